@@ -27,7 +27,7 @@ function Force-Copy($Source, $Destination) {
 }
 
 # Package up all necessary header and manifest files.
-$IncFiles = "msquic.h", "msquicp.h", "msquic_winkernel.h", "msquic_winuser.h"
+$IncFiles = "msquic.h", "msquic.hpp", "msquicp.h", "msquic_winkernel.h", "msquic_winuser.h"
 foreach ($File in $IncFiles) {
     Force-Copy (Join-Path $RootDir "src/inc/$File") $PackageDir
 }
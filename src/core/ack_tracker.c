@@ -54,6 +54,7 @@ QuicAckTrackerInitialize(
     Tracker->LargestPacketNumberAcknowledged = 0;
     Tracker->LargestPacketNumberRecvTime = 0;
     Tracker->AlreadyWrittenAckFrame = FALSE;
+    Tracker->EncodedAckBlocksValid = FALSE;
 
     Status =
         QuicRangeInitialize(
@@ -97,6 +98,8 @@ QuicAckTrackerReset(
     Tracker->LargestPacketNumberAcknowledged = 0;
     Tracker->LargestPacketNumberRecvTime = 0;
     Tracker->AlreadyWrittenAckFrame = FALSE;
+    Tracker->EncodedAckBlocksValid = FALSE;
+    QuicZeroMemory(&Tracker->ReceivedECN, sizeof(Tracker->ReceivedECN));
     QuicRangeReset(&Tracker->PacketNumbersToAck);
     QuicRangeReset(&Tracker->PacketNumbersReceived);
 }
@@ -119,7 +122,9 @@ void
 QuicAckTrackerAckPacket(
     _Inout_ QUIC_ACK_TRACKER* Tracker,
     _In_ uint64_t PacketNumber,
-    _In_ BOOLEAN AckElicitingPayload
+    _In_ uint64_t RecvTime,
+    _In_ QUIC_ECN_TYPE ECN,
+    _In_ QUIC_ACK_TYPE AckType
     )
 {
     QUIC_CONNECTION* Connection = QuicAckTrackerGetPacketSpace(Tracker)->Connection;
@@ -137,6 +142,7 @@ QuicAckTrackerAckPacket(
         Connection->Stats.Recv.ReorderedPackets++;
     }
 
+    uint32_t RangeCount = QuicRangeSize(&Tracker->PacketNumbersToAck);
     if (!QuicRangeAddValue(&Tracker->PacketNumbersToAck, PacketNumber)) {
         //
         // Allocation failure. Fatal error for the connection in this case.
@@ -145,6 +151,15 @@ QuicAckTrackerAckPacket(
         return;
     }
 
+    if (RangeCount != QuicRangeSize(&Tracker->PacketNumbersToAck) ||
+        PacketNumber <= QuicRangeGet(&Tracker->PacketNumbersToAck, RangeCount - 1)->Low) {
+        //
+        // Anything but extending the largest range upwards changes the
+        // additional ACK blocks.
+        //
+        Tracker->EncodedAckBlocksValid = FALSE;
+    }
+
     QuicTraceLogVerbose(
         PacketRxMarkedForAck,
         "[%c][RX][%llu] Marked for ACK",
@@ -154,12 +169,26 @@ QuicAckTrackerAckPacket(
     BOOLEAN NewLargestPacketNumber =
         PacketNumber == QuicRangeGetMax(&Tracker->PacketNumbersToAck);
     if (NewLargestPacketNumber) {
-        Tracker->LargestPacketNumberRecvTime = QuicTimeUs64();
+        Tracker->LargestPacketNumberRecvTime = RecvTime;
     }
 
     Tracker->AlreadyWrittenAckFrame = FALSE;
 
-    if (!AckElicitingPayload) {
+    switch (ECN) {
+    case QUIC_ECN_ECT_1:
+        Tracker->ReceivedECN.ECT_1_Count++;
+        break;
+    case QUIC_ECN_ECT_0:
+        Tracker->ReceivedECN.ECT_0_Count++;
+        break;
+    case QUIC_ECN_CE:
+        Tracker->ReceivedECN.CE_Count++;
+        break;
+    default:
+        break;
+    }
+
+    if (AckType == QUIC_ACK_TYPE_NON_ACK_ELICITING) {
         goto Exit;
     }
 
@@ -172,26 +201,36 @@ QuicAckTrackerAckPacket(
     //
     // There are several conditions where we decide to send an ACK immediately:
     //
-    //   1. We have received QUIC_MIN_ACK_SEND_NUMBER ACK eliciting packets.
-    //   2. We received an ACK eliciting packet that doesn't directly follow the
+    //   1. The peer explicitly asked for one with an IMMEDIATE_ACK frame.
+    //   2. We have received PacketTolerance ACK eliciting packets. This starts
+    //      as QUIC_MIN_ACK_SEND_NUMBER and may be changed by the peer with an
+    //      ACK_FREQUENCY frame.
+    //   3. We received an ACK eliciting packet that doesn't directly follow the
     //      previously received packet number. So we assume there might have
-    //      been loss and should indicate this info to the peer.
-    //   3. The delayed ACK timer fires after the configured time.
+    //      been loss and should indicate this info to the peer. The peer may
+    //      ask us to ignore reordering with an ACK_FREQUENCY frame.
+    //   4. We received an ACK eliciting packet marked with congestion
+    //      experienced (CE), so the peer can react to it as soon as possible.
+    //   5. The delayed ACK timer fires after the configured time.
     //
     // If we don't queue an immediate ACK and this is the first ACK eliciting
     // packet received, we make sure the ACK delay timer is started.
     //
 
-    if (Tracker->AckElicitingPacketsToAcknowledge >= QUIC_MIN_ACK_SEND_NUMBER ||
-        (NewLargestPacketNumber &&
+    if (AckType == QUIC_ACK_TYPE_ACK_IMMEDIATE ||
+        ECN == QUIC_ECN_CE ||
+        Tracker->AckElicitingPacketsToAcknowledge >= (uint16_t)Connection->PacketTolerance ||
+        (!Connection->State.IgnoreReordering &&
+         NewLargestPacketNumber &&
          QuicRangeSize(&Tracker->PacketNumbersToAck) > 1 && // There are more than two ranges, i.e. a gap somewhere.
             QuicRangeGet(
             &Tracker->PacketNumbersToAck,
          QuicRangeSize(&Tracker->PacketNumbersToAck) - 1)->Count == 1)) { // The gap is right before the last packet number.
         //
-        // Always send an ACK immediately if we have received enough ACK
-        // eliciting packets OR the latest one indicate a gap in the packet
-        // numbers, which likely means there was loss.
+        // Always send an ACK immediately if the peer asked for one, we have
+        // received enough ACK eliciting packets, the latest one was CE marked
+        // OR it indicates a gap in the packet numbers, which likely means
+        // there was loss.
         //
         QuicSendSetSendFlag(&Connection->Send, QUIC_CONN_SEND_FLAG_ACK);
 
@@ -223,10 +262,32 @@ QuicAckTrackerAckFrameEncode(
 
     AckDelay >>= Builder->Connection->AckDelayExponent;
 
-    if (!QuicAckFrameEncode(
+    //
+    // The ECN counts are only included once any ECN marked packet has been
+    // received.
+    //
+    BOOLEAN HasECN =
+        Tracker->ReceivedECN.ECT_0_Count != 0 ||
+        Tracker->ReceivedECN.ECT_1_Count != 0 ||
+        Tracker->ReceivedECN.CE_Count != 0;
+
+    if (!Tracker->EncodedAckBlocksValid) {
+        QuicAckBlocksEncode(
+            &Tracker->PacketNumbersToAck,
+            sizeof(Tracker->EncodedAckBlocks),
+            Tracker->EncodedAckBlocks,
+            &Tracker->EncodedAckBlocksLength,
+            &Tracker->EncodedAckBlockCount);
+        Tracker->EncodedAckBlocksValid = TRUE;
+    }
+
+    if (!QuicAckFrameEncodeWithBlocks(
             &Tracker->PacketNumbersToAck,
             AckDelay,
-            NULL, // No ECN right now.
+            HasECN ? &Tracker->ReceivedECN : NULL,
+            Tracker->EncodedAckBlockCount,
+            Tracker->EncodedAckBlocksLength,
+            Tracker->EncodedAckBlocks,
             &Builder->DatagramLength,
             (uint16_t)Builder->Datagram->Length - Builder->EncryptionOverhead,
             Builder->Datagram->Buffer)) {
@@ -263,6 +324,26 @@ QuicAckTrackerOnAckFrameAcked(
     QuicRangeSetMin(
         &Tracker->PacketNumbersToAck,
         LargestAckedPacketNumber + 1);
+    Tracker->EncodedAckBlocksValid = FALSE;
+
+    //
+    // The peer has already treated the packets missing from that ACK frame as
+    // lost, so there's no use in tracking the old gaps for duplicate detection
+    // any more. Collapse everything older than a window below the largest
+    // acknowledged packet number into a single subrange.
+    //
+    if (LargestAckedPacketNumber > QUIC_DUPLICATE_PACKET_WINDOW) {
+        uint64_t Floor = LargestAckedPacketNumber - QUIC_DUPLICATE_PACKET_WINDOW;
+        QUIC_SUBRANGE* Sub = QuicRangeGetSafe(&Tracker->PacketNumbersReceived, 0);
+        if (Sub != NULL && QuicRangeGetHigh(Sub) + 1 < Floor) {
+            BOOLEAN RangeUpdated;
+            (void)QuicRangeAddRange(
+                &Tracker->PacketNumbersReceived,
+                Sub->Low,
+                Floor - Sub->Low,
+                &RangeUpdated);
+        }
+    }
 
     if (!QuicAckTrackerHasPacketsToAck(Tracker) &&
         Tracker->AckElicitingPacketsToAcknowledge) {
@@ -10,7 +10,9 @@ typedef struct QUIC_ACK_TRACKER {
     //
     // Range of packet numbers we have received. Used for duplicate packet
     // detection. The range's growth is limited to QUIC_MAX_RANGE_DUPLICATE_PACKETS
-    // bytes. When this limit is hit, older packets are silently dropped.
+    // bytes. When this limit is hit, older packets are silently dropped. Gaps
+    // more than QUIC_DUPLICATE_PACKET_WINDOW below the largest packet number
+    // of an acknowledged ACK frame are filled in.
     //
     QUIC_RANGE PacketNumbersReceived;
 
@@ -36,12 +38,37 @@ typedef struct QUIC_ACK_TRACKER {
     //
     uint16_t AckElicitingPacketsToAcknowledge;
 
+    //
+    // The number of packets received with each ECN codepoint, reported back
+    // to the peer in the ACK frames.
+    //
+    QUIC_ACK_ECN_EX ReceivedECN;
+
     //
     // Indicates an ACK frame has already been written for all the currently
     // queued packet numbers.
     //
     BOOLEAN AlreadyWrittenAckFrame;
 
+    //
+    // Indicates EncodedAckBlocks matches the current PacketNumbersToAck.
+    // Packets that only extend the largest range don't change the additional
+    // ACK blocks, so they are usually reused by many ACK frames.
+    //
+    BOOLEAN EncodedAckBlocksValid;
+
+    //
+    // The number and length of the additional ACK blocks in EncodedAckBlocks.
+    //
+    uint16_t EncodedAckBlocksLength;
+    uint32_t EncodedAckBlockCount;
+
+    //
+    // The additional ACK blocks (all but the largest range) of
+    // PacketNumbersToAck, as encoded in the ACK frame.
+    //
+    uint8_t EncodedAckBlocks[QUIC_MAX_ACK_BLOCKS_ENCODED_LENGTH];
+
 } QUIC_ACK_TRACKER;
 
 //
@@ -81,15 +108,25 @@ QuicAckTrackerAddPacketNumber(
     _In_ uint64_t PacketNumber
     );
 
+typedef enum QUIC_ACK_TYPE {
+    QUIC_ACK_TYPE_NON_ACK_ELICITING,
+    QUIC_ACK_TYPE_ACK_ELICITING,
+    QUIC_ACK_TYPE_ACK_IMMEDIATE,    // The peer sent an IMMEDIATE_ACK frame.
+} QUIC_ACK_TYPE;
+
 //
 // Adds the packet number to the list of packets that should be acknowledged.
+// RecvTime is when the packet's datagram was received, which the ACK delay
+// is measured from.
 //
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
 QuicAckTrackerAckPacket(
     _Inout_ QUIC_ACK_TRACKER* Tracker,
     _In_ uint64_t PacketNumber,
-    _In_ BOOLEAN AckElicitingPayload
+    _In_ uint64_t RecvTime,
+    _In_ QUIC_ECN_TYPE ECN,
+    _In_ QUIC_ACK_TYPE AckType
     );
 
 //
@@ -387,7 +387,7 @@ MsQuicConnectionSendResumptionTicket(
         goto Error;
     }
 
-    if (Flags > (QUIC_SEND_RESUMPTION_FLAG_FINAL | QUIC_SEND_RESUMPTION_FLAG_NONE)) {
+    if (Flags > (QUIC_SEND_RESUMPTION_FLAG_FINAL | QUIC_SEND_RESUMPTION_FLAG_DEFER)) {
         Status = QUIC_STATUS_INVALID_PARAMETER;
         goto Error;
     }
@@ -854,6 +854,7 @@ MsQuicStreamSend(
     uint64_t TotalLength;
     QUIC_SEND_REQUEST* SendRequest;
     BOOLEAN QueueOper = TRUE;
+    BOOLEAN SendInline;
     QUIC_OPERATION* Oper;
 
     QuicTraceEvent(
@@ -903,7 +904,7 @@ MsQuicStreamSend(
     }
 
 #pragma prefast(suppress: __WARNING_6014, "Memory is correctly freed (QuicStreamCompleteSendRequest).")
-    SendRequest = QuicPoolAlloc(&Connection->Worker->SendRequestPool);
+    SendRequest = QuicConnAllocSendRequest(Connection);
     if (SendRequest == NULL) {
         Status = QUIC_STATUS_OUT_OF_MEMORY;
         QuicTraceEvent(
@@ -936,11 +937,24 @@ MsQuicStreamSend(
     QuicDispatchLockRelease(&Stream->ApiSendRequestLock);
 
     if (QUIC_FAILED(Status)) {
-        QuicPoolFree(&Connection->Worker->SendRequestPool, SendRequest);
+        QuicConnFreeSendRequest(Connection, SendRequest);
         goto Exit;
     }
 
-    if (QueueOper) {
+    //
+    // When called on the worker thread (i.e. from a callback) the send is
+    // flushed inline, instead of through an operation. Not with send
+    // buffering though, because the buffered requests complete immediately,
+    // and the app's callback mustn't be called from within its own call.
+    //
+    SendInline =
+        Connection->WorkerThreadID == QuicCurThreadID() &&
+        !Connection->State.UseSendBuffer;
+
+    if (SendInline) {
+        QuicStreamSendFlush(Stream);
+
+    } else if (QueueOper) {
         Oper = QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_API_CALL);
         if (Oper == NULL) {
             Status = QUIC_STATUS_OUT_OF_MEMORY;
@@ -979,6 +993,229 @@ Exit:
     return Status;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QUIC_API
+MsQuicStreamSendBatch(
+    _In_ _Pre_defensive_ HQUIC Handle,
+    _Inout_updates_(EntryCount) _Pre_defensive_
+        QUIC_STREAM_SEND_BATCH_ENTRY* Entries,
+    _In_ uint32_t EntryCount
+    )
+{
+    QUIC_STATUS Status;
+    QUIC_CONNECTION* Connection;
+    QUIC_STREAM** Streams = NULL;
+    uint32_t StreamCount = 0;
+    BOOLEAN SendInline;
+    QUIC_OPERATION* Oper = NULL;
+
+    QuicTraceEvent(
+        ApiEnter,
+        "[ api] Enter %u (%p).",
+        QUIC_TRACE_API_STREAM_SEND_BATCH,
+        Handle);
+
+    if (!IS_CONN_HANDLE(Handle) ||
+        Entries == NULL ||
+        EntryCount == 0) {
+        Status = QUIC_STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+#pragma prefast(suppress: __WARNING_25024, "Pointer cast already validated.")
+    Connection = (QUIC_CONNECTION*)Handle;
+
+    QUIC_CONN_VERIFY(Connection, !Connection->State.Freed);
+    QUIC_CONN_VERIFY(Connection,
+        (Connection->WorkerThreadID == QuicCurThreadID()) ||
+        !Connection->State.HandleClosed);
+
+    //
+    // Validate all the entries up front, so that nothing is queued if any of
+    // them are invalid.
+    //
+    for (uint32_t i = 0; i < EntryCount; ++i) {
+        QUIC_STREAM_SEND_BATCH_ENTRY* Entry = &Entries[i];
+        Entry->Status = QUIC_STATUS_INVALID_PARAMETER;
+
+        if (!IS_STREAM_HANDLE(Entry->Stream) ||
+            Entry->Buffers == NULL ||
+            Entry->BufferCount == 0) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            goto Exit;
+        }
+
+#pragma prefast(suppress: __WARNING_25024, "Pointer cast already validated.")
+        QUIC_STREAM* Stream = (QUIC_STREAM*)Entry->Stream;
+
+        QUIC_TEL_ASSERT(!Stream->Flags.HandleClosed);
+        QUIC_TEL_ASSERT(!Stream->Flags.Freed);
+
+        if (Stream->Connection != Connection) {
+            QuicTraceEvent(
+                StreamError,
+                "[strm][%p] ERROR, %s.",
+                Stream,
+                "Batched send stream belongs to another connection");
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            goto Exit;
+        }
+
+        uint64_t TotalLength = 0;
+        for (uint32_t j = 0; j < Entry->BufferCount; ++j) {
+            TotalLength += Entry->Buffers[j].Length;
+        }
+
+        if (TotalLength > UINT32_MAX) {
+            QuicTraceEvent(
+                StreamError,
+                "[strm][%p] ERROR, %s.",
+                Stream,
+                "Send request total length exceeds max");
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            goto Exit;
+        }
+
+        if (TotalLength == 0 && !(Entry->Flags & QUIC_SEND_FLAG_FIN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            goto Exit;
+        }
+    }
+
+    //
+    // Flushed inline on the worker thread, as in MsQuicStreamSend.
+    //
+    SendInline =
+        Connection->WorkerThreadID == QuicCurThreadID() &&
+        !Connection->State.UseSendBuffer;
+
+    if (!SendInline) {
+        //
+        // The operation is allocated before anything is queued, so that a
+        // failure doesn't leave sends queued without an operation to flush
+        // them.
+        //
+        Streams = QUIC_ALLOC_NONPAGED(sizeof(QUIC_STREAM*) * EntryCount);
+        if (Streams == NULL) {
+            Status = QUIC_STATUS_OUT_OF_MEMORY;
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "STRM_SEND_BATCH streams",
+                sizeof(QUIC_STREAM*) * EntryCount);
+            goto Exit;
+        }
+
+        Oper = QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_API_CALL);
+        if (Oper == NULL) {
+            Status = QUIC_STATUS_OUT_OF_MEMORY;
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "STRM_SEND_BATCH operation",
+                0);
+            QUIC_FREE(Streams);
+            goto Exit;
+        }
+        Oper->API_CALL.Context->Type = QUIC_API_TYPE_STRM_SEND_BATCH;
+        Oper->API_CALL.Context->STRM_SEND_BATCH.Streams = Streams;
+    }
+
+    Status = QUIC_STATUS_PENDING;
+    for (uint32_t i = 0; i < EntryCount; ++i) {
+        QUIC_STREAM_SEND_BATCH_ENTRY* Entry = &Entries[i];
+        QUIC_STREAM* Stream = (QUIC_STREAM*)Entry->Stream;
+
+        uint64_t TotalLength = 0;
+        for (uint32_t j = 0; j < Entry->BufferCount; ++j) {
+            TotalLength += Entry->Buffers[j].Length;
+        }
+
+#pragma prefast(suppress: __WARNING_6014, "Memory is correctly freed (QuicStreamCompleteSendRequest).")
+        QUIC_SEND_REQUEST* SendRequest =
+            QuicConnAllocSendRequest(Connection);
+        if (SendRequest == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "Stream Send request",
+                0);
+            Entry->Status = QUIC_STATUS_OUT_OF_MEMORY;
+
+        } else {
+            SendRequest->Next = NULL;
+            SendRequest->Buffers = Entry->Buffers;
+            SendRequest->BufferCount = Entry->BufferCount;
+            SendRequest->Flags = Entry->Flags & ~QUIC_SEND_FLAGS_INTERNAL;
+            SendRequest->TotalLength = TotalLength;
+            SendRequest->ClientContext = Entry->ClientSendContext;
+
+            QuicDispatchLockAcquire(&Stream->ApiSendRequestLock);
+            if (!Stream->Flags.SendEnabled) {
+                Entry->Status = QUIC_STATUS_INVALID_STATE;
+            } else {
+                QUIC_SEND_REQUEST** ApiSendRequestsTail = &Stream->ApiSendRequests;
+                while (*ApiSendRequestsTail != NULL) {
+                    ApiSendRequestsTail = &((*ApiSendRequestsTail)->Next);
+                }
+                *ApiSendRequestsTail = SendRequest;
+                Entry->Status = QUIC_STATUS_PENDING;
+            }
+            QuicDispatchLockRelease(&Stream->ApiSendRequestLock);
+
+            if (QUIC_FAILED(Entry->Status)) {
+                QuicConnFreeSendRequest(Connection, SendRequest);
+            }
+        }
+
+        if (QUIC_FAILED(Entry->Status)) {
+            if (Status == QUIC_STATUS_PENDING) {
+                Status = Entry->Status;
+            }
+            continue;
+        }
+
+        if (SendInline) {
+            QuicStreamSendFlush(Stream);
+            continue;
+        }
+
+        //
+        // The stream is flushed by this operation, even if an earlier send on
+        // it already queued one, so the sends on all the streams end up in the
+        // same flush. Each entry holds its own ref on the stream, released
+        // after the operation is processed.
+        //
+        QuicStreamAddRef(Stream, QUIC_STREAM_REF_OPERATION);
+        Streams[StreamCount++] = Stream;
+    }
+
+    if (SendInline) {
+        goto Exit;
+    }
+
+    Oper->API_CALL.Context->STRM_SEND_BATCH.StreamCount = StreamCount;
+    if (StreamCount == 0) {
+        QuicOperationFree(Connection->Worker, Oper);
+        goto Exit;
+    }
+
+    //
+    // Queue the operation but don't wait for the completion.
+    //
+    QuicConnQueueOper(Connection, Oper);
+
+Exit:
+
+    QuicTraceEvent(
+        ApiExitStatus,
+        "[ api] Exit %u",
+        Status);
+
+    return Status;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_STATUS
 QUIC_API
@@ -1095,6 +1332,22 @@ MsQuicStreamReceiveComplete(
         goto Exit;
     }
 
+    if (Connection->WorkerThreadID == QuicCurThreadID() &&
+        Stream->Flags.ReceiveCallActive) {
+        //
+        // Called from within the receive callback. The length is recorded and
+        // the receive is completed when the callback returns.
+        //
+        if (Stream->Flags.ReceiveCompletedInline) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            goto Exit;
+        }
+        Stream->Flags.ReceiveCompletedInline = TRUE;
+        Stream->RecvInlineCompletionLength = BufferLength;
+        Status = QUIC_STATUS_SUCCESS;
+        goto Exit;
+    }
+
     Oper = QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_API_CALL);
     if (Oper == NULL) {
         Status = QUIC_STATUS_OUT_OF_MEMORY;
@@ -1133,6 +1386,72 @@ Exit:
     return Status;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QUIC_API
+MsQuicDatagramReceiveComplete(
+    _In_ _Pre_defensive_ HQUIC Handle,
+    _In_ _Pre_defensive_ const QUIC_BUFFER* Buffer
+    )
+{
+    QUIC_STATUS Status;
+    QUIC_CONNECTION* Connection;
+    QUIC_OPERATION* Oper;
+
+    QuicTraceEvent(
+        ApiEnter,
+        "[ api] Enter %u (%p).",
+        QUIC_TRACE_API_DATAGRAM_RECEIVE_COMPLETE,
+        Handle);
+
+    if (!IS_CONN_HANDLE(Handle) ||
+        Buffer == NULL) {
+        Status = QUIC_STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+#pragma prefast(suppress: __WARNING_25024, "Pointer cast already validated.")
+    Connection = (QUIC_CONNECTION*)Handle;
+
+    QUIC_CONN_VERIFY(Connection, !Connection->State.Freed);
+    QUIC_CONN_VERIFY(Connection,
+        (Connection->WorkerThreadID == QuicCurThreadID()) ||
+        !Connection->State.HandleClosed);
+
+    //
+    // Always queued, even on the worker thread, because the app may call this
+    // from within the receive callback, before the buffer is actually lent.
+    //
+    Oper = QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_API_CALL);
+    if (Oper == NULL) {
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "DATAGRAM_RECV_COMPLETE operation",
+            0);
+        goto Exit;
+    }
+
+    Oper->API_CALL.Context->Type = QUIC_API_TYPE_DATAGRAM_RECV_COMPLETE;
+    Oper->API_CALL.Context->DATAGRAM_RECV_COMPLETE.Buffer = Buffer;
+
+    //
+    // Queue the operation but don't wait for the completion.
+    //
+    QuicConnQueueOper(Connection, Oper);
+    Status = QUIC_STATUS_SUCCESS;
+
+Exit:
+
+    QuicTraceEvent(
+        ApiExitStatus,
+        "[ api] Exit %u",
+        Status);
+
+    return Status;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QUIC_API
@@ -1405,7 +1724,7 @@ MsQuicDatagramSend(
     }
 
 #pragma prefast(suppress: __WARNING_6014, "Memory is correctly freed (...).")
-    SendRequest = QuicPoolAlloc(&Connection->Worker->SendRequestPool);
+    SendRequest = QuicConnAllocSendRequest(Connection);
     if (SendRequest == NULL) {
         Status = QUIC_STATUS_OUT_OF_MEMORY;
         goto Error;
@@ -1416,6 +1735,7 @@ MsQuicDatagramSend(
     SendRequest->BufferCount = BufferCount;
     SendRequest->Flags = Flags;
     SendRequest->TotalLength = TotalLength;
+    SendRequest->ExpirationTime = 0;
     SendRequest->ClientContext = ClientSendContext;
 
     Status = QuicDatagramQueueSend(&Connection->Datagram, SendRequest);
@@ -1429,3 +1749,98 @@ Error:
 
     return Status;
 }
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QUIC_API
+MsQuicDatagramSendBatch(
+    _In_ _Pre_defensive_ HQUIC Handle,
+    _Inout_updates_(EntryCount) _Pre_defensive_
+        QUIC_DATAGRAM_SEND_BATCH_ENTRY* Entries,
+    _In_ uint32_t EntryCount
+    )
+{
+    QUIC_STATUS Status;
+    QUIC_CONNECTION* Connection;
+    uint64_t TimeNow = 0;
+
+    QuicTraceEvent(
+        ApiEnter,
+        "[ api] Enter %u (%p).",
+        QUIC_TRACE_API_DATAGRAM_SEND_BATCH,
+        Handle);
+
+    if (!IS_CONN_HANDLE(Handle) ||
+        Entries == NULL ||
+        EntryCount == 0) {
+        Status = QUIC_STATUS_INVALID_PARAMETER;
+        goto Error;
+    }
+
+#pragma prefast(suppress: __WARNING_25024, "Pointer cast already validated.")
+    Connection = (QUIC_CONNECTION*)Handle;
+
+    QUIC_TEL_ASSERT(!Connection->State.Freed);
+
+    Status = QUIC_STATUS_PENDING;
+    for (uint32_t i = 0; i < EntryCount; ++i) {
+        QUIC_DATAGRAM_SEND_BATCH_ENTRY* Entry = &Entries[i];
+
+        uint64_t TotalLength = 0;
+        if (Entry->Buffers != NULL) {
+            for (uint32_t j = 0; j < Entry->BufferCount; ++j) {
+                TotalLength += Entry->Buffers[j].Length;
+            }
+        }
+
+        if (Entry->Buffers == NULL || Entry->BufferCount == 0) {
+            Entry->Status = QUIC_STATUS_INVALID_PARAMETER;
+
+        } else if (TotalLength > UINT16_MAX) {
+            QuicTraceEvent(
+                ConnError,
+                "[conn][%p] ERROR, %s.",
+                Connection,
+                "Send request total length exceeds max");
+            Entry->Status = QUIC_STATUS_INVALID_PARAMETER;
+
+        } else {
+#pragma prefast(suppress: __WARNING_6014, "Memory is correctly freed (...).")
+            QUIC_SEND_REQUEST* SendRequest =
+                QuicConnAllocSendRequest(Connection);
+            if (SendRequest == NULL) {
+                Entry->Status = QUIC_STATUS_OUT_OF_MEMORY;
+            } else {
+                if (Entry->LifetimeMs != 0 && TimeNow == 0) {
+                    TimeNow = QuicTimeUs64();
+                }
+                SendRequest->Next = NULL;
+                SendRequest->Buffers = Entry->Buffers;
+                SendRequest->BufferCount = Entry->BufferCount;
+                SendRequest->Flags = Entry->Flags;
+                SendRequest->TotalLength = TotalLength;
+                SendRequest->ExpirationTime =
+                    Entry->LifetimeMs != 0 ?
+                        TimeNow + MS_TO_US((uint64_t)Entry->LifetimeMs) : 0;
+                SendRequest->ClientContext = Entry->ClientSendContext;
+
+                Entry->Status =
+                    QuicDatagramQueueSend(&Connection->Datagram, SendRequest);
+            }
+        }
+
+        if (Entry->Status != QUIC_STATUS_PENDING &&
+            Status == QUIC_STATUS_PENDING) {
+            Status = Entry->Status;
+        }
+    }
+
+Error:
+
+    QuicTraceEvent(
+        ApiExitStatus,
+        "[ api] Exit %u",
+        Status);
+
+    return Status;
+}
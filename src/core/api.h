@@ -72,6 +72,27 @@ MsQuicSessionShutdown(
     _In_ _Pre_defensive_ QUIC_UINT62 ErrorCode
     );
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QUIC_API
+MsQuicPoolStreamOpen(
+    _In_ _Pre_defensive_ HQUIC Session,
+    _In_z_ const char* ServerName,
+    _In_ uint16_t ServerPort,
+    _In_ QUIC_STREAM_OPEN_FLAGS Flags,
+    _In_ _Pre_defensive_ QUIC_STREAM_CALLBACK_HANDLER Handler,
+    _In_opt_ void* Context,
+    _Outptr_ _At_(*Stream, __drv_allocatesMem(Mem)) _Pre_defensive_
+        HQUIC *Stream
+    );
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+uint64_t
+QUIC_API
+MsQuicExecutionPoll(
+    _In_ _Pre_defensive_ QUIC_EXECUTION_CONTEXT* ExecutionContext
+    );
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QUIC_API
@@ -205,6 +226,16 @@ MsQuicStreamSend(
     _In_opt_ void* ClientSendContext
     );
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QUIC_API
+MsQuicStreamSendBatch(
+    _In_ _Pre_defensive_ HQUIC Handle,
+    _Inout_updates_(EntryCount) _Pre_defensive_
+        QUIC_STREAM_SEND_BATCH_ENTRY* Entries,
+    _In_ uint32_t EntryCount
+    );
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_STATUS
 QUIC_API
@@ -260,3 +291,21 @@ MsQuicDatagramSend(
     _In_ QUIC_SEND_FLAGS Flags,
     _In_opt_ void* ClientSendContext
     );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QUIC_API
+MsQuicDatagramSendBatch(
+    _In_ _Pre_defensive_ HQUIC Handle,
+    _Inout_updates_(EntryCount) _Pre_defensive_
+        QUIC_DATAGRAM_SEND_BATCH_ENTRY* Entries,
+    _In_ uint32_t EntryCount
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QUIC_API
+MsQuicDatagramReceiveComplete(
+    _In_ _Pre_defensive_ HQUIC Handle,
+    _In_ _Pre_defensive_ const QUIC_BUFFER* Buffer
+    );
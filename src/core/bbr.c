@@ -0,0 +1,1253 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    BBRv2 congestion control algorithm (draft-cardwell-iccrg-bbr-congestion-
+    control-02).
+
+    BBR builds a model of the network path from delivery rate samples (see
+    QUIC_ACK_EVENT) and the min RTT, and paces at the estimated bottleneck
+    bandwidth. Loss is used to bound the model: high loss while probing caps
+    the long term inflight bound (InflightHi) and loss in other phases lowers
+    the short term bounds (BwLo and InflightLo).
+
+Future work:
+
+    -Track the bytes in flight at send time per packet, instead of
+     approximating it with the bytes in flight at loss detection time.
+    -ACK aggregation (extra_acked) compensation for the congestion window.
+
+--*/
+
+#include "precomp.h"
+#ifdef QUIC_CLOG
+#include "bbr.c.clog.h"
+#endif
+
+//
+// Gains, in units of BBR_UNIT.
+//
+#define BBR_UNIT 256
+#define BBR_STARTUP_PACING_GAIN 709         // 2.77 ~= 4 * ln(2)
+#define BBR_STARTUP_CWND_GAIN 512           // 2
+#define BBR_DRAIN_PACING_GAIN 90            // 0.35
+#define BBR_PROBE_BW_DOWN_PACING_GAIN 230   // 0.9
+#define BBR_PROBE_BW_UP_PACING_GAIN 320     // 1.25
+#define BBR_CWND_GAIN 512                   // 2
+#define BBR_PROBE_RTT_CWND_GAIN 128         // 0.5
+#define BBR_BETA 179                        // 0.7
+#define BBR_HEADROOM 217                    // 0.85
+
+//
+// STARTUP exits once the bandwidth estimate grows by less than 25% for this
+// many rounds.
+//
+#define BBR_STARTUP_GROWTH_TARGET 320       // 1.25
+#define BBR_STARTUP_FULL_BW_ROUNDS 3
+
+//
+// STARTUP also exits if the loss rate is too high over at least this many
+// loss events in a round.
+//
+#define BBR_STARTUP_FULL_LOSS_COUNT 6
+
+//
+// The maximum tolerated loss rate, in percent, before the inflight bounds
+// are reduced.
+//
+#define BBR_LOSS_THRESHOLD_PERCENT 2
+
+//
+// Pace slightly below the estimated bandwidth to avoid building a queue.
+//
+#define BBR_PACING_MARGIN_PERCENT 1
+
+#define BBR_MIN_PIPE_CWND_PACKETS 4
+#define BBR_QUANTA_PACKETS 3
+
+#define BBR_MIN_RTT_FILTER_LEN_US MS_TO_US(10000)
+#define BBR_PROBE_RTT_INTERVAL_US MS_TO_US(5000)
+#define BBR_PROBE_RTT_DURATION_US MS_TO_US(200)
+
+//
+// Time between bandwidth probes: a random value in [2, 3) seconds, or the
+// time Reno would take to grow by one BDP, up to this many rounds.
+//
+#define BBR_PROBE_BW_BASE_WAIT_US MS_TO_US(2000)
+#define BBR_PROBE_BW_RAND_WAIT_US MS_TO_US(1000)
+#define BBR_PROBE_BW_MAX_ROUNDS 63
+
+#define BBR_INFINITE_BW UINT64_MAX
+#define BBR_INFINITE_INFLIGHT UINT32_MAX
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlLogState(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    const QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    UNREFERENCED_PARAMETER(Bbr);
+    QuicTraceLogConnVerbose(
+        BbrState,
+        QuicCongestionControlGetConnection(Cc),
+        "BBR: State=%hhu ProbeBwState=%hhu CWnd=%u PacingRate=%llu MinRtt=%u InflightHi=%u InflightLo=%u",
+        Bbr->State,
+        Bbr->ProbeBwState,
+        Bbr->CongestionWindow,
+        Bbr->PacingRate,
+        Bbr->MinRtt,
+        Bbr->InflightHi,
+        Bbr->InflightLo);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+BbrCongestionControlGetMtu(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return QuicCongestionControlGetConnection(Cc)->Paths[0].Mtu;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+BbrCongestionControlGetMinPipeCwnd(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return BBR_MIN_PIPE_CWND_PACKETS * BbrCongestionControlGetMtu(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint64_t
+BbrCongestionControlGetMaxBw(
+    _In_ const QUIC_CONGESTION_CONTROL_BBR* Bbr
+    )
+{
+    return max(Bbr->MaxBwFilter[0], Bbr->MaxBwFilter[1]);
+}
+
+//
+// The bandwidth the model currently uses: the max bandwidth, bounded by the
+// short term lower bound.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint64_t
+BbrCongestionControlGetBw(
+    _In_ const QUIC_CONGESTION_CONTROL_BBR* Bbr
+    )
+{
+    return min(BbrCongestionControlGetMaxBw(Bbr), Bbr->BwLo);
+}
+
+//
+// Returns the estimated bandwidth-delay product scaled by Gain.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+BbrCongestionControlGetBdp(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t Gain
+    )
+{
+    const QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    const uint64_t Bw = BbrCongestionControlGetBw(Bbr);
+    uint64_t Bdp;
+
+    if (!Bbr->MinRttValid || Bw == 0) {
+        Bdp = (uint64_t)Bbr->InitialWindowPackets * BbrCongestionControlGetMtu(Cc);
+    } else {
+        Bdp = Bw * Bbr->MinRtt / MS_TO_US(1000);
+    }
+
+    Bdp = Bdp * Gain / BBR_UNIT;
+    return Bdp > UINT32_MAX ? UINT32_MAX : (uint32_t)Bdp;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+BbrCongestionControlGetTargetInflight(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return min(BbrCongestionControlGetBdp(Cc, BBR_UNIT), Cc->Bbr.CongestionWindow);
+}
+
+//
+// Returns InflightHi with some headroom left for other flows to use.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+BbrCongestionControlGetInflightWithHeadroom(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    const QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    if (Bbr->InflightHi == BBR_INFINITE_INFLIGHT) {
+        return BBR_INFINITE_INFLIGHT;
+    }
+
+    const uint32_t Headroom =
+        max(BbrCongestionControlGetMtu(Cc),
+            (uint32_t)((uint64_t)Bbr->InflightHi * (BBR_UNIT - BBR_HEADROOM) / BBR_UNIT));
+    const uint32_t MinPipeCwnd = BbrCongestionControlGetMinPipeCwnd(Cc);
+    if (Bbr->InflightHi < Headroom + MinPipeCwnd) {
+        return MinPipeCwnd;
+    }
+    return Bbr->InflightHi - Headroom;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlSetPacingRateWithGain(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t Gain
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    const uint64_t Bw = BbrCongestionControlGetBw(Bbr);
+    uint64_t Rate;
+
+    if (Bw == 0) {
+        //
+        // No bandwidth sample yet, so estimate from the window and RTT.
+        //
+        const QUIC_PATH* Path = &QuicCongestionControlGetConnection(Cc)->Paths[0];
+        Rate =
+            (uint64_t)Bbr->CongestionWindow * MS_TO_US(1000) /
+            max(Path->SmoothedRtt, 1);
+    } else {
+        Rate = Bw * (100 - BBR_PACING_MARGIN_PERCENT) / 100;
+    }
+
+    Rate = Rate * Gain / BBR_UNIT;
+    if (Bbr->FilledPipe || Rate > Bbr->PacingRate) {
+        Bbr->PacingRate = Rate;
+    }
+}
+
+//
+// The start of a new round is triggered by the delivery of the first packet
+// sent after the previous round started.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlStartRound(
+    _In_ QUIC_CONGESTION_CONTROL_BBR* Bbr,
+    _In_ uint64_t TotalBytesDelivered
+    )
+{
+    Bbr->NextRoundDelivered = TotalBytesDelivered;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlResetLowerBounds(
+    _In_ QUIC_CONGESTION_CONTROL_BBR* Bbr
+    )
+{
+    Bbr->BwLo = BBR_INFINITE_BW;
+    Bbr->InflightLo = BBR_INFINITE_INFLIGHT;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlEnterStartup(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    Bbr->State = QUIC_BBR_STATE_STARTUP;
+    Bbr->PacingGain = BBR_STARTUP_PACING_GAIN;
+    Bbr->CwndGain = BBR_STARTUP_CWND_GAIN;
+    BbrCongestionControlLogState(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlEnterDrain(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    Bbr->State = QUIC_BBR_STATE_DRAIN;
+    Bbr->PacingGain = BBR_DRAIN_PACING_GAIN;
+    Bbr->CwndGain = BBR_STARTUP_CWND_GAIN;
+    BbrCongestionControlLogState(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlStartProbeBwDown(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t TimeNow
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+
+    //
+    // Start a new bandwidth filter cycle.
+    //
+    if (Bbr->MaxBwFilter[1] != 0) {
+        Bbr->MaxBwFilter[0] = Bbr->MaxBwFilter[1];
+        Bbr->MaxBwFilter[1] = 0;
+    }
+
+    //
+    // Randomize the time to the next probe, so that competing flows don't
+    // probe in sync.
+    //
+    uint32_t Random;
+    QuicRandom(sizeof(Random), &Random);
+    Bbr->RoundsSinceBwProbe = Random & 1;
+    Bbr->BwProbeWait = BBR_PROBE_BW_BASE_WAIT_US + (Random % BBR_PROBE_BW_RAND_WAIT_US);
+    Bbr->BwProbeUpCount = UINT32_MAX;
+    Bbr->CycleStartTime = TimeNow;
+
+    Bbr->State = QUIC_BBR_STATE_PROBE_BW;
+    Bbr->ProbeBwState = QUIC_BBR_PROBE_BW_STATE_DOWN;
+    Bbr->PacingGain = BBR_PROBE_BW_DOWN_PACING_GAIN;
+    Bbr->CwndGain = BBR_CWND_GAIN;
+    BbrCongestionControlLogState(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlStartProbeBwCruise(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    Bbr->ProbeBwState = QUIC_BBR_PROBE_BW_STATE_CRUISE;
+    Bbr->PacingGain = BBR_UNIT;
+    BbrCongestionControlLogState(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlStartProbeBwRefill(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t TotalBytesDelivered
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+
+    //
+    // Forget the short term bounds so the probe can use the full model.
+    //
+    BbrCongestionControlResetLowerBounds(Bbr);
+    Bbr->BwProbeUpRounds = 0;
+    Bbr->BwProbeUpAcks = 0;
+    BbrCongestionControlStartRound(Bbr, TotalBytesDelivered);
+
+    Bbr->ProbeBwState = QUIC_BBR_PROBE_BW_STATE_REFILL;
+    Bbr->PacingGain = BBR_UNIT;
+    BbrCongestionControlLogState(Cc);
+}
+
+//
+// Grows InflightHi exponentially (in rounds) while probing up.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlRaiseInflightHiSlope(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    const uint64_t Growth =
+        (uint64_t)BbrCongestionControlGetMtu(Cc) << Bbr->BwProbeUpRounds;
+    if (Bbr->BwProbeUpRounds < 30) {
+        Bbr->BwProbeUpRounds++;
+    }
+    Bbr->BwProbeUpCount = (uint32_t)max(Bbr->CongestionWindow / Growth, 1);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlStartProbeBwUp(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t TimeNow,
+    _In_ uint64_t TotalBytesDelivered
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    BbrCongestionControlStartRound(Bbr, TotalBytesDelivered);
+    Bbr->CycleStartTime = TimeNow;
+    Bbr->ProbeBwState = QUIC_BBR_PROBE_BW_STATE_UP;
+    Bbr->PacingGain = BBR_PROBE_BW_UP_PACING_GAIN;
+    BbrCongestionControlRaiseInflightHiSlope(Cc);
+    BbrCongestionControlLogState(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlProbeInflightHiUpward(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t AckedBytes
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+
+    if (Bbr->InflightHi == BBR_INFINITE_INFLIGHT ||
+        Bbr->BytesInFlight + AckedBytes < Bbr->CongestionWindow) {
+        //
+        // Not cwnd limited, so there's no evidence the bound should grow.
+        //
+        return;
+    }
+
+    Bbr->BwProbeUpAcks += AckedBytes;
+    if (Bbr->BwProbeUpAcks >= Bbr->BwProbeUpCount) {
+        const uint32_t Delta = Bbr->BwProbeUpAcks / Bbr->BwProbeUpCount;
+        Bbr->BwProbeUpAcks -= Delta * Bbr->BwProbeUpCount;
+        const uint64_t InflightHi =
+            (uint64_t)Bbr->InflightHi + (uint64_t)Delta * BbrCongestionControlGetMtu(Cc);
+        Bbr->InflightHi =
+            InflightHi >= BBR_INFINITE_INFLIGHT ?
+                BBR_INFINITE_INFLIGHT - 1 : (uint32_t)InflightHi;
+    }
+
+    if (Bbr->RoundStart) {
+        BbrCongestionControlRaiseInflightHiSlope(Cc);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BbrCongestionControlCheckTimeToProbeBw(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t TimeNow,
+    _In_ uint64_t TotalBytesDelivered
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+
+    //
+    // Probe either after the randomized wall clock wait, or after as many
+    // rounds as Reno would need to grow by a BDP, whichever comes first.
+    //
+    uint32_t RenoRounds =
+        BbrCongestionControlGetTargetInflight(Cc) / BbrCongestionControlGetMtu(Cc);
+    if (RenoRounds > BBR_PROBE_BW_MAX_ROUNDS) {
+        RenoRounds = BBR_PROBE_BW_MAX_ROUNDS;
+    }
+
+    if (QuicTimeDiff32(Bbr->CycleStartTime, TimeNow) > Bbr->BwProbeWait ||
+        Bbr->RoundsSinceBwProbe >= RenoRounds) {
+        BbrCongestionControlStartProbeBwRefill(Cc, TotalBytesDelivered);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlUpdateProbeBwCyclePhase(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+
+    if (!Bbr->FilledPipe || Bbr->State != QUIC_BBR_STATE_PROBE_BW) {
+        return;
+    }
+
+    if (Bbr->ProbeBwState == QUIC_BBR_PROBE_BW_STATE_UP) {
+        BbrCongestionControlProbeInflightHiUpward(Cc, AckEvent->NumRetransmittableBytes);
+    }
+
+    switch (Bbr->ProbeBwState) {
+
+    case QUIC_BBR_PROBE_BW_STATE_DOWN:
+        if (BbrCongestionControlCheckTimeToProbeBw(
+                Cc, AckEvent->TimeNow, AckEvent->TotalBytesDelivered)) {
+            break;
+        }
+        //
+        // Cruise once the queue built while probing has drained.
+        //
+        if (Bbr->BytesInFlight <= BbrCongestionControlGetInflightWithHeadroom(Cc) &&
+            Bbr->BytesInFlight <= BbrCongestionControlGetBdp(Cc, BBR_UNIT)) {
+            BbrCongestionControlStartProbeBwCruise(Cc);
+        }
+        break;
+
+    case QUIC_BBR_PROBE_BW_STATE_CRUISE:
+        BbrCongestionControlCheckTimeToProbeBw(
+            Cc, AckEvent->TimeNow, AckEvent->TotalBytesDelivered);
+        break;
+
+    case QUIC_BBR_PROBE_BW_STATE_REFILL:
+        //
+        // Refill the pipe for one round before probing up.
+        //
+        if (Bbr->RoundStart) {
+            BbrCongestionControlStartProbeBwUp(
+                Cc, AckEvent->TimeNow, AckEvent->TotalBytesDelivered);
+        }
+        break;
+
+    case QUIC_BBR_PROBE_BW_STATE_UP:
+        //
+        // Stop probing once a queue has built up, after at least a min RTT
+        // in this phase.
+        //
+        if (QuicTimeDiff32(Bbr->CycleStartTime, AckEvent->TimeNow) > Bbr->MinRtt &&
+            Bbr->BytesInFlight > BbrCongestionControlGetBdp(Cc, BBR_PROBE_BW_UP_PACING_GAIN)) {
+            BbrCongestionControlStartProbeBwDown(Cc, AckEvent->TimeNow);
+        }
+        break;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlUpdateRound(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+
+    Bbr->RoundStart = FALSE;
+    if (AckEvent->TotalBytesDelivered > Bbr->NextRoundDelivered &&
+        AckEvent->PriorDelivered >= Bbr->NextRoundDelivered) {
+        BbrCongestionControlStartRound(Bbr, AckEvent->TotalBytesDelivered);
+        Bbr->RoundCount++;
+        Bbr->RoundsSinceBwProbe++;
+        Bbr->RoundStart = TRUE;
+    }
+}
+
+//
+// Reduces the short term bounds after a round with loss or CE marks, unless
+// they were caused by probing for bandwidth.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlAdaptLowerBounds(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+
+    if ((Bbr->LossBytesInRound == 0 && !Bbr->EcnCeInRound) ||
+        Bbr->State == QUIC_BBR_STATE_STARTUP ||
+        (Bbr->State == QUIC_BBR_STATE_PROBE_BW &&
+         (Bbr->ProbeBwState == QUIC_BBR_PROBE_BW_STATE_REFILL ||
+          Bbr->ProbeBwState == QUIC_BBR_PROBE_BW_STATE_UP))) {
+        return;
+    }
+
+    if (Bbr->BwLo == BBR_INFINITE_BW) {
+        Bbr->BwLo = BbrCongestionControlGetMaxBw(Bbr);
+    }
+    if (Bbr->InflightLo == BBR_INFINITE_INFLIGHT) {
+        Bbr->InflightLo = Bbr->CongestionWindow;
+    }
+
+    Bbr->BwLo = max(Bbr->BwLatest, Bbr->BwLo * BBR_BETA / BBR_UNIT);
+    const uint64_t InflightLo =
+        max(Bbr->InflightLatest, (uint64_t)Bbr->InflightLo * BBR_BETA / BBR_UNIT);
+    Bbr->InflightLo =
+        InflightLo >= BBR_INFINITE_INFLIGHT ?
+            BBR_INFINITE_INFLIGHT - 1 : (uint32_t)InflightLo;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlUpdateModel(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+
+    BbrCongestionControlUpdateRound(Cc, AckEvent);
+
+    if (Bbr->RoundStart) {
+        //
+        // The previous round is complete. Apply its congestion signals and
+        // start collecting new ones.
+        //
+        BbrCongestionControlAdaptLowerBounds(Cc);
+        Bbr->LossBytesInRound = 0;
+        Bbr->LossEventsInRound = 0;
+        Bbr->CongestionEventInRound = FALSE;
+        Bbr->EcnCeInRound = FALSE;
+        Bbr->BwLatest = 0;
+        Bbr->InflightLatest = 0;
+    }
+
+    if (AckEvent->IsRateSampleValid) {
+        const uint64_t DeliveryRate =
+            AckEvent->DeliveredBytes * MS_TO_US(1000) / AckEvent->Interval;
+
+        //
+        // App limited samples only underestimate the bandwidth, so they are
+        // only used if they increase the estimate.
+        //
+        if (DeliveryRate >= BbrCongestionControlGetMaxBw(Bbr) ||
+            !AckEvent->IsAppLimited) {
+            Bbr->MaxBwFilter[1] = max(Bbr->MaxBwFilter[1], DeliveryRate);
+        }
+
+        Bbr->BwLatest = max(Bbr->BwLatest, DeliveryRate);
+        Bbr->InflightLatest = max(Bbr->InflightLatest, AckEvent->DeliveredBytes);
+    }
+
+    //
+    // Update the min RTT. ProbeRttMinDelay tracks the min over the shorter
+    // PROBE_RTT interval, and is what PROBE_RTT refreshes.
+    //
+    Bbr->ProbeRttExpired =
+        QuicTimeDiff32(Bbr->ProbeRttMinTimestamp, AckEvent->TimeNow) > BBR_PROBE_RTT_INTERVAL_US;
+    if (AckEvent->MinRttValid &&
+        (!Bbr->MinRttValid ||
+         AckEvent->MinRtt < Bbr->ProbeRttMinDelay ||
+         Bbr->ProbeRttExpired)) {
+        Bbr->ProbeRttMinDelay = AckEvent->MinRtt;
+        Bbr->ProbeRttMinTimestamp = AckEvent->TimeNow;
+    }
+
+    if (AckEvent->MinRttValid &&
+        (!Bbr->MinRttValid ||
+         Bbr->ProbeRttMinDelay < Bbr->MinRtt ||
+         QuicTimeDiff32(Bbr->MinRttTimestamp, AckEvent->TimeNow) > BBR_MIN_RTT_FILTER_LEN_US)) {
+        Bbr->MinRtt = Bbr->ProbeRttMinDelay;
+        Bbr->MinRttTimestamp = Bbr->ProbeRttMinTimestamp;
+        Bbr->MinRttValid = TRUE;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlCheckStartupDone(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+
+    if (Bbr->State != QUIC_BBR_STATE_STARTUP) {
+        return;
+    }
+
+    if (!Bbr->FilledPipe &&
+        Bbr->RoundStart &&
+        AckEvent->IsRateSampleValid &&
+        !AckEvent->IsAppLimited) {
+        const uint64_t MaxBw = BbrCongestionControlGetMaxBw(Bbr);
+        if (MaxBw >= Bbr->FullBw * BBR_STARTUP_GROWTH_TARGET / BBR_UNIT) {
+            Bbr->FullBw = MaxBw;
+            Bbr->FullBwCount = 0;
+        } else if (++Bbr->FullBwCount >= BBR_STARTUP_FULL_BW_ROUNDS) {
+            Bbr->FilledPipe = TRUE;
+        }
+    }
+
+    if (Bbr->FilledPipe) {
+        BbrCongestionControlEnterDrain(Cc);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlExitProbeRtt(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t TimeNow
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    Bbr->ProbeRttMinTimestamp = TimeNow;
+    if (Bbr->FilledPipe) {
+        BbrCongestionControlStartProbeBwDown(Cc, TimeNow);
+        BbrCongestionControlStartProbeBwCruise(Cc);
+    } else {
+        BbrCongestionControlEnterStartup(Cc);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlCheckProbeRtt(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+
+    if (Bbr->State != QUIC_BBR_STATE_PROBE_RTT &&
+        Bbr->ProbeRttExpired &&
+        Bbr->MinRttValid) {
+        Bbr->State = QUIC_BBR_STATE_PROBE_RTT;
+        Bbr->PacingGain = BBR_UNIT;
+        Bbr->CwndGain = BBR_PROBE_RTT_CWND_GAIN;
+        Bbr->ProbeRttDoneTimeValid = FALSE;
+        BbrCongestionControlLogState(Cc);
+    }
+
+    if (Bbr->State != QUIC_BBR_STATE_PROBE_RTT) {
+        return;
+    }
+
+    //
+    // Hold the reduced window for at least the PROBE_RTT duration and one
+    // round trip before going back to probing for bandwidth.
+    //
+    if (!Bbr->ProbeRttDoneTimeValid) {
+        if (Bbr->BytesInFlight <= BbrCongestionControlGetBdp(Cc, BBR_PROBE_RTT_CWND_GAIN) ||
+            Bbr->BytesInFlight <= BbrCongestionControlGetMinPipeCwnd(Cc)) {
+            Bbr->ProbeRttDoneTime = AckEvent->TimeNow + BBR_PROBE_RTT_DURATION_US;
+            Bbr->ProbeRttDoneTimeValid = TRUE;
+            Bbr->ProbeRttRoundDone = FALSE;
+            BbrCongestionControlStartRound(Bbr, AckEvent->TotalBytesDelivered);
+        }
+    } else {
+        if (Bbr->RoundStart) {
+            Bbr->ProbeRttRoundDone = TRUE;
+        }
+        if (Bbr->ProbeRttRoundDone &&
+            QuicTimeAtOrBefore32(Bbr->ProbeRttDoneTime, AckEvent->TimeNow)) {
+            BbrCongestionControlExitProbeRtt(Cc, AckEvent->TimeNow);
+        }
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlUpdateCongestionWindow(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t AckedBytes,
+    _In_ uint64_t TotalBytesDelivered
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    const uint32_t Mtu = BbrCongestionControlGetMtu(Cc);
+    const uint32_t MinPipeCwnd = BbrCongestionControlGetMinPipeCwnd(Cc);
+    const uint64_t MaxInflight =
+        (uint64_t)BbrCongestionControlGetBdp(Cc, Bbr->CwndGain) + BBR_QUANTA_PACKETS * Mtu;
+    uint64_t CongestionWindow = Bbr->CongestionWindow;
+
+    if (Bbr->FilledPipe) {
+        CongestionWindow = min(CongestionWindow + AckedBytes, MaxInflight);
+    } else if (CongestionWindow < MaxInflight ||
+        TotalBytesDelivered < (uint64_t)Bbr->InitialWindowPackets * Mtu) {
+        CongestionWindow += AckedBytes;
+    }
+
+    //
+    // Bound the window by the loss based limits of the model.
+    //
+    uint64_t Cap = BBR_INFINITE_INFLIGHT;
+    if (Bbr->State == QUIC_BBR_STATE_PROBE_BW &&
+        Bbr->ProbeBwState != QUIC_BBR_PROBE_BW_STATE_CRUISE) {
+        Cap = Bbr->InflightHi;
+    } else if (Bbr->State == QUIC_BBR_STATE_PROBE_RTT ||
+        Bbr->State == QUIC_BBR_STATE_PROBE_BW) {
+        Cap = BbrCongestionControlGetInflightWithHeadroom(Cc);
+    }
+    Cap = min(Cap, Bbr->InflightLo);
+    if (Bbr->State == QUIC_BBR_STATE_PROBE_RTT) {
+        Cap = min(Cap, BbrCongestionControlGetBdp(Cc, BBR_PROBE_RTT_CWND_GAIN));
+    }
+    Cap = max(Cap, MinPipeCwnd);
+
+    CongestionWindow = min(CongestionWindow, Cap);
+    CongestionWindow = max(CongestionWindow, MinPipeCwnd);
+    Bbr->CongestionWindow = (uint32_t)CongestionWindow;
+}
+
+//
+// Returns TRUE if we became unblocked.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BbrCongestionControlUpdateBlockedState(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ BOOLEAN PreviousCanSendState
+    )
+{
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    QuicConnLogOutFlowStats(Connection);
+    if (PreviousCanSendState != QuicCongestionControlCanSend(Cc)) {
+        if (PreviousCanSendState) {
+            QuicConnAddOutFlowBlockedReason(
+                Connection, QUIC_FLOW_BLOCKED_CONGESTION_CONTROL);
+        } else {
+            QuicConnRemoveOutFlowBlockedReason(
+                Connection, QUIC_FLOW_BLOCKED_CONGESTION_CONTROL);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BbrCongestionControlCanSend(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    return Bbr->BytesInFlight < Bbr->CongestionWindow || Bbr->Exemptions > 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlSetExemption(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint8_t NumPackets
+    )
+{
+    Cc->Bbr.Exemptions = NumPackets;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+BbrCongestionControlGetSendAllowance(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t TimeSinceLastSend, // microsec
+    _In_ BOOLEAN TimeSinceLastSendValid
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    uint32_t SendAllowance;
+
+    if (Bbr->BytesInFlight >= Bbr->CongestionWindow) {
+        //
+        // We are CC blocked, so we can't send anything.
+        //
+        SendAllowance = 0;
+
+    } else if (!Connection->State.UsePacing ||
+        !Connection->Paths[0].GotFirstRttSample ||
+        !TimeSinceLastSendValid ||
+        Bbr->PacingRate == 0) {
+        //
+        // Pacing is disabled, we don't have an RTT sample yet or this is the
+        // first send, so just send everything we can.
+        //
+        SendAllowance = Bbr->CongestionWindow - Bbr->BytesInFlight;
+
+    } else {
+        //
+        // Allow what the pacing rate allows for the time since the last send,
+        // but at least a minimum chunk to amortize the per send cost.
+        //
+        const uint32_t MinChunkSize =
+            QUIC_SEND_PACING_MIN_CHUNK * Connection->Paths[0].Mtu;
+        uint64_t PacedAllowance =
+            Bbr->PacingRate * TimeSinceLastSend / MS_TO_US(1000);
+        if (PacedAllowance < MinChunkSize) {
+            PacedAllowance = MinChunkSize;
+        }
+        SendAllowance = Bbr->CongestionWindow - Bbr->BytesInFlight;
+        if (PacedAllowance < SendAllowance) {
+            SendAllowance = (uint32_t)PacedAllowance;
+        }
+    }
+
+    return SendAllowance;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint64_t
+BbrCongestionControlGetPacingRate(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    const QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    if (!Connection->State.UsePacing || !Connection->Paths[0].GotFirstRttSample) {
+        return 0;
+    }
+    return Cc->Bbr.PacingRate;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+BbrCongestionControlOnDataSent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t NumRetransmittableBytes
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    BOOLEAN PreviousCanSendState = BbrCongestionControlCanSend(Cc);
+
+    if (Bbr->BytesInFlight == 0 &&
+        Bbr->IsAppLimited &&
+        Bbr->State == QUIC_BBR_STATE_PROBE_BW) {
+        //
+        // Restarting from idle: send at the estimated bandwidth instead of
+        // continuing with any probing gain.
+        //
+        BbrCongestionControlSetPacingRateWithGain(Cc, BBR_UNIT);
+    }
+
+    Bbr->BytesInFlight += NumRetransmittableBytes;
+    if (Bbr->BytesInFlightMax < Bbr->BytesInFlight) {
+        Bbr->BytesInFlightMax = Bbr->BytesInFlight;
+        QuicSendBufferConnectionAdjust(QuicCongestionControlGetConnection(Cc));
+    }
+
+    if (Bbr->Exemptions > 0) {
+        --Bbr->Exemptions;
+    }
+
+    BbrCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BbrCongestionControlOnDataInvalidated(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t NumRetransmittableBytes
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    BOOLEAN PreviousCanSendState = BbrCongestionControlCanSend(Cc);
+
+    QUIC_DBG_ASSERT(Bbr->BytesInFlight >= NumRetransmittableBytes);
+    Bbr->BytesInFlight -= NumRetransmittableBytes;
+
+    return BbrCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BbrCongestionControlOnDataAcknowledged(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    BOOLEAN PreviousCanSendState = BbrCongestionControlCanSend(Cc);
+
+    QUIC_DBG_ASSERT(Bbr->BytesInFlight >= AckEvent->NumRetransmittableBytes);
+    Bbr->BytesInFlight -= AckEvent->NumRetransmittableBytes;
+
+    if (Bbr->IsAppLimited &&
+        AckEvent->TotalBytesDelivered > Bbr->AppLimitedExitTarget) {
+        Bbr->IsAppLimited = FALSE;
+    }
+
+    BbrCongestionControlUpdateModel(Cc, AckEvent);
+    BbrCongestionControlCheckStartupDone(Cc, AckEvent);
+
+    if (Bbr->State == QUIC_BBR_STATE_DRAIN &&
+        Bbr->BytesInFlight <= BbrCongestionControlGetBdp(Cc, BBR_UNIT)) {
+        BbrCongestionControlStartProbeBwDown(Cc, AckEvent->TimeNow);
+    }
+
+    BbrCongestionControlUpdateProbeBwCyclePhase(Cc, AckEvent);
+    BbrCongestionControlCheckProbeRtt(Cc, AckEvent);
+
+    BbrCongestionControlSetPacingRateWithGain(Cc, Bbr->PacingGain);
+    BbrCongestionControlUpdateCongestionWindow(
+        Cc, AckEvent->NumRetransmittableBytes, AckEvent->TotalBytesDelivered);
+
+    return BbrCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlOnCongestionEvent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+
+    if (!Bbr->CongestionEventInRound) {
+        Bbr->CongestionEventInRound = TRUE;
+        QuicTraceEvent(
+            ConnCongestion,
+            "[conn][%p] Congestion event",
+            Connection);
+        QuicTraceProbe(congestion, Connection, FALSE);
+        Connection->Stats.Send.CongestionCount++;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlOnDataLost(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t LargestPacketNumberLost,
+    _In_ uint64_t LargestPacketNumberSent,
+    _In_ uint32_t NumRetransmittableBytes,
+    _In_ BOOLEAN PersistentCongestion
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    BOOLEAN PreviousCanSendState = BbrCongestionControlCanSend(Cc);
+    const uint32_t InflightAtLoss = Bbr->BytesInFlight;
+
+    UNREFERENCED_PARAMETER(LargestPacketNumberLost);
+    UNREFERENCED_PARAMETER(LargestPacketNumberSent);
+
+    QUIC_DBG_ASSERT(Bbr->BytesInFlight >= NumRetransmittableBytes);
+    Bbr->BytesInFlight -= NumRetransmittableBytes;
+
+    Bbr->LossBytesInRound += NumRetransmittableBytes;
+    Bbr->LossEventsInRound++;
+
+    //
+    // The loss rate is too high if the bytes lost this round exceed the loss
+    // threshold relative to what was in flight.
+    //
+    if (Bbr->LossBytesInRound * 100 >
+            (uint64_t)InflightAtLoss * BBR_LOSS_THRESHOLD_PERCENT) {
+
+        if (Bbr->State == QUIC_BBR_STATE_STARTUP) {
+            if (Bbr->LossEventsInRound >= BBR_STARTUP_FULL_LOSS_COUNT) {
+                BbrCongestionControlOnCongestionEvent(Cc);
+                Bbr->FilledPipe = TRUE;
+                Bbr->InflightHi =
+                    max(BbrCongestionControlGetBdp(Cc, BBR_UNIT), InflightAtLoss);
+                BbrCongestionControlEnterDrain(Cc);
+            }
+
+        } else if (
+            Bbr->State == QUIC_BBR_STATE_PROBE_BW &&
+            (Bbr->ProbeBwState == QUIC_BBR_PROBE_BW_STATE_REFILL ||
+             Bbr->ProbeBwState == QUIC_BBR_PROBE_BW_STATE_UP)) {
+            //
+            // Probing pushed too much data into the network. Remember how
+            // much was too much, and stop probing.
+            //
+            BbrCongestionControlOnCongestionEvent(Cc);
+            Bbr->InflightHi =
+                max(InflightAtLoss,
+                    (uint32_t)((uint64_t)BbrCongestionControlGetTargetInflight(Cc) * BBR_BETA / BBR_UNIT));
+            if (Bbr->ProbeBwState == QUIC_BBR_PROBE_BW_STATE_UP) {
+                BbrCongestionControlStartProbeBwDown(Cc, QuicTimeUs32());
+            }
+
+        } else {
+            //
+            // The lower bounds are adapted once the round completes.
+            //
+            BbrCongestionControlOnCongestionEvent(Cc);
+        }
+    }
+
+    if (PersistentCongestion) {
+        QuicTraceEvent(
+            ConnPersistentCongestion,
+            "[conn][%p] Persistent congestion event",
+            Connection);
+        QuicTraceProbe(congestion, Connection, TRUE);
+        Connection->Stats.Send.PersistentCongestionCount++;
+        Bbr->CongestionWindow = BbrCongestionControlGetMinPipeCwnd(Cc);
+    }
+
+    BbrCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+    BbrCongestionControlLogState(Cc);
+}
+
+//
+// BBR's loss response only bounds the model (InflightHi and the lower bounds)
+// and those bounds are refreshed as bandwidth is probed again, so spurious
+// losses aren't undone.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BbrCongestionControlOnSpuriousCongestionEvent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    UNREFERENCED_PARAMETER(Cc);
+    return FALSE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlOnEcn(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t LargestPacketNumberAcked,
+    _In_ uint64_t LargestPacketNumberSent
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    BOOLEAN PreviousCanSendState = BbrCongestionControlCanSend(Cc);
+    const uint32_t InflightAtCe = Bbr->BytesInFlight;
+
+    UNREFERENCED_PARAMETER(LargestPacketNumberAcked);
+    UNREFERENCED_PARAMETER(LargestPacketNumberSent);
+
+    //
+    // CE marks are handled like a round with too much loss, except that
+    // nothing was actually lost.
+    //
+    Bbr->EcnCeInRound = TRUE;
+    BbrCongestionControlOnCongestionEvent(Cc);
+
+    if (Bbr->State == QUIC_BBR_STATE_STARTUP) {
+        Bbr->FilledPipe = TRUE;
+        Bbr->InflightHi =
+            max(BbrCongestionControlGetBdp(Cc, BBR_UNIT), InflightAtCe);
+        BbrCongestionControlEnterDrain(Cc);
+
+    } else if (
+        Bbr->State == QUIC_BBR_STATE_PROBE_BW &&
+        (Bbr->ProbeBwState == QUIC_BBR_PROBE_BW_STATE_REFILL ||
+         Bbr->ProbeBwState == QUIC_BBR_PROBE_BW_STATE_UP)) {
+        Bbr->InflightHi =
+            max(InflightAtCe,
+                (uint32_t)((uint64_t)BbrCongestionControlGetTargetInflight(Cc) * BBR_BETA / BBR_UNIT));
+        if (Bbr->ProbeBwState == QUIC_BBR_PROBE_BW_STATE_UP) {
+            BbrCongestionControlStartProbeBwDown(Cc, QuicTimeUs32());
+        }
+    }
+
+    BbrCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+    BbrCongestionControlLogState(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlSetAppLimited(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    if (Bbr->BytesInFlight < Bbr->CongestionWindow) {
+        Bbr->IsAppLimited = TRUE;
+        Bbr->AppLimitedExitTarget =
+            QuicCongestionControlGetConnection(Cc)->LossDetection.TotalBytesDelivered +
+            Bbr->BytesInFlight;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BbrCongestionControlIsAppLimited(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Bbr.IsAppLimited;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint8_t
+BbrCongestionControlGetExemptions(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Bbr.Exemptions;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+BbrCongestionControlGetBytesInFlightMax(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Bbr.BytesInFlightMax;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+BbrCongestionControlGetCongestionWindow(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Bbr.CongestionWindow;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlLogOutFlowStatus(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    const QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    const QUIC_PATH* Path = &Connection->Paths[0];
+    const QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    UNREFERENCED_PARAMETER(Connection);
+    UNREFERENCED_PARAMETER(Path);
+    UNREFERENCED_PARAMETER(Bbr);
+
+    //
+    // BBR has no slow start threshold; report the long term inflight bound
+    // in its place.
+    //
+    QuicTraceEvent(
+        ConnOutFlowStats,
+        "[conn][%p] OUT: BytesSent=%llu InFlight=%u InFlightMax=%u CWnd=%u SSThresh=%u ConnFC=%llu ISB=%llu PostedBytes=%llu SRtt=%u",
+        Connection,
+        Connection->Stats.Send.TotalBytes,
+        Bbr->BytesInFlight,
+        Bbr->BytesInFlightMax,
+        Bbr->CongestionWindow,
+        Bbr->InflightHi,
+        Connection->Send.PeerMaxData - Connection->Send.OrderedStreamBytesSent,
+        Connection->SendBuffer.IdealBytes,
+        Connection->SendBuffer.PostedBytes,
+        Path->GotFirstRttSample ? Path->SmoothedRtt : 0);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlReset(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_BBR* Bbr = &Cc->Bbr;
+    const uint32_t InitialWindowPackets = Bbr->InitialWindowPackets;
+
+    QuicZeroMemory(Bbr, sizeof(*Bbr));
+    Bbr->InitialWindowPackets = InitialWindowPackets;
+    Bbr->CongestionWindow = BbrCongestionControlGetMtu(Cc) * InitialWindowPackets;
+    Bbr->BytesInFlightMax = Bbr->CongestionWindow / 2;
+    Bbr->InflightHi = BBR_INFINITE_INFLIGHT;
+    BbrCongestionControlResetLowerBounds(Bbr);
+    BbrCongestionControlEnterStartup(Cc);
+    BbrCongestionControlSetPacingRateWithGain(Cc, Bbr->PacingGain);
+
+    QuicConnLogOutFlowStats(QuicCongestionControlGetConnection(Cc));
+}
+
+static const QUIC_CONGESTION_CONTROL_VTABLE QuicCongestionControlBbr = {
+    "Bbr",
+    QUIC_CONGESTION_CONTROL_ALGORITHM_BBR,
+    BbrCongestionControlReset,
+    BbrCongestionControlCanSend,
+    BbrCongestionControlSetExemption,
+    BbrCongestionControlGetSendAllowance,
+    BbrCongestionControlGetPacingRate,
+    BbrCongestionControlOnDataSent,
+    BbrCongestionControlOnDataInvalidated,
+    BbrCongestionControlOnDataAcknowledged,
+    BbrCongestionControlOnDataLost,
+    BbrCongestionControlOnSpuriousCongestionEvent,
+    BbrCongestionControlOnEcn,
+    BbrCongestionControlSetAppLimited,
+    BbrCongestionControlIsAppLimited,
+    BbrCongestionControlGetExemptions,
+    BbrCongestionControlGetBytesInFlightMax,
+    BbrCongestionControlGetCongestionWindow,
+    BbrCongestionControlLogOutFlowStatus
+};
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlInitialize(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_SETTINGS* Settings
+    )
+{
+    Cc->Vtable = &QuicCongestionControlBbr;
+    Cc->Bbr.InitialWindowPackets = Settings->InitialWindowPackets;
+    BbrCongestionControlReset(Cc);
+}
@@ -0,0 +1,162 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+--*/
+
+typedef enum QUIC_BBR_STATE {
+    QUIC_BBR_STATE_STARTUP,
+    QUIC_BBR_STATE_DRAIN,
+    QUIC_BBR_STATE_PROBE_BW,
+    QUIC_BBR_STATE_PROBE_RTT
+} QUIC_BBR_STATE;
+
+typedef enum QUIC_BBR_PROBE_BW_STATE {
+    QUIC_BBR_PROBE_BW_STATE_DOWN,
+    QUIC_BBR_PROBE_BW_STATE_CRUISE,
+    QUIC_BBR_PROBE_BW_STATE_REFILL,
+    QUIC_BBR_PROBE_BW_STATE_UP
+} QUIC_BBR_PROBE_BW_STATE;
+
+typedef struct QUIC_CONGESTION_CONTROL_BBR {
+
+    //
+    // TRUE once the bandwidth estimate has stopped growing in STARTUP (or
+    // STARTUP saw excessive loss).
+    //
+    BOOLEAN FilledPipe : 1;
+
+    //
+    // TRUE if the latest ACK started a new round trip.
+    //
+    BOOLEAN RoundStart : 1;
+
+    //
+    // TRUE if the connection is application limited. Cleared once everything
+    // in flight when it was set has been delivered.
+    //
+    BOOLEAN IsAppLimited : 1;
+
+    //
+    // TRUE if MinRtt holds a valid sample.
+    //
+    BOOLEAN MinRttValid : 1;
+
+    //
+    // TRUE if ProbeRttMinDelay is older than the PROBE_RTT interval.
+    //
+    BOOLEAN ProbeRttExpired : 1;
+
+    //
+    // PROBE_RTT progress.
+    //
+    BOOLEAN ProbeRttDoneTimeValid : 1;
+    BOOLEAN ProbeRttRoundDone : 1;
+
+    //
+    // TRUE if a congestion event was already counted for the current round.
+    //
+    BOOLEAN CongestionEventInRound : 1;
+
+    //
+    // TRUE if the peer reported CE marked packets in the current round.
+    //
+    BOOLEAN EcnCeInRound : 1;
+
+    uint8_t State;          // QUIC_BBR_STATE
+    uint8_t ProbeBwState;   // QUIC_BBR_PROBE_BW_STATE
+
+    //
+    // A count of packets which can be sent ignoring CongestionWindow.
+    //
+    uint8_t Exemptions;
+
+    //
+    // Current gains, in units of BBR_UNIT.
+    //
+    uint16_t PacingGain;
+    uint16_t CwndGain;
+
+    //
+    // The size of the initial congestion window, in packets.
+    //
+    uint32_t InitialWindowPackets;
+
+    uint32_t CongestionWindow; // bytes
+    uint32_t BytesInFlight;
+    uint32_t BytesInFlightMax;
+
+    uint64_t PacingRate; // bytes per second
+
+    //
+    // Round trip counting, based on delivered bytes.
+    //
+    uint64_t RoundCount;
+    uint64_t NextRoundDelivered;
+
+    //
+    // Max bandwidth filter over the last two PROBE_BW cycles, in bytes per
+    // second. New samples go in MaxBwFilter[1].
+    //
+    uint64_t MaxBwFilter[2];
+
+    //
+    // Short term lower bounds, adapted on loss. UINT64_MAX/UINT32_MAX when
+    // not in effect.
+    //
+    uint64_t BwLo;
+    uint32_t InflightLo;
+
+    //
+    // Long term upper bound on inflight data, raised while probing.
+    //
+    uint32_t InflightHi;
+
+    //
+    // The max delivery rate and delivered bytes sampled in the current round.
+    //
+    uint64_t BwLatest;
+    uint64_t InflightLatest;
+
+    //
+    // Loss accounting for the current round.
+    //
+    uint64_t LossBytesInRound;
+    uint32_t LossEventsInRound;
+
+    //
+    // STARTUP full pipe detection.
+    //
+    uint64_t FullBw;
+    uint8_t FullBwCount;
+
+    uint32_t MinRtt; // microsec
+    uint32_t MinRttTimestamp; // microsec
+    uint32_t ProbeRttMinDelay; // microsec
+    uint32_t ProbeRttMinTimestamp; // microsec
+    uint32_t ProbeRttDoneTime; // microsec
+
+    //
+    // PROBE_BW cycle state.
+    //
+    uint32_t CycleStartTime; // microsec
+    uint32_t BwProbeWait; // microsec
+    uint32_t RoundsSinceBwProbe;
+    uint32_t BwProbeUpRounds;
+    uint32_t BwProbeUpCount;
+    uint32_t BwProbeUpAcks;
+
+    //
+    // The value of TotalBytesDelivered at which the app limited period ends.
+    //
+    uint64_t AppLimitedExitTarget;
+
+} QUIC_CONGESTION_CONTROL_BBR;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+BbrCongestionControlInitialize(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_SETTINGS* Settings
+    );
@@ -0,0 +1,127 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Benchmarks for packet protection, for each supported cipher suite. Cipher
+    suites the crypto library doesn't support are reported as skipped.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "CryptBench.cpp.clog.h"
+#endif
+
+#define BENCH_HEADER_SIZE 20
+#define BENCH_MAX_PAYLOAD_SIZE 1200
+
+static const uint8_t BenchRawKey[32] = { 0 };
+static const uint8_t BenchIv[QUIC_IV_LENGTH] = { 0 };
+static const uint8_t BenchHeader[BENCH_HEADER_SIZE] = { 0 };
+
+//
+// The argument is the payload length.
+//
+static
+void
+Encrypt(
+    BenchState& State,
+    QUIC_AEAD_TYPE Aead
+    )
+{
+    QUIC_KEY* Key;
+    if (QUIC_FAILED(QuicKeyCreate(Aead, BenchRawKey, &Key))) {
+        State.Skip("AEAD type unsupported");
+        return;
+    }
+    uint8_t Buffer[BENCH_MAX_PAYLOAD_SIZE + QUIC_ENCRYPTION_OVERHEAD] = { 0 };
+    uint16_t Length = (uint16_t)(State.Arg + QUIC_ENCRYPTION_OVERHEAD);
+    State.BytesPerIteration = State.Arg;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        BenchConsume(
+            QuicEncrypt(Key, BenchIv, sizeof(BenchHeader), BenchHeader, Length, Buffer));
+    }
+    State.Stop();
+    QuicKeyFree(Key);
+}
+
+//
+// Each iteration also copies the cipher text (from a packet encrypted once
+// up front) into the buffer that is decrypted in place.
+//
+static
+void
+Decrypt(
+    BenchState& State,
+    QUIC_AEAD_TYPE Aead
+    )
+{
+    QUIC_KEY* Key;
+    if (QUIC_FAILED(QuicKeyCreate(Aead, BenchRawKey, &Key))) {
+        State.Skip("AEAD type unsupported");
+        return;
+    }
+    uint8_t Cipher[BENCH_MAX_PAYLOAD_SIZE + QUIC_ENCRYPTION_OVERHEAD] = { 0 };
+    uint8_t Buffer[BENCH_MAX_PAYLOAD_SIZE + QUIC_ENCRYPTION_OVERHEAD];
+    uint16_t Length = (uint16_t)(State.Arg + QUIC_ENCRYPTION_OVERHEAD);
+    if (QUIC_FAILED(
+        QuicEncrypt(Key, BenchIv, sizeof(BenchHeader), BenchHeader, Length, Cipher))) {
+        State.Skip("Encrypt failed");
+        QuicKeyFree(Key);
+        return;
+    }
+    State.BytesPerIteration = State.Arg;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        QuicCopyMemory(Buffer, Cipher, Length);
+        BenchConsume(
+            QuicDecrypt(Key, BenchIv, sizeof(BenchHeader), BenchHeader, Length, Buffer));
+    }
+    State.Stop();
+    QuicKeyFree(Key);
+}
+
+//
+// The argument is the number of packets whose masks are computed together.
+//
+static
+void
+HpComputeMask(
+    BenchState& State,
+    QUIC_AEAD_TYPE Aead
+    )
+{
+    QUIC_HP_KEY* Key;
+    if (QUIC_FAILED(QuicHpKeyCreate(Aead, BenchRawKey, &Key))) {
+        State.Skip("AEAD type unsupported");
+        return;
+    }
+    uint8_t Cipher[QUIC_HP_SAMPLE_LENGTH * QUIC_MAX_CRYPTO_BATCH_COUNT] = { 0 };
+    uint8_t Mask[QUIC_HP_SAMPLE_LENGTH * QUIC_MAX_CRYPTO_BATCH_COUNT];
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        BenchConsume(QuicHpComputeMask(Key, (uint8_t)State.Arg, Cipher, Mask));
+    }
+    State.Stop();
+    QuicHpKeyFree(Key);
+}
+
+#define CRYPT_BENCH(Function, Suite, Aead, ...) \
+    static void Function##Suite(BenchState& State) { Function(State, Aead); } \
+    QUIC_BENCH(Function##Suite, __VA_ARGS__)
+
+CRYPT_BENCH(Encrypt, Aes128Gcm, QUIC_AEAD_AES_128_GCM, 64, 1200);
+CRYPT_BENCH(Encrypt, Aes256Gcm, QUIC_AEAD_AES_256_GCM, 64, 1200);
+CRYPT_BENCH(Encrypt, ChaCha20Poly1305, QUIC_AEAD_CHACHA20_POLY1305, 64, 1200);
+
+CRYPT_BENCH(Decrypt, Aes128Gcm, QUIC_AEAD_AES_128_GCM, 64, 1200);
+CRYPT_BENCH(Decrypt, Aes256Gcm, QUIC_AEAD_AES_256_GCM, 64, 1200);
+CRYPT_BENCH(Decrypt, ChaCha20Poly1305, QUIC_AEAD_CHACHA20_POLY1305, 64, 1200);
+
+CRYPT_BENCH(HpComputeMask, Aes128Gcm, QUIC_AEAD_AES_128_GCM, 1, QUIC_MAX_CRYPTO_BATCH_COUNT);
+CRYPT_BENCH(HpComputeMask, Aes256Gcm, QUIC_AEAD_AES_256_GCM, 1, QUIC_MAX_CRYPTO_BATCH_COUNT);
+CRYPT_BENCH(HpComputeMask, ChaCha20Poly1305, QUIC_AEAD_CHACHA20_POLY1305, 1, QUIC_MAX_CRYPTO_BATCH_COUNT);
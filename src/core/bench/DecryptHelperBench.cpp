@@ -0,0 +1,164 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Benchmarks for decrypting a run of 1-RTT packets, on the worker alone and
+    split with a decrypt helper the way the connection does it.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "DecryptHelperBench.cpp.clog.h"
+#endif
+
+#define BENCH_HEADER_SIZE 20
+#define BENCH_PAYLOAD_SIZE 1200
+#define BENCH_PACKET_SIZE (BENCH_PAYLOAD_SIZE + QUIC_ENCRYPTION_OVERHEAD)
+
+static const uint8_t BenchRawKey[16] = { 0 };
+static const uint8_t BenchHeader[BENCH_HEADER_SIZE] = { 0 };
+
+struct BenchRun {
+    uint8_t Cipher[QUIC_MAX_CRYPTO_BATCH_COUNT][BENCH_PACKET_SIZE];
+    uint8_t Buffers[QUIC_MAX_CRYPTO_BATCH_COUNT][BENCH_PACKET_SIZE];
+    QUIC_DECRYPT_BATCH_ENTRY Entries[QUIC_MAX_CRYPTO_BATCH_COUNT];
+
+    bool Initialize(QUIC_KEY* Key, uint8_t Count) {
+        for (uint8_t i = 0; i < Count; ++i) {
+            QUIC_DECRYPT_BATCH_ENTRY* Entry = &Entries[i];
+            QuicZeroMemory(Entry, sizeof(*Entry));
+            Entry->Iv[QUIC_IV_LENGTH - 1] = i;
+            Entry->AuthDataLength = sizeof(BenchHeader);
+            Entry->AuthData = BenchHeader;
+            Entry->BufferLength = BENCH_PACKET_SIZE;
+            Entry->Buffer = Buffers[i];
+            QuicZeroMemory(Cipher[i], BENCH_PACKET_SIZE);
+            if (QUIC_FAILED(
+                QuicEncrypt(
+                    Key,
+                    Entry->Iv,
+                    sizeof(BenchHeader),
+                    BenchHeader,
+                    BENCH_PACKET_SIZE,
+                    Cipher[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //
+    // Decryption is in place, so each iteration starts from a fresh copy of
+    // the cipher text.
+    //
+    void Reset(uint8_t Count) {
+        for (uint8_t i = 0; i < Count; ++i) {
+            QuicCopyMemory(Buffers[i], Cipher[i], BENCH_PACKET_SIZE);
+        }
+    }
+};
+
+//
+// The argument is the number of packets in the run.
+//
+static
+void
+DecryptRunInline(
+    BenchState& State
+    )
+{
+    QUIC_KEY* Key;
+    if (QUIC_FAILED(QuicKeyCreate(QUIC_AEAD_AES_128_GCM, BenchRawKey, &Key))) {
+        State.Skip("AEAD type unsupported");
+        return;
+    }
+    const uint8_t Count = (uint8_t)State.Arg;
+    BenchRun* Run = new BenchRun;
+    if (!Run->Initialize(Key, Count)) {
+        State.Skip("Encrypt failed");
+        delete Run;
+        QuicKeyFree(Key);
+        return;
+    }
+    State.BytesPerIteration = Count * BENCH_PAYLOAD_SIZE;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        Run->Reset(Count);
+        QuicDecryptBatch(Key, Count, Run->Entries);
+        BenchConsume(Run->Entries[Count - 1].Status);
+    }
+    State.Stop();
+    delete Run;
+    QuicKeyFree(Key);
+}
+
+//
+// The argument is the number of packets in the run. The later half of the run
+// is handed to a single helper thread, as in QuicConnRecvBatch.
+//
+static
+void
+DecryptRunHelper(
+    BenchState& State
+    )
+{
+    QUIC_KEY* Key;
+    if (QUIC_FAILED(QuicKeyCreate(QUIC_AEAD_AES_128_GCM, BenchRawKey, &Key))) {
+        State.Skip("AEAD type unsupported");
+        return;
+    }
+    QUIC_KEY* HelperKey;
+    if (QUIC_FAILED(QuicKeyCreate(QUIC_AEAD_AES_128_GCM, BenchRawKey, &HelperKey))) {
+        State.Skip("AEAD type unsupported");
+        QuicKeyFree(Key);
+        return;
+    }
+    QUIC_DECRYPT_HELPER_POOL* Pool;
+    if (QUIC_FAILED(QuicDecryptHelperPoolInitialize(1, &Pool))) {
+        State.Skip("Pool creation failed");
+        QuicKeyFree(HelperKey);
+        QuicKeyFree(Key);
+        return;
+    }
+    const uint8_t Count = (uint8_t)State.Arg;
+    const uint8_t HelperStart = Count - Count / 2;
+    BenchRun* Run = new BenchRun;
+    if (!Run->Initialize(Key, Count)) {
+        State.Skip("Encrypt failed");
+        goto Exit;
+    }
+    State.BytesPerIteration = Count * BENCH_PAYLOAD_SIZE;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        Run->Reset(Count);
+        QUIC_DECRYPT_HELPER* Helper =
+            QuicDecryptHelperStart(
+                Pool,
+                0,
+                HelperKey,
+                Count - HelperStart,
+                Run->Entries + HelperStart);
+        QuicDecryptBatch(
+            Key,
+            Helper == NULL ? Count : HelperStart,
+            Run->Entries);
+        if (Helper != NULL) {
+            QuicDecryptHelperWait(Helper);
+        }
+        BenchConsume(Run->Entries[Count - 1].Status);
+    }
+    State.Stop();
+
+Exit:
+    delete Run;
+    QuicDecryptHelperPoolUninitialize(Pool);
+    QuicKeyFree(HelperKey);
+    QuicKeyFree(Key);
+}
+
+QUIC_BENCH(DecryptRunInline, QUIC_MIN_DECRYPT_HELPER_PACKETS, QUIC_MAX_CRYPTO_BATCH_COUNT);
+QUIC_BENCH(DecryptRunHelper, QUIC_MIN_DECRYPT_HELPER_PACKETS, QUIC_MAX_CRYPTO_BATCH_COUNT);
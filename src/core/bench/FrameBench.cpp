@@ -0,0 +1,289 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Benchmarks for variable length integer and frame encoding and decoding.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "FrameBench.cpp.clog.h"
+#endif
+
+#define BENCH_PACKET_SIZE 1500
+
+//
+// The largest value encoded in the given number of bytes.
+//
+static
+QUIC_VAR_INT
+VarIntMaxForSize(
+    _In_ uint64_t Size
+    )
+{
+    switch (Size) {
+    case 1:  return 0x3F;
+    case 2:  return 0x3FFF;
+    case 4:  return 0x3FFFFFFF;
+    default: return QUIC_VAR_INT_MAX;
+    }
+}
+
+//
+// The argument is the encoded size in bytes.
+//
+static
+void
+VarIntEncode(
+    BenchState& State
+    )
+{
+    uint8_t Buffer[sizeof(uint64_t)];
+    QUIC_VAR_INT Value = VarIntMaxForSize(State.Arg);
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        BenchConsume(QuicVarIntEncode(Value - (i & 1), Buffer));
+    }
+    State.Stop();
+}
+
+QUIC_BENCH(VarIntEncode, 1, 2, 4, 8);
+
+static
+void
+VarIntDecode(
+    BenchState& State
+    )
+{
+    uint8_t Buffer[sizeof(uint64_t)];
+    QuicVarIntEncode(VarIntMaxForSize(State.Arg), Buffer);
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        uint16_t Offset = 0;
+        QUIC_VAR_INT Value;
+        BenchConsume(QuicVarIntDecode(sizeof(Buffer), Buffer, &Offset, &Value));
+        BenchConsume(Value);
+    }
+    State.Stop();
+}
+
+QUIC_BENCH(VarIntDecode, 1, 2, 4, 8);
+
+//
+// The argument is the stream payload length.
+//
+static
+void
+StreamFrameEncode(
+    BenchState& State
+    )
+{
+    uint8_t Payload[BENCH_PACKET_SIZE] = { 0 };
+    uint8_t Buffer[BENCH_PACKET_SIZE];
+    QUIC_STREAM_EX Frame = { FALSE, TRUE, 4, 0x12345678, State.Arg, Payload };
+    State.BytesPerIteration = State.Arg;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        uint16_t Offset = 0;
+        BenchConsume(QuicStreamFrameEncode(&Frame, &Offset, sizeof(Buffer), Buffer));
+    }
+    State.Stop();
+}
+
+QUIC_BENCH(StreamFrameEncode, 0, 64, 1200);
+
+static
+void
+StreamFrameDecode(
+    BenchState& State
+    )
+{
+    uint8_t Payload[BENCH_PACKET_SIZE] = { 0 };
+    uint8_t Buffer[BENCH_PACKET_SIZE];
+    QUIC_STREAM_EX Frame = { FALSE, TRUE, 4, 0x12345678, State.Arg, Payload };
+    uint16_t Length = 0;
+    if (!QuicStreamFrameEncode(&Frame, &Length, sizeof(Buffer), Buffer)) {
+        State.Skip("Encode failed");
+        return;
+    }
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        uint16_t Offset = 1;
+        QUIC_STREAM_EX Decoded;
+        BenchConsume(
+            QuicStreamFrameDecode(
+                (QUIC_FRAME_TYPE)Buffer[0], Length, Buffer, &Offset, &Decoded));
+        BenchConsume(Decoded.Length);
+    }
+    State.Stop();
+}
+
+QUIC_BENCH(StreamFrameDecode, 0, 64, 1200);
+
+//
+// The argument is the number of ACK ranges (i.e. gaps in the received packet
+// numbers) in the frame.
+//
+static
+bool
+AckRangeCreate(
+    _Out_ QUIC_RANGE* Range,
+    _In_ uint64_t Count
+    )
+{
+    if (QUIC_FAILED(QuicRangeInitialize(QUIC_MAX_RANGE_DECODE_ACKS, Range))) {
+        return false;
+    }
+    BOOLEAN Updated;
+    for (uint64_t i = 0; i < Count; ++i) {
+        if (QuicRangeAddRange(Range, 1000 + i * 4, 2, &Updated) == NULL) {
+            QuicRangeUninitialize(Range);
+            return false;
+        }
+    }
+    return true;
+}
+
+static
+void
+AckFrameEncode(
+    BenchState& State
+    )
+{
+    QUIC_RANGE AckRange;
+    if (!AckRangeCreate(&AckRange, State.Arg)) {
+        State.Skip("Out of memory");
+        return;
+    }
+    uint8_t Buffer[BENCH_PACKET_SIZE];
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        uint16_t Offset = 0;
+        BenchConsume(
+            QuicAckFrameEncode(&AckRange, 25, nullptr, &Offset, sizeof(Buffer), Buffer));
+    }
+    State.Stop();
+    QuicRangeUninitialize(&AckRange);
+}
+
+QUIC_BENCH(AckFrameEncode, 1, 16, 256);
+
+static
+void
+AckFrameDecode(
+    BenchState& State
+    )
+{
+    QUIC_RANGE AckRange, DecodedRange;
+    if (!AckRangeCreate(&AckRange, State.Arg)) {
+        State.Skip("Out of memory");
+        return;
+    }
+    uint8_t Buffer[BENCH_PACKET_SIZE];
+    uint16_t Length = 0;
+    BOOLEAN Encoded =
+        QuicAckFrameEncode(&AckRange, 25, nullptr, &Length, sizeof(Buffer), Buffer);
+    QuicRangeUninitialize(&AckRange);
+    if (!Encoded) {
+        State.Skip("Encode failed");
+        return;
+    }
+    if (QUIC_FAILED(QuicRangeInitialize(QUIC_MAX_RANGE_DECODE_ACKS, &DecodedRange))) {
+        State.Skip("Out of memory");
+        return;
+    }
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        uint16_t Offset = 1;
+        BOOLEAN InvalidFrame;
+        QUIC_ACK_ECN_EX Ecn;
+        uint64_t AckDelay;
+        QuicRangeReset(&DecodedRange);
+        BenchConsume(
+            QuicAckFrameDecode(
+                QUIC_FRAME_ACK, Length, Buffer, &Offset, &InvalidFrame,
+                &DecodedRange, &Ecn, &AckDelay));
+        BenchConsume(AckDelay);
+    }
+    State.Stop();
+    QuicRangeUninitialize(&DecodedRange);
+}
+
+QUIC_BENCH(AckFrameDecode, 1, 16, 256);
+
+//
+// Decodes a typical short header payload: an ACK frame followed by two STREAM
+// frames, the last one taking the rest of the packet. The argument is the
+// payload length.
+//
+static
+void
+PacketPayloadDecode(
+    BenchState& State
+    )
+{
+    uint8_t Buffer[BENCH_PACKET_SIZE] = { 0 };
+    uint16_t BufferLength = 0;
+
+    QUIC_RANGE AckRange;
+    if (!AckRangeCreate(&AckRange, 1)) {
+        State.Skip("Out of memory");
+        return;
+    }
+    BOOLEAN Encoded =
+        QuicAckFrameEncode(&AckRange, 25, nullptr, &BufferLength, sizeof(Buffer), Buffer);
+    QuicRangeUninitialize(&AckRange);
+
+    QUIC_STREAM_EX Frame = { FALSE, TRUE, 4, 100000, 500, nullptr };
+    Frame.Data = &Buffer[BufferLength + QuicStreamFrameHeaderSize(&Frame)];
+    Encoded = Encoded && QuicStreamFrameEncode(&Frame, &BufferLength, sizeof(Buffer), Buffer);
+    Frame.StreamID = 8;
+    Frame.ExplicitLength = FALSE;
+    Frame.Length = 0;
+    Encoded = Encoded && QuicStreamFrameEncode(&Frame, &BufferLength, sizeof(Buffer), Buffer);
+    if (!Encoded || State.Arg < BufferLength || State.Arg > sizeof(Buffer)) {
+        State.Skip("Encode failed");
+        return;
+    }
+    BufferLength = (uint16_t)State.Arg;
+
+    QUIC_RANGE DecodedRange;
+    if (QUIC_FAILED(QuicRangeInitialize(QUIC_MAX_RANGE_DECODE_ACKS, &DecodedRange))) {
+        State.Skip("Out of memory");
+        return;
+    }
+    State.BytesPerIteration = BufferLength;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        uint16_t Offset = 0;
+        while (Offset < BufferLength) {
+            QUIC_FRAME_TYPE FrameType = (QUIC_FRAME_TYPE)Buffer[Offset++];
+            if (FrameType == QUIC_FRAME_ACK) {
+                BOOLEAN InvalidFrame;
+                uint64_t AckDelay;
+                QuicRangeReset(&DecodedRange);
+                if (!QuicAckFrameDecode(
+                        FrameType, BufferLength, Buffer, &Offset, &InvalidFrame,
+                        &DecodedRange, nullptr, &AckDelay)) {
+                    break;
+                }
+                BenchConsume(AckDelay);
+            } else {
+                QUIC_STREAM_EX Decoded;
+                if (!QuicStreamFrameDecode(
+                        FrameType, BufferLength, Buffer, &Offset, &Decoded)) {
+                    break;
+                }
+                BenchConsume(Decoded.Length);
+            }
+        }
+    }
+    State.Stop();
+    QuicRangeUninitialize(&DecodedRange);
+}
+
+QUIC_BENCH(PacketPayloadDecode, 1200);
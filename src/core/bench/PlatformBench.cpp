@@ -0,0 +1,155 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Benchmarks for the platform hash table, pool allocator and Toeplitz hash.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "PlatformBench.cpp.clog.h"
+#endif
+
+static
+uint64_t
+BenchSignature(
+    _In_ uint64_t Index
+    )
+{
+    return (Index + 1) * 0x9E3779B97F4A7C15ull;
+}
+
+//
+// The argument is the number of entries in the table.
+//
+static
+void
+HashtableLookup(
+    BenchState& State
+    )
+{
+    QUIC_HASHTABLE* Table = NULL;
+    if (!QuicHashtableInitialize(&Table, QUIC_HASH_MIN_SIZE)) {
+        State.Skip("Out of memory");
+        return;
+    }
+    std::vector<QUIC_HASHTABLE_ENTRY> Entries((size_t)State.Arg);
+    for (uint64_t i = 0; i < State.Arg; ++i) {
+        QuicHashtableInsert(Table, &Entries[(size_t)i], BenchSignature(i), NULL);
+    }
+
+    uint64_t Index = 0;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        BenchConsume(QuicHashtableLookup(Table, BenchSignature(Index), NULL));
+        if (++Index == State.Arg) {
+            Index = 0;
+        }
+    }
+    State.Stop();
+
+    for (uint64_t i = 0; i < State.Arg; ++i) {
+        QuicHashtableRemove(Table, &Entries[(size_t)i], NULL);
+    }
+    QuicHashtableUninitialize(Table);
+}
+
+QUIC_BENCH(HashtableLookup, 16, 1024, 65536);
+
+//
+// The argument is the object size. Each iteration is one allocation and free.
+//
+static
+void
+PoolAllocFree(
+    BenchState& State
+    )
+{
+    QUIC_POOL Pool;
+    QuicPoolInitialize(FALSE, (uint32_t)State.Arg, &Pool);
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        void* Entry = QuicPoolAlloc(&Pool);
+        BenchConsume(Entry);
+        if (Entry != NULL) {
+            QuicPoolFree(&Pool, Entry);
+        }
+    }
+    State.Stop();
+    QuicPoolUninitialize(&Pool);
+}
+
+QUIC_BENCH(PoolAllocFree, 64, 1500);
+
+//
+// The argument is the number of objects allocated, and then freed, in each
+// iteration; more than the per processor cache holds exercises the slow path.
+//
+static
+void
+PoolAllocFreeBurst(
+    BenchState& State
+    )
+{
+    QUIC_POOL Pool;
+    QuicPoolInitialize(FALSE, 64, &Pool);
+    std::vector<void*> Entries((size_t)State.Arg);
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        for (size_t j = 0; j < Entries.size(); ++j) {
+            Entries[j] = QuicPoolAlloc(&Pool);
+        }
+        for (size_t j = 0; j < Entries.size(); ++j) {
+            if (Entries[j] != NULL) {
+                QuicPoolFree(&Pool, Entries[j]);
+            }
+        }
+    }
+    State.Stop();
+    QuicPoolUninitialize(&Pool);
+}
+
+QUIC_BENCH(PoolAllocFreeBurst, 16, 1024);
+
+//
+// The argument is the input length: 12 bytes for an IPv4 2-tuple and port
+// pair, 36 for IPv6, and the maximum input size.
+//
+static
+void
+ToeplitzHash(
+    BenchState& State,
+    BOOLEAN AllowCarrylessMultiply
+    )
+{
+    QUIC_TOEPLITZ_HASH Toeplitz;
+    for (uint32_t i = 0; i < QUIC_TOEPLITZ_KEY_SIZE; ++i) {
+        Toeplitz.HashKey[i] = (uint8_t)(i * 37 + 11);
+    }
+    QuicToeplitzHashInitialize(&Toeplitz);
+    if (!AllowCarrylessMultiply) {
+        Toeplitz.UseCarrylessMultiply = FALSE;
+    } else if (!Toeplitz.UseCarrylessMultiply) {
+        State.Skip("Carry-less multiply unsupported");
+        return;
+    }
+
+    uint8_t Input[QUIC_TOEPLITZ_INPUT_SIZE] = { 0 };
+    State.BytesPerIteration = State.Arg;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        Input[0] = (uint8_t)i;
+        BenchConsume(QuicToeplitzHashCompute(&Toeplitz, Input, (uint32_t)State.Arg, 0));
+    }
+    State.Stop();
+}
+
+static void ToeplitzHashTable(BenchState& State) { ToeplitzHash(State, FALSE); }
+static void ToeplitzHashClmul(BenchState& State) { ToeplitzHash(State, TRUE); }
+
+QUIC_BENCH(ToeplitzHashTable, 12, 36, QUIC_TOEPLITZ_INPUT_SIZE);
+QUIC_BENCH(ToeplitzHashClmul, 12, 36, QUIC_TOEPLITZ_INPUT_SIZE);
@@ -0,0 +1,162 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Benchmarks for the QUIC_RANGE multirange tracker. The argument is the
+    number of disjoint subranges in the range before the timed operations,
+    i.e. how fragmented the received packet numbers or stream offsets are.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "RangeBench.cpp.clog.h"
+#endif
+
+//
+// Initializes the range with Count single value subranges: 0, 2, 4, ...
+//
+static
+bool
+RangeFragment(
+    _Out_ QUIC_RANGE* Range,
+    _In_ uint64_t Count
+    )
+{
+    if (QUIC_FAILED(QuicRangeInitialize(QUIC_MAX_RANGE_ALLOC_SIZE, Range))) {
+        return false;
+    }
+    BOOLEAN Updated;
+    for (uint64_t i = 0; i < Count; ++i) {
+        if (QuicRangeAddRange(Range, i * 2, 1, &Updated) == NULL) {
+            QuicRangeUninitialize(Range);
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// Appends values adjacent to the max, the common case for in order packets.
+//
+static
+void
+RangeAddInOrder(
+    BenchState& State
+    )
+{
+    QUIC_RANGE Range;
+    if (!RangeFragment(&Range, State.Arg)) {
+        State.Skip("Out of memory");
+        return;
+    }
+
+    uint64_t Next = State.Arg * 2 - 1;
+    BOOLEAN Updated;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        BenchConsume(QuicRangeAddRange(&Range, Next++, 1, &Updated));
+    }
+    State.Stop();
+
+    QuicRangeUninitialize(&Range);
+}
+
+QUIC_BENCH(RangeAddInOrder, 1, 16, 256, 4096);
+
+//
+// Fills the gap in the middle of the range, merging two subranges, and then
+// removes the value again, splitting them. Each iteration is one add and one
+// remove.
+//
+static
+void
+RangeAddRemoveMiddle(
+    BenchState& State
+    )
+{
+    QUIC_RANGE Range;
+    if (!RangeFragment(&Range, State.Arg + 1)) {
+        State.Skip("Out of memory");
+        return;
+    }
+
+    uint64_t Gap = (State.Arg / 2) * 2 + 1;
+    BOOLEAN Updated;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        BenchConsume(QuicRangeAddRange(&Range, Gap, 1, &Updated));
+        BenchConsume(QuicRangeRemoveRange(&Range, Gap, 1));
+    }
+    State.Stop();
+
+    QuicRangeUninitialize(&Range);
+}
+
+QUIC_BENCH(RangeAddRemoveMiddle, 1, 16, 256, 4096);
+
+//
+// Adds a value in front of all the others, creating a new first subrange, and
+// removes it again. This is the worst case for a single array.
+//
+static
+void
+RangeAddRemoveFront(
+    BenchState& State
+    )
+{
+    QUIC_RANGE Range;
+    if (!RangeFragment(&Range, State.Arg + 1)) {
+        State.Skip("Out of memory");
+        return;
+    }
+    QuicRangeRemoveRange(&Range, 0, 1);
+
+    BOOLEAN Updated;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        BenchConsume(QuicRangeAddRange(&Range, 0, 1, &Updated));
+        BenchConsume(QuicRangeRemoveRange(&Range, 0, 1));
+    }
+    State.Stop();
+
+    QuicRangeUninitialize(&Range);
+}
+
+QUIC_BENCH(RangeAddRemoveFront, 16, 256, 4096, 16384);
+
+//
+// Looks up values spread across the range.
+//
+static
+void
+RangeSearch(
+    BenchState& State
+    )
+{
+    QUIC_RANGE Range;
+    if (!RangeFragment(&Range, State.Arg)) {
+        State.Skip("Out of memory");
+        return;
+    }
+
+    uint64_t Max = State.Arg * 2;
+    uint64_t Value = 0;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        QUIC_RANGE_SEARCH_KEY Key = { Value, Value };
+        BenchConsume(QuicRangeSearch(&Range, &Key));
+        Value += 7;
+        if (Value >= Max) {
+            Value -= Max;
+        }
+    }
+    State.Stop();
+
+    QuicRangeUninitialize(&Range);
+}
+
+QUIC_BENCH(RangeSearch, 1, 16, 256, 4096);
@@ -0,0 +1,113 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Benchmarks for the connection timer wheel. The connections are zeroed
+    stand-ins that only have the fields the timer wheel uses set.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "TimerWheelBench.cpp.clog.h"
+#endif
+
+//
+// Spreads the expiration times over 1 ms to ~16 s, so that every level of the
+// wheel is used.
+//
+static
+uint64_t
+BenchExpirationTime(
+    _In_ uint64_t Now,
+    _In_ uint64_t Index
+    )
+{
+    return Now + 1000 + ((Index * 0x9E3779B97F4A7C15ull) >> 40);
+}
+
+struct BenchTimerWheel {
+    QUIC_TIMER_WHEEL TimerWheel;
+    QUIC_CONNECTION* Connections;
+    uint64_t Count;
+
+    BenchTimerWheel(uint64_t Count) : Count(Count) {
+        QuicTimerWheelInitialize(&TimerWheel);
+        Connections = new(std::nothrow) QUIC_CONNECTION[(size_t)Count];
+        if (Connections == nullptr) {
+            return;
+        }
+        QuicZeroMemory(Connections, sizeof(QUIC_CONNECTION) * (size_t)Count);
+        uint64_t Now = QuicTimeUs64();
+        for (uint64_t i = 0; i < Count; ++i) {
+            Connections[i].Timers[0].ExpirationTime = BenchExpirationTime(Now, i);
+            QuicTimerWheelUpdateConnection(&TimerWheel, &Connections[i]);
+        }
+    }
+
+    ~BenchTimerWheel() {
+        if (Connections != nullptr) {
+            for (uint64_t i = 0; i < Count; ++i) {
+                QuicTimerWheelRemoveConnection(&TimerWheel, &Connections[i]);
+            }
+            delete [] Connections;
+        }
+        QuicTimerWheelUninitialize(&TimerWheel);
+    }
+};
+
+//
+// The argument is the number of connections in the wheel. Each iteration
+// moves one connection's next timer.
+//
+static
+void
+TimerWheelUpdate(
+    BenchState& State
+    )
+{
+    BenchTimerWheel Wheel(State.Arg);
+    if (Wheel.Connections == nullptr) {
+        State.Skip("Out of memory");
+        return;
+    }
+
+    uint64_t Now = QuicTimeUs64();
+    uint64_t Index = 0;
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        QUIC_CONNECTION* Connection = &Wheel.Connections[Index];
+        Connection->Timers[0].ExpirationTime = BenchExpirationTime(Now, i + State.Arg);
+        QuicTimerWheelUpdateConnection(&Wheel.TimerWheel, Connection);
+        if (++Index == State.Arg) {
+            Index = 0;
+        }
+    }
+    State.Stop();
+}
+
+QUIC_BENCH(TimerWheelUpdate, 16, 1024, 4096);
+
+static
+void
+TimerWheelGetWaitTime(
+    BenchState& State
+    )
+{
+    BenchTimerWheel Wheel(State.Arg);
+    if (Wheel.Connections == nullptr) {
+        State.Skip("Out of memory");
+        return;
+    }
+
+    State.Start();
+    for (uint64_t i = 0; i < State.Iterations; ++i) {
+        BenchConsume(QuicTimerWheelGetWaitTime(&Wheel.TimerWheel));
+    }
+    State.Stop();
+}
+
+QUIC_BENCH(TimerWheelGetWaitTime, 16, 4096);
@@ -0,0 +1,196 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Benchmark harness entry point.
+
+    Usage: msquiccorebench [-filter:<substring>] [-min_time:<ms>] [-json]
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "main.cpp.clog.h"
+#endif
+
+volatile uint64_t BenchSink;
+
+struct BenchDefinition {
+    const char* Name;
+    BenchFunction Function;
+    bool HasArg;
+    uint64_t Arg;
+};
+
+static
+std::vector<BenchDefinition>&
+BenchList()
+{
+    static std::vector<BenchDefinition> List;
+    return List;
+}
+
+BenchRegistration::BenchRegistration(
+    const char* Name,
+    BenchFunction Function,
+    std::initializer_list<uint64_t> Args
+    )
+{
+    if (Args.size() == 0) {
+        BenchList().push_back({ Name, Function, false, 0 });
+    } else {
+        for (uint64_t Arg : Args) {
+            BenchList().push_back({ Name, Function, true, Arg });
+        }
+    }
+}
+
+//
+// The iteration count is never increased by more than this factor at a time.
+//
+#define BENCH_MAX_GROWTH 10
+
+#define BENCH_MAX_ITERATIONS 1000000000ull
+
+static
+bool
+BenchRun(
+    _In_ const BenchDefinition& Bench,
+    _In_ uint64_t MinTimeNs,
+    _Out_ BenchState& State
+    )
+{
+    uint64_t Iterations = 1;
+    while (true) {
+        State.Iterations = Iterations;
+        State.Arg = Bench.Arg;
+        State.BytesPerIteration = 0;
+        State.SkipReason = nullptr;
+        State.Start();
+        State.StopTime = State.StartTime;
+
+        Bench.Function(State);
+        if (State.SkipReason != nullptr) {
+            return false;
+        }
+
+        uint64_t ElapsedNs =
+            (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                State.StopTime - State.StartTime).count();
+        if (ElapsedNs >= MinTimeNs || Iterations >= BENCH_MAX_ITERATIONS) {
+            return true;
+        }
+
+        //
+        // Estimate the iterations needed to reach the min time, with some
+        // headroom, but don't grow too quickly off a noisy short run.
+        //
+        uint64_t Next = ElapsedNs == 0 ?
+            Iterations * BENCH_MAX_GROWTH :
+            (Iterations * MinTimeNs * 14) / (ElapsedNs * 10);
+        if (Next > Iterations * BENCH_MAX_GROWTH) {
+            Next = Iterations * BENCH_MAX_GROWTH;
+        }
+        if (Next <= Iterations) {
+            Next = Iterations + 1;
+        }
+        Iterations = Next > BENCH_MAX_ITERATIONS ? BENCH_MAX_ITERATIONS : Next;
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* Filter = nullptr;
+    uint64_t MinTimeMs = 500;
+    bool Json = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "-filter:", 8) == 0) {
+            Filter = argv[i] + 8;
+        } else if (strncmp(argv[i], "-min_time:", 10) == 0) {
+            MinTimeMs = strtoull(argv[i] + 10, nullptr, 10);
+        } else if (strcmp(argv[i], "-json") == 0) {
+            Json = true;
+        } else {
+            printf("Usage: msquiccorebench [-filter:<substring>] [-min_time:<ms>] [-json]\n");
+            return 1;
+        }
+    }
+
+    QuicPlatformSystemLoad();
+    if (QUIC_FAILED(QuicPlatformInitialize())) {
+        printf("QuicPlatformInitialize failed!\n");
+        QuicPlatformSystemUnload();
+        return 1;
+    }
+
+    if (Json) {
+        printf("[\n");
+    } else {
+        printf("%-40s %14s %14s %12s\n", "Benchmark", "Time (ns)", "Iterations", "MB/s");
+    }
+
+    bool First = true;
+    for (const BenchDefinition& Bench : BenchList()) {
+        char Name[128];
+        if (Bench.HasArg) {
+            snprintf(Name, sizeof(Name), "%s/%llu", Bench.Name, (unsigned long long)Bench.Arg);
+        } else {
+            snprintf(Name, sizeof(Name), "%s", Bench.Name);
+        }
+        if (Filter != nullptr && strstr(Name, Filter) == nullptr) {
+            continue;
+        }
+
+        BenchState State;
+        if (!BenchRun(Bench, MinTimeMs * 1000 * 1000, State)) {
+            if (!Json) {
+                printf("%-40s skipped: %s\n", Name, State.SkipReason);
+            }
+            continue;
+        }
+
+        double ElapsedNs =
+            (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                State.StopTime - State.StartTime).count();
+        double NsPerIteration = ElapsedNs / (double)State.Iterations;
+        double MBps =
+            State.BytesPerIteration == 0 || ElapsedNs == 0 ? 0 :
+                ((double)State.BytesPerIteration * State.Iterations * 1000) / ElapsedNs;
+
+        if (Json) {
+            printf(
+                "%s  {\"Name\":\"%s\",\"NsPerIteration\":%.2f,\"Iterations\":%llu,\"MBps\":%.2f}",
+                First ? "" : ",\n",
+                Name,
+                NsPerIteration,
+                (unsigned long long)State.Iterations,
+                MBps);
+        } else if (State.BytesPerIteration != 0) {
+            printf(
+                "%-40s %14.2f %14llu %12.2f\n",
+                Name,
+                NsPerIteration,
+                (unsigned long long)State.Iterations,
+                MBps);
+        } else {
+            printf(
+                "%-40s %14.2f %14llu\n",
+                Name,
+                NsPerIteration,
+                (unsigned long long)State.Iterations);
+        }
+        First = false;
+    }
+
+    if (Json) {
+        printf("\n]\n");
+    }
+
+    QuicPlatformUninitialize();
+    QuicPlatformSystemUnload();
+
+    return 0;
+}
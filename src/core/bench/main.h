@@ -0,0 +1,76 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    A minimal benchmark harness for the core and platform hot path primitives.
+    Each benchmark is a function that runs the operation under test
+    State.Iterations times between calls to State.Start() and State.Stop().
+    The harness keeps increasing the iteration count until the timed region
+    runs for at least the minimum time, and then reports the time per
+    iteration.
+
+--*/
+
+#include "precomp.h"
+
+#undef min // STL headers conflict with previous definitions of min/max.
+#undef max
+#include <chrono>
+#include <initializer_list>
+#include <vector>
+
+struct BenchState {
+
+    //
+    // The number of times the operation should be run.
+    //
+    uint64_t Iterations;
+
+    //
+    // The benchmark argument (e.g. a size or fragmentation level).
+    //
+    uint64_t Arg;
+
+    //
+    // Optionally set by the benchmark to have a throughput reported.
+    //
+    uint64_t BytesPerIteration;
+
+    //
+    // Set by the benchmark if it can't run (e.g. unsupported cipher).
+    //
+    const char* SkipReason;
+
+    std::chrono::steady_clock::time_point StartTime;
+    std::chrono::steady_clock::time_point StopTime;
+
+    void Start() { StartTime = std::chrono::steady_clock::now(); }
+    void Stop() { StopTime = std::chrono::steady_clock::now(); }
+    void Skip(const char* Reason) { SkipReason = Reason; }
+};
+
+typedef void (*BenchFunction)(BenchState& State);
+
+struct BenchRegistration {
+    BenchRegistration(
+        const char* Name,
+        BenchFunction Function,
+        std::initializer_list<uint64_t> Args
+        );
+};
+
+//
+// Registers a benchmark, to be run once for each of the (optional) args.
+//
+#define QUIC_BENCH(Function, ...) \
+    static BenchRegistration Function##Registration(#Function, Function, { __VA_ARGS__ })
+
+//
+// Prevents the compiler from optimizing away a value computed by the
+// operation under test.
+//
+extern volatile uint64_t BenchSink;
+#define BenchConsume(Value) (BenchSink += (uint64_t)(Value))
@@ -48,7 +48,7 @@ QuicBindingInitialize(
 {
     QUIC_STATUS Status;
     QUIC_BINDING* Binding;
-    uint8_t HashSalt[20];
+    uint8_t HashSalt[QUIC_STATELESS_SECRET_LENGTH];
 
     Binding = QUIC_ALLOC_NONPAGED(sizeof(QUIC_BINDING));
     if (Binding == NULL) {
@@ -66,6 +66,13 @@ QuicBindingInitialize(
     Binding->ServerOwned = ServerOwned;
     Binding->Connected = RemoteAddress == NULL ? FALSE : TRUE;
     Binding->StatelessOperCount = 0;
+    QuicZeroMemory(
+        Binding->StatelessResponseBuckets,
+        sizeof(Binding->StatelessResponseBuckets));
+    QuicZeroMemory(
+        &Binding->StatelessResetBucket,
+        sizeof(Binding->StatelessResetBucket));
+    Binding->EmulatedLink = NULL;
     QuicDispatchRwLockInitialize(&Binding->RwLock);
     QuicDispatchLockInitialize(&Binding->ResetTokenLock);
     QuicDispatchLockInitialize(&Binding->StatelessOperLock);
@@ -81,8 +88,14 @@ QuicBindingInitialize(
     Binding->RandomReservedVersion =
         (Binding->RandomReservedVersion & ~QUIC_VERSION_RESERVED_MASK) |
         QUIC_VERSION_RESERVED;
+    Binding->VerNegSupportedVersions[0] = Binding->RandomReservedVersion;
+    for (uint32_t i = 0; i < ARRAYSIZE(QuicSupportedVersionList); ++i) {
+        Binding->VerNegSupportedVersions[1 + i] = QuicSupportedVersionList[i].Number;
+    }
 
-    QuicRandom(sizeof(HashSalt), HashSalt);
+    QuicLockAcquire(&MsQuicLib.Lock);
+    QuicCopyMemory(HashSalt, MsQuicLib.StatelessResetSecret, sizeof(HashSalt));
+    QuicLockRelease(&MsQuicLib.Lock);
     Status =
         QuicHashCreate(
             QUIC_HASH_SHA256,
@@ -99,6 +112,24 @@ QuicBindingInitialize(
         goto Error;
     }
 
+    //
+    // The link must exist before the datapath binding, as datagrams can be
+    // received as soon as that is created.
+    //
+    QuicLockAcquire(&MsQuicLib.Lock);
+    QUIC_NETWORK_EMULATION Emulation = MsQuicLib.NetworkEmulation;
+    BOOLEAN Emulated = MsQuicLib.NetworkEmulator != NULL;
+    QuicLockRelease(&MsQuicLib.Lock);
+    if (Emulated &&
+        (Emulation.DelayUs != 0 || Emulation.JitterUs != 0 ||
+         Emulation.RateKbps != 0 || Emulation.LossPpm != 0 ||
+         Emulation.ReorderPpm != 0)) {
+        Status = QuicEmulatedLinkCreate(Binding, &Emulation, &Binding->EmulatedLink);
+        if (QUIC_FAILED(Status)) {
+            goto Error;
+        }
+    }
+
 #ifdef QUIC_COMPARTMENT_ID
     Binding->CompartmentId = CompartmentId;
 
@@ -163,6 +194,10 @@ Error:
 
     if (QUIC_FAILED(Status)) {
         if (Binding != NULL) {
+            if (Binding->EmulatedLink != NULL) {
+                QuicEmulatedLinkShutdown(MsQuicLib.NetworkEmulator, Binding->EmulatedLink);
+                QuicEmulatedLinkDelete(Binding->EmulatedLink);
+            }
             QuicHashFree(Binding->ResetTokenHash);
             QuicLookupUninitialize(&Binding->Lookup);
             QuicHashtableUninitialize(&Binding->StatelessOperTable);
@@ -190,12 +225,24 @@ QuicBindingUninitialize(
     QUIC_TEL_ASSERT(Binding->RefCount == 0);
     QUIC_TEL_ASSERT(QuicListIsEmpty(&Binding->Listeners));
 
+    //
+    // Drop the datagrams still held by the emulated network first, as they
+    // belong to the datapath binding.
+    //
+    if (Binding->EmulatedLink != NULL) {
+        QuicEmulatedLinkShutdown(MsQuicLib.NetworkEmulator, Binding->EmulatedLink);
+    }
+
     //
     // Delete the datapath binding. This function blocks until all receive
     // upcalls have completed.
     //
     QuicDataPathBindingDelete(Binding->DatapathBinding);
 
+    if (Binding->EmulatedLink != NULL) {
+        QuicEmulatedLinkDelete(Binding->EmulatedLink);
+    }
+
     //
     // Clean up any leftover stateless operations being tracked.
     //
@@ -626,6 +673,7 @@ QuicBindingQueueStatelessOperation(
 
     QUIC_WORKER* Worker = QuicLibraryGetWorker();
     if (QuicWorkerIsOverloaded(Worker)) {
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_WORKER_OVERLOADED);
         QuicPacketLogDrop(Binding, QuicDataPathRecvDatagramToRecvPacket(Datagram),
             "Worker overloaded (stateless oper)");
         return FALSE;
@@ -678,8 +726,9 @@ QuicBindingProcessStatelessOperation(
         Binding,
         OperationType);
 
+    QUIC_BUFFER* SendDatagram = NULL;
     QUIC_DATAPATH_SEND_CONTEXT* SendContext =
-        QuicDataPathBindingAllocSendContext(Binding->DatapathBinding, 0);
+        QuicDataPathBindingAllocSendContext(Binding->DatapathBinding, QUIC_ECN_NON_ECT, 0);
     if (SendContext == NULL) {
         QuicTraceEvent(
             AllocFailure,
@@ -699,10 +748,9 @@ QuicBindingProcessStatelessOperation(
             RecvPacket->SourceCidLen +
             sizeof(uint8_t) +
             RecvPacket->DestCidLen +
-            sizeof(uint32_t) +                                      // One random version
-            ARRAYSIZE(QuicSupportedVersionList) * sizeof(uint32_t); // Our actual supported versions
+            sizeof(Binding->VerNegSupportedVersions);               // Random + supported versions
 
-        QUIC_BUFFER* SendDatagram =
+        SendDatagram =
             QuicDataPathBindingAllocSendDatagram(SendContext, PacketLength);
         if (SendDatagram == NULL) {
             QuicTraceEvent(
@@ -737,14 +785,16 @@ QuicBindingProcessStatelessOperation(
         Buffer += RecvPacket->DestCidLen;
 
         uint8_t RandomValue = 0;
-        QuicRandom(sizeof(uint8_t), &RandomValue);
+        QuicRandomStreamRead(
+            &StatelessCtx->Worker->Random,
+            sizeof(uint8_t),
+            &RandomValue);
         VerNeg->Unused = 0x7F & RandomValue;
 
-        uint32_t* SupportedVersion = (uint32_t*)Buffer;
-        SupportedVersion[0] = Binding->RandomReservedVersion;
-        for (uint32_t i = 0; i < ARRAYSIZE(QuicSupportedVersionList); ++i) {
-            SupportedVersion[1 + i] = QuicSupportedVersionList[i].Number;
-        }
+        QuicCopyMemory(
+            Buffer,
+            Binding->VerNegSupportedVersions,
+            sizeof(Binding->VerNegSupportedVersions));
 
         QuicTraceLogVerbose(
             PacketTxVersionNegotiation,
@@ -768,7 +818,10 @@ QuicBindingProcessStatelessOperation(
         // Add a bit of randomness (3 bits worth) to the packet length.
         //
         uint8_t PacketLength;
-        QuicRandom(sizeof(PacketLength), &PacketLength);
+        QuicRandomStreamRead(
+            &StatelessCtx->Worker->Random,
+            sizeof(PacketLength),
+            &PacketLength);
         PacketLength >>= 5; // Only drop 5 of the 8 bits of randomness.
         PacketLength += QUIC_RECOMMENDED_STATELESS_RESET_PACKET_LENGTH;
 
@@ -781,7 +834,7 @@ QuicBindingProcessStatelessOperation(
 
         QUIC_DBG_ASSERT(PacketLength >= QUIC_MIN_STATELESS_RESET_PACKET_LENGTH);
 
-        QUIC_BUFFER* SendDatagram =
+        SendDatagram =
             QuicDataPathBindingAllocSendDatagram(SendContext, PacketLength);
         if (SendDatagram == NULL) {
             QuicTraceEvent(
@@ -796,7 +849,8 @@ QuicBindingProcessStatelessOperation(
             (QUIC_SHORT_HEADER_V1*)SendDatagram->Buffer;
         QUIC_DBG_ASSERT(SendDatagram->Length == PacketLength);
 
-        QuicRandom(
+        QuicRandomStreamRead(
+            &StatelessCtx->Worker->Random,
             PacketLength - QUIC_STATELESS_RESET_TOKEN_LENGTH,
             SendDatagram->Buffer);
         ResetPacket->IsLongHeader = FALSE;
@@ -821,7 +875,7 @@ QuicBindingProcessStatelessOperation(
         QUIC_DBG_ASSERT(RecvPacket->SourceCid != NULL);
 
         uint16_t PacketLength = QuicPacketMaxBufferSizeForRetryV1();
-        QUIC_BUFFER* SendDatagram =
+        SendDatagram =
             QuicDataPathBindingAllocSendDatagram(SendContext, PacketLength);
         if (SendDatagram == NULL) {
             QuicTraceEvent(
@@ -834,7 +888,10 @@ QuicBindingProcessStatelessOperation(
 
         uint8_t NewDestCid[MSQUIC_CID_MAX_LENGTH];
         QUIC_DBG_ASSERT(sizeof(NewDestCid) >= MsQuicLib.CidTotalLength);
-        QuicRandom(sizeof(NewDestCid), NewDestCid);
+        QuicRandomStreamRead(
+            &StatelessCtx->Worker->Random,
+            sizeof(NewDestCid),
+            NewDestCid);
 
         QUIC_RETRY_TOKEN_CONTENTS Token = { 0 };
         Token.Authenticated.Timestamp = QuicTimeEpochMs64();
@@ -854,11 +911,13 @@ QuicBindingProcessStatelessOperation(
             QuicCopyMemory(Iv, NewDestCid, MsQuicLib.CidTotalLength);
         }
 
-        QuicLockAcquire(&MsQuicLib.StatelessRetryKeysLock);
+        QUIC_LIBRARY_PP* PerProc =
+            &MsQuicLib.PerProc[QuicLibraryGetCurrentPartition()];
+        QuicDispatchLockAcquire(&PerProc->StatelessRetryKeysLock);
 
-        QUIC_KEY* StatelessRetryKey = QuicLibraryGetCurrentStatelessRetryKey();
+        QUIC_KEY* StatelessRetryKey = QuicLibraryGetCurrentStatelessRetryKey(PerProc);
         if (StatelessRetryKey == NULL) {
-            QuicLockRelease(&MsQuicLib.StatelessRetryKeysLock);
+            QuicDispatchLockRelease(&PerProc->StatelessRetryKeysLock);
             goto Exit;
         }
 
@@ -869,7 +928,7 @@ QuicBindingProcessStatelessOperation(
                 sizeof(Token.Authenticated), (uint8_t*) &Token.Authenticated,
                 sizeof(Token.Encrypted) + sizeof(Token.EncryptionTag), (uint8_t*)&(Token.Encrypted));
 
-        QuicLockRelease(&MsQuicLib.StatelessRetryKeysLock);
+        QuicDispatchLockRelease(&PerProc->StatelessRetryKeysLock);
         if (QUIC_FAILED(Status)) {
             goto Exit;
         }
@@ -895,11 +954,16 @@ QuicBindingProcessStatelessOperation(
             QuicCidBufToStr(RecvPacket->DestCid, RecvPacket->DestCidLen).Buffer,
             (uint16_t)sizeof(Token));
 
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_RETRY_SENT);
+
     } else {
         QUIC_TEL_ASSERT(FALSE); // Should be unreachable code.
         goto Exit;
     }
 
+    QuicPerfCounterIncrement(QUIC_PERF_COUNTER_UDP_SEND);
+    QuicPerfCounterAdd(QUIC_PERF_COUNTER_UDP_SEND_BYTES, SendDatagram->Length);
+
     QuicBindingSendFromTo(
         Binding,
         &RecvDatagram->Tuple->LocalAddress,
@@ -946,6 +1010,90 @@ QuicBindingReleaseStatelessOperation(
     }
 }
 
+//
+// Takes a token from a stateless response bucket, if there is one left.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicStatelessResponseBucketTake(
+    _Inout_ QUIC_STATELESS_RESPONSE_BUCKET* Bucket,
+    _In_ uint32_t TimeMs,
+    _In_ uint32_t TokensPerSec,
+    _In_ uint32_t Burst
+    )
+{
+    uint32_t Refilled =
+        (uint32_t)(((uint64_t)QuicTimeDiff32(Bucket->LastUpdateMs, TimeMs) * TokensPerSec) / 1000);
+    if (Refilled != 0 || Bucket->TokensUsed == 0) {
+        Bucket->TokensUsed = Refilled >= Bucket->TokensUsed ? 0 : Bucket->TokensUsed - Refilled;
+        Bucket->LastUpdateMs = TimeMs;
+    }
+
+    if (Bucket->TokensUsed >= Burst) {
+        return FALSE;
+    }
+
+    Bucket->TokensUsed++;
+    return TRUE;
+}
+
+//
+// Returns TRUE if a version negotiation or stateless reset may be sent in
+// response to the datagram. These responses are limited per source prefix
+// (instead of per address), so that scanning or spoofed junk traffic from a
+// network costs a bounded number of responses and stateless operations.
+// Stateless resets are also limited for the binding as a whole.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicBindingAllowStatelessResponse(
+    _In_ QUIC_BINDING* Binding,
+    _In_ const QUIC_RECV_DATAGRAM* Datagram,
+    _In_ BOOLEAN IsStatelessReset
+    )
+{
+    const QUIC_ADDR* RemoteAddress = &Datagram->Tuple->RemoteAddress;
+    const uint8_t* Prefix;
+    uint8_t PrefixLength;
+    if (QuicAddrGetFamily(RemoteAddress) == AF_INET) {
+        Prefix = (const uint8_t*)&RemoteAddress->Ipv4.sin_addr;
+        PrefixLength = 3;
+    } else {
+        Prefix = (const uint8_t*)&RemoteAddress->Ipv6.sin6_addr;
+        PrefixLength = 6;
+    }
+
+    uint32_t Hash = 5387;
+    for (uint8_t i = 0; i < PrefixLength; ++i) {
+        Hash = ((Hash << 5) - Hash) + Prefix[i];
+    }
+
+    uint32_t TimeMs = QuicTimeMs32();
+
+    if (!QuicStatelessResponseBucketTake(
+            &Binding->StatelessResponseBuckets[Hash % QUIC_STATELESS_RESPONSE_BUCKETS],
+            TimeMs,
+            QUIC_STATELESS_RESPONSES_PER_SEC_PER_PREFIX,
+            QUIC_STATELESS_RESPONSE_BURST_PER_PREFIX)) {
+        QuicPacketLogDrop(Binding, QuicDataPathRecvDatagramToRecvPacket(Datagram),
+            "Stateless response limit reached for prefix");
+        return FALSE;
+    }
+
+    if (IsStatelessReset &&
+        !QuicStatelessResponseBucketTake(
+            &Binding->StatelessResetBucket,
+            TimeMs,
+            QUIC_STATELESS_RESETS_PER_SEC,
+            QUIC_STATELESS_RESET_BURST)) {
+        QuicPacketLogDrop(Binding, QuicDataPathRecvDatagramToRecvPacket(Datagram),
+            "Stateless reset limit reached");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 BOOLEAN
 QuicBindingQueueStatelessReset(
@@ -973,6 +1121,10 @@ QuicBindingQueueStatelessReset(
         return FALSE;
     }
 
+    if (!QuicBindingAllowStatelessResponse(Binding, Datagram, TRUE)) {
+        return FALSE;
+    }
+
     return
         QuicBindingQueueStatelessOperation(
             Binding, QUIC_OPER_TYPE_STATELESS_RESET, Datagram);
@@ -1008,15 +1160,40 @@ QuicBindingPreprocessDatagram(
         // Validate we support this long header packet version.
         //
         if (!QuicIsVersionSupported(Packet->Invariant->LONG_HDR.Version)) {
-            if (!QuicBindingHasListenerRegistered(Binding)) {
+            //
+            // Cheap checks first, as this is where most junk traffic on a
+            // public port ends up: never answer a version negotiation packet,
+            // and (RFC 9000, Section 6.1) only answer datagrams large enough
+            // to be a client's first flight.
+            //
+            if (Packet->Invariant->LONG_HDR.Version == QUIC_VERSION_VER_NEG) {
+                QuicPacketLogDrop(Binding, Packet, "Version negotiation packet");
+            } else if (Datagram->BufferLength < QUIC_MIN_INITIAL_PACKET_LENGTH) {
+                QuicPacketLogDrop(Binding, Packet, "Too small to send VN");
+            } else if (!QuicBindingHasListenerRegistered(Binding)) {
                 QuicPacketLogDrop(Binding, Packet, "No listener to send VN");
-            } else {
+            } else if (QuicBindingAllowStatelessResponse(Binding, Datagram, FALSE)) {
                 *ReleaseDatagram =
                     !QuicBindingQueueStatelessOperation(
                         Binding, QUIC_OPER_TYPE_VERSION_NEGOTIATION, Datagram);
             }
             return FALSE;
         }
+
+        //
+        // When every worker is past its queue delay limit, new handshakes
+        // would only add to the delay of the established connections, so
+        // Initial packets are shed here, before any lookup or allocation. The
+        // clients retransmit them once the load drops.
+        //
+        if (Binding->ServerOwned &&
+            Packet->LH->Type == QUIC_INITIAL &&
+            MsQuicLib.WorkerPool != NULL &&
+            QuicWorkerPoolIsOverloaded(MsQuicLib.WorkerPool)) {
+            QuicPerfCounterIncrement(QUIC_PERF_COUNTER_WORKER_OVERLOADED);
+            QuicPacketLogDrop(Binding, Packet, "Workers overloaded (Initial)");
+            return FALSE;
+        }
     }
 
     *ReleaseDatagram = FALSE;
@@ -1104,6 +1281,41 @@ QuicBindingShouldRetryConnection(
     return MsQuicLib.CurrentHandshakeMemoryUsage >= CurrentMemoryLimit;
 }
 
+//
+// Returns TRUE if the client's first flight carries 0-RTT, i.e. the client is
+// resuming, either coalesced after the (already validated) Initial packet or
+// in another datagram of the chain.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicBindingHasZeroRtt(
+    _In_ const QUIC_RECV_DATAGRAM* const DatagramChain
+    )
+{
+    const QUIC_RECV_PACKET* Packet =
+        QuicDataPathRecvDatagramToRecvPacket(DatagramChain);
+    const QUIC_LONG_HEADER_V1* Header;
+
+    if (Packet->BufferLength < DatagramChain->BufferLength) {
+        Header =
+            (const QUIC_LONG_HEADER_V1*)(DatagramChain->Buffer + Packet->BufferLength);
+        if (Header->IsLongHeader && Header->Type == QUIC_0_RTT_PROTECTED) {
+            return TRUE;
+        }
+    }
+
+    for (const QUIC_RECV_DATAGRAM* Datagram = DatagramChain->Next;
+        Datagram != NULL;
+        Datagram = Datagram->Next) {
+        Header = (const QUIC_LONG_HEADER_V1*)Datagram->Buffer;
+        if (Header->IsLongHeader && Header->Type == QUIC_0_RTT_PROTECTED) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_CONNECTION*
 QuicBindingCreateConnection(
@@ -1149,9 +1361,21 @@ QuicBindingCreateConnection(
     //
     QUIC_WORKER* Worker = QuicLibraryGetWorker();
     if (QuicWorkerIsOverloaded(Worker)) {
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_WORKER_OVERLOADED);
         QuicPacketLogDrop(Binding, Packet, "Worker overloaded");
         goto Exit;
     }
+
+    //
+    // Limit the handshakes in progress, so the worker keeps up with its
+    // established connections. Resuming clients are admitted first.
+    //
+    NewConnection->HandshakeIsResumption = QuicBindingHasZeroRtt(Datagram);
+    if (!QuicWorkerCanAdmitHandshake(Worker, NewConnection->HandshakeIsResumption)) {
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_WORKER_OVERLOADED);
+        QuicPacketLogDrop(Binding, Packet, "Worker handshake limit reached");
+        goto Exit;
+    }
     QuicWorkerAssignConnection(Worker, NewConnection);
 
     //
@@ -1186,6 +1410,7 @@ QuicBindingCreateConnection(
         goto Exit;
     }
 
+    QuicWorkerAddHandshake(NewConnection);
     QuicWorkerQueueConnection(NewConnection->Worker, NewConnection);
 
     return NewConnection;
@@ -1392,16 +1617,66 @@ QuicBindingReceive(
     QUIC_DBG_ASSERT(DatagramChain != NULL);
 
     QUIC_BINDING* Binding = (QUIC_BINDING*)RecvCallbackContext;
+    if (Binding->EmulatedLink != NULL) {
+        QuicEmulatedLinkReceive(
+            MsQuicLib.NetworkEmulator,
+            Binding->EmulatedLink,
+            DatagramChain);
+    } else {
+        QuicBindingProcessDatagrams(Binding, DatagramChain);
+    }
+}
+
+//
+// A chain of received datagrams that all have the same destination CID, with
+// handshake packets first.
+//
+typedef struct QUIC_RECV_SUBCHAIN {
+    QUIC_RECV_DATAGRAM* Head;
+    QUIC_RECV_DATAGRAM** HandshakeTail;
+    QUIC_RECV_DATAGRAM** Tail;
+    uint32_t Length;
+} QUIC_RECV_SUBCHAIN;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicBindingDeliverSubChain(
+    _In_ QUIC_BINDING* Binding,
+    _Inout_ QUIC_RECV_SUBCHAIN* SubChain,
+    _Inout_ QUIC_RECV_DATAGRAM*** ReleaseChainTail
+    )
+{
+    if (!QuicBindingDeliverDatagrams(Binding, SubChain->Head, SubChain->Length)) {
+        **ReleaseChainTail = SubChain->Head;
+        *ReleaseChainTail = SubChain->Tail;
+    }
+    SubChain->Head = NULL;
+    SubChain->HandshakeTail = &SubChain->Head;
+    SubChain->Tail = &SubChain->Head;
+    SubChain->Length = 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicBindingProcessDatagrams(
+    _In_ QUIC_BINDING* Binding,
+    _In_ QUIC_RECV_DATAGRAM* DatagramChain
+    )
+{
     QUIC_RECV_DATAGRAM* ReleaseChain = NULL;
     QUIC_RECV_DATAGRAM** ReleaseChainTail = &ReleaseChain;
-    QUIC_RECV_DATAGRAM* SubChain = NULL;
-    QUIC_RECV_DATAGRAM** SubChainTail = &SubChain;
-    QUIC_RECV_DATAGRAM** SubChainDataTail = &SubChain;
-    uint32_t SubChainLength = 0;
+    QUIC_RECV_SUBCHAIN SubChains[QUIC_MAX_RECEIVE_SUBCHAINS];
+    uint32_t SubChainCount = 0;
+    uint32_t NextEvictedSubChain = 0;
+    uint32_t DatagramCount = 0;
+    uint64_t DatagramBytes = 0;
 
     //
-    // Breaks the chain of datagrams into subchains by destination CID and
-    // delivers the subchains.
+    // Groups the chain of datagrams into subchains by destination CID and
+    // delivers the subchains. Datagrams for different connections are often
+    // interleaved in a receive batch (GRO or recvmmsg), so each connection
+    // gets all its datagrams of the batch in one queue call (one lookup and
+    // at most one operation), instead of one call per run of datagrams.
     //
     // NB: All packets in a datagram are required to have the same destination
     // CID, so we don't split datagrams here. Later on, the packet handling
@@ -1417,6 +1692,8 @@ QuicBindingReceive(
         //
         DatagramChain = Datagram->Next;
         Datagram->Next = NULL;
+        DatagramCount++;
+        DatagramBytes += Datagram->BufferLength;
 
         QUIC_RECV_PACKET* Packet =
             QuicDataPathRecvDatagramToRecvPacket(Datagram);
@@ -1458,65 +1735,74 @@ QuicBindingReceive(
         QUIC_DBG_ASSERT(Packet->ValidatedHeaderInv);
 
         //
-        // If the next datagram doesn't match the current subchain, deliver the
-        // current subchain and start a new one.
+        // Find the subchain for the datagram's destination CID, or start a new
+        // one, delivering the oldest subchain first if there are too many.
         // (If the binding is exclusively owned, all datagrams are delivered to
-        // the same connection and this chain-splitting step is skipped.)
+        // the same connection and are all put in the first subchain.)
         //
-        QUIC_RECV_PACKET* SubChainPacket =
-            SubChain == NULL ?
-                NULL : QuicDataPathRecvDatagramToRecvPacket(SubChain);
-        if (!Binding->Exclusive && SubChain != NULL &&
-            (Packet->DestCidLen != SubChainPacket->DestCidLen ||
-             memcmp(Packet->DestCid, SubChainPacket->DestCid, Packet->DestCidLen) != 0)) {
-            if (!QuicBindingDeliverDatagrams(Binding, SubChain, SubChainLength)) {
-                *ReleaseChainTail = SubChain;
-                ReleaseChainTail = SubChainDataTail;
+        QUIC_RECV_SUBCHAIN* SubChain = NULL;
+        for (uint32_t i = 0; i < SubChainCount; ++i) {
+            QUIC_RECV_PACKET* SubChainPacket =
+                QuicDataPathRecvDatagramToRecvPacket(SubChains[i].Head);
+            if (Binding->Exclusive ||
+                (Packet->DestCidLen == SubChainPacket->DestCidLen &&
+                 QuicCidDataEqual(Packet->DestCid, SubChainPacket->DestCid, Packet->DestCidLen))) {
+                SubChain = &SubChains[i];
+                break;
+            }
+        }
+        if (SubChain == NULL) {
+            if (SubChainCount < ARRAYSIZE(SubChains)) {
+                SubChain = &SubChains[SubChainCount++];
+                SubChain->Head = NULL;
+                SubChain->HandshakeTail = &SubChain->Head;
+                SubChain->Tail = &SubChain->Head;
+                SubChain->Length = 0;
+            } else {
+                SubChain = &SubChains[NextEvictedSubChain];
+                NextEvictedSubChain = (NextEvictedSubChain + 1) % ARRAYSIZE(SubChains);
+                QuicBindingDeliverSubChain(Binding, SubChain, &ReleaseChainTail);
             }
-            SubChain = NULL;
-            SubChainTail = &SubChain;
-            SubChainDataTail = &SubChain;
-            SubChainLength = 0;
         }
 
         //
-        // Insert the datagram into the current chain, with handshake packets
-        // first (we assume handshake packets don't come after non-handshake
-        // packets in a datagram).
+        // Insert the datagram into the subchain, with handshake packets first
+        // (we assume handshake packets don't come after non-handshake packets
+        // in a datagram).
         // We do this so that we can more easily determine if the chain of
         // packets can create a new connection.
         //
 
-        SubChainLength++;
+        SubChain->Length++;
         if (!QuicPacketIsHandshake(Packet->Invariant)) {
-            *SubChainDataTail = Datagram;
-            SubChainDataTail = &Datagram->Next;
+            *SubChain->Tail = Datagram;
+            SubChain->Tail = &Datagram->Next;
         } else {
-            if (*SubChainTail == NULL) {
-                *SubChainTail = Datagram;
-                SubChainTail = &Datagram->Next;
-                SubChainDataTail = &Datagram->Next;
+            if (SubChain->HandshakeTail == SubChain->Tail) {
+                *SubChain->HandshakeTail = Datagram;
+                SubChain->HandshakeTail = &Datagram->Next;
+                SubChain->Tail = &Datagram->Next;
             } else {
-                Datagram->Next = *SubChainTail;
-                *SubChainTail = Datagram;
-                SubChainTail = &Datagram->Next;
+                Datagram->Next = *SubChain->HandshakeTail;
+                *SubChain->HandshakeTail = Datagram;
+                SubChain->HandshakeTail = &Datagram->Next;
             }
         }
     }
 
-    if (SubChain != NULL) {
-        //
-        // Deliver the last subchain.
-        //
-        if (!QuicBindingDeliverDatagrams(Binding, SubChain, SubChainLength)) {
-            *ReleaseChainTail = SubChain;
-            ReleaseChainTail = SubChainTail;
-        }
+    //
+    // Deliver the remaining subchains.
+    //
+    for (uint32_t i = 0; i < SubChainCount; ++i) {
+        QuicBindingDeliverSubChain(Binding, &SubChains[i], &ReleaseChainTail);
     }
 
     if (ReleaseChain != NULL) {
         QuicDataPathBindingReturnRecvDatagrams(ReleaseChain);
     }
+
+    QuicPerfCounterAdd(QUIC_PERF_COUNTER_UDP_RECV, DatagramCount);
+    QuicPerfCounterAdd(QUIC_PERF_COUNTER_UDP_RECV_BYTES, (int64_t)DatagramBytes);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -1675,6 +1961,58 @@ QuicBindingSendFromTo(
     return Status;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicBindingSendBatch(
+    _In_ QUIC_BINDING* Binding,
+    _In_ uint32_t EntryCount,
+    _In_reads_(EntryCount) const QUIC_DATAPATH_SEND_ENTRY* Entries
+    )
+{
+    QUIC_STATUS Status;
+
+#if QUIC_TEST_DATAPATH_HOOKS_ENABLED
+    if (MsQuicLib.TestDatapathHooks != NULL) {
+        //
+        // Give the test hooks a look at each send context on its own.
+        //
+        Status = QUIC_STATUS_SUCCESS;
+        for (uint32_t i = 0; i < EntryCount; ++i) {
+            QUIC_STATUS EntryStatus =
+                Entries[i].LocalAddress == NULL ?
+                    QuicBindingSendTo(
+                        Binding,
+                        Entries[i].RemoteAddress,
+                        Entries[i].SendContext) :
+                    QuicBindingSendFromTo(
+                        Binding,
+                        Entries[i].LocalAddress,
+                        Entries[i].RemoteAddress,
+                        Entries[i].SendContext);
+            if (QUIC_FAILED(EntryStatus)) {
+                Status = EntryStatus;
+            }
+        }
+        return Status;
+    }
+#endif
+
+    Status =
+        QuicDataPathBindingSendBatch(
+            Binding->DatapathBinding,
+            EntryCount,
+            Entries);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceLogWarning(
+            BindingSendBatchFailed,
+            "[bind][%p] SendBatch failed, 0x%x",
+            Binding,
+            Status);
+    }
+
+    return Status;
+}
+
 QUIC_STATIC_ASSERT(
     QUIC_HASH_SHA256_SIZE >= QUIC_STATELESS_RESET_TOKEN_LENGTH,
     "Stateless reset token must be shorter than hash size used");
@@ -139,6 +139,18 @@ typedef struct QUIC_RECV_PACKET {
     //
     BOOLEAN HasNonProbingFrame : 1;
 
+    //
+    // Flag indicating the connection is done with the datagram, but streams
+    // still reference it, so the last of them must return it.
+    //
+    BOOLEAN ReleasedToStreams : 1;
+
+    //
+    // Number of streams indicating stream data directly out of the datagram,
+    // plus the number of DATAGRAM frame payloads lent to the app.
+    //
+    uint16_t StreamRefCount;
+
 } QUIC_RECV_PACKET;
 
 typedef enum QUIC_BINDING_LOOKUP_TYPE {
@@ -153,6 +165,17 @@ typedef enum QUIC_BINDING_LOOKUP_TYPE {
 // Represents a UDP binding of local IP address and UDP port, and optionally
 // remote IP address.
 //
+//
+// A token bucket limiting stateless responses. It tracks the tokens used
+// (rather than the ones left) so that a zeroed bucket is full.
+//
+typedef struct QUIC_STATELESS_RESPONSE_BUCKET {
+
+    uint32_t LastUpdateMs;
+    uint32_t TokensUsed;
+
+} QUIC_STATELESS_RESPONSE_BUCKET;
+
 typedef struct QUIC_BINDING {
 
     //
@@ -160,6 +183,11 @@ typedef struct QUIC_BINDING {
     //
     QUIC_LIST_ENTRY Link;
 
+    //
+    // The entry in the library's index of bindings by address.
+    //
+    QUIC_HASHTABLE_ENTRY TableEntry;
+
     //
     // Indicates whether the binding is exclusively owned already. Defaults
     // to TRUE.
@@ -190,6 +218,13 @@ typedef struct QUIC_BINDING {
     //
     uint32_t RandomReservedVersion;
 
+    //
+    // The version list sent in Version Negotiation packets (the reserved
+    // version followed by the supported versions), prebuilt so each response
+    // only has to fill in the header and connection IDs.
+    //
+    uint32_t VerNegSupportedVersions[1 + QUIC_SUPPORTED_VERSION_COUNT];
+
 #ifdef QUIC_COMPARTMENT_ID
     //
     // The network compartment ID.
@@ -232,6 +267,20 @@ typedef struct QUIC_BINDING {
     QUIC_POOL StatelessOperCtxPool;
     uint32_t StatelessOperCount;
 
+    //
+    // Token buckets for the version negotiation and stateless reset responses,
+    // sharded by source prefix, and for all the stateless resets. Updated
+    // without a lock, as a lost update only lets an extra response through.
+    //
+    QUIC_STATELESS_RESPONSE_BUCKET StatelessResponseBuckets[QUIC_STATELESS_RESPONSE_BUCKETS];
+    QUIC_STATELESS_RESPONSE_BUCKET StatelessResetBucket;
+
+    //
+    // The emulated network the received datagrams go through, if network
+    // emulation was enabled when the binding was created.
+    //
+    QUIC_EMULATED_LINK* EmulatedLink;
+
     struct {
 
         struct {
@@ -248,6 +297,17 @@ typedef struct QUIC_BINDING {
 QUIC_DATAPATH_RECEIVE_CALLBACK QuicBindingReceive;
 QUIC_DATAPATH_UNREACHABLE_CALLBACK QuicBindingUnreachable;
 
+//
+// Processes received datagrams. Called by QuicBindingReceive, or by the
+// network emulator once the datagrams are due.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicBindingProcessDatagrams(
+    _In_ QUIC_BINDING* Binding,
+    _In_ QUIC_RECV_DATAGRAM* DatagramChain
+    );
+
 //
 // Initializes a new binding.
 //
@@ -414,6 +474,18 @@ QuicBindingSendFromTo(
     _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
     );
 
+//
+// Sends the data of several send contexts, each to its own remote host, in as
+// few submissions to the datapath as possible.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicBindingSendBatch(
+    _In_ QUIC_BINDING* Binding,
+    _In_ uint32_t EntryCount,
+    _In_reads_(EntryCount) const QUIC_DATAPATH_SEND_ENTRY* Entries
+    );
+
 //
 // Generates a stateless reset token for the given connection ID.
 //
@@ -456,13 +528,16 @@ QuicRetryTokenDecrypt(
         QuicCopyMemory(Iv, Packet->DestCid, MsQuicLib.CidTotalLength);
     }
 
-    QuicLockAcquire(&MsQuicLib.StatelessRetryKeysLock);
+    QUIC_LIBRARY_PP* PerProc =
+        &MsQuicLib.PerProc[QuicLibraryGetCurrentPartition()];
+    QuicDispatchLockAcquire(&PerProc->StatelessRetryKeysLock);
 
     QUIC_KEY* StatelessRetryKey =
         QuicLibraryGetStatelessRetryKeyForTimestamp(
+            PerProc,
             Token->Authenticated.Timestamp);
     if (StatelessRetryKey == NULL) {
-        QuicLockRelease(&MsQuicLib.StatelessRetryKeysLock);
+        QuicDispatchLockRelease(&PerProc->StatelessRetryKeysLock);
         return FALSE;
     }
 
@@ -475,6 +550,6 @@ QuicRetryTokenDecrypt(
             sizeof(Token->Encrypted) + sizeof(Token->EncryptionTag),
             (uint8_t*)&Token->Encrypted);
 
-    QuicLockRelease(&MsQuicLib.StatelessRetryKeysLock);
+    QuicDispatchLockRelease(&PerProc->StatelessRetryKeysLock);
     return QUIC_SUCCEEDED(Status);
 }
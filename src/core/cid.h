@@ -22,10 +22,11 @@ Abstract:
 #define QUIC_MIN_INITIAL_CONNECTION_ID_LENGTH       8
 
 //
-// The minimum and maximum CID server ID length used by MsQuic.
+// The minimum and maximum CID server ID length used by MsQuic. The largest is
+// a QUIC-LB stream cipher first octet, nonce and encrypted server ID.
 //
 #define MSQUIC_MIN_CID_SID_LENGTH                   0
-#define MSQUIC_MAX_CID_SID_LENGTH                   5
+#define MSQUIC_MAX_CID_SID_LENGTH                   12
 
 //
 // The index of the byte we use for partition ID lookup, in the connection ID.
@@ -68,6 +69,17 @@ QUIC_STATIC_ASSERT(
     MSQUIC_CID_MAX_LENGTH <= QUIC_MAX_CONNECTION_ID_LENGTH_V1,
     "MsQuic CID length must fit in v1");
 
+//
+// The length of QUIC-LB block cipher CIDs: the first octet followed by a single
+// AES block, which holds the server ID, PID and payload. Any octets left over
+// are random.
+//
+#define MSQUIC_CID_LB_BLOCK_LENGTH                  (1 + 16)
+
+QUIC_STATIC_ASSERT(
+    MSQUIC_CID_LB_BLOCK_LENGTH <= QUIC_MAX_CONNECTION_ID_LENGTH_V1,
+    "QUIC-LB block cipher CIDs must fit in v1");
+
 //
 // The maximum size of the prefix an app is allowed to configure is dependent on
 // the values of the other defines above; essentially constituting the left over
@@ -147,13 +159,59 @@ typedef struct QUIC_CID_QUIC_LIST_ENTRY {
 
 typedef struct QUIC_CID_HASH_ENTRY {
 
-    QUIC_HASHTABLE_ENTRY Entry;
     QUIC_SINGLE_LIST_ENTRY Link;
     QUIC_CONNECTION* Connection;
     QUIC_CID CID;
 
 } QUIC_CID_HASH_ENTRY;
 
+//
+// Compares the bytes of two CIDs of the same length. CIDs are short, so this
+// compares a machine word at a time (overlapping the last word instead of
+// finishing byte by byte) rather than calling into memcmp for every one of a
+// connection's CIDs.
+//
+inline
+BOOLEAN
+QuicCidDataEqual(
+    _In_reads_(Length)
+        const uint8_t* const A,
+    _In_reads_(Length)
+        const uint8_t* const B,
+    _In_ uint8_t Length
+    )
+{
+    if (Length >= sizeof(uint64_t)) {
+        uint64_t WordA, WordB;
+        for (uint8_t i = 0; i + sizeof(uint64_t) < Length; i += sizeof(uint64_t)) {
+            memcpy(&WordA, A + i, sizeof(WordA));
+            memcpy(&WordB, B + i, sizeof(WordB));
+            if (WordA != WordB) {
+                return FALSE;
+            }
+        }
+        memcpy(&WordA, A + Length - sizeof(uint64_t), sizeof(WordA));
+        memcpy(&WordB, B + Length - sizeof(uint64_t), sizeof(WordB));
+        return WordA == WordB;
+    }
+
+    if (Length >= sizeof(uint32_t)) {
+        uint32_t HeadA, HeadB, TailA, TailB;
+        memcpy(&HeadA, A, sizeof(HeadA));
+        memcpy(&HeadB, B, sizeof(HeadB));
+        memcpy(&TailA, A + Length - sizeof(uint32_t), sizeof(TailA));
+        memcpy(&TailB, B + Length - sizeof(uint32_t), sizeof(TailB));
+        return HeadA == HeadB && TailA == TailB;
+    }
+
+    for (uint8_t i = 0; i < Length; ++i) {
+        if (A[i] != B[i]) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
 //
 // Creates a new null/empty source connection ID, that will be used on the
 // receive path.
@@ -0,0 +1,371 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    An open addressing ("Swiss table" style) hash table for looking up source
+    connection IDs.
+
+    Slots are organized in aligned groups of QUIC_CID_TABLE_GROUP_SIZE. Each
+    slot has a control byte, which is either QUIC_CID_TABLE_EMPTY,
+    QUIC_CID_TABLE_DELETED or (for used slots) the low 7 bits of the hash. The
+    remaining hash bits pick the first group to probe, and groups are then
+    probed in triangular order, which visits every group once since the number
+    of groups is a power of two.
+
+    A probe compares the whole group of control bytes against the fingerprint
+    at once, and only the matching slots are checked further, first against
+    the full hash stored in the slot and only then against the CID itself. A
+    lookup ends at the first group that has an empty slot.
+
+    Removed slots become QUIC_CID_TABLE_DELETED, unless their group still has
+    an empty slot, since no probe sequence can continue past such a group. The
+    table grows (or is rehashed in place if mostly deleted) when the number of
+    slots that were ever used reaches 7/8 of the capacity.
+
+--*/
+
+#include "precomp.h"
+#ifdef QUIC_CLOG
+#include "cid_table.c.clog.h"
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define QUIC_CID_TABLE_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define QUIC_CID_TABLE_EMPTY            0x80
+#define QUIC_CID_TABLE_DELETED          0xFE
+
+#define QUIC_CID_TABLE_FINGERPRINT(Hash) ((uint8_t)((Hash) & 0x7F))
+#define QUIC_CID_TABLE_FIRST_GROUP(Hash) ((Hash) >> 7)
+
+//
+// Returns the max number of entries for the capacity, i.e. 7/8 of it.
+//
+#define QUIC_CID_TABLE_MAX_LOAD(Capacity) ((Capacity) - (Capacity) / 8)
+
+//
+// Returns a bit mask of the control bytes in the group equal to Value.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicCidTableGroupMatch(
+    _In_reads_(QUIC_CID_TABLE_GROUP_SIZE)
+        const uint8_t* Group,
+    _In_ uint8_t Value
+    )
+{
+#if QUIC_CID_TABLE_USE_SSE2
+    const __m128i Control = _mm_loadu_si128((const __m128i*)Group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(Control, _mm_set1_epi8((char)Value)));
+#else
+    uint32_t Mask = 0;
+    for (uint32_t i = 0; i < QUIC_CID_TABLE_GROUP_SIZE; ++i) {
+        if (Group[i] == Value) {
+            Mask |= 1u << i;
+        }
+    }
+    return Mask;
+#endif
+}
+
+//
+// Returns a bit mask of the empty or deleted control bytes in the group,
+// i.e. the ones with the high bit set.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicCidTableGroupMatchFree(
+    _In_reads_(QUIC_CID_TABLE_GROUP_SIZE)
+        const uint8_t* Group
+    )
+{
+#if QUIC_CID_TABLE_USE_SSE2
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)Group));
+#else
+    uint32_t Mask = 0;
+    for (uint32_t i = 0; i < QUIC_CID_TABLE_GROUP_SIZE; ++i) {
+        if (Group[i] & 0x80) {
+            Mask |= 1u << i;
+        }
+    }
+    return Mask;
+#endif
+}
+
+//
+// Returns the index of the lowest set bit in a non-zero mask.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicCidTableLowestBit(
+    _In_ uint32_t Mask
+    )
+{
+    QUIC_DBG_ASSERT(Mask != 0);
+    uint32_t Bit = 0;
+    while ((Mask & 1) == 0) {
+        Mask >>= 1;
+        Bit++;
+    }
+    return Bit;
+}
+
+//
+// Allocates the slot and control arrays for the given capacity, with all
+// slots empty.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicCidTableAllocate(
+    _Inout_ QUIC_CID_TABLE* Table,
+    _In_ uint32_t Capacity
+    )
+{
+    //
+    // The control bytes follow the slots in the same allocation. The slot
+    // array's length is a multiple of the group size, so the control bytes
+    // stay group aligned.
+    //
+    const size_t AllocLength =
+        (size_t)Capacity * (sizeof(QUIC_CID_TABLE_SLOT) + sizeof(uint8_t));
+    QUIC_CID_TABLE_SLOT* Slots = QUIC_ALLOC_NONPAGED(AllocLength);
+    if (Slots == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "CID table",
+            AllocLength);
+        return FALSE;
+    }
+
+    Table->Slots = Slots;
+    Table->Control = (uint8_t*)(Slots + Capacity);
+    Table->Capacity = Capacity;
+    memset(Table->Control, QUIC_CID_TABLE_EMPTY, Capacity);
+
+    return TRUE;
+}
+
+//
+// Returns the index of the first free (empty or deleted) slot in the probe
+// sequence for the hash, or UINT32_MAX if the table is completely full.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicCidTableFindFree(
+    _In_ const QUIC_CID_TABLE* Table,
+    _In_ uint32_t Hash
+    )
+{
+    const uint32_t GroupMask = Table->Capacity / QUIC_CID_TABLE_GROUP_SIZE - 1;
+    uint32_t Group = QUIC_CID_TABLE_FIRST_GROUP(Hash) & GroupMask;
+
+    for (uint32_t Probe = 1; Probe <= GroupMask + 1; ++Probe) {
+        const uint32_t Base = Group * QUIC_CID_TABLE_GROUP_SIZE;
+        const uint32_t Free = QuicCidTableGroupMatchFree(Table->Control + Base);
+        if (Free != 0) {
+            return Base + QuicCidTableLowestBit(Free);
+        }
+        Group = (Group + Probe) & GroupMask;
+    }
+
+    return UINT32_MAX;
+}
+
+//
+// Moves all the entries into newly allocated arrays of the given capacity.
+// Only the hashes stored in the slots are used; the entries aren't touched.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicCidTableResize(
+    _Inout_ QUIC_CID_TABLE* Table,
+    _In_ uint32_t NewCapacity
+    )
+{
+    QUIC_CID_TABLE OldTable = *Table;
+
+    if (!QuicCidTableAllocate(Table, NewCapacity)) {
+        *Table = OldTable;
+        return FALSE;
+    }
+
+    for (uint32_t i = 0; i < OldTable.Capacity; ++i) {
+        if (OldTable.Control[i] & 0x80) {
+            continue; // Empty or deleted.
+        }
+        const uint32_t Hash = OldTable.Slots[i].Hash;
+        const uint32_t Index = QuicCidTableFindFree(Table, Hash);
+        QUIC_DBG_ASSERT(Index != UINT32_MAX);
+        Table->Control[Index] = QUIC_CID_TABLE_FINGERPRINT(Hash);
+        Table->Slots[Index] = OldTable.Slots[i];
+    }
+
+    Table->GrowthLeft = QUIC_CID_TABLE_MAX_LOAD(NewCapacity) - Table->NumEntries;
+    QUIC_FREE(OldTable.Slots);
+
+    return TRUE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Must_inspect_result_
+BOOLEAN
+QuicCidTableInitialize(
+    _Out_ QUIC_CID_TABLE* Table
+    )
+{
+    Table->NumEntries = 0;
+    if (!QuicCidTableAllocate(Table, QUIC_CID_TABLE_MIN_CAPACITY)) {
+        return FALSE;
+    }
+    Table->GrowthLeft = QUIC_CID_TABLE_MAX_LOAD(QUIC_CID_TABLE_MIN_CAPACITY);
+    return TRUE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCidTableUninitialize(
+    _In_ QUIC_CID_TABLE* Table
+    )
+{
+    QUIC_FREE(Table->Slots);
+    Table->Slots = NULL;
+    Table->Control = NULL;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Must_inspect_result_
+BOOLEAN
+QuicCidTableInsert(
+    _Inout_ QUIC_CID_TABLE* Table,
+    _In_ uint32_t Hash,
+    _In_ QUIC_CID_HASH_ENTRY* Entry
+    )
+{
+    if (Table->GrowthLeft == 0) {
+        //
+        // Double the capacity if at least half the max load is in use;
+        // otherwise most of the used up growth is deleted slots, and just
+        // rehashing at the same capacity reclaims them.
+        //
+        uint32_t NewCapacity = Table->Capacity;
+        if (Table->NumEntries >= QUIC_CID_TABLE_MAX_LOAD(Table->Capacity) / 2) {
+            NewCapacity <<= 1;
+        }
+        //
+        // On failure, keep going with the remaining free slots, if any.
+        //
+        (void)QuicCidTableResize(Table, NewCapacity);
+    }
+
+    const uint32_t Index = QuicCidTableFindFree(Table, Hash);
+    if (Index == UINT32_MAX) {
+        return FALSE;
+    }
+
+    if (Table->Control[Index] == QUIC_CID_TABLE_EMPTY && Table->GrowthLeft != 0) {
+        Table->GrowthLeft--;
+    }
+    Table->Control[Index] = QUIC_CID_TABLE_FINGERPRINT(Hash);
+    Table->Slots[Index].Hash = Hash;
+    Table->Slots[Index].Entry = Entry;
+    Table->NumEntries++;
+
+    return TRUE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCidTableRemove(
+    _Inout_ QUIC_CID_TABLE* Table,
+    _In_ uint32_t Hash,
+    _In_ const QUIC_CID_HASH_ENTRY* Entry
+    )
+{
+    const uint8_t Fingerprint = QUIC_CID_TABLE_FINGERPRINT(Hash);
+    const uint32_t GroupMask = Table->Capacity / QUIC_CID_TABLE_GROUP_SIZE - 1;
+    uint32_t Group = QUIC_CID_TABLE_FIRST_GROUP(Hash) & GroupMask;
+
+    for (uint32_t Probe = 1; Probe <= GroupMask + 1; ++Probe) {
+        const uint32_t Base = Group * QUIC_CID_TABLE_GROUP_SIZE;
+        uint32_t Match = QuicCidTableGroupMatch(Table->Control + Base, Fingerprint);
+        while (Match != 0) {
+            const uint32_t Bit = QuicCidTableLowestBit(Match);
+            if (Table->Slots[Base + Bit].Entry == Entry) {
+                if (QuicCidTableGroupMatch(Table->Control + Base, QUIC_CID_TABLE_EMPTY) != 0) {
+                    Table->Control[Base + Bit] = QUIC_CID_TABLE_EMPTY;
+                    Table->GrowthLeft++;
+                } else {
+                    Table->Control[Base + Bit] = QUIC_CID_TABLE_DELETED;
+                }
+                Table->Slots[Base + Bit].Entry = NULL;
+                Table->NumEntries--;
+                return;
+            }
+            Match &= Match - 1;
+        }
+        if (QuicCidTableGroupMatch(Table->Control + Base, QUIC_CID_TABLE_EMPTY) != 0) {
+            break;
+        }
+        Group = (Group + Probe) & GroupMask;
+    }
+
+    QUIC_DBG_ASSERTMSG(FALSE, "Removing CID not in the table");
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_CID_HASH_ENTRY*
+QuicCidTableLookup(
+    _In_ const QUIC_CID_TABLE* Table,
+    _In_ uint32_t Hash,
+    _In_reads_(Length)
+        const uint8_t* const Cid,
+    _In_ uint8_t Length
+    )
+{
+    const uint8_t Fingerprint = QUIC_CID_TABLE_FINGERPRINT(Hash);
+    const uint32_t GroupMask = Table->Capacity / QUIC_CID_TABLE_GROUP_SIZE - 1;
+    uint32_t Group = QUIC_CID_TABLE_FIRST_GROUP(Hash) & GroupMask;
+
+    for (uint32_t Probe = 1; Probe <= GroupMask + 1; ++Probe) {
+        const uint32_t Base = Group * QUIC_CID_TABLE_GROUP_SIZE;
+        uint32_t Match = QuicCidTableGroupMatch(Table->Control + Base, Fingerprint);
+        while (Match != 0) {
+            const QUIC_CID_TABLE_SLOT* Slot =
+                &Table->Slots[Base + QuicCidTableLowestBit(Match)];
+            if (Slot->Hash == Hash &&
+                Slot->Entry->CID.Length == Length &&
+                QuicCidDataEqual(Cid, Slot->Entry->CID.Data, Length)) {
+                return Slot->Entry;
+            }
+            Match &= Match - 1;
+        }
+        if (QuicCidTableGroupMatch(Table->Control + Base, QUIC_CID_TABLE_EMPTY) != 0) {
+            break;
+        }
+        Group = (Group + Probe) & GroupMask;
+    }
+
+    return NULL;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_CID_HASH_ENTRY*
+QuicCidTableEnumerateNext(
+    _In_ const QUIC_CID_TABLE* Table,
+    _Inout_ uint32_t* Index
+    )
+{
+    while (*Index < Table->Capacity) {
+        const uint32_t i = (*Index)++;
+        if ((Table->Control[i] & 0x80) == 0) {
+            return Table->Slots[i].Entry;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,135 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+--*/
+
+//
+// The number of control bytes (and slots) probed at a time.
+//
+#define QUIC_CID_TABLE_GROUP_SIZE       16
+
+//
+// The initial number of slots in a table. Must be a power of two and a
+// multiple of the group size.
+//
+#define QUIC_CID_TABLE_MIN_CAPACITY     64
+
+QUIC_STATIC_ASSERT(IS_POWER_OF_TWO(QUIC_CID_TABLE_MIN_CAPACITY), L"Must be power of two");
+QUIC_STATIC_ASSERT(QUIC_CID_TABLE_MIN_CAPACITY >= QUIC_CID_TABLE_GROUP_SIZE, L"Must be at least one group");
+
+typedef struct QUIC_CID_TABLE_SLOT {
+
+    //
+    // The full hash of the CID, kept inline so that neither fingerprint
+    // collisions nor growing the table need to touch the entry itself.
+    //
+    uint32_t Hash;
+    QUIC_CID_HASH_ENTRY* Entry;
+
+} QUIC_CID_TABLE_SLOT;
+
+//
+// An open addressing hash table of source CIDs. Each slot has a one byte
+// control value holding either a 7-bit fingerprint of the hash (if used) or
+// an empty/deleted marker. Lookups compare a whole group of control bytes at a
+// time (with SIMD where available) and only look at the slots whose
+// fingerprint matches, so misses generally don't touch anything beyond the
+// control bytes.
+//
+typedef struct QUIC_CID_TABLE {
+
+    //
+    // QUIC_CID_TABLE_GROUP_SIZE-aligned array of control bytes, one per slot.
+    //
+    _Field_size_(Capacity)
+    uint8_t* Control;
+
+    _Field_size_(Capacity)
+    QUIC_CID_TABLE_SLOT* Slots;
+
+    //
+    // The total number of slots. Always a power of two.
+    //
+    uint32_t Capacity;
+
+    //
+    // The number of slots currently holding an entry.
+    //
+    uint32_t NumEntries;
+
+    //
+    // The number of entries that may still be inserted before the table must
+    // grow (or be cleaned of deleted slots) to maintain its load factor.
+    //
+    uint32_t GrowthLeft;
+
+} QUIC_CID_TABLE;
+
+//
+// Initializes an empty table.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Must_inspect_result_
+BOOLEAN
+QuicCidTableInitialize(
+    _Out_ QUIC_CID_TABLE* Table
+    );
+
+//
+// Frees the table's memory. The entries themselves are not touched.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCidTableUninitialize(
+    _In_ QUIC_CID_TABLE* Table
+    );
+
+//
+// Inserts the entry with the given hash. Only fails if the table is full and
+// couldn't be grown.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Must_inspect_result_
+BOOLEAN
+QuicCidTableInsert(
+    _Inout_ QUIC_CID_TABLE* Table,
+    _In_ uint32_t Hash,
+    _In_ QUIC_CID_HASH_ENTRY* Entry
+    );
+
+//
+// Removes the entry, previously inserted with the given hash.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCidTableRemove(
+    _Inout_ QUIC_CID_TABLE* Table,
+    _In_ uint32_t Hash,
+    _In_ const QUIC_CID_HASH_ENTRY* Entry
+    );
+
+//
+// Returns the entry for the given CID, or NULL.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_CID_HASH_ENTRY*
+QuicCidTableLookup(
+    _In_ const QUIC_CID_TABLE* Table,
+    _In_ uint32_t Hash,
+    _In_reads_(Length)
+        const uint8_t* const Cid,
+    _In_ uint8_t Length
+    );
+
+//
+// Enumerates the entries in the table. *Index must start at 0. Entries may be
+// removed while enumerating, but not inserted. Returns NULL at the end.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_CID_HASH_ENTRY*
+QuicCidTableEnumerateNext(
+    _In_ const QUIC_CID_TABLE* Table,
+    _Inout_ uint32_t* Index
+    );
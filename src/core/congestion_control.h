@@ -3,80 +3,230 @@
     Copyright (c) Microsoft Corporation.
     Licensed under the MIT License.
 
+Abstract:
+
+    Interface between the connection and its congestion control algorithm.
+    Each algorithm provides a QUIC_CONGESTION_CONTROL_VTABLE and keeps its
+    state in the union in QUIC_CONGESTION_CONTROL.
+
 --*/
 
-typedef struct QUIC_CONGESTION_CONTROL {
+//
+// Information passed to the congestion control algorithm when data is
+// acknowledged.
+//
+typedef struct QUIC_ACK_EVENT {
+
+    uint32_t TimeNow; // microsec
+
+    uint64_t LargestAck;
+
+    uint64_t LargestSentPacketNumber;
 
     //
-    // TRUE if we have had at least one congestion event.
-    // If TRUE, RecoverySentPacketNumber is valid.
+    // The number of retransmittable bytes newly acknowledged by this event
+    // (i.e. no longer in flight).
     //
-    BOOLEAN HasHadCongestionEvent : 1;
+    uint32_t NumRetransmittableBytes;
+
+    uint32_t SmoothedRtt; // microsec
 
     //
-    // This flag indicates a congestion event occurred and CC is attempting
-    // to recover from it.
+    // The smallest RTT sample taken from this event. Only valid if
+    // MinRttValid is TRUE.
     //
-    BOOLEAN IsInRecovery : 1;
+    uint32_t MinRtt; // microsec
+    BOOLEAN MinRttValid : 1;
 
     //
-    // This flag indicates a persistent congestion event occurred and CC is
-    // attempting to recover from it.
+    // TRUE if the delivery rate sample fields below are valid.
     //
-    BOOLEAN IsInPersistentCongestion : 1;
+    BOOLEAN IsRateSampleValid : 1;
 
     //
-    // TRUE if there has been at least one ACK.
+    // TRUE if the packet the rate sample is based on was sent while the
+    // connection was application limited.
     //
-    BOOLEAN TimeOfLastAckValid : 1;
+    BOOLEAN IsAppLimited : 1;
 
     //
-    // The size of the initial congestion window, in packets.
+    // Total number of bytes delivered over the life of the connection,
+    // including this event.
     //
-    uint32_t InitialWindowPackets;
+    uint64_t TotalBytesDelivered;
 
     //
-    // Minimum time without any sends before the congestion window is reset.
+    // The value of TotalBytesDelivered when the most recently sent packet
+    // acknowledged by this event was sent.
     //
-    uint32_t SendIdleTimeoutMs;
+    uint64_t PriorDelivered;
 
-    uint32_t CongestionWindow; // bytes
-    uint32_t SlowStartThreshold; // bytes
-
-    //
-    // The number of bytes considered to be still in the network.
     //
-    // The client of this module should send packets until BytesInFlight becomes
-    // larger than CongestionWindow (see QuicCongestionControlCanSend). This
-    // means BytesInFlight can become larger than CongestionWindow by up to one
-    // packet's worth of bytes, plus exemptions (see Exemptions variable).
+    // The number of bytes delivered over Interval.
     //
-    uint32_t BytesInFlight;
-    uint32_t BytesInFlightMax;
+    uint64_t DeliveredBytes;
+
+    uint32_t Interval; // microsec
+
+} QUIC_ACK_EVENT;
+
+typedef struct QUIC_CONGESTION_CONTROL_VTABLE {
+
+    const char* Name;
+
+    QUIC_CONGESTION_CONTROL_ALGORITHM Algorithm;
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    void (*Reset)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    BOOLEAN (*CanSend)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    void (*SetExemption)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc,
+        _In_ uint8_t NumPackets
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    uint32_t (*GetSendAllowance)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc,
+        _In_ uint64_t TimeSinceLastSend, // microsec
+        _In_ BOOLEAN TimeSinceLastSendValid
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    uint64_t (*GetPacingRate)(
+        _In_ const QUIC_CONGESTION_CONTROL* Cc
+        );
+
+    _IRQL_requires_max_(PASSIVE_LEVEL)
+    void (*OnDataSent)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc,
+        _In_ uint32_t NumRetransmittableBytes
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    BOOLEAN (*OnDataInvalidated)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc,
+        _In_ uint32_t NumRetransmittableBytes
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    BOOLEAN (*OnDataAcknowledged)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc,
+        _In_ const QUIC_ACK_EVENT* AckEvent
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    void (*OnDataLost)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc,
+        _In_ uint64_t LargestPacketNumberLost,
+        _In_ uint64_t LargestPacketNumberSent,
+        _In_ uint32_t NumRetransmittableBytes,
+        _In_ BOOLEAN PersistentCongestion
+        );
 
     //
-    // A count of packets which can be sent ignoring CongestionWindow.
-    // The count is decremented as the packets are sent. BytesInFlight is still
-    // incremented for these packets. This is used to send probe packets for
-    // loss recovery.
+    // Called when all the packets declared lost since the congestion event
+    // were acknowledged after all. Reverts the event's reductions, if the
+    // algorithm supports it. Returns TRUE if the connection became unblocked.
     //
-    uint8_t Exemptions;
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    BOOLEAN (*OnSpuriousCongestionEvent)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    void (*OnEcn)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc,
+        _In_ uint64_t LargestPacketNumberAcked,
+        _In_ uint64_t LargestPacketNumberSent
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    void (*SetAppLimited)(
+        _In_ QUIC_CONGESTION_CONTROL* Cc
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    BOOLEAN (*IsAppLimited)(
+        _In_ const QUIC_CONGESTION_CONTROL* Cc
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    uint8_t (*GetExemptions)(
+        _In_ const QUIC_CONGESTION_CONTROL* Cc
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    uint32_t (*GetBytesInFlightMax)(
+        _In_ const QUIC_CONGESTION_CONTROL* Cc
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    uint32_t (*GetCongestionWindow)(
+        _In_ const QUIC_CONGESTION_CONTROL* Cc
+        );
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    void (*LogOutFlowStatus)(
+        _In_ const QUIC_CONGESTION_CONTROL* Cc
+        );
+
+} QUIC_CONGESTION_CONTROL_VTABLE;
 
-    uint64_t TimeOfLastAck; // millisec
-    uint64_t TimeOfCongAvoidStart; // millisec
-    uint32_t KCubic; // millisec
-    uint32_t WindowMax; // bytes
-    uint32_t WindowLastMax; // bytes
+typedef struct QUIC_CONGESTION_CONTROL {
 
     //
-    // This variable tracks the largest packet that was outstanding at the time
-    // the last congestion event occurred. An ACK for any packet number greater
-    // than this indicates recovery is over.
+    // The algorithm currently in use. Set by QuicCongestionControlInitialize.
     //
-    uint64_t RecoverySentPacketNumber;
+    const QUIC_CONGESTION_CONTROL_VTABLE* Vtable;
+
+    union {
+        QUIC_CONGESTION_CONTROL_CUBIC Cubic;
+        QUIC_CONGESTION_CONTROL_BBR Bbr;
+        QUIC_CONGESTION_CONTROL_LEDBAT Ledbat;
+    };
 
 } QUIC_CONGESTION_CONTROL;
 
+//
+// Initializes the congestion control state with the algorithm configured in
+// the settings.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCongestionControlInitialize(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_SETTINGS* Settings
+    );
+
+//
+// Changes the initial congestion window of the current algorithm, and resets
+// it. Only used before any data is sent.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCongestionControlSetInitialWindow(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t InitialWindowPackets
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+QuicCongestionControlReset(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    Cc->Vtable->Reset(Cc);
+}
+
 //
 // Returns TRUE if more bytes can be sent on the network.
 //
@@ -87,9 +237,13 @@ QuicCongestionControlCanSend(
     _In_ QUIC_CONGESTION_CONTROL* Cc
     )
 {
-    return Cc->BytesInFlight < Cc->CongestionWindow || Cc->Exemptions > 0;
+    return Cc->Vtable->CanSend(Cc);
 }
 
+//
+// Sets the number of packets which can be sent ignoring the congestion
+// window. Used to send probe packets for loss recovery.
+//
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 void
@@ -98,71 +252,87 @@ QuicCongestionControlSetExemption(
     _In_ uint8_t NumPackets
     )
 {
-    Cc->Exemptions = NumPackets;
+    Cc->Vtable->SetExemption(Cc, NumPackets);
 }
 
-_IRQL_requires_max_(DISPATCH_LEVEL)
-void
-QuicCongestionControlInitialize(
-    _In_ QUIC_CONGESTION_CONTROL* Cc,
-    _In_ const QUIC_SETTINGS* Settings
-    );
-
-_IRQL_requires_max_(DISPATCH_LEVEL)
-void
-QuicCongestionControlReset(
-    _In_ QUIC_CONGESTION_CONTROL* Cc
-    );
-
 //
 // Returns the number of bytes that can be sent immediately.
 //
 _IRQL_requires_max_(DISPATCH_LEVEL)
+inline
 uint32_t
 QuicCongestionControlGetSendAllowance(
     _In_ QUIC_CONGESTION_CONTROL* Cc,
     _In_ uint64_t TimeSinceLastSend, // microsec
     _In_ BOOLEAN TimeSinceLastSendValid
-    );
+    )
+{
+    return Cc->Vtable->GetSendAllowance(Cc, TimeSinceLastSend, TimeSinceLastSendValid);
+}
+
+//
+// Returns the rate (in bytes per second) sends are currently paced at, or zero
+// if sends aren't being paced.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+uint64_t
+QuicCongestionControlGetPacingRate(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Vtable->GetPacingRate(Cc);
+}
 
 //
 // Called when any retransmittable data is sent.
 //
 _IRQL_requires_max_(PASSIVE_LEVEL)
+inline
 void
 QuicCongestionControlOnDataSent(
     _In_ QUIC_CONGESTION_CONTROL* Cc,
     _In_ uint32_t NumRetransmittableBytes
-    );
+    )
+{
+    Cc->Vtable->OnDataSent(Cc, NumRetransmittableBytes);
+}
 
 //
 // Called when any data needs to be removed from inflight but cannot be
 // considered lost or acknowledged.
 //
 _IRQL_requires_max_(DISPATCH_LEVEL)
+inline
 BOOLEAN
 QuicCongestionControlOnDataInvalidated(
     _In_ QUIC_CONGESTION_CONTROL* Cc,
     _In_ uint32_t NumRetransmittableBytes
-    );
+    )
+{
+    return Cc->Vtable->OnDataInvalidated(Cc, NumRetransmittableBytes);
+}
 
 //
-// Called when any data is acknowledged.
+// Called when any data is acknowledged. Returns TRUE if the connection became
+// unblocked.
 //
 _IRQL_requires_max_(DISPATCH_LEVEL)
+inline
 BOOLEAN
 QuicCongestionControlOnDataAcknowledged(
     _In_ QUIC_CONGESTION_CONTROL* Cc,
-    _In_ uint64_t TimeNow, // millisec
-    _In_ uint64_t LargestPacketNumberAcked,
-    _In_ uint32_t NumRetransmittableBytes,
-    _In_ uint32_t SmoothedRtt
-    );
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    )
+{
+    return Cc->Vtable->OnDataAcknowledged(Cc, AckEvent);
+}
 
 //
 // Called when data is determined lost.
 //
 _IRQL_requires_max_(DISPATCH_LEVEL)
+inline
 void
 QuicCongestionControlOnDataLost(
     _In_ QUIC_CONGESTION_CONTROL* Cc,
@@ -170,4 +340,112 @@ QuicCongestionControlOnDataLost(
     _In_ uint64_t LargestPacketNumberSent,
     _In_ uint32_t NumRetransmittableBytes,
     _In_ BOOLEAN PersistentCongestion
-    );
\ No newline at end of file
+    )
+{
+    Cc->Vtable->OnDataLost(
+        Cc,
+        LargestPacketNumberLost,
+        LargestPacketNumberSent,
+        NumRetransmittableBytes,
+        PersistentCongestion);
+}
+
+//
+// Called when all the packets declared lost since the last congestion event
+// turned out to be only reordered. Returns TRUE if the connection became
+// unblocked.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+QuicCongestionControlOnSpuriousCongestionEvent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Vtable->OnSpuriousCongestionEvent(Cc);
+}
+
+//
+// Called when the peer reports newly received packets marked with congestion
+// experienced (CE).
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+QuicCongestionControlOnEcn(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t LargestPacketNumberAcked,
+    _In_ uint64_t LargestPacketNumberSent
+    )
+{
+    Cc->Vtable->OnEcn(Cc, LargestPacketNumberAcked, LargestPacketNumberSent);
+}
+
+//
+// Called when the connection has nothing more to send, even though the
+// congestion window would allow it.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+QuicCongestionControlSetAppLimited(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    Cc->Vtable->SetAppLimited(Cc);
+}
+
+//
+// Returns TRUE if the connection is currently application limited. Packets
+// sent while application limited produce delivery rate samples which may
+// underestimate the available bandwidth.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+QuicCongestionControlIsAppLimited(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Vtable->IsAppLimited(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+uint8_t
+QuicCongestionControlGetExemptions(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Vtable->GetExemptions(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+uint32_t
+QuicCongestionControlGetBytesInFlightMax(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Vtable->GetBytesInFlightMax(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+uint32_t
+QuicCongestionControlGetCongestionWindow(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Vtable->GetCongestionWindow(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+QuicCongestionControlLogOutFlowStatus(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    Cc->Vtable->LogOutFlowStatus(Cc);
+}
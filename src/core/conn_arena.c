@@ -0,0 +1,209 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    The per-connection arena serves a connection's streams and send requests
+    from up to QUIC_CONN_ARENA_MAX_CHUNKS chunks, carved in order and allocated
+    as needed. Freed objects go to a free list per type, and the chunks are
+    only freed with the connection. Short lived connections (e.g. a single
+    request and response) then don't touch the shared pools, and their objects
+    are packed together in memory. Once the chunks are exhausted, objects are
+    allocated from the worker's pools as usual.
+
+    The arena is enabled per connection, with QUIC_PARAM_CONN_ARENA_ENABLED.
+
+--*/
+
+#include "precomp.h"
+#ifdef QUIC_CLOG
+#include "conn_arena.c.clog.h"
+#endif
+
+static const uint16_t QuicConnArenaObjectSizes[QUIC_CONN_ARENA_TYPE_COUNT] = {
+    (sizeof(QUIC_STREAM) + 15) & ~15,
+    (sizeof(QUIC_SEND_REQUEST) + 15) & ~15
+};
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicConnArenaInitialize(
+    _Out_ QUIC_CONN_ARENA* Arena
+    )
+{
+    QuicZeroMemory(Arena, sizeof(*Arena));
+    QuicDispatchLockInitialize(&Arena->Lock);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicConnArenaUninitialize(
+    _In_ QUIC_CONN_ARENA* Arena
+    )
+{
+    for (uint8_t i = 0; i < Arena->ChunkCount; ++i) {
+        QUIC_FREE(Arena->Chunks[i]);
+    }
+    QuicDispatchLockUninitialize(&Arena->Lock);
+}
+
+static
+void*
+QuicConnArenaAlloc(
+    _In_ QUIC_CONN_ARENA* Arena,
+    _In_ QUIC_CONN_ARENA_TYPE Type
+    )
+{
+    if (!Arena->Enabled) {
+        return NULL;
+    }
+
+    const uint16_t Size = QuicConnArenaObjectSizes[Type];
+    void* Object = NULL;
+
+    QuicDispatchLockAcquire(&Arena->Lock);
+    if (Arena->FreeLists[Type] != NULL) {
+        Object = Arena->FreeLists[Type];
+        Arena->FreeLists[Type] = *(void**)Object;
+
+    } else {
+        if ((size_t)(Arena->End - Arena->Next) < Size &&
+            Arena->ChunkCount < QUIC_CONN_ARENA_MAX_CHUNKS) {
+            uint8_t* Chunk = QUIC_ALLOC_NONPAGED(QUIC_CONN_ARENA_CHUNK_SIZE);
+            if (Chunk != NULL) {
+                Arena->Chunks[Arena->ChunkCount++] = Chunk;
+                Arena->Next = Chunk;
+                Arena->End = Chunk + QUIC_CONN_ARENA_CHUNK_SIZE;
+            }
+        }
+        if ((size_t)(Arena->End - Arena->Next) >= Size) {
+            Object = Arena->Next;
+            Arena->Next += Size;
+        }
+    }
+    QuicDispatchLockRelease(&Arena->Lock);
+
+    if (Object != NULL) {
+        QuicZeroMemory(Object, Size);
+    }
+
+    return Object;
+}
+
+//
+// Must be called with the lock held.
+//
+static
+BOOLEAN
+QuicConnArenaContains(
+    _In_ const QUIC_CONN_ARENA* Arena,
+    _In_ const void* Object
+    )
+{
+    for (uint8_t i = 0; i < Arena->ChunkCount; ++i) {
+        if ((const uint8_t*)Object >= Arena->Chunks[i] &&
+            (const uint8_t*)Object < Arena->Chunks[i] + QUIC_CONN_ARENA_CHUNK_SIZE) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//
+// Returns FALSE if the object wasn't allocated from the arena.
+//
+static
+BOOLEAN
+QuicConnArenaFree(
+    _In_ QUIC_CONN_ARENA* Arena,
+    _In_ QUIC_CONN_ARENA_TYPE Type,
+    _In_ void* Object
+    )
+{
+    BOOLEAN Found;
+
+    QuicDispatchLockAcquire(&Arena->Lock);
+    Found = QuicConnArenaContains(Arena, Object);
+    if (Found) {
+        *(void**)Object = Arena->FreeLists[Type];
+        Arena->FreeLists[Type] = Object;
+    }
+    QuicDispatchLockRelease(&Arena->Lock);
+
+    return Found;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STREAM*
+QuicConnAllocStream(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_STREAM* Stream =
+        (QUIC_STREAM*)QuicConnArenaAlloc(&Connection->Arena, QUIC_CONN_ARENA_STREAM);
+    if (Stream == NULL) {
+        Stream = QuicPoolAlloc(&Connection->Worker->StreamPool);
+    }
+    return Stream;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicConnFreeStream(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_STREAM* Stream
+    )
+{
+    if (!QuicConnArenaFree(&Connection->Arena, QUIC_CONN_ARENA_STREAM, Stream)) {
+        QuicPoolFree(&Connection->Worker->StreamPool, Stream);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicConnIsArenaStream(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ const QUIC_STREAM* Stream
+    )
+{
+    QUIC_CONN_ARENA* Arena = &Connection->Arena;
+    if (Arena->ChunkCount == 0) {
+        return FALSE; // Streams being freed were allocated before any new chunk.
+    }
+
+    QuicDispatchLockAcquire(&Arena->Lock);
+    BOOLEAN Found = QuicConnArenaContains(Arena, Stream);
+    QuicDispatchLockRelease(&Arena->Lock);
+
+    return Found;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_SEND_REQUEST*
+QuicConnAllocSendRequest(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_SEND_REQUEST* SendRequest =
+        (QUIC_SEND_REQUEST*)QuicConnArenaAlloc(
+            &Connection->Arena, QUIC_CONN_ARENA_SEND_REQUEST);
+    if (SendRequest == NULL) {
+        SendRequest = QuicPoolAlloc(&Connection->Worker->SendRequestPool);
+    }
+    return SendRequest;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicConnFreeSendRequest(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_SEND_REQUEST* SendRequest
+    )
+{
+    if (!QuicConnArenaFree(
+            &Connection->Arena, QUIC_CONN_ARENA_SEND_REQUEST, SendRequest)) {
+        QuicPoolFree(&Connection->Worker->SendRequestPool, SendRequest);
+    }
+}
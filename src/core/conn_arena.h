@@ -0,0 +1,116 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Definitions for the per-connection arena, which serves the connection's
+    small fixed size objects (streams and send requests) from a few chunks
+    owned by the connection, instead of from the worker's pools.
+
+--*/
+
+#define QUIC_CONN_ARENA_CHUNK_SIZE      0x4000 // 16 KB
+#define QUIC_CONN_ARENA_MAX_CHUNKS      4
+
+//
+// The types of objects the arena serves. Each has its own free list.
+//
+typedef enum QUIC_CONN_ARENA_TYPE {
+
+    QUIC_CONN_ARENA_STREAM,
+    QUIC_CONN_ARENA_SEND_REQUEST,
+    QUIC_CONN_ARENA_TYPE_COUNT
+
+} QUIC_CONN_ARENA_TYPE;
+
+typedef struct QUIC_CONN_ARENA {
+
+    //
+    // Objects are allocated on app threads (streams and sends are opened
+    // there) and freed on the worker, so the arena is locked.
+    //
+    QUIC_DISPATCH_LOCK Lock;
+
+    //
+    // Indicates new objects are allocated from the arena. Objects allocated
+    // while it was disabled still come from (and go back to) the pools.
+    //
+    BOOLEAN Enabled;
+
+    uint8_t ChunkCount;
+
+    //
+    // Unused part of the last chunk.
+    //
+    uint8_t* Next;
+    uint8_t* End;
+
+    //
+    // Singly linked lists (through their first bytes) of freed objects.
+    //
+    void* FreeLists[QUIC_CONN_ARENA_TYPE_COUNT];
+
+    uint8_t* Chunks[QUIC_CONN_ARENA_MAX_CHUNKS];
+
+} QUIC_CONN_ARENA;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicConnArenaInitialize(
+    _Out_ QUIC_CONN_ARENA* Arena
+    );
+
+//
+// Frees all the chunks. All the objects must already be freed.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicConnArenaUninitialize(
+    _In_ QUIC_CONN_ARENA* Arena
+    );
+
+//
+// Allocates a stream for the connection, from its arena if enabled and not
+// exhausted, or else from the worker's pool.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STREAM*
+QuicConnAllocStream(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicConnFreeStream(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_STREAM* Stream
+    );
+
+//
+// Returns TRUE if the stream was allocated from the connection's arena.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicConnIsArenaStream(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ const QUIC_STREAM* Stream
+    );
+
+//
+// Allocates a send request (stream or datagram) for the connection, from its
+// arena if enabled and not exhausted, or else from the worker's pool.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_SEND_REQUEST*
+QuicConnAllocSendRequest(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicConnFreeSendRequest(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_SEND_REQUEST* SendRequest
+    );
@@ -15,8 +15,9 @@ Abstract:
     The connection drains operations in the QuicConnDrainOperations function.
     The only requirement here is that this function is not called in parallel
     on multiple threads. The function will drain up to QUIC_SETTINGS's
-    MaxOperationsPerDrain operations per call, so as to not starve any other
-    work.
+    MaxOperationsPerDrain operations per call, and stops early once it has
+    used up the registration's MaxDrainTimeUs time budget, so as to not starve
+    any other work.
 
     While most of the connection specific work is managed by other interfaces,
     the following things are managed in this file:
@@ -89,6 +90,18 @@ QuicConnAlloc(
     InterlockedIncrement(&MsQuicLib.ConnectionCount);
 #endif
 
+    if (IsServer) {
+        const QUIC_RECV_PACKET* Packet =
+            QuicDataPathRecvDatagramToRecvPacket(Datagram);
+        Connection->TraceSampled =
+            QuicLibraryIsConnTraceSampled(
+                &Datagram->Tuple->RemoteAddress,
+                Packet->DestCidLen,
+                Packet->DestCid);
+    } else {
+        Connection->TraceSampled = QuicLibraryIsConnTraceSampled(NULL, 0, NULL);
+    }
+
     Connection->Stats.CorrelationId =
         InterlockedIncrement64((int64_t*)&MsQuicLib.ConnectionCorrelationId) - 1;
     QuicTraceEvent(
@@ -97,6 +110,8 @@ QuicConnAlloc(
         Connection,
         IsServer,
         Connection->Stats.CorrelationId);
+    QuicPerfCounterIncrement(QUIC_PERF_COUNTER_CONN_CREATED);
+    QuicPerfCounterIncrement(QUIC_PERF_COUNTER_CONN_ACTIVE);
 
     Connection->RefCount = 1;
 #if DEBUG
@@ -110,10 +125,15 @@ QuicConnAlloc(
     Connection->Stats.Timing.Start = QuicTimeUs64();
     Connection->SourceCidLimit = QUIC_ACTIVE_CONNECTION_ID_LIMIT;
     Connection->AckDelayExponent = QUIC_ACK_DELAY_EXPONENT;
+    Connection->PacketTolerance = QUIC_MIN_ACK_SEND_NUMBER;
+    Connection->PeerPacketTolerance = QUIC_MIN_ACK_SEND_NUMBER;
     Connection->PeerTransportParams.AckDelayExponent = QUIC_TP_ACK_DELAY_EXPONENT_DEFAULT;
     Connection->ReceiveQueueTail = &Connection->ReceiveQueue;
     QuicDispatchLockInitialize(&Connection->ReceiveQueueLock);
+    QuicConnArenaInitialize(&Connection->Arena);
     QuicListInitializeHead(&Connection->DestCids);
+    QuicListInitializeHead(&Connection->RecvBatchStreams);
+    QuicListInitializeHead(&Connection->SendCompleteBatchStreams);
     QuicStreamSetInitialize(&Connection->Streams);
     QuicSendBufferInitialize(&Connection->SendBuffer);
     QuicOperationQueueInitialize(&Connection->OperQ);
@@ -349,6 +369,12 @@ QuicConnFree(
     }
     QUIC_TEL_ASSERT(Connection->SourceCids.Next == NULL);
     QUIC_TEL_ASSERT(QuicListIsEmpty(&Connection->Streams.ClosedStreams));
+    QUIC_TEL_ASSERT(QuicListIsEmpty(&Connection->RecvBatchStreams));
+    QUIC_TEL_ASSERT(QuicListIsEmpty(&Connection->SendCompleteBatchStreams));
+    QuicStatsRegionReleaseConnection(Connection);
+    if (Connection->RecvBatch != NULL) {
+        QUIC_FREE(Connection->RecvBatch);
+    }
     QuicLossDetectionUninitialize(&Connection->LossDetection);
     QuicSendUninitialize(&Connection->Send);
     while (!QuicListIsEmpty(&Connection->DestCids)) {
@@ -369,7 +395,14 @@ QuicConnFree(
         } while ((Datagram = Datagram->Next) != NULL);
         QuicDataPathBindingReturnRecvDatagrams(Connection->ReceiveQueue);
         Connection->ReceiveQueue = NULL;
+        if (Connection->Worker != NULL) {
+            InterlockedExchangeAdd64(
+                &Connection->Worker->ReceiveQueueCount,
+                -(int64_t)Connection->ReceiveQueueCount);
+        }
+        Connection->ReceiveQueueCount = 0;
     }
+    QuicDatagramReturnRecvLoans(&Connection->Datagram);
     QUIC_PATH* Path = &Connection->Paths[0];
     if (Path->Binding != NULL) {
         QuicLibraryReleaseBinding(Path->Binding);
@@ -380,8 +413,15 @@ QuicConnFree(
     QuicStreamSetUninitialize(&Connection->Streams);
     QuicSendBufferUninitialize(&Connection->SendBuffer);
     QuicDatagramUninitialize(&Connection->Datagram);
+    QuicConnArenaUninitialize(&Connection->Arena);
     QuicSessionUnregisterConnection(Connection);
     if (Connection->Registration != NULL) {
+        QUIC_STATISTICS_HISTOGRAMS* Totals = &Connection->Registration->Histograms;
+        QuicHistogramAggregate(&Totals->Rtt, Connection->Histograms.Rtt);
+        QuicHistogramAggregate(&Totals->AckDelay, Connection->Histograms.AckDelay);
+        QuicHistogramAggregate(&Totals->QueueDelay, Connection->Histograms.QueueDelay);
+        QuicHistogramAggregate(&Totals->CallbackTime, Connection->Histograms.CallbackTime);
+        QuicHistogramAggregate(&Totals->SendBatchSize, Connection->Histograms.SendBatchSize);
         QuicRundownRelease(&Connection->Registration->ConnectionRundown);
     }
     Connection->State.Freed = TRUE;
@@ -397,10 +437,15 @@ QuicConnFree(
             Connection->HandshakeTP);
         Connection->HandshakeTP = NULL;
     }
+    if (Connection->DeferredTicketAppData != NULL) {
+        QUIC_FREE(Connection->DeferredTicketAppData);
+        Connection->DeferredTicketAppData = NULL;
+    }
     QuicTraceEvent(
         ConnDestroyed,
         "[conn][%p] Destroyed",
         Connection);
+    QuicPerfCounterDecrement(QUIC_PERF_COUNTER_CONN_ACTIVE);
     QuicPoolFree(
         &MsQuicLib.PerProc[QuicLibraryGetCurrentPartition()].ConnectionPool,
         Connection);
@@ -418,12 +463,18 @@ QuicConnApplySettings(
     )
 {
     Connection->State.UsePacing = Settings->PacingDefault;
+    Connection->Send.PacingOffload =
+        Settings->PacingOffloadEnabled &&
+        (QuicDataPathGetSupportedFeatures(MsQuicLib.Datapath) &
+            QUIC_DATAPATH_FEATURE_SEND_TXTIME) != 0;
     Connection->MaxAckDelayMs = Settings->MaxAckDelayMs;
     Connection->Paths[0].SmoothedRtt = MS_TO_US(Settings->InitialRttMs);
     Connection->DisconnectTimeoutUs = MS_TO_US(Settings->DisconnectTimeoutMs);
     Connection->IdleTimeoutMs = Settings->IdleTimeoutMs;
     Connection->HandshakeIdleTimeoutMs = Settings->HandshakeIdleTimeoutMs;
     Connection->KeepAliveIntervalMs = Settings->KeepAliveIntervalMs;
+    Connection->HibernateTimeoutMs = Settings->HibernateTimeoutMs;
+    Connection->HibernateStreamBytes = UINT64_MAX;
     Connection->Datagram.ReceiveEnabled = Settings->DatagramReceiveEnabled;
 
     uint8_t PeerStreamType =
@@ -441,6 +492,14 @@ QuicConnApplySettings(
             PeerStreamType | STREAM_ID_FLAG_IS_UNI_DIR,
             Settings->UnidiStreamCount);
     }
+    QuicStreamSetUpdateMaxCountCeiling(
+        &Connection->Streams,
+        PeerStreamType | STREAM_ID_FLAG_IS_BI_DIR,
+        Settings->PeerStreamCountMax);
+    QuicStreamSetUpdateMaxCountCeiling(
+        &Connection->Streams,
+        PeerStreamType | STREAM_ID_FLAG_IS_UNI_DIR,
+        Settings->PeerStreamCountMax);
 
     if (Settings->ServerResumptionLevel > QUIC_SERVER_NO_RESUME) {
         QUIC_DBG_ASSERT(!Connection->State.Started);
@@ -462,7 +521,22 @@ QuicConnApplySettings(
     }
 
     QuicSendApplySettings(&Connection->Send, Settings);
-    QuicCongestionControlInitialize(&Connection->CongestionControl, Settings);
+
+    if (Connection->Registration != NULL &&
+        Connection->Registration->ExecProfile == QUIC_EXECUTION_PROFILE_TYPE_SCAVENGER &&
+        !Settings->AppSet.CongestionControlAlgorithm) {
+        //
+        // Scavenger connections also give way to other traffic on the
+        // network, unless the app explicitly picked an algorithm.
+        //
+        QUIC_SETTINGS ScavengerSettings = *Settings;
+        ScavengerSettings.CongestionControlAlgorithm =
+            QUIC_CONGESTION_CONTROL_ALGORITHM_LEDBAT;
+        QuicCongestionControlInitialize(
+            &Connection->CongestionControl, &ScavengerSettings);
+    } else {
+        QuicCongestionControlInitialize(&Connection->CongestionControl, Settings);
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -477,6 +551,8 @@ QuicConnShutdown(
     if (Flags & QUIC_CONNECTION_SHUTDOWN_FLAG_SILENT ||
         (!Connection->State.Started && !QuicConnIsServer(Connection))) {
         CloseFlags |= QUIC_CLOSE_SILENT;
+    } else if (Flags & QUIC_CONNECTION_SHUTDOWN_FLAG_NO_DRAIN) {
+        CloseFlags |= QUIC_CLOSE_NO_DRAIN;
     }
 
     QuicConnCloseLocally(Connection, CloseFlags, ErrorCode, NULL);
@@ -506,9 +582,18 @@ QuicConnUninitialize(
     // Remove all entries in the binding's lookup tables so we don't get any
     // more packets queued.
     //
+    QuicCryptoClearInlineOffload(Connection);
     if (Connection->Paths[0].Binding != NULL) {
         QuicBindingRemoveConnection(Connection->Paths[0].Binding, Connection);
     }
+    if (Connection->DedicatedBinding != NULL) {
+        QUIC_BINDING* Binding = Connection->DedicatedBinding;
+        Connection->DedicatedBinding = NULL;
+        QuicLookupClearDedicatedConnection(&Binding->Lookup, Connection);
+        Binding->RefCount = 0; // Only ever referenced by this connection.
+        QuicBindingUninitialize(Binding);
+    }
+    QuicWorkerReleaseHandshake(Connection);
 
     //
     // Clean up the packet space first, to return any deferred received
@@ -528,6 +613,7 @@ QuicConnUninitialize(
     QuicCryptoUninitialize(&Connection->Crypto);
     QuicTimerWheelRemoveConnection(&Connection->Worker->TimerWheel, Connection);
     QuicOperationQueueClear(Connection->Worker, &Connection->OperQ);
+    QuicStreamRecvClearBatch(Connection);
 
     if (Connection->CloseReasonPhrase != NULL) {
         QUIC_FREE(Connection->CloseReasonPhrase);
@@ -665,6 +751,7 @@ QuicConnTraceRundownOper(
             ConnHandshakeComplete,
             "[conn][%p] Handshake complete",
             Connection);
+        QuicTraceProbe(handshake_complete, Connection, QuicConnIsServer(Connection));
     }
     if (Connection->State.HandleClosed) {
         QuicTraceEvent(
@@ -703,12 +790,20 @@ QuicConnIndicateEvent(
                     Connection->ClientContext,
                     Event);
             uint64_t EndTime = QuicTimeUs64();
+            Connection->Stats.Processing.CallbackTime += EndTime - StartTime;
+            QuicHistogramAddSample(
+                Connection->Histograms.CallbackTime,
+                EndTime - StartTime);
             if (EndTime - StartTime > QUIC_MAX_CALLBACK_TIME_WARNING) {
                 QuicTraceLogConnWarning(
                     ApiEventTooLong,
                     Connection,
                     "App took excessive time (%llu us) in callback.",
                     (EndTime - StartTime));
+                if (EndTime - StartTime >= QUIC_MAX_CALLBACK_TIME_ERROR) {
+                    (void)QuicFlightRecorderTrigger(
+                        "App extremely long time in connection callback");
+                }
                 QUIC_TEL_ASSERTMSG_ARGS(
                     EndTime - StartTime < QUIC_MAX_CALLBACK_TIME_ERROR,
                     "App extremely long time in connection callback",
@@ -734,6 +829,7 @@ QuicConnQueueOper(
     _In_ QUIC_OPERATION* Oper
     )
 {
+    QuicTraceProbe(oper_enqueue, Connection, Oper->Type);
     if (QuicOperationEnqueue(&Connection->OperQ, Oper)) {
         //
         // The connection needs to be queued on the worker because this was the
@@ -750,6 +846,7 @@ QuicConnQueueHighestPriorityOper(
     _In_ QUIC_OPERATION* Oper
     )
 {
+    QuicTraceProbe(oper_enqueue, Connection, Oper->Type);
     if (QuicOperationEnqueueFront(&Connection->OperQ, Oper)) {
         //
         // The connection needs to be queued on the worker because this was the
@@ -768,7 +865,6 @@ QuicConnUpdateRtt(
     )
 {
     BOOLEAN RttUpdated;
-    UNREFERENCED_PARAMETER(Connection);
 
     if (LatestRtt == 0) {
         //
@@ -777,6 +873,8 @@ QuicConnUpdateRtt(
         LatestRtt = 1;
     }
 
+    QuicHistogramAddSample(Connection->Histograms.Rtt, LatestRtt);
+
     Path->LatestRttSample = LatestRtt;
     if (LatestRtt < Path->MinRtt) {
         Path->MinRtt = LatestRtt;
@@ -842,6 +940,7 @@ QuicConnGenerateNewSourceCid(
     do {
         SourceCid =
             QuicCidNewRandomSource(
+                &Connection->Worker->Random,
                 Connection,
                 Connection->ServerID,
                 Connection->PartitionID,
@@ -1121,7 +1220,18 @@ QuicConnTimerSet(
     _In_ uint64_t Delay
     )
 {
-    uint64_t NewExpirationTime = QuicTimeUs64() + MS_TO_US(Delay);
+    QuicConnTimerSetUs(Connection, Type, MS_TO_US(Delay));
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnTimerSetUs(
+    _Inout_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_CONN_TIMER_TYPE Type,
+    _In_ uint64_t DelayUs
+    )
+{
+    uint64_t NewExpirationTime = QuicTimeUs64() + DelayUs;
 
     //
     // Find the current and new index in the timer array for this timer.
@@ -1177,6 +1287,24 @@ QuicConnTimerSet(
     }
 }
 
+//
+// Returns the time the timer is set to expire, or UINT64_MAX if it isn't set.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+uint64_t
+QuicConnTimerExpirationTime(
+    _In_ const QUIC_CONNECTION* Connection,
+    _In_ QUIC_CONN_TIMER_TYPE Type
+    )
+{
+    for (uint32_t i = 0; i < ARRAYSIZE(Connection->Timers); ++i) {
+        if (Connection->Timers[i].Type == Type) {
+            return Connection->Timers[i].ExpirationTime;
+        }
+    }
+    return UINT64_MAX;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicConnTimerCancel(
@@ -1282,7 +1410,10 @@ QuicConnTimerExpired(
             "LOSS_DETECTION",
             "KEEP_ALIVE",
             "IDLE",
+            "HIBERNATE",
+            "ADDR_FALLBACK",
             "SHUTDOWN",
+            "CORK",
             "INVALID"
         };
         QuicTraceLogConnVerbose(
@@ -1305,6 +1436,23 @@ QuicConnTimerExpired(
                 Connection,
                 QUIC_CONN_TIMER_PACING);
             FlushSendImmediate = TRUE;
+        } else if (Temp[j].Type == QUIC_CONN_TIMER_CORK) {
+            QuicTraceEvent(
+                ConnExecTimerOper,
+                "[conn][%p] Execute: %u",
+                Connection,
+                QUIC_CONN_TIMER_CORK);
+            Connection->Send.Corked = FALSE;
+            FlushSendImmediate = TRUE;
+        } else if (Temp[j].Type == QUIC_CONN_TIMER_KEEP_ALIVE) {
+            QuicTraceEvent(
+                ConnExecTimerOper,
+                "[conn][%p] Execute: %u",
+                Connection,
+                QUIC_CONN_TIMER_KEEP_ALIVE);
+            if (QuicConnProcessKeepAliveTimer(Connection, TimeNow)) {
+                FlushSendImmediate = TRUE;
+            }
         } else {
             QUIC_OPERATION* Oper;
             if ((Oper = QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_TIMER_EXPIRED)) != NULL) {
@@ -1362,6 +1510,49 @@ QuicConnIndicateShutdownBegin(
     (void)QuicConnIndicateEvent(Connection, &Event);
 }
 
+//
+// Seeds the new path with the metrics last measured on the remote network:
+// half the last congestion window (within limits) as the initial window, the
+// min RTT as the initial RTT estimate and the MTU as the first probe size.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnApplyCachedPathMetrics(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path
+    )
+{
+    QUIC_PATH_METRICS Metrics;
+    if (!QuicSessionPathMetricsGet(
+            Connection->Session, &Path->RemoteAddress, &Metrics)) {
+        return;
+    }
+
+    uint32_t InitialWindowPackets = (Metrics.CongestionWindow / 2) / Path->Mtu;
+    if (InitialWindowPackets > QUIC_PATH_METRICS_MAX_INITIAL_WINDOW_PACKETS) {
+        InitialWindowPackets = QUIC_PATH_METRICS_MAX_INITIAL_WINDOW_PACKETS;
+    }
+    if (InitialWindowPackets > Connection->Session->Settings.InitialWindowPackets) {
+        QuicCongestionControlSetInitialWindow(
+            &Connection->CongestionControl, InitialWindowPackets);
+    }
+
+    if (Metrics.MinRtt != 0 && Metrics.MinRtt < Path->SmoothedRtt) {
+        Path->SmoothedRtt = Metrics.MinRtt;
+        Path->RttVariance = Metrics.MinRtt / 2;
+    }
+
+    Path->MtuDiscovery.CachedMtu = Metrics.Mtu;
+
+    QuicTraceLogConnInfo(
+        PathMetricsApplied,
+        Connection,
+        "Applied cached path metrics, Cwnd=%u MinRtt=%u Mtu=%hu",
+        Metrics.CongestionWindow,
+        Metrics.MinRtt,
+        Metrics.Mtu);
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicConnOnShutdownComplete(
@@ -1380,6 +1571,29 @@ QuicConnOnShutdownComplete(
         Connection,
         Connection->State.ShutdownCompleteTimedOut);
 
+    if (Connection->State.Connected) {
+        QuicPerfCounterDecrement(QUIC_PERF_COUNTER_CONN_CONNECTED);
+    } else {
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_CONN_HANDSHAKE_FAIL);
+    }
+
+    if (!Connection->State.AppClosed &&
+        Connection->CloseErrorCode != QUIC_ERROR_NO_ERROR) {
+        (void)QuicFlightRecorderTrigger("Connection transport error");
+    }
+
+    if (!QuicConnIsServer(Connection) &&
+        Connection->Session != NULL &&
+        Connection->Session->Settings.PathMetricsCacheEnabled &&
+        Connection->Paths[0].GotFirstRttSample) {
+        QuicSessionPathMetricsSet(
+            Connection->Session,
+            &Connection->Paths[0].RemoteAddress,
+            QuicCongestionControlGetCongestionWindow(&Connection->CongestionControl),
+            Connection->Paths[0].MinRtt,
+            Connection->Paths[0].Mtu);
+    }
+
     if (Connection->State.ExternalOwner == FALSE) {
 
         //
@@ -1512,8 +1726,11 @@ QuicConnTryClose(
         if (!SilentClose) {
             //
             // Enter 'closing period' to wait for a (optional) connection close
-            // response.
+            // response. Without a drain, the shutdown completes as soon as the
+            // close frame is sent instead, and the timer only covers the frame
+            // never getting out.
             //
+            Connection->State.NoDrain = !!(Flags & QUIC_CLOSE_NO_DRAIN);
             uint32_t Pto =
                 US_TO_MS(QuicLossDetectionComputeProbeTimeout(
                     &Connection->LossDetection,
@@ -1722,6 +1939,92 @@ QuicConnOnQuicVersionSet(
     }
 }
 
+//
+// Picks the remote address, and any address of the other family to fall back
+// to, from the server name's resolution.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicConnSetResolvedAddress(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_ADDRESS_FAMILY Family,
+    _In_z_ const char* ServerName,
+    _In_ const QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+    QUIC_PATH* Path = &Connection->Paths[0];
+    const QUIC_ADDR* First = NULL;
+    const QUIC_ADDR* Second = NULL;
+
+    if (Family != AF_UNSPEC) {
+        for (uint32_t i = 0; i < ARRAYSIZE(Resolution->Addresses); ++i) {
+            if (QuicAddrGetFamily(&Resolution->Addresses[i]) == Family) {
+                First = &Resolution->Addresses[i];
+                break;
+            }
+        }
+
+    } else if (QuicAddrGetFamily(&Resolution->Addresses[0]) != AF_UNSPEC) {
+        First = &Resolution->Addresses[0];
+        if (QuicAddrGetFamily(&Resolution->Addresses[1]) != AF_UNSPEC &&
+            !Connection->State.LocalAddressSet &&
+            Connection->Session->Settings.HappyEyeballsDelayMs != 0) {
+            //
+            // Start with the family the last handshake with this server
+            // completed over (the resolver's preference if none), and keep
+            // the other one to fall back to.
+            //
+            Second = &Resolution->Addresses[1];
+            if (QuicSessionServerCacheGetFamily(Connection->Session, ServerName) ==
+                QuicAddrGetFamily(Second)) {
+                Second = First;
+                First = &Resolution->Addresses[1];
+            }
+        }
+    }
+
+    if (First == NULL) {
+        QuicTraceEvent(
+            ConnError,
+            "[conn][%p] ERROR, %s.",
+            Connection,
+            "No resolved address of the requested family");
+        return QUIC_STATUS_NOT_FOUND;
+    }
+
+    Path->RemoteAddress = *First;
+    if (Second != NULL) {
+        Connection->FallbackRemoteAddress = *Second;
+        Connection->State.FallbackAddressSet = TRUE;
+    }
+    Connection->State.RemoteAddressSet = TRUE;
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnResolveAddressComplete(
+    _In_opt_ void* Context,
+    _In_ QUIC_STATUS Status,
+    _In_ const QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+    QUIC_CONN_RESOLVE_CONTEXT* ResolveContext = (QUIC_CONN_RESOLVE_CONTEXT*)Context;
+    _Analysis_assume_(ResolveContext != NULL);
+    ResolveContext->Status = Status;
+    ResolveContext->Resolution = *Resolution;
+    QuicConnQueueOper(ResolveContext->Connection, ResolveContext->Oper);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicConnStartResolved(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_opt_z_ const char* ServerName,
+    _In_ uint16_t ServerPort // Host byte order
+    );
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicConnStart(
@@ -1732,63 +2035,220 @@ QuicConnStart(
     )
 {
     QUIC_STATUS Status;
-    QUIC_PATH* Path = &Connection->Paths[0];
+    QUIC_DATAPATH_RESOLUTION Resolution;
+    QUIC_CONN_RESOLVE_CONTEXT* ResolveContext = NULL;
     QUIC_DBG_ASSERT(!QuicConnIsServer(Connection));
 
-    if (Connection->State.ClosedLocally || Connection->State.Started) {
+    if (Connection->State.ClosedLocally ||
+        Connection->State.Started ||
+        Connection->State.ResolvingAddress) {
         if (ServerName != NULL) {
             QUIC_FREE(ServerName);
         }
         return QUIC_STATUS_INVALID_STATE;
     }
 
-    QUIC_TEL_ASSERT(Path->Binding == NULL);
+    QUIC_TEL_ASSERT(Connection->Paths[0].Binding == NULL);
 
-    if (!Connection->State.RemoteAddressSet) {
+    if (Connection->State.RemoteAddressSet) {
+        return QuicConnStartResolved(Connection, ServerName, ServerPort);
+    }
 
-        QUIC_DBG_ASSERT(ServerName != NULL);
-        QuicAddrSetFamily(&Path->RemoteAddress, Family);
+    QUIC_DBG_ASSERT(ServerName != NULL);
 
 #ifdef QUIC_COMPARTMENT_ID
-        BOOLEAN RevertCompartmentId = FALSE;
-        QUIC_COMPARTMENT_ID PrevCompartmentId = QuicCompartmentIdGetCurrent();
-        if (PrevCompartmentId != Connection->Session->CompartmentId) {
-            Status = QuicCompartmentIdSetCurrent(Connection->Session->CompartmentId);
-            if (QUIC_FAILED(Status)) {
-                QuicTraceEvent(
-                    ConnErrorStatus,
-                    "[conn][%p] ERROR, %u, %s.",
-                    Connection, Status,
-                    "Set current compartment Id");
-                goto Exit;
-            }
-            RevertCompartmentId = TRUE;
-        }
+    //
+    // Names may resolve differently in other compartments, which the library's
+    // cache doesn't distinguish.
+    //
+    BOOLEAN UseResolverCache =
+        Connection->Session->CompartmentId == QUIC_DEFAULT_COMPARTMENT_ID;
+#else
+    const BOOLEAN UseResolverCache = TRUE;
 #endif
 
-        //
-        // Resolve the server name to IP address.
-        //
-        Status =
-            QuicDataPathResolveAddress(
-                MsQuicLib.Datapath,
-                ServerName,
-                &Path->RemoteAddress);
+    if (UseResolverCache &&
+        QuicLibraryResolverCacheLookup(ServerName, &Resolution)) {
+        Status = QuicConnSetResolvedAddress(Connection, Family, ServerName, &Resolution);
+        if (QUIC_FAILED(Status)) {
+            goto Error;
+        }
+        return QuicConnStartResolved(Connection, ServerName, ServerPort);
+    }
+
+    //
+    // Resolve the server name without blocking the worker. The connection
+    // starts once the ADDR_RESOLVED operation is processed.
+    //
+    ResolveContext = QUIC_ALLOC_PAGED(sizeof(QUIC_CONN_RESOLVE_CONTEXT));
+    if (ResolveContext == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_CONN_RESOLVE_CONTEXT",
+            sizeof(QUIC_CONN_RESOLVE_CONTEXT));
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Error;
+    }
+
+    ResolveContext->Oper =
+        QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_ADDR_RESOLVED);
+    if (ResolveContext->Oper == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "address resolved operation",
+            0);
+        QUIC_FREE(ResolveContext);
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Error;
+    }
+
+    ResolveContext->Connection = Connection;
+    ResolveContext->Status = QUIC_STATUS_SUCCESS;
+    ResolveContext->Family = Family;
+    ResolveContext->ServerPort = ServerPort;
+    ResolveContext->UseResolverCache = UseResolverCache;
+    ResolveContext->ServerName = ServerName;
+    ResolveContext->Oper->ADDR_RESOLVED.Context = ResolveContext;
+    QuicConnAddRef(Connection, QUIC_CONN_REF_ADDR_RESOLUTION);
 
 #ifdef QUIC_COMPARTMENT_ID
-        if (RevertCompartmentId) {
-            (void)QuicCompartmentIdSetCurrent(PrevCompartmentId);
+    BOOLEAN RevertCompartmentId = FALSE;
+    QUIC_COMPARTMENT_ID PrevCompartmentId = QuicCompartmentIdGetCurrent();
+    if (PrevCompartmentId != Connection->Session->CompartmentId) {
+        Status = QuicCompartmentIdSetCurrent(Connection->Session->CompartmentId);
+        if (QUIC_FAILED(Status)) {
+            QuicTraceEvent(
+                ConnErrorStatus,
+                "[conn][%p] ERROR, %u, %s.",
+                Connection, Status,
+                "Set current compartment Id");
+            ServerName = NULL; // Freed with the context.
+            QuicOperationFree(Connection->Worker, ResolveContext->Oper);
+            goto Error;
         }
+        RevertCompartmentId = TRUE;
+    }
 #endif
 
-        if (QUIC_FAILED(Status)) {
-            goto Exit;
+    Status =
+        QuicDataPathResolveAddressAsync(
+            MsQuicLib.Datapath,
+            ServerName,
+            QuicConnResolveAddressComplete,
+            ResolveContext,
+            &Resolution);
+
+#ifdef QUIC_COMPARTMENT_ID
+    if (RevertCompartmentId) {
+        (void)QuicCompartmentIdSetCurrent(PrevCompartmentId);
+    }
+#endif
+
+    if (Status == QUIC_STATUS_PENDING) {
+        Connection->State.ResolvingAddress = TRUE;
+        return QUIC_STATUS_PENDING;
+    }
+
+    //
+    // Resolved (or failed) inline, so the operation won't be queued.
+    //
+    ResolveContext->ServerName = NULL;
+    QuicOperationFree(Connection->Worker, ResolveContext->Oper);
+
+    if (QUIC_FAILED(Status)) {
+        goto Error;
+    }
+
+    if (UseResolverCache) {
+        QuicLibraryResolverCacheInsert(ServerName, &Resolution);
+    }
+
+    Status = QuicConnSetResolvedAddress(Connection, Family, ServerName, &Resolution);
+    if (QUIC_FAILED(Status)) {
+        goto Error;
+    }
+
+    return QuicConnStartResolved(Connection, ServerName, ServerPort);
+
+Error:
+
+    if (ServerName != NULL) {
+        QUIC_FREE(ServerName);
+    }
+
+    QuicConnCloseLocally(
+        Connection,
+        QUIC_CLOSE_INTERNAL_SILENT | QUIC_CLOSE_QUIC_STATUS,
+        (uint64_t)Status,
+        NULL);
+
+    return Status;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnProcessAddrResolvedOperation(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_CONN_RESOLVE_CONTEXT* ResolveContext
+    )
+{
+    QUIC_STATUS Status = ResolveContext->Status;
+    QUIC_DBG_ASSERT(Connection->State.ResolvingAddress);
+    Connection->State.ResolvingAddress = FALSE;
+
+    if (Connection->State.ClosedLocally || Connection->State.ClosedRemotely) {
+        return;
+    }
+
+    if (QUIC_SUCCEEDED(Status)) {
+        if (ResolveContext->UseResolverCache) {
+            QuicLibraryResolverCacheInsert(
+                ResolveContext->ServerName,
+                &ResolveContext->Resolution);
         }
+        Status =
+            QuicConnSetResolvedAddress(
+                Connection,
+                ResolveContext->Family,
+                ResolveContext->ServerName,
+                &ResolveContext->Resolution);
+    }
 
-        Connection->State.RemoteAddressSet = TRUE;
+    if (QUIC_FAILED(Status)) {
+        QuicConnCloseLocally(
+            Connection,
+            QUIC_CLOSE_INTERNAL_SILENT | QUIC_CLOSE_QUIC_STATUS,
+            (uint64_t)Status,
+            NULL);
+        return;
     }
 
+    const char* ServerName = ResolveContext->ServerName;
+    ResolveContext->ServerName = NULL;
+    (void)QuicConnStartResolved(Connection, ServerName, ResolveContext->ServerPort);
+}
+
+//
+// Starts the connection once its remote address is known. Takes ownership of
+// ServerName.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicConnStartResolved(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_opt_z_ const char* ServerName,
+    _In_ uint16_t ServerPort // Host byte order
+    )
+{
+    QUIC_STATUS Status;
+    QUIC_PATH* Path = &Connection->Paths[0];
+
     QuicAddrSetPort(&Path->RemoteAddress, ServerPort);
+    if (Connection->State.FallbackAddressSet) {
+        QuicAddrSetPort(&Connection->FallbackRemoteAddress, ServerPort);
+    }
     QuicTraceEvent(
         ConnRemoteAddrAdded,
         "[conn][%p] New Remote IP: %!SOCKADDR!",
@@ -1796,6 +2256,10 @@ QuicConnStart(
         LOG_ADDR_LEN(Path->RemoteAddress),
         (const uint8_t*)&Path->RemoteAddress);
 
+    if (Connection->Session->Settings.PathMetricsCacheEnabled) {
+        QuicConnApplyCachedPathMetrics(Connection, Path);
+    }
+
     //
     // Get the binding for the current local & remote addresses.
     //
@@ -1819,6 +2283,7 @@ QuicConnStart(
     if (Connection->State.ShareBinding) {
         SourceCid =
             QuicCidNewRandomSource(
+                &Connection->Worker->Random,
                 Connection,
                 NULL,
                 Connection->PartitionID,
@@ -1874,6 +2339,13 @@ QuicConnStart(
         goto Exit;
     }
 
+    if (Connection->State.FallbackAddressSet) {
+        QuicConnTimerSet(
+            Connection,
+            QUIC_CONN_TIMER_ADDR_FALLBACK,
+            Connection->Session->Settings.HappyEyeballsDelayMs);
+    }
+
 Exit:
 
     if (ServerName != NULL) {
@@ -1926,6 +2398,26 @@ QuicConnRestart(
     QuicLossDetectionReset(&Connection->LossDetection);
     QuicCryptoReset(&Connection->Crypto, CompleteReset);
 }
+//
+// Compares the transport parameters put in a server resumption ticket.
+//
+BOOLEAN
+QuicConnResumptionTPEqual(
+    _In_ const QUIC_TRANSPORT_PARAMETERS* TP1,
+    _In_ const QUIC_TRANSPORT_PARAMETERS* TP2
+    )
+{
+    return
+        TP1->Flags == TP2->Flags &&
+        TP1->ActiveConnectionIdLimit == TP2->ActiveConnectionIdLimit &&
+        TP1->InitialMaxData == TP2->InitialMaxData &&
+        TP1->InitialMaxStreamDataBidiLocal == TP2->InitialMaxStreamDataBidiLocal &&
+        TP1->InitialMaxStreamDataBidiRemote == TP2->InitialMaxStreamDataBidiRemote &&
+        TP1->InitialMaxStreamDataUni == TP2->InitialMaxStreamDataUni &&
+        TP1->InitialMaxBidiStreams == TP2->InitialMaxBidiStreams &&
+        TP1->InitialMaxUniStreams == TP2->InitialMaxUniStreams;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicConnSendResumptionTicket(
@@ -1940,6 +2432,7 @@ QuicConnSendResumptionTicket(
     uint8_t* TicketBuffer = NULL;
     uint16_t AlpnLength = *(Connection->Crypto.TlsState.NegotiatedAlpn);
     const uint8_t* EncodedHSTP = NULL;
+    BOOLEAN FreeEncodedHSTP = FALSE;
 
     if (Connection->HandshakeTP == NULL) {
         Status = QUIC_STATUS_OUT_OF_MEMORY;
@@ -1956,14 +2449,38 @@ QuicConnSendResumptionTicket(
         QUIC_TP_FLAG_INITIAL_MAX_STRMS_BIDI |
         QUIC_TP_FLAG_INITIAL_MAX_STRMS_UNI);
 
-    EncodedHSTP =
-        QuicCryptoTlsEncodeTransportParameters(
-            Connection,
-            &HSTPCopy,
-            &EncodedTransportParametersLength);
-    if (EncodedHSTP == NULL) {
-        Status = QUIC_STATUS_OUT_OF_MEMORY;
-        goto Error;
+    //
+    // The ticket's transport parameters are the same for most connections, so
+    // the worker keeps the last encoding around to reuse.
+    //
+    QUIC_WORKER* Worker = Connection->Worker;
+    if (Worker->ResumptionTPEncoded != NULL &&
+        !Connection->State.TestTransportParameterSet &&
+        QuicConnResumptionTPEqual(&Worker->ResumptionTP, &HSTPCopy)) {
+        EncodedHSTP = Worker->ResumptionTPEncoded;
+        EncodedTransportParametersLength = Worker->ResumptionTPEncodedLength;
+
+    } else {
+        EncodedHSTP =
+            QuicCryptoTlsEncodeTransportParameters(
+                Connection,
+                &HSTPCopy,
+                &EncodedTransportParametersLength);
+        if (EncodedHSTP == NULL) {
+            Status = QUIC_STATUS_OUT_OF_MEMORY;
+            goto Error;
+        }
+
+        if (Connection->State.TestTransportParameterSet) {
+            FreeEncodedHSTP = TRUE;
+        } else {
+            if (Worker->ResumptionTPEncoded != NULL) {
+                QUIC_FREE(Worker->ResumptionTPEncoded);
+            }
+            Worker->ResumptionTP = HSTPCopy;
+            Worker->ResumptionTPEncoded = (uint8_t*)EncodedHSTP;
+            Worker->ResumptionTPEncodedLength = EncodedTransportParametersLength;
+        }
     }
 
     uint32_t TotalTicketLength =
@@ -2023,7 +2540,7 @@ Error:
         QUIC_FREE(TicketBuffer);
     }
 
-    if (EncodedHSTP != NULL) {
+    if (FreeEncodedHSTP) {
         QUIC_FREE(EncodedHSTP);
     }
 
@@ -2034,6 +2551,49 @@ Error:
     return Status;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnSendDeferredResumptionTicket(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    if (Connection->State.ClosedLocally || Connection->State.ClosedRemotely) {
+        Connection->DeferredTicketPending = FALSE;
+        return;
+    }
+
+    //
+    // The connection is only idle once it also has nothing left to send.
+    // Otherwise, this is tried again at the end of its next drain.
+    //
+    if (Connection->Send.SendFlags != 0 ||
+        !QuicListIsEmpty(&Connection->Send.SendStreams)) {
+        return;
+    }
+
+    Connection->DeferredTicketPending = FALSE;
+    const uint8_t* AppData = Connection->DeferredTicketAppData;
+    Connection->DeferredTicketAppData = NULL;
+
+    QUIC_STATUS Status =
+        QuicConnSendResumptionTicket(
+            Connection,
+            Connection->DeferredTicketAppDataLength,
+            AppData);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            ConnErrorStatus,
+            "[conn][%p] ERROR, %u, %s.",
+            Connection,
+            Status,
+            "Send deferred resumption ticket");
+    }
+
+    if (Connection->DeferredTicketFinal) {
+        Connection->State.ResumptionEnabled = FALSE;
+    }
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 BOOLEAN
 QuicConnRecvResumptionTicket(
@@ -2212,8 +2772,10 @@ QuicConnCleanupServerResumptionState(
         if (Crypto->Initialized) {
             QuicRecvBufferUninitialize(&Crypto->RecvBuffer);
             QuicRangeUninitialize(&Crypto->SparseAckRanges);
-            QUIC_FREE(Crypto->TlsState.Buffer);
-            Crypto->TlsState.Buffer = NULL;
+            if (Crypto->TlsState.Buffer != NULL) {
+                QUIC_FREE(Crypto->TlsState.Buffer);
+                Crypto->TlsState.Buffer = NULL;
+            }
             Crypto->Initialized = FALSE;
         }
     }
@@ -2246,10 +2808,11 @@ QuicConnInitializeCrypto(
         // Now that we are starting the connection, start the keep alive timer
         // if enabled.
         //
-        QuicConnTimerSet(
+        uint64_t TimeNow = QuicTimeUs64();
+        QuicConnSetKeepAliveTimer(
             Connection,
-            QUIC_CONN_TIMER_KEEP_ALIVE,
-            Connection->KeepAliveIntervalMs);
+            TimeNow,
+            TimeNow + MS_TO_US(Connection->KeepAliveIntervalMs));
     }
 
 Error:
@@ -2297,6 +2860,7 @@ QuicConnHandshakeConfigure(
         LocalTP.InitialMaxStreamDataBidiRemote = Connection->Session->Settings.StreamRecvWindowDefault;
         LocalTP.InitialMaxStreamDataUni = Connection->Session->Settings.StreamRecvWindowDefault;
         LocalTP.InitialMaxData = Connection->Send.MaxData;
+        Connection->Send.MaxDataSent = Connection->Send.MaxData;
         LocalTP.MaxUdpPayloadSize =
             MaxUdpPayloadSizeFromMTU(
                 QuicDataPathBindingGetLocalMtu(
@@ -2399,6 +2963,17 @@ QuicConnHandshakeConfigure(
             LocalTP.MaxDatagramFrameSize = QUIC_DEFAULT_MAX_DATAGRAM_LENGTH;
         }
 
+        LocalTP.Flags |= QUIC_TP_FLAG_MIN_ACK_DELAY;
+        LocalTP.MinAckDelay = QUIC_MIN_ACK_DELAY_US;
+
+        if (Connection->State.MultipathEnabled) {
+            LocalTP.Flags |= QUIC_TP_FLAG_ENABLE_MULTIPATH;
+        }
+
+        if (Connection->Session->Settings.IntegrityOnlyEnabled) {
+            LocalTP.Flags |= QUIC_TP_FLAG_INTEGRITY_ONLY;
+        }
+
         //
         // Persist the transport parameters used during handshake for resumption.
         // (if resumption is enabled)
@@ -2455,6 +3030,7 @@ QuicConnHandshakeConfigure(
         LocalTP.InitialMaxStreamDataBidiRemote = Connection->Session->Settings.StreamRecvWindowDefault;
         LocalTP.InitialMaxStreamDataUni = Connection->Session->Settings.StreamRecvWindowDefault;
         LocalTP.InitialMaxData = Connection->Send.MaxData;
+        Connection->Send.MaxDataSent = Connection->Send.MaxData;
         LocalTP.MaxUdpPayloadSize =
             MaxUdpPayloadSizeFromMTU(
                 QuicDataPathBindingGetLocalMtu(
@@ -2499,6 +3075,17 @@ QuicConnHandshakeConfigure(
             LocalTP.MaxDatagramFrameSize = QUIC_DEFAULT_MAX_DATAGRAM_LENGTH;
         }
 
+        LocalTP.Flags |= QUIC_TP_FLAG_MIN_ACK_DELAY;
+        LocalTP.MinAckDelay = QUIC_MIN_ACK_DELAY_US;
+
+        if (Connection->State.MultipathEnabled) {
+            LocalTP.Flags |= QUIC_TP_FLAG_ENABLE_MULTIPATH;
+        }
+
+        if (Connection->Session->Settings.IntegrityOnlyEnabled) {
+            LocalTP.Flags |= QUIC_TP_FLAG_INTEGRITY_ONLY;
+        }
+
         if (Connection->Stats.QuicVersion != QUIC_VERSION_DRAFT_27) {
             LocalTP.Flags |= QUIC_TP_FLAG_INITIAL_SOURCE_CONNECTION_ID;
             LocalTP.InitialSourceConnectionIDLength = SourceCid->CID.Length;
@@ -2773,6 +3360,27 @@ QuicConnProcessPeerTransportParameters(
 
     QuicDatagramOnSendStateChanged(&Connection->Datagram);
 
+    if (!FromCache &&
+        Connection->State.MultipathEnabled &&
+        Connection->PeerTransportParams.Flags & QUIC_TP_FLAG_ENABLE_MULTIPATH) {
+        QuicTraceLogConnInfo(
+            MultipathNegotiated,
+            Connection,
+            "Multipath negotiated");
+        Connection->State.MultipathNegotiated = TRUE;
+    }
+
+    if (!FromCache &&
+        Connection->State.EncryptionEnabled &&
+        Connection->Session->Settings.IntegrityOnlyEnabled &&
+        Connection->PeerTransportParams.Flags & QUIC_TP_FLAG_INTEGRITY_ONLY) {
+        QuicTraceLogConnInfo(
+            IntegrityOnlyNegotiated,
+            Connection,
+            "Integrity-only 1-RTT protection negotiated");
+        Connection->State.IntegrityOnly = TRUE;
+    }
+
     return;
 
 Error:
@@ -2780,6 +3388,93 @@ Error:
     QuicConnTransportError(Connection, QUIC_ERROR_TRANSPORT_PARAMETER_ERROR);
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicConnReleaseRecvDatagrams(
+    _In_ QUIC_RECV_DATAGRAM* DatagramChain
+    )
+{
+    QUIC_RECV_DATAGRAM* ReleaseChain = NULL;
+    QUIC_RECV_DATAGRAM** ReleaseChainTail = &ReleaseChain;
+
+    while (DatagramChain != NULL) {
+        QUIC_RECV_DATAGRAM* Datagram = DatagramChain;
+        DatagramChain = DatagramChain->Next;
+
+        QUIC_RECV_PACKET* Packet =
+            QuicDataPathRecvDatagramToRecvPacket(Datagram);
+        if (Packet->StreamRefCount != 0) {
+            Datagram->Next = NULL;
+            Packet->ReleasedToStreams = TRUE;
+        } else {
+            *ReleaseChainTail = Datagram;
+            ReleaseChainTail = &Datagram->Next;
+        }
+    }
+    *ReleaseChainTail = NULL;
+
+    if (ReleaseChain != NULL) {
+        QuicDataPathBindingReturnRecvDatagrams(ReleaseChain);
+    }
+}
+
+//
+// Decides whether a datagram can be queued on the connection, based only on
+// its unprotected header and the current queue lengths. Returns NULL if it
+// can, or else the reason for dropping it. Called with the receive queue lock
+// held.
+//
+// Under load, undecryptable long header packets are dropped first, then
+// everything else except handshake packets and small short header packets
+// (which likely only carry ACKs, and so keep the peer from retransmitting).
+// Duplicates can't be told apart before decryption.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+const char*
+QuicConnRecvQueueDropReason(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ const QUIC_RECV_DATAGRAM* Datagram
+    )
+{
+    const QUIC_RECV_PACKET* Packet =
+        QuicDataPathRecvDatagramToRecvPacket(Datagram);
+    BOOLEAN Priority;
+
+    if (!Packet->IsShortHeader) {
+        if (Connection->State.HandshakeConfirmed) {
+            //
+            // All the long header keys are discarded once the handshake is
+            // confirmed (read racily here, which only affects the heuristic).
+            //
+            if (Connection->ReceiveQueueCount >= QUIC_RECEIVE_QUEUE_OLD_EPOCH_LIMIT) {
+                Connection->Stats.Recv.QueueOldEpochDrops++;
+                return "Old epoch packet dropped under load";
+            }
+            Priority = FALSE;
+        } else {
+            Priority = TRUE;
+        }
+    } else {
+        Priority = Datagram->BufferLength <= QUIC_RECEIVE_QUEUE_SMALL_DATAGRAM;
+    }
+
+    if (Priority) {
+        if (Connection->ReceiveQueueCount >=
+                QUIC_MAX_RECEIVE_QUEUE_COUNT + QUIC_RECEIVE_QUEUE_PRIORITY_RESERVE) {
+            Connection->Stats.Recv.QueueFullDrops++;
+            return "Max queue limit reached";
+        }
+    } else if (Connection->ReceiveQueueCount >= QUIC_MAX_RECEIVE_QUEUE_COUNT) {
+        Connection->Stats.Recv.QueueFullDrops++;
+        return "Max queue limit reached";
+    } else if (Connection->Worker->ReceiveQueueCount >= QUIC_MAX_WORKER_RECEIVE_QUEUE_COUNT) {
+        Connection->Stats.Recv.QueueWorkerLimitDrops++;
+        return "Max worker queue limit reached";
+    }
+
+    return NULL;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
 QuicConnQueueRecvDatagrams(
@@ -2788,45 +3483,48 @@ QuicConnQueueRecvDatagrams(
     _In_ uint32_t DatagramChainLength
     )
 {
-    QUIC_RECV_DATAGRAM** DatagramChainTail = &DatagramChain->Next;
-    DatagramChain->QueuedOnConnection = TRUE;
-    QuicDataPathRecvDatagramToRecvPacket(DatagramChain)->AssignedToConnection = TRUE;
-    while (*DatagramChainTail != NULL) {
-        (*DatagramChainTail)->QueuedOnConnection = TRUE;
-        QuicDataPathRecvDatagramToRecvPacket(*DatagramChainTail)->AssignedToConnection = TRUE;
-        DatagramChainTail = &((*DatagramChainTail)->Next);
-    }
-
     QuicTraceLogConnVerbose(
         QueueDatagrams,
         Connection,
         "Queuing %u UDP datagrams",
         DatagramChainLength);
 
-    BOOLEAN QueueOperation;
+    QUIC_RECV_DATAGRAM* DropChain = NULL;
+    QUIC_RECV_DATAGRAM** DropChainTail = &DropChain;
+    uint32_t QueuedCount = 0;
+
     QuicDispatchLockAcquire(&Connection->ReceiveQueueLock);
-    if (Connection->ReceiveQueueCount >= QUIC_MAX_RECEIVE_QUEUE_COUNT) {
-        QueueOperation = FALSE;
-    } else {
-        *Connection->ReceiveQueueTail = DatagramChain;
-        Connection->ReceiveQueueTail = DatagramChainTail;
-        DatagramChain = NULL;
-        QueueOperation = (Connection->ReceiveQueueCount == 0);
-        Connection->ReceiveQueueCount += DatagramChainLength;
+    BOOLEAN QueueWasEmpty = Connection->ReceiveQueueCount == 0;
+    while (DatagramChain != NULL) {
+        QUIC_RECV_DATAGRAM* Datagram = DatagramChain;
+        DatagramChain = Datagram->Next;
+        Datagram->Next = NULL;
+        QuicDataPathRecvDatagramToRecvPacket(Datagram)->AssignedToConnection = TRUE;
+
+        const char* DropReason = QuicConnRecvQueueDropReason(Connection, Datagram);
+        if (DropReason == NULL) {
+            Datagram->QueuedOnConnection = TRUE;
+            *Connection->ReceiveQueueTail = Datagram;
+            Connection->ReceiveQueueTail = &Datagram->Next;
+            Connection->ReceiveQueueCount++;
+            QueuedCount++;
+        } else {
+            QuicPacketLogDrop(
+                Connection, QuicDataPathRecvDatagramToRecvPacket(Datagram), DropReason);
+            *DropChainTail = Datagram;
+            DropChainTail = &Datagram->Next;
+        }
+    }
+    if (QueuedCount != 0) {
+        InterlockedExchangeAdd64(&Connection->Worker->ReceiveQueueCount, QueuedCount);
     }
     QuicDispatchLockRelease(&Connection->ReceiveQueueLock);
 
-    if (DatagramChain != NULL) {
-        QUIC_RECV_DATAGRAM* Datagram = DatagramChain;
-        do {
-            Datagram->QueuedOnConnection = FALSE;
-            QuicPacketLogDrop(Connection, QuicDataPathRecvDatagramToRecvPacket(Datagram), "Max queue limit reached");
-        } while ((Datagram = Datagram->Next) != NULL);
-        QuicDataPathBindingReturnRecvDatagrams(DatagramChain);
-        return;
+    if (DropChain != NULL) {
+        QuicDataPathBindingReturnRecvDatagrams(DropChain);
     }
 
-    if (QueueOperation) {
+    if (QueueWasEmpty && QueuedCount != 0) {
         QUIC_OPERATION* ConnOper =
             QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_FLUSH_RECV);
         if (ConnOper != NULL) {
@@ -3097,14 +3795,16 @@ QuicConnRecvRetry(
     const uint8_t* Token = (Packet->Buffer + Packet->HeaderLength);
     uint16_t TokenLength = Packet->BufferLength - (Packet->HeaderLength + QUIC_RETRY_INTEGRITY_TAG_LENGTH_V1);
 
-    QuicPacketLogHeader(
-        Connection,
-        TRUE,
-        0,
-        0,
-        Packet->BufferLength,
-        Packet->Buffer,
-        0);
+    if (QuicTraceLogVerboseEnabled() && Connection->TraceSampled) {
+        QuicPacketLogHeader(
+            Connection,
+            TRUE,
+            0,
+            0,
+            Packet->BufferLength,
+            Packet->Buffer,
+            0);
+    }
 
     QUIC_DBG_ASSERT(!QuicListIsEmpty(&Connection->DestCids));
     const QUIC_CID_QUIC_LIST_ENTRY* DestCid =
@@ -3117,7 +3817,7 @@ QuicConnRecvRetry(
 
     if (QUIC_FAILED(
         QuicPacketGenerateRetryIntegrity(
-            VersionInfo->RetryIntegritySecret,
+            VersionInfo,
             DestCid->CID.Length,
             DestCid->CID.Data,
             Packet->BufferLength - QUIC_RETRY_INTEGRITY_TAG_LENGTH_V1,
@@ -3202,6 +3902,32 @@ QuicConnRecvRetry(
     Packet->CompletelyValid = TRUE;
 }
 
+//
+// The number of datagrams that may be deferred per packet number space, while
+// waiting for its key.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+uint16_t
+QuicConnMaxDeferredDatagrams(
+    _In_ const QUIC_CONNECTION* Connection
+    )
+{
+    //
+    // Server connections don't have a session until the client's first flight
+    // is processed.
+    //
+    const QUIC_SETTINGS* Settings =
+        Connection->Session != NULL ?
+            &Connection->Session->Settings : &MsQuicLib.Settings;
+    uint32_t Max = 2 * Settings->InitialWindowPackets;
+    if (Max < QUIC_MAX_PENDING_DATAGRAMS) {
+        Max = QUIC_MAX_PENDING_DATAGRAMS;
+    } else if (Max > QUIC_MAX_PENDING_DATAGRAMS_LIMIT) {
+        Max = QUIC_MAX_PENDING_DATAGRAMS_LIMIT;
+    }
+    return (uint16_t)Max;
+}
+
 //
 // Tries to get the requested decryption key or defers the packet for later
 // processing.
@@ -3233,7 +3959,7 @@ QuicConnGetKeyOrDeferDatagram(
         } else {
             QUIC_ENCRYPT_LEVEL EncryptLevel = QuicKeyTypeToEncryptLevel(Packet->KeyType);
             QUIC_PACKET_SPACE* Packets = Connection->Packets[EncryptLevel];
-            if (Packets->DeferredDatagramsCount == QUIC_MAX_PENDING_DATAGRAMS) {
+            if (Packets->DeferredDatagramsCount >= QuicConnMaxDeferredDatagrams(Connection)) {
                 //
                 // We already have too many packets queued up. Just drop this
                 // one.
@@ -3254,12 +3980,11 @@ QuicConnGetKeyOrDeferDatagram(
                 // Add it to the list of pending packets that are waiting on a
                 // key to decrypt with.
                 //
-                QUIC_RECV_DATAGRAM** Tail = &Packets->DeferredDatagrams;
-                while (*Tail != NULL) {
-                    Tail = &((*Tail)->Next);
-                }
-                *Tail = QuicDataPathRecvPacketToRecvDatagram(Packet);
-                (*Tail)->Next = NULL;
+                QUIC_RECV_DATAGRAM* Datagram =
+                    QuicDataPathRecvPacketToRecvDatagram(Packet);
+                Datagram->Next = NULL;
+                *Packets->DeferredDatagramsTail = Datagram;
+                Packets->DeferredDatagramsTail = &Datagram->Next;
             }
         }
 
@@ -3580,7 +4305,7 @@ QuicConnRecvPrepareDecrypt(
             // The packet doesn't match our key phase, and we're not awaiting
             // confirmation of a key phase change, or this is a newer packet
             // number, so most likely using a new key phase. Update the keys
-            // and try it out.
+            // (normally already generated in the background) and try it out.
             //
 
             QuicTraceLogConnVerbose(
@@ -3602,62 +4327,55 @@ QuicConnRecvPrepareDecrypt(
 }
 
 //
-// Decrypts the packet's payload and authenticates the whole packet. On
-// successful authentication of the packet, does some final processing of the
-// packet header (key and CID updates). Returns TRUE if the packet should
-// continue to be processed further.
+// Copies the end of the packet, which holds the token if the packet is a
+// stateless reset, as a failed decryption trashes it. Returns FALSE if the
+// packet can't be a stateless reset.
 //
 _IRQL_requires_max_(PASSIVE_LEVEL)
 BOOLEAN
-QuicConnRecvDecryptAndAuthenticate(
-    _In_ QUIC_CONNECTION* Connection,
-    _In_ QUIC_PATH* Path,
-    _In_ QUIC_RECV_PACKET* Packet
+QuicConnRecvSaveResetToken(
+    _In_ const QUIC_CONNECTION* Connection,
+    _In_ const QUIC_RECV_PACKET* Packet,
+    _Out_writes_bytes_(QUIC_STATELESS_RESET_TOKEN_LENGTH)
+        uint8_t* ResetToken
     )
 {
-    QUIC_DBG_ASSERT(Packet->BufferLength >= Packet->HeaderLength + Packet->PayloadLength);
-
-    const uint8_t* Payload = Packet->Buffer + Packet->HeaderLength;
-
-    //
-    // We need to copy the end of the packet before trying decryption, as a
-    // failed decryption trashes the stateless reset token.
-    //
-    BOOLEAN CanCheckForStatelessReset = FALSE;
-    uint8_t PacketResetToken[QUIC_STATELESS_RESET_TOKEN_LENGTH];
-    if (!QuicConnIsServer(Connection) &&
-        Packet->IsShortHeader &&
-        Packet->HeaderLength + Packet->PayloadLength >= QUIC_MIN_STATELESS_RESET_PACKET_LENGTH) {
-        CanCheckForStatelessReset = TRUE;
-        QuicCopyMemory(
-            PacketResetToken,
-            Payload + Packet->PayloadLength - QUIC_STATELESS_RESET_TOKEN_LENGTH,
-            QUIC_STATELESS_RESET_TOKEN_LENGTH);
+    if (QuicConnIsServer(Connection) ||
+        !Packet->IsShortHeader ||
+        Packet->HeaderLength + Packet->PayloadLength < QUIC_MIN_STATELESS_RESET_PACKET_LENGTH) {
+        return FALSE;
     }
 
-    uint8_t Iv[QUIC_IV_LENGTH];
-    QuicCryptoCombineIvAndPacketNumber(
-        Connection->Crypto.TlsState.ReadKeys[Packet->KeyType]->Iv,
-        (uint8_t*) &Packet->PacketNumber,
-        Iv);
+    QuicCopyMemory(
+        ResetToken,
+        Packet->Buffer + Packet->HeaderLength + Packet->PayloadLength - QUIC_STATELESS_RESET_TOKEN_LENGTH,
+        QUIC_STATELESS_RESET_TOKEN_LENGTH);
+    return TRUE;
+}
 
-    //
-    // Decrypt the payload with the appropriate key.
-    //
-    if (Connection->State.EncryptionEnabled &&
-        QUIC_FAILED(
-        QuicDecrypt(
-            Connection->Crypto.TlsState.ReadKeys[Packet->KeyType]->PacketKey,
-            Iv,
-            Packet->HeaderLength,   // HeaderLength
-            Packet->Buffer,         // Header
-            Packet->PayloadLength,  // BufferLength
-            (uint8_t*)Payload))) {  // Buffer
+//
+// Authenticates the packet, given the result of decrypting its payload, and on
+// success does some final processing of the packet header (key and CID
+// updates). ResetToken is the token saved by QuicConnRecvSaveResetToken, if
+// any. Returns TRUE if the packet should continue to be processed further.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicConnRecvDecryptComplete(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ QUIC_RECV_PACKET* Packet,
+    _In_ QUIC_STATUS DecryptStatus,
+    _In_reads_opt_(QUIC_STATELESS_RESET_TOKEN_LENGTH)
+        const uint8_t* ResetToken
+    )
+{
+    if (QUIC_FAILED(DecryptStatus)) {
 
         //
         // Check for a stateless reset packet.
         //
-        if (CanCheckForStatelessReset) {
+        if (ResetToken != NULL) {
             for (QUIC_LIST_ENTRY* Entry = Connection->DestCids.Flink;
                     Entry != &Connection->DestCids;
                     Entry = Entry->Flink) {
@@ -3673,12 +4391,12 @@ QuicConnRecvDecryptAndAuthenticate(
                 if (DestCid->CID.HasResetToken &&
                     memcmp(
                         DestCid->ResetToken,
-                        PacketResetToken,
+                        ResetToken,
                         QUIC_STATELESS_RESET_TOKEN_LENGTH) == 0) {
                     QuicTraceLogVerbose(
                         PacketRxStatelessReset,
                         "[S][RX][-] SR %s",
-                        QuicCidBufToStr(PacketResetToken, QUIC_STATELESS_RESET_TOKEN_LENGTH).Buffer);
+                        QuicCidBufToStr(ResetToken, QUIC_STATELESS_RESET_TOKEN_LENGTH).Buffer);
                     QuicTraceLogConnInfo(
                         RecvStatelessReset,
                         Connection,
@@ -3693,7 +4411,7 @@ QuicConnRecvDecryptAndAuthenticate(
             }
         }
 
-        if (QuicTraceLogVerboseEnabled()) {
+        if (QuicTraceLogVerboseEnabled() && Connection->TraceSampled) {
             QuicPacketLogHeader(
                 Connection,
                 TRUE,
@@ -3704,6 +4422,7 @@ QuicConnRecvDecryptAndAuthenticate(
                 Connection->Stats.QuicVersion);
         }
         Connection->Stats.Recv.DecryptionFailures++;
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_PKTS_DECRYPTION_FAIL);
         QuicPacketLogDrop(Connection, Packet, "Decryption failure");
 
         return FALSE;
@@ -3749,7 +4468,7 @@ QuicConnRecvDecryptAndAuthenticate(
             &Connection->Packets[EncryptLevel]->AckTracker,
             Packet->PacketNumber)) {
 
-        if (QuicTraceLogVerboseEnabled()) {
+        if (QuicTraceLogVerboseEnabled() && Connection->TraceSampled) {
             QuicPacketLogHeader(
                 Connection,
                 TRUE,
@@ -3768,7 +4487,14 @@ QuicConnRecvDecryptAndAuthenticate(
     // Log the received packet header and payload now that it's decrypted.
     //
 
-    if (QuicTraceLogVerboseEnabled()) {
+    QuicTraceProbe(
+        packet_recv,
+        Connection,
+        Packet->PacketNumber,
+        Packet->HeaderLength + Packet->PayloadLength,
+        Packet->KeyType);
+
+    if (QuicTraceLogVerboseEnabled() && Connection->TraceSampled) {
         QuicPacketLogHeader(
             Connection,
             TRUE,
@@ -3786,13 +4512,15 @@ QuicConnRecvDecryptAndAuthenticate(
             Packet->HeaderLength);
     }
 
-    QuicTraceEvent(
-        ConnPacketRecv,
-        "[conn][%p][RX][%llu] %c (%hd bytes)",
-        Connection,
-        Packet->PacketNumber,
-        Packet->IsShortHeader ? QUIC_TRACE_PACKET_ONE_RTT : (Packet->LH->Type + 1),
-        Packet->HeaderLength + Packet->PayloadLength);
+    if (Connection->TraceSampled) {
+        QuicTraceEvent(
+            ConnPacketRecv,
+            "[conn][%p][RX][%llu] %c (%hd bytes)",
+            Connection,
+            Packet->PacketNumber,
+            Packet->IsShortHeader ? QUIC_TRACE_PACKET_ONE_RTT : (Packet->LH->Type + 1),
+            Packet->HeaderLength + Packet->PayloadLength);
+    }
 
     //
     // Process any connection ID updates as necessary.
@@ -3867,6 +4595,69 @@ QuicConnRecvDecryptAndAuthenticate(
     return TRUE;
 }
 
+//
+// Decrypts the packet's payload and authenticates the whole packet. Returns
+// TRUE if the packet should continue to be processed further.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicConnRecvDecryptAndAuthenticate(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ QUIC_RECV_PACKET* Packet
+    )
+{
+    QUIC_DBG_ASSERT(Packet->BufferLength >= Packet->HeaderLength + Packet->PayloadLength);
+
+    uint8_t PacketResetToken[QUIC_STATELESS_RESET_TOKEN_LENGTH];
+    BOOLEAN CanCheckForStatelessReset =
+        QuicConnRecvSaveResetToken(Connection, Packet, PacketResetToken);
+
+    //
+    // Decrypt the payload with the appropriate key.
+    //
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    if (Connection->State.EncryptionEnabled) {
+        uint8_t Iv[QUIC_IV_LENGTH];
+        QuicCryptoCombineIvAndPacketNumber(
+            Connection->Crypto.TlsState.ReadKeys[Packet->KeyType]->Iv,
+            (uint8_t*) &Packet->PacketNumber,
+            Iv);
+
+        if (Connection->State.IntegrityOnly && Packet->IsShortHeader) {
+            //
+            // Only the tag is verified, over the header and plain text payload.
+            //
+            uint16_t PlainTextLength = Packet->PayloadLength - QUIC_ENCRYPTION_OVERHEAD;
+            Status =
+                QuicDecrypt(
+                    Connection->Crypto.TlsState.ReadKeys[Packet->KeyType]->PacketKey,
+                    Iv,
+                    Packet->HeaderLength + PlainTextLength,
+                    Packet->Buffer,
+                    QUIC_ENCRYPTION_OVERHEAD,
+                    (uint8_t*)Packet->Buffer + Packet->HeaderLength + PlainTextLength);
+        } else {
+            Status =
+                QuicDecrypt(
+                    Connection->Crypto.TlsState.ReadKeys[Packet->KeyType]->PacketKey,
+                    Iv,
+                    Packet->HeaderLength,   // HeaderLength
+                    Packet->Buffer,         // Header
+                    Packet->PayloadLength,  // BufferLength
+                    (uint8_t*)Packet->Buffer + Packet->HeaderLength); // Buffer
+        }
+    }
+
+    return
+        QuicConnRecvDecryptComplete(
+            Connection,
+            Path,
+            Packet,
+            Status,
+            CanCheckForStatelessReset ? PacketResetToken : NULL);
+}
+
 //
 // Reads the frames in a packet, and if everything is successful marks the
 // packet for acknowledgement and returns TRUE.
@@ -3880,6 +4671,7 @@ QuicConnRecvFrames(
     )
 {
     BOOLEAN AckPacketImmediately = FALSE; // Allows skipping delayed ACK timer.
+    BOOLEAN AckImmediatelyRequested = FALSE; // Peer sent an IMMEDIATE_ACK frame.
     BOOLEAN UpdatedFlowControl = FALSE;
     QUIC_ENCRYPT_LEVEL EncryptLevel = QuicKeyTypeToEncryptLevel(Packet->KeyType);
     BOOLEAN Closed = Connection->State.ClosedLocally || Connection->State.ClosedRemotely;
@@ -3892,8 +4684,18 @@ QuicConnRecvFrames(
         //
         // Read the frame type.
         //
-        QUIC_FRAME_TYPE FrameType = Payload[Offset];
-        if (!QUIC_FRAME_IS_KNOWN(FrameType)) {
+        QUIC_VAR_INT FrameTypeValue;
+        if (!QuicVarIntDecode(PayloadLength, Payload, &Offset, &FrameTypeValue)) {
+            QuicTraceEvent(
+                ConnError,
+                "[conn][%p] ERROR, %s.",
+                Connection,
+                "Frame type decode failure");
+            QuicConnTransportError(Connection, QUIC_ERROR_FRAME_ENCODING_ERROR);
+            return FALSE;
+        }
+
+        if (!QUIC_FRAME_IS_KNOWN(FrameTypeValue)) {
             QuicTraceEvent(
                 ConnError,
                 "[conn][%p] ERROR, %s.",
@@ -3903,6 +4705,8 @@ QuicConnRecvFrames(
             return FALSE;
         }
 
+        QUIC_FRAME_TYPE FrameType = (QUIC_FRAME_TYPE)FrameTypeValue;
+
         //
         // Validate allowable frames based on the packet type.
         //
@@ -3955,8 +4759,6 @@ QuicConnRecvFrames(
             }
         }
 
-        Offset += sizeof(uint8_t);
-
         //
         // Process the frame based on the frame type.
         //
@@ -3991,6 +4793,7 @@ QuicConnRecvFrames(
                     PayloadLength,
                     Payload,
                     &Offset,
+                    QuicDataPathRecvPacketToRecvDatagram(Packet)->RecvTime,
                     &InvalidAckFrame)) {
                 if (InvalidAckFrame) {
                     QuicTraceEvent(
@@ -4099,8 +4902,28 @@ QuicConnRecvFrames(
                 break; // Ignore frame if we are closed.
             }
 
+            //
+            // STREAM frames are fully decoded here, once, instead of peeking
+            // the ID now and decoding the whole frame again later.
+            //
             uint64_t StreamId;
-            if (!QuicStreamFramePeekID(
+            QUIC_STREAM_EX StreamFrame;
+            BOOLEAN IsStreamFrame =
+                FrameType >= QUIC_FRAME_STREAM && FrameType <= QUIC_FRAME_STREAM_7;
+            if (IsStreamFrame) {
+                if (!QuicStreamFrameDecode(
+                        FrameType, PayloadLength, Payload, &Offset, &StreamFrame)) {
+                    QuicTraceEvent(
+                        ConnError,
+                        "[conn][%p] ERROR, %s.",
+                        Connection,
+                        "Decoding STREAM frame");
+                    QuicConnTransportError(Connection, QUIC_ERROR_FRAME_ENCODING_ERROR);
+                    return FALSE;
+                }
+                StreamId = StreamFrame.StreamID;
+
+            } else if (!QuicStreamFramePeekID(
                     PayloadLength, Payload, Offset, &StreamId)) {
                 QuicTraceEvent(
                     ConnError,
@@ -4149,14 +4972,19 @@ QuicConnRecvFrames(
 
             if (Stream) {
                 QUIC_STATUS Status =
-                    QuicStreamRecv(
-                        Stream,
-                        Packet->EncryptedWith0Rtt,
-                        FrameType,
-                        PayloadLength,
-                        Payload,
-                        &Offset,
-                        &UpdatedFlowControl);
+                    IsStreamFrame ?
+                        QuicStreamProcessStreamFrame(
+                            Stream,
+                            Packet,
+                            &StreamFrame) :
+                        QuicStreamRecv(
+                            Stream,
+                            Packet,
+                            FrameType,
+                            PayloadLength,
+                            Payload,
+                            &Offset,
+                            &UpdatedFlowControl);
                 if (Status == QUIC_STATUS_OUT_OF_MEMORY) {
                     return FALSE;
                 } else if (QUIC_FAILED(Status)) {
@@ -4189,7 +5017,8 @@ QuicConnRecvFrames(
                     Connection,
                     "Ignoring frame (%hhu) for already closed stream id = %llu",
                     FrameType, StreamId);
-                if (!QuicStreamFrameSkip(
+                if (!IsStreamFrame &&
+                    !QuicStreamFrameSkip(
                         FrameType, PayloadLength, Payload, &Offset)) {
                     QuicTraceEvent(
                         ConnError,
@@ -4327,6 +5156,14 @@ QuicConnRecvFrames(
                 Frame.StreamLimit);
             AckPacketImmediately = TRUE;
 
+            QuicStreamSetAutoTuneMaxCount(
+                &Connection->Streams,
+                (QuicConnIsServer(Connection) ?
+                    STREAM_ID_FLAG_IS_CLIENT : STREAM_ID_FLAG_IS_SERVER) |
+                (Frame.BidirectionalStreams ?
+                    STREAM_ID_FLAG_IS_BI_DIR : STREAM_ID_FLAG_IS_UNI_DIR),
+                TRUE);
+
             QUIC_CONNECTION_EVENT Event;
             Event.Type = QUIC_CONNECTION_EVENT_PEER_NEEDS_STREAMS; // TODO - Uni/Bidi
             QuicTraceLogConnVerbose(
@@ -4615,23 +5452,77 @@ QuicConnRecvFrames(
             break;
         }
 
-        default:
-            //
-            // No default case necessary, as we have already validated the frame
-            // type initially, but included for clang the compiler.
-            //
-            break;
-        }
-    }
-
-Done:
+        case QUIC_FRAME_ACK_FREQUENCY: { // Always accept the frame, because we always advertise support.
+            QUIC_ACK_FREQUENCY_EX Frame;
+            if (!QuicAckFrequencyFrameDecode(PayloadLength, Payload, &Offset, &Frame)) {
+                QuicTraceEvent(
+                    ConnError,
+                    "[conn][%p] ERROR, %s.",
+                    Connection,
+                    "Decoding ACK_FREQUENCY frame");
+                QuicConnTransportError(Connection, QUIC_ERROR_FRAME_ENCODING_ERROR);
+                return FALSE;
+            }
 
-    if (!QuicConnIsServer(Connection) &&
-        !Connection->State.GotFirstServerResponse) {
-        Connection->State.GotFirstServerResponse = TRUE;
-    }
+            if (Closed) {
+                break; // Ignore frame if we are closed.
+            }
 
-    if (UpdatedFlowControl) {
+            if (Frame.PacketTolerance == 0 ||
+                Frame.UpdateMaxAckDelay < QUIC_MIN_ACK_DELAY_US) {
+                QuicTraceEvent(
+                    ConnError,
+                    "[conn][%p] ERROR, %s.",
+                    Connection,
+                    "Invalid ACK_FREQUENCY frame");
+                QuicConnTransportError(Connection, QUIC_ERROR_PROTOCOL_VIOLATION);
+                return FALSE;
+            }
+
+            if (Frame.SequenceNumber >= Connection->NextRecvAckFreqSeqNum) {
+                Connection->NextRecvAckFreqSeqNum = Frame.SequenceNumber + 1;
+                Connection->PacketTolerance =
+                    (uint8_t)min(Frame.PacketTolerance, UINT8_MAX);
+                Connection->MaxAckDelayMs =
+                    (uint32_t)min(US_TO_MS(Frame.UpdateMaxAckDelay), QUIC_TP_MAX_ACK_DELAY_MAX);
+                Connection->State.IgnoreReordering = Frame.IgnoreOrder;
+                QuicTraceLogConnVerbose(
+                    UpdateAckFrequency,
+                    Connection,
+                    "Updated ACK frequency: tolerance=%hhu max_ack_delay=%u ms ignore_order=%hhu",
+                    Connection->PacketTolerance,
+                    Connection->MaxAckDelayMs,
+                    Frame.IgnoreOrder);
+            }
+
+            AckPacketImmediately = TRUE;
+            Packet->HasNonProbingFrame = TRUE;
+            break;
+        }
+
+        case QUIC_FRAME_IMMEDIATE_ACK: // Always accept the frame, because we always advertise support.
+            AckImmediatelyRequested = TRUE;
+            AckPacketImmediately = TRUE;
+            Packet->HasNonProbingFrame = TRUE;
+            break;
+
+        default:
+            //
+            // No default case necessary, as we have already validated the frame
+            // type initially, but included for clang the compiler.
+            //
+            break;
+        }
+    }
+
+Done:
+
+    if (!QuicConnIsServer(Connection) &&
+        !Connection->State.GotFirstServerResponse) {
+        Connection->State.GotFirstServerResponse = TRUE;
+    }
+
+    if (UpdatedFlowControl) {
         QuicConnLogOutFlowStats(Connection);
     }
 
@@ -4649,10 +5540,23 @@ Done:
             Packet->NewLargestPacketNumber = TRUE;
         }
 
+        QUIC_ACK_TYPE AckType;
+        if (AckImmediatelyRequested) {
+            AckType = QUIC_ACK_TYPE_ACK_IMMEDIATE;
+        } else if (AckPacketImmediately) {
+            AckType = QUIC_ACK_TYPE_ACK_ELICITING;
+        } else {
+            AckType = QUIC_ACK_TYPE_NON_ACK_ELICITING;
+        }
+
+        const QUIC_RECV_DATAGRAM* Datagram =
+            QuicDataPathRecvPacketToRecvDatagram(Packet);
         QuicAckTrackerAckPacket(
             &Connection->Packets[EncryptLevel]->AckTracker,
             Packet->PacketNumber,
-            AckPacketImmediately);
+            Datagram->RecvTime,
+            QUIC_ECN_FROM_TOS(Datagram->TypeOfService),
+            AckType);
     }
 
     Packet->CompletelyValid = TRUE;
@@ -4739,18 +5643,26 @@ QuicConnRecvPostProcessing(
             // for any retransmits, but the spec requires a new payload in each
             // path challenge.
             //
-            QuicRandom(sizeof((*Path)->Challenge), (*Path)->Challenge);
+            QuicRandomStreamRead(
+                &Connection->Worker->Random,
+                sizeof((*Path)->Challenge),
+                (*Path)->Challenge);
 
             //
             // We need to also send a challenge on the active path to make sure
-            // it is still good.
+            // it is still good, unless multipath is in use, in which case the
+            // peer is adding a path rather than migrating.
             //
             QUIC_DBG_ASSERT(Connection->Paths[0].IsActive);
-            if (Connection->Paths[0].IsPeerValidated) { // Not already doing peer validation.
+            if (!Connection->State.MultipathNegotiated &&
+                Connection->Paths[0].IsPeerValidated) { // Not already doing peer validation.
                 Connection->Paths[0].IsPeerValidated = FALSE;
                 Connection->Paths[0].SendChallenge = TRUE;
                 Connection->Paths[0].PathValidationStartTime = QuicTimeUs32();
-                QuicRandom(sizeof(Connection->Paths[0].Challenge), Connection->Paths[0].Challenge);
+                QuicRandomStreamRead(
+                    &Connection->Worker->Random,
+                    sizeof(Connection->Paths[0].Challenge),
+                    Connection->Paths[0].Challenge);
             }
 
             QuicSendSetSendFlag(
@@ -4772,10 +5684,12 @@ QuicConnRecvPostProcessing(
 
     if (Packet->HasNonProbingFrame &&
         Packet->NewLargestPacketNumber &&
-        !(*Path)->IsActive) {
+        !(*Path)->IsActive &&
+        !Connection->State.MultipathNegotiated) {
         //
         // The peer has sent a non-probing frame on a path other than the active
-        // one. This signals their intent to switch active paths.
+        // one. This signals their intent to switch active paths. With multipath
+        // it's just using all its paths at once.
         //
         QuicPathSetActive(Connection, *Path);
         *Path = &Connection->Paths[0];
@@ -4798,6 +5712,206 @@ QuicConnRecvPostProcessing(
     }
 }
 
+//
+// Returns the key phase bit of a short header packet, before the header
+// protection has been removed.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+uint8_t
+QuicConnRecvGetKeyPhase(
+    _In_ QUIC_RECV_DATAGRAM* Datagram,
+    _In_reads_(QUIC_HP_SAMPLE_LENGTH) const uint8_t* HpMask
+    )
+{
+    QUIC_RECV_PACKET* Packet = QuicDataPathRecvDatagramToRecvPacket(Datagram);
+    QUIC_DBG_ASSERT(Packet->IsShortHeader);
+    uint8_t FirstByte = (uint8_t)(Packet->Buffer[0] ^ (HpMask[0] & 0x1f));
+    return ((QUIC_SHORT_HEADER_V1*)&FirstByte)->KeyPhase;
+}
+
+//
+// Processes a run of short header packets from a receive batch that all use
+// the same read key. The header protection is removed from all the packets and
+// their payloads are decrypted with a single QuicDecryptBatch call, before the
+// packets are processed in order. A run the NIC already decrypted inline
+// (CryptoOffloaded) skips both.
+//
+// N.B. The packet numbers are all decompressed before any of the packets are
+// processed, so relative to a slightly older largest packet number. The run is
+// much smaller than the packet number window, so this doesn't change results.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnRecvDatagramRun(
+    _In_ QUIC_CONNECTION* Connection,
+    _Inout_ QUIC_PATH** Path,
+    _In_ uint8_t RunCount,
+    _In_reads_(RunCount) QUIC_RECV_DATAGRAM** Datagrams,
+    _In_reads_(RunCount * QUIC_HP_SAMPLE_LENGTH)
+        const uint8_t* HpMask,
+    _In_ BOOLEAN CryptoOffloaded,
+    _Inout_ QUIC_RECEIVE_PROCESSING_STATE* RecvState
+    )
+{
+    QUIC_RECV_DATAGRAM* Decrypted[QUIC_MAX_CRYPTO_BATCH_COUNT];
+    QUIC_DECRYPT_BATCH_ENTRY Entries[QUIC_MAX_CRYPTO_BATCH_COUNT];
+    uint8_t ResetTokens[QUIC_MAX_CRYPTO_BATCH_COUNT][QUIC_STATELESS_RESET_TOKEN_LENGTH];
+    BOOLEAN CanCheckForStatelessReset[QUIC_MAX_CRYPTO_BATCH_COUNT];
+    QUIC_PACKET_KEY_TYPE KeyType = QUIC_PACKET_KEY_1_RTT;
+    uint8_t DecryptCount = 0;
+
+    QUIC_DBG_ASSERT(RunCount > 0 && RunCount <= QUIC_MAX_CRYPTO_BATCH_COUNT);
+
+    for (uint8_t i = 0; i < RunCount; ++i) {
+        QUIC_DBG_ASSERT(Datagrams[i]->Allocated);
+        QUIC_RECV_PACKET* Packet = QuicDataPathRecvDatagramToRecvPacket(Datagrams[i]);
+        if (!QuicConnRecvPrepareDecrypt(
+                Connection, Packet, HpMask + i * QUIC_HP_SAMPLE_LENGTH)) {
+            Connection->Stats.Recv.DroppedPackets++;
+            continue;
+        }
+
+        QUIC_DBG_ASSERT(Packet->BufferLength >= Packet->HeaderLength + Packet->PayloadLength);
+        QUIC_DBG_ASSERT(DecryptCount == 0 || Packet->KeyType == KeyType);
+        KeyType = Packet->KeyType;
+
+        CanCheckForStatelessReset[DecryptCount] =
+            QuicConnRecvSaveResetToken(Connection, Packet, ResetTokens[DecryptCount]);
+
+        QUIC_DECRYPT_BATCH_ENTRY* Entry = &Entries[DecryptCount];
+        QuicCryptoCombineIvAndPacketNumber(
+            Connection->Crypto.TlsState.ReadKeys[KeyType]->Iv,
+            (uint8_t*) &Packet->PacketNumber,
+            Entry->Iv);
+        Entry->AuthData = Packet->Buffer;
+        if (Connection->State.IntegrityOnly && Packet->IsShortHeader) {
+            //
+            // Only the tag is verified, over the header and plain text payload.
+            //
+            uint16_t PlainTextLength = Packet->PayloadLength - QUIC_ENCRYPTION_OVERHEAD;
+            Entry->AuthDataLength = Packet->HeaderLength + PlainTextLength;
+            Entry->BufferLength = QUIC_ENCRYPTION_OVERHEAD;
+            Entry->Buffer = (uint8_t*)Packet->Buffer + Packet->HeaderLength + PlainTextLength;
+        } else {
+            Entry->AuthDataLength = Packet->HeaderLength;
+            Entry->BufferLength = Packet->PayloadLength;
+            Entry->Buffer = (uint8_t*)Packet->Buffer + Packet->HeaderLength;
+        }
+        Entry->Status = QUIC_STATUS_SUCCESS;
+
+        Decrypted[DecryptCount++] = Datagrams[i];
+    }
+
+    if (DecryptCount == 0) {
+        return;
+    }
+
+    QUIC_DECRYPT_HELPER* Helper = NULL;
+    uint8_t HelperStart = DecryptCount; // The first packet the helper decrypts.
+
+    if (Connection->State.EncryptionEnabled && !CryptoOffloaded) {
+        QUIC_KEY* PacketKey = Connection->Crypto.TlsState.ReadKeys[KeyType]->PacketKey;
+        QUIC_KEY* HelperKey = NULL;
+        if (MsQuicLib.DecryptHelperPool != NULL &&
+            KeyType == QUIC_PACKET_KEY_1_RTT &&
+            DecryptCount >= QUIC_MIN_DECRYPT_HELPER_PACKETS) {
+            HelperKey = QuicCryptoGetHelperReadKey(Connection);
+        }
+        if (HelperKey != NULL) {
+            //
+            // Have a helper decrypt the second half of the run, with its own
+            // copy of the key, while this thread decrypts the first half and
+            // processes its frames. The copy stays valid even if processing
+            // the frames updates the key phase; it's only replaced at the
+            // start of a later run.
+            //
+            HelperStart = DecryptCount - DecryptCount / 2;
+            Helper =
+                QuicDecryptHelperStart(
+                    MsQuicLib.DecryptHelperPool,
+                    Connection->Worker->IdealProcessor,
+                    HelperKey,
+                    DecryptCount - HelperStart,
+                    Entries + HelperStart);
+            if (Helper == NULL) {
+                HelperStart = DecryptCount;
+            }
+        }
+        QuicDecryptBatch(PacketKey, HelperStart, Entries);
+    }
+
+    for (uint8_t i = 0; i < DecryptCount; ++i) {
+        QUIC_RECV_PACKET* Packet = QuicDataPathRecvDatagramToRecvPacket(Decrypted[i]);
+        if (i == HelperStart && Helper != NULL) {
+            QuicDecryptHelperWait(Helper);
+        }
+        if (i + 1 < DecryptCount && i + 1 != HelperStart) {
+            //
+            // Start loading the frames of the next packet while this one is
+            // processed (unless the helper may still be writing them).
+            //
+            const QUIC_RECV_PACKET* NextPacket =
+                QuicDataPathRecvDatagramToRecvPacket(Decrypted[i + 1]);
+            QuicPrefetch(NextPacket->Buffer + NextPacket->HeaderLength);
+        }
+        if (QuicConnRecvDecryptComplete(
+                Connection,
+                *Path,
+                Packet,
+                Entries[i].Status,
+                CanCheckForStatelessReset[i] ? ResetTokens[i] : NULL) &&
+            QuicConnRecvFrames(Connection, *Path, Packet)) {
+
+            QuicConnRecvPostProcessing(Connection, Path, Packet);
+            RecvState->ResetIdleTimeout |= Packet->CompletelyValid;
+
+            if ((*Path)->IsActive && !(*Path)->PartitionUpdated &&
+                Packet->CompletelyValid && Connection->State.Connected &&
+                !Connection->Registration->ProcessorSet) {
+                //
+                // Only move the connection to the partition its packets are
+                // delivered on once the flow has settled there. Connections
+                // of a registration with a processor set stay on its workers.
+                //
+                uint8_t PartitionIndex =
+                    (uint8_t)(Decrypted[i]->PartitionIndex % MsQuicLib.PartitionCount);
+                if (PartitionIndex == RecvState->PartitionIndex) {
+                    (*Path)->CrossPartitionPackets = 0;
+                } else {
+                    if (PartitionIndex != (*Path)->CrossPartitionIndex) {
+                        (*Path)->CrossPartitionIndex = PartitionIndex;
+                        (*Path)->CrossPartitionPackets = 0;
+                    }
+                    if (++(*Path)->CrossPartitionPackets >= QUIC_PARTITION_MOVE_PACKET_THRESHOLD) {
+                        QuicTraceLogConnInfo(
+                            PartitionMove,
+                            Connection,
+                            "Path[%hhu] Moving from partition %hhu to %hhu",
+                            (*Path)->ID,
+                            RecvState->PartitionIndex,
+                            PartitionIndex);
+                        RecvState->PartitionIndex = PartitionIndex;
+                        RecvState->UpdatePartitionId = TRUE;
+                        (*Path)->PartitionUpdated = TRUE;
+                    }
+                }
+            }
+
+            if (Packet->IsShortHeader && Packet->NewLargestPacketNumber) {
+
+                if (QuicConnIsServer(Connection)) {
+                    (*Path)->SpinBit = Packet->SH->SpinBit;
+                } else {
+                    (*Path)->SpinBit = !Packet->SH->SpinBit;
+                }
+            }
+
+        } else {
+            Connection->Stats.Recv.DroppedPackets++;
+        }
+    }
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicConnRecvDatagramBatch(
@@ -4826,8 +5940,20 @@ QuicConnRecvDatagramBatch(
         return;
     }
 
+    //
+    // Short header packets the NIC already decrypted inline have their header
+    // protection removed too, so their mask is zero.
+    //
+    uint8_t OffloadedCount = 0;
+    if (Packet->IsShortHeader) {
+        for (uint8_t i = 0; i < BatchCount; ++i) {
+            OffloadedCount += Datagrams[i]->CryptoOffloaded;
+        }
+    }
+
     if (Connection->State.EncryptionEnabled &&
-        Connection->State.HeaderProtectionEnabled) {
+        Connection->State.HeaderProtectionEnabled &&
+        OffloadedCount != BatchCount) {
         if (QUIC_FAILED(
             QuicHpComputeMask(
                 Connection->Crypto.TlsState.ReadKeys[Packet->KeyType]->HeaderKey,
@@ -4837,40 +5963,50 @@ QuicConnRecvDatagramBatch(
             QuicPacketLogDrop(Connection, Packet, "Failed to compute HP mask");
             return;
         }
+        if (OffloadedCount != 0) {
+            for (uint8_t i = 0; i < BatchCount; ++i) {
+                if (Datagrams[i]->CryptoOffloaded) {
+                    QuicZeroMemory(
+                        HpMask + i * QUIC_HP_SAMPLE_LENGTH,
+                        QUIC_HP_SAMPLE_LENGTH);
+                }
+            }
+        }
     } else {
         QuicZeroMemory(HpMask, BatchCount * QUIC_HP_SAMPLE_LENGTH);
     }
 
-    for (uint8_t i = 0; i < BatchCount; ++i) {
-        QUIC_DBG_ASSERT(Datagrams[i]->Allocated);
-        Packet = QuicDataPathRecvDatagramToRecvPacket(Datagrams[i]);
-        if (QuicConnRecvPrepareDecrypt(
-                Connection, Packet, HpMask + i * QUIC_HP_SAMPLE_LENGTH) &&
-            QuicConnRecvDecryptAndAuthenticate(Connection, Path, Packet) &&
-            QuicConnRecvFrames(Connection, Path, Packet)) {
-
-            QuicConnRecvPostProcessing(Connection, &Path, Packet);
-            RecvState->ResetIdleTimeout |= Packet->CompletelyValid;
-
-            if (Path->IsActive && !Path->PartitionUpdated && Packet->CompletelyValid &&
-                (Datagrams[i]->PartitionIndex % MsQuicLib.PartitionCount) != RecvState->PartitionIndex) {
-                RecvState->PartitionIndex = Datagrams[i]->PartitionIndex % MsQuicLib.PartitionCount;
-                RecvState->UpdatePartitionId = TRUE;
-                Path->PartitionUpdated = TRUE;
-            }
-
-            if (Packet->IsShortHeader && Packet->NewLargestPacketNumber) {
-
-                if (QuicConnIsServer(Connection)) {
-                    Path->SpinBit = Packet->SH->SpinBit;
-                } else {
-                    Path->SpinBit = !Packet->SH->SpinBit;
-                }
+    //
+    // Split the batch into runs of packets in the current key phase, which can
+    // all be decrypted together. A packet in another key phase needs the key
+    // state left by the packets before it, so it always gets a run of its own.
+    // Packets decrypted inline and in software don't share a run either.
+    //
+    QUIC_PACKET_SPACE* PacketSpace = Connection->Packets[QUIC_ENCRYPT_LEVEL_1_RTT];
+    uint8_t RunStart = 0;
+    while (RunStart < BatchCount) {
+        uint8_t RunEnd = (uint8_t)(RunStart + 1);
+        BOOLEAN RunOffloaded =
+            OffloadedCount != 0 && Datagrams[RunStart]->CryptoOffloaded;
+        if (QuicConnRecvGetKeyPhase(Datagrams[RunStart], HpMask + RunStart * QUIC_HP_SAMPLE_LENGTH) ==
+                PacketSpace->CurrentKeyPhase) {
+            while (RunEnd < BatchCount &&
+                (BOOLEAN)Datagrams[RunEnd]->CryptoOffloaded == RunOffloaded &&
+                QuicConnRecvGetKeyPhase(Datagrams[RunEnd], HpMask + RunEnd * QUIC_HP_SAMPLE_LENGTH) ==
+                    PacketSpace->CurrentKeyPhase) {
+                RunEnd++;
             }
-
-        } else {
-            Connection->Stats.Recv.DroppedPackets++;
         }
+
+        QuicConnRecvDatagramRun(
+            Connection,
+            &Path,
+            (uint8_t)(RunEnd - RunStart),
+            Datagrams + RunStart,
+            HpMask + RunStart * QUIC_HP_SAMPLE_LENGTH,
+            RunOffloaded,
+            RecvState);
+        RunStart = RunEnd;
     }
 }
 
@@ -5079,7 +6215,7 @@ QuicConnRecvDatagrams(
                         &RecvState);
                     BatchCount = 0;
                 }
-                QuicDataPathBindingReturnRecvDatagrams(ReleaseChain);
+                QuicConnReleaseRecvDatagrams(ReleaseChain);
                 ReleaseChain = NULL;
                 ReleaseChainTail = &ReleaseChain;
                 ReleaseChainCount = 0;
@@ -5098,12 +6234,14 @@ QuicConnRecvDatagrams(
         BatchCount = 0;
     }
 
+    QuicLossDetectionFlushTimerUpdate(&Connection->LossDetection);
+
     if (RecvState.ResetIdleTimeout) {
         QuicConnResetIdleTimeout(Connection);
     }
 
     if (ReleaseChain != NULL) {
-        QuicDataPathBindingReturnRecvDatagrams(ReleaseChain);
+        QuicConnReleaseRecvDatagrams(ReleaseChain);
     }
 
     //
@@ -5145,16 +6283,72 @@ QuicConnFlushRecv(
     uint32_t ReceiveQueueCount;
     QUIC_RECV_DATAGRAM* ReceiveQueue;
 
+    uint32_t MaxFlushCount;
+    switch (Connection->Registration == NULL ?
+                QUIC_EXECUTION_PROFILE_LOW_LATENCY :
+                Connection->Registration->ExecProfile) {
+    case QUIC_EXECUTION_PROFILE_TYPE_REAL_TIME:
+        MaxFlushCount = QUIC_REAL_TIME_RECEIVE_FLUSH_COUNT;
+        break;
+    case QUIC_EXECUTION_PROFILE_TYPE_MAX_THROUGHPUT:
+        MaxFlushCount = QUIC_MAX_THROUGHPUT_RECEIVE_FLUSH_COUNT;
+        break;
+    default:
+        MaxFlushCount = QUIC_DEFAULT_RECEIVE_FLUSH_COUNT;
+        break;
+    }
+
+    //
+    // Preallocate the operation to flush the rest of the queue, in case it
+    // doesn't all fit in this flush. Without one, the whole queue is flushed.
+    //
+    QUIC_OPERATION* ConnOper =
+        QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_FLUSH_RECV);
+
     QuicDispatchLockAcquire(&Connection->ReceiveQueueLock);
     ReceiveQueueCount = Connection->ReceiveQueueCount;
-    Connection->ReceiveQueueCount = 0;
     ReceiveQueue = Connection->ReceiveQueue;
-    Connection->ReceiveQueue = NULL;
-    Connection->ReceiveQueueTail = &Connection->ReceiveQueue;
+    uint32_t FlushCount = ReceiveQueueCount / 4;
+    if (FlushCount < QUIC_MIN_RECEIVE_FLUSH_COUNT) {
+        FlushCount = QUIC_MIN_RECEIVE_FLUSH_COUNT;
+    } else if (FlushCount > MaxFlushCount) {
+        FlushCount = MaxFlushCount;
+    }
+    if (ConnOper == NULL || ReceiveQueueCount <= FlushCount) {
+        FlushCount = ReceiveQueueCount;
+        Connection->ReceiveQueue = NULL;
+        Connection->ReceiveQueueTail = &Connection->ReceiveQueue;
+    } else {
+        QUIC_RECV_DATAGRAM** Tail = &Connection->ReceiveQueue;
+        for (uint32_t i = 0; i < FlushCount; ++i) {
+            Tail = &(*Tail)->Next;
+        }
+        Connection->ReceiveQueue = *Tail;
+        *Tail = NULL;
+    }
+    Connection->ReceiveQueueCount -= FlushCount;
+    InterlockedExchangeAdd64(
+        &Connection->Worker->ReceiveQueueCount, -(int64_t)FlushCount);
+    BOOLEAN MoreQueued = Connection->ReceiveQueueCount != 0;
     QuicDispatchLockRelease(&Connection->ReceiveQueueLock);
 
+    if (MoreQueued) {
+        //
+        // Flush the rest after the operations queued so far, so the ACKs and
+        // stream data of this batch aren't held back by the rest.
+        //
+        QuicConnQueueOper(Connection, ConnOper);
+    } else if (ConnOper != NULL) {
+        QuicOperationFree(Connection->Worker, ConnOper);
+    }
+
+    Connection->Stats.Recv.FlushCount++;
+    if (FlushCount > Connection->Stats.Recv.MaxFlushDatagrams) {
+        Connection->Stats.Recv.MaxFlushDatagrams = FlushCount;
+    }
+
     QuicConnRecvDatagrams(
-        Connection, ReceiveQueue, ReceiveQueueCount, FALSE);
+        Connection, ReceiveQueue, FlushCount, FALSE);
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -5188,9 +6382,12 @@ QuicConnDiscardDeferred0Rtt(
             DeferredDatagramsTail = &Datagram->Next;
         }
     }
+    *DeferredDatagramsTail = NULL;
+    Packets->DeferredDatagramsTail = DeferredDatagramsTail;
+    *ReleaseChainTail = NULL;
 
     if (ReleaseChain != NULL) {
-        QuicDataPathBindingReturnRecvDatagrams(ReleaseChain);
+        QuicConnReleaseRecvDatagrams(ReleaseChain);
     }
 }
 
@@ -5200,6 +6397,14 @@ QuicConnFlushDeferred(
     _In_ QUIC_CONNECTION* Connection
     )
 {
+    //
+    // Collect the datagrams of all the packet number spaces that now have
+    // their keys, in order, and process them as a single batch.
+    //
+    QUIC_RECV_DATAGRAM* DeferredDatagrams = NULL;
+    QUIC_RECV_DATAGRAM** DeferredDatagramsTail = &DeferredDatagrams;
+    uint32_t DeferredDatagramsCount = 0;
+
     for (uint8_t i = 1; i <= (uint8_t)Connection->Crypto.TlsState.ReadKey; ++i) {
 
         if (Connection->Crypto.TlsState.ReadKeys[i] == NULL) {
@@ -5211,19 +6416,23 @@ QuicConnFlushDeferred(
         QUIC_PACKET_SPACE* Packets = Connection->Packets[EncryptLevel];
 
         if (Packets->DeferredDatagrams != NULL) {
-            QUIC_RECV_DATAGRAM* DeferredDatagrams = Packets->DeferredDatagrams;
-            uint8_t DeferredDatagramsCount = Packets->DeferredDatagramsCount;
+            *DeferredDatagramsTail = Packets->DeferredDatagrams;
+            DeferredDatagramsTail = Packets->DeferredDatagramsTail;
+            DeferredDatagramsCount += Packets->DeferredDatagramsCount;
 
             Packets->DeferredDatagramsCount = 0;
             Packets->DeferredDatagrams = NULL;
-
-            QuicConnRecvDatagrams(
-                Connection,
-                DeferredDatagrams,
-                DeferredDatagramsCount,
-                TRUE);
+            Packets->DeferredDatagramsTail = &Packets->DeferredDatagrams;
         }
     }
+
+    if (DeferredDatagrams != NULL) {
+        QuicConnRecvDatagrams(
+            Connection,
+            DeferredDatagrams,
+            DeferredDatagramsCount,
+            TRUE);
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -5271,6 +6480,9 @@ QuicConnResetIdleTimeout(
     _In_ QUIC_CONNECTION* Connection
     )
 {
+    const uint64_t TimeNow = QuicTimeUs64();
+    Connection->LastActivityTimeUs = TimeNow;
+
     uint64_t IdleTimeoutMs;
     if (Connection->State.Connected) {
         //
@@ -5298,17 +6510,47 @@ QuicConnResetIdleTimeout(
             IdleTimeoutMs = MinIdleTimeoutMs;
         }
 
-        QuicConnTimerSet(Connection, QUIC_CONN_TIMER_IDLE, IdleTimeoutMs);
+        //
+        // Only (re)arm the timer if it isn't set, or set to expire after the
+        // new deadline (i.e. the timeout got shorter). Otherwise, it checks
+        // LastActivityTimeUs when it fires.
+        //
+        Connection->IdleTimeoutUs = MS_TO_US(IdleTimeoutMs);
+        if (QuicConnTimerExpirationTime(Connection, QUIC_CONN_TIMER_IDLE) >
+                TimeNow + Connection->IdleTimeoutUs) {
+            QuicConnTimerSetUs(
+                Connection, QUIC_CONN_TIMER_IDLE, Connection->IdleTimeoutUs);
+        }
 
     } else {
+        Connection->IdleTimeoutUs = 0;
         QuicConnTimerCancel(Connection, QUIC_CONN_TIMER_IDLE);
     }
 
-    if (Connection->KeepAliveIntervalMs != 0) {
-        QuicConnTimerSet(
+    if (Connection->KeepAliveIntervalMs != 0 &&
+        QuicConnTimerExpirationTime(Connection, QUIC_CONN_TIMER_KEEP_ALIVE) >
+            TimeNow + MS_TO_US(Connection->KeepAliveIntervalMs)) {
+        QuicConnSetKeepAliveTimer(
             Connection,
-            QUIC_CONN_TIMER_KEEP_ALIVE,
-            Connection->KeepAliveIntervalMs);
+            TimeNow,
+            TimeNow + MS_TO_US(Connection->KeepAliveIntervalMs));
+    }
+
+    if (Connection->HibernateTimeoutMs != 0 && Connection->State.Connected) {
+        //
+        // Only stream data counts as activity, so that keep alives alone don't
+        // keep postponing hibernation.
+        //
+        uint64_t StreamBytes =
+            Connection->Stats.Send.TotalStreamBytes +
+            Connection->Stats.Recv.TotalStreamBytes;
+        if (Connection->HibernateStreamBytes != StreamBytes) {
+            Connection->HibernateStreamBytes = StreamBytes;
+            QuicConnTimerSet(
+                Connection,
+                QUIC_CONN_TIMER_HIBERNATE,
+                Connection->HibernateTimeoutMs);
+        }
     }
 }
 
@@ -5318,6 +6560,16 @@ QuicConnProcessIdleTimerOperation(
     _In_ QUIC_CONNECTION* Connection
     )
 {
+    uint64_t Deadline = Connection->LastActivityTimeUs + Connection->IdleTimeoutUs;
+    uint64_t TimeNow = QuicTimeUs64();
+    if (TimeNow < Deadline) {
+        //
+        // There was activity since the timer was set.
+        //
+        QuicConnTimerSetUs(Connection, QUIC_CONN_TIMER_IDLE, Deadline - TimeNow);
+        return;
+    }
+
     //
     // Close the connection, as the agreed-upon idle time period has elapsed.
     //
@@ -5328,12 +6580,107 @@ QuicConnProcessIdleTimerOperation(
         NULL);
 }
 
+//
+// Arms the keep alive timer to expire at, or a little before, Deadline: early
+// by a random jitter, and then aligned down to the worker's keep alive
+// buckets, so that the keep alives of the worker's connections are sent in
+// batches, without all the connections started together staying in lockstep.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnSetKeepAliveTimer(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ uint64_t TimeNow,
+    _In_ uint64_t Deadline
+    )
+{
+    const uint64_t IntervalUs = MS_TO_US(Connection->KeepAliveIntervalMs);
+    const uint64_t BucketOffsetUs = Connection->Worker->KeepAliveBucketOffsetUs;
+
+    uint32_t Jitter;
+    QuicRandomStreamRead(&Connection->Worker->Random, sizeof(Jitter), &Jitter);
+    uint64_t ExpirationTime =
+        Deadline - Jitter % (IntervalUs / QUIC_KEEP_ALIVE_JITTER_DIVISOR + 1);
+
+    if (ExpirationTime > BucketOffsetUs) {
+        uint64_t AlignedTime =
+            (ExpirationTime - BucketOffsetUs) / QUIC_KEEP_ALIVE_BUCKET_US *
+                QUIC_KEEP_ALIVE_BUCKET_US + BucketOffsetUs;
+        if (AlignedTime > TimeNow &&
+            AlignedTime >= Deadline - IntervalUs / QUIC_KEEP_ALIVE_MAX_EARLY_DIVISOR) {
+            ExpirationTime = AlignedTime;
+        }
+    }
+
+    QuicConnTimerSetUs(
+        Connection,
+        QUIC_CONN_TIMER_KEEP_ALIVE,
+        ExpirationTime > TimeNow ? ExpirationTime - TimeNow : 0);
+}
+
+//
+// Called inline from the worker's timer processing when the keep alive timer
+// expires. Re-arms the timer, and returns TRUE if a PING is now to be sent;
+// FALSE if there was recent enough activity that no keep alive is needed yet.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicConnProcessKeepAliveTimer(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ uint64_t TimeNow
+    )
+{
+    if (Connection->KeepAliveIntervalMs == 0) {
+        return FALSE;
+    }
+
+    const uint64_t IntervalUs = MS_TO_US(Connection->KeepAliveIntervalMs);
+    uint64_t NextKeepAlive = Connection->LastActivityTimeUs + IntervalUs;
+    if (NextKeepAlive > TimeNow + IntervalUs / QUIC_KEEP_ALIVE_MAX_EARLY_DIVISOR) {
+        //
+        // There was activity since the timer was set, so no keep alive is
+        // needed yet.
+        //
+        QuicConnSetKeepAliveTimer(Connection, TimeNow, NextKeepAlive);
+        return FALSE;
+    }
+
+    QuicConnSetKeepAliveTimer(Connection, TimeNow, TimeNow + IntervalUs);
+
+    if (QuicConnIsClosed(Connection)) {
+        return FALSE;
+    }
+
+    //
+    // Send a PING frame to keep the connection alive. The caller flushes the
+    // send directly, so no flush operation is queued.
+    //
+    Connection->Send.TailLossProbeNeeded = TRUE;
+    Connection->Send.SendFlags |= QUIC_CONN_SEND_FLAG_PING;
+    return TRUE;
+}
+
+//
+// Sends a keep alive right away (e.g. when the keep alive interval is set),
+// unless there was recent activity.
+//
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicConnProcessKeepAliveOperation(
     _In_ QUIC_CONNECTION* Connection
     )
 {
+    const uint64_t IntervalUs = MS_TO_US(Connection->KeepAliveIntervalMs);
+    uint64_t NextKeepAlive = Connection->LastActivityTimeUs + IntervalUs;
+    uint64_t TimeNow = QuicTimeUs64();
+    if (TimeNow < NextKeepAlive) {
+        //
+        // There was recent activity, so no keep alive is needed yet.
+        //
+        QuicConnSetKeepAliveTimer(Connection, TimeNow, NextKeepAlive);
+        return;
+    }
+
     //
     // Send a PING frame to keep the connection alive.
     //
@@ -5343,10 +6690,172 @@ QuicConnProcessKeepAliveOperation(
     //
     // Restart the keep alive timer.
     //
-    QuicConnTimerSet(
+    QuicConnSetKeepAliveTimer(Connection, TimeNow, TimeNow + IntervalUs);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnProcessHibernateTimerOperation(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    uint64_t StreamBytes =
+        Connection->Stats.Send.TotalStreamBytes +
+        Connection->Stats.Recv.TotalStreamBytes;
+    if (StreamBytes != Connection->HibernateStreamBytes ||
+        Connection->LossDetection.PacketsInFlight != 0) {
+        //
+        // Not quiet for the whole period. Check again later.
+        //
+        Connection->HibernateStreamBytes = StreamBytes;
+        QuicConnTimerSet(
+            Connection,
+            QUIC_CONN_TIMER_HIBERNATE,
+            Connection->HibernateTimeoutMs);
+        return;
+    }
+
+    QuicTraceLogConnVerbose(
+        Hibernate,
         Connection,
-        QUIC_CONN_TIMER_KEEP_ALIVE,
-        Connection->KeepAliveIntervalMs);
+        "Hibernating");
+
+    //
+    // Free the memory of state that grows with traffic, but is empty (or
+    // nearly so) while the connection is quiet. All of it is allocated again
+    // on demand, so waking up needs no special handling. The timer is started
+    // again by the next send or receive.
+    //
+    Connection->HibernateStreamBytes = UINT64_MAX;
+
+    if (Connection->LossDetection.SentPackets.LiveCount == 0) {
+        QuicSentPacketRingUninitialize(&Connection->LossDetection.SentPackets);
+    }
+
+    for (uint32_t i = 0; i < ARRAYSIZE(Connection->Packets); ++i) {
+        if (Connection->Packets[i] != NULL) {
+            QuicRangeShrink(&Connection->Packets[i]->AckTracker.PacketNumbersReceived);
+            QuicRangeShrink(&Connection->Packets[i]->AckTracker.PacketNumbersToAck);
+        }
+    }
+
+    QuicCryptoReleaseIdleBuffers(&Connection->Crypto);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnProcessAddrFallbackTimerOperation(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_PATH* Path = &Connection->Paths[0];
+
+    if (!Connection->State.FallbackAddressSet) {
+        return;
+    }
+    Connection->State.FallbackAddressSet = FALSE;
+
+    if (Connection->State.GotFirstServerResponse ||
+        Connection->State.ClosedLocally ||
+        Connection->State.ClosedRemotely) {
+        return;
+    }
+
+    //
+    // The server hasn't responded over the first address family. Move the
+    // connection to a binding for the other one and start the handshake over.
+    //
+    QUIC_BINDING* OldBinding = Path->Binding;
+    QUIC_STATUS Status =
+        QuicLibraryGetBinding(
+            Connection->Session,
+            Connection->State.ShareBinding,
+            FALSE,
+            NULL,
+            &Connection->FallbackRemoteAddress,
+            &Path->Binding);
+    if (QUIC_FAILED(Status)) {
+        Path->Binding = OldBinding;
+        return;
+    }
+
+    QuicTraceLogConnInfo(
+        AddrFallback,
+        Connection,
+        "No response from the server, falling back to the other address family");
+
+    QuicBindingMoveSourceConnectionIDs(OldBinding, Path->Binding, Connection);
+    QuicLibraryReleaseBinding(OldBinding);
+
+    Path->RemoteAddress = Connection->FallbackRemoteAddress;
+    QuicTraceEvent(
+        ConnRemoteAddrAdded,
+        "[conn][%p] New Remote IP: %!SOCKADDR!",
+        Connection,
+        LOG_ADDR_LEN(Path->RemoteAddress),
+        (const uint8_t*)&Path->RemoteAddress);
+
+    QuicTraceEvent(
+        ConnLocalAddrRemoved,
+        "[conn][%p] Removed Local IP: %!SOCKADDR!",
+        Connection,
+        LOG_ADDR_LEN(Path->LocalAddress),
+        (const uint8_t*)&Path->LocalAddress);
+    QuicDataPathBindingGetLocalAddress(
+        Path->Binding->DatapathBinding,
+        &Path->LocalAddress);
+    QuicTraceEvent(
+        ConnLocalAddrAdded,
+        "[conn][%p] New Local IP: %!SOCKADDR!",
+        Connection,
+        LOG_ADDR_LEN(Path->LocalAddress),
+        (const uint8_t*)&Path->LocalAddress);
+
+    QuicConnRestart(Connection, FALSE);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicConnOpenDedicatedBinding(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_PATH* Path = &Connection->Paths[0];
+    QUIC_BINDING* Binding;
+
+    //
+    // The dedicated binding is connected to the peer on the same local address
+    // (and port) as the listener's, so the kernel demultiplexes the flow to its
+    // own socket and receive queue. It isn't added to the library's binding
+    // table, so no other connection ever shares it, and the connection's CIDs
+    // stay on the listener's binding, for the datagrams already queued there.
+    //
+    QUIC_STATUS Status =
+        QuicBindingInitialize(
+#ifdef QUIC_COMPARTMENT_ID
+            Connection->Session->CompartmentId,
+#endif
+            TRUE,
+            TRUE,
+            &Path->LocalAddress,
+            &Path->RemoteAddress,
+            &Binding);
+    if (QUIC_FAILED(Status)) {
+        return Status;
+    }
+
+    BOOLEAN Result = QuicLookupSetDedicatedConnection(&Binding->Lookup, Connection);
+    QUIC_DBG_ASSERT(Result);
+    UNREFERENCED_PARAMETER(Result);
+    Connection->DedicatedBinding = Binding;
+
+    QuicTraceLogConnInfo(
+        DedicatedBindingOpened,
+        Connection,
+        "Opened dedicated binding %p",
+        Binding);
+
+    return QUIC_STATUS_SUCCESS;
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -5455,7 +6964,9 @@ QuicConnParamSet(
 
             QuicBindingMoveSourceConnectionIDs(
                 OldBinding, Connection->Paths[0].Binding, Connection);
+            QuicCryptoClearInlineOffload(Connection);
             QuicLibraryReleaseBinding(OldBinding);
+            QuicCryptoUpdateInlineOffload(Connection);
 
             QuicTraceEvent(
                 ConnLocalAddrRemoved,
@@ -5809,6 +7320,44 @@ QuicConnParamSet(
         break;
     }
 
+    case QUIC_PARAM_CONN_CONGESTION_CONTROL_ALGORITHM: {
+
+        if (BufferLength != sizeof(uint16_t) || Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (Connection->State.Started) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
+
+        uint16_t Algorithm = *(uint16_t*)Buffer;
+        if (Algorithm >= QUIC_CONGESTION_CONTROL_ALGORITHM_COUNT) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // The rest of the congestion control configuration still comes from
+        // the session (or global) settings.
+        //
+        QUIC_SETTINGS Settings =
+            Connection->Session != NULL ?
+                Connection->Session->Settings : MsQuicLib.Settings;
+        Settings.CongestionControlAlgorithm = Algorithm;
+        QuicCongestionControlInitialize(&Connection->CongestionControl, &Settings);
+
+        QuicTraceLogConnInfo(
+            UpdateCongestionControlAlgorithm,
+            Connection,
+            "Updated congestion control algorithm = %hu",
+            Algorithm);
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
     case QUIC_PARAM_CONN_FORCE_KEY_UPDATE:
 
         if (!Connection->State.Connected ||
@@ -5821,68 +7370,260 @@ QuicConnParamSet(
         }
 
         QuicTraceLogConnVerbose(
-            ForceKeyUpdate,
+            ForceKeyUpdate,
+            Connection,
+            "Forcing key update");
+
+        Status = QuicCryptoGenerateNewKeys(Connection);
+        if (QUIC_FAILED(Status)) {
+            QuicTraceEvent(
+                ConnErrorStatus,
+                "[conn][%p] ERROR, %u, %s.",
+                Connection,
+                Status,
+                "Forced key update");
+            break;
+        }
+
+        QuicCryptoUpdateKeyPhase(Connection, TRUE);
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_CONN_FORCE_CID_UPDATE:
+
+        if (!Connection->State.Connected ||
+            !Connection->State.HandshakeConfirmed) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
+
+        QuicTraceLogConnVerbose(
+            ForceCidUpdate,
+            Connection,
+            "Forcing destination CID update");
+
+        if (!QuicConnRetireCurrentDestCid(Connection, &Connection->Paths[0])) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
+
+        Connection->Paths[0].InitiatedCidUpdate = TRUE;
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_CONN_DATAGRAM_RECEIVE_ENABLED:
+
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (Connection->State.Started) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
+
+        Connection->Datagram.ReceiveEnabled = *(BOOLEAN*)Buffer;
+        Status = QUIC_STATUS_SUCCESS;
+
+        QuicTraceLogConnVerbose(
+            DatagramReceiveEnableUpdated,
+            Connection,
+            "Updated datagram receive enabled to %hhu",
+            Connection->Datagram.ReceiveEnabled);
+
+        break;
+
+    case QUIC_PARAM_CONN_DATAGRAM_RECEIVE_LENDING:
+
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        Connection->Datagram.ReceiveLendingEnabled = *(BOOLEAN*)Buffer;
+        Status = QUIC_STATUS_SUCCESS;
+
+        QuicTraceLogConnVerbose(
+            DatagramReceiveLendingUpdated,
+            Connection,
+            "Updated datagram receive lending to %hhu",
+            Connection->Datagram.ReceiveLendingEnabled);
+
+        break;
+
+    case QUIC_PARAM_CONN_MULTIPATH_ENABLED:
+
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (Connection->State.Started) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
+
+        Connection->State.MultipathEnabled = *(BOOLEAN*)Buffer;
+        Status = QUIC_STATUS_SUCCESS;
+
+        QuicTraceLogConnVerbose(
+            MultipathEnableUpdated,
+            Connection,
+            "Updated multipath enabled to %hhu",
+            Connection->State.MultipathEnabled);
+
+        break;
+
+    case QUIC_PARAM_CONN_LATENCY_SENSITIVE:
+
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // Takes effect the next time the connection is queued on its worker.
+        //
+        Connection->LatencySensitive = *(BOOLEAN*)Buffer;
+        Status = QUIC_STATUS_SUCCESS;
+
+        QuicTraceLogConnVerbose(
+            LatencySensitiveUpdated,
+            Connection,
+            "Updated latency sensitive to %hhu",
+            Connection->LatencySensitive);
+
+        break;
+
+    case QUIC_PARAM_CONN_ARENA_ENABLED:
+
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // Objects already allocated are freed where they came from, so this
+        // can be changed at any time.
+        //
+        Connection->Arena.Enabled = *(BOOLEAN*)Buffer;
+        Status = QUIC_STATUS_SUCCESS;
+
+        QuicTraceLogConnVerbose(
+            ArenaEnabledUpdated,
             Connection,
-            "Forcing key update");
+            "Updated arena enabled to %hhu",
+            Connection->Arena.Enabled);
 
-        Status = QuicCryptoGenerateNewKeys(Connection);
-        if (QUIC_FAILED(Status)) {
-            QuicTraceEvent(
-                ConnErrorStatus,
-                "[conn][%p] ERROR, %u, %s.",
-                Connection,
-                Status,
-                "Forced key update");
+        break;
+
+    case QUIC_PARAM_CONN_SEND_CORK_US:
+
+        if (BufferLength != sizeof(uint32_t) ||
+            *(uint32_t*)Buffer > QUIC_MAX_SEND_CORK_US) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
             break;
         }
 
-        QuicCryptoUpdateKeyPhase(Connection, TRUE);
+        Connection->Send.CorkUs = *(uint32_t*)Buffer;
         Status = QUIC_STATUS_SUCCESS;
+
+        QuicTraceLogConnVerbose(
+            SendCorkUpdated,
+            Connection,
+            "Updated send cork to %u us",
+            Connection->Send.CorkUs);
+
         break;
 
-    case QUIC_PARAM_CONN_FORCE_CID_UPDATE:
+    case QUIC_PARAM_CONN_RECEIVE_BATCH_ENABLED:
 
-        if (!Connection->State.Connected ||
-            !Connection->State.HandshakeConfirmed) {
-            Status = QUIC_STATUS_INVALID_STATE;
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
             break;
         }
 
+        if (*(BOOLEAN*)Buffer && Connection->RecvBatch == NULL) {
+            Connection->RecvBatch = QUIC_ALLOC_NONPAGED(sizeof(QUIC_RECV_BATCH));
+            if (Connection->RecvBatch == NULL) {
+                QuicTraceEvent(
+                    AllocFailure,
+                    "Allocation of '%s' failed. (%llu bytes)",
+                    "Receive batch",
+                    sizeof(QUIC_RECV_BATCH));
+                Status = QUIC_STATUS_OUT_OF_MEMORY;
+                break;
+            }
+        }
+
+        //
+        // Streams already queued for a batch (or their own flush) are still
+        // indicated that way; the new mode applies to the next queued flush.
+        //
+        Connection->ReceiveBatchEnabled = *(BOOLEAN*)Buffer;
+        Status = QUIC_STATUS_SUCCESS;
+
         QuicTraceLogConnVerbose(
-            ForceCidUpdate,
+            ReceiveBatchEnabledUpdated,
             Connection,
-            "Forcing destination CID update");
+            "Updated receive batch enabled to %hhu",
+            Connection->ReceiveBatchEnabled);
 
-        if (!QuicConnRetireCurrentDestCid(Connection, &Connection->Paths[0])) {
+        break;
+
+    case QUIC_PARAM_CONN_DEDICATED_SOCKET:
+
+        if (BufferLength != sizeof(BOOLEAN) || !*(BOOLEAN*)Buffer) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // Only a server's confirmed connection is promoted; before that, the
+        // peer may still migrate off the handshake's 4-tuple.
+        //
+        if (!QuicConnIsServer(Connection) ||
+            !Connection->State.HandshakeConfirmed ||
+            Connection->State.ClosedLocally ||
+            Connection->State.ClosedRemotely) {
             Status = QUIC_STATUS_INVALID_STATE;
             break;
         }
 
-        Connection->Paths[0].InitiatedCidUpdate = TRUE;
-        Status = QUIC_STATUS_SUCCESS;
+        if (Connection->DedicatedBinding != NULL) {
+            Status = QUIC_STATUS_SUCCESS;
+            break;
+        }
+
+        Status = QuicConnOpenDedicatedBinding(Connection);
         break;
 
-    case QUIC_PARAM_CONN_DATAGRAM_RECEIVE_ENABLED:
+    case QUIC_PARAM_CONN_ADD_PATH:
 
-        if (BufferLength != sizeof(BOOLEAN)) {
+        if (BufferLength != sizeof(QUIC_ADDR)) {
             Status = QUIC_STATUS_INVALID_PARAMETER;
             break;
         }
 
-        if (Connection->State.Started) {
-            Status = QUIC_STATUS_INVALID_STATE;
+        if (!QuicAddrIsValid((const QUIC_ADDR*)Buffer)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
             break;
         }
 
-        Connection->Datagram.ReceiveEnabled = *(BOOLEAN*)Buffer;
-        Status = QUIC_STATUS_SUCCESS;
-
-        QuicTraceLogConnVerbose(
-            DatagramReceiveEnableUpdated,
-            Connection,
-            "Updated datagram receive enabled to %hhu",
-            Connection->Datagram.ReceiveEnabled);
+        //
+        // New paths use the connection's binding, so it must not be
+        // connected to a single remote address.
+        //
+        if (QuicConnIsServer(Connection) ||
+            !Connection->State.ShareBinding ||
+            !Connection->State.MultipathNegotiated ||
+            !Connection->State.HandshakeConfirmed) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
 
+        Status = QuicConnOpenPath(Connection, (const QUIC_ADDR*)Buffer);
         break;
 
     case QUIC_PARAM_CONN_TEST_TRANSPORT_PARAMETER:
@@ -6113,6 +7854,8 @@ QuicConnParamGet(
         QUIC_STATISTICS* Stats = (QUIC_STATISTICS*)Buffer;
         const QUIC_PATH* Path = &Connection->Paths[0];
 
+        QuicConnUpdateBlockedTime(Connection);
+
         Stats->CorrelationId = Connection->Stats.CorrelationId;
         Stats->VersionNegotiation = Connection->Stats.VersionNegotiation;
         Stats->StatelessRetry = Connection->Stats.StatelessRetry;
@@ -6133,6 +7876,7 @@ QuicConnParamGet(
         Stats->Send.TotalStreamBytes = Connection->Stats.Send.TotalStreamBytes;
         Stats->Send.CongestionCount = Connection->Stats.Send.CongestionCount;
         Stats->Send.PersistentCongestionCount = Connection->Stats.Send.PersistentCongestionCount;
+        Stats->Send.SpuriousCongestionCount = Connection->Stats.Send.SpuriousCongestionCount;
         Stats->Recv.TotalPackets = Connection->Stats.Recv.TotalPackets;
         Stats->Recv.ReorderedPackets = Connection->Stats.Recv.ReorderedPackets;
         Stats->Recv.DroppedPackets = Connection->Stats.Recv.DroppedPackets;
@@ -6140,7 +7884,21 @@ QuicConnParamGet(
         Stats->Recv.TotalBytes = Connection->Stats.Recv.TotalBytes;
         Stats->Recv.TotalStreamBytes = Connection->Stats.Recv.TotalStreamBytes;
         Stats->Recv.DecryptionFailures = Connection->Stats.Recv.DecryptionFailures;
+        Stats->Recv.QueueFullDrops = Connection->Stats.Recv.QueueFullDrops;
+        Stats->Recv.QueueOldEpochDrops = Connection->Stats.Recv.QueueOldEpochDrops;
+        Stats->Recv.QueueWorkerLimitDrops = Connection->Stats.Recv.QueueWorkerLimitDrops;
+        Stats->Recv.FlushCount = Connection->Stats.Recv.FlushCount;
+        Stats->Recv.MaxFlushDatagrams = Connection->Stats.Recv.MaxFlushDatagrams;
         Stats->Misc.KeyUpdateCount = Connection->Stats.Misc.KeyUpdateCount;
+        Stats->Blocked.CongestionControl = Connection->Stats.Blocked.CongestionControl;
+        Stats->Blocked.Pacing = Connection->Stats.Blocked.Pacing;
+        Stats->Blocked.AmplificationProt = Connection->Stats.Blocked.AmplificationProt;
+        Stats->Blocked.ConnFlowControl = Connection->Stats.Blocked.ConnFlowControl;
+        Stats->Blocked.StreamFlowControl = Connection->Stats.Blocked.StreamFlowControl;
+        Stats->Blocked.App = Connection->Stats.Blocked.App;
+        Stats->Processing.TotalTime = Connection->Stats.Processing.TotalTime;
+        Stats->Processing.CryptoTime = Connection->Stats.Processing.CryptoTime;
+        Stats->Processing.CallbackTime = Connection->Stats.Processing.CallbackTime;
 
         if (Param == QUIC_PARAM_CONN_STATISTICS_PLAT) {
             Stats->Timing.Start = QuicTimeUs64ToPlat(Stats->Timing.Start);
@@ -6423,6 +8181,186 @@ QuicConnParamGet(
         Status = QUIC_STATUS_SUCCESS;
         break;
 
+    case QUIC_PARAM_CONN_CONGESTION_CONTROL_ALGORITHM:
+
+        if (*BufferLength < sizeof(uint16_t)) {
+            *BufferLength = sizeof(uint16_t);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(uint16_t);
+        *(uint16_t*)Buffer =
+            (uint16_t)Connection->CongestionControl.Vtable->Algorithm;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_CONN_STATISTICS_HISTOGRAMS: {
+
+        if (*BufferLength < sizeof(QUIC_STATISTICS_HISTOGRAMS)) {
+            *BufferLength = sizeof(QUIC_STATISTICS_HISTOGRAMS);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        QUIC_STATISTICS_HISTOGRAMS* Histograms = (QUIC_STATISTICS_HISTOGRAMS*)Buffer;
+        for (uint32_t i = 0; i < QUIC_HISTOGRAM_BUCKET_COUNT; ++i) {
+            Histograms->Rtt.Buckets[i] = Connection->Histograms.Rtt[i];
+            Histograms->AckDelay.Buckets[i] = Connection->Histograms.AckDelay[i];
+            Histograms->QueueDelay.Buckets[i] = Connection->Histograms.QueueDelay[i];
+            Histograms->CallbackTime.Buckets[i] = Connection->Histograms.CallbackTime[i];
+            Histograms->SendBatchSize.Buckets[i] = Connection->Histograms.SendBatchSize[i];
+        }
+
+        *BufferLength = sizeof(QUIC_STATISTICS_HISTOGRAMS);
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
+    case QUIC_PARAM_CONN_DATAGRAM_RECEIVE_LENDING:
+
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = Connection->Datagram.ReceiveLendingEnabled;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_CONN_MULTIPATH_ENABLED:
+
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = Connection->State.MultipathEnabled;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_CONN_LATENCY_SENSITIVE:
+
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = Connection->LatencySensitive;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_CONN_ARENA_ENABLED:
+
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = Connection->Arena.Enabled;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_CONN_RECEIVE_BATCH_ENABLED:
+
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = Connection->ReceiveBatchEnabled;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_CONN_DEDICATED_SOCKET:
+
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = Connection->DedicatedBinding != NULL;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_CONN_SEND_CORK_US:
+
+        if (*BufferLength < sizeof(uint32_t)) {
+            *BufferLength = sizeof(uint32_t);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(uint32_t);
+        *(uint32_t*)Buffer = Connection->Send.CorkUs;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
     default:
         Status = QUIC_STATUS_INVALID_PARAMETER;
         break;
@@ -6464,6 +8402,24 @@ QuicConnProcessApiOperation(
 
     case QUIC_API_TYPE_CONN_SEND_RESUMPTION_TICKET:
         QUIC_DBG_ASSERT(QuicConnIsServer(Connection));
+        if (ApiCtx->CONN_SEND_RESUMPTION_TICKET.Flags & QUIC_SEND_RESUMPTION_FLAG_DEFER) {
+            //
+            // Encoding the ticket waits until the connection has nothing else
+            // to do; see QuicConnSendDeferredResumptionTicket.
+            //
+            if (Connection->DeferredTicketAppData != NULL) {
+                QUIC_FREE(Connection->DeferredTicketAppData);
+            }
+            Connection->DeferredTicketPending = TRUE;
+            Connection->DeferredTicketFinal =
+                !!(ApiCtx->CONN_SEND_RESUMPTION_TICKET.Flags & QUIC_SEND_RESUMPTION_FLAG_FINAL);
+            Connection->DeferredTicketAppDataLength =
+                ApiCtx->CONN_SEND_RESUMPTION_TICKET.AppDataLength;
+            Connection->DeferredTicketAppData =
+                ApiCtx->CONN_SEND_RESUMPTION_TICKET.ResumptionAppData;
+            ApiCtx->CONN_SEND_RESUMPTION_TICKET.ResumptionAppData = NULL;
+            break;
+        }
         Status =
             QuicConnSendResumptionTicket(
                 Connection,
@@ -6499,6 +8455,13 @@ QuicConnProcessApiOperation(
             ApiCtx->STRM_SEND.Stream);
         break;
 
+    case QUIC_API_TYPE_STRM_SEND_BATCH:
+        for (uint32_t i = 0; i < ApiCtx->STRM_SEND_BATCH.StreamCount; ++i) {
+            QuicStreamSendFlush(
+                ApiCtx->STRM_SEND_BATCH.Streams[i]);
+        }
+        break;
+
     case QUIC_API_TYPE_STRM_RECV_COMPLETE:
         QuicStreamReceiveCompletePending(
             ApiCtx->STRM_RECV_COMPLETE.Stream,
@@ -6512,6 +8475,12 @@ QuicConnProcessApiOperation(
                 ApiCtx->STRM_RECV_SET_ENABLED.IsEnabled);
         break;
 
+    case QUIC_API_TYPE_DATAGRAM_RECV_COMPLETE:
+        QuicDatagramReceiveComplete(
+            &Connection->Datagram,
+            ApiCtx->DATAGRAM_RECV_COMPLETE.Buffer);
+        break;
+
     case QUIC_API_TYPE_SET_PARAM:
         Status =
             QuicLibrarySetParam(
@@ -6564,8 +8533,11 @@ QuicConnProcessExpiredTimer(
     case QUIC_CONN_TIMER_LOSS_DETECTION:
         QuicLossDetectionProcessTimerOperation(&Connection->LossDetection);
         break;
-    case QUIC_CONN_TIMER_KEEP_ALIVE:
-        QuicConnProcessKeepAliveOperation(Connection);
+    case QUIC_CONN_TIMER_HIBERNATE:
+        QuicConnProcessHibernateTimerOperation(Connection);
+        break;
+    case QUIC_CONN_TIMER_ADDR_FALLBACK:
+        QuicConnProcessAddrFallbackTimerOperation(Connection);
         break;
     case QUIC_CONN_TIMER_SHUTDOWN:
         QuicConnProcessShutdownTimerOperation(Connection);
@@ -6587,7 +8559,13 @@ QuicConnDrainOperations(
         (Connection->Session == NULL || Connection->Session->Registration == NULL) ?
             MsQuicLib.Settings.MaxOperationsPerDrain :
             Connection->Session->Settings.MaxOperationsPerDrain;
+    const uint32_t MaxDrainTimeUs =
+        Connection->Registration == NULL ?
+            MsQuicLib.Settings.MaxDrainTimeUs :
+            Connection->Registration->MaxDrainTimeUs;
+    const uint64_t DrainStartTime = MaxDrainTimeUs != 0 ? QuicTimeUs64() : 0;
     uint32_t OperationCount = 0;
+    BOOLEAN OutOfBudget = FALSE;
     BOOLEAN HasMoreWorkToDo = TRUE;
 
     QUIC_PASSIVE_CODE();
@@ -6621,6 +8599,7 @@ QuicConnDrainOperations(
         }
 
         QuicOperLog(Connection, Oper);
+        QuicTraceProbe(oper_dequeue, Connection, Oper->Type);
 
         BOOLEAN FreeOper = Oper->FreeAfterProcess;
 
@@ -6644,7 +8623,11 @@ QuicConnDrainOperations(
             break;
 
         case QUIC_OPER_TYPE_FLUSH_STREAM_RECV:
-            QuicStreamRecvFlush(Oper->FLUSH_STREAM_RECEIVE.Stream);
+            if (Oper->FLUSH_STREAM_RECEIVE.Stream == NULL) {
+                QuicStreamRecvFlushBatch(Connection);
+            } else {
+                QuicStreamRecvFlush(Oper->FLUSH_STREAM_RECEIVE.Stream);
+            }
             break;
 
         case QUIC_OPER_TYPE_FLUSH_SEND:
@@ -6675,6 +8658,16 @@ QuicConnDrainOperations(
             QuicConnTraceRundownOper(Connection);
             break;
 
+        case QUIC_OPER_TYPE_GENERATE_KEYS:
+            QuicCryptoProcessGenerateNewKeysOperation(&Connection->Crypto);
+            break;
+
+        case QUIC_OPER_TYPE_ADDR_RESOLVED:
+            QuicConnProcessAddrResolvedOperation(
+                Connection,
+                Oper->ADDR_RESOLVED.Context);
+            break;
+
         default:
             QUIC_FRE_ASSERT(FALSE);
             break;
@@ -6687,6 +8680,18 @@ QuicConnDrainOperations(
         }
 
         Connection->Stats.Schedule.OperationCount++;
+
+        if (MaxDrainTimeUs != 0 &&
+            QuicTimeDiff64(DrainStartTime, QuicTimeUs64()) >= MaxDrainTimeUs) {
+            //
+            // Out of time for this drain. Yield to the other connections of
+            // the worker; the connection is requeued with its remaining
+            // operations.
+            //
+            Connection->Stats.Schedule.TimeBudgetExceededCount++;
+            OutOfBudget = TRUE;
+            break;
+        }
     }
 
     if (!Connection->State.ExternalOwner && Connection->State.ClosedLocally) {
@@ -6702,7 +8707,7 @@ QuicConnDrainOperations(
     }
 
     if (!Connection->State.HandleClosed) {
-        if (OperationCount >= MaxOperationCount &&
+        if ((OutOfBudget || OperationCount >= MaxOperationCount) &&
             (Connection->Send.SendFlags & QUIC_CONN_SEND_FLAG_ACK)) {
             //
             // We can't process any more operations but still need to send an
@@ -6715,6 +8720,10 @@ QuicConnDrainOperations(
         if (Connection->State.SendShutdownCompleteNotif) {
             QuicConnOnShutdownComplete(Connection);
         }
+
+        if (!HasMoreWorkToDo && Connection->DeferredTicketPending) {
+            QuicConnSendDeferredResumptionTicket(Connection);
+        }
     }
 
     if (Connection->State.HandleClosed) {
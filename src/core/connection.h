@@ -18,6 +18,7 @@ typedef struct QUIC_LISTENER QUIC_LISTENER;
 #define QUIC_CLOSE_APPLICATION              0x00000004  // Application closed the connection.
 #define QUIC_CLOSE_REMOTE                   0x00000008  // Connection closed remotely.
 #define QUIC_CLOSE_QUIC_STATUS              0x00000010  // QUIC_STATUS used for closing.
+#define QUIC_CLOSE_NO_DRAIN                 0x00000020  // Complete once connection close is sent
 
 #define QUIC_CLOSE_INTERNAL QUIC_CLOSE_SEND_NOTIFICATION
 #define QUIC_CLOSE_INTERNAL_SILENT (QUIC_CLOSE_INTERNAL | QUIC_CLOSE_SILENT)
@@ -97,6 +98,19 @@ typedef union QUIC_CONNECTION_STATE {
         //
         BOOLEAN RemoteAddressSet : 1;
 
+        //
+        // Indicates the server name also resolved to an address of the other
+        // family, which the client falls back to if the first one doesn't get
+        // a response in time.
+        //
+        BOOLEAN FallbackAddressSet : 1;
+
+        //
+        // The server name is being resolved asynchronously. The connection
+        // starts once it completes.
+        //
+        BOOLEAN ResolvingAddress : 1;
+
         //
         // Indicates the peer transport parameters variable has been set.
         //
@@ -150,6 +164,37 @@ typedef union QUIC_CONNECTION_STATE {
         //
         BOOLEAN ResumptionEnabled : 1;
 
+        //
+        // Indicates the peer asked (via the ACK_FREQUENCY frame) that out of
+        // order packets not trigger an immediate acknowledgement.
+        //
+        BOOLEAN IgnoreReordering : 1;
+
+        //
+        // Indicates the app enabled the multipath extension, so it's offered
+        // to the peer.
+        //
+        BOOLEAN MultipathEnabled : 1;
+
+        //
+        // Indicates both endpoints support the multipath extension, so that
+        // all validated paths carry data concurrently.
+        //
+        BOOLEAN MultipathNegotiated : 1;
+
+        //
+        // The connection was closed locally without a closing period, so it
+        // completes its shutdown as soon as its close frame is sent.
+        //
+        BOOLEAN NoDrain : 1;
+
+        //
+        // Indicates both endpoints enabled integrity-only protection, so 1-RTT
+        // packet payloads are authenticated but not encrypted. Header
+        // protection still applies.
+        //
+        BOOLEAN IntegrityOnly : 1;
+
 #ifdef QuicVerifierEnabledByAddr
         //
         // The calling app is being verified (app or driver verifier).
@@ -168,6 +213,8 @@ typedef enum QUIC_CONNECTION_REF {
     QUIC_CONN_REF_LOOKUP_TABLE,         // Per registered CID.
     QUIC_CONN_REF_LOOKUP_RESULT,        // For connections returned from lookups.
     QUIC_CONN_REF_WORKER,               // Worker is (queued for) processing.
+    QUIC_CONN_REF_CRYPTO_OFFLOAD,       // Handshake offload is processing.
+    QUIC_CONN_REF_ADDR_RESOLUTION,      // Server name is being resolved.
 
     QUIC_CONN_REF_COUNT
 
@@ -220,6 +267,7 @@ typedef struct QUIC_CONN_STATS {
         uint32_t LastQueueTime;         // Time the connection last entered the work queue.
         uint64_t DrainCount;            // Sum of drain calls
         uint64_t OperationCount;        // Sum of operations processed
+        uint64_t TimeBudgetExceededCount; // Sum of drains cut short by the time budget
     } Schedule;
 
     struct {
@@ -239,6 +287,7 @@ typedef struct QUIC_CONN_STATS {
 
         uint32_t CongestionCount;
         uint32_t PersistentCongestionCount;
+        uint32_t SpuriousCongestionCount;
     } Send;
 
     struct {
@@ -248,6 +297,15 @@ typedef struct QUIC_CONN_STATS {
         uint64_t DuplicatePackets;
         uint64_t DecryptionFailures;    // Count of packets that failed to decrypt.
 
+        //
+        // Datagrams dropped before being queued on the connection, by reason.
+        //
+        uint64_t QueueFullDrops;        // Connection's receive queue was full.
+        uint64_t QueueOldEpochDrops;    // Undecryptable long header, under load.
+        uint64_t QueueWorkerLimitDrops; // Worker's receive queues were full.
+        uint64_t FlushCount;            // Receive queue flushes
+        uint32_t MaxFlushDatagrams;     // Most datagrams taken by one flush
+
         uint64_t TotalBytes;            // Sum of UDP payloads
         uint64_t TotalStreamBytes;      // Sum of stream payloads
     } Recv;
@@ -256,8 +314,113 @@ typedef struct QUIC_CONN_STATS {
         uint32_t KeyUpdateCount;        // Count of key updates completed.
     } Misc;
 
+    //
+    // Cumulative time sending was blocked, by QUIC_FLOW_BLOCKED_* reason. The
+    // open interval of a connection-level reason is added whenever the set of
+    // timed reasons changes; a stream's when its flow control block is lifted.
+    //
+    struct {
+        uint64_t LastUpdate;            // Time the timed reasons last changed.
+        uint64_t CongestionControl;
+        uint64_t Pacing;
+        uint64_t AmplificationProt;
+        uint64_t ConnFlowControl;
+        uint64_t StreamFlowControl;     // Summed across streams.
+        uint64_t App;                   // Nothing left to send.
+    } Blocked;
+
+    //
+    // Time (in us) the worker spent processing the connection's operations,
+    // and the parts of it spent in TLS and in app callbacks.
+    //
+    struct {
+        uint64_t TotalTime;
+        uint64_t CryptoTime;
+        uint64_t CallbackTime;
+    } Processing;
+
 } QUIC_CONN_STATS;
 
+//
+// Per connection histograms, in the same format as QUIC_HISTOGRAM. The counts
+// are only 32-bit to keep the connection small; they saturate instead of
+// wrapping.
+//
+typedef struct QUIC_CONN_HISTOGRAMS {
+
+    uint32_t Rtt[QUIC_HISTOGRAM_BUCKET_COUNT];
+    uint32_t AckDelay[QUIC_HISTOGRAM_BUCKET_COUNT];
+    uint32_t QueueDelay[QUIC_HISTOGRAM_BUCKET_COUNT];
+    uint32_t CallbackTime[QUIC_HISTOGRAM_BUCKET_COUNT];
+    uint32_t SendBatchSize[QUIC_HISTOGRAM_BUCKET_COUNT];
+
+} QUIC_CONN_HISTOGRAMS;
+
+//
+// Counts a sample (in microseconds) in its histogram bucket.
+//
+inline
+void
+QuicHistogramAddSample(
+    _Inout_updates_(QUIC_HISTOGRAM_BUCKET_COUNT) uint32_t* Buckets,
+    _In_ uint64_t Value
+    )
+{
+    uint32_t Index = 0;
+    while (Value != 0 && Index < QUIC_HISTOGRAM_BUCKET_COUNT - 1) {
+        Value >>= 1;
+        Index++;
+    }
+    if (Buckets[Index] != UINT32_MAX) {
+        Buckets[Index]++;
+    }
+}
+
+//
+// Atomically adds a connection histogram's counts to the totals.
+//
+inline
+void
+QuicHistogramAggregate(
+    _Inout_ QUIC_HISTOGRAM* Total,
+    _In_reads_(QUIC_HISTOGRAM_BUCKET_COUNT) const uint32_t* Buckets
+    )
+{
+    for (uint32_t i = 0; i < QUIC_HISTOGRAM_BUCKET_COUNT; ++i) {
+        if (Buckets[i] != 0) {
+            InterlockedExchangeAdd64(
+                (int64_t*)&Total->Buckets[i],
+                (int64_t)Buckets[i]);
+        }
+    }
+}
+
+//
+// State for resolving a client's server name off the worker thread.
+//
+typedef struct QUIC_CONN_RESOLVE_CONTEXT {
+
+    struct QUIC_CONNECTION* Connection;
+
+    //
+    // Preallocated so that queuing the completion can't fail.
+    //
+    QUIC_OPERATION* Oper;
+
+    QUIC_STATUS Status;
+    QUIC_ADDRESS_FAMILY Family;
+    uint16_t ServerPort; // Host byte order
+    BOOLEAN UseResolverCache;
+
+    //
+    // Owned until handed off to the connection.
+    //
+    const char* ServerName;
+
+    QUIC_DATAPATH_RESOLUTION Resolution;
+
+} QUIC_CONN_RESOLVE_CONTEXT;
+
 //
 // Connection-specific state.
 //   N.B. In general, all variables should only be written on the QUIC worker
@@ -272,6 +435,11 @@ typedef struct QUIC_CONNECTION {
     //
     QUIC_LIST_ENTRY SessionLink;
 
+    //
+    // Index of the session's connection list the connection is in.
+    //
+    uint8_t SessionShard;
+
     //
     // Link in the worker's connection queue.
     // N.B. Multi-threaded access, synchronized by worker's connection lock.
@@ -361,6 +529,66 @@ typedef struct QUIC_CONNECTION {
     BOOLEAN WorkerProcessing : 1;
     BOOLEAN HasQueuedWork : 1;
 
+    //
+    // Indicates the (server) connection counts against its worker's
+    // HandshakeCount, until the handshake is confirmed.
+    //
+    BOOLEAN InHandshakeCount;
+
+    //
+    // The connection's slot in the shared memory stats region, if it has one,
+    // and whether it already tried to claim one.
+    //
+    BOOLEAN StatsSlotAttempted;
+    QUIC_STATS_REGION_CONNECTION* StatsSlot;
+
+    //
+    // Indicates the client sent 0-RTT with its first flight, so it's resuming
+    // and the handshake is admitted ahead of full handshakes.
+    //
+    BOOLEAN HandshakeIsResumption;
+
+    //
+    // Indicates the app opted the connection into its worker's latency lane,
+    // which is drained ahead of the other connections.
+    //
+    BOOLEAN LatencySensitive;
+
+    //
+    // Serves the connection's streams and send requests, when enabled.
+    //
+    QUIC_CONN_ARENA Arena;
+
+    //
+    // Indicates the app opted into QUIC_CONNECTION_EVENT_RECEIVE_BATCH, in
+    // place of the streams' own receive events.
+    //
+    BOOLEAN ReceiveBatchEnabled;
+
+    //
+    // Indicates a FLUSH_STREAM_RECV operation for the receive batch is queued.
+    //
+    BOOLEAN RecvBatchFlushQueued;
+
+    //
+    // The streams with data waiting for the next receive batch, and the
+    // scratch space for the event (allocated when the batch is enabled).
+    //
+    QUIC_LIST_ENTRY RecvBatchStreams;
+    QUIC_RECV_BATCH* RecvBatch;
+
+    //
+    // The streams with send completions batched during the current pass of
+    // ACK processing.
+    //
+    QUIC_LIST_ENTRY SendCompleteBatchStreams;
+
+    //
+    // Indicates verbose logs and packet level events are written for this
+    // connection. Decided once, at allocation, by QuicLibraryIsConnTraceSampled.
+    //
+    BOOLEAN TraceSampled;
+
     //
     // Set of current reasons sending more packets is currently blocked.
     //
@@ -372,12 +600,35 @@ typedef struct QUIC_CONNECTION {
     //
     uint8_t AckDelayExponent;
 
+    //
+    // The number of ACK eliciting packets to receive before sending an ACK
+    // immediately. May be updated by the peer with an ACK_FREQUENCY frame.
+    //
+    uint8_t PacketTolerance;
+
+    //
+    // The packet tolerance most recently requested of the peer with an
+    // ACK_FREQUENCY frame.
+    //
+    uint8_t PeerPacketTolerance;
+
     //
     // Maximum amount of time the connection waits before acknowledging a
-    // received packet.
+    // received packet. May be updated by the peer with an ACK_FREQUENCY frame.
     //
     uint32_t MaxAckDelayMs;
 
+    //
+    // The smallest sequence number of an ACK_FREQUENCY frame that will still
+    // be processed. Older (reordered) frames are ignored.
+    //
+    uint64_t NextRecvAckFreqSeqNum;
+
+    //
+    // The sequence number to use for the next ACK_FREQUENCY frame sent.
+    //
+    uint64_t SendAckFreqSeqNum;
+
     //
     // The idle timeout period (in milliseconds).
     //
@@ -388,6 +639,15 @@ typedef struct QUIC_CONNECTION {
     //
     uint64_t HandshakeIdleTimeoutMs;
 
+    //
+    // The idle timeout currently in effect (in microseconds), and the time of
+    // the last activity that reset it. The idle and keep alive timers aren't
+    // re-armed on every activity: when they fire, they check the time of the
+    // last activity and re-arm for the remaining time if needed.
+    //
+    uint64_t IdleTimeoutUs;
+    uint64_t LastActivityTimeUs;
+
     //
     // The number of microseconds that must elapse before the connection will be
     // considered 'ACK idle' and disconnects.
@@ -399,6 +659,18 @@ typedef struct QUIC_CONNECTION {
     //
     uint32_t KeepAliveIntervalMs;
 
+    //
+    // The time (in milliseconds) without any stream data sent or received
+    // after which the connection hibernates. Zero to disable.
+    //
+    uint32_t HibernateTimeoutMs;
+
+    //
+    // The total stream bytes sent and received when the hibernate timer was
+    // last (re)started. UINT64_MAX when the timer isn't running.
+    //
+    uint64_t HibernateStreamBytes;
+
     //
     // The sequence number to use for the next source CID.
     //
@@ -417,6 +689,20 @@ typedef struct QUIC_CONNECTION {
     //
     QUIC_PATH Paths[QUIC_MAX_PATH_COUNT];
 
+    //
+    // A server connection's own connected binding, opened on request for a
+    // long-lived flow. Only receives; the CIDs and sends stay on the path's
+    // binding.
+    //
+    QUIC_BINDING* DedicatedBinding;
+
+    //
+    // The binding and remote address the 1-RTT keys are registered with, if
+    // the datapath protects this connection's short header packets inline.
+    //
+    QUIC_BINDING* CryptoOffloadBinding;
+    QUIC_ADDR CryptoOffloadRemoteAddress;
+
     //
     // The list of connection IDs used for receiving.
     //
@@ -475,6 +761,12 @@ typedef struct QUIC_CONNECTION {
     _Field_z_
     const char* RemoteServerName;
 
+    //
+    // The server's address in the other address family, valid only while
+    // State.FallbackAddressSet is set.
+    //
+    QUIC_ADDR FallbackRemoteAddress;
+
     //
     // The entry into the remote hash lookup table, which is used only during the
     // handshake.
@@ -539,10 +831,21 @@ typedef struct QUIC_CONNECTION {
     //
     QUIC_TRANSPORT_PARAMETERS* HandshakeTP;
 
+    //
+    // (Server-only) A resumption ticket sent with
+    // QUIC_SEND_RESUMPTION_FLAG_DEFER, waiting for the connection to be idle.
+    // Only the last one deferred is kept.
+    //
+    BOOLEAN DeferredTicketPending;
+    BOOLEAN DeferredTicketFinal;
+    uint16_t DeferredTicketAppDataLength;
+    uint8_t* DeferredTicketAppData;
+
     //
     // Statistics
     //
     QUIC_CONN_STATS Stats;
+    QUIC_CONN_HISTOGRAMS Histograms;
 
     //
     // Mostly test specific state.
@@ -656,7 +959,7 @@ inline
 _Ret_notnull_
 QUIC_CONNECTION*
 QuicCongestionControlGetConnection(
-    _In_ QUIC_CONGESTION_CONTROL* Cc
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
     )
 {
     return QUIC_CONTAINING_RECORD(Cc, QUIC_CONNECTION, CongestionControl);
@@ -698,22 +1001,7 @@ QuicConnLogOutFlowStats(
         return;
     }
 
-    const QUIC_PATH* Path = &Connection->Paths[0];
-    UNREFERENCED_PARAMETER(Path);
-
-    QuicTraceEvent(
-        ConnOutFlowStats,
-        "[conn][%p] OUT: BytesSent=%llu InFlight=%u InFlightMax=%u CWnd=%u SSThresh=%u ConnFC=%llu ISB=%llu PostedBytes=%llu SRtt=%u",
-        Connection,
-        Connection->Stats.Send.TotalBytes,
-        Connection->CongestionControl.BytesInFlight,
-        Connection->CongestionControl.BytesInFlightMax,
-        Connection->CongestionControl.CongestionWindow,
-        Connection->CongestionControl.SlowStartThreshold,
-        Connection->Send.PeerMaxData - Connection->Send.OrderedStreamBytesSent,
-        Connection->SendBuffer.IdealBytes,
-        Connection->SendBuffer.PostedBytes,
-        Path->GotFirstRttSample ? Path->SmoothedRtt : 0);
+    QuicCongestionControlLogOutFlowStatus(&Connection->CongestionControl);
 
     uint64_t FcAvailable, SendWindow;
     QuicStreamSetGetFlowControlSummary(
@@ -774,6 +1062,58 @@ QuicConnLogStatistics(
         Connection->Stats.Recv.DroppedPackets,
         Connection->Stats.Recv.DuplicatePackets,
         Connection->Stats.Recv.DecryptionFailures);
+
+    QuicTraceLogConnInfo(
+        BlockedTime,
+        Connection,
+        "STATS: BlockedUs CC=%llu Pacing=%llu Amplification=%llu ConnFC=%llu StreamFC=%llu App=%llu",
+        Connection->Stats.Blocked.CongestionControl,
+        Connection->Stats.Blocked.Pacing,
+        Connection->Stats.Blocked.AmplificationProt,
+        Connection->Stats.Blocked.ConnFlowControl,
+        Connection->Stats.Blocked.StreamFlowControl,
+        Connection->Stats.Blocked.App);
+}
+
+//
+// The connection-level blocked reasons whose time is accounted in
+// Stats.Blocked.
+//
+#define QUIC_CONN_TIMED_BLOCKED_REASONS \
+    (QUIC_FLOW_BLOCKED_PACING | QUIC_FLOW_BLOCKED_AMPLIFICATION_PROT | \
+     QUIC_FLOW_BLOCKED_CONGESTION_CONTROL | QUIC_FLOW_BLOCKED_CONN_FLOW_CONTROL | \
+     QUIC_FLOW_BLOCKED_APP)
+
+//
+// Adds the time since the last update to each currently timed blocked reason.
+//
+inline
+void
+QuicConnUpdateBlockedTime(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    uint64_t Now = QuicTimeUs64();
+    uint8_t Reasons = Connection->OutFlowBlockedReasons;
+    if (Reasons & QUIC_CONN_TIMED_BLOCKED_REASONS) {
+        uint64_t Elapsed = QuicTimeDiff64(Connection->Stats.Blocked.LastUpdate, Now);
+        if (Reasons & QUIC_FLOW_BLOCKED_PACING) {
+            Connection->Stats.Blocked.Pacing += Elapsed;
+        }
+        if (Reasons & QUIC_FLOW_BLOCKED_AMPLIFICATION_PROT) {
+            Connection->Stats.Blocked.AmplificationProt += Elapsed;
+        }
+        if (Reasons & QUIC_FLOW_BLOCKED_CONGESTION_CONTROL) {
+            Connection->Stats.Blocked.CongestionControl += Elapsed;
+        }
+        if (Reasons & QUIC_FLOW_BLOCKED_CONN_FLOW_CONTROL) {
+            Connection->Stats.Blocked.ConnFlowControl += Elapsed;
+        }
+        if (Reasons & QUIC_FLOW_BLOCKED_APP) {
+            Connection->Stats.Blocked.App += Elapsed;
+        }
+    }
+    Connection->Stats.Blocked.LastUpdate = Now;
 }
 
 inline
@@ -784,6 +1124,9 @@ QuicConnAddOutFlowBlockedReason(
     )
 {
     if (!(Connection->OutFlowBlockedReasons & Reason)) {
+        if (Reason & ~Connection->OutFlowBlockedReasons & QUIC_CONN_TIMED_BLOCKED_REASONS) {
+            QuicConnUpdateBlockedTime(Connection);
+        }
         Connection->OutFlowBlockedReasons |= Reason;
         QuicTraceEvent(
             ConnOutFlowBlocked,
@@ -803,6 +1146,9 @@ QuicConnRemoveOutFlowBlockedReason(
     )
 {
     if ((Connection->OutFlowBlockedReasons & Reason)) {
+        if (Reason & Connection->OutFlowBlockedReasons & QUIC_CONN_TIMED_BLOCKED_REASONS) {
+            QuicConnUpdateBlockedTime(Connection);
+        }
         Connection->OutFlowBlockedReasons &= ~Reason;
         QuicTraceEvent(
             ConnOutFlowBlocked,
@@ -919,11 +1265,14 @@ QuicConnRelease(
             QUIC_TEL_ASSERT(Connection->RefTypeCount[i] == 0);
         }
 #endif
-        if (Ref == QUIC_CONN_REF_LOOKUP_RESULT) {
+        if (Ref == QUIC_CONN_REF_LOOKUP_RESULT ||
+            Ref == QUIC_CONN_REF_CRYPTO_OFFLOAD) {
             //
             // Lookup results cannot be the last ref, as they can result in the
             // datapath binding being deleted on a callback. Instead, queue the
-            // connection to be released by the worker.
+            // connection to be released by the worker. The same goes for the
+            // handshake offload threads, which must not free the connection
+            // out from under its worker.
             //
             QUIC_DBG_ASSERT(Connection->Worker != NULL);
             QuicWorkerQueueConnection(Connection->Worker, Connection);
@@ -1012,6 +1361,16 @@ QuicConnGenerateNewSourceCids(
     _In_ BOOLEAN ReplaceExistingCids
     );
 
+//
+// Returns a destination connection ID the peer provided that isn't in use
+// yet, or NULL if there is none.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_CID_QUIC_LIST_ENTRY*
+QuicConnGetUnusedDestCid(
+    _In_ const QUIC_CONNECTION* Connection
+    );
+
 //
 // Retires the currently used destination connection ID.
 //
@@ -1087,7 +1446,7 @@ QuicConnGetSourceCidFromBuf(
                 QUIC_CID_HASH_ENTRY,
                 Link);
         if (CidLength == SourceCid->CID.Length &&
-            memcmp(CidBuffer, SourceCid->CID.Data, CidLength) == 0) {
+            QuicCidDataEqual(CidBuffer, SourceCid->CID.Data, CidLength)) {
             return SourceCid;
         }
     }
@@ -1146,6 +1505,17 @@ QuicConnTimerSet(
     _In_ uint64_t DelayMs
     );
 
+//
+// Sets a new timer delay in microseconds.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnTimerSetUs(
+    _Inout_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_CONN_TIMER_TYPE Type,
+    _In_ uint64_t DelayUs
+    );
+
 //
 // Cancels a timer.
 //
@@ -1330,6 +1700,29 @@ QuicConnResetIdleTimeout(
     _In_ QUIC_CONNECTION* Connection
     );
 
+//
+// Arms the keep alive timer to expire around (never after) Deadline, aligned
+// with the keep alives of the worker's other connections.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicConnSetKeepAliveTimer(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ uint64_t TimeNow,
+    _In_ uint64_t Deadline
+    );
+
+//
+// Processes an expired keep alive timer. Returns TRUE if a PING needs to be
+// sent.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicConnProcessKeepAliveTimer(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ uint64_t TimeNow
+    );
+
 //
 // Queues a received UDP datagram chain to a connection for processing.
 //
@@ -1341,6 +1734,17 @@ QuicConnQueueRecvDatagrams(
     _In_ uint32_t DatagramChainLength
     );
 
+//
+// Returns a chain of received datagrams the connection is done with to the
+// datapath. Datagrams that streams still reference for zero-copy receive are
+// left for the last of those streams to return.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicConnReleaseRecvDatagrams(
+    _In_ QUIC_RECV_DATAGRAM* DatagramChain
+    );
+
 //
 // Queues an unreachable event to a connection for processing.
 //
@@ -33,9 +33,8 @@ QuicCryptoDumpSendState(
     _In_ QUIC_CRYPTO* Crypto
     )
 {
-    if (QuicTraceLogVerboseEnabled()) {
-
-        QUIC_CONNECTION* Connection = QuicCryptoGetConnection(Crypto);
+    QUIC_CONNECTION* Connection = QuicCryptoGetConnection(Crypto);
+    if (QuicTraceLogVerboseEnabled() && Connection->TraceSampled) {
 
         QuicTraceLogConnVerbose(
             CryptoDump,
@@ -149,7 +148,8 @@ QuicCryptoInitialize(
             &Crypto->RecvBuffer,
             InitialRecvBufferLength,
             QUIC_DEFAULT_STREAM_FC_WINDOW_SIZE / 2,
-            TRUE);
+            TRUE,
+            NULL);
     if (QUIC_FAILED(Status)) {
         goto Exit;
     }
@@ -231,12 +231,17 @@ QuicCryptoUninitialize(
     _In_ QUIC_CRYPTO* Crypto
     )
 {
+    if (Crypto->Offload != NULL) {
+        QuicCryptoOffloadFree(Crypto);
+    }
     for (uint8_t i = 0; i < QUIC_PACKET_KEY_COUNT; ++i) {
         QuicPacketKeyFree(Crypto->TlsState.ReadKeys[i]);
         Crypto->TlsState.ReadKeys[i] = NULL;
         QuicPacketKeyFree(Crypto->TlsState.WriteKeys[i]);
         Crypto->TlsState.WriteKeys[i] = NULL;
     }
+    QuicPacketKeyFree(Crypto->HelperReadKey);
+    Crypto->HelperReadKey = NULL;
     if (Crypto->TLS != NULL) {
         QuicTlsUninitialize(Crypto->TLS);
         Crypto->TLS = NULL;
@@ -244,8 +249,10 @@ QuicCryptoUninitialize(
     if (Crypto->Initialized) {
         QuicRecvBufferUninitialize(&Crypto->RecvBuffer);
         QuicRangeUninitialize(&Crypto->SparseAckRanges);
-        QUIC_FREE(Crypto->TlsState.Buffer);
-        Crypto->TlsState.Buffer = NULL;
+        if (Crypto->TlsState.Buffer != NULL) {
+            QUIC_FREE(Crypto->TlsState.Buffer);
+            Crypto->TlsState.Buffer = NULL;
+        }
         Crypto->Initialized = FALSE;
     }
 }
@@ -360,12 +367,28 @@ QuicCryptoHandshakeConfirmed(
 {
     QUIC_CONNECTION* Connection = QuicCryptoGetConnection(Crypto);
     Connection->State.HandshakeConfirmed = TRUE;
+    QuicTraceProbe(handshake_confirmed, Connection, QuicConnIsServer(Connection));
 
     QUIC_PATH* Path = &Connection->Paths[0];
     QUIC_DBG_ASSERT(Path->Binding != NULL);
     QuicBindingOnConnectionHandshakeConfirmed(Path->Binding, Connection);
+    QuicWorkerReleaseHandshake(Connection);
 
     QuicCryptoDiscardKeys(Crypto, QUIC_PACKET_KEY_HANDSHAKE);
+
+    //
+    // Key updates are allowed from now on, so have the keys ready.
+    //
+    QuicCryptoQueueGenerateNewKeys(Crypto);
+
+    QuicCryptoUpdateInlineOffload(Connection);
+
+    //
+    // With the Initial and Handshake packet spaces (and their data) gone, only
+    // resumption tickets still need the crypto buffers; release them if they
+    // are idle.
+    //
+    QuicCryptoReleaseIdleBuffers(Crypto);
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -428,9 +451,30 @@ QuicCryptoDiscardKeys(
         Crypto->NextSendOffset = BufferOffset;
     }
     if (Crypto->UnAckedOffset < BufferOffset) {
+        //
+        // The rest of the data at the discarded level will never be
+        // acknowledged, so drop it from the front of the send buffer.
+        //
+        uint32_t DrainLength = BufferOffset - Crypto->UnAckedOffset;
+        QUIC_DBG_ASSERT(DrainLength <= (uint32_t)Crypto->TlsState.BufferLength);
+        if ((uint32_t)Crypto->TlsState.BufferLength > DrainLength) {
+            Crypto->TlsState.BufferLength -= (uint16_t)DrainLength;
+            QuicMoveMemory(
+                Crypto->TlsState.Buffer,
+                Crypto->TlsState.Buffer + DrainLength,
+                Crypto->TlsState.BufferLength);
+        } else {
+            Crypto->TlsState.BufferLength = 0;
+        }
         Crypto->UnAckedOffset = BufferOffset;
         QuicRangeSetMin(&Crypto->SparseAckRanges, Crypto->UnAckedOffset);
     }
+    if (Crypto->RecoveryNextOffset < Crypto->UnAckedOffset) {
+        Crypto->RecoveryNextOffset = Crypto->UnAckedOffset;
+    }
+    if (Crypto->RecoveryEndOffset < Crypto->UnAckedOffset) {
+        Crypto->InRecovery = FALSE;
+    }
 
     if (HasAckElicitingPacketsToAcknowledge) {
         QuicSendUpdateAckState(&Connection->Send);
@@ -965,6 +1009,9 @@ QuicCryptoOnAck(
                 Crypto->UnAckedOffset == Crypto->TlsState.BufferTotalLength) {
                 QuicConnCleanupServerResumptionState(Connection);
             }
+            if (Crypto->TlsState.BufferLength == 0) {
+                QuicCryptoReleaseIdleBuffers(Crypto);
+            }
         }
 
     } else {
@@ -1147,6 +1194,23 @@ QuicConnReceiveTP(
     _In_reads_(TPLength) const uint8_t* TPBuffer
     )
 {
+    QUIC_CRYPTO_OFFLOAD* Offload = Connection->Crypto.Offload;
+    if (Offload != NULL) {
+        //
+        // Called on a handshake offload thread. The parameters are applied
+        // once the call completes back on the worker.
+        //
+        if (!QuicCryptoTlsDecodeTransportParameters(
+                Connection,
+                TPBuffer,
+                TPLength,
+                &Offload->PeerTransportParams)) {
+            return FALSE;
+        }
+        Offload->PeerTransportParamsReceived = TRUE;
+        return TRUE;
+    }
+
     if (!QuicCryptoTlsDecodeTransportParameters(
             Connection,
             TPBuffer,
@@ -1348,6 +1412,7 @@ QuicCryptoProcessTlsCompletion(
             ConnHandshakeComplete,
             "[conn][%p] Handshake complete",
             Connection);
+        QuicTraceProbe(handshake_complete, Connection, QuicConnIsServer(Connection));
 
         //
         // We should have the 1-RTT keys by connection complete time.
@@ -1373,6 +1438,7 @@ QuicCryptoProcessTlsCompletion(
         // CONNECTED event is indicated to the app).
         //
         Connection->State.Connected = TRUE;
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_CONN_CONNECTED);
 
         QuicConnGenerateNewSourceCids(Connection, FALSE);
 
@@ -1389,6 +1455,7 @@ QuicCryptoProcessTlsCompletion(
             QuicSessionServerCacheSetState(
                 Connection->Session,
                 Connection->RemoteServerName,
+                QuicAddrGetFamily(&Connection->Paths[0].RemoteAddress),
                 Connection->Stats.QuicVersion,
                 &Connection->PeerTransportParams,
                 SecConfig);
@@ -1412,6 +1479,13 @@ QuicCryptoProcessTlsCompletion(
             QUIC_TEL_ASSERT(Crypto->TlsState.NegotiatedAlpn != NULL);
         }
 
+        if (QuicConnIsServer(Connection) && Crypto->ClientHelloHasPsk) {
+            InterlockedIncrement64(
+                Crypto->TlsState.SessionResumed ?
+                    &Connection->Session->ResumptionsAccepted :
+                    &Connection->Session->ResumptionsRejected);
+        }
+
         QUIC_CONNECTION_EVENT Event;
         Event.Type = QUIC_CONNECTION_EVENT_CONNECTED;
         Event.CONNECTED.SessionResumed = Crypto->TlsState.SessionResumed;
@@ -1424,7 +1498,7 @@ QuicCryptoProcessTlsCompletion(
             Event.CONNECTED.SessionResumed);
         (void)QuicConnIndicateEvent(Connection, &Event);
 
-        QuicSendSetSendFlag(&Connection->Send, QUIC_CONN_SEND_FLAG_PMTUD);
+        QuicMtuDiscoveryNewSearch(Connection, &Connection->Paths[0]);
 
         if (QuicConnIsServer(Connection) &&
             Crypto->TlsState.BufferOffset1Rtt != 0 &&
@@ -1472,6 +1546,8 @@ QuicCryptoProcessDataComplete(
     if (Crypto->TlsDataPending && !Crypto->TlsCallPending) {
         QuicCryptoProcessData(Crypto, FALSE);
     }
+
+    QuicCryptoReleaseIdleBuffers(Crypto);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -1499,11 +1575,55 @@ QuicCryptoProcessCompleteOperation(
     )
 {
     uint32_t BufferConsumed = 0;
-    QUIC_TLS_RESULT_FLAGS ResultFlags =
-        QuicTlsProcessDataComplete(Crypto->TLS, &BufferConsumed);
+    QUIC_TLS_RESULT_FLAGS ResultFlags;
+    if (Crypto->Offload != NULL) {
+        ResultFlags = QuicCryptoOffloadComplete(Crypto, &BufferConsumed);
+    } else {
+        uint64_t StartTime = QuicTimeUs64();
+        ResultFlags = QuicTlsProcessDataComplete(Crypto->TLS, &BufferConsumed);
+        QuicCryptoGetConnection(Crypto)->Stats.Processing.CryptoTime +=
+            QuicTimeUs64() - StartTime;
+    }
+    if (ResultFlags == QUIC_TLS_RESULT_PENDING) {
+        //
+        // TLS is still waiting on an async operation and will indicate
+        // completion again.
+        //
+        return;
+    }
     QuicCryptoProcessDataComplete(Crypto, ResultFlags, BufferConsumed);
 }
 
+//
+// Allocates the TLS send buffer again if it was freed by
+// QuicCryptoReleaseIdleBuffers.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicCryptoReserveSendBuffer(
+    _In_ QUIC_CRYPTO* Crypto
+    )
+{
+    if (Crypto->TlsState.Buffer != NULL) {
+        return QUIC_STATUS_SUCCESS;
+    }
+
+    uint16_t SendBufferLength =
+        QuicConnIsServer(QuicCryptoGetConnection(Crypto)) ?
+            QUIC_MAX_TLS_SERVER_SEND_BUFFER : QUIC_MAX_TLS_CLIENT_SEND_BUFFER;
+    Crypto->TlsState.Buffer = QUIC_ALLOC_NONPAGED(SendBufferLength);
+    if (Crypto->TlsState.Buffer == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "crypto send buffer",
+            SendBufferLength);
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+    Crypto->TlsState.BufferAllocLength = SendBufferLength;
+    return QUIC_STATUS_SUCCESS;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicCryptoProcessData(
@@ -1513,6 +1633,7 @@ QuicCryptoProcessData(
 {
     uint32_t BufferCount = 1;
     QUIC_BUFFER Buffer;
+    BOOLEAN CanOffload = FALSE;
 
     QUIC_TEL_ASSERT(!Crypto->TlsCallPending);
 
@@ -1636,6 +1757,16 @@ QuicCryptoProcessData(
                 }
             }
         }
+
+        //
+        // Only the server's first flight, without a pre-shared key, is
+        // offloaded. That's where the (expensive) signing happens.
+        //
+        CanOffload =
+            BufferOffset == 0 &&
+            QuicConnIsServer(Connection) &&
+            !Crypto->ClientHelloHasPsk &&
+            MsQuicLib.CryptoOffloadPool != NULL;
     }
 
     if (Crypto->TLS == NULL) {
@@ -1646,13 +1777,30 @@ QuicCryptoProcessData(
         goto Error;
     }
 
+    if (QUIC_FAILED(QuicCryptoReserveSendBuffer(Crypto))) {
+        QuicConnFatalError(QuicCryptoGetConnection(Crypto), QUIC_STATUS_OUT_OF_MEMORY, NULL);
+        goto Error;
+    }
+
     Crypto->TlsDataPending = FALSE;
     Crypto->TlsCallPending = TRUE;
 
     QuicCryptoValidate(Crypto);
 
+    if (CanOffload &&
+        QuicCryptoOffloadStart(
+            MsQuicLib.CryptoOffloadPool,
+            Crypto,
+            Buffer.Buffer,
+            Buffer.Length)) {
+        return;
+    }
+
+    uint64_t StartTime = QuicTimeUs64();
     QUIC_TLS_RESULT_FLAGS ResultFlags =
         QuicTlsProcessData(Crypto->TLS, QUIC_TLS_CRYPTO_DATA, Buffer.Buffer, &Buffer.Length, &Crypto->TlsState);
+    QuicCryptoGetConnection(Crypto)->Stats.Processing.CryptoTime +=
+        QuicTimeUs64() - StartTime;
 
     QUIC_TEL_ASSERT(!IsClientInitial || ResultFlags != QUIC_TLS_RESULT_PENDING); // TODO - Support async for client Initial?
 
@@ -1683,6 +1831,11 @@ QuicCryptoProcessAppData(
         goto Error;
     }
 
+    Status = QuicCryptoReserveSendBuffer(Crypto);
+    if (QUIC_FAILED(Status)) {
+        goto Error;
+    }
+
     QUIC_TLS_RESULT_FLAGS ResultFlags =
         QuicTlsProcessData(Crypto->TLS, QUIC_TLS_TICKET_DATA, AppData, &DataLength, &Crypto->TlsState);
     if (ResultFlags & QUIC_TLS_RESULT_ERROR) {
@@ -1700,6 +1853,52 @@ Error:
     return Status;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_KEY*
+QuicCryptoGetHelperReadKey(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_CRYPTO* Crypto = &Connection->Crypto;
+    const QUIC_PACKET_KEY* ReadKey = Crypto->TlsState.ReadKeys[QUIC_PACKET_KEY_1_RTT];
+    QUIC_DBG_ASSERT(ReadKey != NULL && ReadKey->Type == QUIC_PACKET_KEY_1_RTT);
+
+    //
+    // The traffic secret identifies the key, whatever key updates happened
+    // since the copy was made.
+    //
+    if (Crypto->HelperReadKey != NULL &&
+        memcmp(
+            Crypto->HelperReadKey->TrafficSecret,
+            ReadKey->TrafficSecret,
+            sizeof(QUIC_SECRET)) != 0) {
+        QuicPacketKeyFree(Crypto->HelperReadKey);
+        Crypto->HelperReadKey = NULL;
+    }
+
+    if (Crypto->HelperReadKey == NULL) {
+        QUIC_STATUS Status =
+            QuicPacketKeyDerive(
+                QUIC_PACKET_KEY_1_RTT,
+                ReadKey->TrafficSecret,
+                "helper read",
+                FALSE,
+                &Crypto->HelperReadKey);
+        if (QUIC_FAILED(Status)) {
+            QuicTraceEvent(
+                ConnErrorStatus,
+                "[conn][%p] ERROR, %u, %s.",
+                Connection,
+                Status,
+                "Failed to derive helper read key");
+            Crypto->HelperReadKey = NULL;
+            return NULL;
+        }
+    }
+
+    return Crypto->HelperReadKey->PacketKey;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicCryptoGenerateNewKeys(
@@ -1763,6 +1962,55 @@ Error:
     return Status;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoQueueGenerateNewKeys(
+    _In_ QUIC_CRYPTO* Crypto
+    )
+{
+    if (Crypto->GenerateNewKeysPending) {
+        return;
+    }
+
+    QUIC_CONNECTION* Connection = QuicCryptoGetConnection(Crypto);
+    QUIC_OPERATION* Oper;
+    if ((Oper = QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_GENERATE_KEYS)) != NULL) {
+        Crypto->GenerateNewKeysPending = TRUE;
+        QuicConnQueueOper(Connection, Oper);
+    } else {
+        //
+        // Not fatal; the keys will be generated when they're needed instead.
+        //
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "Generate keys operation",
+            0);
+    }
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoProcessGenerateNewKeysOperation(
+    _In_ QUIC_CRYPTO* Crypto
+    )
+{
+    Crypto->GenerateNewKeysPending = FALSE;
+
+    QUIC_CONNECTION* Connection = QuicCryptoGetConnection(Crypto);
+    if (Connection->State.ClosedLocally || Connection->State.ClosedRemotely ||
+        Crypto->TlsState.ReadKeys[QUIC_PACKET_KEY_1_RTT] == NULL ||
+        Crypto->TlsState.WriteKeys[QUIC_PACKET_KEY_1_RTT] == NULL) {
+        return;
+    }
+
+    //
+    // Failure is ignored here (it's already logged); the keys will be
+    // generated again when a key update actually needs them.
+    //
+    (void)QuicCryptoGenerateNewKeys(Connection);
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicCryptoUpdateKeyPhase(
@@ -1839,4 +2087,117 @@ QuicCryptoUpdateKeyPhase(
     PacketSpace->AwaitingKeyPhaseConfirmation = TRUE;
 
     PacketSpace->CurrentKeyPhaseBytesSent = 0;
+
+    //
+    // Derive the keys for the following phase off the hot path.
+    //
+    QuicCryptoQueueGenerateNewKeys(&Connection->Crypto);
+
+    QuicCryptoUpdateInlineOffload(Connection);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoUpdateInlineOffload(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_PATH* Path = &Connection->Paths[0];
+    const QUIC_PACKET_KEY* ReadKey =
+        Connection->Crypto.TlsState.ReadKeys[QUIC_PACKET_KEY_1_RTT];
+    const QUIC_PACKET_KEY* WriteKey =
+        Connection->Crypto.TlsState.WriteKeys[QUIC_PACKET_KEY_1_RTT];
+
+    //
+    // Integrity-only packets aren't AEAD protected the way the NIC expects,
+    // so they always stay in software.
+    //
+    if (!Connection->State.HandshakeConfirmed ||
+        !Connection->State.EncryptionEnabled ||
+        !Connection->State.HeaderProtectionEnabled ||
+        Connection->State.IntegrityOnly ||
+        Connection->State.ClosedLocally || Connection->State.ClosedRemotely ||
+        Path->Binding == NULL || ReadKey == NULL || WriteKey == NULL ||
+        !(QuicDataPathGetSupportedFeatures(MsQuicLib.Datapath) &
+            QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD)) {
+        return;
+    }
+
+    if (Connection->CryptoOffloadBinding != NULL &&
+        (Connection->CryptoOffloadBinding != Path->Binding ||
+         !QuicAddrCompare(&Connection->CryptoOffloadRemoteAddress, &Path->RemoteAddress))) {
+        //
+        // The active path moved; the old registration no longer applies.
+        //
+        QuicCryptoClearInlineOffload(Connection);
+    }
+
+    QUIC_DATAPATH_CRYPTO_OFFLOAD Offload;
+    Offload.ReadSecret = ReadKey->TrafficSecret;
+    Offload.WriteSecret = WriteKey->TrafficSecret;
+    Offload.KeyPhase =
+        Connection->Packets[QUIC_ENCRYPT_LEVEL_1_RTT]->CurrentKeyPhase;
+    Offload.CidLength =
+        Path->Binding->Exclusive ? 0 : MsQuicLib.CidTotalLength;
+
+    QUIC_STATUS Status =
+        QuicDataPathBindingSetCryptoOffload(
+            Path->Binding->DatapathBinding,
+            &Path->RemoteAddress,
+            &Offload);
+    if (QUIC_FAILED(Status)) {
+        //
+        // Not fatal; packets are simply protected in software instead.
+        //
+        QuicTraceLogConnWarning(
+            CryptoOffloadFailed,
+            Connection,
+            "Inline crypto offload registration failed, 0x%x",
+            Status);
+        QuicCryptoClearInlineOffload(Connection);
+        return;
+    }
+
+    Connection->CryptoOffloadBinding = Path->Binding;
+    Connection->CryptoOffloadRemoteAddress = Path->RemoteAddress;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoClearInlineOffload(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    if (Connection->CryptoOffloadBinding == NULL) {
+        return;
+    }
+
+    (void)QuicDataPathBindingSetCryptoOffload(
+        Connection->CryptoOffloadBinding->DatapathBinding,
+        &Connection->CryptoOffloadRemoteAddress,
+        NULL);
+    Connection->CryptoOffloadBinding = NULL;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoReleaseIdleBuffers(
+    _In_ QUIC_CRYPTO* Crypto
+    )
+{
+    QUIC_CONNECTION* Connection = QuicCryptoGetConnection(Crypto);
+    if (!Crypto->Initialized ||
+        !Connection->State.HandshakeConfirmed ||
+        Crypto->TlsCallPending ||
+        Crypto->Offload != NULL) {
+        return;
+    }
+
+    if (Crypto->TlsState.Buffer != NULL && Crypto->TlsState.BufferLength == 0) {
+        QUIC_FREE(Crypto->TlsState.Buffer);
+        Crypto->TlsState.Buffer = NULL;
+        Crypto->TlsState.BufferAllocLength = 0;
+    }
+
+    (void)QuicRecvBufferRelease(&Crypto->RecvBuffer);
 }
@@ -35,11 +35,35 @@ typedef struct QUIC_CRYPTO {
     //
     BOOLEAN TlsCallPending : 1;
 
+    //
+    // Indicates the (server) received ClientHello offered a pre-shared key,
+    // i.e. the handshake is a resumption attempt.
+    //
+    BOOLEAN ClientHelloHasPsk : 1;
+
+    //
+    // Indicates an operation to derive the next key phase's keys is queued.
+    //
+    BOOLEAN GenerateNewKeysPending : 1;
+
     //
     // The TLS context for processing handshake messages.
     //
     QUIC_TLS* TLS;
 
+    //
+    // The outstanding request, if the TLS call is currently being processed
+    // by the handshake offload pool.
+    //
+    QUIC_CRYPTO_OFFLOAD* Offload;
+
+    //
+    // A second copy of the current 1-RTT read key, derived from the same
+    // traffic secret, so a decrypt helper thread has its own cipher context
+    // to use while the worker uses the original. Only created when needed.
+    //
+    QUIC_PACKET_KEY* HelperReadKey;
+
     //
     // Send State
     //
@@ -280,6 +304,46 @@ QuicCryptoGenerateNewKeys(
     _In_ QUIC_CONNECTION* Connection
     );
 
+//
+// Queues an operation to generate the next 1-RTT keys ahead of time, so that
+// a key update doesn't need to derive them on the packet that triggers it.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoQueueGenerateNewKeys(
+    _In_ QUIC_CRYPTO* Crypto
+    );
+
+//
+// Processes the operation queued by QuicCryptoQueueGenerateNewKeys.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoProcessGenerateNewKeysOperation(
+    _In_ QUIC_CRYPTO* Crypto
+    );
+
+//
+// Returns the copy of the current 1-RTT read key for a decrypt helper to use,
+// deriving it again if the read key changed since. Returns NULL on failure.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_KEY*
+QuicCryptoGetHelperReadKey(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
+//
+// Frees the TLS send and receive buffers while they hold no data, once the
+// handshake is confirmed. Any later TLS data (i.e. resumption tickets) will
+// allocate them again.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoReleaseIdleBuffers(
+    _In_ QUIC_CRYPTO* Crypto
+    );
+
 //
 // Shift 1-RTT keys, freeing the old keys and replacing them with the current
 // keys, replacing the current keys with the new keys; update the start packet
@@ -293,3 +357,23 @@ QuicCryptoUpdateKeyPhase (
     _In_ QUIC_CONNECTION* Connection,
     _In_ BOOLEAN LocalUpdate
     );
+
+//
+// Registers the current 1-RTT keys with the active path's binding, if the
+// datapath supports inline crypto offload, replacing any previous
+// registration.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoUpdateInlineOffload(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
+//
+// Removes the connection's 1-RTT keys from the datapath, if registered.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoClearInlineOffload(
+    _In_ QUIC_CONNECTION* Connection
+    );
@@ -0,0 +1,375 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    The handshake offload pool moves the (expensive) TLS processing of a
+    server's first handshake flight off of the worker threads. The worker
+    hands the ClientHello to the pool along with a private copy of the TLS
+    state, and an offload thread calls TLS with it. When done, the completion
+    is queued back to the connection's worker as a regular TLS complete
+    operation, where the output is merged back into the connection.
+
+    While a request is outstanding, the connection's TLS call is pending, so
+    nothing else on the worker touches the TLS context. Anything TLS calls back
+    into the connection for (i.e. the peer's transport parameters) is stashed
+    in the request and applied on the worker.
+
+    Only handshakes without a pre-shared key are offloaded. Resumed handshakes
+    don't do any signing, so there's little to gain, and accepting a
+    resumption ticket calls into the app, which must happen on the worker.
+
+--*/
+
+#include "precomp.h"
+#ifdef QUIC_CLOG
+#include "crypto_offload.c.clog.h"
+#endif
+
+QUIC_THREAD_CALLBACK(QuicCryptoOffloadThread, Context);
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicCryptoOffloadPoolInitialize(
+    _In_ uint16_t ThreadCount,
+    _Out_ QUIC_CRYPTO_OFFLOAD_POOL** NewPool
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    const size_t PoolSize =
+        sizeof(QUIC_CRYPTO_OFFLOAD_POOL) + ThreadCount * sizeof(QUIC_THREAD);
+
+    QUIC_CRYPTO_OFFLOAD_POOL* Pool = QUIC_ALLOC_NONPAGED(PoolSize);
+    if (Pool == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_CRYPTO_OFFLOAD_POOL",
+            PoolSize);
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    QuicZeroMemory(Pool, PoolSize);
+    Pool->Enabled = TRUE;
+    QuicDispatchLockInitialize(&Pool->Lock);
+    QuicListInitializeHead(&Pool->Requests);
+    QuicEventInitialize(&Pool->Ready, FALSE, FALSE);
+
+    for (uint16_t i = 0; i < ThreadCount; ++i) {
+        QUIC_THREAD_CONFIG ThreadConfig = {
+            0,
+            (uint8_t)(i % QuicProcActiveCount()),
+            "quic_hs_offload",
+            QuicCryptoOffloadThread,
+            Pool
+        };
+        Status = QuicThreadCreate(&ThreadConfig, &Pool->Threads[i]);
+        if (QUIC_FAILED(Status)) {
+            QuicTraceEvent(
+                LibraryErrorStatus,
+                "[ lib] ERROR, %u, %s.",
+                Status,
+                "QuicThreadCreate (handshake offload)");
+            break;
+        }
+        Pool->ThreadCount++;
+    }
+
+    if (QUIC_FAILED(Status)) {
+        QuicCryptoOffloadPoolUninitialize(Pool);
+        return Status;
+    }
+
+    QuicTraceLogInfo(
+        CryptoOffloadPoolCreated,
+        "[ lib] Handshake offload pool created with %hu threads",
+        ThreadCount);
+
+    *NewPool = Pool;
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoOffloadPoolUninitialize(
+    _In_ QUIC_CRYPTO_OFFLOAD_POOL* Pool
+    )
+{
+    //
+    // The threads drain the queue before exiting, so that every queued
+    // request still completes (and releases its connection reference).
+    //
+    QuicDispatchLockAcquire(&Pool->Lock);
+    Pool->Enabled = FALSE;
+    QuicDispatchLockRelease(&Pool->Lock);
+    QuicEventSet(Pool->Ready);
+
+    for (uint16_t i = 0; i < Pool->ThreadCount; ++i) {
+        QuicThreadWait(&Pool->Threads[i]);
+        QuicThreadDelete(&Pool->Threads[i]);
+    }
+
+    QUIC_DBG_ASSERT(QuicListIsEmpty(&Pool->Requests));
+    QuicEventUninitialize(Pool->Ready);
+    QuicDispatchLockUninitialize(&Pool->Lock);
+    QUIC_FREE(Pool);
+}
+
+//
+// Runs the TLS call for a request on an offload thread and queues the
+// completion back to the worker.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoOffloadProcess(
+    _In_ QUIC_CRYPTO_OFFLOAD* Request
+    )
+{
+    QUIC_CONNECTION* Connection = Request->Connection;
+    QUIC_OPERATION* Oper = Request->CompletionOper;
+    uint32_t BufferLength = Request->InputLength;
+
+    QUIC_TLS_RESULT_FLAGS ResultFlags =
+        QuicTlsProcessData(
+            Connection->Crypto.TLS,
+            QUIC_TLS_CRYPTO_DATA,
+            Request->Input,
+            &BufferLength,
+            &Request->TlsState);
+
+    if (ResultFlags != QUIC_TLS_RESULT_PENDING) {
+        Request->ResultFlags = ResultFlags;
+        Request->BufferConsumed = BufferLength;
+        //
+        // The worker may complete (and free) the request as soon as the
+        // operation is queued, so it must not be touched after this.
+        //
+        QuicConnQueueOper(Connection, Oper);
+    } else {
+        //
+        // TLS will queue the completion itself once the call completes, and
+        // the request may already be gone.
+        //
+        QuicOperationFree(Connection->Worker, Oper);
+    }
+
+    QuicConnRelease(Connection, QUIC_CONN_REF_CRYPTO_OFFLOAD);
+}
+
+QUIC_THREAD_CALLBACK(QuicCryptoOffloadThread, Context)
+{
+    QUIC_CRYPTO_OFFLOAD_POOL* Pool = (QUIC_CRYPTO_OFFLOAD_POOL*)Context;
+
+    while (TRUE) {
+        QUIC_CRYPTO_OFFLOAD* Request = NULL;
+        QuicDispatchLockAcquire(&Pool->Lock);
+        BOOLEAN Enabled = Pool->Enabled;
+        BOOLEAN MoreRequests = FALSE;
+        if (!QuicListIsEmpty(&Pool->Requests)) {
+            Request =
+                QUIC_CONTAINING_RECORD(
+                    QuicListRemoveHead(&Pool->Requests), QUIC_CRYPTO_OFFLOAD, Link);
+            MoreRequests = !QuicListIsEmpty(&Pool->Requests);
+        }
+        QuicDispatchLockRelease(&Pool->Lock);
+
+        if (Request != NULL) {
+            if (MoreRequests) {
+                //
+                // Only one thread is woken per signal, so pass it on.
+                //
+                QuicEventSet(Pool->Ready);
+            }
+            QuicCryptoOffloadProcess(Request);
+        } else if (!Enabled) {
+            break;
+        } else {
+            QuicEventWaitForever(Pool->Ready);
+        }
+    }
+
+    //
+    // Wake up the next thread so it sees the pool is shutting down too.
+    //
+    QuicEventSet(Pool->Ready);
+
+    QUIC_THREAD_RETURN(QUIC_STATUS_SUCCESS);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicCryptoOffloadStart(
+    _In_ QUIC_CRYPTO_OFFLOAD_POOL* Pool,
+    _In_ QUIC_CRYPTO* Crypto,
+    _In_reads_(BufferLength)
+        const uint8_t* Buffer,
+    _In_ uint32_t BufferLength
+    )
+{
+    QUIC_CONNECTION* Connection = QuicCryptoGetConnection(Crypto);
+    QUIC_DBG_ASSERT(Crypto->Offload == NULL);
+    QUIC_DBG_ASSERT(Crypto->TlsCallPending);
+
+    //
+    // TLS may only fill up what's left of the connection's send buffer, so
+    // that the output is guaranteed to fit when merged back.
+    //
+    const uint16_t OutputLength =
+        (uint16_t)(Crypto->TlsState.BufferAllocLength - Crypto->TlsState.BufferLength);
+    const size_t RequestSize =
+        sizeof(QUIC_CRYPTO_OFFLOAD) + BufferLength + OutputLength;
+
+    QUIC_CRYPTO_OFFLOAD* Request = QUIC_ALLOC_NONPAGED(RequestSize);
+    if (Request == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_CRYPTO_OFFLOAD",
+            RequestSize);
+        return FALSE;
+    }
+
+    Request->CompletionOper =
+        QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_TLS_COMPLETE);
+    if (Request->CompletionOper == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "TLS complete operation",
+            0);
+        QUIC_FREE(Request);
+        return FALSE;
+    }
+
+    Request->Connection = Connection;
+    Request->ResultFlags = QUIC_TLS_RESULT_PENDING;
+    Request->BufferConsumed = 0;
+    Request->PeerTransportParamsReceived = FALSE;
+    Request->TlsState = Crypto->TlsState;
+    Request->TlsState.Buffer = Request->Input + BufferLength;
+    Request->TlsState.BufferLength = 0;
+    Request->TlsState.BufferAllocLength = OutputLength;
+    Request->InputLength = BufferLength;
+    QuicCopyMemory(Request->Input, Buffer, BufferLength);
+
+    Crypto->Offload = Request;
+    QuicConnAddRef(Connection, QUIC_CONN_REF_CRYPTO_OFFLOAD);
+
+    QuicDispatchLockAcquire(&Pool->Lock);
+    BOOLEAN Enabled = Pool->Enabled;
+    if (Enabled) {
+        QuicListInsertTail(&Pool->Requests, &Request->Link);
+    }
+    QuicDispatchLockRelease(&Pool->Lock);
+
+    if (!Enabled) {
+        Crypto->Offload = NULL;
+        QuicConnRelease(Connection, QUIC_CONN_REF_CRYPTO_OFFLOAD);
+        QuicOperationFree(Connection->Worker, Request->CompletionOper);
+        QUIC_FREE(Request);
+        return FALSE;
+    }
+
+    QuicTraceLogConnVerbose(
+        CryptoOffloadQueued,
+        Connection,
+        "Offloading %u crypto bytes",
+        BufferLength);
+
+    QuicEventSet(Pool->Ready);
+    return TRUE;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_TLS_RESULT_FLAGS
+QuicCryptoOffloadComplete(
+    _In_ QUIC_CRYPTO* Crypto,
+    _Out_ uint32_t* BufferConsumed
+    )
+{
+    QUIC_CONNECTION* Connection = QuicCryptoGetConnection(Crypto);
+    QUIC_CRYPTO_OFFLOAD* Request = Crypto->Offload;
+    QUIC_TLS_RESULT_FLAGS ResultFlags = Request->ResultFlags;
+    *BufferConsumed = Request->BufferConsumed;
+
+    if (ResultFlags == QUIC_TLS_RESULT_PENDING) {
+        //
+        // TLS completed the call asynchronously.
+        //
+        ResultFlags = QuicTlsProcessDataComplete(Crypto->TLS, BufferConsumed);
+        if (ResultFlags == QUIC_TLS_RESULT_PENDING) {
+            return ResultFlags; // Still waiting.
+        }
+    }
+
+    Crypto->Offload = NULL;
+
+    QuicTraceLogConnVerbose(
+        CryptoOffloadComplete,
+        Connection,
+        "Offloaded crypto complete, %u bytes produced",
+        Request->TlsState.BufferLength);
+
+    //
+    // Append the newly produced data and take on the rest of the TLS state.
+    //
+    QUIC_TLS_PROCESS_STATE* State = &Crypto->TlsState;
+    const QUIC_TLS_PROCESS_STATE* Output = &Request->TlsState;
+    QUIC_DBG_ASSERT(State->BufferLength + Output->BufferLength <= State->BufferAllocLength);
+    QuicCopyMemory(
+        State->Buffer + State->BufferLength,
+        Output->Buffer,
+        Output->BufferLength);
+    State->BufferLength += Output->BufferLength;
+    State->BufferTotalLength = Output->BufferTotalLength;
+    State->BufferOffsetHandshake = Output->BufferOffsetHandshake;
+    State->BufferOffset1Rtt = Output->BufferOffset1Rtt;
+    State->HandshakeComplete = Output->HandshakeComplete;
+    State->SessionResumed = Output->SessionResumed;
+    State->EarlyDataState = Output->EarlyDataState;
+    State->ReadKey = Output->ReadKey;
+    State->WriteKey = Output->WriteKey;
+    State->AlertCode = Output->AlertCode;
+    State->NegotiatedAlpn = Output->NegotiatedAlpn;
+
+    for (uint8_t i = 0; i < QUIC_PACKET_KEY_COUNT; ++i) {
+        if (Output->ReadKeys[i] != State->ReadKeys[i]) {
+            QUIC_DBG_ASSERT(State->ReadKeys[i] == NULL);
+            State->ReadKeys[i] = Output->ReadKeys[i];
+        }
+        if (Output->WriteKeys[i] != State->WriteKeys[i]) {
+            QUIC_DBG_ASSERT(State->WriteKeys[i] == NULL);
+            State->WriteKeys[i] = Output->WriteKeys[i];
+        }
+    }
+
+    if (Request->PeerTransportParamsReceived) {
+        Connection->PeerTransportParams = Request->PeerTransportParams;
+        QuicConnProcessPeerTransportParameters(Connection, FALSE);
+    }
+
+    QUIC_FREE(Request);
+
+    return ResultFlags;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoOffloadFree(
+    _In_ QUIC_CRYPTO* Crypto
+    )
+{
+    QUIC_CRYPTO_OFFLOAD* Request = Crypto->Offload;
+    for (uint8_t i = 0; i < QUIC_PACKET_KEY_COUNT; ++i) {
+        if (Request->TlsState.ReadKeys[i] != Crypto->TlsState.ReadKeys[i]) {
+            QuicPacketKeyFree(Request->TlsState.ReadKeys[i]);
+        }
+        if (Request->TlsState.WriteKeys[i] != Crypto->TlsState.WriteKeys[i]) {
+            QuicPacketKeyFree(Request->TlsState.WriteKeys[i]);
+        }
+    }
+    Crypto->Offload = NULL;
+    QUIC_FREE(Request);
+}
@@ -0,0 +1,155 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Definitions for the handshake offload pool, which processes server
+    handshakes (the TLS ClientHello and its response) on a dedicated set of
+    threads, so that the workers can keep processing established connections
+    in the meantime.
+
+--*/
+
+//
+// A single TLS call being processed by the offload pool.
+//
+typedef struct QUIC_CRYPTO_OFFLOAD {
+
+    //
+    // Link in the pool's list of queued requests.
+    //
+    QUIC_LIST_ENTRY Link;
+
+    QUIC_CONNECTION* Connection;
+
+    //
+    // Preallocated operation used to queue the completion back to the
+    // connection's worker, so that completing can't fail.
+    //
+    QUIC_OPERATION* CompletionOper;
+
+    //
+    // The result of the TLS call. Stays QUIC_TLS_RESULT_PENDING if TLS
+    // completed the call asynchronously.
+    //
+    QUIC_TLS_RESULT_FLAGS ResultFlags;
+
+    //
+    // The amount of input data consumed by TLS.
+    //
+    uint32_t BufferConsumed;
+
+    //
+    // Indicates the peer's transport parameters were received (and decoded
+    // into PeerTransportParams) during the TLS call.
+    //
+    BOOLEAN PeerTransportParamsReceived;
+
+    QUIC_TRANSPORT_PARAMETERS PeerTransportParams;
+
+    //
+    // Private copy of the connection's TLS state, which TLS writes its output
+    // to. Its Buffer only holds the newly produced data and is merged back
+    // into the connection's state on completion.
+    //
+    QUIC_TLS_PROCESS_STATE TlsState;
+
+    //
+    // A copy of the input data, as the receive buffer may be modified while
+    // the request is outstanding.
+    //
+    uint32_t InputLength;
+    uint8_t Input[0];
+
+    // uint8_t Output[TlsState.BufferAllocLength];
+
+} QUIC_CRYPTO_OFFLOAD;
+
+//
+// The set of threads processing offloaded handshakes.
+//
+typedef struct QUIC_CRYPTO_OFFLOAD_POOL {
+
+    //
+    // Indicates new requests may be queued.
+    //
+    BOOLEAN Enabled;
+
+    uint16_t ThreadCount;
+
+    //
+    // Protects Requests and Enabled.
+    //
+    QUIC_DISPATCH_LOCK Lock;
+
+    //
+    // Queue of QUIC_CRYPTO_OFFLOAD.
+    //
+    QUIC_LIST_ENTRY Requests;
+
+    //
+    // Auto-reset event signaled when a request is queued.
+    //
+    QUIC_EVENT Ready;
+
+    QUIC_THREAD Threads[0];
+
+} QUIC_CRYPTO_OFFLOAD_POOL;
+
+//
+// Creates the pool and its threads.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicCryptoOffloadPoolInitialize(
+    _In_ uint16_t ThreadCount,
+    _Out_ QUIC_CRYPTO_OFFLOAD_POOL** NewPool
+    );
+
+//
+// Processes any requests still queued and then cleans up the pool.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoOffloadPoolUninitialize(
+    _In_ QUIC_CRYPTO_OFFLOAD_POOL* Pool
+    );
+
+//
+// Queues the TLS call for the given data to the pool. Returns FALSE if the
+// request couldn't be queued, in which case the caller should process the
+// data inline.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicCryptoOffloadStart(
+    _In_ QUIC_CRYPTO_OFFLOAD_POOL* Pool,
+    _In_ QUIC_CRYPTO* Crypto,
+    _In_reads_(BufferLength)
+        const uint8_t* Buffer,
+    _In_ uint32_t BufferLength
+    );
+
+//
+// Called on the worker when the completion operation is processed. Merges the
+// request's results into the connection, frees the request and returns the
+// TLS result flags.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_TLS_RESULT_FLAGS
+QuicCryptoOffloadComplete(
+    _In_ QUIC_CRYPTO* Crypto,
+    _Out_ uint32_t* BufferConsumed
+    );
+
+//
+// Frees a request that was never completed, along with any keys TLS produced
+// for it.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCryptoOffloadFree(
+    _In_ QUIC_CRYPTO* Crypto
+    );
@@ -30,6 +30,7 @@ typedef enum eTlsExtensions {
     TlsExt_ServerName               = 0x00,
     TlsExt_AppProtocolNegotiation   = 0x10,
     TlsExt_SessionTicket            = 0x23,
+    TlsExt_PreSharedKey             = 0x29,
     TlsExt_QuicTransportParameters  = 0xffa5
 } eTlsExtensions;
 
@@ -62,6 +63,9 @@ typedef enum eSniNameType {
 // Extensions
 //
 #define QUIC_TP_ID_MAX_DATAGRAM_FRAME_SIZE                  32  // varint
+#define QUIC_TP_ID_MIN_ACK_DELAY                            0xff02de1aULL // varint
+#define QUIC_TP_ID_ENABLE_MULTIPATH                         0xbabf  // N/A
+#define QUIC_TP_ID_INTEGRITY_ONLY                           0x1e9d  // N/A
 
 #define QUIC_TP_ID_MAX QUIC_TP_ID_MAX_DATAGRAM_FRAME_SIZE
 
@@ -115,7 +119,7 @@ TlsReadUint24(
 static
 uint8_t*
 TlsWriteTransportParam(
-    _In_ uint16_t Id,
+    _In_ QUIC_VAR_INT Id,
     _In_ uint16_t Length,
     _In_reads_bytes_opt_(Length) const uint8_t* Param,
     _Out_writes_bytes_(_Inexpressible_("Too Dynamic"))
@@ -135,7 +139,7 @@ TlsWriteTransportParam(
 static
 uint8_t*
 TlsWriteTransportParamVarInt(
-    _In_ uint16_t Id,
+    _In_ QUIC_VAR_INT Id,
     _In_ QUIC_VAR_INT Value,
     _Out_writes_bytes_(_Inexpressible_("Too Dynamic"))
         uint8_t* Buffer
@@ -387,6 +391,9 @@ QuicCryptoTlsReadExtensions(
             if (QUIC_FAILED(Status)) {
                 return Status;
             }
+
+        } else if (ExtType == TlsExt_PreSharedKey) {
+            Connection->Crypto.ClientHelloHasPsk = TRUE;
         }
 
         BufferLength -= ExtLen;
@@ -754,6 +761,24 @@ QuicCryptoTlsEncodeTransportParameters(
                 QUIC_TP_ID_MAX_DATAGRAM_FRAME_SIZE,
                 QuicVarIntSize(TransportParams->MaxDatagramFrameSize));
     }
+    if (TransportParams->Flags & QUIC_TP_FLAG_MIN_ACK_DELAY) {
+        RequiredTPLen +=
+            TlsTransportParamLength(
+                QUIC_TP_ID_MIN_ACK_DELAY,
+                QuicVarIntSize(TransportParams->MinAckDelay));
+    }
+    if (TransportParams->Flags & QUIC_TP_FLAG_ENABLE_MULTIPATH) {
+        RequiredTPLen +=
+            TlsTransportParamLength(
+                QUIC_TP_ID_ENABLE_MULTIPATH,
+                0);
+    }
+    if (TransportParams->Flags & QUIC_TP_FLAG_INTEGRITY_ONLY) {
+        RequiredTPLen +=
+            TlsTransportParamLength(
+                QUIC_TP_ID_INTEGRITY_ONLY,
+                0);
+    }
     if (Connection->State.TestTransportParameterSet) {
         RequiredTPLen +=
             TlsTransportParamLength(
@@ -1005,6 +1030,41 @@ QuicCryptoTlsEncodeTransportParameters(
             "TP: Max Datagram Frame Size (%llu bytes)",
             TransportParams->MaxDatagramFrameSize);
     }
+    if (TransportParams->Flags & QUIC_TP_FLAG_MIN_ACK_DELAY) {
+        TPBuf =
+            TlsWriteTransportParamVarInt(
+                QUIC_TP_ID_MIN_ACK_DELAY,
+                TransportParams->MinAckDelay, TPBuf);
+        QuicTraceLogConnVerbose(
+            EncodeTPMinAckDelay,
+            Connection,
+            "TP: Min ACK Delay (%llu us)",
+            TransportParams->MinAckDelay);
+    }
+    if (TransportParams->Flags & QUIC_TP_FLAG_ENABLE_MULTIPATH) {
+        TPBuf =
+            TlsWriteTransportParam(
+                QUIC_TP_ID_ENABLE_MULTIPATH,
+                0,
+                NULL,
+                TPBuf);
+        QuicTraceLogConnVerbose(
+            EncodeTPEnableMultipath,
+            Connection,
+            "TP: Enable Multipath");
+    }
+    if (TransportParams->Flags & QUIC_TP_FLAG_INTEGRITY_ONLY) {
+        TPBuf =
+            TlsWriteTransportParam(
+                QUIC_TP_ID_INTEGRITY_ONLY,
+                0,
+                NULL,
+                TPBuf);
+        QuicTraceLogConnVerbose(
+            EncodeTPIntegrityOnly,
+            Connection,
+            "TP: Integrity Only");
+    }
     if (Connection->State.TestTransportParameterSet) {
         TPBuf =
             TlsWriteTransportParam(
@@ -1552,6 +1612,82 @@ QuicCryptoTlsDecodeTransportParameters(
                 TransportParams->MaxDatagramFrameSize);
             break;
 
+        case QUIC_TP_ID_MIN_ACK_DELAY:
+            if (TransportParams->Flags & QUIC_TP_FLAG_MIN_ACK_DELAY) {
+                QuicTraceEvent(
+                    ConnError,
+                    "[conn][%p] ERROR, %s.",
+                    Connection,
+                    "Duplicate QUIC TP ID");
+                goto Exit;
+            }
+            if (!TRY_READ_VAR_INT(TransportParams->MinAckDelay)) {
+                QuicTraceEvent(
+                    ConnErrorStatus,
+                    "[conn][%p] ERROR, %u, %s.",
+                    Connection,
+                    Length,
+                    "Invalid length of QUIC_TP_ID_MIN_ACK_DELAY");
+                goto Exit;
+            }
+            TransportParams->Flags |= QUIC_TP_FLAG_MIN_ACK_DELAY;
+            QuicTraceLogConnVerbose(
+                DecodeTPMinAckDelay,
+                Connection,
+                "TP: Min ACK Delay (%llu us)",
+                TransportParams->MinAckDelay);
+            break;
+
+        case QUIC_TP_ID_ENABLE_MULTIPATH:
+            if (TransportParams->Flags & QUIC_TP_FLAG_ENABLE_MULTIPATH) {
+                QuicTraceEvent(
+                    ConnError,
+                    "[conn][%p] ERROR, %s.",
+                    Connection,
+                    "Duplicate QUIC TP ID");
+                goto Exit;
+            }
+            if (Length != 0) {
+                QuicTraceEvent(
+                    ConnErrorStatus,
+                    "[conn][%p] ERROR, %u, %s.",
+                    Connection,
+                    Length,
+                    "Invalid length of QUIC_TP_ID_ENABLE_MULTIPATH");
+                goto Exit;
+            }
+            TransportParams->Flags |= QUIC_TP_FLAG_ENABLE_MULTIPATH;
+            QuicTraceLogConnVerbose(
+                DecodeTPEnableMultipath,
+                Connection,
+                "TP: Enable Multipath");
+            break;
+
+        case QUIC_TP_ID_INTEGRITY_ONLY:
+            if (TransportParams->Flags & QUIC_TP_FLAG_INTEGRITY_ONLY) {
+                QuicTraceEvent(
+                    ConnError,
+                    "[conn][%p] ERROR, %s.",
+                    Connection,
+                    "Duplicate QUIC TP ID");
+                goto Exit;
+            }
+            if (Length != 0) {
+                QuicTraceEvent(
+                    ConnErrorStatus,
+                    "[conn][%p] ERROR, %u, %s.",
+                    Connection,
+                    Length,
+                    "Invalid length of QUIC_TP_ID_INTEGRITY_ONLY");
+                goto Exit;
+            }
+            TransportParams->Flags |= QUIC_TP_FLAG_INTEGRITY_ONLY;
+            QuicTraceLogConnVerbose(
+                DecodeTPIntegrityOnly,
+                Connection,
+                "TP: Integrity Only");
+            break;
+
         default:
             if (QuicTpIdIsReserved(Id)) {
                 QuicTraceLogConnWarning(
@@ -1574,6 +1710,16 @@ QuicCryptoTlsDecodeTransportParameters(
         Offset += Length;
     }
 
+    if (TransportParams->Flags & QUIC_TP_FLAG_MIN_ACK_DELAY &&
+        TransportParams->MinAckDelay > MS_TO_US(TransportParams->MaxAckDelay)) {
+        QuicTraceEvent(
+            ConnError,
+            "[conn][%p] ERROR, %s.",
+            Connection,
+            "Min ACK delay larger than max ACK delay");
+        goto Exit;
+    }
+
     Result = TRUE;
 
 Exit:
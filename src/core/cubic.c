@@ -0,0 +1,972 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    CUBIC congestion control algorithm (RFC8312).
+
+    The send rate is limited to the available bandwidth by
+    limiting the number of bytes in flight to CongestionWindow.
+
+    When enabled, HyStart++ (RFC 9406) is used to exit slow start early,
+    based on increases in the RTT, before the first loss.
+
+--*/
+
+#include "precomp.h"
+#ifdef QUIC_CLOG
+#include "cubic.c.clog.h"
+#endif
+
+//
+// BETA and C from RFC8312. 10x multiples for integer arithmetic.
+//
+#define TEN_TIMES_BETA_CUBIC 7
+#define TEN_TIMES_C_CUBIC 4
+
+//
+// HyStart++ constants from RFC 9406.
+//
+#define QUIC_HYSTART_MIN_RTT_THRESH         4000    // microsec
+#define QUIC_HYSTART_MAX_RTT_THRESH         16000   // microsec
+#define QUIC_HYSTART_MIN_RTT_DIVISOR        8
+#define QUIC_HYSTART_N_RTT_SAMPLE           8
+#define QUIC_HYSTART_CSS_GROWTH_DIVISOR     4
+#define QUIC_HYSTART_CSS_ROUNDS             5
+
+//
+// Shifting nth root algorithm.
+//
+// This works sort of like long division: we look at the radicand in aligned
+// chunks of 3 bits to compute each bit of the root. This is somewhat
+// intuitive, since 2^3 = 8, i.e. one bit is needed to encode the cube root
+// of a 3-bit number.
+//
+// At each step, we have a root value computed "so far" (i.e. the most
+// significant bits of the root) and we need to find the correct value of
+// the LSB of the (shifted) root so that it satisfies the two conditions:
+// y^3 <= x
+// (y+1)^3 > x
+// ...where y represents the shifted value of the root "computed so far"
+// and x represents the bits of the radicand "shifted in so far."
+//
+// The initial shift of 30 bits gives us 3-bit-aligned chunks.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+CubeRoot(
+    uint32_t Radicand
+    )
+{
+    int i;
+    uint32_t x = 0;
+    uint32_t y = 0;
+
+    for (i = 30; i >= 0; i -= 3) {
+        x = x * 8 + ((Radicand >> i) & 7);
+        if ((y * 2 + 1) * (y * 2 + 1) * (y * 2 + 1) <= x) {
+            y = y * 2 + 1;
+        } else {
+            y = y * 2;
+        }
+    }
+    return y;
+}
+
+void
+CubicCongestionControlLogCubic(
+    _In_ const QUIC_CONNECTION* const Connection
+    )
+{
+    UNREFERENCED_PARAMETER(Connection);
+    QuicTraceEvent(
+        ConnCubic,
+        "[conn][%p] CUBIC: SlowStartThreshold=%u K=%u WindowMax=%u WindowLastMax=%u",
+        Connection,
+        Connection->CongestionControl.Cubic.SlowStartThreshold,
+        Connection->CongestionControl.Cubic.KCubic,
+        Connection->CongestionControl.Cubic.WindowMax,
+        Connection->CongestionControl.Cubic.WindowLastMax);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+CubicCongestionControlCanSend(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    return Cubic->BytesInFlight < Cubic->CongestionWindow || Cubic->Exemptions > 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlSetExemption(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint8_t NumPackets
+    )
+{
+    Cc->Cubic.Exemptions = NumPackets;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlHyStartResetState(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    Cubic->HyStartState = HYSTART_NOT_STARTED;
+    Cubic->HyStartAckCount = 0;
+    Cubic->HyStartConservativeRounds = 0;
+    Cubic->HyStartRoundEnd = 0;
+    Cubic->MinRttInLastRound = UINT32_MAX;
+    Cubic->MinRttInCurrentRound = UINT32_MAX;
+    Cubic->CssBaselineMinRtt = UINT32_MAX;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlReset(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    Cubic->SlowStartThreshold = UINT32_MAX;
+    Cubic->IsInRecovery = FALSE;
+    Cubic->HasHadCongestionEvent = FALSE;
+    Cubic->IsAppLimited = FALSE;
+    Cubic->CongestionWindow = Connection->Paths[0].Mtu * Cubic->InitialWindowPackets;
+    Cubic->BytesInFlightMax = Cubic->CongestionWindow / 2;
+    Cubic->BytesInFlight = 0;
+    CubicCongestionControlHyStartResetState(Cc);
+    QuicConnLogOutFlowStats(Connection);
+    CubicCongestionControlLogCubic(Connection);
+}
+
+//
+// Attempts to predict what the congestion window will be one RTT from now.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+CubicCongestionControlPredictNextWindow(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    //
+    // TODO - Replace NewReno prediction logic.
+    //
+    uint32_t Wnd;
+    if (Cubic->CongestionWindow < Cubic->SlowStartThreshold) {
+        Wnd = Cubic->CongestionWindow << 1;
+        if (Wnd > Cubic->SlowStartThreshold) {
+            Wnd = Cubic->SlowStartThreshold;
+        }
+    } else {
+        Wnd =
+            Cubic->CongestionWindow +
+            QuicCongestionControlGetConnection(Cc)->Paths[0].Mtu;
+    }
+    return Wnd;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+CubicCongestionControlGetSendAllowance(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t TimeSinceLastSend, // microsec
+    _In_ BOOLEAN TimeSinceLastSendValid
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    uint32_t SendAllowance;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    if (Cubic->BytesInFlight >= Cubic->CongestionWindow) {
+        //
+        // We are CC blocked, so we can't send anything.
+        //
+        SendAllowance = 0;
+
+    } else if (!Connection->State.UsePacing || !Connection->Paths[0].GotFirstRttSample) {
+        //
+        // Pacing is disabled or we don't have an RTT sample yet, so just send
+        // everything we can.
+        //
+        SendAllowance = Cubic->CongestionWindow - Cubic->BytesInFlight;
+
+    } else {
+        //
+        // Try to pace: if the window and RTT are large enough, the window can
+        // be split into chunks which are spread out over the RTT.
+        // SendAllowance will be set to the size of the next chunk.
+        //
+        uint32_t MinChunkSize = QUIC_SEND_PACING_MIN_CHUNK * Connection->Paths[0].Mtu;
+        if (Connection->Paths[0].SmoothedRtt < QUIC_SEND_PACING_MIN_RTT ||
+            Cubic->CongestionWindow < MinChunkSize ||
+            !TimeSinceLastSendValid) {
+            //
+            // Either the RTT is too small (i.e. it cannot be split into
+            // multiple intervals based on the pacing timer precision) or the window
+            // is too small (i.e. it cannot be split into chunks larger than
+            // MinChunkSize) for us to use pacing, or this is the first send,
+            // in which case the pacing formula (which uses the time since the
+            // last send) is invalid.
+            //
+            SendAllowance = Cubic->CongestionWindow - Cubic->BytesInFlight;
+
+        } else {
+
+            //
+            // We are pacing, so calculate the current chunk size based on how
+            // long it's been since we sent the previous chunk.
+            //
+
+            //
+            // Since the window grows via ACK feedback and since we defer
+            // packets when pacing, using the current window to calculate the
+            // pacing interval is not quite as aggressive as we'd like. Instead,
+            // use the predicted window of the next RTT.
+            //
+            uint64_t EstimatedWnd = CubicCongestionControlPredictNextWindow(Cc);
+
+            //
+            // After an app-limited period, the time since the last send says
+            // nothing about how much data the path can absorb. Pace the
+            // restart as if the previous chunk was sent an interval ago,
+            // instead of bursting up to half the window.
+            //
+            if (Cubic->IsAppLimited &&
+                TimeSinceLastSend > MS_TO_US(QUIC_SEND_PACING_INTERVAL)) {
+                TimeSinceLastSend = MS_TO_US(QUIC_SEND_PACING_INTERVAL);
+            }
+
+            SendAllowance =
+                (uint32_t)((EstimatedWnd * TimeSinceLastSend) / Connection->Paths[0].SmoothedRtt);
+            if (SendAllowance < MinChunkSize) {
+                SendAllowance = MinChunkSize;
+            }
+            if (SendAllowance > (Cubic->CongestionWindow - Cubic->BytesInFlight)) {
+                SendAllowance = Cubic->CongestionWindow - Cubic->BytesInFlight;
+            }
+            if (SendAllowance > (Cubic->CongestionWindow >> 1)) {
+                SendAllowance = Cubic->CongestionWindow >> 1; // Don't send more than half the current window.
+            }
+        }
+    }
+    return SendAllowance;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint64_t
+CubicCongestionControlGetPacingRate(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    const QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    if (!Connection->State.UsePacing ||
+        !Connection->Paths[0].GotFirstRttSample ||
+        Connection->Paths[0].SmoothedRtt < QUIC_SEND_PACING_MIN_RTT) {
+        return 0;
+    }
+
+    //
+    // Same as the allowance calculation: the predicted window for the next
+    // RTT, spread over the RTT.
+    //
+    return
+        (uint64_t)CubicCongestionControlPredictNextWindow((QUIC_CONGESTION_CONTROL*)Cc) *
+        MS_TO_US(1000) / Connection->Paths[0].SmoothedRtt;
+}
+
+//
+// Returns TRUE if we became unblocked.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+CubicCongestionControlUpdateBlockedState(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ BOOLEAN PreviousCanSendState
+    )
+{
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    QuicConnLogOutFlowStats(Connection);
+    if (PreviousCanSendState != CubicCongestionControlCanSend(Cc)) {
+        if (PreviousCanSendState) {
+            QuicConnAddOutFlowBlockedReason(
+                Connection, QUIC_FLOW_BLOCKED_CONGESTION_CONTROL);
+        } else {
+            QuicConnRemoveOutFlowBlockedReason(
+                Connection, QUIC_FLOW_BLOCKED_CONGESTION_CONTROL);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlHyStartChangeState(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ QUIC_CUBIC_HYSTART_STATE NewState
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    if (!Cubic->HyStartEnabled || Cubic->HyStartState == NewState) {
+        return;
+    }
+
+    QuicTraceLogConnInfo(
+        HyStartStateChange,
+        QuicCongestionControlGetConnection(Cc),
+        "HyStart: State=%u CongestionWindow=%u SlowStartThreshold=%u",
+        NewState,
+        Cubic->CongestionWindow,
+        Cubic->SlowStartThreshold);
+
+    Cubic->HyStartState = NewState;
+    Cubic->HyStartConservativeRounds = 0;
+    Cubic->CssBaselineMinRtt = UINT32_MAX;
+}
+
+//
+// Runs the HyStart++ state machine for an ACK received in slow start, and
+// returns the divisor to apply to the slow start window growth.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+CubicCongestionControlHyStartOnAck(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+
+    if (AckEvent->LargestAck >= Cubic->HyStartRoundEnd) {
+        //
+        // The current round is over. Start a new one, ending with the
+        // largest packet sent so far.
+        //
+        Cubic->HyStartRoundEnd = AckEvent->LargestSentPacketNumber;
+        Cubic->MinRttInLastRound = Cubic->MinRttInCurrentRound;
+        Cubic->MinRttInCurrentRound = UINT32_MAX;
+        Cubic->HyStartAckCount = 0;
+
+        if (Cubic->HyStartState == HYSTART_ACTIVE &&
+            ++Cubic->HyStartConservativeRounds >= QUIC_HYSTART_CSS_ROUNDS) {
+            //
+            // The RTT stayed elevated through conservative slow start, so
+            // the increase wasn't spurious. Move to congestion avoidance,
+            // with the cubic curve starting from the current window.
+            //
+            Cubic->SlowStartThreshold = Cubic->CongestionWindow;
+            Cubic->WindowMax = Cubic->CongestionWindow;
+            Cubic->WindowLastMax = Cubic->CongestionWindow;
+            Cubic->KCubic = 0;
+            Cubic->TimeOfCongAvoidStart = QuicTimeMs64();
+            CubicCongestionControlHyStartChangeState(Cc, HYSTART_DONE);
+            return 1;
+        }
+    }
+
+    if (!AckEvent->MinRttValid) {
+        return Cubic->HyStartState == HYSTART_ACTIVE ?
+            QUIC_HYSTART_CSS_GROWTH_DIVISOR : 1;
+    }
+
+    if (AckEvent->MinRtt < Cubic->MinRttInCurrentRound) {
+        Cubic->MinRttInCurrentRound = AckEvent->MinRtt;
+    }
+    Cubic->HyStartAckCount++;
+
+    if (Cubic->HyStartAckCount >= QUIC_HYSTART_N_RTT_SAMPLE &&
+        Cubic->MinRttInCurrentRound != UINT32_MAX &&
+        Cubic->MinRttInLastRound != UINT32_MAX) {
+
+        if (Cubic->HyStartState == HYSTART_NOT_STARTED) {
+            //
+            // Enter conservative slow start if the RTT has grown by more
+            // than RttThresh since the last round.
+            //
+            uint32_t RttThresh =
+                max(QUIC_HYSTART_MIN_RTT_THRESH,
+                    min(Cubic->MinRttInLastRound / QUIC_HYSTART_MIN_RTT_DIVISOR,
+                        QUIC_HYSTART_MAX_RTT_THRESH));
+            if (Cubic->MinRttInCurrentRound >=
+                    Cubic->MinRttInLastRound + RttThresh) {
+                CubicCongestionControlHyStartChangeState(Cc, HYSTART_ACTIVE);
+                Cubic->CssBaselineMinRtt = Cubic->MinRttInCurrentRound;
+            }
+
+        } else if (Cubic->MinRttInCurrentRound < Cubic->CssBaselineMinRtt) {
+            //
+            // The RTT increase was spurious. Go back to slow start.
+            //
+            CubicCongestionControlHyStartChangeState(Cc, HYSTART_NOT_STARTED);
+        }
+    }
+
+    return Cubic->HyStartState == HYSTART_ACTIVE ?
+        QUIC_HYSTART_CSS_GROWTH_DIVISOR : 1;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlOnCongestionEvent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    QuicTraceEvent(
+        ConnCongestion,
+        "[conn][%p] Congestion event",
+        Connection);
+    QuicTraceProbe(congestion, Connection, FALSE);
+    Connection->Stats.Send.CongestionCount++;
+
+    Cubic->IsInRecovery = TRUE;
+    Cubic->HasHadCongestionEvent = TRUE;
+    CubicCongestionControlHyStartChangeState(Cc, HYSTART_DONE);
+
+    Cubic->WindowMax = Cubic->CongestionWindow;
+    if (Cubic->WindowLastMax > Cubic->WindowMax) {
+        //
+        // Fast convergence.
+        //
+        Cubic->WindowLastMax = Cubic->WindowMax;
+        Cubic->WindowMax = Cubic->WindowMax * (10 + TEN_TIMES_BETA_CUBIC) / 20;
+    } else {
+        Cubic->WindowLastMax = Cubic->WindowMax;
+    }
+
+    //
+    // K = (WindowMax * (1 - BETA) / C) ^ (1/3)
+    // BETA := multiplicative window decrease factor.
+    //
+    // Here we reduce rounding error by left-shifting the CubeRoot argument
+    // by 9 before the division and then right-shifting the result by 3
+    // (since 2^9 = 2^3^3).
+    //
+    Cubic->KCubic =
+        CubeRoot(
+            (Cubic->WindowMax / Connection->Paths[0].Mtu * (10 - TEN_TIMES_BETA_CUBIC) << 9) /
+            TEN_TIMES_C_CUBIC);
+    Cubic->KCubic = S_TO_MS(Cubic->KCubic);
+    Cubic->KCubic >>= 3;
+
+    Cubic->SlowStartThreshold =
+    Cubic->CongestionWindow =
+        max(
+            (uint32_t)Connection->Paths[0].Mtu * Cubic->InitialWindowPackets,
+            Cubic->CongestionWindow * TEN_TIMES_BETA_CUBIC / 10);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlOnPersistentCongestionEvent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    QuicTraceEvent(
+        ConnPersistentCongestion,
+        "[conn][%p] Persistent congestion event",
+        Connection);
+    QuicTraceProbe(congestion, Connection, TRUE);
+    Connection->Stats.Send.PersistentCongestionCount++;
+
+    Cubic->IsInPersistentCongestion = TRUE;
+    Cubic->WindowMax =
+        Cubic->WindowLastMax =
+        Cubic->SlowStartThreshold =
+            Cubic->CongestionWindow * TEN_TIMES_BETA_CUBIC / 10;
+    Cubic->CongestionWindow =
+        Connection->Paths[0].Mtu * QUIC_PERSISTENT_CONGESTION_WINDOW_PACKETS;
+    Cubic->KCubic = 0;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+CubicCongestionControlOnDataSent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t NumRetransmittableBytes
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    BOOLEAN PreviousCanSendState = CubicCongestionControlCanSend(Cc);
+
+    Cubic->BytesInFlight += NumRetransmittableBytes;
+    if (Cubic->BytesInFlightMax < Cubic->BytesInFlight) {
+        Cubic->BytesInFlightMax = Cubic->BytesInFlight;
+        QuicSendBufferConnectionAdjust(QuicCongestionControlGetConnection(Cc));
+    }
+
+    if (Cubic->Exemptions > 0) {
+        --Cubic->Exemptions;
+    }
+
+    if (Cubic->IsAppLimited && Cubic->BytesInFlight >= Cubic->CongestionWindow) {
+        Cubic->IsAppLimited = FALSE; // Window is in use again.
+    }
+
+    CubicCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+CubicCongestionControlOnDataInvalidated(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t NumRetransmittableBytes
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    BOOLEAN PreviousCanSendState = CubicCongestionControlCanSend(Cc);
+
+    QUIC_DBG_ASSERT(Cubic->BytesInFlight >= NumRetransmittableBytes);
+    Cubic->BytesInFlight -= NumRetransmittableBytes;
+
+    return CubicCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+CubicCongestionControlOnDataAcknowledged(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    const uint64_t TimeNow = US_TO_MS(AckEvent->TimeNow);
+    const uint64_t LargestPacketNumberAcked = AckEvent->LargestAck;
+    const uint32_t NumRetransmittableBytes = AckEvent->NumRetransmittableBytes;
+    const uint32_t SmoothedRtt = AckEvent->SmoothedRtt;
+    BOOLEAN PreviousCanSendState = CubicCongestionControlCanSend(Cc);
+
+    QUIC_DBG_ASSERT(Cubic->BytesInFlight >= NumRetransmittableBytes);
+    Cubic->BytesInFlight -= NumRetransmittableBytes;
+
+    if (Cubic->IsInRecovery) {
+        if (LargestPacketNumberAcked > Cubic->RecoverySentPacketNumber) {
+            //
+            // Done recovering. Note that completion of recovery is defined a
+            // bit differently here than in TCP: we simply require an ACK for a
+            // packet sent after recovery started.
+            //
+            QuicTraceEvent(
+                ConnRecoveryExit,
+                "[conn][%p] Recovery complete",
+                Connection);
+            Cubic->IsInRecovery = FALSE;
+            Cubic->IsInPersistentCongestion = FALSE;
+            Cubic->TimeOfCongAvoidStart = QuicTimeMs64();
+        }
+        goto Exit;
+    } else if (NumRetransmittableBytes == 0) {
+        goto Exit;
+
+    } else if (AckEvent->IsAppLimited) {
+        //
+        // The newest packet acknowledged was sent while app-limited, so the
+        // ACK doesn't show the network could handle a larger window. Freeze
+        // the window, and the cubic curve with it (by pushing the start of
+        // congestion avoidance forward by the time since the last ACK).
+        //
+        if (Cubic->CongestionWindow >= Cubic->SlowStartThreshold &&
+            Cubic->TimeOfLastAckValid) {
+            uint64_t TimeSinceLastAck = QuicTimeDiff64(Cubic->TimeOfLastAck, TimeNow);
+            Cubic->TimeOfCongAvoidStart += TimeSinceLastAck;
+            if (QuicTimeAtOrBefore64(TimeNow, Cubic->TimeOfCongAvoidStart)) {
+                Cubic->TimeOfCongAvoidStart = TimeNow;
+            }
+        }
+        goto Exit;
+    }
+
+    if (Cubic->CongestionWindow < Cubic->SlowStartThreshold) {
+
+        //
+        // Slow Start
+        //
+
+        uint32_t GrowthDivisor = 1;
+        if (Cubic->HyStartEnabled && Cubic->HyStartState != HYSTART_DONE) {
+            GrowthDivisor = CubicCongestionControlHyStartOnAck(Cc, AckEvent);
+        }
+
+        Cubic->CongestionWindow += NumRetransmittableBytes / GrowthDivisor;
+        if (Cubic->CongestionWindow >= Cubic->SlowStartThreshold) {
+            Cubic->TimeOfCongAvoidStart = QuicTimeMs64();
+        }
+
+    } else {
+
+        //
+        // Congestion Avoidance
+        //
+
+        //
+        // We require steady ACK feedback to justify window growth. If there is
+        // a long time gap between ACKs, add the gap to TimeOfCongAvoidStart to
+        // reduce the value of TimeInCongAvoid, which effectively freezes window
+        // growth during the gap.
+        //
+        if (Cubic->TimeOfLastAckValid) {
+            uint64_t TimeSinceLastAck = QuicTimeDiff64(Cubic->TimeOfLastAck, TimeNow);
+            if (TimeSinceLastAck > Cubic->SendIdleTimeoutMs &&
+                TimeSinceLastAck > US_TO_MS(Connection->Paths[0].SmoothedRtt + 4 * Connection->Paths[0].RttVariance)) {
+                Cubic->TimeOfCongAvoidStart += TimeSinceLastAck;
+                if (QuicTimeAtOrBefore64(TimeNow, Cubic->TimeOfCongAvoidStart)) {
+                    Cubic->TimeOfCongAvoidStart = TimeNow;
+                }
+            }
+        }
+
+        uint64_t TimeInCongAvoid =
+            QuicTimeDiff64(Cubic->TimeOfCongAvoidStart, QuicTimeMs64());
+        if (TimeInCongAvoid > UINT32_MAX) {
+            TimeInCongAvoid = UINT32_MAX;
+        }
+
+        //
+        // Compute the cubic window:
+        // W_cubic(t) = C*(t-K)^3 + WindowMax.
+        // (t in seconds; window sizes in MSS)
+        //
+        // NB: The RFC uses W_cubic(t+RTT) rather than W_cubic(t), so we
+        // add RTT to DeltaT.
+        //
+        // Here we have 30 bits' worth of right shift. This is to convert
+        // millisec^3 to sec^3. Each ten bit's worth of shift approximates
+        // a division by 1000. The order of operations is chosen to strike
+        // a balance between rounding error and overflow protection.
+        // With C = 0.4 and MTU=0xffff, we are safe from overflow for
+        // DeltaT < ~2.5M (about 30min).
+        //
+
+        int64_t DeltaT = TimeInCongAvoid - Cubic->KCubic + US_TO_MS(SmoothedRtt);
+
+        int64_t CubicWindow =
+            ((((DeltaT * DeltaT) >> 10) * DeltaT *
+              (int64_t)(Connection->Paths[0].Mtu * TEN_TIMES_C_CUBIC / 10)) >> 20) +
+            (int64_t)Cubic->WindowMax;
+
+        if (CubicWindow < 0) {
+            //
+            // The window came out so large it overflowed. We want to limit the
+            // huge window below anyway, so just set it to the limiting value.
+            //
+            CubicWindow = 2 * Cubic->BytesInFlightMax;
+        }
+
+        //
+        // Compute the AIMD window (called W_est in the RFC):
+        // W_est(t) = WindowMax*BETA + [3*(1-BETA)/(1+BETA)] * (t/RTT).
+        // (again, window sizes in MSS)
+        //
+        // This is a window with linear growth which is designed
+        // to have the same average window size as an AIMD window
+        // with BETA=0.5 and a slope of 1MSS/RTT. Since our
+        // BETA is 0.7, we need a smaller slope than 1MSS/RTT to
+        // have this property.
+        //
+        // Also, for our value of BETA we have [3*(1-BETA)/(1+BETA)] ~= 0.5,
+        // so we simplify the calculation as:
+        // W_est(t) ~= WindowMax*BETA + (t/(2*RTT)).
+        //
+        // Using max(RTT, 1) prevents division by zero.
+        //
+
+        QUIC_STATIC_ASSERT(TEN_TIMES_BETA_CUBIC == 7, "TEN_TIMES_BETA_CUBIC must be 7 for simplified calculation.");
+
+        int64_t AimdWindow =
+            Cubic->WindowMax * TEN_TIMES_BETA_CUBIC / 10 +
+            TimeInCongAvoid * Connection->Paths[0].Mtu / (2 * max(1, US_TO_MS(SmoothedRtt)));
+
+        //
+        // Use the cubic or AIMD window, whichever is larger.
+        //
+        if (AimdWindow > CubicWindow) {
+            Cubic->CongestionWindow = (uint32_t)max(AimdWindow, Cubic->CongestionWindow + 1);
+        } else {
+            //
+            // Here we increment by a fraction of the difference, per the spec,
+            // rather than setting the window equal to CubicWindow. This helps
+            // prevent a burst when transitioning into congestion avoidance, since
+            // the cubic window may be significantly different from SlowStartThreshold.
+            //
+            Cubic->CongestionWindow +=
+                (uint32_t)max(
+                    ((CubicWindow - Cubic->CongestionWindow) * Connection->Paths[0].Mtu) / Cubic->CongestionWindow,
+                    1);
+        }
+    }
+
+    //
+    // Limit the growth of the window based on the number of bytes we
+    // actually manage to put on the wire, which may be limited by flow
+    // control or by the app posting a limited number of bytes. This must
+    // be done to prevent the window from growing without loss feedback from
+    // the network.
+    //
+    // Using 2 * BytesInFlightMax for the limit allows for exponential growth
+    // in the window when not otherwise limited.
+    //
+    if (Cubic->CongestionWindow > 2 * Cubic->BytesInFlightMax) {
+        Cubic->CongestionWindow = 2 * Cubic->BytesInFlightMax;
+    }
+
+Exit:
+
+    Cubic->TimeOfLastAck = TimeNow;
+    Cubic->TimeOfLastAckValid = TRUE;
+    return CubicCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlOnDataLost(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t LargestPacketNumberLost,
+    _In_ uint64_t LargestPacketNumberSent,
+    _In_ uint32_t NumRetransmittableBytes,
+    _In_ BOOLEAN PersistentCongestion
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    BOOLEAN PreviousCanSendState = CubicCongestionControlCanSend(Cc);
+
+    //
+    // If data is lost after the most recent congestion event (or if there
+    // hasn't been a congestion event yet) then treat this loss as a new
+    // congestion event.
+    //
+    if (!Cubic->HasHadCongestionEvent ||
+        LargestPacketNumberLost > Cubic->RecoverySentPacketNumber) {
+
+        //
+        // Save the state, so it can be restored if all the lost packets are
+        // acknowledged after all (i.e. they were only reordered).
+        //
+        Cubic->PrevStateValid = TRUE;
+        Cubic->PrevCongestionWindow = Cubic->CongestionWindow;
+        Cubic->PrevSlowStartThreshold = Cubic->SlowStartThreshold;
+        Cubic->PrevKCubic = Cubic->KCubic;
+        Cubic->PrevWindowMax = Cubic->WindowMax;
+        Cubic->PrevWindowLastMax = Cubic->WindowLastMax;
+        Cubic->PrevTimeOfCongAvoidStart = Cubic->TimeOfCongAvoidStart;
+        Cubic->PrevHasHadCongestionEvent = Cubic->HasHadCongestionEvent;
+        Cubic->PrevRecoverySentPacketNumber = Cubic->RecoverySentPacketNumber;
+
+        Cubic->RecoverySentPacketNumber = LargestPacketNumberSent;
+        CubicCongestionControlOnCongestionEvent(Cc);
+
+        if (PersistentCongestion && !Cubic->IsInPersistentCongestion) {
+            CubicCongestionControlOnPersistentCongestionEvent(Cc);
+        }
+    }
+
+    QUIC_DBG_ASSERT(Cubic->BytesInFlight >= NumRetransmittableBytes);
+    Cubic->BytesInFlight -= NumRetransmittableBytes;
+
+    CubicCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+    CubicCongestionControlLogCubic(QuicCongestionControlGetConnection(Cc));
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlOnEcn(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t LargestPacketNumberAcked,
+    _In_ uint64_t LargestPacketNumberSent
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    BOOLEAN PreviousCanSendState = CubicCongestionControlCanSend(Cc);
+
+    //
+    // CE marks are handled like loss (RFC 9002, section 7.1): at most one
+    // congestion event per round trip, but nothing needs to be retransmitted.
+    //
+    if (!Cubic->HasHadCongestionEvent ||
+        LargestPacketNumberAcked > Cubic->RecoverySentPacketNumber) {
+
+        Cubic->RecoverySentPacketNumber = LargestPacketNumberSent;
+        CubicCongestionControlOnCongestionEvent(Cc);
+
+        //
+        // The peer really saw congestion, so this can't be undone.
+        //
+        Cubic->PrevStateValid = FALSE;
+    }
+
+    CubicCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+    CubicCongestionControlLogCubic(QuicCongestionControlGetConnection(Cc));
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+CubicCongestionControlOnSpuriousCongestionEvent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+
+    if (!Cubic->PrevStateValid) {
+        return FALSE;
+    }
+
+    BOOLEAN PreviousCanSendState = CubicCongestionControlCanSend(Cc);
+
+    QuicTraceLogConnInfo(
+        CubicSpuriousCongestion,
+        Connection,
+        "Spurious congestion event, restoring window %u (was %u)",
+        Cubic->PrevCongestionWindow,
+        Cubic->CongestionWindow);
+    Connection->Stats.Send.SpuriousCongestionCount++;
+
+    Cubic->PrevStateValid = FALSE;
+    Cubic->IsInRecovery = FALSE;
+    Cubic->IsInPersistentCongestion = FALSE;
+    Cubic->HasHadCongestionEvent = Cubic->PrevHasHadCongestionEvent;
+    Cubic->RecoverySentPacketNumber = Cubic->PrevRecoverySentPacketNumber;
+    Cubic->SlowStartThreshold = Cubic->PrevSlowStartThreshold;
+    Cubic->KCubic = Cubic->PrevKCubic;
+    Cubic->WindowMax = Cubic->PrevWindowMax;
+    Cubic->WindowLastMax = Cubic->PrevWindowLastMax;
+    Cubic->TimeOfCongAvoidStart = Cubic->PrevTimeOfCongAvoidStart;
+    if (Cubic->CongestionWindow < Cubic->PrevCongestionWindow) {
+        Cubic->CongestionWindow = Cubic->PrevCongestionWindow;
+    }
+
+    BOOLEAN Unblocked = CubicCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+    CubicCongestionControlLogCubic(Connection);
+    return Unblocked;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlSetAppLimited(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    if (Cubic->BytesInFlight < Cubic->CongestionWindow) {
+        Cubic->IsAppLimited = TRUE;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+CubicCongestionControlIsAppLimited(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Cubic.IsAppLimited;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint8_t
+CubicCongestionControlGetExemptions(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Cubic.Exemptions;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+CubicCongestionControlGetBytesInFlightMax(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Cubic.BytesInFlightMax;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+CubicCongestionControlGetCongestionWindow(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Cubic.CongestionWindow;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlLogOutFlowStatus(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    const QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    const QUIC_PATH* Path = &Connection->Paths[0];
+    const QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    UNREFERENCED_PARAMETER(Connection);
+    UNREFERENCED_PARAMETER(Path);
+    UNREFERENCED_PARAMETER(Cubic);
+
+    QuicTraceEvent(
+        ConnOutFlowStats,
+        "[conn][%p] OUT: BytesSent=%llu InFlight=%u InFlightMax=%u CWnd=%u SSThresh=%u ConnFC=%llu ISB=%llu PostedBytes=%llu SRtt=%u",
+        Connection,
+        Connection->Stats.Send.TotalBytes,
+        Cubic->BytesInFlight,
+        Cubic->BytesInFlightMax,
+        Cubic->CongestionWindow,
+        Cubic->SlowStartThreshold,
+        Connection->Send.PeerMaxData - Connection->Send.OrderedStreamBytesSent,
+        Connection->SendBuffer.IdealBytes,
+        Connection->SendBuffer.PostedBytes,
+        Path->GotFirstRttSample ? Path->SmoothedRtt : 0);
+}
+
+static const QUIC_CONGESTION_CONTROL_VTABLE QuicCongestionControlCubic = {
+    "Cubic",
+    QUIC_CONGESTION_CONTROL_ALGORITHM_CUBIC,
+    CubicCongestionControlReset,
+    CubicCongestionControlCanSend,
+    CubicCongestionControlSetExemption,
+    CubicCongestionControlGetSendAllowance,
+    CubicCongestionControlGetPacingRate,
+    CubicCongestionControlOnDataSent,
+    CubicCongestionControlOnDataInvalidated,
+    CubicCongestionControlOnDataAcknowledged,
+    CubicCongestionControlOnDataLost,
+    CubicCongestionControlOnSpuriousCongestionEvent,
+    CubicCongestionControlOnEcn,
+    CubicCongestionControlSetAppLimited,
+    CubicCongestionControlIsAppLimited,
+    CubicCongestionControlGetExemptions,
+    CubicCongestionControlGetBytesInFlightMax,
+    CubicCongestionControlGetCongestionWindow,
+    CubicCongestionControlLogOutFlowStatus
+};
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlInitialize(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_SETTINGS* Settings
+    )
+{
+    QUIC_CONGESTION_CONTROL_CUBIC* Cubic = &Cc->Cubic;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    Cc->Vtable = &QuicCongestionControlCubic;
+    QuicZeroMemory(Cubic, sizeof(*Cubic));
+    Cubic->SlowStartThreshold = UINT32_MAX;
+    Cubic->SendIdleTimeoutMs = Settings->SendIdleTimeoutMs;
+    Cubic->InitialWindowPackets = Settings->InitialWindowPackets;
+    Cubic->HyStartEnabled = Settings->HyStartEnabled;
+    Cubic->CongestionWindow = Connection->Paths[0].Mtu * Cubic->InitialWindowPackets;
+    Cubic->BytesInFlightMax = Cubic->CongestionWindow / 2;
+    CubicCongestionControlHyStartResetState(Cc);
+    QuicConnLogOutFlowStats(Connection);
+    CubicCongestionControlLogCubic(Connection);
+}
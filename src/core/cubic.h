@@ -0,0 +1,137 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+--*/
+
+//
+// HyStart++ (RFC 9406) slow start states.
+//
+typedef enum QUIC_CUBIC_HYSTART_STATE {
+    HYSTART_NOT_STARTED,    // Standard slow start, watching for RTT increases.
+    HYSTART_ACTIVE,         // Conservative slow start (CSS).
+    HYSTART_DONE            // Slow start is over; HyStart++ isn't used anymore.
+} QUIC_CUBIC_HYSTART_STATE;
+
+typedef struct QUIC_CONGESTION_CONTROL_CUBIC {
+
+    //
+    // TRUE if we have had at least one congestion event.
+    // If TRUE, RecoverySentPacketNumber is valid.
+    //
+    BOOLEAN HasHadCongestionEvent : 1;
+
+    //
+    // This flag indicates a congestion event occurred and CC is attempting
+    // to recover from it.
+    //
+    BOOLEAN IsInRecovery : 1;
+
+    //
+    // This flag indicates a persistent congestion event occurred and CC is
+    // attempting to recover from it.
+    //
+    BOOLEAN IsInPersistentCongestion : 1;
+
+    //
+    // TRUE if there has been at least one ACK.
+    //
+    BOOLEAN TimeOfLastAckValid : 1;
+
+    //
+    // TRUE if HyStart++ is used to exit slow start before the first loss.
+    //
+    BOOLEAN HyStartEnabled : 1;
+
+    //
+    // TRUE if the Prev* fields hold the state from before the last congestion
+    // event, which can still be restored if that event turns out spurious.
+    //
+    BOOLEAN PrevStateValid : 1;
+
+    //
+    // TRUE if the sender ran out of data to send with the window not full
+    // (i.e. it isn't cwnd-limited). Packets sent meanwhile are marked as
+    // app-limited, and their ACKs don't grow the window (RFC 7661). Cleared
+    // once sends fill the window again.
+    //
+    BOOLEAN IsAppLimited : 1;
+
+    //
+    // The size of the initial congestion window, in packets.
+    //
+    uint32_t InitialWindowPackets;
+
+    //
+    // Minimum time without any sends before the congestion window is reset.
+    //
+    uint32_t SendIdleTimeoutMs;
+
+    uint32_t CongestionWindow; // bytes
+    uint32_t SlowStartThreshold; // bytes
+
+    //
+    // The number of bytes considered to be still in the network.
+    //
+    // The client of this module should send packets until BytesInFlight becomes
+    // larger than CongestionWindow (see CubicCongestionControlCanSend). This
+    // means BytesInFlight can become larger than CongestionWindow by up to one
+    // packet's worth of bytes, plus exemptions (see Exemptions variable).
+    //
+    uint32_t BytesInFlight;
+    uint32_t BytesInFlightMax;
+
+    //
+    // A count of packets which can be sent ignoring CongestionWindow.
+    // The count is decremented as the packets are sent. BytesInFlight is still
+    // incremented for these packets. This is used to send probe packets for
+    // loss recovery.
+    //
+    uint8_t Exemptions;
+
+    uint64_t TimeOfLastAck; // millisec
+    uint64_t TimeOfCongAvoidStart; // millisec
+    uint32_t KCubic; // millisec
+    uint32_t WindowMax; // bytes
+    uint32_t WindowLastMax; // bytes
+
+    //
+    // This variable tracks the largest packet that was outstanding at the time
+    // the last congestion event occurred. An ACK for any packet number greater
+    // than this indicates recovery is over.
+    //
+    uint64_t RecoverySentPacketNumber;
+
+    //
+    // The state from before the last congestion event caused by loss.
+    //
+    uint32_t PrevCongestionWindow; // bytes
+    uint32_t PrevSlowStartThreshold; // bytes
+    uint32_t PrevKCubic; // millisec
+    uint32_t PrevWindowMax; // bytes
+    uint32_t PrevWindowLastMax; // bytes
+    uint64_t PrevTimeOfCongAvoidStart; // millisec
+    uint64_t PrevRecoverySentPacketNumber;
+    BOOLEAN PrevHasHadCongestionEvent;
+
+    //
+    // HyStart++ state. A round ends when a packet sent after the start of the
+    // round (i.e. larger than HyStartRoundEnd) is acknowledged.
+    //
+    QUIC_CUBIC_HYSTART_STATE HyStartState;
+    uint32_t HyStartAckCount;           // RTT samples taken in the current round
+    uint32_t HyStartConservativeRounds; // Rounds spent in conservative slow start
+    uint64_t HyStartRoundEnd;           // Packet number
+    uint32_t MinRttInLastRound;         // microsec
+    uint32_t MinRttInCurrentRound;      // microsec
+    uint32_t CssBaselineMinRtt;         // microsec
+
+} QUIC_CONGESTION_CONTROL_CUBIC;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+CubicCongestionControlInitialize(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_SETTINGS* Settings
+    );
@@ -82,7 +82,9 @@ QuicDatagramInitialize(
     Datagram->MaxSendLength = UINT16_MAX;
     Datagram->PrioritySendQueueTail = &Datagram->SendQueue;
     Datagram->SendQueueTail = &Datagram->SendQueue;
+    Datagram->ApiQueueTail = &Datagram->ApiQueue;
     QuicDispatchLockInitialize(&Datagram->ApiQueueLock);
+    QuicListInitializeHead(&Datagram->RecvLoans);
     QuicDatagramValidate(Datagram);
 }
 
@@ -130,7 +132,7 @@ QuicDatagramCancelSend(
         Connection,
         &SendRequest->ClientContext,
         QUIC_DATAGRAM_SEND_CANCELED);
-    QuicPoolFree(&Connection->Worker->SendRequestPool, SendRequest);
+    QuicConnFreeSendRequest(Connection, SendRequest);
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -146,7 +148,7 @@ QuicDatagramCompleteSend(
         Connection,
         ClientContext,
         QUIC_DATAGRAM_SEND_SENT);
-    QuicPoolFree(&Connection->Worker->SendRequestPool, SendRequest);
+    QuicConnFreeSendRequest(Connection, SendRequest);
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -158,6 +160,7 @@ QuicDatagramUninitialize(
     QuicDatagramSendShutdown(Datagram);
     QUIC_DBG_ASSERT(Datagram->SendQueue == NULL);
     QUIC_DBG_ASSERT(Datagram->ApiQueue == NULL);
+    QUIC_DBG_ASSERT(QuicListIsEmpty(&Datagram->RecvLoans));
     QuicDispatchLockUninitialize(&Datagram->ApiQueueLock);
 }
 
@@ -183,6 +186,7 @@ QuicDatagramSendShutdown(
     Datagram->MaxSendLength = 0;
     QUIC_SEND_REQUEST* ApiQueue = Datagram->ApiQueue;
     Datagram->ApiQueue = NULL;
+    Datagram->ApiQueueTail = &Datagram->ApiQueue;
     QuicDispatchLockRelease(&Datagram->ApiQueueLock);
 
     QuicSendClearSendFlag(&Connection->Send, QUIC_CONN_SEND_FLAG_DATAGRAM);
@@ -356,23 +360,31 @@ QuicDatagramQueueSend(
                 "Datagram send request is longer than allowed");
             Status = QUIC_STATUS_INVALID_PARAMETER;
         } else {
-            QUIC_SEND_REQUEST** ApiQueueTail = &Datagram->ApiQueue;
-            while (*ApiQueueTail != NULL) {
-                ApiQueueTail = &((*ApiQueueTail)->Next);
+            if (Datagram->ApiQueue != NULL) {
                 QueueOper = FALSE; // Not necessary if the previous send hasn't been flushed yet.
             }
-            *ApiQueueTail = SendRequest;
+            *Datagram->ApiQueueTail = SendRequest;
+            Datagram->ApiQueueTail = &SendRequest->Next;
             Status = QUIC_STATUS_SUCCESS;
         }
     }
     QuicDispatchLockRelease(&Datagram->ApiQueueLock);
 
     if (QUIC_FAILED(Status)) {
-        QuicPoolFree(&Connection->Worker->SendRequestPool, SendRequest);
+        QuicConnFreeSendRequest(Connection, SendRequest);
         goto Exit;
     }
 
-    if (QueueOper) {
+    if (Connection->WorkerThreadID == QuicCurThreadID() &&
+        !QuicConnIsClosed(Connection)) {
+        //
+        // Called on the worker thread (i.e. from a callback), so the send is
+        // flushed inline, instead of through an operation. Not once closed,
+        // because then the send is canceled, which calls back into the app.
+        //
+        QuicDatagramSendFlush(Datagram);
+
+    } else if (QueueOper) {
         QUIC_OPERATION* Oper =
             QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_API_CALL);
         if (Oper == NULL) {
@@ -408,6 +420,7 @@ QuicDatagramSendFlush(
     QuicDispatchLockAcquire(&Datagram->ApiQueueLock);
     QUIC_SEND_REQUEST* ApiQueue = Datagram->ApiQueue;
     Datagram->ApiQueue = NULL;
+    Datagram->ApiQueueTail = &Datagram->ApiQueue;
     QuicDispatchLockRelease(&Datagram->ApiQueueLock);
 
     if (ApiQueue == NULL) {
@@ -459,6 +472,26 @@ QuicDatagramSendFlush(
     QuicDatagramValidate(Datagram);
 }
 
+//
+// Removes the send request *SendQueue points to from the send queue.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDatagramRemoveSend(
+    _In_ QUIC_DATAGRAM* Datagram,
+    _Inout_ QUIC_SEND_REQUEST** SendQueue
+    )
+{
+    QUIC_SEND_REQUEST* SendRequest = *SendQueue;
+    if (Datagram->PrioritySendQueueTail == &SendRequest->Next) {
+        Datagram->PrioritySendQueueTail = SendQueue;
+    }
+    if (Datagram->SendQueueTail == &SendRequest->Next) {
+        Datagram->SendQueueTail = SendQueue;
+    }
+    *SendQueue = SendRequest->Next;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 BOOLEAN
 QuicDatagramWriteFrame(
@@ -472,8 +505,26 @@ QuicDatagramWriteFrame(
 
     QuicDatagramValidate(Datagram);
 
-    while (Datagram->SendQueue != NULL) {
-        QUIC_SEND_REQUEST* SendRequest = Datagram->SendQueue;
+    uint64_t TimeNow = 0;
+    QUIC_SEND_REQUEST** SendQueue = &Datagram->SendQueue;
+    while (*SendQueue != NULL) {
+        QUIC_SEND_REQUEST* SendRequest = *SendQueue;
+
+        if (SendRequest->ExpirationTime != 0) {
+            if (TimeNow == 0) {
+                TimeNow = QuicTimeUs64();
+            }
+            if (TimeNow >= SendRequest->ExpirationTime) {
+                QuicTraceLogConnVerbose(
+                    DatagramSendExpired,
+                    Connection,
+                    "Datagram [%p] expired before being sent",
+                    SendRequest);
+                QuicDatagramRemoveSend(Datagram, SendQueue);
+                QuicDatagramCancelSend(Connection, SendRequest);
+                continue;
+            }
+        }
 
         if (Builder->Metadata->Flags.KeyType == QUIC_PACKET_KEY_0_RTT &&
             !(SendRequest->Flags & QUIC_SEND_FLAG_ALLOW_0_RTT)) {
@@ -507,16 +558,19 @@ QuicDatagramWriteFrame(
                 Builder->Metadata->FrameCount != 0 ||
                 Builder->PacketStart != 0);
             Result = TRUE;
-            goto Exit;
-        }
 
-        if (Datagram->PrioritySendQueueTail == &SendRequest->Next) {
-            Datagram->PrioritySendQueueTail = &Datagram->SendQueue;
-        }
-        if (Datagram->SendQueueTail == &SendRequest->Next) {
-            Datagram->SendQueueTail = &Datagram->SendQueue;
+            //
+            // Fill the rest of the packet with any later (smaller) datagrams
+            // that still fit. This one stays queued for the next packet.
+            //
+            if (AvailableBufferLength - Builder->DatagramLength <= DATAGRAM_FRAME_HEADER_LENGTH) {
+                goto Exit;
+            }
+            SendQueue = &SendRequest->Next;
+            continue;
         }
-        Datagram->SendQueue = SendRequest->Next;
+
+        QuicDatagramRemoveSend(Datagram, SendQueue);
 
         Builder->Metadata->Flags.IsAckEliciting = TRUE;
         Builder->Metadata->Frames[Builder->Metadata->FrameCount].Type = QUIC_FRAME_DATAGRAM;
@@ -545,7 +599,7 @@ _IRQL_requires_max_(PASSIVE_LEVEL)
 BOOLEAN
 QuicDatagramProcessFrame(
     _In_ QUIC_DATAGRAM* Datagram,
-    _In_ const QUIC_RECV_PACKET* const Packet,
+    _In_ QUIC_RECV_PACKET* const Packet,
     _In_ QUIC_FRAME_TYPE FrameType,
     _In_ uint16_t BufferLength,
     _In_reads_bytes_(BufferLength)
@@ -562,24 +616,103 @@ QuicDatagramProcessFrame(
 
     // TODO - If we ever limit max receive length, validate it here.
 
+    QUIC_CONNECTION* Connection = QuicDatagramGetConnection(Datagram);
     const QUIC_BUFFER QuicBuffer = { (uint16_t)Frame.Length, (uint8_t*)Frame.Data };
 
+    QUIC_DATAGRAM_RECV_LOAN* Loan = NULL;
+    if (Datagram->ReceiveLendingEnabled) {
+        Loan = QUIC_ALLOC_NONPAGED(sizeof(QUIC_DATAGRAM_RECV_LOAN));
+        if (Loan == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "Datagram receive loan",
+                sizeof(QUIC_DATAGRAM_RECV_LOAN));
+            return TRUE; // Datagrams are unreliable, so it's just dropped.
+        }
+        Loan->Buffer = QuicBuffer;
+        Loan->RecvDatagram = QuicDataPathRecvPacketToRecvDatagram(Packet);
+    }
+
     QUIC_CONNECTION_EVENT Event;
     Event.Type = QUIC_CONNECTION_EVENT_DATAGRAM_RECEIVED;
-    Event.DATAGRAM_RECEIVED.Buffer = &QuicBuffer;
+    Event.DATAGRAM_RECEIVED.Buffer = Loan != NULL ? &Loan->Buffer : &QuicBuffer;
     if (Packet->EncryptedWith0Rtt) {
         Event.DATAGRAM_RECEIVED.Flags = QUIC_RECEIVE_FLAG_0_RTT;
     } else {
         Event.DATAGRAM_RECEIVED.Flags = 0;
     }
 
-    QUIC_CONNECTION* Connection = QuicDatagramGetConnection(Datagram);
     QuicTraceLogConnVerbose(
         IndicateDatagramReceived,
         Connection,
         "Indicating DATAGRAM_RECEIVED [len=%hu]",
         (uint16_t)Frame.Length);
-    (void)QuicConnIndicateEvent(Connection, &Event);
+    QUIC_STATUS Status = QuicConnIndicateEvent(Connection, &Event);
+
+    if (Loan != NULL) {
+        if (Status == QUIC_STATUS_PENDING) {
+            //
+            // The app kept the buffer, so the UDP datagram is held until the
+            // app returns it. The connection returns the datagram as usual if
+            // the app is done with it first.
+            //
+            Packet->StreamRefCount++;
+            QuicListInsertTail(&Datagram->RecvLoans, &Loan->Link);
+        } else {
+            QUIC_FREE(Loan);
+        }
+    }
 
     return TRUE;
 }
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDatagramReleaseRecvLoan(
+    _In_ QUIC_DATAGRAM_RECV_LOAN* Loan
+    )
+{
+    QUIC_RECV_PACKET* Packet =
+        QuicDataPathRecvDatagramToRecvPacket(Loan->RecvDatagram);
+    QUIC_DBG_ASSERT(Packet->StreamRefCount != 0);
+
+    QuicListEntryRemove(&Loan->Link);
+    if (--Packet->StreamRefCount == 0 && Packet->ReleasedToStreams) {
+        QuicDataPathBindingReturnRecvDatagrams(Loan->RecvDatagram);
+    }
+    QUIC_FREE(Loan);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDatagramReceiveComplete(
+    _In_ QUIC_DATAGRAM* Datagram,
+    _In_ const QUIC_BUFFER* Buffer
+    )
+{
+    QUIC_DATAGRAM_RECV_LOAN* Loan =
+        QUIC_CONTAINING_RECORD(Buffer, QUIC_DATAGRAM_RECV_LOAN, Buffer);
+
+    QuicTraceLogConnVerbose(
+        DatagramReceiveComplete,
+        QuicDatagramGetConnection(Datagram),
+        "Datagram receive complete [len=%hu]",
+        (uint16_t)Buffer->Length);
+    QuicDatagramReleaseRecvLoan(Loan);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDatagramReturnRecvLoans(
+    _In_ QUIC_DATAGRAM* Datagram
+    )
+{
+    while (!QuicListIsEmpty(&Datagram->RecvLoans)) {
+        QuicDatagramReleaseRecvLoan(
+            QUIC_CONTAINING_RECORD(
+                Datagram->RecvLoans.Flink,
+                QUIC_DATAGRAM_RECV_LOAN,
+                Link));
+    }
+}
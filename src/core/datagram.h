@@ -5,6 +5,26 @@
 
 --*/
 
+//
+// A DATAGRAM frame payload lent to the app, which holds the received UDP
+// datagram it points into until the app returns it.
+//
+typedef struct QUIC_DATAGRAM_RECV_LOAN {
+
+    //
+    // Link in the QUIC_DATAGRAM's RecvLoans list.
+    //
+    QUIC_LIST_ENTRY Link;
+
+    //
+    // The buffer indicated to the app.
+    //
+    QUIC_BUFFER Buffer;
+
+    QUIC_RECV_DATAGRAM* RecvDatagram;
+
+} QUIC_DATAGRAM_RECV_LOAN;
+
 typedef struct QUIC_DATAGRAM {
 
     //
@@ -20,8 +40,14 @@ typedef struct QUIC_DATAGRAM {
     // send queue.
     //
     QUIC_SEND_REQUEST* ApiQueue;
+    QUIC_SEND_REQUEST** ApiQueueTail;
     QUIC_DISPATCH_LOCK ApiQueueLock;
 
+    //
+    // The received payloads still lent to the app.
+    //
+    QUIC_LIST_ENTRY RecvLoans;
+
     //
     // The maximum datagram frame we allow the peer to send.
     //
@@ -44,6 +70,12 @@ typedef struct QUIC_DATAGRAM {
     //
     BOOLEAN SendEnabled : 1;
 
+    //
+    // Indicates the app may keep received payloads after the receive event
+    // (see QUIC_PARAM_CONN_DATAGRAM_RECEIVE_LENDING).
+    //
+    BOOLEAN ReceiveLendingEnabled : 1;
+
 } QUIC_DATAGRAM;
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -105,11 +137,30 @@ QuicDatagramIndicateSendStateChange(
     _In_ QUIC_DATAGRAM_SEND_STATE State
     );
 
+//
+// Returns a payload the app kept from a receive event.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDatagramReceiveComplete(
+    _In_ QUIC_DATAGRAM* Datagram,
+    _In_ const QUIC_BUFFER* Buffer
+    );
+
+//
+// Reclaims all the payloads still lent to the app.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDatagramReturnRecvLoans(
+    _In_ QUIC_DATAGRAM* Datagram
+    );
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 BOOLEAN
 QuicDatagramProcessFrame(
     _In_ QUIC_DATAGRAM* Datagram,
-    _In_ const QUIC_RECV_PACKET* const Packet,
+    _In_ QUIC_RECV_PACKET* const Packet,
     _In_ QUIC_FRAME_TYPE FrameType,
     _In_ uint16_t BufferLength,
     _In_reads_bytes_(BufferLength)
@@ -0,0 +1,234 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    The decrypt helper pool lets a single busy connection use more than one
+    core for packet decryption. When a worker has a large enough run of 1-RTT
+    packets to decrypt, it hands the later packets to a helper thread and
+    decrypts the earlier ones itself. It then processes the frames of its own
+    packets while the helper is still decrypting, and only waits for the
+    helper once it reaches the first of the helper's packets. Frames are still
+    processed strictly in packet order, on the worker.
+
+    A helper decrypts with its own copy of the connection's read key (see
+    QuicCryptoGetHelperReadKey), since a key's cipher context can only be used
+    by one thread at a time.
+
+    Jobs are short (a few packets, i.e. a few microseconds of work), so an
+    event round trip for each would cost about as much as the job saves.
+    Instead, a helper keeps polling for the next job for a little while
+    (QUIC_DECRYPT_HELPER_POLL_US) after each one before blocking, and a worker
+    spins for a little while (QUIC_DECRYPT_HELPER_SPIN_US) for a job to finish
+    before blocking. Each side only signals the other's event if the other
+    announced it's going to block. Both yield the processor between checks,
+    since the helper may share a core with the worker (or with another one)
+    and would otherwise keep it from running.
+
+    Workers never wait for a busy helper though: if none is idle, they decrypt
+    everything themselves, as without the pool.
+
+--*/
+
+#include "precomp.h"
+#ifdef QUIC_CLOG
+#include "decrypt_helper.c.clog.h"
+#endif
+
+QUIC_THREAD_CALLBACK(QuicDecryptHelperThread, Context);
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDecryptHelperPoolInitialize(
+    _In_ uint16_t ThreadCount,
+    _Out_ QUIC_DECRYPT_HELPER_POOL** NewPool
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    const size_t PoolSize =
+        sizeof(QUIC_DECRYPT_HELPER_POOL) + ThreadCount * sizeof(QUIC_DECRYPT_HELPER);
+
+    QUIC_DECRYPT_HELPER_POOL* Pool = QUIC_ALLOC_NONPAGED(PoolSize);
+    if (Pool == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_DECRYPT_HELPER_POOL",
+            PoolSize);
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    QuicZeroMemory(Pool, PoolSize);
+    Pool->Enabled = TRUE;
+
+    for (uint16_t i = 0; i < ThreadCount; ++i) {
+        QUIC_DECRYPT_HELPER* Helper = &Pool->Helpers[i];
+        Helper->Pool = Pool;
+        Helper->State = QUIC_DECRYPT_HELPER_IDLE;
+        QuicEventInitialize(&Helper->Ready, FALSE, FALSE);
+        QuicEventInitialize(&Helper->Done, FALSE, FALSE);
+
+        QUIC_THREAD_CONFIG ThreadConfig = {
+            0,
+            (uint8_t)(i % QuicProcActiveCount()),
+            "quic_decrypt",
+            QuicDecryptHelperThread,
+            Helper
+        };
+        Status = QuicThreadCreate(&ThreadConfig, &Helper->Thread);
+        if (QUIC_FAILED(Status)) {
+            QuicTraceEvent(
+                LibraryErrorStatus,
+                "[ lib] ERROR, %u, %s.",
+                Status,
+                "QuicThreadCreate (decrypt helper)");
+            QuicEventUninitialize(Helper->Ready);
+            QuicEventUninitialize(Helper->Done);
+            break;
+        }
+        Pool->HelperCount++;
+    }
+
+    if (QUIC_FAILED(Status)) {
+        QuicDecryptHelperPoolUninitialize(Pool);
+        return Status;
+    }
+
+    QuicTraceLogInfo(
+        DecryptHelperPoolCreated,
+        "[ lib] Decrypt helper pool created with %hu threads",
+        ThreadCount);
+
+    *NewPool = Pool;
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDecryptHelperPoolUninitialize(
+    _In_ QUIC_DECRYPT_HELPER_POOL* Pool
+    )
+{
+    Pool->Enabled = FALSE;
+    MemoryBarrier();
+
+    for (uint16_t i = 0; i < Pool->HelperCount; ++i) {
+        QUIC_DECRYPT_HELPER* Helper = &Pool->Helpers[i];
+        QUIC_DBG_ASSERT(Helper->State == QUIC_DECRYPT_HELPER_IDLE);
+        QuicEventSet(Helper->Ready);
+        QuicThreadWait(&Helper->Thread);
+        QuicThreadDelete(&Helper->Thread);
+        QuicEventUninitialize(Helper->Ready);
+        QuicEventUninitialize(Helper->Done);
+    }
+
+    QUIC_FREE(Pool);
+}
+
+QUIC_THREAD_CALLBACK(QuicDecryptHelperThread, Context)
+{
+    QUIC_DECRYPT_HELPER* Helper = (QUIC_DECRYPT_HELPER*)Context;
+    QUIC_DECRYPT_HELPER_POOL* Pool = Helper->Pool;
+    uint64_t LastJobTime = QuicTimeUs64();
+
+    while (Pool->Enabled) {
+
+        if (Helper->State == QUIC_DECRYPT_HELPER_QUEUED) {
+            MemoryBarrier(); // Read the job only after seeing it queued.
+            QuicDecryptBatch(Helper->Key, Helper->EntryCount, Helper->Entries);
+            //
+            // The worker may reuse the entries as soon as this is set, so
+            // they must not be touched after this.
+            //
+            InterlockedExchange(&Helper->State, QUIC_DECRYPT_HELPER_DONE);
+            if (Helper->Waiting) {
+                QuicEventSet(Helper->Done);
+            }
+            LastJobTime = QuicTimeUs64();
+            continue;
+        }
+
+        if (QuicTimeDiff64(LastJobTime, QuicTimeUs64()) < QUIC_DECRYPT_HELPER_POLL_US) {
+            QuicThreadYield();
+            continue;
+        }
+
+        //
+        // Announce that the thread is going to sleep before checking for a
+        // job one last time, so that a job queued concurrently either is seen
+        // here or signals the event.
+        //
+        InterlockedExchange(&Helper->Sleeping, TRUE);
+        if (Helper->State != QUIC_DECRYPT_HELPER_QUEUED && Pool->Enabled) {
+            QuicEventWaitForever(Helper->Ready);
+        }
+        InterlockedExchange(&Helper->Sleeping, FALSE);
+        LastJobTime = QuicTimeUs64();
+    }
+
+    QUIC_THREAD_RETURN(QUIC_STATUS_SUCCESS);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_DECRYPT_HELPER*
+QuicDecryptHelperStart(
+    _In_ QUIC_DECRYPT_HELPER_POOL* Pool,
+    _In_ uint32_t Hint,
+    _In_ QUIC_KEY* Key,
+    _In_ uint8_t EntryCount,
+    _Inout_updates_(EntryCount)
+        QUIC_DECRYPT_BATCH_ENTRY* Entries
+    )
+{
+    for (uint16_t i = 0; i < Pool->HelperCount; ++i) {
+        QUIC_DECRYPT_HELPER* Helper =
+            &Pool->Helpers[(Hint + i) % Pool->HelperCount];
+        if (Helper->State != QUIC_DECRYPT_HELPER_IDLE ||
+            InterlockedCompareExchange(
+                &Helper->State,
+                QUIC_DECRYPT_HELPER_CLAIMED,
+                QUIC_DECRYPT_HELPER_IDLE) != QUIC_DECRYPT_HELPER_IDLE) {
+            continue;
+        }
+
+        Helper->Key = Key;
+        Helper->EntryCount = EntryCount;
+        Helper->Entries = Entries;
+        InterlockedExchange(&Helper->State, QUIC_DECRYPT_HELPER_QUEUED);
+        if (Helper->Sleeping) {
+            QuicEventSet(Helper->Ready);
+        }
+        return Helper;
+    }
+
+    return NULL;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDecryptHelperWait(
+    _In_ QUIC_DECRYPT_HELPER* Helper
+    )
+{
+    if (Helper->State != QUIC_DECRYPT_HELPER_DONE) {
+        const uint64_t SpinStart = QuicTimeUs64();
+        while (Helper->State != QUIC_DECRYPT_HELPER_DONE &&
+               QuicTimeDiff64(SpinStart, QuicTimeUs64()) < QUIC_DECRYPT_HELPER_SPIN_US) {
+            QuicThreadYield();
+        }
+
+        //
+        // Same as the helper: announce the wait before checking one last
+        // time, so that the job finishing concurrently signals the event.
+        //
+        InterlockedExchange(&Helper->Waiting, TRUE);
+        while (Helper->State != QUIC_DECRYPT_HELPER_DONE) {
+            QuicEventWaitForever(Helper->Done);
+        }
+        InterlockedExchange(&Helper->Waiting, FALSE);
+    }
+    MemoryBarrier(); // Read the results only after seeing them done.
+    InterlockedExchange(&Helper->State, QUIC_DECRYPT_HELPER_IDLE);
+}
@@ -0,0 +1,129 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Definitions for the decrypt helper pool, which decrypts part of a
+    connection's receive batch on another core while the worker processes the
+    frames of the packets before it.
+
+--*/
+
+#define QUIC_DECRYPT_HELPER_IDLE        0   // Free to be claimed by a worker.
+#define QUIC_DECRYPT_HELPER_CLAIMED     1   // A worker is filling in the job.
+#define QUIC_DECRYPT_HELPER_QUEUED      2   // The job is ready to be decrypted.
+#define QUIC_DECRYPT_HELPER_DONE        3   // The job has been decrypted.
+
+//
+// A single helper thread. It processes one job at a time, handed to it by a
+// worker, which then waits for it before touching the job's packets again.
+//
+typedef struct QUIC_DECRYPT_HELPER {
+
+    struct QUIC_DECRYPT_HELPER_POOL* Pool;
+
+    //
+    // One of the QUIC_DECRYPT_HELPER_* states.
+    //
+    long volatile State;
+
+    //
+    // Set while the thread is (about to be) blocked on Ready, rather than
+    // polling State.
+    //
+    long volatile Sleeping;
+
+    //
+    // Set while the worker is (about to be) blocked on Done, rather than
+    // spinning on State.
+    //
+    long volatile Waiting;
+
+    //
+    // Auto-reset event signaled to wake the thread up when a job is queued
+    // (or the pool stops).
+    //
+    QUIC_EVENT Ready;
+
+    //
+    // Auto-reset event signaled to wake the worker up when a job is done.
+    // Both events may be left signaled from an earlier job, so waiters must
+    // check State again after waking.
+    //
+    QUIC_EVENT Done;
+
+    //
+    // The job: the entries to decrypt with the key. No other thread may use
+    // the key until the job is done.
+    //
+    QUIC_KEY* Key;
+    uint8_t EntryCount;
+    QUIC_DECRYPT_BATCH_ENTRY* Entries;
+
+    QUIC_THREAD Thread;
+
+} QUIC_DECRYPT_HELPER;
+
+//
+// The set of decrypt helpers.
+//
+typedef struct QUIC_DECRYPT_HELPER_POOL {
+
+    //
+    // Indicates the threads should keep running.
+    //
+    BOOLEAN volatile Enabled;
+
+    uint16_t HelperCount;
+    QUIC_DECRYPT_HELPER Helpers[0];
+
+} QUIC_DECRYPT_HELPER_POOL;
+
+//
+// Creates the pool and its threads.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDecryptHelperPoolInitialize(
+    _In_ uint16_t ThreadCount,
+    _Out_ QUIC_DECRYPT_HELPER_POOL** NewPool
+    );
+
+//
+// Stops the threads and cleans up the pool. No job may be outstanding.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDecryptHelperPoolUninitialize(
+    _In_ QUIC_DECRYPT_HELPER_POOL* Pool
+    );
+
+//
+// Hands the entries to an idle helper, starting the search at the one for
+// the given hint (e.g. the worker's processor). Returns NULL, without waiting,
+// if all of them are busy, in which case the caller decrypts the entries
+// itself. Otherwise, the caller must call QuicDecryptHelperWait before using
+// the entries (or the key) again.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_DECRYPT_HELPER*
+QuicDecryptHelperStart(
+    _In_ QUIC_DECRYPT_HELPER_POOL* Pool,
+    _In_ uint32_t Hint,
+    _In_ QUIC_KEY* Key,
+    _In_ uint8_t EntryCount,
+    _Inout_updates_(EntryCount)
+        QUIC_DECRYPT_BATCH_ENTRY* Entries
+    );
+
+//
+// Waits for the helper to finish decrypting the entries it was given, and
+// makes it available to other jobs.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDecryptHelperWait(
+    _In_ QUIC_DECRYPT_HELPER* Helper
+    );
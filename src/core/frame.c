@@ -163,7 +163,7 @@ QuicAckEcnEncode(
 {
     uint16_t RequiredLength =
         QuicVarIntSize(Ecn->ECT_0_Count) +
-        QuicVarIntSize(Ecn->ECT_0_Count) +
+        QuicVarIntSize(Ecn->ECT_1_Count) +
         QuicVarIntSize(Ecn->CE_Count);
 
     if (BufferLength < *Offset + RequiredLength) {
@@ -172,7 +172,7 @@ QuicAckEcnEncode(
 
     Buffer = Buffer + *Offset;
     Buffer = QuicVarIntEncode(Ecn->ECT_0_Count, Buffer);
-    Buffer = QuicVarIntEncode(Ecn->ECT_0_Count, Buffer);
+    Buffer = QuicVarIntEncode(Ecn->ECT_1_Count, Buffer);
     Buffer = QuicVarIntEncode(Ecn->CE_Count, Buffer);
     *Offset += RequiredLength;
 
@@ -266,6 +266,86 @@ QuicAckFrameEncode(
     return TRUE;
 }
 
+void
+QuicAckBlocksEncode(
+    _In_ const QUIC_RANGE * const AckBlocks,
+    _In_ uint16_t BufferLength,
+    _Out_writes_to_(BufferLength, *Length) uint8_t* Buffer,
+    _Out_ uint16_t* Length,
+    _Out_ uint32_t* BlockCount
+    )
+{
+    uint32_t i = QuicRangeSize(AckBlocks) - 1;
+    uint64_t Largest = QuicRangeGet(AckBlocks, i)->Low;
+
+    *Length = 0;
+    *BlockCount = 0;
+
+    while (i != 0) {
+
+        QUIC_SUBRANGE* Next = QuicRangeGet(AckBlocks, i - 1);
+        uint64_t NextLargest = QuicRangeGetHigh(Next);
+
+        QUIC_DBG_ASSERT(Largest > NextLargest + 1);
+        QUIC_DBG_ASSERT(Next->Count > 0);
+
+        QUIC_ACK_BLOCK_EX Block = {
+            (Largest - NextLargest) - 2,    // Gap
+            Next->Count - 1                 // AckBlock
+        };
+
+        if (!QuicAckBlockEncode(&Block, Length, BufferLength, Buffer)) {
+            break; // The older blocks are left out.
+        }
+        (*BlockCount)++;
+
+        Largest = Next->Low;
+        i--;
+    }
+}
+
+_Success_(return != FALSE)
+BOOLEAN
+QuicAckFrameEncodeWithBlocks(
+    _In_ const QUIC_RANGE * const AckBlocks,
+    _In_ uint64_t AckDelay,
+    _In_opt_ QUIC_ACK_ECN_EX* Ecn,
+    _In_ uint32_t EncodedBlockCount,
+    _In_ uint16_t EncodedBlocksLength,
+    _In_reads_bytes_(EncodedBlocksLength) const uint8_t* EncodedBlocks,
+    _Inout_ uint16_t* Offset,
+    _In_ uint16_t BufferLength,
+    _Out_writes_to_(BufferLength, *Offset) uint8_t* Buffer
+    )
+{
+    QUIC_SUBRANGE* LastSub =
+        QuicRangeGet(AckBlocks, QuicRangeSize(AckBlocks) - 1);
+
+    QUIC_ACK_EX Frame = {
+        QuicRangeGetHigh(LastSub),  // LargestAcknowledged
+        AckDelay,                   // AckDelay
+        EncodedBlockCount,          // AdditionalAckBlockCount
+        LastSub->Count - 1          // FirstAckBlock
+    };
+
+    uint16_t NewOffset = *Offset;
+    if (!QuicAckHeaderEncode(&Frame, Ecn, &NewOffset, BufferLength, Buffer) ||
+        BufferLength < NewOffset + EncodedBlocksLength) {
+        return FALSE;
+    }
+
+    QuicCopyMemory(Buffer + NewOffset, EncodedBlocks, EncodedBlocksLength);
+    NewOffset += EncodedBlocksLength;
+
+    if (Ecn != NULL &&
+        !QuicAckEcnEncode(Ecn, &NewOffset, BufferLength, Buffer)) {
+        return FALSE;
+    }
+
+    *Offset = NewOffset;
+    return TRUE;
+}
+
 //
 // Given that the max UDP packet is 64k, this is a reasonable upper bound for
 // the number of ACK blocks possible.
@@ -292,7 +372,7 @@ QuicAckFrameDecode(
     )
 {
     *InvalidFrame = FALSE;
-    QUIC_DBG_ASSERT(AckRanges->SubRanges); // Should be pre-initialized.
+    QUIC_DBG_ASSERT(AckRanges->SubRanges != NULL || AckRanges->Blocks != NULL); // Should be pre-initialized.
 
     //
     // Decode the ACK frame header.
@@ -1196,6 +1276,59 @@ QuicDatagramFrameDecode(
     return TRUE;
 }
 
+_Success_(return != FALSE)
+BOOLEAN
+QuicAckFrequencyFrameEncode(
+    _In_ const QUIC_ACK_FREQUENCY_EX * const Frame,
+    _Inout_ uint16_t* Offset,
+    _In_ uint16_t BufferLength,
+    _Out_writes_to_(BufferLength, *Offset) uint8_t* Buffer
+    )
+{
+    uint16_t RequiredLength =
+        QuicVarIntSize(QUIC_FRAME_ACK_FREQUENCY) +
+        QuicVarIntSize(Frame->SequenceNumber) +
+        QuicVarIntSize(Frame->PacketTolerance) +
+        QuicVarIntSize(Frame->UpdateMaxAckDelay) +
+        sizeof(uint8_t);      // IgnoreOrder
+
+    if (BufferLength < *Offset + RequiredLength) {
+        return FALSE;
+    }
+
+    Buffer = Buffer + *Offset;
+    Buffer = QuicVarIntEncode(QUIC_FRAME_ACK_FREQUENCY, Buffer);
+    Buffer = QuicVarIntEncode(Frame->SequenceNumber, Buffer);
+    Buffer = QuicVarIntEncode(Frame->PacketTolerance, Buffer);
+    Buffer = QuicVarIntEncode(Frame->UpdateMaxAckDelay, Buffer);
+    QuicUint8Encode(Frame->IgnoreOrder, Buffer);
+    *Offset += RequiredLength;
+
+    return TRUE;
+}
+
+_Success_(return != FALSE)
+BOOLEAN
+QuicAckFrequencyFrameDecode(
+    _In_ uint16_t BufferLength,
+    _In_reads_bytes_(BufferLength)
+        const uint8_t * const Buffer,
+    _Inout_ uint16_t* Offset,
+    _Out_ QUIC_ACK_FREQUENCY_EX* Frame
+    )
+{
+    if (!QuicVarIntDecode(BufferLength, Buffer, Offset, &Frame->SequenceNumber) ||
+        !QuicVarIntDecode(BufferLength, Buffer, Offset, &Frame->PacketTolerance) ||
+        !QuicVarIntDecode(BufferLength, Buffer, Offset, &Frame->UpdateMaxAckDelay) ||
+        BufferLength < *Offset + sizeof(uint8_t) ||
+        Buffer[*Offset] > 1) { // IgnoreOrder must be 0 or 1.
+        return FALSE;
+    }
+    Frame->IgnoreOrder = Buffer[*Offset];
+    *Offset += sizeof(uint8_t);
+    return TRUE;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 BOOLEAN
 QuicFrameLog(
@@ -1208,19 +1341,29 @@ QuicFrameLog(
     _Inout_ uint16_t* Offset
     )
 {
-    QUIC_FRAME_TYPE FrameType = Packet[*Offset];
-    if (!QUIC_FRAME_IS_KNOWN(FrameType)) {
+    QUIC_VAR_INT FrameTypeValue;
+    if (!QuicVarIntDecode(PacketLength, Packet, Offset, &FrameTypeValue)) {
+        QuicTraceLogVerbose(
+            FrameLogInvalidType,
+            "[%c][%cX][%llu]   invalid frame type",
+            PtkConnPre(Connection),
+            PktRxPre(Rx),
+            PacketNumber);
+        return FALSE;
+    }
+
+    if (!QUIC_FRAME_IS_KNOWN(FrameTypeValue)) {
         QuicTraceLogVerbose(
             FrameLogUnknownType,
-            "[%c][%cX][%llu]   unknown frame (%hu)",
+            "[%c][%cX][%llu]   unknown frame (%llu)",
             PtkConnPre(Connection),
             PktRxPre(Rx),
             PacketNumber,
-            FrameType);
+            FrameTypeValue);
         return FALSE;
     }
 
-    *Offset += 1;
+    QUIC_FRAME_TYPE FrameType = (QUIC_FRAME_TYPE)FrameTypeValue;
 
     switch (FrameType) {
 
@@ -1766,6 +1909,41 @@ QuicFrameLog(
         break;
     }
 
+    case QUIC_FRAME_IMMEDIATE_ACK: {
+        QuicTraceLogVerbose(
+            FrameLogImmediateAck,
+            "[%c][%cX][%llu]   IMMEDIATE_ACK",
+            PtkConnPre(Connection),
+            PktRxPre(Rx),
+            PacketNumber);
+        break;
+    }
+
+    case QUIC_FRAME_ACK_FREQUENCY: {
+        QUIC_ACK_FREQUENCY_EX Frame;
+        if (!QuicAckFrequencyFrameDecode(PacketLength, Packet, Offset, &Frame)) {
+            QuicTraceLogVerbose(
+                FrameLogAckFrequencyInvalid,
+                "[%c][%cX][%llu]   ACK_FREQUENCY [Invalid]",
+                PtkConnPre(Connection),
+                PktRxPre(Rx),
+                PacketNumber);
+            return FALSE;
+        }
+
+        QuicTraceLogVerbose(
+            FrameLogAckFrequency,
+            "[%c][%cX][%llu]   ACK_FREQUENCY SeqNum:%llu PktTolerance:%llu MaxAckDelay:%llu IgnoreOrder:%hhu",
+            PtkConnPre(Connection),
+            PktRxPre(Rx),
+            PacketNumber,
+            Frame.SequenceNumber,
+            Frame.PacketTolerance,
+            Frame.UpdateMaxAckDelay,
+            Frame.IgnoreOrder);
+        break;
+    }
+
     case QUIC_FRAME_DATAGRAM:
     case QUIC_FRAME_DATAGRAM_1: {
         QUIC_DATAGRAM_EX Frame;
@@ -1808,6 +1986,10 @@ QuicFrameLogAll(
     _In_ uint16_t Offset
     )
 {
+    if (!QuicTraceLogVerboseEnabled()) {
+        return;
+    }
+
     BOOLEAN ProcessFrames = TRUE;
     while (ProcessFrames && Offset < PacketLength) {
         ProcessFrames =
@@ -118,12 +118,18 @@ typedef enum QUIC_FRAME_TYPE {
     /* 0x1f to 0x2f are unused currently */
     QUIC_FRAME_DATAGRAM             = 0x30, // to 0x31
     QUIC_FRAME_DATAGRAM_1           = 0x31,
+    /* 0x32 to 0xab are unused currently */
+    QUIC_FRAME_IMMEDIATE_ACK        = 0xac,
+    /* 0xad to 0xae are unused currently */
+    QUIC_FRAME_ACK_FREQUENCY        = 0xaf,
 
 } QUIC_FRAME_TYPE;
 
 #define QUIC_FRAME_IS_KNOWN(X) \
     (X <= QUIC_FRAME_HANDSHAKE_DONE || \
-    (X >= QUIC_FRAME_DATAGRAM && X <= QUIC_FRAME_DATAGRAM_1))
+    (X >= QUIC_FRAME_DATAGRAM && X <= QUIC_FRAME_DATAGRAM_1) || \
+    X == QUIC_FRAME_IMMEDIATE_ACK || \
+    X == QUIC_FRAME_ACK_FREQUENCY)
 
 //
 // QUIC_FRAME_ACK Encoding/Decoding
@@ -165,6 +171,41 @@ QuicAckFrameEncode(
         uint8_t* Buffer
     );
 
+//
+// Encodes the additional ACK blocks (all but the one with the largest packet
+// numbers) from the largest packet numbers down. Stops early, at a block
+// boundary, if they don't all fit in BufferLength bytes.
+//
+void
+QuicAckBlocksEncode(
+    _In_ const QUIC_RANGE * const AckBlocks,
+    _In_ uint16_t BufferLength,
+    _Out_writes_to_(BufferLength, *Length)
+        uint8_t* Buffer,
+    _Out_ uint16_t* Length,
+    _Out_ uint32_t* BlockCount
+    );
+
+//
+// Encodes an ACK frame from the given ranges, using additional ACK blocks
+// previously encoded by QuicAckBlocksEncode for them.
+//
+_Success_(return != FALSE)
+BOOLEAN
+QuicAckFrameEncodeWithBlocks(
+    _In_ const QUIC_RANGE * const AckBlocks,
+    _In_ uint64_t AckDelay,
+    _In_opt_ QUIC_ACK_ECN_EX* Ecn,
+    _In_ uint32_t EncodedBlockCount,
+    _In_ uint16_t EncodedBlocksLength,
+    _In_reads_bytes_(EncodedBlocksLength)
+        const uint8_t* EncodedBlocks,
+    _Inout_ uint16_t* Offset,
+    _In_ uint16_t BufferLength,
+    _Out_writes_to_(BufferLength, *Offset)
+        uint8_t* Buffer
+    );
+
 _Success_(return != FALSE)
 BOOLEAN
 QuicAckFrameDecode(
@@ -754,6 +795,39 @@ QuicDatagramFrameDecode(
     _Out_ QUIC_DATAGRAM_EX* Frame
     );
 
+//
+// QUIC_FRAME_ACK_FREQUENCY Encoding/Decoding
+//
+
+typedef struct QUIC_ACK_FREQUENCY_EX {
+
+    QUIC_VAR_INT SequenceNumber;
+    QUIC_VAR_INT PacketTolerance;
+    QUIC_VAR_INT UpdateMaxAckDelay; // In microseconds (us)
+    BOOLEAN IgnoreOrder;
+
+} QUIC_ACK_FREQUENCY_EX;
+
+_Success_(return != FALSE)
+BOOLEAN
+QuicAckFrequencyFrameEncode(
+    _In_ const QUIC_ACK_FREQUENCY_EX * const Frame,
+    _Inout_ uint16_t* Offset,
+    _In_ uint16_t BufferLength,
+    _Out_writes_to_(BufferLength, *Offset)
+        uint8_t* Buffer
+    );
+
+_Success_(return != FALSE)
+BOOLEAN
+QuicAckFrequencyFrameDecode(
+    _In_ uint16_t BufferLength,
+    _In_reads_bytes_(BufferLength)
+        const uint8_t * const Buffer,
+    _Inout_ uint16_t* Offset,
+    _Out_ QUIC_ACK_FREQUENCY_EX* Frame
+    );
+
 //
 // Helper functions
 //
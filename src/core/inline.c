@@ -35,6 +35,15 @@ QuicCidNewSource(
         const uint8_t* const Data
     );
 
+BOOLEAN
+QuicCidDataEqual(
+    _In_reads_(Length)
+        const uint8_t* const A,
+    _In_reads_(Length)
+        const uint8_t* const B,
+    _In_ uint8_t Length
+    );
+
 QUIC_CID_HASH_ENTRY*
 QuicCidNewNullSource(
     _In_ QUIC_CONNECTION* Connection
@@ -42,6 +51,7 @@ QuicCidNewNullSource(
 
 QUIC_CID_HASH_ENTRY*
 QuicCidNewRandomSource(
+    _Inout_ QUIC_RANDOM_STREAM* Random,
     _In_opt_ QUIC_CONNECTION* Connection,
     _In_reads_opt_(MsQuicLib.CidServerIdLength)
         const void* ServerID,
@@ -145,6 +155,25 @@ QuicLibraryGetCurrentPartition(
     void
     );
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint64_t
+QuicLibraryGetMemoryBudget(
+    void
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicLibraryIsMemoryBudgetExceeded(
+    void
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicPerfCounterAdd(
+    _In_ QUIC_PERFORMANCE_COUNTERS Type,
+    _In_ int64_t Value
+    );
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 uint8_t
 QuicPartitionIdCreate(
@@ -214,6 +243,18 @@ QuicCryptoCombineIvAndPacketNumber(
         uint8_t* IvOut
     );
 
+void
+QuicHistogramAddSample(
+    _Inout_updates_(QUIC_HISTOGRAM_BUCKET_COUNT) uint32_t* Buckets,
+    _In_ uint64_t Value
+    );
+
+void
+QuicHistogramAggregate(
+    _Inout_ QUIC_HISTOGRAM* Total,
+    _In_reads_(QUIC_HISTOGRAM_BUCKET_COUNT) const uint32_t* Buckets
+    );
+
 QUIC_SUBRANGE*
 QuicRangeGetSafe(
     _In_ const QUIC_RANGE * const Range,
@@ -271,6 +312,107 @@ QuicCongestionControlCanSend(
     _In_ QUIC_CONGESTION_CONTROL* Cc
     );
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCongestionControlReset(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicCongestionControlGetSendAllowance(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t TimeSinceLastSend,
+    _In_ BOOLEAN TimeSinceLastSendValid
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint64_t
+QuicCongestionControlGetPacingRate(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    );
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicCongestionControlOnDataSent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t NumRetransmittableBytes
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicCongestionControlOnDataInvalidated(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t NumRetransmittableBytes
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicCongestionControlOnDataAcknowledged(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCongestionControlOnDataLost(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t LargestPacketNumberLost,
+    _In_ uint64_t LargestPacketNumberSent,
+    _In_ uint32_t NumRetransmittableBytes,
+    _In_ BOOLEAN PersistentCongestion
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicCongestionControlOnSpuriousCongestionEvent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCongestionControlOnEcn(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t LargestPacketNumberAcked,
+    _In_ uint64_t LargestPacketNumberSent
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCongestionControlSetAppLimited(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicCongestionControlIsAppLimited(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint8_t
+QuicCongestionControlGetExemptions(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicCongestionControlGetBytesInFlightMax(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicCongestionControlGetCongestionWindow(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicCongestionControlLogOutFlowStatus(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    );
+
 QUIC_CONNECTION*
 QuicSendGetConnection(
     _In_ QUIC_SEND* Send
@@ -309,7 +451,7 @@ QuicAckTrackerGetPacketSpace(
 
 QUIC_CONNECTION*
 QuicCongestionControlGetConnection(
-    _In_ QUIC_CONGESTION_CONTROL* Cc
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
     );
 
 QUIC_CID_STR
@@ -467,6 +609,12 @@ QuicPathDecrementAllowance(
     _In_ uint32_t Amount
     );
 
+void
+QuicPathRemoveBytesInFlight(
+    _In_ QUIC_PATH* Path,
+    _In_ uint32_t Bytes
+    );
+
 void
 QuicPktNumDecode(
     _In_ uint8_t PacketNumberLength,
@@ -495,6 +643,15 @@ QuicRangeSearch(
     _In_ const QUIC_RANGE_SEARCH_KEY* Key
     );
 
+#if QUIC_RANGE_USE_BINARY_SEARCH
+int
+QuicRangeSearchSubRanges(
+    _In_reads_(Length) const QUIC_SUBRANGE* SubRanges,
+    _In_ uint32_t Length,
+    _In_ const QUIC_RANGE_SEARCH_KEY* Key
+    );
+#endif
+
 int
 QuicRangeCompare(
     const QUIC_RANGE_SEARCH_KEY* Key,
@@ -524,10 +681,22 @@ QuicWorkerIsOverloaded(
     _In_ QUIC_WORKER* Worker
     );
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicWorkerCanAdmitHandshake(
+    _In_ QUIC_WORKER* Worker,
+    _In_ BOOLEAN IsResumption
+    );
+
 BOOLEAN HasStreamControlFrames(uint32_t Flags);
 
 BOOLEAN HasStreamDataFrames(uint32_t Flags);
 
+void
+QuicConnUpdateBlockedTime(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
 BOOLEAN
 QuicConnAddOutFlowBlockedReason(
     _In_ QUIC_CONNECTION* Connection,
@@ -632,6 +801,12 @@ QuicPacketTraceType(
     _In_ const QUIC_SENT_PACKET_METADATA* Metadata
     );
 
+QUIC_SENT_PACKET_HEADER*
+QuicSentPacketRingGet(
+    _In_ const QUIC_SENT_PACKET_RING* Ring,
+    _In_ uint32_t Index
+    );
+
 int64_t
 QuicTimeEpochMs64(
     void
@@ -0,0 +1,667 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    LEDBAT++ congestion control algorithm (draft-irtf-iccrg-ledbat-plus-plus),
+    for background (scavenger) transfers.
+
+    The window is driven by the queuing delay, i.e. the RTT above the smallest
+    RTT seen: it grows while the delay is below a target, and shrinks in
+    proportion to how far it is above. Since loss based algorithms (like CUBIC)
+    only back off once the queue is full, LEDBAT connections give way to them
+    well before that. Loss is still handled by halving the window.
+
+    Periodic slowdowns (dropping the window to the minimum for a couple of
+    RTTs) let the queue drain, so the base RTT is remeasured and competing
+    LEDBAT flows don't mistake each other's queuing for the base RTT.
+
+--*/
+
+#include "precomp.h"
+#ifdef QUIC_CLOG
+#include "ledbat.c.clog.h"
+#endif
+
+//
+// The queuing delay the algorithm tries to stay below.
+//
+#define QUIC_LEDBAT_TARGET_DELAY            60000   // microsec
+
+//
+// The window growth per RTT is 1/GainDivisor packets, with the divisor
+// derived from the base RTT (larger for shorter RTTs) and capped at this.
+//
+#define QUIC_LEDBAT_MAX_GAIN_DIVISOR        16
+
+//
+// The smallest congestion window, in packets. Also the window used during
+// slowdowns.
+//
+#define QUIC_LEDBAT_MIN_WINDOW_PACKETS      2
+
+//
+// Slowdowns last this many RTTs (plus the slow start back to the previous
+// window), and then wait this many times their duration before the next.
+//
+#define QUIC_LEDBAT_SLOWDOWN_RTTS           2
+#define QUIC_LEDBAT_SLOWDOWN_INTERVAL       9
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+LedbatCongestionControlCanSend(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    return Ledbat->BytesInFlight < Ledbat->CongestionWindow || Ledbat->Exemptions > 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+LedbatCongestionControlSetExemption(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint8_t NumPackets
+    )
+{
+    Cc->Ledbat.Exemptions = NumPackets;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+LedbatCongestionControlReset(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    Ledbat->SlowStartThreshold = UINT32_MAX;
+    Ledbat->IsInRecovery = FALSE;
+    Ledbat->HasHadCongestionEvent = FALSE;
+    Ledbat->SlowdownState = LEDBAT_SLOWDOWN_NOT_SCHEDULED;
+    Ledbat->CongestionWindow = Connection->Paths[0].Mtu * Ledbat->InitialWindowPackets;
+    Ledbat->BytesInFlightMax = Ledbat->CongestionWindow / 2;
+    Ledbat->BytesInFlight = 0;
+    Ledbat->CongAvoidBytesAcked = 0;
+    QuicConnLogOutFlowStats(Connection);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+LedbatCongestionControlGetSendAllowance(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t TimeSinceLastSend, // microsec
+    _In_ BOOLEAN TimeSinceLastSendValid
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    uint32_t SendAllowance;
+
+    if (Ledbat->BytesInFlight >= Ledbat->CongestionWindow) {
+        SendAllowance = 0;
+
+    } else if (!Connection->State.UsePacing ||
+        !Connection->Paths[0].GotFirstRttSample ||
+        Connection->Paths[0].SmoothedRtt < QUIC_SEND_PACING_MIN_RTT ||
+        Ledbat->CongestionWindow < QUIC_SEND_PACING_MIN_CHUNK * Connection->Paths[0].Mtu ||
+        !TimeSinceLastSendValid) {
+        SendAllowance = Ledbat->CongestionWindow - Ledbat->BytesInFlight;
+
+    } else {
+        //
+        // Pace the window over the RTT, the same way as CUBIC (but without
+        // predicting growth, since the window barely grows per RTT).
+        //
+        uint32_t MinChunkSize = QUIC_SEND_PACING_MIN_CHUNK * Connection->Paths[0].Mtu;
+        SendAllowance =
+            (uint32_t)(((uint64_t)Ledbat->CongestionWindow * TimeSinceLastSend) /
+                Connection->Paths[0].SmoothedRtt);
+        if (SendAllowance < MinChunkSize) {
+            SendAllowance = MinChunkSize;
+        }
+        if (SendAllowance > (Ledbat->CongestionWindow - Ledbat->BytesInFlight)) {
+            SendAllowance = Ledbat->CongestionWindow - Ledbat->BytesInFlight;
+        }
+        if (SendAllowance > (Ledbat->CongestionWindow >> 1)) {
+            SendAllowance = Ledbat->CongestionWindow >> 1;
+        }
+    }
+    return SendAllowance;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint64_t
+LedbatCongestionControlGetPacingRate(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    const QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    if (!Connection->State.UsePacing ||
+        !Connection->Paths[0].GotFirstRttSample ||
+        Connection->Paths[0].SmoothedRtt < QUIC_SEND_PACING_MIN_RTT) {
+        return 0;
+    }
+
+    return
+        (uint64_t)Cc->Ledbat.CongestionWindow * MS_TO_US(1000) /
+        Connection->Paths[0].SmoothedRtt;
+}
+
+//
+// Returns TRUE if we became unblocked.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+LedbatCongestionControlUpdateBlockedState(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ BOOLEAN PreviousCanSendState
+    )
+{
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    QuicConnLogOutFlowStats(Connection);
+    if (PreviousCanSendState != LedbatCongestionControlCanSend(Cc)) {
+        if (PreviousCanSendState) {
+            QuicConnAddOutFlowBlockedReason(
+                Connection, QUIC_FLOW_BLOCKED_CONGESTION_CONTROL);
+        } else {
+            QuicConnRemoveOutFlowBlockedReason(
+                Connection, QUIC_FLOW_BLOCKED_CONGESTION_CONTROL);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//
+// Returns the divisor for the window growth: ceil(2 * Target / BaseRtt),
+// between 1 and QUIC_LEDBAT_MAX_GAIN_DIVISOR.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+LedbatCongestionControlGainDivisor(
+    _In_ const QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat
+    )
+{
+    if (Ledbat->BaseRtt == 0) {
+        return QUIC_LEDBAT_MAX_GAIN_DIVISOR;
+    }
+    uint64_t Divisor =
+        (2ull * QUIC_LEDBAT_TARGET_DELAY + Ledbat->BaseRtt - 1) / Ledbat->BaseRtt;
+    if (Divisor < 1) {
+        Divisor = 1;
+    } else if (Divisor > QUIC_LEDBAT_MAX_GAIN_DIVISOR) {
+        Divisor = QUIC_LEDBAT_MAX_GAIN_DIVISOR;
+    }
+    return (uint32_t)Divisor;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+LedbatCongestionControlOnRttSample(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t Rtt // microsec
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    if (Rtt < Ledbat->BaseRtt) {
+        Ledbat->BaseRtt = Rtt;
+    }
+    if (Ledbat->SlowdownState == LEDBAT_SLOWDOWN_ACTIVE &&
+        Rtt < Ledbat->SlowdownMinRtt) {
+        Ledbat->SlowdownMinRtt = Rtt;
+    }
+    Ledbat->QueuingDelay = Rtt - Ledbat->BaseRtt;
+}
+
+//
+// Runs the periodic slowdown state machine for an ACK. Returns FALSE if the
+// window is being held at the minimum for a slowdown.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+LedbatCongestionControlUpdateSlowdown(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t TimeNow, // microsec
+    _In_ uint32_t SmoothedRtt // microsec
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+
+    switch (Ledbat->SlowdownState) {
+    case LEDBAT_SLOWDOWN_NOT_SCHEDULED:
+        if (Ledbat->CongestionWindow >= Ledbat->SlowStartThreshold) {
+            //
+            // The first slowdown is two RTTs after slow start ends.
+            //
+            Ledbat->SlowdownState = LEDBAT_SLOWDOWN_SCHEDULED;
+            Ledbat->SlowdownTime = TimeNow + QUIC_LEDBAT_SLOWDOWN_RTTS * SmoothedRtt;
+        }
+        break;
+
+    case LEDBAT_SLOWDOWN_SCHEDULED:
+        if (QuicTimeAtOrBefore32(Ledbat->SlowdownTime, TimeNow)) {
+            QuicTraceLogConnInfo(
+                LedbatSlowdownStart,
+                Connection,
+                "LEDBAT: Slowdown start, CongestionWindow=%u BaseRtt=%u",
+                Ledbat->CongestionWindow,
+                Ledbat->BaseRtt);
+            Ledbat->SlowdownState = LEDBAT_SLOWDOWN_ACTIVE;
+            Ledbat->SlowdownTime = TimeNow;
+            Ledbat->SlowdownMinRtt = UINT32_MAX;
+            Ledbat->SlowdownWindow = Ledbat->CongestionWindow;
+            Ledbat->CongestionWindow =
+                Connection->Paths[0].Mtu * QUIC_LEDBAT_MIN_WINDOW_PACKETS;
+            return FALSE;
+        }
+        break;
+
+    case LEDBAT_SLOWDOWN_ACTIVE:
+        if (QuicTimeDiff32(Ledbat->SlowdownTime, TimeNow) <
+                QUIC_LEDBAT_SLOWDOWN_RTTS * SmoothedRtt) {
+            return FALSE;
+        }
+        //
+        // The queue should have drained, so the smallest RTT seen during the
+        // slowdown is the new base RTT. Then slow start back up to the window
+        // from before the slowdown.
+        //
+        if (Ledbat->SlowdownMinRtt != UINT32_MAX) {
+            Ledbat->BaseRtt = Ledbat->SlowdownMinRtt;
+        }
+        Ledbat->SlowdownState = LEDBAT_SLOWDOWN_RECOVERING;
+        Ledbat->SlowStartThreshold = Ledbat->SlowdownWindow;
+        break;
+
+    case LEDBAT_SLOWDOWN_RECOVERING:
+        if (Ledbat->CongestionWindow >= Ledbat->SlowStartThreshold) {
+            uint32_t SlowdownDuration = QuicTimeDiff32(Ledbat->SlowdownTime, TimeNow);
+            QuicTraceLogConnInfo(
+                LedbatSlowdownEnd,
+                Connection,
+                "LEDBAT: Slowdown end, CongestionWindow=%u BaseRtt=%u Duration=%u",
+                Ledbat->CongestionWindow,
+                Ledbat->BaseRtt,
+                SlowdownDuration);
+            Ledbat->SlowdownState = LEDBAT_SLOWDOWN_SCHEDULED;
+            Ledbat->SlowdownTime =
+                TimeNow + QUIC_LEDBAT_SLOWDOWN_INTERVAL * SlowdownDuration;
+        }
+        break;
+    }
+
+    return TRUE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+LedbatCongestionControlOnCongestionEvent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t LargestPacketNumberSent
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    QuicTraceEvent(
+        ConnCongestion,
+        "[conn][%p] Congestion event",
+        Connection);
+    QuicTraceProbe(congestion, Connection, FALSE);
+    Connection->Stats.Send.CongestionCount++;
+
+    Ledbat->IsInRecovery = TRUE;
+    Ledbat->HasHadCongestionEvent = TRUE;
+    Ledbat->RecoverySentPacketNumber = LargestPacketNumberSent;
+
+    //
+    // A slowdown in progress is abandoned, and the window halved from where
+    // it was before the slowdown. The next one is scheduled after recovery.
+    //
+    uint32_t Window = Ledbat->CongestionWindow;
+    if (Ledbat->SlowdownState == LEDBAT_SLOWDOWN_ACTIVE ||
+        Ledbat->SlowdownState == LEDBAT_SLOWDOWN_RECOVERING) {
+        Window = Ledbat->SlowdownWindow;
+    }
+    Ledbat->SlowdownState = LEDBAT_SLOWDOWN_NOT_SCHEDULED;
+
+    Ledbat->SlowStartThreshold =
+    Ledbat->CongestionWindow =
+        max(Connection->Paths[0].Mtu * QUIC_LEDBAT_MIN_WINDOW_PACKETS, Window / 2);
+    Ledbat->CongAvoidBytesAcked = 0;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+LedbatCongestionControlOnDataSent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t NumRetransmittableBytes
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    BOOLEAN PreviousCanSendState = LedbatCongestionControlCanSend(Cc);
+
+    Ledbat->BytesInFlight += NumRetransmittableBytes;
+    if (Ledbat->BytesInFlightMax < Ledbat->BytesInFlight) {
+        Ledbat->BytesInFlightMax = Ledbat->BytesInFlight;
+        QuicSendBufferConnectionAdjust(QuicCongestionControlGetConnection(Cc));
+    }
+
+    if (Ledbat->Exemptions > 0) {
+        --Ledbat->Exemptions;
+    }
+
+    LedbatCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+LedbatCongestionControlOnDataInvalidated(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint32_t NumRetransmittableBytes
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    BOOLEAN PreviousCanSendState = LedbatCongestionControlCanSend(Cc);
+
+    QUIC_DBG_ASSERT(Ledbat->BytesInFlight >= NumRetransmittableBytes);
+    Ledbat->BytesInFlight -= NumRetransmittableBytes;
+
+    return LedbatCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+LedbatCongestionControlOnDataAcknowledged(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_ACK_EVENT* AckEvent
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    const uint32_t NumRetransmittableBytes = AckEvent->NumRetransmittableBytes;
+    const uint32_t Mtu = Connection->Paths[0].Mtu;
+    const uint32_t MinWindow = Mtu * QUIC_LEDBAT_MIN_WINDOW_PACKETS;
+    BOOLEAN PreviousCanSendState = LedbatCongestionControlCanSend(Cc);
+
+    QUIC_DBG_ASSERT(Ledbat->BytesInFlight >= NumRetransmittableBytes);
+    Ledbat->BytesInFlight -= NumRetransmittableBytes;
+
+    if (AckEvent->MinRttValid) {
+        LedbatCongestionControlOnRttSample(Cc, AckEvent->MinRtt);
+    }
+
+    if (Ledbat->IsInRecovery) {
+        if (AckEvent->LargestAck > Ledbat->RecoverySentPacketNumber) {
+            QuicTraceEvent(
+                ConnRecoveryExit,
+                "[conn][%p] Recovery complete",
+                Connection);
+            Ledbat->IsInRecovery = FALSE;
+            Ledbat->IsInPersistentCongestion = FALSE;
+        }
+        goto Exit;
+    } else if (NumRetransmittableBytes == 0) {
+        goto Exit;
+    }
+
+    if (!LedbatCongestionControlUpdateSlowdown(
+            Cc, AckEvent->TimeNow, AckEvent->SmoothedRtt)) {
+        goto Exit;
+    }
+
+    uint32_t GainDivisor = LedbatCongestionControlGainDivisor(Ledbat);
+
+    if (Ledbat->CongestionWindow < Ledbat->SlowStartThreshold &&
+        Ledbat->QueuingDelay <= QUIC_LEDBAT_TARGET_DELAY * 3 / 4) {
+        //
+        // Slow Start, at the reduced LEDBAT++ gain.
+        //
+        uint32_t Increase = NumRetransmittableBytes / GainDivisor;
+        Ledbat->CongestionWindow += max(Increase, 1);
+        if (Ledbat->CongestionWindow > Ledbat->SlowStartThreshold) {
+            Ledbat->CongestionWindow = Ledbat->SlowStartThreshold;
+        }
+
+    } else {
+        if (Ledbat->CongestionWindow < Ledbat->SlowStartThreshold) {
+            //
+            // The queue is building up, so slow start is over.
+            //
+            Ledbat->SlowStartThreshold = Ledbat->CongestionWindow;
+        }
+
+        if (Ledbat->QueuingDelay <= QUIC_LEDBAT_TARGET_DELAY) {
+            //
+            // Below the target: grow by 1/GainDivisor packets per RTT.
+            //
+            Ledbat->CongAvoidBytesAcked += NumRetransmittableBytes;
+            uint64_t BytesPerIncrease = (uint64_t)Ledbat->CongestionWindow * GainDivisor;
+            if (Ledbat->CongAvoidBytesAcked >= BytesPerIncrease) {
+                Ledbat->CongAvoidBytesAcked -= (uint32_t)BytesPerIncrease;
+                Ledbat->CongestionWindow += Mtu;
+            }
+
+        } else {
+            //
+            // Above the target: shrink in proportion to the excess delay, but
+            // by no more than half the window per RTT.
+            //
+            uint32_t Decrease =
+                (uint32_t)(((uint64_t)NumRetransmittableBytes *
+                    (Ledbat->QueuingDelay - QUIC_LEDBAT_TARGET_DELAY)) /
+                    QUIC_LEDBAT_TARGET_DELAY);
+            if (Decrease > NumRetransmittableBytes / 2) {
+                Decrease = NumRetransmittableBytes / 2;
+            }
+            if (Ledbat->CongestionWindow < MinWindow + Decrease) {
+                Ledbat->CongestionWindow = MinWindow;
+            } else {
+                Ledbat->CongestionWindow -= Decrease;
+            }
+            Ledbat->CongAvoidBytesAcked = 0;
+        }
+    }
+
+    //
+    // Limit the growth to twice what's actually been in flight, as CUBIC does.
+    //
+    if (Ledbat->CongestionWindow > 2 * Ledbat->BytesInFlightMax) {
+        Ledbat->CongestionWindow = max(2 * Ledbat->BytesInFlightMax, MinWindow);
+    }
+
+Exit:
+
+    return LedbatCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+LedbatCongestionControlOnDataLost(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t LargestPacketNumberLost,
+    _In_ uint64_t LargestPacketNumberSent,
+    _In_ uint32_t NumRetransmittableBytes,
+    _In_ BOOLEAN PersistentCongestion
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    BOOLEAN PreviousCanSendState = LedbatCongestionControlCanSend(Cc);
+
+    if (!Ledbat->HasHadCongestionEvent ||
+        LargestPacketNumberLost > Ledbat->RecoverySentPacketNumber) {
+
+        LedbatCongestionControlOnCongestionEvent(Cc, LargestPacketNumberSent);
+
+        if (PersistentCongestion && !Ledbat->IsInPersistentCongestion) {
+            QuicTraceEvent(
+                ConnPersistentCongestion,
+                "[conn][%p] Persistent congestion event",
+                Connection);
+            QuicTraceProbe(congestion, Connection, TRUE);
+            Connection->Stats.Send.PersistentCongestionCount++;
+            Ledbat->IsInPersistentCongestion = TRUE;
+            Ledbat->CongestionWindow =
+                Connection->Paths[0].Mtu * QUIC_PERSISTENT_CONGESTION_WINDOW_PACKETS;
+        }
+    }
+
+    QUIC_DBG_ASSERT(Ledbat->BytesInFlight >= NumRetransmittableBytes);
+    Ledbat->BytesInFlight -= NumRetransmittableBytes;
+
+    LedbatCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+LedbatCongestionControlOnSpuriousCongestionEvent(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    //
+    // A background transfer has nothing to gain from undoing a reduction.
+    //
+    UNREFERENCED_PARAMETER(Cc);
+    return FALSE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+LedbatCongestionControlOnEcn(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ uint64_t LargestPacketNumberAcked,
+    _In_ uint64_t LargestPacketNumberSent
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    BOOLEAN PreviousCanSendState = LedbatCongestionControlCanSend(Cc);
+
+    if (!Ledbat->HasHadCongestionEvent ||
+        LargestPacketNumberAcked > Ledbat->RecoverySentPacketNumber) {
+        LedbatCongestionControlOnCongestionEvent(Cc, LargestPacketNumberSent);
+    }
+
+    LedbatCongestionControlUpdateBlockedState(Cc, PreviousCanSendState);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+LedbatCongestionControlSetAppLimited(
+    _In_ QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    //
+    // Growth is limited to 2 * BytesInFlightMax instead.
+    //
+    UNREFERENCED_PARAMETER(Cc);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+LedbatCongestionControlIsAppLimited(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    UNREFERENCED_PARAMETER(Cc);
+    return FALSE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint8_t
+LedbatCongestionControlGetExemptions(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Ledbat.Exemptions;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+LedbatCongestionControlGetBytesInFlightMax(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Ledbat.BytesInFlightMax;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+LedbatCongestionControlGetCongestionWindow(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    return Cc->Ledbat.CongestionWindow;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+LedbatCongestionControlLogOutFlowStatus(
+    _In_ const QUIC_CONGESTION_CONTROL* Cc
+    )
+{
+    const QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    const QUIC_PATH* Path = &Connection->Paths[0];
+    const QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    UNREFERENCED_PARAMETER(Connection);
+    UNREFERENCED_PARAMETER(Path);
+    UNREFERENCED_PARAMETER(Ledbat);
+
+    QuicTraceEvent(
+        ConnOutFlowStats,
+        "[conn][%p] OUT: BytesSent=%llu InFlight=%u InFlightMax=%u CWnd=%u SSThresh=%u ConnFC=%llu ISB=%llu PostedBytes=%llu SRtt=%u",
+        Connection,
+        Connection->Stats.Send.TotalBytes,
+        Ledbat->BytesInFlight,
+        Ledbat->BytesInFlightMax,
+        Ledbat->CongestionWindow,
+        Ledbat->SlowStartThreshold,
+        Connection->Send.PeerMaxData - Connection->Send.OrderedStreamBytesSent,
+        Connection->SendBuffer.IdealBytes,
+        Connection->SendBuffer.PostedBytes,
+        Path->GotFirstRttSample ? Path->SmoothedRtt : 0);
+}
+
+static const QUIC_CONGESTION_CONTROL_VTABLE QuicCongestionControlLedbat = {
+    "Ledbat",
+    QUIC_CONGESTION_CONTROL_ALGORITHM_LEDBAT,
+    LedbatCongestionControlReset,
+    LedbatCongestionControlCanSend,
+    LedbatCongestionControlSetExemption,
+    LedbatCongestionControlGetSendAllowance,
+    LedbatCongestionControlGetPacingRate,
+    LedbatCongestionControlOnDataSent,
+    LedbatCongestionControlOnDataInvalidated,
+    LedbatCongestionControlOnDataAcknowledged,
+    LedbatCongestionControlOnDataLost,
+    LedbatCongestionControlOnSpuriousCongestionEvent,
+    LedbatCongestionControlOnEcn,
+    LedbatCongestionControlSetAppLimited,
+    LedbatCongestionControlIsAppLimited,
+    LedbatCongestionControlGetExemptions,
+    LedbatCongestionControlGetBytesInFlightMax,
+    LedbatCongestionControlGetCongestionWindow,
+    LedbatCongestionControlLogOutFlowStatus
+};
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+LedbatCongestionControlInitialize(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_SETTINGS* Settings
+    )
+{
+    QUIC_CONGESTION_CONTROL_LEDBAT* Ledbat = &Cc->Ledbat;
+    QUIC_CONNECTION* Connection = QuicCongestionControlGetConnection(Cc);
+    Cc->Vtable = &QuicCongestionControlLedbat;
+    QuicZeroMemory(Ledbat, sizeof(*Ledbat));
+    Ledbat->SlowStartThreshold = UINT32_MAX;
+    Ledbat->InitialWindowPackets = Settings->InitialWindowPackets;
+    Ledbat->CongestionWindow = Connection->Paths[0].Mtu * Ledbat->InitialWindowPackets;
+    Ledbat->BytesInFlightMax = Ledbat->CongestionWindow / 2;
+    Ledbat->BaseRtt = UINT32_MAX;
+    QuicConnLogOutFlowStats(Connection);
+}
@@ -0,0 +1,94 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+--*/
+
+//
+// LEDBAT++ periodic slowdown states.
+//
+typedef enum QUIC_LEDBAT_SLOWDOWN_STATE {
+    LEDBAT_SLOWDOWN_NOT_SCHEDULED,  // Waiting for the end of slow start.
+    LEDBAT_SLOWDOWN_SCHEDULED,      // Next slowdown starts at SlowdownTime.
+    LEDBAT_SLOWDOWN_ACTIVE,         // Window held at the minimum.
+    LEDBAT_SLOWDOWN_RECOVERING      // Slow start back to the previous window.
+} QUIC_LEDBAT_SLOWDOWN_STATE;
+
+typedef struct QUIC_CONGESTION_CONTROL_LEDBAT {
+
+    //
+    // TRUE if we have had at least one congestion event.
+    // If TRUE, RecoverySentPacketNumber is valid.
+    //
+    BOOLEAN HasHadCongestionEvent : 1;
+
+    //
+    // This flag indicates a congestion event occurred and CC is attempting
+    // to recover from it.
+    //
+    BOOLEAN IsInRecovery : 1;
+
+    //
+    // This flag indicates a persistent congestion event occurred and CC is
+    // attempting to recover from it.
+    //
+    BOOLEAN IsInPersistentCongestion : 1;
+
+    uint8_t SlowdownState; // QUIC_LEDBAT_SLOWDOWN_STATE
+
+    //
+    // A count of packets which can be sent ignoring CongestionWindow.
+    //
+    uint8_t Exemptions;
+
+    //
+    // The size of the initial congestion window, in packets.
+    //
+    uint32_t InitialWindowPackets;
+
+    uint32_t CongestionWindow; // bytes
+    uint32_t SlowStartThreshold; // bytes
+
+    uint32_t BytesInFlight;
+    uint32_t BytesInFlightMax;
+
+    //
+    // Bytes acknowledged in congestion avoidance since the window last grew.
+    //
+    uint32_t CongAvoidBytesAcked;
+
+    //
+    // The smallest RTT observed, i.e. the RTT without any queuing. Refreshed
+    // by each slowdown, so it can also grow if the path changes.
+    //
+    uint32_t BaseRtt; // microsec
+
+    //
+    // The latest estimate of the queuing delay, the current RTT minus BaseRtt.
+    //
+    uint32_t QueuingDelay; // microsec
+
+    //
+    // Periodic slowdown state. SlowdownTime is when the next slowdown starts
+    // while scheduled, or when the current one started otherwise.
+    //
+    uint32_t SlowdownTime; // microsec
+    uint32_t SlowdownMinRtt; // microsec
+    uint32_t SlowdownWindow; // bytes
+
+    //
+    // This variable tracks the largest packet that was outstanding at the time
+    // the last congestion event occurred. An ACK for any packet number greater
+    // than this indicates recovery is over.
+    //
+    uint64_t RecoverySentPacketNumber;
+
+} QUIC_CONGESTION_CONTROL_LEDBAT;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+LedbatCongestionControlInitialize(
+    _In_ QUIC_CONGESTION_CONTROL* Cc,
+    _In_ const QUIC_SETTINGS* Settings
+    );
@@ -16,12 +16,43 @@ Abstract:
 
 QUIC_LIBRARY MsQuicLib = { 0 };
 
+//
+// A server name's resolution in the library's resolver cache.
+//
+typedef struct QUIC_RESOLVER_CACHE_ENTRY {
+
+    QUIC_HASHTABLE_ENTRY Entry;
+
+    //
+    // Link in MsQuicLib.ResolverCacheList, oldest first.
+    //
+    QUIC_LIST_ENTRY Link;
+
+    //
+    // Time (in microseconds) after which the entry is no longer used.
+    //
+    uint64_t ExpirationTime;
+
+    QUIC_DATAPATH_RESOLUTION Resolution;
+
+    uint16_t ServerNameLength;
+
+    char ServerName[0];
+
+} QUIC_RESOLVER_CACHE_ENTRY;
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicLibApplyLoadBalancingSetting(
     void
     );
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLibApplyCidSteeringSetting(
+    void
+    );
+
 //
 // Initializes all global variables.
 //
@@ -34,8 +65,12 @@ MsQuicLibraryLoad(
 {
     QuicLockInitialize(&MsQuicLib.Lock);
     QuicDispatchLockInitialize(&MsQuicLib.DatapathLock);
+    QuicDispatchLockInitialize(&MsQuicLib.LoadBalancingLock);
     QuicListInitializeHead(&MsQuicLib.Registrations);
     QuicListInitializeHead(&MsQuicLib.Bindings);
+    QuicLockInitialize(&MsQuicLib.ResolverCacheLock);
+    QuicListInitializeHead(&MsQuicLib.ResolverCacheList);
+    MsQuicLib.TraceSampling.SampleRate = QUIC_TRACE_SAMPLE_RATE_MAX;
     MsQuicLib.Loaded = TRUE;
 }
 
@@ -52,6 +87,8 @@ MsQuicLibraryUnload(
     QUIC_LIB_VERIFY(MsQuicLib.RefCount == 0);
     QUIC_LIB_VERIFY(!MsQuicLib.InUse);
     MsQuicLib.Loaded = FALSE;
+    QuicLockUninitialize(&MsQuicLib.ResolverCacheLock);
+    QuicDispatchLockUninitialize(&MsQuicLib.LoadBalancingLock);
     QuicDispatchLockUninitialize(&MsQuicLib.DatapathLock);
     QuicLockUninitialize(&MsQuicLib.Lock);
 }
@@ -107,6 +144,7 @@ MsQuicLibraryReadSettings(
         // destroyed.
         //
         QuicLibApplyLoadBalancingSetting();
+        QuicLibApplyCidSteeringSetting();
     }
 
     BOOLEAN UpdateRegistrations = (Context != NULL);
@@ -139,6 +177,15 @@ MsQuicLibraryInitialize(
     }
     PlatformInitialized = TRUE;
 
+#ifdef QUIC_FLIGHT_RECORDER
+    if (QUIC_FAILED(QuicFlightRecorderInitialize())) {
+        QuicTraceLogWarning(
+            LibraryFlightRecorderInitFailed,
+            "[ lib] Failed to initialize the flight recorder");
+        // Non-fatal, events just won't be recorded.
+    }
+#endif
+
     QUIC_DBG_ASSERT(US_TO_MS(QuicGetTimerResolution()) + 1 <= UINT8_MAX);
     MsQuicLib.TimerResolutionMs = (uint8_t)US_TO_MS(QuicGetTimerResolution()) + 1;
 
@@ -162,9 +209,12 @@ MsQuicLibraryInitialize(
 
     MsQuicLibraryReadSettings(NULL); // NULL means don't update registrations.
 
-    QuicLockInitialize(&MsQuicLib.StatelessRetryKeysLock);
-    QuicZeroMemory(&MsQuicLib.StatelessRetryKeys, sizeof(MsQuicLib.StatelessRetryKeys));
+    QuicDispatchLockInitialize(&MsQuicLib.StatelessRetryKeysLock);
+    MsQuicLib.StatelessRetryKeysGeneration = 0;
+    MsQuicLib.StatelessRetrySecretsGeneration = 0;
+    QuicZeroMemory(&MsQuicLib.StatelessRetrySecrets, sizeof(MsQuicLib.StatelessRetrySecrets));
     QuicZeroMemory(&MsQuicLib.StatelessRetryKeysExpiration, sizeof(MsQuicLib.StatelessRetryKeysExpiration));
+    QuicRandom(sizeof(MsQuicLib.StatelessResetSecret), MsQuicLib.StatelessResetSecret);
 
     //
     // TODO: Add support for CPU hot swap/add.
@@ -197,6 +247,44 @@ MsQuicLibraryInitialize(
             FALSE,
             sizeof(QUIC_TRANSPORT_PARAMETERS),
             &MsQuicLib.PerProc[i].TransportParamPool);
+        QuicDispatchLockInitialize(&MsQuicLib.PerProc[i].StatelessRetryKeysLock);
+        MsQuicLib.PerProc[i].StatelessRetryKeysGeneration = 0;
+        MsQuicLib.PerProc[i].StatelessRetrySecretsGeneration = 0;
+        MsQuicLib.PerProc[i].CurrentStatelessRetryKey = FALSE;
+        QuicZeroMemory(
+            &MsQuicLib.PerProc[i].StatelessRetryKeys,
+            sizeof(MsQuicLib.PerProc[i].StatelessRetryKeys));
+        QuicZeroMemory(
+            &MsQuicLib.PerProc[i].StatelessRetryKeysExpiration,
+            sizeof(MsQuicLib.PerProc[i].StatelessRetryKeysExpiration));
+        QuicDispatchLockInitialize(&MsQuicLib.PerProc[i].RetryIntegrityKeysLock);
+        QuicZeroMemory(
+            &MsQuicLib.PerProc[i].RetryIntegrityKeys,
+            sizeof(MsQuicLib.PerProc[i].RetryIntegrityKeys));
+        QuicZeroMemory(
+            &MsQuicLib.PerProc[i].PerfCounters,
+            sizeof(MsQuicLib.PerProc[i].PerfCounters));
+    }
+
+    if (!QuicHashtableInitialize(
+            &MsQuicLib.BindingTable, QUIC_LIBRARY_BINDING_TABLE_SIZE)) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "binding table",
+            QUIC_LIBRARY_BINDING_TABLE_SIZE * sizeof(QUIC_LIST_ENTRY));
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Error;
+    }
+
+    if (!QuicHashtableInitialize(&MsQuicLib.ResolverCache, QUIC_HASH_MIN_SIZE)) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "resolver cache",
+            0);
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Error;
     }
 
     Status =
@@ -214,6 +302,21 @@ MsQuicLibraryInitialize(
         goto Error;
     }
 
+    QuicLibApplyCidSteeringSetting();
+
+    if (MsQuicLib.Settings.DecryptHelperThreadCount != 0 &&
+        QuicProcActiveCount() > 1) {
+        //
+        // Without the helpers, connections just decrypt everything on their
+        // workers, so failing to create them isn't fatal. With a single
+        // processor, helpers can't run alongside the workers, so they would
+        // only add overhead.
+        //
+        (void)QuicDecryptHelperPoolInitialize(
+            MsQuicLib.Settings.DecryptHelperThreadCount,
+            &MsQuicLib.DecryptHelperPool);
+    }
+
     QuicTraceEvent(
         LibraryInitialized,
         "[ lib] Initialized, PartitionCount=%u DatapathFeatures=%u",
@@ -239,10 +342,20 @@ MsQuicLibraryInitialize(
 Error:
 
     if (QUIC_FAILED(Status)) {
+        if (MsQuicLib.ResolverCache != NULL) {
+            QuicHashtableUninitialize(MsQuicLib.ResolverCache);
+            MsQuicLib.ResolverCache = NULL;
+        }
+        if (MsQuicLib.BindingTable != NULL) {
+            QuicHashtableUninitialize(MsQuicLib.BindingTable);
+            MsQuicLib.BindingTable = NULL;
+        }
         if (MsQuicLib.PerProc != NULL) {
             for (uint8_t i = 0; i < MsQuicLib.PartitionCount; ++i) {
                 QuicPoolUninitialize(&MsQuicLib.PerProc[i].ConnectionPool);
                 QuicPoolUninitialize(&MsQuicLib.PerProc[i].TransportParamPool);
+                QuicDispatchLockUninitialize(&MsQuicLib.PerProc[i].StatelessRetryKeysLock);
+                QuicDispatchLockUninitialize(&MsQuicLib.PerProc[i].RetryIntegrityKeysLock);
             }
             QUIC_FREE(MsQuicLib.PerProc);
             MsQuicLib.PerProc = NULL;
@@ -259,6 +372,27 @@ Error:
     return Status;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicLibrarySumPerfCounters(
+    _Out_writes_all_(QUIC_PERF_COUNTER_MAX) int64_t* Counters
+    )
+{
+    QuicZeroMemory(Counters, QUIC_PERF_COUNTER_MAX * sizeof(int64_t));
+    if (MsQuicLib.PerProc != NULL) {
+        for (uint8_t i = 0; i < MsQuicLib.PartitionCount; ++i) {
+            for (uint32_t j = 0; j < QUIC_PERF_COUNTER_MAX; ++j) {
+                Counters[j] += MsQuicLib.PerProc[i].PerfCounters[j];
+            }
+        }
+    }
+
+    uint64_t LockContended, LockParked;
+    QuicDispatchLockGetStatistics(&LockContended, &LockParked);
+    Counters[QUIC_PERF_COUNTER_LOCK_CONTENDED] = (int64_t)LockContended;
+    Counters[QUIC_PERF_COUNTER_LOCK_PARKED] = (int64_t)LockParked;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 MsQuicLibraryUninitialize(
@@ -287,6 +421,23 @@ MsQuicLibraryUninitialize(
     QuicDataPathUninitialize(MsQuicLib.Datapath);
     MsQuicLib.Datapath = NULL;
 
+    //
+    // The handshake offload threads may still hold connection references,
+    // which they hand back to the workers, so they go before the workers.
+    //
+    if (MsQuicLib.CryptoOffloadPool != NULL) {
+        QuicCryptoOffloadPoolUninitialize(MsQuicLib.CryptoOffloadPool);
+        MsQuicLib.CryptoOffloadPool = NULL;
+    }
+
+    //
+    // All the bindings, and so all the emulated links, are gone by now.
+    //
+    if (MsQuicLib.NetworkEmulator != NULL) {
+        QuicNetworkEmulatorUninitialize(MsQuicLib.NetworkEmulator);
+        MsQuicLib.NetworkEmulator = NULL;
+    }
+
     //
     // The library's worker pool for processing half-opened connections
     // needs to be cleaned up first, as it's the last thing that can be
@@ -297,6 +448,19 @@ MsQuicLibraryUninitialize(
         MsQuicLib.WorkerPool = NULL;
     }
 
+    //
+    // All the workers and connections, and so all their slots, are gone.
+    //
+    QuicStatsRegionUninitialize();
+
+    //
+    // No worker is left to hand the decrypt helpers a job.
+    //
+    if (MsQuicLib.DecryptHelperPool != NULL) {
+        QuicDecryptHelperPoolUninitialize(MsQuicLib.DecryptHelperPool);
+        MsQuicLib.DecryptHelperPool = NULL;
+    }
+
 #if DEBUG
     //
     // If you hit this assert, MsQuic API is trying to be unloaded without
@@ -310,24 +474,53 @@ MsQuicLibraryUninitialize(
     // first being cleaned up all listeners and connections.
     //
     QUIC_TEL_ASSERT(QuicListIsEmpty(&MsQuicLib.Bindings));
+    QuicHashtableUninitialize(MsQuicLib.BindingTable);
+    MsQuicLib.BindingTable = NULL;
+
+    while (!QuicListIsEmpty(&MsQuicLib.ResolverCacheList)) {
+        QUIC_RESOLVER_CACHE_ENTRY* Entry =
+            QUIC_CONTAINING_RECORD(
+                QuicListRemoveHead(&MsQuicLib.ResolverCacheList),
+                QUIC_RESOLVER_CACHE_ENTRY,
+                Link);
+        QuicHashtableRemove(MsQuicLib.ResolverCache, &Entry->Entry, NULL);
+        QUIC_FREE(Entry);
+    }
+    MsQuicLib.ResolverCacheCount = 0;
+    QuicHashtableUninitialize(MsQuicLib.ResolverCache);
+    MsQuicLib.ResolverCache = NULL;
 
     for (uint8_t i = 0; i < MsQuicLib.PartitionCount; ++i) {
         QuicPoolUninitialize(&MsQuicLib.PerProc[i].ConnectionPool);
         QuicPoolUninitialize(&MsQuicLib.PerProc[i].TransportParamPool);
+        for (uint8_t j = 0; j < ARRAYSIZE(MsQuicLib.PerProc[i].StatelessRetryKeys); ++j) {
+            QuicKeyFree(MsQuicLib.PerProc[i].StatelessRetryKeys[j]);
+        }
+        QuicDispatchLockUninitialize(&MsQuicLib.PerProc[i].StatelessRetryKeysLock);
+        for (uint8_t j = 0; j < ARRAYSIZE(MsQuicLib.PerProc[i].RetryIntegrityKeys); ++j) {
+            QuicPacketKeyFree(MsQuicLib.PerProc[i].RetryIntegrityKeys[j]);
+        }
+        QuicDispatchLockUninitialize(&MsQuicLib.PerProc[i].RetryIntegrityKeysLock);
     }
     QUIC_FREE(MsQuicLib.PerProc);
     MsQuicLib.PerProc = NULL;
 
-    for (uint8_t i = 0; i < ARRAYSIZE(MsQuicLib.StatelessRetryKeys); ++i) {
-        QuicKeyFree(MsQuicLib.StatelessRetryKeys[i]);
-        MsQuicLib.StatelessRetryKeys[i] = NULL;
-    }
-    QuicLockUninitialize(&MsQuicLib.StatelessRetryKeysLock);
+    QuicSecureZeroMemory(&MsQuicLib.StatelessRetrySecrets, sizeof(MsQuicLib.StatelessRetrySecrets));
+    QuicSecureZeroMemory(&MsQuicLib.StatelessResetSecret, sizeof(MsQuicLib.StatelessResetSecret));
+    QuicDispatchLockUninitialize(&MsQuicLib.StatelessRetryKeysLock);
+
+    QuicHpKeyFree(MsQuicLib.LoadBalancingKey);
+    MsQuicLib.LoadBalancingKey = NULL;
+    QuicSecureZeroMemory(&MsQuicLib.LoadBalancingConfig, sizeof(MsQuicLib.LoadBalancingConfig));
 
     QuicTraceEvent(
         LibraryUninitialized,
         "[ lib] Uninitialized");
 
+#ifdef QUIC_FLIGHT_RECORDER
+    QuicFlightRecorderUninitialize();
+#endif
+
     QuicPlatformUninitialize();
 }
 
@@ -470,7 +663,43 @@ QuicLibApplyLoadBalancingSetting(
     void
     )
 {
-    switch (MsQuicLib.Settings.LoadBalancingMode) {
+    const QUIC_LOAD_BALANCING_CONFIG* Config = &MsQuicLib.LoadBalancingConfig;
+    uint16_t Mode = MsQuicLib.Settings.LoadBalancingMode;
+
+    QuicHpKeyFree(MsQuicLib.LoadBalancingKey);
+    MsQuicLib.LoadBalancingKey = NULL;
+
+    if ((Mode == QUIC_LOAD_BALANCING_SERVER_ID_STREAM_CIPHER &&
+         Config->NonceLength == 0) ||
+        ((Mode == QUIC_LOAD_BALANCING_SERVER_ID_STREAM_CIPHER ||
+          Mode == QUIC_LOAD_BALANCING_SERVER_ID_BLOCK_CIPHER) &&
+         Config->ServerIdLength == 0)) {
+        QuicTraceLogWarning(
+            LibraryLoadBalancingConfigMissing,
+            "[ lib] No load balancing config for mode %hu, disabling",
+            Mode);
+        Mode = QUIC_LOAD_BALANCING_DISABLED;
+    }
+
+    if (Mode == QUIC_LOAD_BALANCING_SERVER_ID_STREAM_CIPHER ||
+        Mode == QUIC_LOAD_BALANCING_SERVER_ID_BLOCK_CIPHER) {
+        QUIC_STATUS Status =
+            QuicHpKeyCreate(
+                QUIC_AEAD_AES_128_GCM,
+                Config->Key,
+                &MsQuicLib.LoadBalancingKey);
+        if (QUIC_FAILED(Status)) {
+            QuicTraceEvent(
+                LibraryErrorStatus,
+                "[ lib] ERROR, %u, %s.",
+                Status,
+                "Create load balancing key, disabling");
+            MsQuicLib.LoadBalancingKey = NULL;
+            Mode = QUIC_LOAD_BALANCING_DISABLED;
+        }
+    }
+
+    switch (Mode) {
     case QUIC_LOAD_BALANCING_DISABLED:
     default:
         MsQuicLib.CidServerIdLength = 0;
@@ -478,12 +707,23 @@ QuicLibApplyLoadBalancingSetting(
     case QUIC_LOAD_BALANCING_SERVER_ID_IP:
         MsQuicLib.CidServerIdLength = 5; // 1 + 4 for v4 IP address
         break;
+    case QUIC_LOAD_BALANCING_SERVER_ID_STREAM_CIPHER:
+        MsQuicLib.CidServerIdLength =
+            1 + Config->NonceLength + Config->ServerIdLength;
+        break;
+    case QUIC_LOAD_BALANCING_SERVER_ID_BLOCK_CIPHER:
+        MsQuicLib.CidServerIdLength = 1 + Config->ServerIdLength;
+        break;
     }
 
     MsQuicLib.CidTotalLength =
         MsQuicLib.CidServerIdLength +
         MSQUIC_CID_PID_LENGTH +
         MSQUIC_CID_PAYLOAD_LENGTH;
+    if (Mode == QUIC_LOAD_BALANCING_SERVER_ID_BLOCK_CIPHER) {
+        QUIC_DBG_ASSERT(MsQuicLib.CidTotalLength <= MSQUIC_CID_LB_BLOCK_LENGTH);
+        MsQuicLib.CidTotalLength = MSQUIC_CID_LB_BLOCK_LENGTH;
+    }
 
     QUIC_FRE_ASSERT(MsQuicLib.CidServerIdLength >= MSQUIC_MIN_CID_SID_LENGTH);
     QUIC_FRE_ASSERT(MsQuicLib.CidServerIdLength <= MSQUIC_MAX_CID_SID_LENGTH);
@@ -496,6 +736,111 @@ QuicLibApplyLoadBalancingSetting(
         MsQuicLib.CidTotalLength);
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Success_(return != FALSE)
+BOOLEAN
+QuicLibEncryptCidServerId(
+    _Inout_ QUIC_RANDOM_STREAM* Random,
+    _Inout_updates_(MsQuicLib.CidTotalLength)
+        uint8_t* Cid
+    )
+{
+    const QUIC_LOAD_BALANCING_CONFIG* Config = &MsQuicLib.LoadBalancingConfig;
+    const BOOLEAN StreamCipher =
+        MsQuicLib.Settings.LoadBalancingMode == QUIC_LOAD_BALANCING_SERVER_ID_STREAM_CIPHER;
+    uint8_t Block[QUIC_HP_SAMPLE_LENGTH];
+    uint8_t Mask[QUIC_HP_SAMPLE_LENGTH];
+
+    QUIC_STATIC_ASSERT(
+        sizeof(Block) == MSQUIC_CID_LB_BLOCK_LENGTH - 1,
+        "The block cipher CID is a single AES block");
+
+    //
+    // The high bits of the first octet tell the load balancer which config
+    // (key) to use. The rest are random, so they don't link the CIDs.
+    //
+    QuicRandomStreamRead(Random, 1, Cid);
+    Cid[0] = (uint8_t)((Config->ConfigRotation << 6) | (Cid[0] & 0x3F));
+
+    if (StreamCipher) {
+        //
+        // Nonce || (ServerId ^ AES-ECB(Nonce || 0...)).
+        //
+        QuicRandomStreamRead(Random, Config->NonceLength, Cid + 1);
+        QuicZeroMemory(Block, sizeof(Block));
+        QuicCopyMemory(Block, Cid + 1, Config->NonceLength);
+    } else {
+        //
+        // AES-ECB(ServerId || PID || Payload || Random).
+        //
+        QuicCopyMemory(Cid + 1, Config->ServerId, Config->ServerIdLength);
+        QuicCopyMemory(Block, Cid + 1, sizeof(Block));
+    }
+
+    QuicDispatchLockAcquire(&MsQuicLib.LoadBalancingLock);
+    QUIC_STATUS Status =
+        QuicHpComputeMask(MsQuicLib.LoadBalancingKey, 1, Block, Mask);
+    QuicDispatchLockRelease(&MsQuicLib.LoadBalancingLock);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "Encrypt CID server ID");
+        return FALSE;
+    }
+
+    if (StreamCipher) {
+        uint8_t* ServerId = Cid + 1 + Config->NonceLength;
+        for (uint8_t i = 0; i < Config->ServerIdLength; ++i) {
+            ServerId[i] = Config->ServerId[i] ^ Mask[i];
+        }
+    } else {
+        QuicCopyMemory(Cid + 1, Mask, sizeof(Mask));
+    }
+
+    QuicSecureZeroMemory(Block, sizeof(Block));
+    return TRUE;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLibApplyCidSteeringSetting(
+    void
+    )
+{
+    if (MsQuicLib.Datapath == NULL) {
+        return; // Applied once the datapath is initialized.
+    }
+
+    //
+    // The block cipher encrypts the PID along with the server ID, so it can't
+    // be used to steer.
+    //
+    BOOLEAN SteeringEnabled =
+        MsQuicLib.Settings.CidSteeringEnabled &&
+        !(MsQuicLib.LoadBalancingKey != NULL &&
+          MsQuicLib.Settings.LoadBalancingMode == QUIC_LOAD_BALANCING_SERVER_ID_BLOCK_CIPHER);
+
+    QUIC_DATAPATH_CID_STEERING Steering = {
+        MsQuicLib.CidTotalLength,
+        MsQuicLib.CidServerIdLength,
+        MsQuicLib.PartitionMask,
+        MsQuicLib.PartitionCount
+    };
+
+    QUIC_STATUS Status =
+        QuicDataPathSetCidSteering(
+            MsQuicLib.Datapath,
+            SteeringEnabled ? &Steering : NULL);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceLogWarning(
+            LibraryCidSteeringFailed,
+            "[ lib] Datapath CID steering not enabled, 0x%x",
+            Status);
+    }
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicLibrarySetGlobalParam(
@@ -525,6 +870,123 @@ QuicLibrarySetGlobalParam(
         Status = QUIC_STATUS_SUCCESS;
         break;
 
+    case QUIC_PARAM_GLOBAL_MEMORY_BUDGET_PERCENT:
+
+        if (BufferLength != sizeof(MsQuicLib.Settings.MemoryBudgetLimit)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        MsQuicLib.Settings.MemoryBudgetLimit = *(uint16_t*)Buffer;
+        MsQuicLib.Settings.AppSet.MemoryBudgetLimit = TRUE;
+        QuicTraceLogInfo(
+            LibraryMemoryBudgetLimitSet,
+            "[ lib] Updated memory budget limit = %hu",
+            MsQuicLib.Settings.MemoryBudgetLimit);
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_GLOBAL_LARGE_PAGE_BUFFERS:
+
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // Only affects the datapath buffers allocated from now on.
+        //
+        Status = QuicSetLargePageBuffers(*(BOOLEAN*)Buffer);
+        if (QUIC_SUCCEEDED(Status)) {
+            QuicTraceLogInfo(
+                LibraryLargePageBuffersSet,
+                "[ lib] Updated large page buffers = %hhu",
+                *(BOOLEAN*)Buffer);
+        }
+        break;
+
+    case QUIC_PARAM_GLOBAL_STATELESS_SECRETS: {
+
+        if (BufferLength != sizeof(QUIC_STATELESS_SECRETS)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        const QUIC_STATELESS_SECRETS* Secrets = (const QUIC_STATELESS_SECRETS*)Buffer;
+        if (Secrets->CurrentRetrySecret > 1 ||
+            Secrets->RetrySecretsExpiration[Secrets->CurrentRetrySecret] <
+                Secrets->RetrySecretsExpiration[!Secrets->CurrentRetrySecret]) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        QuicLibrarySetStatelessSecrets(Secrets);
+        QuicTraceLogInfo(
+            LibraryStatelessSecretsSet,
+            "[ lib] Updated stateless secrets");
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
+    case QUIC_PARAM_GLOBAL_STATS_REGION: {
+
+        if (BufferLength == 0 || BufferLength > QUIC_MAX_STATS_REGION_NAME_LENGTH ||
+            memchr(Buffer, 0, BufferLength) != NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        char Name[QUIC_MAX_STATS_REGION_NAME_LENGTH + 1];
+        QuicCopyMemory(Name, Buffer, BufferLength);
+        Name[BufferLength] = '\0';
+
+        QuicLockAcquire(&MsQuicLib.Lock);
+        Status = QuicStatsRegionInitialize(Name);
+        QuicLockRelease(&MsQuicLib.Lock);
+        break;
+    }
+
+    case QUIC_PARAM_GLOBAL_FLIGHT_RECORDER_DUMP:
+
+#ifdef QUIC_FLIGHT_RECORDER
+        QuicFlightRecorderDump("Requested by app");
+        Status = QUIC_STATUS_SUCCESS;
+#else
+        Status = QUIC_STATUS_NOT_SUPPORTED;
+#endif
+        break;
+
+    case QUIC_PARAM_GLOBAL_TRACE_SAMPLING: {
+
+        if (BufferLength != sizeof(QUIC_TRACE_SAMPLING)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        const QUIC_TRACE_SAMPLING* Sampling = (const QUIC_TRACE_SAMPLING*)Buffer;
+        if (Sampling->SampleRate > QUIC_TRACE_SAMPLE_RATE_MAX ||
+            Sampling->CidPrefixLength > QUIC_TRACE_SAMPLING_MAX_CID_PREFIX_LENGTH ||
+            !QuicAddrIsValid(&Sampling->RemoteAddress)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // Only affects connections created after this point.
+        //
+        MsQuicLib.TraceSampling = *Sampling;
+        QuicTraceLogInfo(
+            LibraryTraceSamplingSet,
+            "[ lib] Updated trace sampling rate = %u, cid prefix length = %hhu",
+            MsQuicLib.TraceSampling.SampleRate,
+            MsQuicLib.TraceSampling.CidPrefixLength);
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
     case QUIC_PARAM_GLOBAL_LOAD_BALACING_MODE: {
 
         if (BufferLength != sizeof(uint16_t)) {
@@ -532,7 +994,7 @@ QuicLibrarySetGlobalParam(
             break;
         }
 
-        if (*(uint16_t*)Buffer > QUIC_LOAD_BALANCING_SERVER_ID_IP) {
+        if (*(uint16_t*)Buffer > QUIC_LOAD_BALANCING_SERVER_ID_BLOCK_CIPHER) {
             Status = QUIC_STATUS_INVALID_PARAMETER;
             break;
         }
@@ -553,6 +1015,52 @@ QuicLibrarySetGlobalParam(
             "[ lib] Updated load balancing mode = %hu",
             MsQuicLib.Settings.LoadBalancingMode);
 
+        if (!MsQuicLib.InUse) {
+            QuicLibApplyLoadBalancingSetting();
+            QuicLibApplyCidSteeringSetting();
+        }
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
+    case QUIC_PARAM_GLOBAL_LOAD_BALANCING_CONFIG: {
+
+        if (BufferLength != sizeof(QUIC_LOAD_BALANCING_CONFIG)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        const QUIC_LOAD_BALANCING_CONFIG* Config =
+            (const QUIC_LOAD_BALANCING_CONFIG*)Buffer;
+        if (Config->ConfigRotation > QUIC_LOAD_BALANCING_MAX_CONFIG_ROTATION ||
+            Config->ServerIdLength == 0 ||
+            Config->ServerIdLength > QUIC_LOAD_BALANCING_MAX_SERVER_ID_LENGTH ||
+            (Config->NonceLength != 0 &&
+             (Config->NonceLength < QUIC_LOAD_BALANCING_MIN_NONCE_LENGTH ||
+              1 + Config->NonceLength + Config->ServerIdLength > MSQUIC_MAX_CID_SID_LENGTH))) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (MsQuicLib.InUse) {
+            QuicTraceLogError(
+                LibraryLoadBalancingConfigSetAfterInUse,
+                "[ lib] Tried to change load balancing config after library in use!");
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
+
+        MsQuicLib.LoadBalancingConfig = *Config;
+        QuicTraceLogInfo(
+            LibraryLoadBalancingConfigSet,
+            "[ lib] Updated load balancing config, server ID length = %hhu, nonce length = %hhu",
+            Config->ServerIdLength,
+            Config->NonceLength);
+
+        QuicLibApplyLoadBalancingSetting();
+        QuicLibApplyCidSteeringSetting();
+
         Status = QUIC_STATUS_SUCCESS;
         break;
 
@@ -581,48 +1089,250 @@ QuicLibrarySetGlobalParam(
         Status = QUIC_STATUS_SUCCESS;
         break;
 
-#if QUIC_TEST_DATAPATH_HOOKS_ENABLED
-    case QUIC_PARAM_GLOBAL_TEST_DATAPATH_HOOKS:
+    case QUIC_PARAM_GLOBAL_NETWORK_EMULATION: {
+
+        if (BufferLength != sizeof(QUIC_NETWORK_EMULATION)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        const QUIC_NETWORK_EMULATION* Emulation = (const QUIC_NETWORK_EMULATION*)Buffer;
+        if (Emulation->LossPpm > QUIC_NETWORK_EMULATION_PPM_MAX ||
+            Emulation->ReorderPpm > QUIC_NETWORK_EMULATION_PPM_MAX) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        Status = QUIC_STATUS_SUCCESS;
+        QuicLockAcquire(&MsQuicLib.Lock);
+        if (MsQuicLib.NetworkEmulator == NULL &&
+            (Emulation->DelayUs != 0 || Emulation->JitterUs != 0 ||
+             Emulation->RateKbps != 0 || Emulation->LossPpm != 0 ||
+             Emulation->ReorderPpm != 0)) {
+            Status = QuicNetworkEmulatorInitialize(&MsQuicLib.NetworkEmulator);
+        }
+        if (QUIC_SUCCEEDED(Status)) {
+            //
+            // Only affects bindings created after this point.
+            //
+            MsQuicLib.NetworkEmulation = *Emulation;
+            QuicTraceLogWarning(
+                LibraryNetworkEmulationSet,
+                "[ lib] Updated network emulation, delay = %u us, rate = %u kbps, loss = %u ppm",
+                Emulation->DelayUs,
+                Emulation->RateKbps,
+                Emulation->LossPpm);
+        }
+        QuicLockRelease(&MsQuicLib.Lock);
+        break;
+    }
+
+#if QUIC_TEST_DATAPATH_HOOKS_ENABLED
+    case QUIC_PARAM_GLOBAL_TEST_DATAPATH_HOOKS:
+
+        if (BufferLength != sizeof(QUIC_TEST_DATAPATH_HOOKS*)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        MsQuicLib.TestDatapathHooks = *(QUIC_TEST_DATAPATH_HOOKS**)Buffer;
+        QuicTraceLogWarning(
+            LibraryTestDatapathHooksSet,
+            "[ lib] Updated test datapath hooks");
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+#endif
+    }
+
+    default:
+        Status = QUIC_STATUS_INVALID_PARAMETER;
+        break;
+    }
+
+    return Status;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicLibraryGetGlobalParam(
+    _In_ uint32_t Param,
+    _Inout_ uint32_t* BufferLength,
+    _Out_writes_bytes_opt_(*BufferLength)
+        void* Buffer
+    )
+{
+    QUIC_STATUS Status;
+
+    switch (Param) {
+    case QUIC_PARAM_GLOBAL_RETRY_MEMORY_PERCENT:
+
+        if (*BufferLength < sizeof(MsQuicLib.Settings.RetryMemoryLimit)) {
+            *BufferLength = sizeof(MsQuicLib.Settings.RetryMemoryLimit);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(MsQuicLib.Settings.RetryMemoryLimit);
+        *(uint16_t*)Buffer = MsQuicLib.Settings.RetryMemoryLimit;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_GLOBAL_MEMORY_BUDGET_PERCENT:
+
+        if (*BufferLength < sizeof(MsQuicLib.Settings.MemoryBudgetLimit)) {
+            *BufferLength = sizeof(MsQuicLib.Settings.MemoryBudgetLimit);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(MsQuicLib.Settings.MemoryBudgetLimit);
+        *(uint16_t*)Buffer = MsQuicLib.Settings.MemoryBudgetLimit;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_GLOBAL_LARGE_PAGE_BUFFERS:
+
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = QuicGetLargePageBuffers();
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_GLOBAL_STATELESS_SECRETS:
+
+        if (*BufferLength < sizeof(QUIC_STATELESS_SECRETS)) {
+            *BufferLength = sizeof(QUIC_STATELESS_SECRETS);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(QUIC_STATELESS_SECRETS);
+        QuicLibraryGetStatelessSecrets((QUIC_STATELESS_SECRETS*)Buffer);
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_GLOBAL_MEMORY_USAGE: {
+
+        if (*BufferLength < sizeof(QUIC_MEMORY_USAGE)) {
+            *BufferLength = sizeof(QUIC_MEMORY_USAGE);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(QUIC_MEMORY_USAGE);
+        QUIC_MEMORY_USAGE* Usage = (QUIC_MEMORY_USAGE*)Buffer;
+        Usage->Budget = QuicLibraryGetMemoryBudget();
+        Usage->Handshakes = MsQuicLib.CurrentHandshakeMemoryUsage;
+        Usage->SendBuffers = MsQuicLib.CurrentSendBufferMemoryUsage;
+        Usage->RecvWindows = MsQuicLib.CurrentRecvWindowMemoryUsage;
+        Usage->RecvBuffers = MsQuicLib.CurrentRecvBufferMemoryUsage;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
+    case QUIC_PARAM_GLOBAL_SUPPORTED_VERSIONS:
+
+        if (*BufferLength < sizeof(QuicSupportedVersionList)) {
+            *BufferLength = sizeof(QuicSupportedVersionList);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(QuicSupportedVersionList);
+        QuicCopyMemory(
+            Buffer,
+            QuicSupportedVersionList,
+            sizeof(QuicSupportedVersionList));
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_GLOBAL_LOAD_BALACING_MODE:
 
-        if (BufferLength != sizeof(QUIC_TEST_DATAPATH_HOOKS*)) {
+        if (*BufferLength < sizeof(uint16_t)) {
+            *BufferLength = sizeof(uint16_t);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
             Status = QUIC_STATUS_INVALID_PARAMETER;
             break;
         }
 
-        MsQuicLib.TestDatapathHooks = *(QUIC_TEST_DATAPATH_HOOKS**)Buffer;
-        QuicTraceLogWarning(
-            LibraryTestDatapathHooksSet,
-            "[ lib] Updated test datapath hooks");
+        *BufferLength = sizeof(uint16_t);
+        *(uint16_t*)Buffer = MsQuicLib.Settings.LoadBalancingMode;
 
         Status = QUIC_STATUS_SUCCESS;
         break;
-#endif
-    }
 
-    default:
-        Status = QUIC_STATUS_INVALID_PARAMETER;
-        break;
-    }
+    case QUIC_PARAM_GLOBAL_LOAD_BALANCING_CONFIG:
 
-    return Status;
-}
+        if (*BufferLength < sizeof(QUIC_LOAD_BALANCING_CONFIG)) {
+            *BufferLength = sizeof(QUIC_LOAD_BALANCING_CONFIG);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
 
-_IRQL_requires_max_(PASSIVE_LEVEL)
-QUIC_STATUS
-QuicLibraryGetGlobalParam(
-    _In_ uint32_t Param,
-    _Inout_ uint32_t* BufferLength,
-    _Out_writes_bytes_opt_(*BufferLength)
-        void* Buffer
-    )
-{
-    QUIC_STATUS Status;
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
 
-    switch (Param) {
-    case QUIC_PARAM_GLOBAL_RETRY_MEMORY_PERCENT:
+        *BufferLength = sizeof(QUIC_LOAD_BALANCING_CONFIG);
+        QuicCopyMemory(
+            Buffer,
+            &MsQuicLib.LoadBalancingConfig,
+            sizeof(QUIC_LOAD_BALANCING_CONFIG));
 
-        if (*BufferLength < sizeof(MsQuicLib.Settings.RetryMemoryLimit)) {
-            *BufferLength = sizeof(MsQuicLib.Settings.RetryMemoryLimit);
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_GLOBAL_NETWORK_EMULATION:
+
+        if (*BufferLength < sizeof(QUIC_NETWORK_EMULATION)) {
+            *BufferLength = sizeof(QUIC_NETWORK_EMULATION);
             Status = QUIC_STATUS_BUFFER_TOO_SMALL;
             break;
         }
@@ -632,16 +1342,16 @@ QuicLibraryGetGlobalParam(
             break;
         }
 
-        *BufferLength = sizeof(MsQuicLib.Settings.RetryMemoryLimit);
-        *(uint16_t*)Buffer = MsQuicLib.Settings.RetryMemoryLimit;
+        *BufferLength = sizeof(QUIC_NETWORK_EMULATION);
+        *(QUIC_NETWORK_EMULATION*)Buffer = MsQuicLib.NetworkEmulation;
 
         Status = QUIC_STATUS_SUCCESS;
         break;
 
-    case QUIC_PARAM_GLOBAL_SUPPORTED_VERSIONS:
+    case QUIC_PARAM_GLOBAL_TRACE_SAMPLING:
 
-        if (*BufferLength < sizeof(QuicSupportedVersionList)) {
-            *BufferLength = sizeof(QuicSupportedVersionList);
+        if (*BufferLength < sizeof(QUIC_TRACE_SAMPLING)) {
+            *BufferLength = sizeof(QUIC_TRACE_SAMPLING);
             Status = QUIC_STATUS_BUFFER_TOO_SMALL;
             break;
         }
@@ -651,19 +1361,18 @@ QuicLibraryGetGlobalParam(
             break;
         }
 
-        *BufferLength = sizeof(QuicSupportedVersionList);
-        QuicCopyMemory(
-            Buffer,
-            QuicSupportedVersionList,
-            sizeof(QuicSupportedVersionList));
+        *BufferLength = sizeof(QUIC_TRACE_SAMPLING);
+        *(QUIC_TRACE_SAMPLING*)Buffer = MsQuicLib.TraceSampling;
 
         Status = QUIC_STATUS_SUCCESS;
         break;
 
-    case QUIC_PARAM_GLOBAL_LOAD_BALACING_MODE:
+    case QUIC_PARAM_GLOBAL_PERF_COUNTERS: {
 
-        if (*BufferLength < sizeof(uint16_t)) {
-            *BufferLength = sizeof(uint16_t);
+        const uint32_t CountersLength =
+            QUIC_PERF_COUNTER_MAX * sizeof(int64_t);
+        if (*BufferLength < CountersLength) {
+            *BufferLength = CountersLength;
             Status = QUIC_STATUS_BUFFER_TOO_SMALL;
             break;
         }
@@ -673,11 +1382,12 @@ QuicLibraryGetGlobalParam(
             break;
         }
 
-        *BufferLength = sizeof(uint16_t);
-        *(uint16_t*)Buffer = MsQuicLib.Settings.LoadBalancingMode;
+        *BufferLength = CountersLength;
+        QuicLibrarySumPerfCounters((int64_t*)Buffer);
 
         Status = QUIC_STATUS_SUCCESS;
         break;
+    }
 
     case QUIC_PARAM_GLOBAL_ENCRYPTION:
 
@@ -1046,6 +1756,14 @@ MsQuicOpen(
 
     Api->DatagramSend = MsQuicDatagramSend;
 
+    Api->StreamSendBatch = MsQuicStreamSendBatch;
+    Api->DatagramSendBatch = MsQuicDatagramSendBatch;
+    Api->DatagramReceiveComplete = MsQuicDatagramReceiveComplete;
+
+    Api->PoolStreamOpen = MsQuicPoolStreamOpen;
+
+    Api->ExecutionPoll = MsQuicExecutionPoll;
+
     *QuicApi = Api;
 
 Error:
@@ -1080,6 +1798,30 @@ MsQuicClose(
     }
 }
 
+//
+// The signature of a binding in MsQuicLib.BindingTable. The remote address is
+// only part of it for connected bindings.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicLibraryBindingHash(
+#ifdef QUIC_COMPARTMENT_ID
+    _In_ QUIC_COMPARTMENT_ID CompartmentId,
+#endif
+    _In_ const QUIC_ADDR * LocalAddress,
+    _In_opt_ const QUIC_ADDR * RemoteAddress
+    )
+{
+    uint32_t Hash = QuicAddrHash(LocalAddress);
+    if (RemoteAddress != NULL) {
+        Hash = (Hash * 31) ^ QuicAddrHash(RemoteAddress);
+    }
+#ifdef QUIC_COMPARTMENT_ID
+    Hash ^= (uint32_t)CompartmentId;
+#endif
+    return Hash;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_BINDING*
 QuicLibraryLookupBinding(
@@ -1090,12 +1832,22 @@ QuicLibraryLookupBinding(
     _In_opt_ const QUIC_ADDR * RemoteAddress
     )
 {
-    for (QUIC_LIST_ENTRY* Link = MsQuicLib.Bindings.Flink;
-        Link != &MsQuicLib.Bindings;
-        Link = Link->Flink) {
+    QUIC_HASHTABLE_LOOKUP_CONTEXT Context;
+    QUIC_HASHTABLE_ENTRY* Entry =
+        QuicHashtableLookup(
+            MsQuicLib.BindingTable,
+            QuicLibraryBindingHash(
+#ifdef QUIC_COMPARTMENT_ID
+                CompartmentId,
+#endif
+                LocalAddress,
+                RemoteAddress),
+            &Context);
 
+    while (Entry != NULL) {
         QUIC_BINDING* Binding =
-            QUIC_CONTAINING_RECORD(Link, QUIC_BINDING, Link);
+            QUIC_CONTAINING_RECORD(Entry, QUIC_BINDING, TableEntry);
+        Entry = QuicHashtableLookupNext(MsQuicLib.BindingTable, &Context);
 
 #ifdef QUIC_COMPARTMENT_ID
         if (CompartmentId != Binding->CompartmentId) {
@@ -1257,6 +2009,22 @@ NewBinding:
             MsQuicLib.InUse = TRUE;
         }
         QuicListInsertTail(&MsQuicLib.Bindings, &(*NewBinding)->Link);
+
+        QUIC_ADDR NewRemoteAddress;
+        if ((*NewBinding)->Connected) {
+            QuicDataPathBindingGetRemoteAddress(
+                (*NewBinding)->DatapathBinding, &NewRemoteAddress);
+        }
+        QuicHashtableInsert(
+            MsQuicLib.BindingTable,
+            &(*NewBinding)->TableEntry,
+            QuicLibraryBindingHash(
+#ifdef QUIC_COMPARTMENT_ID
+                Session->CompartmentId,
+#endif
+                &NewLocalAddress,
+                (*NewBinding)->Connected ? &NewRemoteAddress : NULL),
+            NULL);
     }
 
     QuicDispatchLockRelease(&MsQuicLib.DatapathLock);
@@ -1309,6 +2077,7 @@ QuicLibraryReleaseBinding(
     QUIC_DBG_ASSERT(Binding->RefCount > 0);
     if (--Binding->RefCount == 0) {
         QuicListEntryRemove(&Binding->Link);
+        QuicHashtableRemove(MsQuicLib.BindingTable, &Binding->TableEntry, NULL);
         Uninitialize = TRUE;
 
         if (QuicListIsEmpty(&MsQuicLib.Bindings)) {
@@ -1362,7 +2131,11 @@ QuicLibraryOnListenerRegistered(
             QuicWorkerPoolInitialize(
                 NULL,
                 0,
+                0,
+                FALSE,
+                FALSE,
                 max(1, MsQuicLib.PartitionCount / 4),
+                NULL,
                 &MsQuicLib.WorkerPool))) {
             Success = FALSE;
             MsQuicSessionClose((HQUIC)MsQuicLib.UnregisteredSession);
@@ -1371,6 +2144,17 @@ QuicLibraryOnListenerRegistered(
         }
     }
 
+    if (MsQuicLib.CryptoOffloadPool == NULL &&
+        MsQuicLib.Settings.HandshakeOffloadThreadCount != 0) {
+        if (QUIC_FAILED(
+            QuicCryptoOffloadPoolInitialize(
+                MsQuicLib.Settings.HandshakeOffloadThreadCount,
+                &MsQuicLib.CryptoOffloadPool))) {
+            Success = FALSE;
+            goto Fail;
+        }
+    }
+
 Fail:
 
     QuicLockRelease(&MsQuicLib.Lock);
@@ -1384,10 +2168,67 @@ QuicLibraryGetWorker(
     void
     )
 {
-    QUIC_DBG_ASSERT(MsQuicLib.WorkerPool != NULL);
-    return
-        &MsQuicLib.WorkerPool->Workers[
-            MsQuicLib.NextWorkerIndex++ % MsQuicLib.WorkerPool->WorkerCount];
+    QUIC_WORKER_POOL* WorkerPool = MsQuicLib.WorkerPool;
+    QUIC_DBG_ASSERT(WorkerPool != NULL);
+    uint8_t Start = MsQuicLib.NextWorkerIndex++;
+
+    if (WorkerPool->MultipleNumaNodes) {
+        //
+        // Prefer a worker on the NUMA node of the current processor, i.e. of
+        // the NIC queue the datagram was received on, so that the connection
+        // is processed in the same memory its receive buffers are in.
+        //
+        uint16_t Node = QuicProcNumaNode(QuicProcCurrentNumber());
+        for (uint8_t i = 0; i < WorkerPool->WorkerCount; ++i) {
+            QUIC_WORKER* Worker =
+                &WorkerPool->Workers[(uint8_t)(Start + i) % WorkerPool->WorkerCount];
+            if (Worker->NumaNode == Node) {
+                return Worker;
+            }
+        }
+    }
+
+    return &WorkerPool->Workers[Start % WorkerPool->WorkerCount];
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicLibraryIsConnTraceSampled(
+    _In_opt_ const QUIC_ADDR* RemoteAddress,
+    _In_ uint8_t CidLength,
+    _In_reads_(CidLength)
+        const uint8_t* Cid
+    )
+{
+    const QUIC_TRACE_SAMPLING* Sampling = &MsQuicLib.TraceSampling;
+
+    if (Sampling->SampleRate >= QUIC_TRACE_SAMPLE_RATE_MAX) {
+        return TRUE;
+    }
+
+    const uint16_t Family = QuicAddrGetFamily(&Sampling->RemoteAddress);
+    if (RemoteAddress != NULL &&
+        Family != AF_UNSPEC &&
+        Family == QuicAddrGetFamily(RemoteAddress) &&
+        QuicAddrCompareIp(&Sampling->RemoteAddress, RemoteAddress) &&
+        (QuicAddrGetPort(&Sampling->RemoteAddress) == 0 ||
+         QuicAddrGetPort(&Sampling->RemoteAddress) == QuicAddrGetPort(RemoteAddress))) {
+        return TRUE;
+    }
+
+    if (Sampling->CidPrefixLength != 0 &&
+        Sampling->CidPrefixLength <= CidLength &&
+        memcmp(Sampling->CidPrefix, Cid, Sampling->CidPrefixLength) == 0) {
+        return TRUE;
+    }
+
+    if (Sampling->SampleRate == 0) {
+        return FALSE;
+    }
+
+    uint32_t Random;
+    QuicRandom(sizeof(Random), &Random);
+    return (Random % QUIC_TRACE_SAMPLE_RATE_MAX) < Sampling->SampleRate;
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -1429,28 +2270,165 @@ QuicTraceRundown(
     QuicLockRelease(&MsQuicLib.Lock);
 }
 
+//
+// Generates a new stateless retry key secret, replacing the previous one, if
+// the current one has expired. Requires MsQuicLib.StatelessRetryKeysLock to be
+// held.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicLibraryRotateStatelessRetryKeys(
+    _In_ int64_t Now
+    )
+{
+    int64_t StartTime = (Now / QUIC_STATELESS_RETRY_KEY_LIFETIME_MS) * QUIC_STATELESS_RETRY_KEY_LIFETIME_MS;
+    int64_t ExpirationTime = StartTime + QUIC_STATELESS_RETRY_KEY_LIFETIME_MS;
+
+    //
+    // If the start time for the current key interval is greater-than-or-equal to the expiration time
+    // of the latest stateless retry key, generate a new key, and rotate the old.
+    //
+    if (StartTime >= MsQuicLib.StatelessRetryKeysExpiration[MsQuicLib.CurrentStatelessRetryKey]) {
+        QuicRandom(
+            sizeof(MsQuicLib.StatelessRetrySecrets[0]),
+            MsQuicLib.StatelessRetrySecrets[!MsQuicLib.CurrentStatelessRetryKey]);
+        MsQuicLib.StatelessRetryKeysExpiration[!MsQuicLib.CurrentStatelessRetryKey] = ExpirationTime;
+        MsQuicLib.CurrentStatelessRetryKey = !MsQuicLib.CurrentStatelessRetryKey;
+        MsQuicLib.StatelessRetryKeysGeneration++;
+    }
+}
+
+//
+// Recreates the partition's stateless retry keys from the current global
+// secrets. Requires both the partition's and MsQuicLib.StatelessRetryKeysLock
+// to be held.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicLibrarySyncStatelessRetryKeys(
+    _Inout_ QUIC_LIBRARY_PP* PerProc
+    )
+{
+    BOOLEAN Synced = TRUE;
+
+    for (uint8_t i = 0; i < ARRAYSIZE(PerProc->StatelessRetryKeys); ++i) {
+        if (PerProc->StatelessRetryKeys[i] != NULL &&
+            PerProc->StatelessRetrySecretsGeneration == MsQuicLib.StatelessRetrySecretsGeneration &&
+            PerProc->StatelessRetryKeysExpiration[i] == MsQuicLib.StatelessRetryKeysExpiration[i]) {
+            continue; // Already up to date.
+        }
+
+        QuicKeyFree(PerProc->StatelessRetryKeys[i]);
+        PerProc->StatelessRetryKeys[i] = NULL;
+        PerProc->StatelessRetryKeysExpiration[i] = MsQuicLib.StatelessRetryKeysExpiration[i];
+        if (MsQuicLib.StatelessRetryKeysExpiration[i] == 0) {
+            continue; // Not generated yet.
+        }
+
+        QUIC_STATUS Status =
+            QuicKeyCreate(
+                QUIC_AEAD_AES_256_GCM,
+                MsQuicLib.StatelessRetrySecrets[i],
+                &PerProc->StatelessRetryKeys[i]);
+        if (QUIC_FAILED(Status)) {
+            QuicTraceEvent(
+                LibraryErrorStatus,
+                "[ lib] ERROR, %u, %s.",
+                Status,
+                "Create stateless retry key");
+            Synced = FALSE; // Try again next time.
+        }
+    }
+
+    PerProc->CurrentStatelessRetryKey = MsQuicLib.CurrentStatelessRetryKey;
+    if (Synced) {
+        PerProc->StatelessRetryKeysGeneration = MsQuicLib.StatelessRetryKeysGeneration;
+        PerProc->StatelessRetrySecretsGeneration = MsQuicLib.StatelessRetrySecretsGeneration;
+    }
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLibraryGetStatelessSecrets(
+    _Out_ QUIC_STATELESS_SECRETS* Secrets
+    )
+{
+    QuicLockAcquire(&MsQuicLib.Lock);
+    QuicCopyMemory(
+        Secrets->ResetSecret,
+        MsQuicLib.StatelessResetSecret,
+        sizeof(Secrets->ResetSecret));
+    QuicLockRelease(&MsQuicLib.Lock);
+
+    QuicDispatchLockAcquire(&MsQuicLib.StatelessRetryKeysLock);
+    QuicLibraryRotateStatelessRetryKeys(QuicTimeEpochMs64());
+    Secrets->CurrentRetrySecret = MsQuicLib.CurrentStatelessRetryKey;
+    QuicCopyMemory(
+        Secrets->RetrySecrets,
+        MsQuicLib.StatelessRetrySecrets,
+        sizeof(Secrets->RetrySecrets));
+    QuicCopyMemory(
+        Secrets->RetrySecretsExpiration,
+        MsQuicLib.StatelessRetryKeysExpiration,
+        sizeof(Secrets->RetrySecretsExpiration));
+    QuicDispatchLockRelease(&MsQuicLib.StatelessRetryKeysLock);
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLibrarySetStatelessSecrets(
+    _In_ const QUIC_STATELESS_SECRETS* Secrets
+    )
+{
+    QuicLockAcquire(&MsQuicLib.Lock);
+    QuicCopyMemory(
+        MsQuicLib.StatelessResetSecret,
+        Secrets->ResetSecret,
+        sizeof(MsQuicLib.StatelessResetSecret));
+    QuicLockRelease(&MsQuicLib.Lock);
+
+    //
+    // Bumping the generations makes every partition recreate its keys from the
+    // new secrets the next time it uses them.
+    //
+    QuicDispatchLockAcquire(&MsQuicLib.StatelessRetryKeysLock);
+    MsQuicLib.CurrentStatelessRetryKey = Secrets->CurrentRetrySecret;
+    QuicCopyMemory(
+        MsQuicLib.StatelessRetrySecrets,
+        Secrets->RetrySecrets,
+        sizeof(MsQuicLib.StatelessRetrySecrets));
+    QuicCopyMemory(
+        MsQuicLib.StatelessRetryKeysExpiration,
+        Secrets->RetrySecretsExpiration,
+        sizeof(MsQuicLib.StatelessRetryKeysExpiration));
+    MsQuicLib.StatelessRetryKeysGeneration++;
+    MsQuicLib.StatelessRetrySecretsGeneration++;
+    QuicDispatchLockRelease(&MsQuicLib.StatelessRetryKeysLock);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
 _Ret_maybenull_
 QUIC_KEY*
 QuicLibraryGetStatelessRetryKeyForTimestamp(
+    _Inout_ QUIC_LIBRARY_PP* PerProc,
     _In_ int64_t Timestamp
     )
 {
-    if (Timestamp < MsQuicLib.StatelessRetryKeysExpiration[!MsQuicLib.CurrentStatelessRetryKey] - QUIC_STATELESS_RETRY_KEY_LIFETIME_MS) {
+    if (PerProc->StatelessRetryKeysGeneration != MsQuicLib.StatelessRetryKeysGeneration) {
+        QuicDispatchLockAcquire(&MsQuicLib.StatelessRetryKeysLock);
+        QuicLibrarySyncStatelessRetryKeys(PerProc);
+        QuicDispatchLockRelease(&MsQuicLib.StatelessRetryKeysLock);
+    }
+
+    if (Timestamp < PerProc->StatelessRetryKeysExpiration[!PerProc->CurrentStatelessRetryKey] - QUIC_STATELESS_RETRY_KEY_LIFETIME_MS) {
         //
         // Timestamp is before the begining of the previous key's validity window.
         //
         return NULL;
-    } else if (Timestamp < MsQuicLib.StatelessRetryKeysExpiration[!MsQuicLib.CurrentStatelessRetryKey]) {
-        if (MsQuicLib.StatelessRetryKeys[!MsQuicLib.CurrentStatelessRetryKey] == NULL) {
-            return NULL;
-        }
-        return MsQuicLib.StatelessRetryKeys[!MsQuicLib.CurrentStatelessRetryKey];
-    } else if (Timestamp < MsQuicLib.StatelessRetryKeysExpiration[MsQuicLib.CurrentStatelessRetryKey]) {
-        if (MsQuicLib.StatelessRetryKeys[MsQuicLib.CurrentStatelessRetryKey] == NULL) {
-            return NULL;
-        }
-        return MsQuicLib.StatelessRetryKeys[MsQuicLib.CurrentStatelessRetryKey];
+    } else if (Timestamp < PerProc->StatelessRetryKeysExpiration[!PerProc->CurrentStatelessRetryKey]) {
+        return PerProc->StatelessRetryKeys[!PerProc->CurrentStatelessRetryKey];
+    } else if (Timestamp < PerProc->StatelessRetryKeysExpiration[PerProc->CurrentStatelessRetryKey]) {
+        return PerProc->StatelessRetryKeys[PerProc->CurrentStatelessRetryKey];
     } else {
         //
         // Timestamp is after the end of the latest key's validity window.
@@ -1459,47 +2437,152 @@ QuicLibraryGetStatelessRetryKeyForTimestamp(
     }
 }
 
-_IRQL_requires_max_(PASSIVE_LEVEL)
+_IRQL_requires_max_(DISPATCH_LEVEL)
 _Ret_maybenull_
 QUIC_KEY*
 QuicLibraryGetCurrentStatelessRetryKey(
-    void
+    _Inout_ QUIC_LIBRARY_PP* PerProc
     )
 {
     int64_t Now = QuicTimeEpochMs64();
-    int64_t StartTime = (Now / QUIC_STATELESS_RETRY_KEY_LIFETIME_MS) * QUIC_STATELESS_RETRY_KEY_LIFETIME_MS;
-    int64_t ExpirationTime = StartTime + QUIC_STATELESS_RETRY_KEY_LIFETIME_MS;
 
     //
-    // If the start time for the current key interval is greater-than-or-equal to the expiration time
-    // of the latest stateless retry key, generate a new key, and rotate the old.
+    // Only go to the global lock if this partition's key has expired or
+    // another partition already rotated the keys.
     //
-    if (StartTime >= MsQuicLib.StatelessRetryKeysExpiration[MsQuicLib.CurrentStatelessRetryKey]) {
+    if (Now >= PerProc->StatelessRetryKeysExpiration[PerProc->CurrentStatelessRetryKey] ||
+        PerProc->StatelessRetryKeysGeneration != MsQuicLib.StatelessRetryKeysGeneration) {
+        QuicDispatchLockAcquire(&MsQuicLib.StatelessRetryKeysLock);
+        QuicLibraryRotateStatelessRetryKeys(Now);
+        QuicLibrarySyncStatelessRetryKeys(PerProc);
+        QuicDispatchLockRelease(&MsQuicLib.StatelessRetryKeysLock);
+    }
 
-        QUIC_KEY* NewKey;
-        uint8_t RawKey[QUIC_AEAD_AES_256_GCM_SIZE];
-        QuicRandom(sizeof(RawKey), RawKey);
-        QUIC_STATUS Status =
-            QuicKeyCreate(
-                QUIC_AEAD_AES_256_GCM,
-                RawKey,
-                &NewKey);
-        if (QUIC_FAILED(Status)) {
-            QuicTraceEvent(
-                LibraryErrorStatus,
-                "[ lib] ERROR, %u, %s.",
-                Status,
-                "Create stateless retry key");
-            return NULL;
+    return PerProc->StatelessRetryKeys[PerProc->CurrentStatelessRetryKey];
+}
+
+//
+// Requires MsQuicLib.ResolverCacheLock to be held.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_RESOLVER_CACHE_ENTRY*
+QuicLibraryResolverCacheFind(
+    _In_ uint16_t ServerNameLength,
+    _In_reads_(ServerNameLength)
+        const char* ServerName,
+    _In_ uint32_t Hash
+    )
+{
+    QUIC_HASHTABLE_LOOKUP_CONTEXT Context;
+    QUIC_HASHTABLE_ENTRY* Entry =
+        QuicHashtableLookup(MsQuicLib.ResolverCache, Hash, &Context);
+
+    while (Entry != NULL) {
+        QUIC_RESOLVER_CACHE_ENTRY* Temp =
+            QUIC_CONTAINING_RECORD(Entry, QUIC_RESOLVER_CACHE_ENTRY, Entry);
+        if (Temp->ServerNameLength == ServerNameLength &&
+            memcmp(Temp->ServerName, ServerName, ServerNameLength) == 0) {
+            return Temp;
         }
+        Entry = QuicHashtableLookupNext(MsQuicLib.ResolverCache, &Context);
+    }
 
-        MsQuicLib.StatelessRetryKeysExpiration[!MsQuicLib.CurrentStatelessRetryKey] = ExpirationTime;
-        QuicKeyFree(MsQuicLib.StatelessRetryKeys[!MsQuicLib.CurrentStatelessRetryKey]);
-        MsQuicLib.StatelessRetryKeys[!MsQuicLib.CurrentStatelessRetryKey] = NewKey;
-        MsQuicLib.CurrentStatelessRetryKey = !MsQuicLib.CurrentStatelessRetryKey;
+    return NULL;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Success_(return != FALSE)
+BOOLEAN
+QuicLibraryResolverCacheLookup(
+    _In_z_ const char* ServerName,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+    BOOLEAN Found = FALSE;
+
+    if (MsQuicLib.Settings.DnsCacheTimeoutMs == 0) {
+        return FALSE;
+    }
+
+    uint16_t ServerNameLength = (uint16_t)strlen(ServerName);
+    uint32_t Hash = QuicHashSimple(ServerNameLength, (const uint8_t*)ServerName);
+
+    QuicLockAcquire(&MsQuicLib.ResolverCacheLock);
+
+    QUIC_RESOLVER_CACHE_ENTRY* Entry =
+        QuicLibraryResolverCacheFind(ServerNameLength, ServerName, Hash);
+    if (Entry != NULL) {
+        if (Entry->ExpirationTime > QuicTimeUs64()) {
+            *Resolution = Entry->Resolution;
+            Found = TRUE;
+        } else {
+            QuicListEntryRemove(&Entry->Link);
+            QuicHashtableRemove(MsQuicLib.ResolverCache, &Entry->Entry, NULL);
+            MsQuicLib.ResolverCacheCount--;
+            QUIC_FREE(Entry);
+        }
+    }
+
+    QuicLockRelease(&MsQuicLib.ResolverCacheLock);
+
+    return Found;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLibraryResolverCacheInsert(
+    _In_z_ const char* ServerName,
+    _In_ const QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+    if (MsQuicLib.Settings.DnsCacheTimeoutMs == 0) {
+        return;
+    }
+
+    uint16_t ServerNameLength = (uint16_t)strlen(ServerName);
+    uint32_t Hash = QuicHashSimple(ServerNameLength, (const uint8_t*)ServerName);
+    uint64_t ExpirationTime =
+        QuicTimeUs64() + MS_TO_US((uint64_t)MsQuicLib.Settings.DnsCacheTimeoutMs);
+
+    QuicLockAcquire(&MsQuicLib.ResolverCacheLock);
+
+    QUIC_RESOLVER_CACHE_ENTRY* Entry =
+        QuicLibraryResolverCacheFind(ServerNameLength, ServerName, Hash);
+    if (Entry != NULL) {
+        QuicListEntryRemove(&Entry->Link);
 
-        return NewKey;
     } else {
-        return MsQuicLib.StatelessRetryKeys[MsQuicLib.CurrentStatelessRetryKey];
+        Entry = QUIC_ALLOC_PAGED(sizeof(QUIC_RESOLVER_CACHE_ENTRY) + ServerNameLength);
+        if (Entry == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "resolver cache entry",
+                sizeof(QUIC_RESOLVER_CACHE_ENTRY) + ServerNameLength);
+            goto Exit;
+        }
+        Entry->ServerNameLength = ServerNameLength;
+        memcpy(Entry->ServerName, ServerName, ServerNameLength);
+        QuicHashtableInsert(MsQuicLib.ResolverCache, &Entry->Entry, Hash, NULL);
+        MsQuicLib.ResolverCacheCount++;
+    }
+
+    Entry->ExpirationTime = ExpirationTime;
+    Entry->Resolution = *Resolution;
+    QuicListInsertTail(&MsQuicLib.ResolverCacheList, &Entry->Link);
+
+    while (MsQuicLib.ResolverCacheCount > QUIC_DNS_CACHE_MAX_ENTRIES) {
+        QUIC_RESOLVER_CACHE_ENTRY* Oldest =
+            QUIC_CONTAINING_RECORD(
+                QuicListRemoveHead(&MsQuicLib.ResolverCacheList),
+                QUIC_RESOLVER_CACHE_ENTRY,
+                Link);
+        QuicHashtableRemove(MsQuicLib.ResolverCache, &Oldest->Entry, NULL);
+        MsQuicLib.ResolverCacheCount--;
+        QUIC_FREE(Oldest);
     }
+
+Exit:
+
+    QuicLockRelease(&MsQuicLib.ResolverCacheLock);
 }
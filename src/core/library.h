@@ -51,6 +51,41 @@ typedef struct QUIC_CACHEALIGN QUIC_LIBRARY_PP {
     //
     QUIC_POOL TransportParamPool;
 
+    //
+    // Controls access to this partition's stateless retry keys.
+    //
+    QUIC_DISPATCH_LOCK StatelessRetryKeysLock;
+
+    //
+    // This partition's copies of the stateless retry keys, so that retry
+    // tokens can be encrypted and decrypted without contending on the global
+    // lock. The value of MsQuicLib.StatelessRetryKeysGeneration they were
+    // last synchronized with is tracked to detect rotations, along with the
+    // value of MsQuicLib.StatelessRetrySecretsGeneration.
+    //
+    uint32_t StatelessRetryKeysGeneration;
+    uint32_t StatelessRetrySecretsGeneration;
+    BOOLEAN CurrentStatelessRetryKey;
+    QUIC_KEY* StatelessRetryKeys[2];
+    int64_t StatelessRetryKeysExpiration[2];
+
+    //
+    // Controls access to this partition's Retry integrity keys.
+    //
+    QUIC_DISPATCH_LOCK RetryIntegrityKeysLock;
+
+    //
+    // This partition's Retry integrity keys, one per supported version,
+    // lazily derived from the version's integrity secret on first use.
+    //
+    QUIC_PACKET_KEY* RetryIntegrityKeys[QUIC_SUPPORTED_VERSION_COUNT];
+
+    //
+    // This partition's share of the library wide performance counters. They
+    // are only summed up when queried.
+    //
+    int64_t PerfCounters[QUIC_PERF_COUNTER_MAX];
+
 } QUIC_LIBRARY_PP;
 
 //
@@ -93,6 +128,12 @@ typedef struct QUIC_LIBRARY {
     //
     QUIC_SETTINGS Settings;
 
+    //
+    // Selects which new connections have verbose logs and packet level events
+    // traced.
+    //
+    QUIC_TRACE_SAMPLING TraceSampling;
+
     //
     // Controls access to all non-datapath internal state of the library.
     //
@@ -103,6 +144,19 @@ typedef struct QUIC_LIBRARY {
     //
     QUIC_DISPATCH_LOCK DatapathLock;
 
+    //
+    // The QUIC-LB configuration and the AES key created from it, used to
+    // encrypt the server ID in locally generated connection IDs. The key is
+    // only set while one of the cipher load balancing modes is in effect.
+    //
+    QUIC_LOAD_BALANCING_CONFIG LoadBalancingConfig;
+    QUIC_HP_KEY* LoadBalancingKey;
+
+    //
+    // Serializes use of LoadBalancingKey.
+    //
+    QUIC_DISPATCH_LOCK LoadBalancingLock;
+
     //
     // Total outstanding references on the library.
     //
@@ -155,6 +209,23 @@ typedef struct QUIC_LIBRARY {
     //
     uint64_t CurrentHandshakeMemoryUsage;
 
+    //
+    // The sum of the receive windows of all streams, i.e. the memory committed
+    // to buffering received stream data.
+    //
+    uint64_t CurrentRecvWindowMemoryUsage;
+
+    //
+    // The memory of the chunks currently allocated to stream receive buffers,
+    // i.e. the memory actually used to buffer received stream data.
+    //
+    uint64_t CurrentRecvBufferMemoryUsage;
+
+    //
+    // The bytes of app data currently copied into send buffers.
+    //
+    uint64_t CurrentSendBufferMemoryUsage;
+
     //
     // Handle to global persistent storage (registry).
     //
@@ -175,6 +246,21 @@ typedef struct QUIC_LIBRARY {
     //
     QUIC_LIST_ENTRY Bindings;
 
+    //
+    // Index of the bindings in the list, by compartment, local address and
+    // (for connected bindings) remote address. Protected by DatapathLock.
+    //
+    QUIC_HASHTABLE* BindingTable;
+
+    //
+    // Recently resolved server names, by name, and in the order they were
+    // resolved. Protected by ResolverCacheLock.
+    //
+    QUIC_LOCK ResolverCacheLock;
+    QUIC_HASHTABLE* ResolverCache;
+    QUIC_LIST_ENTRY ResolverCacheList;
+    uint32_t ResolverCacheCount;
+
     //
     // Contains all (server) connections currently not in an app's registration.
     //
@@ -186,6 +272,36 @@ typedef struct QUIC_LIBRARY {
     //
     QUIC_WORKER_POOL* WorkerPool;
 
+    //
+    // Threads processing server handshakes off of the workers. Only created
+    // if the HandshakeOffloadThreadCount setting is non-zero.
+    //
+    QUIC_CRYPTO_OFFLOAD_POOL* CryptoOffloadPool;
+
+    //
+    // Threads decrypting part of the connections' receive batches. Only
+    // created if the DecryptHelperThreadCount setting is non-zero.
+    //
+    QUIC_DECRYPT_HELPER_POOL* DecryptHelperPool;
+
+    //
+    // The network conditions emulated for new bindings (all zero if none),
+    // and the emulator, created the first time emulation is enabled.
+    //
+    QUIC_NETWORK_EMULATION NetworkEmulation;
+    QUIC_NETWORK_EMULATOR* NetworkEmulator;
+
+    //
+    // The shared memory stats region (see QUIC_PARAM_GLOBAL_STATS_REGION), if
+    // created, and its name. The time (QuicTimeUs64) its perf counters were
+    // last updated, and the slot new connections start looking for a free one
+    // at.
+    //
+    QUIC_STATS_REGION* StatsRegion;
+    char* StatsRegionName;
+    int64_t StatsRegionUpdateTime;
+    long StatsRegionNextConnection;
+
     //
     // Per-processor storage. Count of `PartitionCount`.
     //
@@ -195,18 +311,37 @@ typedef struct QUIC_LIBRARY {
     //
     // Controls access to the stateless retry keys when rotated.
     //
-    QUIC_LOCK StatelessRetryKeysLock;
+    QUIC_DISPATCH_LOCK StatelessRetryKeysLock;
 
     //
-    // Keys used for encryption of stateless retry tokens.
+    // Incremented each time the stateless retry keys are rotated.
     //
-    QUIC_KEY* StatelessRetryKeys[2];
+    uint32_t StatelessRetryKeysGeneration;
+
+    //
+    // Incremented each time the stateless retry secrets are replaced by the
+    // app, which makes the partitions recreate all their keys, even the ones
+    // whose expiration didn't change.
+    //
+    uint32_t StatelessRetrySecretsGeneration;
+
+    //
+    // Secrets for the keys used for encryption of stateless retry tokens. The
+    // keys themselves are created per partition (see QUIC_LIBRARY_PP).
+    //
+    uint8_t StatelessRetrySecrets[2][QUIC_AEAD_AES_256_GCM_SIZE];
 
     //
     // Timestamp when the current stateless retry key expires.
     //
     int64_t StatelessRetryKeysExpiration[2];
 
+    //
+    // Secret the bindings' stateless reset token hashes are keyed with.
+    // Protected by Lock.
+    //
+    uint8_t StatelessResetSecret[QUIC_STATELESS_SECRET_LENGTH];
+
     //
     // The Toeplitz hash used for hashing received long header packets.
     //
@@ -241,6 +376,65 @@ QuicLibraryGetCurrentPartition(
     return ((uint8_t)QuicProcCurrentNumber()) % MsQuicLib.PartitionCount;
 }
 
+//
+// Adds to a performance counter in the current partition.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+QuicPerfCounterAdd(
+    _In_ QUIC_PERFORMANCE_COUNTERS Type,
+    _In_ int64_t Value
+    )
+{
+    QUIC_DBG_ASSERT(Type < QUIC_PERF_COUNTER_MAX);
+    InterlockedExchangeAdd64(
+        &MsQuicLib.PerProc[QuicLibraryGetCurrentPartition()].PerfCounters[Type],
+        Value);
+}
+
+#define QuicPerfCounterIncrement(Type) QuicPerfCounterAdd(Type, 1)
+#define QuicPerfCounterDecrement(Type) QuicPerfCounterAdd(Type, -1)
+
+//
+// Sums up the performance counters across all partitions.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicLibrarySumPerfCounters(
+    _Out_writes_all_(QUIC_PERF_COUNTER_MAX) int64_t* Counters
+    );
+
+//
+// Returns the memory budget for buffering, in bytes.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+uint64_t
+QuicLibraryGetMemoryBudget(
+    void
+    )
+{
+    return (MsQuicLib.Settings.MemoryBudgetLimit * QuicTotalMemory) / UINT16_MAX;
+}
+
+//
+// Returns TRUE if the memory used for buffering across all connections
+// (handshakes, send buffers and stream receive buffers) exceeds the budget.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+QuicLibraryIsMemoryBudgetExceeded(
+    void
+    )
+{
+    return
+        MsQuicLib.CurrentHandshakeMemoryUsage +
+        MsQuicLib.CurrentSendBufferMemoryUsage +
+        MsQuicLib.CurrentRecvBufferMemoryUsage >= QuicLibraryGetMemoryBudget();
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 uint8_t
@@ -272,6 +466,20 @@ QuicPartitionIdGetIndex(
     return (PartitionId & MsQuicLib.PartitionMask) % MsQuicLib.PartitionCount;
 }
 
+//
+// Encrypts the server ID (and for the block cipher, the rest of the block) of
+// a locally generated server connection ID, as configured by
+// MsQuicLib.LoadBalancingConfig.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Success_(return != FALSE)
+BOOLEAN
+QuicLibEncryptCidServerId(
+    _Inout_ QUIC_RANDOM_STREAM* Random,
+    _Inout_updates_(MsQuicLib.CidTotalLength)
+        uint8_t* Cid
+    );
+
 //
 // Creates a random, new source connection ID, that will be used on the receive
 // path.
@@ -280,6 +488,7 @@ inline
 _Success_(return != NULL)
 QUIC_CID_HASH_ENTRY*
 QuicCidNewRandomSource(
+    _Inout_ QUIC_RANDOM_STREAM* Random,
     _In_opt_ QUIC_CONNECTION* Connection,
     _In_reads_opt_(MsQuicLib.CidServerIdLength)
         const void* ServerID,
@@ -290,7 +499,7 @@ QuicCidNewRandomSource(
     )
 {
     QUIC_DBG_ASSERT(MsQuicLib.CidTotalLength <= QUIC_MAX_CONNECTION_ID_LENGTH_V1);
-    QUIC_DBG_ASSERT(MsQuicLib.CidTotalLength == MsQuicLib.CidServerIdLength + 1 + MSQUIC_CID_PAYLOAD_LENGTH);
+    QUIC_DBG_ASSERT(MsQuicLib.CidTotalLength >= MsQuicLib.CidServerIdLength + 1 + MSQUIC_CID_PAYLOAD_LENGTH);
     QUIC_DBG_ASSERT(MSQUIC_CID_PAYLOAD_LENGTH > PrefixLength);
 
     QUIC_CID_HASH_ENTRY* Entry =
@@ -308,7 +517,7 @@ QuicCidNewRandomSource(
         if (ServerID != NULL) {
             QuicCopyMemory(Data, ServerID, MsQuicLib.CidServerIdLength);
         } else {
-            QuicRandom(MsQuicLib.CidServerIdLength, Data);
+            QuicRandomStreamRead(Random, MsQuicLib.CidServerIdLength, Data);
         }
         Data += MsQuicLib.CidServerIdLength;
 
@@ -319,7 +528,17 @@ QuicCidNewRandomSource(
         QuicCopyMemory(Data, Prefix, PrefixLength);
         Data += PrefixLength;
 
-        QuicRandom(MSQUIC_CID_PAYLOAD_LENGTH - PrefixLength, Data);
+        QuicRandomStreamRead(
+            Random,
+            MsQuicLib.CidTotalLength - MsQuicLib.CidServerIdLength -
+                MSQUIC_CID_PID_LENGTH - PrefixLength,
+            Data);
+
+        if (ServerID != NULL && MsQuicLib.LoadBalancingKey != NULL &&
+            !QuicLibEncryptCidServerId(Random, Entry->CID.Data)) {
+            QUIC_FREE(Entry);
+            Entry = NULL;
+        }
     }
 
     return Entry;
@@ -411,7 +630,8 @@ QuicLibraryOnListenerRegistered(
     );
 
 //
-// Returns the next available worker. Note, the worker may be overloaded.
+// Returns the next available worker, on the current processor's NUMA node if
+// possible. Note, the worker may be overloaded.
 //
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_WORKER*
@@ -420,21 +640,78 @@ QuicLibraryGetWorker(
     );
 
 //
-// Returns the current stateless retry key.
+// Makes the trace sampling decision for a new connection. RemoteAddress is
+// NULL if not known yet (i.e. client side).
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicLibraryIsConnTraceSampled(
+    _In_opt_ const QUIC_ADDR* RemoteAddress,
+    _In_ uint8_t CidLength,
+    _In_reads_(CidLength)
+        const uint8_t* Cid
+    );
+
+//
+// Copies out the stateless reset and retry secrets, generating the current
+// retry secret first if necessary.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLibraryGetStatelessSecrets(
+    _Out_ QUIC_STATELESS_SECRETS* Secrets
+    );
+
+//
+// Replaces the stateless reset and retry secrets.
 //
 _IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLibrarySetStatelessSecrets(
+    _In_ const QUIC_STATELESS_SECRETS* Secrets
+    );
+
+//
+// Returns the partition's copy of the current stateless retry key, rotating
+// the keys first if necessary. Requires PerProc->StatelessRetryKeysLock to be
+// held.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
 _Ret_maybenull_
 QUIC_KEY*
 QuicLibraryGetCurrentStatelessRetryKey(
-    void
+    _Inout_ QUIC_LIBRARY_PP* PerProc
     );
 
 //
-// Returns the stateless retry key for that timestamp.
+// Returns the partition's copy of the stateless retry key for that timestamp.
+// Requires PerProc->StatelessRetryKeysLock to be held.
 //
-_IRQL_requires_max_(PASSIVE_LEVEL)
+_IRQL_requires_max_(DISPATCH_LEVEL)
 _Ret_maybenull_
 QUIC_KEY*
 QuicLibraryGetStatelessRetryKeyForTimestamp(
+    _Inout_ QUIC_LIBRARY_PP* PerProc,
     _In_ int64_t Timestamp
     );
+
+//
+// Gets the cached resolution of the server name, if it hasn't expired.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Success_(return != FALSE)
+BOOLEAN
+QuicLibraryResolverCacheLookup(
+    _In_z_ const char* ServerName,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    );
+
+//
+// Caches (or refreshes) the resolution of the server name.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLibraryResolverCacheInsert(
+    _In_z_ const char* ServerName,
+    _In_ const QUIC_DATAPATH_RESOLUTION* Resolution
+    );
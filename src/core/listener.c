@@ -124,6 +124,10 @@ MsQuicListenerClose(
     //
     MsQuicListenerStop(Handle);
 
+    if (Listener->ConnectionSecConfig != NULL) {
+        QuicTlsSecConfigRelease(Listener->ConnectionSecConfig);
+    }
+
     QuicRundownUninitialize(&Listener->Rundown);
     QUIC_FREE(Listener);
 
@@ -343,6 +347,10 @@ QuicListenerIndicateEvent(
             "[list][%p] App took excessive time (%llu us) in callback.",
             Listener,
             (EndTime - StartTime));
+        if (EndTime - StartTime >= QUIC_MAX_CALLBACK_TIME_ERROR) {
+            (void)QuicFlightRecorderTrigger(
+                "App extremely long time in listener callback");
+        }
         QUIC_TEL_ASSERTMSG_ARGS(
             EndTime - StartTime < QUIC_MAX_CALLBACK_TIME_ERROR,
             "App extremely long time in listener callback",
@@ -373,6 +381,24 @@ QuicListenerClaimConnection(
     QuicSessionRegisterConnection(Listener->Session, Connection);
 
     QUIC_LISTENER_EVENT Event;
+    QUIC_STATUS Status;
+
+    if (Listener->ConnectionCallbackHandler != NULL) {
+        //
+        // The app pre-configured the listener, so there's nothing to ask it.
+        //
+        QuicTraceLogVerbose(
+            ListenerNewConnectionPreConfigured,
+            "[list][%p] Accepting NEW_CONNECTION with listener config",
+            Listener);
+        Connection->ClientCallbackHandler = Listener->ConnectionCallbackHandler;
+        Connection->ClientContext = Listener->ConnectionContext;
+        Event.NEW_CONNECTION.SecurityConfig = Listener->ConnectionSecConfig;
+        *SecConfig = Event.NEW_CONNECTION.SecurityConfig;
+        Status = QUIC_STATUS_SUCCESS;
+        goto Accepted;
+    }
+
     Event.Type = QUIC_LISTENER_EVENT_NEW_CONNECTION;
     Event.NEW_CONNECTION.Info = Info;
     Event.NEW_CONNECTION.Connection = (HQUIC)Connection;
@@ -384,7 +410,7 @@ QuicListenerClaimConnection(
         ListenerIndicateNewConnection,
         "[list][%p] Indicating NEW_CONNECTION",
         Listener);
-    QUIC_STATUS Status = QuicListenerIndicateEvent(Listener, &Event);
+    Status = QuicListenerIndicateEvent(Listener, &Event);
 
     QuicSessionDetachSilo();
 
@@ -419,6 +445,8 @@ QuicListenerClaimConnection(
         *SecConfig = Event.NEW_CONNECTION.SecurityConfig;
     }
 
+Accepted:
+
     //
     // The application layer has accepted the connection and provided a
     // server certificate.
@@ -508,12 +536,44 @@ QuicListenerParamSet(
 {
     QUIC_STATUS Status;
 
-    UNREFERENCED_PARAMETER(Listener);
-    UNREFERENCED_PARAMETER(BufferLength);
-    UNREFERENCED_PARAMETER(Buffer);
-
     switch (Param) {
 
+    case QUIC_PARAM_LISTENER_CONNECTION_CONFIG: {
+
+        if (BufferLength != sizeof(QUIC_LISTENER_CONNECTION_CONFIG)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        const QUIC_LISTENER_CONNECTION_CONFIG* Config =
+            (const QUIC_LISTENER_CONNECTION_CONFIG*)Buffer;
+        if ((Config->Handler == NULL) != (Config->SecurityConfig == NULL)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // Connections are accepted on the workers without any lock, so the
+        // config can't change while the listener is started.
+        //
+        if (Listener->Binding != NULL) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
+
+        if (Listener->ConnectionSecConfig != NULL) {
+            QuicTlsSecConfigRelease(Listener->ConnectionSecConfig);
+        }
+        Listener->ConnectionSecConfig =
+            Config->SecurityConfig != NULL ?
+                QuicTlsSecConfigAddRef(Config->SecurityConfig) : NULL;
+        Listener->ConnectionCallbackHandler = Config->Handler;
+        Listener->ConnectionContext = Config->Context;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
     default:
         Status = QUIC_STATUS_INVALID_PARAMETER;
         break;
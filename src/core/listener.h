@@ -47,6 +47,14 @@ typedef struct QUIC_LISTENER {
     //
     QUIC_LISTENER_CALLBACK_HANDLER ClientCallbackHandler;
 
+    //
+    // Set with QUIC_PARAM_LISTENER_CONNECTION_CONFIG. If the handler is set,
+    // new connections are accepted with these, without indicating the app.
+    //
+    QUIC_SEC_CONFIG* ConnectionSecConfig;
+    QUIC_CONNECTION_CALLBACK_HANDLER ConnectionCallbackHandler;
+    void* ConnectionContext;
+
     //
     // Stats for the Listener.
     //
@@ -17,7 +17,16 @@ Abstract:
 typedef struct QUIC_CACHEALIGN QUIC_PARTITIONED_HASHTABLE {
 
     QUIC_DISPATCH_RW_LOCK RwLock;
-    QUIC_HASHTABLE Table;
+    QUIC_CID_TABLE Table;
+
+    //
+    // Directly indexed slots for CIDs of the library's CID length, indexed by
+    // the CID's trailing random bytes. A CID whose slot is already taken goes
+    // in the hash table instead. NULL if disabled (CidRouteTableBits == 0).
+    //
+    _Field_size_opt_(SlotMask + 1)
+    QUIC_CID_HASH_ENTRY** Slots;
+    uint32_t SlotMask;
 
 } QUIC_PARTITIONED_HASHTABLE;
 
@@ -25,11 +34,165 @@ _IRQL_requires_max_(DISPATCH_LEVEL)
 BOOLEAN
 QuicLookupInsertLocalCid(
     _In_ QUIC_LOOKUP* Lookup,
-    _In_ uint32_t Hash,
     _In_ QUIC_CID_HASH_ENTRY* SourceCid,
     _In_ BOOLEAN UpdateRefCount
     );
 
+//
+// Returns the slot for the CID, or NULL if the CID can't use the slots.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_CID_HASH_ENTRY**
+QuicPartitionedTableGetSlot(
+    _In_ const QUIC_PARTITIONED_HASHTABLE* Table,
+    _In_reads_(CIDLen)
+        const uint8_t* const CID,
+    _In_ uint8_t CIDLen
+    )
+{
+    if (Table->Slots == NULL || CIDLen != MsQuicLib.CidTotalLength) {
+        return NULL;
+    }
+
+    //
+    // Locally generated CIDs always end in random bytes, so they are already
+    // a uniform index and don't need to be hashed.
+    //
+    QUIC_STATIC_ASSERT(MSQUIC_CID_MIN_RANDOM_BYTES >= sizeof(uint32_t), "Slot index must be random");
+    uint32_t Index;
+    QuicCopyMemory(&Index, CID + CIDLen - sizeof(Index), sizeof(Index));
+    return &Table->Slots[Index & Table->SlotMask];
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicPartitionedTableInitialize(
+    _Out_ QUIC_PARTITIONED_HASHTABLE* Table
+    )
+{
+    if (!QuicCidTableInitialize(&Table->Table)) {
+        return FALSE;
+    }
+    QuicDispatchRwLockInitialize(&Table->RwLock);
+
+    Table->Slots = NULL;
+    Table->SlotMask = 0;
+    const uint8_t SlotBits = MsQuicLib.Settings.CidRouteTableBits;
+    if (SlotBits != 0) {
+        const uint32_t SlotCount = 1u << SlotBits;
+        Table->Slots =
+            QUIC_ALLOC_NONPAGED(SlotCount * sizeof(QUIC_CID_HASH_ENTRY*));
+        if (Table->Slots != NULL) {
+            QuicZeroMemory(Table->Slots, SlotCount * sizeof(QUIC_CID_HASH_ENTRY*));
+            Table->SlotMask = SlotCount - 1;
+        } else {
+            //
+            // The slots are only an optimization, so just hash everything.
+            //
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "CID route table",
+                SlotCount * sizeof(QUIC_CID_HASH_ENTRY*));
+        }
+    }
+
+    return TRUE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicPartitionedTableUninitialize(
+    _In_ QUIC_PARTITIONED_HASHTABLE* Table
+    )
+{
+    QUIC_DBG_ASSERT(Table->Table.NumEntries == 0);
+    QuicCidTableUninitialize(&Table->Table);
+    QuicDispatchRwLockUninitialize(&Table->RwLock);
+    if (Table->Slots != NULL) {
+        QUIC_FREE(Table->Slots);
+    }
+}
+
+//
+// Requires the table's RwLock to be held exclusively.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicPartitionedTableInsert(
+    _Inout_ QUIC_PARTITIONED_HASHTABLE* Table,
+    _In_ QUIC_CID_HASH_ENTRY* SourceCid
+    )
+{
+    QUIC_CID_HASH_ENTRY** Slot =
+        QuicPartitionedTableGetSlot(Table, SourceCid->CID.Data, SourceCid->CID.Length);
+    if (Slot != NULL && *Slot == NULL) {
+        *Slot = SourceCid;
+        return TRUE;
+    }
+
+    return
+        QuicCidTableInsert(
+            &Table->Table,
+            QuicHashSimple(SourceCid->CID.Length, SourceCid->CID.Data),
+            SourceCid);
+}
+
+//
+// Requires the table's RwLock to be held exclusively.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicPartitionedTableRemove(
+    _Inout_ QUIC_PARTITIONED_HASHTABLE* Table,
+    _In_ const QUIC_CID_HASH_ENTRY* SourceCid
+    )
+{
+    QUIC_CID_HASH_ENTRY** Slot =
+        QuicPartitionedTableGetSlot(Table, SourceCid->CID.Data, SourceCid->CID.Length);
+    if (Slot != NULL && *Slot == SourceCid) {
+        *Slot = NULL;
+        return;
+    }
+
+    QuicCidTableRemove(
+        &Table->Table,
+        QuicHashSimple(SourceCid->CID.Length, SourceCid->CID.Data),
+        SourceCid);
+}
+
+//
+// Removes and returns any one CID from the table, or NULL if it is empty.
+// Requires the table's RwLock to be held exclusively.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_CID_HASH_ENTRY*
+QuicPartitionedTableRemoveNext(
+    _Inout_ QUIC_PARTITIONED_HASHTABLE* Table,
+    _Inout_ uint32_t* SlotIndex,
+    _Inout_ uint32_t* HashIndex
+    )
+{
+    if (Table->Slots != NULL) {
+        for (; *SlotIndex <= Table->SlotMask; ++(*SlotIndex)) {
+            QUIC_CID_HASH_ENTRY* CID = Table->Slots[*SlotIndex];
+            if (CID != NULL) {
+                Table->Slots[(*SlotIndex)++] = NULL;
+                return CID;
+            }
+        }
+    }
+
+    QUIC_CID_HASH_ENTRY* CID = QuicCidTableEnumerateNext(&Table->Table, HashIndex);
+    if (CID != NULL) {
+        QuicCidTableRemove(
+            &Table->Table,
+            QuicHashSimple(CID->CID.Length, CID->CID.Data),
+            CID);
+    }
+    return CID;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
 QuicLookupInitialize(
@@ -53,14 +216,18 @@ QuicLookupUninitialize(
     } else {
         QUIC_DBG_ASSERT(Lookup->HASH.Tables != NULL);
         for (uint8_t i = 0; i < Lookup->PartitionCount; i++) {
-            QUIC_PARTITIONED_HASHTABLE* Table = &Lookup->HASH.Tables[i];
-            QUIC_DBG_ASSERT(Table->Table.NumEntries == 0);
-            QuicHashtableUninitialize(&Table->Table);
-            QuicDispatchRwLockUninitialize(&Table->RwLock);
+            QuicPartitionedTableUninitialize(&Lookup->HASH.Tables[i]);
         }
         QUIC_FREE(Lookup->HASH.Tables);
     }
 
+    if (Lookup->RetiredTables != NULL) {
+        for (uint8_t i = 0; i < Lookup->RetiredPartitionCount; i++) {
+            QuicPartitionedTableUninitialize(&Lookup->RetiredTables[i]);
+        }
+        QUIC_FREE(Lookup->RetiredTables);
+    }
+
     if (Lookup->MaximizePartitioning) {
         QUIC_DBG_ASSERT(Lookup->RemoteHashTable.NumEntries == 0);
         QuicHashtableUninitialize(&Lookup->RemoteHashTable);
@@ -87,17 +254,15 @@ QuicLookupCreateHashTable(
 
     if (Lookup->HASH.Tables != NULL) {
 
-        uint8_t Cleanup = 0;
-        for (uint8_t i = 0; i < PartitionCount; i++) {
-            if (!QuicHashtableInitializeEx(&Lookup->HASH.Tables[i].Table, QUIC_HASH_MIN_SIZE)) {
-                Cleanup = i;
+        uint8_t Initialized = 0;
+        for (; Initialized < PartitionCount; Initialized++) {
+            if (!QuicPartitionedTableInitialize(&Lookup->HASH.Tables[Initialized])) {
                 break;
             }
-            QuicDispatchRwLockInitialize(&Lookup->HASH.Tables[i].RwLock);
         }
-        if (Cleanup != 0) {
-            for (uint8_t i = 0; i < Cleanup; i++) {
-                QuicHashtableUninitialize(&Lookup->HASH.Tables[i].Table);
+        if (Initialized != PartitionCount) {
+            for (uint8_t i = 0; i < Initialized; i++) {
+                QuicPartitionedTableUninitialize(&Lookup->HASH.Tables[i]);
             }
             QUIC_FREE(Lookup->HASH.Tables);
             Lookup->HASH.Tables = NULL;
@@ -147,6 +312,12 @@ QuicLookupRebalance(
 
     if (PartitionCount > Lookup->PartitionCount) {
 
+        //
+        // Make lock-free readers fall back to the locked path until the new
+        // tables are fully populated.
+        //
+        InterlockedIncrement(&Lookup->Generation);
+
         uint8_t PreviousPartitionCount = Lookup->PartitionCount;
         void* PreviousLookup = Lookup->LookupTable;
         Lookup->LookupTable = NULL;
@@ -155,6 +326,7 @@ QuicLookupRebalance(
 
         if (!QuicLookupCreateHashTable(Lookup, PartitionCount)) {
             Lookup->LookupTable = PreviousLookup;
+            InterlockedIncrement(&Lookup->Generation);
             return FALSE;
         }
 
@@ -179,11 +351,7 @@ QuicLookupRebalance(
                             Entry,
                             QUIC_CID_HASH_ENTRY,
                             Link);
-                    (void)QuicLookupInsertLocalCid(
-                        Lookup,
-                        QuicHashSimple(CID->CID.Length, CID->CID.Data),
-                        CID,
-                        FALSE);
+                    (void)QuicLookupInsertLocalCid(Lookup, CID, FALSE);
                     Entry = Entry->Next;
                 }
             }
@@ -197,32 +365,27 @@ QuicLookupRebalance(
 
             QUIC_PARTITIONED_HASHTABLE* PreviousTable = PreviousLookup;
             for (uint8_t i = 0; i < PreviousPartitionCount; i++) {
-                QUIC_HASHTABLE_ENTRY* Entry;
-                QUIC_HASHTABLE_ENUMERATOR Enumerator;
-                QuicHashtableEnumerateBegin(&PreviousTable[i].Table, &Enumerator);
-                while (TRUE) {
-                    Entry = QuicHashtableEnumerateNext(&PreviousTable[i].Table, &Enumerator);
-                    if (Entry == NULL) {
-                        QuicHashtableEnumerateEnd(&PreviousTable[i].Table, &Enumerator);
-                        break;
-                    }
-                    QuicHashtableRemove(&PreviousTable[i].Table, Entry, NULL);
-
-                    QUIC_CID_HASH_ENTRY *CID =
-                        QUIC_CONTAINING_RECORD(
-                            Entry,
-                            QUIC_CID_HASH_ENTRY,
-                            Entry);
-                    (void)QuicLookupInsertLocalCid(
-                        Lookup,
-                        QuicHashSimple(CID->CID.Length, CID->CID.Data),
-                        CID,
-                        FALSE);
+                QUIC_CID_HASH_ENTRY* CID;
+                uint32_t SlotIndex = 0, HashIndex = 0;
+                QuicDispatchRwLockAcquireExclusive(&PreviousTable[i].RwLock);
+                while ((CID =
+                        QuicPartitionedTableRemoveNext(
+                            &PreviousTable[i], &SlotIndex, &HashIndex)) != NULL) {
+                    (void)QuicLookupInsertLocalCid(Lookup, CID, FALSE);
                 }
-                QuicHashtableUninitialize(&PreviousTable[i].Table);
+                QuicDispatchRwLockReleaseExclusive(&PreviousTable[i].RwLock);
             }
-            QUIC_FREE(PreviousTable);
+
+            //
+            // Lock-free readers may still be looking in the old (now empty)
+            // tables, so they can't be freed yet.
+            //
+            QUIC_DBG_ASSERT(Lookup->RetiredTables == NULL);
+            Lookup->RetiredTables = PreviousTable;
+            Lookup->RetiredPartitionCount = PreviousPartitionCount;
         }
+
+        InterlockedIncrement(&Lookup->Generation);
     }
 
     return TRUE;
@@ -279,7 +442,7 @@ QuicCidMatchConnection(
             QUIC_CONTAINING_RECORD(Link, const QUIC_CID_HASH_ENTRY, Link);
 
         if (Length == Entry->CID.Length &&
-            (Length == 0 || memcmp(DestCid, Entry->CID.Data, Length) == 0)) {
+            QuicCidDataEqual(DestCid, Entry->CID.Data, Length)) {
             return TRUE;
         }
     }
@@ -288,36 +451,35 @@ QuicCidMatchConnection(
 }
 
 //
-// Uses the hash and destination connection ID to look up the connection in the
-// hash table. Returns the pointer to the connection if found; NULL otherwise.
+// Uses the destination connection ID to look up the connection in the
+// partition, first in its slot and then, only if not found there, in the hash
+// table. Returns the pointer to the connection if found; NULL otherwise.
+// Requires the table's RwLock to be held.
 //
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_CONNECTION*
-QuicHashLookupConnection(
-    _In_ QUIC_HASHTABLE* Table,
+QuicPartitionedTableLookupConnection(
+    _In_ const QUIC_PARTITIONED_HASHTABLE* Table,
     _In_reads_(Length)
         const uint8_t* const DestCid,
-    _In_ uint8_t Length,
-    _In_ uint32_t Hash
+    _In_ uint8_t Length
     )
 {
-    QUIC_HASHTABLE_LOOKUP_CONTEXT Context;
-    QUIC_HASHTABLE_ENTRY* TableEntry =
-        QuicHashtableLookup(Table, Hash, &Context);
-
-    while (TableEntry != NULL) {
-        QUIC_CID_HASH_ENTRY* CIDEntry =
-            QUIC_CONTAINING_RECORD(TableEntry, QUIC_CID_HASH_ENTRY, Entry);
-
-        if (CIDEntry->CID.Length == Length &&
-            memcmp(DestCid, CIDEntry->CID.Data, Length) == 0) {
+    QUIC_CID_HASH_ENTRY** Slot = QuicPartitionedTableGetSlot(Table, DestCid, Length);
+    if (Slot != NULL) {
+        const QUIC_CID_HASH_ENTRY* CIDEntry = *Slot;
+        if (CIDEntry != NULL && QuicCidDataEqual(DestCid, CIDEntry->CID.Data, Length)) {
             return CIDEntry->Connection;
         }
-
-        TableEntry = QuicHashtableLookupNext(Table, &Context);
     }
 
-    return NULL;
+    QUIC_CID_HASH_ENTRY* CIDEntry =
+        QuicCidTableLookup(
+            &Table->Table,
+            QuicHashSimple(Length, DestCid),
+            DestCid,
+            Length);
+    return CIDEntry == NULL ? NULL : CIDEntry->Connection;
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -326,8 +488,7 @@ QuicLookupFindConnectionByLocalCidInternal(
     _In_ QUIC_LOOKUP* Lookup,
     _In_reads_(CIDLen)
         const uint8_t* const CID,
-    _In_ uint8_t CIDLen,
-    _In_ uint32_t Hash
+    _In_ uint8_t CIDLen
     )
 {
     QUIC_CONNECTION* Connection = NULL;
@@ -358,12 +519,7 @@ QuicLookupFindConnectionByLocalCidInternal(
         QUIC_PARTITIONED_HASHTABLE* Table = &Lookup->HASH.Tables[PartitionIndex];
 
         QuicDispatchRwLockAcquireShared(&Table->RwLock);
-        Connection =
-            QuicHashLookupConnection(
-                &Table->Table,
-                CID,
-                CIDLen,
-                Hash);
+        Connection = QuicPartitionedTableLookupConnection(Table, CID, CIDLen);
         QuicDispatchRwLockReleaseShared(&Table->RwLock);
     }
 
@@ -371,22 +527,87 @@ QuicLookupFindConnectionByLocalCidInternal(
     if (Connection != NULL) {
         QuicTraceLogVerbose(
             LookupCidFound,
-            "[look][%p] Lookup Hash=%u found %p",
+            "[look][%p] Lookup found %p",
             Lookup,
-            Hash,
             Connection);
     } else {
         QuicTraceLogVerbose(
             LookupCidNotFound,
-            "[look][%p] Lookup Hash=%u not found",
-            Lookup,
-            Hash);
+            "[look][%p] Lookup not found",
+            Lookup);
     }
 #endif
 
     return Connection;
 }
 
+//
+// Looks up the connection for a local CID in the partitioned hash tables,
+// without acquiring Lookup->RwLock. Returns FALSE if the result can't be
+// trusted because the tables were being replaced concurrently, or if the
+// lookup isn't using partitioned tables, in which case the caller must fall
+// back to the locked lookup.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Success_(return != FALSE)
+BOOLEAN
+QuicLookupTryFindConnectionByLocalCidLockFree(
+    _In_ QUIC_LOOKUP* Lookup,
+    _In_reads_(CIDLen)
+        const uint8_t* const CID,
+    _In_ uint8_t CIDLen,
+    _Out_ QUIC_CONNECTION** Connection
+    )
+{
+    const long Generation = ReadAcquire(&Lookup->Generation);
+    if (Generation & 1) {
+        return FALSE; // Rebalance in progress.
+    }
+
+    const uint8_t PartitionCount = *(volatile uint8_t*)&Lookup->PartitionCount;
+    QUIC_PARTITIONED_HASHTABLE* Tables =
+        *(QUIC_PARTITIONED_HASHTABLE* volatile*)&Lookup->HASH.Tables;
+    MemoryBarrier();
+    if (PartitionCount == 0 || ReadAcquire(&Lookup->Generation) != Generation) {
+        return FALSE;
+    }
+
+    QUIC_DBG_ASSERT(CIDLen >= QUIC_MIN_INITIAL_CONNECTION_ID_LENGTH);
+
+    //
+    // Even if the tables are retired right after this point, they stay valid
+    // (and empty) until the lookup is uninitialized.
+    //
+    QUIC_STATIC_ASSERT(MSQUIC_CID_PID_LENGTH == 1, "The code below assumes 1 byte");
+    uint32_t PartitionIndex = CID[MsQuicLib.CidServerIdLength];
+    PartitionIndex &= MsQuicLib.PartitionMask;
+    PartitionIndex %= PartitionCount;
+    QUIC_PARTITIONED_HASHTABLE* Table = &Tables[PartitionIndex];
+
+    //
+    // The reference must be taken under the partition lock, since without
+    // RwLock nothing else prevents the CID from being removed and the
+    // connection released right after the lookup.
+    //
+    QuicDispatchRwLockAcquireShared(&Table->RwLock);
+    *Connection = QuicPartitionedTableLookupConnection(Table, CID, CIDLen);
+    if (*Connection != NULL) {
+        QuicConnAddRef(*Connection, QUIC_CONN_REF_LOOKUP_RESULT);
+    }
+    QuicDispatchRwLockReleaseShared(&Table->RwLock);
+
+    if (*Connection != NULL) {
+        return TRUE;
+    }
+
+    //
+    // A miss can only be trusted if the CIDs weren't being moved between
+    // tables during the lookup.
+    //
+    MemoryBarrier();
+    return ReadAcquire(&Lookup->Generation) == Generation;
+}
+
 //
 // Requires Lookup->RwLock to be held (shared).
 
@@ -446,7 +667,6 @@ _IRQL_requires_max_(DISPATCH_LEVEL)
 BOOLEAN
 QuicLookupInsertLocalCid(
     _In_ QUIC_LOOKUP* Lookup,
-    _In_ uint32_t Hash,
     _In_ QUIC_CID_HASH_ENTRY* SourceCid,
     _In_ BOOLEAN UpdateRefCount
     )
@@ -476,12 +696,11 @@ QuicLookupInsertLocalCid(
         QUIC_PARTITIONED_HASHTABLE* Table = &Lookup->HASH.Tables[PartitionIndex];
 
         QuicDispatchRwLockAcquireExclusive(&Table->RwLock);
-        QuicHashtableInsert(
-            &Table->Table,
-            &SourceCid->Entry,
-            Hash,
-            NULL);
+        BOOLEAN Inserted = QuicPartitionedTableInsert(Table, SourceCid);
         QuicDispatchRwLockReleaseExclusive(&Table->RwLock);
+        if (!Inserted) {
+            return FALSE;
+        }
     }
 
     if (UpdateRefCount) {
@@ -492,10 +711,9 @@ QuicLookupInsertLocalCid(
 #if QUIC_DEBUG_HASHTABLE_LOOKUP
     QuicTraceLogVerbose(
         LookupCidInsert,
-        "[look][%p] Insert Conn=%p Hash=%u",
+        "[look][%p] Insert Conn=%p",
         Lookup,
-        Connection,
-        Hash);
+        SourceCid->Connection);
 #endif
 
     SourceCid->CID.IsInLookupTable = TRUE;
@@ -604,7 +822,7 @@ QuicLookupRemoveLocalCidInt(
         PartitionIndex %= Lookup->PartitionCount;
         QUIC_PARTITIONED_HASHTABLE* Table = &Lookup->HASH.Tables[PartitionIndex];
         QuicDispatchRwLockAcquireExclusive(&Table->RwLock);
-        QuicHashtableRemove(&Table->Table, &SourceCid->Entry, NULL);
+        QuicPartitionedTableRemove(Table, SourceCid);
         QuicDispatchRwLockReleaseExclusive(&Table->RwLock);
     }
 }
@@ -618,16 +836,23 @@ QuicLookupFindConnectionByLocalCid(
     _In_ uint8_t CIDLen
     )
 {
-    uint32_t Hash = QuicHashSimple(CIDLen, CID);
+    QUIC_CONNECTION* ExistingConnection;
+
+    if (QuicLookupTryFindConnectionByLocalCidLockFree(
+            Lookup,
+            CID,
+            CIDLen,
+            &ExistingConnection)) {
+        return ExistingConnection;
+    }
 
     QuicDispatchRwLockAcquireShared(&Lookup->RwLock);
 
-    QUIC_CONNECTION* ExistingConnection =
+    ExistingConnection =
         QuicLookupFindConnectionByLocalCidInternal(
             Lookup,
             CID,
-            CIDLen,
-            Hash);
+            CIDLen);
 
     if (ExistingConnection != NULL) {
         QuicConnAddRef(ExistingConnection, QUIC_CONN_REF_LOOKUP_RESULT);
@@ -718,7 +943,6 @@ QuicLookupAddLocalCid(
 {
     BOOLEAN Result;
     QUIC_CONNECTION* ExistingConnection;
-    uint32_t Hash = QuicHashSimple(SourceCid->CID.Length, SourceCid->CID.Data);
 
     QuicDispatchRwLockAcquireExclusive(&Lookup->RwLock);
 
@@ -728,12 +952,11 @@ QuicLookupAddLocalCid(
         QuicLookupFindConnectionByLocalCidInternal(
             Lookup,
             SourceCid->CID.Data,
-            SourceCid->CID.Length,
-            Hash);
+            SourceCid->CID.Length);
 
     if (ExistingConnection == NULL) {
         Result =
-            QuicLookupInsertLocalCid(Lookup, Hash, SourceCid, TRUE);
+            QuicLookupInsertLocalCid(Lookup, SourceCid, TRUE);
         if (Collision != NULL) {
             *Collision = NULL;
         }
@@ -912,11 +1135,7 @@ QuicLookupMoveLocalConnectionIDs(
                 Link);
         if (CID->CID.IsInLookupTable) {
             BOOLEAN Result =
-                QuicLookupInsertLocalCid(
-                    LookupDest,
-                    QuicHashSimple(CID->CID.Length, CID->CID.Data),
-                    CID,
-                    TRUE);
+                QuicLookupInsertLocalCid(LookupDest, CID, TRUE);
             QUIC_DBG_ASSERT(Result);
             UNREFERENCED_PARAMETER(Result);
         }
@@ -924,3 +1143,41 @@ QuicLookupMoveLocalConnectionIDs(
     }
     QuicDispatchRwLockReleaseExclusive(&LookupDest->RwLock);
 }
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicLookupSetDedicatedConnection(
+    _In_ QUIC_LOOKUP* Lookup,
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    BOOLEAN Result;
+
+    QuicDispatchRwLockAcquireExclusive(&Lookup->RwLock);
+    Result =
+        Lookup->PartitionCount == 0 &&
+        Lookup->CidCount == 0 &&
+        Lookup->SINGLE.Connection == NULL;
+    if (Result) {
+        Lookup->SINGLE.Connection = Connection;
+        QuicConnAddRef(Connection, QUIC_CONN_REF_LOOKUP_TABLE);
+    }
+    QuicDispatchRwLockReleaseExclusive(&Lookup->RwLock);
+
+    return Result;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicLookupClearDedicatedConnection(
+    _In_ QUIC_LOOKUP* Lookup,
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QuicDispatchRwLockAcquireExclusive(&Lookup->RwLock);
+    QUIC_DBG_ASSERT(Lookup->PartitionCount == 0);
+    QUIC_DBG_ASSERT(Lookup->SINGLE.Connection == Connection);
+    Lookup->SINGLE.Connection = NULL;
+    QuicDispatchRwLockReleaseExclusive(&Lookup->RwLock);
+    QuicConnRelease(Connection, QUIC_CONN_REF_LOOKUP_TABLE);
+}
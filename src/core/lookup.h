@@ -38,6 +38,13 @@ typedef struct QUIC_LOOKUP {
     //
     QUIC_DISPATCH_RW_LOCK RwLock;
 
+    //
+    // Incremented to an odd value before the partitioned tables are replaced,
+    // and back to an even value after. Lets local CID lookups skip RwLock and
+    // only take the partition's lock, as long as no rebalance overlapped them.
+    //
+    long volatile Generation;
+
     //
     // The number of partitions used for lookup tables. Value of 0 (default)
     // indicates only a single connection (may be NULL) is bound.
@@ -64,6 +71,15 @@ typedef struct QUIC_LOOKUP {
         } HASH;
     };
 
+    //
+    // The partitioned hash tables replaced by the last rebalance. Lock-free
+    // readers may still be accessing them, so they are only freed when the
+    // lookup is uninitialized. Partitioning only grows, and only once after
+    // the first hash tables are created, so at most one set is ever retired.
+    //
+    uint8_t RetiredPartitionCount;
+    QUIC_PARTITIONED_HASHTABLE* RetiredTables;
+
     //
     // Remote Hash lookup.
     //
@@ -199,3 +215,25 @@ QuicLookupMoveLocalConnectionIDs(
     _In_ QUIC_LOOKUP* LookupDest,
     _In_ QUIC_CONNECTION* Connection
     );
+
+//
+// Binds the connection to an otherwise empty lookup, without inserting any of
+// its local CIDs, which stay in the lookup they're already in. Packets are
+// still matched against all the connection's local CIDs.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicLookupSetDedicatedConnection(
+    _In_ QUIC_LOOKUP* Lookup,
+    _In_ QUIC_CONNECTION* Connection
+    );
+
+//
+// Unbinds the connection set by QuicLookupSetDedicatedConnection.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicLookupClearDedicatedConnection(
+    _In_ QUIC_LOOKUP* Lookup,
+    _In_ QUIC_CONNECTION* Connection
+    );
@@ -14,6 +14,11 @@ Abstract:
     An unacknowledged packet sent before an acknowledged packet and
     sent more than QUIC_TIME_REORDER_THRESHOLD ago is assumed lost.
 
+    Both the time threshold and the packet (FACK) threshold adapt to the
+    reordering observed on the path: they are widened each time a packet
+    declared lost is later acknowledged, and reset after
+    QUIC_REORDER_THRESHOLD_PERSIST loss events without that happening.
+
 
     There are three logical timers in this module:
 
@@ -71,6 +76,14 @@ QuicLossDetectionInitializeInternalState(
 {
     LossDetection->PacketsInFlight = 0;
     LossDetection->ProbeCount = 0;
+    LossDetection->ReorderThresholdMultiplier = 1;
+    LossDetection->LossEventsSinceSpuriousLoss = 0;
+    LossDetection->TimerUpdatePending = FALSE;
+    LossDetection->LossEventActive = FALSE;
+    LossDetection->LossEventConfirmed = FALSE;
+    LossDetection->TotalBytesDelivered = 0;
+    LossDetection->TimeOfLastDelivery = 0;
+    LossDetection->FirstSentTime = 0;
 }
 
 #if DEBUG
@@ -80,19 +93,28 @@ QuicLossValidate(
     _In_ QUIC_LOSS_DETECTION* LossDetection
     )
 {
+    const QUIC_SENT_PACKET_RING* Ring = &LossDetection->SentPackets;
     uint32_t AckElicitingPackets = 0;
-    QUIC_SENT_PACKET_METADATA** Tail = &LossDetection->SentPackets;
-    while (*Tail) {
-        QUIC_DBG_ASSERT(!(*Tail)->Flags.Freed);
-        if ((*Tail)->Flags.IsAckEliciting) {
+    uint32_t LivePackets = 0;
+    for (uint32_t i = 0; i < Ring->Count; ++i) {
+        const QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(Ring, i);
+        QUIC_DBG_ASSERT(
+            i == 0 ||
+            QuicSentPacketRingGet(Ring, i - 1)->PacketNumber < Header->PacketNumber);
+        if (Header->Metadata == NULL) {
+            continue;
+        }
+        QUIC_DBG_ASSERT(!Header->Metadata->Flags.Freed);
+        QUIC_DBG_ASSERT(Header->PacketNumber == Header->Metadata->PacketNumber);
+        LivePackets++;
+        if (Header->Flags.IsAckEliciting) {
             AckElicitingPackets++;
         }
-        Tail = &((*Tail)->Next);
     }
-    QUIC_DBG_ASSERT(Tail == LossDetection->SentPacketsTail);
+    QUIC_DBG_ASSERT(Ring->LiveCount == LivePackets);
     QUIC_DBG_ASSERT(LossDetection->PacketsInFlight == AckElicitingPackets);
 
-    Tail = &LossDetection->LostPackets;
+    QUIC_SENT_PACKET_METADATA** Tail = &LossDetection->LostPackets;
     while (*Tail) {
         QUIC_DBG_ASSERT(!(*Tail)->Flags.Freed);
         Tail = &((*Tail)->Next);
@@ -109,8 +131,7 @@ QuicLossDetectionInitialize(
     _Inout_ QUIC_LOSS_DETECTION* LossDetection
     )
 {
-    LossDetection->SentPackets = NULL;
-    LossDetection->SentPacketsTail = &LossDetection->SentPackets;
+    QuicSentPacketRingInitialize(&LossDetection->SentPackets);
     LossDetection->LostPackets = NULL;
     LossDetection->LostPacketsTail = &LossDetection->LostPackets;
     QuicLossDetectionInitializeInternalState(LossDetection);
@@ -124,9 +145,12 @@ QuicLossDetectionUninitialize(
 {
     QUIC_CONNECTION* Connection = QuicLossDetectionGetConnection(LossDetection);
 
-    while (LossDetection->SentPackets != NULL) {
-        QUIC_SENT_PACKET_METADATA* Packet = LossDetection->SentPackets;
-        LossDetection->SentPackets = LossDetection->SentPackets->Next;
+    QUIC_SENT_PACKET_RING* Ring = &LossDetection->SentPackets;
+    for (uint32_t i = 0; i < Ring->Count; ++i) {
+        if (QuicSentPacketRingGet(Ring, i)->Metadata == NULL) {
+            continue;
+        }
+        QUIC_SENT_PACKET_METADATA* Packet = QuicSentPacketRingRemove(Ring, i);
 
         if (Packet->Flags.IsAckEliciting) {
             QuicTraceLogVerbose(
@@ -139,6 +163,7 @@ QuicLossDetectionUninitialize(
 
         QuicLossDetectionOnPacketDiscarded(LossDetection, Packet);
     }
+    QuicSentPacketRingUninitialize(Ring);
     while (LossDetection->LostPackets != NULL) {
         QUIC_SENT_PACKET_METADATA* Packet = LossDetection->LostPackets;
         LossDetection->LostPackets = LossDetection->LostPackets->Next;
@@ -172,12 +197,14 @@ QuicLossDetectionReset(
     // Throw away any outstanding packets.
     //
 
-    while (LossDetection->SentPackets != NULL) {
-        QUIC_SENT_PACKET_METADATA* Packet = LossDetection->SentPackets;
-        LossDetection->SentPackets = LossDetection->SentPackets->Next;
-        QuicLossDetectionRetransmitFrames(LossDetection, Packet, TRUE);
+    QUIC_SENT_PACKET_RING* Ring = &LossDetection->SentPackets;
+    for (uint32_t i = 0; i < Ring->Count; ++i) {
+        if (QuicSentPacketRingGet(Ring, i)->Metadata != NULL) {
+            QuicLossDetectionRetransmitFrames(
+                LossDetection, QuicSentPacketRingRemove(Ring, i), TRUE);
+        }
     }
-    LossDetection->SentPacketsTail = &LossDetection->SentPackets;
+    QuicSentPacketRingTrim(Ring);
 
     while (LossDetection->LostPackets != NULL) {
         QUIC_SENT_PACKET_METADATA* Packet = LossDetection->LostPackets;
@@ -191,20 +218,22 @@ QuicLossDetectionReset(
 
 //
 // Returns the oldest outstanding retransmittable packet's sent tracking
-// data structure. Returns NULL if there are no oustanding retransmittable
-// packets.
+// header. Returns NULL if there are no oustanding retransmittable packets.
 //
 _IRQL_requires_max_(PASSIVE_LEVEL)
-QUIC_SENT_PACKET_METADATA*
+const QUIC_SENT_PACKET_HEADER*
 QuicLossDetectionOldestOutstandingPacket(
     _In_ QUIC_LOSS_DETECTION* LossDetection
     )
 {
-    QUIC_SENT_PACKET_METADATA* Packet = LossDetection->SentPackets;
-    while (Packet != NULL && !Packet->Flags.IsAckEliciting) {
-        Packet = Packet->Next;
+    const QUIC_SENT_PACKET_RING* Ring = &LossDetection->SentPackets;
+    for (uint32_t i = 0; i < Ring->Count; ++i) {
+        const QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(Ring, i);
+        if (Header->Metadata != NULL && Header->Flags.IsAckEliciting) {
+            return Header;
+        }
     }
-    return Packet;
+    return NULL;
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -233,6 +262,24 @@ QuicLossDetectionComputeProbeTimeout(
     return Pto;
 }
 
+//
+// Returns the time (in microseconds) after which an unacknowledged packet sent
+// before an acknowledged one is considered lost.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+uint32_t
+QuicLossDetectionTimeReorderThreshold(
+    _In_ const QUIC_LOSS_DETECTION* LossDetection,
+    _In_ uint32_t Rtt
+    )
+{
+    uint32_t ReorderWindow = (Rtt / 8) * LossDetection->ReorderThresholdMultiplier;
+    if (ReorderWindow > Rtt) {
+        ReorderWindow = Rtt;
+    }
+    return Rtt + ReorderWindow;
+}
+
 typedef enum QUIC_LOSS_TIMER_TYPE {
     LOSS_TIMER_INITIAL,
     LOSS_TIMER_RACK,
@@ -247,6 +294,8 @@ QuicLossDetectionUpdateTimer(
 {
     QUIC_CONNECTION* Connection = QuicLossDetectionGetConnection(LossDetection);
 
+    LossDetection->TimerUpdatePending = FALSE;
+
     if (Connection->State.ClosedLocally || Connection->State.ClosedRemotely) {
         //
         // No retransmission timer runs after the connection has been shut down.
@@ -259,7 +308,7 @@ QuicLossDetectionUpdateTimer(
         return;
     }
 
-    const QUIC_SENT_PACKET_METADATA* OldestPacket = // Oldest retransmittable packet.
+    const QUIC_SENT_PACKET_HEADER* OldestPacket = // Oldest retransmittable packet.
         QuicLossDetectionOldestOutstandingPacket(LossDetection);
 
     if (OldestPacket == NULL &&
@@ -306,12 +355,14 @@ QuicLossDetectionUpdateTimer(
         //
         // RACK timer.
         // There is an outstanding packet with a later packet acknowledged.
-        // Set a timeout for the remainder of QUIC_TIME_REORDER_THRESHOLD.
+        // Set a timeout for the remainder of the time reordering threshold.
         // If it expires, we'll consider the packet lost.
         //
         TimeoutType = LOSS_TIMER_RACK;
         uint32_t RttUs = max(Path->SmoothedRtt, Path->LatestRttSample);
-        TimeFires = OldestPacket->SentTime + QUIC_TIME_REORDER_THRESHOLD(RttUs);
+        TimeFires =
+            OldestPacket->SentTime +
+            QuicLossDetectionTimeReorderThreshold(LossDetection, RttUs);
 
     } else if (!Path->GotFirstRttSample) {
 
@@ -395,6 +446,14 @@ QuicLossDetectionOnPacketSent(
 
     QUIC_DBG_ASSERT(TempSentPacket->FrameCount != 0);
 
+    //
+    // Make room in the outstanding-packet ring first, so there is nothing to
+    // undo if it fails.
+    //
+    if (!QuicSentPacketRingReserve(&LossDetection->SentPackets)) {
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
     //
     // Allocate a copy of the packet metadata.
     //
@@ -412,12 +471,20 @@ QuicLossDetectionOnPacketSent(
 
     LossDetection->LargestSentPacketNumber = TempSentPacket->PacketNumber;
 
+    if (SentPacket->Flags.IsAckEliciting) {
+        SentPacket->Flags.IsAppLimited =
+            QuicCongestionControlIsAppLimited(&Connection->CongestionControl);
+    }
+
+    if (SentPacket->Flags.EcnEctSet) {
+        QuicPathOnEcnPacketSent(Connection, Path);
+    }
+
     //
-    // Add to the outstanding-packet queue.
+    // Add to the outstanding-packet ring.
     //
     SentPacket->Next = NULL;
-    *LossDetection->SentPacketsTail = SentPacket;
-    LossDetection->SentPacketsTail = &SentPacket->Next;
+    QuicSentPacketRingPush(&LossDetection->SentPackets, SentPacket);
 
     QUIC_DBG_ASSERT(
         SentPacket->Flags.KeyType != QUIC_PACKET_KEY_0_RTT ||
@@ -429,11 +496,23 @@ QuicLossDetectionOnPacketSent(
 
         if (LossDetection->PacketsInFlight == 0) {
             QuicConnResetIdleTimeout(Connection);
+
+            //
+            // Start a new delivery rate sampling interval, so that the idle
+            // time isn't counted against the sample.
+            //
+            LossDetection->FirstSentTime = SentPacket->SentTime;
+            LossDetection->TimeOfLastDelivery = SentPacket->SentTime;
         }
 
+        SentPacket->TotalBytesDelivered = LossDetection->TotalBytesDelivered;
+        SentPacket->DeliveredTime = LossDetection->TimeOfLastDelivery;
+        SentPacket->FirstSentTime = LossDetection->FirstSentTime;
+
         Connection->Stats.Send.RetransmittablePackets++;
         LossDetection->PacketsInFlight++;
         LossDetection->TimeOfLastPacketSent = SentPacket->SentTime;
+        Path->BytesInFlight += SentPacket->PacketLength;
 
         if (!Path->IsPeerValidated) {
             QuicPathDecrementAllowance(
@@ -573,8 +652,15 @@ QuicLossDetectionOnPacketAcknowledged(
         }
     }
 
-    if (Path != NULL && Packet->Flags.IsPMTUD) {
-        QuicSendOnMtuProbePacketAcked(&Connection->Send, Path, Packet);
+    if (Path != NULL) {
+        if (Path->LargestAck < Packet->PacketNumber) {
+            Path->LargestAck = Packet->PacketNumber;
+        }
+        if (Packet->Flags.IsAckEliciting && !Packet->Flags.SuspectedLost) {
+            QuicPathRemoveBytesInFlight(Path, Packet->PacketLength);
+        }
+        QuicMtuDiscoveryOnPacketAcknowledged(
+            Connection, Path, Packet->Flags.IsPMTUD, Packet->PacketLength);
     }
 
     QuicSentPacketPoolReturnPacketMetadata(&Connection->Worker->SentPacketPool, Packet);
@@ -748,6 +834,20 @@ QuicLossDetectionRetransmitFrames(
                     QUIC_CONN_SEND_FLAG_HANDSHAKE_DONE);
             break;
 
+        case QUIC_FRAME_ACK_FREQUENCY:
+            //
+            // Only the most recent ACK_FREQUENCY frame matters. If a newer one
+            // has already been sent, there is nothing to retransmit.
+            //
+            if (Packet->Frames[i].ACK_FREQUENCY.Sequence + 1 ==
+                Connection->SendAckFreqSeqNum) {
+                NewDataQueued |=
+                    QuicSendSetSendFlag(
+                        &Connection->Send,
+                        QUIC_CONN_SEND_FLAG_ACK_FREQUENCY);
+            }
+            break;
+
         case QUIC_FRAME_DATAGRAM:
         case QUIC_FRAME_DATAGRAM_1:
             if (!Packet->Flags.SuspectedLost) {
@@ -827,6 +927,7 @@ QuicLossDetectionDetectAndHandleLostPackets(
                 PtkConnPre(Connection),
                 Packet->PacketNumber);
             LossDetection->LostPackets = Packet->Next;
+            LossDetection->LossEventConfirmed = TRUE;
             QuicLossDetectionOnPacketDiscarded(LossDetection, Packet);
         }
         if (LossDetection->LostPackets == NULL) {
@@ -836,7 +937,8 @@ QuicLossDetectionDetectAndHandleLostPackets(
         QuicLossValidate(LossDetection);
     }
 
-    if (LossDetection->SentPackets != NULL) {
+    QUIC_SENT_PACKET_RING* Ring = &LossDetection->SentPackets;
+    if (Ring->LiveCount != 0) {
         //
         // Remove "suspect" packets inferred lost from out-of-order ACKs.
         // The spec has:
@@ -847,55 +949,81 @@ QuicLossDetectionDetectAndHandleLostPackets(
         //
         const QUIC_PATH* Path = &Connection->Paths[0]; // TODO - Correct?
         uint32_t Rtt = max(Path->SmoothedRtt, Path->LatestRttSample);
-        uint32_t TimeReorderThreshold = QUIC_TIME_REORDER_THRESHOLD(Rtt);
+        uint32_t TimeReorderThreshold =
+            QuicLossDetectionTimeReorderThreshold(LossDetection, Rtt);
+        uint64_t PacketReorderThreshold =
+            QUIC_PACKET_REORDER_THRESHOLD * LossDetection->ReorderThresholdMultiplier;
         uint64_t LargestLostPacketNumber = 0;
-        QUIC_SENT_PACKET_METADATA* PrevPacket = NULL;
-        Packet = LossDetection->SentPackets;
-        while (Packet != NULL) {
+        for (uint32_t i = 0; i < Ring->Count; ++i) {
+
+            const QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(Ring, i);
+            if (Header->Metadata == NULL) {
+                continue;
+            }
 
             BOOLEAN NonretransmittableHandshakePacket =
-                !Packet->Flags.IsAckEliciting &&
-                Packet->Flags.KeyType < QUIC_PACKET_KEY_1_RTT;
+                !Header->Flags.IsAckEliciting &&
+                Header->Flags.KeyType < QUIC_PACKET_KEY_1_RTT;
             QUIC_ENCRYPT_LEVEL EncryptLevel =
-                QuicKeyTypeToEncryptLevel(Packet->Flags.KeyType);
+                QuicKeyTypeToEncryptLevel(Header->Flags.KeyType);
 
             if (EncryptLevel > LossDetection->LargestAckEncryptLevel) {
-                PrevPacket = Packet;
-                Packet = Packet->Next;
                 continue;
-            } else if (Packet->PacketNumber + QUIC_PACKET_REORDER_THRESHOLD < LossDetection->LargestAck) {
+            }
+
+            Packet = Header->Metadata;
+            QUIC_PATH* PacketPath = QuicConnGetPathByID(Connection, Packet->PathId);
+            uint64_t LargestAck = LossDetection->LargestAck;
+            if (Connection->State.MultipathNegotiated && PacketPath != NULL) {
+                //
+                // Only compare with the packets sent on the same path, since
+                // the other paths may be much faster or slower.
+                //
+                LargestAck = PacketPath->LargestAck;
+                Rtt = max(PacketPath->SmoothedRtt, PacketPath->LatestRttSample);
+                TimeReorderThreshold =
+                    QuicLossDetectionTimeReorderThreshold(LossDetection, Rtt);
+            }
+
+            if (Header->PacketNumber + PacketReorderThreshold < LargestAck) {
                 if (!NonretransmittableHandshakePacket) {
-                    QuicTraceLogVerbose(
-                        PacketTxLostFack,
-                        "[%c][TX][%llu] Lost: FACK %llu packets",
-                        PtkConnPre(Connection),
-                        Packet->PacketNumber,
-                        LossDetection->LargestAck - Packet->PacketNumber);
-                    QuicTraceEvent(
-                        ConnPacketLost,
-                        "[conn][%p][TX][%llu] %hhu Lost: %hhu",
-                        Connection,
-                        Packet->PacketNumber,
-                        QuicPacketTraceType(Packet),
-                        QUIC_TRACE_PACKET_LOSS_FACK);
+                    if (Connection->TraceSampled) {
+                        QuicTraceLogVerbose(
+                            PacketTxLostFack,
+                            "[%c][TX][%llu] Lost: FACK %llu packets",
+                            PtkConnPre(Connection),
+                            Packet->PacketNumber,
+                            LargestAck - Packet->PacketNumber);
+                        QuicTraceEvent(
+                            ConnPacketLost,
+                            "[conn][%p][TX][%llu] %hhu Lost: %hhu",
+                            Connection,
+                            Packet->PacketNumber,
+                            QuicPacketTraceType(Packet),
+                            QUIC_TRACE_PACKET_LOSS_FACK);
+                    }
                 }
-            } else if (Packet->PacketNumber < LossDetection->LargestAck &&
-                        QuicTimeAtOrBefore32(Packet->SentTime + TimeReorderThreshold, TimeNow)) {
+            } else if (Header->PacketNumber < LargestAck &&
+                        QuicTimeAtOrBefore32(Header->SentTime + TimeReorderThreshold, TimeNow)) {
                 if (!NonretransmittableHandshakePacket) {
-                    QuicTraceLogVerbose(
-                        PacketTxLostRack,
-                        "[%c][TX][%llu] Lost: RACK %lu ms",
-                        PtkConnPre(Connection),
-                        Packet->PacketNumber,
-                        QuicTimeDiff32(Packet->SentTime, TimeNow));
-                    QuicTraceEvent(
-                        ConnPacketLost,
-                        "[conn][%p][TX][%llu] %hhu Lost: %hhu",
-                        Connection,
-                        Packet->PacketNumber,
-                        QuicPacketTraceType(Packet),
-                        QUIC_TRACE_PACKET_LOSS_RACK);
+                    if (Connection->TraceSampled) {
+                        QuicTraceLogVerbose(
+                            PacketTxLostRack,
+                            "[%c][TX][%llu] Lost: RACK %lu ms",
+                            PtkConnPre(Connection),
+                            Packet->PacketNumber,
+                            QuicTimeDiff32(Packet->SentTime, TimeNow));
+                        QuicTraceEvent(
+                            ConnPacketLost,
+                            "[conn][%p][TX][%llu] %hhu Lost: %hhu",
+                            Connection,
+                            Packet->PacketNumber,
+                            QuicPacketTraceType(Packet),
+                            QUIC_TRACE_PACKET_LOSS_RACK);
+                    }
                 }
+            } else if (Connection->State.MultipathNegotiated) {
+                continue; // Later packets may be on a different path.
             } else {
                 break;
             }
@@ -904,37 +1032,51 @@ QuicLossDetectionDetectAndHandleLostPackets(
             if (Packet->Flags.IsAckEliciting) {
                 LossDetection->PacketsInFlight--;
                 LostRetransmittableBytes += Packet->PacketLength;
+                if (PacketPath != NULL) {
+                    QuicPathRemoveBytesInFlight(PacketPath, Packet->PacketLength);
+                }
                 QuicLossDetectionRetransmitFrames(LossDetection, Packet, FALSE);
             }
 
-            LargestLostPacketNumber = Packet->PacketNumber;
-            if (PrevPacket == NULL) {
-                LossDetection->SentPackets = Packet->Next;
-                if (Packet->Next == NULL) {
-                    LossDetection->SentPacketsTail = &LossDetection->SentPackets;
-                }
-            } else {
-                PrevPacket->Next = Packet->Next;
-                if (Packet->Next == NULL) {
-                    LossDetection->SentPacketsTail = &PrevPacket->Next;
+            if (PacketPath != NULL) {
+                QuicMtuDiscoveryOnPacketLost(
+                    Connection, PacketPath, Packet->Flags.IsPMTUD, Packet->PacketLength);
+                if (Packet->Flags.EcnEctSet) {
+                    QuicPathOnEcnPacketLost(Connection, PacketPath);
                 }
             }
 
+            LargestLostPacketNumber = Packet->PacketNumber;
+            QuicSentPacketRingRemove(Ring, i);
+
             *LossDetection->LostPacketsTail = Packet;
             LossDetection->LostPacketsTail = &Packet->Next;
-            Packet = Packet->Next;
             *LossDetection->LostPacketsTail = NULL;
         }
 
+        QuicSentPacketRingTrim(Ring);
         QuicLossValidate(LossDetection);
 
         if (LostRetransmittableBytes > 0) {
+            if (LossDetection->ReorderThresholdMultiplier > 1 &&
+                ++LossDetection->LossEventsSinceSpuriousLoss >= QUIC_REORDER_THRESHOLD_PERSIST) {
+                LossDetection->ReorderThresholdMultiplier = 1;
+                LossDetection->LossEventsSinceSpuriousLoss = 0;
+            }
+            if (!LossDetection->LossEventActive ||
+                LargestLostPacketNumber > LossDetection->LossEventSentPacketNumber) {
+                LossDetection->LossEventActive = TRUE;
+                LossDetection->LossEventConfirmed = FALSE;
+                LossDetection->LossEventSentPacketNumber =
+                    LossDetection->LargestSentPacketNumber;
+            }
             QuicCongestionControlOnDataLost(
                 &Connection->CongestionControl,
                 LargestLostPacketNumber,
                 LossDetection->LargestSentPacketNumber,
                 LostRetransmittableBytes,
                 LossDetection->ProbeCount > QUIC_PERSISTENT_CONGESTION_THRESHOLD);
+            QuicSendUpdateAckFrequency(&Connection->Send);
             //
             // Send packets from any previously blocked streams.
             //
@@ -973,6 +1115,7 @@ QuicLossDetectionDiscardPackets(
         QUIC_SENT_PACKET_METADATA* NextPacket = Packet->Next;
 
         if (Packet->Flags.KeyType == KeyType) {
+            LossDetection->LossEventConfirmed = TRUE;
             if (PrevPacket != NULL) {
                 PrevPacket->Next = NextPacket;
                 if (NextPacket == NULL) {
@@ -985,17 +1128,19 @@ QuicLossDetectionDiscardPackets(
                 }
             }
 
-            QuicTraceLogVerbose(
-                PacketTxAckedImplicit,
-                "[%c][TX][%llu] ACKed (implicit)",
-                PtkConnPre(Connection),
-                Packet->PacketNumber);
-            QuicTraceEvent(
-                ConnPacketACKed,
-                "[conn][%p][TX][%llu] %hhu ACKed",
-                Connection,
-                Packet->PacketNumber,
-                QuicPacketTraceType(Packet));
+            if (Connection->TraceSampled) {
+                QuicTraceLogVerbose(
+                    PacketTxAckedImplicit,
+                    "[%c][TX][%llu] ACKed (implicit)",
+                    PtkConnPre(Connection),
+                    Packet->PacketNumber);
+                QuicTraceEvent(
+                    ConnPacketACKed,
+                    "[conn][%p][TX][%llu] %hhu ACKed",
+                    Connection,
+                    Packet->PacketNumber,
+                    QuicPacketTraceType(Packet));
+            }
             QuicLossDetectionOnPacketAcknowledged(LossDetection, EncryptLevel, Packet);
 
             Packet = NextPacket;
@@ -1008,35 +1153,26 @@ QuicLossDetectionDiscardPackets(
 
     QuicLossValidate(LossDetection);
 
-    PrevPacket = NULL;
-    Packet = LossDetection->SentPackets;
-    while (Packet != NULL) {
-        QUIC_SENT_PACKET_METADATA* NextPacket = Packet->Next;
+    QUIC_SENT_PACKET_RING* Ring = &LossDetection->SentPackets;
+    for (uint32_t i = 0; i < Ring->Count; ++i) {
+        const QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(Ring, i);
 
-        if (Packet->Flags.KeyType == KeyType) {
-            if (PrevPacket != NULL) {
-                PrevPacket->Next = NextPacket;
-                if (NextPacket == NULL) {
-                    LossDetection->SentPacketsTail = &PrevPacket->Next;
-                }
-            } else {
-                LossDetection->SentPackets = NextPacket;
-                if (NextPacket == NULL) {
-                    LossDetection->SentPacketsTail = &LossDetection->SentPackets;
-                }
-            }
+        if (Header->Metadata != NULL && Header->Flags.KeyType == KeyType) {
+            Packet = QuicSentPacketRingRemove(Ring, i);
 
-            QuicTraceLogVerbose(
-                PacketTxAckedImplicit,
-                "[%c][TX][%llu] ACKed (implicit)",
-                PtkConnPre(Connection),
-                Packet->PacketNumber);
-            QuicTraceEvent(
-                ConnPacketACKed,
-                "[conn][%p][TX][%llu] %hhu ACKed",
-                Connection,
-                Packet->PacketNumber,
-                QuicPacketTraceType(Packet));
+            if (Connection->TraceSampled) {
+                QuicTraceLogVerbose(
+                    PacketTxAckedImplicit,
+                    "[%c][TX][%llu] ACKed (implicit)",
+                    PtkConnPre(Connection),
+                    Packet->PacketNumber);
+                QuicTraceEvent(
+                    ConnPacketACKed,
+                    "[conn][%p][TX][%llu] %hhu ACKed",
+                    Connection,
+                    Packet->PacketNumber,
+                    QuicPacketTraceType(Packet));
+            }
 
             if (Packet->Flags.IsAckEliciting) {
                 LossDetection->PacketsInFlight--;
@@ -1044,25 +1180,31 @@ QuicLossDetectionDiscardPackets(
             }
 
             QuicLossDetectionOnPacketAcknowledged(LossDetection, EncryptLevel, Packet);
-
-            Packet = NextPacket;
-
-        } else {
-            PrevPacket = Packet;
-            Packet = NextPacket;
         }
     }
 
+    QuicSentPacketRingTrim(Ring);
     QuicLossValidate(LossDetection);
+    QuicStreamSendCompleteFlushBatches(Connection);
 
     if (AckedRetransmittableBytes > 0) {
         const QUIC_PATH* Path = &Connection->Paths[0]; // TODO - Correct?
+        QUIC_ACK_EVENT AckEvent;
+        QuicZeroMemory(&AckEvent, sizeof(AckEvent));
+        AckEvent.TimeNow = TimeNow;
+        AckEvent.LargestAck = LossDetection->LargestAck;
+        AckEvent.LargestSentPacketNumber = LossDetection->LargestSentPacketNumber;
+        AckEvent.NumRetransmittableBytes = AckedRetransmittableBytes;
+        AckEvent.SmoothedRtt = Path->SmoothedRtt;
+        AckEvent.TotalBytesDelivered = LossDetection->TotalBytesDelivered;
+
+        //
+        // Implicitly acknowledged packets weren't necessarily delivered, so
+        // they don't produce a delivery rate sample.
+        //
         if (QuicCongestionControlOnDataAcknowledged(
                 &Connection->CongestionControl,
-                US_TO_MS(TimeNow),
-                LossDetection->LargestAck,
-                AckedRetransmittableBytes,
-                Path->SmoothedRtt)) {
+                &AckEvent)) {
             //
             // We were previously blocked and are now unblocked.
             //
@@ -1078,31 +1220,19 @@ QuicLossDetectionOnZeroRttRejected(
     )
 {
     QUIC_CONNECTION* Connection = QuicLossDetectionGetConnection(LossDetection);
-    QUIC_SENT_PACKET_METADATA* PrevPacket;
-    QUIC_SENT_PACKET_METADATA* Packet;
+    QUIC_SENT_PACKET_RING* Ring = &LossDetection->SentPackets;
     uint32_t CountRetransmittableBytes = 0;
 
     //
     // Marks all the packets as lost so they can be retransmitted immediately.
     //
 
-    PrevPacket = NULL;
-    Packet = LossDetection->SentPackets;
-    while (Packet != NULL) {
-        QUIC_SENT_PACKET_METADATA* NextPacket = Packet->Next;
+    for (uint32_t i = 0; i < Ring->Count; ++i) {
+        const QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(Ring, i);
 
-        if (Packet->Flags.KeyType == QUIC_PACKET_KEY_0_RTT) {
-            if (PrevPacket != NULL) {
-                PrevPacket->Next = NextPacket;
-                if (NextPacket == NULL) {
-                    LossDetection->SentPacketsTail = &PrevPacket->Next;
-                }
-            } else {
-                LossDetection->SentPackets = NextPacket;
-                if (NextPacket == NULL) {
-                    LossDetection->SentPacketsTail = &LossDetection->SentPackets;
-                }
-            }
+        if (Header->Metadata != NULL &&
+            Header->Flags.KeyType == QUIC_PACKET_KEY_0_RTT) {
+            QUIC_SENT_PACKET_METADATA* Packet = QuicSentPacketRingRemove(Ring, i);
 
             QuicTraceLogVerbose(
                 PacketTx0RttRejected,
@@ -1116,15 +1246,10 @@ QuicLossDetectionOnZeroRttRejected(
             CountRetransmittableBytes += Packet->PacketLength;
 
             QuicLossDetectionRetransmitFrames(LossDetection, Packet, TRUE);
-
-            Packet = NextPacket;
-
-        } else {
-            PrevPacket = Packet;
-            Packet = NextPacket;
         }
     }
 
+    QuicSentPacketRingTrim(Ring);
     QuicLossValidate(LossDetection);
 
     if (CountRetransmittableBytes > 0) {
@@ -1139,6 +1264,78 @@ QuicLossDetectionOnZeroRttRejected(
     }
 }
 
+//
+// Validates the ECN counts of an ACK frame that acknowledged a new largest
+// packet (RFC 9000, section 13.4.2) and reports any new CE marks to the
+// congestion controller.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLossDetectionProcessEcn(
+    _In_ QUIC_LOSS_DETECTION* LossDetection,
+    _In_ QUIC_PATH* Path,
+    _In_ QUIC_ENCRYPT_LEVEL EncryptLevel,
+    _In_opt_ const QUIC_ACK_ECN_EX* Ecn,
+    _In_ uint32_t EcnEctPacketsAcked
+    )
+{
+    QUIC_CONNECTION* Connection = QuicLossDetectionGetConnection(LossDetection);
+    QUIC_PACKET_SPACE* Packets = Connection->Packets[EncryptLevel];
+
+    if (Path->EcnValidationState == QUIC_ECN_VALIDATION_FAILED ||
+        Packets == NULL) {
+        return;
+    }
+
+    if (Ecn == NULL) {
+        if (EcnEctPacketsAcked > 0) {
+            //
+            // The marks (or the counts) were removed somewhere on the path.
+            //
+            QuicPathSetEcnValidationState(
+                Connection, Path, QUIC_ECN_VALIDATION_FAILED);
+        }
+        return;
+    }
+
+    QUIC_ACK_ECN_EX* PeerEcn = &Packets->PeerEcn;
+    if (Ecn->ECT_0_Count < PeerEcn->ECT_0_Count ||
+        Ecn->ECT_1_Count < PeerEcn->ECT_1_Count ||
+        Ecn->CE_Count < PeerEcn->CE_Count ||
+        (Ecn->ECT_0_Count - PeerEcn->ECT_0_Count) +
+            (Ecn->CE_Count - PeerEcn->CE_Count) < EcnEctPacketsAcked) {
+        //
+        // The counts don't cover all the newly acknowledged ECT(0) packets,
+        // so the path (or the peer) doesn't handle ECN correctly.
+        //
+        QuicPathSetEcnValidationState(
+            Connection, Path, QUIC_ECN_VALIDATION_FAILED);
+        return;
+    }
+
+    const BOOLEAN NewCeMarks = Ecn->CE_Count > PeerEcn->CE_Count;
+    *PeerEcn = *Ecn;
+
+    if (EcnEctPacketsAcked > 0 &&
+        Path->EcnValidationState != QUIC_ECN_VALIDATION_CAPABLE) {
+        QuicPathSetEcnValidationState(
+            Connection, Path, QUIC_ECN_VALIDATION_CAPABLE);
+    }
+
+    if (NewCeMarks) {
+        QuicTraceLogConnInfo(
+            EcnCongestionExperienced,
+            Connection,
+            "Path[%hhu] Peer reported CE count %llu",
+            Path->ID,
+            Ecn->CE_Count);
+        QuicCongestionControlOnEcn(
+            &Connection->CongestionControl,
+            LossDetection->LargestAck,
+            LossDetection->LargestSentPacketNumber);
+    }
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicLossDetectionProcessAckBlocks(
@@ -1147,6 +1344,8 @@ QuicLossDetectionProcessAckBlocks(
     _In_ QUIC_ENCRYPT_LEVEL EncryptLevel,
     _In_ uint64_t AckDelay,
     _In_ QUIC_RANGE* AckBlocks,
+    _In_opt_ const QUIC_ACK_ECN_EX* Ecn,
+    _In_ uint64_t AckRecvTime,
     _Out_ BOOLEAN* InvalidAckBlock
     )
 {
@@ -1154,17 +1353,33 @@ QuicLossDetectionProcessAckBlocks(
     QUIC_SENT_PACKET_METADATA** AckedPacketsTail = &AckedPackets;
 
     uint32_t AckedRetransmittableBytes = 0;
+    uint32_t EcnEctPacketsAcked = 0;
     QUIC_CONNECTION* Connection = QuicLossDetectionGetConnection(LossDetection);
     uint32_t TimeNow = QuicTimeUs32();
     uint32_t SmallestRtt = (uint32_t)(-1);
     BOOLEAN NewLargestAck = FALSE;
     BOOLEAN NewLargestAckRetransmittable = FALSE;
     BOOLEAN NewLargestAckDifferentPath = FALSE;
+    uint8_t NewLargestAckPathId = 0;
+    BOOLEAN SpuriousLoss = FALSE;
+
+    //
+    // Delivery rate state of the most recently sent, newly acknowledged,
+    // ack-eliciting packet, which the rate sample is based on.
+    //
+    BOOLEAN HasRateSamplePacket = FALSE;
+    uint64_t RateSamplePacketNumber = 0;
+    uint64_t RateSamplePriorDelivered = 0;
+    uint32_t RateSampleDeliveredTime = 0;
+    uint32_t RateSampleSentTime = 0;
+    uint32_t RateSampleFirstSentTime = 0;
+    BOOLEAN RateSampleIsAppLimited = FALSE;
 
     *InvalidAckBlock = FALSE;
 
     QUIC_SENT_PACKET_METADATA** LostPacketsStart = &LossDetection->LostPackets;
-    QUIC_SENT_PACKET_METADATA** SentPacketsStart = &LossDetection->SentPackets;
+    QUIC_SENT_PACKET_RING* Ring = &LossDetection->SentPackets;
+    uint32_t SentPacketsStart = 0;
     QUIC_SENT_PACKET_METADATA* LargestAckedPacket = NULL;
 
     uint32_t i = 0;
@@ -1188,6 +1403,7 @@ QuicLossDetectionProcessAckBlocks(
                     PtkConnPre(Connection),
                     (*End)->PacketNumber);
                 Connection->Stats.Send.SpuriousLostPackets++;
+                SpuriousLoss = TRUE;
                 //
                 // NOTE: we don't increment AckedRetransmittableBytes here
                 // because we already told the congestion control module that
@@ -1210,38 +1426,41 @@ QuicLossDetectionProcessAckBlocks(
         }
 
         //
-        // Now find all the acknowledged packets in the SentPackets list.
+        // Now find all the acknowledged packets in the SentPackets ring. The
+        // ACK blocks are in ascending order, so each search can start where
+        // the previous block ended.
         //
-        if (*SentPacketsStart != NULL) {
-            while (*SentPacketsStart && (*SentPacketsStart)->PacketNumber < AckBlock->Low) {
-                SentPacketsStart = &((*SentPacketsStart)->Next);
-            }
-
-            QUIC_SENT_PACKET_METADATA** End = SentPacketsStart;
-            while (*End && (*End)->PacketNumber <= QuicRangeGetHigh(AckBlock)) {
+        if (Ring->LiveCount != 0) {
+            SentPacketsStart =
+                QuicSentPacketRingLowerBound(Ring, SentPacketsStart, AckBlock->Low);
+
+            uint64_t High = QuicRangeGetHigh(AckBlock);
+            for (; SentPacketsStart < Ring->Count; ++SentPacketsStart) {
+                const QUIC_SENT_PACKET_HEADER* Header =
+                    QuicSentPacketRingGet(Ring, SentPacketsStart);
+                if (Header->PacketNumber > High) {
+                    break;
+                }
+                if (Header->Metadata == NULL) {
+                    continue;
+                }
 
-                if ((*End)->Flags.IsAckEliciting) {
+                if (Header->Flags.IsAckEliciting) {
                     LossDetection->PacketsInFlight--;
-                    AckedRetransmittableBytes += (*End)->PacketLength;
+                    AckedRetransmittableBytes += Header->PacketLength;
                 }
-                LargestAckedPacket = *End;
-                End = &((*End)->Next);
-            }
 
-            if (SentPacketsStart != End) {
                 //
-                // Remove the ACKed packets from the outstanding packet list.
+                // Move the ACKed packet from the outstanding packet ring to
+                // the end of the acknowledged list.
                 //
-                *AckedPacketsTail = *SentPacketsStart;
-                AckedPacketsTail = End;
-                *SentPacketsStart = *End;
-                *End = NULL;
-                if (End == LossDetection->SentPacketsTail) {
-                    LossDetection->SentPacketsTail = SentPacketsStart;
-                }
-
-                QuicLossValidate(LossDetection);
+                LargestAckedPacket = QuicSentPacketRingRemove(Ring, SentPacketsStart);
+                *AckedPacketsTail = LargestAckedPacket;
+                AckedPacketsTail = &LargestAckedPacket->Next;
+                *AckedPacketsTail = NULL;
             }
+
+            QuicLossValidate(LossDetection);
         }
 
         if (LargestAckedPacket != NULL &&
@@ -1253,9 +1472,12 @@ QuicLossDetectionProcessAckBlocks(
             NewLargestAck = TRUE;
             NewLargestAckRetransmittable = LargestAckedPacket->Flags.IsAckEliciting;
             NewLargestAckDifferentPath = Path->ID != LargestAckedPacket->PathId;
+            NewLargestAckPathId = LargestAckedPacket->PathId;
         }
     }
 
+    QuicSentPacketRingTrim(Ring);
+
     if (AckedPackets == NULL) {
         //
         // Nothing was acknowledged, so we can exit now.
@@ -1281,27 +1503,74 @@ QuicLossDetectionProcessAckBlocks(
             return;
         }
 
-        uint32_t PacketRtt = QuicTimeDiff32(Packet->SentTime, TimeNow);
-        QuicTraceLogVerbose(
-            PacketTxAcked,
-            "[%c][TX][%llu] ACKed (%u.%03u ms)",
-            PtkConnPre(Connection),
-            Packet->PacketNumber,
-            PacketRtt / 1000,
-            PacketRtt % 1000);
-        QuicTraceEvent(
-            ConnPacketACKed,
-            "[conn][%p][TX][%llu] %hhu ACKed",
-            Connection,
-            Packet->PacketNumber,
-            QuicPacketTraceType(Packet));
+        //
+        // The RTT runs until the ACK was received, not until it's processed.
+        // A packet seemingly sent after that (which can only be the result
+        // of an inaccurate receive timestamp) is measured against now.
+        //
+        uint32_t PacketRtt =
+            QuicTimeAtOrBefore32(Packet->SentTime, (uint32_t)AckRecvTime) ?
+                QuicTimeDiff32(Packet->SentTime, (uint32_t)AckRecvTime) :
+                QuicTimeDiff32(Packet->SentTime, TimeNow);
+        if (Connection->TraceSampled) {
+            QuicTraceLogVerbose(
+                PacketTxAcked,
+                "[%c][TX][%llu] ACKed (%u.%03u ms)",
+                PtkConnPre(Connection),
+                Packet->PacketNumber,
+                PacketRtt / 1000,
+                PacketRtt % 1000);
+            QuicTraceEvent(
+                ConnPacketACKed,
+                "[conn][%p][TX][%llu] %hhu ACKed",
+                Connection,
+                Packet->PacketNumber,
+                QuicPacketTraceType(Packet));
+        }
+
+        if (!Connection->State.MultipathNegotiated ||
+            Packet->PathId == NewLargestAckPathId) {
+            SmallestRtt = min(SmallestRtt, PacketRtt);
+        }
+
+        if (Packet->Flags.IsAckEliciting) {
+            //
+            // Spuriously lost packets count as delivered too; they only
+            // stopped counting towards bytes in flight.
+            //
+            LossDetection->TotalBytesDelivered += Packet->PacketLength;
+            LossDetection->TimeOfLastDelivery = TimeNow;
+            if (!HasRateSamplePacket ||
+                Packet->PacketNumber > RateSamplePacketNumber) {
+                HasRateSamplePacket = TRUE;
+                RateSamplePacketNumber = Packet->PacketNumber;
+                RateSamplePriorDelivered = Packet->TotalBytesDelivered;
+                RateSampleDeliveredTime = Packet->DeliveredTime;
+                RateSampleSentTime = Packet->SentTime;
+                RateSampleFirstSentTime = Packet->FirstSentTime;
+                RateSampleIsAppLimited = Packet->Flags.IsAppLimited;
+            }
+        }
 
-        SmallestRtt = min(SmallestRtt, PacketRtt);
+        if (Packet->Flags.EcnEctSet) {
+            EcnEctPacketsAcked++;
+        }
 
         QuicLossDetectionOnPacketAcknowledged(LossDetection, EncryptLevel, Packet);
     }
 
     QuicLossValidate(LossDetection);
+    QuicStreamSendCompleteFlushBatches(Connection);
+
+    QUIC_PATH* RttPath = Path;
+    if (NewLargestAckDifferentPath && Connection->State.MultipathNegotiated) {
+        //
+        // With multipath, ACKs come back on any path. The RTT sample is for
+        // the path the packet was sent on.
+        //
+        RttPath = QuicConnGetPathByID(Connection, NewLargestAckPathId);
+        NewLargestAckDifferentPath = RttPath == NULL;
+    }
 
     if (NewLargestAckRetransmittable && !NewLargestAckDifferentPath) {
         //
@@ -1315,7 +1584,40 @@ QuicLossDetectionProcessAckBlocks(
             //
             SmallestRtt -= (uint32_t)AckDelay;
         }
-        QuicConnUpdateRtt(Connection, Path, SmallestRtt);
+        QuicHistogramAddSample(Connection->Histograms.AckDelay, AckDelay);
+        QuicConnUpdateRtt(Connection, RttPath, SmallestRtt);
+    } else {
+        SmallestRtt = (uint32_t)(-1);
+    }
+
+    if (SpuriousLoss) {
+        //
+        // Packets were only reordered, not lost, so widen the reordering
+        // thresholds before looking for more losses.
+        //
+        if (LossDetection->ReorderThresholdMultiplier < QUIC_MAX_REORDER_THRESHOLD_MULTIPLIER) {
+            LossDetection->ReorderThresholdMultiplier++;
+            QuicTraceLogConnVerbose(
+                ReorderThresholdIncreased,
+                Connection,
+                "Reorder threshold multiplier increased to %hhu",
+                LossDetection->ReorderThresholdMultiplier);
+        }
+        LossDetection->LossEventsSinceSpuriousLoss = 0;
+
+        if (LossDetection->LostPackets == NULL &&
+            LossDetection->LossEventActive &&
+            !LossDetection->LossEventConfirmed) {
+            //
+            // Every packet declared lost since the congestion event was
+            // acknowledged after all, so the event is undone.
+            //
+            LossDetection->LossEventActive = FALSE;
+            if (QuicCongestionControlOnSpuriousCongestionEvent(
+                    &Connection->CongestionControl)) {
+                QuicSendQueueFlush(&Connection->Send, REASON_CONGESTION_CONTROL);
+            }
+        }
     }
 
     if (NewLargestAck) {
@@ -1325,29 +1627,88 @@ QuicLossDetectionProcessAckBlocks(
         // calculation for congestion events.
         //
         QuicLossDetectionDetectAndHandleLostPackets(LossDetection, TimeNow);
+
+        if (RttPath != NULL) {
+            QuicLossDetectionProcessEcn(
+                LossDetection,
+                RttPath,
+                EncryptLevel,
+                Ecn,
+                EcnEctPacketsAcked);
+        }
     }
 
     if (NewLargestAck || AckedRetransmittableBytes > 0) {
+        QUIC_ACK_EVENT AckEvent;
+        QuicZeroMemory(&AckEvent, sizeof(AckEvent));
+        AckEvent.TimeNow = TimeNow;
+        AckEvent.LargestAck = LossDetection->LargestAck;
+        AckEvent.LargestSentPacketNumber = LossDetection->LargestSentPacketNumber;
+        AckEvent.NumRetransmittableBytes = AckedRetransmittableBytes;
+        AckEvent.SmoothedRtt = Connection->Paths[0].SmoothedRtt;
+        AckEvent.MinRtt = SmallestRtt;
+        AckEvent.MinRttValid = SmallestRtt != (uint32_t)(-1);
+        AckEvent.TotalBytesDelivered = LossDetection->TotalBytesDelivered;
+
+        if (HasRateSamplePacket) {
+            //
+            // The sample covers the bytes delivered since the sample packet
+            // was sent, over the longer of its send and ACK phases. Using
+            // the longer phase keeps ACK compression from inflating the
+            // estimate.
+            //
+            uint32_t SendElapsed =
+                QuicTimeDiff32(RateSampleFirstSentTime, RateSampleSentTime);
+            uint32_t AckElapsed =
+                QuicTimeDiff32(RateSampleDeliveredTime, TimeNow);
+            LossDetection->FirstSentTime = RateSampleSentTime;
+
+            AckEvent.PriorDelivered = RateSamplePriorDelivered;
+            AckEvent.DeliveredBytes =
+                LossDetection->TotalBytesDelivered - RateSamplePriorDelivered;
+            AckEvent.Interval = max(SendElapsed, AckElapsed);
+            AckEvent.IsAppLimited = RateSampleIsAppLimited;
+
+            //
+            // Samples over intervals shorter than the min RTT are likely the
+            // result of ACK aggregation and aren't trustworthy.
+            //
+            AckEvent.IsRateSampleValid =
+                AckEvent.Interval != 0 &&
+                (!Connection->Paths[0].GotFirstRttSample ||
+                 AckEvent.Interval >= Connection->Paths[0].MinRtt);
+        }
+
         if (QuicCongestionControlOnDataAcknowledged(
                 &Connection->CongestionControl,
-                US_TO_MS(TimeNow),
-                LossDetection->LargestAck,
-                AckedRetransmittableBytes,
-                Connection->Paths[0].SmoothedRtt)) {
+                &AckEvent)) {
             //
             // We were previously blocked and are now unblocked.
             //
             QuicSendQueueFlush(&Connection->Send, REASON_CONGESTION_CONTROL);
         }
+        QuicSendUpdateAckFrequency(&Connection->Send);
     }
 
     LossDetection->ProbeCount = 0;
 
     //
     // At least one packet was ACKed. If all packets were ACKed then we'll
-    // cancel the timer; otherwise we'll reset the timer.
+    // cancel the timer; otherwise we'll reset the timer. A datagram batch may
+    // carry many ACKs, so this is done once at the end of the batch.
     //
-    QuicLossDetectionUpdateTimer(LossDetection);
+    LossDetection->TimerUpdatePending = TRUE;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLossDetectionFlushTimerUpdate(
+    _In_ QUIC_LOSS_DETECTION* LossDetection
+    )
+{
+    if (LossDetection->TimerUpdatePending) {
+        QuicLossDetectionUpdateTimer(LossDetection);
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -1361,6 +1722,7 @@ QuicLossDetectionProcessAckFrame(
     _In_reads_bytes_(BufferLength)
         const uint8_t* const Buffer,
     _Inout_ uint16_t* Offset,
+    _In_ uint64_t AckRecvTime,
     _Out_ BOOLEAN* InvalidFrame
     )
 {
@@ -1400,7 +1762,6 @@ QuicLossDetectionProcessAckFrame(
 
         } else {
 
-            // TODO - Use ECN information.
             AckDelay <<= Connection->PeerTransportParams.AckDelayExponent;
 
             QuicLossDetectionProcessAckBlocks(
@@ -1409,6 +1770,8 @@ QuicLossDetectionProcessAckFrame(
                 EncryptLevel,
                 AckDelay,
                 &Connection->DecodedAckRanges,
+                FrameType == QUIC_FRAME_ACK_1 ? &Ecn : NULL,
+                AckRecvTime,
                 InvalidFrame);
         }
     }
@@ -1456,6 +1819,14 @@ QuicLossDetectionScheduleProbe(
     Connection->Send.TailLossProbeNeeded = TRUE;
 
     if (Connection->Crypto.TlsState.WriteKey == QUIC_PACKET_KEY_1_RTT) {
+        if (Connection->PeerTransportParams.Flags & QUIC_TP_FLAG_MIN_ACK_DELAY) {
+            //
+            // The peer may be delaying its ACKs because of a previous
+            // ACK_FREQUENCY frame. Ask it to acknowledge the probe right away.
+            //
+            QuicSendSetSendFlag(&Connection->Send, QUIC_CONN_SEND_FLAG_IMMEDIATE_ACK);
+        }
+
         //
         // Check to see if any streams have fresh data to send out.
         //
@@ -1477,27 +1848,30 @@ QuicLossDetectionScheduleProbe(
     // Not enough new stream data exists to fill the probing packets. Schedule
     // retransmits if possible.
     //
-    QUIC_SENT_PACKET_METADATA* Packet = LossDetection->SentPackets;
-    while (Packet != NULL) {
-        if (Packet->Flags.IsAckEliciting) {
-            QuicTraceLogVerbose(
-                PacketTxProbeRetransmit,
-                "[%c][TX][%llu] Probe Retransmit",
-                PtkConnPre(Connection),
-                Packet->PacketNumber);
-            QuicTraceEvent(
-                ConnPacketLost,
-                "[conn][%p][TX][%llu] %hhu Lost: %hhu",
-                Connection,
-                Packet->PacketNumber,
-                QuicPacketTraceType(Packet),
-                QUIC_TRACE_PACKET_LOSS_PROBE);
+    const QUIC_SENT_PACKET_RING* Ring = &LossDetection->SentPackets;
+    for (uint32_t i = 0; i < Ring->Count; ++i) {
+        const QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(Ring, i);
+        if (Header->Metadata != NULL && Header->Flags.IsAckEliciting) {
+            QUIC_SENT_PACKET_METADATA* Packet = Header->Metadata;
+            if (Connection->TraceSampled) {
+                QuicTraceLogVerbose(
+                    PacketTxProbeRetransmit,
+                    "[%c][TX][%llu] Probe Retransmit",
+                    PtkConnPre(Connection),
+                    Packet->PacketNumber);
+                QuicTraceEvent(
+                    ConnPacketLost,
+                    "[conn][%p][TX][%llu] %hhu Lost: %hhu",
+                    Connection,
+                    Packet->PacketNumber,
+                    QuicPacketTraceType(Packet),
+                    QUIC_TRACE_PACKET_LOSS_PROBE);
+            }
             if (QuicLossDetectionRetransmitFrames(LossDetection, Packet, FALSE) &&
                 --NumPackets == 0) {
                 return;
             }
         }
-        Packet = Packet->Next;
     }
 
     //
@@ -1516,7 +1890,7 @@ QuicLossDetectionProcessTimerOperation(
 {
     QUIC_CONNECTION* Connection = QuicLossDetectionGetConnection(LossDetection);
 
-    const QUIC_SENT_PACKET_METADATA* OldestPacket = // Oldest retransmittable packet.
+    const QUIC_SENT_PACKET_HEADER* OldestPacket = // Oldest retransmittable packet.
         QuicLossDetectionOldestOutstandingPacket(LossDetection);
 
     if (OldestPacket == NULL &&
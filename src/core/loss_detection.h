@@ -23,20 +23,20 @@ typedef struct QUIC_LOSS_DETECTION {
     QUIC_ENCRYPT_LEVEL LargestAckEncryptLevel;
 
     //
-    // N.B.: SentPackets and LostPackets are generally kept in ascending packet
-    // number order, and packets in the LostPackets list generally have smaller
-    // numbers than those in the SentPackets list. The only case this is not
-    // true is during the handshake. Since multiple encryption levels are used
-    // in parallel, higher numbered packets in lower encryption levels can be
-    // "lost" sooner than the higher encryption levels.
+    // N.B.: SentPackets is always in ascending packet number order. LostPackets
+    // is generally kept in ascending packet number order too, and packets in
+    // the LostPackets list generally have smaller numbers than those in
+    // SentPackets. The only case this is not true is during the handshake.
+    // Since multiple encryption levels are used in parallel, higher numbered
+    // packets in lower encryption levels can be "lost" sooner than the higher
+    // encryption levels.
     //
 
     //
     // Outstanding packets.
     //
     uint64_t LargestSentPacketNumber;
-    QUIC_SENT_PACKET_METADATA* SentPackets;
-    QUIC_SENT_PACKET_METADATA** SentPacketsTail;
+    QUIC_SENT_PACKET_RING SentPackets;
 
     uint32_t TimeOfLastPacketSent;
 
@@ -54,6 +54,58 @@ typedef struct QUIC_LOSS_DETECTION {
     //
     uint16_t ProbeCount;
 
+    //
+    // Scales the reordering thresholds for the reordering observed on the
+    // path. Starts at 1; see QUIC_MAX_REORDER_THRESHOLD_MULTIPLIER.
+    //
+    uint8_t ReorderThresholdMultiplier;
+
+    //
+    // The number of loss events since the last spurious loss.
+    //
+    uint8_t LossEventsSinceSpuriousLoss;
+
+    //
+    // Mirrors the congestion controller's congestion events (a new one starts
+    // when a packet sent after the last one started is lost), to find events
+    // where every packet declared lost was only reordered. Such an event is
+    // undone once the LostPackets list empties, unless any lost packet was
+    // forgotten (or discarded) without being acknowledged, i.e. was really
+    // lost.
+    //
+    uint64_t LossEventSentPacketNumber;
+    BOOLEAN LossEventActive;
+    BOOLEAN LossEventConfirmed;
+
+    //
+    // Indicates ACKs were processed and the timer must be updated, which is
+    // deferred to the end of the receive batch.
+    //
+    BOOLEAN TimerUpdatePending;
+
+    //
+    // Delivery rate sampling state (see draft-cheng-iccrg-delivery-rate-
+    // estimation). Each sent packet captures these values so that the bytes
+    // delivered between its send and its acknowledgement, and the time it
+    // took, can be computed when it is acknowledged.
+    //
+
+    //
+    // Total number of ack-eliciting bytes acknowledged so far.
+    //
+    uint64_t TotalBytesDelivered;
+
+    //
+    // The time TotalBytesDelivered was last updated, in microseconds.
+    //
+    uint32_t TimeOfLastDelivery;
+
+    //
+    // The send time of the packet most recently used as the basis of a rate
+    // sample, in microseconds. Reset when nothing is in flight.
+    //
+    uint32_t FirstSentTime;
+
 } QUIC_LOSS_DETECTION;
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -103,6 +155,16 @@ QuicLossDetectionUpdateTimer(
     _In_ QUIC_LOSS_DETECTION* LossDetection
     );
 
+//
+// Updates the timer if an update was deferred while processing received
+// packets. Called once per receive batch.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicLossDetectionFlushTimerUpdate(
+    _In_ QUIC_LOSS_DETECTION* LossDetection
+    );
+
 //
 // Returns the current PTO in microseconds.
 //
@@ -128,7 +190,8 @@ QuicLossDetectionOnPacketSent(
 //
 // Processes a received ACK frame. Returns true if the frame could be
 // successfully processed. On failure, 'InvalidFrame' indicates if the frame
-// was corrupt or not.
+// was corrupt or not. AckRecvTime is when the datagram carrying the frame was
+// received, which RTT samples are measured against.
 //
 _IRQL_requires_max_(PASSIVE_LEVEL)
 BOOLEAN
@@ -141,6 +204,7 @@ QuicLossDetectionProcessAckFrame(
     _In_reads_bytes_(BufferLength)
         const uint8_t* const Buffer,
     _Inout_ uint16_t* Offset,
+    _In_ uint64_t AckRecvTime,
     _Out_ BOOLEAN* InvalidFrame
     );
 
@@ -0,0 +1,252 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Datagram packetization layer path MTU discovery (DPLPMTUD, RFC 8899).
+
+    The path starts at the minimum QUIC MTU. Once the path is validated, a
+    probe (a padded, PING only packet) of the largest MTU allowed by the local
+    interface and the peer is sent. If it is acknowledged, the search is done.
+    Otherwise, a binary search is run between the largest MTU known to work
+    and the largest one that may still work, lowering the latter each time
+    QUIC_DPLPMTUD_MAX_PROBES probes of a size are lost.
+
+    A search that completed below the maximum is run again after
+    QUIC_DPLPMTUD_RAISE_TIMER, in case the path changed. If too many
+    consecutive packets larger than the minimum MTU are lost, the path is
+    assumed to have become a black hole for them: the MTU falls back to the
+    minimum and a new search starts below the size that was lost.
+
+--*/
+
+#include "precomp.h"
+#ifdef QUIC_CLOG
+#include "mtu_discovery.c.clog.h"
+#endif
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicMtuDiscoverySendProbe(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ uint16_t ProbeSize
+    )
+{
+    Path->MtuDiscovery.ProbeSize = ProbeSize;
+    Path->MtuDiscovery.ProbeCount = 0;
+    QuicTraceLogConnVerbose(
+        MtuSearchProbe,
+        Connection,
+        "Path[%hhu] Probing MTU %hu bytes",
+        Path->ID,
+        ProbeSize);
+    QuicSendSetSendFlag(&Connection->Send, QUIC_CONN_SEND_FLAG_PMTUD);
+}
+
+//
+// Probes the middle of the remaining search range, or completes the search if
+// the range is small enough.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicMtuDiscoveryContinueSearch(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path
+    )
+{
+    QUIC_MTU_DISCOVERY* MtuDiscovery = &Path->MtuDiscovery;
+
+    if ((uint32_t)MtuDiscovery->SearchHigh <
+        (uint32_t)Path->Mtu + QUIC_DPLPMTUD_SEARCH_GRANULARITY) {
+        MtuDiscovery->ProbeSize = 0;
+        MtuDiscovery->IsSearchComplete = TRUE;
+        MtuDiscovery->SearchCompleteTime = QuicTimeUs64();
+        QuicTraceLogConnInfo(
+            MtuSearchComplete,
+            Connection,
+            "Path[%hhu] MTU search complete at %hu bytes",
+            Path->ID,
+            Path->Mtu);
+        return;
+    }
+
+    QuicMtuDiscoverySendProbe(
+        Connection,
+        Path,
+        (uint16_t)(((uint32_t)Path->Mtu + MtuDiscovery->SearchHigh + 1) / 2));
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicMtuDiscoveryStartSearch(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ uint16_t SearchHigh
+    )
+{
+    QUIC_MTU_DISCOVERY* MtuDiscovery = &Path->MtuDiscovery;
+    MtuDiscovery->SearchHigh = SearchHigh;
+    MtuDiscovery->IsSearchComplete = FALSE;
+
+    if ((uint32_t)SearchHigh < (uint32_t)Path->Mtu + QUIC_DPLPMTUD_SEARCH_GRANULARITY) {
+        QuicMtuDiscoveryContinueSearch(Connection, Path);
+    } else {
+        //
+        // Most paths support the largest MTU, so it's tried first, before
+        // searching.
+        //
+        QuicMtuDiscoverySendProbe(Connection, Path, SearchHigh);
+    }
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicMtuDiscoveryUpdateMtu(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ uint16_t NewMtu
+    )
+{
+    Path->Mtu = NewMtu;
+    QuicTraceLogConnInfo(
+        PathMtuUpdated,
+        Connection,
+        "Path[%hhu] MTU updated to %hu bytes",
+        Path->ID,
+        Path->Mtu);
+    QuicDatagramOnSendStateChanged(&Connection->Datagram);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicMtuDiscoveryNewSearch(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path
+    )
+{
+    QUIC_ADDRESS_FAMILY Family = QuicAddrGetFamily(&Path->RemoteAddress);
+
+    uint16_t MaxMtu =
+        QuicDataPathBindingGetLocalMtu(Path->Binding->DatapathBinding);
+    if (MaxMtu > QUIC_MAX_MTU) {
+        MaxMtu = QUIC_MAX_MTU; // The largest datagram the datapath can send.
+    }
+    if (Connection->PeerTransportParams.Flags & QUIC_TP_FLAG_MAX_UDP_PAYLOAD_SIZE &&
+        Connection->PeerTransportParams.MaxUdpPayloadSize <
+            MaxUdpPayloadSizeForFamily(Family, MaxMtu)) {
+        MaxMtu =
+            PacketSizeFromUdpPayloadSize(
+                Family,
+                (uint16_t)Connection->PeerTransportParams.MaxUdpPayloadSize);
+    }
+    if (MaxMtu < Path->Mtu) {
+        MaxMtu = Path->Mtu;
+    }
+
+    uint16_t SearchHigh = MaxMtu;
+    if (Path->MtuDiscovery.CachedMtu > Path->Mtu &&
+        Path->MtuDiscovery.CachedMtu < MaxMtu) {
+        //
+        // A previous connection found the network doesn't support the largest
+        // MTU, so its MTU is probed first instead. Larger MTUs are still tried
+        // again when the search is next raised.
+        //
+        SearchHigh = Path->MtuDiscovery.CachedMtu;
+    }
+    Path->MtuDiscovery.CachedMtu = 0;
+
+    Path->MtuDiscovery.MaxMtu = MaxMtu;
+    Path->MtuDiscovery.LargePacketsLost = 0;
+    QuicMtuDiscoveryStartSearch(Connection, Path, SearchHigh);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicMtuDiscoveryOnPacketAcknowledged(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ BOOLEAN IsProbe,
+    _In_ uint16_t PacketLength
+    )
+{
+    QUIC_MTU_DISCOVERY* MtuDiscovery = &Path->MtuDiscovery;
+    uint16_t PacketMtu =
+        PacketSizeFromUdpPayloadSize(
+            QuicAddrGetFamily(&Path->RemoteAddress),
+            PacketLength);
+
+    if (IsProbe) {
+        if (PacketMtu > Path->Mtu) {
+            QuicMtuDiscoveryUpdateMtu(Connection, Path, PacketMtu);
+        }
+        if (PacketMtu == MtuDiscovery->ProbeSize) {
+            QuicMtuDiscoveryContinueSearch(Connection, Path);
+        }
+        return;
+    }
+
+    if (PacketMtu > QUIC_DEFAULT_PATH_MTU) {
+        MtuDiscovery->LargePacketsLost = 0;
+    }
+
+    if (MtuDiscovery->IsSearchComplete &&
+        MtuDiscovery->SearchHigh < MtuDiscovery->MaxMtu &&
+        QuicTimeDiff64(MtuDiscovery->SearchCompleteTime, QuicTimeUs64()) >=
+            QUIC_DPLPMTUD_RAISE_TIMER) {
+        QuicTraceLogConnVerbose(
+            MtuSearchRestart,
+            Connection,
+            "Path[%hhu] Restarting MTU search",
+            Path->ID);
+        QuicMtuDiscoveryStartSearch(Connection, Path, MtuDiscovery->MaxMtu);
+    }
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicMtuDiscoveryOnPacketLost(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ BOOLEAN IsProbe,
+    _In_ uint16_t PacketLength
+    )
+{
+    QUIC_MTU_DISCOVERY* MtuDiscovery = &Path->MtuDiscovery;
+    uint16_t PacketMtu =
+        PacketSizeFromUdpPayloadSize(
+            QuicAddrGetFamily(&Path->RemoteAddress),
+            PacketLength);
+
+    if (IsProbe) {
+        if (PacketMtu != MtuDiscovery->ProbeSize) {
+            return; // An older probe.
+        }
+        if (++MtuDiscovery->ProbeCount < QUIC_DPLPMTUD_MAX_PROBES) {
+            QuicSendSetSendFlag(&Connection->Send, QUIC_CONN_SEND_FLAG_PMTUD);
+        } else {
+            MtuDiscovery->SearchHigh = PacketMtu - 1;
+            QuicMtuDiscoveryContinueSearch(Connection, Path);
+        }
+        return;
+    }
+
+    if (PacketMtu <= QUIC_DEFAULT_PATH_MTU ||
+        ++MtuDiscovery->LargePacketsLost < QUIC_DPLPMTUD_BLACK_HOLE_PACKETS) {
+        return;
+    }
+
+    QuicTraceLogConnInfo(
+        MtuBlackHoleDetected,
+        Connection,
+        "Path[%hhu] Black hole detected for %hu byte packets",
+        Path->ID,
+        PacketMtu);
+    MtuDiscovery->LargePacketsLost = 0;
+    MtuDiscovery->SearchHigh = PacketMtu - 1;
+    MtuDiscovery->IsSearchComplete = FALSE;
+    QuicMtuDiscoveryUpdateMtu(Connection, Path, QUIC_DEFAULT_PATH_MTU);
+    QuicMtuDiscoveryContinueSearch(Connection, Path);
+}
@@ -0,0 +1,93 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Definitions for datagram packetization layer path MTU discovery
+    (DPLPMTUD, RFC 8899), which searches for the largest MTU a path supports.
+
+--*/
+
+typedef struct QUIC_MTU_DISCOVERY {
+
+    //
+    // The time (in microseconds) the last search completed.
+    //
+    uint64_t SearchCompleteTime;
+
+    //
+    // The largest MTU allowed by the local interface and the peer.
+    //
+    uint16_t MaxMtu;
+
+    //
+    // The largest MTU that may still work. Lowered as probes are lost.
+    //
+    uint16_t SearchHigh;
+
+    //
+    // The MTU currently being probed, or 0 if none.
+    //
+    uint16_t ProbeSize;
+
+    //
+    // The MTU the path's network was last known to support (from the
+    // session's path metrics cache), or 0. Used by the first search only.
+    //
+    uint16_t CachedMtu;
+
+    //
+    // The number of probes of ProbeSize lost so far.
+    //
+    uint8_t ProbeCount;
+
+    //
+    // The number of consecutive lost packets larger than the minimum MTU.
+    //
+    uint8_t LargePacketsLost;
+
+    //
+    // Indicates the search is not running, and will next be started by the
+    // raise timer.
+    //
+    BOOLEAN IsSearchComplete : 1;
+
+} QUIC_MTU_DISCOVERY;
+
+//
+// Starts a search from the path's current MTU up to the largest MTU allowed
+// locally and by the peer.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicMtuDiscoveryNewSearch(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path
+    );
+
+//
+// Called when a packet sent on the path is acknowledged. PacketLength is the
+// length of the UDP payload it was sent in.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicMtuDiscoveryOnPacketAcknowledged(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ BOOLEAN IsProbe,
+    _In_ uint16_t PacketLength
+    );
+
+//
+// Called when a packet sent on the path is declared lost.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicMtuDiscoveryOnPacketLost(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ BOOLEAN IsProbe,
+    _In_ uint16_t PacketLength
+    );
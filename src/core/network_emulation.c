@@ -0,0 +1,413 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    The network emulator stands in for the network in front of each binding,
+    so that congestion control and loss recovery can be benchmarked in a
+    repeatable way without an external emulator (e.g. netem).
+
+    When enabled (see QUIC_PARAM_GLOBAL_NETWORK_EMULATION), each new binding
+    gets an emulated link. Every datagram the binding receives first goes
+    through the link: it may be lost (alone or in a burst), it waits for the
+    bottleneck to send everything queued ahead of it (and is dropped if the
+    bottleneck's buffer is full), and then has the fixed delay, any jitter and
+    any reordering delay added to it. The datagrams are then queued to a single
+    thread, which delivers them to their bindings at their delivery times.
+
+    Only the receive path is emulated, so when both peers are in the same
+    process both directions are. Delivery times are only as precise as the
+    platform's event wait, which has a millisecond granularity.
+
+--*/
+
+#include "precomp.h"
+#ifdef QUIC_CLOG
+#include "network_emulation.c.clog.h"
+#endif
+
+QUIC_THREAD_CALLBACK(QuicNetworkEmulatorThread, Context);
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicNetworkEmulatorInitialize(
+    _Out_ QUIC_NETWORK_EMULATOR** NewEmulator
+    )
+{
+    QUIC_NETWORK_EMULATOR* Emulator =
+        QUIC_ALLOC_NONPAGED(sizeof(QUIC_NETWORK_EMULATOR));
+    if (Emulator == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_NETWORK_EMULATOR",
+            sizeof(QUIC_NETWORK_EMULATOR));
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    QuicZeroMemory(Emulator, sizeof(QUIC_NETWORK_EMULATOR));
+    Emulator->Enabled = TRUE;
+    QuicDispatchLockInitialize(&Emulator->Lock);
+    QuicListInitializeHead(&Emulator->Queue);
+    QuicPoolInitialize(FALSE, sizeof(QUIC_EMULATED_DATAGRAM), &Emulator->DatagramPool);
+    QuicEventInitialize(&Emulator->Ready, FALSE, FALSE);
+
+    QUIC_THREAD_CONFIG ThreadConfig = {
+        0,
+        0,
+        "quic_netem",
+        QuicNetworkEmulatorThread,
+        Emulator
+    };
+    QUIC_STATUS Status = QuicThreadCreate(&ThreadConfig, &Emulator->Thread);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "QuicThreadCreate (network emulator)");
+        QuicEventUninitialize(Emulator->Ready);
+        QuicPoolUninitialize(&Emulator->DatagramPool);
+        QuicDispatchLockUninitialize(&Emulator->Lock);
+        QUIC_FREE(Emulator);
+        return Status;
+    }
+
+    QuicTraceLogInfo(
+        NetworkEmulatorCreated,
+        "[ lib] Network emulator created");
+
+    *NewEmulator = Emulator;
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicNetworkEmulatorUninitialize(
+    _In_ QUIC_NETWORK_EMULATOR* Emulator
+    )
+{
+    QuicDispatchLockAcquire(&Emulator->Lock);
+    Emulator->Enabled = FALSE;
+    QuicDispatchLockRelease(&Emulator->Lock);
+    QuicEventSet(Emulator->Ready);
+
+    QuicThreadWait(&Emulator->Thread);
+    QuicThreadDelete(&Emulator->Thread);
+
+    QUIC_DBG_ASSERT(QuicListIsEmpty(&Emulator->Queue));
+    QuicEventUninitialize(Emulator->Ready);
+    QuicPoolUninitialize(&Emulator->DatagramPool);
+    QuicDispatchLockUninitialize(&Emulator->Lock);
+    QUIC_FREE(Emulator);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicEmulatedLinkCreate(
+    _In_ QUIC_BINDING* Binding,
+    _In_ const QUIC_NETWORK_EMULATION* Settings,
+    _Out_ QUIC_EMULATED_LINK** NewLink
+    )
+{
+    QUIC_EMULATED_LINK* Link = QUIC_ALLOC_NONPAGED(sizeof(QUIC_EMULATED_LINK));
+    if (Link == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_EMULATED_LINK",
+            sizeof(QUIC_EMULATED_LINK));
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    QuicZeroMemory(Link, sizeof(QUIC_EMULATED_LINK));
+    Link->Binding = Binding;
+    Link->Settings = *Settings;
+    if (Settings->RandomSeed != 0) {
+        Link->RandomState = Settings->RandomSeed;
+    } else {
+        QuicRandom(sizeof(Link->RandomState), &Link->RandomState);
+    }
+    if (Link->RandomState == 0) {
+        Link->RandomState = 1; // The generator never leaves the zero state.
+    }
+    QuicRundownInitialize(&Link->Rundown);
+
+    *NewLink = Link;
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicEmulatedLinkShutdown(
+    _In_ QUIC_NETWORK_EMULATOR* Emulator,
+    _In_ QUIC_EMULATED_LINK* Link
+    )
+{
+    QUIC_RECV_DATAGRAM* ReleaseChain = NULL;
+    QUIC_RECV_DATAGRAM** ReleaseChainTail = &ReleaseChain;
+
+    QuicDispatchLockAcquire(&Emulator->Lock);
+    Link->Closing = TRUE;
+    QUIC_LIST_ENTRY* Entry = Emulator->Queue.Flink;
+    while (Entry != &Emulator->Queue) {
+        QUIC_EMULATED_DATAGRAM* Emulated =
+            QUIC_CONTAINING_RECORD(Entry, QUIC_EMULATED_DATAGRAM, Link);
+        Entry = Entry->Flink;
+        if (Emulated->EmulatedLink == Link) {
+            QuicListEntryRemove(&Emulated->Link);
+            *ReleaseChainTail = Emulated->Datagram;
+            ReleaseChainTail = &Emulated->Datagram->Next;
+            QuicPoolFree(&Emulator->DatagramPool, Emulated);
+        }
+    }
+    QuicDispatchLockRelease(&Emulator->Lock);
+
+    if (ReleaseChain != NULL) {
+        QuicDataPathBindingReturnRecvDatagrams(ReleaseChain);
+    }
+
+    //
+    // Wait for the emulator thread, if it's delivering to the binding.
+    //
+    QuicRundownReleaseAndWait(&Link->Rundown);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicEmulatedLinkDelete(
+    _In_ QUIC_EMULATED_LINK* Link
+    )
+{
+    QuicRundownUninitialize(&Link->Rundown);
+    QUIC_FREE(Link);
+}
+
+//
+// xorshift64*, so that the sequence only depends on the seed.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint64_t
+QuicEmulatedLinkRandom(
+    _Inout_ QUIC_EMULATED_LINK* Link
+    )
+{
+    Link->RandomState ^= Link->RandomState >> 12;
+    Link->RandomState ^= Link->RandomState << 25;
+    Link->RandomState ^= Link->RandomState >> 27;
+    return Link->RandomState * 0x2545F4914F6CDD1Dull;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicEmulatedLinkRandomPpm(
+    _Inout_ QUIC_EMULATED_LINK* Link,
+    _In_ uint32_t Ppm
+    )
+{
+    return
+        Ppm != 0 &&
+        (QuicEmulatedLinkRandom(Link) % QUIC_NETWORK_EMULATION_PPM_MAX) < Ppm;
+}
+
+//
+// Returns TRUE if the datagram is lost.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicEmulatedLinkIsLost(
+    _Inout_ QUIC_EMULATED_LINK* Link
+    )
+{
+    if (Link->InLossBurst) {
+        //
+        // Each further datagram ends the burst with a chance of
+        // 1 / BurstLength, so bursts average BurstLength datagrams.
+        //
+        if (QuicEmulatedLinkRandom(Link) % Link->Settings.BurstLength == 0) {
+            Link->InLossBurst = FALSE;
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    if (QuicEmulatedLinkRandomPpm(Link, Link->Settings.LossPpm)) {
+        Link->InLossBurst = Link->Settings.BurstLength > 1;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+//
+// Returns the time the datagram should be delivered, or 0 if it's dropped
+// because the bottleneck's buffer is full.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint64_t
+QuicEmulatedLinkGetDeliveryTime(
+    _Inout_ QUIC_EMULATED_LINK* Link,
+    _In_ uint64_t Now,
+    _In_ uint32_t Length
+    )
+{
+    const QUIC_NETWORK_EMULATION* Settings = &Link->Settings;
+    uint64_t Time = Now;
+
+    if (Settings->RateKbps != 0) {
+        if (Link->BusyUntil < Now) {
+            Link->BusyUntil = Now;
+        }
+        uint64_t QueuedBytes =
+            (Link->BusyUntil - Now) * Settings->RateKbps / 8000;
+        if (Settings->QueueLimitBytes != 0 &&
+            QueuedBytes + Length > Settings->QueueLimitBytes) {
+            return 0;
+        }
+        Link->BusyUntil += (uint64_t)Length * 8000 / Settings->RateKbps;
+        Time = Link->BusyUntil;
+    }
+
+    Time += Settings->DelayUs;
+    if (Settings->JitterUs != 0) {
+        Time += QuicEmulatedLinkRandom(Link) % ((uint64_t)Settings->JitterUs + 1);
+    }
+    if (QuicEmulatedLinkRandomPpm(Link, Settings->ReorderPpm)) {
+        Time += Settings->ReorderDelayUs;
+    }
+
+    return Time;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicEmulatedLinkReceive(
+    _In_ QUIC_NETWORK_EMULATOR* Emulator,
+    _In_ QUIC_EMULATED_LINK* Link,
+    _In_ QUIC_RECV_DATAGRAM* DatagramChain
+    )
+{
+    QUIC_RECV_DATAGRAM* ReleaseChain = NULL;
+    QUIC_RECV_DATAGRAM** ReleaseChainTail = &ReleaseChain;
+    BOOLEAN NewHead = FALSE;
+    uint64_t Now = QuicTimeUs64();
+
+    QuicDispatchLockAcquire(&Emulator->Lock);
+
+    QUIC_RECV_DATAGRAM* Datagram;
+    while ((Datagram = DatagramChain) != NULL) {
+        DatagramChain = Datagram->Next;
+        Datagram->Next = NULL;
+
+        uint64_t DeliveryTime = 0;
+        QUIC_EMULATED_DATAGRAM* Emulated = NULL;
+        if (!Link->Closing &&
+            !QuicEmulatedLinkIsLost(Link) &&
+            (DeliveryTime =
+                QuicEmulatedLinkGetDeliveryTime(Link, Now, Datagram->BufferLength)) != 0) {
+            Emulated = QuicPoolAlloc(&Emulator->DatagramPool);
+        }
+
+        if (Emulated == NULL) {
+            QuicTraceLogVerbose(
+                NetworkEmulatorDrop,
+                "[bind][%p] Emulated network dropped datagram",
+                Link->Binding);
+            *ReleaseChainTail = Datagram;
+            ReleaseChainTail = &Datagram->Next;
+            continue;
+        }
+
+        Emulated->DeliveryTime = DeliveryTime;
+        Emulated->EmulatedLink = Link;
+        Emulated->Datagram = Datagram;
+
+        //
+        // Insert in delivery time order, after any datagrams with the same
+        // time. Without jitter or reordering that is always the tail.
+        //
+        QUIC_LIST_ENTRY* Prev = Emulator->Queue.Blink;
+        while (Prev != &Emulator->Queue &&
+               QUIC_CONTAINING_RECORD(Prev, QUIC_EMULATED_DATAGRAM, Link)->DeliveryTime > DeliveryTime) {
+            Prev = Prev->Blink;
+        }
+        QuicListInsertHead(Prev, &Emulated->Link);
+        if (Prev == &Emulator->Queue) {
+            NewHead = TRUE;
+        }
+    }
+
+    QuicDispatchLockRelease(&Emulator->Lock);
+
+    if (NewHead) {
+        QuicEventSet(Emulator->Ready);
+    }
+
+    if (ReleaseChain != NULL) {
+        QuicDataPathBindingReturnRecvDatagrams(ReleaseChain);
+    }
+}
+
+QUIC_THREAD_CALLBACK(QuicNetworkEmulatorThread, Context)
+{
+    QUIC_NETWORK_EMULATOR* Emulator = (QUIC_NETWORK_EMULATOR*)Context;
+
+    while (TRUE) {
+        QUIC_EMULATED_LINK* Link = NULL;
+        QUIC_RECV_DATAGRAM* DatagramChain = NULL;
+        QUIC_RECV_DATAGRAM** DatagramChainTail = &DatagramChain;
+        uint32_t WaitTimeMs = UINT32_MAX;
+
+        QuicDispatchLockAcquire(&Emulator->Lock);
+        BOOLEAN Enabled = Emulator->Enabled;
+        uint64_t Now = QuicTimeUs64();
+
+        //
+        // Take all the due datagrams, at the head of the queue, for the same
+        // binding, so they are delivered as one chain.
+        //
+        while (!QuicListIsEmpty(&Emulator->Queue)) {
+            QUIC_EMULATED_DATAGRAM* Emulated =
+                QUIC_CONTAINING_RECORD(Emulator->Queue.Flink, QUIC_EMULATED_DATAGRAM, Link);
+            if (Emulated->DeliveryTime > Now) {
+                if (Link == NULL) {
+                    WaitTimeMs =
+                        (uint32_t)US_TO_MS(Emulated->DeliveryTime - Now + 999);
+                }
+                break;
+            }
+            if (Link == NULL) {
+                Link = Emulated->EmulatedLink;
+                //
+                // Can't fail, as deleting a link removes its datagrams (under
+                // the lock) before running down.
+                //
+                (void)QuicRundownAcquire(&Link->Rundown);
+            } else if (Emulated->EmulatedLink != Link) {
+                break;
+            }
+            QuicListEntryRemove(&Emulated->Link);
+            Emulated->Datagram->RecvTime = Emulated->DeliveryTime;
+            *DatagramChainTail = Emulated->Datagram;
+            DatagramChainTail = &Emulated->Datagram->Next;
+            QuicPoolFree(&Emulator->DatagramPool, Emulated);
+        }
+
+        QuicDispatchLockRelease(&Emulator->Lock);
+
+        if (Link != NULL) {
+            QuicBindingProcessDatagrams(Link->Binding, DatagramChain);
+            QuicRundownRelease(&Link->Rundown);
+        } else if (!Enabled) {
+            break;
+        } else if (WaitTimeMs == UINT32_MAX) {
+            QuicEventWaitForever(Emulator->Ready);
+        } else {
+            QuicEventWaitWithTimeout(Emulator->Ready, WaitTimeMs);
+        }
+    }
+
+    QUIC_THREAD_RETURN(QUIC_STATUS_SUCCESS);
+}
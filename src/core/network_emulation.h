@@ -0,0 +1,162 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Definitions for the network emulator, which applies delay, jitter, a
+    bandwidth limit, loss and reordering (see QUIC_NETWORK_EMULATION) to the
+    datagrams received by the bindings.
+
+--*/
+
+//
+// The emulated network in front of a single binding.
+//
+typedef struct QUIC_EMULATED_LINK {
+
+    QUIC_BINDING* Binding;
+
+    QUIC_NETWORK_EMULATION Settings;
+
+    //
+    // State of the random number generator used for loss, jitter and
+    // reordering.
+    //
+    uint64_t RandomState;
+
+    //
+    // The time (in microseconds) at which the bottleneck finishes sending the
+    // datagrams queued to it so far.
+    //
+    uint64_t BusyUntil;
+
+    //
+    // Indicates the datagrams are currently being dropped in a loss burst.
+    //
+    BOOLEAN InLossBurst;
+
+    //
+    // Indicates the binding is being deleted and all datagrams are dropped.
+    //
+    BOOLEAN Closing;
+
+    //
+    // Held while queued datagrams are being delivered to the binding.
+    //
+    QUIC_RUNDOWN_REF Rundown;
+
+} QUIC_EMULATED_LINK;
+
+//
+// A datagram waiting to be delivered to a binding.
+//
+typedef struct QUIC_EMULATED_DATAGRAM {
+
+    //
+    // Link in the emulator's queue, which is sorted by DeliveryTime.
+    //
+    QUIC_LIST_ENTRY Link;
+
+    uint64_t DeliveryTime;
+
+    QUIC_EMULATED_LINK* EmulatedLink;
+
+    QUIC_RECV_DATAGRAM* Datagram;
+
+} QUIC_EMULATED_DATAGRAM;
+
+//
+// The queue of delayed datagrams, for all bindings, and the thread that
+// delivers them.
+//
+typedef struct QUIC_NETWORK_EMULATOR {
+
+    //
+    // Indicates the thread should keep running.
+    //
+    BOOLEAN Enabled;
+
+    //
+    // Protects the queue and the state of all the emulated links.
+    //
+    QUIC_DISPATCH_LOCK Lock;
+
+    //
+    // Queue of QUIC_EMULATED_DATAGRAM.
+    //
+    QUIC_LIST_ENTRY Queue;
+
+    QUIC_POOL DatagramPool;
+
+    //
+    // Auto-reset event signaled when a datagram is queued at the head.
+    //
+    QUIC_EVENT Ready;
+
+    QUIC_THREAD Thread;
+
+} QUIC_NETWORK_EMULATOR;
+
+//
+// Creates the emulator and its thread.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicNetworkEmulatorInitialize(
+    _Out_ QUIC_NETWORK_EMULATOR** NewEmulator
+    );
+
+//
+// Cleans up the emulator. All the emulated links must be deleted first.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicNetworkEmulatorUninitialize(
+    _In_ QUIC_NETWORK_EMULATOR* Emulator
+    );
+
+//
+// Creates the emulated link for a new binding.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicEmulatedLinkCreate(
+    _In_ QUIC_BINDING* Binding,
+    _In_ const QUIC_NETWORK_EMULATION* Settings,
+    _Out_ QUIC_EMULATED_LINK** NewLink
+    );
+
+//
+// Drops all the datagrams still queued for the link, and any received from
+// now on, and waits for any delivery in progress.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicEmulatedLinkShutdown(
+    _In_ QUIC_NETWORK_EMULATOR* Emulator,
+    _In_ QUIC_EMULATED_LINK* Link
+    );
+
+//
+// Frees the link. It must be shut down, and the datapath binding deleted,
+// first.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicEmulatedLinkDelete(
+    _In_ QUIC_EMULATED_LINK* Link
+    );
+
+//
+// Takes ownership of the received datagrams: each is either dropped or queued
+// to be delivered to the binding later, on the emulator's thread.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicEmulatedLinkReceive(
+    _In_ QUIC_NETWORK_EMULATOR* Emulator,
+    _In_ QUIC_EMULATED_LINK* Link,
+    _In_ QUIC_RECV_DATAGRAM* DatagramChain
+    );
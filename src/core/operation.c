@@ -20,6 +20,12 @@ Abstract:
     is the only thread that touches the connection itself, which simplifies
     synchronization.
 
+    The queue is lock-free. Producers push onto one of two intrusive stacks
+    (one for normal and one for highest priority operations) with a compare
+    and exchange. The worker takes a whole stack at once with an exchange and
+    moves its operations into a list only it accesses: FIFO for the normal
+    stack, and newest first, ahead of everything else, for the priority one.
+
 --*/
 
 #include "precomp.h"
@@ -33,8 +39,9 @@ QuicOperationQueueInitialize(
     _Inout_ QUIC_OPERATION_QUEUE* OperQ
     )
 {
-    OperQ->ActivelyProcessing = FALSE;
-    QuicDispatchLockInitialize(&OperQ->Lock);
+    OperQ->Scheduled = 0;
+    OperQ->Incoming = NULL;
+    OperQ->IncomingPriority = NULL;
     QuicListInitializeHead(&OperQ->List);
 }
 
@@ -45,8 +52,9 @@ QuicOperationQueueUninitialize(
     )
 {
     UNREFERENCED_PARAMETER(OperQ);
+    QUIC_DBG_ASSERT(OperQ->Incoming == NULL);
+    QUIC_DBG_ASSERT(OperQ->IncomingPriority == NULL);
     QUIC_DBG_ASSERT(QuicListIsEmpty(&OperQ->List));
-    QuicDispatchLockUninitialize(&OperQ->Lock);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -108,6 +116,12 @@ QuicOperationFree(
             QuicStreamRelease(ApiCtx->STRM_SHUTDOWN.Stream, QUIC_STREAM_REF_OPERATION);
         } else if (ApiCtx->Type == QUIC_API_TYPE_STRM_SEND) {
             QuicStreamRelease(ApiCtx->STRM_SEND.Stream, QUIC_STREAM_REF_OPERATION);
+        } else if (ApiCtx->Type == QUIC_API_TYPE_STRM_SEND_BATCH) {
+            for (uint32_t i = 0; i < ApiCtx->STRM_SEND_BATCH.StreamCount; ++i) {
+                QuicStreamRelease(
+                    ApiCtx->STRM_SEND_BATCH.Streams[i], QUIC_STREAM_REF_OPERATION);
+            }
+            QUIC_FREE(ApiCtx->STRM_SEND_BATCH.Streams);
         } else if (ApiCtx->Type == QUIC_API_TYPE_STRM_RECV_COMPLETE) {
             QuicStreamRelease(ApiCtx->STRM_RECV_COMPLETE.Stream, QUIC_STREAM_REF_OPERATION);
         } else if (ApiCtx->Type == QUIC_API_TYPE_STRM_RECV_SET_ENABLED) {
@@ -115,7 +129,16 @@ QuicOperationFree(
         }
         QuicPoolFree(&Worker->ApiContextPool, ApiCtx);
     } else if (Oper->Type == QUIC_OPER_TYPE_FLUSH_STREAM_RECV) {
-        QuicStreamRelease(Oper->FLUSH_STREAM_RECEIVE.Stream, QUIC_STREAM_REF_OPERATION);
+        if (Oper->FLUSH_STREAM_RECEIVE.Stream != NULL) {
+            QuicStreamRelease(Oper->FLUSH_STREAM_RECEIVE.Stream, QUIC_STREAM_REF_OPERATION);
+        }
+    } else if (Oper->Type == QUIC_OPER_TYPE_ADDR_RESOLVED) {
+        QUIC_CONN_RESOLVE_CONTEXT* ResolveContext = Oper->ADDR_RESOLVED.Context;
+        if (ResolveContext->ServerName != NULL) {
+            QUIC_FREE(ResolveContext->ServerName);
+        }
+        QuicConnRelease(ResolveContext->Connection, QUIC_CONN_REF_ADDR_RESOLUTION);
+        QUIC_FREE(ResolveContext);
     } else if (Oper->Type >= QUIC_OPER_TYPE_VERSION_NEGOTIATION) {
         if (Oper->STATELESS.Context != NULL) {
             QuicBindingReleaseStatelessOperation(Oper->STATELESS.Context, TRUE);
@@ -124,22 +147,91 @@ QuicOperationFree(
     QuicPoolFree(&Worker->OperPool, Oper);
 }
 
+//
+// Pushes an operation onto one of the queue's lock-free stacks and returns
+// TRUE if the queue was idle (not already scheduled to be drained).
+//
 _IRQL_requires_max_(DISPATCH_LEVEL)
 BOOLEAN
-QuicOperationEnqueue(
+QuicOperationQueuePush(
     _In_ QUIC_OPERATION_QUEUE* OperQ,
+    _Inout_ QUIC_LIST_ENTRY* volatile* Stack,
     _In_ QUIC_OPERATION* Oper
     )
 {
-    BOOLEAN StartProcessing;
-    QuicDispatchLockAcquire(&OperQ->Lock);
 #if DEBUG
     QUIC_DBG_ASSERT(Oper->Link.Flink == NULL);
 #endif
-    StartProcessing = QuicListIsEmpty(&OperQ->List) && !OperQ->ActivelyProcessing;
-    QuicListInsertTail(&OperQ->List, &Oper->Link);
-    QuicDispatchLockRelease(&OperQ->Lock);
-    return StartProcessing;
+    QUIC_LIST_ENTRY* Head;
+    do {
+        Head = *Stack;
+        Oper->Link.Flink = Head;
+    } while (InterlockedCompareExchangePointer(
+                (void* volatile*)Stack, &Oper->Link, Head) != Head);
+
+    QuicPerfCounterIncrement(QUIC_PERF_COUNTER_CONN_OPER_QUEUED);
+    QuicPerfCounterIncrement(QUIC_PERF_COUNTER_CONN_OPER_QUEUE_DEPTH);
+
+    return
+        OperQ->Scheduled == 0 &&
+        InterlockedCompareExchange(&OperQ->Scheduled, 1, 0) == 0;
+}
+
+//
+// Takes everything pushed so far and moves it into the consumer's list.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicOperationQueueCollect(
+    _In_ QUIC_OPERATION_QUEUE* OperQ
+    )
+{
+    if (OperQ->IncomingPriority != NULL) {
+        //
+        // The priority stack is already newest first, which is the order a
+        // series of inserts at the head would have resulted in.
+        //
+        QUIC_LIST_ENTRY* Entry =
+            (QUIC_LIST_ENTRY*)InterlockedExchangePointer(
+                (void* volatile*)&OperQ->IncomingPriority, NULL);
+        QUIC_LIST_ENTRY Priority;
+        QuicListInitializeHead(&Priority);
+        while (Entry != NULL) {
+            QUIC_LIST_ENTRY* Next = Entry->Flink;
+            QuicListInsertTail(&Priority, Entry);
+            Entry = Next;
+        }
+        QuicListMoveItems(&OperQ->List, &Priority);
+        QuicListMoveItems(&Priority, &OperQ->List);
+    }
+
+    if (OperQ->Incoming != NULL) {
+        //
+        // The normal stack is newest first, so insert each at the head of a
+        // temporary list to restore FIFO order.
+        //
+        QUIC_LIST_ENTRY* Entry =
+            (QUIC_LIST_ENTRY*)InterlockedExchangePointer(
+                (void* volatile*)&OperQ->Incoming, NULL);
+        QUIC_LIST_ENTRY Normal;
+        QuicListInitializeHead(&Normal);
+        while (Entry != NULL) {
+            QUIC_LIST_ENTRY* Next = Entry->Flink;
+            QuicListInsertHead(&Normal, Entry);
+            Entry = Next;
+        }
+        QuicListMoveItems(&Normal, &OperQ->List);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicOperationEnqueue(
+    _In_ QUIC_OPERATION_QUEUE* OperQ,
+    _In_ QUIC_OPERATION* Oper
+    )
+{
+    return QuicOperationQueuePush(OperQ, &OperQ->Incoming, Oper);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -149,15 +241,7 @@ QuicOperationEnqueueFront(
     _In_ QUIC_OPERATION* Oper
     )
 {
-    BOOLEAN StartProcessing;
-    QuicDispatchLockAcquire(&OperQ->Lock);
-#if DEBUG
-    QUIC_DBG_ASSERT(Oper->Link.Flink == NULL);
-#endif
-    StartProcessing = QuicListIsEmpty(&OperQ->List) && !OperQ->ActivelyProcessing;
-    QuicListInsertHead(&OperQ->List, &Oper->Link);
-    QuicDispatchLockRelease(&OperQ->Lock);
-    return StartProcessing;
+    return QuicOperationQueuePush(OperQ, &OperQ->IncomingPriority, Oper);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -166,21 +250,37 @@ QuicOperationDequeue(
     _In_ QUIC_OPERATION_QUEUE* OperQ
     )
 {
-    QUIC_OPERATION* Oper;
-    QuicDispatchLockAcquire(&OperQ->Lock);
-    if (QuicListIsEmpty(&OperQ->List)) {
-        OperQ->ActivelyProcessing = FALSE;
-        Oper = NULL;
-    } else {
-        OperQ->ActivelyProcessing = TRUE;
-        Oper =
-            QUIC_CONTAINING_RECORD(
-                QuicListRemoveHead(&OperQ->List), QUIC_OPERATION, Link);
+    if (OperQ->IncomingPriority != NULL || QuicListIsEmpty(&OperQ->List)) {
+        QuicOperationQueueCollect(OperQ);
+    }
+
+    while (QuicListIsEmpty(&OperQ->List)) {
+        //
+        // Looks empty, so go idle. A producer that pushed before the exchange
+        // either sees the queue still scheduled (and its operation is found
+        // below) or schedules it again itself.
+        //
+        (void)InterlockedExchange(&OperQ->Scheduled, 0);
+        if (OperQ->Incoming == NULL && OperQ->IncomingPriority == NULL) {
+            return NULL;
+        }
+        if (InterlockedCompareExchange(&OperQ->Scheduled, 1, 0) != 0) {
+            //
+            // A producer already scheduled the queue again, and will queue
+            // the connection to be drained.
+            //
+            return NULL;
+        }
+        QuicOperationQueueCollect(OperQ);
+    }
+
+    QUIC_OPERATION* Oper =
+        QUIC_CONTAINING_RECORD(
+            QuicListRemoveHead(&OperQ->List), QUIC_OPERATION, Link);
 #if DEBUG
-        Oper->Link.Flink = NULL;
+    Oper->Link.Flink = NULL;
 #endif
-    }
-    QuicDispatchLockRelease(&OperQ->Lock);
+    QuicPerfCounterDecrement(QUIC_PERF_COUNTER_CONN_OPER_QUEUE_DEPTH);
     return Oper;
 }
 
@@ -194,10 +294,9 @@ QuicOperationQueueClear(
     QUIC_LIST_ENTRY OldList;
     QuicListInitializeHead(&OldList);
 
-    QuicDispatchLockAcquire(&OperQ->Lock);
-    OperQ->ActivelyProcessing = FALSE;
+    (void)InterlockedExchange(&OperQ->Scheduled, 0);
+    QuicOperationQueueCollect(OperQ);
     QuicListMoveItems(&OperQ->List, &OldList);
-    QuicDispatchLockRelease(&OperQ->Lock);
 
     while (!QuicListIsEmpty(&OldList)) {
         QUIC_OPERATION* Oper =
@@ -205,6 +304,7 @@ QuicOperationQueueClear(
 #if DEBUG
         Oper->Link.Flink = NULL;
 #endif
+        QuicPerfCounterDecrement(QUIC_PERF_COUNTER_CONN_OPER_QUEUE_DEPTH);
         if (Oper->FreeAfterProcess) {
             if (Oper->Type == QUIC_OPER_TYPE_API_CALL) {
                 QUIC_API_CONTEXT* ApiCtx = Oper->API_CALL.Context;
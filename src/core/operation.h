@@ -10,6 +10,7 @@
 #endif
 
 typedef struct QUIC_SEND_REQUEST QUIC_SEND_REQUEST;
+typedef struct QUIC_CONN_RESOLVE_CONTEXT QUIC_CONN_RESOLVE_CONTEXT;
 
 //
 // For logging.
@@ -30,6 +31,8 @@ typedef enum QUIC_OPERATION_TYPE {
     QUIC_OPER_TYPE_TLS_COMPLETE,        // A TLS process call completed.
     QUIC_OPER_TYPE_TIMER_EXPIRED,       // A timer expired.
     QUIC_OPER_TYPE_TRACE_RUNDOWN,       // A trace rundown was triggered.
+    QUIC_OPER_TYPE_GENERATE_KEYS,       // Generate the next 1-RTT keys.
+    QUIC_OPER_TYPE_ADDR_RESOLVED,       // The server name was resolved.
 
     //
     // All stateless operations follow.
@@ -60,6 +63,10 @@ typedef enum QUIC_API_TYPE {
 
     QUIC_API_TYPE_DATAGRAM_SEND,
 
+    QUIC_API_TYPE_STRM_SEND_BATCH,
+
+    QUIC_API_TYPE_DATAGRAM_RECV_COMPLETE,
+
 } QUIC_API_TYPE;
 
 //
@@ -128,6 +135,10 @@ typedef struct QUIC_API_CONTEXT {
         struct {
             QUIC_STREAM* Stream;
         } STRM_SEND;
+        struct {
+            QUIC_STREAM** Streams;
+            uint32_t StreamCount;
+        } STRM_SEND_BATCH;
         struct {
             QUIC_STREAM* Stream;
             uint64_t BufferLength;
@@ -137,6 +148,10 @@ typedef struct QUIC_API_CONTEXT {
             BOOLEAN IsEnabled;
         } STRM_RECV_SET_ENABLED;
 
+        struct {
+            const QUIC_BUFFER* Buffer;
+        } DATAGRAM_RECV_COMPLETE;
+
         struct {
             HQUIC Handle;
             uint32_t Level;
@@ -162,7 +177,10 @@ typedef enum QUIC_CONN_TIMER_TYPE {
     QUIC_CONN_TIMER_LOSS_DETECTION,
     QUIC_CONN_TIMER_KEEP_ALIVE,
     QUIC_CONN_TIMER_IDLE,
+    QUIC_CONN_TIMER_HIBERNATE,
+    QUIC_CONN_TIMER_ADDR_FALLBACK,
     QUIC_CONN_TIMER_SHUTDOWN,
+    QUIC_CONN_TIMER_CORK,
 
     QUIC_CONN_TIMER_COUNT
 
@@ -211,7 +229,7 @@ typedef struct QUIC_OPERATION {
             QUIC_ADDR RemoteAddress;
         } UNREACHABLE;
         struct {
-            QUIC_STREAM* Stream;
+            QUIC_STREAM* Stream; // NULL for the connection's receive batch.
         } FLUSH_STREAM_RECEIVE;
         struct {
             void* Reserved; // Nothing.
@@ -219,6 +237,9 @@ typedef struct QUIC_OPERATION {
         struct {
             QUIC_CONN_TIMER_TYPE Type;
         } TIMER_EXPIRED;
+        struct {
+            QUIC_CONN_RESOLVE_CONTEXT* Context;
+        } ADDR_RESOLVED;
         struct {
             QUIC_STATELESS_CONTEXT* Context;
         } STATELESS; // Stateless reset, retry and VN
@@ -266,14 +287,22 @@ QuicOperLog(
 typedef struct QUIC_OPERATION_QUEUE {
 
     //
-    // TRUE if the queue is being drained.
+    // Nonzero from when an operation is queued to an idle queue, until the
+    // queue is found empty while being drained. Only the producer that sets
+    // it queues the connection on its worker.
+    //
+    long volatile Scheduled;
+
+    //
+    // Lock-free stacks of newly queued operations, linked through Link.Flink.
+    // Any thread may push, but only the draining thread takes them.
     //
-    BOOLEAN ActivelyProcessing;
+    QUIC_LIST_ENTRY* volatile Incoming;
+    QUIC_LIST_ENTRY* volatile IncomingPriority;
 
     //
-    // Queue of pending operations.
+    // Queue of pending operations, only accessed by the draining thread.
     //
-    QUIC_DISPATCH_LOCK Lock;
     QUIC_LIST_ENTRY List;
 
 } QUIC_OPERATION_QUEUE;
@@ -339,7 +368,8 @@ QuicOperationEnqueueFront(
     );
 
 //
-// Dequeues an operation. Returns NULL if the queue is empty.
+// Dequeues an operation. Returns NULL if the queue is empty. Only the thread
+// draining the queue may call this.
 //
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_OPERATION*
@@ -310,10 +310,16 @@ QuicPacketValidateLongHeaderV1(
     return TRUE;
 }
 
+//
+// Large enough for the pseudo packet of any Retry we generate ourselves.
+//
+#define QUIC_RETRY_PSEUDO_PACKET_STACK_LENGTH \
+    (sizeof(uint8_t) + QUIC_MAX_CONNECTION_ID_LENGTH_V1 + QuicPacketMaxBufferSizeForRetryV1())
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_STATUS
 QuicPacketGenerateRetryIntegrity(
-    _In_reads_(QUIC_VERSION_RETRY_INTEGRITY_SECRET_LENGTH)
-        const uint8_t* IntegritySecret,
+    _In_ const QUIC_VERSION_INFO* VersionInfo,
     _In_ uint8_t OrigDestCidLength,
     _In_reads_(OrigDestCidLength) const uint8_t* const OrigDestCid,
     _In_ uint16_t BufferLength,
@@ -323,37 +329,24 @@ QuicPacketGenerateRetryIntegrity(
         uint8_t* IntegrityField
     )
 {
-    QUIC_SECRET Secret;
-    Secret.Hash = QUIC_HASH_SHA256;
-    Secret.Aead = QUIC_AEAD_AES_128_GCM;
-    QuicCopyMemory(
-        Secret.Secret,
-        IntegritySecret,
-        QUIC_VERSION_RETRY_INTEGRITY_SECRET_LENGTH);
-
-    uint8_t* RetryPseudoPacket = NULL;
-    QUIC_PACKET_KEY* RetryIntegrityKey = NULL;
-    QUIC_STATUS Status =
-        QuicPacketKeyDerive(
-            QUIC_PACKET_KEY_INITIAL,
-            &Secret,
-            "RetryIntegrity",
-            FALSE,
-            &RetryIntegrityKey);
-    if (QUIC_FAILED(Status)) {
-        goto Exit;
-    }
+    const uint32_t VersionIndex = (uint32_t)(VersionInfo - QuicSupportedVersionList);
+    QUIC_DBG_ASSERT(VersionIndex < ARRAYSIZE(QuicSupportedVersionList));
+
+    uint8_t RetryPseudoPacketStack[QUIC_RETRY_PSEUDO_PACKET_STACK_LENGTH];
+    uint8_t* RetryPseudoPacket = RetryPseudoPacketStack;
+    QUIC_STATUS Status;
 
     uint16_t RetryPseudoPacketLength = sizeof(uint8_t) + OrigDestCidLength + BufferLength;
-    RetryPseudoPacket = (uint8_t*)QUIC_ALLOC_PAGED(RetryPseudoPacketLength);
-    if (RetryPseudoPacket == NULL) {
-        QuicTraceEvent(
-            AllocFailure,
-            "Allocation of '%s' failed. (%llu bytes)",
-            "RetryPseudoPacket",
-            RetryPseudoPacketLength);
-        Status = QUIC_STATUS_OUT_OF_MEMORY;
-        goto Exit;
+    if (RetryPseudoPacketLength > sizeof(RetryPseudoPacketStack)) {
+        RetryPseudoPacket = (uint8_t*)QUIC_ALLOC_PAGED(RetryPseudoPacketLength);
+        if (RetryPseudoPacket == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "RetryPseudoPacket",
+                RetryPseudoPacketLength);
+            return QUIC_STATUS_OUT_OF_MEMORY;
+        }
     }
     uint8_t* RetryPseudoPacketCursor = RetryPseudoPacket;
 
@@ -364,6 +357,41 @@ QuicPacketGenerateRetryIntegrity(
     QuicCopyMemory(RetryPseudoPacketCursor, Buffer, BufferLength);
     RetryPseudoPacketCursor += BufferLength;
 
+    //
+    // The integrity key only depends on the version, so it's derived the first
+    // time it's needed and reused for every Retry after that. The key is used
+    // under the partition's lock, as the AEAD context isn't safe for concurrent
+    // use.
+    //
+    QUIC_LIBRARY_PP* PerProc =
+        &MsQuicLib.PerProc[QuicLibraryGetCurrentPartition()];
+    QuicDispatchLockAcquire(&PerProc->RetryIntegrityKeysLock);
+
+    QUIC_PACKET_KEY* RetryIntegrityKey = PerProc->RetryIntegrityKeys[VersionIndex];
+    if (RetryIntegrityKey == NULL) {
+        QUIC_SECRET Secret;
+        Secret.Hash = QUIC_HASH_SHA256;
+        Secret.Aead = QUIC_AEAD_AES_128_GCM;
+        QuicCopyMemory(
+            Secret.Secret,
+            VersionInfo->RetryIntegritySecret,
+            QUIC_VERSION_RETRY_INTEGRITY_SECRET_LENGTH);
+
+        Status =
+            QuicPacketKeyDerive(
+                QUIC_PACKET_KEY_INITIAL,
+                &Secret,
+                "RetryIntegrity",
+                FALSE,
+                &RetryIntegrityKey);
+        QuicSecureZeroMemory(&Secret, sizeof(Secret));
+        if (QUIC_FAILED(Status)) {
+            QuicDispatchLockRelease(&PerProc->RetryIntegrityKeysLock);
+            goto Exit;
+        }
+        PerProc->RetryIntegrityKeys[VersionIndex] = RetryIntegrityKey;
+    }
+
     Status =
         QuicEncrypt(
             RetryIntegrityKey->PacketKey,
@@ -373,11 +401,12 @@ QuicPacketGenerateRetryIntegrity(
             QUIC_RETRY_INTEGRITY_TAG_LENGTH_V1,
             IntegrityField);
 
+    QuicDispatchLockRelease(&PerProc->RetryIntegrityKeysLock);
+
 Exit:
-    if (RetryPseudoPacket != NULL) {
+    if (RetryPseudoPacket != RetryPseudoPacketStack) {
         QUIC_FREE(RetryPseudoPacket);
     }
-    QuicPacketKeyFree(RetryIntegrityKey);
     return Status;
 }
 
@@ -449,7 +478,7 @@ QuicPacketEncodeRetryV1(
 
     if (QUIC_FAILED(
         QuicPacketGenerateRetryIntegrity(
-            VersionInfo->RetryIntegritySecret,
+            VersionInfo,
             OrigDestCidLength,
             OrigDestCid,
             RequiredBufferLength - QUIC_RETRY_INTEGRITY_TAG_LENGTH_V1,
@@ -561,6 +590,10 @@ QuicPacketLogHeader(
     _In_ uint32_t Version             // Network Byte Order. Used for Short Headers
     )
 {
+    if (!QuicTraceLogVerboseEnabled()) {
+        return;
+    }
+
     const QUIC_HEADER_INVARIANT* Invariant = (QUIC_HEADER_INVARIANT*)Packet;
     uint16_t Offset;
 
@@ -730,6 +763,7 @@ QuicPacketLogDrop(
 
     if (Packet->AssignedToConnection) {
         InterlockedIncrement64((int64_t*) &((QUIC_CONNECTION*)Owner)->Stats.Recv.DroppedPackets);
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_PKTS_DROPPED_CONN);
         QuicTraceEvent(
             ConnDropPacket,
             "[conn][%p] DROP packet[%llu] Dst=%!SOCKADDR! Src=%!SOCKADDR! Reason=%s.",
@@ -742,6 +776,7 @@ QuicPacketLogDrop(
             Reason);
     } else {
         InterlockedIncrement64((int64_t*) &((QUIC_BINDING*)Owner)->Stats.Recv.DroppedPackets);
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_PKTS_DROPPED_BINDING);
         QuicTraceEvent(
             BindingDropPacket,
             "[bind][%p] DROP packet[%llu] Dst=%!SOCKADDR! Src=%!SOCKADDR! Reason=%s.",
@@ -769,6 +804,7 @@ QuicPacketLogDropWithValue(
 
     if (Packet->AssignedToConnection) {
         InterlockedIncrement64((int64_t*) & ((QUIC_CONNECTION*)Owner)->Stats.Recv.DroppedPackets);
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_PKTS_DROPPED_CONN);
         QuicTraceEvent(
             ConnDropPacketEx,
             "[conn][%p] DROP packet[%llu] Value=%llu Dst=%!SOCKADDR! Src=%!SOCKADDR! Reason=%s.",
@@ -782,6 +818,7 @@ QuicPacketLogDropWithValue(
             Reason);
     } else {
         InterlockedIncrement64((int64_t*) &((QUIC_BINDING*)Owner)->Stats.Recv.DroppedPackets);
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_PKTS_DROPPED_BINDING);
         QuicTraceEvent(
             BindingDropPacketEx,
             "[bind][%p] DROP packet[%llu] %llu. Dst=%!SOCKADDR! Src=%!SOCKADDR! Reason=%s",
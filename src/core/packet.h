@@ -30,7 +30,7 @@ typedef struct QUIC_VERSION_INFO {
 //
 // The list of supported QUIC versions.
 //
-extern const QUIC_VERSION_INFO QuicSupportedVersionList[4];
+extern const QUIC_VERSION_INFO QuicSupportedVersionList[QUIC_SUPPORTED_VERSION_COUNT];
 
 //
 // Prefixes used in packet logging.
@@ -456,11 +456,14 @@ QuicPacketEncodeLongHeaderV1(
     3 * QUIC_MAX_CONNECTION_ID_LENGTH_V1 + \
     sizeof(QUIC_RETRY_TOKEN_CONTENTS)
 
+//
+// Computes the Retry integrity tag with the version's integrity key, which is
+// derived once per partition and cached until the library is cleaned up.
+//
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_STATUS
 QuicPacketGenerateRetryIntegrity(
-    _In_reads_(QUIC_VERSION_RETRY_INTEGRITY_SECRET_LENGTH)
-        const uint8_t* IntegritySecret,
+    _In_ const QUIC_VERSION_INFO* VersionInfo,
     _In_ uint8_t OrigDestCidLength,
     _In_reads_(OrigDestCidLength) const uint8_t* const OrigDestCid,
     _In_ uint16_t BufferLength,
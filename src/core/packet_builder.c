@@ -33,6 +33,102 @@ QuicPacketBuilderSendBatch(
     _Inout_ QUIC_PACKET_BUILDER* Builder
     );
 
+//
+// Encodes a short header for the builder's path, from the path's cached
+// header template when it's still current. Most short header packets on a
+// path only differ by packet number, so this skips rebuilding the first byte
+// and copying the CID field by field (most notably for ACK-only packets).
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Success_(return != 0)
+uint16_t
+QuicPacketBuilderEncodeShortHeader(
+    _Inout_ QUIC_PACKET_BUILDER* Builder,
+    _In_ BOOLEAN KeyPhase,
+    _In_ uint16_t BufferLength,
+    _Out_writes_bytes_(BufferLength)
+        uint8_t* Buffer
+    )
+{
+    QUIC_PATH* Path = Builder->Path;
+    const QUIC_CID_QUIC_LIST_ENTRY* DestCid = Path->DestCid;
+
+    if (Path->HeaderTemplateLength == 0 ||
+        Path->HeaderTemplateCid != DestCid ||
+        Path->HeaderTemplateCidSequence != DestCid->CID.SequenceNumber ||
+        ((QUIC_SHORT_HEADER_V1*)Path->HeaderTemplate)->SpinBit != Path->SpinBit ||
+        ((QUIC_SHORT_HEADER_V1*)Path->HeaderTemplate)->KeyPhase != KeyPhase ||
+        ((QUIC_SHORT_HEADER_V1*)Path->HeaderTemplate)->PnLength != Builder->PacketNumberLength - 1) {
+
+        uint16_t HeaderLength =
+            QuicPacketEncodeShortHeaderV1(
+                &DestCid->CID,
+                Builder->Metadata->PacketNumber,
+                Builder->PacketNumberLength,
+                Path->SpinBit,
+                KeyPhase,
+                BufferLength,
+                Buffer);
+        if (HeaderLength != 0) {
+            Path->HeaderTemplateCid = DestCid;
+            Path->HeaderTemplateCidSequence = DestCid->CID.SequenceNumber;
+            Path->HeaderTemplateLength = 1 + DestCid->CID.Length;
+            QuicCopyMemory(
+                Path->HeaderTemplate, Buffer, Path->HeaderTemplateLength);
+        }
+        return HeaderLength;
+    }
+
+    uint16_t HeaderLength =
+        Path->HeaderTemplateLength + Builder->PacketNumberLength;
+    if (BufferLength < HeaderLength) {
+        return 0;
+    }
+
+    QuicCopyMemory(Buffer, Path->HeaderTemplate, Path->HeaderTemplateLength);
+    QuicPktNumEncode(
+        Builder->Metadata->PacketNumber,
+        Builder->PacketNumberLength,
+        Buffer + Path->HeaderTemplateLength);
+
+    return HeaderLength;
+}
+
+//
+// Sizes the datagram batch of a flush. Building more datagrams than the send
+// allowance (which already accounts for pacing) can fill only delays the other
+// connections on the worker, so the batch follows the allowance, with some
+// room left for the frames that bypass congestion control. An overloaded
+// worker gets smaller batches, to share the thread more evenly.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint8_t
+QuicPacketBuilderGetMaxDatagrams(
+    _In_ const QUIC_PACKET_BUILDER* Builder
+    )
+{
+    QUIC_CONNECTION* Connection = Builder->Connection;
+
+    uint32_t MinCount =
+        (QuicDataPathGetSupportedFeatures(MsQuicLib.Datapath) &
+            QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION) ?
+            QUIC_MIN_SEGMENTED_DATAGRAMS_PER_SEND :
+            QUIC_MIN_DATAGRAMS_PER_SEND;
+
+    uint32_t Count =
+        Builder->SendAllowance / Builder->Path->Mtu + QUIC_MIN_DATAGRAMS_PER_SEND;
+    if (Connection->Worker != NULL && QuicWorkerIsOverloaded(Connection->Worker)) {
+        Count /= 2;
+    }
+
+    if (Count < MinCount) {
+        Count = MinCount;
+    } else if (Count > QUIC_MAX_DATAGRAMS_PER_SEND) {
+        Count = QUIC_MAX_DATAGRAMS_PER_SEND;
+    }
+    return (uint8_t)Count;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 _Success_(return != FALSE)
 BOOLEAN
@@ -48,6 +144,10 @@ QuicPacketBuilderInitialize(
     Builder->PacketBatchSent = FALSE;
     Builder->PacketBatchRetransmittable = FALSE;
     Builder->Metadata = &Builder->MetadataStorage.Metadata;
+    Builder->CryptoOffload =
+        Connection->CryptoOffloadBinding != NULL &&
+        Connection->CryptoOffloadBinding == Path->Binding &&
+        QuicAddrCompare(&Connection->CryptoOffloadRemoteAddress, &Path->RemoteAddress);
     Builder->EncryptionOverhead =
         Connection->State.EncryptionEnabled ?
             QUIC_ENCRYPTION_OVERHEAD : 0;
@@ -74,14 +174,44 @@ QuicPacketBuilderInitialize(
     } else {
         TimeSinceLastSend = 0;
     }
-    Builder->SendAllowance =
-        QuicCongestionControlGetSendAllowance(
-            &Connection->CongestionControl,
-            TimeSinceLastSend,
-            Connection->Send.LastFlushTimeValid);
+
+    if (Connection->Send.PacingOffload) {
+        Builder->TxPacingRate =
+            QuicCongestionControlGetPacingRate(&Connection->CongestionControl);
+    }
+
+    if (Builder->TxPacingRate != 0) {
+        //
+        // The datapath spaces the datagrams out, so everything the window
+        // allows can be built now, up to what the pacing rate allows before
+        // the horizon.
+        //
+        if (Connection->Send.NextTxTime < TimeNow) {
+            Connection->Send.NextTxTime = TimeNow;
+        }
+        uint64_t Horizon = TimeNow + QUIC_SEND_PACING_OFFLOAD_HORIZON;
+        uint64_t PacedAllowance =
+            Connection->Send.NextTxTime >= Horizon ?
+                0 :
+                (Horizon - Connection->Send.NextTxTime) *
+                    Builder->TxPacingRate / MS_TO_US(1000);
+        Builder->SendAllowance =
+            QuicCongestionControlGetSendAllowance(
+                &Connection->CongestionControl, 0, FALSE);
+        if (PacedAllowance < Builder->SendAllowance) {
+            Builder->SendAllowance = (uint32_t)PacedAllowance;
+        }
+    } else {
+        Builder->SendAllowance =
+            QuicCongestionControlGetSendAllowance(
+                &Connection->CongestionControl,
+                TimeSinceLastSend,
+                Connection->Send.LastFlushTimeValid);
+    }
     if (Builder->SendAllowance > Path->Allowance) {
         Builder->SendAllowance = Path->Allowance;
     }
+    Builder->MaxCountDatagrams = QuicPacketBuilderGetMaxDatagrams(Builder);
     Connection->Send.LastFlushTime = TimeNow;
     Connection->Send.LastFlushTimeValid = TRUE;
 
@@ -96,6 +226,17 @@ QuicPacketBuilderCleanup(
 {
     QUIC_DBG_ASSERT(Builder->SendContext == NULL);
 
+    if (Builder->TotalCountDatagrams != 0) {
+        QuicPerfCounterAdd(
+            QUIC_PERF_COUNTER_UDP_SEND, Builder->TotalCountDatagrams);
+        QuicPerfCounterAdd(
+            QUIC_PERF_COUNTER_UDP_SEND_BYTES, Builder->TotalDatagramsLength);
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_UDP_SEND_BATCHES);
+        QuicHistogramAddSample(
+            Builder->Connection->Histograms.SendBatchSize,
+            Builder->TotalCountDatagrams);
+    }
+
     if (Builder->PacketBatchSent && Builder->PacketBatchRetransmittable) {
         QuicLossDetectionUpdateTimer(&Builder->Connection->LossDetection);
     }
@@ -164,7 +305,7 @@ QuicPacketBuilderPrepare(
             QuicPacketBuilderFinalize(Builder, IsPathMtuDiscovery);
         }
         if (Builder->SendContext == NULL &&
-            Builder->TotalCountDatagrams >= QUIC_MAX_DATAGRAMS_PER_SEND) {
+            Builder->TotalCountDatagrams >= Builder->MaxCountDatagrams) {
             goto Error;
         }
         NewQuicPacket = TRUE;
@@ -183,9 +324,12 @@ QuicPacketBuilderPrepare(
         //
 
         if (Builder->SendContext == NULL) {
+            QUIC_ECN_TYPE EcnType = QuicPathGetEcnType(Connection, Builder->Path);
+            Builder->EcnEctSet = EcnType != QUIC_ECN_NON_ECT;
             Builder->SendContext =
                 QuicDataPathBindingAllocSendContext(
                     Builder->Path->Binding->DatapathBinding,
+                    EcnType,
                     IsPathMtuDiscovery ?
                         0 :
                         MaxUdpPayloadSizeForFamily(
@@ -199,12 +343,27 @@ QuicPacketBuilderPrepare(
                     0);
                 goto Error;
             }
+            if (Builder->TxPacingRate != 0) {
+                QuicDataPathBindingSetSendTxTime(
+                    Builder->SendContext, Connection->Send.NextTxTime);
+            }
+
+        } else if (
+            Builder->TxPacingRate != 0 &&
+            Builder->TotalCountDatagrams % QUIC_SEND_PACING_MIN_CHUNK == 0) {
+            //
+            // Each pacing chunk leaves at the time the previous ones take to
+            // drain at the pacing rate.
+            //
+            QuicDataPathBindingSetSendTxTime(
+                Builder->SendContext, Connection->Send.NextTxTime);
         }
 
         uint16_t NewDatagramLength =
             MaxUdpPayloadSizeForFamily(
                 QuicAddrGetFamily(&Builder->Path->RemoteAddress),
-                IsPathMtuDiscovery ? QUIC_MAX_MTU : DatagramSize);
+                IsPathMtuDiscovery ?
+                    Builder->Path->MtuDiscovery.ProbeSize : DatagramSize);
         if ((Connection->PeerTransportParams.Flags & QUIC_TP_FLAG_MAX_UDP_PAYLOAD_SIZE) &&
             NewDatagramLength > Connection->PeerTransportParams.MaxUdpPayloadSize) {
             NewDatagramLength = (uint16_t)Connection->PeerTransportParams.MaxUdpPayloadSize;
@@ -284,6 +443,7 @@ QuicPacketBuilderPrepare(
         Builder->Metadata->Flags.IsAckEliciting = FALSE;
         Builder->Metadata->Flags.IsPMTUD = IsPathMtuDiscovery;
         Builder->Metadata->Flags.SuspectedLost = FALSE;
+        Builder->Metadata->Flags.EcnEctSet = Builder->EcnEctSet;
 #if DEBUG
         Builder->Metadata->Flags.Freed = FALSE;
 #endif
@@ -307,11 +467,8 @@ QuicPacketBuilderPrepare(
             case QUIC_VERSION_DRAFT_29:
             case QUIC_VERSION_MS_1:
                 Builder->HeaderLength =
-                    QuicPacketEncodeShortHeaderV1(
-                        &Builder->Path->DestCid->CID,
-                        Builder->Metadata->PacketNumber,
-                        Builder->PacketNumberLength,
-                        Builder->Path->SpinBit,
+                    QuicPacketBuilderEncodeShortHeader(
+                        Builder,
                         PacketSpace->CurrentKeyPhase,
                         BufferSpaceAvailable,
                         Header);
@@ -560,6 +717,52 @@ QuicPacketBuilderFinalizeHeaderProtection(
     Builder->BatchCount = 0;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicPacketBuilderCopyPayload(
+    _Inout_ QUIC_PACKET_BUILDER* Builder,
+    _Out_writes_bytes_(Length) uint8_t* Dest,
+    _In_reads_bytes_(Length) const uint8_t* Source,
+    _In_ uint16_t Length
+    )
+{
+    if (Builder->Connection->State.EncryptionEnabled &&
+        Builder->EncryptCopyCount < QUIC_MAX_ENCRYPT_COPY_COUNT) {
+        QUIC_DBG_ASSERT(Dest >= Builder->Datagram->Buffer);
+        Builder->EncryptCopies[Builder->EncryptCopyCount].Source = Source;
+        Builder->EncryptCopies[Builder->EncryptCopyCount].Offset =
+            (uint16_t)(Dest - Builder->Datagram->Buffer);
+        Builder->EncryptCopies[Builder->EncryptCopyCount].Length = Length;
+        Builder->EncryptCopyCount++;
+        //
+        // The source is only read once the packet is encrypted, so its first
+        // bytes can be loaded in the meantime.
+        //
+        QuicPrefetch(Source);
+    } else {
+        QuicCopyMemory(Dest, Source, Length);
+    }
+}
+
+//
+// Performs any copies that were deferred to encryption, for when the plain
+// text is needed in place after all.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicPacketBuilderCompleteEncryptCopies(
+    _Inout_ QUIC_PACKET_BUILDER* Builder
+    )
+{
+    for (uint8_t i = 0; i < Builder->EncryptCopyCount; ++i) {
+        QuicCopyMemory(
+            (uint8_t*)Builder->Datagram->Buffer + Builder->EncryptCopies[i].Offset,
+            Builder->EncryptCopies[i].Source,
+            Builder->EncryptCopies[i].Length);
+    }
+    Builder->EncryptCopyCount = 0;
+}
+
 //
 // This function completes the current QUIC packet. It updates the header if
 // necessary and encrypts the payload. If there isn't enough space for another
@@ -568,6 +771,63 @@ QuicPacketBuilderFinalizeHeaderProtection(
 // in the current send batch, then the send context is also completed and sent
 // off.
 //
+//
+// The crypto data of a flight is written in order, filling each datagram
+// before starting the next, so the flight already takes as few datagrams as
+// its data needs. The one exception is the switch from the Initial packet to
+// the Handshake one: a new packet isn't started with less than
+// QUIC_MIN_PACKET_SPARE_SPACE left in the datagram. If that's all the rest of
+// the flight needs, its short tail would go in a datagram of its own. So the
+// exact length of that last Handshake packet is worked out here instead.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicPacketBuilderFlightFitsInDatagram(
+    _In_ const QUIC_PACKET_BUILDER* Builder
+    )
+{
+    const QUIC_CONNECTION* Connection = Builder->Connection;
+    const QUIC_CRYPTO* Crypto = &Connection->Crypto;
+
+    if (Builder->Datagram == NULL ||
+        Builder->PacketType != QUIC_INITIAL ||
+        Connection->Send.SendFlags != QUIC_CONN_SEND_FLAG_CRYPTO ||
+        Crypto->TlsState.WriteKeys[QUIC_PACKET_KEY_HANDSHAKE] == NULL ||
+        RECOV_WINDOW_OPEN(Crypto)) {
+        return FALSE;
+    }
+
+    //
+    // All the Initial data must have been sent, and the rest must all be
+    // Handshake data.
+    //
+    uint32_t HandshakeStart = Crypto->TlsState.BufferOffsetHandshake;
+    uint32_t Left = Crypto->NextSendOffset;
+    uint32_t Right = Crypto->TlsState.BufferTotalLength;
+    if (HandshakeStart == 0 || Left < HandshakeStart || Left == Right ||
+        (Crypto->TlsState.BufferOffset1Rtt != 0 &&
+         Right > Crypto->TlsState.BufferOffset1Rtt)) {
+        return FALSE;
+    }
+
+    uint32_t PacketLength =
+        sizeof(QUIC_LONG_HEADER_V1) +
+        Builder->Path->DestCid->CID.Length +
+        sizeof(uint8_t) +
+        Builder->SourceCid->CID.Length +
+        sizeof(uint16_t) +  // Payload length
+        sizeof(uint32_t) +  // Packet number
+        sizeof(uint8_t) +   // CRYPTO frame type
+        QuicVarIntSize(Left - HandshakeStart) +
+        QuicVarIntSize(Right - Left) +
+        (Right - Left) +
+        QUIC_ENCRYPTION_OVERHEAD;
+
+    return
+        Builder->DatagramLength + Builder->EncryptionOverhead + PacketLength <=
+        Builder->Datagram->Length;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicPacketBuilderFinalize(
@@ -623,7 +883,8 @@ QuicPacketBuilderFinalize(
 
     if (FlushBatchedDatagrams ||
         Builder->PacketType == SEND_PACKET_SHORT_HEADER_TYPE ||
-        (uint16_t)Builder->Datagram->Length - ExpectedFinalDatagramLength < QUIC_MIN_PACKET_SPARE_SPACE) {
+        ((uint16_t)Builder->Datagram->Length - ExpectedFinalDatagramLength < QUIC_MIN_PACKET_SPARE_SPACE &&
+         !QuicPacketBuilderFlightFitsInDatagram(Builder))) {
 
         FinalQuicPacket = TRUE;
 
@@ -674,11 +935,39 @@ QuicPacketBuilderFinalize(
         }
     }
 
+    BOOLEAN CryptoOffloaded =
+        Builder->CryptoOffload &&
+        Builder->PacketType == SEND_PACKET_SHORT_HEADER_TYPE;
+
+    if (Builder->EncryptCopyCount != 0) {
+#ifdef QUIC_FUZZER
+        QuicPacketBuilderCompleteEncryptCopies(Builder);
+#else
+        if (!Connection->State.EncryptionEnabled ||
+            CryptoOffloaded ||
+            (Connection->State.IntegrityOnly &&
+             Builder->PacketType == SEND_PACKET_SHORT_HEADER_TYPE) ||
+            (QuicTraceLogVerboseEnabled() && Connection->TraceSampled)) {
+            //
+            // The plain text is needed in place.
+            //
+            QuicPacketBuilderCompleteEncryptCopies(Builder);
+        }
+#endif
+    }
+
 #ifdef QUIC_FUZZER
     QuicFuzzInjectHook(Builder);
 #endif
 
-    if (QuicTraceLogVerboseEnabled()) {
+    QuicTraceProbe(
+        packet_send,
+        Connection,
+        Builder->Metadata->PacketNumber,
+        Builder->HeaderLength + PayloadLength,
+        Builder->EncryptLevel);
+
+    if (QuicTraceLogVerboseEnabled() && Connection->TraceSampled) {
         QuicPacketLogHeader(
             Connection,
             FALSE,
@@ -711,20 +1000,94 @@ QuicPacketBuilderFinalize(
         QuicCryptoCombineIvAndPacketNumber(Builder->Key->Iv, (uint8_t*) &Builder->Metadata->PacketNumber, Iv);
 
         QUIC_STATUS Status;
-        if (QUIC_FAILED(
-            Status =
-            QuicEncrypt(
-                Builder->Key->PacketKey,
-                Iv,
+        if (CryptoOffloaded) {
+            //
+            // The NIC encrypts and header protects the packet on its way out;
+            // the room for the tag is all that's needed here.
+            //
+            QUIC_DBG_ASSERT(Builder->EncryptCopyCount == 0);
+            QuicDataPathBindingSetCryptoOffloadPacket(
+                Builder->SendContext,
+                Builder->Datagram,
+                Builder->PacketStart,
+                Builder->HeaderLength + PayloadLength,
                 Builder->HeaderLength,
-                Header,
-                PayloadLength,
-                Payload))) {
+                Builder->Metadata->PacketNumber);
+            Status = QUIC_STATUS_SUCCESS;
+        } else if (Connection->State.IntegrityOnly &&
+            Builder->PacketType == SEND_PACKET_SHORT_HEADER_TYPE) {
+            //
+            // Only authenticate the packet: the header and plain text payload
+            // together are the associated data, and only the tag is written.
+            //
+            QUIC_DBG_ASSERT(Builder->EncryptCopyCount == 0);
+            uint16_t PlainTextLength = PayloadLength - Builder->EncryptionOverhead;
+            Status =
+                QuicEncrypt(
+                    Builder->Key->PacketKey,
+                    Iv,
+                    Builder->HeaderLength + PlainTextLength,
+                    Header,
+                    Builder->EncryptionOverhead,
+                    Payload + PlainTextLength);
+        } else if (Builder->EncryptCopyCount != 0) {
+            //
+            // Some of the payload is still in the app's buffers. Describe the
+            // plain text as a list of segments, alternating between what was
+            // framed in place and what still needs to be copied, and let the
+            // encryption read it from there.
+            //
+            QUIC_BUFFER Segments[2 * QUIC_MAX_ENCRYPT_COPY_COUNT + 1];
+            uint32_t SegmentCount = 0;
+            uint8_t* Cursor = Payload;
+            for (uint8_t i = 0; i < Builder->EncryptCopyCount; ++i) {
+                uint8_t* Dest =
+                    (uint8_t*)Builder->Datagram->Buffer + Builder->EncryptCopies[i].Offset;
+                QUIC_DBG_ASSERT(Dest >= Cursor);
+                if (Dest != Cursor) {
+                    Segments[SegmentCount].Buffer = Cursor;
+                    Segments[SegmentCount].Length = (uint32_t)(Dest - Cursor);
+                    SegmentCount++;
+                }
+                Segments[SegmentCount].Buffer = (uint8_t*)Builder->EncryptCopies[i].Source;
+                Segments[SegmentCount].Length = Builder->EncryptCopies[i].Length;
+                SegmentCount++;
+                Cursor = Dest + Builder->EncryptCopies[i].Length;
+            }
+            uint8_t* PlainTextEnd = Payload + PayloadLength - Builder->EncryptionOverhead;
+            if (Cursor != PlainTextEnd) {
+                Segments[SegmentCount].Buffer = Cursor;
+                Segments[SegmentCount].Length = (uint32_t)(PlainTextEnd - Cursor);
+                SegmentCount++;
+            }
+            Builder->EncryptCopyCount = 0;
+
+            Status =
+                QuicEncryptWithCopy(
+                    Builder->Key->PacketKey,
+                    Iv,
+                    Builder->HeaderLength,
+                    Header,
+                    SegmentCount,
+                    Segments,
+                    PayloadLength,
+                    Payload);
+        } else {
+            Status =
+                QuicEncrypt(
+                    Builder->Key->PacketKey,
+                    Iv,
+                    Builder->HeaderLength,
+                    Header,
+                    PayloadLength,
+                    Payload);
+        }
+        if (QUIC_FAILED(Status)) {
             QuicConnFatalError(Connection, Status, "Encryption failure");
             goto Exit;
         }
 
-        if (Connection->State.HeaderProtectionEnabled) {
+        if (Connection->State.HeaderProtectionEnabled && !CryptoOffloaded) {
 
             uint8_t* PnStart = Payload - Builder->PacketNumberLength;
 
@@ -820,13 +1183,15 @@ QuicPacketBuilderFinalize(
     Builder->Metadata->PacketLength =
         Builder->HeaderLength + PayloadLength;
 
-    QuicTraceEvent(
-        ConnPacketSent,
-        "[conn][%p][TX][%llu] %hhu (%hu bytes)",
-        Connection,
-        Builder->Metadata->PacketNumber,
-        QuicPacketTraceType(Builder->Metadata),
-        Builder->Metadata->PacketLength);
+    if (Connection->TraceSampled) {
+        QuicTraceEvent(
+            ConnPacketSent,
+            "[conn][%p][TX][%llu] %hhu (%hu bytes)",
+            Connection,
+            Builder->Metadata->PacketNumber,
+            QuicPacketTraceType(Builder->Metadata),
+            Builder->Metadata->PacketLength);
+    }
     if (QUIC_FAILED(
         QuicLossDetectionOnPacketSent(
             &Connection->LossDetection,
@@ -850,8 +1215,16 @@ QuicPacketBuilderFinalize(
         }
     }
 
+    if (Builder->TxPacingRate != 0) {
+        Connection->Send.NextTxTime +=
+            (uint64_t)Builder->Metadata->PacketLength * MS_TO_US(1000) /
+            Builder->TxPacingRate;
+    }
+
 Exit:
 
+    Builder->EncryptCopyCount = 0;
+
     //
     // Send the packet out if necessary.
     //
@@ -861,6 +1234,7 @@ Exit:
             Builder->Datagram->Length = Builder->DatagramLength;
             Builder->Datagram = NULL;
             ++Builder->TotalCountDatagrams;
+            Builder->TotalDatagramsLength += Builder->DatagramLength;
         }
 
         if (FlushBatchedDatagrams || QuicDataPathBindingIsSendContextFull(Builder->SendContext)) {
@@ -893,7 +1267,21 @@ QuicPacketBuilderSendBatch(
         "Sending batch. %hu datagrams",
         (uint16_t)Builder->TotalCountDatagrams);
 
-    if (QuicAddrIsBoundExplicitly(&Builder->Path->LocalAddress)) {
+    if ((!Builder->PacketBatchRetransmittable ||
+            Builder->TotalCountDatagrams == 1) &&
+        QuicWorkerQueueSend(
+            Builder->Connection->Worker,
+            Builder->Path->Binding,
+            QuicAddrIsBoundExplicitly(&Builder->Path->LocalAddress) ?
+                NULL : &Builder->Path->LocalAddress,
+            &Builder->Path->RemoteAddress,
+            Builder->SendContext)) {
+        //
+        // ACK only and single datagram (e.g. keep alive) sends are sent with
+        // the worker's batch.
+        //
+
+    } else if (QuicAddrIsBoundExplicitly(&Builder->Path->LocalAddress)) {
         QuicBindingSendTo(
             Builder->Path->Binding,
             &Builder->Path->RemoteAddress,
@@ -57,6 +57,16 @@ typedef struct QUIC_PACKET_BUILDER {
     //
     uint8_t* HeaderBatch[QUIC_MAX_CRYPTO_BATCH_COUNT];
 
+    //
+    // Stream payload in the current QUIC packet that hasn't been copied from
+    // the app's buffers yet. The copy happens as part of encryption.
+    //
+    struct {
+        const uint8_t* Source;
+        uint16_t Offset;    // Offset in Datagram.
+        uint16_t Length;
+    } EncryptCopies[QUIC_MAX_ENCRYPT_COPY_COUNT];
+
     //
     // Indicates a batch of packets has been sent.
     //
@@ -73,11 +83,33 @@ typedef struct QUIC_PACKET_BUILDER {
     //
     uint8_t BatchCount : 4;
 
+    //
+    // Indicates the datagrams of the current send context are marked with
+    // ECT(0).
+    //
+    uint8_t EcnEctSet : 1;
+
+    //
+    // Indicates the NIC protects the short header packets sent on the path,
+    // so they are left in plain text.
+    //
+    uint8_t CryptoOffload : 1;
+
+    //
+    // The number of valid entries in EncryptCopies.
+    //
+    uint8_t EncryptCopyCount;
+
     //
     // The total number of datagrams that have been created.
     //
     uint8_t TotalCountDatagrams;
 
+    //
+    // The maximum number of datagrams to create for this flush.
+    //
+    uint8_t MaxCountDatagrams;
+
     //
     // The size of the encryption AEAD tag at the end of the current QUIC
     // packet.
@@ -131,6 +163,17 @@ typedef struct QUIC_PACKET_BUILDER {
     //
     uint32_t SendAllowance;
 
+    //
+    // The pacing rate (in bytes per second) used to compute the departure
+    // time of the datagrams, or zero if they are sent immediately.
+    //
+    uint64_t TxPacingRate;
+
+    //
+    // The total length of all the datagrams that have been created.
+    //
+    uint32_t TotalDatagramsLength;
+
     //
     // Represents the metadata of the current QUIC packet.
     //
@@ -164,6 +207,21 @@ QuicPacketBuilderCleanup(
     _Inout_ QUIC_PACKET_BUILDER* Builder
     );
 
+//
+// Copies app payload into the current QUIC packet. When possible, the copy is
+// deferred and done as part of encrypting the packet, so the payload is only
+// passed over once. The source memory must stay valid until the packet is
+// finalized.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicPacketBuilderCopyPayload(
+    _Inout_ QUIC_PACKET_BUILDER* Builder,
+    _Out_writes_bytes_(Length) uint8_t* Dest,
+    _In_reads_bytes_(Length) const uint8_t* Source,
+    _In_ uint16_t Length
+    );
+
 //
 // Prepares the packet builder for framing control payload.
 //
@@ -197,6 +255,16 @@ QuicPacketBuilderPrepareForStreamFrames(
     _In_ BOOLEAN IsTailLossProbe
     );
 
+//
+// Returns TRUE if the rest of the handshake flight goes in the current
+// datagram, even though it has less than QUIC_MIN_PACKET_SPARE_SPACE left.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicPacketBuilderFlightFitsInDatagram(
+    _In_ const QUIC_PACKET_BUILDER* Builder
+    );
+
 //
 // Finishes up the current packet so it can be sent.
 //
@@ -219,7 +287,7 @@ QuicPacketBuilderHasAllowance(
 {
     return
         Builder->SendAllowance > 0 ||
-        Builder->Connection->CongestionControl.Exemptions > 0;
+        QuicCongestionControlGetExemptions(&Builder->Connection->CongestionControl) > 0;
 }
 
 //
@@ -40,6 +40,7 @@ QuicPacketSpaceInitialize(
     QuicZeroMemory(Packets, sizeof(QUIC_PACKET_SPACE));
     Packets->Connection = Connection;
     Packets->EncryptLevel = EncryptLevel;
+    Packets->DeferredDatagramsTail = &Packets->DeferredDatagrams;
 
     Status = QuicAckTrackerInitialize(&Packets->AckTracker);
     if (QUIC_FAILED(Status)) {
@@ -72,7 +73,7 @@ QuicPacketSpaceUninitialize(
         do {
             Datagram->QueuedOnConnection = FALSE;
         } while ((Datagram = Datagram->Next) != NULL);
-        QuicDataPathBindingReturnRecvDatagrams(Packets->DeferredDatagrams);
+        QuicConnReleaseRecvDatagrams(Packets->DeferredDatagrams);
     }
 
     QuicAckTrackerUninitialize(&Packets->AckTracker);
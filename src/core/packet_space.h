@@ -54,7 +54,7 @@ typedef struct QUIC_PACKET_SPACE {
     //
     // Numbers of entries in the DeferredDatagrams list.
     //
-    uint8_t DeferredDatagramsCount;
+    uint16_t DeferredDatagramsCount;
 
     //
     // The (expected) next packet number to receive. Used for decoding received
@@ -72,6 +72,7 @@ typedef struct QUIC_PACKET_SPACE {
     // for yet.
     //
     QUIC_RECV_DATAGRAM* DeferredDatagrams;
+    QUIC_RECV_DATAGRAM** DeferredDatagramsTail;
 
     //
     // Information related to packets that have been received and need to be
@@ -79,6 +80,11 @@ typedef struct QUIC_PACKET_SPACE {
     //
     QUIC_ACK_TRACKER AckTracker;
 
+    //
+    // The largest ECN counts the peer has reported for this packet space.
+    //
+    QUIC_ACK_ECN_EX PeerEcn;
+
     //
     // Packet number of the first sent packet of the current key phase.
     //
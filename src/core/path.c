@@ -132,12 +132,12 @@ QuicPathSetValid(
     Path->IsPeerValidated = TRUE;
     QuicPathSetAllowance(Connection, Path, UINT32_MAX);
 
-    if (Path->IsPeerValidated && Reason == QUIC_PATH_VALID_PATH_RESPONSE) {
+    if (Path->IsActive && Reason == QUIC_PATH_VALID_PATH_RESPONSE) {
         //
-        // If the active path was just validated, then let's queue up a PMTUD
-        // packet.
+        // If the active path was just validated, then let's search for its
+        // MTU.
         //
-        QuicSendSetSendFlag(&Connection->Send, QUIC_CONN_SEND_FLAG_PMTUD);
+        QuicMtuDiscoveryNewSearch(Connection, Path);
     }
 }
 
@@ -212,6 +212,68 @@ QuicConnGetPathForDatagram(
     return Path;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicConnOpenPath(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ const QUIC_ADDR* RemoteAddress
+    )
+{
+    if (Connection->PathsCount == QUIC_MAX_PATH_COUNT) {
+        return QUIC_STATUS_INVALID_STATE;
+    }
+
+    for (uint8_t i = 0; i < Connection->PathsCount; ++i) {
+        if (QuicAddrCompare(RemoteAddress, &Connection->Paths[i].RemoteAddress)) {
+            return QUIC_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    QUIC_CID_QUIC_LIST_ENTRY* DestCid = QuicConnGetUnusedDestCid(Connection);
+    if (DestCid == NULL) {
+        QuicTraceLogConnWarning(
+            NoCidForNewPath,
+            Connection,
+            "Can't open path because there is no unused destination CID");
+        return QUIC_STATUS_INVALID_STATE;
+    }
+
+    QUIC_PATH* Path = &Connection->Paths[Connection->PathsCount];
+    QuicPathInitialize(Connection, Path);
+    Connection->PathsCount++;
+
+    Path->DestCid = DestCid;
+    Path->DestCid->CID.UsedLocally = TRUE;
+    Path->Binding = Connection->Paths[0].Binding;
+    Path->LocalAddress = Connection->Paths[0].LocalAddress;
+    Path->RemoteAddress = *RemoteAddress;
+
+    //
+    // The client isn't subject to amplification protection, and the path is
+    // opened locally, so it's kept even though nothing was received on it yet.
+    //
+    Path->Allowance = UINT32_MAX;
+    Path->GotValidPacket = TRUE;
+
+    Path->SendChallenge = TRUE;
+    Path->PathValidationStartTime = QuicTimeUs32();
+    QuicRandomStreamRead(
+        &Connection->Worker->Random,
+        sizeof(Path->Challenge),
+        Path->Challenge);
+
+    QuicTraceEvent(
+        ConnRemoteAddrAdded,
+        "[conn][%p] New Remote IP: %!SOCKADDR!",
+        Connection,
+        LOG_ADDR_LEN(Path->RemoteAddress),
+        (const uint8_t*)&Path->RemoteAddress);
+
+    QuicSendSetSendFlag(&Connection->Send, QUIC_CONN_SEND_FLAG_PATH_CHALLENGE);
+
+    return QUIC_STATUS_SUCCESS;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicPathSetActive(
@@ -243,4 +305,90 @@ QuicPathSetActive(
     if (!UdpPortChangeOnly) {
         QuicCongestionControlReset(&Connection->CongestionControl);
     }
+
+    QuicCryptoUpdateInlineOffload(Connection);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_ECN_TYPE
+QuicPathGetEcnType(
+    _In_ const QUIC_CONNECTION* Connection,
+    _In_ const QUIC_PATH* Path
+    )
+{
+    if (Connection->Session == NULL ||
+        !Connection->Session->Settings.EcnEnabled) {
+        return QUIC_ECN_NON_ECT;
+    }
+
+    //
+    // Only a limited number of test packets are marked before the path is
+    // validated, so that a path that drops ECT packets doesn't lose them all.
+    //
+    return
+        Path->EcnValidationState == QUIC_ECN_VALIDATION_TESTING ||
+        Path->EcnValidationState == QUIC_ECN_VALIDATION_CAPABLE ?
+            QUIC_ECN_ECT_0 : QUIC_ECN_NON_ECT;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicPathSetEcnValidationState(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ QUIC_ECN_VALIDATION_STATE NewState
+    )
+{
+    if (Path->EcnValidationState == (uint8_t)NewState) {
+        return;
+    }
+
+    const char* StateStrings[] = {
+        "Testing",
+        "Unknown",
+        "Capable",
+        "Failed"
+    };
+
+    QuicTraceLogConnInfo(
+        PathEcnValidationState,
+        Connection,
+        "Path[%hhu] ECN validation state: %s",
+        Path->ID,
+        StateStrings[NewState]);
+
+    Path->EcnValidationState = (uint8_t)NewState;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicPathOnEcnPacketSent(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path
+    )
+{
+    if (Path->EcnValidationState == QUIC_ECN_VALIDATION_TESTING &&
+        ++Path->EcnTestingPacketsSent >= QUIC_ECN_TEST_PACKET_COUNT) {
+        QuicPathSetEcnValidationState(
+            Connection, Path, QUIC_ECN_VALIDATION_UNKNOWN);
+    }
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicPathOnEcnPacketLost(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path
+    )
+{
+    if ((Path->EcnValidationState == QUIC_ECN_VALIDATION_TESTING ||
+         Path->EcnValidationState == QUIC_ECN_VALIDATION_UNKNOWN) &&
+        ++Path->EcnTestingPacketsLost >= QUIC_ECN_TEST_PACKET_COUNT) {
+        //
+        // All the test packets were lost, probably because something on the
+        // path drops ECT marked packets.
+        //
+        QuicPathSetEcnValidationState(
+            Connection, Path, QUIC_ECN_VALIDATION_FAILED);
+    }
 }
@@ -5,6 +5,17 @@
 
 --*/
 
+//
+// The state of the validation (RFC 9000, Section 13.4.2) that the path and the
+// peer correctly carry and report ECN marks.
+//
+typedef enum QUIC_ECN_VALIDATION_STATE {
+    QUIC_ECN_VALIDATION_TESTING,    // Sending the first ECT(0) marked packets.
+    QUIC_ECN_VALIDATION_UNKNOWN,    // Waiting for the test packets to be ACKed.
+    QUIC_ECN_VALIDATION_CAPABLE,    // The marks are reported; keep marking.
+    QUIC_ECN_VALIDATION_FAILED      // The marks are lost or mangled; stop.
+} QUIC_ECN_VALIDATION_STATE;
+
 //
 // Represents all the per-path information of a connection.
 //
@@ -62,11 +73,32 @@ typedef struct QUIC_PATH {
     //
     uint8_t PartitionUpdated : 1;
 
+    //
+    // The partition the latest packets on this path were received on, when
+    // it isn't the connection's, and how many valid packets in a row were
+    // received there.
+    //
+    uint8_t CrossPartitionIndex;
+    uint8_t CrossPartitionPackets;
+
+    //
+    // The state of ECN validation (QUIC_ECN_VALIDATION_STATE), and the number
+    // of ECT marked packets sent and lost while testing the path.
+    //
+    uint8_t EcnValidationState;
+    uint8_t EcnTestingPacketsSent;
+    uint8_t EcnTestingPacketsLost;
+
     //
     // The currently calculated path MTU.
     //
     uint16_t Mtu;
 
+    //
+    // The state of the search for a larger path MTU.
+    //
+    QUIC_MTU_DISCOVERY MtuDiscovery;
+
     //
     // The binding used for sending/receiving UDP packets.
     //
@@ -87,6 +119,17 @@ typedef struct QUIC_PATH {
     //
     QUIC_CID_QUIC_LIST_ENTRY* DestCid;
 
+    //
+    // The first byte and destination CID of the last short header encoded on
+    // this path. They are copied as is into the next short header (only the
+    // packet number is encoded) while the CID, spin bit and key phase stay
+    // the same. HeaderTemplateLength is zero when there is no template.
+    //
+    const QUIC_CID_QUIC_LIST_ENTRY* HeaderTemplateCid;
+    uint64_t HeaderTemplateCidSequence;
+    uint8_t HeaderTemplateLength;
+    uint8_t HeaderTemplate[1 + QUIC_MAX_CONNECTION_ID_LENGTH_V1];
+
     //
     // Used on the server side until the client's IP address has been validated
     // to prevent the server from being used for amplification attacks. A value
@@ -103,6 +146,20 @@ typedef struct QUIC_PATH {
     uint32_t RttVariance;
     uint32_t LatestRttSample;
 
+    //
+    // The number of ack-eliciting bytes sent on this path that haven't been
+    // acknowledged or declared lost. Used for scheduling sends across paths
+    // when multipath is in use.
+    //
+    uint32_t BytesInFlight;
+
+    //
+    // The largest packet number acknowledged among those sent on this path.
+    // With multipath, loss is detected separately for each path, because
+    // paths with different latencies reorder the packet number space.
+    //
+    uint64_t LargestAck;
+
     //
     // The last path challenge we received and needs to be sent back as in a
     // PATH_RESPONSE frame.
@@ -174,6 +231,18 @@ QuicPathDecrementAllowance(
         Path->Allowance <= Amount ? 0 : (Path->Allowance - Amount));
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+inline
+void
+QuicPathRemoveBytesInFlight(
+    _In_ QUIC_PATH* Path,
+    _In_ uint32_t Bytes
+    )
+{
+    Path->BytesInFlight =
+        Path->BytesInFlight <= Bytes ? 0 : (Path->BytesInFlight - Bytes);
+}
+
 typedef enum QUIC_PATH_VALID_REASON {
     QUIC_PATH_VALID_INITIAL_TOKEN,
     QUIC_PATH_VALID_HANDSHAKE_PACKET,
@@ -195,6 +264,44 @@ QuicPathSetActive(
     _In_ QUIC_PATH* Path
     );
 
+//
+// Returns the ECN codepoint to mark the packets sent on the path with.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_ECN_TYPE
+QuicPathGetEcnType(
+    _In_ const QUIC_CONNECTION* Connection,
+    _In_ const QUIC_PATH* Path
+    );
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicPathSetEcnValidationState(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path,
+    _In_ QUIC_ECN_VALIDATION_STATE NewState
+    );
+
+//
+// Called when an ECT marked packet is sent on the path.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicPathOnEcnPacketSent(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path
+    );
+
+//
+// Called when an ECT marked packet sent on the path is lost.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicPathOnEcnPacketLost(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ QUIC_PATH* Path
+    );
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 _Ret_maybenull_
 QUIC_PATH*
@@ -203,6 +310,17 @@ QuicConnGetPathByID(
     _In_ uint8_t ID
     );
 
+//
+// Opens a new path from the connection's binding to another address of the
+// peer, and starts validating it.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicConnOpenPath(
+    _In_ QUIC_CONNECTION* Connection,
+    _In_ const QUIC_ADDR* RemoteAddress
+    );
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 _Ret_maybenull_
 QUIC_PATH*
@@ -16,6 +16,13 @@
 #pragma warning(disable:26451) // Arithmetic overflow: Using operator '+' on a 4 byte value and then casting the result to a 8 byte value.
 #pragma warning(disable:28931) // Unused Assignment
 
+//
+// Only write verbose connection and stream logs for connections sampled for
+// tracing. See QUIC_PARAM_GLOBAL_TRACE_SAMPLING.
+//
+#define QuicTraceConnSampled(Ptr) (((const QUIC_CONNECTION*)(Ptr))->TraceSampled)
+#define QuicTraceStreamSampled(Ptr) (((const QUIC_STREAM*)(Ptr))->Connection->TraceSampled)
+
 //
 // Platform or Public Headers.
 //
@@ -39,11 +46,14 @@ extern "C" {
 //
 #include "quicdef.h"
 #include "cid.h"
+#include "cid_table.h"
+#include "mtu_discovery.h"
 #include "path.h"
 #include "transport_params.h"
 #include "lookup.h"
 #include "timer_wheel.h"
 #include "settings.h"
+#include "decrypt_helper.h"
 #include "library.h"
 #include "binding.h"
 #include "api.h"
@@ -58,17 +68,24 @@ extern "C" {
 #include "worker.h"
 #include "ack_tracker.h"
 #include "packet_space.h"
+#include "cubic.h"
+#include "bbr.h"
+#include "ledbat.h"
 #include "congestion_control.h"
 #include "loss_detection.h"
 #include "send.h"
 #include "operation.h"
 #include "crypto.h"
+#include "crypto_offload.h"
+#include "network_emulation.h"
 #include "stream.h"
 #include "stream_set.h"
 #include "datagram.h"
+#include "conn_arena.h"
 #include "connection.h"
 #include "packet_builder.h"
 #include "listener.h"
+#include "stats_region.h"
 
 #if defined(__cplusplus)
 }
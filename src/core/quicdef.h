@@ -16,6 +16,11 @@ typedef struct QUIC_CONNECTION QUIC_CONNECTION;
 typedef struct QUIC_STREAM QUIC_STREAM;
 typedef struct QUIC_PACKET_BUILDER QUIC_PACKET_BUILDER;
 typedef struct QUIC_PATH QUIC_PATH;
+typedef struct QUIC_CONGESTION_CONTROL QUIC_CONGESTION_CONTROL;
+typedef struct QUIC_CRYPTO_OFFLOAD QUIC_CRYPTO_OFFLOAD;
+typedef struct QUIC_CRYPTO_OFFLOAD_POOL QUIC_CRYPTO_OFFLOAD_POOL;
+typedef struct QUIC_EMULATED_LINK QUIC_EMULATED_LINK;
+typedef struct QUIC_NETWORK_EMULATOR QUIC_NETWORK_EMULATOR;
 
 /*************************************************************
                     PROTOCOL CONSTANTS
@@ -56,6 +61,20 @@ typedef struct QUIC_PATH QUIC_PATH;
 //
 #define QUIC_TIME_REORDER_THRESHOLD(rtt)        ((rtt) + ((rtt) / 8))
 
+//
+// Each time a packet declared lost is later acknowledged (i.e. it was only
+// reordered), both reordering thresholds are scaled up, by increasing the
+// multiplier of the packet threshold and of the time threshold's RTT/8 (which
+// is capped at one RTT), up to this value.
+//
+#define QUIC_MAX_REORDER_THRESHOLD_MULTIPLIER   8
+
+//
+// The number of loss events without any spurious loss after which the
+// reordering thresholds are reset to their defaults.
+//
+#define QUIC_REORDER_THRESHOLD_PERSIST          16
+
 //
 // Number of consecutive PTOs after which the network is considered to be
 // experiencing persistent congestion.
@@ -80,6 +99,44 @@ typedef struct QUIC_PATH QUIC_PATH;
 //
 #define QUIC_MIN_ACK_SEND_NUMBER                2
 
+//
+// The minimum ACK delay (in microseconds) advertised to the peer. The delayed
+// ACK timer has millisecond granularity.
+//
+#define QUIC_MIN_ACK_DELAY_US                   1000
+
+//
+// The target number of ACKs per congestion window when asking the peer (via
+// the ACK_FREQUENCY frame) to acknowledge less often.
+//
+#define QUIC_ACK_FREQUENCY_ACKS_PER_CWND        4
+
+//
+// The granularity (in microseconds) delayed ACK timers expire on, so that the
+// timers of a worker's connections expire, and their ACKs are sent, together.
+//
+#define QUIC_ACK_DELAY_ALIGNMENT_US             1000
+
+//
+// The granularity (in microseconds) keep alive timers expire on, so that the
+// keep alives of a worker's connections due around the same time are sent
+// together. Each worker offsets its buckets randomly.
+//
+#define QUIC_KEEP_ALIVE_BUCKET_US               (1000 * 1000)
+
+//
+// Keep alives are scheduled early by a random jitter of up to this fraction of
+// the interval, so that connections started together drift apart, and by at
+// most this fraction of the interval overall (jitter and bucket alignment).
+//
+#define QUIC_KEEP_ALIVE_JITTER_DIVISOR          16
+#define QUIC_KEEP_ALIVE_MAX_EARLY_DIVISOR       4
+
+//
+// The largest packet tolerance requested of the peer.
+//
+#define QUIC_MAX_ACK_FREQUENCY_PACKET_TOLERANCE 10
+
 //
 // The size of the stateless reset token.
 //
@@ -113,23 +170,152 @@ typedef struct QUIC_PATH QUIC_PATH;
 //
 #define QUIC_MAX_THROUGHPUT_PARTITION_OFFSET    2 // Two to skip over hyper-threaded cores
 
+//
+// The number of consecutive valid packets that must arrive on the active path
+// on a partition other than the connection's before the connection moves to
+// that partition. A few packets may be delivered elsewhere after a NAT
+// rebinding or an RSS indirection change without the flow having moved.
+//
+#define QUIC_PARTITION_MOVE_PACKET_THRESHOLD    8
+
 //
 // The fraction ((0 to UINT16_MAX) / UINT16_MAX) of memory that must be
 // exhausted before enabling retry.
 //
 #define QUIC_DEFAULT_RETRY_MEMORY_FRACTION      65 // ~0.1%
 
+//
+// The fraction ((0 to UINT16_MAX) / UINT16_MAX) of memory that may be used for
+// buffering (handshakes, send buffers and stream receive windows) across all
+// connections. Past it, send buffers and receive windows are shrunk and new
+// streams are refused.
+//
+#define QUIC_DEFAULT_MEMORY_BUDGET_FRACTION     16384 // 25%
+
 //
 // The maximum amount of queue delay a worker should take on (in ms).
 //
 #define QUIC_MAX_WORKER_QUEUE_DELAY             250
 
+//
+// The maximum number of latency sensitive connections a worker processes in a
+// row while other connections are queued.
+//
+#define QUIC_WORKER_MAX_PRIORITY_DRAINS         4
+
+//
+// The maximum number of freed streams a worker keeps, with their receive
+// buffer and range allocations, to be reused by new streams.
+//
+#define QUIC_WORKER_STREAM_CACHE_DEPTH          64
+
+//
+// The amount of time (in us) workers and datapath threads spin, polling for
+// new work, before going to sleep when the
+// QUIC_EXECUTION_PROFILE_TYPE_BUSY_POLL profile is used.
+//
+#define QUIC_DEFAULT_BUSY_POLL_US               200
+
+//
+// The number of threads servers use to process handshakes (i.e. the TLS
+// ClientHello) off of the worker threads. Zero disables the offload.
+//
+#define QUIC_DEFAULT_HANDSHAKE_OFFLOAD_THREAD_COUNT 0
+
+//
+// The number of threads connections use to decrypt part of their receive
+// batches while the worker processes the rest. Zero disables the helpers.
+//
+#define QUIC_DEFAULT_DECRYPT_HELPER_THREAD_COUNT 0
+
+//
+// The fewest packets in a run for part of it to be handed to a decrypt helper.
+// The helper gets the second half of the run.
+//
+#define QUIC_MIN_DECRYPT_HELPER_PACKETS         4
+
+//
+// How long (in us) a decrypt helper keeps polling for the next job after
+// finishing one, before blocking.
+//
+#define QUIC_DECRYPT_HELPER_POLL_US             50
+
+//
+// How long (in us) a worker spins waiting for a decrypt helper's job to
+// finish, before blocking.
+//
+#define QUIC_DECRYPT_HELPER_SPIN_US             20
+
+//
+// The maximum number of times a worker processes its queues in a row, in the
+// QUIC_EXECUTION_PROFILE_TYPE_RUN_TO_COMPLETION profile, before letting the
+// datapath check for new receives.
+//
+#define QUIC_MAX_WORKER_POLL_ITERATIONS         16
+
+//
+// The maximum number of ACK only datagrams a worker holds, while processing
+// expired timers, to send together in one batch per binding.
+//
+#define QUIC_MAX_WORKER_SEND_BATCH              32
+
+//
+// How often (in microseconds) a worker refreshes its slot in the shared memory
+// stats region, and the perf counters there, while it has work to process.
+//
+#define QUIC_STATS_REGION_UPDATE_INTERVAL_US    MS_TO_US(100)
+
+//
+// The number of connection slots in the shared memory stats region a new
+// connection tries, before giving up on being tracked there.
+//
+#define QUIC_STATS_REGION_MAX_CLAIM_PROBES      16
+
+//
+// The maximum length of the shared memory stats region's name.
+//
+#define QUIC_MAX_STATS_REGION_NAME_LENGTH       255
+
+//
+// The number of independently locked shards the per-session cache of server
+// state is split into. Must be a power of two.
+//
+#define QUIC_SERVER_CACHE_SHARD_COUNT           8
+
+//
+// The number of independently locked lists a session's connections are split
+// into, selected by the processor the connection is registered on. Must be a
+// power of two.
+//
+#define QUIC_SESSION_CONNECTION_SHARD_COUNT     16
+
+//
+// The maximum number of servers and bytes of memory kept in a session's
+// server state cache. Least recently used entries are evicted beyond that.
+//
+#define QUIC_SERVER_CACHE_MAX_ENTRIES           1024
+#define QUIC_SERVER_CACHE_MAX_MEMORY            (512 * 1024)
+
+//
+// The maximum number of server names in the library's resolver cache. The
+// oldest entries are evicted beyond that.
+//
+#define QUIC_DNS_CACHE_MAX_ENTRIES              256
+
 //
 // The maximum number of simultaneous stateless operations that can be queued on
 // a single worker.
 //
 #define QUIC_MAX_STATELESS_OPERATIONS           16
 
+//
+// The maximum number of new server connections a worker handshakes at once.
+// A quarter of them are only used for clients that resume (send 0-RTT), so
+// returning clients still get in while full handshakes are being limited.
+//
+#define QUIC_MAX_WORKER_HANDSHAKES              1024
+#define QUIC_WORKER_HANDSHAKES_RESUMPTION_SHARE 4
+
 //
 // The maximum number of simultaneous stateless operations that can be queued on
 // a single binding.
@@ -142,12 +328,48 @@ typedef struct QUIC_PATH QUIC_PATH;
 //
 #define QUIC_STATELESS_OPERATION_EXPIRATION_MS  100
 
+//
+// The number of per source prefix (/24 for IPv4, /48 for IPv6) buckets a
+// binding uses to limit its version negotiation and stateless reset responses.
+//
+#define QUIC_STATELESS_RESPONSE_BUCKETS         256
+
+//
+// The number of buckets in the library's index of bindings by address. Must be
+// a power of two.
+//
+#define QUIC_LIBRARY_BINDING_TABLE_SIZE         4096
+
+//
+// The token bucket for the version negotiation and stateless reset responses
+// sent to the prefixes of a bucket: the number of responses per second, and
+// the burst allowed after a quiet period.
+//
+#define QUIC_STATELESS_RESPONSES_PER_SEC_PER_PREFIX 16
+#define QUIC_STATELESS_RESPONSE_BURST_PER_PREFIX    32
+
+//
+// The token bucket for all the stateless reset responses of a binding. After
+// a restart, the packets of all the former clients trigger resets, so this
+// bounds the cost of the storm however many prefixes they come from.
+//
+#define QUIC_STATELESS_RESETS_PER_SEC           1000
+#define QUIC_STATELESS_RESET_BURST              100
+
 //
 // The maximum number of operations a connection will drain from its queue per
 // call to QuicConnDrainOperations.
 //
 #define QUIC_MAX_OPERATIONS_PER_DRAIN           16
 
+//
+// The default time budget (in microseconds) for a single call to
+// QuicConnDrainOperations. Once exceeded, the connection is requeued behind
+// the other connections of its worker, even if it hasn't hit the operation
+// count limit. Zero disables the budget.
+//
+#define QUIC_DEFAULT_MAX_DRAIN_TIME_US          1000
+
 //
 // Used as a hint for the maximum number of UDP datagrams to send for each
 // FLUSH_SEND operation. The actual number will generally exceed this value up
@@ -155,22 +377,65 @@ typedef struct QUIC_PATH QUIC_PATH;
 //
 #define QUIC_MAX_DATAGRAMS_PER_SEND             245
 
+//
+// The minimum number of UDP datagrams each flush is allowed to build,
+// however little the send allowance is. It is larger when the datapath
+// supports send segmentation, since each extra datagram then costs no extra
+// syscall.
+//
+#define QUIC_MIN_DATAGRAMS_PER_SEND             8
+#define QUIC_MIN_SEGMENTED_DATAGRAMS_PER_SEND   32
+
 //
 // The number of packets we write for a single stream before going to the next
 // one in the round robin.
 //
 #define QUIC_STREAM_SEND_BATCH_COUNT            8
 
+//
+// The default send priority of a stream. Streams with a higher priority are
+// always scheduled before streams with a lower one.
+//
+#define QUIC_STREAM_PRIORITY_DEFAULT            0x7FFF
+
+//
+// The number of stream IDs, per stream type, in the stream set's direct
+// mapped lookup window.
+//
+#define QUIC_STREAM_SET_WINDOW_SIZE             32
+
+QUIC_STATIC_ASSERT(IS_POWER_OF_TWO(QUIC_STREAM_SET_WINDOW_SIZE), L"Must be power of two");
+
 //
 // The maximum number of received packets to batch process at a time.
 //
 #define QUIC_MAX_RECEIVE_BATCH_COUNT            32
 
+//
+// The bounds on the number of queued datagrams a single receive flush takes
+// off the connection's receive queue, before letting the connection's other
+// operations (sending ACKs, indicating stream data) run. Within the bounds, a
+// flush takes a quarter of the queue, so shallow queues are indicated
+// promptly and deep ones are processed in larger batches. The upper bound
+// depends on the execution profile.
+//
+#define QUIC_MIN_RECEIVE_FLUSH_COUNT            4
+#define QUIC_REAL_TIME_RECEIVE_FLUSH_COUNT      8
+#define QUIC_DEFAULT_RECEIVE_FLUSH_COUNT        QUIC_MAX_RECEIVE_BATCH_COUNT
+#define QUIC_MAX_THROUGHPUT_RECEIVE_FLUSH_COUNT 128
+
 //
 // The maximum number of crypto operations to batch.
 //
 #define QUIC_MAX_CRYPTO_BATCH_COUNT             8
 
+//
+// The maximum number of app buffer pieces per QUIC packet that are copied into
+// the packet as part of encrypting it, rather than while framing it. Any more
+// than this are copied while framing.
+//
+#define QUIC_MAX_ENCRYPT_COPY_COUNT             8
+
 //
 // The maximum number of received packets that may be queued on a single
 // connection. When this limit is reached, any additional packets are dropped.
@@ -178,11 +443,51 @@ typedef struct QUIC_PATH QUIC_PATH;
 #define QUIC_MAX_RECEIVE_QUEUE_COUNT            0x1000      // 4096
 
 //
-// The maximum number of pending datagrams we will hold on to, per connection,
-// per packet number space. We base our max on the expected initial window size
-// of the peer with a little bit of extra.
+// Past QUIC_MAX_RECEIVE_QUEUE_COUNT, a connection still queues up to this many
+// more handshake packets and small (likely ACK only) short header packets.
+//
+#define QUIC_RECEIVE_QUEUE_PRIORITY_RESERVE     0x200       // 512
+
+//
+// Short header datagrams no larger than this are considered likely to only
+// carry ACK (or other small control) frames, when deciding what to drop.
+//
+#define QUIC_RECEIVE_QUEUE_SMALL_DATAGRAM       128
+
+//
+// Long header packets received after the handshake is confirmed can't be
+// decrypted anymore, and are dropped once this many packets are queued.
+//
+#define QUIC_RECEIVE_QUEUE_OLD_EPOCH_LIMIT      (QUIC_MAX_RECEIVE_QUEUE_COUNT / 4)
+
+//
+// The maximum number of destination CIDs a received batch of datagrams is
+// grouped by at once, before the oldest group is delivered to its connection.
+//
+#define QUIC_MAX_RECEIVE_SUBCHAINS              8
+
+//
+// The initial number of send completions a stream with
+// QUIC_PARAM_STREAM_SEND_COMPLETE_BATCHING has room for. Grows as needed.
+//
+#define QUIC_SEND_COMPLETE_BATCH_INITIAL_SIZE   16
+
+//
+// The maximum number of received packets that may be queued on all the
+// connections of a worker. Past it, only priority packets are queued.
+//
+#define QUIC_MAX_WORKER_RECEIVE_QUEUE_COUNT     0x10000     // 65536
+
+//
+// The minimum number of pending datagrams we will hold on to, per connection,
+// per packet number space. We base our min on the expected initial window size
+// of the peer with a little bit of extra. A 0-RTT client may send a whole
+// initial window of early data before the server has the keys for it, so the
+// max grows to twice the configured initial window, up to
+// QUIC_MAX_PENDING_DATAGRAMS_LIMIT.
 //
 #define QUIC_MAX_PENDING_DATAGRAMS              (QUIC_INITIAL_WINDOW_PACKETS + 5)
+#define QUIC_MAX_PENDING_DATAGRAMS_LIMIT        256
 
 //
 // The maximum crypto FC window we will use/allow for client buffers.
@@ -204,11 +509,40 @@ typedef struct QUIC_PATH QUIC_PATH;
 //
 #define QUIC_DEFAULT_STREAM_RECV_BUFFER_SIZE    0x1000  // 4096
 
+//
+// The size of each chunk making up a stream receive buffer.
+//
+#define QUIC_RECV_BUFFER_CHUNK_SIZE             0x1000  // 4096
+
+//
+// The size a receive buffer is allocated with when it's needed again, after
+// its memory was released (see QuicRecvBufferRelease).
+//
+#define QUIC_MIN_RECV_BUFFER_ALLOC_SIZE         0x400   // 1024
+
+//
+// The maximum number of buffers indicated to the app in a single stream
+// receive event.
+//
+#define QUIC_MAX_RECV_INDICATION_BUFFERS        16
+
+//
+// The maximum number of streams indicated in one
+// QUIC_CONNECTION_EVENT_RECEIVE_BATCH. The rest wait for the next one.
+//
+#define QUIC_MAX_RECV_BATCH_STREAMS             64
+
 //
 // The default connection flow control window value, in bytes.
 //
 #define QUIC_DEFAULT_CONN_FLOW_CONTROL_WINDOW   0x1000000  // 16MB
 
+//
+// The default largest size a stream's receive window is grown to by
+// auto-tuning, in bytes.
+//
+#define QUIC_DEFAULT_STREAM_RECV_WINDOW_MAX     0x1000000  // 16MB
+
 //
 // Maximum memory allocated (in bytes) for different range tracking structures
 //
@@ -222,12 +556,56 @@ QUIC_STATIC_ASSERT(IS_POWER_OF_TWO(QUIC_MAX_RANGE_DUPLICATE_PACKETS), L"Must be
 QUIC_STATIC_ASSERT(IS_POWER_OF_TWO(QUIC_MAX_RANGE_ACK_PACKETS), L"Must be power of two");
 QUIC_STATIC_ASSERT(IS_POWER_OF_TWO(QUIC_MAX_RANGE_DECODE_ACKS), L"Must be power of two");
 
+//
+// Once an ACK frame is acknowledged, received packet numbers more than this
+// far below its largest are all treated as received (so any straggler is
+// dropped as a duplicate), instead of tracking each gap left by losses.
+//
+#define QUIC_DUPLICATE_PACKET_WINDOW            1024
+
+//
+// The number of entries in QuicSupportedVersionList.
+//
+#define QUIC_SUPPORTED_VERSION_COUNT            4
+
+//
+// The maximum length of the encoded additional ACK blocks in an ACK frame.
+// Older blocks beyond this are left out; the peer has long since used the
+// newer ones to detect their loss.
+//
+#define QUIC_MAX_ACK_BLOCKS_ENCODED_LENGTH      256
+
 //
 // Path MTU discovery will always start with/initialize with the smallest
 // allowable MTU for QUIC (1280 bytes).
 //
 #define QUIC_DEFAULT_PATH_MTU                   QUIC_MIN_MTU
 
+//
+// The number of times a path MTU probe of a given size is lost before the size
+// is considered too large for the path.
+//
+#define QUIC_DPLPMTUD_MAX_PROBES                3
+
+//
+// The path MTU search stops once the largest MTU known to work and the
+// largest one that might are this close.
+//
+#define QUIC_DPLPMTUD_SEARCH_GRANULARITY        16
+
+//
+// The time (in microseconds) after a search completed below the maximum MTU,
+// before the larger sizes are probed again.
+//
+#define QUIC_DPLPMTUD_RAISE_TIMER               S_TO_US(600)
+
+//
+// The number of consecutive lost packets larger than the minimum MTU, with
+// none acknowledged in between, after which the path is considered a black
+// hole for them and the MTU goes back to the minimum.
+//
+#define QUIC_DPLPMTUD_BLACK_HOLE_PACKETS        8
+
 //
 // The maximum time an app callback can take before we log a warning.
 // Apps should generally take less than a millisecond for each callback if at
@@ -275,12 +653,46 @@ QUIC_STATIC_ASSERT(
 //
 #define QUIC_DEFAULT_KEEP_ALIVE_INTERVAL        0
 
+//
+// The default time (in milliseconds) a connection must be quiet before it
+// frees its unused memory. Zero disables hibernation.
+//
+#define QUIC_DEFAULT_HIBERNATE_TIMEOUT          0
+
+//
+// The default time (in milliseconds) a client waits for a response from the
+// first resolved address family before falling back to the other one (RFC
+// 8305's "Connection Attempt Delay"). Zero disables the fallback.
+//
+#define QUIC_DEFAULT_HAPPY_EYEBALLS_DELAY       250
+
 //
 // The flow control window is doubled when more than (1 / ratio) of the current
 // window is delivered to the app within 1 RTT.
 //
 #define QUIC_RECV_BUFFER_DRAIN_RATIO            2
 
+//
+// A receive buffer's allocation (or its array of chunks) is halved as long as
+// no more than (1 / ratio) of it is in use after a drain. Since growing always
+// doubles, the gap keeps a buffer from bouncing between two sizes.
+//
+#define QUIC_RECV_BUFFER_SHRINK_RATIO           4
+
+//
+// The smallest array of chunk pointers kept by a chunked receive buffer.
+//
+#define QUIC_RECV_BUFFER_MIN_CHUNK_RING_LENGTH  4
+
+//
+// Flow control updates that can't ride along with another frame are held
+// until the peer is down to (1 / ratio) of the window, or to the credit it
+// consumes in QUIC_RECV_WINDOW_UPDATE_RTT_COUNT RTTs at the current drain rate,
+// whichever is more.
+//
+#define QUIC_RECV_WINDOW_UPDATE_CREDIT_RATIO    4
+#define QUIC_RECV_WINDOW_UPDATE_RTT_COUNT       2
+
 //
 // The default value for send buffering being enabled or not.
 //
@@ -339,10 +751,31 @@ QUIC_STATIC_ASSERT(
 #define QUIC_DEFAULT_SEND_PACING                TRUE
 
 //
-// The number of milliseconds between pacing chunks.
+// The maximum number of milliseconds between pacing chunks.
 //
 #define QUIC_SEND_PACING_INTERVAL               15
 
+//
+// The longest (in microseconds) stream data sent with QUIC_SEND_FLAG_DELAY_SEND
+// is held back, when the connection has no cork delay of its own.
+//
+#define QUIC_DEFAULT_SEND_CORK_US               1000
+
+//
+// The upper bound for a connection's cork delay, in microseconds.
+//
+#define QUIC_MAX_SEND_CORK_US                   25000
+
+//
+// The minimum smoothed RTT (in microseconds) for which sends are paced.
+//
+#define QUIC_SEND_PACING_MIN_RTT                1000
+
+//
+// The minimum number of microseconds between pacing chunks.
+//
+#define QUIC_SEND_PACING_MIN_DELAY              50
+
 //
 // The minimum number of packets to send per pacing chunk.
 //
@@ -403,6 +836,105 @@ QUIC_STATIC_ASSERT(
 //
 #define QUIC_DEFAULT_SERVER_RESUMPTION_LEVEL    QUIC_SERVER_NO_RESUME
 
+//
+// The default ceiling for automatically raising the number of concurrent
+// streams the peer may open. Zero disables it; the peer's limit then only
+// changes when the app sets it.
+//
+#define QUIC_DEFAULT_PEER_STREAM_COUNT_MAX      0
+
+//
+// The default congestion control algorithm.
+//
+#define QUIC_DEFAULT_CONGESTION_CONTROL_ALGORITHM QUIC_CONGESTION_CONTROL_ALGORITHM_CUBIC
+
+//
+// The default value for enabling HyStart++ slow start exit in CUBIC.
+//
+#define QUIC_DEFAULT_HYSTART_ENABLED            FALSE
+
+//
+// The default value for steering server datagrams to the partition encoded in
+// their connection ID, in the datapath.
+//
+#define QUIC_DEFAULT_CID_STEERING_ENABLED       FALSE
+
+//
+// The default log2 of the number of directly indexed CID slots per lookup
+// partition. Zero disables the slots; all CIDs are then hashed.
+//
+#define QUIC_DEFAULT_CID_ROUTE_TABLE_BITS       0
+
+//
+// The maximum log2 of the number of directly indexed CID slots per lookup
+// partition.
+//
+#define QUIC_MAX_CID_ROUTE_TABLE_BITS           20
+
+//
+// The default time (in milliseconds) the library caches a resolved server
+// name for. Zero disables the cache.
+//
+#define QUIC_DEFAULT_DNS_CACHE_TIMEOUT          30000
+
+//
+// The default value for indicating in-order stream data directly out of the
+// received datagram, instead of copying it into the stream's receive buffer.
+//
+#define QUIC_DEFAULT_ZERO_COPY_RECV_ENABLED     FALSE
+
+//
+// The default value for marking sent packets ECN-capable, and reacting to the
+// congestion the peer reports with ECN.
+//
+#define QUIC_DEFAULT_ECN_ENABLED                FALSE
+
+//
+// The number of ECN-capable packets sent on a path before it has been
+// validated. If all of them are lost, ECN marking is assumed to be what causes
+// the loss, and is disabled on the path.
+//
+#define QUIC_ECN_TEST_PACKET_COUNT              10
+
+//
+// The default value for handing the pacing of sends to the datapath (i.e.
+// stamping each pacing chunk with the time it may leave the host), where the
+// datapath supports it. This needs a qdisc which honors the departure times,
+// such as fq, on the sending interface.
+//
+#define QUIC_DEFAULT_PACING_OFFLOAD_ENABLED     FALSE
+
+//
+// How far ahead (in microseconds) of the current time sends are scheduled
+// when pacing is offloaded to the datapath.
+//
+#define QUIC_SEND_PACING_OFFLOAD_HORIZON        2000
+
+//
+// The default value for caching path metrics (congestion window, min RTT and
+// MTU) per remote network in the session, to seed new client connections.
+//
+#define QUIC_DEFAULT_PATH_METRICS_CACHE_ENABLED FALSE
+
+//
+// The number of entries in a session's path metrics cache.
+//
+#define QUIC_PATH_METRICS_CACHE_SIZE            64
+
+//
+// The largest initial congestion window (in packets) a new connection is given
+// from the path metrics cache. It gets half the cached congestion window, but
+// never less than the configured initial window.
+//
+#define QUIC_PATH_METRICS_MAX_INITIAL_WINDOW_PACKETS 64
+
+//
+// The default value for offering integrity-only protection of 1-RTT packets
+// (authenticated, but not encrypted) to the peer. It's only used if both
+// endpoints enable it.
+//
+#define QUIC_DEFAULT_INTEGRITY_ONLY_ENABLED     FALSE
+
 //
 // Version of the wire-format for resumption tickets.
 // This needs to be incremented for each change in order or count of fields.
@@ -417,10 +949,19 @@ QUIC_STATIC_ASSERT(
 
 #define QUIC_SETTING_MAX_PARTITION_COUNT        "MaxPartitionCount"
 #define QUIC_SETTING_RETRY_MEMORY_FRACTION      "RetryMemoryFraction"
+#define QUIC_SETTING_MEMORY_BUDGET_FRACTION     "MemoryBudgetFraction"
 #define QUIC_SETTING_LOAD_BALANCING_MODE        "LoadBalancingMode"
 #define QUIC_SETTING_MAX_WORKER_QUEUE_DELAY     "MaxWorkerQueueDelayMs"
 #define QUIC_SETTING_MAX_STATELESS_OPERATIONS   "MaxStatelessOperations"
+#define QUIC_SETTING_MAX_WORKER_HANDSHAKES      "MaxWorkerHandshakes"
 #define QUIC_SETTING_MAX_OPERATIONS_PER_DRAIN   "MaxOperationsPerDrain"
+#define QUIC_SETTING_MAX_DRAIN_TIME_US          "MaxDrainTimeUs"
+#define QUIC_SETTING_BUSY_POLL_US               "BusyPollUs"
+#define QUIC_SETTING_HANDSHAKE_OFFLOAD_THREADS  "HandshakeOffloadThreadCount"
+#define QUIC_SETTING_DECRYPT_HELPER_THREADS     "DecryptHelperThreadCount"
+#define QUIC_SETTING_CID_STEERING_ENABLED       "CidSteeringEnabled"
+#define QUIC_SETTING_CID_ROUTE_TABLE_BITS       "CidRouteTableBits"
+#define QUIC_SETTING_DNS_CACHE_TIMEOUT          "DnsCacheTimeoutMs"
 
 #define QUIC_SETTING_SEND_PACING_DEFAULT        "SendPacingDefault"
 #define QUIC_SETTING_MIGRATION_ENABLED          "MigrationEnabled"
@@ -428,11 +969,20 @@ QUIC_STATIC_ASSERT(
 
 #define QUIC_SETTING_INITIAL_WINDOW_PACKETS     "InitialWindowPackets"
 #define QUIC_SETTING_SEND_IDLE_TIMEOUT_MS       "SendIdleTimeoutMs"
+#define QUIC_SETTING_CONGESTION_CONTROL_ALGORITHM "CongestionControlAlgorithm"
+#define QUIC_SETTING_HYSTART_ENABLED            "HyStartEnabled"
+#define QUIC_SETTING_ZERO_COPY_RECV_ENABLED     "ZeroCopyRecvEnabled"
+#define QUIC_SETTING_ECN_ENABLED                "EcnEnabled"
+#define QUIC_SETTING_PACING_OFFLOAD_ENABLED     "PacingOffloadEnabled"
+#define QUIC_SETTING_PATH_METRICS_CACHE_ENABLED "PathMetricsCacheEnabled"
+#define QUIC_SETTING_INTEGRITY_ONLY_ENABLED     "IntegrityOnlyEnabled"
 
 #define QUIC_SETTING_INITIAL_RTT                "InitialRttMs"
 #define QUIC_SETTING_MAX_ACK_DELAY              "MaxAckDelayMs"
 #define QUIC_SETTING_DISCONNECT_TIMEOUT         "DisconnectTimeoutMs"
 #define QUIC_SETTING_KEEP_ALIVE_INTERVAL        "KeepAliveIntervalMs"
+#define QUIC_SETTING_HIBERNATE_TIMEOUT          "HibernateTimeoutMs"
+#define QUIC_SETTING_HAPPY_EYEBALLS_DELAY       "HappyEyeballsDelayMs"
 #define QUIC_SETTING_IDLE_TIMEOUT               "IdleTimeoutMs"
 #define QUIC_SETTING_HANDSHAKE_IDLE_TIMEOUT     "HandshakeIdleTimeoutMs"
 
@@ -441,7 +991,9 @@ QUIC_STATIC_ASSERT(
 #define QUIC_SETTING_STREAM_FC_WINDOW_SIZE      "StreamRecvWindowDefault"
 #define QUIC_SETTING_STREAM_RECV_BUFFER_SIZE    "StreamRecvBufferDefault"
 #define QUIC_SETTING_CONN_FLOW_CONTROL_WINDOW   "ConnFlowControlWindow"
+#define QUIC_SETTING_STREAM_RECV_WINDOW_MAX     "StreamRecvWindowMax"
 
 #define QUIC_SETTING_MAX_BYTES_PER_KEY_PHASE    "MaxBytesPerKey"
+#define QUIC_SETTING_PEER_STREAM_COUNT_MAX      "PeerStreamCountMax"
 
 #define QUIC_SETTING_SERVER_RESUMPTION_LEVEL    "ResumptionLevel"
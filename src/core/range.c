@@ -6,7 +6,11 @@
 Abstract:
 
     A set of unique 64-bit values, stored as an array of subranges ordered from
-    smallest to largest.
+    smallest to largest. Once there are more than QUIC_RANGE_MAX_FLAT_LENGTH
+    subranges, the array is split into an ordered array of fixed size blocks
+    (essentially a two level B-tree), so that an insert or removal only moves
+    the subranges in one block, and a lookup by index or value is a binary
+    search of the blocks followed by one of the subranges in a block.
 
 --*/
 
@@ -24,6 +28,9 @@ QuicRangeInitialize(
     _Out_ QUIC_RANGE* Range
     )
 {
+    Range->Blocks = NULL;
+    Range->BlockCount = 0;
+    Range->BlockAllocLength = 0;
     Range->UsedLength = 0;
     Range->AllocLength = INITIAL_SUBRANGE_COUNT;
     Range->MaxAllocSize = MaxAllocSize;
@@ -39,13 +46,34 @@ QuicRangeInitialize(
     return (Range->SubRanges == NULL) ? QUIC_STATUS_OUT_OF_MEMORY : QUIC_STATUS_SUCCESS;
 }
 
+//
+// Frees all the blocks, but not the 'Blocks' array itself.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRangeBlocksFreeAll(
+    _Inout_ QUIC_RANGE* Range
+    )
+{
+    for (uint32_t i = 0; i < Range->BlockCount; ++i) {
+        QUIC_FREE(Range->Blocks[i].SubRanges);
+    }
+    Range->BlockCount = 0;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
 QuicRangeUninitialize(
     _In_ QUIC_RANGE* Range
     )
 {
-    QUIC_FREE(Range->SubRanges);
+    if (Range->Blocks != NULL) {
+        QuicRangeBlocksFreeAll(Range);
+        QUIC_FREE(Range->Blocks);
+    }
+    if (Range->SubRanges != NULL) {
+        QUIC_FREE(Range->SubRanges);
+    }
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -54,7 +82,452 @@ QuicRangeReset(
     _Inout_ QUIC_RANGE* Range
     )
 {
+    if (Range->Blocks != NULL) {
+        QuicRangeBlocksFreeAll(Range);
+    }
+    Range->UsedLength = 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicRangeTryReset(
+    _Inout_ QUIC_RANGE* Range
+    )
+{
+    if (Range->Blocks != NULL ||
+        Range->SubRanges == NULL ||
+        Range->AllocLength != INITIAL_SUBRANGE_COUNT) {
+        return FALSE;
+    }
     Range->UsedLength = 0;
+    return TRUE;
+}
+
+//
+// Returns the index of the block holding the subrange at the given index. An
+// index one past the last subrange maps to the last block.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicRangeBlocksFind(
+    _In_ const QUIC_RANGE* Range,
+    _In_ uint32_t Index
+    )
+{
+    uint32_t Lo = 0;
+    uint32_t Hi = Range->BlockCount;
+    while (Hi - Lo > 1) {
+        uint32_t Mid = Lo + (Hi - Lo) / 2;
+        if (Range->Blocks[Mid].Start <= Index) {
+            Lo = Mid;
+        } else {
+            Hi = Mid;
+        }
+    }
+    return Lo;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_SUBRANGE*
+QuicRangeBlocksGet(
+    _In_ const QUIC_RANGE* Range,
+    _In_ uint32_t Index
+    )
+{
+    QUIC_DBG_ASSERT(Index < Range->UsedLength);
+    const QUIC_RANGE_BLOCK* Block = Range->Blocks + QuicRangeBlocksFind(Range, Index);
+    return Block->SubRanges + (Index - Block->Start);
+}
+
+#if QUIC_RANGE_USE_BINARY_SEARCH
+_IRQL_requires_max_(DISPATCH_LEVEL)
+int
+QuicRangeBlocksSearch(
+    _In_ const QUIC_RANGE* Range,
+    _In_ const QUIC_RANGE_SEARCH_KEY* Key
+    )
+{
+    //
+    // Find the first block whose last subrange isn't completely below the key.
+    // Any overlapping subrange, or else the insert point, must be in it.
+    //
+    uint32_t Lo = 0;
+    uint32_t Hi = Range->BlockCount;
+    while (Lo < Hi) {
+        uint32_t Mid = Lo + (Hi - Lo) / 2;
+        const QUIC_RANGE_BLOCK* Block = Range->Blocks + Mid;
+        if (QuicRangeGetHigh(Block->SubRanges + Block->Count - 1) < Key->Low) {
+            Lo = Mid + 1;
+        } else {
+            Hi = Mid;
+        }
+    }
+
+    if (Lo == Range->BlockCount) {
+        return FIND_INDEX_TO_INSERT_INDEX(Range->UsedLength);
+    }
+
+    const QUIC_RANGE_BLOCK* Block = Range->Blocks + Lo;
+    int Result = QuicRangeSearchSubRanges(Block->SubRanges, Block->Count, Key);
+    if (IS_FIND_INDEX(Result)) {
+        return (int)Block->Start + Result;
+    }
+    return FIND_INDEX_TO_INSERT_INDEX(Block->Start + INSERT_INDEX_TO_FIND_INDEX(Result));
+}
+#endif
+
+//
+// Recalculates the start index of every block from the given one on.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRangeBlocksUpdateStarts(
+    _Inout_ QUIC_RANGE* Range,
+    _In_ uint32_t BlockIndex
+    )
+{
+    uint32_t Start =
+        BlockIndex == 0 ?
+            0 :
+            Range->Blocks[BlockIndex - 1].Start + Range->Blocks[BlockIndex - 1].Count;
+    for (uint32_t i = BlockIndex; i < Range->BlockCount; ++i) {
+        Range->Blocks[i].Start = Start;
+        Start += Range->Blocks[i].Count;
+    }
+}
+
+//
+// Inserts a new, empty block at the given index in the 'Blocks' array.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Success_(return != NULL)
+QUIC_RANGE_BLOCK*
+QuicRangeBlocksInsertBlock(
+    _Inout_ QUIC_RANGE* Range,
+    _In_ uint32_t BlockIndex
+    )
+{
+    QUIC_DBG_ASSERT(BlockIndex <= Range->BlockCount);
+
+    if (Range->BlockCount == Range->BlockAllocLength) {
+        uint32_t NewBlockAllocLength = Range->BlockAllocLength << 1;
+        QUIC_RANGE_BLOCK* NewBlocks =
+            QUIC_ALLOC_NONPAGED(sizeof(QUIC_RANGE_BLOCK) * NewBlockAllocLength);
+        if (NewBlocks == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "range blocks",
+                sizeof(QUIC_RANGE_BLOCK) * NewBlockAllocLength);
+            return NULL;
+        }
+        memcpy(
+            NewBlocks,
+            Range->Blocks,
+            Range->BlockCount * sizeof(QUIC_RANGE_BLOCK));
+        QUIC_FREE(Range->Blocks);
+        Range->Blocks = NewBlocks;
+        Range->BlockAllocLength = NewBlockAllocLength;
+    }
+
+    QUIC_SUBRANGE* SubRanges =
+        QUIC_ALLOC_NONPAGED(sizeof(QUIC_SUBRANGE) * QUIC_RANGE_BLOCK_LENGTH);
+    if (SubRanges == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "range block",
+            sizeof(QUIC_SUBRANGE) * QUIC_RANGE_BLOCK_LENGTH);
+        return NULL;
+    }
+
+    memmove(
+        Range->Blocks + BlockIndex + 1,
+        Range->Blocks + BlockIndex,
+        (Range->BlockCount - BlockIndex) * sizeof(QUIC_RANGE_BLOCK));
+    Range->BlockCount++;
+
+    QUIC_RANGE_BLOCK* Block = Range->Blocks + BlockIndex;
+    Block->Start =
+        BlockIndex == 0 ?
+            0 :
+            Range->Blocks[BlockIndex - 1].Start + Range->Blocks[BlockIndex - 1].Count;
+    Block->Count = 0;
+    Block->SubRanges = SubRanges;
+    return Block;
+}
+
+//
+// Frees the block at the given index and removes it from the 'Blocks' array.
+// Doesn't update the start indexes of the following blocks.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRangeBlocksRemoveBlock(
+    _Inout_ QUIC_RANGE* Range,
+    _In_ uint32_t BlockIndex
+    )
+{
+    QUIC_FREE(Range->Blocks[BlockIndex].SubRanges);
+    memmove(
+        Range->Blocks + BlockIndex,
+        Range->Blocks + BlockIndex + 1,
+        (Range->BlockCount - BlockIndex - 1) * sizeof(QUIC_RANGE_BLOCK));
+    Range->BlockCount--;
+}
+
+//
+// Moves the subranges from the 'SubRanges' array into blocks.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Success_(return != FALSE)
+BOOLEAN
+QuicRangeConvertToBlocks(
+    _Inout_ QUIC_RANGE* Range
+    )
+{
+    QUIC_DBG_ASSERT(Range->Blocks == NULL);
+
+    const uint32_t BlockAllocLength =
+        2 * QUIC_RANGE_MAX_FLAT_LENGTH / QUIC_RANGE_BLOCK_LENGTH;
+    Range->Blocks = QUIC_ALLOC_NONPAGED(sizeof(QUIC_RANGE_BLOCK) * BlockAllocLength);
+    if (Range->Blocks == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "range blocks",
+            sizeof(QUIC_RANGE_BLOCK) * BlockAllocLength);
+        return FALSE;
+    }
+    Range->BlockCount = 0;
+    Range->BlockAllocLength = BlockAllocLength;
+
+    for (uint32_t i = 0; i < Range->UsedLength; i += QUIC_RANGE_BLOCK_LENGTH) {
+        QUIC_RANGE_BLOCK* Block = QuicRangeBlocksInsertBlock(Range, Range->BlockCount);
+        if (Block == NULL) {
+            QuicRangeBlocksFreeAll(Range);
+            QUIC_FREE(Range->Blocks);
+            Range->Blocks = NULL;
+            return FALSE;
+        }
+        Block->Count = QUIC_RANGE_BLOCK_LENGTH;
+        if (Block->Count > Range->UsedLength - i) {
+            Block->Count = Range->UsedLength - i;
+        }
+        memcpy(
+            Block->SubRanges,
+            Range->SubRanges + i,
+            Block->Count * sizeof(QUIC_SUBRANGE));
+    }
+
+    QUIC_FREE(Range->SubRanges);
+    Range->SubRanges = NULL;
+    return TRUE;
+}
+
+//
+// Moves the subranges from blocks back into a single 'SubRanges' array. Does
+// nothing on allocation failure; the blocks continue to work just as well.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRangeConvertToFlat(
+    _Inout_ QUIC_RANGE* Range
+    )
+{
+    const uint32_t NewAllocLength = QUIC_RANGE_MAX_FLAT_LENGTH / 2;
+    QUIC_DBG_ASSERT(Range->UsedLength <= NewAllocLength);
+    QUIC_SUBRANGE* NewSubRanges =
+        QUIC_ALLOC_NONPAGED(sizeof(QUIC_SUBRANGE) * NewAllocLength);
+    if (NewSubRanges == NULL) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < Range->BlockCount; ++i) {
+        memcpy(
+            NewSubRanges + Range->Blocks[i].Start,
+            Range->Blocks[i].SubRanges,
+            Range->Blocks[i].Count * sizeof(QUIC_SUBRANGE));
+    }
+
+    QuicRangeBlocksFreeAll(Range);
+    QUIC_FREE(Range->Blocks);
+    Range->Blocks = NULL;
+    Range->BlockAllocLength = 0;
+    Range->SubRanges = NewSubRanges;
+    Range->AllocLength = NewAllocLength;
+}
+
+//
+// Inserts a new subrange at the given index, when using blocks.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Success_(return != NULL)
+QUIC_SUBRANGE*
+QuicRangeBlocksInsert(
+    _Inout_ QUIC_RANGE* Range,
+    _In_ uint32_t Index
+    )
+{
+    QUIC_DBG_ASSERT(Index <= Range->UsedLength);
+
+    uint32_t BlockIndex = 0;
+    uint32_t Offset = 0;
+    QUIC_RANGE_BLOCK* Block;
+
+    if (Range->BlockCount == 0) {
+        if ((Block = QuicRangeBlocksInsertBlock(Range, 0)) == NULL) {
+            return NULL;
+        }
+
+    } else {
+        BlockIndex = QuicRangeBlocksFind(Range, Index);
+        Block = Range->Blocks + BlockIndex;
+        Offset = Index - Block->Start;
+
+        if (Offset == 0 && BlockIndex > 0 &&
+            Block[-1].Count < QUIC_RANGE_BLOCK_LENGTH) {
+            //
+            // The start of one block is also the end of the previous one, which
+            // has room.
+            //
+            Block--;
+            BlockIndex--;
+            Offset = Block->Count;
+        }
+
+        if (Block->Count == QUIC_RANGE_BLOCK_LENGTH) {
+            if (Offset == 0 || Offset == QUIC_RANGE_BLOCK_LENGTH) {
+                //
+                // Inserting at the edge of a full block (most commonly, appending
+                // to the end of the range), so start a new block next to it,
+                // instead of leaving two half full ones behind.
+                //
+                if (Offset != 0) {
+                    BlockIndex++;
+                    Offset = 0;
+                }
+                if ((Block = QuicRangeBlocksInsertBlock(Range, BlockIndex)) == NULL) {
+                    return NULL;
+                }
+
+            } else {
+                //
+                // Split the block in half and insert into the correct half.
+                //
+                const uint32_t Half = QUIC_RANGE_BLOCK_LENGTH / 2;
+                QUIC_RANGE_BLOCK* NewBlock =
+                    QuicRangeBlocksInsertBlock(Range, BlockIndex + 1);
+                if (NewBlock == NULL) {
+                    return NULL;
+                }
+                Block = Range->Blocks + BlockIndex; // The array may have moved.
+                memcpy(
+                    NewBlock->SubRanges,
+                    Block->SubRanges + Half,
+                    Half * sizeof(QUIC_SUBRANGE));
+                Block->Count = Half;
+                NewBlock->Count = Half;
+                NewBlock->Start = Block->Start + Half;
+                if (Offset > Half) {
+                    Block = NewBlock;
+                    BlockIndex++;
+                    Offset -= Half;
+                }
+            }
+        }
+    }
+
+    if (Offset < Block->Count) {
+        memmove(
+            Block->SubRanges + Offset + 1,
+            Block->SubRanges + Offset,
+            (Block->Count - Offset) * sizeof(QUIC_SUBRANGE));
+    }
+    Block->Count++;
+    Range->UsedLength++;
+    for (uint32_t i = BlockIndex + 1; i < Range->BlockCount; ++i) {
+        Range->Blocks[i].Start++;
+    }
+
+    return Block->SubRanges + Offset;
+}
+
+//
+// Merges the block after the given one into it, if they both fit in half a
+// block. This keeps the average block at least a quarter full.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRangeBlocksTryMerge(
+    _Inout_ QUIC_RANGE* Range,
+    _In_ uint32_t BlockIndex
+    )
+{
+    if (BlockIndex + 1 >= Range->BlockCount) {
+        return;
+    }
+
+    QUIC_RANGE_BLOCK* Block = Range->Blocks + BlockIndex;
+    const QUIC_RANGE_BLOCK* Next = Block + 1;
+    if (Block->Count + Next->Count > QUIC_RANGE_BLOCK_LENGTH / 2) {
+        return;
+    }
+
+    memcpy(
+        Block->SubRanges + Block->Count,
+        Next->SubRanges,
+        Next->Count * sizeof(QUIC_SUBRANGE));
+    Block->Count += Next->Count;
+    QuicRangeBlocksRemoveBlock(Range, BlockIndex + 1);
+}
+
+//
+// Removes a number of subranges, when using blocks.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRangeBlocksRemove(
+    _Inout_ QUIC_RANGE* Range,
+    _In_ uint32_t Index,
+    _In_ uint32_t Count
+    )
+{
+    const uint32_t FirstBlockIndex = QuicRangeBlocksFind(Range, Index);
+    uint32_t BlockIndex = FirstBlockIndex;
+    uint32_t Offset = Index - Range->Blocks[BlockIndex].Start;
+
+    Range->UsedLength -= Count;
+
+    while (Count != 0) {
+        QUIC_RANGE_BLOCK* Block = Range->Blocks + BlockIndex;
+        uint32_t Removed = Block->Count - Offset;
+        if (Removed > Count) {
+            Removed = Count;
+        }
+        if (Removed == Block->Count) {
+            QuicRangeBlocksRemoveBlock(Range, BlockIndex);
+        } else {
+            memmove(
+                Block->SubRanges + Offset,
+                Block->SubRanges + Offset + Removed,
+                (Block->Count - Offset - Removed) * sizeof(QUIC_SUBRANGE));
+            Block->Count -= Removed;
+            BlockIndex++;
+        }
+        Count -= Removed;
+        Offset = 0;
+    }
+
+    QuicRangeBlocksUpdateStarts(Range, FirstBlockIndex);
+    QuicRangeBlocksTryMerge(Range, FirstBlockIndex);
+    if (FirstBlockIndex > 0) {
+        QuicRangeBlocksTryMerge(Range, FirstBlockIndex - 1);
+    }
+
+    if (Range->UsedLength <= QUIC_RANGE_MAX_FLAT_LENGTH / 4) {
+        QuicRangeConvertToFlat(Range);
+    }
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -80,6 +553,21 @@ QuicRangeGrow(
         return FALSE;
     }
 
+    if (Range->Blocks != NULL || NewAllocLength > QUIC_RANGE_MAX_FLAT_LENGTH) {
+        //
+        // Too big for a single array. Use blocks, and just raise the limit on
+        // the number of subranges.
+        //
+        if (Range->Blocks == NULL && !QuicRangeConvertToBlocks(Range)) {
+            return FALSE;
+        }
+        if (QuicRangeBlocksInsert(Range, NextIndex) == NULL) {
+            return FALSE;
+        }
+        Range->AllocLength = NewAllocLength;
+        return TRUE;
+    }
+
     QUIC_SUBRANGE* NewSubRanges = QUIC_ALLOC_NONPAGED(NewAllocSize);
     if (NewSubRanges == NULL) {
         QuicTraceEvent(
@@ -123,6 +611,42 @@ QuicRangeGrow(
     return TRUE;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRangeShrink(
+    _Inout_ QUIC_RANGE* Range
+    )
+{
+    if (Range->UsedLength > INITIAL_SUBRANGE_COUNT) {
+        return;
+    }
+
+    if (Range->Blocks != NULL) {
+        QuicRangeConvertToFlat(Range);
+        if (Range->Blocks != NULL) {
+            return;
+        }
+    }
+
+    if (Range->AllocLength == INITIAL_SUBRANGE_COUNT) {
+        return;
+    }
+
+    QUIC_SUBRANGE* NewSubRanges =
+        QUIC_ALLOC_NONPAGED(sizeof(QUIC_SUBRANGE) * INITIAL_SUBRANGE_COUNT);
+    if (NewSubRanges == NULL) {
+        return; // The current array still works just as well.
+    }
+
+    memcpy(
+        NewSubRanges,
+        Range->SubRanges,
+        Range->UsedLength * sizeof(QUIC_SUBRANGE));
+    QUIC_FREE(Range->SubRanges);
+    Range->SubRanges = NewSubRanges;
+    Range->AllocLength = INITIAL_SUBRANGE_COUNT;
+}
+
 //
 // Reads the array for inserting a new subrange at the given index.
 //
@@ -146,6 +670,11 @@ QuicRangeMakeSpace(
             if (Range->MaxAllocSize == QUIC_MAX_RANGE_ALLOC_SIZE ||
                 *Index == 0) {
                 return NULL;
+            } else if (Range->Blocks != NULL) {
+                if (QuicRangeBlocksInsert(Range, *Index) == NULL) {
+                    return NULL;
+                }
+                QuicRangeBlocksRemove(Range, 0, 1);
             } else if (*Index > 1) {
                 memmove(
                     Range->SubRanges,
@@ -154,6 +683,8 @@ QuicRangeMakeSpace(
             }
             (*Index)--; // Actually going to be inserting 1 before where requested.
         }
+    } else if (Range->Blocks != NULL) {
+        return QuicRangeBlocksInsert(Range, *Index);
     } else {
         if (*Index == 0) {
             memmove(
@@ -173,7 +704,7 @@ QuicRangeMakeSpace(
         Range->UsedLength++; // For the new write.
     }
 
-    return Range->SubRanges + *Index;
+    return QuicRangeGet(Range, *Index);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -187,6 +718,14 @@ QuicRangeRemoveSubranges(
     QUIC_DBG_ASSERT(Count > 0);
     QUIC_DBG_ASSERT(Index + Count <= Range->UsedLength);
 
+    if (Range->Blocks != NULL) {
+        //
+        // Subranges may have moved between blocks (or back to a single array).
+        //
+        QuicRangeBlocksRemove(Range, Index, Count);
+        return TRUE;
+    }
+
     if (Index + Count < Range->UsedLength) {
         memmove(
             Range->SubRanges + Index,
@@ -401,22 +940,22 @@ QuicRangeRemoveRange(
     //
 
     uint32_t i;
-    QUIC_SUBRANGE* Sub = NULL;
-    QUIC_SUBRANGE* Test;
+    QUIC_SUBRANGE* Sub;
+    QUIC_RANGE_SEARCH_KEY Key = { Low, Low + Count - 1 };
 
     //
     // Find the leftmost overlapping subrange.
     //
-    for (i = 0; (Test = QuicRangeGetSafe(Range, i)) != NULL; i++) {
-        if (Test->Low < Low + Count &&
-            Test->Low + Test->Count > Low) {
-            Sub = Test;
-            break;
-        }
-    }
-    if (Sub == NULL) {
+    int Result = QuicRangeSearch(Range, &Key);
+    if (IS_INSERT_INDEX(Result)) {
         return TRUE;
     }
+    i = (uint32_t)Result;
+    while ((Sub = QuicRangeGetSafe(Range, i - 1)) != NULL &&
+            QuicRangeCompare(&Key, Sub) == 0) {
+        --i;
+    }
+    Sub = QuicRangeGet(Range, i);
 
     if (Sub->Low + Sub->Count > Low + Count &&
         Sub->Low < Low) {
@@ -426,11 +965,12 @@ QuicRangeRemoveRange(
         // and the second part will be handled by the "left edge
         // overlaps" case.
         //
+        QUIC_SUBRANGE Copy = *Sub; // Sub may move when making space.
         QUIC_SUBRANGE* NewSub = QuicRangeMakeSpace(Range, &i);
         if (NewSub == NULL) {
             return FALSE;
         }
-        *NewSub = *Sub;
+        *NewSub = Copy;
         Sub = NewSub;
     }
 
@@ -8,6 +8,22 @@
 #define QUIC_RANGE_NO_MAX_ALLOC_SIZE    UINT32_MAX
 #define QUIC_RANGE_USE_BINARY_SEARCH    1
 
+//
+// The most subranges stored in a single contiguous array. Past this, inserting
+// or removing a subrange near the front means moving many kilobytes of memory,
+// so the subranges are split into fixed size blocks instead, and only the rest
+// of one block needs to move.
+//
+#define QUIC_RANGE_MAX_FLAT_LENGTH      512
+
+//
+// The number of subranges in a single block.
+//
+#define QUIC_RANGE_BLOCK_LENGTH         64
+
+QUIC_STATIC_ASSERT(IS_POWER_OF_TWO(QUIC_RANGE_MAX_FLAT_LENGTH), L"Must be power of two");
+QUIC_STATIC_ASSERT(QUIC_RANGE_BLOCK_LENGTH < QUIC_RANGE_MAX_FLAT_LENGTH, L"Blocks must be smaller than the flat array");
+
 typedef struct QUIC_SUBRANGE {
 
     uint64_t Low;
@@ -36,21 +52,54 @@ QuicRangeGetHigh(
     return Sub->Low + Sub->Count - 1;
 }
 
+typedef struct QUIC_RANGE_BLOCK {
+
+    //
+    // The index (in the whole range) of the first subrange in this block.
+    //
+    uint32_t Start;
+
+    //
+    // The number of used subranges in the block. Never zero.
+    //
+    uint32_t Count;
+
+    _Field_size_(QUIC_RANGE_BLOCK_LENGTH)
+    QUIC_SUBRANGE* SubRanges;
+
+} QUIC_RANGE_BLOCK;
+
 typedef struct QUIC_RANGE {
 
     //
-    // Array of subranges that represent the set of intervals.
+    // Array of subranges that represent the set of intervals. NULL when the
+    // subranges are stored in 'Blocks' instead.
     //
-    _Field_size_(AllocLength)
+    _Field_size_opt_(AllocLength)
     QUIC_SUBRANGE* SubRanges;
 
     //
-    // The number of currently used subranges in the 'SubRanges' array.
+    // Array of blocks, ordered from smallest to largest, that hold the
+    // subranges once there are too many for a single array. NULL until then.
+    //
+    _Field_size_opt_(BlockAllocLength)
+    QUIC_RANGE_BLOCK* Blocks;
+
+    //
+    // The number of used and allocated entries in the 'Blocks' array.
+    //
+    uint32_t BlockCount;
+    uint32_t BlockAllocLength;
+
+    //
+    // The number of currently used subranges.
     //
     uint32_t UsedLength;
 
     //
-    // The number of allocated subranges in the 'SubRanges' array.
+    // The number of allocated subranges in the 'SubRanges' array. When using
+    // blocks, this is only the limit on the number of subranges, which grows
+    // the same way the array would have.
     //
     _Field_range_(1, QUIC_MAX_RANGE_ALLOC_SIZE)
     uint32_t AllocLength;
@@ -63,6 +112,28 @@ typedef struct QUIC_RANGE {
 
 } QUIC_RANGE;
 
+//
+// Returns the subrange at the given index when the subranges are stored in
+// blocks. O(log(n / QUIC_RANGE_BLOCK_LENGTH))
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_SUBRANGE*
+QuicRangeBlocksGet(
+    _In_ const QUIC_RANGE* Range,
+    _In_ uint32_t Index
+    );
+
+//
+// Searches blocks for a subrange overlapping the key. Same return values as
+// QuicRangeSearch.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+int
+QuicRangeBlocksSearch(
+    _In_ const QUIC_RANGE* Range,
+    _In_ const QUIC_RANGE_SEARCH_KEY* Key
+    );
+
 //
 // Returns the number of subranges in the range.
 //
@@ -85,6 +156,9 @@ QuicRangeGet(
     _In_ uint32_t Index
     )
 {
+    if (Range->Blocks != NULL) {
+        return QuicRangeBlocksGet(Range, Index);
+    }
     return &Range->SubRanges[Index];
 }
 
@@ -99,7 +173,7 @@ QuicRangeGetSafe(
     _In_ uint32_t Index
     )
 {
-    return Index < QuicRangeSize(Range) ? &Range->SubRanges[Index] : NULL;
+    return Index < QuicRangeSize(Range) ? QuicRangeGet(Range, Index) : NULL;
 }
 
 //
@@ -139,20 +213,21 @@ QuicRangeCompare(
 
 //
 // O(log(n))
-// Does a binary search to find *a* subrange that overlaps the search key passed
-// into the function. There is no guarentee which subrange is returned if
-// multiple overlap the search.
+// Does a binary search of an array of subranges to find *a* subrange that
+// overlaps the search key passed into the function. There is no guarentee
+// which subrange is returned if multiple overlap the search.
 //
 inline
 int
-QuicRangeSearch(
-    _In_ const QUIC_RANGE* Range,
+QuicRangeSearchSubRanges(
+    _In_reads_(Length) const QUIC_SUBRANGE* SubRanges,
+    _In_ uint32_t Length,
     _In_ const QUIC_RANGE_SEARCH_KEY* Key
     )
 {
-    uint32_t Num = Range->UsedLength;
+    uint32_t Num = Length;
     uint32_t Lo = 0;
-    uint32_t Hi = Range->UsedLength - 1;
+    uint32_t Hi = Length - 1;
     uint32_t Mid = 0;
     uint32_t Half;
     int Result = 0;
@@ -160,7 +235,7 @@ QuicRangeSearch(
     while (Lo <= Hi) {
         if ((Half = Num / 2) != 0) {
             Mid = Lo + (Num & 1 ? Half : (Half - 1));
-            if ((Result = QuicRangeCompare(Key, QuicRangeGet(Range, Mid))) == 0) {
+            if ((Result = QuicRangeCompare(Key, &SubRanges[Mid])) == 0) {
                 return (int)Mid;
             } else if (Result < 0) {
                 Hi = Mid - 1;
@@ -170,7 +245,7 @@ QuicRangeSearch(
                 Num = Half;
             }
         } else if (Num) {
-            if ((Result = QuicRangeCompare(Key, QuicRangeGet(Range, Lo))) == 0) {
+            if ((Result = QuicRangeCompare(Key, &SubRanges[Lo])) == 0) {
                 return (int)Lo;
             } else if (Result < 0) {
                 return FIND_INDEX_TO_INSERT_INDEX(Lo);
@@ -188,6 +263,25 @@ QuicRangeSearch(
             FIND_INDEX_TO_INSERT_INDEX(Mid);
 }
 
+//
+// O(log(n))
+// Does a binary search to find *a* subrange that overlaps the search key passed
+// into the function. There is no guarentee which subrange is returned if
+// multiple overlap the search.
+//
+inline
+int
+QuicRangeSearch(
+    _In_ const QUIC_RANGE* Range,
+    _In_ const QUIC_RANGE_SEARCH_KEY* Key
+    )
+{
+    if (Range->Blocks != NULL) {
+        return QuicRangeBlocksSearch(Range, Key);
+    }
+    return QuicRangeSearchSubRanges(Range->SubRanges, Range->UsedLength, Key);
+}
+
 #else
 
 //
@@ -239,6 +333,27 @@ QuicRangeReset(
     _Inout_ QUIC_RANGE* Range
     );
 
+//
+// Removes all values, but only if the range still has just its initial
+// allocation, so it can be reused as if freshly initialized. Returns FALSE,
+// and leaves the range as is, otherwise.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicRangeTryReset(
+    _Inout_ QUIC_RANGE* Range
+    );
+
+//
+// Reallocates the subranges at the initial size, if they fit, to give back the
+// memory of a range that grew large earlier. Does nothing on failure.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRangeShrink(
+    _Inout_ QUIC_RANGE* Range
+    );
+
 //
 // O(n)      when QUIC_RANGE_USE_BINARY_SEARCH == 0
 // O(log(n)) when QUIC_RANGE_USE_BINARY_SEARCH == 1
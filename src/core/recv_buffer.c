@@ -13,6 +13,15 @@ Abstract:
     only resize the buffer infrequently, for instance by resizing exponentially,
     or try to resize when few bytes are buffered.
 
+    Alternatively, the buffer can be backed by a ring of fixed size chunks
+    allocated from a pool (used by streams). In this mode, growing the buffer
+    just appends new chunks and draining frees the chunks at the front, so
+    bytes are never moved once written. Reads return one buffer per chunk.
+    Chunks are only allocated as data is written and all of them go back to
+    the pool once the buffer is drained, so an idle stream holds no receive
+    memory, and the chunks currently allocated are what's counted against the
+    library's memory budget.
+
     There are two size variables, AllocBufferLength and VirtualBufferLength.
     The first indicates the length of the physical buffer that has been
     allocated. The second indicates the maximum size the physical buffer is
@@ -24,7 +33,15 @@ Abstract:
 
     When physical buffer space runs out, assuming more 'virtual' space is
     available, the physical buffer will be reallocated and copied over.
-    Physical buffer space always doubles in size as it grows.
+    Physical buffer space always doubles in size as it grows. In chunked mode,
+    only as many chunks as are needed are added instead.
+
+    After a burst, the buffer doesn't keep its peak allocation. Whenever a drain
+    leaves no more than a quarter of the physical buffer in use, it is shrunk
+    (copying what's left) back toward its initial size. In chunked mode, the
+    chunks themselves are already returned as they are drained, so only the
+    array of chunk pointers is shrunk. Growing doubles and shrinking needs the
+    buffer to be three quarters empty, so a steady flow doesn't thrash.
 
     The VirtualBufferLength is what is used to report the maximum allowed
     stream offset to the peer. Again, if the application drains at a fast
@@ -38,7 +55,9 @@ Abstract:
     commit. We must always be willing/able to allocate the buffer length
     advertised to the peer.
 
-    Currently, only growing the virtual buffer length is supported.
+    The virtual buffer length may also shrink, as long as it still covers all
+    the data already buffered; the caller must make sure it still covers the
+    maximum offset already reported to the peer.
 
 --*/
 
@@ -47,13 +66,119 @@ Abstract:
 #include "recv_buffer.c.clog.h"
 #endif
 
+//
+// Returns the chunk at the given index, relative to the first chunk.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint8_t*
+QuicRecvBufferGetChunk(
+    _In_ const QUIC_RECV_BUFFER* RecvBuffer,
+    _In_ uint32_t Index
+    )
+{
+    QUIC_DBG_ASSERT(Index < RecvBuffer->ChunkCount);
+    return
+        RecvBuffer->Chunks[
+            (RecvBuffer->ChunkRingStart + Index) % RecvBuffer->ChunkRingLength];
+}
+
+//
+// Frees the first chunk of the buffer.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRecvBufferFreeFirstChunk(
+    _In_ QUIC_RECV_BUFFER* RecvBuffer
+    )
+{
+    QUIC_DBG_ASSERT(RecvBuffer->ChunkCount != 0);
+    QuicPoolFree(
+        RecvBuffer->ChunkPool,
+        RecvBuffer->Chunks[RecvBuffer->ChunkRingStart]);
+    RecvBuffer->ChunkRingStart =
+        (RecvBuffer->ChunkRingStart + 1) % RecvBuffer->ChunkRingLength;
+    RecvBuffer->ChunkCount--;
+    RecvBuffer->AllocBufferLength -= QUIC_RECV_BUFFER_CHUNK_SIZE;
+    InterlockedExchangeAdd64(
+        (int64_t*)&MsQuicLib.CurrentRecvBufferMemoryUsage,
+        -1 * (int64_t)QUIC_RECV_BUFFER_CHUNK_SIZE);
+}
+
+//
+// Appends chunks until the buffer can hold the given number of bytes, counted
+// from the start of the first chunk. Existing chunks never move; only the
+// (small) array of chunk pointers may have to be reallocated.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicRecvBufferAddChunks(
+    _In_ QUIC_RECV_BUFFER* RecvBuffer,
+    _In_ uint32_t RequiredLength
+    )
+{
+    uint32_t RequiredCount =
+        (RequiredLength + QUIC_RECV_BUFFER_CHUNK_SIZE - 1) / QUIC_RECV_BUFFER_CHUNK_SIZE;
+
+    if (RequiredCount > RecvBuffer->ChunkRingLength) {
+        uint32_t NewRingLength =
+            RecvBuffer->ChunkRingLength == 0 ?
+                QUIC_RECV_BUFFER_MIN_CHUNK_RING_LENGTH : RecvBuffer->ChunkRingLength;
+        while (NewRingLength < RequiredCount) {
+            NewRingLength <<= 1;
+        }
+
+        uint8_t** NewChunks = QUIC_ALLOC_NONPAGED(NewRingLength * sizeof(uint8_t*));
+        if (NewChunks == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "recv_buffer chunk array",
+                NewRingLength * sizeof(uint8_t*));
+            return QUIC_STATUS_OUT_OF_MEMORY;
+        }
+
+        for (uint32_t i = 0; i < RecvBuffer->ChunkCount; ++i) {
+            NewChunks[i] = QuicRecvBufferGetChunk(RecvBuffer, i);
+        }
+        if (RecvBuffer->Chunks != NULL) {
+            QUIC_FREE(RecvBuffer->Chunks);
+        }
+        RecvBuffer->Chunks = NewChunks;
+        RecvBuffer->ChunkRingLength = NewRingLength;
+        RecvBuffer->ChunkRingStart = 0;
+    }
+
+    while (RecvBuffer->ChunkCount < RequiredCount) {
+        uint8_t* Chunk = QuicPoolAlloc(RecvBuffer->ChunkPool);
+        if (Chunk == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "recv_buffer chunk",
+                QUIC_RECV_BUFFER_CHUNK_SIZE);
+            return QUIC_STATUS_OUT_OF_MEMORY;
+        }
+        RecvBuffer->Chunks[
+            (RecvBuffer->ChunkRingStart + RecvBuffer->ChunkCount) % RecvBuffer->ChunkRingLength] =
+            Chunk;
+        RecvBuffer->ChunkCount++;
+        RecvBuffer->AllocBufferLength += QUIC_RECV_BUFFER_CHUNK_SIZE;
+        InterlockedExchangeAdd64(
+            (int64_t*)&MsQuicLib.CurrentRecvBufferMemoryUsage,
+            (int64_t)QUIC_RECV_BUFFER_CHUNK_SIZE);
+    }
+
+    return QUIC_STATUS_SUCCESS;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_STATUS
 QuicRecvBufferInitialize(
     _Inout_ QUIC_RECV_BUFFER* RecvBuffer,
     _In_ uint32_t AllocBufferLength,
     _In_ uint32_t VirtualBufferLength,
-    _In_ BOOLEAN CopyOnDrain
+    _In_ BOOLEAN CopyOnDrain,
+    _In_opt_ QUIC_POOL* ChunkPool
     )
 {
     QUIC_STATUS Status;
@@ -61,16 +186,35 @@ QuicRecvBufferInitialize(
     QUIC_DBG_ASSERT(AllocBufferLength != 0 && (AllocBufferLength & (AllocBufferLength - 1)) == 0);       // Power of 2
     QUIC_DBG_ASSERT(VirtualBufferLength != 0 && (VirtualBufferLength & (VirtualBufferLength - 1)) == 0); // Power of 2
     QUIC_DBG_ASSERT(AllocBufferLength <= VirtualBufferLength);
+    QUIC_DBG_ASSERT(ChunkPool == NULL || !CopyOnDrain);
+
+    RecvBuffer->ChunkPool = ChunkPool;
+    RecvBuffer->Chunks = NULL;
+    RecvBuffer->ChunkRingLength = 0;
+    RecvBuffer->ChunkRingStart = 0;
+    RecvBuffer->ChunkCount = 0;
+
+    if (ChunkPool == NULL) {
+        RecvBuffer->Buffer = QUIC_ALLOC_NONPAGED(AllocBufferLength);
+        if (RecvBuffer->Buffer == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "recv_buffer",
+                AllocBufferLength);
+            Status = QUIC_STATUS_OUT_OF_MEMORY;
+            goto Error;
+        }
+        RecvBuffer->AllocBufferLength = AllocBufferLength;
+        RecvBuffer->MinAllocBufferLength = AllocBufferLength;
 
-    RecvBuffer->Buffer = QUIC_ALLOC_NONPAGED(AllocBufferLength);
-    if (RecvBuffer->Buffer == NULL) {
-        QuicTraceEvent(
-            AllocFailure,
-            "Allocation of '%s' failed. (%llu bytes)",
-            "recv_buffer",
-            AllocBufferLength);
-        Status = QUIC_STATUS_OUT_OF_MEMORY;
-        goto Error;
+    } else {
+        //
+        // Chunks are added by the first write.
+        //
+        RecvBuffer->Buffer = NULL;
+        RecvBuffer->AllocBufferLength = 0;
+        RecvBuffer->MinAllocBufferLength = 0;
     }
 
     Status =
@@ -83,21 +227,35 @@ QuicRecvBufferInitialize(
             "Allocation of '%s' failed. (%llu bytes)",
             "recv_buffer written ranged",
             QUIC_MAX_RANGE_ALLOC_SIZE);
-        QUIC_FREE(RecvBuffer->Buffer);
         goto Error;
     }
 
-    RecvBuffer->AllocBufferLength = AllocBufferLength;
     RecvBuffer->VirtualBufferLength = VirtualBufferLength;
     RecvBuffer->BufferStart = 0;
     RecvBuffer->BaseOffset = 0;
     RecvBuffer->CopyOnDrain = CopyOnDrain;
     RecvBuffer->ExternalBufferReference = FALSE;
     RecvBuffer->OldBuffer = NULL;
+    RecvBuffer->ExternalData = NULL;
+    RecvBuffer->ExternalLength = 0;
     Status = QUIC_STATUS_SUCCESS;
 
 Error:
 
+    if (QUIC_FAILED(Status)) {
+        if (RecvBuffer->Buffer != NULL) {
+            QUIC_FREE(RecvBuffer->Buffer);
+            RecvBuffer->Buffer = NULL;
+        }
+        while (RecvBuffer->ChunkCount != 0) {
+            QuicRecvBufferFreeFirstChunk(RecvBuffer);
+        }
+        if (RecvBuffer->Chunks != NULL) {
+            QUIC_FREE(RecvBuffer->Chunks);
+            RecvBuffer->Chunks = NULL;
+        }
+    }
+
     return Status;
 }
 
@@ -108,14 +266,64 @@ QuicRecvBufferUninitialize(
     )
 {
     QuicRangeUninitialize(&RecvBuffer->WrittenRanges);
-    QUIC_FREE(RecvBuffer->Buffer);
-    RecvBuffer->Buffer = NULL;
+    if (RecvBuffer->Buffer != NULL) {
+        QUIC_FREE(RecvBuffer->Buffer);
+        RecvBuffer->Buffer = NULL;
+    }
+    while (RecvBuffer->ChunkCount != 0) {
+        QuicRecvBufferFreeFirstChunk(RecvBuffer);
+    }
+    if (RecvBuffer->Chunks != NULL) {
+        QUIC_FREE(RecvBuffer->Chunks);
+        RecvBuffer->Chunks = NULL;
+    }
+    RecvBuffer->ExternalData = NULL;
     if (RecvBuffer->OldBuffer != NULL) {
         QUIC_FREE(RecvBuffer->OldBuffer);
         RecvBuffer->OldBuffer = NULL;
     }
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicRecvBufferTryReset(
+    _Inout_ QUIC_RECV_BUFFER* RecvBuffer
+    )
+{
+    if (RecvBuffer->ChunkPool == NULL ||
+        RecvBuffer->OldBuffer != NULL ||
+        RecvBuffer->ExternalBufferReference ||
+        RecvBuffer->ExternalData != NULL ||
+        !QuicRangeTryReset(&RecvBuffer->WrittenRanges)) {
+        return FALSE;
+    }
+
+    while (RecvBuffer->ChunkCount != 0) {
+        QuicRecvBufferFreeFirstChunk(RecvBuffer);
+    }
+    return TRUE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRecvBufferReinitialize(
+    _Inout_ QUIC_RECV_BUFFER* RecvBuffer,
+    _In_ uint32_t VirtualBufferLength
+    )
+{
+    QUIC_DBG_ASSERT(VirtualBufferLength != 0 && (VirtualBufferLength & (VirtualBufferLength - 1)) == 0); // Power of 2
+    QUIC_DBG_ASSERT(RecvBuffer->ChunkPool != NULL);
+    QUIC_DBG_ASSERT(RecvBuffer->ChunkCount == 0);
+
+    RecvBuffer->BufferStart = 0;
+    RecvBuffer->VirtualBufferLength = VirtualBufferLength;
+    RecvBuffer->BaseOffset = 0;
+    RecvBuffer->CopyOnDrain = FALSE;
+    RecvBuffer->ExternalBufferReference = FALSE;
+    RecvBuffer->ExternalData = NULL;
+    RecvBuffer->ExternalLength = 0;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 uint64_t
 QuicRecvBufferGetTotalLength(
@@ -145,6 +353,27 @@ QuicRecvBufferGetSpan(
     return (uint32_t)(QuicRecvBufferGetTotalLength(RecvBuffer) - RecvBuffer->BaseOffset);
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicRecvBufferRelease(
+    _In_ QUIC_RECV_BUFFER* RecvBuffer
+    )
+{
+    if (RecvBuffer->ChunkPool != NULL ||
+        RecvBuffer->Buffer == NULL ||
+        RecvBuffer->ExternalBufferReference ||
+        RecvBuffer->ExternalData != NULL ||
+        QuicRecvBufferGetSpan(RecvBuffer) != 0) {
+        return FALSE;
+    }
+
+    QUIC_FREE(RecvBuffer->Buffer);
+    RecvBuffer->Buffer = NULL;
+    RecvBuffer->AllocBufferLength = 0;
+    RecvBuffer->BufferStart = 0;
+    return TRUE;
+}
+
 //
 // Allocates a new contiguous buffer of the target size and copies the bytes
 // into it.
@@ -175,7 +404,11 @@ QuicRecvBufferResize(
 
         uint32_t LengthTillWrap = RecvBuffer->AllocBufferLength - RecvBuffer->BufferStart;
 
-        if (Span <= LengthTillWrap) {
+        if (Span == 0) {
+            //
+            // Nothing to copy (and the old buffer may have been released).
+            //
+        } else if (Span <= LengthTillWrap) {
             QuicCopyMemory(
                 NewBuffer,
                 RecvBuffer->Buffer + RecvBuffer->BufferStart,
@@ -191,7 +424,11 @@ QuicRecvBufferResize(
                 Span - LengthTillWrap);
         }
 
-        if (RecvBuffer->ExternalBufferReference && RecvBuffer->OldBuffer == NULL) {
+        if (RecvBuffer->Buffer == NULL) {
+            //
+            // The buffer was released while empty.
+            //
+        } else if (RecvBuffer->ExternalBufferReference && RecvBuffer->OldBuffer == NULL) {
             RecvBuffer->OldBuffer = RecvBuffer->Buffer;
         } else {
             QUIC_FREE(RecvBuffer->Buffer);
@@ -207,6 +444,40 @@ Error:
     return Status;
 }
 
+//
+// Makes sure there is physical space for all bytes up to the given absolute
+// stream offset.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicRecvBufferReserve(
+    _In_ QUIC_RECV_BUFFER* RecvBuffer,
+    _In_ uint64_t AbsoluteLength
+    )
+{
+    uint32_t RelativeLength = (uint32_t)(AbsoluteLength - RecvBuffer->BaseOffset);
+
+    if (RecvBuffer->ChunkPool != NULL) {
+        if (RecvBuffer->BufferStart + RelativeLength <= RecvBuffer->AllocBufferLength) {
+            return QUIC_STATUS_SUCCESS;
+        }
+        return QuicRecvBufferAddChunks(RecvBuffer, RecvBuffer->BufferStart + RelativeLength);
+    }
+
+    if (RelativeLength <= RecvBuffer->AllocBufferLength) {
+        return QUIC_STATUS_SUCCESS;
+    }
+
+    uint32_t NewBufferLength =
+        RecvBuffer->AllocBufferLength == 0 ?
+            QUIC_MIN_RECV_BUFFER_ALLOC_SIZE : RecvBuffer->AllocBufferLength << 1;
+    while (RelativeLength > NewBufferLength) {
+        NewBufferLength <<= 1;
+    }
+
+    return QuicRecvBufferResize(RecvBuffer, NewBufferLength);
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
 QuicRecvBufferSetVirtualBufferLength(
@@ -214,7 +485,8 @@ QuicRecvBufferSetVirtualBufferLength(
     _In_ uint32_t NewLength
     )
 {
-    QUIC_FRE_ASSERT(NewLength >= RecvBuffer->VirtualBufferLength); // Don't support decrease yet.
+    QUIC_FRE_ASSERT(
+        RecvBuffer->BaseOffset + NewLength >= QuicRecvBufferGetTotalLength(RecvBuffer));
     RecvBuffer->VirtualBufferLength = NewLength;
 }
 
@@ -238,6 +510,86 @@ QuicRecvBufferAlreadyReadData(
     return BufferOffset + BufferLength <= RecvBuffer->BaseOffset;
 }
 
+//
+// Copies bytes into the circular buffer at the given offset relative to
+// BaseOffset, accounting for wrap around.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRecvBufferCopyIn(
+    _In_ QUIC_RECV_BUFFER* RecvBuffer,
+    _In_ uint32_t RelativeOffset,
+    _In_ uint16_t BufferLength,
+    _In_reads_bytes_(BufferLength) uint8_t const* Buffer
+    )
+{
+    if (RecvBuffer->ChunkPool != NULL) {
+        //
+        // Walk the chunks, starting with the one that holds the first byte.
+        //
+        uint32_t Position = RecvBuffer->BufferStart + RelativeOffset;
+        uint32_t ChunkIndex = Position / QUIC_RECV_BUFFER_CHUNK_SIZE;
+        uint32_t ChunkOffset = Position % QUIC_RECV_BUFFER_CHUNK_SIZE;
+        while (BufferLength != 0) {
+            uint16_t CopyLength =
+                (uint16_t)min(BufferLength, QUIC_RECV_BUFFER_CHUNK_SIZE - ChunkOffset);
+            QuicCopyMemory(
+                QuicRecvBufferGetChunk(RecvBuffer, ChunkIndex) + ChunkOffset,
+                Buffer,
+                CopyLength);
+            Buffer += CopyLength;
+            BufferLength -= CopyLength;
+            ChunkIndex++;
+            ChunkOffset = 0;
+        }
+        return;
+    }
+
+    //
+    // Calculate the actual starting point in the buffer that we will write to,
+    // accounting for wrap around.
+    //
+    uint32_t WriteBufferStart = (RecvBuffer->BufferStart + RelativeOffset) % RecvBuffer->AllocBufferLength;
+
+    //
+    // Copy the data; but make sure to account for wrap around on the circular buffer.
+    //
+    if (WriteBufferStart + BufferLength > RecvBuffer->AllocBufferLength) {
+
+        //
+        // The copy must be split into two parts.
+        //
+        uint16_t Part1Len = (uint16_t)(RecvBuffer->AllocBufferLength - WriteBufferStart);
+        uint16_t Part2Len = BufferLength - Part1Len;
+
+        //
+        // Copy the first part, which is at the end of the circular buffer.
+        //
+        QuicCopyMemory(
+            RecvBuffer->Buffer + WriteBufferStart,
+            Buffer,
+            Part1Len);
+
+        //
+        // Copy the second part, which is at the beginning of the circular buffer.
+        //
+        QuicCopyMemory(
+            RecvBuffer->Buffer,
+            Buffer + Part1Len,
+            Part2Len);
+
+    } else {
+
+        //
+        // Single copy case, because it doesn't overlap the end.
+        //
+        QuicCopyMemory(
+            RecvBuffer->Buffer + WriteBufferStart,
+            Buffer,
+            BufferLength);
+    }
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_STATUS
 QuicRecvBufferWrite(
@@ -261,7 +613,6 @@ QuicRecvBufferWrite(
     *ReadyToRead = FALSE;
 
     uint32_t RelativeOffset;
-    uint32_t WriteBufferStart;
 
     uint64_t AbsoluteLength = BufferOffset + BufferLength;
 
@@ -300,25 +651,12 @@ QuicRecvBufferWrite(
     }
 
     //
-    // Check to see if the input buffer is trying to write beyond the
-    // currently allocated length.
+    // Make room for the new data, if it goes beyond the currently allocated
+    // length.
     //
-    if (AbsoluteLength > RecvBuffer->BaseOffset + RecvBuffer->AllocBufferLength) {
-
-        //
-        // Make room for the new data.
-        //
-
-        uint32_t NewBufferLength = RecvBuffer->AllocBufferLength << 1;
-        while (AbsoluteLength > RecvBuffer->BaseOffset + NewBufferLength) {
-            NewBufferLength <<= 1;
-        }
-
-        Status = QuicRecvBufferResize(RecvBuffer, NewBufferLength);
-
-        if (QUIC_FAILED(Status)) {
-            goto Error;
-        }
+    Status = QuicRecvBufferReserve(RecvBuffer, AbsoluteLength);
+    if (QUIC_FAILED(Status)) {
+        goto Error;
     }
 
     //
@@ -358,55 +696,98 @@ QuicRecvBufferWrite(
         RelativeOffset = (uint32_t)(BufferOffset - RecvBuffer->BaseOffset);
     }
 
-    //
-    // Calculate the actual starting point in the buffer that we will write to,
-    // accounting for wrap around.
-    //
-    WriteBufferStart = (RecvBuffer->BufferStart + RelativeOffset) % RecvBuffer->AllocBufferLength;
+    QuicRecvBufferCopyIn(RecvBuffer, RelativeOffset, BufferLength, Buffer);
 
     //
-    // Copy the data; but make sure to account for wrap around on the circular buffer.
+    // We have data to read if we just wrote to the front of the buffer.
     //
-    if (WriteBufferStart + BufferLength > RecvBuffer->AllocBufferLength) {
+    *ReadyToRead = UpdatedRange->Low == 0;
 
-        //
-        // The copy must be split into two parts.
-        //
-        uint16_t Part1Len = (uint16_t)(RecvBuffer->AllocBufferLength - WriteBufferStart);
-        uint16_t Part2Len = BufferLength - Part1Len;
+    Status = QUIC_STATUS_SUCCESS;
 
-        //
-        // Copy the first part, which is at the end of the circular buffer.
-        //
-        QuicCopyMemory(
-            RecvBuffer->Buffer + WriteBufferStart,
-            Buffer,
-            Part1Len);
+Error:
 
-        //
-        // Copy the second part, which is at the beginning of the circular buffer.
-        //
-        QuicCopyMemory(
-            RecvBuffer->Buffer,
-            Buffer + Part1Len,
-            Part2Len);
+    return Status;
+}
 
-    } else {
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicRecvBufferWriteExternal(
+    _In_ QUIC_RECV_BUFFER* RecvBuffer,
+    _In_ uint64_t BufferOffset,
+    _In_ uint16_t BufferLength,
+    _In_reads_bytes_(BufferLength) uint8_t const* Buffer,
+    _Inout_ uint64_t* WriteLength,
+    _Out_ BOOLEAN* ReadyToRead,
+    _Out_ BOOLEAN* Referenced
+    )
+{
+    QUIC_STATUS Status;
+    BOOLEAN WrittenRangesUpdated;
+
+    QUIC_DBG_ASSERT(BufferLength != 0);
+
+    *Referenced = FALSE;
 
+    if (BufferOffset != RecvBuffer->BaseOffset ||
+        RecvBuffer->ExternalBufferReference ||
+        RecvBuffer->ExternalData != NULL ||
+        QuicRecvBufferHasUnreadData(RecvBuffer)) {
         //
-        // Single copy case, because it doesn't overlap the end.
+        // Only the next in-order bytes of an otherwise empty buffer can be
+        // referenced. Everything else is copied.
         //
-        QuicCopyMemory(
-            RecvBuffer->Buffer + WriteBufferStart,
-            Buffer,
-            BufferLength);
+        return
+            QuicRecvBufferWrite(
+                RecvBuffer,
+                BufferOffset,
+                BufferLength,
+                Buffer,
+                WriteLength,
+                ReadyToRead);
     }
 
+    *ReadyToRead = FALSE;
+
     //
-    // We have data to read if we just wrote to the front of the buffer.
+    // Nothing is buffered, so all the bytes are new. Apply the same stream and
+    // connection flow control checks as a regular write.
     //
-    *ReadyToRead = UpdatedRange->Low == 0;
+    if (BufferLength > RecvBuffer->VirtualBufferLength ||
+        BufferLength > *WriteLength) {
+        Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+        goto Error;
+    }
+    *WriteLength = BufferLength;
+
+    //
+    // Make sure there is physical space for the bytes, in case they aren't
+    // all drained and must be copied in later. The buffer is empty, so this
+    // doesn't copy anything.
+    //
+    Status = QuicRecvBufferReserve(RecvBuffer, BufferOffset + BufferLength);
+    if (QUIC_FAILED(Status)) {
+        goto Error;
+    }
 
+    if (!QuicRangeAddRange(
+            &RecvBuffer->WrittenRanges,
+            BufferOffset,
+            BufferLength,
+            &WrittenRangesUpdated)) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "recv_buffer range",
+            0);
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Error;
+    }
+
+    RecvBuffer->ExternalData = Buffer;
+    RecvBuffer->ExternalLength = BufferLength;
+    *ReadyToRead = TRUE;
+    *Referenced = TRUE;
     Status = QUIC_STATUS_SUCCESS;
 
 Error:
@@ -431,6 +812,20 @@ QuicRecvBufferRead(
 
     QUIC_DBG_ASSERT(!RecvBuffer->ExternalBufferReference);
 
+    if (RecvBuffer->ExternalData != NULL) {
+        //
+        // The next bytes are still in the writer's memory. Hand them out
+        // directly.
+        //
+        RecvBuffer->ExternalBufferReference = TRUE;
+        *BufferOffset = RecvBuffer->BaseOffset;
+        QUIC_DBG_ASSERT(*BufferCount >= 1);
+        *BufferCount = 1;
+        Buffers[0].Length = RecvBuffer->ExternalLength;
+        Buffers[0].Buffer = (uint8_t*)RecvBuffer->ExternalData;
+        return TRUE;
+    }
+
     //
     // Query if the front of the buffer has been written.
     //
@@ -451,7 +846,28 @@ QuicRecvBufferRead(
     RecvBuffer->ExternalBufferReference = TRUE;
     *BufferOffset = RecvBuffer->BaseOffset;
 
-    if (RecvBuffer->BufferStart + WrittenRangeLength > RecvBuffer->AllocBufferLength) {
+    if (RecvBuffer->ChunkPool != NULL) {
+        //
+        // Return one buffer per chunk, up to as many as the caller has room
+        // for. Anything beyond that is returned on the next read.
+        //
+        uint32_t Count = 0;
+        uint32_t ChunkIndex = 0;
+        uint32_t ChunkOffset = RecvBuffer->BufferStart;
+        while (WrittenRangeLength != 0 && Count < *BufferCount) {
+            uint32_t Length =
+                (uint32_t)min(WrittenRangeLength, (uint64_t)(QUIC_RECV_BUFFER_CHUNK_SIZE - ChunkOffset));
+            Buffers[Count].Length = Length;
+            Buffers[Count].Buffer = QuicRecvBufferGetChunk(RecvBuffer, ChunkIndex) + ChunkOffset;
+            WrittenRangeLength -= Length;
+            Count++;
+            ChunkIndex++;
+            ChunkOffset = 0;
+        }
+        QUIC_DBG_ASSERT(Count != 0);
+        *BufferCount = Count;
+
+    } else if (RecvBuffer->BufferStart + WrittenRangeLength > RecvBuffer->AllocBufferLength) {
         //
         // Circular buffer wrap around case.
         //
@@ -472,6 +888,77 @@ QuicRecvBufferRead(
     return TRUE;
 }
 
+//
+// Gives back memory left over from an earlier burst, once a drain has left the
+// buffer mostly empty. Failing to allocate the smaller buffer isn't an error;
+// the current one is just kept.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRecvBufferShrink(
+    _In_ QUIC_RECV_BUFFER* RecvBuffer
+    )
+{
+    QUIC_DBG_ASSERT(!RecvBuffer->ExternalBufferReference);
+
+    if (RecvBuffer->ChunkPool != NULL) {
+        if (RecvBuffer->ChunkRingLength <= QUIC_RECV_BUFFER_MIN_CHUNK_RING_LENGTH ||
+            RecvBuffer->ChunkCount > RecvBuffer->ChunkRingLength / QUIC_RECV_BUFFER_SHRINK_RATIO) {
+            return;
+        }
+
+        if (RecvBuffer->ChunkCount == 0) {
+            //
+            // The next write allocates a new minimum sized array.
+            //
+            QUIC_FREE(RecvBuffer->Chunks);
+            RecvBuffer->Chunks = NULL;
+            RecvBuffer->ChunkRingLength = 0;
+            RecvBuffer->ChunkRingStart = 0;
+            return;
+        }
+
+        uint32_t NewRingLength = RecvBuffer->ChunkRingLength;
+        while (NewRingLength > QUIC_RECV_BUFFER_MIN_CHUNK_RING_LENGTH &&
+               RecvBuffer->ChunkCount <= NewRingLength / QUIC_RECV_BUFFER_SHRINK_RATIO) {
+            NewRingLength >>= 1;
+        }
+
+        uint8_t** NewChunks = QUIC_ALLOC_NONPAGED(NewRingLength * sizeof(uint8_t*));
+        if (NewChunks == NULL) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < RecvBuffer->ChunkCount; ++i) {
+            NewChunks[i] = QuicRecvBufferGetChunk(RecvBuffer, i);
+        }
+        QUIC_FREE(RecvBuffer->Chunks);
+        RecvBuffer->Chunks = NewChunks;
+        RecvBuffer->ChunkRingLength = NewRingLength;
+        RecvBuffer->ChunkRingStart = 0;
+        return;
+    }
+
+    if (RecvBuffer->Buffer == NULL ||
+        RecvBuffer->ExternalData != NULL ||
+        RecvBuffer->AllocBufferLength <= RecvBuffer->MinAllocBufferLength) {
+        return;
+    }
+
+    uint32_t Span = QuicRecvBufferGetSpan(RecvBuffer);
+    if (Span > RecvBuffer->AllocBufferLength / QUIC_RECV_BUFFER_SHRINK_RATIO) {
+        return;
+    }
+
+    uint32_t NewBufferLength = RecvBuffer->AllocBufferLength;
+    while (NewBufferLength > RecvBuffer->MinAllocBufferLength &&
+           Span <= NewBufferLength / QUIC_RECV_BUFFER_SHRINK_RATIO) {
+        NewBufferLength >>= 1;
+    }
+
+    (void)QuicRecvBufferResize(RecvBuffer, NewBufferLength);
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 BOOLEAN
 QuicRecvBufferDrain(
@@ -487,6 +974,23 @@ QuicRecvBufferDrain(
         RecvBuffer->OldBuffer = NULL;
     }
 
+    if (RecvBuffer->ExternalData != NULL) {
+        QUIC_DBG_ASSERT(BufferLength <= RecvBuffer->ExternalLength);
+        if (BufferLength < RecvBuffer->ExternalLength) {
+            //
+            // The caller's memory is about to go away, so copy whatever wasn't
+            // drained into its place in the buffer.
+            //
+            QuicRecvBufferCopyIn(
+                RecvBuffer,
+                (uint32_t)BufferLength,
+                RecvBuffer->ExternalLength - (uint16_t)BufferLength,
+                RecvBuffer->ExternalData + BufferLength);
+        }
+        RecvBuffer->ExternalData = NULL;
+        RecvBuffer->ExternalLength = 0;
+    }
+
     if (BufferLength == 0) {
         return FALSE;
     }
@@ -496,13 +1000,27 @@ QuicRecvBufferDrain(
 
     if (RecvBuffer->BaseOffset == TotalWrittenLength) {
         //
-        // All buffer has been drained. Just reset start back to beginning.
+        // All buffer has been drained. Just reset start back to beginning,
+        // returning all the chunks to the pool until the next write.
         //
+        while (RecvBuffer->ChunkCount != 0) {
+            QuicRecvBufferFreeFirstChunk(RecvBuffer);
+        }
         RecvBuffer->BufferStart = 0;
+        QuicRecvBufferShrink(RecvBuffer);
         return TRUE;
     }
 
-    if (RecvBuffer->CopyOnDrain) {
+    if (RecvBuffer->ChunkPool != NULL) {
+        //
+        // Release any chunks that have been completely drained.
+        //
+        RecvBuffer->BufferStart += (uint32_t)BufferLength;
+        while (RecvBuffer->BufferStart >= QUIC_RECV_BUFFER_CHUNK_SIZE) {
+            QuicRecvBufferFreeFirstChunk(RecvBuffer);
+            RecvBuffer->BufferStart -= QUIC_RECV_BUFFER_CHUNK_SIZE;
+        }
+    } else if (RecvBuffer->CopyOnDrain) {
         QUIC_DBG_ASSERT(RecvBuffer->BufferStart == 0);
         //
         // Copy remaining bytes in the buffer to the beginning.
@@ -520,6 +1038,8 @@ QuicRecvBufferDrain(
             (uint32_t)(RecvBuffer->BufferStart + BufferLength) % RecvBuffer->AllocBufferLength;
     }
 
+    QuicRecvBufferShrink(RecvBuffer);
+
     //
     // Not all data was drained, but that doesn't mean it wasn't drained up to
     // the first gap. Get the length of the first sub range and compare that to
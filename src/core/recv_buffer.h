@@ -27,16 +27,40 @@ typedef struct QUIC_RECV_BUFFER {
     uint8_t * OldBuffer;
 
     //
-    // Circular buffer used for storing the writes.
+    // Circular buffer used for storing the writes. Not used if ChunkPool is
+    // set.
     //
     uint8_t * Buffer;
 
     //
-    // Length of memory allocated for 'Buffer'. Dynamically grows up to
-    // VirtualBufferLength.
+    // Pool of fixed size (QUIC_RECV_BUFFER_CHUNK_SIZE) chunks. If set, the
+    // buffer is made up of a list of these chunks instead of a single
+    // contiguous allocation. It then grows without copying, indicates one
+    // QUIC_BUFFER per chunk and holds no chunks while empty.
+    //
+    QUIC_POOL* ChunkPool;
+
+    //
+    // Circular array of the chunks, in stream order. The first chunk starts
+    // BufferStart bytes before BaseOffset.
+    //
+    uint8_t** Chunks;
+    uint32_t ChunkRingLength;
+    uint32_t ChunkRingStart;
+    uint32_t ChunkCount;
+
+    //
+    // Length of memory allocated for 'Buffer' (or all the chunks). Dynamically
+    // grows up to VirtualBufferLength and shrinks back as data is drained.
     //
     uint32_t AllocBufferLength;
 
+    //
+    // The length 'Buffer' was initially allocated with. Draining never shrinks
+    // the contiguous buffer below this.
+    //
+    uint32_t MinAllocBufferLength;
+
     //
     // Length of the buffer indicated to peers.
     //
@@ -48,7 +72,7 @@ typedef struct QUIC_RECV_BUFFER {
     uint64_t BaseOffset;
 
     //
-    // Start of the head in the circular 'Buffer'.
+    // Start of the head in the circular 'Buffer', or in the first chunk.
     //
     uint32_t BufferStart;
 
@@ -57,6 +81,13 @@ typedef struct QUIC_RECV_BUFFER {
     //
     QUIC_RANGE WrittenRanges;
 
+    //
+    // In-order bytes at BaseOffset that were written without being copied into
+    // 'Buffer'. They still live in the caller's memory until the next drain.
+    //
+    const uint8_t* ExternalData;
+    uint16_t ExternalLength;
+
 } QUIC_RECV_BUFFER;
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -65,7 +96,8 @@ QuicRecvBufferInitialize(
     _Inout_ QUIC_RECV_BUFFER* RecvBuffer,
     _In_ uint32_t AllocBufferLength,
     _In_ uint32_t VirtualBufferLength,
-    _In_ BOOLEAN CopyOnDrain
+    _In_ BOOLEAN CopyOnDrain,
+    _In_opt_ QUIC_POOL* ChunkPool
     );
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -74,6 +106,39 @@ QuicRecvBufferUninitialize(
     _In_ QUIC_RECV_BUFFER* RecvBuffer
     );
 
+//
+// Empties a chunked buffer that's no longer used, returning all its chunks to
+// the pool, so it can be reinitialized with QuicRecvBufferReinitialize. Returns
+// FALSE if the buffer can't be reused, in which case it must be uninitialized.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicRecvBufferTryReset(
+    _Inout_ QUIC_RECV_BUFFER* RecvBuffer
+    );
+
+//
+// Brings a buffer emptied by QuicRecvBufferTryReset to the state
+// QuicRecvBufferInitialize leaves a chunked buffer in.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicRecvBufferReinitialize(
+    _Inout_ QUIC_RECV_BUFFER* RecvBuffer,
+    _In_ uint32_t VirtualBufferLength
+    );
+
+//
+// Frees the memory of a contiguous buffer that doesn't currently hold any
+// data. It's allocated again by the next write. Returns TRUE if the memory was
+// freed.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicRecvBufferRelease(
+    _In_ QUIC_RECV_BUFFER* RecvBuffer
+    );
+
 //
 // Get the buffer's total length from 0.
 //
@@ -84,7 +149,8 @@ QuicRecvBufferGetTotalLength(
     );
 
 //
-// Changes the buffer's virtual buffer length.
+// Changes the buffer's virtual buffer length. It can't be made smaller than
+// the data currently buffered.
 //
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
@@ -130,6 +196,26 @@ QuicRecvBufferWrite(
     _Out_ BOOLEAN* ReadyToRead
     );
 
+//
+// Same as QuicRecvBufferWrite, except that if the bytes are the next in-order
+// bytes and nothing else is buffered, they aren't copied. Instead, the buffer
+// references the caller's memory, which must stay valid until the next call to
+// QuicRecvBufferDrain. Any of those bytes not drained are copied in then.
+//
+// Referenced is set to TRUE if the caller's memory is now referenced.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicRecvBufferWriteExternal(
+    _In_ QUIC_RECV_BUFFER* RecvBuffer,
+    _In_ uint64_t BufferOffset,
+    _In_ uint16_t BufferLength,
+    _In_reads_bytes_(BufferLength) uint8_t const* Buffer,
+    _Inout_ uint64_t* WriteLength,
+    _Out_ BOOLEAN* ReadyToRead,
+    _Out_ BOOLEAN* Referenced
+    );
+
 //
 // Returns a pointer into the buffer for data ready to be delivered
 // to the client.
@@ -65,9 +65,11 @@ MsQuicRegistrationOpen(
     Registration->Type = QUIC_HANDLE_TYPE_REGISTRATION;
     Registration->ClientContext = NULL;
     Registration->NoPartitioning = FALSE;
+    Registration->ProcessorSet = FALSE;
     Registration->ExecProfile = Config == NULL ? QUIC_EXECUTION_PROFILE_LOW_LATENCY : Config->ExecutionProfile;
     Registration->CidPrefixLength = 0;
     Registration->CidPrefix = NULL;
+    QuicZeroMemory(&Registration->Histograms, sizeof(Registration->Histograms));
     QuicLockInitialize(&Registration->Lock);
     QuicListInitializeHead(&Registration->Sessions);
     QuicRundownInitialize(&Registration->SecConfigRundown);
@@ -80,6 +82,10 @@ MsQuicRegistrationOpen(
     }
 
     uint16_t WorkerThreadFlags = 0;
+    uint32_t BusyPollUs = 0;
+    BOOLEAN RunToCompletion = FALSE;
+    BOOLEAN External = FALSE;
+    Registration->MaxDrainTimeUs = MsQuicLib.Settings.MaxDrainTimeUs;
     switch (Registration->ExecProfile) {
     default:
     case QUIC_EXECUTION_PROFILE_LOW_LATENCY:
@@ -90,6 +96,12 @@ MsQuicRegistrationOpen(
         WorkerThreadFlags =
             QUIC_THREAD_FLAG_SET_IDEAL_PROC |
             QUIC_THREAD_FLAG_SET_AFFINITIZE;
+        //
+        // Longer time slices mean fewer trips through the worker queue.
+        //
+        if (Registration->MaxDrainTimeUs <= UINT32_MAX / 4) {
+            Registration->MaxDrainTimeUs *= 4;
+        }
         break;
     case QUIC_EXECUTION_PROFILE_TYPE_SCAVENGER:
         WorkerThreadFlags = 0;
@@ -99,14 +111,52 @@ MsQuicRegistrationOpen(
         WorkerThreadFlags =
             QUIC_THREAD_FLAG_SET_IDEAL_PROC |
             QUIC_THREAD_FLAG_SET_AFFINITIZE;
+        //
+        // Shorter time slices bound how long one connection can delay the
+        // others on its worker.
+        //
+        Registration->MaxDrainTimeUs = (Registration->MaxDrainTimeUs + 3) / 4;
+        break;
+    case QUIC_EXECUTION_PROFILE_TYPE_BUSY_POLL:
+        WorkerThreadFlags =
+            QUIC_THREAD_FLAG_SET_IDEAL_PROC |
+            QUIC_THREAD_FLAG_SET_AFFINITIZE;
+        BusyPollUs = MsQuicLib.Settings.BusyPollUs;
+        //
+        // The datapath is shared by all registrations, so once any
+        // registration asks for busy polling, its threads busy poll too.
+        //
+        QuicDataPathSetBusyPoll(MsQuicLib.Datapath, BusyPollUs);
+        break;
+    case QUIC_EXECUTION_PROFILE_TYPE_RUN_TO_COMPLETION:
+        //
+        // The flags are only used if a worker has to fall back to its own
+        // thread.
+        //
+        WorkerThreadFlags =
+            QUIC_THREAD_FLAG_SET_IDEAL_PROC |
+            QUIC_THREAD_FLAG_SET_AFFINITIZE;
+        RunToCompletion = TRUE;
+        break;
+    case QUIC_EXECUTION_PROFILE_TYPE_EXTERNAL:
+        //
+        // The app runs the workers from its own threads.
+        //
+        WorkerThreadFlags = 0;
+        External = TRUE;
         break;
     }
 
+    Registration->WorkerThreadFlags = WorkerThreadFlags;
     Status =
         QuicWorkerPoolInitialize(
             Registration,
             WorkerThreadFlags,
+            BusyPollUs,
+            RunToCompletion,
+            External,
             Registration->NoPartitioning ? 1 : MsQuicLib.PartitionCount,
+            NULL,
             &Registration->WorkerPool);
     if (QUIC_FAILED(Status)) {
         goto Error;
@@ -327,6 +377,49 @@ MsQuicSecConfigDelete(
         "[ api] Exit");
 }
 
+//
+// Returns the worker for the connection, based on its partition. With a
+// processor set, that's the worker on the partition's processor, if there is
+// one, or else one of the workers; and the connection's partition is moved to
+// the worker's processor, so that the connection IDs it issues steer its
+// datagrams to the worker's processor too.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_WORKER*
+QuicRegistrationGetWorker(
+    _In_ QUIC_REGISTRATION* Registration,
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_WORKER_POOL* WorkerPool = Registration->WorkerPool;
+    if (Registration->NoPartitioning) {
+        return &WorkerPool->Workers[0];
+    }
+
+    uint8_t PartitionIndex = QuicPartitionIdGetIndex(Connection->PartitionID);
+    if (!Registration->ProcessorSet) {
+        return &WorkerPool->Workers[PartitionIndex];
+    }
+
+    QUIC_WORKER* Worker =
+        &WorkerPool->Workers[PartitionIndex % WorkerPool->WorkerCount];
+    for (uint8_t i = 0; i < WorkerPool->WorkerCount; ++i) {
+        if (WorkerPool->Workers[i].IdealProcessor % MsQuicLib.PartitionCount ==
+                PartitionIndex) {
+            Worker = &WorkerPool->Workers[i];
+            break;
+        }
+    }
+
+    uint8_t WorkerPartitionIndex =
+        (uint8_t)(Worker->IdealProcessor % MsQuicLib.PartitionCount);
+    if (WorkerPartitionIndex != PartitionIndex) {
+        Connection->PartitionID = QuicPartitionIdCreate(WorkerPartitionIndex);
+    }
+
+    return Worker;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_CONNECTION_ACCEPT_RESULT
 QuicRegistrationAcceptConnection(
@@ -337,23 +430,29 @@ QuicRegistrationAcceptConnection(
     if (QuicRegistrationIsSplitPartitioning(Registration)) {
         //
         // TODO - Figure out how to check to see if hyper-threading was enabled first
-        // TODO - Constrain PartitionID to the same NUMA node.
         //
         // When hyper-threading is enabled, better bulk throughput can sometimes
         // be gained by sharing the same physical core, but not the logical one.
-        // The shared one is always one greater than the RSS core.
+        // The shared one is always one greater than the RSS core. It's not
+        // used if it's on another NUMA node than the RSS core.
         //
-        Connection->PartitionID += QUIC_MAX_THROUGHPUT_PARTITION_OFFSET;
+        uint8_t SharedPartitionID =
+            Connection->PartitionID + QUIC_MAX_THROUGHPUT_PARTITION_OFFSET;
+        if (QuicProcNumaNode(QuicPartitionIdGetIndex(SharedPartitionID)) ==
+            QuicProcNumaNode(QuicPartitionIdGetIndex(Connection->PartitionID))) {
+            Connection->PartitionID = SharedPartitionID;
+        }
     }
 
-    uint8_t Index =
-        Registration->NoPartitioning ? 0 : QuicPartitionIdGetIndex(Connection->PartitionID);
-
     //
     // TODO - Look for other worker instead if the proposed worker is overloaded?
     //
 
-    if (QuicWorkerIsOverloaded(&Registration->WorkerPool->Workers[Index])) {
+    QUIC_WORKER* Worker = QuicRegistrationGetWorker(Registration, Connection);
+    if (QuicWorkerIsOverloaded(Worker) ||
+        (Worker != Connection->Worker &&
+         !QuicWorkerCanAdmitHandshake(Worker, Connection->HandshakeIsResumption))) {
+        QuicPerfCounterIncrement(QUIC_PERF_COUNTER_WORKER_OVERLOADED);
         return QUIC_CONNECTION_REJECT_BUSY;
     } else {
         return QUIC_CONNECTION_ACCEPT;
@@ -367,15 +466,12 @@ QuicRegistrationQueueNewConnection(
     _In_ QUIC_CONNECTION* Connection
     )
 {
-    uint8_t Index =
-        Registration->NoPartitioning ? 0 : QuicPartitionIdGetIndex(Connection->PartitionID);
-
     //
     // TODO - Look for other worker instead if the proposed worker is overloaded?
     //
 
     QuicWorkerAssignConnection(
-        &Registration->WorkerPool->Workers[Index],
+        QuicRegistrationGetWorker(Registration, Connection),
         Connection);
 }
 
@@ -426,6 +522,118 @@ QuicRegistrationParamSet(
         Status = QUIC_STATUS_SUCCESS;
         break;
 
+    case QUIC_PARAM_REGISTRATION_EXECUTION_CONTEXTS: {
+
+        QUIC_WORKER_POOL* WorkerPool = Registration->WorkerPool;
+        if (!WorkerPool->Workers[0].External) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
+
+        if (BufferLength == 0 ||
+            BufferLength % sizeof(QUIC_EXECUTION_CONTEXT_CONFIG) != 0) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        const QUIC_EXECUTION_CONTEXT_CONFIG* Configs =
+            (const QUIC_EXECUTION_CONTEXT_CONFIG*)Buffer;
+        uint32_t ConfigCount = BufferLength / sizeof(QUIC_EXECUTION_CONTEXT_CONFIG);
+
+        //
+        // Validate all the contexts belong to the registration before
+        // changing any of them.
+        //
+        Status = QUIC_STATUS_SUCCESS;
+        for (uint32_t i = 0; i < ConfigCount; ++i) {
+            QUIC_WORKER* Worker = (QUIC_WORKER*)Configs[i].ExecutionContext;
+            if (Worker < WorkerPool->Workers ||
+                Worker >= WorkerPool->Workers + WorkerPool->WorkerCount ||
+                Worker != &WorkerPool->Workers[Worker - WorkerPool->Workers]) {
+                Status = QUIC_STATUS_INVALID_PARAMETER;
+                break;
+            }
+        }
+        if (QUIC_FAILED(Status)) {
+            break;
+        }
+
+        for (uint32_t i = 0; i < ConfigCount; ++i) {
+            QUIC_WORKER* Worker = (QUIC_WORKER*)Configs[i].ExecutionContext;
+            QuicDispatchLockAcquire(&Worker->Lock);
+            Worker->ExternalWakeContext = Configs[i].WakeContext;
+            Worker->ExternalWake = Configs[i].Wake;
+            QuicDispatchLockRelease(&Worker->Lock);
+        }
+
+        break;
+    }
+
+    case QUIC_PARAM_REGISTRATION_PROCESSORS: {
+
+        if (BufferLength == 0 ||
+            BufferLength % sizeof(uint16_t) != 0 ||
+            BufferLength / sizeof(uint16_t) > UINT8_MAX) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        const uint16_t* Processors = (const uint16_t*)Buffer;
+        uint8_t ProcessorCount = (uint8_t)(BufferLength / sizeof(uint16_t));
+
+        Status = QUIC_STATUS_SUCCESS;
+        for (uint8_t i = 0; i < ProcessorCount; ++i) {
+            if (Processors[i] >= QuicProcMaxCount() ||
+                Processors[i] > UINT8_MAX) {
+                Status = QUIC_STATUS_INVALID_PARAMETER;
+                break;
+            }
+        }
+        if (QUIC_FAILED(Status)) {
+            break;
+        }
+
+        //
+        // The workers are replaced by a new set, one per processor, hard
+        // affinitized to it. That's only possible while the registration has
+        // no sessions (and so no connections) using the current ones.
+        //
+        QUIC_WORKER_POOL* OldWorkerPool = NULL;
+        QuicLockAcquire(&Registration->Lock);
+        if (!QuicListIsEmpty(&Registration->Sessions) ||
+            Registration->WorkerPool->Workers[0].External ||
+            Registration->WorkerPool->Workers[0].RunToCompletion) {
+            Status = QUIC_STATUS_INVALID_STATE;
+        } else {
+            QUIC_WORKER_POOL* NewWorkerPool;
+            Status =
+                QuicWorkerPoolInitialize(
+                    Registration,
+                    Registration->WorkerThreadFlags |
+                        QUIC_THREAD_FLAG_SET_IDEAL_PROC |
+                        QUIC_THREAD_FLAG_SET_AFFINITIZE,
+                    Registration->WorkerPool->Workers[0].BusyPollUs,
+                    FALSE,
+                    FALSE,
+                    ProcessorCount,
+                    Processors,
+                    &NewWorkerPool);
+            if (QUIC_SUCCEEDED(Status)) {
+                OldWorkerPool = Registration->WorkerPool;
+                Registration->WorkerPool = NewWorkerPool;
+                Registration->NoPartitioning = FALSE;
+                Registration->ProcessorSet = TRUE;
+            }
+        }
+        QuicLockRelease(&Registration->Lock);
+
+        if (OldWorkerPool != NULL) {
+            QuicWorkerPoolUninitialize(OldWorkerPool);
+        }
+
+        break;
+    }
+
     default:
         Status = QUIC_STATUS_INVALID_PARAMETER;
         break;
@@ -471,6 +679,118 @@ QuicRegistrationParamGet(
         Status = QUIC_STATUS_SUCCESS;
         break;
 
+    case QUIC_PARAM_REGISTRATION_STATISTICS_HISTOGRAMS:
+
+        if (*BufferLength < sizeof(QUIC_STATISTICS_HISTOGRAMS)) {
+            *BufferLength = sizeof(QUIC_STATISTICS_HISTOGRAMS);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(QUIC_STATISTICS_HISTOGRAMS);
+        memcpy(Buffer, &Registration->Histograms, sizeof(QUIC_STATISTICS_HISTOGRAMS));
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_REGISTRATION_EXECUTION_CONTEXTS: {
+
+        QUIC_WORKER_POOL* WorkerPool = Registration->WorkerPool;
+        if (!WorkerPool->Workers[0].External) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
+
+        uint32_t Length =
+            WorkerPool->WorkerCount * sizeof(QUIC_EXECUTION_CONTEXT_CONFIG);
+        if (*BufferLength < Length) {
+            *BufferLength = Length;
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        QUIC_EXECUTION_CONTEXT_CONFIG* Configs = (QUIC_EXECUTION_CONTEXT_CONFIG*)Buffer;
+        for (uint8_t i = 0; i < WorkerPool->WorkerCount; ++i) {
+            QUIC_WORKER* Worker = &WorkerPool->Workers[i];
+            Configs[i].ExecutionContext = (QUIC_EXECUTION_CONTEXT*)Worker;
+            Configs[i].IdealProcessor = Worker->IdealProcessor;
+            Configs[i].Wake = Worker->ExternalWake;
+            Configs[i].WakeContext = Worker->ExternalWakeContext;
+        }
+        *BufferLength = Length;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
+    case QUIC_PARAM_REGISTRATION_WORKER_LOAD: {
+
+        QUIC_WORKER_POOL* WorkerPool = Registration->WorkerPool;
+        uint32_t Length = WorkerPool->WorkerCount * sizeof(QUIC_WORKER_LOAD);
+        if (*BufferLength < Length) {
+            *BufferLength = Length;
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        QUIC_WORKER_LOAD* Loads = (QUIC_WORKER_LOAD*)Buffer;
+        for (uint8_t i = 0; i < WorkerPool->WorkerCount; ++i) {
+            QUIC_WORKER* Worker = &WorkerPool->Workers[i];
+            Loads[i].IdealProcessor = Worker->IdealProcessor;
+            QuicDispatchLockAcquire(&Worker->Lock);
+            Loads[i].ProcessingTime = Worker->ProcessingTime;
+            memcpy(
+                Loads[i].TopConnections,
+                Worker->TopConnections,
+                sizeof(Worker->TopConnections));
+            QuicDispatchLockRelease(&Worker->Lock);
+        }
+        *BufferLength = Length;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
+    case QUIC_PARAM_REGISTRATION_PROCESSORS: {
+
+        QUIC_WORKER_POOL* WorkerPool = Registration->WorkerPool;
+        uint32_t Length = WorkerPool->WorkerCount * sizeof(uint16_t);
+        if (*BufferLength < Length) {
+            *BufferLength = Length;
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        uint16_t* Processors = (uint16_t*)Buffer;
+        for (uint8_t i = 0; i < WorkerPool->WorkerCount; ++i) {
+            Processors[i] = WorkerPool->Workers[i].IdealProcessor;
+        }
+        *BufferLength = Length;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
     default:
         Status = QUIC_STATUS_INVALID_PARAMETER;
         break;
@@ -35,11 +35,29 @@ typedef struct QUIC_REGISTRATION {
     //
     BOOLEAN NoPartitioning : 1;
 
+    //
+    // Indicates the registration's workers are dedicated to (and hard
+    // affinitized to) an app configured set of processors. See
+    // QUIC_PARAM_REGISTRATION_PROCESSORS.
+    //
+    BOOLEAN ProcessorSet : 1;
+
+    //
+    // The thread flags the registration's workers were created with.
+    //
+    uint16_t WorkerThreadFlags;
+
     //
     // App (optionally) configured execution profile.
     //
     QUIC_EXECUTION_PROFILE ExecProfile;
 
+    //
+    // The time budget (in microseconds) for each drain of one of the
+    // registration's connections, scaled for the execution profile.
+    //
+    uint32_t MaxDrainTimeUs;
+
     //
     // An app configured prefix for all connection IDs in this registration.
     //
@@ -71,6 +89,12 @@ typedef struct QUIC_REGISTRATION {
     //
     QUIC_RUNDOWN_REF ConnectionRundown;
 
+    //
+    // Histograms of all the registration's connections, added as each one is
+    // freed.
+    //
+    QUIC_STATISTICS_HISTOGRAMS Histograms;
+
     //
     // Rundown for all outstanding security configs.
     //
@@ -106,9 +130,12 @@ QuicRegistrationIsSplitPartitioning(
     // The shared core is always one greater than the RSS core.
     //
     // TODO - Figure out how to check to see if hyper-threading is enabled
-    // TODO - Constrain ++PartitionID to the same NUMA node.
     //
-    return Registration->ExecProfile == QUIC_EXECUTION_PROFILE_TYPE_MAX_THROUGHPUT;
+    // Not used with a processor set, where the app picks the cores.
+    //
+    return
+        !Registration->ProcessorSet &&
+        Registration->ExecProfile == QUIC_EXECUTION_PROFILE_TYPE_MAX_THROUGHPUT;
 }
 
 //
@@ -73,6 +73,8 @@ QuicSendApplySettings(
     )
 {
     Send->MaxData = Settings->ConnFlowControlWindow;
+    Send->MaxDataWindow = Settings->ConnFlowControlWindow;
+    Send->MaxDataSent = Settings->ConnFlowControlWindow;
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -94,6 +96,10 @@ QuicSendReset(
     QuicConnTimerCancel(
         QuicSendGetConnection(Send),
         QUIC_CONN_TIMER_PACING);
+    Send->Corked = FALSE;
+    QuicConnTimerCancel(
+        QuicSendGetConnection(Send),
+        QUIC_CONN_TIMER_CORK);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -134,6 +140,41 @@ QuicSendQueueFlush(
     }
 }
 
+//
+// Inserts the stream into the send queue, which is kept sorted by priority,
+// after all the streams of the same or higher priority.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSendInsertStream(
+    _In_ QUIC_SEND* Send,
+    _In_ QUIC_STREAM* Stream
+    )
+{
+    //
+    // Most streams share the same priority, so searching from the tail
+    // generally finds the insertion point immediately.
+    //
+    QUIC_LIST_ENTRY* Entry = Send->SendStreams.Blink;
+    while (Entry != &Send->SendStreams &&
+        QUIC_CONTAINING_RECORD(Entry, QUIC_STREAM, SendLink)->SendPriority < Stream->SendPriority) {
+        Entry = Entry->Blink;
+    }
+    QuicListInsertHead(Entry, &Stream->SendLink);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSendUpdateStreamPriority(
+    _In_ QUIC_SEND* Send,
+    _In_ QUIC_STREAM* Stream
+    )
+{
+    QUIC_DBG_ASSERT(Stream->SendLink.Flink != NULL);
+    QuicListEntryRemove(&Stream->SendLink);
+    QuicSendInsertStream(Send, Stream);
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicSendQueueFlushForStream(
@@ -144,22 +185,57 @@ QuicSendQueueFlushForStream(
 {
     if (!WasPreviouslyQueued) {
         //
-        // Not previously queued, so add the stream to the end of the queue.
+        // Not previously queued, so add the stream to the end of its priority
+        // level in the queue.
         //
         QUIC_DBG_ASSERT(Stream->SendLink.Flink == NULL);
-        QuicListInsertTail(&Send->SendStreams, &Stream->SendLink);
+        QuicSendInsertStream(Send, Stream);
         QuicStreamAddRef(Stream, QUIC_STREAM_REF_SEND);
     }
 
-    if (Stream->Connection->State.Started) {
+    if (Stream->Connection->State.Started && !Send->Corked) {
         //
         // Schedule the flush even if we didn't just queue the stream,
-        // because it may have been previously blocked.
+        // because it may have been previously blocked. Corked data is
+        // flushed by the CORK timer instead.
         //
         QuicSendQueueFlush(Send, REASON_STREAM_FLAGS);
     }
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSendSetCorked(
+    _In_ QUIC_SEND* Send,
+    _In_ BOOLEAN Corked
+    )
+{
+    QUIC_CONNECTION* Connection = QuicSendGetConnection(Send);
+
+    if (Corked) {
+        if (!Send->Corked) {
+            //
+            // Only the first corked write arms the timer, so the delay is
+            // bounded no matter how many writes follow.
+            //
+            Send->Corked = TRUE;
+            QuicConnTimerSetUs(
+                Connection,
+                QUIC_CONN_TIMER_CORK,
+                Send->CorkUs != 0 ? Send->CorkUs : QUIC_DEFAULT_SEND_CORK_US);
+        }
+
+    } else if (Send->Corked) {
+        //
+        // Streams already queued while corked wouldn't queue a flush for
+        // the new data, so flush everything now.
+        //
+        Send->Corked = FALSE;
+        QuicConnTimerCancel(Connection, QUIC_CONN_TIMER_CORK);
+        QuicSendQueueFlush(Send, REASON_STREAM_FLAGS);
+    }
+}
+
 #if DEBUG
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
@@ -447,6 +523,15 @@ QuicSendWriteFrames(
         }
     }
 
+    if (Builder->Metadata->FrameCount > PrevFrameCount &&
+        (Send->SendFlags & ~QUIC_CONN_SEND_FLAG_ACK) == 0) {
+        //
+        // Fast path for ACK-only packets (the most common control packet):
+        // nothing else is queued, so skip checking for all the other frames.
+        //
+        goto Exit;
+    }
+
     if (!IsCongestionControlBlocked &&
         Send->SendFlags & QUIC_CONN_SEND_FLAG_CRYPTO &&
         Builder->PacketType == QuicEncryptLevelToPacketType(QuicCryptoGetNextEncryptLevel(&Connection->Crypto))) {
@@ -489,6 +574,16 @@ QuicSendWriteFrames(
             Send->SendFlags &= ~(QUIC_CONN_SEND_FLAG_CONNECTION_CLOSE | QUIC_CONN_SEND_FLAG_APPLICATION_CLOSE);
             (void)QuicPacketBuilderAddFrame(
                 Builder, IsApplicationClose ? QUIC_FRAME_CONNECTION_CLOSE_1 : QUIC_FRAME_CONNECTION_CLOSE, FALSE);
+
+            if (Connection->State.NoDrain) {
+                //
+                // Don't wait for the peer's response. The shutdown complete
+                // notification is only indicated once the current operation
+                // (and so this send) is done.
+                //
+                Connection->State.ClosedRemotely = TRUE;
+                Connection->State.SendShutdownCompleteNotif = TRUE;
+            }
         } else {
             RanOutOfRoom = TRUE;
         }
@@ -562,6 +657,60 @@ QuicSendWriteFrames(
             }
         }
 
+        if (Builder->Metadata->Flags.KeyType == QUIC_PACKET_KEY_1_RTT &&
+            Send->SendFlags & QUIC_CONN_SEND_FLAG_ACK_FREQUENCY) {
+
+            //
+            // Ask the peer to wait for the requested number of packets, but
+            // no longer than a quarter of the RTT, before acknowledging.
+            //
+            QUIC_ACK_FREQUENCY_EX Frame;
+            Frame.SequenceNumber = Connection->SendAckFreqSeqNum;
+            Frame.PacketTolerance = Connection->PeerPacketTolerance;
+            Frame.UpdateMaxAckDelay =
+                min(
+                    max(Connection->Paths[0].SmoothedRtt / 4,
+                        Connection->PeerTransportParams.MinAckDelay),
+                    MS_TO_US(Connection->PeerTransportParams.MaxAckDelay));
+            Frame.IgnoreOrder = FALSE;
+
+            if (QuicAckFrequencyFrameEncode(
+                    &Frame,
+                    &Builder->DatagramLength,
+                    AvailableBufferLength,
+                    Builder->Datagram->Buffer)) {
+
+                Connection->SendAckFreqSeqNum++;
+                Send->SendFlags &= ~QUIC_CONN_SEND_FLAG_ACK_FREQUENCY;
+                Builder->Metadata->Frames[
+                    Builder->Metadata->FrameCount].ACK_FREQUENCY.Sequence =
+                        Frame.SequenceNumber;
+                if (QuicPacketBuilderAddFrame(Builder, QUIC_FRAME_ACK_FREQUENCY, TRUE)) {
+                    return TRUE;
+                }
+            } else {
+                RanOutOfRoom = TRUE;
+            }
+        }
+
+        if (Builder->Metadata->Flags.KeyType == QUIC_PACKET_KEY_1_RTT &&
+            Send->SendFlags & QUIC_CONN_SEND_FLAG_IMMEDIATE_ACK) {
+
+            if (Builder->DatagramLength + QuicVarIntSize(QUIC_FRAME_IMMEDIATE_ACK) <= AvailableBufferLength) {
+                Builder->DatagramLength =
+                    (uint16_t)(QuicVarIntEncode(
+                        QUIC_FRAME_IMMEDIATE_ACK,
+                        Builder->Datagram->Buffer + Builder->DatagramLength) -
+                    Builder->Datagram->Buffer);
+                Send->SendFlags &= ~QUIC_CONN_SEND_FLAG_IMMEDIATE_ACK;
+                if (QuicPacketBuilderAddFrame(Builder, QUIC_FRAME_IMMEDIATE_ACK, TRUE)) {
+                    return TRUE;
+                }
+            } else {
+                RanOutOfRoom = TRUE;
+            }
+        }
+
         if (Send->SendFlags & QUIC_CONN_SEND_FLAG_DATA_BLOCKED) {
 
             QUIC_DATA_BLOCKED_EX Frame = { Send->OrderedStreamBytesSent };
@@ -592,6 +741,7 @@ QuicSendWriteFrames(
                     (uint8_t*)Builder->Datagram->Buffer)) {
 
                 Send->SendFlags &= ~QUIC_CONN_SEND_FLAG_MAX_DATA;
+                Send->MaxDataSent = Send->MaxData;
                 if (QuicPacketBuilderAddFrame(Builder, QUIC_FRAME_MAX_DATA, TRUE)) {
                     return TRUE;
                 }
@@ -825,6 +975,8 @@ QuicSendGetNextStream(
     QUIC_CONNECTION* Connection = QuicSendGetConnection(Send);
     QUIC_DBG_ASSERT(!QuicConnIsClosed(Connection) || QuicListIsEmpty(&Send->SendStreams));
 
+    QUIC_STREAM* Selected = NULL;
+    BOOLEAN SkippedLowerPriority = FALSE;
     QUIC_LIST_ENTRY* Entry = Send->SendStreams.Flink;
     while (Entry != &Send->SendStreams) {
 
@@ -834,33 +986,75 @@ QuicSendGetNextStream(
         //
 
         QUIC_STREAM* Stream = QUIC_CONTAINING_RECORD(Entry, QUIC_STREAM, SendLink);
+        Entry = Entry->Flink;
 
         //
         // Make sure, given the current state of the connection and the stream,
         // that we can use the stream to frame a packet.
         //
-        if (QuicSendCanSendStreamNow(Stream)) {
+        if (!QuicSendCanSendStreamNow(Stream)) {
+            continue;
+        }
 
-            if (Connection->State.UseRoundRobinStreamScheduling) {
-                //
-                // Move the stream to the end of the queue.
-                //
-                QuicListEntryRemove(&Stream->SendLink);
-                QuicListInsertTail(&Send->SendStreams, &Stream->SendLink);
+        if (Selected == NULL) {
+            Selected = Stream;
+            if (!Send->StreamRecoveryPending || RECOV_WINDOW_OPEN(Stream)) {
+                break;
+            }
+        } else if (Stream->SendPriority != Selected->SendPriority) {
+            SkippedLowerPriority = TRUE;
+            break;
+        } else if (RECOV_WINDOW_OPEN(Stream)) {
+            //
+            // Lost data goes out before new data of the same priority, so
+            // the retransmissions of all the streams are sent together.
+            //
+            Selected = Stream;
+            break;
+        }
+    }
 
-                *PacketCount = QUIC_STREAM_SEND_BATCH_COUNT;
+    if (Selected == NULL) {
+        return NULL;
+    }
 
-            } else { // FIFO prioritization scheme
-                *PacketCount = UINT32_MAX;
-            }
+    if (Send->StreamRecoveryPending &&
+        !RECOV_WINDOW_OPEN(Selected) &&
+        !SkippedLowerPriority) {
+        //
+        // No stream has anything left to recover.
+        //
+        Send->StreamRecoveryPending = FALSE;
+    }
 
-            return Stream;
+    if (RECOV_WINDOW_OPEN(Selected)) {
+        //
+        // One packet at a time, so the retransmissions of the other streams
+        // follow right after. The rest of the packet is topped off with the
+        // stream's new data.
+        //
+        if (Connection->State.UseRoundRobinStreamScheduling) {
+            QuicListEntryRemove(&Selected->SendLink);
+            QuicSendInsertStream(Send, Selected);
         }
+        *PacketCount = 1;
 
-        Entry = Entry->Flink;
+    } else if (Connection->State.UseRoundRobinStreamScheduling) {
+        //
+        // Move the stream to the end of its priority level in the
+        // queue, so it only round robins with streams of the same
+        // priority.
+        //
+        QuicListEntryRemove(&Selected->SendLink);
+        QuicSendInsertStream(Send, Selected);
+
+        *PacketCount = QUIC_STREAM_SEND_BATCH_COUNT;
+
+    } else { // FIFO prioritization scheme
+        *PacketCount = UINT32_MAX;
     }
 
-    return NULL;
+    return Selected;
 }
 
 //
@@ -929,6 +1123,86 @@ QuicSendPathChallenges(
     }
 }
 
+//
+// Returns the delay (in microseconds) until the congestion controller will
+// allow the next pacing chunk to be sent.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+uint64_t
+QuicSendGetPacingDelay(
+    _In_ QUIC_SEND* Send
+    )
+{
+    QUIC_CONNECTION* Connection = QuicSendGetConnection(Send);
+    uint64_t PacingRate =
+        QuicCongestionControlGetPacingRate(&Connection->CongestionControl);
+    if (PacingRate == 0) {
+        return MS_TO_US(QUIC_SEND_PACING_INTERVAL);
+    }
+
+    //
+    // The time it takes to accumulate a minimum sized chunk at the current
+    // pacing rate.
+    //
+    uint64_t Delay =
+        (uint64_t)QUIC_SEND_PACING_MIN_CHUNK * Connection->Paths[0].Mtu *
+        MS_TO_US(1000) / PacingRate;
+    if (Delay < QUIC_SEND_PACING_MIN_DELAY) {
+        Delay = QUIC_SEND_PACING_MIN_DELAY;
+    } else if (Delay > MS_TO_US(QUIC_SEND_PACING_INTERVAL)) {
+        Delay = MS_TO_US(QUIC_SEND_PACING_INTERVAL);
+    }
+    return Delay;
+}
+
+//
+// Returns the path the next flush sends on. Only the active path carries data
+// unless multipath has been negotiated. Then, each flush goes to the validated
+// path where data is expected to arrive first: its RTT, stretched by how much
+// of the (shared) congestion window it already has in flight. Low latency
+// paths are preferred, and the others take over as they fill up.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_PATH*
+QuicSendSelectPath(
+    _In_ QUIC_SEND* Send
+    )
+{
+    QUIC_CONNECTION* Connection = QuicSendGetConnection(Send);
+    QUIC_PATH* BestPath = &Connection->Paths[0];
+
+    if (!Connection->State.MultipathNegotiated ||
+        Connection->PathsCount == 1 ||
+        Send->SendFlags & QUIC_CONN_SEND_FLAG_PMTUD) { // Probes are for the active path.
+        return BestPath;
+    }
+
+    uint64_t CongestionWindow =
+        QuicCongestionControlGetCongestionWindow(&Connection->CongestionControl);
+    if (CongestionWindow == 0) {
+        CongestionWindow = 1;
+    }
+
+    uint64_t BestDeliveryTime = UINT64_MAX;
+    for (uint8_t i = 0; i < Connection->PathsCount; ++i) {
+        QUIC_PATH* Path = &Connection->Paths[i];
+        if (!Path->IsPeerValidated ||
+            Path->DestCid == NULL ||
+            Path->Allowance != UINT32_MAX) {
+            continue;
+        }
+        uint64_t DeliveryTime =
+            Path->SmoothedRtt +
+            Path->SmoothedRtt * (uint64_t)Path->BytesInFlight / CongestionWindow;
+        if (DeliveryTime < BestDeliveryTime) {
+            BestDeliveryTime = DeliveryTime;
+            BestPath = Path;
+        }
+    }
+
+    return BestPath;
+}
+
 typedef enum QUIC_SEND_RESULT {
 
     QUIC_SEND_COMPLETE,
@@ -949,13 +1223,22 @@ QuicSendFlush(
 
     QuicConnTimerCancel(Connection, QUIC_CONN_TIMER_PACING);
     QuicConnRemoveOutFlowBlockedReason(
-        Connection, QUIC_FLOW_BLOCKED_SCHEDULING | QUIC_FLOW_BLOCKED_PACING);
+        Connection,
+        QUIC_FLOW_BLOCKED_SCHEDULING | QUIC_FLOW_BLOCKED_PACING | QUIC_FLOW_BLOCKED_APP);
+
+    if (Send->Corked) {
+        //
+        // Anything corked goes out with this flush.
+        //
+        Send->Corked = FALSE;
+        QuicConnTimerCancel(Connection, QUIC_CONN_TIMER_CORK);
+    }
 
     if (Send->SendFlags == 0 && QuicListIsEmpty(&Send->SendStreams)) {
         return TRUE;
     }
 
-    QUIC_PATH* Path = &Connection->Paths[0];
+    QUIC_PATH* Path = QuicSendSelectPath(Send);
     if (Path->DestCid == NULL) {
         return TRUE;
     }
@@ -1025,15 +1308,16 @@ QuicSendFlush(
                     //
                     QuicConnAddOutFlowBlockedReason(
                         Connection, QUIC_FLOW_BLOCKED_PACING);
+                    uint64_t PacingDelay = QuicSendGetPacingDelay(Send);
                     QuicTraceLogConnVerbose(
                         SetPacingTimer,
                         Connection,
-                        "Setting delayed send (PACING) timer for %u ms",
-                        QUIC_SEND_PACING_INTERVAL);
-                    QuicConnTimerSet(
+                        "Setting delayed send (PACING) timer for %llu us",
+                        PacingDelay);
+                    QuicConnTimerSetUs(
                         Connection,
                         QUIC_CONN_TIMER_PACING,
-                        QUIC_SEND_PACING_INTERVAL);
+                        PacingDelay);
                     Result = QUIC_SEND_DELAYED_PACING;
                 } else {
                     //
@@ -1093,6 +1377,14 @@ QuicSendFlush(
             }
 
         } else if (SendFlags == QUIC_CONN_SEND_FLAG_PMTUD) {
+            if (Path->MtuDiscovery.ProbeSize == 0) {
+                //
+                // No probe is needed on the active path (e.g. it changed
+                // since the probe was requested).
+                //
+                Send->SendFlags &= ~QUIC_CONN_SEND_FLAG_PMTUD;
+                continue;
+            }
             if (!QuicPacketBuilderPrepareForPathMtuDiscovery(&Builder)) {
                 break;
             }
@@ -1113,8 +1405,11 @@ QuicSendFlush(
 
         } else {
             //
-            // Nothing else left to send right now.
+            // Nothing else left to send right now. Since the congestion
+            // controller still had allowance, we are application limited.
             //
+            QuicCongestionControlSetAppLimited(&Connection->CongestionControl);
+            QuicConnAddOutFlowBlockedReason(Connection, QUIC_FLOW_BLOCKED_APP);
             Result = QUIC_SEND_COMPLETE;
             break;
         }
@@ -1130,7 +1425,8 @@ QuicSendFlush(
 
         if (!WrotePacketFrames ||
             Builder.Metadata->FrameCount == QUIC_MAX_FRAMES_PER_PACKET ||
-            Builder.Datagram->Length - Builder.DatagramLength < QUIC_MIN_PACKET_SPARE_SPACE) {
+            (Builder.Datagram->Length - Builder.DatagramLength < QUIC_MIN_PACKET_SPARE_SPACE &&
+             !QuicPacketBuilderFlightFitsInDatagram(&Builder))) {
 
             //
             // We now have enough data in the current packet that we should
@@ -1140,7 +1436,7 @@ QuicSendFlush(
         }
 
     } while (Builder.SendContext != NULL ||
-        Builder.TotalCountDatagrams < QUIC_MAX_DATAGRAMS_PER_SEND);
+        Builder.TotalCountDatagrams < Builder.MaxCountDatagrams);
 
     if (Builder.SendContext != NULL) {
         //
@@ -1191,14 +1487,63 @@ QuicSendStartDelayedAckTimer(
             Connection,
             "Starting ACK_DELAY timer for %u ms",
             Connection->MaxAckDelayMs);
-        QuicConnTimerSet(
-            Connection,
-            QUIC_CONN_TIMER_ACK_DELAY,
-            Connection->MaxAckDelayMs); // TODO - Use smaller timeout when handshake data is outstanding.
+
+        //
+        // Expire the timer on the worker's ACK delay granularity (but never
+        // later than the max ACK delay), so that the ACKs of all the worker's
+        // connections due around the same time are sent in the same batch.
+        //
+        uint64_t DelayUs = MS_TO_US(Connection->MaxAckDelayMs); // TODO - Use smaller timeout when handshake data is outstanding.
+        uint64_t TimeNow = QuicTimeUs64();
+        uint64_t AlignedDelayUs =
+            (TimeNow + DelayUs) / QUIC_ACK_DELAY_ALIGNMENT_US *
+                QUIC_ACK_DELAY_ALIGNMENT_US - TimeNow;
+        if (AlignedDelayUs >= QUIC_MIN_ACK_DELAY_US &&
+            AlignedDelayUs <= DelayUs) {
+            DelayUs = AlignedDelayUs;
+        }
+        QuicConnTimerSetUs(Connection, QUIC_CONN_TIMER_ACK_DELAY, DelayUs);
         Send->DelayedAckTimerActive = TRUE;
     }
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSendUpdateAckFrequency(
+    _In_ QUIC_SEND* Send
+    )
+{
+    QUIC_CONNECTION* Connection = QuicSendGetConnection(Send);
+
+    if (!(Connection->PeerTransportParams.Flags & QUIC_TP_FLAG_MIN_ACK_DELAY) ||
+        Connection->Crypto.TlsState.WriteKey != QUIC_PACKET_KEY_1_RTT) {
+        return;
+    }
+
+    //
+    // Aim for QUIC_ACK_FREQUENCY_ACKS_PER_CWND acknowledgements per congestion
+    // window, so that small windows still get the default ACK rate.
+    //
+    uint32_t PacketsPerWindow =
+        QuicCongestionControlGetCongestionWindow(&Connection->CongestionControl) /
+        Connection->Paths[0].Mtu;
+    uint8_t PacketTolerance =
+        (uint8_t)max(
+            QUIC_MIN_ACK_SEND_NUMBER,
+            min(PacketsPerWindow / QUIC_ACK_FREQUENCY_ACKS_PER_CWND,
+                QUIC_MAX_ACK_FREQUENCY_PACKET_TOLERANCE));
+
+    if (PacketTolerance != Connection->PeerPacketTolerance) {
+        QuicTraceLogConnVerbose(
+            RequestAckFrequency,
+            Connection,
+            "Requesting ACK frequency: tolerance=%hhu",
+            PacketTolerance);
+        Connection->PeerPacketTolerance = PacketTolerance;
+        QuicSendSetSendFlag(Send, QUIC_CONN_SEND_FLAG_ACK_FREQUENCY);
+    }
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
 QuicSendProcessDelayedAckTimer(
@@ -1227,25 +1572,3 @@ QuicSendProcessDelayedAckTimer(
 
     QuicSendValidate(Send);
 }
-
-_IRQL_requires_max_(DISPATCH_LEVEL)
-void
-QuicSendOnMtuProbePacketAcked(
-    _In_ QUIC_SEND* Send,
-    _In_ QUIC_PATH* Path,
-    _In_ QUIC_SENT_PACKET_METADATA* Packet
-    )
-{
-    QUIC_CONNECTION* Connection = QuicSendGetConnection(Send);
-    Path->Mtu =
-        PacketSizeFromUdpPayloadSize(
-            QuicAddrGetFamily(&Path->RemoteAddress),
-            Packet->PacketLength);
-    QuicTraceLogConnInfo(
-        PathMtuUpdated,
-        QuicSendGetConnection(Send),
-        "Path[%hhu] MTU updated to %hu bytes",
-        Path->ID,
-        Path->Mtu);
-    QuicDatagramOnSendStateChanged(&Connection->Datagram);
-}
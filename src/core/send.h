@@ -85,6 +85,8 @@ QuicPacketTypeToEncryptLevel(
 #define QUIC_CONN_SEND_FLAG_PING                    0x00001000
 #define QUIC_CONN_SEND_FLAG_HANDSHAKE_DONE          0x00002000
 #define QUIC_CONN_SEND_FLAG_DATAGRAM                0x00004000
+#define QUIC_CONN_SEND_FLAG_ACK_FREQUENCY           0x00008000
+#define QUIC_CONN_SEND_FLAG_IMMEDIATE_ACK           0x00010000
 #define QUIC_CONN_SEND_FLAG_PMTUD                   0x80000000
 
 //
@@ -113,6 +115,8 @@ QuicPacketTypeToEncryptLevel(
     QUIC_CONN_SEND_FLAG_PATH_RESPONSE | \
     QUIC_CONN_SEND_FLAG_PING | \
     QUIC_CONN_SEND_FLAG_DATAGRAM | \
+    QUIC_CONN_SEND_FLAG_ACK_FREQUENCY | \
+    QUIC_CONN_SEND_FLAG_IMMEDIATE_ACK | \
     QUIC_CONN_SEND_FLAG_PMTUD \
 )
 
@@ -182,6 +186,24 @@ typedef struct QUIC_SEND {
     //
     BOOLEAN TailLossProbeNeeded : 1;
 
+    //
+    // Indicates the datapath paces the sends: datagrams are stamped with the
+    // time they may leave the host instead of being held back.
+    //
+    BOOLEAN PacingOffload : 1;
+
+    //
+    // Indicates the stream data queued since the last flush is being held
+    // back (corked) until the CORK timer fires or the data is uncorked.
+    //
+    BOOLEAN Corked : 1;
+
+    //
+    // Indicates a stream may have lost data queued for retransmission, so
+    // stream selection should look for streams to recover first.
+    //
+    BOOLEAN StreamRecoveryPending : 1;
+
     //
     // The next packet number to use.
     //
@@ -192,11 +214,35 @@ typedef struct QUIC_SEND {
     //
     uint64_t LastFlushTime;
 
+    //
+    // The departure time of the next pacing chunk, when PacingOffload is set.
+    //
+    uint64_t NextTxTime;
+
+    //
+    // The longest small stream writes are corked for, in microseconds. Zero
+    // disables automatic corking; only QUIC_SEND_FLAG_DELAY_SEND sends are
+    // then corked, for QUIC_DEFAULT_SEND_CORK_US.
+    //
+    uint32_t CorkUs;
+
     //
     // The value we send in MAX_DATA frames.
     //
     uint64_t MaxData;
 
+    //
+    // How far MaxData is kept ahead of the bytes delivered to the app. Starts
+    // at the ConnFlowControlWindow setting and grows with the stream windows.
+    //
+    uint64_t MaxDataWindow;
+
+    //
+    // The last value sent to the peer, in a MAX_DATA frame or the initial_max_data
+    // transport parameter.
+    //
+    uint64_t MaxDataSent;
+
     //
     // The max value received in MAX_DATA frames.
     //
@@ -298,7 +344,8 @@ QuicSendQueueFlush(
     );
 
 //
-// Queues a FLUSH_SEND operation for stream data.
+// Queues a FLUSH_SEND operation for stream data, or arms the CORK timer
+// instead if the data is corked.
 //
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
@@ -308,6 +355,28 @@ QuicSendQueueFlushForStream(
     _In_ BOOLEAN WasPreviouslyQueued
     );
 
+//
+// Corks (or uncorks) the stream data about to be queued. Corking doesn't
+// extend an already running cork delay.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSendSetCorked(
+    _In_ QUIC_SEND* Send,
+    _In_ BOOLEAN Corked
+    );
+
+//
+// Moves an already queued stream to the correct place in the send queue
+// after its priority has changed.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSendUpdateStreamPriority(
+    _In_ QUIC_SEND* Send,
+    _In_ QUIC_STREAM* Stream
+    );
+
 //
 // Tries to drain all queued data that needs to be sent. Returns TRUE if all the
 // data was drained.
@@ -318,6 +387,16 @@ QuicSendFlush(
     _In_ QUIC_SEND* Send
     );
 
+//
+// Called when the congestion window changes, to update the packet tolerance
+// requested of the peer (via the ACK_FREQUENCY frame), if supported.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSendUpdateAckFrequency(
+    _In_ QUIC_SEND* Send
+    );
+
 //
 // Starts the delayed ACK timer if not already running.
 //
@@ -389,14 +468,3 @@ QuicSendClearStreamSendFlag(
     _In_ QUIC_STREAM* Stream,
     _In_ uint32_t SendFlag
     );
-
-//
-// Invoked on receiving an ACK for a MTU probe packet.
-//
-_IRQL_requires_max_(DISPATCH_LEVEL)
-void
-QuicSendOnMtuProbePacketAcked(
-    _In_ QUIC_SEND* Send,
-    _In_ QUIC_PATH* Path,
-    _In_ QUIC_SENT_PACKET_METADATA* Packet
-    );
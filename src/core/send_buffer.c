@@ -89,6 +89,9 @@ QuicSendBufferAlloc(
 
     if (Buf != NULL) {
         SendBuffer->BufferedBytes += Size;
+        InterlockedExchangeAdd64(
+            (int64_t*)&MsQuicLib.CurrentSendBufferMemoryUsage,
+            (int64_t)Size);
     } else {
         QuicTraceEvent(
             AllocFailure,
@@ -110,6 +113,9 @@ QuicSendBufferFree(
 {
     QUIC_FREE(Buf);
     SendBuffer->BufferedBytes -= Size;
+    InterlockedExchangeAdd64(
+        (int64_t*)&MsQuicLib.CurrentSendBufferMemoryUsage,
+        -1 * (int64_t)Size);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -223,8 +229,7 @@ QuicSendBufferConnectionAdjust(
     _In_ QUIC_CONNECTION* Connection
     )
 {
-    if (Connection->SendBuffer.IdealBytes == QUIC_MAX_IDEAL_SEND_BUFFER_SIZE ||
-        Connection->Streams.StreamTable == NULL) {
+    if (Connection->Streams.StreamTable == NULL) {
         return; // Nothing to do.
     }
 
@@ -232,13 +237,24 @@ QuicSendBufferConnectionAdjust(
     // If the current IdealBytes is close to limiting throughput, double it.
     // Since we grow exponentially, this will not happen frequently.
     //
-    // TODO: Currently, IdealBytes only grows and never shrinks. Add appropriate
-    // shrinking logic.
+    // While the library is over its memory budget, IdealBytes falls back to
+    // the default instead, and grows again once the pressure is gone.
     //
-    if (Connection->CongestionControl.BytesInFlightMax >
-        QUIC_IDEAL_SEND_BUFFER_THRESHOLD(Connection->SendBuffer.IdealBytes)) {
-        Connection->SendBuffer.IdealBytes =
-            min(2 * Connection->CongestionControl.BytesInFlightMax, QUIC_MAX_IDEAL_SEND_BUFFER_SIZE);
+    uint64_t NewIdealBytes = Connection->SendBuffer.IdealBytes;
+    if (QuicLibraryIsMemoryBudgetExceeded()) {
+        NewIdealBytes = QUIC_DEFAULT_IDEAL_SEND_BUFFER_SIZE;
+    } else {
+        const uint32_t BytesInFlightMax =
+            QuicCongestionControlGetBytesInFlightMax(&Connection->CongestionControl);
+        if (BytesInFlightMax >
+            QUIC_IDEAL_SEND_BUFFER_THRESHOLD(Connection->SendBuffer.IdealBytes)) {
+            NewIdealBytes =
+                min(2 * BytesInFlightMax, QUIC_MAX_IDEAL_SEND_BUFFER_SIZE);
+        }
+    }
+
+    if (NewIdealBytes != Connection->SendBuffer.IdealBytes) {
+        Connection->SendBuffer.IdealBytes = NewIdealBytes;
 
         QUIC_HASHTABLE_ENUMERATOR Enumerator;
         QUIC_HASHTABLE_ENTRY* Entry;
@@ -11,8 +11,14 @@ Abstract:
     to determine what exactly was acknowledged or lost.
 
     The size of a QUIC_SENT_PACKET_METADATA depends on the number of frames
-    contained in the packet. The allocator uses a different pool for each
-    possible size.
+    contained in the packet. The packet builder fills in the metadata in its
+    own (maximum sized) storage, and only once the packet is sent is a copy
+    allocated from the worker's pools. There is a pool per size class: exact
+    sizes for the common small frame counts and a few coarser classes above
+    that, so each worker keeps fewer, busier pools.
+
+    Outstanding packets are tracked (by the loss detection module) in a
+    QUIC_SENT_PACKET_RING of compact headers, also implemented here.
 
 --*/
 
@@ -53,6 +59,24 @@ QuicSentPacketMetadataReleaseFrames(
     }
 }
 
+//
+// The largest frame count held by each size class.
+//
+static const uint8_t QuicSentPacketPoolClassFrameCount[QUIC_SENT_PACKET_POOL_CLASS_COUNT] = {
+    1, 2, 3, 4, 6, 8, QUIC_MAX_FRAMES_PER_PACKET
+};
+
+//
+// The size class for each frame count.
+//
+static const uint8_t QuicSentPacketPoolClass[QUIC_MAX_FRAMES_PER_PACKET + 1] = {
+    0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6
+};
+
+QUIC_STATIC_ASSERT(
+    QUIC_MAX_FRAMES_PER_PACKET == 12,
+    "Update the sent packet pool size classes");
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
 QuicSentPacketPoolInitialize(
@@ -61,7 +85,7 @@ QuicSentPacketPoolInitialize(
 {
     for (uint8_t i = 0; i < ARRAYSIZE(Pool->Pools); i++) {
         uint16_t PacketMetadataSize =
-            (i + 1) * sizeof(QUIC_SENT_FRAME_METADATA) +
+            QuicSentPacketPoolClassFrameCount[i] * sizeof(QUIC_SENT_FRAME_METADATA) +
             sizeof(QUIC_SENT_PACKET_METADATA);
 
         QuicPoolInitialize(
@@ -90,7 +114,7 @@ QuicSentPacketPoolGetPacketMetadata(
     )
 {
     QUIC_SENT_PACKET_METADATA* Metadata =
-        QuicPoolAlloc(Pool->Pools + FrameCount - 1);
+        QuicPoolAlloc(Pool->Pools + QuicSentPacketPoolClass[FrameCount]);
 #if DEBUG
     Metadata->Flags.Freed = FALSE;
 #endif
@@ -113,5 +137,175 @@ QuicSentPacketPoolReturnPacketMetadata(
 #endif
 
     QuicSentPacketMetadataReleaseFrames(Metadata);
-    QuicPoolFree(Pool->Pools + Metadata->FrameCount - 1, Metadata);
+    QuicPoolFree(Pool->Pools + QuicSentPacketPoolClass[Metadata->FrameCount], Metadata);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSentPacketRingInitialize(
+    _Out_ QUIC_SENT_PACKET_RING* Ring
+    )
+{
+    Ring->Headers = NULL;
+    Ring->Capacity = 0;
+    Ring->Head = 0;
+    Ring->Count = 0;
+    Ring->LiveCount = 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSentPacketRingUninitialize(
+    _In_ QUIC_SENT_PACKET_RING* Ring
+    )
+{
+    QUIC_DBG_ASSERT(Ring->LiveCount == 0);
+    if (Ring->Headers != NULL) {
+        QUIC_FREE(Ring->Headers);
+        Ring->Headers = NULL;
+    }
+    Ring->Capacity = 0;
+    Ring->Head = 0;
+    Ring->Count = 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Must_inspect_result_
+BOOLEAN
+QuicSentPacketRingReserve(
+    _Inout_ QUIC_SENT_PACKET_RING* Ring
+    )
+{
+    if (Ring->Count < Ring->Capacity) {
+        return TRUE;
+    }
+
+    if (Ring->LiveCount <= Ring->Capacity / 2 && Ring->Capacity != 0) {
+        //
+        // At least half the slots only hold removed packets. Compact the
+        // remaining ones in place instead of growing.
+        //
+        uint32_t Dest = 0;
+        for (uint32_t i = 0; i < Ring->Count; ++i) {
+            QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(Ring, i);
+            if (Header->Metadata != NULL) {
+                *QuicSentPacketRingGet(Ring, Dest++) = *Header;
+            }
+        }
+        QUIC_DBG_ASSERT(Dest == Ring->LiveCount);
+        Ring->Count = Dest;
+        return TRUE;
+    }
+
+    uint32_t NewCapacity =
+        Ring->Capacity == 0 ?
+            QUIC_SENT_PACKET_RING_INITIAL_CAPACITY : Ring->Capacity * 2;
+    if (NewCapacity < Ring->Capacity) {
+        return FALSE; // Overflow
+    }
+
+    QUIC_SENT_PACKET_HEADER* NewHeaders =
+        QUIC_ALLOC_NONPAGED(sizeof(QUIC_SENT_PACKET_HEADER) * NewCapacity);
+    if (NewHeaders == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "Sent packet ring",
+            sizeof(QUIC_SENT_PACKET_HEADER) * NewCapacity);
+        return FALSE;
+    }
+
+    //
+    // Unwrap the ring into the new buffer, dropping removed packets on the way.
+    //
+    uint32_t Dest = 0;
+    for (uint32_t i = 0; i < Ring->Count; ++i) {
+        QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(Ring, i);
+        if (Header->Metadata != NULL) {
+            NewHeaders[Dest++] = *Header;
+        }
+    }
+    QUIC_DBG_ASSERT(Dest == Ring->LiveCount);
+
+    if (Ring->Headers != NULL) {
+        QUIC_FREE(Ring->Headers);
+    }
+    Ring->Headers = NewHeaders;
+    Ring->Capacity = NewCapacity;
+    Ring->Head = 0;
+    Ring->Count = Dest;
+
+    return TRUE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSentPacketRingPush(
+    _Inout_ QUIC_SENT_PACKET_RING* Ring,
+    _In_ QUIC_SENT_PACKET_METADATA* Metadata
+    )
+{
+    QUIC_DBG_ASSERT(Ring->Count < Ring->Capacity);
+    QUIC_DBG_ASSERT(
+        Ring->Count == 0 ||
+        QuicSentPacketRingGet(Ring, Ring->Count - 1)->PacketNumber < Metadata->PacketNumber);
+
+    QUIC_SENT_PACKET_HEADER* Header =
+        &Ring->Headers[(Ring->Head + Ring->Count) & (Ring->Capacity - 1)];
+    Header->PacketNumber = Metadata->PacketNumber;
+    Header->SentTime = Metadata->SentTime;
+    Header->PacketLength = Metadata->PacketLength;
+    Header->Flags = Metadata->Flags;
+    Header->Metadata = Metadata;
+
+    Ring->Count++;
+    Ring->LiveCount++;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_SENT_PACKET_METADATA*
+QuicSentPacketRingRemove(
+    _Inout_ QUIC_SENT_PACKET_RING* Ring,
+    _In_ uint32_t Index
+    )
+{
+    QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(Ring, Index);
+    QUIC_SENT_PACKET_METADATA* Metadata = Header->Metadata;
+    QUIC_DBG_ASSERT(Metadata != NULL);
+    Header->Metadata = NULL;
+    Ring->LiveCount--;
+    return Metadata;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSentPacketRingTrim(
+    _Inout_ QUIC_SENT_PACKET_RING* Ring
+    )
+{
+    while (Ring->Count != 0 && Ring->Headers[Ring->Head].Metadata == NULL) {
+        Ring->Head = (Ring->Head + 1) & (Ring->Capacity - 1);
+        Ring->Count--;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicSentPacketRingLowerBound(
+    _In_ const QUIC_SENT_PACKET_RING* Ring,
+    _In_ uint32_t Start,
+    _In_ uint64_t PacketNumber
+    )
+{
+    uint32_t Low = Start;
+    uint32_t High = Ring->Count;
+    while (Low < High) {
+        uint32_t Mid = Low + (High - Low) / 2;
+        if (QuicSentPacketRingGet(Ring, Mid)->PacketNumber < PacketNumber) {
+            Low = Mid + 1;
+        } else {
+            High = Mid;
+        }
+    }
+    return Low;
 }
@@ -66,6 +66,9 @@ typedef struct QUIC_SENT_FRAME_METADATA {
         struct {
             void* ClientContext;
         } DATAGRAM;
+        struct {
+            QUIC_VAR_INT Sequence;
+        } ACK_FREQUENCY;
     };
     uint8_t Type; // QUIC_FRAME_*
     uint8_t Flags; // QUIC_SENT_FRAME_FLAG_*
@@ -79,6 +82,8 @@ typedef struct QUIC_SEND_PACKET_FLAGS {
     BOOLEAN IsPMTUD                 : 1;
     BOOLEAN KeyPhase                : 1;
     BOOLEAN SuspectedLost           : 1;
+    BOOLEAN IsAppLimited            : 1;
+    BOOLEAN EcnEctSet               : 1;
 #if DEBUG
     BOOLEAN Freed                   : 1;
 #endif
@@ -97,6 +102,14 @@ typedef struct QUIC_SENT_PACKET_METADATA {
     uint16_t PacketLength;
     uint8_t PathId;
 
+    //
+    // Delivery rate sampling state, captured when the packet was sent. See
+    // QUIC_LOSS_DETECTION for the meaning of each field.
+    //
+    uint64_t TotalBytesDelivered;
+    uint32_t DeliveredTime; // In microseconds
+    uint32_t FirstSentTime; // In microseconds
+
     //
     // Hints about the QUIC packet and included frames.
     //
@@ -112,6 +125,154 @@ typedef struct QUIC_SENT_PACKET_METADATA {
 
 #pragma pack(pop)
 
+//
+// Compact header for an outstanding packet. It holds everything needed to scan
+// for acknowledged or lost packets, so the (out of line) packet and frame
+// metadata is only touched once a packet is actually acknowledged, lost or
+// discarded.
+//
+typedef struct QUIC_SENT_PACKET_HEADER {
+
+    uint64_t PacketNumber;
+    uint32_t SentTime; // In microseconds
+    uint16_t PacketLength;
+    QUIC_SEND_PACKET_FLAGS Flags;
+
+    //
+    // The full metadata for the packet. NULL once the packet is removed.
+    //
+    QUIC_SENT_PACKET_METADATA* Metadata;
+
+} QUIC_SENT_PACKET_HEADER;
+
+//
+// The number of headers allocated the first time a packet is added to a ring.
+// Must be a power of two.
+//
+#define QUIC_SENT_PACKET_RING_INITIAL_CAPACITY 64
+
+QUIC_STATIC_ASSERT(IS_POWER_OF_TWO(QUIC_SENT_PACKET_RING_INITIAL_CAPACITY), L"Must be power of two");
+
+//
+// A ring buffer of packet headers, in ascending packet number order, so that
+// lookups can binary search and scans walk contiguous memory. Removing a
+// packet only clears its Metadata. Removed packets at the front are dropped by
+// QuicSentPacketRingTrim and ones in the middle are compacted out when the
+// ring runs out of room.
+//
+typedef struct QUIC_SENT_PACKET_RING {
+
+    _Field_size_(Capacity)
+    QUIC_SENT_PACKET_HEADER* Headers;
+
+    //
+    // The number of allocated headers. Zero or a power of two.
+    //
+    uint32_t Capacity;
+
+    //
+    // The index in Headers of the first (oldest) used slot.
+    //
+    uint32_t Head;
+
+    //
+    // The number of used slots, including ones whose packet was removed.
+    //
+    uint32_t Count;
+
+    //
+    // The number of slots still holding a packet.
+    //
+    uint32_t LiveCount;
+
+} QUIC_SENT_PACKET_RING;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSentPacketRingInitialize(
+    _Out_ QUIC_SENT_PACKET_RING* Ring
+    );
+
+//
+// Frees the ring's memory. All packets must have been removed.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSentPacketRingUninitialize(
+    _In_ QUIC_SENT_PACKET_RING* Ring
+    );
+
+//
+// Returns the header at the given index, relative to the oldest used slot.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+QUIC_SENT_PACKET_HEADER*
+QuicSentPacketRingGet(
+    _In_ const QUIC_SENT_PACKET_RING* Ring,
+    _In_ uint32_t Index
+    )
+{
+    QUIC_DBG_ASSERT(Index < Ring->Count);
+    return &Ring->Headers[(Ring->Head + Index) & (Ring->Capacity - 1)];
+}
+
+//
+// Makes sure there is room to push one more packet, by compacting or growing
+// the ring. Only fails if memory couldn't be allocated.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Must_inspect_result_
+BOOLEAN
+QuicSentPacketRingReserve(
+    _Inout_ QUIC_SENT_PACKET_RING* Ring
+    );
+
+//
+// Adds a packet to the end of the ring. Its packet number must be larger than
+// any other in the ring, and there must be room for it (see
+// QuicSentPacketRingReserve).
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSentPacketRingPush(
+    _Inout_ QUIC_SENT_PACKET_RING* Ring,
+    _In_ QUIC_SENT_PACKET_METADATA* Metadata
+    );
+
+//
+// Removes the packet at the given index and returns its metadata. Indexes of
+// the other packets don't change until the next QuicSentPacketRingTrim or
+// QuicSentPacketRingReserve call.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_SENT_PACKET_METADATA*
+QuicSentPacketRingRemove(
+    _Inout_ QUIC_SENT_PACKET_RING* Ring,
+    _In_ uint32_t Index
+    );
+
+//
+// Drops the removed packets from the front of the ring.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSentPacketRingTrim(
+    _Inout_ QUIC_SENT_PACKET_RING* Ring
+    );
+
+//
+// Returns the index of the first slot, at or after Start, whose packet number
+// is at least PacketNumber. Returns Ring->Count if there is none.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicSentPacketRingLowerBound(
+    _In_ const QUIC_SENT_PACKET_RING* Ring,
+    _In_ uint32_t Start,
+    _In_ uint64_t PacketNumber
+    );
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 uint8_t
@@ -145,12 +306,19 @@ QUIC_STATIC_ASSERT(
     "Max Send Packet Metadata should be small enough to be allocated on the stack");
 
 //
-// A collection of object pools for each size of packet and
+// The number of size classes packet metadata is allocated in. Packets with up
+// to four frames (nearly all of them) get an exact fit; larger ones share
+// classes of 6, 8 and QUIC_MAX_FRAMES_PER_PACKET frames.
+//
+#define QUIC_SENT_PACKET_POOL_CLASS_COUNT 7
+
+//
+// A collection of object pools for each size class of packet and
 // associated frame metadata.
 //
 typedef struct QUIC_SENT_PACKET_POOL {
 
-    QUIC_POOL Pools[QUIC_MAX_FRAMES_PER_PACKET];
+    QUIC_POOL Pools[QUIC_SENT_PACKET_POOL_CLASS_COUNT];
 
 } QUIC_SENT_PACKET_POOL;
 
@@ -90,9 +90,16 @@ QuicSessionAlloc(
         ""); // TODO - Buffer and length
 
     QuicRundownInitialize(&Session->Rundown);
-    QuicRwLockInitialize(&Session->ServerCacheLock);
-    QuicDispatchLockInitialize(&Session->ConnectionsLock);
-    QuicListInitializeHead(&Session->Connections);
+    for (uint32_t i = 0; i < QUIC_SERVER_CACHE_SHARD_COUNT; ++i) {
+        QuicRwLockInitialize(&Session->ServerCache[i].Lock);
+    }
+    for (uint32_t i = 0; i < QUIC_SESSION_CONNECTION_SHARD_COUNT; ++i) {
+        QuicDispatchLockInitialize(&Session->Connections[i].Lock);
+        QuicListInitializeHead(&Session->Connections[i].List);
+    }
+    QuicLockInitialize(&Session->ConnectionPoolLock);
+    QuicListInitializeHead(&Session->ConnectionPool);
+    QuicDispatchLockInitialize(&Session->PathMetricsLock);
 
     *NewSession = Session;
 
@@ -110,37 +117,16 @@ MsQuicSessionFree(
     // If you hit this assert, you are trying to clean up a session without
     // first cleaning up all the child connections first.
     //
-    QUIC_TEL_ASSERT(QuicListIsEmpty(&Session->Connections));
+    for (uint32_t i = 0; i < QUIC_SESSION_CONNECTION_SHARD_COUNT; ++i) {
+        QUIC_TEL_ASSERT(QuicListIsEmpty(&Session->Connections[i].List));
+    }
+    QUIC_DBG_ASSERT(QuicListIsEmpty(&Session->ConnectionPool));
     QuicRundownUninitialize(&Session->Rundown);
 
     if (Session->Registration != NULL) {
         QuicTlsSessionUninitialize(Session->TlsSession);
 
-        //
-        // Enumerate and free all entries in the table.
-        //
-        QUIC_HASHTABLE_ENTRY* Entry;
-        QUIC_HASHTABLE_ENUMERATOR Enumerator;
-        QuicHashtableEnumerateBegin(&Session->ServerCache, &Enumerator);
-        while (TRUE) {
-            Entry = QuicHashtableEnumerateNext(&Session->ServerCache, &Enumerator);
-            if (Entry == NULL) {
-                QuicHashtableEnumerateEnd(&Session->ServerCache, &Enumerator);
-                break;
-            }
-            QuicHashtableRemove(&Session->ServerCache, Entry, NULL);
-
-            //
-            // Release the security config stored in this cache.
-            //
-            QUIC_SERVER_CACHE* Temp = QUIC_CONTAINING_RECORD(Entry, QUIC_SERVER_CACHE, Entry);
-            if (Temp->SecConfig != NULL) {
-                QuicTlsSecConfigRelease(Temp->SecConfig);
-            }
-
-            QUIC_FREE(Entry);
-        }
-        QuicHashtableUninitialize(&Session->ServerCache);
+        QuicSessionServerCacheUninitialize(Session, QUIC_SERVER_CACHE_SHARD_COUNT);
 
         QuicStorageClose(Session->AppSpecificStorage);
 #ifdef QUIC_SILO
@@ -149,8 +135,14 @@ MsQuicSessionFree(
 #endif
     }
 
-    QuicDispatchLockUninitialize(&Session->ConnectionsLock);
-    QuicRwLockUninitialize(&Session->ServerCacheLock);
+    QuicDispatchLockUninitialize(&Session->PathMetricsLock);
+    QuicLockUninitialize(&Session->ConnectionPoolLock);
+    for (uint32_t i = 0; i < QUIC_SESSION_CONNECTION_SHARD_COUNT; ++i) {
+        QuicDispatchLockUninitialize(&Session->Connections[i].Lock);
+    }
+    for (uint32_t i = 0; i < QUIC_SERVER_CACHE_SHARD_COUNT; ++i) {
+        QuicRwLockUninitialize(&Session->ServerCache[i].Lock);
+    }
     QuicTraceEvent(
         SessionDestroyed,
         "[sess][%p] Destroyed",
@@ -200,7 +192,7 @@ MsQuicSessionOpen(
         goto Error;
     }
 
-    if (!QuicHashtableInitializeEx(&Session->ServerCache, QUIC_HASH_MIN_SIZE)) {
+    if (!QuicSessionServerCacheInitialize(Session)) {
         QuicTraceEvent(
             SessionError,
             "[sess][%p] ERROR, %s.",
@@ -218,7 +210,7 @@ MsQuicSessionOpen(
             Session,
             Status,
             "QuicTlsSessionInitialize");
-        QuicHashtableUninitialize(&Session->ServerCache);
+        QuicSessionServerCacheUninitialize(Session, QUIC_SERVER_CACHE_SHARD_COUNT);
         goto Error;
     }
 
@@ -335,6 +327,22 @@ MsQuicSessionClose(
         MsQuicSessionShutdown(Handle, QUIC_CONNECTION_SHUTDOWN_FLAG_SILENT, 0);
     }
 
+    //
+    // The pooled connections are owned by the session, so shut them down. Each
+    // is closed once it completes its shutdown (and the app has closed all
+    // its streams), which releases its reference on the rundown.
+    //
+    QuicLockAcquire(&Session->ConnectionPoolLock);
+    for (QUIC_LIST_ENTRY* Entry = Session->ConnectionPool.Flink;
+        Entry != &Session->ConnectionPool;
+        Entry = Entry->Flink) {
+        MsQuicConnectionShutdown(
+            (HQUIC)QUIC_CONTAINING_RECORD(Entry, QUIC_POOLED_CONNECTION, Link)->Connection,
+            QUIC_CONNECTION_SHUTDOWN_FLAG_NONE,
+            0);
+    }
+    QuicLockRelease(&Session->ConnectionPoolLock);
+
     QuicRundownReleaseAndWait(&Session->Rundown);
     MsQuicSessionFree(Session);
 
@@ -376,31 +384,34 @@ MsQuicSessionShutdown(
             Flags,
             ErrorCode);
 
-        QuicDispatchLockAcquire(&Session->ConnectionsLock);
+        for (uint32_t i = 0; i < QUIC_SESSION_CONNECTION_SHARD_COUNT; ++i) {
+            QUIC_SESSION_CONNECTIONS* Shard = &Session->Connections[i];
+            QuicDispatchLockAcquire(&Shard->Lock);
 
-        QUIC_LIST_ENTRY* Entry = Session->Connections.Flink;
-        while (Entry != &Session->Connections) {
+            QUIC_LIST_ENTRY* Entry = Shard->List.Flink;
+            while (Entry != &Shard->List) {
 
-            QUIC_CONNECTION* Connection =
-                QUIC_CONTAINING_RECORD(Entry, QUIC_CONNECTION, SessionLink);
+                QUIC_CONNECTION* Connection =
+                    QUIC_CONTAINING_RECORD(Entry, QUIC_CONNECTION, SessionLink);
 
-            if (InterlockedCompareExchange16(
-                    (short*)&Connection->BackUpOperUsed, 1, 0) == 0) {
+                if (InterlockedCompareExchange16(
+                        (short*)&Connection->BackUpOperUsed, 1, 0) == 0) {
 
-                QUIC_OPERATION* Oper = &Connection->BackUpOper;
-                Oper->FreeAfterProcess = FALSE;
-                Oper->Type = QUIC_OPER_TYPE_API_CALL;
-                Oper->API_CALL.Context = &Connection->BackupApiContext;
-                Oper->API_CALL.Context->Type = QUIC_API_TYPE_CONN_SHUTDOWN;
-                Oper->API_CALL.Context->CONN_SHUTDOWN.Flags = Flags;
-                Oper->API_CALL.Context->CONN_SHUTDOWN.ErrorCode = ErrorCode;
-                QuicConnQueueHighestPriorityOper(Connection, Oper);
+                    QUIC_OPERATION* Oper = &Connection->BackUpOper;
+                    Oper->FreeAfterProcess = FALSE;
+                    Oper->Type = QUIC_OPER_TYPE_API_CALL;
+                    Oper->API_CALL.Context = &Connection->BackupApiContext;
+                    Oper->API_CALL.Context->Type = QUIC_API_TYPE_CONN_SHUTDOWN;
+                    Oper->API_CALL.Context->CONN_SHUTDOWN.Flags = Flags;
+                    Oper->API_CALL.Context->CONN_SHUTDOWN.ErrorCode = ErrorCode;
+                    QuicConnQueueHighestPriorityOper(Connection, Oper);
+                }
+
+                Entry = Entry->Flink;
             }
 
-            Entry = Entry->Flink;
+            QuicDispatchLockRelease(&Shard->Lock);
         }
-
-        QuicDispatchLockRelease(&Session->ConnectionsLock);
     }
 
     QuicTraceEvent(
@@ -408,6 +419,289 @@ MsQuicSessionShutdown(
         "[ api] Exit");
 }
 
+//
+// Closes the pooled connection, if it's shut down and has no more streams.
+// Called with the pool lock held, which is released.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSessionConnectionPoolReleaseLock(
+    _In_ QUIC_SESSION* Session,
+    _In_ __drv_freesMem(Mem) QUIC_POOLED_CONNECTION* Pooled
+    )
+{
+    BOOLEAN CloseConnection =
+        Pooled->ShutdownComplete && Pooled->StreamCount == 0;
+    QuicLockRelease(&Session->ConnectionPoolLock);
+
+    if (CloseConnection) {
+        QuicTraceLogVerbose(
+            SessionPoolConnectionClosed,
+            "[sess][%p] Closing pooled connection %p",
+            Session,
+            Pooled->Connection);
+        MsQuicConnectionClose((HQUIC)Pooled->Connection);
+        QUIC_FREE(Pooled);
+    }
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QUIC_API
+MsQuicPoolStreamOpen(
+    _In_ _Pre_defensive_ HQUIC Handle,
+    _In_z_ const char* ServerName,
+    _In_ uint16_t ServerPort,
+    _In_ QUIC_STREAM_OPEN_FLAGS Flags,
+    _In_ _Pre_defensive_ QUIC_STREAM_CALLBACK_HANDLER Handler,
+    _In_opt_ void* Context,
+    _Outptr_ _At_(*NewStream, __drv_allocatesMem(Mem)) _Pre_defensive_
+        HQUIC *NewStream
+    )
+{
+    QUIC_STATUS Status;
+    QUIC_SESSION* Session;
+    QUIC_POOLED_CONNECTION* Pooled = NULL;
+    HQUIC Connection = NULL;
+    size_t ServerNameLength = 0;
+
+    QuicTraceEvent(
+        ApiEnter,
+        "[ api] Enter %u (%p).",
+        QUIC_TRACE_API_POOL_STREAM_OPEN,
+        Handle);
+
+    if (ServerName != NULL) {
+        ServerNameLength = strnlen(ServerName, QUIC_MAX_SNI_LENGTH + 1);
+    }
+
+    if (Handle == NULL ||
+        Handle->Type != QUIC_HANDLE_TYPE_SESSION ||
+        ServerNameLength == 0 ||
+        ServerNameLength > QUIC_MAX_SNI_LENGTH ||
+        ServerPort == 0 ||
+        Handler == NULL ||
+        NewStream == NULL) {
+        Status = QUIC_STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+#pragma prefast(suppress: __WARNING_25024, "Pointer cast already validated.")
+    Session = (QUIC_SESSION*)Handle;
+
+    if (Session->Registration == NULL) {
+        Status = QUIC_STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    QuicLockAcquire(&Session->ConnectionPoolLock);
+    for (QUIC_LIST_ENTRY* Entry = Session->ConnectionPool.Flink;
+        Entry != &Session->ConnectionPool;
+        Entry = Entry->Flink) {
+        QUIC_POOLED_CONNECTION* Candidate =
+            QUIC_CONTAINING_RECORD(Entry, QUIC_POOLED_CONNECTION, Link);
+        if (Candidate->ServerPort == ServerPort &&
+            Candidate->ServerNameLength == ServerNameLength &&
+            memcmp(Candidate->ServerName, ServerName, ServerNameLength) == 0) {
+            Pooled = Candidate;
+            Pooled->StreamCount++;
+            break;
+        }
+    }
+    QuicLockRelease(&Session->ConnectionPoolLock);
+
+    if (Pooled == NULL) {
+        //
+        // Open a new connection for the pool. The pool lock isn't held while
+        // the (blocking) parameters are set, as this connection's worker may
+        // be waiting on the lock for another pooled connection.
+        //
+        Pooled =
+            QUIC_ALLOC_PAGED(sizeof(QUIC_POOLED_CONNECTION) + ServerNameLength + 1);
+        if (Pooled == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "pooled connection",
+                sizeof(QUIC_POOLED_CONNECTION) + ServerNameLength + 1);
+            Status = QUIC_STATUS_OUT_OF_MEMORY;
+            goto Exit;
+        }
+        QuicZeroMemory(Pooled, sizeof(QUIC_POOLED_CONNECTION));
+        Pooled->Session = Session;
+        Pooled->ServerPort = ServerPort;
+        Pooled->ServerNameLength = (uint16_t)ServerNameLength;
+        QuicCopyMemory(Pooled->ServerName, ServerName, ServerNameLength);
+        Pooled->ServerName[ServerNameLength] = '\0';
+
+        //
+        // Count the stream about to be opened, so the connection isn't closed
+        // if it shuts down before it's added to the pool.
+        //
+        Pooled->StreamCount = 1;
+
+        Status =
+            MsQuicConnectionOpen(
+                Handle,
+                QuicSessionConnectionPoolCallback,
+                Pooled,
+                &Connection);
+        if (QUIC_FAILED(Status)) {
+            QUIC_FREE(Pooled);
+            goto Exit;
+        }
+        Pooled->Connection = (QUIC_CONNECTION*)Connection;
+
+        uint16_t PeerStreamCount = 0;
+        Status =
+            MsQuicSetParam(
+                Connection,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_PEER_BIDI_STREAM_COUNT,
+                sizeof(PeerStreamCount),
+                &PeerStreamCount);
+        if (QUIC_SUCCEEDED(Status)) {
+            Status =
+                MsQuicSetParam(
+                    Connection,
+                    QUIC_PARAM_LEVEL_CONNECTION,
+                    QUIC_PARAM_CONN_PEER_UNIDI_STREAM_COUNT,
+                    sizeof(PeerStreamCount),
+                    &PeerStreamCount);
+        }
+
+        //
+        // Keep the connection warm between uses, well within the idle timeout,
+        // unless the app configured its own keep alive interval.
+        //
+        uint32_t KeepAliveIntervalMs = Session->Settings.KeepAliveIntervalMs;
+        if (KeepAliveIntervalMs == 0 && Session->Settings.IdleTimeoutMs != 0) {
+            KeepAliveIntervalMs =
+                (uint32_t)min(Session->Settings.IdleTimeoutMs / 2, UINT32_MAX);
+        }
+        if (QUIC_SUCCEEDED(Status) && KeepAliveIntervalMs != 0) {
+            Status =
+                MsQuicSetParam(
+                    Connection,
+                    QUIC_PARAM_LEVEL_CONNECTION,
+                    QUIC_PARAM_CONN_KEEP_ALIVE,
+                    sizeof(KeepAliveIntervalMs),
+                    &KeepAliveIntervalMs);
+        }
+
+        if (QUIC_SUCCEEDED(Status)) {
+            Status =
+                MsQuicConnectionStart(
+                    Connection,
+                    AF_UNSPEC,
+                    Pooled->ServerName,
+                    ServerPort);
+        }
+
+        if (QUIC_FAILED(Status)) {
+            MsQuicConnectionClose(Connection);
+            QUIC_FREE(Pooled);
+            goto Exit;
+        }
+
+        QuicTraceLogVerbose(
+            SessionPoolConnectionOpened,
+            "[sess][%p] Pooled connection %p to %s:%hu",
+            Session,
+            Pooled->Connection,
+            Pooled->ServerName,
+            ServerPort);
+
+        QuicLockAcquire(&Session->ConnectionPoolLock);
+        if (!Pooled->ShutdownComplete) {
+            Pooled->InPool = TRUE;
+            QuicListInsertTail(&Session->ConnectionPool, &Pooled->Link);
+        }
+
+    } else {
+        QuicLockAcquire(&Session->ConnectionPoolLock);
+    }
+
+    Status =
+        MsQuicStreamOpen(
+            (HQUIC)Pooled->Connection,
+            Flags,
+            Handler,
+            Context,
+            NewStream);
+    if (QUIC_FAILED(Status)) {
+        Pooled->StreamCount--;
+    }
+    QuicSessionConnectionPoolReleaseLock(Session, Pooled);
+
+Exit:
+
+    QuicTraceEvent(
+        ApiExitStatus,
+        "[ api] Exit %u",
+        Status);
+
+    return Status;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Function_class_(QUIC_CONNECTION_CALLBACK)
+QUIC_STATUS
+QUIC_API
+QuicSessionConnectionPoolCallback(
+    _In_ HQUIC Connection,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_CONNECTION_EVENT* Event
+    )
+{
+    QUIC_POOLED_CONNECTION* Pooled = (QUIC_POOLED_CONNECTION*)Context;
+    QUIC_DBG_ASSERT(Pooled != NULL);
+    QUIC_DBG_ASSERT(Pooled->Connection == (QUIC_CONNECTION*)Connection);
+    UNREFERENCED_PARAMETER(Connection);
+    QUIC_SESSION* Session = Pooled->Session;
+
+    switch (Event->Type) {
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_TRANSPORT:
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_PEER:
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_COMPLETE:
+        //
+        // The next stream to the server gets a new connection.
+        //
+        QuicLockAcquire(&Session->ConnectionPoolLock);
+        if (Pooled->InPool) {
+            Pooled->InPool = FALSE;
+            QuicListEntryRemove(&Pooled->Link);
+        }
+        if (Event->Type == QUIC_CONNECTION_EVENT_SHUTDOWN_COMPLETE) {
+            Pooled->ShutdownComplete = TRUE;
+            QuicSessionConnectionPoolReleaseLock(Session, Pooled);
+        } else {
+            QuicLockRelease(&Session->ConnectionPoolLock);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSessionConnectionPoolOnStreamClosed(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_POOLED_CONNECTION* Pooled =
+        (QUIC_POOLED_CONNECTION*)Connection->ClientContext;
+    QUIC_SESSION* Session = Pooled->Session;
+
+    QuicLockAcquire(&Session->ConnectionPoolLock);
+    QUIC_DBG_ASSERT(Pooled->StreamCount != 0);
+    Pooled->StreamCount--;
+    QuicSessionConnectionPoolReleaseLock(Session, Pooled);
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 const uint8_t*
 QuicSessionFindAlpnInList(
@@ -492,16 +786,19 @@ QuicSessionTraceRundown(
         Session->Registration,
         ""); // TODO
 
-    QuicDispatchLockAcquire(&Session->ConnectionsLock);
+    for (uint32_t i = 0; i < QUIC_SESSION_CONNECTION_SHARD_COUNT; ++i) {
+        QUIC_SESSION_CONNECTIONS* Shard = &Session->Connections[i];
+        QuicDispatchLockAcquire(&Shard->Lock);
 
-    for (QUIC_LIST_ENTRY* Link = Session->Connections.Flink;
-        Link != &Session->Connections;
-        Link = Link->Flink) {
-        QuicConnQueueTraceRundown(
-            QUIC_CONTAINING_RECORD(Link, QUIC_CONNECTION, SessionLink));
-    }
+        for (QUIC_LIST_ENTRY* Link = Shard->List.Flink;
+            Link != &Shard->List;
+            Link = Link->Flink) {
+            QuicConnQueueTraceRundown(
+                QUIC_CONTAINING_RECORD(Link, QUIC_CONNECTION, SessionLink));
+        }
 
-    QuicDispatchLockRelease(&Session->ConnectionsLock);
+        QuicDispatchLockRelease(&Shard->Lock);
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -560,9 +857,12 @@ QuicSessionRegisterConnection(
         Session);
     BOOLEAN Success = QuicRundownAcquire(&Session->Rundown);
     QUIC_DBG_ASSERT(Success); UNREFERENCED_PARAMETER(Success);
-    QuicDispatchLockAcquire(&Session->ConnectionsLock);
-    QuicListInsertTail(&Session->Connections, &Connection->SessionLink);
-    QuicDispatchLockRelease(&Session->ConnectionsLock);
+    Connection->SessionShard =
+        (uint8_t)(QuicProcCurrentNumber() & (QUIC_SESSION_CONNECTION_SHARD_COUNT - 1));
+    QUIC_SESSION_CONNECTIONS* Shard = &Session->Connections[Connection->SessionShard];
+    QuicDispatchLockAcquire(&Shard->Lock);
+    QuicListInsertTail(&Shard->List, &Connection->SessionLink);
+    QuicDispatchLockRelease(&Shard->Lock);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -581,19 +881,100 @@ QuicSessionUnregisterConnection(
         "[conn][%p] Unregistered from session: %p",
         Connection,
         Session);
-    QuicDispatchLockAcquire(&Session->ConnectionsLock);
+    QUIC_SESSION_CONNECTIONS* Shard = &Session->Connections[Connection->SessionShard];
+    QuicDispatchLockAcquire(&Shard->Lock);
     QuicListEntryRemove(&Connection->SessionLink);
-    QuicDispatchLockRelease(&Session->ConnectionsLock);
+    QuicDispatchLockRelease(&Shard->Lock);
     QuicRundownRelease(&Session->Rundown);
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicSessionServerCacheInitialize(
+    _Inout_ QUIC_SESSION* Session
+    )
+{
+    for (uint32_t i = 0; i < QUIC_SERVER_CACHE_SHARD_COUNT; ++i) {
+        QUIC_SERVER_CACHE_SHARD* Shard = &Session->ServerCache[i];
+        if (!QuicHashtableInitializeEx(&Shard->Table, QUIC_HASH_MIN_SIZE)) {
+            QuicSessionServerCacheUninitialize(Session, i);
+            return FALSE;
+        }
+        QuicListInitializeHead(&Shard->Lru);
+        Shard->EntryCount = 0;
+        Shard->MemoryUsage = 0;
+    }
+    return TRUE;
+}
+
+//
+// Removes the entry from its shard and frees it. Requires the shard lock to
+// be held exclusively.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSessionServerCacheFreeEntry(
+    _Inout_ QUIC_SERVER_CACHE_SHARD* Shard,
+    _In_ __drv_freesMem(Mem) QUIC_SERVER_CACHE* Cache
+    )
+{
+    QuicHashtableRemove(&Shard->Table, &Cache->Entry, NULL);
+    QuicListEntryRemove(&Cache->LruLink);
+    Shard->EntryCount--;
+    Shard->MemoryUsage -= sizeof(QUIC_SERVER_CACHE) + Cache->ServerNameLength;
+
+    //
+    // Release the security config stored in this cache.
+    //
+    if (Cache->SecConfig != NULL) {
+        QuicTlsSecConfigRelease(Cache->SecConfig);
+    }
+
+    QUIC_FREE(Cache);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSessionServerCacheUninitialize(
+    _Inout_ QUIC_SESSION* Session,
+    _In_ uint32_t ShardCount
+    )
+{
+    for (uint32_t i = 0; i < ShardCount; ++i) {
+        QUIC_SERVER_CACHE_SHARD* Shard = &Session->ServerCache[i];
+        while (!QuicListIsEmpty(&Shard->Lru)) {
+            QuicSessionServerCacheFreeEntry(
+                Shard,
+                QUIC_CONTAINING_RECORD(Shard->Lru.Flink, QUIC_SERVER_CACHE, LruLink));
+        }
+        QuicHashtableUninitialize(&Shard->Table);
+    }
+}
+
 //
-// Requires Session->Lock to be held (shared or exclusive).
+// Returns the shard for the hash of a server name.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_SERVER_CACHE_SHARD*
+QuicSessionServerCacheGetShard(
+    _In_ QUIC_SESSION* Session,
+    _In_ uint32_t Hash
+    )
+{
+    //
+    // The low bits select the bucket within the shard's table, so use the
+    // high ones for the shard.
+    //
+    return &Session->ServerCache[(Hash >> 24) & (QUIC_SERVER_CACHE_SHARD_COUNT - 1)];
+}
+
+//
+// Requires Shard->Lock to be held (shared or exclusive).
 //
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_SERVER_CACHE*
 QuicSessionServerCacheLookup(
-    _In_ QUIC_SESSION* Session,
+    _In_ QUIC_SERVER_CACHE_SHARD* Shard,
     _In_ uint16_t ServerNameLength,
     _In_reads_(ServerNameLength)
         const char* ServerName,
@@ -602,7 +983,7 @@ QuicSessionServerCacheLookup(
 {
     QUIC_HASHTABLE_LOOKUP_CONTEXT Context;
     QUIC_HASHTABLE_ENTRY* Entry =
-        QuicHashtableLookup(&Session->ServerCache, Hash, &Context);
+        QuicHashtableLookup(&Shard->Table, Hash, &Context);
 
     while (Entry != NULL) {
         QUIC_SERVER_CACHE* Temp =
@@ -611,12 +992,39 @@ QuicSessionServerCacheLookup(
             memcmp(Temp->ServerName, ServerName, ServerNameLength) == 0) {
             return Temp;
         }
-        Entry = QuicHashtableLookupNext(&Session->ServerCache, &Context);
+        Entry = QuicHashtableLookupNext(&Shard->Table, &Context);
     }
 
     return NULL;
 }
 
+//
+// Evicts entries until the shard is back within its limits. Entries are
+// evicted in LRU order, except that entries read since they were last
+// considered are moved to the back of the list instead (i.e. CLOCK), as
+// reads only hold the shared lock and can't reorder the list themselves.
+// Requires Shard->Lock to be held exclusively.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSessionServerCacheEvict(
+    _Inout_ QUIC_SERVER_CACHE_SHARD* Shard
+    )
+{
+    while (Shard->EntryCount > QUIC_SERVER_CACHE_MAX_ENTRIES / QUIC_SERVER_CACHE_SHARD_COUNT ||
+           Shard->MemoryUsage > QUIC_SERVER_CACHE_MAX_MEMORY / QUIC_SERVER_CACHE_SHARD_COUNT) {
+        QUIC_SERVER_CACHE* Cache =
+            QUIC_CONTAINING_RECORD(Shard->Lru.Flink, QUIC_SERVER_CACHE, LruLink);
+        if (Cache->Referenced) {
+            Cache->Referenced = FALSE;
+            QuicListEntryRemove(&Cache->LruLink);
+            QuicListInsertTail(&Shard->Lru, &Cache->LruLink);
+            continue;
+        }
+        QuicSessionServerCacheFreeEntry(Shard, Cache);
+    }
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 _Success_(return != FALSE)
 BOOLEAN
@@ -630,17 +1038,21 @@ QuicSessionServerCacheGetState(
 {
     uint16_t ServerNameLength = (uint16_t)strlen(ServerName);
     uint32_t Hash = QuicHashSimple(ServerNameLength, (const uint8_t*)ServerName);
+    QUIC_SERVER_CACHE_SHARD* Shard = QuicSessionServerCacheGetShard(Session, Hash);
 
-    QuicRwLockAcquireShared(&Session->ServerCacheLock);
+    QuicRwLockAcquireShared(&Shard->Lock);
 
     QUIC_SERVER_CACHE* Cache =
         QuicSessionServerCacheLookup(
-            Session,
+            Shard,
             ServerNameLength,
             ServerName,
             Hash);
 
     if (Cache != NULL) {
+        if (!Cache->Referenced) {
+            Cache->Referenced = TRUE; // Benign race with other readers.
+        }
         *QuicVersion = Cache->QuicVersion;
         *Parameters = Cache->TransportParameters;
         if (Cache->SecConfig != NULL) {
@@ -650,11 +1062,44 @@ QuicSessionServerCacheGetState(
         }
     }
 
-    QuicRwLockReleaseShared(&Session->ServerCacheLock);
+    QuicRwLockReleaseShared(&Shard->Lock);
 
     return Cache != NULL;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_ADDRESS_FAMILY
+QuicSessionServerCacheGetFamily(
+    _In_ QUIC_SESSION* Session,
+    _In_z_ const char* ServerName
+    )
+{
+    uint16_t ServerNameLength = (uint16_t)strlen(ServerName);
+    uint32_t Hash = QuicHashSimple(ServerNameLength, (const uint8_t*)ServerName);
+    QUIC_SERVER_CACHE_SHARD* Shard = QuicSessionServerCacheGetShard(Session, Hash);
+    QUIC_ADDRESS_FAMILY Family = AF_UNSPEC;
+
+    QuicRwLockAcquireShared(&Shard->Lock);
+
+    QUIC_SERVER_CACHE* Cache =
+        QuicSessionServerCacheLookup(
+            Shard,
+            ServerNameLength,
+            ServerName,
+            Hash);
+    if (Cache != NULL) {
+        Family = Cache->RemoteFamily;
+    }
+
+    QuicRwLockReleaseShared(&Shard->Lock);
+
+    return Family;
+}
+
+//
+// RemoteFamily may be AF_UNSPEC, to leave any cached family
+// unchanged.
+//
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicSessionServerCacheSetStateInternal(
@@ -662,23 +1107,28 @@ QuicSessionServerCacheSetStateInternal(
     _In_ uint16_t ServerNameLength,
     _In_reads_(ServerNameLength)
         const char* ServerName,
+    _In_ QUIC_ADDRESS_FAMILY RemoteFamily,
     _In_ uint32_t QuicVersion,
     _In_ const QUIC_TRANSPORT_PARAMETERS* Parameters,
     _In_opt_ QUIC_SEC_CONFIG* SecConfig
     )
 {
     uint32_t Hash = QuicHashSimple(ServerNameLength, (const uint8_t*)ServerName);
+    QUIC_SERVER_CACHE_SHARD* Shard = QuicSessionServerCacheGetShard(Session, Hash);
 
-    QuicRwLockAcquireExclusive(&Session->ServerCacheLock);
+    QuicRwLockAcquireExclusive(&Shard->Lock);
 
     QUIC_SERVER_CACHE* Cache =
         QuicSessionServerCacheLookup(
-            Session,
+            Shard,
             ServerNameLength,
             ServerName,
             Hash);
 
     if (Cache != NULL) {
+        if (RemoteFamily != AF_UNSPEC) {
+            Cache->RemoteFamily = RemoteFamily;
+        }
         Cache->QuicVersion = QuicVersion;
         Cache->TransportParameters = *Parameters;
         if (SecConfig != NULL) {
@@ -687,6 +1137,8 @@ QuicSessionServerCacheSetStateInternal(
             }
             Cache->SecConfig = QuicTlsSecConfigAddRef(SecConfig);
         }
+        QuicListEntryRemove(&Cache->LruLink);
+        QuicListInsertTail(&Shard->Lru, &Cache->LruLink);
 
     } else {
 #pragma prefast(suppress: __WARNING_6014, "Memory is correctly freed (MsQuicSessionClose).")
@@ -696,13 +1148,20 @@ QuicSessionServerCacheSetStateInternal(
             memcpy(Cache + 1, ServerName, ServerNameLength);
             Cache->ServerName = (const char*)(Cache + 1);
             Cache->ServerNameLength = ServerNameLength;
+            Cache->Referenced = FALSE;
+            Cache->RemoteFamily = RemoteFamily;
             Cache->QuicVersion = QuicVersion;
             Cache->TransportParameters = *Parameters;
+            Cache->SecConfig = NULL;
             if (SecConfig != NULL) {
                 Cache->SecConfig = QuicTlsSecConfigAddRef(SecConfig);
             }
 
-            QuicHashtableInsert(&Session->ServerCache, &Cache->Entry, Hash, NULL);
+            QuicHashtableInsert(&Shard->Table, &Cache->Entry, Hash, NULL);
+            QuicListInsertTail(&Shard->Lru, &Cache->LruLink);
+            Shard->EntryCount++;
+            Shard->MemoryUsage += sizeof(QUIC_SERVER_CACHE) + ServerNameLength;
+            QuicSessionServerCacheEvict(Shard);
 
         } else {
             QuicTraceEvent(
@@ -713,7 +1172,7 @@ QuicSessionServerCacheSetStateInternal(
         }
     }
 
-    QuicRwLockReleaseExclusive(&Session->ServerCacheLock);
+    QuicRwLockReleaseExclusive(&Shard->Lock);
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -721,6 +1180,7 @@ void
 QuicSessionServerCacheSetState(
     _In_ QUIC_SESSION* Session,
     _In_z_ const char* ServerName,
+    _In_ QUIC_ADDRESS_FAMILY RemoteFamily,
     _In_ uint32_t QuicVersion,
     _In_ const QUIC_TRANSPORT_PARAMETERS* Parameters,
     _In_ QUIC_SEC_CONFIG* SecConfig
@@ -730,11 +1190,83 @@ QuicSessionServerCacheSetState(
         Session,
         (uint16_t)strlen(ServerName),
         ServerName,
+        RemoteFamily,
         QuicVersion,
         Parameters,
         SecConfig);
 }
 
+//
+// Writes the network (prefix) of the remote address, with the rest of the
+// address (including the port) zeroed.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSessionPathMetricsGetPrefix(
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _Out_ QUIC_ADDR* Prefix
+    )
+{
+    QuicZeroMemory(Prefix, sizeof(*Prefix));
+    QuicAddrSetFamily(Prefix, QuicAddrGetFamily(RemoteAddress));
+    if (QuicAddrGetFamily(RemoteAddress) == AF_INET) {
+        QuicCopyMemory(&Prefix->Ipv4.sin_addr, &RemoteAddress->Ipv4.sin_addr, 3);
+    } else {
+        QuicCopyMemory(&Prefix->Ipv6.sin6_addr, &RemoteAddress->Ipv6.sin6_addr, 6);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Success_(return!=FALSE)
+BOOLEAN
+QuicSessionPathMetricsGet(
+    _In_ QUIC_SESSION* Session,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _Out_ QUIC_PATH_METRICS* Metrics
+    )
+{
+    QUIC_ADDR Prefix;
+    QuicSessionPathMetricsGetPrefix(RemoteAddress, &Prefix);
+    QUIC_PATH_METRICS* Entry =
+        &Session->PathMetrics[QuicAddrHash(&Prefix) % QUIC_PATH_METRICS_CACHE_SIZE];
+    BOOLEAN Found = FALSE;
+
+    QuicDispatchLockAcquire(&Session->PathMetricsLock);
+    if (Entry->InUse &&
+        QuicAddrGetFamily(&Entry->Prefix) == QuicAddrGetFamily(&Prefix) &&
+        QuicAddrCompareIp(&Entry->Prefix, &Prefix)) {
+        *Metrics = *Entry;
+        Found = TRUE;
+    }
+    QuicDispatchLockRelease(&Session->PathMetricsLock);
+
+    return Found;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSessionPathMetricsSet(
+    _In_ QUIC_SESSION* Session,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_ uint32_t CongestionWindow,
+    _In_ uint32_t MinRtt,
+    _In_ uint16_t Mtu
+    )
+{
+    QUIC_ADDR Prefix;
+    QuicSessionPathMetricsGetPrefix(RemoteAddress, &Prefix);
+    QUIC_PATH_METRICS* Entry =
+        &Session->PathMetrics[QuicAddrHash(&Prefix) % QUIC_PATH_METRICS_CACHE_SIZE];
+
+    QuicDispatchLockAcquire(&Session->PathMetricsLock);
+    Entry->Prefix = Prefix;
+    Entry->CongestionWindow = CongestionWindow;
+    Entry->MinRtt = MinRtt;
+    Entry->Mtu = Mtu;
+    Entry->InUse = TRUE;
+    QuicDispatchLockRelease(&Session->PathMetricsLock);
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicSessionParamGet(
@@ -787,6 +1319,25 @@ QuicSessionParamGet(
         Status = QUIC_STATUS_SUCCESS;
         break;
 
+    case QUIC_PARAM_SESSION_PEER_STREAM_COUNT_MAX:
+
+        if (*BufferLength < sizeof(Session->Settings.PeerStreamCountMax)) {
+            *BufferLength = sizeof(Session->Settings.PeerStreamCountMax);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(Session->Settings.PeerStreamCountMax);
+        *(uint16_t*)Buffer = Session->Settings.PeerStreamCountMax;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
     case QUIC_PARAM_SESSION_IDLE_TIMEOUT:
 
         if (*BufferLength < sizeof(Session->Settings.IdleTimeoutMs)) {
@@ -879,6 +1430,42 @@ QuicSessionParamGet(
         Status = QUIC_STATUS_SUCCESS;
         break;
 
+    case QUIC_PARAM_SESSION_PATH_METRICS_CACHE_ENABLED:
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = Session->Settings.PathMetricsCacheEnabled;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_SESSION_INTEGRITY_ONLY_ENABLED:
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = Session->Settings.IntegrityOnlyEnabled;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
     case QUIC_PARAM_SESSION_SERVER_RESUMPTION_LEVEL:
         if (*BufferLength  < sizeof(QUIC_SERVER_RESUMPTION_LEVEL)) {
             *BufferLength = sizeof(QUIC_SERVER_RESUMPTION_LEVEL);
@@ -898,6 +1485,46 @@ QuicSessionParamGet(
         Status = QUIC_STATUS_SUCCESS;
         break;
 
+    case QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM:
+        if (*BufferLength < sizeof(uint16_t)) {
+            *BufferLength = sizeof(uint16_t);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(uint16_t);
+        *(uint16_t*)Buffer = Session->Settings.CongestionControlAlgorithm;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_SESSION_STATS: {
+        if (*BufferLength < sizeof(QUIC_SESSION_STATISTICS)) {
+            *BufferLength = sizeof(QUIC_SESSION_STATISTICS);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(QUIC_SESSION_STATISTICS);
+        QUIC_SESSION_STATISTICS* Stats = (QUIC_SESSION_STATISTICS*)Buffer;
+
+        Stats->TotalResumptionsAccepted = (uint64_t)Session->ResumptionsAccepted;
+        Stats->TotalResumptionsRejected = (uint64_t)Session->ResumptionsRejected;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
     default:
         Status = QUIC_STATUS_INVALID_PARAMETER;
         break;
@@ -928,9 +1555,35 @@ QuicSessionParamSet(
         }
 
         Status =
-            QuicTlsSessionSetTicketKey(
+            QuicTlsSessionSetTicketKeys(
+                Session->TlsSession,
+                1,
+                Buffer);
+        break;
+    }
+
+    case QUIC_PARAM_SESSION_TLS_TICKET_KEYS: {
+
+        if (BufferLength == 0 ||
+            BufferLength % QUIC_TICKET_KEY_LENGTH != 0 ||
+            BufferLength / QUIC_TICKET_KEY_LENGTH > QUIC_MAX_TICKET_KEY_COUNT ||
+            Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        Status =
+            QuicTlsSessionSetTicketKeys(
                 Session->TlsSession,
+                BufferLength / QUIC_TICKET_KEY_LENGTH,
                 Buffer);
+
+        QuicTraceLogInfo(
+            SessionTicketKeysSet,
+            "[sess][%p] Updated ticket keys (count=%u), 0x%x",
+            Session,
+            BufferLength / QUIC_TICKET_KEY_LENGTH,
+            Status);
         break;
     }
 
@@ -974,6 +1627,26 @@ QuicSessionParamSet(
         break;
     }
 
+    case QUIC_PARAM_SESSION_PEER_STREAM_COUNT_MAX: {
+
+        if (BufferLength != sizeof(uint16_t)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        Session->Settings.AppSet.PeerStreamCountMax = TRUE;
+        Session->Settings.PeerStreamCountMax = *(uint16_t*)Buffer;
+
+        QuicTraceLogInfo(
+            SessionPeerStreamCountMaxSet,
+            "[sess][%p] Updated peer stream count max = %hu",
+            Session,
+            Session->Settings.PeerStreamCountMax);
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
     case QUIC_PARAM_SESSION_IDLE_TIMEOUT: {
 
         if (BufferLength != sizeof(Session->Settings.IdleTimeoutMs)) {
@@ -1037,6 +1710,7 @@ QuicSessionParamSet(
             Session,
             State->ServerNameLength,
             ServerName,
+            AF_UNSPEC,
             State->QuicVersion,
             &State->TransportParameters,
             NULL);
@@ -1112,6 +1786,44 @@ QuicSessionParamSet(
         break;
     }
 
+    case QUIC_PARAM_SESSION_PATH_METRICS_CACHE_ENABLED: {
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        Session->Settings.AppSet.PathMetricsCacheEnabled = TRUE;
+        Session->Settings.PathMetricsCacheEnabled = *(BOOLEAN*)Buffer;
+
+        QuicTraceLogInfo(
+            SessionPathMetricsCacheEnabledSet,
+            "[sess][%p] Updated path metrics cache enabled to %hhu",
+            Session,
+            Session->Settings.PathMetricsCacheEnabled);
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
+    case QUIC_PARAM_SESSION_INTEGRITY_ONLY_ENABLED: {
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        Session->Settings.AppSet.IntegrityOnlyEnabled = TRUE;
+        Session->Settings.IntegrityOnlyEnabled = *(BOOLEAN*)Buffer;
+
+        QuicTraceLogInfo(
+            SessionIntegrityOnlyEnabledSet,
+            "[sess][%p] Updated integrity-only enabled to %hhu",
+            Session,
+            Session->Settings.IntegrityOnlyEnabled);
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
     case QUIC_PARAM_SESSION_SERVER_RESUMPTION_LEVEL: {
         if (BufferLength != sizeof(QUIC_SERVER_RESUMPTION_LEVEL) ||
             Buffer == NULL ||
@@ -1134,6 +1846,27 @@ QuicSessionParamSet(
         break;
     }
 
+    case QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM: {
+        if (BufferLength != sizeof(uint16_t) ||
+            Buffer == NULL ||
+            *(uint16_t*)Buffer >= QUIC_CONGESTION_CONTROL_ALGORITHM_COUNT) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        Session->Settings.AppSet.CongestionControlAlgorithm = TRUE;
+        Session->Settings.CongestionControlAlgorithm = *(uint16_t*)Buffer;
+
+        QuicTraceLogInfo(
+            SessionCongestionControlAlgorithmSet,
+            "[sess][%p] Updated congestion control algorithm to %hu",
+            Session,
+            Session->Settings.CongestionControlAlgorithm);
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
     default:
         Status = QUIC_STATUS_INVALID_PARAMETER;
         break;
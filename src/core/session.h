@@ -21,18 +21,135 @@ typedef struct QUIC_SERVER_CACHE {
 
     QUIC_HASHTABLE_ENTRY Entry;
 
+    //
+    // Link in the shard's LRU list.
+    //
+    QUIC_LIST_ENTRY LruLink;
+
+    //
+    // Set when the entry is read (under the shared lock), so that it gets a
+    // second chance before being evicted.
+    //
+    BOOLEAN Referenced;
+
     const char* ServerName;
 
     uint16_t ServerNameLength;
 
     uint32_t QuicVersion;
 
+    //
+    // The address family of the last completed connection to the server, or
+    // AF_UNSPEC if unknown.
+    //
+    QUIC_ADDRESS_FAMILY RemoteFamily;
+
     QUIC_TRANSPORT_PARAMETERS TransportParameters;
 
     QUIC_SEC_CONFIG* SecConfig;
 
 } QUIC_SERVER_CACHE;
 
+QUIC_STATIC_ASSERT(IS_POWER_OF_TWO(QUIC_SERVER_CACHE_SHARD_COUNT), L"Must be power of two");
+
+//
+// A subset of the cached server state, selected by the hash of the server
+// name, with its own lock.
+//
+typedef struct QUIC_SERVER_CACHE_SHARD {
+
+    QUIC_RW_LOCK Lock;
+
+    QUIC_HASHTABLE Table;
+
+    //
+    // List of entries, least recently used (updated) first.
+    //
+    QUIC_LIST_ENTRY Lru;
+
+    uint32_t EntryCount;
+
+    //
+    // Total bytes allocated for the entries.
+    //
+    uint32_t MemoryUsage;
+
+} QUIC_SERVER_CACHE_SHARD;
+
+QUIC_STATIC_ASSERT(IS_POWER_OF_TWO(QUIC_SESSION_CONNECTION_SHARD_COUNT), L"Must be power of two");
+
+//
+// A subset of the session's connections, with its own lock.
+//
+typedef struct QUIC_SESSION_CONNECTIONS {
+
+    QUIC_DISPATCH_LOCK Lock;
+
+    QUIC_LIST_ENTRY List;
+
+} QUIC_SESSION_CONNECTIONS;
+
+//
+// Path characteristics last measured by a client connection to a remote
+// network, used to seed new connections to the same network.
+//
+typedef struct QUIC_PATH_METRICS {
+
+    //
+    // The remote network: the remote IP address with only its first 24 (IPv4)
+    // or 48 (IPv6) bits kept.
+    //
+    QUIC_ADDR Prefix;
+
+    uint32_t CongestionWindow;  // bytes
+    uint32_t MinRtt;            // microsec
+    uint16_t Mtu;
+
+    BOOLEAN InUse;
+
+} QUIC_PATH_METRICS;
+
+//
+// A client connection in (or removed from, but not yet closed by) the
+// session's connection pool.
+//
+typedef struct QUIC_POOLED_CONNECTION {
+
+    //
+    // Link in the session's ConnectionPool list.
+    //
+    QUIC_LIST_ENTRY Link;
+
+    QUIC_SESSION* Session;
+
+    QUIC_CONNECTION* Connection;
+
+    //
+    // Indicates the connection is still in the pool, i.e. it isn't shutting
+    // down and new streams may be opened on it.
+    //
+    BOOLEAN InPool;
+
+    //
+    // Indicates the connection has completed its shutdown. Its handle is
+    // closed once there are no more streams.
+    //
+    BOOLEAN ShutdownComplete;
+
+    //
+    // The number of streams opened through the pool whose handles haven't
+    // been closed by the app yet.
+    //
+    uint32_t StreamCount;
+
+    uint16_t ServerPort;
+
+    uint16_t ServerNameLength;
+    _Field_size_(ServerNameLength + 1)
+    char ServerName[0];
+
+} QUIC_POOLED_CONNECTION;
+
 //
 // Represents a library session context.
 //
@@ -90,14 +207,36 @@ typedef struct QUIC_SESSION {
     //
     // Per server cached state information.
     //
-    QUIC_HASHTABLE ServerCache;
-    QUIC_RW_LOCK ServerCacheLock;
+    QUIC_SERVER_CACHE_SHARD ServerCache[QUIC_SERVER_CACHE_SHARD_COUNT];
+
+    //
+    // Counts of server handshakes where the client offered a resumption
+    // ticket, by whether the ticket was accepted.
+    //
+    int64_t ResumptionsAccepted;
+    int64_t ResumptionsRejected;
+
+    //
+    // All connections in the session, split by the processor they were
+    // registered on, so that connections accepted and closed on different
+    // workers don't contend on one lock.
+    //
+    QUIC_SESSION_CONNECTIONS Connections[QUIC_SESSION_CONNECTION_SHARD_COUNT];
 
     //
-    // List of all connections in the session.
+    // List of QUIC_POOLED_CONNECTION, used by PoolStreamOpen. Lookups are
+    // linear, as an app only talks to a handful of servers.
     //
-    QUIC_LIST_ENTRY Connections;
-    QUIC_DISPATCH_LOCK ConnectionsLock;
+    QUIC_LIST_ENTRY ConnectionPool;
+    QUIC_LOCK ConnectionPoolLock;
+
+    //
+    // Cache of path metrics by remote network, used when the
+    // PathMetricsCacheEnabled setting is set. Direct mapped by a hash of the
+    // prefix, so a new network simply replaces the one it collides with.
+    //
+    QUIC_DISPATCH_LOCK PathMetricsLock;
+    QUIC_PATH_METRICS PathMetrics[QUIC_PATH_METRICS_CACHE_SIZE];
 
     //
     // The application layer protocol negotiation buffers. Encoded in the TLS
@@ -228,6 +367,26 @@ QuicSessionParamSet(
         const void* Buffer
     );
 
+//
+// Initializes the (empty) tables of all server cache shards.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicSessionServerCacheInitialize(
+    _Inout_ QUIC_SESSION* Session
+    );
+
+//
+// Frees all entries in, and uninitializes the tables of, the first ShardCount
+// server cache shards.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSessionServerCacheUninitialize(
+    _Inout_ QUIC_SESSION* Session,
+    _In_ uint32_t ShardCount
+    );
+
 //
 // Gets a previously cached server state.
 //
@@ -242,6 +401,17 @@ QuicSessionServerCacheGetState(
     _Out_ QUIC_SEC_CONFIG** SecConfig
     );
 
+//
+// Gets the address family a previous connection to the server completed its
+// handshake over. Returns AF_UNSPEC if not cached.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_ADDRESS_FAMILY
+QuicSessionServerCacheGetFamily(
+    _In_ QUIC_SESSION* Session,
+    _In_z_ const char* ServerName
+    );
+
 //
 // Sets/updates cached server state.
 //
@@ -250,7 +420,56 @@ void
 QuicSessionServerCacheSetState(
     _In_ QUIC_SESSION* Session,
     _In_z_ const char* ServerName,
+    _In_ QUIC_ADDRESS_FAMILY RemoteFamily,
     _In_ uint32_t QuicVersion,
     _In_ const QUIC_TRANSPORT_PARAMETERS* Parameters,
     _In_ QUIC_SEC_CONFIG* SecConfig
     );
+
+//
+// Gets the cached path metrics for the remote address's network.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Success_(return!=FALSE)
+BOOLEAN
+QuicSessionPathMetricsGet(
+    _In_ QUIC_SESSION* Session,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _Out_ QUIC_PATH_METRICS* Metrics
+    );
+
+//
+// Sets/updates the cached path metrics for the remote address's network.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicSessionPathMetricsSet(
+    _In_ QUIC_SESSION* Session,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_ uint32_t CongestionWindow,
+    _In_ uint32_t MinRtt,
+    _In_ uint16_t Mtu
+    );
+
+//
+// Callback handler for the pooled connections' events.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Function_class_(QUIC_CONNECTION_CALLBACK)
+QUIC_STATUS
+QUIC_API
+QuicSessionConnectionPoolCallback(
+    _In_ HQUIC Connection,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_CONNECTION_EVENT* Event
+    );
+
+//
+// Called on the connection's worker after the app closed a stream opened
+// through the connection pool.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSessionConnectionPoolOnStreamClosed(
+    _In_ QUIC_CONNECTION* Connection
+    );
@@ -38,6 +38,9 @@ QuicSettingsSetDefault(
     if (!Settings->AppSet.RetryMemoryLimit) {
         Settings->RetryMemoryLimit = QUIC_DEFAULT_RETRY_MEMORY_FRACTION;
     }
+    if (!Settings->AppSet.MemoryBudgetLimit) {
+        Settings->MemoryBudgetLimit = QUIC_DEFAULT_MEMORY_BUDGET_FRACTION;
+    }
     if (!Settings->AppSet.LoadBalancingMode) {
         Settings->LoadBalancingMode = QUIC_DEFAULT_LOAD_BALANCING_MODE;
     }
@@ -47,6 +50,9 @@ QuicSettingsSetDefault(
     if (!Settings->AppSet.MaxStatelessOperations) {
         Settings->MaxStatelessOperations = QUIC_MAX_STATELESS_OPERATIONS;
     }
+    if (!Settings->AppSet.MaxWorkerHandshakes) {
+        Settings->MaxWorkerHandshakes = QUIC_MAX_WORKER_HANDSHAKES;
+    }
     if (!Settings->AppSet.InitialWindowPackets) {
         Settings->InitialWindowPackets = QUIC_INITIAL_WINDOW_PACKETS;
     }
@@ -65,6 +71,12 @@ QuicSettingsSetDefault(
     if (!Settings->AppSet.KeepAliveIntervalMs) {
         Settings->KeepAliveIntervalMs = QUIC_DEFAULT_KEEP_ALIVE_INTERVAL;
     }
+    if (!Settings->AppSet.HibernateTimeoutMs) {
+        Settings->HibernateTimeoutMs = QUIC_DEFAULT_HIBERNATE_TIMEOUT;
+    }
+    if (!Settings->AppSet.HappyEyeballsDelayMs) {
+        Settings->HappyEyeballsDelayMs = QUIC_DEFAULT_HAPPY_EYEBALLS_DELAY;
+    }
     if (!Settings->AppSet.IdleTimeoutMs) {
         Settings->IdleTimeoutMs = QUIC_DEFAULT_IDLE_TIMEOUT;
     }
@@ -77,6 +89,9 @@ QuicSettingsSetDefault(
     if (!Settings->AppSet.UnidiStreamCount) {
         Settings->UnidiStreamCount = 0;
     }
+    if (!Settings->AppSet.PeerStreamCountMax) {
+        Settings->PeerStreamCountMax = QUIC_DEFAULT_PEER_STREAM_COUNT_MAX;
+    }
     if (!Settings->AppSet.TlsClientMaxSendBuffer) {
         Settings->TlsClientMaxSendBuffer = QUIC_MAX_TLS_CLIENT_SEND_BUFFER;
     }
@@ -92,12 +107,57 @@ QuicSettingsSetDefault(
     if (!Settings->AppSet.ConnFlowControlWindow) {
         Settings->ConnFlowControlWindow = QUIC_DEFAULT_CONN_FLOW_CONTROL_WINDOW;
     }
+    if (!Settings->AppSet.StreamRecvWindowMax) {
+        Settings->StreamRecvWindowMax = QUIC_DEFAULT_STREAM_RECV_WINDOW_MAX;
+    }
     if (!Settings->AppSet.MaxBytesPerKey) {
         Settings->MaxBytesPerKey = QUIC_DEFAULT_MAX_BYTES_PER_KEY;
     }
     if (!Settings->AppSet.ServerResumptionLevel) {
         Settings->ServerResumptionLevel = QUIC_DEFAULT_SERVER_RESUMPTION_LEVEL;
     }
+    if (!Settings->AppSet.CongestionControlAlgorithm) {
+        Settings->CongestionControlAlgorithm = QUIC_DEFAULT_CONGESTION_CONTROL_ALGORITHM;
+    }
+    if (!Settings->AppSet.HyStartEnabled) {
+        Settings->HyStartEnabled = QUIC_DEFAULT_HYSTART_ENABLED;
+    }
+    if (!Settings->AppSet.BusyPollUs) {
+        Settings->BusyPollUs = QUIC_DEFAULT_BUSY_POLL_US;
+    }
+    if (!Settings->AppSet.HandshakeOffloadThreadCount) {
+        Settings->HandshakeOffloadThreadCount = QUIC_DEFAULT_HANDSHAKE_OFFLOAD_THREAD_COUNT;
+    }
+    if (!Settings->AppSet.DecryptHelperThreadCount) {
+        Settings->DecryptHelperThreadCount = QUIC_DEFAULT_DECRYPT_HELPER_THREAD_COUNT;
+    }
+    if (!Settings->AppSet.CidSteeringEnabled) {
+        Settings->CidSteeringEnabled = QUIC_DEFAULT_CID_STEERING_ENABLED;
+    }
+    if (!Settings->AppSet.CidRouteTableBits) {
+        Settings->CidRouteTableBits = QUIC_DEFAULT_CID_ROUTE_TABLE_BITS;
+    }
+    if (!Settings->AppSet.DnsCacheTimeoutMs) {
+        Settings->DnsCacheTimeoutMs = QUIC_DEFAULT_DNS_CACHE_TIMEOUT;
+    }
+    if (!Settings->AppSet.MaxDrainTimeUs) {
+        Settings->MaxDrainTimeUs = QUIC_DEFAULT_MAX_DRAIN_TIME_US;
+    }
+    if (!Settings->AppSet.ZeroCopyRecvEnabled) {
+        Settings->ZeroCopyRecvEnabled = QUIC_DEFAULT_ZERO_COPY_RECV_ENABLED;
+    }
+    if (!Settings->AppSet.EcnEnabled) {
+        Settings->EcnEnabled = QUIC_DEFAULT_ECN_ENABLED;
+    }
+    if (!Settings->AppSet.PacingOffloadEnabled) {
+        Settings->PacingOffloadEnabled = QUIC_DEFAULT_PACING_OFFLOAD_ENABLED;
+    }
+    if (!Settings->AppSet.PathMetricsCacheEnabled) {
+        Settings->PathMetricsCacheEnabled = QUIC_DEFAULT_PATH_METRICS_CACHE_ENABLED;
+    }
+    if (!Settings->AppSet.IntegrityOnlyEnabled) {
+        Settings->IntegrityOnlyEnabled = QUIC_DEFAULT_INTEGRITY_ONLY_ENABLED;
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -125,6 +185,9 @@ QuicSettingsCopy(
     if (!Settings->AppSet.RetryMemoryLimit) {
         Settings->RetryMemoryLimit = ParentSettings->RetryMemoryLimit;
     }
+    if (!Settings->AppSet.MemoryBudgetLimit) {
+        Settings->MemoryBudgetLimit = ParentSettings->MemoryBudgetLimit;
+    }
     if (!Settings->AppSet.LoadBalancingMode) {
         Settings->LoadBalancingMode = ParentSettings->LoadBalancingMode;
     }
@@ -134,6 +197,9 @@ QuicSettingsCopy(
     if (!Settings->AppSet.MaxStatelessOperations) {
         Settings->MaxStatelessOperations = ParentSettings->MaxStatelessOperations;
     }
+    if (!Settings->AppSet.MaxWorkerHandshakes) {
+        Settings->MaxWorkerHandshakes = ParentSettings->MaxWorkerHandshakes;
+    }
     if (!Settings->AppSet.InitialWindowPackets) {
         Settings->InitialWindowPackets = ParentSettings->InitialWindowPackets;
     }
@@ -152,6 +218,12 @@ QuicSettingsCopy(
     if (!Settings->AppSet.KeepAliveIntervalMs) {
         Settings->KeepAliveIntervalMs = ParentSettings->KeepAliveIntervalMs;
     }
+    if (!Settings->AppSet.HibernateTimeoutMs) {
+        Settings->HibernateTimeoutMs = ParentSettings->HibernateTimeoutMs;
+    }
+    if (!Settings->AppSet.HappyEyeballsDelayMs) {
+        Settings->HappyEyeballsDelayMs = ParentSettings->HappyEyeballsDelayMs;
+    }
     if (!Settings->AppSet.IdleTimeoutMs) {
         Settings->IdleTimeoutMs = ParentSettings->IdleTimeoutMs;
     }
@@ -164,6 +236,9 @@ QuicSettingsCopy(
     if (!Settings->AppSet.UnidiStreamCount) {
         Settings->UnidiStreamCount = ParentSettings->UnidiStreamCount;
     }
+    if (!Settings->AppSet.PeerStreamCountMax) {
+        Settings->PeerStreamCountMax = ParentSettings->PeerStreamCountMax;
+    }
     if (!Settings->AppSet.TlsClientMaxSendBuffer) {
         Settings->TlsClientMaxSendBuffer = ParentSettings->TlsClientMaxSendBuffer;
     }
@@ -179,12 +254,57 @@ QuicSettingsCopy(
     if (!Settings->AppSet.ConnFlowControlWindow) {
         Settings->ConnFlowControlWindow = ParentSettings->ConnFlowControlWindow;
     }
+    if (!Settings->AppSet.StreamRecvWindowMax) {
+        Settings->StreamRecvWindowMax = ParentSettings->StreamRecvWindowMax;
+    }
     if (!Settings->AppSet.MaxBytesPerKey) {
         Settings->MaxBytesPerKey = ParentSettings->MaxBytesPerKey;
     }
     if (!Settings->AppSet.ServerResumptionLevel) {
         Settings->ServerResumptionLevel = ParentSettings->ServerResumptionLevel;
     }
+    if (!Settings->AppSet.CongestionControlAlgorithm) {
+        Settings->CongestionControlAlgorithm = ParentSettings->CongestionControlAlgorithm;
+    }
+    if (!Settings->AppSet.HyStartEnabled) {
+        Settings->HyStartEnabled = ParentSettings->HyStartEnabled;
+    }
+    if (!Settings->AppSet.BusyPollUs) {
+        Settings->BusyPollUs = ParentSettings->BusyPollUs;
+    }
+    if (!Settings->AppSet.HandshakeOffloadThreadCount) {
+        Settings->HandshakeOffloadThreadCount = ParentSettings->HandshakeOffloadThreadCount;
+    }
+    if (!Settings->AppSet.DecryptHelperThreadCount) {
+        Settings->DecryptHelperThreadCount = ParentSettings->DecryptHelperThreadCount;
+    }
+    if (!Settings->AppSet.CidSteeringEnabled) {
+        Settings->CidSteeringEnabled = ParentSettings->CidSteeringEnabled;
+    }
+    if (!Settings->AppSet.CidRouteTableBits) {
+        Settings->CidRouteTableBits = ParentSettings->CidRouteTableBits;
+    }
+    if (!Settings->AppSet.DnsCacheTimeoutMs) {
+        Settings->DnsCacheTimeoutMs = ParentSettings->DnsCacheTimeoutMs;
+    }
+    if (!Settings->AppSet.MaxDrainTimeUs) {
+        Settings->MaxDrainTimeUs = ParentSettings->MaxDrainTimeUs;
+    }
+    if (!Settings->AppSet.ZeroCopyRecvEnabled) {
+        Settings->ZeroCopyRecvEnabled = ParentSettings->ZeroCopyRecvEnabled;
+    }
+    if (!Settings->AppSet.EcnEnabled) {
+        Settings->EcnEnabled = ParentSettings->EcnEnabled;
+    }
+    if (!Settings->AppSet.PacingOffloadEnabled) {
+        Settings->PacingOffloadEnabled = ParentSettings->PacingOffloadEnabled;
+    }
+    if (!Settings->AppSet.PathMetricsCacheEnabled) {
+        Settings->PathMetricsCacheEnabled = ParentSettings->PathMetricsCacheEnabled;
+    }
+    if (!Settings->AppSet.IntegrityOnlyEnabled) {
+        Settings->IntegrityOnlyEnabled = ParentSettings->IntegrityOnlyEnabled;
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -274,6 +394,19 @@ QuicSettingsLoad(
         }
     }
 
+    if (!Settings->AppSet.MemoryBudgetLimit) {
+        Value = QUIC_DEFAULT_MEMORY_BUDGET_FRACTION;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_MEMORY_BUDGET_FRACTION,
+            (uint8_t*)&Value,
+            &ValueLen);
+        if (Value <= UINT16_MAX) {
+            Settings->MemoryBudgetLimit = (uint16_t)Value;
+        }
+    }
+
     if (!Settings->AppSet.LoadBalancingMode &&
         !MsQuicLib.InUse) {
         Value = QUIC_DEFAULT_LOAD_BALANCING_MODE;
@@ -283,7 +416,7 @@ QuicSettingsLoad(
             QUIC_SETTING_LOAD_BALANCING_MODE,
             (uint8_t*)&Value,
             &ValueLen);
-        if (Value <= QUIC_LOAD_BALANCING_SERVER_ID_IP) {
+        if (Value <= QUIC_LOAD_BALANCING_SERVER_ID_BLOCK_CIPHER) {
             Settings->LoadBalancingMode = (uint16_t)Value;
         }
     }
@@ -308,6 +441,15 @@ QuicSettingsLoad(
             &ValueLen);
     }
 
+    if (!Settings->AppSet.MaxWorkerHandshakes) {
+        ValueLen = sizeof(Settings->MaxWorkerHandshakes);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_MAX_WORKER_HANDSHAKES,
+            (uint8_t*)&Settings->MaxWorkerHandshakes,
+            &ValueLen);
+    }
+
     if (!Settings->AppSet.InitialWindowPackets) {
         ValueLen = sizeof(Settings->InitialWindowPackets);
         QuicStorageReadValue(
@@ -368,6 +510,24 @@ QuicSettingsLoad(
             &ValueLen);
     }
 
+    if (!Settings->AppSet.HibernateTimeoutMs) {
+        ValueLen = sizeof(Settings->HibernateTimeoutMs);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_HIBERNATE_TIMEOUT,
+            (uint8_t*)&Settings->HibernateTimeoutMs,
+            &ValueLen);
+    }
+
+    if (!Settings->AppSet.HappyEyeballsDelayMs) {
+        ValueLen = sizeof(Settings->HappyEyeballsDelayMs);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_HAPPY_EYEBALLS_DELAY,
+            (uint8_t*)&Settings->HappyEyeballsDelayMs,
+            &ValueLen);
+    }
+
     if (!Settings->AppSet.IdleTimeoutMs) {
         QUIC_STATIC_ASSERT(sizeof(MultiValue) == sizeof(Settings->IdleTimeoutMs), "These must be the same size");
         ValueLen = sizeof(MultiValue);
@@ -453,6 +613,15 @@ QuicSettingsLoad(
             &ValueLen);
     }
 
+    if (!Settings->AppSet.StreamRecvWindowMax) {
+        ValueLen = sizeof(Settings->StreamRecvWindowMax);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_STREAM_RECV_WINDOW_MAX,
+            (uint8_t*)&Settings->StreamRecvWindowMax,
+            &ValueLen);
+    }
+
     if (!Settings->AppSet.MaxBytesPerKey) {
         ValueLen = sizeof(Settings->MaxBytesPerKey);
         QuicStorageReadValue(
@@ -465,6 +634,18 @@ QuicSettingsLoad(
         }
     }
 
+    if (!Settings->AppSet.PeerStreamCountMax) {
+        Value = QUIC_DEFAULT_PEER_STREAM_COUNT_MAX;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_PEER_STREAM_COUNT_MAX,
+            (uint8_t*)&Value,
+            &ValueLen);
+        Settings->PeerStreamCountMax =
+            Value > UINT16_MAX ? UINT16_MAX : (uint16_t)Value;
+    }
+
     if (!Settings->AppSet.ServerResumptionLevel) {
         ValueLen = sizeof(Value);
         QuicStorageReadValue(
@@ -477,6 +658,162 @@ QuicSettingsLoad(
         }
         Settings->ServerResumptionLevel = (uint8_t)Value;
     }
+
+    if (!Settings->AppSet.CongestionControlAlgorithm) {
+        Value = QUIC_DEFAULT_CONGESTION_CONTROL_ALGORITHM;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_CONGESTION_CONTROL_ALGORITHM,
+            (uint8_t*)&Value,
+            &ValueLen);
+        if (Value < QUIC_CONGESTION_CONTROL_ALGORITHM_COUNT) {
+            Settings->CongestionControlAlgorithm = (uint16_t)Value;
+        }
+    }
+
+    if (!Settings->AppSet.HyStartEnabled) {
+        Value = QUIC_DEFAULT_HYSTART_ENABLED;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_HYSTART_ENABLED,
+            (uint8_t*)&Value,
+            &ValueLen);
+        Settings->HyStartEnabled = !!Value;
+    }
+
+    if (!Settings->AppSet.BusyPollUs) {
+        ValueLen = sizeof(Settings->BusyPollUs);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_BUSY_POLL_US,
+            (uint8_t*)&Settings->BusyPollUs,
+            &ValueLen);
+    }
+
+    if (!Settings->AppSet.HandshakeOffloadThreadCount) {
+        Value = QUIC_DEFAULT_HANDSHAKE_OFFLOAD_THREAD_COUNT;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_HANDSHAKE_OFFLOAD_THREADS,
+            (uint8_t*)&Value,
+            &ValueLen);
+        if (Value <= UINT16_MAX) {
+            Settings->HandshakeOffloadThreadCount = (uint16_t)Value;
+        }
+    }
+
+    if (!Settings->AppSet.DecryptHelperThreadCount) {
+        Value = QUIC_DEFAULT_DECRYPT_HELPER_THREAD_COUNT;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_DECRYPT_HELPER_THREADS,
+            (uint8_t*)&Value,
+            &ValueLen);
+        if (Value <= UINT16_MAX) {
+            Settings->DecryptHelperThreadCount = (uint16_t)Value;
+        }
+    }
+
+    if (!Settings->AppSet.CidSteeringEnabled) {
+        Value = QUIC_DEFAULT_CID_STEERING_ENABLED;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_CID_STEERING_ENABLED,
+            (uint8_t*)&Value,
+            &ValueLen);
+        Settings->CidSteeringEnabled = !!Value;
+    }
+
+    if (!Settings->AppSet.CidRouteTableBits) {
+        Value = QUIC_DEFAULT_CID_ROUTE_TABLE_BITS;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_CID_ROUTE_TABLE_BITS,
+            (uint8_t*)&Value,
+            &ValueLen);
+        if (Value <= QUIC_MAX_CID_ROUTE_TABLE_BITS) {
+            Settings->CidRouteTableBits = (uint8_t)Value;
+        }
+    }
+
+    if (!Settings->AppSet.DnsCacheTimeoutMs) {
+        ValueLen = sizeof(Settings->DnsCacheTimeoutMs);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_DNS_CACHE_TIMEOUT,
+            (uint8_t*)&Settings->DnsCacheTimeoutMs,
+            &ValueLen);
+    }
+
+    if (!Settings->AppSet.MaxDrainTimeUs) {
+        ValueLen = sizeof(Settings->MaxDrainTimeUs);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_MAX_DRAIN_TIME_US,
+            (uint8_t*)&Settings->MaxDrainTimeUs,
+            &ValueLen);
+    }
+
+    if (!Settings->AppSet.ZeroCopyRecvEnabled) {
+        Value = QUIC_DEFAULT_ZERO_COPY_RECV_ENABLED;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_ZERO_COPY_RECV_ENABLED,
+            (uint8_t*)&Value,
+            &ValueLen);
+        Settings->ZeroCopyRecvEnabled = !!Value;
+    }
+
+    if (!Settings->AppSet.EcnEnabled) {
+        Value = QUIC_DEFAULT_ECN_ENABLED;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_ECN_ENABLED,
+            (uint8_t*)&Value,
+            &ValueLen);
+        Settings->EcnEnabled = !!Value;
+    }
+
+    if (!Settings->AppSet.PacingOffloadEnabled) {
+        Value = QUIC_DEFAULT_PACING_OFFLOAD_ENABLED;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_PACING_OFFLOAD_ENABLED,
+            (uint8_t*)&Value,
+            &ValueLen);
+        Settings->PacingOffloadEnabled = !!Value;
+    }
+
+    if (!Settings->AppSet.PathMetricsCacheEnabled) {
+        Value = QUIC_DEFAULT_PATH_METRICS_CACHE_ENABLED;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_PATH_METRICS_CACHE_ENABLED,
+            (uint8_t*)&Value,
+            &ValueLen);
+        Settings->PathMetricsCacheEnabled = !!Value;
+    }
+
+    if (!Settings->AppSet.IntegrityOnlyEnabled) {
+        Value = QUIC_DEFAULT_INTEGRITY_ONLY_ENABLED;
+        ValueLen = sizeof(Value);
+        QuicStorageReadValue(
+            Storage,
+            QUIC_SETTING_INTEGRITY_ONLY_ENABLED,
+            (uint8_t*)&Value,
+            &ValueLen);
+        Settings->IntegrityOnlyEnabled = !!Value;
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -491,8 +828,10 @@ QuicSettingsDump(
     QuicTraceLogVerbose(SettingDumpMaxPartitionCount,       "[sett] MaxPartitionCount      = %hhu", Settings->MaxPartitionCount);
     QuicTraceLogVerbose(SettingDumpMaxOperationsPerDrain,   "[sett] MaxOperationsPerDrain  = %hhu", Settings->MaxOperationsPerDrain);
     QuicTraceLogVerbose(SettingDumpRetryMemoryLimit,        "[sett] RetryMemoryLimit       = %hu", Settings->RetryMemoryLimit);
+    QuicTraceLogVerbose(SettingDumpMemoryBudgetLimit,       "[sett] MemoryBudgetLimit      = %hu", Settings->MemoryBudgetLimit);
     QuicTraceLogVerbose(SettingDumpLoadBalancingMode,       "[sett] LoadBalancingMode      = %hu", Settings->LoadBalancingMode);
     QuicTraceLogVerbose(SettingDumpMaxStatelessOperations,  "[sett] MaxStatelessOperations = %u", Settings->MaxStatelessOperations);
+    QuicTraceLogVerbose(SettingDumpMaxWorkerHandshakes,     "[sett] MaxWorkerHandshakes    = %u", Settings->MaxWorkerHandshakes);
     QuicTraceLogVerbose(SettingDumpMaxWorkerQueueDelayUs,   "[sett] MaxWorkerQueueDelayUs  = %u", Settings->MaxWorkerQueueDelayUs);
     QuicTraceLogVerbose(SettingDumpInitialWindowPackets,    "[sett] InitialWindowPackets   = %u", Settings->InitialWindowPackets);
     QuicTraceLogVerbose(SettingDumpSendIdleTimeoutMs,       "[sett] SendIdleTimeoutMs      = %u", Settings->SendIdleTimeoutMs);
@@ -500,15 +839,33 @@ QuicSettingsDump(
     QuicTraceLogVerbose(SettingDumpMaxAckDelayMs,           "[sett] MaxAckDelayMs          = %u", Settings->MaxAckDelayMs);
     QuicTraceLogVerbose(SettingDumpDisconnectTimeoutMs,     "[sett] DisconnectTimeoutMs    = %u", Settings->DisconnectTimeoutMs);
     QuicTraceLogVerbose(SettingDumpKeepAliveIntervalMs,     "[sett] KeepAliveIntervalMs    = %u", Settings->KeepAliveIntervalMs);
+    QuicTraceLogVerbose(SettingDumpHibernateTimeoutMs,      "[sett] HibernateTimeoutMs     = %u", Settings->HibernateTimeoutMs);
+    QuicTraceLogVerbose(SettingDumpHappyEyeballsDelayMs,    "[sett] HappyEyeballsDelayMs   = %u", Settings->HappyEyeballsDelayMs);
     QuicTraceLogVerbose(SettingDumpIdleTimeoutMs,           "[sett] IdleTimeoutMs          = %llu", Settings->IdleTimeoutMs);
     QuicTraceLogVerbose(SettingDumpHandshakeIdleTimeoutMs,  "[sett] HandshakeIdleTimeoutMs = %llu", Settings->HandshakeIdleTimeoutMs);
     QuicTraceLogVerbose(SettingDumpBidiStreamCount,         "[sett] BidiStreamCount        = %hu", Settings->BidiStreamCount);
     QuicTraceLogVerbose(SettingDumpUnidiStreamCount,        "[sett] UnidiStreamCount       = %hu", Settings->UnidiStreamCount);
+    QuicTraceLogVerbose(SettingDumpPeerStreamCountMax,      "[sett] PeerStreamCountMax     = %hu", Settings->PeerStreamCountMax);
     QuicTraceLogVerbose(SettingDumpTlsClientMaxSendBuffer,  "[sett] TlsClientMaxSendBuffer = %u", Settings->TlsClientMaxSendBuffer);
     QuicTraceLogVerbose(SettingDumpTlsServerMaxSendBuffer,  "[sett] TlsServerMaxSendBuffer = %u", Settings->TlsServerMaxSendBuffer);
     QuicTraceLogVerbose(SettingDumpStreamRecvWindowDefault, "[sett] StreamRecvWindowDefault= %u", Settings->StreamRecvWindowDefault);
     QuicTraceLogVerbose(SettingDumpStreamRecvBufferDefault, "[sett] StreamRecvBufferDefault= %u", Settings->StreamRecvBufferDefault);
     QuicTraceLogVerbose(SettingDumpConnFlowControlWindow,   "[sett] ConnFlowControlWindow  = %u", Settings->ConnFlowControlWindow);
+    QuicTraceLogVerbose(SettingDumpStreamRecvWindowMax,     "[sett] StreamRecvWindowMax    = %u", Settings->StreamRecvWindowMax);
     QuicTraceLogVerbose(SettingDumpMaxBytesPerKey,          "[sett] MaxBytesPerKey         = %llu", Settings->MaxBytesPerKey);
     QuicTraceLogVerbose(SettingDumpServerResumptionLevel,   "[sett] ServerResumptionLevel  = %hhu", Settings->ServerResumptionLevel);
+    QuicTraceLogVerbose(SettingDumpCongestionControlAlgorithm, "[sett] CongestionControlAlgorithm = %hu", Settings->CongestionControlAlgorithm);
+    QuicTraceLogVerbose(SettingDumpHyStartEnabled,          "[sett] HyStartEnabled         = %hhu", Settings->HyStartEnabled);
+    QuicTraceLogVerbose(SettingDumpBusyPollUs,              "[sett] BusyPollUs             = %u", Settings->BusyPollUs);
+    QuicTraceLogVerbose(SettingDumpHandshakeOffloadThreadCount, "[sett] HandshakeOffloadThreadCount = %hu", Settings->HandshakeOffloadThreadCount);
+    QuicTraceLogVerbose(SettingDumpDecryptHelperThreadCount, "[sett] DecryptHelperThreadCount = %hu", Settings->DecryptHelperThreadCount);
+    QuicTraceLogVerbose(SettingDumpCidSteeringEnabled,      "[sett] CidSteeringEnabled     = %hhu", Settings->CidSteeringEnabled);
+    QuicTraceLogVerbose(SettingDumpCidRouteTableBits,       "[sett] CidRouteTableBits      = %hhu", Settings->CidRouteTableBits);
+    QuicTraceLogVerbose(SettingDumpDnsCacheTimeoutMs,       "[sett] DnsCacheTimeoutMs      = %u", Settings->DnsCacheTimeoutMs);
+    QuicTraceLogVerbose(SettingDumpMaxDrainTimeUs,          "[sett] MaxDrainTimeUs         = %u", Settings->MaxDrainTimeUs);
+    QuicTraceLogVerbose(SettingDumpZeroCopyRecvEnabled,     "[sett] ZeroCopyRecvEnabled    = %hhu", Settings->ZeroCopyRecvEnabled);
+    QuicTraceLogVerbose(SettingDumpEcnEnabled,              "[sett] EcnEnabled             = %hhu", Settings->EcnEnabled);
+    QuicTraceLogVerbose(SettingDumpPacingOffloadEnabled,    "[sett] PacingOffloadEnabled   = %hhu", Settings->PacingOffloadEnabled);
+    QuicTraceLogVerbose(SettingDumpPathMetricsCacheEnabled, "[sett] PathMetricsCacheEnabled= %hhu", Settings->PathMetricsCacheEnabled);
+    QuicTraceLogVerbose(SettingDumpIntegrityOnlyEnabled,    "[sett] IntegrityOnlyEnabled   = %hhu", Settings->IntegrityOnlyEnabled);
 }
@@ -10,29 +10,49 @@ typedef struct QUIC_SETTINGS {
     BOOLEAN PacingDefault    : 1;
     BOOLEAN MigrationEnabled : 1;
     BOOLEAN DatagramReceiveEnabled  : 1;
+    BOOLEAN HyStartEnabled : 1;
+    BOOLEAN CidSteeringEnabled : 1;     // Global only
+    BOOLEAN ZeroCopyRecvEnabled : 1;
+    BOOLEAN EcnEnabled : 1;
+    BOOLEAN PacingOffloadEnabled : 1;
+    BOOLEAN PathMetricsCacheEnabled : 1;
+    BOOLEAN IntegrityOnlyEnabled : 1;
     uint8_t ServerResumptionLevel : 2;
     uint8_t MaxPartitionCount;          // Global only
     uint8_t MaxOperationsPerDrain;      // Global only
+    uint8_t CidRouteTableBits;          // Global only
     uint16_t RetryMemoryLimit;          // Global only
+    uint16_t MemoryBudgetLimit;         // Global only
     uint16_t LoadBalancingMode;         // Global only
     uint32_t MaxWorkerQueueDelayUs;
     uint32_t MaxStatelessOperations;
+    uint32_t MaxWorkerHandshakes;
     uint32_t InitialWindowPackets;
     uint32_t SendIdleTimeoutMs;
     uint32_t InitialRttMs;
     uint32_t MaxAckDelayMs;
     uint32_t DisconnectTimeoutMs;
     uint32_t KeepAliveIntervalMs;
+    uint32_t HibernateTimeoutMs;
+    uint32_t HappyEyeballsDelayMs;
     uint64_t HandshakeIdleTimeoutMs;
     uint64_t IdleTimeoutMs;
     uint16_t BidiStreamCount;
     uint16_t UnidiStreamCount;
+    uint16_t PeerStreamCountMax;
     uint32_t TlsClientMaxSendBuffer;
     uint32_t TlsServerMaxSendBuffer;
     uint32_t StreamRecvWindowDefault;
     uint32_t StreamRecvBufferDefault;
     uint32_t ConnFlowControlWindow;
+    uint32_t StreamRecvWindowMax;
     uint64_t MaxBytesPerKey;
+    uint16_t CongestionControlAlgorithm;
+    uint32_t BusyPollUs;                // Global only
+    uint16_t HandshakeOffloadThreadCount; // Global only
+    uint16_t DecryptHelperThreadCount;  // Global only
+    uint32_t DnsCacheTimeoutMs;         // Global only
+    uint32_t MaxDrainTimeUs;            // Global only
 
     struct {
         BOOLEAN PacingDefault : 1;
@@ -42,25 +62,45 @@ typedef struct QUIC_SETTINGS {
         BOOLEAN MaxPartitionCount : 1;
         BOOLEAN MaxOperationsPerDrain : 1;
         BOOLEAN RetryMemoryLimit : 1;
+        BOOLEAN MemoryBudgetLimit : 1;
         BOOLEAN LoadBalancingMode : 1;
         BOOLEAN MaxWorkerQueueDelayUs : 1;
         BOOLEAN MaxStatelessOperations : 1;
+        BOOLEAN MaxWorkerHandshakes : 1;
         BOOLEAN InitialWindowPackets : 1;
         BOOLEAN SendIdleTimeoutMs : 1;
         BOOLEAN InitialRttMs : 1;
         BOOLEAN MaxAckDelayMs : 1;
         BOOLEAN DisconnectTimeoutMs : 1;
         BOOLEAN KeepAliveIntervalMs : 1;
+        BOOLEAN HibernateTimeoutMs : 1;
+        BOOLEAN HappyEyeballsDelayMs : 1;
         BOOLEAN IdleTimeoutMs : 1;
         BOOLEAN HandshakeIdleTimeoutMs : 1;
         BOOLEAN BidiStreamCount : 1;
         BOOLEAN UnidiStreamCount : 1;
+        BOOLEAN PeerStreamCountMax : 1;
         BOOLEAN TlsClientMaxSendBuffer : 1;
         BOOLEAN TlsServerMaxSendBuffer : 1;
         BOOLEAN StreamRecvWindowDefault : 1;
         BOOLEAN StreamRecvBufferDefault : 1;
         BOOLEAN ConnFlowControlWindow : 1;
+        BOOLEAN StreamRecvWindowMax : 1;
         BOOLEAN MaxBytesPerKey : 1;
+        BOOLEAN CongestionControlAlgorithm : 1;
+        BOOLEAN HyStartEnabled : 1;
+        BOOLEAN BusyPollUs : 1;
+        BOOLEAN HandshakeOffloadThreadCount : 1;
+        BOOLEAN DecryptHelperThreadCount : 1;
+        BOOLEAN CidSteeringEnabled : 1;
+        BOOLEAN ZeroCopyRecvEnabled : 1;
+        BOOLEAN EcnEnabled : 1;
+        BOOLEAN PacingOffloadEnabled : 1;
+        BOOLEAN PathMetricsCacheEnabled : 1;
+        BOOLEAN IntegrityOnlyEnabled : 1;
+        BOOLEAN CidRouteTableBits : 1;
+        BOOLEAN DnsCacheTimeoutMs : 1;
+        BOOLEAN MaxDrainTimeUs : 1;
     } AppSet;
 
 } QUIC_SETTINGS;
@@ -0,0 +1,231 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    The shared memory stats region lets an external monitoring process scrape
+    the perf counters, and the stats of every worker and connection, without
+    calling into the library.
+
+    When enabled (see QUIC_PARAM_GLOBAL_STATS_REGION), each connection claims a
+    slot in the region the first time it's processed after that, and its
+    worker copies a handful of its stats there every time it processes it.
+    Each worker claims a slot of its own, which it refreshes, along with the
+    summed up perf counters, at most every QUIC_STATS_REGION_UPDATE_INTERVAL_US
+    while it has work. Only plain stores are used, so the cost on the worker
+    is a few cache lines per connection processed; an idle worker doesn't
+    update anything, but then nothing changes either.
+
+    Slots are claimed with a compare exchange on InUse, starting from a
+    rotating index; a connection that finds no free slot in a few probes just
+    isn't tracked.
+
+--*/
+
+#include "precomp.h"
+#ifdef QUIC_CLOG
+#include "stats_region.c.clog.h"
+#endif
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicStatsRegionInitialize(
+    _In_z_ const char* Name
+    )
+{
+    if (MsQuicLib.StatsRegion != NULL) {
+        return QUIC_STATUS_INVALID_STATE;
+    }
+
+    size_t NameLength = strlen(Name);
+    char* NameCopy = QUIC_ALLOC_NONPAGED(NameLength + 1);
+    if (NameCopy == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "stats region name",
+            NameLength + 1);
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+    QuicCopyMemory(NameCopy, Name, NameLength + 1);
+
+    QUIC_STATS_REGION* Region =
+        (QUIC_STATS_REGION*)QuicSharedMemoryCreate(Name, sizeof(QUIC_STATS_REGION));
+    if (Region == NULL) {
+        QUIC_FREE(NameCopy);
+        return QUIC_STATUS_NOT_SUPPORTED;
+    }
+
+    Region->Magic = QUIC_STATS_REGION_MAGIC;
+    Region->Version = QUIC_STATS_REGION_VERSION;
+    Region->Size = sizeof(QUIC_STATS_REGION);
+    Region->PerfCounterCount = QUIC_PERF_COUNTER_MAX;
+
+    MsQuicLib.StatsRegionName = NameCopy;
+    MsQuicLib.StatsRegionUpdateTime = 0;
+    MsQuicLib.StatsRegionNextConnection = 0;
+
+    //
+    // Publish the region only once it's set up; the workers pick it up
+    // without the library lock.
+    //
+    InterlockedExchangePointer((void**)&MsQuicLib.StatsRegion, Region);
+
+    QuicTraceLogInfo(
+        LibraryStatsRegionCreated,
+        "[ lib] Created stats region %s",
+        Name);
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStatsRegionUninitialize(
+    void
+    )
+{
+    if (MsQuicLib.StatsRegion == NULL) {
+        return;
+    }
+
+    QuicSharedMemoryDelete(
+        MsQuicLib.StatsRegionName,
+        MsQuicLib.StatsRegion,
+        sizeof(QUIC_STATS_REGION));
+    QUIC_FREE(MsQuicLib.StatsRegionName);
+    MsQuicLib.StatsRegionName = NULL;
+    MsQuicLib.StatsRegion = NULL;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStatsRegionUpdateConnection(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_STATS_REGION_CONNECTION* Slot = Connection->StatsSlot;
+    if (Slot == NULL) {
+        if (Connection->StatsSlotAttempted) {
+            return; // Already tried, and the region was full.
+        }
+        Connection->StatsSlotAttempted = TRUE;
+
+        QUIC_STATS_REGION* Region = MsQuicLib.StatsRegion;
+        uint32_t Start =
+            (uint32_t)InterlockedIncrement(&MsQuicLib.StatsRegionNextConnection);
+        for (uint32_t i = 0; i < QUIC_STATS_REGION_MAX_CLAIM_PROBES; ++i) {
+            QUIC_STATS_REGION_CONNECTION* Candidate =
+                &Region->Connections[(Start + i) % QUIC_STATS_REGION_CONNECTION_COUNT];
+            if (Candidate->InUse == 0 &&
+                InterlockedCompareExchange64(&Candidate->InUse, 1, 0) == 0) {
+                Slot = Candidate;
+                break;
+            }
+        }
+        if (Slot == NULL) {
+            return;
+        }
+        Connection->StatsSlot = Slot;
+        Slot->CorrelationId = Connection->Stats.CorrelationId;
+    }
+
+    const QUIC_PATH* Path = &Connection->Paths[0];
+    Slot->Rtt = Path->SmoothedRtt;
+    Slot->CongestionWindow =
+        QuicCongestionControlGetCongestionWindow(&Connection->CongestionControl);
+    Slot->SendTotalBytes = Connection->Stats.Send.TotalBytes;
+    Slot->SendTotalPackets = Connection->Stats.Send.TotalPackets;
+    Slot->SendSuspectedLostPackets = Connection->Stats.Send.SuspectedLostPackets;
+    Slot->RecvTotalBytes = Connection->Stats.Recv.TotalBytes;
+    Slot->RecvTotalPackets = Connection->Stats.Recv.TotalPackets;
+    Slot->RecvDroppedPackets = Connection->Stats.Recv.DroppedPackets;
+    Slot->ProcessingTime = Connection->Stats.Processing.TotalTime;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicStatsRegionReleaseConnection(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_STATS_REGION_CONNECTION* Slot = Connection->StatsSlot;
+    if (Slot != NULL) {
+        Connection->StatsSlot = NULL;
+        QuicZeroMemory(
+            (uint8_t*)Slot + sizeof(Slot->InUse),
+            sizeof(*Slot) - sizeof(Slot->InUse));
+        InterlockedExchange64(&Slot->InUse, 0);
+    }
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStatsRegionUpdateWorker(
+    _In_ QUIC_WORKER* Worker,
+    _In_ uint64_t TimeNow
+    )
+{
+    if (TimeNow - Worker->StatsUpdateTime < QUIC_STATS_REGION_UPDATE_INTERVAL_US) {
+        return;
+    }
+    Worker->StatsUpdateTime = TimeNow;
+
+    QUIC_STATS_REGION* Region = MsQuicLib.StatsRegion;
+    QUIC_STATS_REGION_WORKER* Slot = Worker->StatsSlot;
+    if (Slot == NULL) {
+        for (uint32_t i = 0; i < QUIC_STATS_REGION_WORKER_COUNT; ++i) {
+            if (Region->Workers[i].InUse == 0 &&
+                InterlockedCompareExchange64(&Region->Workers[i].InUse, 1, 0) == 0) {
+                Slot = &Region->Workers[i];
+                break;
+            }
+        }
+        if (Slot != NULL) {
+            Worker->StatsSlot = Slot;
+            Slot->IdealProcessor = Worker->IdealProcessor;
+        }
+    }
+
+    if (Slot != NULL) {
+        Slot->AverageQueueDelay = Worker->AverageQueueDelay;
+        Slot->ProcessingTime = Worker->ProcessingTime;
+        Slot->ReceiveQueueCount = Worker->ReceiveQueueCount;
+        Slot->UpdateTime = TimeNow;
+    }
+
+    //
+    // Only one worker sums up the perf counters per interval.
+    //
+    int64_t LastUpdateTime = MsQuicLib.StatsRegionUpdateTime;
+    if (TimeNow - (uint64_t)LastUpdateTime >= QUIC_STATS_REGION_UPDATE_INTERVAL_US &&
+        InterlockedCompareExchange64(
+            &MsQuicLib.StatsRegionUpdateTime,
+            (int64_t)TimeNow,
+            LastUpdateTime) == LastUpdateTime) {
+        int64_t Counters[QUIC_PERF_COUNTER_MAX];
+        QuicLibrarySumPerfCounters(Counters);
+        for (uint32_t i = 0; i < QUIC_PERF_COUNTER_MAX; ++i) {
+            Region->PerfCounters[i] = Counters[i];
+        }
+        Region->UpdateTime = TimeNow;
+    }
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStatsRegionReleaseWorker(
+    _In_ QUIC_WORKER* Worker
+    )
+{
+    QUIC_STATS_REGION_WORKER* Slot = Worker->StatsSlot;
+    if (Slot != NULL) {
+        Worker->StatsSlot = NULL;
+        QuicZeroMemory(
+            (uint8_t*)Slot + sizeof(Slot->InUse),
+            sizeof(*Slot) - sizeof(Slot->InUse));
+        InterlockedExchange64(&Slot->InUse, 0);
+    }
+}
@@ -0,0 +1,69 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Definitions for the shared memory stats region (see QUIC_STATS_REGION).
+
+--*/
+
+//
+// Creates the region under the given name. Called with the library lock held.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicStatsRegionInitialize(
+    _In_z_ const char* Name
+    );
+
+//
+// Deletes the region, if created. All the workers and connections must be
+// cleaned up first.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStatsRegionUninitialize(
+    void
+    );
+
+//
+// Publishes the connection's stats to its slot, claiming one first if it has
+// none yet. Called on the connection's worker after it's processed.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStatsRegionUpdateConnection(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
+//
+// Frees the connection's slot, if it has one.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicStatsRegionReleaseConnection(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
+//
+// Publishes the worker's stats to its slot, and the perf counters, if they
+// weren't updated for QUIC_STATS_REGION_UPDATE_INTERVAL_US. Called on the
+// worker's thread.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStatsRegionUpdateWorker(
+    _In_ QUIC_WORKER* Worker,
+    _In_ uint64_t TimeNow
+    );
+
+//
+// Frees the worker's slot, if it has one.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStatsRegionReleaseWorker(
+    _In_ QUIC_WORKER* Worker
+    );
@@ -15,6 +15,89 @@ Abstract:
 #include "stream.c.clog.h"
 #endif
 
+//
+// Pops a stream from the worker's cache. Its receive buffer and sparse ACK
+// ranges are still allocated, and must be reinitialized.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STREAM*
+QuicStreamCacheAlloc(
+    _In_ QUIC_WORKER* Worker
+    )
+{
+    QUIC_SINGLE_LIST_ENTRY* Entry;
+
+    if (Worker->StreamCache.Next == NULL) {
+        return NULL;
+    }
+
+    QuicDispatchLockAcquire(&Worker->StreamCacheLock);
+    Entry = QuicListPopEntry(&Worker->StreamCache);
+    if (Entry != NULL) {
+        Worker->StreamCacheDepth--;
+    }
+    QuicDispatchLockRelease(&Worker->StreamCacheLock);
+
+    return
+        Entry == NULL ?
+            NULL :
+            QUIC_CONTAINING_RECORD(Entry, QUIC_STREAM, CacheLink);
+}
+
+//
+// Resets a freed stream's receive buffer and sparse ACK ranges in place and
+// adds it to its worker's cache. Returns FALSE if the stream isn't cached, in
+// which case they must be uninitialized as usual.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+QuicStreamCacheFree(
+    _In_ QUIC_STREAM* Stream
+    )
+{
+    QUIC_CONNECTION* Connection = Stream->Connection;
+    QUIC_WORKER* Worker = Connection->Worker;
+    BOOLEAN Cached = FALSE;
+
+    //
+    // The cached chunks must go back to this worker's pool when the cache is
+    // drained, so streams created on another worker (before the connection
+    // moved) aren't cached. Neither are streams owned by the connection's
+    // arena.
+    //
+    if (Worker->StreamCacheDepth >= QUIC_WORKER_STREAM_CACHE_DEPTH ||
+        Stream->RecvBuffer.ChunkPool != &Worker->RecvChunkPool ||
+        QuicConnIsArenaStream(Connection, Stream) ||
+        !QuicRangeTryReset(&Stream->SparseAckRanges) ||
+        !QuicRecvBufferTryReset(&Stream->RecvBuffer)) {
+        return FALSE;
+    }
+
+    QuicDispatchLockAcquire(&Worker->StreamCacheLock);
+    if (Worker->StreamCacheDepth < QUIC_WORKER_STREAM_CACHE_DEPTH) {
+        QuicListPushEntry(&Worker->StreamCache, &Stream->CacheLink);
+        Worker->StreamCacheDepth++;
+        Cached = TRUE;
+    }
+    QuicDispatchLockRelease(&Worker->StreamCacheLock);
+
+    return Cached;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicStreamCacheDrain(
+    _In_ QUIC_WORKER* Worker
+    )
+{
+    QUIC_STREAM* Stream;
+    while ((Stream = QuicStreamCacheAlloc(Worker)) != NULL) {
+        QuicRecvBufferUninitialize(&Stream->RecvBuffer);
+        QuicRangeUninitialize(&Stream->SparseAckRanges);
+        QuicPoolFree(&Worker->StreamPool, Stream);
+    }
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_STATUS
 QuicStreamInitialize(
@@ -27,14 +110,46 @@ QuicStreamInitialize(
     )
 {
     QUIC_STATUS Status;
-    QUIC_STREAM* Stream;
+    QUIC_STREAM* Stream = NULL;
+    BOOLEAN Reused = FALSE;
 
-    Stream = QuicPoolAlloc(&Connection->Worker->StreamPool);
-    if (Stream == NULL) {
+    if (!OpenedRemotely && QuicLibraryIsMemoryBudgetExceeded()) {
+        //
+        // The peer's streams are limited by withholding stream credit instead
+        // (see QuicStreamSetReleaseStream).
+        //
+        QuicTraceLogConnWarning(
+            StreamOpenMemoryBudgetExceeded,
+            Connection,
+            "Refusing new stream, memory budget exceeded");
+        Stream = NULL;
         Status = QUIC_STATUS_OUT_OF_MEMORY;
         goto Exit;
     }
-    QuicZeroMemory(Stream, sizeof(QUIC_STREAM));
+
+    if (!Connection->Arena.Enabled) {
+        Stream = QuicStreamCacheAlloc(Connection->Worker);
+    }
+
+    if (Stream != NULL) {
+        //
+        // Keep the cached stream's (already reset) allocations.
+        //
+        QUIC_RANGE SparseAckRanges = Stream->SparseAckRanges;
+        QUIC_RECV_BUFFER RecvBuffer = Stream->RecvBuffer;
+        QuicZeroMemory(Stream, sizeof(QUIC_STREAM));
+        Stream->SparseAckRanges = SparseAckRanges;
+        Stream->RecvBuffer = RecvBuffer;
+        Reused = TRUE;
+
+    } else {
+        Stream = QuicConnAllocStream(Connection);
+        if (Stream == NULL) {
+            Status = QUIC_STATUS_OUT_OF_MEMORY;
+            goto Exit;
+        }
+        QuicZeroMemory(Stream, sizeof(QUIC_STREAM));
+    }
 
     Stream->Type = QUIC_HANDLE_TYPE_STREAM;
     Stream->Connection = Connection;
@@ -45,6 +160,7 @@ QuicStreamInitialize(
     Stream->Flags.SendEnabled = TRUE;
     Stream->Flags.ReceiveEnabled = TRUE;
     Stream->RecvMaxLength = UINT64_MAX;
+    Stream->SendPriority = QUIC_STREAM_PRIORITY_DEFAULT;
     Stream->RefCount = 1;
     Stream->SendRequestsTail = &Stream->SendRequests;
     QuicDispatchLockInitialize(&Stream->ApiSendRequestLock);
@@ -79,25 +195,36 @@ QuicStreamInitialize(
         }
     }
 
-    Status =
-        QuicRangeInitialize(
-            QUIC_MAX_RANGE_ALLOC_SIZE,
-            &Stream->SparseAckRanges);
-    if (QUIC_FAILED(Status)) {
-        goto Exit;
-    }
-
-    Status =
-        QuicRecvBufferInitialize(
+    if (Reused) {
+        QuicRecvBufferReinitialize(
             &Stream->RecvBuffer,
-            Connection->Session->Settings.StreamRecvBufferDefault,
-            Connection->Session->Settings.StreamRecvWindowDefault,
-            FALSE);
-    if (QUIC_FAILED(Status)) {
-        QuicRangeUninitialize(&Stream->SparseAckRanges);
-        goto Exit;
+            Connection->Session->Settings.StreamRecvWindowDefault);
+
+    } else {
+        Status =
+            QuicRangeInitialize(
+                QUIC_MAX_RANGE_ALLOC_SIZE,
+                &Stream->SparseAckRanges);
+        if (QUIC_FAILED(Status)) {
+            goto Exit;
+        }
+
+        Status =
+            QuicRecvBufferInitialize(
+                &Stream->RecvBuffer,
+                Connection->Session->Settings.StreamRecvBufferDefault,
+                Connection->Session->Settings.StreamRecvWindowDefault,
+                FALSE,
+                &Connection->Worker->RecvChunkPool);
+        if (QUIC_FAILED(Status)) {
+            QuicRangeUninitialize(&Stream->SparseAckRanges);
+            goto Exit;
+        }
     }
 
+    InterlockedExchangeAdd64(
+        (int64_t*)&MsQuicLib.CurrentRecvWindowMemoryUsage,
+        (int64_t)Stream->RecvBuffer.VirtualBufferLength);
     Stream->MaxAllowedRecvOffset = Stream->RecvBuffer.VirtualBufferLength;
     Stream->RecvWindowLastUpdate = QuicTimeUs32();
 
@@ -110,7 +237,7 @@ Exit:
     if (Stream) {
         QuicDispatchLockUninitialize(&Stream->ApiSendRequestLock);
         Stream->Flags.Freed = TRUE;
-        QuicPoolFree(&Connection->Worker->StreamPool, Stream);
+        QuicConnFreeStream(Connection, Stream);
     }
 
     return Status;
@@ -124,6 +251,10 @@ QuicStreamFree(
 {
     BOOLEAN WasStarted = Stream->Flags.Started;
 
+    if (WasStarted) {
+        QuicTraceProbe(stream_close, Stream->Connection, Stream, Stream->ID);
+    }
+
     QUIC_TEL_ASSERT(Stream->RefCount == 0);
     QUIC_TEL_ASSERT(Stream->Flags.ShutdownComplete);
     QUIC_TEL_ASSERT(Stream->Flags.HandleClosed);
@@ -135,13 +266,26 @@ QuicStreamFree(
     QUIC_TEL_ASSERT(Stream->ApiSendRequests == NULL);
     QUIC_TEL_ASSERT(Stream->SendRequests == NULL);
 
-    QuicRecvBufferUninitialize(&Stream->RecvBuffer);
-    QuicRangeUninitialize(&Stream->SparseAckRanges);
+    if (Stream->RecvZeroCopyDatagram != NULL) {
+        QuicStreamRecvReleaseDatagram(Stream);
+    }
+    if (Stream->SendCompleteBatchContexts != NULL) {
+        QUIC_DBG_ASSERT(Stream->SendCompleteBatchCount == 0);
+        QUIC_FREE(Stream->SendCompleteBatchContexts);
+        Stream->SendCompleteBatchContexts = NULL;
+    }
+    InterlockedExchangeAdd64(
+        (int64_t*)&MsQuicLib.CurrentRecvWindowMemoryUsage,
+        -1 * (int64_t)Stream->RecvBuffer.VirtualBufferLength);
     QuicDispatchLockUninitialize(&Stream->ApiSendRequestLock);
     QuicRefUninitialize(&Stream->RefCount);
 
     Stream->Flags.Freed = TRUE;
-    QuicPoolFree(&Stream->Connection->Worker->StreamPool, Stream);
+    if (!QuicStreamCacheFree(Stream)) {
+        QuicRecvBufferUninitialize(&Stream->RecvBuffer);
+        QuicRangeUninitialize(&Stream->SparseAckRanges);
+        QuicConnFreeStream(Stream->Connection, Stream);
+    }
 
     if (WasStarted) {
 #pragma warning(push)
@@ -154,6 +298,17 @@ QuicStreamFree(
     }
 }
 
+void
+QuicStreamAddFlowControlBlockedTime(
+    _In_ QUIC_STREAM* Stream
+    )
+{
+    uint64_t BlockedTime =
+        QuicTimeDiff64(Stream->FlowControlBlockedTime, QuicTimeUs64());
+    Stream->Stats.SendFlowControlBlockedTime += BlockedTime;
+    Stream->Connection->Stats.Blocked.StreamFlowControl += BlockedTime;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicStreamStart(
@@ -202,6 +357,7 @@ QuicStreamStart(
         Stream->Connection,
         Stream->ID,
         !IsRemoteStream);
+    QuicTraceProbe(stream_open, Stream->Connection, Stream, Stream->ID);
     QuicTraceEvent(
         StreamSendState,
         "[strm][%p] Send State: %hhu",
@@ -241,6 +397,7 @@ QuicStreamStart(
             &Stream->Connection->PeerTransportParams);
     if (Stream->MaxAllowedSendOffset == 0) {
         Stream->OutFlowBlockedReasons |= QUIC_FLOW_BLOCKED_STREAM_FLOW_CONTROL;
+        Stream->FlowControlBlockedTime = QuicTimeUs64();
     }
     Stream->SendWindow = (uint32_t)min(Stream->MaxAllowedSendOffset, UINT32_MAX);
 
@@ -305,7 +462,16 @@ QuicStreamClose(
     Stream->Flags.HandleClosed = TRUE;
     Stream->ClientCallbackHandler = NULL;
 
+    QUIC_CONNECTION* Connection = Stream->Connection;
     QuicStreamRelease(Stream, QUIC_STREAM_REF_APP);
+
+    if (Connection->ClientCallbackHandler == QuicSessionConnectionPoolCallback) {
+        //
+        // All the streams on a pooled connection are opened through the pool,
+        // which closes the connection after the last one.
+        //
+        QuicSessionConnectionPoolOnStreamClosed(Connection);
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -345,12 +511,20 @@ QuicStreamIndicateEvent(
                 Stream->ClientContext,
                 Event);
         uint64_t EndTime = QuicTimeUs64();
+        Stream->Connection->Stats.Processing.CallbackTime += EndTime - StartTime;
+        QuicHistogramAddSample(
+            Stream->Connection->Histograms.CallbackTime,
+            EndTime - StartTime);
         if (EndTime - StartTime > QUIC_MAX_CALLBACK_TIME_WARNING) {
             QuicTraceLogStreamWarning(
                 AppTooLong,
                 Stream,
                 "App took excessive time (%llu us) in callback.",
                 (EndTime - StartTime));
+            if (EndTime - StartTime >= QUIC_MAX_CALLBACK_TIME_ERROR) {
+                (void)QuicFlightRecorderTrigger(
+                    "App extremely long time in stream callback");
+            }
             QUIC_TEL_ASSERTMSG_ARGS(
                 EndTime - StartTime < QUIC_MAX_CALLBACK_TIME_ERROR,
                 "App extremely long time in stream callback",
@@ -494,11 +668,136 @@ QuicStreamParamSet(
         const void* Buffer
     )
 {
-    UNREFERENCED_PARAMETER(Stream);
-    UNREFERENCED_PARAMETER(Param);
-    UNREFERENCED_PARAMETER(BufferLength);
-    UNREFERENCED_PARAMETER(Buffer);
-    return QUIC_STATUS_INVALID_PARAMETER;
+    QUIC_STATUS Status;
+
+    switch (Param)
+    {
+    case QUIC_PARAM_STREAM_PRIORITY:
+
+        if (BufferLength != sizeof(Stream->SendPriority)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (Stream->SendPriority != *(uint16_t*)Buffer) {
+            Stream->SendPriority = *(uint16_t*)Buffer;
+
+            QuicTraceLogStreamInfo(
+                UpdatePriority,
+                Stream,
+                "New send priority = %hu",
+                Stream->SendPriority);
+
+            if (Stream->SendLink.Flink != NULL) {
+                //
+                // The stream is already queued, so move it to its new place
+                // in the queue.
+                //
+                QuicSendUpdateStreamPriority(&Stream->Connection->Send, Stream);
+            }
+        }
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_STREAM_RECEIVE_MESSAGE_FRAMING:
+
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // Framing can only start at the first message.
+        //
+        if (*(BOOLEAN*)Buffer &&
+            (Stream->RecvBuffer.BaseOffset != 0 || Stream->Flags.ReceiveCallPending)) {
+            Status = QUIC_STATUS_INVALID_STATE;
+            break;
+        }
+
+        Stream->RecvMessageFraming = *(BOOLEAN*)Buffer;
+        Status = QUIC_STATUS_SUCCESS;
+
+        QuicTraceLogStreamVerbose(
+            UpdateRecvMessageFraming,
+            Stream,
+            "Updated recv message framing to %hhu",
+            Stream->RecvMessageFraming);
+
+        break;
+
+    case QUIC_PARAM_STREAM_SEND_DEADLINE: {
+
+        if (BufferLength != sizeof(QUIC_STREAM_SEND_DEADLINE)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        const QUIC_STREAM_SEND_DEADLINE* Deadline =
+            (const QUIC_STREAM_SEND_DEADLINE*)Buffer;
+        if (Deadline->ErrorCode > QUIC_UINT62_MAX) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        Stream->SendDeadlineUs = MS_TO_US((uint64_t)Deadline->DeadlineMs);
+        Stream->SendDeadlineErrorCode = Deadline->ErrorCode;
+        Status = QUIC_STATUS_SUCCESS;
+
+        QuicTraceLogStreamVerbose(
+            UpdateSendDeadline,
+            Stream,
+            "Updated send deadline to %u ms",
+            Deadline->DeadlineMs);
+
+        break;
+    }
+
+    case QUIC_PARAM_STREAM_SEND_COMPLETE_BATCHING:
+
+        if (BufferLength != sizeof(BOOLEAN)) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (*(BOOLEAN*)Buffer && Stream->SendCompleteBatchContexts == NULL) {
+            Stream->SendCompleteBatchContexts =
+                QUIC_ALLOC_NONPAGED(
+                    QUIC_SEND_COMPLETE_BATCH_INITIAL_SIZE * sizeof(void*));
+            if (Stream->SendCompleteBatchContexts == NULL) {
+                QuicTraceEvent(
+                    AllocFailure,
+                    "Allocation of '%s' failed. (%llu bytes)",
+                    "Send complete batch",
+                    QUIC_SEND_COMPLETE_BATCH_INITIAL_SIZE * sizeof(void*));
+                Status = QUIC_STATUS_OUT_OF_MEMORY;
+                break;
+            }
+            Stream->SendCompleteBatchCapacity = QUIC_SEND_COMPLETE_BATCH_INITIAL_SIZE;
+        }
+
+        //
+        // Completions already batched are still indicated together, at the
+        // end of the current ACK processing.
+        //
+        Stream->SendCompleteBatchEnabled = *(BOOLEAN*)Buffer;
+        Status = QUIC_STATUS_SUCCESS;
+
+        QuicTraceLogStreamVerbose(
+            UpdateSendCompleteBatching,
+            Stream,
+            "Updated send complete batching to %hhu",
+            Stream->SendCompleteBatchEnabled);
+
+        break;
+
+    default:
+        Status = QUIC_STATUS_INVALID_PARAMETER;
+        break;
+    }
+
+    return Status;
 }
 
 QUIC_STATUS
@@ -582,6 +881,117 @@ QuicStreamParamGet(
         Status = QUIC_STATUS_SUCCESS;
         break;
 
+    case QUIC_PARAM_STREAM_PRIORITY:
+
+        if (*BufferLength < sizeof(Stream->SendPriority)) {
+            *BufferLength = sizeof(Stream->SendPriority);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(Stream->SendPriority);
+        *(uint16_t*)Buffer = Stream->SendPriority;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_STREAM_RECEIVE_MESSAGE_FRAMING:
+
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = Stream->RecvMessageFraming;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_STREAM_SEND_COMPLETE_BATCHING:
+
+        if (*BufferLength < sizeof(BOOLEAN)) {
+            *BufferLength = sizeof(BOOLEAN);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        *BufferLength = sizeof(BOOLEAN);
+        *(BOOLEAN*)Buffer = Stream->SendCompleteBatchEnabled;
+
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+
+    case QUIC_PARAM_STREAM_STATISTICS: {
+
+        if (*BufferLength < sizeof(QUIC_STREAM_STATISTICS)) {
+            *BufferLength = sizeof(QUIC_STREAM_STATISTICS);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        QUIC_STREAM_STATISTICS* Stats = (QUIC_STREAM_STATISTICS*)Buffer;
+
+        Stats->Send.TotalBytes = Stream->Stats.SendTotalBytes;
+        Stats->Send.RetransmittedBytes = Stream->Stats.SendRetransmittedBytes;
+        Stats->Send.FlowControlBlockedTime = Stream->Stats.SendFlowControlBlockedTime;
+        if (Stream->OutFlowBlockedReasons & QUIC_FLOW_BLOCKED_STREAM_FLOW_CONTROL) {
+            Stats->Send.FlowControlBlockedTime +=
+                QuicTimeDiff64(Stream->FlowControlBlockedTime, QuicTimeUs64());
+        }
+        Stats->Send.FullAckTime = Stream->Stats.SendFullAckTime;
+        Stats->Recv.TotalBytes = Stream->Stats.RecvTotalBytes;
+        Stats->Recv.EventCount = Stream->Stats.RecvEventCount;
+        Stats->Recv.BufferMaxLength = Stream->Stats.RecvBufferMaxLength;
+
+        *BufferLength = sizeof(QUIC_STREAM_STATISTICS);
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
+    case QUIC_PARAM_STREAM_SEND_DEADLINE: {
+
+        if (*BufferLength < sizeof(QUIC_STREAM_SEND_DEADLINE)) {
+            *BufferLength = sizeof(QUIC_STREAM_SEND_DEADLINE);
+            Status = QUIC_STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (Buffer == NULL) {
+            Status = QUIC_STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        QUIC_STREAM_SEND_DEADLINE* Deadline = (QUIC_STREAM_SEND_DEADLINE*)Buffer;
+        Deadline->DeadlineMs = (uint32_t)US_TO_MS(Stream->SendDeadlineUs);
+        Deadline->ErrorCode = Stream->SendDeadlineErrorCode;
+
+        *BufferLength = sizeof(QUIC_STREAM_SEND_DEADLINE);
+        Status = QUIC_STATUS_SUCCESS;
+        break;
+    }
+
     default:
         Status = QUIC_STATUS_INVALID_PARAMETER;
         break;
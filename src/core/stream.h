@@ -87,6 +87,14 @@ typedef struct QUIC_SEND_REQUEST {
     //
     uint64_t TotalLength;
 
+    //
+    // For datagrams, the time (in microseconds) after which the request is
+    // canceled instead of being sent, or 0 if it never expires. For stream
+    // requests with QUIC_SEND_FLAG_DEADLINE, the time after which lost data
+    // is no longer retransmitted.
+    //
+    uint64_t ExpirationTime;
+
     //
     // Data descriptor for buffered requests.
     //
@@ -135,6 +143,8 @@ typedef union QUIC_STREAM_FLAGS {
         BOOLEAN ReceiveFlushQueued      : 1;    // The receive flush operation is queued.
         BOOLEAN ReceiveDataPending      : 1;    // Data (or FIN) is queued and ready for delivery.
         BOOLEAN ReceiveCallPending      : 1;    // There is an uncompleted receive to the app.
+        BOOLEAN ReceiveCallActive       : 1;    // The app is in the receive callback.
+        BOOLEAN ReceiveCompletedInline  : 1;    // The app completed the receive in the callback.
 
         BOOLEAN HandleSendShutdown      : 1;    // Send shutdown complete callback delivered.
         BOOLEAN HandleShutdown          : 1;    // Shutdown callback delivered.
@@ -206,6 +216,11 @@ typedef struct QUIC_STREAM {
         // The entry in the connection's list of closed streams to clean up.
         //
         QUIC_LIST_ENTRY ClosedLink;
+
+        //
+        // The entry in the worker's cache of freed streams.
+        //
+        QUIC_SINGLE_LIST_ENTRY CacheLink;
     };
 
     //
@@ -213,6 +228,18 @@ typedef struct QUIC_STREAM {
     //
     QUIC_LIST_ENTRY SendLink;
 
+    //
+    // The entry in the connection's list of streams waiting for the next
+    // receive batch indication.
+    //
+    QUIC_LIST_ENTRY RecvBatchLink;
+
+    //
+    // The entry in the connection's list of streams with send completions
+    // waiting for the end of the current ACK processing.
+    //
+    QUIC_LIST_ENTRY SendCompleteBatchLink;
+
     //
     // The parent connection for this stream.
     //
@@ -234,11 +261,36 @@ typedef struct QUIC_STREAM {
     //
     uint16_t SendFlags;
 
+    //
+    // The send priority of the stream, relative to the connection's other
+    // streams. Higher values are sent first.
+    //
+    uint16_t SendPriority;
+
     //
     // Set of current reasons sending more packets is currently blocked.
     //
     uint8_t OutFlowBlockedReasons; // Set of QUIC_FLOW_BLOCKED_* flags
 
+    //
+    // Time (in us) the stream last became blocked by its flow control.
+    //
+    uint64_t FlowControlBlockedTime;
+
+    //
+    // Statistics returned by QUIC_PARAM_STREAM_STATISTICS. Times are in us.
+    //
+    struct {
+        uint64_t FirstSendTime;
+        uint64_t SendTotalBytes;
+        uint64_t SendRetransmittedBytes;
+        uint64_t SendFlowControlBlockedTime;
+        uint64_t SendFullAckTime;
+        uint64_t RecvTotalBytes;
+        uint64_t RecvEventCount;
+        uint32_t RecvBufferMaxLength;
+    } Stats;
+
     //
     // Send State
     //
@@ -248,6 +300,14 @@ typedef struct QUIC_STREAM {
     //
     QUIC_VAR_INT SendCloseErrorCode;
 
+    //
+    // The lifetime (in us) of send requests with QUIC_SEND_FLAG_DEADLINE, and
+    // the error code the send direction is aborted with once data past that
+    // lifetime is lost. Set with QUIC_PARAM_STREAM_SEND_DEADLINE.
+    //
+    uint64_t SendDeadlineUs;
+    QUIC_VAR_INT SendDeadlineErrorCode;
+
     //
     // API calls to StreamSend queue the send request here and then queue the
     // send operation. That operation moves the send request onto the
@@ -262,6 +322,18 @@ typedef struct QUIC_STREAM {
     QUIC_SEND_REQUEST* SendRequests;
     QUIC_SEND_REQUEST** SendRequestsTail;
 
+    //
+    // With QUIC_PARAM_STREAM_SEND_COMPLETE_BATCHING, the client contexts (and
+    // total length) of the sends acknowledged since the last
+    // QUIC_STREAM_EVENT_SEND_COMPLETE_BATCH.
+    //
+    BOOLEAN SendCompleteBatchEnabled;
+    BOOLEAN SendCompleteBatchQueued;
+    uint32_t SendCompleteBatchCount;
+    uint32_t SendCompleteBatchCapacity;
+    uint64_t SendCompleteBatchLength;
+    void** SendCompleteBatchContexts;
+
     //
     // Shortcut pointer: NULL, or the request containing the next byte to send.
     //
@@ -342,6 +414,12 @@ typedef struct QUIC_STREAM {
     uint64_t RecvWindowBytesDelivered;
     uint32_t RecvWindowLastUpdate;
 
+    //
+    // The rate (in bytes per second) the app drained the receive buffer at,
+    // over the last drain interval.
+    //
+    uint64_t RecvWindowDrainRate;
+
     //
     // Flags indicating the state of queued events.
     //
@@ -368,6 +446,30 @@ typedef struct QUIC_STREAM {
     //
     uint64_t RecvPendingLength;
 
+    //
+    // The length the app completed from within the receive callback (see
+    // ReceiveCompletedInline).
+    //
+    uint64_t RecvInlineCompletionLength;
+
+    //
+    // Indicates the received data is made of messages, each with a varint
+    // length prefix, and is indicated to the app one whole message at a time.
+    //
+    BOOLEAN RecvMessageFraming;
+
+    //
+    // The length prefix of the message in the pending receive call, which is
+    // consumed along with it. Zero if no message is pending.
+    //
+    uint8_t RecvMessagePrefixLength;
+
+    //
+    // The received datagram that RecvBuffer's external (zero-copy) data points
+    // into, if any.
+    //
+    QUIC_RECV_DATAGRAM* RecvZeroCopyDatagram;
+
     //
     // The handler for the API client's callbacks.
     //
@@ -476,6 +578,15 @@ QuicStreamFree(
     _In_ __drv_freesMem(Mem) QUIC_STREAM* Stream
     );
 
+//
+// Frees all the streams in the worker's cache.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicStreamCacheDrain(
+    _In_ QUIC_WORKER* Worker
+    );
+
 //
 // Associates a new ID with the stream and inserts it into the connection's
 // table.
@@ -634,6 +745,15 @@ QuicStreamRelease(
 // Send Functions
 //
 
+//
+// Adds the time since the stream became flow control blocked to the stream's
+// and the connection's statistics.
+//
+void
+QuicStreamAddFlowControlBlockedTime(
+    _In_ QUIC_STREAM* Stream
+    );
+
 inline
 BOOLEAN
 QuicStreamAddOutFlowBlockedReason(
@@ -642,6 +762,9 @@ QuicStreamAddOutFlowBlockedReason(
     )
 {
     if (!(Stream->OutFlowBlockedReasons & Reason)) {
+        if (Reason & QUIC_FLOW_BLOCKED_STREAM_FLOW_CONTROL) {
+            Stream->FlowControlBlockedTime = QuicTimeUs64();
+        }
         Stream->OutFlowBlockedReasons |= Reason;
         QuicTraceEvent(
             StreamOutFlowBlocked,
@@ -661,6 +784,9 @@ QuicStreamRemoveOutFlowBlockedReason(
     )
 {
     if ((Stream->OutFlowBlockedReasons & Reason)) {
+        if (Reason & Stream->OutFlowBlockedReasons & QUIC_FLOW_BLOCKED_STREAM_FLOW_CONTROL) {
+            QuicStreamAddFlowControlBlockedTime(Stream);
+        }
         Stream->OutFlowBlockedReasons &= ~Reason;
         QuicTraceEvent(
             StreamOutFlowBlocked,
@@ -694,6 +820,29 @@ QuicStreamIndicateSendShutdownComplete(
     _In_ BOOLEAN GracefulShutdown
     );
 
+//
+// Returns TRUE if the send requests about to be queued on the stream should
+// be held back briefly, to be coalesced with later writes.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicStreamSendShouldCork(
+    _In_ QUIC_STREAM* Stream,
+    _In_opt_ const QUIC_SEND_REQUEST* SendRequests
+    );
+
+//
+// Returns TRUE if any send request covering the lost range [Start, End) has
+// passed its QUIC_SEND_FLAG_DEADLINE expiration time.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicStreamSendDeadlineExpired(
+    _In_ const QUIC_STREAM* Stream,
+    _In_ uint64_t Start,
+    _In_ uint64_t End
+    );
+
 //
 // Indicates data has been queued up to be sent out on the stream.
 //
@@ -747,6 +896,16 @@ QuicStreamOnAck(
     _In_ QUIC_SENT_FRAME_METADATA* FrameMetadata
     );
 
+//
+// Indicates the send completions batched by QuicStreamOnAck, for all the
+// connection's streams. Called at the end of each pass of ACK processing.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamSendCompleteFlushBatches(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
 //
 // Called when an ACK is received for a RESET_STREAM frame we sent.
 //
@@ -790,6 +949,16 @@ QuicStreamReceiveCompletePending(
     _In_ uint64_t BufferLength
     );
 
+//
+// Releases the stream's reference on the received datagram its zero-copy
+// receive data points into.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicStreamRecvReleaseDatagram(
+    _In_ QUIC_STREAM* Stream
+    );
+
 //
 // Processes a received frame for the given stream.
 //
@@ -797,7 +966,7 @@ _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicStreamRecv(
     _In_ QUIC_STREAM* Stream,
-    _In_ BOOLEAN EncryptedWith0Rtt,
+    _In_ QUIC_RECV_PACKET* Packet,
     _In_ QUIC_FRAME_TYPE FrameType,
     _In_ uint16_t BufferLength,
     _In_reads_bytes_(BufferLength)
@@ -806,6 +975,17 @@ QuicStreamRecv(
     _Inout_ BOOLEAN* UpdatedFlowControl
     );
 
+//
+// Processes an already decoded STREAM frame for the given stream.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicStreamProcessStreamFrame(
+    _In_ QUIC_STREAM* Stream,
+    _In_ QUIC_RECV_PACKET* Packet,
+    _In_ const QUIC_STREAM_EX* Frame
+    );
+
 //
 // Processes queued events and delivers them to the API client.
 //
@@ -815,6 +995,36 @@ QuicStreamRecvFlush(
     _In_ QUIC_STREAM* Stream
     );
 
+//
+// The scratch space for a QUIC_CONNECTION_EVENT_RECEIVE_BATCH.
+//
+typedef struct QUIC_RECV_BATCH {
+
+    QUIC_STREAM* Streams[QUIC_MAX_RECV_BATCH_STREAMS];
+    QUIC_RECEIVE_BATCH_ENTRY Entries[QUIC_MAX_RECV_BATCH_STREAMS];
+    QUIC_BUFFER Buffers[QUIC_MAX_RECV_BATCH_STREAMS][QUIC_MAX_RECV_INDICATION_BUFFERS];
+
+} QUIC_RECV_BATCH;
+
+//
+// Indicates the data of the connection's streams queued for a receive batch
+// to the app, in one QUIC_CONNECTION_EVENT_RECEIVE_BATCH.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamRecvFlushBatch(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
+//
+// Releases the streams still queued for a receive batch, on cleanup.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamRecvClearBatch(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
 //
 // Enables or disables receive callbacks for the stream.
 //
@@ -89,6 +89,32 @@ Exit:
     }
 }
 
+//
+// Queues the FLUSH_STREAM_RECV operation for the connection's receive batch.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicStreamRecvQueueBatchFlush(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    if (!Connection->RecvBatchFlushQueued) {
+        QUIC_OPERATION* Oper;
+        if ((Oper = QuicOperationAlloc(Connection->Worker, QUIC_OPER_TYPE_FLUSH_STREAM_RECV)) == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "Flush Stream Recv operation",
+                0);
+            return FALSE;
+        }
+        Oper->FLUSH_STREAM_RECEIVE.Stream = NULL;
+        QuicConnQueueOper(Connection, Oper);
+        Connection->RecvBatchFlushQueued = TRUE;
+    }
+    return TRUE;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicStreamRecvQueueFlush(
@@ -110,6 +136,20 @@ QuicStreamRecvQueueFlush(
             Stream,
             "Queuing recv flush");
 
+        QUIC_CONNECTION* Connection = Stream->Connection;
+        if (Connection->ReceiveBatchEnabled && !Stream->RecvMessageFraming) {
+            //
+            // The stream waits with the others for the connection's next
+            // receive batch, instead of getting its own operation.
+            //
+            if (QuicStreamRecvQueueBatchFlush(Connection)) {
+                QuicListInsertTail(&Connection->RecvBatchStreams, &Stream->RecvBatchLink);
+                QuicStreamAddRef(Stream, QUIC_STREAM_REF_OPERATION);
+                Stream->Flags.ReceiveFlushQueued = TRUE;
+            }
+            return;
+        }
+
         QUIC_OPERATION* Oper;
         if ((Oper = QuicOperationAlloc(Stream->Connection->Worker, QUIC_OPER_TYPE_FLUSH_STREAM_RECV)) != NULL) {
             Oper->FLUSH_STREAM_RECEIVE.Stream = Stream;
@@ -265,12 +305,13 @@ _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicStreamProcessStreamFrame(
     _In_ QUIC_STREAM* Stream,
-    _In_ BOOLEAN EncryptedWith0Rtt,
+    _In_ QUIC_RECV_PACKET* Packet,
     _In_ const QUIC_STREAM_EX* Frame
     )
 {
     QUIC_STATUS Status;
     BOOLEAN ReadyToDeliver = FALSE;
+    BOOLEAN Referenced = FALSE;
     uint64_t EndOffset = Frame->Offset + Frame->Length;
 
     if (Stream->Flags.RemoteNotAllowed) {
@@ -346,18 +387,42 @@ QuicStreamProcessStreamFrame(
         // Write any nonduplicate data to the receive buffer.
         // QuicRecvBufferWrite will indicate if there is data to deliver.
         //
-        Status =
-            QuicRecvBufferWrite(
-                &Stream->RecvBuffer,
-                Frame->Offset,
-                (uint16_t)Frame->Length,
-                Frame->Data,
-                &WriteLength,
-                &ReadyToDeliver);
+        if (Stream->Connection->Session->Settings.ZeroCopyRecvEnabled &&
+            Stream->RecvZeroCopyDatagram == NULL) {
+            //
+            // In-order data can be indicated straight out of the decrypted
+            // datagram, which is then held until the app completes the
+            // receive. Anything else is still copied.
+            //
+            Status =
+                QuicRecvBufferWriteExternal(
+                    &Stream->RecvBuffer,
+                    Frame->Offset,
+                    (uint16_t)Frame->Length,
+                    Frame->Data,
+                    &WriteLength,
+                    &ReadyToDeliver,
+                    &Referenced);
+        } else {
+            Status =
+                QuicRecvBufferWrite(
+                    &Stream->RecvBuffer,
+                    Frame->Offset,
+                    (uint16_t)Frame->Length,
+                    Frame->Data,
+                    &WriteLength,
+                    &ReadyToDeliver);
+        }
         if (QUIC_FAILED(Status)) {
             goto Error;
         }
 
+        if (Referenced) {
+            Stream->RecvZeroCopyDatagram =
+                QuicDataPathRecvPacketToRecvDatagram(Packet);
+            Packet->StreamRefCount++;
+        }
+
         //
         // Keep track of the total ordered bytes received.
         //
@@ -372,7 +437,7 @@ QuicStreamProcessStreamFrame(
                 "Flow control window exhausted!");
         }
 
-        if (EncryptedWith0Rtt) {
+        if (Packet->EncryptedWith0Rtt) {
             //
             // Keep track of the maximum length of the 0-RTT payload so that we
             // can indicate that appropriately to the API client.
@@ -383,6 +448,10 @@ QuicStreamProcessStreamFrame(
         }
 
         Stream->Connection->Stats.Recv.TotalStreamBytes += Frame->Length;
+        Stream->Stats.RecvTotalBytes += Frame->Length;
+        if (Stream->RecvBuffer.AllocBufferLength > Stream->Stats.RecvBufferMaxLength) {
+            Stream->Stats.RecvBufferMaxLength = Stream->RecvBuffer.AllocBufferLength;
+        }
     }
 
     if (Frame->Fin) {
@@ -431,7 +500,7 @@ _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicStreamRecv(
     _In_ QUIC_STREAM* Stream,
-    _In_ BOOLEAN EncryptedWith0Rtt,
+    _In_ QUIC_RECV_PACKET* Packet,
     _In_ QUIC_FRAME_TYPE FrameType,
     _In_ uint16_t BufferLength,
     _In_reads_bytes_(BufferLength)
@@ -545,7 +614,7 @@ QuicStreamRecv(
 
         Status =
             QuicStreamProcessStreamFrame(
-                Stream, EncryptedWith0Rtt, &Frame);
+                Stream, Packet, &Frame);
 
         break;
     }
@@ -555,13 +624,81 @@ QuicStreamRecv(
 }
 
 //
-// Generally, every time bytes are delivered to the application we update our max
-// data (stream and connection) values and queue an update to be sent to the
-// peer. It is done every time, because nearly always an ACK frame is also
-// ready to be sent out, so we might as well take advantage of that packet to
-// send this data as well. If we don't have an ACK ready to be sent out
-// immediately then we only update the values if we have reached the drain
-// limit.
+// Changes the stream's receive window, keeping the library's accounting of the
+// memory committed to receive windows in sync. The connection's window is
+// grown along with it, so that a single stream isn't limited by it.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamRecvSetWindow(
+    _In_ QUIC_STREAM* Stream,
+    _In_ uint32_t NewLength
+    )
+{
+    QUIC_SEND* Send = &Stream->Connection->Send;
+
+    InterlockedExchangeAdd64(
+        (int64_t*)&MsQuicLib.CurrentRecvWindowMemoryUsage,
+        (int64_t)NewLength - (int64_t)Stream->RecvBuffer.VirtualBufferLength);
+    QuicRecvBufferSetVirtualBufferLength(&Stream->RecvBuffer, NewLength);
+
+    if (NewLength > Send->MaxDataWindow) {
+        Send->MaxData += NewLength - Send->MaxDataWindow;
+        Send->MaxDataWindow = NewLength;
+    }
+}
+
+//
+// Returns TRUE if the stream's (and connection's) flow control update should be
+// queued now. Updates ride along with any ACK or MAX_DATA frame already queued,
+// which also batches the updates of all the streams drained before the next
+// send. Otherwise, they are held until the peer is about to run low on credit,
+// based on how fast the app has been draining the data and the RTT, so the
+// update arrives just in time without a packet of its own.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+static
+BOOLEAN
+QuicStreamRecvFlowControlUpdateNeeded(
+    _In_ QUIC_STREAM* Stream
+    )
+{
+    const QUIC_CONNECTION* Connection = Stream->Connection;
+    if (Connection->Send.SendFlags &
+        (QUIC_CONN_SEND_FLAG_ACK | QUIC_CONN_SEND_FLAG_MAX_DATA)) {
+        return TRUE;
+    }
+
+    const uint64_t RttCredit =
+        US_TO_S(
+            Stream->RecvWindowDrainRate *
+            QUIC_RECV_WINDOW_UPDATE_RTT_COUNT *
+            Connection->Paths[0].SmoothedRtt);
+
+    uint64_t RecvLength = QuicRecvBufferGetTotalLength(&Stream->RecvBuffer);
+    uint64_t MinCredit =
+        Stream->RecvBuffer.VirtualBufferLength / QUIC_RECV_WINDOW_UPDATE_CREDIT_RATIO;
+    if (MinCredit < RttCredit) {
+        MinCredit = RttCredit;
+    }
+    if (Stream->MaxAllowedRecvOffset <= RecvLength + MinCredit) {
+        return TRUE;
+    }
+
+    MinCredit = Connection->Send.MaxDataWindow / QUIC_RECV_WINDOW_UPDATE_CREDIT_RATIO;
+    if (MinCredit < RttCredit) {
+        MinCredit = RttCredit;
+    }
+    return
+        Connection->Send.MaxDataSent <=
+            Connection->Send.OrderedStreamBytesReceived + MinCredit;
+}
+
+//
+// Every time bytes are delivered to the application we update our max data
+// (stream and connection) values, and the drain rate is measured every time
+// the drain limit is reached. The updates are only queued to be sent to the
+// peer when QuicStreamRecvFlowControlUpdateNeeded says so.
 //
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
@@ -570,6 +707,7 @@ QuicStreamOnBytesDelivered(
     _In_ uint64_t BytesDelivered
     )
 {
+    const QUIC_SETTINGS* Settings = &Stream->Connection->Session->Settings;
     const uint64_t RecvBufferDrainThreshold =
         Stream->RecvBuffer.VirtualBufferLength / QUIC_RECV_BUFFER_DRAIN_RATIO;
 
@@ -579,12 +717,30 @@ QuicStreamOnBytesDelivered(
     if (Stream->RecvWindowBytesDelivered >= RecvBufferDrainThreshold) {
 
         uint32_t TimeNow = QuicTimeUs32();
+        uint32_t VirtualBufferLength = Stream->RecvBuffer.VirtualBufferLength;
 
-        //
-        // Limit stream FC window growth by the connection FC window size.
-        //
-        if (Stream->RecvBuffer.VirtualBufferLength <
-            Stream->Connection->Session->Settings.ConnFlowControlWindow) {
+        if (QuicLibraryIsMemoryBudgetExceeded()) {
+
+            //
+            // Under memory pressure, windows grown by auto-tuning are halved
+            // back towards the default. The window can't be shrunk below the
+            // offset already advertised to the peer, so that's retried on a
+            // later drain if needed.
+            //
+            uint32_t NewLength = VirtualBufferLength / 2;
+            if (NewLength >= Settings->StreamRecvWindowDefault &&
+                Stream->RecvBuffer.BaseOffset + NewLength > Stream->MaxAllowedRecvOffset) {
+
+                QuicTraceLogStreamVerbose(
+                    DecreaseRxBuffer,
+                    Stream,
+                    "Decreasing max RX buffer size to %u (memory pressure)",
+                    NewLength);
+
+                QuicStreamRecvSetWindow(Stream, NewLength);
+            }
+
+        } else if ((uint64_t)VirtualBufferLength * 2 <= Settings->StreamRecvWindowMax) {
 
             uint32_t TimeThreshold = (uint32_t)
                 ((Stream->RecvWindowBytesDelivered * Stream->Connection->Paths[0].MinRtt) / RecvBufferDrainThreshold);
@@ -600,38 +756,43 @@ QuicStreamOnBytesDelivered(
                 //   R / QUIC_RECV_BUFFER_DRAIN_RATIO
                 //
                 // Double VirtualBufferLength to make sure it doesn't limit
-                // throughput.
-                //
-                // Mainly people complain about flow control when it limits
-                // throughput. But if we grow the buffer limit and then the app
-                // stops receiving data, bytes will pile up in the buffer. We could
-                // add logic to shrink the buffer when the app absorb rate is too
-                // low.
+                // throughput, up to StreamRecvWindowMax. If the app later
+                // stops keeping up, the buffered bytes are bounded by memory
+                // pressure shrinking the windows again.
                 //
 
                 QuicTraceLogStreamVerbose(
                     IncreaseRxBuffer,
                     Stream,
                     "Increasing max RX buffer size to %u (MinRtt=%u; TimeNow=%u; LastUpdate=%u)",
-                    Stream->RecvBuffer.VirtualBufferLength * 2,
+                    VirtualBufferLength * 2,
                     Stream->Connection->Paths[0].MinRtt,
                     TimeNow,
                     Stream->RecvWindowLastUpdate);
 
-                QuicRecvBufferSetVirtualBufferLength(
-                    &Stream->RecvBuffer,
-                    Stream->RecvBuffer.VirtualBufferLength * 2);
+                QuicStreamRecvSetWindow(Stream, VirtualBufferLength * 2);
             }
         }
 
+        uint32_t TimeElapsed = QuicTimeDiff32(Stream->RecvWindowLastUpdate, TimeNow);
+        if (TimeElapsed != 0) {
+            Stream->RecvWindowDrainRate =
+                (Stream->RecvWindowBytesDelivered * 1000 * 1000) / TimeElapsed;
+        }
+
         Stream->RecvWindowLastUpdate = TimeNow;
         Stream->RecvWindowBytesDelivered = 0;
+    }
+
+    if (!QuicStreamRecvFlowControlUpdateNeeded(Stream)) {
+        return;
+    }
 
-    } else if (!(Stream->Connection->Send.SendFlags & QUIC_CONN_SEND_FLAG_ACK)) {
+    if (Stream->RecvBuffer.BaseOffset + Stream->RecvBuffer.VirtualBufferLength <=
+        Stream->MaxAllowedRecvOffset) {
         //
-        // We haven't hit the drain limit AND we don't have any ACKs to send
-        // immediately, so we don't need to immediately update the max data
-        // values.
+        // The window was shrunk, and the offset already advertised to the
+        // peer is still ahead of it.
         //
         return;
     }
@@ -645,10 +806,6 @@ QuicStreamOnBytesDelivered(
         Stream,
         "Updating flow control window");
 
-    QUIC_DBG_ASSERT(
-        Stream->RecvBuffer.BaseOffset + Stream->RecvBuffer.VirtualBufferLength >
-        Stream->MaxAllowedRecvOffset);
-
     Stream->MaxAllowedRecvOffset =
         Stream->RecvBuffer.BaseOffset + Stream->RecvBuffer.VirtualBufferLength;
 
@@ -661,6 +818,114 @@ QuicStreamOnBytesDelivered(
         QUIC_STREAM_SEND_FLAG_MAX_DATA);
 }
 
+//
+// For a stream with message framing, trims the read buffers down to the
+// payload of the next message, after its varint length prefix. Returns
+// QUIC_STATUS_PENDING if the whole message isn't readable yet, and
+// QUIC_STATUS_BUFFER_TOO_SMALL if it can never be read in one indication.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicStreamRecvFrameMessage(
+    _In_ QUIC_STREAM* Stream,
+    _Inout_ QUIC_STREAM_EVENT* Event,
+    _Inout_updates_(Event->RECEIVE.BufferCount)
+        QUIC_BUFFER* Buffers
+    )
+{
+    const QUIC_SETTINGS* Settings = &Stream->Connection->Session->Settings;
+    const uint32_t BufferCount = Event->RECEIVE.BufferCount;
+
+    //
+    // The prefix may straddle buffers, so it's gathered first.
+    //
+    uint8_t Prefix[8];
+    uint16_t PrefixLength = 0;
+    for (uint32_t i = 0; i < BufferCount && PrefixLength < sizeof(Prefix); ++i) {
+        uint32_t Length = min(Buffers[i].Length, (uint32_t)(sizeof(Prefix) - PrefixLength));
+        QuicCopyMemory(Prefix + PrefixLength, Buffers[i].Buffer, Length);
+        PrefixLength += (uint16_t)Length;
+    }
+
+    uint16_t Offset = 0;
+    QUIC_VAR_INT MessageLength;
+    if (!QuicVarIntDecode(PrefixLength, Prefix, &Offset, &MessageLength)) {
+        return QUIC_STATUS_PENDING;
+    }
+
+    const uint64_t FramedLength = Offset + MessageLength;
+    if (FramedLength > Settings->StreamRecvWindowMax ||
+        (Stream->RecvBuffer.ChunkPool != NULL &&
+         FramedLength > (QUIC_MAX_RECV_INDICATION_BUFFERS - 1) * QUIC_RECV_BUFFER_CHUNK_SIZE)) {
+        return QUIC_STATUS_BUFFER_TOO_SMALL;
+    }
+
+    if (Event->RECEIVE.TotalBufferLength < FramedLength) {
+        if (FramedLength > Stream->RecvBuffer.VirtualBufferLength) {
+            //
+            // The peer can't send the rest of the message until the window
+            // holds all of it.
+            //
+            uint64_t NewLength = Stream->RecvBuffer.VirtualBufferLength;
+            while (NewLength < FramedLength) {
+                NewLength *= 2;
+            }
+            if (NewLength > Settings->StreamRecvWindowMax) {
+                NewLength = Settings->StreamRecvWindowMax;
+            }
+
+            QuicTraceLogStreamVerbose(
+                IncreaseRxBufferForMessage,
+                Stream,
+                "Increasing max RX buffer size to %u (message of %llu bytes)",
+                (uint32_t)NewLength,
+                FramedLength);
+
+            QuicStreamRecvSetWindow(Stream, (uint32_t)NewLength);
+            Stream->MaxAllowedRecvOffset =
+                Stream->RecvBuffer.BaseOffset + Stream->RecvBuffer.VirtualBufferLength;
+            QuicSendSetSendFlag(
+                &Stream->Connection->Send,
+                QUIC_CONN_SEND_FLAG_MAX_DATA);
+            QuicSendSetStreamSendFlag(
+                &Stream->Connection->Send,
+                Stream,
+                QUIC_STREAM_SEND_FLAG_MAX_DATA);
+        }
+        return QUIC_STATUS_PENDING;
+    }
+
+    //
+    // Skip the prefix and cut the buffers at the end of the message. The
+    // payload keeps pointing into the receive buffer.
+    //
+    uint32_t First = 0;
+    uint32_t Skip = Offset;
+    while (First < BufferCount && Skip >= Buffers[First].Length) {
+        Skip -= Buffers[First].Length;
+        First++;
+    }
+
+    uint64_t Remaining = MessageLength;
+    uint32_t Count = 0;
+    for (uint32_t i = First; i < BufferCount && Remaining != 0; ++i) {
+        uint8_t* Buffer = Buffers[i].Buffer + Skip;
+        uint32_t Length = (uint32_t)min((uint64_t)(Buffers[i].Length - Skip), Remaining);
+        Buffers[Count].Buffer = Buffer;
+        Buffers[Count].Length = Length;
+        Remaining -= Length;
+        Count++;
+        Skip = 0;
+    }
+
+    Event->RECEIVE.AbsoluteOffset += Offset;
+    Event->RECEIVE.BufferCount = Count;
+    Event->RECEIVE.TotalBufferLength = MessageLength;
+    Stream->RecvMessagePrefixLength = (uint8_t)Offset;
+
+    return QUIC_STATUS_SUCCESS;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicStreamRecvFlush(
@@ -682,11 +947,11 @@ QuicStreamRecvFlush(
     BOOLEAN FlushRecv = TRUE;
     while (FlushRecv) {
 
-        QUIC_BUFFER RecvBuffers[2];
+        QUIC_BUFFER RecvBuffers[QUIC_MAX_RECV_INDICATION_BUFFERS];
         QUIC_STREAM_EVENT Event = {0};
         Event.Type = QUIC_STREAM_EVENT_RECEIVE;
         Event.RECEIVE.Flags = 0;
-        Event.RECEIVE.BufferCount = 2;
+        Event.RECEIVE.BufferCount = ARRAYSIZE(RecvBuffers);
         Event.RECEIVE.Buffers = RecvBuffers;
 
         //
@@ -701,6 +966,7 @@ QuicStreamRecvFlush(
 
         Stream->Flags.ReceiveEnabled = FALSE;
         Stream->Flags.ReceiveCallPending = TRUE;
+        Stream->RecvMessagePrefixLength = 0;
 
         if (DataAvailable) {
             for (uint32_t i = 0; i < Event.RECEIVE.BufferCount; ++i) {
@@ -709,6 +975,39 @@ QuicStreamRecvFlush(
             QUIC_DBG_ASSERT(Event.RECEIVE.TotalBufferLength != 0);
             Stream->RecvPendingLength = Event.RECEIVE.TotalBufferLength;
 
+            if (Stream->RecvMessageFraming) {
+                QUIC_STATUS Status =
+                    QuicStreamRecvFrameMessage(Stream, &Event, RecvBuffers);
+                if (Status == QUIC_STATUS_PENDING) {
+                    //
+                    // Wait for the rest of the message. If the read only
+                    // covered the received datagram's bytes, the drain copies
+                    // them into the buffer, and the rest is read right away.
+                    //
+                    BOOLEAN ReadExternal = Stream->RecvBuffer.ExternalData != NULL;
+                    (void)QuicStreamReceiveComplete(Stream, 0);
+                    Stream->Flags.ReceiveEnabled = TRUE;
+                    FlushRecv = ReadExternal;
+                    continue;
+                }
+
+                if (QUIC_FAILED(Status)) {
+                    QuicTraceLogStreamWarning(
+                        RecvMessageTooLarge,
+                        Stream,
+                        "Aborting recv: message too large to indicate");
+                    (void)QuicStreamReceiveComplete(Stream, 0);
+                    QuicStreamShutdown(
+                        Stream,
+                        QUIC_STREAM_SHUTDOWN_FLAG_ABORT_RECEIVE,
+                        QUIC_ERROR_NO_ERROR);
+                    break;
+                }
+
+                Stream->RecvPendingLength =
+                    Event.RECEIVE.TotalBufferLength + Stream->RecvMessagePrefixLength;
+            }
+
             if (Event.RECEIVE.AbsoluteOffset < Stream->RecvMax0RttLength) {
                 //
                 // This data includes data encrypted with 0-RTT key.
@@ -735,8 +1034,21 @@ QuicStreamRecvFlush(
                 Event.RECEIVE.BufferCount,
                 Event.RECEIVE.Flags);
 
+            Stream->Stats.RecvEventCount++;
+            Stream->Flags.ReceiveCallActive = TRUE;
             QUIC_STATUS Status = QuicStreamIndicateEvent(Stream, &Event);
-            if (Status == QUIC_STATUS_PENDING) {
+            Stream->Flags.ReceiveCallActive = FALSE;
+
+            if (Stream->Flags.ReceiveCompletedInline) {
+                //
+                // The app called StreamReceiveComplete from within the
+                // callback. That call only recorded the length, so the receive
+                // completes here just as if it had returned synchronously.
+                //
+                Stream->Flags.ReceiveCompletedInline = FALSE;
+                Event.RECEIVE.TotalBufferLength = Stream->RecvInlineCompletionLength;
+
+            } else if (Status == QUIC_STATUS_PENDING) {
                 if (Stream->Flags.ReceiveCallPending) {
                     //
                     // If the pending call wasn't completed inline, then receive
@@ -787,6 +1099,152 @@ QuicStreamRecvFlush(
     }
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamRecvFlushBatch(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_RECV_BATCH* Batch = Connection->RecvBatch;
+    uint32_t StreamCount = 0;
+
+    Connection->RecvBatchFlushQueued = FALSE;
+
+    while (!QuicListIsEmpty(&Connection->RecvBatchStreams) &&
+        StreamCount < QUIC_MAX_RECV_BATCH_STREAMS) {
+
+        QUIC_STREAM* Stream =
+            QUIC_CONTAINING_RECORD(
+                QuicListRemoveHead(&Connection->RecvBatchStreams),
+                QUIC_STREAM,
+                RecvBatchLink);
+
+        Stream->Flags.ReceiveFlushQueued = FALSE;
+        if (!Stream->Flags.ReceiveEnabled) {
+            QuicTraceLogStreamVerbose(
+                IgnoreRecvFlush,
+                Stream,
+                "Ignoring recv flush (recv disabled)");
+            QuicStreamRelease(Stream, QUIC_STREAM_REF_OPERATION);
+            continue;
+        }
+
+        QUIC_TEL_ASSERT(Stream->Flags.ReceiveDataPending);
+        QUIC_TEL_ASSERT(!Stream->Flags.ReceiveCallPending);
+
+        QUIC_RECEIVE_BATCH_ENTRY* Entry = &Batch->Entries[StreamCount];
+        Entry->Stream = (HQUIC)Stream;
+        Entry->TotalBufferLength = 0;
+        Entry->Buffers = Batch->Buffers[StreamCount];
+        Entry->BufferCount = QUIC_MAX_RECV_INDICATION_BUFFERS;
+        Entry->Flags = 0;
+
+        BOOLEAN DataAvailable =
+            QuicRecvBufferRead(
+                &Stream->RecvBuffer,
+                &Entry->AbsoluteOffset,
+                &Entry->BufferCount,
+                Batch->Buffers[StreamCount]);
+
+        Stream->Flags.ReceiveEnabled = FALSE;
+        Stream->Flags.ReceiveCallPending = TRUE;
+
+        if (!DataAvailable) {
+            //
+            // FIN only case. Nothing to indicate in the batch.
+            //
+            Stream->RecvPendingLength = 0;
+            if (QuicStreamReceiveComplete(Stream, 0)) {
+                QuicStreamRecvQueueFlush(Stream);
+            }
+            QuicStreamRelease(Stream, QUIC_STREAM_REF_OPERATION);
+            continue;
+        }
+
+        for (uint32_t i = 0; i < Entry->BufferCount; ++i) {
+            Entry->TotalBufferLength += Entry->Buffers[i].Length;
+        }
+        QUIC_DBG_ASSERT(Entry->TotalBufferLength != 0);
+        Stream->RecvPendingLength = Entry->TotalBufferLength;
+
+        if (Entry->AbsoluteOffset < Stream->RecvMax0RttLength) {
+            Entry->Flags |= QUIC_RECEIVE_FLAG_0_RTT;
+        }
+        if (Entry->AbsoluteOffset + Entry->TotalBufferLength == Stream->RecvMaxLength) {
+            Entry->Flags |= QUIC_RECEIVE_FLAG_FIN;
+        }
+
+        Stream->Flags.ReceiveCallActive = TRUE;
+        Batch->Streams[StreamCount++] = Stream;
+    }
+
+    if (!QuicListIsEmpty(&Connection->RecvBatchStreams)) {
+        //
+        // More streams than fit in one batch. The rest go in the next one.
+        //
+        (void)QuicStreamRecvQueueBatchFlush(Connection);
+    }
+
+    if (StreamCount == 0) {
+        return;
+    }
+
+    QUIC_CONNECTION_EVENT Event;
+    Event.Type = QUIC_CONNECTION_EVENT_RECEIVE_BATCH;
+    Event.RECEIVE_BATCH.StreamCount = StreamCount;
+    Event.RECEIVE_BATCH.Streams = Batch->Entries;
+    QuicTraceLogConnVerbose(
+        IndicateReceiveBatch,
+        Connection,
+        "Indicating QUIC_CONNECTION_EVENT_RECEIVE_BATCH [%u streams]",
+        StreamCount);
+    QUIC_STATUS Status = QuicConnIndicateEvent(Connection, &Event);
+    QUIC_TEL_ASSERTMSG_ARGS(
+        QUIC_SUCCEEDED(Status) && Status != QUIC_STATUS_PENDING,
+        "App failed or pended recv batch callback",
+        Connection->Registration->AppName,
+        Status, 0);
+
+    //
+    // Unlike the stream's own receive event, the batch can't be pended: every
+    // receive completes now, and the streams with more data (and receives
+    // still enabled) go back in the queue.
+    //
+    for (uint32_t i = 0; i < StreamCount; ++i) {
+        QUIC_STREAM* Stream = Batch->Streams[i];
+        uint64_t BufferLength = Batch->Entries[i].TotalBufferLength;
+
+        Stream->Flags.ReceiveCallActive = FALSE;
+        if (Stream->Flags.ReceiveCompletedInline) {
+            Stream->Flags.ReceiveCompletedInline = FALSE;
+            BufferLength = Stream->RecvInlineCompletionLength;
+        }
+
+        if (QuicStreamReceiveComplete(Stream, BufferLength)) {
+            QuicStreamRecvQueueFlush(Stream);
+        }
+        QuicStreamRelease(Stream, QUIC_STREAM_REF_OPERATION);
+    }
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamRecvClearBatch(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    while (!QuicListIsEmpty(&Connection->RecvBatchStreams)) {
+        QUIC_STREAM* Stream =
+            QUIC_CONTAINING_RECORD(
+                QuicListRemoveHead(&Connection->RecvBatchStreams),
+                QUIC_STREAM,
+                RecvBatchLink);
+        Stream->Flags.ReceiveFlushQueued = FALSE;
+        QuicStreamRelease(Stream, QUIC_STREAM_REF_OPERATION);
+    }
+    Connection->RecvBatchFlushQueued = FALSE;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicStreamReceiveCompletePending(
@@ -799,6 +1257,26 @@ QuicStreamReceiveCompletePending(
     }
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicStreamRecvReleaseDatagram(
+    _In_ QUIC_STREAM* Stream
+    )
+{
+    QUIC_RECV_PACKET* Packet =
+        QuicDataPathRecvDatagramToRecvPacket(Stream->RecvZeroCopyDatagram);
+    QUIC_DBG_ASSERT(Packet->StreamRefCount != 0);
+
+    //
+    // If the connection is still processing the datagram, it returns the
+    // datagram itself once it's done.
+    //
+    if (--Packet->StreamRefCount == 0 && Packet->ReleasedToStreams) {
+        QuicDataPathBindingReturnRecvDatagrams(Stream->RecvZeroCopyDatagram);
+    }
+    Stream->RecvZeroCopyDatagram = NULL;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 BOOLEAN
 QuicStreamReceiveComplete(
@@ -814,6 +1292,17 @@ QuicStreamReceiveComplete(
         BufferLength <= Stream->RecvPendingLength,
         "App overflowed read buffer!");
 
+    if (Stream->RecvMessagePrefixLength != 0) {
+        //
+        // A framed message is consumed whole (with its length prefix) or not
+        // at all.
+        //
+        BufferLength =
+            BufferLength + Stream->RecvMessagePrefixLength == Stream->RecvPendingLength ?
+                Stream->RecvPendingLength : 0;
+        Stream->RecvMessagePrefixLength = 0;
+    }
+
     Stream->Flags.ReceiveCallPending = FALSE;
     QuicTraceLogStreamVerbose(
         ReceiveComplete,
@@ -832,6 +1321,15 @@ QuicStreamReceiveComplete(
         Stream->Flags.ReceiveDataPending = FALSE;
     }
 
+    if (Stream->RecvZeroCopyDatagram != NULL &&
+        Stream->RecvBuffer.ExternalData == NULL) {
+        //
+        // The drain either consumed or copied out the bytes that were still in
+        // the datagram, so it can go back to the datapath.
+        //
+        QuicStreamRecvReleaseDatagram(Stream);
+    }
+
     if (BufferLength != 0) {
         QuicStreamOnBytesDelivered(Stream, BufferLength);
     }
@@ -46,6 +46,12 @@ QuicStreamCompleteSendRequest(
     _In_ BOOLEAN Canceled
     );
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamIndicateSendCompleteBatch(
+    _In_ QUIC_STREAM* Stream
+    );
+
 #if DEBUG
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -87,6 +93,11 @@ QuicStreamIndicateSendShutdownComplete(
     if (!Stream->Flags.HandleSendShutdown) {
         Stream->Flags.HandleSendShutdown = TRUE;
 
+        //
+        // The app gets its batched send completions first.
+        //
+        QuicStreamIndicateSendCompleteBatch(Stream);
+
         QUIC_STREAM_EVENT Event;
         Event.Type = QUIC_STREAM_EVENT_SEND_SHUTDOWN_COMPLETE;
         Event.SEND_SHUTDOWN_COMPLETE.Graceful = GracefulShutdown;
@@ -352,6 +363,107 @@ QuicStreamCanSendNow(
     return FALSE;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamIndicateSendCompleteBatch(
+    _In_ QUIC_STREAM* Stream
+    )
+{
+    if (Stream->SendCompleteBatchCount == 0) {
+        return;
+    }
+
+    QUIC_STREAM_EVENT Event;
+    Event.Type = QUIC_STREAM_EVENT_SEND_COMPLETE_BATCH;
+    Event.SEND_COMPLETE_BATCH.ClientContexts = Stream->SendCompleteBatchContexts;
+    Event.SEND_COMPLETE_BATCH.ClientContextCount = Stream->SendCompleteBatchCount;
+    Event.SEND_COMPLETE_BATCH.TotalLength = Stream->SendCompleteBatchLength;
+    Event.SEND_COMPLETE_BATCH.AckedOffset = Stream->UnAckedOffset;
+
+    //
+    // Reset first, as the app may queue (and complete) more sends from the
+    // callback.
+    //
+    Stream->SendCompleteBatchCount = 0;
+    Stream->SendCompleteBatchLength = 0;
+
+    QuicTraceLogStreamVerbose(
+        IndicateSendCompleteBatch,
+        Stream,
+        "Indicating QUIC_STREAM_EVENT_SEND_COMPLETE_BATCH [%u]",
+        Event.SEND_COMPLETE_BATCH.ClientContextCount);
+
+    (void)QuicStreamIndicateEvent(Stream, &Event);
+}
+
+//
+// Adds the acknowledged send to the stream's batch. Returns FALSE if it must
+// be indicated on its own instead.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicStreamAddSendCompleteToBatch(
+    _In_ QUIC_STREAM* Stream,
+    _In_ QUIC_SEND_REQUEST* SendRequest
+    )
+{
+    if (Stream->SendCompleteBatchCount == Stream->SendCompleteBatchCapacity) {
+        uint32_t NewCapacity = Stream->SendCompleteBatchCapacity * 2;
+        void** NewContexts = QUIC_ALLOC_NONPAGED(NewCapacity * sizeof(void*));
+        if (NewContexts == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "Send complete batch",
+                NewCapacity * sizeof(void*));
+            //
+            // Indicate what's batched so far, to keep the completions in order.
+            //
+            QuicStreamIndicateSendCompleteBatch(Stream);
+            return FALSE;
+        }
+        QuicCopyMemory(
+            NewContexts,
+            Stream->SendCompleteBatchContexts,
+            Stream->SendCompleteBatchCount * sizeof(void*));
+        QUIC_FREE(Stream->SendCompleteBatchContexts);
+        Stream->SendCompleteBatchContexts = NewContexts;
+        Stream->SendCompleteBatchCapacity = NewCapacity;
+    }
+
+    Stream->SendCompleteBatchContexts[Stream->SendCompleteBatchCount++] =
+        SendRequest->ClientContext;
+    Stream->SendCompleteBatchLength += SendRequest->TotalLength;
+
+    if (!Stream->SendCompleteBatchQueued) {
+        Stream->SendCompleteBatchQueued = TRUE;
+        QuicListInsertTail(
+            &Stream->Connection->SendCompleteBatchStreams,
+            &Stream->SendCompleteBatchLink);
+        QuicStreamAddRef(Stream, QUIC_STREAM_REF_OPERATION);
+    }
+
+    return TRUE;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamSendCompleteFlushBatches(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    while (!QuicListIsEmpty(&Connection->SendCompleteBatchStreams)) {
+        QUIC_STREAM* Stream =
+            QUIC_CONTAINING_RECORD(
+                QuicListRemoveHead(&Connection->SendCompleteBatchStreams),
+                QUIC_STREAM,
+                SendCompleteBatchLink);
+        Stream->SendCompleteBatchQueued = FALSE;
+        QuicStreamIndicateSendCompleteBatch(Stream);
+        QuicStreamRelease(Stream, QUIC_STREAM_REF_OPERATION);
+    }
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicStreamCompleteSendRequest(
@@ -372,7 +484,20 @@ QuicStreamCompleteSendRequest(
             !(Stream->SendBufferBookmark->Flags & QUIC_SEND_FLAG_BUFFERED));
     }
 
-    if (!(SendRequest->Flags & QUIC_SEND_FLAG_BUFFERED)) {
+    if (!(SendRequest->Flags & QUIC_SEND_FLAG_BUFFERED) &&
+        !Canceled &&
+        Stream->SendCompleteBatchEnabled &&
+        QuicStreamAddSendCompleteToBatch(Stream, SendRequest)) {
+        //
+        // Indicated with the rest of the batch, at the end of this pass of
+        // ACK processing.
+        //
+
+    } else if (!(SendRequest->Flags & QUIC_SEND_FLAG_BUFFERED)) {
+        if (Canceled) {
+            QuicStreamIndicateSendCompleteBatch(Stream);
+        }
+
         QUIC_STREAM_EVENT Event;
         Event.Type = QUIC_STREAM_EVENT_SEND_COMPLETE;
         Event.SEND_COMPLETE.Canceled = Canceled;
@@ -406,7 +531,7 @@ QuicStreamCompleteSendRequest(
         QuicSendBufferFill(Connection);
     }
 
-    QuicPoolFree(&Stream->Connection->Worker->SendRequestPool, SendRequest);
+    QuicConnFreeSendRequest(Stream->Connection, SendRequest);
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -465,6 +590,74 @@ QuicStreamSendBufferRequest(
     return QUIC_STATUS_SUCCESS;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicStreamSendDeadlineExpired(
+    _In_ const QUIC_STREAM* Stream,
+    _In_ uint64_t Start,
+    _In_ uint64_t End
+    )
+{
+    uint64_t TimeNow = 0;
+
+    //
+    // The requests are in stream offset order, and the fully acknowledged
+    // ones have already been completed, so only the head of the queue needs
+    // to be searched.
+    //
+    for (const QUIC_SEND_REQUEST* Req = Stream->SendRequests;
+        Req != NULL && Req->StreamOffset < End;
+        Req = Req->Next) {
+        if (Req->ExpirationTime == 0 ||
+            Req->StreamOffset + Req->TotalLength <= Start) {
+            continue;
+        }
+        if (TimeNow == 0) {
+            TimeNow = QuicTimeUs64();
+        }
+        if (TimeNow >= Req->ExpirationTime) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+//
+// Returns TRUE if the send requests about to be queued should be corked, i.e.
+// held back briefly so that later writes can share their packets. They are
+// corked if they are all allowed to be (either with QUIC_SEND_FLAG_DELAY_SEND,
+// or by automatic corking when the congestion window isn't the limit) and the
+// stream's unsent data still doesn't fill a packet.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicStreamSendShouldCork(
+    _In_ QUIC_STREAM* Stream,
+    _In_opt_ const QUIC_SEND_REQUEST* SendRequests
+    )
+{
+    QUIC_CONNECTION* Connection = Stream->Connection;
+    if (SendRequests == NULL || !Connection->State.Started) {
+        return FALSE;
+    }
+
+    BOOLEAN AutoCork =
+        Connection->Send.CorkUs != 0 &&
+        QuicCongestionControlCanSend(&Connection->CongestionControl);
+
+    uint64_t UnsentLength = Stream->QueuedSendOffset - Stream->NextSendOffset;
+    for (const QUIC_SEND_REQUEST* Req = SendRequests; Req != NULL; Req = Req->Next) {
+        if (Req->Flags & QUIC_SEND_FLAG_FIN ||
+            (!(Req->Flags & QUIC_SEND_FLAG_DELAY_SEND) && !AutoCork)) {
+            return FALSE;
+        }
+        UnsentLength += Req->TotalLength;
+    }
+
+    return UnsentLength < Connection->Paths[0].Mtu;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicStreamSendFlush(
@@ -476,6 +669,10 @@ QuicStreamSendFlush(
     Stream->ApiSendRequests = NULL;
     QuicDispatchLockRelease(&Stream->ApiSendRequestLock);
 
+    QuicSendSetCorked(
+        &Stream->Connection->Send,
+        QuicStreamSendShouldCork(Stream, ApiSendRequests));
+
     while (ApiSendRequests != NULL) {
 
         QUIC_SEND_REQUEST* SendRequest = ApiSendRequests;
@@ -506,7 +703,24 @@ QuicStreamSendFlush(
         SendRequest->StreamOffset = Stream->QueuedSendOffset;
         Stream->QueuedSendOffset += SendRequest->TotalLength;
 
-        if (SendRequest->Flags & QUIC_SEND_FLAG_ALLOW_0_RTT &&
+        //
+        // Data with a deadline is only retransmitted until the deadline,
+        // counted from when it is queued.
+        //
+        if ((SendRequest->Flags & QUIC_SEND_FLAG_DEADLINE) &&
+            Stream->SendDeadlineUs != 0) {
+            SendRequest->ExpirationTime = QuicTimeUs64() + Stream->SendDeadlineUs;
+        } else {
+            SendRequest->ExpirationTime = 0;
+        }
+
+        //
+        // A client stream opened with QUIC_STREAM_OPEN_FLAG_0_RTT allows all
+        // its data in 0-RTT, so a request queued before the connection starts
+        // goes out in the first flight, coalesced with the Initial packet.
+        //
+        if ((SendRequest->Flags & QUIC_SEND_FLAG_ALLOW_0_RTT ||
+             (Stream->Flags.Opened0Rtt && !QuicConnIsServer(Stream->Connection))) &&
             Stream->Queued0Rtt == SendRequest->StreamOffset) {
             Stream->Queued0Rtt = Stream->QueuedSendOffset;
         }
@@ -574,12 +788,14 @@ QuicStreamCopyFromSendRequests(
     _In_ QUIC_STREAM* Stream,
     _In_ uint64_t Offset,
     _Out_writes_bytes_(Len) uint8_t* Buf,
-    _In_ uint16_t Len
+    _In_ uint16_t Len,
+    _Inout_ QUIC_PACKET_BUILDER* Builder
     )
 {
     //
     // Copies up to Len stream bytes starting at Offset from the noncontiguous
-    // send request queue into a contiguous frame buffer.
+    // send request queue into a contiguous frame buffer. The builder may defer
+    // the actual copies until it encrypts the packet.
     //
     // Returns the actual number of bytes copied, which may be less than the
     // requested number of bytes when not enough data is present in send
@@ -642,7 +858,8 @@ QuicStreamCopyFromSendRequests(
         // Copy the data from the request buffer to the frame buffer.
         //
         uint16_t SubLen = (uint16_t)min(Len, Req->Buffers[CurIndex].Length - (uint32_t)CurOffset);
-        QuicCopyMemory(Buf, Req->Buffers[CurIndex].Buffer + CurOffset, SubLen);
+        QuicPacketBuilderCopyPayload(
+            Builder, Buf, Req->Buffers[CurIndex].Buffer + CurOffset, SubLen);
         Len -= SubLen;
         Buf += SubLen;
         Copied += SubLen;
@@ -650,7 +867,16 @@ QuicStreamCopyFromSendRequests(
         if (Len == 0) {
             //
             // No more frame buffer to copy to or request buffer to copy from.
+            // Start loading the bytes the next frame will most likely copy
+            // (the ones right after these) while this packet is finished.
             //
+            if (CurOffset + SubLen < Req->Buffers[CurIndex].Length) {
+                QuicPrefetch(Req->Buffers[CurIndex].Buffer + CurOffset + SubLen);
+            } else if (CurIndex + 1 < Req->BufferCount) {
+                QuicPrefetch(Req->Buffers[CurIndex + 1].Buffer);
+            } else if (Req->Next != NULL && Req->Next->BufferCount != 0) {
+                QuicPrefetch(Req->Next->Buffers[0].Buffer);
+            }
             break;
         }
 
@@ -686,9 +912,10 @@ QuicStreamWriteOneFrame(
     _Inout_ uint16_t* FramePayloadBytes,
     _Inout_ uint16_t* FrameBytes,
     _Out_writes_bytes_(*FrameBytes) uint8_t* Buffer,
-    _Inout_ QUIC_SENT_PACKET_METADATA* PacketMetadata
+    _Inout_ QUIC_PACKET_BUILDER* Builder
     )
 {
+    QUIC_SENT_PACKET_METADATA* PacketMetadata = Builder->Metadata;
     QUIC_STREAM_EX Frame = { FALSE, ExplicitDataLength, Stream->ID, Offset, 0, NULL };
     uint16_t HeaderLength = 0;
     uint16_t SendLength;
@@ -718,9 +945,13 @@ QuicStreamWriteOneFrame(
         uint8_t* FrameBuffer = Buffer + HeaderLength;
         Frame.Length =
             QuicStreamCopyFromSendRequests(
-                Stream, Offset, FrameBuffer, SendLength);
+                Stream, Offset, FrameBuffer, SendLength, Builder);
         Frame.Data = FrameBuffer;
         Stream->Connection->Stats.Send.TotalStreamBytes += Frame.Length;
+        Stream->Stats.SendTotalBytes += Frame.Length;
+        if (Stream->Stats.FirstSendTime == 0) {
+            Stream->Stats.FirstSendTime = QuicTimeUs64();
+        }
     }
 
     if ((Stream->SendFlags & QUIC_STREAM_SEND_FLAG_FIN) &&
@@ -791,11 +1022,12 @@ void
 QuicStreamWriteStreamFrames(
     _In_ QUIC_STREAM* Stream,
     _In_ BOOLEAN ExplicitDataLength,
-    _Inout_ QUIC_SENT_PACKET_METADATA* PacketMetadata,
+    _Inout_ QUIC_PACKET_BUILDER* Builder,
     _Inout_ uint16_t* BufferLength,
     _Out_writes_bytes_(*BufferLength) uint8_t* Buffer
     )
 {
+    QUIC_SENT_PACKET_METADATA* PacketMetadata = Builder->Metadata;
     QUIC_SEND* Send = &Stream->Connection->Send;
     uint16_t BytesWritten = 0;
 
@@ -894,7 +1126,7 @@ QuicStreamWriteStreamFrames(
             &FramePayloadBytes,
             &FrameBytes,
             Buffer + BytesWritten,
-            PacketMetadata);
+            Builder);
 
         BOOLEAN ExitLoop = FALSE;
 
@@ -1065,7 +1297,7 @@ QuicStreamSendWrite(
         QuicStreamWriteStreamFrames(
             Stream,
             Builder->PacketType == QUIC_INITIAL,
-            Builder->Metadata,
+            Builder,
             &StreamFrameLength,
             (uint8_t*)Builder->Datagram->Buffer + Builder->DatagramLength);
 
@@ -1209,6 +1441,22 @@ QuicStreamOnLoss(
         }
     }
 
+    if (Stream->SendDeadlineUs != 0 &&
+        QuicStreamSendDeadlineExpired(Stream, Start, End)) {
+        //
+        // The lost data is stale, so rather than spend congestion window on
+        // it, abort the send path. The peer gets a RESET_STREAM and all the
+        // outstanding send requests are completed as canceled.
+        //
+        QuicTraceLogStreamInfo(
+            SendDeadlineExpired,
+            Stream,
+            "Lost data past its send deadline, aborting send");
+        QuicStreamSendShutdown(
+            Stream, FALSE, FALSE, Stream->SendDeadlineErrorCode);
+        return TRUE;
+    }
+
     BOOLEAN UpdatedRecoveryWindow = FALSE;
 
     //
@@ -1227,6 +1475,8 @@ QuicStreamOnLoss(
 
     if (UpdatedRecoveryWindow) {
 
+        Stream->Stats.SendRetransmittedBytes += End - Start;
+        Stream->Connection->Send.StreamRecoveryPending = TRUE;
         QuicTraceLogStreamVerbose(
             RecoverRange,
             Stream,
@@ -1383,6 +1633,10 @@ QuicStreamOnAck(
             //
             if (!Stream->Flags.LocalCloseAcked) {
                 Stream->Flags.LocalCloseAcked = TRUE;
+                if (Stream->Stats.FirstSendTime != 0) {
+                    Stream->Stats.SendFullAckTime =
+                        QuicTimeDiff64(Stream->Stats.FirstSendTime, QuicTimeUs64());
+                }
                 QuicTraceEvent(
                     StreamSendState,
                     "[strm][%p] Send State: %hhu",
@@ -1471,7 +1725,7 @@ QuicStreamSendDumpState(
     _In_ QUIC_STREAM* Stream
     )
 {
-    if (QuicTraceLogStreamVerboseEnabled()) {
+    if (QuicTraceLogStreamVerboseEnabled() && Stream->Connection->TraceSampled) {
 
         QuicTraceLogStreamVerbose(
             SendDump,
@@ -16,6 +16,13 @@ Abstract:
 #include "stream_set.c.clog.h"
 #endif
 
+//
+// Returns the stream's slot in the lookup window. The two low bits of the ID
+// are the stream type, so each type gets its own set of slots.
+//
+#define QuicStreamSetWindowIndex(ID) \
+    ((uint32_t)(ID) & (QUIC_STREAM_SET_WINDOW_SIZE * NUMBER_OF_STREAM_TYPES - 1))
+
 #if DEBUG
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
@@ -60,6 +67,9 @@ QuicStreamSetUninitialize(
     if (StreamSet->StreamTable != NULL) {
         QuicHashtableUninitialize(StreamSet->StreamTable);
     }
+    if (StreamSet->StreamWindow != NULL) {
+        QUIC_FREE(StreamSet->StreamWindow);
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -103,11 +113,31 @@ QuicStreamSetInsertStream(
             return FALSE;
         }
     }
+    if (StreamSet->StreamWindow == NULL) {
+        const size_t WindowLength =
+            QUIC_STREAM_SET_WINDOW_SIZE * NUMBER_OF_STREAM_TYPES * sizeof(QUIC_STREAM*);
+        StreamSet->StreamWindow = QUIC_ALLOC_NONPAGED(WindowLength);
+        if (StreamSet->StreamWindow == NULL) {
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "streamset window",
+                WindowLength);
+            return FALSE;
+        }
+        QuicZeroMemory(StreamSet->StreamWindow, WindowLength);
+    }
     QuicHashtableInsert(
         StreamSet->StreamTable,
         &Stream->TableEntry,
         (uint32_t)Stream->ID,
         NULL);
+
+    //
+    // The new stream replaces any older one in its window slot. The older one
+    // is still found via the hash table.
+    //
+    StreamSet->StreamWindow[QuicStreamSetWindowIndex(Stream->ID)] = Stream;
     return TRUE;
 }
 
@@ -123,12 +153,16 @@ QuicStreamSetLookupStream(
         return NULL; // No streams have been created yet.
     }
 
+    QUIC_STREAM* Stream = StreamSet->StreamWindow[QuicStreamSetWindowIndex(ID)];
+    if (Stream != NULL && Stream->ID == ID) {
+        return Stream;
+    }
+
     QUIC_HASHTABLE_LOOKUP_CONTEXT Context;
     QUIC_HASHTABLE_ENTRY* Entry =
         QuicHashtableLookup(StreamSet->StreamTable, (uint32_t)ID, &Context);
     while (Entry != NULL) {
-        QUIC_STREAM* Stream =
-            QUIC_CONTAINING_RECORD(Entry, QUIC_STREAM, TableEntry);
+        Stream = QUIC_CONTAINING_RECORD(Entry, QUIC_STREAM, TableEntry);
         if (Stream->ID == ID) {
             return Stream;
         }
@@ -175,6 +209,9 @@ QuicStreamSetReleaseStream(
     //
     QuicHashtableRemove(StreamSet->StreamTable, &Stream->TableEntry, NULL);
     QuicListInsertTail(&StreamSet->ClosedStreams, &Stream->ClosedLink);
+    if (StreamSet->StreamWindow[QuicStreamSetWindowIndex(Stream->ID)] == Stream) {
+        StreamSet->StreamWindow[QuicStreamSetWindowIndex(Stream->ID)] = NULL;
+    }
 
     uint8_t Flags = (uint8_t)(Stream->ID & STREAM_ID_MASK);
     QUIC_STREAM_TYPE_INFO* Info = &StreamSet->Types[Flags];
@@ -189,12 +226,24 @@ QuicStreamSetReleaseStream(
         return;
     }
 
-    if (Info->CurrentStreamCount < Info->MaxCurrentStreamCount) {
+    if (Info->CurrentStreamCount != 0 && QuicLibraryIsMemoryBudgetExceeded()) {
         //
-        // Since a peer's stream was just closed we should allow the peer to
-        // create more streams.
+        // While the library is over its memory budget, the peer isn't allowed
+        // to replace its closed streams. The credit is restored by the first
+        // close after the pressure is gone, or when its last stream closes, so
+        // the peer is never left without any way to open a stream.
         //
-        Info->MaxTotalStreamCount++;
+        return;
+    }
+
+    //
+    // Since a peer's stream was just closed we should allow the peer to create
+    // more streams, making up for any credit withheld under memory pressure.
+    //
+    uint64_t MaxTotalStreamCount =
+        Info->TotalStreamCount - Info->CurrentStreamCount + Info->MaxCurrentStreamCount;
+    if (MaxTotalStreamCount > Info->MaxTotalStreamCount) {
+        Info->MaxTotalStreamCount = MaxTotalStreamCount;
         QuicSendSetSendFlag(
             &QuicStreamSetGetConnection(StreamSet)->Send,
             (Flags & STREAM_ID_FLAG_IS_UNI_DIR) ?
@@ -434,6 +483,72 @@ QuicStreamSetUpdateMaxCount(
     Info->MaxCurrentStreamCount = Count;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamSetUpdateMaxCountCeiling(
+    _Inout_ QUIC_STREAM_SET* StreamSet,
+    _In_ uint8_t Type,
+    _In_ uint16_t Ceiling
+    )
+{
+    StreamSet->Types[Type].MaxCurrentStreamCountCeiling = Ceiling;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamSetAutoTuneMaxCount(
+    _Inout_ QUIC_STREAM_SET* StreamSet,
+    _In_ uint8_t Type,
+    _In_ BOOLEAN PeerBlocked
+    )
+{
+    QUIC_CONNECTION* Connection = QuicStreamSetGetConnection(StreamSet);
+    QUIC_STREAM_TYPE_INFO* Info = &StreamSet->Types[Type];
+
+    //
+    // A zero limit means the app doesn't accept the peer's streams at all.
+    //
+    if (Info->MaxCurrentStreamCount == 0 ||
+        Info->MaxCurrentStreamCount >= Info->MaxCurrentStreamCountCeiling) {
+        return;
+    }
+
+    //
+    // The number of streams the peer keeps open is its open rate times the
+    // streams' lifetime (Little's law), so this tracks both. Doubling the limit
+    // once half of it is in use sends the new credit well before the peer runs
+    // out, instead of after a STREAMS_BLOCKED round trip.
+    //
+    if (!PeerBlocked &&
+        Info->CurrentStreamCount <= Info->MaxCurrentStreamCount / 2) {
+        return;
+    }
+
+    if (QuicLibraryIsMemoryBudgetExceeded()) {
+        return;
+    }
+
+    uint32_t Count = (uint32_t)Info->MaxCurrentStreamCount * 2;
+    if (Count > Info->MaxCurrentStreamCountCeiling) {
+        Count = Info->MaxCurrentStreamCountCeiling;
+    }
+
+    QuicTraceLogConnInfo(
+        MaxStreamCountAutoTuned,
+        Connection,
+        "Raised peer max stream count to %hu (type=%hhu).",
+        (uint16_t)Count,
+        Type);
+
+    Info->MaxTotalStreamCount += Count - Info->MaxCurrentStreamCount;
+    Info->MaxCurrentStreamCount = (uint16_t)Count;
+    QuicSendSetSendFlag(
+        &Connection->Send,
+        (Type & STREAM_ID_FLAG_IS_UNI_DIR) ?
+            QUIC_CONN_SEND_FLAG_MAX_STREAMS_UNI :
+            QUIC_CONN_SEND_FLAG_MAX_STREAMS_BIDI);
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 uint16_t
 QuicStreamSetGetCountAvailable(
@@ -634,6 +749,7 @@ QuicStreamSetGetStreamForPeer(
             }
             Info->CurrentStreamCount++;
             Info->TotalStreamCount++;
+            QuicStreamSetAutoTuneMaxCount(StreamSet, (uint8_t)StreamType, FALSE);
 
             QuicStreamAddRef(Stream, QUIC_STREAM_REF_STREAM_SET);
 
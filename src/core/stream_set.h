@@ -32,6 +32,12 @@ typedef struct QUIC_STREAM_TYPE_INFO {
     //
     uint16_t CurrentStreamCount;
 
+    //
+    // For the peer's streams, the value MaxCurrentStreamCount is automatically
+    // raised up to as the peer keeps more streams open. Zero if disabled.
+    //
+    uint16_t MaxCurrentStreamCountCeiling;
+
 } QUIC_STREAM_TYPE_INFO;
 
 typedef struct QUIC_STREAM_SET {
@@ -46,6 +52,14 @@ typedef struct QUIC_STREAM_SET {
     //
     QUIC_HASHTABLE* StreamTable;
 
+    //
+    // Direct mapped lookup window over the hash table, indexed by the low bits
+    // of the stream ID. Since stream IDs are allocated sequentially per type,
+    // this holds the most recently opened streams of every type. Lookups that
+    // miss here fall back to the hash table.
+    //
+    QUIC_STREAM** StreamWindow;
+
     //
     // The list of streams that are completely closed and need to be released.
     //
@@ -143,6 +157,30 @@ QuicStreamSetUpdateMaxCount(
     _In_ uint16_t Count
     );
 
+//
+// Sets the ceiling the peer's max stream count of the type is automatically
+// raised up to. Zero disables it.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamSetUpdateMaxCountCeiling(
+    _Inout_ QUIC_STREAM_SET* StreamSet,
+    _In_ uint8_t Type,
+    _In_ uint16_t Ceiling
+    );
+
+//
+// Raises the peer's max stream count of the type, if enabled and the peer is
+// using enough of it. PeerBlocked indicates the peer reported it's blocked.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicStreamSetAutoTuneMaxCount(
+    _Inout_ QUIC_STREAM_SET* StreamSet,
+    _In_ uint8_t Type,
+    _In_ BOOLEAN PeerBlocked
+    );
+
 //
 // Returns the number of available streams still allowed.
 //
@@ -21,27 +21,30 @@ Abstract:
         The timer wheel itself doesn't care about anything other than that value
         from the connection.
 
-        Slots - This is a very simple hash table of time slots. Each slot holds
-        all connections with a next expiration time modulo the total slot count.
+        Levels - The timer wheel is hierarchical. Each level has a fixed number
+        of slots, and each slot of a level covers as much time as the whole of
+        the level below it. The lowest level has 64 us slots, for timers like
+        pacing, ACK delay and loss detection, while the higher levels have
+        slots of milliseconds to minutes, for timers like idle and keep alive.
 
-        Slot Entry - Each slot is made up of a sorted, doubly-linked list of
-        connections.
+        Slot Entry - Each slot is made up of an unsorted, doubly-linked list of
+        connections, and a bit in the level's bitmap.
 
         Next Expiration - Along with all the connections in the timer wheel, the
         timer wheel also explicitly keeps track of the next expiration time and
         connection for quick next delay calculations.
 
-    With these parts, the timer wheel is able to support insertion, update and
-    removal of any number of timers (and their associated connection).
-
     Insertion or update consists of getting the next expiration time from the
-    connection, calculating the correct slot and then doing an insert into the
-    slot's sorted list of connections. Additionally, the next expiration is
-    updated if the new timer is the soonest to expire.
+    connection, picking the lowest level in which the time fits (relative to
+    the last time the timer wheel was processed) and adding the connection to
+    the end of that slot's list. Removal consists of removing the connection
+    from the doubly-linked list. Both are constant time. Additionally, the next
+    expiration is updated if the connection is, or was, the next to expire.
 
-    Removal consists of removing the connection from the doubly-linked list and
-    updating the timer wheel's next expiration if this connection was currently
-    next to expire.
+    Expiration processes every slot, in each level, that has been passed since
+    the last time the timer wheel was processed. Connections that have expired
+    are returned in a batch, and the rest (because higher level slots span a
+    lot of time) are inserted again, at a lower level.
 
 --*/
 
@@ -51,20 +54,29 @@ Abstract:
 #endif
 
 //
-// The initial count of slots in the timer wheel.
+// Shift from time (in us) to a slot of the lowest level, and from the slots
+// of one level to the next.
 //
-#define QUIC_TIMER_WHEEL_INITIAL_SLOT_COUNT     32
+#define QUIC_TIMER_WHEEL_TICK_SHIFT     6   // 64 us
+#define QUIC_TIMER_WHEEL_LEVEL_SHIFT    6   // 64 slots
+
+QUIC_STATIC_ASSERT(
+    (1 << QUIC_TIMER_WHEEL_LEVEL_SHIFT) == QUIC_TIMER_WHEEL_SLOT_COUNT,
+    "Each level's slots must fit in its bitmap");
 
 //
-// On average, the max number of connections per slot.
+// Helper to get the (absolute) slot number for a given time in a level.
 //
-#define QUIC_TIMER_WHEEL_MAX_LOAD_FACTOR    32
+#define TIME_TO_SLOT(Level, TimeUs) \
+    ((TimeUs) >> (QUIC_TIMER_WHEEL_TICK_SHIFT + (Level) * QUIC_TIMER_WHEEL_LEVEL_SHIFT))
 
 //
-// Helper to get the slot index for a given time.
+// Helper to get the start time of an (absolute) slot number in a level.
 //
-#define TIME_TO_SLOT_INDEX(TimerWheel, TimeUs) \
-    ((US_TO_MS(TimeUs) / 1000) % TimerWheel->SlotCount)
+#define SLOT_TO_TIME(Level, Slot) \
+    ((Slot) << (QUIC_TIMER_WHEEL_TICK_SHIFT + (Level) * QUIC_TIMER_WHEEL_LEVEL_SHIFT))
+
+#define SLOT_INDEX(Slot) ((uint32_t)((Slot) & (QUIC_TIMER_WHEEL_SLOT_COUNT - 1)))
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
@@ -75,19 +87,13 @@ QuicTimerWheelInitialize(
     TimerWheel->NextExpirationTime = UINT64_MAX;
     TimerWheel->ConnectionCount = 0;
     TimerWheel->NextConnection = NULL;
-    TimerWheel->SlotCount = QUIC_TIMER_WHEEL_INITIAL_SLOT_COUNT;
-    TimerWheel->Slots =
-        QUIC_ALLOC_NONPAGED(QUIC_TIMER_WHEEL_INITIAL_SLOT_COUNT * sizeof(QUIC_LIST_ENTRY));
-    if (TimerWheel->Slots == NULL) {
-        QuicTraceEvent(
-            AllocFailure,
-            "Allocation of '%s' failed. (%llu bytes)", "timerwheel slots",
-            QUIC_TIMER_WHEEL_INITIAL_SLOT_COUNT * sizeof(QUIC_LIST_ENTRY));
-        return QUIC_STATUS_OUT_OF_MEMORY;
-    }
+    TimerWheel->LastProcessedTime = QuicTimeUs64();
 
-    for (uint32_t i = 0; i < TimerWheel->SlotCount; ++i) {
-        QuicListInitializeHead(&TimerWheel->Slots[i]);
+    for (uint32_t i = 0; i < QUIC_TIMER_WHEEL_LEVEL_COUNT; ++i) {
+        TimerWheel->SlotBitmaps[i] = 0;
+        for (uint32_t j = 0; j < QUIC_TIMER_WHEEL_SLOT_COUNT; ++j) {
+            QuicListInitializeHead(&TimerWheel->Slots[i][j]);
+        }
     }
 
     return QUIC_STATUS_SUCCESS;
@@ -99,107 +105,69 @@ QuicTimerWheelUninitialize(
     _Inout_ QUIC_TIMER_WHEEL* TimerWheel
     )
 {
-    for (uint32_t i = 0; i < TimerWheel->SlotCount; ++i) {
-        QUIC_LIST_ENTRY* ListHead = &TimerWheel->Slots[i];
-        QUIC_LIST_ENTRY* Entry = ListHead->Flink;
-        while (Entry != ListHead) {
-            QUIC_CONNECTION* Connection =
-                QUIC_CONTAINING_RECORD(Entry, QUIC_CONNECTION, TimerLink);
-            QuicTraceLogConnWarning(
-                StillInTimerWheel,
-                Connection,
-                "Still in timer wheel! Connection was likely leaked!");
-            Entry = Entry->Blink;
+    for (uint32_t i = 0; i < QUIC_TIMER_WHEEL_LEVEL_COUNT; ++i) {
+        for (uint32_t j = 0; j < QUIC_TIMER_WHEEL_SLOT_COUNT; ++j) {
+            QUIC_LIST_ENTRY* ListHead = &TimerWheel->Slots[i][j];
+            QUIC_LIST_ENTRY* Entry = ListHead->Flink;
+            while (Entry != ListHead) {
+                QUIC_CONNECTION* Connection =
+                    QUIC_CONTAINING_RECORD(Entry, QUIC_CONNECTION, TimerLink);
+                QuicTraceLogConnWarning(
+                    StillInTimerWheel,
+                    Connection,
+                    "Still in timer wheel! Connection was likely leaked!");
+                Entry = Entry->Flink;
+            }
+            QUIC_TEL_ASSERT(QuicListIsEmpty(ListHead));
         }
-        QUIC_TEL_ASSERT(QuicListIsEmpty(&TimerWheel->Slots[i]));
     }
     QUIC_TEL_ASSERT(TimerWheel->ConnectionCount == 0);
     QUIC_TEL_ASSERT(TimerWheel->NextConnection == NULL);
     QUIC_TEL_ASSERT(TimerWheel->NextExpirationTime == UINT64_MAX);
-
-    QUIC_FREE(TimerWheel->Slots);
 }
 
+//
+// Adds the connection to the slot for its expiration time.
+//
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
-QuicTimerWheelResize(
-    _Inout_ QUIC_TIMER_WHEEL* TimerWheel
+QuicTimerWheelInsert(
+    _Inout_ QUIC_TIMER_WHEEL* TimerWheel,
+    _Inout_ QUIC_CONNECTION* Connection,
+    _In_ uint64_t ExpirationTime
     )
 {
-    uint32_t NewSlotCount = TimerWheel->SlotCount * 2;
-    if (NewSlotCount <= TimerWheel->SlotCount) {
+    if (ExpirationTime < TimerWheel->LastProcessedTime) {
         //
-        // Max size has been reached.
+        // Already expired. It goes in the current lowest level slot.
         //
-        return;
+        ExpirationTime = TimerWheel->LastProcessedTime;
     }
 
-    QUIC_LIST_ENTRY* NewSlots =
-        QUIC_ALLOC_NONPAGED(NewSlotCount * sizeof(QUIC_LIST_ENTRY));
-    if (NewSlots == NULL) {
-        QuicTraceEvent(
-            AllocFailure,
-            "Allocation of '%s' failed. (%llu bytes)", "timerwheel slots (realloc)",
-            NewSlotCount * sizeof(QUIC_LIST_ENTRY));
-        return;
+    //
+    // Find the lowest level where the expiration time is within the level's
+    // slots. If it's too far out for all of them, use the last slot of the
+    // highest level; it'll be inserted again when that slot is processed.
+    //
+    uint32_t Level;
+    uint64_t Slot = 0;
+    for (Level = 0; Level < QUIC_TIMER_WHEEL_LEVEL_COUNT; ++Level) {
+        Slot = TIME_TO_SLOT(Level, ExpirationTime);
+        if (Slot - TIME_TO_SLOT(Level, TimerWheel->LastProcessedTime) <
+                QUIC_TIMER_WHEEL_SLOT_COUNT) {
+            break;
+        }
     }
-
-    QuicTraceLogVerbose(
-        TimerWheelResize,
-        "[time][%p] Resizing timer wheel (new slot count = %u).",
-        TimerWheel,
-        NewSlotCount);
-
-    for (uint32_t i = 0; i < NewSlotCount; ++i) {
-        QuicListInitializeHead(&NewSlots[i]);
+    if (Level == QUIC_TIMER_WHEEL_LEVEL_COUNT) {
+        Level = QUIC_TIMER_WHEEL_LEVEL_COUNT - 1;
+        Slot =
+            TIME_TO_SLOT(Level, TimerWheel->LastProcessedTime) +
+            QUIC_TIMER_WHEEL_SLOT_COUNT - 1;
     }
 
-    uint32_t OldSlotCount = TimerWheel->SlotCount;
-    QUIC_LIST_ENTRY* OldSlots = TimerWheel->Slots;
-
-    TimerWheel->SlotCount = NewSlotCount;
-    TimerWheel->Slots = NewSlots;
-
-    for (uint32_t i = 0; i < OldSlotCount; ++i) {
-        //
-        // Iterate through each old slot, remove all connections and add them
-        // to the new slots.
-        //
-        while (!QuicListIsEmpty(&OldSlots[i])) {
-            QUIC_CONNECTION* Connection =
-                QUIC_CONTAINING_RECORD(
-                    QuicListRemoveHead(&OldSlots[i]),
-                    QUIC_CONNECTION,
-                    TimerLink);
-            uint64_t ExpirationTime = QuicConnGetNextExpirationTime(Connection);
-            uint32_t SlotIndex = TIME_TO_SLOT_INDEX(TimerWheel, ExpirationTime);
-
-            //
-            // Insert the connection into the slot, in the correct order. We search
-            // the slot's list in reverse order, with the assumption that most new
-            // timers will on average be later than existing ones.
-            //
-            QUIC_LIST_ENTRY* ListHead = &TimerWheel->Slots[SlotIndex];
-            QUIC_LIST_ENTRY* Entry = ListHead->Blink;
-
-            while (Entry != ListHead) {
-                QUIC_CONNECTION* ConnectionEntry =
-                    QUIC_CONTAINING_RECORD(Entry, QUIC_CONNECTION, TimerLink);
-                uint64_t EntryExpirationTime = QuicConnGetNextExpirationTime(ConnectionEntry);
-
-                if (ExpirationTime > EntryExpirationTime) {
-                    break;
-                }
-
-                Entry = Entry->Blink;
-            }
-
-            //
-            // Insert after the current entry.
-            //
-            QuicListInsertHead(Entry, &Connection->TimerLink);
-        }
-    }
+    const uint32_t Index = SLOT_INDEX(Slot);
+    QuicListInsertTail(&TimerWheel->Slots[Level][Index], &Connection->TimerLink);
+    TimerWheel->SlotBitmaps[Level] |= (1ull << Index);
 }
 
 //
@@ -216,21 +184,43 @@ QuicTimerWheelUpdate(
     TimerWheel->NextConnection = NULL;
 
     //
-    // Loop over the slots to find the connection with the earliest
-    // expiration time.
+    // Within a level, all the connections in a slot expire before those of
+    // any later slot, so only the first non-empty slot of each level needs to
+    // be searched. A level is skipped entirely if its first slot starts after
+    // the earliest expiration found so far.
     //
-    for (uint32_t i = 0; i < TimerWheel->SlotCount; ++i) {
-        if (!QuicListIsEmpty(&TimerWheel->Slots[i])) {
-            QUIC_CONNECTION* ConnectionEntry =
-                QUIC_CONTAINING_RECORD(
-                    TimerWheel->Slots[i].Flink,
-                    QUIC_CONNECTION,
-                    TimerLink);
-            uint64_t EntryExpirationTime = QuicConnGetNextExpirationTime(ConnectionEntry);
-            if (EntryExpirationTime < TimerWheel->NextExpirationTime) {
-                TimerWheel->NextExpirationTime = EntryExpirationTime;
-                TimerWheel->NextConnection = ConnectionEntry;
+    for (uint32_t Level = 0; Level < QUIC_TIMER_WHEEL_LEVEL_COUNT; ++Level) {
+        const uint64_t FirstSlot =
+            TIME_TO_SLOT(Level, TimerWheel->LastProcessedTime);
+        for (uint32_t i = 0;
+            i < QUIC_TIMER_WHEEL_SLOT_COUNT && TimerWheel->SlotBitmaps[Level] != 0;
+            ++i) {
+            const uint64_t Slot = FirstSlot + i;
+            const uint32_t Index = SLOT_INDEX(Slot);
+            if (!(TimerWheel->SlotBitmaps[Level] & (1ull << Index))) {
+                continue;
+            }
+            QUIC_LIST_ENTRY* ListHead = &TimerWheel->Slots[Level][Index];
+            if (QuicListIsEmpty(ListHead)) {
+                TimerWheel->SlotBitmaps[Level] &= ~(1ull << Index);
+                continue;
             }
+            if (SLOT_TO_TIME(Level, Slot) >= TimerWheel->NextExpirationTime) {
+                break;
+            }
+            for (QUIC_LIST_ENTRY* Entry = ListHead->Flink;
+                Entry != ListHead;
+                Entry = Entry->Flink) {
+                QUIC_CONNECTION* ConnectionEntry =
+                    QUIC_CONTAINING_RECORD(Entry, QUIC_CONNECTION, TimerLink);
+                uint64_t EntryExpirationTime =
+                    QuicConnGetNextExpirationTime(ConnectionEntry);
+                if (EntryExpirationTime < TimerWheel->NextExpirationTime) {
+                    TimerWheel->NextExpirationTime = EntryExpirationTime;
+                    TimerWheel->NextConnection = ConnectionEntry;
+                }
+            }
+            break;
         }
     }
 
@@ -323,32 +313,7 @@ QuicTimerWheelUpdateConnection(
 
     } else {
 
-        uint32_t SlotIndex = TIME_TO_SLOT_INDEX(TimerWheel, ExpirationTime);
-
-        //
-        // Insert the connection into the slot, in the correct order. We search
-        // the slot's list in reverse order, with the assumption that most new
-        // timers will on average be later than existing ones.
-        //
-        QUIC_LIST_ENTRY* ListHead = &TimerWheel->Slots[SlotIndex];
-        QUIC_LIST_ENTRY* Entry = ListHead->Blink;
-
-        while (Entry != ListHead) {
-            QUIC_CONNECTION* ConnectionEntry =
-                QUIC_CONTAINING_RECORD(Entry, QUIC_CONNECTION, TimerLink);
-            uint64_t EntryExpirationTime = QuicConnGetNextExpirationTime(ConnectionEntry);
-
-            if (ExpirationTime > EntryExpirationTime) {
-                break;
-            }
-
-            Entry = Entry->Blink;
-        }
-
-        //
-        // Insert after the current entry.
-        //
-        QuicListInsertHead(Entry, &Connection->TimerLink);
+        QuicTimerWheelInsert(TimerWheel, Connection, ExpirationTime);
 
         QuicTraceLogVerbose(
             TimerWheelUpdateConnection,
@@ -371,15 +336,6 @@ QuicTimerWheelUpdateConnection(
         } else if (Connection == TimerWheel->NextConnection) {
             QuicTimerWheelUpdate(TimerWheel);
         }
-
-        //
-        // Resize the timer wheel if we have too many connections for the
-        // current size.
-        //
-        if (TimerWheel->ConnectionCount >
-            TimerWheel->SlotCount * QUIC_TIMER_WHEEL_MAX_LOAD_FACTOR) {
-            QuicTimerWheelResize(TimerWheel);
-        }
     }
 }
 
@@ -400,11 +356,9 @@ QuicTimerWheelGetWaitTime(
             Delay = 0;
         } else {
             //
-            // Convert the absolute expiration time to a relative delay. Add one
-            // to the delay to ensure we don't end up expiring our wait too
-            // early.
+            // Convert the absolute expiration time to a relative delay.
             //
-            Delay = US_TO_MS(TimerWheel->NextExpirationTime - TimeNow) + 1;
+            Delay = TimerWheel->NextExpirationTime - TimeNow;
         }
     } else {
         //
@@ -415,6 +369,21 @@ QuicTimerWheelGetWaitTime(
     return Delay;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicTimerWheelIsNextTimerPrecise(
+    _In_ QUIC_TIMER_WHEEL* TimerWheel
+    )
+{
+    //
+    // Only the pacing timer needs better than millisecond precision. Since a
+    // connection's timers are sorted, only the first one needs to be checked.
+    //
+    return
+        TimerWheel->NextConnection != NULL &&
+        TimerWheel->NextConnection->Timers[0].Type == QUIC_CONN_TIMER_PACING;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicTimerWheelGetExpired(
@@ -423,24 +392,71 @@ QuicTimerWheelGetExpired(
     _Inout_ QUIC_LIST_ENTRY* OutputListHead
     )
 {
+    QUIC_LIST_ENTRY NotExpired;
+    QuicListInitializeHead(&NotExpired);
+
+    if (TimeNow < TimerWheel->LastProcessedTime) {
+        TimeNow = TimerWheel->LastProcessedTime;
+    }
+
     //
-    // Iterate through every slot to find all the connections that now have
-    // expired timers.
+    // Process every slot, in each level, between the last processed time and
+    // now. Each level has a fixed number of slots, so this is bounded no
+    // matter how long it has been.
     //
-    for (uint32_t i = 0; i < TimerWheel->SlotCount; ++i) {
-        QUIC_LIST_ENTRY* ListHead = &TimerWheel->Slots[i];
-        QUIC_LIST_ENTRY* Entry = ListHead->Flink;
-        while (Entry != ListHead) {
-            QUIC_CONNECTION* ConnectionEntry =
-                QUIC_CONTAINING_RECORD(Entry, QUIC_CONNECTION, TimerLink);
-            uint64_t EntryExpirationTime = QuicConnGetNextExpirationTime(ConnectionEntry);
-            if (EntryExpirationTime > TimeNow) {
-                break;
+    for (uint32_t Level = 0; Level < QUIC_TIMER_WHEEL_LEVEL_COUNT; ++Level) {
+        const uint64_t FirstSlot =
+            TIME_TO_SLOT(Level, TimerWheel->LastProcessedTime);
+        uint64_t SlotCount = TIME_TO_SLOT(Level, TimeNow) - FirstSlot + 1;
+        if (SlotCount > QUIC_TIMER_WHEEL_SLOT_COUNT) {
+            SlotCount = QUIC_TIMER_WHEEL_SLOT_COUNT;
+        }
+
+        for (uint64_t i = 0;
+            i < SlotCount && TimerWheel->SlotBitmaps[Level] != 0;
+            ++i) {
+            const uint32_t Index = SLOT_INDEX(FirstSlot + i);
+            if (!(TimerWheel->SlotBitmaps[Level] & (1ull << Index))) {
+                continue;
+            }
+            TimerWheel->SlotBitmaps[Level] &= ~(1ull << Index);
+
+            QUIC_LIST_ENTRY* ListHead = &TimerWheel->Slots[Level][Index];
+            while (!QuicListIsEmpty(ListHead)) {
+                QUIC_CONNECTION* ConnectionEntry =
+                    QUIC_CONTAINING_RECORD(
+                        QuicListRemoveHead(ListHead),
+                        QUIC_CONNECTION,
+                        TimerLink);
+                uint64_t EntryExpirationTime =
+                    QuicConnGetNextExpirationTime(ConnectionEntry);
+                if (EntryExpirationTime <= TimeNow) {
+                    QuicListInsertTail(OutputListHead, &ConnectionEntry->TimerLink);
+                    TimerWheel->ConnectionCount--;
+                } else {
+                    QuicListInsertTail(&NotExpired, &ConnectionEntry->TimerLink);
+                }
             }
-            Entry = Entry->Flink;
-            QuicListEntryRemove(&ConnectionEntry->TimerLink);
-            QuicListInsertTail(OutputListHead, &ConnectionEntry->TimerLink);
-            TimerWheel->ConnectionCount--;
         }
     }
+
+    TimerWheel->LastProcessedTime = TimeNow;
+
+    //
+    // Connections in higher level slots that haven't expired yet move down to
+    // a lower level, now that they are closer to expiring.
+    //
+    while (!QuicListIsEmpty(&NotExpired)) {
+        QUIC_CONNECTION* ConnectionEntry =
+            QUIC_CONTAINING_RECORD(
+                QuicListRemoveHead(&NotExpired),
+                QUIC_CONNECTION,
+                TimerLink);
+        QuicTimerWheelInsert(
+            TimerWheel,
+            ConnectionEntry,
+            QuicConnGetNextExpirationTime(ConnectionEntry));
+    }
+
+    QuicTimerWheelUpdate(TimerWheel);
 }
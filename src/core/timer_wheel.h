@@ -7,6 +7,13 @@
 
 typedef struct QUIC_CONNECTION QUIC_CONNECTION;
 
+//
+// The number of levels in the timer wheel, and the number of slots (one bit of
+// the level's bitmap each) in each level.
+//
+#define QUIC_TIMER_WHEEL_LEVEL_COUNT    5
+#define QUIC_TIMER_WHEEL_SLOT_COUNT     64
+
 typedef struct QUIC_TIMER_WHEEL {
 
     //
@@ -25,14 +32,21 @@ typedef struct QUIC_TIMER_WHEEL {
     QUIC_CONNECTION* NextConnection;
 
     //
-    // The number of slots in the Slots array.
+    // The time (in us) up to which the slots have been processed for expired
+    // timers. Slot positions in every level are relative to this time.
+    //
+    uint64_t LastProcessedTime;
+
+    //
+    // A bit per slot, for each level, which is set when the slot may be
+    // non-empty. Bits are cleared lazily, when an empty slot is found.
     //
-    uint32_t SlotCount;
+    uint64_t SlotBitmaps[QUIC_TIMER_WHEEL_LEVEL_COUNT];
 
     //
-    // An array of slots in the timer wheel.
+    // The slots of each level. Each slot is an unsorted list of connections.
     //
-    QUIC_LIST_ENTRY* Slots;
+    QUIC_LIST_ENTRY Slots[QUIC_TIMER_WHEEL_LEVEL_COUNT][QUIC_TIMER_WHEEL_SLOT_COUNT];
 
 } QUIC_TIMER_WHEEL;
 
@@ -84,6 +98,15 @@ QuicTimerWheelGetWaitTime(
     _In_ QUIC_TIMER_WHEEL* TimerWheel
     );
 
+//
+// Returns TRUE if the next timer to expire needs sub-millisecond precision.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicTimerWheelIsNextTimerPrecise(
+    _In_ QUIC_TIMER_WHEEL* TimerWheel
+    );
+
 //
 // Gets the next connection with an expired timer.
 //
@@ -27,6 +27,9 @@ Abstract:
 #define QUIC_TP_FLAG_MAX_DATAGRAM_FRAME_SIZE                0x00008000
 #define QUIC_TP_FLAG_INITIAL_SOURCE_CONNECTION_ID           0x00010000
 #define QUIC_TP_FLAG_RETRY_SOURCE_CONNECTION_ID             0x00020000
+#define QUIC_TP_FLAG_MIN_ACK_DELAY                          0x00040000
+#define QUIC_TP_FLAG_ENABLE_MULTIPATH                       0x00080000
+#define QUIC_TP_FLAG_INTEGRITY_ONLY                         0x00100000
 
 #define QUIC_TP_MAX_PACKET_SIZE_DEFAULT                     65527
 #define QUIC_TP_MAX_UDP_PAYLOAD_SIZE_MIN                    1200
@@ -125,6 +128,13 @@ typedef struct QUIC_TRANSPORT_PARAMETERS {
     //
     QUIC_VAR_INT MaxDatagramFrameSize;
 
+    //
+    // The minimum amount of time, in microseconds, the endpoint is willing to
+    // delay an acknowledgment. Indicates support for the ACK_FREQUENCY and
+    // IMMEDIATE_ACK frames. Must not be larger than MaxAckDelay.
+    //
+    QUIC_VAR_INT MinAckDelay;
+
     //
     // The value that the endpoint included in the Source Connection ID field
     // of the first Initial packet it sends for the connection.
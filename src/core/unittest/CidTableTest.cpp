@@ -0,0 +1,127 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Unit test for the QUIC_CID_TABLE source CID lookup table.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "CidTableTest.cpp.clog.h"
+#endif
+
+#include <vector>
+
+struct SmartCidTable {
+    QUIC_CID_TABLE table;
+    std::vector<QUIC_CID_HASH_ENTRY> entries;
+    SmartCidTable(uint32_t Count) : entries(Count) {
+        EXPECT_EQ(TRUE, QuicCidTableInitialize(&table));
+        for (uint32_t i = 0; i < Count; ++i) {
+            QuicZeroMemory(&entries[i], sizeof(entries[i]));
+            entries[i].CID.Length = 8;
+            for (uint8_t j = 0; j < 8; ++j) {
+                entries[i].CID.Data[j] = (uint8_t)((i * 2654435761u) >> (j * 4));
+            }
+        }
+    }
+    ~SmartCidTable() {
+        QuicCidTableUninitialize(&table);
+    }
+    static uint32_t Hash(const QUIC_CID_HASH_ENTRY& Entry) {
+        return QuicHashSimple(Entry.CID.Length, Entry.CID.Data);
+    }
+    void Insert(uint32_t i) {
+        ASSERT_EQ(TRUE, QuicCidTableInsert(&table, Hash(entries[i]), &entries[i]));
+    }
+    void Remove(uint32_t i) {
+        QuicCidTableRemove(&table, Hash(entries[i]), &entries[i]);
+    }
+    QUIC_CID_HASH_ENTRY* Lookup(uint32_t i) {
+        return
+            QuicCidTableLookup(
+                &table,
+                Hash(entries[i]),
+                entries[i].CID.Data,
+                entries[i].CID.Length);
+    }
+};
+
+TEST(CidTableTest, Empty)
+{
+    SmartCidTable Table(1);
+    ASSERT_EQ(Table.table.NumEntries, (uint32_t)0);
+    ASSERT_EQ(Table.Lookup(0), nullptr);
+}
+
+TEST(CidTableTest, InsertLookupRemove)
+{
+    SmartCidTable Table(2);
+    Table.Insert(0);
+    ASSERT_EQ(Table.Lookup(0), &Table.entries[0]);
+    ASSERT_EQ(Table.Lookup(1), nullptr);
+    Table.Remove(0);
+    ASSERT_EQ(Table.table.NumEntries, (uint32_t)0);
+    ASSERT_EQ(Table.Lookup(0), nullptr);
+}
+
+TEST(CidTableTest, Grow)
+{
+    const uint32_t Count = QUIC_CID_TABLE_MIN_CAPACITY * 16;
+    SmartCidTable Table(Count);
+    for (uint32_t i = 0; i < Count; ++i) {
+        Table.Insert(i);
+    }
+    ASSERT_EQ(Table.table.NumEntries, Count);
+    ASSERT_GT(Table.table.Capacity, Count);
+    for (uint32_t i = 0; i < Count; ++i) {
+        ASSERT_EQ(Table.Lookup(i), &Table.entries[i]);
+    }
+}
+
+TEST(CidTableTest, Churn)
+{
+    const uint32_t Count = QUIC_CID_TABLE_MIN_CAPACITY * 4;
+    SmartCidTable Table(Count);
+    for (uint32_t i = 0; i < Count; ++i) {
+        Table.Insert(i);
+    }
+    for (uint32_t Round = 0; Round < 16; ++Round) {
+        for (uint32_t i = Round % 2; i < Count; i += 2) {
+            Table.Remove(i);
+        }
+        for (uint32_t i = 0; i < Count; ++i) {
+            if (i % 2 == Round % 2) {
+                ASSERT_EQ(Table.Lookup(i), nullptr);
+            } else {
+                ASSERT_EQ(Table.Lookup(i), &Table.entries[i]);
+            }
+        }
+        for (uint32_t i = Round % 2; i < Count; i += 2) {
+            Table.Insert(i);
+        }
+    }
+    ASSERT_EQ(Table.table.NumEntries, Count);
+}
+
+TEST(CidTableTest, Enumerate)
+{
+    const uint32_t Count = 100;
+    SmartCidTable Table(Count);
+    for (uint32_t i = 0; i < Count; ++i) {
+        Table.Insert(i);
+    }
+    uint32_t Index = 0;
+    uint32_t Found = 0;
+    QUIC_CID_HASH_ENTRY* Entry;
+    while ((Entry = QuicCidTableEnumerateNext(&Table.table, &Index)) != nullptr) {
+        QuicCidTableRemove(&Table.table, SmartCidTable::Hash(*Entry), Entry);
+        Found++;
+    }
+    ASSERT_EQ(Found, Count);
+    ASSERT_EQ(Table.table.NumEntries, (uint32_t)0);
+}
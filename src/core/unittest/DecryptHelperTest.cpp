@@ -0,0 +1,169 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Unit test for the decrypt helper pool.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "DecryptHelperTest.cpp.clog.h"
+#endif
+
+#define TEST_PACKET_COUNT 16
+#define TEST_HEADER_SIZE 20
+#define TEST_PAYLOAD_SIZE 1000
+
+static const uint8_t TestRawKey[32] = { 1 };
+
+struct TestPackets {
+    uint8_t Header[TEST_HEADER_SIZE];
+    uint8_t Buffers[TEST_PACKET_COUNT][TEST_PAYLOAD_SIZE + QUIC_ENCRYPTION_OVERHEAD];
+    QUIC_DECRYPT_BATCH_ENTRY Entries[TEST_PACKET_COUNT];
+
+    //
+    // Encrypts TEST_PACKET_COUNT packets, each with its own IV and payload.
+    //
+    void Encrypt(QUIC_KEY* Key) {
+        QuicZeroMemory(Header, sizeof(Header));
+        for (uint8_t i = 0; i < TEST_PACKET_COUNT; ++i) {
+            QUIC_DECRYPT_BATCH_ENTRY* Entry = &Entries[i];
+            QuicZeroMemory(Entry, sizeof(*Entry));
+            Entry->Iv[QUIC_IV_LENGTH - 1] = i;
+            Entry->AuthDataLength = sizeof(Header);
+            Entry->AuthData = Header;
+            Entry->BufferLength = sizeof(Buffers[i]);
+            Entry->Buffer = Buffers[i];
+            Entry->Status = QUIC_STATUS_PENDING;
+            memset(Buffers[i], i, TEST_PAYLOAD_SIZE);
+            TEST_QUIC_SUCCEEDED(
+                QuicEncrypt(
+                    Key,
+                    Entry->Iv,
+                    Entry->AuthDataLength,
+                    Entry->AuthData,
+                    Entry->BufferLength,
+                    Entry->Buffer));
+        }
+    }
+
+    void Validate(uint8_t i) {
+        ASSERT_EQ(QUIC_STATUS_SUCCESS, Entries[i].Status);
+        for (uint16_t j = 0; j < TEST_PAYLOAD_SIZE; ++j) {
+            ASSERT_EQ(i, Buffers[i][j]);
+        }
+    }
+};
+
+struct DecryptHelperTest : public ::testing::Test {
+    QUIC_DECRYPT_HELPER_POOL* Pool;
+    QUIC_KEY* WorkerKey;
+    QUIC_KEY* HelperKey;
+    TestPackets Packets;
+
+    void SetUp() override {
+        Pool = nullptr;
+        WorkerKey = nullptr;
+        HelperKey = nullptr;
+        TEST_QUIC_SUCCEEDED(QuicDecryptHelperPoolInitialize(1, &Pool));
+        TEST_QUIC_SUCCEEDED(QuicKeyCreate(QUIC_AEAD_AES_128_GCM, TestRawKey, &WorkerKey));
+        TEST_QUIC_SUCCEEDED(QuicKeyCreate(QUIC_AEAD_AES_128_GCM, TestRawKey, &HelperKey));
+        Packets.Encrypt(WorkerKey);
+    }
+
+    void TearDown() override {
+        if (HelperKey != nullptr) {
+            QuicKeyFree(HelperKey);
+        }
+        if (WorkerKey != nullptr) {
+            QuicKeyFree(WorkerKey);
+        }
+        if (Pool != nullptr) {
+            QuicDecryptHelperPoolUninitialize(Pool);
+        }
+    }
+
+    //
+    // Decrypts the packets the way the connection does: the later ones on the
+    // helper and the earlier ones inline, waiting for the helper only once
+    // its first packet is reached.
+    //
+    void DecryptSplit() {
+        const uint8_t HelperStart = TEST_PACKET_COUNT / 2;
+        QUIC_DECRYPT_HELPER* Helper =
+            QuicDecryptHelperStart(
+                Pool,
+                0,
+                HelperKey,
+                TEST_PACKET_COUNT - HelperStart,
+                Packets.Entries + HelperStart);
+        ASSERT_NE(nullptr, Helper);
+        QuicDecryptBatch(WorkerKey, HelperStart, Packets.Entries);
+        for (uint8_t i = 0; i < HelperStart; ++i) {
+            Packets.Validate(i);
+        }
+        QuicDecryptHelperWait(Helper);
+    }
+};
+
+TEST_F(DecryptHelperTest, Decrypt)
+{
+    DecryptSplit();
+    for (uint8_t i = 0; i < TEST_PACKET_COUNT; ++i) {
+        Packets.Validate(i);
+    }
+}
+
+TEST_F(DecryptHelperTest, DecryptRepeated)
+{
+    //
+    // Back to back jobs are picked up by a polling helper, and jobs queued
+    // after a pause wake a blocked one; both must complete.
+    //
+    for (uint32_t Round = 0; Round < 200; ++Round) {
+        if (Round % 50 == 49) {
+            QuicSleep(1); // Well past QUIC_DECRYPT_HELPER_POLL_US.
+        }
+        Packets.Encrypt(WorkerKey);
+        DecryptSplit();
+        for (uint8_t i = 0; i < TEST_PACKET_COUNT; ++i) {
+            Packets.Validate(i);
+        }
+    }
+}
+
+TEST_F(DecryptHelperTest, DecryptFailure)
+{
+    Packets.Buffers[TEST_PACKET_COUNT - 1][0] ^= 0xFF;
+    DecryptSplit();
+    for (uint8_t i = 0; i < TEST_PACKET_COUNT - 1; ++i) {
+        Packets.Validate(i);
+    }
+    ASSERT_TRUE(QUIC_FAILED(Packets.Entries[TEST_PACKET_COUNT - 1].Status));
+}
+
+TEST_F(DecryptHelperTest, AllHelpersBusy)
+{
+    QUIC_DECRYPT_HELPER* Helper =
+        QuicDecryptHelperStart(Pool, 0, HelperKey, 1, Packets.Entries);
+    ASSERT_NE(nullptr, Helper);
+
+    //
+    // The only helper stays claimed until it's waited on, even once its job
+    // is done, so the next job must be left to the worker.
+    //
+    ASSERT_EQ(
+        nullptr,
+        QuicDecryptHelperStart(Pool, 1, HelperKey, 1, Packets.Entries + 1));
+    QuicDecryptHelperWait(Helper);
+    Packets.Validate(0);
+
+    Helper = QuicDecryptHelperStart(Pool, 1, HelperKey, 1, Packets.Entries + 1);
+    ASSERT_NE(nullptr, Helper);
+    QuicDecryptHelperWait(Helper);
+    Packets.Validate(1);
+}
@@ -23,7 +23,7 @@ TEST_P(AckFrameTest, AckFrameEncodeDecode)
     const uint64_t ContigPktCount = 4;
     const uint64_t MinPktNum = 5;
     const uint64_t AckDelay = 0;
-    QUIC_ACK_ECN_EX Ecn = {4, 4, 4};
+    QUIC_ACK_ECN_EX Ecn = {4, 5, 6};
     QUIC_ACK_ECN_EX DecodedEcn = {0, 0, 0};
     QUIC_RANGE AckRange;
     QUIC_RANGE DecodedAckRange;
@@ -71,6 +71,63 @@ TEST_P(AckFrameTest, AckFrameEncodeDecode)
     QuicRangeUninitialize(&DecodedAckRange);
 }
 
+TEST_P(AckFrameTest, AckFrameEncodeWithBlocks)
+{
+    QUIC_ACK_ECN_EX Ecn = {4, 5, 6};
+    QUIC_ACK_ECN_EX* EcnPtr = GetParam() == QUIC_FRAME_ACK ? nullptr : &Ecn;
+    QUIC_RANGE AckRange;
+    BOOLEAN Unused;
+
+    TEST_QUIC_SUCCEEDED(QuicRangeInitialize(QUIC_MAX_RANGE_DECODE_ACKS, &AckRange));
+    for (uint64_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(QuicRangeAddRange(&AckRange, i * 1000, i + 1, &Unused) != nullptr);
+    }
+
+    //
+    // With room for all the blocks, the frame matches the regular encoding.
+    //
+    uint8_t Blocks[QUIC_MAX_ACK_BLOCKS_ENCODED_LENGTH * 2];
+    uint16_t BlocksLength;
+    uint32_t BlockCount;
+    QuicAckBlocksEncode(&AckRange, sizeof(Blocks), Blocks, &BlocksLength, &BlockCount);
+    ASSERT_EQ(BlockCount, 99u);
+
+    uint8_t Expected[1000];
+    uint8_t Buffer[1000];
+    uint16_t ExpectedLength = 0;
+    uint16_t Offset = 0;
+    ASSERT_TRUE(QuicAckFrameEncode(&AckRange, 25, EcnPtr, &ExpectedLength, sizeof(Expected), Expected));
+    ASSERT_TRUE(QuicAckFrameEncodeWithBlocks(&AckRange, 25, EcnPtr, BlockCount, BlocksLength, Blocks, &Offset, sizeof(Buffer), Buffer));
+    ASSERT_EQ(ExpectedLength, Offset);
+    ASSERT_EQ(0, memcmp(Expected, Buffer, Offset));
+
+    //
+    // With less room, the oldest blocks are left out and the frame still
+    // decodes to the newest ranges.
+    //
+    QuicAckBlocksEncode(&AckRange, 20, Blocks, &BlocksLength, &BlockCount);
+    ASSERT_LE(BlocksLength, 20);
+    ASSERT_GT(BlockCount, 0u);
+    ASSERT_LT(BlockCount, 99u);
+    Offset = 0;
+    ASSERT_TRUE(QuicAckFrameEncodeWithBlocks(&AckRange, 25, EcnPtr, BlockCount, BlocksLength, Blocks, &Offset, sizeof(Buffer), Buffer));
+
+    QUIC_RANGE DecodedAckRange;
+    QUIC_ACK_ECN_EX DecodedEcn;
+    uint64_t DecodedAckDelay;
+    BOOLEAN InvalidFrame;
+    TEST_QUIC_SUCCEEDED(QuicRangeInitialize(QUIC_MAX_RANGE_DECODE_ACKS, &DecodedAckRange));
+    uint16_t DecodeOffset = 1;
+    ASSERT_TRUE(QuicAckFrameDecode(GetParam(), Offset, Buffer, &DecodeOffset, &InvalidFrame, &DecodedAckRange, &DecodedEcn, &DecodedAckDelay));
+    ASSERT_EQ(DecodeOffset, Offset);
+    ASSERT_EQ(QuicRangeSize(&DecodedAckRange), BlockCount + 1);
+    ASSERT_EQ(QuicRangeGetMax(&DecodedAckRange), QuicRangeGetMax(&AckRange));
+    ASSERT_EQ(QuicRangeGetMin(&DecodedAckRange), (99 - BlockCount) * 1000);
+
+    QuicRangeUninitialize(&DecodedAckRange);
+    QuicRangeUninitialize(&AckRange);
+}
+
 TEST_P(AckFrameTest, DecodeAckFrameFail) {
     QUIC_ACK_ECN_EX DecodedEcn;
     uint8_t Buffer[18];
@@ -616,6 +673,69 @@ INSTANTIATE_TEST_SUITE_P(
     ::testing::Values(QUIC_FRAME_STREAM, QUIC_FRAME_STREAM_1, QUIC_FRAME_STREAM_2, QUIC_FRAME_STREAM_3, QUIC_FRAME_STREAM_4, QUIC_FRAME_STREAM_5, QUIC_FRAME_STREAM_6, QUIC_FRAME_STREAM_7),
     ::testing::PrintToStringParamName());
 
+//
+// Microbenchmark for decoding a typical short header payload: an ACK frame
+// followed by two STREAM frames.
+//
+TEST(FrameTest, DecodeShortHeaderPayload)
+{
+    uint8_t Buffer[1200];
+    uint16_t BufferLength = 0;
+    QuicZeroMemory(Buffer, sizeof(Buffer));
+
+    QUIC_RANGE AckRange;
+    TEST_QUIC_SUCCEEDED(QuicRangeInitialize(QUIC_MAX_RANGE_DECODE_ACKS, &AckRange));
+    ASSERT_TRUE(QuicRangeAddValue(&AckRange, 1000));
+    ASSERT_TRUE(QuicAckFrameEncode(&AckRange, 25, nullptr, &BufferLength, sizeof(Buffer), Buffer));
+    QuicRangeUninitialize(&AckRange);
+
+    QUIC_STREAM_EX Frame;
+    QuicZeroMemory(&Frame, sizeof(Frame));
+    Frame.StreamID = 4;
+    Frame.Offset = 100000;
+    Frame.ExplicitLength = TRUE;
+    Frame.Length = 500;
+    Frame.Data = &Buffer[BufferLength + QuicStreamFrameHeaderSize(&Frame)];
+    ASSERT_TRUE(QuicStreamFrameEncode(&Frame, &BufferLength, sizeof(Buffer), Buffer));
+    Frame.StreamID = 8;
+    Frame.ExplicitLength = FALSE;
+    Frame.Length = 0;
+    ASSERT_TRUE(QuicStreamFrameEncode(&Frame, &BufferLength, sizeof(Buffer), Buffer));
+    BufferLength = sizeof(Buffer);
+
+    QUIC_RANGE DecodedAckRange;
+    TEST_QUIC_SUCCEEDED(QuicRangeInitialize(QUIC_MAX_RANGE_DECODE_ACKS, &DecodedAckRange));
+
+    uint16_t Offset = 0;
+    BOOLEAN InvalidFrame = FALSE;
+    uint64_t AckDelay = 0;
+    ASSERT_EQ(QUIC_FRAME_ACK, (QUIC_FRAME_TYPE)Buffer[Offset++]);
+    ASSERT_TRUE(QuicAckFrameDecode(QUIC_FRAME_ACK, BufferLength, Buffer, &Offset, &InvalidFrame, &DecodedAckRange, nullptr, &AckDelay));
+    ASSERT_FALSE(InvalidFrame);
+    ASSERT_EQ(25ull, AckDelay);
+    ASSERT_EQ(1u, QuicRangeSize(&DecodedAckRange));
+    ASSERT_EQ(1000ull, QuicRangeGetMax(&DecodedAckRange));
+
+    QUIC_STREAM_EX DecodedFrame;
+    QuicZeroMemory(&DecodedFrame, sizeof(DecodedFrame));
+    QUIC_FRAME_TYPE FrameType = (QUIC_FRAME_TYPE)Buffer[Offset++];
+    ASSERT_TRUE(QuicStreamFrameDecode(FrameType, BufferLength, Buffer, &Offset, &DecodedFrame));
+    ASSERT_EQ(4ull, DecodedFrame.StreamID);
+    ASSERT_EQ(100000ull, DecodedFrame.Offset);
+    ASSERT_TRUE(DecodedFrame.ExplicitLength);
+    ASSERT_EQ(500ull, DecodedFrame.Length);
+
+    QuicZeroMemory(&DecodedFrame, sizeof(DecodedFrame));
+    FrameType = (QUIC_FRAME_TYPE)Buffer[Offset++];
+    ASSERT_TRUE(QuicStreamFrameDecode(FrameType, BufferLength, Buffer, &Offset, &DecodedFrame));
+    ASSERT_EQ(8ull, DecodedFrame.StreamID);
+    ASSERT_EQ(100000ull, DecodedFrame.Offset);
+    ASSERT_FALSE(DecodedFrame.ExplicitLength);
+    ASSERT_EQ(BufferLength, Offset); // The last frame takes the rest of the packet.
+
+    QuicRangeUninitialize(&DecodedAckRange);
+}
+
 TEST(FrameTest, MaxDataFrameEncodeDecode)
 {
     QUIC_MAX_DATA_EX Frame = {65536};
@@ -1229,3 +1349,48 @@ TEST_P(ConnectionCloseFrameDecodeTest, DecodeConnectionCloseFrameFail) {
 }
 
 INSTANTIATE_TEST_SUITE_P(FrameTest, ConnectionCloseFrameDecodeTest, ::testing::ValuesIn(ConnectionCloseFrameParams::GenerateDecodeFailParams()));
+
+TEST(FrameTest, AckFrequencyFrameEncodeDecode)
+{
+    QUIC_ACK_FREQUENCY_EX Frame = {5, 10, 25000, TRUE};
+    QUIC_ACK_FREQUENCY_EX DecodedFrame;
+    uint8_t Buffer[9];
+    uint16_t BufferLength = (uint16_t)sizeof(Buffer);
+    uint16_t Offset = 0;
+
+    QuicZeroMemory(&DecodedFrame, sizeof(DecodedFrame));
+
+    ASSERT_FALSE(QuicAckFrequencyFrameEncode(&Frame, &Offset, BufferLength - 1, Buffer));
+    ASSERT_TRUE(QuicAckFrequencyFrameEncode(&Frame, &Offset, BufferLength, Buffer));
+    ASSERT_EQ(Offset, BufferLength);
+    ASSERT_EQ(Buffer[0], 0x40);
+    ASSERT_EQ(Buffer[1], QUIC_FRAME_ACK_FREQUENCY);
+    Offset = 2;
+    ASSERT_TRUE(QuicAckFrequencyFrameDecode(BufferLength, Buffer, &Offset, &DecodedFrame));
+
+    ASSERT_EQ(Offset, BufferLength);
+    ASSERT_EQ(Frame.SequenceNumber, DecodedFrame.SequenceNumber);
+    ASSERT_EQ(Frame.PacketTolerance, DecodedFrame.PacketTolerance);
+    ASSERT_EQ(Frame.UpdateMaxAckDelay, DecodedFrame.UpdateMaxAckDelay);
+    ASSERT_EQ(Frame.IgnoreOrder, DecodedFrame.IgnoreOrder);
+}
+
+TEST(FrameTest, DecodeAckFrequencyFrameFail)
+{
+    QUIC_ACK_FREQUENCY_EX DecodedFrame;
+    uint16_t Offset;
+
+    //
+    // Missing Ignore Order field.
+    //
+    uint8_t Truncated[] = { 0x40, QUIC_FRAME_ACK_FREQUENCY, 1, 2, 3 };
+    Offset = 2;
+    ASSERT_FALSE(QuicAckFrequencyFrameDecode(sizeof(Truncated), Truncated, &Offset, &DecodedFrame));
+
+    //
+    // Ignore Order must be 0 or 1.
+    //
+    uint8_t BadIgnoreOrder[] = { 0x40, QUIC_FRAME_ACK_FREQUENCY, 1, 2, 3, 2 };
+    Offset = 2;
+    ASSERT_FALSE(QuicAckFrequencyFrameDecode(sizeof(BadIgnoreOrder), BadIgnoreOrder, &Offset, &DecodedFrame));
+}
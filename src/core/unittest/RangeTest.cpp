@@ -14,6 +14,8 @@ Abstract:
 #include "RangeTest.cpp.clog.h"
 #endif
 
+#include <set>
+
 struct SmartRange {
     QUIC_RANGE range;
     SmartRange(uint32_t MaxAllocSize = QUIC_MAX_RANGE_ALLOC_SIZE) {
@@ -787,3 +789,217 @@ TEST(RangeTest, SearchRangeThree)
     ASSERT_EQ(index, 2);
 #endif
 }
+
+//
+// Compares the range against a set of individual values.
+//
+static void CompareToValues(QUIC_RANGE* Range, const std::set<uint64_t>& Values)
+{
+    uint32_t i = 0;
+    auto It = Values.begin();
+    while (It != Values.end()) {
+        QUIC_SUBRANGE* Sub = QuicRangeGetSafe(Range, i++);
+        ASSERT_NE(Sub, nullptr);
+        for (uint64_t j = 0; j < Sub->Count; ++j, ++It) {
+            ASSERT_NE(It, Values.end());
+            ASSERT_EQ(Sub->Low + j, *It);
+        }
+        ASSERT_TRUE(It == Values.end() || *It > QuicRangeGetHigh(Sub) + 1);
+    }
+    ASSERT_EQ(QuicRangeSize(Range), i);
+}
+
+TEST(RangeTest, Blocks)
+{
+    SmartRange range;
+    std::set<uint64_t> Values;
+
+    //
+    // Every third value, in a scrambled order, gives enough subranges to need
+    // blocks.
+    //
+    const uint32_t Count = QUIC_RANGE_MAX_FLAT_LENGTH * 4;
+    for (uint32_t i = 0; i < Count; ++i) {
+        uint64_t Value = ((i * 7919ull) % Count) * 3;
+        range.Add(Value);
+        Values.insert(Value);
+    }
+    ASSERT_NE(range.range.Blocks, nullptr);
+    ASSERT_EQ(range.ValidCount(), Count);
+    CompareToValues(&range.range, Values);
+
+    for (uint32_t i = 0; i < Count; ++i) {
+        ASSERT_EQ(range.Find(i * 3), (int)i);
+        ASSERT_EQ(range.Find(i * 3 + 1), FIND_INDEX_TO_INSERT_INDEX(i + 1));
+    }
+
+    //
+    // Fill some gaps (merging subranges) and punch some holes (splitting them).
+    //
+    for (uint32_t i = 0; i < Count; i += 5) {
+        range.Add(i * 3 + 1, 2);
+        Values.insert(i * 3 + 1);
+        Values.insert(i * 3 + 2);
+    }
+    CompareToValues(&range.range, Values);
+    for (uint32_t i = 0; i < Count * 3; i += 17) {
+        range.Remove(i, 2);
+        Values.erase(i);
+        Values.erase(i + 1);
+    }
+    CompareToValues(&range.range, Values);
+
+    //
+    // Dropping most of the values goes back to a single array.
+    //
+    uint64_t NewMin = Count * 3 - 30;
+    QuicRangeSetMin(&range.range, NewMin);
+    Values.erase(Values.begin(), Values.lower_bound(NewMin));
+    ASSERT_EQ(range.range.Blocks, nullptr);
+    CompareToValues(&range.range, Values);
+
+    range.Reset();
+    ASSERT_EQ(range.ValidCount(), (uint32_t)0);
+}
+
+TEST(RangeTest, BlocksReset)
+{
+    SmartRange range;
+    for (uint32_t i = 0; i < QUIC_RANGE_MAX_FLAT_LENGTH * 2; ++i) {
+        range.Add(i * 2);
+    }
+    ASSERT_NE(range.range.Blocks, nullptr);
+    range.Reset();
+    ASSERT_EQ(range.ValidCount(), (uint32_t)0);
+    for (uint32_t i = 0; i < QUIC_RANGE_BLOCK_LENGTH * 2; ++i) {
+        range.Add(i * 2);
+    }
+    ASSERT_EQ(range.ValidCount(), (uint32_t)QUIC_RANGE_BLOCK_LENGTH * 2);
+    ASSERT_EQ(range.Min(), 0ull);
+    ASSERT_EQ(range.Max(), (QUIC_RANGE_BLOCK_LENGTH * 2 - 1) * 2ull);
+}
+
+TEST(RangeTest, BlocksHitMax)
+{
+    const uint32_t MaxCount = QUIC_RANGE_MAX_FLAT_LENGTH * 4;
+    SmartRange range(MaxCount * sizeof(QUIC_SUBRANGE));
+    for (uint32_t i = 0; i < MaxCount; i++) {
+        range.Add(i*2);
+    }
+    ASSERT_NE(range.range.Blocks, nullptr);
+    ASSERT_EQ(range.ValidCount(), MaxCount);
+    ASSERT_EQ(range.Min(), 0ull);
+    ASSERT_EQ(range.Max(), (MaxCount - 1)*2ull);
+    range.Add(MaxCount*2);
+    ASSERT_EQ(range.ValidCount(), MaxCount);
+    ASSERT_EQ(range.Min(), 2ull);
+    ASSERT_EQ(range.Max(), MaxCount*2ull);
+    //
+    // Inserting in the middle ages out the smallest value too.
+    //
+    range.Remove(MaxCount, 1);
+    range.Add(MaxCount*2 + 2);
+    ASSERT_EQ(range.ValidCount(), MaxCount);
+    range.Add(MaxCount);
+    ASSERT_EQ(range.ValidCount(), MaxCount);
+    ASSERT_EQ(range.Min(), 4ull);
+    range.Remove(4, 1);
+    ASSERT_EQ(range.ValidCount(), MaxCount - 1);
+    ASSERT_EQ(range.Min(), 6ull);
+    range.Add(0);
+    ASSERT_EQ(range.ValidCount(), MaxCount);
+    ASSERT_EQ(range.Min(), 0ull);
+    ASSERT_EQ(range.Max(), MaxCount*2ull + 2);
+}
+
+TEST(RangeTest, Shrink)
+{
+    SmartRange range;
+    for (uint32_t i = 0; i < QUIC_RANGE_MAX_FLAT_LENGTH * 2; ++i) {
+        range.Add(i * 2);
+    }
+    ASSERT_NE(range.range.Blocks, nullptr);
+
+    //
+    // Too many subranges left to shrink.
+    //
+    range.Remove(0, QUIC_RANGE_MAX_FLAT_LENGTH * 4 - 40);
+    ASSERT_EQ(range.ValidCount(), 20u);
+    QuicRangeShrink(&range.range);
+    ASSERT_EQ(range.ValidCount(), 20u);
+
+    range.Remove(0, QUIC_RANGE_MAX_FLAT_LENGTH * 4 - 6);
+    ASSERT_EQ(range.ValidCount(), 3u);
+    QuicRangeShrink(&range.range);
+    ASSERT_EQ(range.range.Blocks, nullptr);
+    ASSERT_EQ(range.range.AllocLength, 8u);
+    ASSERT_EQ(range.ValidCount(), 3u);
+    ASSERT_EQ(range.Min(), QUIC_RANGE_MAX_FLAT_LENGTH * 4 - 6ull);
+    ASSERT_EQ(range.Max(), QUIC_RANGE_MAX_FLAT_LENGTH * 4 - 2ull);
+
+    //
+    // Still grows again afterwards.
+    //
+    for (uint32_t i = 0; i < 32; ++i) {
+        range.Add(QUIC_RANGE_MAX_FLAT_LENGTH * 4 + i * 2);
+    }
+    ASSERT_EQ(range.ValidCount(), 35u);
+}
+
+TEST(RangeTest, TryReset)
+{
+    SmartRange range;
+    range.Add(100);
+    range.Add(200);
+    ASSERT_TRUE(QuicRangeTryReset(&range.range));
+    ASSERT_EQ(range.ValidCount(), 0u);
+
+    //
+    // Not once it has grown beyond its initial allocation.
+    //
+    for (uint32_t i = 0; i < 32; ++i) {
+        range.Add(i * 2);
+    }
+    ASSERT_FALSE(QuicRangeTryReset(&range.range));
+    ASSERT_EQ(range.ValidCount(), 32u);
+}
+
+//
+// Adding values at the front, each creating a new subrange, fills and splits
+// the first block over and over, and removing a large range spans many
+// blocks.
+//
+TEST(RangeTest, BlocksFrontInsertAndRemoveAcross)
+{
+    SmartRange range;
+    std::set<uint64_t> Values;
+
+    const uint32_t Count = QUIC_RANGE_MAX_FLAT_LENGTH * 8;
+    for (uint32_t i = Count; i > 0; --i) {
+        ASSERT_TRUE(range.TryAdd(i * 2ull));
+        Values.insert(i * 2ull);
+    }
+    ASSERT_NE(range.range.Blocks, nullptr);
+    ASSERT_EQ(range.ValidCount(), Count);
+    ASSERT_EQ(range.Min(), 2ull);
+    ASSERT_EQ(range.Max(), Count * 2ull);
+    CompareToValues(&range.range, Values);
+
+    //
+    // Starts and ends in the middle of a block, several blocks apart.
+    //
+    const uint64_t Low = QUIC_RANGE_BLOCK_LENGTH * 3 + 9;
+    const uint64_t RemoveCount = QUIC_RANGE_BLOCK_LENGTH * 2 * 5;
+    range.Remove(Low, RemoveCount);
+    Values.erase(Values.lower_bound(Low), Values.lower_bound(Low + RemoveCount));
+    ASSERT_EQ(range.ValidCount(), (uint32_t)Values.size());
+    CompareToValues(&range.range, Values);
+
+    //
+    // Removing everything but the ends.
+    //
+    range.Remove(4, Count * 2ull - 5);
+    ASSERT_EQ(range.ValidCount(), 2u);
+    ASSERT_EQ(range.Min(), 2ull);
+    ASSERT_EQ(range.Max(), Count * 2ull);
+}
@@ -0,0 +1,159 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Unit test for the QUIC_SENT_PACKET_RING outstanding packet tracker.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "SentPacketRingTest.cpp.clog.h"
+#endif
+
+#include <vector>
+
+struct SmartSentPacketRing {
+    QUIC_SENT_PACKET_RING ring;
+    std::vector<QUIC_SENT_PACKET_METADATA> packets;
+    uint64_t NextPacketNumber;
+    SmartSentPacketRing(uint32_t Count) : packets(Count), NextPacketNumber(0) {
+        QuicSentPacketRingInitialize(&ring);
+        QuicZeroMemory(packets.data(), sizeof(QUIC_SENT_PACKET_METADATA) * Count);
+    }
+    ~SmartSentPacketRing() {
+        for (uint32_t i = 0; i < ring.Count; ++i) {
+            if (QuicSentPacketRingGet(&ring, i)->Metadata != nullptr) {
+                QuicSentPacketRingRemove(&ring, i);
+            }
+        }
+        QuicSentPacketRingUninitialize(&ring);
+    }
+    void Push(uint32_t i) {
+        packets[i].PacketNumber = NextPacketNumber;
+        NextPacketNumber += 1 + (i % 3); // Leave some gaps.
+        packets[i].SentTime = i;
+        packets[i].PacketLength = (uint16_t)i;
+        ASSERT_EQ(TRUE, QuicSentPacketRingReserve(&ring));
+        QuicSentPacketRingPush(&ring, &packets[i]);
+    }
+    void Remove(uint32_t i) {
+        uint32_t Index = QuicSentPacketRingLowerBound(&ring, 0, packets[i].PacketNumber);
+        ASSERT_LT(Index, ring.Count);
+        ASSERT_EQ(&packets[i], QuicSentPacketRingRemove(&ring, Index));
+    }
+    QUIC_SENT_PACKET_METADATA* Lookup(uint32_t i) {
+        uint32_t Index = QuicSentPacketRingLowerBound(&ring, 0, packets[i].PacketNumber);
+        if (Index == ring.Count) {
+            return nullptr;
+        }
+        QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(&ring, Index);
+        if (Header->PacketNumber != packets[i].PacketNumber) {
+            return nullptr;
+        }
+        return Header->Metadata;
+    }
+};
+
+TEST(SentPacketRingTest, Empty)
+{
+    SmartSentPacketRing Ring(1);
+    ASSERT_EQ(Ring.ring.Count, (uint32_t)0);
+    ASSERT_EQ(Ring.ring.LiveCount, (uint32_t)0);
+    ASSERT_EQ(QuicSentPacketRingLowerBound(&Ring.ring, 0, 0), (uint32_t)0);
+    QuicSentPacketRingTrim(&Ring.ring);
+    ASSERT_EQ(Ring.ring.Count, (uint32_t)0);
+}
+
+TEST(SentPacketRingTest, PushLookupRemove)
+{
+    const uint32_t Count = QUIC_SENT_PACKET_RING_INITIAL_CAPACITY * 4 + 1;
+    SmartSentPacketRing Ring(Count);
+    for (uint32_t i = 0; i < Count; ++i) {
+        Ring.Push(i);
+    }
+    ASSERT_EQ(Ring.ring.LiveCount, Count);
+    ASSERT_GE(Ring.ring.Capacity, Count);
+    for (uint32_t i = 0; i < Count; ++i) {
+        ASSERT_EQ(Ring.Lookup(i), &Ring.packets[i]);
+        QUIC_SENT_PACKET_HEADER* Header = QuicSentPacketRingGet(&Ring.ring, i);
+        ASSERT_EQ(Header->PacketNumber, Ring.packets[i].PacketNumber);
+        ASSERT_EQ(Header->SentTime, Ring.packets[i].SentTime);
+        ASSERT_EQ(Header->PacketLength, Ring.packets[i].PacketLength);
+    }
+
+    //
+    // Packet numbers in the gaps map to the next packet.
+    //
+    ASSERT_EQ(
+        QuicSentPacketRingLowerBound(&Ring.ring, 0, Ring.packets[2].PacketNumber - 1),
+        (uint32_t)2);
+
+    Ring.Remove(5);
+    ASSERT_EQ(Ring.Lookup(5), nullptr);
+    ASSERT_EQ(Ring.ring.LiveCount, Count - 1);
+    ASSERT_EQ(Ring.ring.Count, Count); // Not at the front, so still in use.
+
+    Ring.Remove(0);
+    QuicSentPacketRingTrim(&Ring.ring);
+    ASSERT_EQ(Ring.ring.Count, Count - 1);
+    ASSERT_EQ(QuicSentPacketRingGet(&Ring.ring, 0)->Metadata, &Ring.packets[1]);
+}
+
+TEST(SentPacketRingTest, CompactWhenFull)
+{
+    const uint32_t Count = QUIC_SENT_PACKET_RING_INITIAL_CAPACITY * 4;
+    SmartSentPacketRing Ring(Count);
+    for (uint32_t i = 0; i < QUIC_SENT_PACKET_RING_INITIAL_CAPACITY; ++i) {
+        Ring.Push(i);
+    }
+
+    //
+    // Removing every other packet (except the first) leaves holes that can't
+    // be trimmed, so the next push should compact rather than grow.
+    //
+    for (uint32_t i = 1; i < QUIC_SENT_PACKET_RING_INITIAL_CAPACITY; i += 2) {
+        Ring.Remove(i);
+    }
+    Ring.Remove(2);
+    QuicSentPacketRingTrim(&Ring.ring);
+    ASSERT_EQ(Ring.ring.Count, (uint32_t)QUIC_SENT_PACKET_RING_INITIAL_CAPACITY);
+
+    Ring.Push(QUIC_SENT_PACKET_RING_INITIAL_CAPACITY);
+    ASSERT_EQ(Ring.ring.Capacity, (uint32_t)QUIC_SENT_PACKET_RING_INITIAL_CAPACITY);
+    ASSERT_EQ(Ring.ring.Count, Ring.ring.LiveCount);
+    for (uint32_t i = 0; i <= QUIC_SENT_PACKET_RING_INITIAL_CAPACITY; ++i) {
+        if (i == 2 || i % 2 == 1) {
+            ASSERT_EQ(Ring.Lookup(i), nullptr);
+        } else {
+            ASSERT_EQ(Ring.Lookup(i), &Ring.packets[i]);
+        }
+    }
+}
+
+TEST(SentPacketRingTest, Wraparound)
+{
+    const uint32_t Count = QUIC_SENT_PACKET_RING_INITIAL_CAPACITY * 16;
+    SmartSentPacketRing Ring(Count);
+
+    //
+    // Keep a sliding window of half the capacity outstanding, so the ring
+    // wraps many times without growing.
+    //
+    const uint32_t Window = QUIC_SENT_PACKET_RING_INITIAL_CAPACITY / 2;
+    for (uint32_t i = 0; i < Count; ++i) {
+        Ring.Push(i);
+        if (i >= Window) {
+            Ring.Remove(i - Window);
+            QuicSentPacketRingTrim(&Ring.ring);
+        }
+        ASSERT_EQ(Ring.ring.Count, Ring.ring.LiveCount);
+    }
+    ASSERT_EQ(Ring.ring.Capacity, (uint32_t)QUIC_SENT_PACKET_RING_INITIAL_CAPACITY);
+    for (uint32_t i = Count - Window; i < Count; ++i) {
+        ASSERT_EQ(Ring.Lookup(i), &Ring.packets[i]);
+    }
+}
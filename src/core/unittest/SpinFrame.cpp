@@ -32,6 +32,7 @@ union QuicV1Frames {
     QUIC_PATH_CHALLENGE_EX PathChallengeFrame;
     QUIC_CONNECTION_CLOSE_EX ConnectionCloseFrame;
     QUIC_DATAGRAM_EX DatagramFrame;
+    QUIC_ACK_FREQUENCY_EX AckFrequencyFrame;
 };
 
 TEST(SpinFrame, SpinFrame1000000)
@@ -202,6 +203,7 @@ TEST(SpinFrame, SpinFrame1000000)
                 }
                 break;
             case QUIC_FRAME_HANDSHAKE_DONE:
+            case QUIC_FRAME_IMMEDIATE_ACK:
                 // no-op
                 break;
             case QUIC_FRAME_DATAGRAM:
@@ -212,6 +214,13 @@ TEST(SpinFrame, SpinFrame1000000)
                     FailedDecodes++;
                 }
                 break;
+            case QUIC_FRAME_ACK_FREQUENCY:
+                if (QuicAckFrequencyFrameDecode(BufferLength, Buffer, &Offset, &DecodedFrame.AckFrequencyFrame)) {
+                    SuccessfulDecodes++;
+                } else {
+                    FailedDecodes++;
+                }
+                break;
             default:
                 ASSERT_TRUE(FALSE) << "You have a test bug. FrameType: " << (QUIC_FRAME_TYPE) FrameType << " doesn't have a matching case.";
                 break;
@@ -37,6 +37,7 @@ void CompareTransportParams(
     COMPARE_TP_FIELD(IDLE_TIMEOUT, IdleTimeout);
     COMPARE_TP_FIELD(MAX_ACK_DELAY, MaxAckDelay);
     COMPARE_TP_FIELD(ACTIVE_CONNECTION_ID_LIMIT, ActiveConnectionIdLimit);
+    COMPARE_TP_FIELD(MIN_ACK_DELAY, MinAckDelay);
     //COMPARE_TP_FIELD(InitialSourceConnectionID);
     //COMPARE_TP_FIELD(InitialSourceConnectionIDLength);
     if (IsServer) { // TODO
@@ -99,3 +100,28 @@ TEST(TransportParamTest, Preset1)
     Original.IdleTimeout = 100000;
     EncodeDecodeAndCompare(&Original);
 }
+
+TEST(TransportParamTest, MinAckDelay)
+{
+    QUIC_TRANSPORT_PARAMETERS Original;
+    QuicZeroMemory(&Original, sizeof(Original));
+    Original.Flags |= QUIC_TP_FLAG_MIN_ACK_DELAY;
+    Original.MinAckDelay = 1000;
+    EncodeDecodeAndCompare(&Original);
+}
+
+TEST(TransportParamTest, EnableMultipath)
+{
+    QUIC_TRANSPORT_PARAMETERS Original;
+    QuicZeroMemory(&Original, sizeof(Original));
+    Original.Flags |= QUIC_TP_FLAG_ENABLE_MULTIPATH;
+    EncodeDecodeAndCompare(&Original);
+}
+
+TEST(TransportParamTest, IntegrityOnly)
+{
+    QUIC_TRANSPORT_PARAMETERS Original;
+    QuicZeroMemory(&Original, sizeof(Original));
+    Original.Flags |= QUIC_TP_FLAG_INTEGRITY_ONLY;
+    EncodeDecodeAndCompare(&Original);
+}
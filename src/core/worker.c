@@ -17,6 +17,17 @@ Abstract:
     Each connection is assigned to a single worker, and is queued whenever it
     has operations to be processed.
 
+    In run-to-completion mode, a worker has no thread of its own. Instead, the
+    datapath thread of the same processor calls QuicWorkerPoll after each
+    batch of receives, so that a datagram is received, processed and any
+    response sent, all on the same thread.
+
+    When a worker runs out of work while another worker in the same pool is
+    overloaded, the idle worker asks to steal one of the overloaded worker's
+    queued connections. The overloaded worker hands the next connection it
+    processes over, moving the connection's partition (and so its CIDs) to
+    the idle worker, so that the datapath stays consistent with the new owner.
+
 --*/
 
 #include "precomp.h"
@@ -29,6 +40,12 @@ Abstract:
 //
 QUIC_THREAD_CALLBACK(QuicWorkerThread, Context);
 
+//
+// Datapath callback for processing the work queued for the worker, in
+// run-to-completion mode.
+//
+QUIC_DATAPATH_POLL_CALLBACK QuicWorkerPoll;
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicWorkerInitialize(
@@ -49,9 +66,11 @@ QuicWorkerInitialize(
 
     Worker->Enabled = TRUE;
     Worker->IdealProcessor = IdealProcessor;
+    Worker->NumaNode = QuicProcNumaNode(IdealProcessor);
     QuicDispatchLockInitialize(&Worker->Lock);
     QuicEventInitialize(&Worker->Ready, FALSE, FALSE);
     QuicListInitializeHead(&Worker->Connections);
+    QuicListInitializeHead(&Worker->PriorityConnections);
     QuicListInitializeHead(&Worker->Operations);
     QuicPoolInitialize(FALSE, sizeof(QUIC_STREAM), &Worker->StreamPool);
     QuicPoolInitialize(FALSE, sizeof(QUIC_SEND_REQUEST), &Worker->SendRequestPool);
@@ -59,12 +78,54 @@ QuicWorkerInitialize(
     QuicPoolInitialize(FALSE, sizeof(QUIC_API_CONTEXT), &Worker->ApiContextPool);
     QuicPoolInitialize(FALSE, sizeof(QUIC_STATELESS_CONTEXT), &Worker->StatelessContextPool);
     QuicPoolInitialize(FALSE, sizeof(QUIC_OPERATION), &Worker->OperPool);
+    QuicPoolInitialize(FALSE, QUIC_RECV_BUFFER_CHUNK_SIZE, &Worker->RecvChunkPool);
+    QuicDispatchLockInitialize(&Worker->StreamCacheLock);
+
+    Status = QuicRandomStreamInitialize(&Worker->Random);
+    if (QUIC_FAILED(Status)) {
+        goto Error;
+    }
+
+    QuicRandomStreamRead(
+        &Worker->Random,
+        sizeof(Worker->KeepAliveBucketOffsetUs),
+        &Worker->KeepAliveBucketOffsetUs);
+    Worker->KeepAliveBucketOffsetUs %= QUIC_KEEP_ALIVE_BUCKET_US;
 
     Status = QuicTimerWheelInitialize(&Worker->TimerWheel);
     if (QUIC_FAILED(Status)) {
         goto Error;
     }
 
+    if (Worker->External) {
+        //
+        // The app runs the worker, with ExecutionPoll.
+        //
+        QuicRundownInitialize(&Worker->ExternalRundown);
+        goto Error;
+    }
+
+    if (Worker->RunToCompletion) {
+        Status =
+            QuicDataPathSetPollCallback(
+                MsQuicLib.Datapath,
+                IdealProcessor,
+                QuicWorkerPoll,
+                Worker);
+        if (QUIC_SUCCEEDED(Status)) {
+            goto Error;
+        }
+        //
+        // Fall back to a thread of its own.
+        //
+        QuicTraceLogWarning(
+            WorkerRunToCompletionUnsupported,
+            "[wrkr][%p] Run to completion unavailable, 0x%x",
+            Worker,
+            Status);
+        Worker->RunToCompletion = FALSE;
+    }
+
     QUIC_THREAD_CONFIG ThreadConfig = {
         ThreadFlags,
         IdealProcessor,
@@ -97,6 +158,9 @@ Error:
         QuicPoolUninitialize(&Worker->ApiContextPool);
         QuicPoolUninitialize(&Worker->StatelessContextPool);
         QuicPoolUninitialize(&Worker->OperPool);
+        QuicPoolUninitialize(&Worker->RecvChunkPool);
+        QuicDispatchLockUninitialize(&Worker->StreamCacheLock);
+        QuicRandomStreamUninitialize(&Worker->Random);
         QuicEventUninitialize(Worker->Ready);
         QuicDispatchLockUninitialize(&Worker->Lock);
     }
@@ -104,6 +168,52 @@ Error:
     return Status;
 }
 
+//
+// Releases everything still queued on the worker once it has stopped.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicWorkerCleanupQueues(
+    _In_ QUIC_WORKER* Worker
+    )
+{
+    //
+    // Because the session layer only waits for the session rundown to complete,
+    // and because the connection releases the session rundown on handle close,
+    // not free, it's possible that the worker thread still had the connection
+    // in it's list by the time clean up started. So it needs to release any
+    // remaining references on connections.
+    //
+    QuicListMoveItems(&Worker->PriorityConnections, &Worker->Connections);
+    while (!QuicListIsEmpty(&Worker->Connections)) {
+        QUIC_CONNECTION* Connection =
+            QUIC_CONTAINING_RECORD(
+                QuicListRemoveHead(&Worker->Connections), QUIC_CONNECTION, WorkerLink);
+        if (!Connection->State.ExternalOwner) {
+            //
+            // If there is no external owner, shut down the connection so that
+            // it's not leaked.
+            //
+            QuicTraceLogConnVerbose(
+                AbandonOnLibShutdown,
+                Connection,
+                "Abandoning on shutdown");
+            QuicConnOnShutdownComplete(Connection);
+        }
+        QuicConnRelease(Connection, QUIC_CONN_REF_WORKER);
+    }
+
+    while (!QuicListIsEmpty(&Worker->Operations)) {
+        QUIC_OPERATION* Operation =
+            QUIC_CONTAINING_RECORD(
+                QuicListRemoveHead(&Worker->Operations), QUIC_OPERATION, Link);
+#if DEBUG
+        Operation->Link.Flink = NULL;
+#endif
+        QuicOperationFree(Worker, Operation);
+    }
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicWorkerUninitialize(
@@ -120,22 +230,53 @@ QuicWorkerUninitialize(
     //
     Worker->Enabled = FALSE;
 
-    //
-    // Wait for the thread to finish.
-    //
-    QuicEventSet(Worker->Ready);
-    QuicThreadWait(&Worker->Thread);
-    QuicThreadDelete(&Worker->Thread);
+    if (Worker->External) {
+        //
+        // Wait for the ExecutionPoll calls in progress to return. New ones
+        // fail to acquire the rundown and return right away.
+        //
+        QuicRundownReleaseAndWait(&Worker->ExternalRundown);
+        QuicRundownUninitialize(&Worker->ExternalRundown);
+        QuicWorkerCleanupQueues(Worker);
+    } else if (Worker->RunToCompletion) {
+        //
+        // Once cleared, the datapath thread is no longer running the worker.
+        //
+        (void)QuicDataPathSetPollCallback(
+            MsQuicLib.Datapath,
+            Worker->IdealProcessor,
+            NULL,
+            NULL);
+        QuicWorkerCleanupQueues(Worker);
+    } else {
+        //
+        // Wait for the thread to finish.
+        //
+        QuicEventSet(Worker->Ready);
+        QuicThreadWait(&Worker->Thread);
+        QuicThreadDelete(&Worker->Thread);
+    }
 
     QUIC_TEL_ASSERT(QuicListIsEmpty(&Worker->Connections));
+    QUIC_TEL_ASSERT(QuicListIsEmpty(&Worker->PriorityConnections));
     QUIC_TEL_ASSERT(QuicListIsEmpty(&Worker->Operations));
 
+    QuicStreamCacheDrain(Worker);
+    QuicDispatchLockUninitialize(&Worker->StreamCacheLock);
+    QuicStatsRegionReleaseWorker(Worker);
+
+    if (Worker->ResumptionTPEncoded != NULL) {
+        QUIC_FREE(Worker->ResumptionTPEncoded);
+    }
+
     QuicPoolUninitialize(&Worker->StreamPool);
     QuicPoolUninitialize(&Worker->SendRequestPool);
     QuicSentPacketPoolUninitialize(&Worker->SentPacketPool);
     QuicPoolUninitialize(&Worker->ApiContextPool);
     QuicPoolUninitialize(&Worker->StatelessContextPool);
     QuicPoolUninitialize(&Worker->OperPool);
+    QuicPoolUninitialize(&Worker->RecvChunkPool);
+    QuicRandomStreamUninitialize(&Worker->Random);
     QuicEventUninitialize(Worker->Ready);
     QuicDispatchLockUninitialize(&Worker->Lock);
     QuicTimerWheelUninitialize(&Worker->TimerWheel);
@@ -154,7 +295,21 @@ QuicWorkerAssignConnection(
     )
 {
     QUIC_DBG_ASSERT(Connection->Worker != Worker);
+    if (Connection->InHandshakeCount) {
+        InterlockedDecrement(&Connection->Worker->HandshakeCount);
+        InterlockedIncrement(&Worker->HandshakeCount);
+    }
+    QuicDispatchLockAcquire(&Connection->ReceiveQueueLock);
+    if (Connection->ReceiveQueueCount != 0) {
+        InterlockedExchangeAdd64(
+            &Connection->Worker->ReceiveQueueCount,
+            -(int64_t)Connection->ReceiveQueueCount);
+        InterlockedExchangeAdd64(
+            &Worker->ReceiveQueueCount,
+            (int64_t)Connection->ReceiveQueueCount);
+    }
     Connection->Worker = Worker;
+    QuicDispatchLockRelease(&Connection->ReceiveQueueLock);
     QuicTraceEvent(
         ConnAssignWorker,
         "[conn][%p] Assigned worker: %p",
@@ -162,6 +317,30 @@ QuicWorkerAssignConnection(
         Worker);
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicWorkerAddHandshake(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QUIC_DBG_ASSERT(Connection->Worker != NULL);
+    QUIC_DBG_ASSERT(!Connection->InHandshakeCount);
+    Connection->InHandshakeCount = TRUE;
+    InterlockedIncrement(&Connection->Worker->HandshakeCount);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicWorkerReleaseHandshake(
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    if (Connection->InHandshakeCount) {
+        Connection->InHandshakeCount = FALSE;
+        InterlockedDecrement(&Connection->Worker->HandshakeCount);
+    }
+}
+
 BOOLEAN
 QuicWorkerIsIdle(
     _In_ const QUIC_WORKER* Worker
@@ -169,9 +348,56 @@ QuicWorkerIsIdle(
 {
     return
         QuicListIsEmpty(&Worker->Connections) &&
+        QuicListIsEmpty(&Worker->PriorityConnections) &&
         QuicListIsEmpty(&Worker->Operations);
 }
 
+//
+// Queues the connection in its lane. Called with the worker lock held.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicWorkerInsertConnection(
+    _In_ QUIC_WORKER* Worker,
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    QuicListInsertTail(
+        Connection->LatencySensitive ?
+            &Worker->PriorityConnections : &Worker->Connections,
+        &Connection->WorkerLink);
+}
+
+//
+// Kicks the worker to process newly queued work.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicWorkerWake(
+    _In_ QUIC_WORKER* Worker
+    )
+{
+    if (Worker->External) {
+        //
+        // The app may poll the worker from any thread, so always wake it.
+        //
+        QUIC_EXECUTION_WAKE_FN* Wake = Worker->ExternalWake;
+        if (Wake != NULL) {
+            Wake(Worker->ExternalWakeContext);
+        }
+    } else if (Worker->RunToCompletion) {
+        //
+        // Work queued on the datapath thread itself is picked up when it calls
+        // back into the worker after the current batch.
+        //
+        if (Worker->ThreadID != QuicCurThreadID()) {
+            QuicDataPathWakeProcessor(MsQuicLib.Datapath, Worker->IdealProcessor);
+        }
+    } else {
+        QuicEventSet(Worker->Ready);
+    }
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
 QuicWorkerQueueConnection(
@@ -193,7 +419,7 @@ QuicWorkerQueueConnection(
             Connection,
             QUIC_SCHEDULE_QUEUED);
         QuicConnAddRef(Connection, QUIC_CONN_REF_WORKER);
-        QuicListInsertTail(&Worker->Connections, &Connection->WorkerLink);
+        QuicWorkerInsertConnection(Worker, Connection);
     } else {
         WakeWorkerThread = FALSE;
     }
@@ -203,7 +429,7 @@ QuicWorkerQueueConnection(
     QuicDispatchLockRelease(&Worker->Lock);
 
     if (WakeWorkerThread) {
-        QuicEventSet(Worker->Ready);
+        QuicWorkerWake(Worker);
     }
 }
 
@@ -228,13 +454,13 @@ QuicWorkerMoveConnection(
             Connection,
             QUIC_SCHEDULE_QUEUED);
         QuicConnAddRef(Connection, QUIC_CONN_REF_WORKER);
-        QuicListInsertTail(&Worker->Connections, &Connection->WorkerLink);
+        QuicWorkerInsertConnection(Worker, Connection);
     }
 
     QuicDispatchLockRelease(&Worker->Lock);
 
     if (WakeWorkerThread) {
-        QuicEventSet(Worker->Ready);
+        QuicWorkerWake(Worker);
     }
 }
 
@@ -271,7 +497,7 @@ QuicWorkerQueueOperation(
         QuicPacketLogDrop(Binding, Packet, "Worker operation limit reached");
         QuicOperationFree(Worker, Operation);
     } else if (WakeWorkerThread) {
-        QuicEventSet(Worker->Ready);
+        QuicWorkerWake(Worker);
     }
 }
 
@@ -323,6 +549,105 @@ QuicWorkerResetQueueDelay(
         Worker->AverageQueueDelay);
 }
 
+//
+// Called by an idle worker to ask an overloaded peer to hand over one of its
+// queued connections.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicWorkerRequestSteal(
+    _In_ QUIC_WORKER* Worker
+    )
+{
+    QUIC_WORKER_POOL* WorkerPool = Worker->Pool;
+    if (WorkerPool == NULL || WorkerPool->WorkerCount < 2) {
+        return;
+    }
+
+    const uint8_t Index = (uint8_t)(Worker - WorkerPool->Workers);
+    for (uint8_t i = 1; i < WorkerPool->WorkerCount; ++i) {
+        QUIC_WORKER* Victim =
+            &WorkerPool->Workers[(Index + i) % WorkerPool->WorkerCount];
+        if (!QuicWorkerIsOverloaded(Victim) ||
+            Victim->StealingWorker != NULL ||
+            Victim->NumaNode != Worker->NumaNode) { // Connection memory stays on its node.
+            continue;
+        }
+
+        BOOLEAN Requested = FALSE;
+        QuicDispatchLockAcquire(&Victim->Lock);
+        //
+        // Only steal if the victim has more than one connection queued, so
+        // that it doesn't go idle itself.
+        //
+        if (Victim->StealingWorker == NULL &&
+            !QuicListIsEmpty(&Victim->Connections) &&
+            Victim->Connections.Flink != Victim->Connections.Blink) {
+            Victim->StealingWorker = Worker;
+            Requested = TRUE;
+        }
+        QuicDispatchLockRelease(&Victim->Lock);
+
+        if (Requested) {
+            QuicTraceLogVerbose(
+                WorkerStealRequested,
+                "[wrkr][%p] Requested steal from %p",
+                Worker,
+                Victim);
+            break;
+        }
+    }
+}
+
+//
+// Called on an overloaded worker, before processing the connection, to hand
+// it over to an idle worker that requested it.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicWorkerTryHandOffConnection(
+    _In_ QUIC_WORKER* Worker,
+    _In_ QUIC_CONNECTION* Connection
+    )
+{
+    if (!Connection->State.Connected ||
+        Connection->State.UpdateWorker ||
+        Connection->State.HandleClosed ||
+        Connection->State.ClosedLocally ||
+        Connection->State.ClosedRemotely ||
+        Connection->Registration == NULL ||
+        Connection->Registration->NoPartitioning ||
+        Connection->Registration->WorkerPool != Worker->Pool) {
+        return;
+    }
+
+    QuicDispatchLockAcquire(&Worker->Lock);
+    QUIC_WORKER* StealingWorker = Worker->StealingWorker;
+    Worker->StealingWorker = NULL;
+    QuicDispatchLockRelease(&Worker->Lock);
+
+    if (StealingWorker == NULL) {
+        return;
+    }
+
+    QuicTraceLogConnInfo(
+        WorkerConnectionStolen,
+        Connection,
+        "Handing off to idle worker %p",
+        StealingWorker);
+
+    //
+    // Move the connection to the stealing worker's partition the same way a
+    // change in the receive partition does, so that new CIDs route to it.
+    // The connection then moves workers once it's done being processed here.
+    //
+    Connection->PartitionID =
+        QuicPartitionIdCreate(
+            (uint8_t)(StealingWorker->IdealProcessor % MsQuicLib.PartitionCount));
+    QuicConnGenerateNewSourceCids(Connection, TRUE);
+    Connection->State.UpdateWorker = TRUE;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_CONNECTION*
 QuicWorkerGetNextConnection(
@@ -334,12 +659,25 @@ QuicWorkerGetNextConnection(
     if (Worker->Enabled) {
         QuicDispatchLockAcquire(&Worker->Lock);
 
-        if (QuicListIsEmpty(&Worker->Connections)) {
+        QUIC_LIST_ENTRY* Queue;
+        if (QuicListIsEmpty(&Worker->PriorityConnections)) {
+            Queue = &Worker->Connections;
+        } else if (QuicListIsEmpty(&Worker->Connections)) {
+            Queue = &Worker->PriorityConnections;
+        } else if (Worker->PriorityDrainCount < QUIC_WORKER_MAX_PRIORITY_DRAINS) {
+            Queue = &Worker->PriorityConnections;
+            Worker->PriorityDrainCount++;
+        } else {
+            Queue = &Worker->Connections; // Don't starve the other connections.
+            Worker->PriorityDrainCount = 0;
+        }
+
+        if (QuicListIsEmpty(Queue)) {
             Connection = NULL;
         } else {
             Connection =
                 QUIC_CONTAINING_RECORD(
-                    QuicListRemoveHead(&Worker->Connections), QUIC_CONNECTION, WorkerLink);
+                    QuicListRemoveHead(Queue), QUIC_CONNECTION, WorkerLink);
             QUIC_DBG_ASSERT(!Connection->WorkerProcessing);
             QUIC_DBG_ASSERT(Connection->HasQueuedWork);
             Connection->HasQueuedWork = FALSE;
@@ -385,6 +723,78 @@ QuicWorkerGetNextOperation(
     return Operation;
 }
 
+//
+// Sends all the held send contexts, with one batch per binding.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicWorkerFlushSendBatch(
+    _In_ QUIC_WORKER* Worker
+    )
+{
+    QUIC_DATAPATH_SEND_ENTRY Entries[QUIC_MAX_WORKER_SEND_BATCH];
+
+    QuicTraceLogVerbose(
+        WorkerFlushSendBatch,
+        "[wrkr][%p] Sending %u batched send contexts",
+        Worker,
+        Worker->SendBatchCount);
+
+    for (uint32_t i = 0; i < Worker->SendBatchCount; ++i) {
+        QUIC_BINDING* Binding = Worker->SendBatch[i].Binding;
+        if (Binding == NULL) {
+            continue; // Already sent with an earlier entry's binding.
+        }
+
+        uint32_t EntryCount = 0;
+        for (uint32_t j = i; j < Worker->SendBatchCount; ++j) {
+            QUIC_WORKER_SEND* Send = &Worker->SendBatch[j];
+            if (Send->Binding == Binding) {
+                Entries[EntryCount].LocalAddress =
+                    Send->SendFrom ? &Send->LocalAddress : NULL;
+                Entries[EntryCount].RemoteAddress = &Send->RemoteAddress;
+                Entries[EntryCount].SendContext = Send->SendContext;
+                EntryCount++;
+                Send->Binding = NULL;
+            }
+        }
+
+        (void)QuicBindingSendBatch(Binding, EntryCount, Entries);
+    }
+
+    Worker->SendBatchCount = 0;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicWorkerQueueSend(
+    _In_ QUIC_WORKER* Worker,
+    _In_ QUIC_BINDING* Binding,
+    _In_opt_ const QUIC_ADDR* LocalAddress,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
+    )
+{
+    if (!Worker->BatchingSends || Worker->ThreadID != QuicCurThreadID()) {
+        return FALSE;
+    }
+
+    if (Worker->SendBatchCount == QUIC_MAX_WORKER_SEND_BATCH) {
+        QuicWorkerFlushSendBatch(Worker);
+    }
+
+    QUIC_WORKER_SEND* Send = &Worker->SendBatch[Worker->SendBatchCount++];
+    Send->Binding = Binding;
+    Send->SendContext = SendContext;
+    Send->SendFrom = LocalAddress != NULL;
+    if (LocalAddress != NULL) {
+        Send->LocalAddress = *LocalAddress;
+    }
+    Send->RemoteAddress = *RemoteAddress;
+
+    return TRUE;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicWorkerProcessTimers(
@@ -400,8 +810,12 @@ QuicWorkerProcessTimers(
     QuicTimerWheelGetExpired(&Worker->TimerWheel, TimeNow, &ExpiredTimers);
 
     //
-    // Indicate to all the connections that have expired timers.
+    // Indicate to all the connections that have expired timers. Many of them
+    // are usually delayed ACK or keep alive timers (aligned to expire
+    // together), so the small sends for them are held, and sent together
+    // afterwards, instead of each with its own datapath send.
     //
+    Worker->BatchingSends = TRUE;
     while (!QuicListIsEmpty(&ExpiredTimers)) {
         QUIC_LIST_ENTRY* Entry = QuicListRemoveHead(&ExpiredTimers);
         Entry->Flink = NULL;
@@ -415,6 +829,50 @@ QuicWorkerProcessTimers(
         QuicSessionDetachSilo();
         Connection->WorkerThreadID = 0;
     }
+    Worker->BatchingSends = FALSE;
+
+    if (Worker->SendBatchCount != 0) {
+        QuicWorkerFlushSendBatch(Worker);
+    }
+}
+
+//
+// Records the connection's total processing time in the worker's list of
+// heaviest connections, if it's heavy enough. Called with the worker lock
+// held.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicWorkerUpdateTopConnections(
+    _In_ QUIC_WORKER* Worker,
+    _In_ uint64_t CorrelationId,
+    _In_ uint64_t ProcessingTime
+    )
+{
+    QUIC_CONNECTION_LOAD* Top = Worker->TopConnections;
+    uint32_t i = 0;
+    while (i < QUIC_WORKER_LOAD_TOP_CONNECTION_COUNT - 1 &&
+        (Top[i].ProcessingTime == 0 || Top[i].CorrelationId != CorrelationId)) {
+        ++i;
+    }
+    if (Top[i].ProcessingTime == 0 || Top[i].CorrelationId != CorrelationId) {
+        //
+        // Not in the list; replaces the lightest one, if heavier.
+        //
+        if (ProcessingTime <= Top[i].ProcessingTime) {
+            return;
+        }
+    }
+
+    Top[i].CorrelationId = CorrelationId;
+    Top[i].ProcessingTime = ProcessingTime;
+
+    while (i > 0 && Top[i - 1].ProcessingTime < Top[i].ProcessingTime) {
+        QUIC_CONNECTION_LOAD Temp = Top[i - 1];
+        Top[i - 1] = Top[i];
+        Top[i] = Temp;
+        --i;
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -432,11 +890,12 @@ QuicWorkerProcessConnection(
     QuicSessionAttachSilo(Connection->Session);
 
     if (Connection->Stats.Schedule.LastQueueTime != 0) {
-        QuicWorkerUpdateQueueDelay(
-            Worker,
+        uint32_t TimeInQueueUs =
             QuicTimeDiff32(
                 Connection->Stats.Schedule.LastQueueTime,
-                QuicTimeUs32()));
+                QuicTimeUs32());
+        QuicWorkerUpdateQueueDelay(Worker, TimeInQueueUs);
+        QuicHistogramAddSample(Connection->Histograms.QueueDelay, TimeInQueueUs);
     }
 
     //
@@ -473,17 +932,34 @@ QuicWorkerProcessConnection(
         (void)QuicConnIndicateEvent(Connection, &Event);
     }
 
+    if (Worker->StealingWorker != NULL) {
+        //
+        // An idle worker asked for some of this worker's load. If handed off,
+        // the connection's operations are left for the new worker to process.
+        //
+        QuicWorkerTryHandOffConnection(Worker, Connection);
+    }
+
     //
     // Process some operations.
     //
+    uint64_t StartTime = QuicTimeUs64();
     BOOLEAN StillHasWorkToDo =
         QuicConnDrainOperations(Connection) | Connection->State.UpdateWorker;
     Connection->WorkerThreadID = 0;
+    uint64_t TimeNow = QuicTimeUs64();
+    uint64_t ProcessingTime = TimeNow - StartTime;
+    Connection->Stats.Processing.TotalTime += ProcessingTime;
 
     //
     // Determine whether the connection needs to be requeued.
     //
     QuicDispatchLockAcquire(&Worker->Lock);
+    Worker->ProcessingTime += ProcessingTime;
+    QuicWorkerUpdateTopConnections(
+        Worker,
+        Connection->Stats.CorrelationId,
+        Connection->Stats.Processing.TotalTime);
     Connection->WorkerProcessing = FALSE;
     Connection->HasQueuedWork |= StillHasWorkToDo;
 
@@ -491,7 +967,7 @@ QuicWorkerProcessConnection(
     if (!Connection->State.UpdateWorker) {
         if (Connection->HasQueuedWork) {
             Connection->Stats.Schedule.LastQueueTime = QuicTimeUs32();
-            QuicListInsertTail(&Worker->Connections, &Connection->WorkerLink);
+            QuicWorkerInsertConnection(Worker, Connection);
             QuicTraceEvent(
                 ConnScheduleState,
                 "[conn][%p] Scheduling: %u",
@@ -510,6 +986,11 @@ QuicWorkerProcessConnection(
 
     QuicSessionDetachSilo();
 
+    if (MsQuicLib.StatsRegion != NULL) {
+        QuicStatsRegionUpdateConnection(Connection);
+        QuicStatsRegionUpdateWorker(Worker, TimeNow);
+    }
+
     if (DoneWithConnection) {
         if (Connection->State.UpdateWorker) {
             //
@@ -538,6 +1019,101 @@ QuicWorkerProcessConnection(
     }
 }
 
+//
+// Spins for up to the busy poll budget, or the given delay if smaller, waiting
+// for new work to be queued. Returns TRUE if there is new work to process.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicWorkerBusyPoll(
+    _In_ QUIC_WORKER* Worker,
+    _In_ uint64_t MaxDelayUs
+    )
+{
+    const uint64_t Budget =
+        MaxDelayUs < Worker->BusyPollUs ? MaxDelayUs : Worker->BusyPollUs;
+    const uint64_t StartTime = QuicTimeUs64();
+    do {
+        if (!QuicWorkerIsIdle(Worker) || !Worker->Enabled) {
+            return TRUE;
+        }
+        YieldProcessor();
+    } while (QuicTimeDiff64(StartTime, QuicTimeUs64()) < Budget);
+    return FALSE;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Function_class_(QUIC_DATAPATH_POLL_CALLBACK)
+uint64_t
+QuicWorkerPoll(
+    _In_ void* Context
+    )
+{
+    QUIC_WORKER* Worker = (QUIC_WORKER*)Context;
+    Worker->ThreadID = QuicCurThreadID();
+
+    for (uint32_t i = 0; i < QUIC_MAX_WORKER_POLL_ITERATIONS && Worker->Enabled; ++i) {
+
+        QUIC_CONNECTION* Connection = QuicWorkerGetNextConnection(Worker);
+        if (Connection != NULL) {
+            QuicWorkerProcessConnection(Worker, Connection);
+        }
+
+        QUIC_OPERATION* Operation = QuicWorkerGetNextOperation(Worker);
+        if (Operation != NULL) {
+            QuicBindingProcessStatelessOperation(
+                Operation->Type,
+                Operation->STATELESS.Context);
+            QuicOperationFree(Worker, Operation);
+        }
+
+        uint64_t Delay = QuicTimerWheelGetWaitTime(&Worker->TimerWheel); // us
+        if (Delay == 0) {
+            QuicWorkerProcessTimers(Worker);
+
+        } else if (Connection == NULL && Operation == NULL) {
+            //
+            // Nothing left to do until new work is queued or the next timer
+            // expires.
+            //
+            QuicWorkerRequestSteal(Worker);
+            QuicWorkerResetQueueDelay(Worker);
+            return Delay;
+        }
+    }
+
+    //
+    // Still more work to do, but let the datapath check for receives first.
+    //
+    return 0;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+uint64_t
+QUIC_API
+MsQuicExecutionPoll(
+    _In_ _Pre_defensive_ QUIC_EXECUTION_CONTEXT* ExecutionContext
+    )
+{
+    QUIC_WORKER* Worker = (QUIC_WORKER*)ExecutionContext;
+    if (Worker == NULL || !Worker->External) {
+        return UINT64_MAX;
+    }
+
+    //
+    // Fails once the registration started closing the worker.
+    //
+    if (!QuicRundownAcquire(&Worker->ExternalRundown)) {
+        return UINT64_MAX;
+    }
+
+    uint64_t Delay = QuicWorkerPoll(Worker);
+
+    QuicRundownRelease(&Worker->ExternalRundown);
+
+    return Delay;
+}
+
 QUIC_THREAD_CALLBACK(QuicWorkerThread, Context)
 {
     QUIC_WORKER* Worker = (QUIC_WORKER*)Context;
@@ -582,7 +1158,7 @@ QUIC_THREAD_CALLBACK(QuicWorkerThread, Context)
         // next timer if we have run out of connections and stateless operations
         // to process.
         //
-        uint64_t Delay = QuicTimerWheelGetWaitTime(&Worker->TimerWheel);
+        uint64_t Delay = QuicTimerWheelGetWaitTime(&Worker->TimerWheel); // us
 
         if (Delay == 0) {
             //
@@ -604,6 +1180,37 @@ QUIC_THREAD_CALLBACK(QuicWorkerThread, Context)
             // process at the moment, we need to wait for the ready event or the
             // next timer to expire.
             //
+            QuicWorkerRequestSteal(Worker);
+            if (Worker->BusyPollUs != 0 &&
+                (QuicWorkerBusyPoll(Worker, Delay) || Delay <= Worker->BusyPollUs)) {
+                //
+                // Either new work showed up or the next timer expired while
+                // spinning.
+                //
+                continue;
+            }
+            if (QuicTimerWheelIsNextTimerPrecise(&Worker->TimerWheel)) {
+                //
+                // The platform wait only has millisecond granularity, so only
+                // wait for the whole milliseconds and then poll for the rest.
+                //
+                Delay = US_TO_MS(Delay);
+                if (Delay == 0) {
+                    //
+                    // Less than a millisecond left. Poll the ready event, so
+                    // that new work is still picked up, until the timer
+                    // expires.
+                    //
+                    (void)QuicEventWaitWithTimeout(Worker->Ready, 0);
+                    continue;
+                }
+            } else {
+                //
+                // Add one to the delay to ensure we don't end up expiring our
+                // wait too early.
+                //
+                Delay = US_TO_MS(Delay) + 1;
+            }
             if (Delay >= (uint64_t)UINT32_MAX) {
                 Delay = UINT32_MAX - 1; // Max has special meaning for most platforms.
             }
@@ -621,6 +1228,10 @@ QUIC_THREAD_CALLBACK(QuicWorkerThread, Context)
             //
             // No active timers running, so just wait for the ready event.
             //
+            QuicWorkerRequestSteal(Worker);
+            if (Worker->BusyPollUs != 0 && QuicWorkerBusyPoll(Worker, UINT64_MAX)) {
+                continue;
+            }
             QuicWorkerToggleActivityState(Worker, UINT32_MAX);
             QuicWorkerResetQueueDelay(Worker);
             QuicEventWaitForever(Worker->Ready);
@@ -628,40 +1239,7 @@ QUIC_THREAD_CALLBACK(QuicWorkerThread, Context)
         }
     }
 
-    //
-    // Because the session layer only waits for the session rundown to complete,
-    // and because the connection releases the session rundown on handle close,
-    // not free, it's possible that the worker thread still had the connection
-    // in it's list by the time clean up started. So it needs to release any
-    // remaining references on connections.
-    //
-    while (!QuicListIsEmpty(&Worker->Connections)) {
-        QUIC_CONNECTION* Connection =
-            QUIC_CONTAINING_RECORD(
-                QuicListRemoveHead(&Worker->Connections), QUIC_CONNECTION, WorkerLink);
-        if (!Connection->State.ExternalOwner) {
-            //
-            // If there is no external owner, shut down the connection so that
-            // it's not leaked.
-            //
-            QuicTraceLogConnVerbose(
-                AbandonOnLibShutdown,
-                Connection,
-                "Abandoning on shutdown");
-            QuicConnOnShutdownComplete(Connection);
-        }
-        QuicConnRelease(Connection, QUIC_CONN_REF_WORKER);
-    }
-
-    while (!QuicListIsEmpty(&Worker->Operations)) {
-        QUIC_OPERATION* Operation =
-            QUIC_CONTAINING_RECORD(
-                QuicListRemoveHead(&Worker->Operations), QUIC_OPERATION, Link);
-#if DEBUG
-        Operation->Link.Flink = NULL;
-#endif
-        QuicOperationFree(Worker, Operation);
-    }
+    QuicWorkerCleanupQueues(Worker);
 
     QuicTraceEvent(
         WorkerStop,
@@ -675,7 +1253,11 @@ QUIC_STATUS
 QuicWorkerPoolInitialize(
     _In_opt_ const void* Owner,
     _In_ uint16_t ThreadFlags,
+    _In_ uint32_t BusyPollUs,
+    _In_ BOOLEAN RunToCompletion,
+    _In_ BOOLEAN External,
     _In_ uint8_t WorkerCount,
+    _In_reads_opt_(WorkerCount) const uint16_t* Processors,
     _Out_ QUIC_WORKER_POOL** NewWorkerPool
     )
 {
@@ -699,17 +1281,30 @@ QuicWorkerPoolInitialize(
 
     //
     // Create the set of worker threads and soft affinitize them in order to
-    // attempt to spread the connection workload out over multiple processors.
+    // attempt to spread the connection workload out over multiple processors:
+    // the given ones, or else the first WorkerCount processors.
     //
 
     for (uint8_t i = 0; i < WorkerCount; i++) {
-        Status = QuicWorkerInitialize(Owner, ThreadFlags, i, &WorkerPool->Workers[i]);
+        WorkerPool->Workers[i].Pool = WorkerPool;
+        WorkerPool->Workers[i].BusyPollUs = BusyPollUs;
+        WorkerPool->Workers[i].RunToCompletion = RunToCompletion;
+        WorkerPool->Workers[i].External = External;
+        Status =
+            QuicWorkerInitialize(
+                Owner,
+                ThreadFlags,
+                Processors != NULL ? (uint8_t)Processors[i] : i,
+                &WorkerPool->Workers[i]);
         if (QUIC_FAILED(Status)) {
             for (uint8_t j = 0; j < i; j++) {
                 QuicWorkerUninitialize(&WorkerPool->Workers[j]);
             }
             goto Error;
         }
+        if (WorkerPool->Workers[i].NumaNode != WorkerPool->Workers[0].NumaNode) {
+            WorkerPool->MultipleNumaNodes = TRUE;
+        }
     }
 
     *NewWorkerPool = WorkerPool;
@@ -5,6 +5,27 @@
 
 --*/
 
+//
+// A send context held by a worker, to be sent in a batch with others.
+//
+typedef struct QUIC_WORKER_SEND {
+
+    QUIC_BINDING* Binding;
+
+    QUIC_DATAPATH_SEND_CONTEXT* SendContext;
+
+    //
+    // Indicates LocalAddress should be sent from, instead of the binding's
+    // local address.
+    //
+    BOOLEAN SendFrom;
+
+    QUIC_ADDR LocalAddress;
+
+    QUIC_ADDR RemoteAddress;
+
+} QUIC_WORKER_SEND;
+
 //
 // A worker thread for draining queued operations on a connection.
 //
@@ -21,9 +42,10 @@ typedef struct QUIC_CACHEALIGN QUIC_WORKER {
     BOOLEAN IsActive;
 
     //
-    // The worker's ideal processor.
+    // The worker's ideal processor, and its NUMA node.
     //
     uint8_t IdealProcessor;
+    uint16_t NumaNode;
 
     //
     // The identifier of the platform thread.
@@ -35,6 +57,53 @@ typedef struct QUIC_CACHEALIGN QUIC_WORKER {
     //
     uint32_t AverageQueueDelay;
 
+    //
+    // The number of server connections assigned to the worker that haven't
+    // confirmed their handshake yet.
+    //
+    long HandshakeCount;
+
+    //
+    // The number of received datagrams queued on the worker's connections.
+    //
+    int64_t ReceiveQueueCount;
+
+    //
+    // TRUE if the worker has no thread of its own, and instead runs on the
+    // datapath thread of the same processor.
+    //
+    BOOLEAN RunToCompletion;
+
+    //
+    // TRUE if the worker has no thread of its own, and instead the app runs it
+    // from its own threads, with ExecutionPoll.
+    //
+    BOOLEAN External;
+
+    //
+    // For external workers, the app's callback to wake the thread polling the
+    // worker, and the rundown of ExecutionPoll calls in progress.
+    //
+    QUIC_EXECUTION_WAKE_FN* ExternalWake;
+    void* ExternalWakeContext;
+    QUIC_RUNDOWN_REF ExternalRundown;
+
+    //
+    // The time (in us) to spin, polling for new work, before sleeping.
+    //
+    uint32_t BusyPollUs;
+
+    //
+    // The pool the worker belongs to.
+    //
+    struct QUIC_WORKER_POOL* Pool;
+
+    //
+    // An idle worker, from the same pool, that is waiting to take over one of
+    // this worker's queued connections. Protected by Lock.
+    //
+    struct QUIC_WORKER* StealingWorker;
+
     //
     // Timers for the worker's connections.
     //
@@ -56,9 +125,14 @@ typedef struct QUIC_CACHEALIGN QUIC_WORKER {
     QUIC_DISPATCH_LOCK Lock;
 
     //
-    // Queue of connections with operations to be processed.
+    // Queues of connections with operations to be processed. The latency
+    // sensitive ones are queued in PriorityConnections, which is drained
+    // first; but at most QUIC_WORKER_MAX_PRIORITY_DRAINS in a row while
+    // others are waiting, so they aren't starved.
     //
     QUIC_LIST_ENTRY Connections;
+    QUIC_LIST_ENTRY PriorityConnections;
+    uint8_t PriorityDrainCount;
 
     //
     // Queue of stateless operations to be processed.
@@ -67,12 +141,69 @@ typedef struct QUIC_CACHEALIGN QUIC_WORKER {
     uint32_t OperationCount;
     uint64_t DroppedOperationCount;
 
+    //
+    // Time (in us) spent processing connections, and the connections that
+    // took the most of it, heaviest first. Protected by Lock.
+    //
+    uint64_t ProcessingTime;
+    QUIC_CONNECTION_LOAD TopConnections[QUIC_WORKER_LOAD_TOP_CONNECTION_COUNT];
+
+    //
+    // The worker's slot in the shared memory stats region, if it has one, and
+    // the time (in us) it was last updated.
+    //
+    QUIC_STATS_REGION_WORKER* StatsSlot;
+    uint64_t StatsUpdateTime;
+
     QUIC_POOL StreamPool; // QUIC_STREAM
     QUIC_POOL SendRequestPool; // QUIC_SEND_REQUEST
     QUIC_SENT_PACKET_POOL SentPacketPool; // QUIC_SENT_PACKET_METADATA
     QUIC_POOL ApiContextPool; // QUIC_API_CONTEXT
     QUIC_POOL StatelessContextPool; // QUIC_STATELESS_CONTEXT
     QUIC_POOL OperPool; // QUIC_OPERATION
+    QUIC_POOL RecvChunkPool; // Stream receive buffer chunks
+
+    //
+    // Freed streams, still holding their receive buffer chunks (from
+    // RecvChunkPool) and range allocations, to be reset and reused by new
+    // streams on the worker's connections. See QuicStreamInitialize.
+    //
+    QUIC_DISPATCH_LOCK StreamCacheLock;
+    QUIC_SINGLE_LIST_ENTRY StreamCache;
+    uint32_t StreamCacheDepth;
+
+    //
+    // Random bytes for connection IDs and other per-packet randomness, so the
+    // worker doesn't go to the platform RNG each time.
+    //
+    QUIC_RANDOM_STREAM Random;
+
+    //
+    // The worker's random offset (in us) of the keep alive timer buckets. See
+    // QUIC_KEEP_ALIVE_BUCKET_US.
+    //
+    uint32_t KeepAliveBucketOffsetUs;
+
+    //
+    // The transport parameters last encoded into a server resumption ticket
+    // on this worker, and their encoding. Reused as long as the connections'
+    // ticket parameters (which mostly come from the session settings) don't
+    // change.
+    //
+    QUIC_TRANSPORT_PARAMETERS ResumptionTP;
+    uint8_t* ResumptionTPEncoded;
+    uint32_t ResumptionTPEncodedLength;
+
+    //
+    // TRUE while the worker processes expired timers. The small sends (ACK
+    // only or single datagram, e.g. for expired delayed ACK and keep alive
+    // timers) made in the meantime are held in SendBatch, and sent together,
+    // one batch per binding, afterwards.
+    //
+    BOOLEAN BatchingSends;
+
+    uint32_t SendBatchCount;
+    QUIC_WORKER_SEND SendBatch[QUIC_MAX_WORKER_SEND_BATCH];
 
 } QUIC_WORKER;
 
@@ -91,6 +222,11 @@ typedef struct QUIC_WORKER_POOL {
     //
     uint8_t LastWorker;
 
+    //
+    // TRUE if the workers are spread over more than one NUMA node.
+    //
+    BOOLEAN MultipleNumaNodes;
+
     //
     // All the workers.
     //
@@ -113,6 +249,45 @@ QuicWorkerIsOverloaded(
     return Worker->AverageQueueDelay > MsQuicLib.Settings.MaxWorkerQueueDelayUs;
 }
 
+//
+// Returns TRUE if the worker can take on another server handshake. Part of the
+// handshakes are reserved for resuming clients.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+QuicWorkerCanAdmitHandshake(
+    _In_ QUIC_WORKER* Worker,
+    _In_ BOOLEAN IsResumption
+    )
+{
+    uint32_t Limit = MsQuicLib.Settings.MaxWorkerHandshakes;
+    if (!IsResumption) {
+        Limit -= Limit / QUIC_WORKER_HANDSHAKES_RESUMPTION_SHARE;
+    }
+    return (uint32_t)Worker->HandshakeCount < Limit;
+}
+
+//
+// Counts the new server connection's handshake against its worker, until
+// QuicWorkerReleaseHandshake is called.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicWorkerAddHandshake(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
+//
+// Called when the connection's handshake is confirmed, or the connection is
+// cleaned up.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicWorkerReleaseHandshake(
+    _In_ QUIC_CONNECTION* Connection
+    );
+
 //
 // Initializes the worker pool.
 //
@@ -121,7 +296,11 @@ QUIC_STATUS
 QuicWorkerPoolInitialize(
     _In_opt_ const void* Owner,
     _In_ uint16_t ThreadFlags,
+    _In_ uint32_t BusyPollUs,
+    _In_ BOOLEAN RunToCompletion,
+    _In_ BOOLEAN External,
     _In_ uint8_t WorkerCount,
+    _In_reads_opt_(WorkerCount) const uint16_t* Processors,
     _Out_ QUIC_WORKER_POOL** WorkerPool
     );
 
@@ -183,3 +362,18 @@ QuicWorkerQueueOperation(
     _In_ QUIC_WORKER* Worker,
     _In_ QUIC_OPERATION* Operation
     );
+
+//
+// Holds an ACK only send context to be sent with the rest of the worker's
+// batch. Returns FALSE if the worker isn't currently batching sends, in which
+// case the caller must send it itself.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicWorkerQueueSend(
+    _In_ QUIC_WORKER* Worker,
+    _In_ QUIC_BINDING* Binding,
+    _In_opt_ const QUIC_ADDR* LocalAddress,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
+    );
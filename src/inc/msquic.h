@@ -73,16 +73,28 @@ typedef _In_range_(0, QUIC_UINT62_MAX) uint64_t QUIC_UINT62;
 //
 #define QUIC_MAX_RESUMPTION_APP_DATA_LENGTH     1000
 
+//
+// A resumption ticket encryption key is 44 bytes, and a session may have up to
+// 16 of them configured at a time (see QUIC_PARAM_SESSION_TLS_TICKET_KEYS).
+//
+#define QUIC_TICKET_KEY_LENGTH          44
+#define QUIC_MAX_TICKET_KEY_COUNT       16
+
 typedef enum QUIC_EXECUTION_PROFILE {
     QUIC_EXECUTION_PROFILE_LOW_LATENCY,         // Default
     QUIC_EXECUTION_PROFILE_TYPE_MAX_THROUGHPUT,
     QUIC_EXECUTION_PROFILE_TYPE_SCAVENGER,
-    QUIC_EXECUTION_PROFILE_TYPE_REAL_TIME
+    QUIC_EXECUTION_PROFILE_TYPE_REAL_TIME,
+    QUIC_EXECUTION_PROFILE_TYPE_BUSY_POLL,
+    QUIC_EXECUTION_PROFILE_TYPE_RUN_TO_COMPLETION,
+    QUIC_EXECUTION_PROFILE_TYPE_EXTERNAL        // App runs the workers (ExecutionPoll)
 } QUIC_EXECUTION_PROFILE;
 
 typedef enum QUIC_LOAD_BALANCING_MODE {
     QUIC_LOAD_BALANCING_DISABLED,               // Default
-    QUIC_LOAD_BALANCING_SERVER_ID_IP            // Encodes IP address in Server ID
+    QUIC_LOAD_BALANCING_SERVER_ID_IP,           // Encodes IP address in Server ID
+    QUIC_LOAD_BALANCING_SERVER_ID_STREAM_CIPHER,// QUIC-LB stream cipher CID (QUIC_LOAD_BALANCING_CONFIG)
+    QUIC_LOAD_BALANCING_SERVER_ID_BLOCK_CIPHER  // QUIC-LB block cipher CID (QUIC_LOAD_BALANCING_CONFIG)
 } QUIC_LOAD_BALANCING_MODE;
 
 typedef enum QUIC_SEC_CONFIG_FLAGS {
@@ -91,7 +103,8 @@ typedef enum QUIC_SEC_CONFIG_FLAGS {
     QUIC_SEC_CONFIG_FLAG_CERTIFICATE_HASH_STORE = 0x00000002,
     QUIC_SEC_CONFIG_FLAG_CERTIFICATE_CONTEXT    = 0x00000004,
     QUIC_SEC_CONFIG_FLAG_CERTIFICATE_FILE       = 0x00000008,
-    QUIC_SEC_CONFIG_FLAG_ENABLE_OCSP            = 0x00000010
+    QUIC_SEC_CONFIG_FLAG_ENABLE_OCSP            = 0x00000010,
+    QUIC_SEC_CONFIG_FLAG_ENABLE_ASYNC_PRIVATE_KEY = 0x00000020
 } QUIC_SEC_CONFIG_FLAGS;
 
 DEFINE_ENUM_FLAG_OPERATORS(QUIC_SEC_CONFIG_FLAGS);
@@ -105,14 +118,16 @@ DEFINE_ENUM_FLAG_OPERATORS(QUIC_CERTIFICATE_HASH_STORE_FLAGS);
 
 typedef enum QUIC_CONNECTION_SHUTDOWN_FLAGS {
     QUIC_CONNECTION_SHUTDOWN_FLAG_NONE      = 0x0000,
-    QUIC_CONNECTION_SHUTDOWN_FLAG_SILENT    = 0x0001    // Don't send the close frame over the network.
+    QUIC_CONNECTION_SHUTDOWN_FLAG_SILENT    = 0x0001,   // Don't send the close frame over the network.
+    QUIC_CONNECTION_SHUTDOWN_FLAG_NO_DRAIN  = 0x0002    // Send the close frame, but don't wait for the peer's response.
 } QUIC_CONNECTION_SHUTDOWN_FLAGS;
 
 DEFINE_ENUM_FLAG_OPERATORS(QUIC_CONNECTION_SHUTDOWN_FLAGS);
 
 typedef enum QUIC_SEND_RESUMPTION_FLAGS {
     QUIC_SEND_RESUMPTION_FLAG_NONE          = 0x0000,
-    QUIC_SEND_RESUMPTION_FLAG_FINAL         = 0x0001    // Free TLS state after sending this ticket.
+    QUIC_SEND_RESUMPTION_FLAG_FINAL         = 0x0001,   // Free TLS state after sending this ticket.
+    QUIC_SEND_RESUMPTION_FLAG_DEFER         = 0x0002    // Send the ticket once the connection is idle.
 } QUIC_SEND_RESUMPTION_FLAGS;
 
 DEFINE_ENUM_FLAG_OPERATORS(QUIC_SEND_RESUMPTION_FLAGS);
@@ -123,10 +138,18 @@ typedef enum QUIC_STREAM_SCHEDULING_SCHEME {
     QUIC_STREAM_SCHEDULING_SCHEME_COUNT                     // The number of stream scheduling schemes.
 } QUIC_STREAM_SCHEDULING_SCHEME;
 
+typedef enum QUIC_CONGESTION_CONTROL_ALGORITHM {
+    QUIC_CONGESTION_CONTROL_ALGORITHM_CUBIC     = 0x0000,   // CUBIC (RFC8312). (Default)
+    QUIC_CONGESTION_CONTROL_ALGORITHM_BBR       = 0x0001,   // BBRv2.
+    QUIC_CONGESTION_CONTROL_ALGORITHM_LEDBAT    = 0x0002,   // LEDBAT++. (Default for the scavenger profile)
+    QUIC_CONGESTION_CONTROL_ALGORITHM_COUNT                 // The number of congestion control algorithms.
+} QUIC_CONGESTION_CONTROL_ALGORITHM;
+
 typedef enum QUIC_STREAM_OPEN_FLAGS {
     QUIC_STREAM_OPEN_FLAG_NONE              = 0x0000,
     QUIC_STREAM_OPEN_FLAG_UNIDIRECTIONAL    = 0x0001,   // Indicates the stream is unidirectional.
-    QUIC_STREAM_OPEN_FLAG_0_RTT             = 0x0002    // The stream was opened via a 0-RTT packet.
+    QUIC_STREAM_OPEN_FLAG_0_RTT             = 0x0002    // The stream was opened via a 0-RTT packet. On StreamOpen (client),
+                                                        // all the stream's data is allowed in 0-RTT.
 } QUIC_STREAM_OPEN_FLAGS;
 
 DEFINE_ENUM_FLAG_OPERATORS(QUIC_STREAM_OPEN_FLAGS);
@@ -163,7 +186,9 @@ typedef enum QUIC_SEND_FLAGS {
     QUIC_SEND_FLAG_NONE                     = 0x0000,
     QUIC_SEND_FLAG_ALLOW_0_RTT              = 0x0001,   // Allows the use of encrypting with 0-RTT key.
     QUIC_SEND_FLAG_FIN                      = 0x0002,   // Indicates the request is the one last sent on the stream.
-    QUIC_SEND_FLAG_DGRAM_PRIORITY           = 0x0004    // Indicates the datagram is higher priority than others.
+    QUIC_SEND_FLAG_DGRAM_PRIORITY           = 0x0004,   // Indicates the datagram is higher priority than others.
+    QUIC_SEND_FLAG_DELAY_SEND               = 0x0008,   // Allows the stream data to be held back briefly, to be coalesced with more.
+    QUIC_SEND_FLAG_DEADLINE                 = 0x0010    // Stream data is dropped instead of retransmitted after QUIC_PARAM_STREAM_SEND_DEADLINE.
 } QUIC_SEND_FLAGS;
 
 DEFINE_ENUM_FLAG_OPERATORS(QUIC_SEND_FLAGS);
@@ -267,6 +292,7 @@ typedef struct QUIC_STATISTICS {
         uint64_t TotalStreamBytes;      // Sum of stream payloads
         uint32_t CongestionCount;       // Number of congestion events
         uint32_t PersistentCongestionCount; // Number of persistent congestion events
+        uint32_t SpuriousCongestionCount; // Number of congestion events undone (all losses were spurious)
     } Send;
     struct {
         uint64_t TotalPackets;          // QUIC packets; could be coalesced into fewer UDP datagrams.
@@ -276,12 +302,265 @@ typedef struct QUIC_STATISTICS {
         uint64_t TotalBytes;            // Sum of UDP payloads
         uint64_t TotalStreamBytes;      // Sum of stream payloads
         uint64_t DecryptionFailures;    // Count of packet decryption failures.
+        uint64_t QueueFullDrops;        // Dropped because the connection's receive queue was full.
+        uint64_t QueueOldEpochDrops;    // Long header dropped under load after the handshake was confirmed.
+        uint64_t QueueWorkerLimitDrops; // Dropped because the worker's receive queues were full.
+        uint64_t FlushCount;            // Number of batches the received datagrams were processed in.
+        uint32_t MaxFlushDatagrams;     // Largest batch, in UDP datagrams.
     } Recv;
     struct {
         uint32_t KeyUpdateCount;
     } Misc;
+    struct {                            // Cumulative time sending was blocked, in microseconds
+        uint64_t CongestionControl;
+        uint64_t Pacing;
+        uint64_t AmplificationProt;     // Before the peer's address is validated
+        uint64_t ConnFlowControl;       // Peer's MAX_DATA
+        uint64_t StreamFlowControl;     // Peer's MAX_STREAM_DATA, summed across streams
+        uint64_t App;                   // Nothing left to send
+    } Blocked;
+    struct {                            // Time spent on the worker thread, in microseconds
+        uint64_t TotalTime;             // Processing the connection's operations
+        uint64_t CryptoTime;            // In TLS, out of TotalTime
+        uint64_t CallbackTime;          // In app callbacks, out of TotalTime
+    } Processing;
 } QUIC_STATISTICS;
 
+//
+// A worker's processing load, returned (one per worker) by
+// QUIC_PARAM_REGISTRATION_WORKER_LOAD. The registration's total is the sum of
+// its workers'.
+//
+#define QUIC_WORKER_LOAD_TOP_CONNECTION_COUNT 4
+
+typedef struct QUIC_CONNECTION_LOAD {
+    uint64_t CorrelationId;             // As in QUIC_STATISTICS
+    uint64_t ProcessingTime;            // In microseconds
+} QUIC_CONNECTION_LOAD;
+
+typedef struct QUIC_WORKER_LOAD {
+    uint16_t IdealProcessor;
+    uint64_t ProcessingTime;            // Processing connections, in microseconds
+    QUIC_CONNECTION_LOAD TopConnections[QUIC_WORKER_LOAD_TOP_CONNECTION_COUNT]; // Heaviest first, including closed connections; unused entries are zero
+} QUIC_WORKER_LOAD;
+
+typedef struct QUIC_STREAM_STATISTICS {
+    struct {
+        uint64_t TotalBytes;            // Sum of stream payloads, including retransmissions
+        uint64_t RetransmittedBytes;    // Sum of stream payloads declared lost
+        uint64_t FlowControlBlockedTime; // Time blocked by the peer's MAX_STREAM_DATA, in microseconds
+        uint64_t FullAckTime;           // First send to the FIN being acknowledged, in microseconds (0 until then)
+    } Send;
+    struct {
+        uint64_t TotalBytes;            // Sum of stream payloads, including duplicates
+        uint64_t EventCount;            // QUIC_STREAM_EVENT_RECEIVE events indicated
+        uint32_t BufferMaxLength;       // Largest the receive buffer was allocated, in bytes
+    } Recv;
+} QUIC_STREAM_STATISTICS;
+
+typedef struct QUIC_STREAM_SEND_DEADLINE {
+    uint32_t DeadlineMs;                // Lifetime of QUIC_SEND_FLAG_DEADLINE data, or 0 to disable
+    QUIC_UINT62 ErrorCode;              // Sent in RESET_STREAM once lost data is past its deadline
+} QUIC_STREAM_SEND_DEADLINE;
+
+//
+// A log-bucketed histogram of durations, in microseconds. Bucket 0 counts
+// samples of zero and bucket i counts samples in [2^(i-1), 2^i). The last
+// bucket also counts all larger samples.
+//
+#define QUIC_HISTOGRAM_BUCKET_COUNT     24
+
+typedef struct QUIC_HISTOGRAM {
+    uint64_t Buckets[QUIC_HISTOGRAM_BUCKET_COUNT];
+} QUIC_HISTOGRAM;
+
+typedef struct QUIC_STATISTICS_HISTOGRAMS {
+    QUIC_HISTOGRAM Rtt;                 // RTT samples
+    QUIC_HISTOGRAM AckDelay;            // ACK delays reported by the peer, with RTT samples
+    QUIC_HISTOGRAM QueueDelay;          // Time queued before a worker processed the connection
+    QUIC_HISTOGRAM CallbackTime;        // Time spent in app connection and stream callbacks
+    QUIC_HISTOGRAM SendBatchSize;       // Datagrams built per send flush (a count, not a duration)
+} QUIC_STATISTICS_HISTOGRAMS;
+
+//
+// A worker of a registration opened with QUIC_EXECUTION_PROFILE_TYPE_EXTERNAL,
+// which the app runs from its own threads by calling ExecutionPoll.
+//
+typedef struct QUIC_EXECUTION_CONTEXT QUIC_EXECUTION_CONTEXT;
+
+//
+// Called (from any thread) when new work is queued on an execution context,
+// to wake the app thread that polls it, e.g. by signaling an eventfd watched
+// by its epoll loop, or posting to its IOCP.
+//
+typedef
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+(QUIC_API QUIC_EXECUTION_WAKE_FN)(
+    _In_opt_ void* WakeContext
+    );
+
+typedef struct QUIC_EXECUTION_CONTEXT_CONFIG {
+    QUIC_EXECUTION_CONTEXT* ExecutionContext;
+    uint16_t IdealProcessor;
+    QUIC_EXECUTION_WAKE_FN* Wake;
+    void* WakeContext;
+} QUIC_EXECUTION_CONTEXT_CONFIG;
+
+//
+// Library wide counters, returned by QUIC_PARAM_GLOBAL_PERF_COUNTERS as an
+// array of int64_t indexed by this enum. Counters that track a current value
+// (e.g. active connections) can go up and down; the rest only ever increase.
+//
+typedef enum QUIC_PERFORMANCE_COUNTERS {
+    QUIC_PERF_COUNTER_CONN_CREATED,          // Total connections ever allocated
+    QUIC_PERF_COUNTER_CONN_HANDSHAKE_FAIL,   // Total connections shut down before the handshake completed
+    QUIC_PERF_COUNTER_CONN_ACTIVE,           // Connections currently allocated
+    QUIC_PERF_COUNTER_CONN_CONNECTED,        // Connections currently in the connected state
+    QUIC_PERF_COUNTER_PKTS_DROPPED_BINDING,  // Total packets dropped before reaching a connection
+    QUIC_PERF_COUNTER_PKTS_DROPPED_CONN,     // Total packets dropped by a connection
+    QUIC_PERF_COUNTER_PKTS_DECRYPTION_FAIL,  // Total packets with decryption failures
+    QUIC_PERF_COUNTER_UDP_RECV,              // Total UDP datagrams received
+    QUIC_PERF_COUNTER_UDP_SEND,              // Total UDP datagrams sent
+    QUIC_PERF_COUNTER_UDP_RECV_BYTES,        // Total UDP payload bytes received
+    QUIC_PERF_COUNTER_UDP_SEND_BYTES,        // Total UDP payload bytes sent
+    QUIC_PERF_COUNTER_RETRY_SENT,            // Total stateless retries sent
+    QUIC_PERF_COUNTER_CONN_OPER_QUEUED,      // Total connection operations queued
+    QUIC_PERF_COUNTER_CONN_OPER_QUEUE_DEPTH, // Connection operations currently queued
+    QUIC_PERF_COUNTER_WORKER_OVERLOADED,     // Total new work refused due to an overloaded worker
+    QUIC_PERF_COUNTER_LOCK_CONTENDED,        // Total dispatch lock acquisitions that had to wait (Linux only)
+    QUIC_PERF_COUNTER_LOCK_PARKED,           // Total contended dispatch lock acquisitions that had to block (Linux only)
+    QUIC_PERF_COUNTER_UDP_SEND_BATCHES,      // Total send flushes that built UDP datagrams
+    QUIC_PERF_COUNTER_MAX
+} QUIC_PERFORMANCE_COUNTERS;
+
+//
+// The library wide memory used for buffering, returned by
+// QUIC_PARAM_GLOBAL_MEMORY_USAGE. Once the memory in use (handshakes, send
+// buffers and receive buffers) reaches the budget (set by
+// QUIC_PARAM_GLOBAL_MEMORY_BUDGET_PERCENT), ideal send buffer sizes and stream
+// receive windows shrink and new streams are refused until it drops again.
+//
+typedef struct QUIC_MEMORY_USAGE {
+    uint64_t Budget;                    // Bytes
+    uint64_t Handshakes;                // Estimated memory of connections in the handshake
+    uint64_t SendBuffers;               // App data copied into send buffers
+    uint64_t RecvWindows;               // Sum of the streams' receive windows
+    uint64_t RecvBuffers;               // Memory actually buffering received stream data
+} QUIC_MEMORY_USAGE;
+
+//
+// The layout of the shared memory stats region created by
+// QUIC_PARAM_GLOBAL_STATS_REGION, which another process can map read-only and
+// scrape without calling into the library. The library updates it with plain
+// (relaxed) stores and no locks, so a reader sees each field atomically, but
+// not a consistent snapshot across fields. A slot's InUse is zero while it's
+// free; a slot reused between two reads is detected by its CorrelationId (or
+// IdealProcessor) changing.
+//
+#define QUIC_STATS_REGION_MAGIC                 0x53544151  // "QATS"
+#define QUIC_STATS_REGION_VERSION               1
+#define QUIC_STATS_REGION_WORKER_COUNT          256
+#define QUIC_STATS_REGION_CONNECTION_COUNT      4096
+
+typedef struct QUIC_STATS_REGION_WORKER {
+    int64_t InUse;
+    uint16_t IdealProcessor;
+    uint32_t AverageQueueDelay;         // In microseconds
+    uint64_t ProcessingTime;            // Processing connections, in microseconds
+    int64_t ReceiveQueueCount;          // Datagrams queued on the worker's connections
+    uint64_t UpdateTime;                // In microseconds, of the last update
+} QUIC_STATS_REGION_WORKER;
+
+typedef struct QUIC_STATS_REGION_CONNECTION {
+    int64_t InUse;
+    uint64_t CorrelationId;             // As in QUIC_STATISTICS
+    uint32_t Rtt;                       // In microseconds
+    uint32_t CongestionWindow;          // In bytes
+    uint64_t SendTotalBytes;
+    uint64_t SendTotalPackets;
+    uint64_t SendSuspectedLostPackets;
+    uint64_t RecvTotalBytes;
+    uint64_t RecvTotalPackets;
+    uint64_t RecvDroppedPackets;
+    uint64_t ProcessingTime;            // In microseconds
+} QUIC_STATS_REGION_CONNECTION;
+
+typedef struct QUIC_STATS_REGION {
+    uint32_t Magic;                     // QUIC_STATS_REGION_MAGIC
+    uint32_t Version;                   // QUIC_STATS_REGION_VERSION
+    uint32_t Size;                      // sizeof(QUIC_STATS_REGION)
+    uint32_t PerfCounterCount;          // QUIC_PERF_COUNTER_MAX
+    uint64_t UpdateTime;                // In microseconds, of the last PerfCounters update
+    int64_t PerfCounters[QUIC_PERF_COUNTER_MAX];
+    QUIC_STATS_REGION_WORKER Workers[QUIC_STATS_REGION_WORKER_COUNT];
+    QUIC_STATS_REGION_CONNECTION Connections[QUIC_STATS_REGION_CONNECTION_COUNT];
+} QUIC_STATS_REGION;
+
+#define QUIC_TRACE_SAMPLE_RATE_MAX                  1000000
+#define QUIC_TRACE_SAMPLING_MAX_CID_PREFIX_LENGTH   20
+
+//
+// Selects which new connections write verbose logs and packet level events,
+// returned and set by QUIC_PARAM_GLOBAL_TRACE_SAMPLING. A connection is traced
+// if it is randomly sampled, or if it matches either filter. The decision is
+// made once, when the connection is created. By default, all connections are
+// traced.
+//
+typedef struct QUIC_TRACE_SAMPLING {
+    uint32_t SampleRate;        // Connections traced per QUIC_TRACE_SAMPLE_RATE_MAX
+    QUIC_ADDR RemoteAddress;    // Server only. Unspecified family disables. Port 0 matches any port.
+    uint8_t CidPrefixLength;    // Server only. Client's initial destination CID prefix. 0 disables.
+    uint8_t CidPrefix[QUIC_TRACE_SAMPLING_MAX_CID_PREFIX_LENGTH];
+} QUIC_TRACE_SAMPLING;
+
+#define QUIC_LOAD_BALANCING_MAX_CONFIG_ROTATION     2
+#define QUIC_LOAD_BALANCING_MAX_SERVER_ID_LENGTH    8
+#define QUIC_LOAD_BALANCING_MIN_NONCE_LENGTH        8
+#define QUIC_LOAD_BALANCING_KEY_LENGTH              16
+
+//
+// The QUIC-LB (draft-ietf-quic-load-balancers) configuration shared with the
+// load balancer, used by the QUIC_LOAD_BALANCING_SERVER_ID_STREAM_CIPHER and
+// QUIC_LOAD_BALANCING_SERVER_ID_BLOCK_CIPHER modes. Set by
+// QUIC_PARAM_GLOBAL_LOAD_BALANCING_CONFIG, before the library is in use.
+//
+// The stream cipher CID is the first octet, NonceLength random octets and the
+// server ID XOR'ed with the AES-ECB encryption of the (zero padded) nonce,
+// followed by octets for the server's own use. 1 + NonceLength +
+// ServerIdLength must not exceed 12.
+//
+// The block cipher CID is the first octet and the AES-ECB encryption of the
+// server ID followed by octets for the server's own use, 17 octets in total.
+//
+// The high two bits of the first octet are ConfigRotation.
+//
+typedef struct QUIC_LOAD_BALANCING_CONFIG {
+    uint8_t ConfigRotation;     // 0 to QUIC_LOAD_BALANCING_MAX_CONFIG_ROTATION
+    uint8_t ServerIdLength;     // 1 to QUIC_LOAD_BALANCING_MAX_SERVER_ID_LENGTH
+    uint8_t NonceLength;        // Stream cipher only. At least QUIC_LOAD_BALANCING_MIN_NONCE_LENGTH.
+    uint8_t ServerId[QUIC_LOAD_BALANCING_MAX_SERVER_ID_LENGTH];
+    uint8_t Key[QUIC_LOAD_BALANCING_KEY_LENGTH]; // AES-128
+} QUIC_LOAD_BALANCING_CONFIG;
+
+#define QUIC_STATELESS_SECRET_LENGTH                32
+
+//
+// The secrets behind the library's stateless responses, returned and set by
+// QUIC_PARAM_GLOBAL_STATELESS_SECRETS. A process taking over a server's
+// traffic (e.g. on restart) sets the old process' secrets, so that it accepts
+// the Retry tokens the old process issued, and generates the same stateless
+// reset tokens. The reset secret only applies to bindings created afterwards.
+// The Retry secrets expire on the given wall clock times (milliseconds since
+// the epoch) and are then replaced by random ones as usual.
+//
+typedef struct QUIC_STATELESS_SECRETS {
+    uint8_t ResetSecret[QUIC_STATELESS_SECRET_LENGTH];
+    uint8_t CurrentRetrySecret; // Index of the current (newest) Retry secret
+    uint8_t RetrySecrets[2][QUIC_STATELESS_SECRET_LENGTH];
+    int64_t RetrySecretsExpiration[2];
+} QUIC_STATELESS_SECRETS;
+
 typedef struct QUIC_LISTENER_STATISTICS {
 
     uint64_t TotalAcceptedConnections;
@@ -294,6 +573,17 @@ typedef struct QUIC_LISTENER_STATISTICS {
     } Binding;
 } QUIC_LISTENER_STATISTICS;
 
+typedef struct QUIC_SESSION_STATISTICS {
+
+    //
+    // Server handshakes where the client offered a resumption ticket, which
+    // was either accepted or not (i.e. a full handshake was done instead).
+    //
+    uint64_t TotalResumptionsAccepted;
+    uint64_t TotalResumptionsRejected;
+
+} QUIC_SESSION_STATISTICS;
+
 //
 // Functions for associating application contexts with QUIC handles.
 //
@@ -352,11 +642,24 @@ typedef enum QUIC_SERVER_RESUMPTION_LEVEL {
 #define QUIC_PARAM_GLOBAL_RETRY_MEMORY_PERCENT          0   // uint16_t
 #define QUIC_PARAM_GLOBAL_SUPPORTED_VERSIONS            1   // uint32_t[] - network byte order
 #define QUIC_PARAM_GLOBAL_LOAD_BALACING_MODE            2   // uint16_t - QUIC_LOAD_BALANCING_MODE
+#define QUIC_PARAM_GLOBAL_PERF_COUNTERS                 3   // int64_t[] - Array size is QUIC_PERF_COUNTER_MAX
+#define QUIC_PARAM_GLOBAL_FLIGHT_RECORDER_DUMP          4   // No value - Set only
+#define QUIC_PARAM_GLOBAL_TRACE_SAMPLING                5   // QUIC_TRACE_SAMPLING
+#define QUIC_PARAM_GLOBAL_LOAD_BALANCING_CONFIG         6   // QUIC_LOAD_BALANCING_CONFIG
+#define QUIC_PARAM_GLOBAL_MEMORY_BUDGET_PERCENT         7   // uint16_t
+#define QUIC_PARAM_GLOBAL_MEMORY_USAGE                  8   // QUIC_MEMORY_USAGE - Get only
+#define QUIC_PARAM_GLOBAL_LARGE_PAGE_BUFFERS            9   // uint8_t (BOOLEAN) - Linux only
+#define QUIC_PARAM_GLOBAL_STATELESS_SECRETS             10  // QUIC_STATELESS_SECRETS
+#define QUIC_PARAM_GLOBAL_STATS_REGION                  11  // char[] - Shared memory name; set only, once; not in kernel mode
 
 //
 // Parameters for QUIC_PARAM_LEVEL_REGISTRATION.
 //
 #define QUIC_PARAM_REGISTRATION_CID_PREFIX              0   // uint8_t[]
+#define QUIC_PARAM_REGISTRATION_STATISTICS_HISTOGRAMS   1   // QUIC_STATISTICS_HISTOGRAMS - Closed connections only
+#define QUIC_PARAM_REGISTRATION_EXECUTION_CONTEXTS      2   // QUIC_EXECUTION_CONTEXT_CONFIG[]
+#define QUIC_PARAM_REGISTRATION_WORKER_LOAD             3   // QUIC_WORKER_LOAD[]
+#define QUIC_PARAM_REGISTRATION_PROCESSORS              4   // uint16_t[] - Set before opening any session
 
 //
 // Parameters for QUIC_PARAM_LEVEL_SESSION.
@@ -370,12 +673,19 @@ typedef enum QUIC_SERVER_RESUMPTION_LEVEL {
 #define QUIC_PARAM_SESSION_MIGRATION_ENABLED            6   // uint8_t (BOOLEAN)
 #define QUIC_PARAM_SESSION_DATAGRAM_RECEIVE_ENABLED     7   // uint8_t (BOOLEAN)
 #define QUIC_PARAM_SESSION_SERVER_RESUMPTION_LEVEL      8   // QUIC_SERVER_RESUMPTION_LEVEL
+#define QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM 9   // uint16_t - QUIC_CONGESTION_CONTROL_ALGORITHM
+#define QUIC_PARAM_SESSION_TLS_TICKET_KEYS              10  // uint8_t[44 * N] - Current key first, then previous keys
+#define QUIC_PARAM_SESSION_STATS                        11  // QUIC_SESSION_STATISTICS
+#define QUIC_PARAM_SESSION_PEER_STREAM_COUNT_MAX        12  // uint16_t - 0 disables auto-tuning
+#define QUIC_PARAM_SESSION_PATH_METRICS_CACHE_ENABLED   13  // uint8_t (BOOLEAN)
+#define QUIC_PARAM_SESSION_INTEGRITY_ONLY_ENABLED       14  // uint8_t (BOOLEAN)
 
 //
 // Parameters for QUIC_PARAM_LEVEL_LISTENER.
 //
 #define QUIC_PARAM_LISTENER_LOCAL_ADDRESS               0   // QUIC_ADDR
 #define QUIC_PARAM_LISTENER_STATS                       1   // QUIC_LISTENER_STATISTICS
+#define QUIC_PARAM_LISTENER_CONNECTION_CONFIG           2   // QUIC_LISTENER_CONNECTION_CONFIG
 
 //
 // Parameters for QUIC_PARAM_LEVEL_CONNECTION.
@@ -403,6 +713,16 @@ typedef enum QUIC_SERVER_RESUMPTION_LEVEL {
 #define QUIC_PARAM_CONN_STREAM_SCHEDULING_SCHEME        20  // QUIC_STREAM_SCHEDULING_SCHEME
 #define QUIC_PARAM_CONN_DATAGRAM_RECEIVE_ENABLED        21  // uint8_t (BOOLEAN)
 #define QUIC_PARAM_CONN_DATAGRAM_SEND_ENABLED           22  // uint8_t (BOOLEAN)
+#define QUIC_PARAM_CONN_CONGESTION_CONTROL_ALGORITHM    23  // uint16_t - QUIC_CONGESTION_CONTROL_ALGORITHM
+#define QUIC_PARAM_CONN_STATISTICS_HISTOGRAMS           24  // QUIC_STATISTICS_HISTOGRAMS
+#define QUIC_PARAM_CONN_DATAGRAM_RECEIVE_LENDING        25  // uint8_t (BOOLEAN)
+#define QUIC_PARAM_CONN_MULTIPATH_ENABLED               26  // uint8_t (BOOLEAN)
+#define QUIC_PARAM_CONN_ADD_PATH                        27  // QUIC_ADDR - Set only
+#define QUIC_PARAM_CONN_LATENCY_SENSITIVE               28  // uint8_t (BOOLEAN)
+#define QUIC_PARAM_CONN_ARENA_ENABLED                   29  // uint8_t (BOOLEAN)
+#define QUIC_PARAM_CONN_SEND_CORK_US                    30  // uint32_t - microseconds
+#define QUIC_PARAM_CONN_RECEIVE_BATCH_ENABLED           31  // uint8_t (BOOLEAN)
+#define QUIC_PARAM_CONN_DEDICATED_SOCKET                32  // uint8_t (BOOLEAN) - Server only
 
 #ifdef WIN32 // Windows certificate validation ignore flags.
 #define QUIC_CERTIFICATE_FLAG_IGNORE_REVOCATION                 0x00000080
@@ -430,6 +750,11 @@ typedef struct QUIC_SCHANNEL_CONTEXT_ATTRIBUTE_W {
 #define QUIC_PARAM_STREAM_ID                            0   // QUIC_UINT62
 #define QUIC_PARAM_STREAM_0RTT_LENGTH                   1   // uint64_t
 #define QUIC_PARAM_STREAM_IDEAL_SEND_BUFFER_SIZE        2   // uint64_t - bytes
+#define QUIC_PARAM_STREAM_PRIORITY                      3   // uint16_t - 0 (low) to 0xFFFF (high) - 0x7FFF (default)
+#define QUIC_PARAM_STREAM_RECEIVE_MESSAGE_FRAMING       4   // uint8_t (BOOLEAN)
+#define QUIC_PARAM_STREAM_STATISTICS                    5   // QUIC_STREAM_STATISTICS
+#define QUIC_PARAM_STREAM_SEND_DEADLINE                 6   // QUIC_STREAM_SEND_DEADLINE
+#define QUIC_PARAM_STREAM_SEND_COMPLETE_BATCHING        7   // uint8_t (BOOLEAN)
 
 typedef
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -669,9 +994,25 @@ typedef enum QUIC_CONNECTION_EVENT_TYPE {
     QUIC_CONNECTION_EVENT_DATAGRAM_RECEIVED                 = 11,
     QUIC_CONNECTION_EVENT_DATAGRAM_SEND_STATE_CHANGED       = 12,
     QUIC_CONNECTION_EVENT_RESUMED                           = 13,   // Server-only; provides resumption data, if any.
-    QUIC_CONNECTION_EVENT_RESUMPTION_TICKET_RECEIVED        = 14    // Client-only; provides ticket to persist, if any.
+    QUIC_CONNECTION_EVENT_RESUMPTION_TICKET_RECEIVED        = 14,   // Client-only; provides ticket to persist, if any.
+    QUIC_CONNECTION_EVENT_RECEIVE_BATCH                     = 15    // Only with QUIC_PARAM_CONN_RECEIVE_BATCH_ENABLED.
 } QUIC_CONNECTION_EVENT_TYPE;
 
+//
+// One stream's data in a QUIC_CONNECTION_EVENT_RECEIVE_BATCH. The fields are
+// the same as in QUIC_STREAM_EVENT_RECEIVE.
+//
+typedef struct QUIC_RECEIVE_BATCH_ENTRY {
+    /* in */    HQUIC Stream;
+    /* in */    uint64_t AbsoluteOffset;
+    /* inout */ uint64_t TotalBufferLength;
+    _Field_size_(BufferCount)
+    /* in */    const QUIC_BUFFER* Buffers;
+    _Field_range_(1, UINT32_MAX)
+    /* in */    uint32_t BufferCount;
+    /* in */    QUIC_RECEIVE_FLAGS Flags;
+} QUIC_RECEIVE_BATCH_ENTRY;
+
 typedef struct QUIC_CONNECTION_EVENT {
     QUIC_CONNECTION_EVENT_TYPE Type;
     union {
@@ -712,6 +1053,11 @@ typedef struct QUIC_CONNECTION_EVENT {
             uint16_t MaxSendLength;
         } DATAGRAM_STATE_CHANGED;
         struct {
+            //
+            // With QUIC_PARAM_CONN_DATAGRAM_RECEIVE_LENDING enabled, the app
+            // may return QUIC_STATUS_PENDING to keep the buffer, and must
+            // then give it back with DatagramReceiveComplete.
+            //
             const QUIC_BUFFER* Buffer;
             QUIC_RECEIVE_FLAGS Flags;
         } DATAGRAM_RECEIVED;
@@ -727,6 +1073,17 @@ typedef struct QUIC_CONNECTION_EVENT {
             uint16_t ResumptionTicketLength;
             const uint8_t* ResumptionTicket;
         } RESUMPTION_TICKET_RECEIVED;
+        struct {
+            //
+            // The receives always complete when the callback returns, with
+            // each entry's TotalBufferLength (or the length passed to
+            // StreamReceiveComplete from within the callback).
+            //
+            _Field_range_(1, UINT32_MAX)
+            uint32_t StreamCount;
+            _Field_size_(StreamCount)
+            QUIC_RECEIVE_BATCH_ENTRY* Streams;
+        } RECEIVE_BATCH;
     };
 } QUIC_CONNECTION_EVENT;
 
@@ -742,6 +1099,19 @@ QUIC_STATUS
 
 typedef QUIC_CONNECTION_CALLBACK *QUIC_CONNECTION_CALLBACK_HANDLER;
 
+//
+// Set on a listener (before it's started) with
+// QUIC_PARAM_LISTENER_CONNECTION_CONFIG. New connections are then accepted
+// with this security config, callback handler and context, without the
+// NEW_CONNECTION listener event. The app sees each connection first in its
+// connection callback. A NULL Handler (and SecurityConfig) clears it.
+//
+typedef struct QUIC_LISTENER_CONNECTION_CONFIG {
+    QUIC_SEC_CONFIG* SecurityConfig;
+    QUIC_CONNECTION_CALLBACK_HANDLER Handler;
+    void* Context;
+} QUIC_LISTENER_CONNECTION_CONFIG;
+
 //
 // Opens a new connection.
 //
@@ -825,7 +1195,8 @@ typedef enum QUIC_STREAM_EVENT_TYPE {
     QUIC_STREAM_EVENT_PEER_RECEIVE_ABORTED      = 5,
     QUIC_STREAM_EVENT_SEND_SHUTDOWN_COMPLETE    = 6,
     QUIC_STREAM_EVENT_SHUTDOWN_COMPLETE         = 7,
-    QUIC_STREAM_EVENT_IDEAL_SEND_BUFFER_SIZE    = 8
+    QUIC_STREAM_EVENT_IDEAL_SEND_BUFFER_SIZE    = 8,
+    QUIC_STREAM_EVENT_SEND_COMPLETE_BATCH       = 9     // Only with QUIC_PARAM_STREAM_SEND_COMPLETE_BATCHING.
 } QUIC_STREAM_EVENT_TYPE;
 
 typedef struct QUIC_STREAM_EVENT {
@@ -848,6 +1219,13 @@ typedef struct QUIC_STREAM_EVENT {
             BOOLEAN Canceled;
             void* ClientContext;
         } SEND_COMPLETE;
+        struct {
+            _Field_size_(ClientContextCount)
+            void* const* ClientContexts;    // In the order the sends were queued.
+            uint32_t ClientContextCount;
+            uint64_t TotalLength;           // Bytes of all the completed sends.
+            uint64_t AckedOffset;           // The stream's data is acknowledged up to here.
+        } SEND_COMPLETE_BATCH;
         struct {
             QUIC_UINT62 ErrorCode;
         } PEER_SEND_ABORTED;
@@ -890,6 +1268,43 @@ QUIC_STATUS
         HQUIC* Stream
     );
 
+//
+// Opens a stream on a client connection, to the given server, owned by the
+// session's connection pool. An existing connection to the server is reused
+// if there is one. Otherwise a new one is opened and started (using any
+// resumption state cached for the server) and kept alive in the pool until
+// it's shut down by the peer or the transport, or the session is closed. The
+// pooled connections don't accept peer initiated streams.
+//
+typedef
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+(QUIC_API * QUIC_POOL_STREAM_OPEN_FN)(
+    _In_ _Pre_defensive_ HQUIC Session,
+    _In_z_ const char* ServerName,
+    _In_ uint16_t ServerPort, // Host byte order
+    _In_ QUIC_STREAM_OPEN_FLAGS Flags,
+    _In_ _Pre_defensive_ QUIC_STREAM_CALLBACK_HANDLER Handler,
+    _In_opt_ void* Context,
+    _Outptr_ _At_(*Stream, __drv_allocatesMem(Mem)) _Pre_defensive_
+        HQUIC* Stream
+    );
+
+//
+// Runs an execution context of a registration opened with
+// QUIC_EXECUTION_PROFILE_TYPE_EXTERNAL: processes the work queued on it, up
+// to a limit, and fires its expired timers. Returns the time (in us) until
+// the context needs to be polled again, if not woken before then: 0 if it
+// still has queued work, or UINT64_MAX if it has no timers set. A context
+// must only be polled by one thread at a time.
+//
+typedef
+_IRQL_requires_max_(PASSIVE_LEVEL)
+uint64_t
+(QUIC_API * QUIC_EXECUTION_POLL_FN)(
+    _In_ _Pre_defensive_ QUIC_EXECUTION_CONTEXT* ExecutionContext
+    );
+
 //
 // Closes a stream handle.
 //
@@ -962,6 +1377,38 @@ QUIC_STATUS
     _In_ BOOLEAN IsEnabled
     );
 
+//
+// A single send in a QUIC_STREAM_SEND_BATCH_FN call. The first five fields are
+// the same as the StreamSend parameters.
+//
+typedef struct QUIC_STREAM_SEND_BATCH_ENTRY {
+    HQUIC Stream;
+    const QUIC_BUFFER* Buffers;
+    uint32_t BufferCount;
+    QUIC_SEND_FLAGS Flags;
+    void* ClientSendContext;
+    QUIC_STATUS Status;         // Out. QUIC_STATUS_PENDING if queued.
+} QUIC_STREAM_SEND_BATCH_ENTRY;
+
+//
+// Queues app data to be sent on any number of streams of a single connection.
+// It's the same as calling StreamSend for each entry, but the sends are all
+// processed (and flushed) by a single operation on the connection. All the
+// entries are validated first; if any are invalid, nothing is queued. The
+// function returns QUIC_STATUS_PENDING if every entry was queued. Otherwise
+// it returns the status of the first entry that wasn't, and each entry's
+// Status indicates whether it was queued.
+//
+typedef
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+(QUIC_API * QUIC_STREAM_SEND_BATCH_FN)(
+    _In_ _Pre_defensive_ HQUIC Connection,
+    _Inout_updates_(EntryCount) _Pre_defensive_
+        QUIC_STREAM_SEND_BATCH_ENTRY* Entries,
+    _In_ uint32_t EntryCount
+    );
+
 //
 // Datagrams
 //
@@ -982,6 +1429,52 @@ QUIC_STATUS
     _In_opt_ void* ClientSendContext
     );
 
+//
+// Returns a datagram buffer the app kept (by returning QUIC_STATUS_PENDING)
+// from a QUIC_CONNECTION_EVENT_DATAGRAM_RECEIVED event. Buffer must be the
+// pointer indicated in the event. Every kept buffer must be returned before
+// the connection is closed.
+//
+typedef
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+(QUIC_API * QUIC_DATAGRAM_RECEIVE_COMPLETE_FN)(
+    _In_ _Pre_defensive_ HQUIC Connection,
+    _In_ _Pre_defensive_ const QUIC_BUFFER* Buffer
+    );
+
+//
+// A single datagram in a QUIC_DATAGRAM_SEND_BATCH_FN call. Buffers,
+// BufferCount, Flags and ClientSendContext are the same as the DatagramSend
+// parameters. If LifetimeMs is not zero, the datagram is canceled instead of
+// being sent if it is still queued after that many milliseconds.
+//
+typedef struct QUIC_DATAGRAM_SEND_BATCH_ENTRY {
+    const QUIC_BUFFER* Buffers;
+    uint32_t BufferCount;
+    QUIC_SEND_FLAGS Flags;
+    uint32_t LifetimeMs;
+    void* ClientSendContext;
+    QUIC_STATUS Status;         // Out. QUIC_STATUS_PENDING if queued.
+} QUIC_DATAGRAM_SEND_BATCH_ENTRY;
+
+//
+// Queues any number of unreliable datagrams to be sent on the connection. It's
+// the same as calling DatagramSend for each entry, except for the optional
+// lifetime. The function returns QUIC_STATUS_PENDING if every entry was
+// queued. Otherwise it returns the status of the first entry that wasn't, and
+// each entry's Status indicates whether it was queued.
+//
+typedef
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+(QUIC_API * QUIC_DATAGRAM_SEND_BATCH_FN)(
+    _In_ _Pre_defensive_ HQUIC Connection,
+    _Inout_updates_(EntryCount) _Pre_defensive_
+        QUIC_DATAGRAM_SEND_BATCH_ENTRY* Entries,
+    _In_ uint32_t EntryCount
+    );
+
 //
 // API Function Table.
 //
@@ -1025,6 +1518,14 @@ typedef struct QUIC_API_TABLE {
 
     QUIC_DATAGRAM_SEND_FN               DatagramSend;
 
+    QUIC_STREAM_SEND_BATCH_FN           StreamSendBatch;
+    QUIC_DATAGRAM_SEND_BATCH_FN         DatagramSendBatch;
+    QUIC_DATAGRAM_RECEIVE_COMPLETE_FN   DatagramReceiveComplete;
+
+    QUIC_POOL_STREAM_OPEN_FN            PoolStreamOpen;
+
+    QUIC_EXECUTION_POLL_FN              ExecutionPoll;
+
 } QUIC_API_TABLE;
 
 //
@@ -0,0 +1,708 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    A header only C++20 layer over the MsQuic API: RAII handles, move only
+    buffers for zero copy sends and receives, and awaitable connect, send,
+    receive, accept and shutdown operations.
+
+    The awaitables work with any coroutine type. A coroutine waiting on one
+    is resumed directly from the MsQuic callback that completes it, on the
+    connection's worker thread, so there is no thread hop and no queue
+    between the event and the app code. That also means:
+
+     - Code after a co_await runs inside a MsQuic callback, and must not block.
+       Calls it makes on the same connection (e.g. StreamSend) run inline.
+
+     - A stream (or connection) must not be destroyed by code resumed from
+       one of its own awaiters, except after awaiting its ShutdownComplete.
+
+     - A QuicCoReceive must be completed (or destroyed) before its stream is.
+
+--*/
+
+#pragma once
+
+#include "msquic.h"
+
+#if !defined(_MSVC_LANG) && __cplusplus < 202002L || defined(_MSVC_LANG) && _MSVC_LANG < 202002L
+#error "msquic.hpp requires C++20"
+#endif
+
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+//
+// The MsQuic function table, opened for the lifetime of the object.
+//
+class QuicCoApi {
+    const QUIC_API_TABLE* Api {nullptr};
+    QUIC_STATUS InitStatus;
+public:
+    QuicCoApi() noexcept : InitStatus(MsQuicOpen(&Api)) { }
+    ~QuicCoApi() noexcept { if (Api != nullptr) { MsQuicClose(Api); } }
+    QuicCoApi(const QuicCoApi&) = delete;
+    QuicCoApi& operator=(const QuicCoApi&) = delete;
+    QUIC_STATUS GetInitStatus() const noexcept { return InitStatus; }
+    bool IsValid() const noexcept { return QUIC_SUCCEEDED(InitStatus); }
+    const QUIC_API_TABLE* operator->() const noexcept { return Api; }
+    operator const QUIC_API_TABLE* () const noexcept { return Api; }
+};
+
+//
+// A move only handle, closed with the given function of the API table.
+//
+template<auto Close>
+class QuicCoHandle {
+protected:
+    const QUIC_API_TABLE* Api {nullptr};
+    HQUIC Handle {nullptr};
+public:
+    QuicCoHandle() noexcept = default;
+    QuicCoHandle(const QUIC_API_TABLE* _Api, HQUIC _Handle) noexcept
+        : Api(_Api), Handle(_Handle) { }
+    QuicCoHandle(QuicCoHandle&& Other) noexcept
+        : Api(Other.Api), Handle(std::exchange(Other.Handle, nullptr)) { }
+    QuicCoHandle& operator=(QuicCoHandle&& Other) noexcept {
+        if (this != &Other) {
+            Reset();
+            Api = Other.Api;
+            Handle = std::exchange(Other.Handle, nullptr);
+        }
+        return *this;
+    }
+    ~QuicCoHandle() noexcept { Reset(); }
+    void Reset() noexcept {
+        if (Handle != nullptr) {
+            (Api->*Close)(std::exchange(Handle, nullptr));
+        }
+    }
+    HQUIC Release() noexcept { return std::exchange(Handle, nullptr); }
+    bool IsValid() const noexcept { return Handle != nullptr; }
+    operator HQUIC () const noexcept { return Handle; }
+};
+
+class QuicCoRegistration : public QuicCoHandle<&QUIC_API_TABLE::RegistrationClose> {
+public:
+    QUIC_STATUS
+    Open(
+        _In_ const QUIC_API_TABLE* _Api,
+        _In_opt_ const QUIC_REGISTRATION_CONFIG* Config = nullptr
+        ) noexcept {
+        Reset();
+        Api = _Api;
+        return Api->RegistrationOpen(Config, &Handle);
+    }
+};
+
+class QuicCoSession : public QuicCoHandle<&QUIC_API_TABLE::SessionClose> {
+public:
+    QUIC_STATUS
+    Open(
+        _In_ const QUIC_API_TABLE* _Api,
+        _In_ HQUIC Registration,
+        _In_reads_(AlpnCount) const QUIC_BUFFER* Alpns,
+        _In_ uint32_t AlpnCount
+        ) noexcept {
+        Reset();
+        Api = _Api;
+        return Api->SessionOpen(Registration, Alpns, AlpnCount, nullptr, &Handle);
+    }
+};
+
+//
+// A move only, heap allocated buffer. Sends take ownership of it for the
+// duration of the send, without copying, and hand it back on completion so
+// it can be reused.
+//
+class QuicCoBuffer {
+    uint8_t* Data {nullptr};
+    uint32_t Length {0};
+    uint32_t Capacity {0};
+public:
+    QuicCoBuffer() noexcept = default;
+    explicit QuicCoBuffer(uint32_t _Capacity) noexcept
+        : Data(new(std::nothrow) uint8_t[_Capacity]),
+          Capacity(Data != nullptr ? _Capacity : 0) { }
+    QuicCoBuffer(QuicCoBuffer&& Other) noexcept
+        : Data(std::exchange(Other.Data, nullptr)),
+          Length(std::exchange(Other.Length, 0)),
+          Capacity(std::exchange(Other.Capacity, 0)) { }
+    QuicCoBuffer& operator=(QuicCoBuffer&& Other) noexcept {
+        if (this != &Other) {
+            delete [] Data;
+            Data = std::exchange(Other.Data, nullptr);
+            Length = std::exchange(Other.Length, 0);
+            Capacity = std::exchange(Other.Capacity, 0);
+        }
+        return *this;
+    }
+    QuicCoBuffer(const QuicCoBuffer&) = delete;
+    QuicCoBuffer& operator=(const QuicCoBuffer&) = delete;
+    ~QuicCoBuffer() noexcept { delete [] Data; }
+    bool IsValid() const noexcept { return Data != nullptr; }
+    uint8_t* GetData() noexcept { return Data; }
+    const uint8_t* GetData() const noexcept { return Data; }
+    uint32_t GetLength() const noexcept { return Length; }
+    uint32_t GetCapacity() const noexcept { return Capacity; }
+    void SetLength(uint32_t _Length) noexcept {
+        Length = _Length <= Capacity ? _Length : Capacity;
+    }
+};
+
+struct QuicCoSendResult {
+    QUIC_STATUS Status;     // QUIC_STATUS_ABORTED if the send was canceled
+    QuicCoBuffer Buffer;    // The buffer that was sent, for reuse
+};
+
+//
+// Data received on a stream, referenced in place in MsQuic's buffers until
+// completed. Completing it (explicitly, or when destroyed) lets MsQuic
+// indicate more data. A receive with no buffers marks the end of the stream's
+// receive direction (gracefully or not).
+//
+class QuicCoReceive {
+    const QUIC_API_TABLE* Api {nullptr};
+    HQUIC Stream {nullptr}; // Set while the receive is pending.
+    const QUIC_BUFFER* Buffers {nullptr};
+    uint32_t BufferCount {0};
+    uint64_t TotalLength {0};
+    QUIC_RECEIVE_FLAGS Flags {QUIC_RECEIVE_FLAG_NONE};
+public:
+    QuicCoReceive() noexcept = default;
+    QuicCoReceive(
+        const QUIC_API_TABLE* _Api,
+        HQUIC _Stream,
+        const QUIC_BUFFER* _Buffers,
+        uint32_t _BufferCount,
+        uint64_t _TotalLength,
+        QUIC_RECEIVE_FLAGS _Flags
+        ) noexcept
+        : Api(_Api), Stream(_Stream), Buffers(_Buffers), BufferCount(_BufferCount),
+          TotalLength(_TotalLength), Flags(_Flags) { }
+    QuicCoReceive(QuicCoReceive&& Other) noexcept
+        : Api(Other.Api), Stream(std::exchange(Other.Stream, nullptr)),
+          Buffers(std::exchange(Other.Buffers, nullptr)),
+          BufferCount(std::exchange(Other.BufferCount, 0)),
+          TotalLength(std::exchange(Other.TotalLength, 0)),
+          Flags(std::exchange(Other.Flags, QUIC_RECEIVE_FLAG_NONE)) { }
+    QuicCoReceive& operator=(QuicCoReceive&& Other) noexcept {
+        if (this != &Other) {
+            Complete();
+            Api = Other.Api;
+            Stream = std::exchange(Other.Stream, nullptr);
+            Buffers = std::exchange(Other.Buffers, nullptr);
+            BufferCount = std::exchange(Other.BufferCount, 0);
+            TotalLength = std::exchange(Other.TotalLength, 0);
+            Flags = std::exchange(Other.Flags, QUIC_RECEIVE_FLAG_NONE);
+        }
+        return *this;
+    }
+    QuicCoReceive(const QuicCoReceive&) = delete;
+    QuicCoReceive& operator=(const QuicCoReceive&) = delete;
+    ~QuicCoReceive() noexcept { Complete(); }
+
+    bool IsEnd() const noexcept { return Stream == nullptr && Buffers == nullptr; }
+    bool IsFin() const noexcept { return (Flags & QUIC_RECEIVE_FLAG_FIN) != 0; }
+    const QUIC_BUFFER* GetBuffers() const noexcept { return Buffers; }
+    uint32_t GetBufferCount() const noexcept { return BufferCount; }
+    uint64_t GetLength() const noexcept { return TotalLength; }
+
+    //
+    // Consumes the first Length bytes. The rest is indicated again by the
+    // next receive.
+    //
+    void Complete(uint64_t Length) noexcept {
+        if (Stream != nullptr) {
+            Api->StreamReceiveComplete(std::exchange(Stream, nullptr), Length);
+        }
+    }
+    void Complete() noexcept { Complete(TotalLength); }
+};
+
+class QuicCoStream {
+    friend class QuicCoConnection;
+
+    const QUIC_API_TABLE* Api;
+    HQUIC Handle {nullptr};
+
+    std::mutex Lock;
+
+    //
+    // The receive indicated by MsQuic, and not yet handed to the app.
+    //
+    bool RecvIndicated {false};
+    const QUIC_BUFFER* RecvBuffers {nullptr};
+    uint32_t RecvBufferCount {0};
+    uint64_t RecvLength {0};
+    QUIC_RECEIVE_FLAGS RecvFlags {QUIC_RECEIVE_FLAG_NONE};
+
+    bool RecvShutdown {false};
+    bool ShutdownCompleted {false};
+    std::coroutine_handle<> RecvWaiter;
+    std::coroutine_handle<> ShutdownWaiter;
+
+    //
+    // Wakes the coroutine, if any, taken from the given waiter slot. Must be
+    // the last thing a callback does with the stream, as the coroutine may
+    // destroy it.
+    //
+    static QUIC_STATUS Resume(std::coroutine_handle<> Waiter) noexcept {
+        if (Waiter) {
+            Waiter.resume();
+        }
+        return QUIC_STATUS_SUCCESS;
+    }
+
+    _Function_class_(QUIC_STREAM_CALLBACK)
+    static QUIC_STATUS
+    QUIC_API
+    Callback(
+        _In_ HQUIC,
+        _In_opt_ void* Context,
+        _Inout_ QUIC_STREAM_EVENT* Event
+        ) noexcept {
+        auto Stream = (QuicCoStream*)Context;
+        std::coroutine_handle<> Waiter;
+
+        switch (Event->Type) {
+        case QUIC_STREAM_EVENT_RECEIVE: {
+            {
+                std::lock_guard<std::mutex> Guard(Stream->Lock);
+                Stream->RecvIndicated = true;
+                Stream->RecvBuffers = Event->RECEIVE.Buffers;
+                Stream->RecvBufferCount = Event->RECEIVE.BufferCount;
+                Stream->RecvLength = Event->RECEIVE.TotalBufferLength;
+                Stream->RecvFlags = Event->RECEIVE.Flags;
+                Waiter = std::exchange(Stream->RecvWaiter, nullptr);
+            }
+            Resume(Waiter);
+            return QUIC_STATUS_PENDING;
+        }
+        case QUIC_STREAM_EVENT_SEND_COMPLETE:
+            return SendAwaiter::Complete(Event);
+
+        case QUIC_STREAM_EVENT_PEER_SEND_SHUTDOWN:
+        case QUIC_STREAM_EVENT_PEER_SEND_ABORTED: {
+            std::lock_guard<std::mutex> Guard(Stream->Lock);
+            Stream->RecvShutdown = true;
+            Waiter = std::exchange(Stream->RecvWaiter, nullptr);
+            break;
+        }
+        case QUIC_STREAM_EVENT_SHUTDOWN_COMPLETE: {
+            std::lock_guard<std::mutex> Guard(Stream->Lock);
+            Stream->RecvShutdown = true;
+            Stream->ShutdownCompleted = true;
+            //
+            // At most one of them can be waiting: the coroutine is suspended
+            // on one awaiter at a time.
+            //
+            Waiter = std::exchange(Stream->RecvWaiter, nullptr);
+            if (!Waiter) {
+                Waiter = std::exchange(Stream->ShutdownWaiter, nullptr);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        return Resume(Waiter);
+    }
+
+    void Attach(HQUIC _Handle) noexcept {
+        Handle = _Handle;
+        Api->SetCallbackHandler(Handle, (void*)Callback, this);
+    }
+
+public:
+    explicit QuicCoStream(const QUIC_API_TABLE* _Api) noexcept : Api(_Api) { }
+    QuicCoStream(const QuicCoStream&) = delete;
+    QuicCoStream& operator=(const QuicCoStream&) = delete;
+    ~QuicCoStream() noexcept {
+        if (Handle != nullptr) {
+            Api->StreamClose(Handle);
+        }
+    }
+
+    bool IsValid() const noexcept { return Handle != nullptr; }
+    operator HQUIC () const noexcept { return Handle; }
+
+    QUIC_STATUS
+    Open(
+        _In_ HQUIC Connection,
+        _In_ QUIC_STREAM_OPEN_FLAGS Flags = QUIC_STREAM_OPEN_FLAG_NONE
+        ) noexcept {
+        return Api->StreamOpen(Connection, Flags, Callback, this, &Handle);
+    }
+
+    //
+    // Sends queued before the peer is told about the stream (without
+    // QUIC_STREAM_START_FLAG_IMMEDIATE) are sent along with the first data.
+    //
+    QUIC_STATUS
+    Start(
+        _In_ QUIC_STREAM_START_FLAGS Flags = QUIC_STREAM_START_FLAG_NONE
+        ) noexcept {
+        return Api->StreamStart(Handle, Flags);
+    }
+
+    QUIC_STATUS
+    Shutdown(
+        _In_ QUIC_STREAM_SHUTDOWN_FLAGS Flags,
+        _In_ QUIC_UINT62 ErrorCode = 0
+        ) noexcept {
+        return Api->StreamShutdown(Handle, Flags, ErrorCode);
+    }
+
+    class SendAwaiter {
+        friend class QuicCoStream;
+        QuicCoStream& Stream;
+        QuicCoBuffer Buffer;
+        QUIC_BUFFER View;
+        QUIC_SEND_FLAGS Flags;
+        QUIC_STATUS Status {QUIC_STATUS_SUCCESS};
+        std::coroutine_handle<> Waiter;
+
+        static QUIC_STATUS Complete(QUIC_STREAM_EVENT* Event) noexcept {
+            auto Awaiter = (SendAwaiter*)Event->SEND_COMPLETE.ClientContext;
+            if (Event->SEND_COMPLETE.Canceled) {
+                Awaiter->Status = QUIC_STATUS_ABORTED;
+            }
+            return Resume(Awaiter->Waiter);
+        }
+
+    public:
+        SendAwaiter(QuicCoStream& _Stream, QuicCoBuffer&& _Buffer, QUIC_SEND_FLAGS _Flags) noexcept
+            : Stream(_Stream), Buffer(std::move(_Buffer)), View{0, nullptr}, Flags(_Flags) { }
+        SendAwaiter(const SendAwaiter&) = delete;
+        SendAwaiter& operator=(const SendAwaiter&) = delete;
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> _Waiter) noexcept {
+            Waiter = _Waiter;
+            View.Buffer = Buffer.GetData();
+            View.Length = Buffer.GetLength();
+            QUIC_STATUS SendStatus =
+                Stream.Api->StreamSend(Stream.Handle, &View, 1, Flags, this);
+            if (QUIC_FAILED(SendStatus)) {
+                Status = SendStatus; // No completion is indicated.
+                return false;
+            }
+            //
+            // The completion may already have resumed (and even destroyed)
+            // the coroutine, so the awaiter must not be touched anymore.
+            //
+            return true;
+        }
+        QuicCoSendResult await_resume() noexcept {
+            return QuicCoSendResult{Status, std::move(Buffer)};
+        }
+    };
+
+    //
+    // Sends the buffer, without copying it. Completes once the peer has
+    // acknowledged the data, or the send is canceled.
+    //
+    SendAwaiter
+    Send(
+        _In_ QuicCoBuffer&& Buffer,
+        _In_ QUIC_SEND_FLAGS Flags = QUIC_SEND_FLAG_NONE
+        ) noexcept {
+        return SendAwaiter(*this, std::move(Buffer), Flags);
+    }
+
+    class ReceiveAwaiter {
+        QuicCoStream& Stream;
+    public:
+        explicit ReceiveAwaiter(QuicCoStream& _Stream) noexcept : Stream(_Stream) { }
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> Waiter) noexcept {
+            std::lock_guard<std::mutex> Guard(Stream.Lock);
+            if (Stream.RecvIndicated || Stream.RecvShutdown) {
+                return false;
+            }
+            Stream.RecvWaiter = Waiter;
+            return true;
+        }
+        QuicCoReceive await_resume() noexcept {
+            std::lock_guard<std::mutex> Guard(Stream.Lock);
+            if (!Stream.RecvIndicated) {
+                return QuicCoReceive(); // End of the stream.
+            }
+            Stream.RecvIndicated = false;
+            return
+                QuicCoReceive(
+                    Stream.Api,
+                    Stream.Handle,
+                    Stream.RecvBuffers,
+                    Stream.RecvBufferCount,
+                    Stream.RecvLength,
+                    Stream.RecvFlags);
+        }
+    };
+
+    //
+    // Waits for the next data received on the stream. MsQuic doesn't indicate
+    // more until the previous receive is completed.
+    //
+    ReceiveAwaiter Receive() noexcept { return ReceiveAwaiter(*this); }
+
+    class ShutdownAwaiter {
+        QuicCoStream& Stream;
+    public:
+        explicit ShutdownAwaiter(QuicCoStream& _Stream) noexcept : Stream(_Stream) { }
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> Waiter) noexcept {
+            std::lock_guard<std::mutex> Guard(Stream.Lock);
+            if (Stream.ShutdownCompleted) {
+                return false;
+            }
+            Stream.ShutdownWaiter = Waiter;
+            return true;
+        }
+        void await_resume() const noexcept { }
+    };
+
+    //
+    // Waits for both directions of the stream to be shut down, after which it
+    // can be destroyed (even from the resumed coroutine).
+    //
+    ShutdownAwaiter ShutdownComplete() noexcept { return ShutdownAwaiter(*this); }
+};
+
+class QuicCoConnection {
+    const QUIC_API_TABLE* Api;
+    HQUIC Handle {nullptr};
+
+    std::mutex Lock;
+    bool Connected {false};
+    bool ShutdownCompleted {false};
+    QUIC_STATUS ConnectStatus {QUIC_STATUS_PENDING};
+    std::coroutine_handle<> ConnectWaiter;
+    std::coroutine_handle<> AcceptWaiter;
+    std::coroutine_handle<> ShutdownWaiter;
+
+    //
+    // Streams started by the peer, not yet accepted by the app.
+    //
+    std::deque<QuicCoStream*> PeerStreams;
+
+    _Function_class_(QUIC_CONNECTION_CALLBACK)
+    static QUIC_STATUS
+    QUIC_API
+    Callback(
+        _In_ HQUIC,
+        _In_opt_ void* Context,
+        _Inout_ QUIC_CONNECTION_EVENT* Event
+        ) noexcept {
+        auto Connection = (QuicCoConnection*)Context;
+        std::coroutine_handle<> Waiter;
+
+        switch (Event->Type) {
+        case QUIC_CONNECTION_EVENT_CONNECTED: {
+            std::lock_guard<std::mutex> Guard(Connection->Lock);
+            Connection->Connected = true;
+            Connection->ConnectStatus = QUIC_STATUS_SUCCESS;
+            Waiter = std::exchange(Connection->ConnectWaiter, nullptr);
+            break;
+        }
+        case QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_TRANSPORT:
+        case QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_PEER: {
+            std::lock_guard<std::mutex> Guard(Connection->Lock);
+            if (!Connection->Connected) {
+                Connection->ConnectStatus =
+                    Event->Type == QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_TRANSPORT ?
+                        Event->SHUTDOWN_INITIATED_BY_TRANSPORT.Status :
+                        QUIC_STATUS_ABORTED;
+                Waiter = std::exchange(Connection->ConnectWaiter, nullptr);
+            }
+            break;
+        }
+        case QUIC_CONNECTION_EVENT_PEER_STREAM_STARTED: {
+            auto Stream = new(std::nothrow) QuicCoStream(Connection->Api);
+            if (Stream == nullptr) {
+                return QUIC_STATUS_OUT_OF_MEMORY; // MsQuic closes the stream.
+            }
+            Stream->Attach(Event->PEER_STREAM_STARTED.Stream);
+            std::lock_guard<std::mutex> Guard(Connection->Lock);
+            Connection->PeerStreams.push_back(Stream);
+            Waiter = std::exchange(Connection->AcceptWaiter, nullptr);
+            break;
+        }
+        case QUIC_CONNECTION_EVENT_SHUTDOWN_COMPLETE: {
+            std::lock_guard<std::mutex> Guard(Connection->Lock);
+            Connection->ShutdownCompleted = true;
+            if (Connection->ConnectStatus == QUIC_STATUS_PENDING) {
+                Connection->ConnectStatus = QUIC_STATUS_ABORTED;
+            }
+            //
+            // At most one of them can be waiting: the coroutine is suspended
+            // on one awaiter at a time.
+            //
+            Waiter = std::exchange(Connection->ConnectWaiter, nullptr);
+            if (!Waiter) {
+                Waiter = std::exchange(Connection->AcceptWaiter, nullptr);
+            }
+            if (!Waiter) {
+                Waiter = std::exchange(Connection->ShutdownWaiter, nullptr);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        return QuicCoStream::Resume(Waiter);
+    }
+
+public:
+    explicit QuicCoConnection(const QUIC_API_TABLE* _Api) noexcept : Api(_Api) { }
+    QuicCoConnection(const QuicCoConnection&) = delete;
+    QuicCoConnection& operator=(const QuicCoConnection&) = delete;
+    ~QuicCoConnection() noexcept {
+        for (auto Stream : PeerStreams) {
+            delete Stream;
+        }
+        if (Handle != nullptr) {
+            Api->ConnectionClose(Handle);
+        }
+    }
+
+    bool IsValid() const noexcept { return Handle != nullptr; }
+    operator HQUIC () const noexcept { return Handle; }
+
+    //
+    // Opens a client connection.
+    //
+    QUIC_STATUS Open(_In_ HQUIC Session) noexcept {
+        return Api->ConnectionOpen(Session, Callback, this, &Handle);
+    }
+
+    //
+    // Takes over a server connection, from the listener's NEW_CONNECTION
+    // event (before it returns).
+    //
+    void Attach(_In_ HQUIC _Handle) noexcept {
+        Handle = _Handle;
+        Api->SetCallbackHandler(Handle, (void*)Callback, this);
+    }
+
+    void
+    Shutdown(
+        _In_ QUIC_CONNECTION_SHUTDOWN_FLAGS Flags,
+        _In_ QUIC_UINT62 ErrorCode = 0
+        ) noexcept {
+        Api->ConnectionShutdown(Handle, Flags, ErrorCode);
+    }
+
+    class ConnectAwaiter {
+        QuicCoConnection& Connection;
+        QUIC_ADDRESS_FAMILY Family;
+        const char* ServerName;
+        uint16_t ServerPort;
+        QUIC_STATUS StartStatus {QUIC_STATUS_SUCCESS};
+    public:
+        ConnectAwaiter(
+            QuicCoConnection& _Connection,
+            QUIC_ADDRESS_FAMILY _Family,
+            const char* _ServerName,
+            uint16_t _ServerPort
+            ) noexcept
+            : Connection(_Connection), Family(_Family), ServerName(_ServerName),
+              ServerPort(_ServerPort) { }
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> Waiter) noexcept {
+            {
+                std::lock_guard<std::mutex> Guard(Connection.Lock);
+                Connection.ConnectWaiter = Waiter;
+            }
+            QUIC_STATUS Status =
+                Connection.Api->ConnectionStart(
+                    Connection.Handle, Family, ServerName, ServerPort);
+            if (QUIC_FAILED(Status)) {
+                std::lock_guard<std::mutex> Guard(Connection.Lock);
+                Connection.ConnectWaiter = nullptr;
+                StartStatus = Status;
+                return false;
+            }
+            return true;
+        }
+        QUIC_STATUS await_resume() noexcept {
+            if (QUIC_FAILED(StartStatus)) {
+                return StartStatus;
+            }
+            std::lock_guard<std::mutex> Guard(Connection.Lock);
+            return Connection.ConnectStatus;
+        }
+    };
+
+    //
+    // Starts the (client) connection and waits for the handshake to complete.
+    //
+    ConnectAwaiter
+    Connect(
+        _In_ QUIC_ADDRESS_FAMILY Family,
+        _In_z_ const char* ServerName,
+        _In_ uint16_t ServerPort // Host byte order
+        ) noexcept {
+        return ConnectAwaiter(*this, Family, ServerName, ServerPort);
+    }
+
+    class AcceptAwaiter {
+        QuicCoConnection& Connection;
+    public:
+        explicit AcceptAwaiter(QuicCoConnection& _Connection) noexcept : Connection(_Connection) { }
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> Waiter) noexcept {
+            std::lock_guard<std::mutex> Guard(Connection.Lock);
+            if (!Connection.PeerStreams.empty() || Connection.ShutdownCompleted) {
+                return false;
+            }
+            Connection.AcceptWaiter = Waiter;
+            return true;
+        }
+        std::unique_ptr<QuicCoStream> await_resume() noexcept {
+            std::lock_guard<std::mutex> Guard(Connection.Lock);
+            if (Connection.PeerStreams.empty()) {
+                return nullptr; // The connection is shut down.
+            }
+            std::unique_ptr<QuicCoStream> Stream(Connection.PeerStreams.front());
+            Connection.PeerStreams.pop_front();
+            return Stream;
+        }
+    };
+
+    //
+    // Waits for the next stream started by the peer.
+    //
+    AcceptAwaiter AcceptStream() noexcept { return AcceptAwaiter(*this); }
+
+    class ShutdownAwaiter {
+        QuicCoConnection& Connection;
+    public:
+        explicit ShutdownAwaiter(QuicCoConnection& _Connection) noexcept : Connection(_Connection) { }
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> Waiter) noexcept {
+            std::lock_guard<std::mutex> Guard(Connection.Lock);
+            if (Connection.ShutdownCompleted) {
+                return false;
+            }
+            Connection.ShutdownWaiter = Waiter;
+            return true;
+        }
+        void await_resume() const noexcept { }
+    };
+
+    //
+    // Waits for the connection to be shut down, after which it can be
+    // destroyed (even from the resumed coroutine) once its streams are.
+    //
+    ShutdownAwaiter ShutdownComplete() noexcept { return ShutdownAwaiter(*this); }
+};
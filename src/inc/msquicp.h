@@ -65,8 +65,29 @@ typedef struct QUIC_TEST_DATAPATH_HOOKS {
 #define QUIC_TEST_DATAPATH_HOOKS_ENABLED 1
 #endif
 
+//
+// Network conditions applied to the datagrams received by each UDP binding,
+// for benchmarking congestion control and loss recovery without an external
+// network emulator. Only bindings created after the parameter is set are
+// affected. All zero (the default) disables emulation.
+//
+typedef struct QUIC_NETWORK_EMULATION {
+    uint32_t DelayUs;           // Fixed delay added to every datagram.
+    uint32_t JitterUs;          // Max random delay added on top of DelayUs.
+    uint32_t RateKbps;          // Bottleneck bandwidth. 0 means unlimited.
+    uint32_t QueueLimitBytes;   // Bottleneck buffer (with RateKbps). 0 means unlimited.
+    uint32_t LossPpm;           // Chance of a datagram starting a loss burst, in parts per million.
+    uint32_t BurstLength;       // Average length of a loss burst. 0 or 1 means independent losses.
+    uint32_t ReorderPpm;        // Chance of a datagram being held back by ReorderDelayUs.
+    uint32_t ReorderDelayUs;
+    uint32_t RandomSeed;        // Makes the loss and reordering repeatable. 0 means random.
+} QUIC_NETWORK_EMULATION;
+
+#define QUIC_NETWORK_EMULATION_PPM_MAX                  1000000
+
 #define QUIC_PARAM_GLOBAL_ENCRYPTION                    0x80000001  // uint8_t (BOOLEAN)
 #define QUIC_PARAM_GLOBAL_TEST_DATAPATH_HOOKS           0x80000002  // QUIC_TEST_DATAPATH_HOOKS*
+#define QUIC_PARAM_GLOBAL_NETWORK_EMULATION             0x80000003  // QUIC_NETWORK_EMULATION
 
 //
 // The different private parameters for QUIC_PARAM_LEVEL_SESSION.
@@ -272,6 +272,30 @@ QuicEncrypt(
         uint8_t* Buffer
     );
 
+//
+// Encrypts the concatenation of the plain text segments into Buffer with the
+// given key, so the plain text doesn't first have to be copied into Buffer. A
+// segment may already be at its final position in Buffer, in which case it is
+// encrypted in place. 'BufferLength' includes QUIC_ENCRYPTION_OVERHEAD, as with
+// QuicEncrypt.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicEncryptWithCopy(
+    _In_ QUIC_KEY* Key,
+    _In_reads_bytes_(QUIC_IV_LENGTH)
+        const uint8_t* const Iv,
+    _In_ uint16_t AuthDataLength,
+    _In_reads_bytes_opt_(AuthDataLength)
+        const uint8_t* const AuthData,
+    _In_ uint32_t SegmentCount,
+    _In_reads_(SegmentCount)
+        const QUIC_BUFFER* const Segments,
+    _In_ uint16_t BufferLength,
+    _Out_writes_bytes_(BufferLength)
+        uint8_t* Buffer
+    );
+
 //
 // Decrypts buffer with the given key. 'BufferLength' is the full encrypted
 // payload length on input. On output, the length shrinks by
@@ -291,6 +315,33 @@ QuicDecrypt(
         uint8_t* Buffer
     );
 
+//
+// A single buffer to decrypt with QuicDecryptBatch. The inputs are the same as
+// QuicDecrypt's; the result for the buffer is returned in Status.
+//
+typedef struct QUIC_DECRYPT_BATCH_ENTRY {
+    uint8_t Iv[QUIC_IV_LENGTH];
+    uint16_t AuthDataLength;
+    const uint8_t* AuthData;
+    uint16_t BufferLength;
+    uint8_t* Buffer;
+    QUIC_STATUS Status;
+} QUIC_DECRYPT_BATCH_ENTRY;
+
+//
+// Decrypts a batch of buffers (e.g. the packets of a receive batch) with the
+// same key, so that implementations may process them together. Each entry
+// succeeds or fails on its own, as if passed to QuicDecrypt.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDecryptBatch(
+    _In_ QUIC_KEY* Key,
+    _In_ uint8_t BatchSize,
+    _Inout_updates_(BatchSize)
+        QUIC_DECRYPT_BATCH_ENTRY* Entries
+    );
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicHpKeyCreate(
@@ -107,6 +107,22 @@ PacketSizeFromUdpPayloadSize(
 
 typedef struct QUIC_BUFFER QUIC_BUFFER;
 
+//
+// The explicit congestion notification (RFC 3168) codepoints, carried in the
+// two low bits of the IPv4 TOS or IPv6 traffic class field.
+//
+typedef enum QUIC_ECN_TYPE {
+    QUIC_ECN_NON_ECT = 0x0,     // Not ECN-capable transport.
+    QUIC_ECN_ECT_1   = 0x1,     // ECN-capable transport, ECT(1).
+    QUIC_ECN_ECT_0   = 0x2,     // ECN-capable transport, ECT(0).
+    QUIC_ECN_CE      = 0x3      // Congestion experienced.
+} QUIC_ECN_TYPE;
+
+//
+// Gets the ECN codepoint from the TOS or traffic class field.
+//
+#define QUIC_ECN_FROM_TOS(ToS) (QUIC_ECN_TYPE)((ToS) & 0x3)
+
 //
 // Declaration for the DataPath context structures.
 //
@@ -149,6 +165,12 @@ typedef struct QUIC_RECV_DATAGRAM {
     _Field_size_(BufferLength)
     uint8_t * Buffer;
 
+    //
+    // The time (in microseconds, on the QuicTimeUs64 clock) the datagram was
+    // received; the kernel's timestamp, where the datapath supports it.
+    //
+    uint64_t RecvTime;
+
     //
     // Length of the valid data in Buffer.
     //
@@ -159,11 +181,18 @@ typedef struct QUIC_RECV_DATAGRAM {
     //
     uint8_t PartitionIndex;
 
+    //
+    // The TOS (IPv4) or traffic class (IPv6) field of the received datagram.
+    // The ECN codepoint is QUIC_ECN_FROM_TOS(TypeOfService).
+    //
+    uint8_t TypeOfService;
+
     //
     // Flags.
     //
     uint8_t Allocated : 1;          // Used for debugging. Set to FALSE on free.
     uint8_t QueuedOnConnection : 1; // Used for debugging.
+    uint8_t CryptoOffloaded : 1;    // Short header packet already decrypted inline.
 
 } QUIC_RECV_DATAGRAM;
 
@@ -213,6 +242,22 @@ void
 
 typedef QUIC_DATAPATH_UNREACHABLE_CALLBACK *QUIC_DATAPATH_UNREACHABLE_CALLBACK_HANDLER;
 
+//
+// Function pointer type for processor poll callbacks. Called on a processor's
+// datapath thread after each batch of events, to run other work to completion
+// on the same thread. Returns the time (in us) until it needs to be called
+// again, or UINT64_MAX if only after new events or a wake.
+//
+typedef
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Function_class_(QUIC_DATAPATH_POLL_CALLBACK)
+uint64_t
+(QUIC_DATAPATH_POLL_CALLBACK)(
+    _In_ void* Context
+    );
+
+typedef QUIC_DATAPATH_POLL_CALLBACK *QUIC_DATAPATH_POLL_CALLBACK_HANDLER;
+
 
 //
 // Function pointer type for send complete callbacks.
@@ -259,6 +304,8 @@ QuicDataPathUninitialize(
 #define QUIC_DATAPATH_FEATURE_RECV_SIDE_SCALING     0x0001
 #define QUIC_DATAPATH_FEATURE_RECV_COALESCING       0x0002
 #define QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION     0x0004
+#define QUIC_DATAPATH_FEATURE_SEND_TXTIME           0x0008
+#define QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD      0x0010
 
 //
 // Queries the currently supported features of the datapath.
@@ -278,6 +325,95 @@ QuicDataPathIsPaddingPreferred(
     _In_ QUIC_DATAPATH* Datapath
     );
 
+//
+// Sets the amount of time (in us) the datapath threads spin, polling for new
+// events, before blocking. Zero disables busy polling.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDataPathSetBusyPoll(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t BusyPollUs
+    );
+
+//
+// Sets (or clears, if NULL) the callback run on the datapath thread of the
+// given processor. Once this returns after clearing the callback, it is no
+// longer running. Fails if the processor already has a callback or the
+// datapath doesn't have its own per-processor threads.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathSetPollCallback(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index,
+    _In_opt_ QUIC_DATAPATH_POLL_CALLBACK_HANDLER PollCallback,
+    _In_opt_ void* PollContext
+    );
+
+//
+// Wakes the datapath thread of the given processor, so that its poll callback
+// gets called.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDataPathWakeProcessor(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index
+    );
+
+//
+// Describes where the partition ID lives in the server's connection IDs, so
+// that the datapath can steer received datagrams to the socket of the
+// partition that owns the connection.
+//
+typedef struct QUIC_DATAPATH_CID_STEERING {
+    uint8_t CidLength;          // Total length of locally generated CIDs.
+    uint8_t PartitionOffset;    // Offset of the partition ID byte in the CID.
+    uint8_t PartitionMask;
+    uint8_t PartitionCount;
+} QUIC_DATAPATH_CID_STEERING;
+
+//
+// Sets (or clears, if NULL) connection ID based steering for server bindings
+// created from now on. Fails if the datapath has no way to steer datagrams.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathSetCidSteering(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_opt_ const QUIC_DATAPATH_CID_STEERING* Steering
+    );
+
+//
+// The 1-RTT packet protection state of a connection, handed to a datapath
+// that supports QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD so that the NIC protects
+// and unprotects its short header packets inline. The datapath derives the
+// packet and header protection keys from the secrets, and the keys of the
+// following key phase as well, so it can decrypt the first packets of a key
+// update initiated by the peer before the connection registers them.
+//
+typedef struct QUIC_DATAPATH_CRYPTO_OFFLOAD {
+    const struct QUIC_SECRET* ReadSecret;   // Secret of the current read key phase.
+    const struct QUIC_SECRET* WriteSecret;  // Secret of the current write key phase.
+    uint8_t KeyPhase;                       // The current key phase bit.
+    uint8_t CidLength;                      // Length of the CIDs in received packets.
+} QUIC_DATAPATH_CRYPTO_OFFLOAD;
+
+//
+// Registers (or replaces) the 1-RTT keys of the connection on the given remote
+// address with the binding, or removes them if Offload is NULL. From then on,
+// received short header packets from the remote address that decrypt are
+// indicated with CryptoOffloaded set; the ones that don't are dropped.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathBindingSetCryptoOffload(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_opt_ const QUIC_DATAPATH_CRYPTO_OFFLOAD* Offload
+    );
+
 //
 // Resolves a hostname to an IP address.
 //
@@ -289,6 +425,53 @@ QuicDataPathResolveAddress(
     _Inout_ QUIC_ADDR * Address
     );
 
+//
+// The result of resolving a hostname in both address families.
+//
+typedef struct QUIC_DATAPATH_RESOLUTION {
+
+    //
+    // The first address of each family, in the order the resolver returned
+    // them (i.e. the system's preference first). Unused entries have the
+    // AF_UNSPEC family.
+    //
+    QUIC_ADDR Addresses[2];
+
+} QUIC_DATAPATH_RESOLUTION;
+
+//
+// Function pointer type for asynchronous hostname resolution completions.
+// Called on an arbitrary thread. Resolution is only valid for the duration of
+// the call.
+//
+typedef
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Function_class_(QUIC_DATAPATH_RESOLVE_CALLBACK)
+void
+(QUIC_DATAPATH_RESOLVE_CALLBACK)(
+    _In_opt_ void* Context,
+    _In_ QUIC_STATUS Status,
+    _In_ const QUIC_DATAPATH_RESOLUTION* Resolution
+    );
+
+typedef QUIC_DATAPATH_RESOLVE_CALLBACK *QUIC_DATAPATH_RESOLVE_CALLBACK_HANDLER;
+
+//
+// Resolves a hostname to its IPv4 and IPv6 addresses, without blocking on the
+// resolver. Returns QUIC_STATUS_SUCCESS, with Resolution filled in, if the
+// name could be resolved immediately (e.g. a numeric address). Returns
+// QUIC_STATUS_PENDING if Callback will be called with the result instead.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathResolveAddressAsync(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_z_ const char* HostName,
+    _In_ QUIC_DATAPATH_RESOLVE_CALLBACK_HANDLER Callback,
+    _In_opt_ void* Context,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    );
+
 //
 // The following APIs are specific to a single UDP port abstraction.
 //
@@ -362,13 +545,15 @@ QuicDataPathBindingReturnRecvDatagrams(
 
 //
 // Allocates a new send context to be used to call QuicDataPathBindingSendTo. It
-// can be freed with QuicDataPathBindingFreeSendContext too.
+// can be freed with QuicDataPathBindingFreeSendContext too. All the datagrams
+// sent with the context are marked with the ECN codepoint.
 //
 _IRQL_requires_max_(DISPATCH_LEVEL)
 _Success_(return != NULL)
 QUIC_DATAPATH_SEND_CONTEXT*
 QuicDataPathBindingAllocSendContext(
     _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ QUIC_ECN_TYPE ECN,
     _In_ uint16_t MaxPacketSize
     );
 
@@ -413,6 +598,37 @@ QuicDataPathBindingIsSendContextFull(
     _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
     );
 
+//
+// Sets the time (in microseconds, on the QuicTimeUs64 clock) before which the
+// datagrams allocated from the send context from now on don't leave the host.
+// Zero sends them immediately. Only valid if the datapath supports
+// QUIC_DATAPATH_FEATURE_SEND_TXTIME. With send segmentation, a new time starts
+// a new segmented batch.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDataPathBindingSetSendTxTime(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ uint64_t TxTime
+    );
+
+//
+// Marks a short header packet in a datagram allocated from the send context
+// as left in plain text, for the NIC to encrypt and header protect inline
+// with the keys registered via QuicDataPathBindingSetCryptoOffload. The packet
+// already has room for the authentication tag at its end.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDataPathBindingSetCryptoOffloadPacket(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ QUIC_BUFFER* Datagram,
+    _In_ uint16_t PacketOffset,
+    _In_ uint16_t PacketLength,
+    _In_ uint16_t HeaderLength,
+    _In_ uint64_t PacketNumber
+    );
+
 //
 // Sends data to a remote host. Note, the buffer must remain valid for
 // the duration of the send operation.
@@ -438,6 +654,38 @@ QuicDataPathBindingSendFromTo(
     _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
     );
 
+//
+// A send context, and the addresses to send it from and to, in a batch passed
+// to QuicDataPathBindingSendBatch.
+//
+typedef struct QUIC_DATAPATH_SEND_ENTRY {
+
+    //
+    // The local address to send from, or NULL to send from the binding's local
+    // address (as QuicDataPathBindingSendTo does).
+    //
+    const QUIC_ADDR* LocalAddress;
+
+    const QUIC_ADDR* RemoteAddress;
+
+    QUIC_DATAPATH_SEND_CONTEXT* SendContext;
+
+} QUIC_DATAPATH_SEND_ENTRY;
+
+//
+// Sends the data of several send contexts, each possibly to a different remote
+// host, in as few submissions to the socket as possible. All the send contexts
+// are consumed, even on failure. Note, the buffers must remain valid for the
+// duration of the send operation.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicDataPathBindingSendBatch(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ uint32_t EntryCount,
+    _In_reads_(EntryCount) const QUIC_DATAPATH_SEND_ENTRY* Entries
+    );
+
 //
 // Sets a parameter on the binding.
 //
@@ -0,0 +1,177 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    An always on, in-memory recorder of the most recent QuicTraceEvent calls.
+    When built with QUIC_FLIGHT_RECORDER, every event is also written, as a
+    fixed size binary record, into a lock-free ring buffer for the current
+    processor. The rings can be dumped (on demand or on a trigger) as
+    LibraryFlightRecord events, which quicetw decodes like any other event.
+
+--*/
+
+#pragma once
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+//
+// The number of records in each processor's ring. Must be a power of 2.
+//
+#define QUIC_FLIGHT_RECORDER_RECORD_COUNT   1024
+
+//
+// The maximum number of event arguments stored in a record. Any additional
+// arguments are dropped.
+//
+#define QUIC_FLIGHT_RECORD_MAX_ARGS         12
+
+//
+// The minimum time between dumps caused by triggers (as opposed to explicit
+// requests), so that a burst of failures doesn't turn into a burst of dumps.
+//
+#define QUIC_FLIGHT_RECORDER_TRIGGER_INTERVAL_MS 10000
+
+//
+// A single recorded event. Arguments are stored as raw 64-bit values; strings
+// and buffers are stored as their addresses and are never dereferenced.
+//
+typedef struct QUIC_FLIGHT_RECORD {
+    //
+    // The ring position this record was written for, or -1 while the record
+    // is being written.
+    //
+    int64_t volatile Sequence;
+    uint64_t TimeUs;
+    const char* Name;
+    const char* Format;
+    uint32_t ArgCount;
+    uint64_t Args[QUIC_FLIGHT_RECORD_MAX_ARGS];
+} QUIC_FLIGHT_RECORD;
+
+//
+// Allocates a ring for each processor. Events are only recorded between
+// initialization and uninitialization.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicFlightRecorderInitialize(
+    void
+    );
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicFlightRecorderUninitialize(
+    void
+    );
+
+//
+// Writes an event to the current processor's ring.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicFlightRecorderWrite(
+    _In_z_ const char* Name,
+    _In_z_ const char* Format,
+    _In_ uint32_t ArgCount,
+    _In_reads_(ArgCount)
+        const uint64_t* Args
+    );
+
+typedef
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+(QUIC_FLIGHT_RECORDER_CALLBACK)(
+    _In_opt_ void* Context,
+    _In_ uint32_t Processor,
+    _In_ const QUIC_FLIGHT_RECORD* Record
+    );
+
+//
+// Calls the callback for every complete record still in the rings, oldest
+// first for each processor.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicFlightRecorderEnumerate(
+    _In_ QUIC_FLIGHT_RECORDER_CALLBACK* Callback,
+    _In_opt_ void* Context
+    );
+
+//
+// Formats a record's arguments with its event's format string. Returns the
+// length of the string written (not including the null terminator).
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicFlightRecordFormat(
+    _In_ const QUIC_FLIGHT_RECORD* Record,
+    _In_ uint32_t BufferLength,
+    _Out_writes_z_(BufferLength)
+        char* Buffer
+    );
+
+//
+// Writes out the contents of all the rings as trace events.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicFlightRecorderDump(
+    _In_z_ const char* Reason
+    );
+
+//
+// Dumps the rings, unless a triggered dump already happened within the last
+// QUIC_FLIGHT_RECORDER_TRIGGER_INTERVAL_MS. Returns TRUE if dumped.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicFlightRecorderTrigger(
+    _In_z_ const char* Reason
+    );
+
+//
+// Helpers for converting the variable arguments of a QuicTraceEvent call into
+// an array of 64-bit values.
+//
+#define QUIC_FR_EXPAND(x) x
+#define QUIC_FR_CONCAT_(a, b) a##b
+#define QUIC_FR_CONCAT(a, b) QUIC_FR_CONCAT_(a, b)
+#define QUIC_FR_ARG_COUNT_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, N, ...) N
+#define QUIC_FR_ARG_COUNT(...) \
+    QUIC_FR_EXPAND(QUIC_FR_ARG_COUNT_(0, ##__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0))
+#define QUIC_FR_ARG(a) (uint64_t)(a)
+#define QUIC_FR_ARGS_0()
+#define QUIC_FR_ARGS_1(a) QUIC_FR_ARG(a)
+#define QUIC_FR_ARGS_2(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_1(__VA_ARGS__))
+#define QUIC_FR_ARGS_3(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_2(__VA_ARGS__))
+#define QUIC_FR_ARGS_4(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_3(__VA_ARGS__))
+#define QUIC_FR_ARGS_5(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_4(__VA_ARGS__))
+#define QUIC_FR_ARGS_6(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_5(__VA_ARGS__))
+#define QUIC_FR_ARGS_7(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_6(__VA_ARGS__))
+#define QUIC_FR_ARGS_8(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_7(__VA_ARGS__))
+#define QUIC_FR_ARGS_9(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_8(__VA_ARGS__))
+#define QUIC_FR_ARGS_10(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_9(__VA_ARGS__))
+#define QUIC_FR_ARGS_11(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_10(__VA_ARGS__))
+#define QUIC_FR_ARGS_12(a, ...) QUIC_FR_ARG(a), QUIC_FR_EXPAND(QUIC_FR_ARGS_11(__VA_ARGS__))
+#define QUIC_FR_ARGS(...) \
+    QUIC_FR_EXPAND(QUIC_FR_CONCAT(QUIC_FR_ARGS_, QUIC_FR_ARG_COUNT(__VA_ARGS__))(__VA_ARGS__))
+
+//
+// Records a QuicTraceEvent call. The first array element is a placeholder so
+// that events without any arguments still have a valid initializer.
+//
+#define QuicFlightRecorderEvent(Name, Fmt, ...) \
+    { \
+        const uint64_t QuicFrArgs[] = { 0, QUIC_FR_ARGS(__VA_ARGS__) }; \
+        QuicFlightRecorderWrite( \
+            #Name, Fmt, (uint32_t)(ARRAYSIZE(QuicFrArgs) - 1), QuicFrArgs + 1); \
+    }
+
+#if defined(__cplusplus)
+}
+#endif
@@ -87,6 +87,15 @@ Usage examples:
 
 #define QUIC_HASH_MIN_SIZE 128
 
+//
+// Tables grow by one bucket at a time (splitting a single chain) whenever an
+// insert takes the average chain length above QUIC_HASH_MAX_LOAD_FACTOR, so
+// the cost of growing is spread evenly over the inserts instead of rehashing
+// the whole table at once.
+//
+#define QUIC_HASHTABLE_RESIZE_SUPPORT
+#define QUIC_HASH_MAX_LOAD_FACTOR 2
+
 typedef struct QUIC_HASHTABLE_ENTRY {
     QUIC_LIST_ENTRY Linkage;
     uint64_t Signature;
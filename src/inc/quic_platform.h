@@ -234,5 +234,6 @@ QuicListPopEntry(
 
 #include "quic_hashtable.h"
 #include "quic_toeplitz.h"
+#include "quic_random_stream.h"
 
 #endif // QUIC_PLATFORM_
@@ -106,6 +106,36 @@ BOOLEAN
     _In_ QUIC_DATAPATH* Datapath
     );
 
+typedef
+void
+(*QUIC_DATAPATH_SET_BUSY_POLL)(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t BusyPollUs
+    );
+
+typedef
+QUIC_STATUS
+(*QUIC_DATAPATH_SET_POLL_CALLBACK)(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index,
+    _In_opt_ QUIC_DATAPATH_POLL_CALLBACK_HANDLER PollCallback,
+    _In_opt_ void* PollContext
+    );
+
+typedef
+void
+(*QUIC_DATAPATH_WAKE_PROCESSOR)(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index
+    );
+
+typedef
+QUIC_STATUS
+(*QUIC_DATAPATH_SET_CID_STEERING)(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_opt_ const QUIC_DATAPATH_CID_STEERING* Steering
+    );
+
 typedef
 QUIC_STATUS
 (*QUIC_DATAPATH_RESOLVE_ADDRESS)(
@@ -114,6 +144,16 @@ QUIC_STATUS
     _Inout_ QUIC_ADDR * Address
     );
 
+typedef
+QUIC_STATUS
+(*QUIC_DATAPATH_RESOLVE_ADDRESS_ASYNC)(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_z_ const char* HostName,
+    _In_ QUIC_DATAPATH_RESOLVE_CALLBACK_HANDLER Callback,
+    _In_opt_ void* Context,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    );
+
 typedef
 QUIC_STATUS
 (*QUIC_DATAPATH_BINDING_CREATE)(
@@ -160,6 +200,7 @@ typedef
 QUIC_DATAPATH_SEND_CONTEXT*
 (*QUIC_DATAPATH_BINDING_ALLOC_SEND_CONTEXT)(
     _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ QUIC_ECN_TYPE ECN,
     _In_ uint16_t MaxPacketSize
     );
 
@@ -249,7 +290,12 @@ typedef struct QUIC_PLATFORM_DISPATCH {
     QUIC_DATAPATH_RECVCONTEXT_TO_RECVBUFFER DatapathRecvContextToRecvPacket;
     QUIC_DATAPATH_RECVBUFFER_TO_RECVCONTEXT DatapathRecvPacketToRecvContext;
     QUIC_DATAPATH_IS_PADDING_PREFERRED DatapathIsPaddingPreferred;
+    QUIC_DATAPATH_SET_BUSY_POLL DatapathSetBusyPoll;
+    QUIC_DATAPATH_SET_POLL_CALLBACK DatapathSetPollCallback;
+    QUIC_DATAPATH_WAKE_PROCESSOR DatapathWakeProcessor;
+    QUIC_DATAPATH_SET_CID_STEERING DatapathSetCidSteering;
     QUIC_DATAPATH_RESOLVE_ADDRESS DatapathResolveAddress;
+    QUIC_DATAPATH_RESOLVE_ADDRESS_ASYNC DatapathResolveAddressAsync;
     QUIC_DATAPATH_BINDING_CREATE DatapathBindingCreate;
     QUIC_DATAPATH_BINDING_DELETE DatapathBindingDelete;
     QUIC_DATPATH_BINDING_GET_LOCAL_MTU DatapathBindingGetLocalMtu;
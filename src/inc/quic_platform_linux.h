@@ -41,6 +41,7 @@ Environment:
 #include <msquic_linux.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <sched.h>
 #include <errno.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
@@ -92,6 +93,12 @@ QuicPlatformUninitialize(
 
 #define ARRAYSIZE(A) (sizeof(A)/sizeof((A)[0]))
 
+#define ALIGN_DOWN(length, type) \
+    ((unsigned long)(length) & ~(sizeof(type) - 1))
+
+#define ALIGN_UP(length, type) \
+    (ALIGN_DOWN(((unsigned long)(length) + sizeof(type) - 1), type))
+
 #define UNREFERENCED_PARAMETER(P) (P)
 
 #define QuicNetByteSwapShort(x) htons((x))
@@ -138,6 +145,48 @@ InterlockedExchangeAdd64(
     return __sync_fetch_and_add(Addend, Value);
 }
 
+inline
+long
+InterlockedCompareExchange(
+    _Inout_ _Interlocked_operand_ long volatile *Destination,
+    _In_ long ExChange,
+    _In_ long Comperand
+    )
+{
+    return __sync_val_compare_and_swap(Destination, Comperand, ExChange);
+}
+
+inline
+long
+InterlockedExchange(
+    _Inout_ _Interlocked_operand_ long volatile *Target,
+    _In_ long Value
+    )
+{
+    return __atomic_exchange_n(Target, Value, __ATOMIC_SEQ_CST);
+}
+
+inline
+void*
+InterlockedCompareExchangePointer(
+    _Inout_ _Interlocked_operand_ void* volatile *Destination,
+    _In_opt_ void* ExChange,
+    _In_opt_ void* Comperand
+    )
+{
+    return __sync_val_compare_and_swap(Destination, Comperand, ExChange);
+}
+
+inline
+void*
+InterlockedExchangePointer(
+    _Inout_ _Interlocked_operand_ void* volatile *Target,
+    _In_opt_ void* Value
+    )
+{
+    return __atomic_exchange_n(Target, Value, __ATOMIC_SEQ_CST);
+}
+
 inline
 short
 InterlockedCompareExchange16(
@@ -176,6 +225,50 @@ InterlockedIncrement64(
     return __sync_add_and_fetch(Addend, (int64_t)1);
 }
 
+inline
+int64_t
+InterlockedExchange64(
+    _Inout_ _Interlocked_operand_ int64_t volatile *Target,
+    _In_ int64_t Value
+    )
+{
+    return __atomic_exchange_n(Target, Value, __ATOMIC_SEQ_CST);
+}
+
+inline
+int64_t
+InterlockedCompareExchange64(
+    _Inout_ _Interlocked_operand_ int64_t volatile *Destination,
+    _In_ int64_t ExChange,
+    _In_ int64_t Comperand
+    )
+{
+    return __sync_val_compare_and_swap(Destination, Comperand, ExChange);
+}
+
+inline
+long
+ReadAcquire(
+    _In_ _Interlocked_operand_ long const volatile *Source
+    )
+{
+    return __atomic_load_n(Source, __ATOMIC_ACQUIRE);
+}
+
+#define MemoryBarrier() __sync_synchronize()
+
+//
+// Hints to the processor that the thread is spinning.
+//
+
+#if defined(__x86_64__) || defined(__i386__)
+#define YieldProcessor() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define YieldProcessor() __asm__ __volatile__("yield")
+#else
+#define YieldProcessor()
+#endif
+
 //
 // String utils.
 //
@@ -265,27 +358,80 @@ QuicFree(
 //
 // Represents a QUIC memory pool used for fixed sized allocations.
 //
+// Freed entries are cached in per-CPU magazines (fixed size arrays of
+// entries). When a CPU's magazines are both full (or empty) a whole magazine
+// is exchanged with a lock-free depot, so that entries freed on one CPU can be
+// reused on another. There is one depot per NUMA node, so that entries only
+// move between the CPUs of a node, and stay in its local memory.
+//
 
-typedef struct QUIC_POOL {
+#define QUIC_POOL_MAGAZINE_SIZE   32
+#define QUIC_POOL_DEPOT_SIZE      16
+
+typedef struct QUIC_POOL_MAGAZINE {
 
     //
-    // List of free entries.
+    // Number of valid entries in the Entries array.
     //
 
-    QUIC_SINGLE_LIST_ENTRY ListHead;
+    uint32_t Count;
+
+    void* Entries[QUIC_POOL_MAGAZINE_SIZE];
+
+} QUIC_POOL_MAGAZINE;
+
+typedef struct QUIC_POOL_CPU_CACHE {
+
+    //
+    // Set while a thread is using this CPU's magazines. A thread which finds
+    // it already set (because it was migrated, or preempted, while using the
+    // cache) never waits and bypasses the cache instead.
+    //
+
+    long Busy;
 
     //
-    // Number of free entries in the list.
+    // The magazine entries are allocated from and freed to, and the
+    // previously loaded magazine. Both are allocated on first use.
     //
 
-    uint16_t ListDepth;
+    QUIC_POOL_MAGAZINE* Loaded;
+    QUIC_POOL_MAGAZINE* Previous;
 
     //
-    // Lock to synchronize access to the List.
-    // LINUX_TODO: Check how to make this lock free?
+    // Number of allocations served from, and not served from, the cache.
+    //
+
+    uint64_t Hits;
+    uint64_t Misses;
+
     //
+    // Index of the depot (the CPU's NUMA node) the magazines are exchanged
+    // with.
+    //
+
+    uint32_t Depot;
+
+    //
+    // Keeps each CPU's cache on its own cache line.
+    //
+
+    uint8_t Padding[20];
+
+} QUIC_POOL_CPU_CACHE;
+
+//
+// A depot of full and empty magazines. Each slot is either NULL or owns a
+// magazine, and is only updated with atomic exchanges.
+//
+typedef struct QUIC_POOL_DEPOT {
+
+    QUIC_POOL_MAGAZINE* FullMagazines[QUIC_POOL_DEPOT_SIZE];
+    QUIC_POOL_MAGAZINE* EmptyMagazines[QUIC_POOL_DEPOT_SIZE];
 
-    pthread_mutex_t Lock;
+} QUIC_POOL_DEPOT;
+
+typedef struct QUIC_POOL {
 
     //
     // Size of entries.
@@ -299,6 +445,33 @@ typedef struct QUIC_POOL {
 
     uint32_t MemTag;
 
+    //
+    // Per-CPU caches, indexed by the current processor number.
+    //
+
+    uint32_t CacheCount;
+    QUIC_POOL_CPU_CACHE* Caches;
+
+    //
+    // Allocations that bypassed a busy per-CPU cache.
+    //
+
+    uint64_t ContendedMisses;
+
+    //
+    // Per-NUMA node depots.
+    //
+
+    uint32_t DepotCount;
+    QUIC_POOL_DEPOT* Depots;
+
+    //
+    // Large page arena the entries are carved from, while large page buffers
+    // are enabled. NULL unless QuicPoolEnableLargePages was called.
+    //
+
+    struct QUIC_POOL_ARENA* Arena;
+
 } QUIC_POOL;
 
 #define QUIC_POOL_MAXIMUM_DEPTH   256 // Copied from EX_MAXIMUM_LOOKASIDE_DEPTH_BASE
@@ -326,9 +499,67 @@ QuicPoolFree(
     _In_ void* Entry
     );
 
+//
+// Lets the pool carve new entries out of 2 MB (huge) pages, instead of
+// allocating them individually, while large page buffers are enabled. Must be
+// called right after QuicPoolInitialize.
+//
+void
+QuicPoolEnableLargePages(
+    _Inout_ QUIC_POOL* Pool
+    );
+
+//
+// Enables or disables large page buffers, for the pools that allow them.
+// Entries already allocated are unaffected.
+//
+QUIC_STATUS
+QuicSetLargePageBuffers(
+    _In_ BOOLEAN Enabled
+    );
+
+BOOLEAN
+QuicGetLargePageBuffers(
+    void
+    );
+
+//
+// Creates a named shared memory region of the given size, zeroed and mapped
+// read/write, which other processes can map by name to read. Any existing
+// region with the name is replaced. Returns NULL on failure.
+//
+void*
+QuicSharedMemoryCreate(
+    _In_z_ const char* Name,
+    _In_ uint32_t Size
+    );
+
+//
+// Unmaps and removes a region created by QuicSharedMemoryCreate. Processes
+// that still have it mapped keep their mappings.
+//
+void
+QuicSharedMemoryDelete(
+    _In_z_ const char* Name,
+    _In_ void* Buffer,
+    _In_ uint32_t Size
+    );
+
+//
+// Returns the number of allocations which were, and weren't, served from the
+// pool's per-CPU caches.
+//
+void
+QuicPoolGetStatistics(
+    _In_ const QUIC_POOL* Pool,
+    _Out_ uint64_t* Hits,
+    _Out_ uint64_t* Misses
+    );
+
 #define QuicZeroMemory(Destination, Length) memset((Destination), 0, (Length))
 #define QuicCopyMemory(Destination, Source, Length) memcpy((Destination), (Source), (Length))
 #define QuicMoveMemory(Destination, Source, Length) memmove((Destination), (Source), (Length))
+#define QuicPrefetch(Address) __builtin_prefetch((Address), 0, 3)
 #define QuicSecureZeroMemory QuicZeroMemory // TODO - Something better?
 
 #define QuicByteSwapUint16(value) __builtin_bswap16((unsigned short)(value))
@@ -366,13 +597,28 @@ typedef struct QUIC_LOCK {
 #define QuicLockRelease(Lock) \
     QUIC_FRE_ASSERT(pthread_mutex_unlock(&(Lock)->Mutex) == 0);
 
+//
+// Dispatch locks only protect short critical sections (they are spin locks in
+// the Windows kernel), so a contended acquisition first spins, with
+// exponential backoff, before blocking in the kernel.
+//
+
 typedef QUIC_LOCK QUIC_DISPATCH_LOCK;
 
 #define QuicDispatchLockInitialize QuicLockInitialize
 
 #define QuicDispatchLockUninitialize QuicLockUninitialize
 
-#define QuicDispatchLockAcquire QuicLockAcquire
+void
+QuicDispatchLockAcquireContended(
+    _Inout_ QUIC_DISPATCH_LOCK* Lock
+    );
+
+#define QuicDispatchLockAcquire(Lock) do { \
+    if (pthread_mutex_trylock(&(Lock)->Mutex) != 0) { \
+        QuicDispatchLockAcquireContended(Lock); \
+    } \
+} while (0)
 
 #define QuicDispatchLockRelease QuicLockRelease
 
@@ -410,14 +656,42 @@ typedef QUIC_RW_LOCK QUIC_DISPATCH_RW_LOCK;
 
 #define QuicDispatchRwLockUninitialize QuicRwLockUninitialize
 
-#define QuicDispatchRwLockAcquireShared QuicRwLockAcquireShared
+void
+QuicDispatchRwLockAcquireSharedContended(
+    _Inout_ QUIC_DISPATCH_RW_LOCK* Lock
+    );
+
+void
+QuicDispatchRwLockAcquireExclusiveContended(
+    _Inout_ QUIC_DISPATCH_RW_LOCK* Lock
+    );
 
-#define QuicDispatchRwLockAcquireExclusive QuicRwLockAcquireExclusive
+#define QuicDispatchRwLockAcquireShared(Lock) do { \
+    if (pthread_rwlock_tryrdlock(&(Lock)->RwLock) != 0) { \
+        QuicDispatchRwLockAcquireSharedContended(Lock); \
+    } \
+} while (0)
+
+#define QuicDispatchRwLockAcquireExclusive(Lock) do { \
+    if (pthread_rwlock_trywrlock(&(Lock)->RwLock) != 0) { \
+        QuicDispatchRwLockAcquireExclusiveContended(Lock); \
+    } \
+} while (0)
 
 #define QuicDispatchRwLockReleaseShared QuicRwLockReleaseShared
 
 #define QuicDispatchRwLockReleaseExclusive QuicRwLockReleaseExclusive
 
+//
+// Returns the number of contended dispatch lock acquisitions, and how many of
+// those had to block.
+//
+void
+QuicDispatchLockGetStatistics(
+    _Out_ uint64_t* Contended,
+    _Out_ uint64_t* Parked
+    );
+
 //
 // Reference Count Interface
 //
@@ -612,6 +886,11 @@ QuicSleep(
     _In_ uint32_t DurationMs
     );
 
+//
+// Gives up the rest of the thread's time slice, if another thread is ready.
+//
+#define QuicThreadYield() sched_yield()
+
 
 //
 // Thread Interfaces.
@@ -687,6 +966,19 @@ QuicProcCurrentNumber(
     void
     );
 
+//
+// NUMA node of a processor (by index), or 0 if unknown.
+//
+uint16_t
+QuicProcNumaNode(
+    _In_ uint32_t Index
+    );
+
+uint16_t
+QuicNumaNodeCount(
+    void
+    );
+
 //
 // Rundown Protection Interfaces.
 //
@@ -278,9 +278,27 @@ typedef LOOKASIDE_LIST_EX QUIC_POOL;
 #define QuicPoolAlloc(Pool) ExAllocateFromLookasideListEx(Pool)
 #define QuicPoolFree(Pool, Entry) ExFreeToLookasideListEx(Pool, Entry)
 
+//
+// Large page buffers are only implemented on Linux. The pools here are
+// lookaside lists, so the parameter can only be set to FALSE.
+//
+#define QuicSetLargePageBuffers(Enabled) \
+    ((Enabled) ? QUIC_STATUS_NOT_SUPPORTED : QUIC_STATUS_SUCCESS)
+#define QuicGetLargePageBuffers() FALSE
+
+//
+// Shared memory (for the stats region) isn't supported in kernel mode; the
+// stats are exposed through the perf counters instead.
+//
+#define QuicSharedMemoryCreate(Name, Size) \
+    ((void)(Name), (void)(Size), (void*)NULL)
+#define QuicSharedMemoryDelete(Name, Buffer, Size) \
+    ((void)(Name), (void)(Buffer), (void)(Size))
+
 #define QuicZeroMemory RtlZeroMemory
 #define QuicCopyMemory RtlCopyMemory
 #define QuicMoveMemory RtlMoveMemory
+#define QuicPrefetch(Address) PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, (Address))
 #define QuicSecureZeroMemory RtlSecureZeroMemory
 
 #define QuicByteSwapUint16 RtlUshortByteSwap
@@ -378,6 +396,13 @@ typedef struct QUIC_DISPATCH_RW_LOCK {
 #define QuicDispatchRwLockReleaseShared(Lock) ExReleaseSpinLockShared(&(Lock)->SpinLock, (Lock)->PrevIrql)
 #define QuicDispatchRwLockReleaseExclusive(Lock) ExReleaseSpinLockExclusive(&(Lock)->SpinLock, (Lock)->PrevIrql)
 
+//
+// Dispatch locks are plain spin locks here, which don't count contention, so
+// the lock perf counters are always zero (see QUIC_PERF_COUNTER_LOCK_*).
+//
+#define QuicDispatchLockGetStatistics(Contended, Parked) \
+    (*(Contended) = 0, *(Parked) = 0)
+
 //
 // Reference Count Interface
 //
@@ -692,6 +717,22 @@ QuicSleep(
     KeWaitForSingleObject(&SleepTimer, Executive, KernelMode, FALSE, NULL);
 }
 
+//
+// Gives up the rest of the thread's time slice, if another thread is ready. A
+// zero delay only yields.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+inline
+void
+QuicThreadYield(
+    void
+    )
+{
+    LARGE_INTEGER Delay;
+    Delay.QuadPart = 0;
+    KeDelayExecutionThread(KernelMode, FALSE, &Delay);
+}
+
 //
 // Create Thread Interfaces
 //
@@ -869,6 +910,32 @@ typedef ULONG_PTR QUIC_THREAD_ID;
 #define QuicProcActiveCount() KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS)
 #define QuicProcCurrentNumber() KeGetCurrentProcessorIndex()
 
+//
+// NUMA node of a processor (by index), or 0 if unknown.
+//
+inline
+uint16_t
+QuicProcNumaNode(
+    _In_ uint32_t Index
+    )
+{
+    PROCESSOR_NUMBER ProcNumber;
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX Info;
+    ULONG InfoLength = sizeof(Info);
+    if (!NT_SUCCESS(KeGetProcessorNumberFromIndex(Index, &ProcNumber)) ||
+        !NT_SUCCESS(
+            KeQueryLogicalProcessorRelationship(
+                &ProcNumber,
+                RelationNumaNode,
+                &Info,
+                &InfoLength))) {
+        return 0;
+    }
+    return (uint16_t)Info.NumaNode.NodeNumber;
+}
+
+#define QuicNumaNodeCount() ((uint16_t)(KeQueryHighestNodeNumber() + 1))
+
 //
 // Rundown Protection Interfaces
 //
@@ -347,9 +347,44 @@ QuicPoolFree(
 #endif
 }
 
+//
+// Large page buffers are only implemented on Linux, where the datapath's pools
+// are carved out of huge page arenas. Here the pools are lookaside lists, so
+// the parameter can only be set to FALSE.
+//
+#define QuicSetLargePageBuffers(Enabled) \
+    ((Enabled) ? QUIC_STATUS_NOT_SUPPORTED : QUIC_STATUS_SUCCESS)
+#define QuicGetLargePageBuffers() FALSE
+
+//
+// Creates a named, pagefile backed shared memory region of the given size,
+// zeroed and mapped read/write, which other processes can map by name to read.
+// An existing region with the name is reused (and zeroed). Only one region
+// can exist at a time. Returns NULL on failure.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void*
+QuicSharedMemoryCreate(
+    _In_z_ const char* Name,
+    _In_ uint32_t Size
+    );
+
+//
+// Unmaps and closes a region created by QuicSharedMemoryCreate. Processes that
+// still have it mapped keep their mappings.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSharedMemoryDelete(
+    _In_z_ const char* Name,
+    _In_ void* Buffer,
+    _In_ uint32_t Size
+    );
+
 #define QuicZeroMemory RtlZeroMemory
 #define QuicCopyMemory RtlCopyMemory
 #define QuicMoveMemory RtlMoveMemory
+#define QuicPrefetch(Address) PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, (Address))
 #define QuicSecureZeroMemory RtlSecureZeroMemory
 
 #define QuicByteSwapUint16 _byteswap_ushort
@@ -392,6 +427,13 @@ typedef SRWLOCK QUIC_DISPATCH_RW_LOCK;
 #define QuicDispatchRwLockReleaseShared(Lock) ReleaseSRWLockShared(Lock)
 #define QuicDispatchRwLockReleaseExclusive(Lock) ReleaseSRWLockExclusive(Lock)
 
+//
+// Dispatch locks are plain critical sections here, which don't count contention, so
+// the lock perf counters are always zero (see QUIC_PERF_COUNTER_LOCK_*).
+//
+#define QuicDispatchLockGetStatistics(Contended, Parked) \
+    (*(Contended) = 0, *(Parked) = 0)
+
 //
 // Reference Count Interface
 //
@@ -696,6 +738,11 @@ QuicTimeAtOrBefore32(
 
 #define QuicSleep(ms) Sleep(ms)
 
+//
+// Gives up the rest of the thread's time slice, if another thread is ready.
+//
+#define QuicThreadYield() SwitchToThread()
+
 //
 // Create Thread Interfaces
 //
@@ -808,6 +855,30 @@ typedef uint32_t QUIC_THREAD_ID;
 #define QuicProcActiveCount() GetActiveProcessorCount(ALL_PROCESSOR_GROUPS)
 #define QuicProcCurrentNumber() GetCurrentProcessorNumber()
 
+//
+// NUMA node of a processor (by index), or 0 if unknown.
+//
+inline
+uint16_t
+QuicProcNumaNode(
+    _In_ uint32_t Index
+    )
+{
+    PROCESSOR_NUMBER ProcNumber = { 0, (BYTE)Index, 0 };
+    USHORT Node;
+    return GetNumaProcessorNodeEx(&ProcNumber, &Node) ? (uint16_t)Node : 0;
+}
+
+inline
+uint16_t
+QuicNumaNodeCount(
+    void
+    )
+{
+    ULONG HighestNode;
+    return GetNumaHighestNodeNumber(&HighestNode) ? (uint16_t)(HighestNode + 1) : 1;
+}
+
 //
 // Rundown Protection Interfaces
 //
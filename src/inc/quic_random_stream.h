@@ -0,0 +1,89 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+--*/
+
+#pragma once
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define QUIC_CHACHA20_KEY_SIZE              32
+#define QUIC_CHACHA20_BLOCK_SIZE            64
+
+//
+// The number of ChaCha20 blocks generated per refill of the stream's buffer.
+//
+#define QUIC_RANDOM_STREAM_BLOCK_COUNT      8
+
+//
+// The number of refills after which the stream's key is replaced with fresh
+// bytes from QuicRandom.
+//
+#define QUIC_RANDOM_STREAM_RESEED_INTERVAL  1024
+
+//
+// A buffered cryptographically secure random number generator, built on the
+// ChaCha20 keystream. After each refill, the first bytes of the new keystream
+// replace the key (i.e. "fast key erasure"), so earlier output can't be
+// recovered from the current state. Not thread safe; meant to be owned by a
+// single thread (e.g. a worker) to avoid going to the platform RNG for every
+// connection ID.
+//
+typedef struct QUIC_RANDOM_STREAM {
+    uint32_t Key[QUIC_CHACHA20_KEY_SIZE / sizeof(uint32_t)];
+    uint32_t RefillsUntilReseed;
+    //
+    // Offset of the next unused byte in Buffer.
+    //
+    uint32_t Offset;
+    uint8_t Buffer[QUIC_RANDOM_STREAM_BLOCK_COUNT * QUIC_CHACHA20_BLOCK_SIZE];
+} QUIC_RANDOM_STREAM;
+
+//
+// Computes a single ChaCha20 block (RFC 8439).
+//
+void
+QuicChaCha20Block(
+    _In_reads_(QUIC_CHACHA20_KEY_SIZE / sizeof(uint32_t))
+        const uint32_t* Key,
+    _In_ uint32_t Counter,
+    _In_reads_(3)
+        const uint32_t* Nonce,
+    _Out_writes_bytes_(QUIC_CHACHA20_BLOCK_SIZE)
+        uint8_t* Output
+    );
+
+//
+// Seeds the stream from QuicRandom.
+//
+QUIC_STATUS
+QuicRandomStreamInitialize(
+    _Out_ QUIC_RANDOM_STREAM* Stream
+    );
+
+//
+// Erases the stream's state.
+//
+void
+QuicRandomStreamUninitialize(
+    _Inout_ QUIC_RANDOM_STREAM* Stream
+    );
+
+//
+// Fills the buffer with random bytes from the stream.
+//
+void
+QuicRandomStreamRead(
+    _Inout_ QUIC_RANDOM_STREAM* Stream,
+    _In_ uint32_t BufferLength,
+    _Out_writes_bytes_(BufferLength)
+        void* Buffer
+    );
+
+#if defined(__cplusplus)
+}
+#endif
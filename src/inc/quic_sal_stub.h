@@ -106,6 +106,10 @@
 #define _Field_size_(...)
 #endif
 
+#ifndef _Field_size_opt_
+#define _Field_size_opt_(...)
+#endif
+
 #ifndef _Success_
 #define _Success_(...)
 #endif
@@ -138,6 +142,10 @@
 #define _Outptr_result_buffer_maybenull_(...)
 #endif
 
+#ifndef _Inout_updates_
+#define _Inout_updates_(...)
+#endif
+
 #ifndef _Inout_updates_bytes_
 #define _Inout_updates_bytes_(...)
 #endif
@@ -214,6 +222,10 @@
 #define _Out_writes_to_(...)
 #endif
 
+#ifndef _Out_writes_z_
+#define _Out_writes_z_(...)
+#endif
+
 #ifndef _Field_z_
 #define _Field_z_
 #endif
@@ -320,14 +320,17 @@ QuicTlsSessionUninitialize(
     );
 
 //
-// Configures the 0-RTT ticket key (server side).
+// Configures the resumption/0-RTT ticket keys (server side). The first key is
+// used to encrypt new tickets; the rest are previous keys, only still used to
+// decrypt tickets from clients. Replaces any previously configured keys.
 //
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
-QuicTlsSessionSetTicketKey(
+QuicTlsSessionSetTicketKeys(
     _In_ QUIC_TLS_SESSION* TlsSession,
-    _In_reads_bytes_(44)
-        const void* Buffer
+    _In_range_(1, QUIC_MAX_TICKET_KEY_COUNT) uint32_t KeyCount,
+    _In_reads_bytes_(KeyCount * QUIC_TICKET_KEY_LENGTH)
+        const uint8_t* Keys
     );
 
 //
@@ -7,6 +7,10 @@
 
 #pragma once
 
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
 #define NIBBLES_PER_BYTE    2
 #define BITS_PER_NIBBLE     4
 
@@ -45,7 +49,18 @@ typedef struct QUIC_TOEPLITZ_LOOKUP_TABLE {
 
 typedef struct QUIC_TOEPLITZ_HASH {
     QUIC_TOEPLITZ_LOOKUP_TABLE LookupTableArray[QUIC_TOEPLITZ_LOOKUP_TABLE_COUNT];
+    //
+    // For each byte offset of the input, the 64 key bits starting at that
+    // offset, bit reversed. Used by the carry-less multiply implementation.
+    //
+    uint64_t ReflectedKey[QUIC_TOEPLITZ_INPUT_SIZE];
     uint8_t HashKey[QUIC_TOEPLITZ_KEY_SIZE];
+    //
+    // Set by QuicToeplitzHashInitialize if the processor supports carry-less
+    // multiplication (PCLMULQDQ or PMULL). May be cleared afterwards to force
+    // the lookup table implementation.
+    //
+    BOOLEAN UseCarrylessMultiply;
 } QUIC_TOEPLITZ_HASH;
 
 //
@@ -67,3 +82,7 @@ QuicToeplitzHashCompute(
     _In_ uint32_t HashInputLength,
     _In_ uint32_t HashInputOffset
     );
+
+#if defined(__cplusplus)
+}
+#endif
@@ -27,6 +27,10 @@ Abstract:
     QUIC_LOGS_MANIFEST_ETW      Write to Windows ETW framework
     QUIC_LOGS_LTTNG             Write to Linux LTTng framework
 
+    Independently of the above, QUIC_FLIGHT_RECORDER additionally records all
+    Events into per-processor, in-memory ring buffers (see
+    quic_flight_recorder.h).
+
  --*/
 
 #ifndef _TRACE_H
@@ -94,7 +98,11 @@ typedef enum QUIC_TRACE_API_TYPE {
     QUIC_TRACE_API_STREAM_SEND,
     QUIC_TRACE_API_STREAM_RECEIVE_COMPLETE,
     QUIC_TRACE_API_STREAM_RECEIVE_SET_ENABLED,
-    QUIC_TRACE_API_DATAGRAM_SEND
+    QUIC_TRACE_API_DATAGRAM_SEND,
+    QUIC_TRACE_API_STREAM_SEND_BATCH,
+    QUIC_TRACE_API_DATAGRAM_SEND_BATCH,
+    QUIC_TRACE_API_DATAGRAM_RECEIVE_COMPLETE,
+    QUIC_TRACE_API_POOL_STREAM_OPEN
 } QUIC_TRACE_API_TYPE;
 
 typedef enum QUIC_TRACE_LEVEL {
@@ -124,8 +132,12 @@ QuicTraceRundown(
 #ifdef QUIC_EVENTS_STUB
 
 #define QuicTraceEventEnabled(Name) FALSE
-#define QuicTraceEvent(Name, Fmt, ...)
+#define QuicTraceEventWrite(Name, Fmt, ...)
+#ifdef QUIC_FLIGHT_RECORDER
+#define LOG_ADDR_LEN(Addr) (uint8_t)sizeof(Addr)
+#else
 #define LOG_ADDR_LEN(Addr)
+#endif
 
 #endif // QUIC_EVENTS_STUB
 
@@ -164,7 +176,7 @@ QuicEtwCallback(
 
 #define QuicTraceEventEnabled(Name) EventEnabledQuic##Name()
 #define _QuicTraceEvent(Name, Args) EventWriteQuic##Name##Args
-#define QuicTraceEvent(Name, Fmt, ...) _QuicTraceEvent(Name, (__VA_ARGS__))
+#define QuicTraceEventWrite(Name, Fmt, ...) _QuicTraceEvent(Name, (__VA_ARGS__))
 
 #define LOG_ADDR_LEN(Addr) \
     (uint8_t)((Addr).si_family == AF_INET6 ? sizeof(SOCKADDR_IN6) : sizeof(SOCKADDR_IN))
@@ -177,6 +189,48 @@ QuicEtwCallback(
 
 #endif // QUIC_EVENTS_LTTNG
 
+#include "quic_flight_recorder.h"
+
+#ifdef QUIC_FLIGHT_RECORDER
+
+#define QuicTraceEvent(Name, Fmt, ...) \
+    do { \
+        QuicFlightRecorderEvent(Name, Fmt, ##__VA_ARGS__) \
+        QuicTraceEventWrite(Name, Fmt, ##__VA_ARGS__); \
+    } while (0)
+
+#else
+
+#define QuicTraceEvent(Name, Fmt, ...) QuicTraceEventWrite(Name, Fmt, ##__VA_ARGS__)
+
+#endif // QUIC_FLIGHT_RECORDER
+
+//
+// USDT (user statically defined tracing) probes, under the "msquic" provider,
+// at a few hot path points for ad-hoc profiling with bpftrace or SystemTap.
+// Unattached, each probe is a single nop; arguments are only materialized into
+// registers or stack slots the compiler already has them in. Arguments must
+// be integers or pointers.
+//
+#if defined(QUIC_USDT) && defined(QUIC_PLATFORM_LINUX)
+#include <sys/sdt.h>
+#define QuicTraceProbe(Name, ...) STAP_PROBEV(msquic, Name, ##__VA_ARGS__)
+#else
+#define QuicTraceProbe(Name, ...)
+#endif
+
+//
+// Verbose connection and stream logs are only written for connections sampled
+// for tracing. Code that can see the connection's definition (i.e. core)
+// defines these to check the connection's cached sampling decision.
+//
+#ifndef QuicTraceConnSampled
+#define QuicTraceConnSampled(Ptr) TRUE
+#endif
+#ifndef QuicTraceStreamSampled
+#define QuicTraceStreamSampled(Ptr) TRUE
+#endif
+
 #ifdef QUIC_LOGS_STUB
 
 #define QuicTraceLogErrorEnabled()   FALSE
@@ -194,22 +248,29 @@ QuicTraceStubVarArgs(
     UNREFERENCED_PARAMETER(Fmt);
 }
 
-#define QuicTraceLogError(X,...)            QuicTraceStubVarArgs(__VA_ARGS__)
-#define QuicTraceLogWarning(X,...)          QuicTraceStubVarArgs(__VA_ARGS__)
-#define QuicTraceLogInfo(X,...)             QuicTraceStubVarArgs(__VA_ARGS__)
-#define QuicTraceLogVerbose(X,...)          QuicTraceStubVarArgs(__VA_ARGS__)
+//
+// The arguments still have to compile, but are never evaluated, so hot paths
+// don't pay for formatting helpers (e.g. CID to string conversions).
+//
+#define QuicTraceLogStub(...) \
+    do { if (FALSE) { QuicTraceStubVarArgs(__VA_ARGS__); } } while (0)
+
+#define QuicTraceLogError(X,...)            QuicTraceLogStub(__VA_ARGS__)
+#define QuicTraceLogWarning(X,...)          QuicTraceLogStub(__VA_ARGS__)
+#define QuicTraceLogInfo(X,...)             QuicTraceLogStub(__VA_ARGS__)
+#define QuicTraceLogVerbose(X,...)          QuicTraceLogStub(__VA_ARGS__)
 
-#define QuicTraceLogConnError(X,...)        QuicTraceStubVarArgs(__VA_ARGS__)
-#define QuicTraceLogConnWarning(X,...)      QuicTraceStubVarArgs(__VA_ARGS__)
-#define QuicTraceLogConnInfo(X,...)         QuicTraceStubVarArgs(__VA_ARGS__)
-#define QuicTraceLogConnVerbose(X,...)      QuicTraceStubVarArgs(__VA_ARGS__)
+#define QuicTraceLogConnError(X,...)        QuicTraceLogStub(__VA_ARGS__)
+#define QuicTraceLogConnWarning(X,...)      QuicTraceLogStub(__VA_ARGS__)
+#define QuicTraceLogConnInfo(X,...)         QuicTraceLogStub(__VA_ARGS__)
+#define QuicTraceLogConnVerbose(X,...)      QuicTraceLogStub(__VA_ARGS__)
 
 #define QuicTraceLogStreamVerboseEnabled() FALSE
 
-#define QuicTraceLogStreamError(X,...)      QuicTraceStubVarArgs(__VA_ARGS__)
-#define QuicTraceLogStreamWarning(X,...)    QuicTraceStubVarArgs(__VA_ARGS__)
-#define QuicTraceLogStreamInfo(X,...)       QuicTraceStubVarArgs(__VA_ARGS__)
-#define QuicTraceLogStreamVerbose(X,...)    QuicTraceStubVarArgs(__VA_ARGS__)
+#define QuicTraceLogStreamError(X,...)      QuicTraceLogStub(__VA_ARGS__)
+#define QuicTraceLogStreamWarning(X,...)    QuicTraceLogStub(__VA_ARGS__)
+#define QuicTraceLogStreamInfo(X,...)       QuicTraceLogStub(__VA_ARGS__)
+#define QuicTraceLogStreamVerbose(X,...)    QuicTraceLogStub(__VA_ARGS__)
 
 #endif // QUIC_LOGS_STUB
 
@@ -248,6 +309,13 @@ QuicTraceStubVarArgs(
         EventWriteQuic##Type##Log##EventName##_AssumeEnabled(Ptr, EtwBuffer); \
     }
 
+#define LogEtwTypeSampled(Type, EventName, Ptr, Sampled, Fmt, ...) \
+    if (EventEnabledQuic##Type##Log##EventName() && (Sampled)) { \
+        char EtwBuffer[QUIC_ETW_BUFFER_LENGTH]; \
+        _snprintf_s(EtwBuffer, sizeof(EtwBuffer), _TRUNCATE, Fmt, ##__VA_ARGS__); \
+        EventWriteQuic##Type##Log##EventName##_AssumeEnabled(Ptr, EtwBuffer); \
+    }
+
 #define QuicTraceLogError(Name, Fmt, ...)               LogEtw(Error, Fmt, ##__VA_ARGS__)
 #define QuicTraceLogWarning(Name, Fmt, ...)             LogEtw(Warning, Fmt, ##__VA_ARGS__)
 #define QuicTraceLogInfo(Name, Fmt, ...)                LogEtw(Info, Fmt, ##__VA_ARGS__)
@@ -256,14 +324,14 @@ QuicTraceStubVarArgs(
 #define QuicTraceLogConnError(Name, Ptr, Fmt, ...)      LogEtwType(Conn, Error, Ptr, Fmt, ##__VA_ARGS__)
 #define QuicTraceLogConnWarning(Name, Ptr, Fmt, ...)    LogEtwType(Conn, Warning, Ptr, Fmt, ##__VA_ARGS__)
 #define QuicTraceLogConnInfo(Name, Ptr, Fmt, ...)       LogEtwType(Conn, Info, Ptr, Fmt, ##__VA_ARGS__)
-#define QuicTraceLogConnVerbose(Name, Ptr, Fmt, ...)    LogEtwType(Conn, Verbose, Ptr, Fmt, ##__VA_ARGS__)
+#define QuicTraceLogConnVerbose(Name, Ptr, Fmt, ...)    LogEtwTypeSampled(Conn, Verbose, Ptr, QuicTraceConnSampled(Ptr), Fmt, ##__VA_ARGS__)
 
 #define QuicTraceLogStreamVerboseEnabled() EventEnabledQuicStreamLogVerbose()
 
 #define QuicTraceLogStreamError(Name, Ptr, Fmt, ...)    LogEtwType(Stream, Error, Ptr, Fmt, ##__VA_ARGS__)
 #define QuicTraceLogStreamWarning(Name, Ptr, Fmt, ...)  LogEtwType(Stream, Warning, Ptr, Fmt, ##__VA_ARGS__)
 #define QuicTraceLogStreamInfo(Name, Ptr, Fmt, ...)     LogEtwType(Stream, Info, Ptr, Fmt, ##__VA_ARGS__)
-#define QuicTraceLogStreamVerbose(Name, Ptr, Fmt, ...)  LogEtwType(Stream, Verbose, Ptr, Fmt, ##__VA_ARGS__)
+#define QuicTraceLogStreamVerbose(Name, Ptr, Fmt, ...)  LogEtwTypeSampled(Stream, Verbose, Ptr, QuicTraceStreamSampled(Ptr), Fmt, ##__VA_ARGS__)
 
 #endif // QUIC_LOGS_MANIFEST_ETW
 
@@ -97,6 +97,26 @@ QUIC_TRACE_EVENT(LibraryAssert,
         ctf_string(Expression, Expression))
 )
 QUIC_TRACE_LEVEL(LibraryAssert, TRACE_ERR)
+QUIC_TRACE_EVENT(LibraryFlightRecorderDump,
+    TP_ARGS(
+        const char*, Reason),
+    TP_FIELDS(
+        ctf_string(Reason, Reason))
+)
+QUIC_TRACE_LEVEL(LibraryFlightRecorderDump, TRACE_INFO)
+QUIC_TRACE_EVENT(LibraryFlightRecord,
+    TP_ARGS(
+        uint32_t, Processor,
+        uint64_t, TimeUs,
+        const char*, Name,
+        const char*, Message),
+    TP_FIELDS(
+        ctf_integer(uint32_t, Processor, Processor)
+        ctf_integer(uint64_t, TimeUs, TimeUs)
+        ctf_string(Name, Name)
+        ctf_string(Message, Message))
+)
+QUIC_TRACE_LEVEL(LibraryFlightRecord, TRACE_INFO)
 QUIC_TRACE_EVENT(ApiEnter,
     TP_ARGS(
         uint32_t, Type, // TODO - Use Enum
@@ -1145,5 +1165,5 @@ QUIC_TRACE_LEVEL(DatapathErrorStatus, TRACE_ERR)
 #include <lttng/tracepoint-event.h>
 
 #define QuicTraceEventEnabled(Name) tracepoint_enabled(MsQuic, Name)
-#define QuicTraceEvent(Name, Fmt, ...) tracepoint(MsQuic, Name, ##__VA_ARGS__)
+#define QuicTraceEventWrite(Name, Fmt, ...) tracepoint(MsQuic, Name, ##__VA_ARGS__)
 #define LOG_ADDR_LEN(Addr) sizeof(Addr)
@@ -0,0 +1,246 @@
+﻿// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.Linq;
+
+namespace QuicDataServer.Analysis
+{
+    /// <summary>
+    /// The result of comparing a candidate set of results against a baseline.
+    /// </summary>
+    public class SampleComparison
+    {
+        public double BaselineMean { get; set; }
+        public double BaselineStdDev { get; set; }
+        public double CandidateMean { get; set; }
+        public double CandidateStdDev { get; set; }
+        public double DifferencePercent { get; set; }
+        public double DifferenceLowPercent { get; set; }
+        public double DifferenceHighPercent { get; set; }
+        public double TStatistic { get; set; }
+        public bool Significant { get; set; }
+    }
+
+    /// <summary>
+    /// Statistics used to find performance regressions in test results.
+    /// </summary>
+    /// <remarks>
+    /// Each test record (one run of the test for a commit) is summarized by
+    /// the mean of its individual runs. A commit is compared against the
+    /// distribution of the record means before it with a Welch t-test, and
+    /// change points in a series of record means are found by binary
+    /// segmentation, splitting where the pooled-variance t statistic between
+    /// the two sides is largest.
+    /// </remarks>
+    public static class RegressionDetector
+    {
+        //
+        // Two-sided 95% critical values of the t-distribution for 1 to 30
+        // degrees of freedom. Larger degrees of freedom use the normal value.
+        //
+        //
+        // The t statistic a change point needs. Much stricter than for a
+        // single comparison, since every split of a segment is tried.
+        //
+        private const double ChangePointTStatistic = 5.0;
+
+        private static readonly double[] TCritical95 =
+        {
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+        };
+
+        public static double TCritical(double degreesOfFreedom)
+        {
+            if (double.IsNaN(degreesOfFreedom) || degreesOfFreedom < 1)
+            {
+                return TCritical95[0];
+            }
+            int index = (int)Math.Floor(degreesOfFreedom);
+            return index <= TCritical95.Length ? TCritical95[index - 1] : 1.960;
+        }
+
+        public static double Mean(IReadOnlyList<double> values)
+        {
+            if (values == null)
+            {
+                throw new ArgumentNullException(nameof(values));
+            }
+            return values.Count == 0 ? 0 : values.Average();
+        }
+
+        /// <summary>
+        /// The unbiased sample variance, or 0 with fewer than two values.
+        /// </summary>
+        public static double Variance(IReadOnlyList<double> values)
+        {
+            if (values == null)
+            {
+                throw new ArgumentNullException(nameof(values));
+            }
+            if (values.Count < 2)
+            {
+                return 0;
+            }
+            double mean = values.Average();
+            return values.Sum(x => (x - mean) * (x - mean)) / (values.Count - 1);
+        }
+
+        /// <summary>
+        /// Compares the candidate values against the baseline values. The
+        /// difference is significant if its 95% confidence interval excludes
+        /// zero and it is at least thresholdPercent of the baseline mean.
+        /// </summary>
+        public static SampleComparison Compare(IReadOnlyList<double> baseline, IReadOnlyList<double> candidate, double thresholdPercent)
+        {
+            if (baseline == null)
+            {
+                throw new ArgumentNullException(nameof(baseline));
+            }
+            if (candidate == null)
+            {
+                throw new ArgumentNullException(nameof(candidate));
+            }
+
+            double baselineMean = Mean(baseline);
+            double candidateMean = Mean(candidate);
+            double baselineVariance = Variance(baseline);
+
+            //
+            // A single candidate value has no spread of its own, so assume it
+            // varies like the baseline does.
+            //
+            double candidateVariance = candidate.Count < 2 ? baselineVariance : Variance(candidate);
+
+            double baselineTerm = baseline.Count == 0 ? 0 : baselineVariance / baseline.Count;
+            double candidateTerm = candidate.Count == 0 ? 0 : candidateVariance / candidate.Count;
+            double standardError = Math.Sqrt(baselineTerm + candidateTerm);
+
+            //
+            // Welch-Satterthwaite degrees of freedom.
+            //
+            double degreesOfFreedom = 1;
+            if (standardError > 0)
+            {
+                double denominator = 0;
+                if (baseline.Count > 1)
+                {
+                    denominator += baselineTerm * baselineTerm / (baseline.Count - 1);
+                }
+                if (candidate.Count > 1)
+                {
+                    denominator += candidateTerm * candidateTerm / (candidate.Count - 1);
+                }
+                else
+                {
+                    denominator += candidateTerm * candidateTerm / Math.Max(1, baseline.Count - 1);
+                }
+                degreesOfFreedom = denominator > 0 ? Math.Pow(standardError, 4) / denominator : 1;
+            }
+
+            double difference = candidateMean - baselineMean;
+            double margin = TCritical(degreesOfFreedom) * standardError;
+            double scale = baselineMean == 0 ? 0 : 100.0 / baselineMean;
+
+            var result = new SampleComparison
+            {
+                BaselineMean = baselineMean,
+                BaselineStdDev = Math.Sqrt(baselineVariance),
+                CandidateMean = candidateMean,
+                CandidateStdDev = Math.Sqrt(candidateVariance),
+                DifferencePercent = difference * scale,
+                DifferenceLowPercent = (difference - margin) * scale,
+                DifferenceHighPercent = (difference + margin) * scale,
+                TStatistic = standardError > 0 ? difference / standardError : 0,
+            };
+
+            result.Significant =
+                baseline.Count >= 2 &&
+                candidate.Count >= 1 &&
+                (difference - margin > 0 || difference + margin < 0) &&
+                Math.Abs(result.DifferencePercent) >= thresholdPercent;
+
+            return result;
+        }
+
+        /// <summary>
+        /// Finds the indexes in the series (oldest first) where its level
+        /// significantly changes. Each segment between change points has at
+        /// least minSegmentLength values.
+        /// </summary>
+        public static IReadOnlyList<int> FindChangePoints(IReadOnlyList<double> series, int minSegmentLength, double thresholdPercent)
+        {
+            if (series == null)
+            {
+                throw new ArgumentNullException(nameof(series));
+            }
+
+            var changePoints = new List<int>();
+            FindChangePoints(series, 0, series.Count, Math.Max(2, minSegmentLength), thresholdPercent, changePoints);
+            changePoints.Sort();
+            return changePoints;
+        }
+
+        private static void FindChangePoints(IReadOnlyList<double> series, int start, int end, int minSegmentLength, double thresholdPercent, List<int> changePoints)
+        {
+            int bestSplit = -1;
+            double bestScore = 0;
+
+            for (int split = start + minSegmentLength; split <= end - minSegmentLength; split++)
+            {
+                var before = Slice(series, start, split);
+                var after = Slice(series, split, end);
+                double beforeMean = Mean(before);
+                double changePercent = beforeMean == 0 ? 0 : (Mean(after) - beforeMean) * 100.0 / beforeMean;
+                if (Math.Abs(changePercent) < thresholdPercent)
+                {
+                    continue;
+                }
+
+                //
+                // Both sides of a split are taken to have the same noise, so
+                // a short segment that happens to have little spread doesn't
+                // look like a change by itself.
+                //
+                double pooledVariance =
+                    (Variance(before) * (before.Length - 1) + Variance(after) * (after.Length - 1)) /
+                    (before.Length + after.Length - 2);
+                double standardError = Math.Sqrt(pooledVariance * (1.0 / before.Length + 1.0 / after.Length));
+                double score =
+                    standardError > 0 ? Math.Abs(Mean(after) - beforeMean) / standardError : double.MaxValue;
+                if (score < ChangePointTStatistic)
+                {
+                    continue;
+                }
+
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestSplit = split;
+                }
+            }
+
+            if (bestSplit < 0)
+            {
+                return;
+            }
+
+            changePoints.Add(bestSplit);
+            FindChangePoints(series, start, bestSplit, minSegmentLength, thresholdPercent, changePoints);
+            FindChangePoints(series, bestSplit, end, minSegmentLength, thresholdPercent, changePoints);
+        }
+
+        private static double[] Slice(IReadOnlyList<double> series, int start, int end)
+        {
+            var slice = new double[end - start];
+            for (int i = start; i < end; i++)
+            {
+                slice[i - start] = series[i];
+            }
+            return slice;
+        }
+    }
+}
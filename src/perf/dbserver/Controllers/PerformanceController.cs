@@ -12,6 +12,7 @@ using Microsoft.AspNetCore.Mvc;
 using Microsoft.EntityFrameworkCore;
 using Microsoft.Extensions.Configuration;
 using Microsoft.Extensions.Logging;
+using QuicDataServer.Analysis;
 using QuicDataServer.Data;
 using QuicDataServer.Models;
 using QuicDataServer.Models.Db;
@@ -122,6 +123,183 @@ namespace QuicDataServer.Controllers
                 .ToListAsync();
         }
 
+        private class SeriesEntry
+        {
+            public string CommitHash { get; set; } = null!;
+            public DateTime TestDate { get; set; }
+            public int DbMachineId { get; set; }
+            public IReadOnlyList<double> Results { get; set; } = null!;
+        }
+
+        private async Task<List<SeriesEntry>> GetSeries(string platform, string test, int? machineId, DateTime? before, int numResults)
+        {
+            var records = await _context.Platforms.Where(x => x.PlatformName == platform)
+                .SelectMany(x => x.Tests)
+                .Where(x => x.TestName == test)
+                .SelectMany(x => x.TestRecords)
+                .Where(x => machineId == null || x.DbMachineId == machineId)
+                .Where(x => before == null || x.TestDate < before)
+                .OrderByDescending(x => x.TestDate)
+                .Take(numResults)
+                .Select(x => new
+                {
+                    x.CommitHash,
+                    x.TestDate,
+                    x.DbMachineId,
+                    Results = x.TestResults.Select(y => y.Result)
+                })
+                .ToListAsync();
+
+            return records.Select(x => new SeriesEntry
+            {
+                CommitHash = x.CommitHash,
+                TestDate = x.TestDate,
+                DbMachineId = x.DbMachineId,
+                Results = x.Results.ToList()
+            })
+            .Where(x => x.Results.Count != 0)
+            .ToList();
+        }
+
+        private async Task<int?> GetMachineId(string? machine)
+        {
+            if (string.IsNullOrWhiteSpace(machine))
+            {
+                return null;
+            }
+            return await _context.Machines.Where(x => x.MachineName == machine)
+                .Select(x => (int?)x.DbMachineId)
+                .FirstOrDefaultAsync();
+        }
+
+        /// <summary>
+        /// Compares the results for a commit against the distribution of the results before it, on the same machine.
+        /// </summary>
+        /// <remarks>
+        /// The baseline is the mean of each of the previous baselineCount test records. The change is significant if
+        /// its 95% confidence interval excludes zero and it is at least thresholdPercent. Results are taken as higher
+        /// is better (throughput, RPS) unless lowerIsBetter is set.
+        /// </remarks>
+        /// <param name="platform">The platform</param>
+        /// <param name="test">The test</param>
+        /// <param name="commitHash">The commit to check</param>
+        /// <param name="machine">The machine, or the one the commit's latest result is from</param>
+        /// <param name="baselineCount">The number of previous test records to compare against</param>
+        /// <param name="thresholdPercent">The smallest change to flag</param>
+        /// <param name="lowerIsBetter">Whether smaller results are better</param>
+        /// <returns>The comparison</returns>
+        /// <response code="200">On success</response>
+        /// <response code="404">No result for the commit</response>
+        [HttpGet("{platform}/{test}/compare/{commitHash}")]
+        [ProducesResponseType(StatusCodes.Status200OK)]
+        [ProducesResponseType(StatusCodes.Status404NotFound)]
+        public async Task<ActionResult<RegressionResult>> CompareCommit(string platform, string test, string commitHash,
+            [FromQuery] string? machine = null, [FromQuery] int baselineCount = 20,
+            [FromQuery] double thresholdPercent = 2.0, [FromQuery] bool lowerIsBetter = false)
+        {
+            var machineId = await GetMachineId(machine);
+            if (!string.IsNullOrWhiteSpace(machine) && machineId == null)
+            {
+                return NotFound();
+            }
+
+            var candidate = await _context.Platforms.Where(x => x.PlatformName == platform)
+                .SelectMany(x => x.Tests)
+                .Where(x => x.TestName == test)
+                .SelectMany(x => x.TestRecords)
+                .Where(x => x.CommitHash == commitHash && (machineId == null || x.DbMachineId == machineId))
+                .OrderByDescending(x => x.TestDate)
+                .Select(x => new
+                {
+                    x.TestDate,
+                    x.DbMachineId,
+                    Results = x.TestResults.Select(y => y.Result)
+                })
+                .FirstOrDefaultAsync();
+            if (candidate == null)
+            {
+                return NotFound();
+            }
+
+            var baseline = await GetSeries(platform, test, candidate.DbMachineId, candidate.TestDate, Math.Max(1, baselineCount));
+            var comparison = RegressionDetector.Compare(
+                baseline.Select(x => RegressionDetector.Mean(x.Results)).ToList(),
+                candidate.Results.ToList(),
+                thresholdPercent);
+
+            return new RegressionResult
+            {
+                MachineName = await _context.Machines.Where(y => y.DbMachineId == candidate.DbMachineId).Select(y => y.MachineName).FirstAsync(),
+                PlatformName = platform,
+                TestName = test,
+                CommitHash = commitHash,
+                ResultDate = candidate.TestDate,
+                BaselineRecordCount = baseline.Count,
+                BaselineMean = comparison.BaselineMean,
+                BaselineStdDev = comparison.BaselineStdDev,
+                CandidateMean = comparison.CandidateMean,
+                CandidateStdDev = comparison.CandidateStdDev,
+                ChangePercent = comparison.DifferencePercent,
+                ChangeLowPercent = comparison.DifferenceLowPercent,
+                ChangeHighPercent = comparison.DifferenceHighPercent,
+                Significant = comparison.Significant,
+                Regression = comparison.Significant && (comparison.DifferencePercent < 0) != lowerIsBetter
+            };
+        }
+
+        /// <summary>
+        /// Finds the points where the results of a test on a machine significantly changed.
+        /// </summary>
+        /// <param name="platform">The platform</param>
+        /// <param name="test">The test</param>
+        /// <param name="machine">The machine</param>
+        /// <param name="numResults">The number of most recent test records to search</param>
+        /// <param name="minSegmentLength">The fewest test records between change points</param>
+        /// <param name="thresholdPercent">The smallest change to report</param>
+        /// <param name="lowerIsBetter">Whether smaller results are better</param>
+        /// <returns>The change points, oldest first</returns>
+        /// <response code="200">On success</response>
+        /// <response code="404">Unknown machine</response>
+        [HttpGet("{platform}/{test}/changePoints/{machine}")]
+        [ProducesResponseType(StatusCodes.Status200OK)]
+        [ProducesResponseType(StatusCodes.Status404NotFound)]
+        public async Task<ActionResult<IEnumerable<ChangePoint>>> GetChangePoints(string platform, string test, string machine,
+            [FromQuery] int numResults = 100, [FromQuery] int minSegmentLength = 5,
+            [FromQuery] double thresholdPercent = 2.0, [FromQuery] bool lowerIsBetter = false)
+        {
+            var machineId = await GetMachineId(machine);
+            if (machineId == null)
+            {
+                return NotFound();
+            }
+
+            var series = await GetSeries(platform, test, machineId, null, Math.Max(1, numResults));
+            series.Reverse();
+            var means = series.Select(x => RegressionDetector.Mean(x.Results)).ToList();
+
+            var changePoints = new List<ChangePoint>();
+            var indexes = RegressionDetector.FindChangePoints(means, minSegmentLength, thresholdPercent);
+            for (int i = 0; i < indexes.Count; i++)
+            {
+                int start = i == 0 ? 0 : indexes[i - 1];
+                int end = i == indexes.Count - 1 ? means.Count : indexes[i + 1];
+                double before = means.Skip(start).Take(indexes[i] - start).Average();
+                double after = means.Skip(indexes[i]).Take(end - indexes[i]).Average();
+                double changePercent = before == 0 ? 0 : (after - before) * 100.0 / before;
+                changePoints.Add(new ChangePoint
+                {
+                    CommitHash = series[indexes[i]].CommitHash,
+                    ResultDate = series[indexes[i]].TestDate,
+                    MeanBefore = before,
+                    MeanAfter = after,
+                    ChangePercent = changePercent,
+                    Regression = (changePercent < 0) != lowerIsBetter
+                });
+            }
+
+            return Ok(changePoints);
+        }
+
         private bool Authorize(IAuthorizable authorization)
         {
             return authorization.AuthKey == _configuration["ApiAuthorizationKey"];
@@ -0,0 +1,20 @@
+﻿// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.ComponentModel.DataAnnotations;
+
+namespace QuicDataServer.Models
+{
+    public class ChangePoint
+    {
+        [Required]
+        public string CommitHash { get; set; } = null!;
+        [Required]
+        public DateTime ResultDate { get; set; }
+        public double MeanBefore { get; set; }
+        public double MeanAfter { get; set; }
+        public double ChangePercent { get; set; }
+        public bool Regression { get; set; }
+    }
+}
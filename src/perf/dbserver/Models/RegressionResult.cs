@@ -0,0 +1,32 @@
+﻿// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.ComponentModel.DataAnnotations;
+
+namespace QuicDataServer.Models
+{
+    public class RegressionResult
+    {
+        [Required]
+        public string MachineName { get; set; } = null!;
+        [Required]
+        public string PlatformName { get; set; } = null!;
+        [Required]
+        public string TestName { get; set; } = null!;
+        [Required]
+        public string CommitHash { get; set; } = null!;
+        [Required]
+        public DateTime ResultDate { get; set; }
+        public int BaselineRecordCount { get; set; }
+        public double BaselineMean { get; set; }
+        public double BaselineStdDev { get; set; }
+        public double CandidateMean { get; set; }
+        public double CandidateStdDev { get; set; }
+        public double ChangePercent { get; set; }
+        public double ChangeLowPercent { get; set; }
+        public double ChangeHighPercent { get; set; }
+        public bool Significant { get; set; }
+        public bool Regression { get; set; }
+    }
+}
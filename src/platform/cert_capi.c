@@ -839,6 +839,221 @@ Exit:
     return Status;
 }
 
+//
+// Cache of successfully validated chains, so that repeated handshakes with the
+// same server don't rebuild and verify the chain each time. Entries are keyed
+// by a SHA-256 over the leaf, the intermediates the peer sent, the server name
+// and the ignore flags, and are direct mapped into a fixed number of slots.
+//
+#define QUIC_CERT_VALIDATION_CACHE_SIZE     256 // Must be a power of 2
+#define QUIC_CERT_VALIDATION_CACHE_KEY_SIZE 32
+
+//
+// How long a validation result is trusted before the chain (and revocation
+// status) is checked again, in 100ns units.
+//
+#define QUIC_CERT_VALIDATION_CACHE_LIFETIME (5ull * 60 * 1000 * 1000 * 10)
+
+typedef struct QUIC_CERT_VALIDATION_CACHE_ENTRY {
+    uint64_t Expiration; // FILETIME; zero when unused.
+    BYTE Key[QUIC_CERT_VALIDATION_CACHE_KEY_SIZE];
+} QUIC_CERT_VALIDATION_CACHE_ENTRY;
+
+static SRWLOCK QuicCertValidationCacheLock = SRWLOCK_INIT;
+static QUIC_CERT_VALIDATION_CACHE_ENTRY
+    QuicCertValidationCache[QUIC_CERT_VALIDATION_CACHE_SIZE];
+
+static
+uint64_t
+QuicCertFileTimeToUInt64(
+    _In_ const FILETIME* Time
+    )
+{
+    return ((uint64_t)Time->dwHighDateTime << 32) | Time->dwLowDateTime;
+}
+
+static
+_Success_(return != FALSE)
+BOOLEAN
+QuicCertValidationCacheComputeKey(
+    _In_ PCCERT_CONTEXT LeafCertCtx,
+    _In_opt_z_ PCSTR Host,
+    _In_ uint32_t IgnoreFlags,
+    _Out_writes_all_(QUIC_CERT_VALIDATION_CACHE_KEY_SIZE) BYTE* Key
+    )
+{
+    BOOLEAN Result = FALSE;
+    BCRYPT_HASH_HANDLE HashHandle = NULL;
+
+    NTSTATUS Status =
+        BCryptCreateHash(
+            BCRYPT_SHA256_ALG_HANDLE,
+            &HashHandle,
+            NULL,
+            0,
+            NULL,
+            0,
+            0);
+    if (!NT_SUCCESS(Status)) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "BCryptCreateHash failed");
+        goto Exit;
+    }
+
+    Status =
+        BCryptHashData(
+            HashHandle,
+            LeafCertCtx->pbCertEncoded,
+            LeafCertCtx->cbCertEncoded,
+            0);
+    if (!NT_SUCCESS(Status)) {
+        goto HashError;
+    }
+
+    if (LeafCertCtx->hCertStore != NULL) {
+        PCCERT_CONTEXT CertCtx = NULL;
+        while ((CertCtx =
+            CertEnumCertificatesInStore(LeafCertCtx->hCertStore, CertCtx)) != NULL) {
+            if (CertCtx->cbCertEncoded == LeafCertCtx->cbCertEncoded &&
+                memcmp(
+                    CertCtx->pbCertEncoded,
+                    LeafCertCtx->pbCertEncoded,
+                    CertCtx->cbCertEncoded) == 0) {
+                continue;
+            }
+            Status =
+                BCryptHashData(
+                    HashHandle,
+                    CertCtx->pbCertEncoded,
+                    CertCtx->cbCertEncoded,
+                    0);
+            if (!NT_SUCCESS(Status)) {
+                CertFreeCertificateContext(CertCtx);
+                goto HashError;
+            }
+        }
+    }
+
+    if (Host != NULL) {
+        Status =
+            BCryptHashData(
+                HashHandle,
+                (PUCHAR)Host,
+                (ULONG)strlen(Host) + 1,
+                0);
+        if (!NT_SUCCESS(Status)) {
+            goto HashError;
+        }
+    }
+
+    Status =
+        BCryptHashData(
+            HashHandle,
+            (PUCHAR)&IgnoreFlags,
+            sizeof(IgnoreFlags),
+            0);
+    if (!NT_SUCCESS(Status)) {
+        goto HashError;
+    }
+
+    Status =
+        BCryptFinishHash(
+            HashHandle,
+            Key,
+            QUIC_CERT_VALIDATION_CACHE_KEY_SIZE,
+            0);
+    if (!NT_SUCCESS(Status)) {
+        goto HashError;
+    }
+
+    Result = TRUE;
+    goto Exit;
+
+HashError:
+
+    QuicTraceEvent(
+        LibraryErrorStatus,
+        "[ lib] ERROR, %u, %s.",
+        Status,
+        "Hashing the cert chain failed");
+
+Exit:
+
+    if (HashHandle != NULL) {
+        BCryptDestroyHash(HashHandle);
+    }
+
+    return Result;
+}
+
+static
+QUIC_CERT_VALIDATION_CACHE_ENTRY*
+QuicCertValidationCacheSlot(
+    _In_reads_(QUIC_CERT_VALIDATION_CACHE_KEY_SIZE) const BYTE* Key
+    )
+{
+    uint32_t Index;
+    memcpy(&Index, Key, sizeof(Index));
+    return &QuicCertValidationCache[Index & (QUIC_CERT_VALIDATION_CACHE_SIZE - 1)];
+}
+
+static
+BOOLEAN
+QuicCertValidationCacheLookup(
+    _In_reads_(QUIC_CERT_VALIDATION_CACHE_KEY_SIZE) const BYTE* Key
+    )
+{
+    FILETIME Now;
+    GetSystemTimeAsFileTime(&Now);
+
+    QUIC_CERT_VALIDATION_CACHE_ENTRY* Entry = QuicCertValidationCacheSlot(Key);
+    AcquireSRWLockShared(&QuicCertValidationCacheLock);
+    BOOLEAN Found =
+        Entry->Expiration > QuicCertFileTimeToUInt64(&Now) &&
+        memcmp(Entry->Key, Key, QUIC_CERT_VALIDATION_CACHE_KEY_SIZE) == 0;
+    ReleaseSRWLockShared(&QuicCertValidationCacheLock);
+
+    return Found;
+}
+
+static
+void
+QuicCertValidationCacheInsert(
+    _In_reads_(QUIC_CERT_VALIDATION_CACHE_KEY_SIZE) const BYTE* Key,
+    _In_ PCCERT_CHAIN_CONTEXT ChainContext
+    )
+{
+    FILETIME Now;
+    GetSystemTimeAsFileTime(&Now);
+
+    //
+    // Never trust the result past the first certificate in the chain to
+    // expire.
+    //
+    uint64_t Expiration =
+        QuicCertFileTimeToUInt64(&Now) + QUIC_CERT_VALIDATION_CACHE_LIFETIME;
+    for (DWORD i = 0; i < ChainContext->cChain; ++i) {
+        PCERT_SIMPLE_CHAIN SimpleChain = ChainContext->rgpChain[i];
+        for (DWORD j = 0; j < SimpleChain->cElement; ++j) {
+            uint64_t NotAfter =
+                QuicCertFileTimeToUInt64(
+                    &SimpleChain->rgpElement[j]->pCertContext->pCertInfo->NotAfter);
+            if (NotAfter < Expiration) {
+                Expiration = NotAfter;
+            }
+        }
+    }
+
+    QUIC_CERT_VALIDATION_CACHE_ENTRY* Entry = QuicCertValidationCacheSlot(Key);
+    AcquireSRWLockExclusive(&QuicCertValidationCacheLock);
+    memcpy(Entry->Key, Key, QUIC_CERT_VALIDATION_CACHE_KEY_SIZE);
+    Entry->Expiration = Expiration;
+    ReleaseSRWLockExclusive(&QuicCertValidationCacheLock);
+}
+
 _Success_(return != FALSE)
 BOOLEAN
 QuicCertValidateChain(
@@ -861,6 +1076,17 @@ QuicCertValidateChain(
         szOID_SGC_NETSCAPE
     };
 
+    BYTE CacheKey[QUIC_CERT_VALIDATION_CACHE_KEY_SIZE];
+    BOOLEAN CacheKeyValid =
+        QuicCertValidationCacheComputeKey(
+            LeafCertCtx,
+            Host,
+            IgnoreFlags,
+            CacheKey);
+    if (CacheKeyValid && QuicCertValidationCacheLookup(CacheKey)) {
+        return TRUE;
+    }
+
     memset(&ChainPara, 0, sizeof(ChainPara));
     ChainPara.cbSize = sizeof(ChainPara);
     ChainPara.RequestedUsage.dwType = USAGE_MATCH_TYPE_OR;
@@ -923,6 +1149,10 @@ QuicCertValidateChain(
             ServerName,
             IgnoreFlags);
 
+    if (Result && CacheKeyValid) {
+        QuicCertValidationCacheInsert(CacheKey, ChainContext);
+    }
+
 Exit:
 
     if (ChainContext != NULL) {
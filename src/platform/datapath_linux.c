@@ -17,24 +17,161 @@ Environment:
 #include "platform_internal.h"
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <poll.h>
 #include <inttypes.h>
 #include <linux/in6.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
+#include <signal.h>
 #include "quic_platform_dispatch.h"
 #ifdef QUIC_CLOG
 #include "datapath_linux.c.clog.h"
 #endif
 
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
 QUIC_STATIC_ASSERT((SIZEOF_STRUCT_MEMBER(QUIC_BUFFER, Length) <= sizeof(size_t)), "(sizeof(QUIC_BUFFER.Length) == sizeof(size_t) must be TRUE.");
 QUIC_STATIC_ASSERT((SIZEOF_STRUCT_MEMBER(QUIC_BUFFER, Buffer) == sizeof(void*)), "(sizeof(QUIC_BUFFER.Buffer) == sizeof(void*) must be TRUE.");
 
 //
-// TODO: Support batching.
+// The maximum number of UDP datagrams that can be sent with one call.
+//
+#define QUIC_MAX_BATCH_SEND 7
+
+//
+// The maximum number of UDP datagrams, from any number of send contexts, that
+// QuicDataPathBindingSendBatch submits with one call.
+//
+#define QUIC_MAX_MULTI_SEND 32
+
+//
+// The size of the control data sent with each datagram: the source address
+// and, optionally, the segment size, the ECN codepoint and the departure time.
+//
+#define QUIC_SEND_CONTROL_BUFFER_SIZE \
+    (CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(uint16_t)) + \
+     CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(uint64_t)))
+
+//
+// The maximum number of UDP datagrams that can be received with one call.
+//
+#define QUIC_MAX_RECEIVE_BATCH_COUNT 32
+
+//
+// The maximum number of (coalesced) receive buffers that can be received with
+// one call, when UDP receive coalescing (GRO) is enabled.
+//
+#define QUIC_MAX_COALESCED_RECEIVE_BATCH_COUNT 4
+
+//
+// The maximum UDP receive coalescing payload.
+//
+#define MAX_GRO_PAYLOAD_LENGTH (UINT16_MAX - QUIC_UDP_HEADER_SIZE)
+
+//
+// The maximum number of UDP datagrams to preallocate for GRO.
+//
+#define GRO_MAX_DATAGRAMS_PER_INDICATION 64
+
+#ifdef QUIC_LINUX_IO_URING
+//
+// The number of submission queue entries for each per-processor io_uring.
+//
+#define QUIC_URING_ENTRY_COUNT 4096
+
+//
+// The types of operations posted to a per-processor io_uring.
+//
+#define QUIC_URING_OP_RECV          0
+#define QUIC_URING_OP_SEND_READY    1
+#define QUIC_URING_OP_CLEANUP       2
+#define QUIC_URING_OP_CANCEL        3
+
+//
+// Context for a single operation posted to a per-processor io_uring. Its
+// address is used as the submission's user data.
+//
+typedef struct QUIC_URING_OPERATION {
+    //
+    // The socket context the operation was posted for.
+    //
+    struct QUIC_SOCKET_CONTEXT* SocketContext;
+
+    //
+    // One of the QUIC_URING_OP_* values.
+    //
+    uint8_t Type;
+
+    //
+    // The receive slot, for QUIC_URING_OP_RECV operations.
+    //
+    uint8_t Index;
+
+    //
+    // Indicates the operation has been posted and has not completed yet.
+    //
+    BOOLEAN Pending;
+
+} QUIC_URING_OPERATION;
+
+//
+// Shared context for cancel requests, whose completions are ignored.
+//
+static QUIC_URING_OPERATION QuicUringCancelOperation = {
+    NULL, QUIC_URING_OP_CANCEL, 0, FALSE
+};
+#endif
+
+#ifdef QUIC_LINUX_XDP
+//
+// The maximum number of frames taken off an AF_XDP socket's RX ring at once.
+//
+#define QUIC_XDP_RECEIVE_BATCH_COUNT 32
+
+//
+// The number of entries in the AF_XDP neighbor cache.
+//
+#define QUIC_XDP_NEIGHBOR_COUNT 256
+
+//
+// The state of a datapath's AF_XDP fast path.
+//
+#define QUIC_XDP_STATE_UNINITIALIZED    0
+#define QUIC_XDP_STATE_ACTIVE           1
+#define QUIC_XDP_STATE_FAILED           2
+
+//
+// The link-layer address frames from a remote IPv4 address were last received
+// from, i.e. the next hop for sends back to it.
+//
+typedef struct QUIC_XDP_NEIGHBOR {
+    uint32_t Address;
+    uint8_t MacAddress[6];
+} QUIC_XDP_NEIGHBOR;
+
+QUIC_STATIC_ASSERT(
+    QUIC_XDP_HEADERS_LENGTH + MAX_UDP_PAYLOAD_LENGTH <= QUIC_XDP_FRAME_SIZE,
+    "Send datagrams must fit in a single UMEM frame");
+#endif
+
+//
+// The maximum single buffer size for sending coalesced payloads.
+//
+#define QUIC_LARGE_SEND_BUFFER_SIZE (UINT16_MAX - QUIC_MIN_IPV4_HEADER_SIZE - QUIC_UDP_HEADER_SIZE)
+
+//
+// The maximum number of segments the kernel accepts in a single segmentation
+// offload (UDP_SEGMENT) send.
 //
-#define QUIC_MAX_BATCH_SEND 1
+#define QUIC_MAX_SEND_SEGMENT_COUNT 64
 
 //
-// A receive block to receive a UDP packet over the sockets.
+// A receive block to receive a UDP packet (or a coalesced set of UDP packets)
+// over the sockets.
 //
 typedef struct QUIC_DATAPATH_RECV_BLOCK {
     //
@@ -43,9 +180,10 @@ typedef struct QUIC_DATAPATH_RECV_BLOCK {
     QUIC_POOL* OwningPool;
 
     //
-    // The recv buffer used by MsQuic.
+    // The number of datagrams indicated from this block that haven't been
+    // returned yet.
     //
-    QUIC_RECV_DATAGRAM RecvPacket;
+    long ReferenceCount;
 
     //
     // Represents the address (source and destination) information of the
@@ -53,18 +191,41 @@ typedef struct QUIC_DATAPATH_RECV_BLOCK {
     //
     QUIC_TUPLE Tuple;
 
+#ifdef QUIC_LINUX_XDP
     //
-    // Buffer that actually stores the UDP payload.
+    // The AF_XDP socket and UMEM frame holding the payload, if the datagram
+    // was received over AF_XDP. The block then has no payload buffer of its
+    // own.
     //
-    uint8_t Buffer[MAX_UDP_PAYLOAD_LENGTH];
+    QUIC_XDP_SOCKET* XdpSocket;
+    uint64_t XdpFrame;
+#endif
 
     //
-    // This follows the recv block.
+    // This is followed by an array of Datapath->DatagramStride sized
+    // elements, each containing:
     //
+    // QUIC_RECV_DATAGRAM RecvPacket;
+    // QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT InternalContext;
     // QUIC_RECV_PACKET RecvContext;
+    //
+    // The buffer that actually stores the UDP payload then starts at
+    // Datapath->RecvPayloadOffset.
+    //
 
 } QUIC_DATAPATH_RECV_BLOCK;
 
+//
+// Internal per-datagram receive context.
+//
+typedef struct QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT {
+    //
+    // The recv block owning the datagram.
+    //
+    QUIC_DATAPATH_RECV_BLOCK* RecvBlock;
+
+} QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT;
+
 //
 // Send context.
 //
@@ -100,6 +261,22 @@ typedef struct QUIC_DATAPATH_SEND_CONTEXT {
     //
     struct QUIC_DATAPATH_PROC_CONTEXT *Owner;
 
+    //
+    // The send segmentation size; zero if segmentation is not performed.
+    //
+    uint16_t SegmentSize;
+
+    //
+    // The ECN codepoint to mark the datagrams with.
+    //
+    uint8_t ECN;
+
+    //
+    // The departure time (in microseconds, on the QuicTimeUs64 clock) of the
+    // datagrams allocated from now on; zero to send them immediately.
+    //
+    uint64_t TxTime;
+
     //
     // BufferCount - The buffer count in use.
     //
@@ -117,6 +294,24 @@ typedef struct QUIC_DATAPATH_SEND_CONTEXT {
     QUIC_BUFFER Buffers[QUIC_MAX_BATCH_SEND];
     struct iovec Iovs[QUIC_MAX_BATCH_SEND];
 
+    //
+    // The departure time of each of the Buffers. All the segments of a buffer
+    // leave at the same time.
+    //
+    uint64_t TxTimes[QUIC_MAX_BATCH_SEND];
+
+    //
+    // The QUIC_BUFFER returned to the client for segmented sends.
+    //
+    QUIC_BUFFER ClientBuffer;
+
+#ifdef QUIC_LINUX_XDP
+    //
+    // The AF_XDP socket whose UMEM frames back Buffers, if any.
+    //
+    QUIC_XDP_SOCKET* XdpSocket;
+#endif
+
 } QUIC_DATAPATH_SEND_CONTEXT;
 
 //
@@ -152,30 +347,65 @@ typedef struct QUIC_SOCKET_CONTEXT {
     BOOLEAN SendWaiting;
 
     //
-    // The I/O vector for receive datagrams.
+    // The I/O vectors for receive datagrams.
     //
-    struct iovec RecvIov;
+    struct iovec RecvIovs[QUIC_MAX_RECEIVE_BATCH_COUNT];
 
     //
-    // The control buffer used in RecvMsgHdr.
+    // The control buffers used in RecvMsgHdrs.
     //
-    char RecvMsgControl[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+    char RecvMsgControl[QUIC_MAX_RECEIVE_BATCH_COUNT][
+        CMSG_SPACE(sizeof(struct in6_pktinfo)) +
+        CMSG_SPACE(sizeof(int)) +
+        CMSG_SPACE(sizeof(int)) +
+        CMSG_SPACE(sizeof(struct timespec))];
 
     //
-    // The buffer used to receive msg headers on socket.
+    // The buffers used to receive msg headers on socket with recvmmsg.
     //
-    struct msghdr RecvMsgHdr;
+    struct mmsghdr RecvMsgHdrs[QUIC_MAX_RECEIVE_BATCH_COUNT];
 
     //
-    // The receive block currently being used for receives on this socket.
+    // The receive blocks currently being used for receives on this socket. A
+    // NULL entry has been indicated up and must be replaced before the
+    // corresponding msg header can be used again.
     //
-    QUIC_DATAPATH_RECV_BLOCK* CurrentRecvBlock;
+    QUIC_DATAPATH_RECV_BLOCK* CurrentRecvBlocks[QUIC_MAX_RECEIVE_BATCH_COUNT];
 
     //
     // The head of list containg all pending sends on this socket.
     //
     QUIC_LIST_ENTRY PendingSendContextHead;
 
+#ifdef QUIC_LINUX_IO_URING
+    //
+    // The io_uring operations for each receive slot.
+    //
+    QUIC_URING_OPERATION RecvOperations[QUIC_MAX_RECEIVE_BATCH_COUNT];
+
+    //
+    // The io_uring operation waiting for the socket to be write ready.
+    //
+    QUIC_URING_OPERATION SendReadyOperation;
+
+    //
+    // The io_uring operation waiting on the cleanup event FD.
+    //
+    QUIC_URING_OPERATION CleanupOperation;
+
+    //
+    // The number of io_uring operations posted for this socket that haven't
+    // completed yet.
+    //
+    long OutstandingUringOperations;
+
+    //
+    // Indicates the cleanup event was signaled and outstanding operations are
+    // being cancelled.
+    //
+    BOOLEAN UringCleanupStarted;
+#endif
+
 } QUIC_SOCKET_CONTEXT;
 
 //
@@ -218,13 +448,38 @@ typedef struct QUIC_DATAPATH_BINDING {
     //
     BOOLEAN Shutdown : 1;
 
+#ifdef QUIC_LINUX_XDP
+    //
+    // Indicates the binding receives (and, when possible, sends) over AF_XDP.
+    //
+    BOOLEAN Xdp : 1;
+
+    //
+    // Link in the datapath's list of AF_XDP bindings.
+    //
+    QUIC_LIST_ENTRY XdpLink;
+#endif
+
     //
     // The MTU for this binding.
     //
     uint16_t Mtu;
 
     //
-    // Set of socket contexts one per proc.
+    // The number of socket contexts. Connected (client) bindings only have
+    // one, served by the processor the binding was created on, instead of one
+    // per processor.
+    //
+    uint32_t SocketCount;
+
+    //
+    // The index of the processor context serving the first socket context.
+    // Socket context i is served by processor context ProcIndex + i.
+    //
+    uint32_t ProcIndex;
+
+    //
+    // Set of socket contexts, one per proc for unconnected bindings.
     //
     QUIC_SOCKET_CONTEXT SocketContexts[];
 
@@ -255,11 +510,33 @@ typedef struct QUIC_DATAPATH_PROC_CONTEXT {
     //
     uint32_t Index;
 
+    //
+    // TRUE once the epoll (or io_uring) instance, event FD and thread have been
+    // created. This is deferred until a binding or poll callback first needs
+    // the processor, so that short lived clients don't pay for a thread on
+    // every processor.
+    //
+    BOOLEAN volatile Started;
+
     //
     // The epoll wait thread.
     //
     QUIC_THREAD EpollWaitThread;
 
+    //
+    // Work run to completion on the epoll wait thread, after each batch of
+    // events. Protected by PollLock, which is held while it runs.
+    //
+    QUIC_LOCK PollLock;
+    QUIC_DATAPATH_POLL_CALLBACK_HANDLER PollCallback;
+    void* PollContext;
+
+    //
+    // TRUE once the epoll wait thread has been affinitized to its processor,
+    // which is done the first time it runs a poll callback.
+    //
+    BOOLEAN PollAffinitized;
+
     //
     // Pool of receive packet contexts and buffers to be shared by all sockets
     // on this core.
@@ -271,11 +548,42 @@ typedef struct QUIC_DATAPATH_PROC_CONTEXT {
     //
     QUIC_POOL SendBufferPool;
 
+    //
+    // Pool of large segmented send buffers to be shared by all sockets on this
+    // core.
+    //
+    QUIC_POOL LargeSendBufferPool;
+
     //
     // Pool of send contexts to be shared by all sockets on this core.
     //
     QUIC_POOL SendContextPool;
 
+#ifdef QUIC_LINUX_IO_URING
+    //
+    // The io_uring used instead of epoll, when supported.
+    //
+    QUIC_URING Ring;
+
+    //
+    // Serializes queuing submissions to Ring.
+    //
+    QUIC_LOCK RingLock;
+#endif
+
+#ifdef QUIC_LINUX_XDP
+    //
+    // The AF_XDP socket for the receive queue with the same index, if any.
+    //
+    QUIC_XDP_SOCKET* XdpSocket;
+
+    //
+    // Pool of receive blocks (without payload buffers) for datagrams received
+    // over XdpSocket.
+    //
+    QUIC_POOL XdpRecvBlockPool;
+#endif
+
 } QUIC_DATAPATH_PROC_CONTEXT;
 
 //
@@ -288,12 +596,64 @@ typedef struct QUIC_DATAPATH {
     //
     BOOLEAN volatile Shutdown;
 
+    //
+    // Set of supported features.
+    //
+    uint32_t Features;
+
+#ifdef QUIC_LINUX_IO_URING
+    //
+    // Indicates the io_uring backend is used instead of epoll.
+    //
+    BOOLEAN UseUring;
+#endif
+
     //
     // The max send batch size.
-    // TODO: See how send batching can be enabled.
     //
     uint8_t MaxSendBatchSize;
 
+    //
+    // The time (in us) to spin polling for events before blocking.
+    //
+    uint32_t BusyPollUs;
+
+    //
+    // Connection ID steering applied to new server bindings. Unused if
+    // CidSteering.CidLength is zero.
+    //
+    QUIC_DATAPATH_CID_STEERING CidSteering;
+
+#ifdef QUIC_LINUX_XDP
+    //
+    // The AF_XDP fast path. It is set up on the interface of the first server
+    // binding to a specific IPv4 address; later bindings on other interfaces
+    // only use sockets. XdpLock serializes setup and address registration.
+    //
+    QUIC_LOCK XdpLock;
+    uint8_t XdpState;
+    QUIC_XDP_PROGRAM XdpProgram;
+
+    //
+    // The bindings receiving over AF_XDP. Held shared while indicating
+    // datagrams received over AF_XDP.
+    //
+    QUIC_RW_LOCK XdpBindingsLock;
+    QUIC_LIST_ENTRY XdpBindings;
+
+    //
+    // Next hop cache for AF_XDP sends, indexed by a hash of the remote IPv4
+    // address.
+    //
+    QUIC_LOCK XdpNeighborLock;
+    QUIC_XDP_NEIGHBOR XdpNeighbors[QUIC_XDP_NEIGHBOR_COUNT];
+#endif
+
+    //
+    // Serializes starting the processor contexts.
+    //
+    QUIC_LOCK ProcStartLock;
+
     //
     // A reference rundown on the datapath binding.
     //
@@ -314,6 +674,28 @@ typedef struct QUIC_DATAPATH {
     //
     size_t ClientRecvContextLength;
 
+    //
+    // The size of each receive datagram array element, including client
+    // context, internal context, and padding.
+    //
+    uint32_t DatagramStride;
+
+    //
+    // The offset of the receive payload buffer from the start of the receive
+    // block.
+    //
+    uint32_t RecvPayloadOffset;
+
+    //
+    // The length of the receive payload buffer.
+    //
+    uint32_t RecvPayloadLength;
+
+    //
+    // The number of receive buffers armed per socket for each recvmmsg call.
+    //
+    uint32_t RecvBatchCount;
+
     //
     // The proc count to create per proc datapath state.
     //
@@ -339,32 +721,90 @@ QuicDataPathWorkerThread(
     _In_ void* Context
     );
 
+//
+// Returns the binding's socket context to send on from the current processor,
+// and the processor context serving it.
+//
+QUIC_SOCKET_CONTEXT*
+QuicDataPathBindingGetSocketContext(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _Out_ QUIC_DATAPATH_PROC_CONTEXT** ProcContext
+    )
+{
+    const uint32_t Index =
+        Binding->SocketCount == 1 ? 0 : QuicProcCurrentNumber();
+    *ProcContext = &Binding->Datapath->ProcContexts[Binding->ProcIndex + Index];
+    return &Binding->SocketContexts[Index];
+}
+
+#ifdef QUIC_LINUX_IO_URING
+QUIC_STATUS
+QuicSocketContextUringStartReceive(
+    _In_ QUIC_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    );
+
 QUIC_STATUS
+QuicSocketContextUringPostSendReady(
+    _In_ QUIC_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    );
+
+void
+QuicProcContextUringEventLoop(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    );
+#endif
+
+void
 QuicProcessorContextInitialize(
     _In_ QUIC_DATAPATH* Datapath,
     _In_ uint32_t Index,
     _Out_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
     )
 {
-    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
-    int EpollFd = INVALID_SOCKET_FD;
-    int EventFd = INVALID_SOCKET_FD;
-    int Ret = 0;
-    uint32_t RecvPacketLength = 0;
-    BOOLEAN EventFdAdded = FALSE;
-
     QUIC_DBG_ASSERT(Datapath != NULL);
 
-    RecvPacketLength =
-        sizeof(QUIC_DATAPATH_RECV_BLOCK) + Datapath->ClientRecvContextLength;
+    const uint32_t RecvPacketLength =
+        Datapath->RecvPayloadOffset + Datapath->RecvPayloadLength;
 
+    ProcContext->Datapath = Datapath;
     ProcContext->Index = Index;
+    ProcContext->EpollFd = INVALID_SOCKET_FD;
+    ProcContext->EventFd = INVALID_SOCKET_FD;
+    QuicLockInitialize(&ProcContext->PollLock);
     QuicPoolInitialize(TRUE, RecvPacketLength, &ProcContext->RecvBlockPool);
+#ifdef QUIC_LINUX_XDP
+    QuicPoolInitialize(TRUE, Datapath->RecvPayloadOffset, &ProcContext->XdpRecvBlockPool);
+#endif
     QuicPoolInitialize(TRUE, MAX_UDP_PAYLOAD_LENGTH, &ProcContext->SendBufferPool);
+    QuicPoolInitialize(TRUE, QUIC_LARGE_SEND_BUFFER_SIZE, &ProcContext->LargeSendBufferPool);
+    QuicPoolEnableLargePages(&ProcContext->RecvBlockPool);
+    QuicPoolEnableLargePages(&ProcContext->SendBufferPool);
+    QuicPoolEnableLargePages(&ProcContext->LargeSendBufferPool);
     QuicPoolInitialize(
         TRUE,
         sizeof(QUIC_DATAPATH_SEND_CONTEXT),
         &ProcContext->SendContextPool);
+}
+
+//
+// Creates the epoll (or io_uring) instance, event FD and thread of the
+// processor context. Called with the datapath's ProcStartLock held.
+//
+QUIC_STATUS
+QuicProcessorContextStart(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    int EpollFd = INVALID_SOCKET_FD;
+    int EventFd = INVALID_SOCKET_FD;
+    int Ret = 0;
+    BOOLEAN EventFdAdded = FALSE;
+#ifdef QUIC_LINUX_IO_URING
+    BOOLEAN RingInitialized = FALSE;
+#endif
 
     EpollFd = epoll_create1(EPOLL_CLOEXEC);
     if (EpollFd == INVALID_SOCKET_FD) {
@@ -408,10 +848,33 @@ QuicProcessorContextInitialize(
 
     EventFdAdded = TRUE;
 
-    ProcContext->Datapath = Datapath;
     ProcContext->EpollFd = EpollFd;
     ProcContext->EventFd = EventFd;
 
+#ifdef QUIC_LINUX_IO_URING
+    if (ProcContext->Datapath->UseUring) {
+        Status = QuicUringInitialize(QUIC_URING_ENTRY_COUNT, &ProcContext->Ring);
+        if (QUIC_FAILED(Status)) {
+            goto Exit;
+        }
+        QuicLockInitialize(&ProcContext->RingLock);
+        RingInitialized = TRUE;
+
+        //
+        // The shutdown event is watched with a poll on the event FD, which has
+        // no operation context (NULL user data), like the epoll registration.
+        // It is submitted by the worker thread's first wait.
+        //
+        struct io_uring_sqe* Sqe = QuicUringGetSqe(&ProcContext->Ring);
+        QUIC_DBG_ASSERT(Sqe != NULL);
+        Sqe->opcode = IORING_OP_POLL_ADD;
+        Sqe->fd = EventFd;
+        Sqe->poll32_events = POLLIN;
+        Sqe->user_data = 0;
+        QuicUringFlush(&ProcContext->Ring);
+    }
+#endif
+
     //
     // Starting the thread must be done after the rest of the ProcContext
     // members have been initialized. Because the thread start routine accesses
@@ -439,6 +902,12 @@ QuicProcessorContextInitialize(
 Exit:
 
     if (QUIC_FAILED(Status)) {
+#ifdef QUIC_LINUX_IO_URING
+        if (RingInitialized) {
+            QuicUringUninitialize(&ProcContext->Ring);
+            QuicLockUninitialize(&ProcContext->RingLock);
+        }
+#endif
         if (EventFdAdded) {
             epoll_ctl(EpollFd, EPOLL_CTL_DEL, EventFd, NULL);
         }
@@ -448,9 +917,10 @@ Exit:
         if (EpollFd != INVALID_SOCKET_FD) {
             close(EpollFd);
         }
-        QuicPoolUninitialize(&ProcContext->RecvBlockPool);
-        QuicPoolUninitialize(&ProcContext->SendBufferPool);
-        QuicPoolUninitialize(&ProcContext->SendContextPool);
+        ProcContext->EpollFd = INVALID_SOCKET_FD;
+        ProcContext->EventFd = INVALID_SOCKET_FD;
+    } else {
+        ProcContext->Started = TRUE;
     }
 
     return Status;
@@ -461,23 +931,161 @@ QuicProcessorContextUninitialize(
     _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
     )
 {
+    if (!ProcContext->Started) {
+        goto Pools;
+    }
+
     const eventfd_t Value = 1;
     eventfd_write(ProcContext->EventFd, Value);
     QuicThreadWait(&ProcContext->EpollWaitThread);
     QuicThreadDelete(&ProcContext->EpollWaitThread);
 
+#ifdef QUIC_LINUX_IO_URING
+    if (ProcContext->Datapath->UseUring) {
+        QuicUringUninitialize(&ProcContext->Ring);
+        QuicLockUninitialize(&ProcContext->RingLock);
+    }
+#endif
+
+#ifdef QUIC_LINUX_XDP
+    if (ProcContext->XdpSocket != NULL) {
+        epoll_ctl(ProcContext->EpollFd, EPOLL_CTL_DEL, ProcContext->XdpSocket->Fd, NULL);
+        QuicXdpSocketUninitialize(ProcContext->XdpSocket);
+        QUIC_FREE(ProcContext->XdpSocket);
+        ProcContext->XdpSocket = NULL;
+    }
+#endif
+
     epoll_ctl(ProcContext->EpollFd, EPOLL_CTL_DEL, ProcContext->EventFd, NULL);
     close(ProcContext->EventFd);
     close(ProcContext->EpollFd);
 
+Pools:
+
     QuicPoolUninitialize(&ProcContext->RecvBlockPool);
+#ifdef QUIC_LINUX_XDP
+    QuicPoolUninitialize(&ProcContext->XdpRecvBlockPool);
+#endif
     QuicPoolUninitialize(&ProcContext->SendBufferPool);
+    QuicPoolUninitialize(&ProcContext->LargeSendBufferPool);
     QuicPoolUninitialize(&ProcContext->SendContextPool);
+    QuicLockUninitialize(&ProcContext->PollLock);
 }
 
-QUIC_STATUS
-QuicDataPathInitialize(
-    _In_ uint32_t ClientRecvContextLength,
+#ifdef QUIC_LINUX_IO_URING
+BOOLEAN
+QuicDataPathQueryUringSupport(
+    void
+    )
+{
+    //
+    // Only use io_uring if the kernel is new enough to poll sockets internally
+    // instead of blocking its worker threads (IORING_FEAT_FAST_POLL), and to
+    // never drop completions (IORING_FEAT_NODROP). Otherwise fall back to epoll.
+    //
+    QUIC_URING Ring;
+    if (QUIC_FAILED(QuicUringInitialize(8, &Ring))) {
+        return FALSE;
+    }
+    const uint32_t RequiredFeatures = IORING_FEAT_FAST_POLL | IORING_FEAT_NODROP;
+    BOOLEAN Supported = (Ring.Features & RequiredFeatures) == RequiredFeatures;
+    QuicUringUninitialize(&Ring);
+    return Supported;
+}
+#endif
+
+void
+QuicDataPathQuerySockoptSupport(
+    _Inout_ QUIC_DATAPATH* Datapath
+    )
+{
+#ifdef UDP_SEGMENT
+    int Result;
+    int SegmentSize;
+    socklen_t OptionLength;
+
+    int UdpSocket = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (UdpSocket == INVALID_SOCKET_FD) {
+        QuicTraceLogWarning(
+            DatapathOpenUdpSocketFailed,
+            "[ udp] UDP send segmentation helper socket failed to open, 0x%x",
+            errno);
+        return;
+    }
+
+    OptionLength = sizeof(SegmentSize);
+    Result =
+        getsockopt(
+            UdpSocket,
+            IPPROTO_UDP,
+            UDP_SEGMENT,
+            &SegmentSize,
+            &OptionLength);
+    if (Result == SOCKET_ERROR) {
+        QuicTraceLogWarning(
+            DatapathQueryUdpSegmentFailed,
+            "[ udp] Query for UDP_SEGMENT failed, 0x%x",
+            errno);
+    } else {
+        Datapath->Features |= QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION;
+    }
+
+#ifdef UDP_GRO
+{
+    int GroEnabled;
+    OptionLength = sizeof(GroEnabled);
+    Result =
+        getsockopt(
+            UdpSocket,
+            IPPROTO_UDP,
+            UDP_GRO,
+            &GroEnabled,
+            &OptionLength);
+    if (Result == SOCKET_ERROR) {
+        QuicTraceLogWarning(
+            DatapathQueryUdpGroFailed,
+            "[ udp] Query for UDP_GRO failed, 0x%x",
+            errno);
+    } else {
+        Datapath->Features |= QUIC_DATAPATH_FEATURE_RECV_COALESCING;
+    }
+}
+#endif
+
+#ifdef SO_TXTIME
+{
+    //
+    // Departure times are on the QuicTimeUs64 clock, which is the one the fq
+    // qdisc uses.
+    //
+    struct sock_txtime TxTimeConfig = { CLOCK_MONOTONIC, 0 };
+    Result =
+        setsockopt(
+            UdpSocket,
+            SOL_SOCKET,
+            SO_TXTIME,
+            &TxTimeConfig,
+            sizeof(TxTimeConfig));
+    if (Result == SOCKET_ERROR) {
+        QuicTraceLogWarning(
+            DatapathQueryTxTimeFailed,
+            "[ udp] Setting SO_TXTIME failed, 0x%x",
+            errno);
+    } else {
+        Datapath->Features |= QUIC_DATAPATH_FEATURE_SEND_TXTIME;
+    }
+}
+#endif
+
+    close(UdpSocket);
+#else
+    UNREFERENCED_PARAMETER(Datapath);
+#endif
+}
+
+QUIC_STATUS
+QuicDataPathInitialize(
+    _In_ uint32_t ClientRecvContextLength,
     _In_ QUIC_DATAPATH_RECEIVE_CALLBACK_HANDLER RecvCallback,
     _In_ QUIC_DATAPATH_UNREACHABLE_CALLBACK_HANDLER UnreachableCallback,
     _Out_ QUIC_DATAPATH* *NewDataPath
@@ -520,20 +1128,51 @@ QuicDataPathInitialize(
     Datapath->ClientRecvContextLength = ClientRecvContextLength;
     Datapath->ProcCount = QuicProcMaxCount();
     Datapath->MaxSendBatchSize = QUIC_MAX_BATCH_SEND;
+    QuicLockInitialize(&Datapath->ProcStartLock);
     QuicRundownInitialize(&Datapath->BindingsRundown);
+#ifdef QUIC_LINUX_XDP
+    QuicLockInitialize(&Datapath->XdpLock);
+    QuicRwLockInitialize(&Datapath->XdpBindingsLock);
+    QuicListInitializeHead(&Datapath->XdpBindings);
+    QuicLockInitialize(&Datapath->XdpNeighborLock);
+#endif
+
+    QuicDataPathQuerySockoptSupport(Datapath);
+
+#ifdef QUIC_LINUX_IO_URING
+    Datapath->UseUring = QuicDataPathQueryUringSupport();
+    QuicTraceLogInfo(
+        DatapathUringSupport,
+        "[ udp] io_uring backend %s",
+        Datapath->UseUring ? "enabled" : "unsupported, using epoll");
+#endif
+
+    uint32_t MessageCount =
+        (Datapath->Features & QUIC_DATAPATH_FEATURE_RECV_COALESCING)
+            ? GRO_MAX_DATAGRAMS_PER_INDICATION : 1;
+
+    Datapath->DatagramStride =
+        ALIGN_UP(
+            sizeof(QUIC_RECV_DATAGRAM) +
+            sizeof(QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT) +
+            ClientRecvContextLength,
+            void*);
+    Datapath->RecvPayloadOffset =
+        ALIGN_UP(sizeof(QUIC_DATAPATH_RECV_BLOCK), void*) +
+        MessageCount * Datapath->DatagramStride;
+    Datapath->RecvPayloadLength =
+        (Datapath->Features & QUIC_DATAPATH_FEATURE_RECV_COALESCING) ?
+            MAX_GRO_PAYLOAD_LENGTH : MAX_UDP_PAYLOAD_LENGTH;
+    Datapath->RecvBatchCount =
+        (Datapath->Features & QUIC_DATAPATH_FEATURE_RECV_COALESCING) ?
+            QUIC_MAX_COALESCED_RECEIVE_BATCH_COUNT : QUIC_MAX_RECEIVE_BATCH_COUNT;
 
     //
-    // Initialize the per processor contexts.
+    // Initialize the per processor contexts. Their threads are only started
+    // once the processor is first used.
     //
     for (uint32_t i = 0; i < Datapath->ProcCount; i++) {
-        Status = QuicProcessorContextInitialize(Datapath, i, &Datapath->ProcContexts[i]);
-        if (QUIC_FAILED(Status)) {
-            Datapath->Shutdown = TRUE;
-            for (uint32_t j = 0; j < i; j++) {
-                QuicProcessorContextUninitialize(&Datapath->ProcContexts[j]);
-            }
-            goto Exit;
-        }
+        QuicProcessorContextInitialize(Datapath, i, &Datapath->ProcContexts[i]);
     }
 
     *NewDataPath = Datapath;
@@ -542,6 +1181,12 @@ QuicDataPathInitialize(
 Exit:
 
     if (Datapath != NULL) {
+#ifdef QUIC_LINUX_XDP
+        QuicLockUninitialize(&Datapath->XdpLock);
+        QuicRwLockUninitialize(&Datapath->XdpBindingsLock);
+        QuicLockUninitialize(&Datapath->XdpNeighborLock);
+#endif
+        QuicLockUninitialize(&Datapath->ProcStartLock);
         QuicRundownUninitialize(&Datapath->BindingsRundown);
         QUIC_FREE(Datapath);
     }
@@ -564,24 +1209,63 @@ QuicDataPathUninitialize(
 #else
     QuicRundownReleaseAndWait(&Datapath->BindingsRundown);
 
+#ifdef QUIC_LINUX_XDP
+    if (Datapath->XdpState == QUIC_XDP_STATE_ACTIVE) {
+        QuicXdpProgramUninitialize(&Datapath->XdpProgram);
+    }
+#endif
+
     Datapath->Shutdown = TRUE;
     for (uint32_t i = 0; i < Datapath->ProcCount; i++) {
         QuicProcessorContextUninitialize(&Datapath->ProcContexts[i]);
     }
 
+#ifdef QUIC_LINUX_XDP
+    QuicLockUninitialize(&Datapath->XdpLock);
+    QuicRwLockUninitialize(&Datapath->XdpBindingsLock);
+    QuicLockUninitialize(&Datapath->XdpNeighborLock);
+#endif
+    QuicLockUninitialize(&Datapath->ProcStartLock);
     QuicRundownUninitialize(&Datapath->BindingsRundown);
     QUIC_FREE(Datapath);
 #endif
 }
 
+//
+// Starts the processor contexts in [Start, Start + Count) that aren't running
+// yet.
+//
+QUIC_STATUS
+QuicDataPathStartProcessors(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Start,
+    _In_ uint32_t Count
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    QUIC_DBG_ASSERT(Start + Count <= Datapath->ProcCount);
+
+    QuicLockAcquire(&Datapath->ProcStartLock);
+    for (uint32_t i = Start; i < Start + Count; i++) {
+        if (!Datapath->ProcContexts[i].Started) {
+            Status = QuicProcessorContextStart(&Datapath->ProcContexts[i]);
+            if (QUIC_FAILED(Status)) {
+                break;
+            }
+        }
+    }
+    QuicLockRelease(&Datapath->ProcStartLock);
+
+    return Status;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 uint32_t
 QuicDataPathGetSupportedFeatures(
     _In_ QUIC_DATAPATH* Datapath
     )
 {
-    UNREFERENCED_PARAMETER(Datapath);
-    return 0;
+    return Datapath->Features;
 }
 
 BOOLEAN
@@ -592,15 +1276,175 @@ QuicDataPathIsPaddingPreferred(
 #ifdef QUIC_PLATFORM_DISPATCH_TABLE
     return PlatDispatch->DatapathIsPaddingPreferred(Datapath);
 #else
-    UNREFERENCED_PARAMETER(Datapath);
     //
-    // The windows implementation returns TRUE only if GSO is supported and
-    // this DAL implementation doesn't support GSO currently.
+    // Padding is preferred only when GSO is used, because all but the last
+    // segment of a segmented send must be the same size.
     //
-    return FALSE;
+    return !!(Datapath->Features & QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION);
+#endif
+}
+
+void
+QuicDataPathSetBusyPoll(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t BusyPollUs
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    PlatDispatch->DatapathSetBusyPoll(Datapath, BusyPollUs);
+#else
+    Datapath->BusyPollUs = BusyPollUs;
+#endif
+}
+
+QUIC_STATUS
+QuicDataPathSetPollCallback(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index,
+    _In_opt_ QUIC_DATAPATH_POLL_CALLBACK_HANDLER PollCallback,
+    _In_opt_ void* PollContext
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    return
+        PlatDispatch->DatapathSetPollCallback(
+            Datapath,
+            Index,
+            PollCallback,
+            PollContext);
+#else
+#ifdef QUIC_LINUX_IO_URING
+    if (Datapath->UseUring) {
+        return QUIC_STATUS_NOT_SUPPORTED;
+    }
+#endif
+    if (Index >= Datapath->ProcCount) {
+        return QUIC_STATUS_INVALID_PARAMETER;
+    }
+
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    QUIC_DATAPATH_PROC_CONTEXT* ProcContext = &Datapath->ProcContexts[Index];
+    if (PollCallback != NULL) {
+        //
+        // The callback runs on the processor's thread.
+        //
+        Status = QuicDataPathStartProcessors(Datapath, Index, 1);
+        if (QUIC_FAILED(Status)) {
+            return Status;
+        }
+    }
+
+    QuicLockAcquire(&ProcContext->PollLock);
+    if (PollCallback != NULL && ProcContext->PollCallback != NULL) {
+        Status = QUIC_STATUS_INVALID_STATE;
+    } else {
+        ProcContext->PollCallback = PollCallback;
+        ProcContext->PollContext = PollContext;
+    }
+    QuicLockRelease(&ProcContext->PollLock);
+
+    if (QUIC_SUCCEEDED(Status) && PollCallback != NULL) {
+        //
+        // Kick the thread so that it runs the callback the first time.
+        //
+        QuicDataPathWakeProcessor(Datapath, Index);
+    }
+
+    return Status;
+#endif
+}
+
+void
+QuicDataPathWakeProcessor(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    PlatDispatch->DatapathWakeProcessor(Datapath, Index);
+#else
+    if (Datapath->ProcContexts[Index].Started) {
+        const eventfd_t Value = 1;
+        eventfd_write(Datapath->ProcContexts[Index].EventFd, Value);
+    }
+#endif
+}
+
+QUIC_STATUS
+QuicDataPathSetCidSteering(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_opt_ const QUIC_DATAPATH_CID_STEERING* Steering
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    return PlatDispatch->DatapathSetCidSteering(Datapath, Steering);
+#else
+    if (Steering == NULL) {
+        QuicZeroMemory(&Datapath->CidSteering, sizeof(Datapath->CidSteering));
+        return QUIC_STATUS_SUCCESS;
+    }
+
+    if (Steering->CidLength == 0 ||
+        Steering->PartitionOffset >= Steering->CidLength ||
+        Steering->PartitionCount == 0) {
+        return QUIC_STATUS_INVALID_PARAMETER;
+    }
+
+    Datapath->CidSteering = *Steering;
+    return QUIC_STATUS_SUCCESS;
 #endif
 }
 
+QUIC_STATUS
+QuicDataPathBindingSetCryptoOffload(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_opt_ const QUIC_DATAPATH_CRYPTO_OFFLOAD* Offload
+    )
+{
+    //
+    // No inline crypto offload (QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD); the
+    // kernel has no interface to program QUIC keys into the NIC.
+    //
+    UNREFERENCED_PARAMETER(Binding);
+    UNREFERENCED_PARAMETER(RemoteAddress);
+    return Offload == NULL ? QUIC_STATUS_SUCCESS : QUIC_STATUS_NOT_SUPPORTED;
+}
+
+static
+QUIC_RECV_DATAGRAM*
+QuicDataPathRecvBlockGetDatagram(
+    _In_ const QUIC_DATAPATH* Datapath,
+    _In_ QUIC_DATAPATH_RECV_BLOCK* RecvBlock,
+    _In_ uint32_t Index
+    )
+{
+    return (QUIC_RECV_DATAGRAM*)
+        ((uint8_t*)RecvBlock +
+            ALIGN_UP(sizeof(QUIC_DATAPATH_RECV_BLOCK), void*) +
+            Index * Datapath->DatagramStride);
+}
+
+static
+uint8_t*
+QuicDataPathRecvBlockGetPayload(
+    _In_ const QUIC_DATAPATH* Datapath,
+    _In_ QUIC_DATAPATH_RECV_BLOCK* RecvBlock
+    )
+{
+    return (uint8_t*)RecvBlock + Datapath->RecvPayloadOffset;
+}
+
+static
+QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT*
+QuicDataPathDatagramToInternalDatagramContext(
+    _In_ const QUIC_RECV_DATAGRAM* Datagram
+    )
+{
+    return (QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT*)
+        (((uint8_t*)Datagram) + sizeof(QUIC_RECV_DATAGRAM));
+}
+
 QUIC_DATAPATH_RECV_BLOCK*
 QuicDataPathAllocRecvBlock(
     _In_ QUIC_DATAPATH* Datapath,
@@ -618,8 +1462,6 @@ QuicDataPathAllocRecvBlock(
     } else {
         QuicZeroMemory(RecvBlock, sizeof(*RecvBlock));
         RecvBlock->OwningPool = &Datapath->ProcContexts[ProcIndex].RecvBlockPool;
-        RecvBlock->RecvPacket.Buffer = RecvBlock->Buffer;
-        RecvBlock->RecvPacket.Allocated = TRUE;
     }
     return RecvBlock;
 }
@@ -733,6 +1575,151 @@ Exit:
 #endif
 }
 
+//
+// An outstanding getaddrinfo_a request.
+//
+typedef struct QUIC_DATAPATH_RESOLVE_REQUEST {
+
+    struct gaicb Request;
+    ADDRINFO Hints;
+    struct sigevent Event;
+    QUIC_DATAPATH* Datapath;
+    QUIC_DATAPATH_RESOLVE_CALLBACK_HANDLER Callback;
+    void* Context;
+    char HostName[];
+
+} QUIC_DATAPATH_RESOLVE_REQUEST;
+
+//
+// Keeps the first address of each family from the resolver's results.
+//
+void
+QuicDataPathPopulateResolution(
+    _In_ ADDRINFO* AddrInfo,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+    uint32_t Count = 0;
+    QuicZeroMemory(Resolution, sizeof(QUIC_DATAPATH_RESOLUTION));
+
+    for (; AddrInfo != NULL && Count < ARRAYSIZE(Resolution->Addresses); AddrInfo = AddrInfo->ai_next) {
+        if (AddrInfo->ai_addr->sa_family != AF_INET &&
+            AddrInfo->ai_addr->sa_family != AF_INET6) {
+            continue;
+        }
+        QUIC_ADDR* Address = &Resolution->Addresses[Count];
+        QuicDataPathPopulateTargetAddress(AF_UNSPEC, AddrInfo, Address);
+        if (Count == 0 ||
+            QuicAddrGetFamily(Address) != QuicAddrGetFamily(&Resolution->Addresses[0])) {
+            Count++;
+        } else {
+            QuicZeroMemory(Address, sizeof(QUIC_ADDR));
+        }
+    }
+}
+
+void
+QuicDataPathResolveComplete(
+    _In_ union sigval Value
+    )
+{
+    QUIC_DATAPATH_RESOLVE_REQUEST* Request =
+        (QUIC_DATAPATH_RESOLVE_REQUEST*)Value.sival_ptr;
+    QUIC_DATAPATH_RESOLUTION Resolution;
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+
+    int Result = gai_error(&Request->Request);
+    if (Result == 0 && Request->Request.ar_result != NULL) {
+        QuicDataPathPopulateResolution(Request->Request.ar_result, &Resolution);
+        freeaddrinfo(Request->Request.ar_result);
+    } else {
+        QuicTraceEvent(
+            LibraryError,
+            "[ lib] ERROR, %s.",
+            "Resolving hostname to IP");
+        QuicTraceLogError(
+            DatapathResolveHostNameFailed,
+            "[%p] Couldn't resolve hostname '%s' to an IP address",
+            Request->Datapath,
+            Request->HostName);
+        QuicZeroMemory(&Resolution, sizeof(Resolution));
+        Status = QUIC_STATUS_DNS_RESOLUTION_ERROR;
+    }
+
+    Request->Callback(Request->Context, Status, &Resolution);
+    QUIC_FREE(Request);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathResolveAddressAsync(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_z_ const char* HostName,
+    _In_ QUIC_DATAPATH_RESOLVE_CALLBACK_HANDLER Callback,
+    _In_opt_ void* Context,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    return
+        PlatDispatch->DatapathResolveAddressAsync(
+            Datapath, HostName, Callback, Context, Resolution);
+#else
+    ADDRINFO Hints = {0};
+    ADDRINFO* AddrInfo = NULL;
+
+    //
+    // Numeric names don't need the resolver, so don't bother with a request.
+    //
+    Hints.ai_family = AF_UNSPEC;
+    Hints.ai_flags = AI_NUMERICHOST;
+    if (getaddrinfo(HostName, NULL, &Hints, &AddrInfo) == 0) {
+        QuicDataPathPopulateResolution(AddrInfo, Resolution);
+        freeaddrinfo(AddrInfo);
+        return QUIC_STATUS_SUCCESS;
+    }
+
+    size_t HostNameLength = strlen(HostName);
+    QUIC_DATAPATH_RESOLVE_REQUEST* Request =
+        QUIC_ALLOC_PAGED(sizeof(QUIC_DATAPATH_RESOLVE_REQUEST) + HostNameLength + 1);
+    if (Request == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_DATAPATH_RESOLVE_REQUEST",
+            sizeof(QUIC_DATAPATH_RESOLVE_REQUEST) + HostNameLength + 1);
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    QuicZeroMemory(Request, sizeof(QUIC_DATAPATH_RESOLVE_REQUEST));
+    memcpy(Request->HostName, HostName, HostNameLength + 1);
+    Request->Datapath = Datapath;
+    Request->Callback = Callback;
+    Request->Context = Context;
+    Request->Hints.ai_family = AF_UNSPEC;
+    Request->Hints.ai_flags = AI_CANONNAME;
+    Request->Request.ar_name = Request->HostName;
+    Request->Request.ar_request = &Request->Hints;
+    Request->Event.sigev_notify = SIGEV_THREAD;
+    Request->Event.sigev_notify_function = QuicDataPathResolveComplete;
+    Request->Event.sigev_value.sival_ptr = Request;
+
+    struct gaicb* List[1] = { &Request->Request };
+    int Result = getaddrinfo_a(GAI_NOWAIT, List, 1, &Request->Event);
+    if (Result != 0) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Result,
+            "getaddrinfo_a failed");
+        QUIC_FREE(Request);
+        return QUIC_STATUS_DNS_RESOLUTION_ERROR;
+    }
+
+    return QUIC_STATUS_PENDING;
+#endif
+}
+
 //
 // Socket context interface. It abstracts a (generally per-processor) UDP socket
 // and the corresponding logic/functionality like send and receive processing.
@@ -930,15 +1917,14 @@ QuicSocketContextInitialize(
     }
 
     //
-    // The socket is shared by multiple QUIC endpoints, so increase the receive
-    // buffer size.
+    // Receive the TOS/traffic class too, for its ECN codepoint.
     //
-    Option = INT32_MAX;
+    Option = TRUE;
     Result =
         setsockopt(
             SocketContext->SocketFd,
-            SOL_SOCKET,
-            SO_RCVBUF,
+            IPPROTO_IPV6,
+            IPV6_RECVTCLASS,
             (const void*)&Option,
             sizeof(Option));
     if (Result == SOCKET_ERROR) {
@@ -948,19 +1934,16 @@ QuicSocketContextInitialize(
             "[ udp][%p] ERROR, %u, %s.",
             Binding,
             Status,
-            "setsockopt(SO_RCVBUF) failed");
+            "setsockopt(IPV6_RECVTCLASS) failed");
         goto Exit;
     }
 
-    //
-    // The port is shared across processors.
-    //
     Option = TRUE;
     Result =
         setsockopt(
             SocketContext->SocketFd,
-            SOL_SOCKET,
-            SO_REUSEADDR,
+            IPPROTO_IP,
+            IP_RECVTOS,
             (const void*)&Option,
             sizeof(Option));
     if (Result == SOCKET_ERROR) {
@@ -970,16 +1953,160 @@ QuicSocketContextInitialize(
             "[ udp][%p] ERROR, %u, %s.",
             Binding,
             Status,
-            "setsockopt(SO_REUSEADDR) failed");
+            "setsockopt(IP_RECVTOS) failed");
         goto Exit;
     }
 
+    //
+    // Have the kernel timestamp the datagrams when they arrive, so the time
+    // they wait to be processed doesn't count towards the RTT.
+    //
+    Option = TRUE;
     Result =
-        bind(
+        setsockopt(
             SocketContext->SocketFd,
-            (const struct sockaddr*)&Binding->LocalAddress,
-            sizeof(Binding->LocalAddress));
-    if (Result == SOCKET_ERROR) {
+            SOL_SOCKET,
+            SO_TIMESTAMPNS,
+            (const void*)&Option,
+            sizeof(Option));
+    if (Result == SOCKET_ERROR) {
+        Status = errno;
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            Binding,
+            Status,
+            "setsockopt(SO_TIMESTAMPNS) failed");
+        goto Exit;
+    }
+
+#ifdef UDP_GRO
+    if (Binding->Datapath->Features & QUIC_DATAPATH_FEATURE_RECV_COALESCING) {
+        //
+        // Have the kernel coalesce consecutive same-flow datagrams into a
+        // single receive buffer. The segment size comes back in a UDP_GRO
+        // control message.
+        //
+        Option = TRUE;
+        Result =
+            setsockopt(
+                SocketContext->SocketFd,
+                SOL_UDP,
+                UDP_GRO,
+                (const void*)&Option,
+                sizeof(Option));
+        if (Result == SOCKET_ERROR) {
+            Status = errno;
+            QuicTraceEvent(
+                DatapathErrorStatus,
+                "[ udp][%p] ERROR, %u, %s.",
+                Binding,
+                Status,
+                "setsockopt(UDP_GRO) failed");
+            goto Exit;
+        }
+    }
+#endif
+
+#ifdef SO_TXTIME
+    if (Binding->Datapath->Features & QUIC_DATAPATH_FEATURE_SEND_TXTIME) {
+        struct sock_txtime TxTimeConfig = { CLOCK_MONOTONIC, 0 };
+        Result =
+            setsockopt(
+                SocketContext->SocketFd,
+                SOL_SOCKET,
+                SO_TXTIME,
+                &TxTimeConfig,
+                sizeof(TxTimeConfig));
+        if (Result == SOCKET_ERROR) {
+            Status = errno;
+            QuicTraceEvent(
+                DatapathErrorStatus,
+                "[ udp][%p] ERROR, %u, %s.",
+                Binding,
+                Status,
+                "setsockopt(SO_TXTIME) failed");
+            goto Exit;
+        }
+    }
+#endif
+
+    //
+    // The socket is shared by multiple QUIC endpoints, so increase the receive
+    // buffer size.
+    //
+    Option = INT32_MAX;
+    Result =
+        setsockopt(
+            SocketContext->SocketFd,
+            SOL_SOCKET,
+            SO_RCVBUF,
+            (const void*)&Option,
+            sizeof(Option));
+    if (Result == SOCKET_ERROR) {
+        Status = errno;
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            Binding,
+            Status,
+            "setsockopt(SO_RCVBUF) failed");
+        goto Exit;
+    }
+
+    //
+    // The port is shared across processors, and with the connected sockets a
+    // server opens for its dedicated flows (the kernel prefers the connected
+    // socket for the flow's 4-tuple). Steered server bindings also join a
+    // reuseport group, so that a steering program can pick the socket (and so
+    // the processor) for each datagram.
+    //
+    Option = TRUE;
+    Result =
+        setsockopt(
+            SocketContext->SocketFd,
+            SOL_SOCKET,
+            SO_REUSEADDR,
+            (const void*)&Option,
+            sizeof(Option));
+    if (Result == SOCKET_ERROR) {
+        Status = errno;
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            Binding,
+            Status,
+            "setsockopt(SO_REUSEADDR) failed");
+        goto Exit;
+    }
+
+    if (RemoteAddress == NULL && Binding->Datapath->CidSteering.CidLength != 0) {
+        Option = TRUE;
+        Result =
+            setsockopt(
+                SocketContext->SocketFd,
+                SOL_SOCKET,
+                SO_REUSEPORT,
+                (const void*)&Option,
+                sizeof(Option));
+        if (Result == SOCKET_ERROR) {
+            Status = errno;
+            QuicTraceEvent(
+                DatapathErrorStatus,
+                "[ udp][%p] ERROR, %u, %s.",
+                Binding,
+                Status,
+                "setsockopt(SO_REUSEPORT) failed");
+            goto Exit;
+        }
+    }
+
+    Result =
+        bind(
+            SocketContext->SocketFd,
+            (const struct sockaddr*)&Binding->LocalAddress,
+            sizeof(Binding->LocalAddress));
+    if (Result == SOCKET_ERROR) {
         Status = errno;
         QuicTraceEvent(
             DatapathErrorStatus,
@@ -1048,6 +2175,70 @@ Exit:
     return Status;
 }
 
+//
+// Attaches a classic BPF program to the binding's reuseport group that picks
+// the socket from the partition ID in the datagram's destination CID. Sockets
+// join the group in processor order, so the socket index is the partition
+// index. Datagrams without a CID of the expected length (i.e. client Initials)
+// fall back to the kernel's 4-tuple hash.
+//
+QUIC_STATUS
+QuicSocketContextAttachCidSteering(
+    _In_ QUIC_SOCKET_CONTEXT* SocketContext,
+    _In_ uint32_t SocketCount
+    )
+{
+    const QUIC_DATAPATH_CID_STEERING* Steering =
+        &SocketContext->Binding->Datapath->CidSteering;
+    uint32_t PartitionCount = Steering->PartitionCount;
+    if (PartitionCount > SocketCount) {
+        PartitionCount = SocketCount;
+    }
+
+    //
+    // UDP reuseport programs see the UDP payload, i.e. the QUIC packet.
+    //
+    struct sock_filter Code[] = {
+        /* 0 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+        /* 1 */ BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x80, 2, 0),
+        // Short header: the DCID immediately follows the first byte.
+        /* 2 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 1 + Steering->PartitionOffset),
+        /* 3 */ BPF_STMT(BPF_JMP | BPF_JA, 3),
+        // Long header: the DCID length and DCID follow the version.
+        /* 4 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 5),
+        /* 5 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, Steering->CidLength, 0, 4),
+        /* 6 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 6 + Steering->PartitionOffset),
+        /* 7 */ BPF_STMT(BPF_ALU | BPF_AND | BPF_K, Steering->PartitionMask),
+        /* 8 */ BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, PartitionCount),
+        /* 9 */ BPF_STMT(BPF_RET | BPF_A, 0),
+        /* 10 */ BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF),
+    };
+    struct sock_fprog Program = {
+        .len = ARRAYSIZE(Code),
+        .filter = Code
+    };
+
+    int Result =
+        setsockopt(
+            SocketContext->SocketFd,
+            SOL_SOCKET,
+            SO_ATTACH_REUSEPORT_CBPF,
+            (const void*)&Program,
+            sizeof(Program));
+    if (Result == SOCKET_ERROR) {
+        QUIC_STATUS Status = errno;
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            SocketContext->Binding,
+            Status,
+            "setsockopt(SO_ATTACH_REUSEPORT_CBPF) failed");
+        return Status;
+    }
+
+    return QUIC_STATUS_SUCCESS;
+}
+
 void
 QuicSocketContextUninitialize(
     _In_ QUIC_SOCKET_CONTEXT* SocketContext,
@@ -1066,8 +2257,13 @@ QuicSocketContextUninitializeComplete(
     _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
     )
 {
-    if (SocketContext->CurrentRecvBlock != NULL) {
-        QuicDataPathBindingReturnRecvDatagrams(&SocketContext->CurrentRecvBlock->RecvPacket);
+    for (uint32_t i = 0; i < QUIC_MAX_RECEIVE_BATCH_COUNT; ++i) {
+        if (SocketContext->CurrentRecvBlocks[i] != NULL) {
+            QuicPoolFree(
+                SocketContext->CurrentRecvBlocks[i]->OwningPool,
+                SocketContext->CurrentRecvBlocks[i]);
+            SocketContext->CurrentRecvBlocks[i] = NULL;
+        }
     }
 
     while (!QuicListIsEmpty(&SocketContext->PendingSendContextHead)) {
@@ -1091,12 +2287,23 @@ QuicSocketContextPrepareReceive(
     _In_ QUIC_SOCKET_CONTEXT* SocketContext
     )
 {
-    if (SocketContext->CurrentRecvBlock == NULL) {
-        SocketContext->CurrentRecvBlock =
+    //
+    // Only the msg headers whose receive blocks were indicated up by the last
+    // recvmmsg call need to be (re)initialized. The rest were left untouched
+    // by the kernel and are still ready to use.
+    //
+    QUIC_DATAPATH* Datapath = SocketContext->Binding->Datapath;
+
+    for (uint32_t i = 0; i < Datapath->RecvBatchCount; ++i) {
+        if (SocketContext->CurrentRecvBlocks[i] != NULL) {
+            continue;
+        }
+
+        QUIC_DATAPATH_RECV_BLOCK* RecvBlock =
             QuicDataPathAllocRecvBlock(
-                SocketContext->Binding->Datapath,
+                Datapath,
                 QuicProcCurrentNumber());
-        if (SocketContext->CurrentRecvBlock == NULL) {
+        if (RecvBlock == NULL) {
             QuicTraceEvent(
                 AllocFailure,
                 "Allocation of '%s' failed. (%llu bytes)",
@@ -1104,30 +2311,31 @@ QuicSocketContextPrepareReceive(
                 0);
             return QUIC_STATUS_OUT_OF_MEMORY;
         }
+        SocketContext->CurrentRecvBlocks[i] = RecvBlock;
+
+        SocketContext->RecvIovs[i].iov_base =
+            QuicDataPathRecvBlockGetPayload(Datapath, RecvBlock);
+
+        struct msghdr* MsgHdr = &SocketContext->RecvMsgHdrs[i].msg_hdr;
+        QuicZeroMemory(&SocketContext->RecvMsgHdrs[i], sizeof(SocketContext->RecvMsgHdrs[i]));
+        QuicZeroMemory(SocketContext->RecvMsgControl[i], sizeof(SocketContext->RecvMsgControl[i]));
+
+        MsgHdr->msg_name = &RecvBlock->Tuple.RemoteAddress;
+        MsgHdr->msg_namelen = sizeof(RecvBlock->Tuple.RemoteAddress);
+        MsgHdr->msg_iov = &SocketContext->RecvIovs[i];
+        MsgHdr->msg_iovlen = 1;
+        MsgHdr->msg_control = SocketContext->RecvMsgControl[i];
+        MsgHdr->msg_controllen = sizeof(SocketContext->RecvMsgControl[i]);
+        MsgHdr->msg_flags = 0;
     }
 
-    SocketContext->RecvIov.iov_base = SocketContext->CurrentRecvBlock->RecvPacket.Buffer;
-    SocketContext->CurrentRecvBlock->RecvPacket.BufferLength = SocketContext->RecvIov.iov_len;
-    SocketContext->CurrentRecvBlock->RecvPacket.Tuple = (QUIC_TUPLE*)&SocketContext->CurrentRecvBlock->Tuple;
-
-    QuicZeroMemory(&SocketContext->RecvMsgHdr, sizeof(SocketContext->RecvMsgHdr));
-    QuicZeroMemory(&SocketContext->RecvMsgControl, sizeof(SocketContext->RecvMsgControl));
-
-    SocketContext->RecvMsgHdr.msg_name = &SocketContext->CurrentRecvBlock->RecvPacket.Tuple->RemoteAddress;
-    SocketContext->RecvMsgHdr.msg_namelen = sizeof(SocketContext->CurrentRecvBlock->RecvPacket.Tuple->RemoteAddress);
-    SocketContext->RecvMsgHdr.msg_iov = &SocketContext->RecvIov;
-    SocketContext->RecvMsgHdr.msg_iovlen = 1;
-    SocketContext->RecvMsgHdr.msg_control = SocketContext->RecvMsgControl;
-    SocketContext->RecvMsgHdr.msg_controllen = sizeof(SocketContext->RecvMsgControl);
-    SocketContext->RecvMsgHdr.msg_flags = 0;
-
     return QUIC_STATUS_SUCCESS;
 }
 
 QUIC_STATUS
 QuicSocketContextStartReceive(
     _In_ QUIC_SOCKET_CONTEXT* SocketContext,
-    _In_ int EpollFd
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
     )
 {
     QUIC_STATUS Status = QuicSocketContextPrepareReceive(SocketContext);
@@ -1135,6 +2343,13 @@ QuicSocketContextStartReceive(
         goto Error;
     }
 
+#ifdef QUIC_LINUX_IO_URING
+    if (SocketContext->Binding->Datapath->UseUring) {
+        Status = QuicSocketContextUringStartReceive(SocketContext, ProcContext);
+        goto Error;
+    }
+#endif
+
     struct epoll_event SockFdEpEvt = {
         .events = EPOLLIN | EPOLLET,
         .data = {
@@ -1144,7 +2359,7 @@ QuicSocketContextStartReceive(
 
     int Ret =
         epoll_ctl(
-            EpollFd,
+            ProcContext->EpollFd,
             EPOLL_CTL_ADD,
             SocketContext->SocketFd,
             &SockFdEpEvt);
@@ -1169,76 +2384,199 @@ Error:
     return Status;
 }
 
+//
+// Converts a kernel receive timestamp, on the wall clock, to the QuicTimeUs64
+// clock, given the current time on both. Timestamps from the future, or too
+// old to be trusted (e.g. the wall clock was stepped), are replaced by the
+// current time.
+//
+uint64_t
+QuicDataPathRecvTimestampToTimeUs(
+    _In_ const struct timespec* Timestamp,
+    _In_ uint64_t RealTimeNowUs,
+    _In_ uint64_t TimeNowUs
+    )
+{
+    uint64_t TimestampUs =
+        S_TO_US((uint64_t)Timestamp->tv_sec) + (uint64_t)Timestamp->tv_nsec / 1000;
+    if (TimestampUs > RealTimeNowUs ||
+        RealTimeNowUs - TimestampUs > S_TO_US(1) ||
+        RealTimeNowUs - TimestampUs > TimeNowUs) {
+        return TimeNowUs;
+    }
+    return TimeNowUs - (RealTimeNowUs - TimestampUs);
+}
+
 void
 QuicSocketContextRecvComplete(
     _In_ QUIC_SOCKET_CONTEXT* SocketContext,
     _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext,
-    _In_ ssize_t BytesTransferred
+    _In_ int FirstIndex,
+    _In_ int MessageCount
     )
 {
     QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    QUIC_DATAPATH* Datapath = SocketContext->Binding->Datapath;
+    QUIC_RECV_DATAGRAM* DatagramChain = NULL;
+    QUIC_RECV_DATAGRAM** DatagramChainTail = &DatagramChain;
+
+    QUIC_DBG_ASSERT(MessageCount > 0);
+    QUIC_DBG_ASSERT((uint32_t)(FirstIndex + MessageCount) <= Datapath->RecvBatchCount);
+
+    struct timespec RealTimeNow;
+    clock_gettime(CLOCK_REALTIME, &RealTimeNow);
+    const uint64_t RealTimeNowUs =
+        S_TO_US((uint64_t)RealTimeNow.tv_sec) + (uint64_t)RealTimeNow.tv_nsec / 1000;
+    const uint64_t TimeNowUs = QuicTimeUs64();
+
+    for (int i = FirstIndex; i < FirstIndex + MessageCount; ++i) {
+
+        QUIC_DATAPATH_RECV_BLOCK* RecvBlock = SocketContext->CurrentRecvBlocks[i];
+        QUIC_DBG_ASSERT(RecvBlock != NULL);
+        SocketContext->CurrentRecvBlocks[i] = NULL;
+
+        struct msghdr* MsgHdr = &SocketContext->RecvMsgHdrs[i].msg_hdr;
+        uint32_t BytesTransferred = SocketContext->RecvMsgHdrs[i].msg_len;
+        uint16_t MessageLength = (uint16_t)BytesTransferred;
+        BOOLEAN IsCoalesced = FALSE;
+        uint8_t TypeOfService = 0;
+        uint64_t RecvTime = TimeNowUs;
+
+        BOOLEAN FoundLocalAddr = FALSE;
+        QUIC_ADDR* LocalAddr = &RecvBlock->Tuple.LocalAddress;
+        QUIC_ADDR* RemoteAddr = &RecvBlock->Tuple.RemoteAddress;
+        QuicConvertFromMappedV6(RemoteAddr, RemoteAddr);
+
+        struct cmsghdr *CMsg;
+        for (CMsg = CMSG_FIRSTHDR(MsgHdr);
+             CMsg != NULL;
+             CMsg = CMSG_NXTHDR(MsgHdr, CMsg)) {
+
+            if (!FoundLocalAddr &&
+                CMsg->cmsg_level == IPPROTO_IPV6 &&
+                CMsg->cmsg_type == IPV6_PKTINFO) {
+                struct in6_pktinfo* PktInfo6 = (struct in6_pktinfo*) CMSG_DATA(CMsg);
+                LocalAddr->Ip.sa_family = AF_INET6;
+                LocalAddr->Ipv6.sin6_addr = PktInfo6->ipi6_addr;
+                LocalAddr->Ipv6.sin6_port = SocketContext->Binding->LocalAddress.Ipv6.sin6_port;
+                QuicConvertFromMappedV6(LocalAddr, LocalAddr);
+
+                LocalAddr->Ipv6.sin6_scope_id = PktInfo6->ipi6_ifindex;
+                FoundLocalAddr = TRUE;
+            } else if (!FoundLocalAddr &&
+                       CMsg->cmsg_level == IPPROTO_IP &&
+                       CMsg->cmsg_type == IP_PKTINFO) {
+                struct in_pktinfo* PktInfo = (struct in_pktinfo*)CMSG_DATA(CMsg);
+                LocalAddr->Ip.sa_family = AF_INET;
+                LocalAddr->Ipv4.sin_addr = PktInfo->ipi_addr;
+                LocalAddr->Ipv4.sin_port = SocketContext->Binding->LocalAddress.Ipv6.sin6_port;
+                LocalAddr->Ipv6.sin6_scope_id = PktInfo->ipi_ifindex;
+                FoundLocalAddr = TRUE;
+            } else if (CMsg->cmsg_level == IPPROTO_IPV6 &&
+                       CMsg->cmsg_type == IPV6_TCLASS) {
+                TypeOfService = (uint8_t)*(int*)CMSG_DATA(CMsg);
+            } else if (CMsg->cmsg_level == IPPROTO_IP &&
+                       CMsg->cmsg_type == IP_TOS) {
+                TypeOfService = *(uint8_t*)CMSG_DATA(CMsg);
+            } else if (CMsg->cmsg_level == SOL_SOCKET &&
+                       CMsg->cmsg_type == SCM_TIMESTAMPNS) {
+                RecvTime =
+                    QuicDataPathRecvTimestampToTimeUs(
+                        (struct timespec*)CMSG_DATA(CMsg),
+                        RealTimeNowUs,
+                        TimeNowUs);
+#ifdef UDP_GRO
+            } else if (CMsg->cmsg_level == SOL_UDP && CMsg->cmsg_type == UDP_GRO) {
+                QUIC_DBG_ASSERT(*(int*)CMSG_DATA(CMsg) <= MAX_GRO_PAYLOAD_LENGTH);
+                MessageLength = (uint16_t)*(int*)CMSG_DATA(CMsg);
+                IsCoalesced = TRUE;
+#endif
+            }
+        }
 
-    QUIC_DBG_ASSERT(SocketContext->CurrentRecvBlock != NULL);
-    QUIC_RECV_DATAGRAM* RecvPacket = &SocketContext->CurrentRecvBlock->RecvPacket;
-    SocketContext->CurrentRecvBlock = NULL;
-
-    BOOLEAN FoundLocalAddr = FALSE;
-    QUIC_ADDR* LocalAddr = &RecvPacket->Tuple->LocalAddress;
-    QUIC_ADDR* RemoteAddr = &RecvPacket->Tuple->RemoteAddress;
-    QuicConvertFromMappedV6(RemoteAddr, RemoteAddr);
-
-    struct cmsghdr *CMsg;
-    for (CMsg = CMSG_FIRSTHDR(&SocketContext->RecvMsgHdr);
-         CMsg != NULL;
-         CMsg = CMSG_NXTHDR(&SocketContext->RecvMsgHdr, CMsg)) {
-
-        if (CMsg->cmsg_level == IPPROTO_IPV6 &&
-            CMsg->cmsg_type == IPV6_PKTINFO) {
-            struct in6_pktinfo* PktInfo6 = (struct in6_pktinfo*) CMSG_DATA(CMsg);
-            LocalAddr->Ip.sa_family = AF_INET6;
-            LocalAddr->Ipv6.sin6_addr = PktInfo6->ipi6_addr;
-            LocalAddr->Ipv6.sin6_port = SocketContext->Binding->LocalAddress.Ipv6.sin6_port;
-            QuicConvertFromMappedV6(LocalAddr, LocalAddr);
-
-            LocalAddr->Ipv6.sin6_scope_id = PktInfo6->ipi6_ifindex;
-            FoundLocalAddr = TRUE;
-            break;
+        QUIC_FRE_ASSERT(FoundLocalAddr);
+
+        if (BytesTransferred == 0 || MessageLength == 0) {
+            QuicTraceLogWarning(
+                DatapathRecvEmpty,
+                "[ udp][%p] Dropping datagram with empty payload.",
+                SocketContext->Binding);
+            QuicPoolFree(RecvBlock->OwningPool, RecvBlock);
+            continue;
         }
 
-        if (CMsg->cmsg_level == IPPROTO_IP && CMsg->cmsg_type == IP_PKTINFO) {
-            struct in_pktinfo* PktInfo = (struct in_pktinfo*)CMSG_DATA(CMsg);
-            LocalAddr->Ip.sa_family = AF_INET;
-            LocalAddr->Ipv4.sin_addr = PktInfo->ipi_addr;
-            LocalAddr->Ipv4.sin_port = SocketContext->Binding->LocalAddress.Ipv6.sin6_port;
-            LocalAddr->Ipv6.sin6_scope_id = PktInfo->ipi_ifindex;
-            FoundLocalAddr = TRUE;
-            break;
+        QuicTraceEvent(
+            DatapathRecv,
+            "[ udp][%p] Recv %u bytes (segment=%hu) Src=%!SOCKADDR! Dst=%!SOCKADDR!",
+            SocketContext->Binding,
+            BytesTransferred,
+            MessageLength,
+            LOG_ADDR_LEN(*LocalAddr),
+            LOG_ADDR_LEN(*RemoteAddr),
+            (uint8_t*)LocalAddr,
+            (uint8_t*)RemoteAddr);
+
+        QUIC_DBG_ASSERT(BytesTransferred <= Datapath->RecvPayloadLength);
+
+        //
+        // Split the (possibly coalesced) payload into individual datagrams,
+        // all sharing the receive block's tuple and payload buffer.
+        //
+        uint8_t* RecvPayload = QuicDataPathRecvBlockGetPayload(Datapath, RecvBlock);
+        uint32_t DatagramIndex = 0;
+
+        for ( ;
+            BytesTransferred != 0;
+            BytesTransferred -= MessageLength) {
+
+            QUIC_RECV_DATAGRAM* Datagram =
+                QuicDataPathRecvBlockGetDatagram(Datapath, RecvBlock, DatagramIndex);
+            QuicDataPathDatagramToInternalDatagramContext(Datagram)->RecvBlock = RecvBlock;
+
+            if (MessageLength > BytesTransferred) {
+                //
+                // The last message is smaller than all the rest.
+                //
+                MessageLength = (uint16_t)BytesTransferred;
+            }
+
+            Datagram->Next = NULL;
+            Datagram->Buffer = RecvPayload;
+            Datagram->BufferLength = MessageLength;
+            Datagram->Tuple = &RecvBlock->Tuple;
+            Datagram->PartitionIndex = (uint8_t)ProcContext->Index;
+            Datagram->RecvTime = RecvTime;
+            Datagram->TypeOfService = TypeOfService;
+            Datagram->Allocated = TRUE;
+            Datagram->QueuedOnConnection = FALSE;
+            Datagram->CryptoOffloaded = FALSE;
+
+            RecvPayload += MessageLength;
+
+            //
+            // Add the datagram to the end of the current chain.
+            //
+            *DatagramChainTail = Datagram;
+            DatagramChainTail = &Datagram->Next;
+            RecvBlock->ReferenceCount++;
+
+            if (IsCoalesced && ++DatagramIndex == GRO_MAX_DATAGRAMS_PER_INDICATION) {
+                QuicTraceLogWarning(
+                    DatapathGroPreallocExceeded,
+                    "[ udp][%p] Exceeded GRO preallocation capacity.",
+                    SocketContext->Binding);
+                break;
+            }
         }
     }
 
-    QUIC_FRE_ASSERT(FoundLocalAddr);
-
-    QuicTraceEvent(
-        DatapathRecv,
-        "[ udp][%p] Recv %u bytes (segment=%hu) Src=%!SOCKADDR! Dst=%!SOCKADDR!",
-        SocketContext->Binding,
-        (uint32_t)BytesTransferred,
-        (uint32_t)BytesTransferred,
-        LOG_ADDR_LEN(*LocalAddr),
-        LOG_ADDR_LEN(*RemoteAddr),
-        (uint8_t*)LocalAddr,
-        (uint8_t*)RemoteAddr);
-
-    QUIC_DBG_ASSERT(BytesTransferred <= RecvPacket->BufferLength);
-    RecvPacket->BufferLength = BytesTransferred;
-
-    RecvPacket->PartitionIndex = ProcContext->Index;
-
-    QUIC_DBG_ASSERT(SocketContext->Binding->Datapath->RecvHandler);
-    SocketContext->Binding->Datapath->RecvHandler(
-        SocketContext->Binding,
-        SocketContext->Binding->ClientContext,
-        RecvPacket);
+    if (DatagramChain != NULL) {
+        QUIC_DBG_ASSERT(Datapath->RecvHandler);
+        Datapath->RecvHandler(
+            SocketContext->Binding,
+            SocketContext->Binding->ClientContext,
+            DatagramChain);
+    }
 
     Status = QuicSocketContextPrepareReceive(SocketContext);
 
@@ -1249,6 +2587,44 @@ QuicSocketContextRecvComplete(
     QUIC_FRE_ASSERT(QUIC_SUCCEEDED(Status));
 }
 
+QUIC_STATUS
+QuicSocketContextArmSendReady(
+    _In_ QUIC_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+#ifdef QUIC_LINUX_IO_URING
+    if (SocketContext->Binding->Datapath->UseUring) {
+        return QuicSocketContextUringPostSendReady(SocketContext, ProcContext);
+    }
+#endif
+
+    struct epoll_event SockFdEpEvt = {
+        .events = EPOLLIN | EPOLLOUT | EPOLLET,
+        .data = {
+            .ptr = &SocketContext->EventContexts[QUIC_SOCK_EVENT_SOCKET]
+        }
+    };
+
+    int Ret =
+        epoll_ctl(
+            ProcContext->EpollFd,
+            EPOLL_CTL_MOD,
+            SocketContext->SocketFd,
+            &SockFdEpEvt);
+    if (Ret != 0) {
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            SocketContext->Binding,
+            errno,
+            "epoll_ctl failed");
+        return errno;
+    }
+
+    return QUIC_STATUS_SUCCESS;
+}
+
 QUIC_STATUS
 QuicSocketContextPendSend(
     _In_ QUIC_SOCKET_CONTEXT* SocketContext,
@@ -1260,29 +2636,20 @@ QuicSocketContextPendSend(
 {
     if (!SocketContext->SendWaiting) {
 
-        struct epoll_event SockFdEpEvt = {
-            .events = EPOLLIN | EPOLLOUT | EPOLLET,
-            .data = {
-                .ptr = &SocketContext->EventContexts[QUIC_SOCK_EVENT_SOCKET]
-            }
-        };
-
-        int Ret =
-            epoll_ctl(
-                ProcContext->EpollFd,
-                EPOLL_CTL_MOD,
-                SocketContext->SocketFd,
-                &SockFdEpEvt);
-        if (Ret != 0) {
-            QuicTraceEvent(
-                DatapathErrorStatus,
-                "[ udp][%p] ERROR, %u, %s.",
-                SocketContext->Binding,
-                errno,
-                "epoll_ctl failed");
-            return errno;
+        QUIC_STATUS Status =
+            QuicSocketContextArmSendReady(SocketContext, ProcContext);
+        if (QUIC_FAILED(Status)) {
+            return Status;
         }
 
+        SocketContext->SendWaiting = TRUE;
+    }
+
+    if (!SendContext->Pending) {
+        //
+        // Save the addresses of every newly pended send, since sends queued
+        // behind the first one may each be to a different remote host.
+        //
         if (LocalAddress != NULL) {
             QuicCopyMemory(
                 &SendContext->LocalAddress,
@@ -1295,8 +2662,6 @@ QuicSocketContextPendSend(
             &SendContext->RemoteAddress,
             RemoteAddress,
             sizeof(*RemoteAddress));
-
-        SocketContext->SendWaiting = TRUE;
     }
 
     if (SendContext->Pending) {
@@ -1385,15 +2750,404 @@ Exit:
     return Status;
 }
 
-void
-QuicSocketContextProcessEvents(
-    _In_ void* EventPtr,
-    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext,
-    _In_ int Events
+#ifdef QUIC_LINUX_IO_URING
+
+//
+// io_uring backend. Receives are posted as one IORING_OP_RECVMSG per receive
+// slot, reusing the same msg headers and receive blocks as the recvmmsg path,
+// and re-posted as soon as the slot is re-armed. Write readiness and socket
+// cleanup are watched with one-shot polls. All completions are reaped by the
+// per-proc worker thread.
+//
+
+static
+struct io_uring_sqe*
+QuicProcContextGetUringSqe(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
     )
 {
-    uint8_t EventType = *(uint8_t*)EventPtr;
-    QUIC_SOCKET_CONTEXT* SocketContext =
+    //
+    // Must be called with RingLock held.
+    //
+    struct io_uring_sqe* Sqe = QuicUringGetSqe(&ProcContext->Ring);
+    if (Sqe == NULL) {
+        //
+        // The submission queue is full. Hand what is queued to the kernel to
+        // make room.
+        //
+        QuicUringFlush(&ProcContext->Ring);
+        (void)QuicUringSubmitAndWait(&ProcContext->Ring, 0);
+        Sqe = QuicUringGetSqe(&ProcContext->Ring);
+        if (Sqe == NULL) {
+            QuicTraceEvent(
+                LibraryErrorStatus,
+                "[ lib] ERROR, %u, %s.",
+                QUIC_STATUS_OUT_OF_MEMORY,
+                "io_uring submission queue full");
+        }
+    }
+    return Sqe;
+}
+
+static
+QUIC_STATUS
+QuicSocketContextUringPostRecv(
+    _In_ QUIC_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext,
+    _In_ uint32_t Index
+    )
+{
+    //
+    // Must be called with RingLock held.
+    //
+    struct io_uring_sqe* Sqe = QuicProcContextGetUringSqe(ProcContext);
+    if (Sqe == NULL) {
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    QUIC_URING_OPERATION* Operation = &SocketContext->RecvOperations[Index];
+    QUIC_DBG_ASSERT(!Operation->Pending);
+    QUIC_DBG_ASSERT(SocketContext->CurrentRecvBlocks[Index] != NULL);
+    Operation->Pending = TRUE;
+    InterlockedIncrement(&SocketContext->OutstandingUringOperations);
+
+    Sqe->opcode = IORING_OP_RECVMSG;
+    Sqe->fd = SocketContext->SocketFd;
+    Sqe->addr = (uint64_t)(uintptr_t)&SocketContext->RecvMsgHdrs[Index].msg_hdr;
+    Sqe->len = 1;
+    Sqe->user_data = (uint64_t)(uintptr_t)Operation;
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+static
+QUIC_STATUS
+QuicSocketContextUringPostPoll(
+    _In_ QUIC_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext,
+    _In_ QUIC_URING_OPERATION* Operation,
+    _In_ int Fd,
+    _In_ uint32_t Events
+    )
+{
+    //
+    // Must be called with RingLock held.
+    //
+    struct io_uring_sqe* Sqe = QuicProcContextGetUringSqe(ProcContext);
+    if (Sqe == NULL) {
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    QUIC_DBG_ASSERT(!Operation->Pending);
+    Operation->Pending = TRUE;
+    InterlockedIncrement(&SocketContext->OutstandingUringOperations);
+
+    Sqe->opcode = IORING_OP_POLL_ADD;
+    Sqe->fd = Fd;
+    Sqe->poll32_events = Events;
+    Sqe->user_data = (uint64_t)(uintptr_t)Operation;
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+static
+void
+QuicSocketContextUringPostCancel(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext,
+    _In_ QUIC_URING_OPERATION* Operation
+    )
+{
+    //
+    // Must be called with RingLock held. The cancel request itself has no
+    // socket context, as it may complete after the socket is cleaned up.
+    //
+    struct io_uring_sqe* Sqe = QuicProcContextGetUringSqe(ProcContext);
+    if (Sqe != NULL) {
+        Sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        Sqe->addr = (uint64_t)(uintptr_t)Operation;
+        Sqe->user_data = (uint64_t)(uintptr_t)&QuicUringCancelOperation;
+    }
+}
+
+QUIC_STATUS
+QuicSocketContextUringStartReceive(
+    _In_ QUIC_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    const uint32_t RecvBatchCount = SocketContext->Binding->Datapath->RecvBatchCount;
+
+    for (uint32_t i = 0; i < QUIC_MAX_RECEIVE_BATCH_COUNT; ++i) {
+        SocketContext->RecvOperations[i].SocketContext = SocketContext;
+        SocketContext->RecvOperations[i].Type = QUIC_URING_OP_RECV;
+        SocketContext->RecvOperations[i].Index = (uint8_t)i;
+    }
+    SocketContext->SendReadyOperation.SocketContext = SocketContext;
+    SocketContext->SendReadyOperation.Type = QUIC_URING_OP_SEND_READY;
+    SocketContext->CleanupOperation.SocketContext = SocketContext;
+    SocketContext->CleanupOperation.Type = QUIC_URING_OP_CLEANUP;
+
+    QuicLockAcquire(&ProcContext->RingLock);
+
+    Status =
+        QuicSocketContextUringPostPoll(
+            SocketContext,
+            ProcContext,
+            &SocketContext->CleanupOperation,
+            SocketContext->CleanupFd,
+            POLLIN);
+    if (QUIC_FAILED(Status)) {
+        goto Exit;
+    }
+
+    for (uint32_t i = 0; i < RecvBatchCount; ++i) {
+        Status = QuicSocketContextUringPostRecv(SocketContext, ProcContext, i);
+        if (QUIC_FAILED(Status)) {
+            goto Exit;
+        }
+    }
+
+Exit:
+
+    QuicUringFlush(&ProcContext->Ring);
+    QUIC_STATUS SubmitStatus = QuicUringSubmitAndWait(&ProcContext->Ring, 0);
+    QuicLockRelease(&ProcContext->RingLock);
+
+    if (QUIC_SUCCEEDED(Status) && QUIC_FAILED(SubmitStatus)) {
+        Status = SubmitStatus;
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            SocketContext->Binding,
+            Status,
+            "io_uring_enter failed");
+    }
+
+    return Status;
+}
+
+QUIC_STATUS
+QuicSocketContextUringPostSendReady(
+    _In_ QUIC_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+    QuicLockAcquire(&ProcContext->RingLock);
+    QUIC_STATUS Status =
+        QuicSocketContextUringPostPoll(
+            SocketContext,
+            ProcContext,
+            &SocketContext->SendReadyOperation,
+            SocketContext->SocketFd,
+            POLLOUT);
+    if (QUIC_SUCCEEDED(Status)) {
+        QuicUringFlush(&ProcContext->Ring);
+        Status = QuicUringSubmitAndWait(&ProcContext->Ring, 0);
+    }
+    QuicLockRelease(&ProcContext->RingLock);
+
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            SocketContext->Binding,
+            Status,
+            "io_uring POLL_ADD failed");
+    }
+
+    return Status;
+}
+
+static
+void
+QuicSocketContextUringRecvComplete(
+    _In_ QUIC_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext,
+    _In_ uint32_t Index,
+    _In_ int Result
+    )
+{
+    if (Result < 0) {
+        //
+        // A canceled receive means the socket is going away, so the slot
+        // isn't re-posted.
+        //
+        if (Result == -ECANCELED || SocketContext->Binding->Shutdown) {
+            return;
+        }
+
+        if (Result != -EAGAIN && Result != -EWOULDBLOCK) {
+            QuicTraceEvent(
+                DatapathErrorStatus,
+                "[ udp][%p] ERROR, %u, %s.",
+                SocketContext->Binding,
+                (uint32_t)-Result,
+                "io_uring recvmsg failed");
+        }
+
+        //
+        // Send unreachable notification to MsQuic if any related errors were
+        // received. Like the epoll path, every other error is just traced and
+        // receiving carries on; the socket error is consumed by the failed
+        // receive, so the re-posted one waits for the next datagram.
+        //
+        if (Result == -ECONNREFUSED ||
+            Result == -EHOSTUNREACH ||
+            Result == -ENETUNREACH) {
+            SocketContext->Binding->Datapath->UnreachHandler(
+                SocketContext->Binding,
+                SocketContext->Binding->ClientContext,
+                &SocketContext->Binding->RemoteAddress);
+        }
+
+    } else {
+        SocketContext->RecvMsgHdrs[Index].msg_len = (unsigned int)Result;
+        QuicSocketContextRecvComplete(SocketContext, ProcContext, (int)Index, 1);
+    }
+
+    QuicLockAcquire(&ProcContext->RingLock);
+    QUIC_STATUS Status = QuicSocketContextUringPostRecv(SocketContext, ProcContext, Index);
+    QuicLockRelease(&ProcContext->RingLock);
+
+    //
+    // Posting can only fail if the submission queue cannot be drained. Treat
+    // it as a fatal error, like the failure to re-arm the receive.
+    //
+    QUIC_FRE_ASSERT(QUIC_SUCCEEDED(Status));
+}
+
+static
+void
+QuicSocketContextUringComplete(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext,
+    _In_ QUIC_URING_OPERATION* Operation,
+    _In_ int Result
+    )
+{
+    if (Operation->Type == QUIC_URING_OP_CANCEL) {
+        return;
+    }
+
+    QUIC_SOCKET_CONTEXT* SocketContext = Operation->SocketContext;
+    QUIC_DBG_ASSERT(Operation->Pending);
+    Operation->Pending = FALSE;
+
+    if (Operation->Type == QUIC_URING_OP_CLEANUP) {
+        QUIC_DBG_ASSERT(SocketContext->Binding->Shutdown);
+        SocketContext->UringCleanupStarted = TRUE;
+
+        //
+        // Cancel everything still outstanding on the socket. The socket is
+        // cleaned up once their completions have all been reaped.
+        //
+        QuicLockAcquire(&ProcContext->RingLock);
+        for (uint32_t i = 0; i < QUIC_MAX_RECEIVE_BATCH_COUNT; ++i) {
+            if (SocketContext->RecvOperations[i].Pending) {
+                QuicSocketContextUringPostCancel(
+                    ProcContext, &SocketContext->RecvOperations[i]);
+            }
+        }
+        if (SocketContext->SendReadyOperation.Pending) {
+            QuicSocketContextUringPostCancel(
+                ProcContext, &SocketContext->SendReadyOperation);
+        }
+        QuicLockRelease(&ProcContext->RingLock);
+
+    } else if (!SocketContext->UringCleanupStarted) {
+        if (Operation->Type == QUIC_URING_OP_RECV) {
+            QuicSocketContextUringRecvComplete(
+                SocketContext, ProcContext, Operation->Index, Result);
+        } else {
+            QUIC_DBG_ASSERT(Operation->Type == QUIC_URING_OP_SEND_READY);
+            //
+            // Polls are one-shot, so there is nothing to re-register; just
+            // flush the pending sends.
+            //
+            SocketContext->SendWaiting = FALSE;
+            QuicSocketContextSendComplete(SocketContext, ProcContext);
+        }
+    }
+
+    if (InterlockedDecrement(&SocketContext->OutstandingUringOperations) == 0 &&
+        SocketContext->UringCleanupStarted) {
+        QuicSocketContextUninitializeComplete(SocketContext, ProcContext);
+    }
+}
+
+void
+QuicProcContextUringEventLoop(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+    while (!ProcContext->Datapath->Shutdown) {
+
+        //
+        // Submit everything queued while processing the last set of
+        // completions (mostly receive re-posts) and wait for more, in a
+        // single system call.
+        //
+        QuicLockAcquire(&ProcContext->RingLock);
+        QuicUringFlush(&ProcContext->Ring);
+        QuicLockRelease(&ProcContext->RingLock);
+
+        uint32_t WaitCount = 1;
+        const uint32_t BusyPollUs = ProcContext->Datapath->BusyPollUs;
+        if (BusyPollUs != 0) {
+            //
+            // Submit without waiting and then spin on the (shared memory)
+            // completion queue for up to the busy poll budget.
+            //
+            QUIC_STATUS Status = QuicUringSubmitAndWait(&ProcContext->Ring, 0);
+            QUIC_FRE_ASSERT(QUIC_SUCCEEDED(Status));
+            const uint64_t StartTime = QuicTimeUs64();
+            while (QuicUringPeekCqe(&ProcContext->Ring) == NULL &&
+                   !ProcContext->Datapath->Shutdown &&
+                   QuicTimeDiff64(StartTime, QuicTimeUs64()) < BusyPollUs) {
+                YieldProcessor();
+            }
+            if (QuicUringPeekCqe(&ProcContext->Ring) != NULL) {
+                WaitCount = 0;
+            }
+        }
+
+        QUIC_STATUS Status = QuicUringSubmitAndWait(&ProcContext->Ring, WaitCount);
+        QUIC_FRE_ASSERT(QUIC_SUCCEEDED(Status));
+
+        struct io_uring_cqe* Cqe;
+        while ((Cqe = QuicUringPeekCqe(&ProcContext->Ring)) != NULL) {
+            const uint64_t UserData = Cqe->user_data;
+            const int Result = Cqe->res;
+            QuicUringCqeSeen(&ProcContext->Ring);
+
+            if (UserData == 0) {
+                //
+                // The processor context is shutting down and the worker thread
+                // needs to clean up.
+                //
+                QUIC_DBG_ASSERT(ProcContext->Datapath->Shutdown);
+                break;
+            }
+
+            QuicSocketContextUringComplete(
+                ProcContext,
+                (QUIC_URING_OPERATION*)(uintptr_t)UserData,
+                Result);
+        }
+    }
+}
+
+#endif // QUIC_LINUX_IO_URING
+
+void
+QuicSocketContextProcessEvents(
+    _In_ void* EventPtr,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext,
+    _In_ int Events
+    )
+{
+    uint8_t EventType = *(uint8_t*)EventPtr;
+    QUIC_SOCKET_CONTEXT* SocketContext =
         ((QUIC_SOCKET_CONTEXT*)( \
             (uint8_t*)(EventPtr) - \
             (size_t)(&((QUIC_SOCKET_CONTEXT*)0)->EventContexts) -
@@ -1447,35 +3201,491 @@ QuicSocketContextProcessEvents(
         }
     }
 
-    if (EPOLLIN & Events) {
-        while (TRUE) {
-            QUIC_DBG_ASSERT(SocketContext->CurrentRecvBlock != NULL);
+    if (EPOLLIN & Events) {
+        while (TRUE) {
+            int Ret =
+                recvmmsg(
+                    SocketContext->SocketFd,
+                    SocketContext->RecvMsgHdrs,
+                    SocketContext->Binding->Datapath->RecvBatchCount,
+                    0,
+                    NULL);
+            if (Ret <= 0) {
+                if (Ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    QuicTraceEvent(
+                        DatapathErrorStatus,
+                        "[ udp][%p] ERROR, %u, %s.",
+                        SocketContext->Binding,
+                        errno,
+                        "recvmmsg failed");
+                }
+                break;
+            } else {
+                QuicSocketContextRecvComplete(SocketContext, ProcContext, 0, Ret);
+            }
+        }
+    }
+
+    if (EPOLLOUT & Events) {
+        QuicSocketContextSendComplete(SocketContext, ProcContext);
+    }
+}
+
+#ifdef QUIC_LINUX_XDP
+//
+// AF_XDP fast path. Datagrams to server bindings with a specific IPv4 address
+// are redirected by an XDP program to per-queue AF_XDP sockets, whose UMEM
+// frames back the receive datagrams and send buffers directly. Everything the
+// program passes on, as well as sends to peers whose next hop isn't known yet,
+// still goes through the binding's regular sockets.
+//
+
+static
+QUIC_STATUS
+QuicDataPathXdpStart(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t IfIndex
+    )
+{
+    QUIC_STATUS Status;
+    uint32_t SocketCount = 0;
+
+#ifdef QUIC_LINUX_IO_URING
+    if (Datapath->UseUring) {
+        return QUIC_STATUS_NOT_SUPPORTED;
+    }
+#endif
+
+    Status = QuicXdpProgramInitialize(IfIndex, &Datapath->XdpProgram);
+    if (QUIC_FAILED(Status)) {
+        return Status;
+    }
+
+    //
+    // Receive queue N is served by processor context N. Queues beyond the
+    // processor count get no socket, and the program passes their datagrams
+    // to the kernel stack.
+    //
+    const uint32_t QueueCount =
+        min(Datapath->XdpProgram.QueueCount, Datapath->ProcCount);
+    for (; SocketCount < QueueCount; ++SocketCount) {
+        QUIC_DATAPATH_PROC_CONTEXT* ProcContext = &Datapath->ProcContexts[SocketCount];
+        QUIC_DBG_ASSERT(ProcContext->Started); // Server bindings start them all.
+
+        QUIC_XDP_SOCKET* Socket = QUIC_ALLOC_PAGED(sizeof(QUIC_XDP_SOCKET));
+        if (Socket == NULL) {
+            Status = QUIC_STATUS_OUT_OF_MEMORY;
+            QuicTraceEvent(
+                AllocFailure,
+                "Allocation of '%s' failed. (%llu bytes)",
+                "QUIC_XDP_SOCKET",
+                sizeof(QUIC_XDP_SOCKET));
+            break;
+        }
+
+        Status = QuicXdpSocketInitialize(&Datapath->XdpProgram, SocketCount, Socket);
+        if (QUIC_FAILED(Status)) {
+            QUIC_FREE(Socket);
+            break;
+        }
+
+        //
+        // Published before registering with epoll, as the epoll thread uses it
+        // to recognize the socket's events.
+        //
+        ProcContext->XdpSocket = Socket;
+
+        struct epoll_event SockFdEpEvt = {
+            .events = EPOLLIN,
+            .data = {
+                .ptr = Socket
+            }
+        };
+        if (epoll_ctl(ProcContext->EpollFd, EPOLL_CTL_ADD, Socket->Fd, &SockFdEpEvt) != 0) {
+            Status = errno;
+            QuicTraceEvent(
+                LibraryErrorStatus,
+                "[ lib] ERROR, %u, %s.",
+                Status,
+                "epoll_ctl(EPOLL_CTL_ADD, XDP) failed");
+            ProcContext->XdpSocket = NULL;
+            QuicXdpSocketUninitialize(Socket);
+            QUIC_FREE(Socket);
+            break;
+        }
+    }
+
+    if (SocketCount == 0) {
+        QuicXdpProgramUninitialize(&Datapath->XdpProgram);
+        return Status;
+    }
+
+    QuicTraceLogInfo(
+        DatapathXdpStarted,
+        "[ udp] AF_XDP started on interface %u, %u of %u queues",
+        IfIndex,
+        SocketCount,
+        Datapath->XdpProgram.QueueCount);
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+static
+void
+QuicDataPathBindingXdpRegister(
+    _In_ QUIC_DATAPATH_BINDING* Binding
+    )
+{
+    QUIC_DATAPATH* Datapath = Binding->Datapath;
+
+    if (Binding->LocalAddress.Ip.sa_family != AF_INET ||
+        QuicAddrIsWildCard(&Binding->LocalAddress)) {
+        return;
+    }
+
+    const uint32_t IfIndex = QuicXdpGetInterfaceIndex(&Binding->LocalAddress);
+    if (IfIndex == 0) {
+        return;
+    }
+
+    QuicLockAcquire(&Datapath->XdpLock);
+
+    if (Datapath->XdpState == QUIC_XDP_STATE_UNINITIALIZED) {
+        QUIC_STATUS Status = QuicDataPathXdpStart(Datapath, IfIndex);
+        if (QUIC_FAILED(Status)) {
+            QuicTraceLogWarning(
+                DatapathXdpUnsupported,
+                "[ udp] AF_XDP unavailable, using sockets only, 0x%x",
+                Status);
+            Datapath->XdpState = QUIC_XDP_STATE_FAILED;
+        } else {
+            Datapath->XdpState = QUIC_XDP_STATE_ACTIVE;
+        }
+    }
+
+    if (Datapath->XdpState == QUIC_XDP_STATE_ACTIVE &&
+        Datapath->XdpProgram.IfIndex == IfIndex) {
+        //
+        // The binding must be findable before the program starts redirecting
+        // its datagrams.
+        //
+        QuicRwLockAcquireExclusive(&Datapath->XdpBindingsLock);
+        QuicListInsertTail(&Datapath->XdpBindings, &Binding->XdpLink);
+        QuicRwLockReleaseExclusive(&Datapath->XdpBindingsLock);
+
+        QUIC_STATUS Status =
+            QuicXdpProgramSetAddress(&Datapath->XdpProgram, &Binding->LocalAddress, TRUE);
+        if (QUIC_SUCCEEDED(Status)) {
+            Binding->Xdp = TRUE;
+        } else {
+            QuicTraceEvent(
+                DatapathErrorStatus,
+                "[ udp][%p] ERROR, %u, %s.",
+                Binding,
+                Status,
+                "QuicXdpProgramSetAddress failed");
+            QuicRwLockAcquireExclusive(&Datapath->XdpBindingsLock);
+            QuicListEntryRemove(&Binding->XdpLink);
+            QuicRwLockReleaseExclusive(&Datapath->XdpBindingsLock);
+        }
+    }
+
+    QuicLockRelease(&Datapath->XdpLock);
+}
+
+static
+void
+QuicDataPathBindingXdpUnregister(
+    _In_ QUIC_DATAPATH_BINDING* Binding
+    )
+{
+    QUIC_DATAPATH* Datapath = Binding->Datapath;
+
+    QuicLockAcquire(&Datapath->XdpLock);
+    (void)QuicXdpProgramSetAddress(&Datapath->XdpProgram, &Binding->LocalAddress, FALSE);
+
+    //
+    // Once removed (under the exclusive lock), no receive indication for the
+    // binding can be in progress or start.
+    //
+    QuicRwLockAcquireExclusive(&Datapath->XdpBindingsLock);
+    QuicListEntryRemove(&Binding->XdpLink);
+    QuicRwLockReleaseExclusive(&Datapath->XdpBindingsLock);
+    QuicLockRelease(&Datapath->XdpLock);
+}
+
+static
+QUIC_XDP_NEIGHBOR*
+QuicDataPathXdpGetNeighbor(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Address
+    )
+{
+    const uint32_t Hash = Address ^ (Address >> 8) ^ (Address >> 16) ^ (Address >> 24);
+    return &Datapath->XdpNeighbors[Hash % QUIC_XDP_NEIGHBOR_COUNT];
+}
+
+static
+void
+QuicDataPathXdpLearnNeighbor(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_reads_bytes_(6) const uint8_t* MacAddress
+    )
+{
+    const uint32_t Address = RemoteAddress->Ipv4.sin_addr.s_addr;
+    QUIC_XDP_NEIGHBOR* Neighbor = QuicDataPathXdpGetNeighbor(Datapath, Address);
+
+    QuicLockAcquire(&Datapath->XdpNeighborLock);
+    Neighbor->Address = Address;
+    QuicCopyMemory(Neighbor->MacAddress, MacAddress, sizeof(Neighbor->MacAddress));
+    QuicLockRelease(&Datapath->XdpNeighborLock);
+}
+
+_Success_(return != FALSE)
+static
+BOOLEAN
+QuicDataPathXdpLookupNeighbor(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _Out_writes_bytes_(6) uint8_t* MacAddress
+    )
+{
+    const uint32_t Address = RemoteAddress->Ipv4.sin_addr.s_addr;
+    QUIC_XDP_NEIGHBOR* Neighbor = QuicDataPathXdpGetNeighbor(Datapath, Address);
+    BOOLEAN Found = FALSE;
+
+    QuicLockAcquire(&Datapath->XdpNeighborLock);
+    if (Neighbor->Address == Address && Address != 0) {
+        QuicCopyMemory(MacAddress, Neighbor->MacAddress, sizeof(Neighbor->MacAddress));
+        Found = TRUE;
+    }
+    QuicLockRelease(&Datapath->XdpNeighborLock);
+
+    return Found;
+}
+
+static
+QUIC_DATAPATH_BINDING*
+QuicDataPathXdpLookupBinding(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ const QUIC_ADDR* LocalAddress
+    )
+{
+    for (QUIC_LIST_ENTRY* Link = Datapath->XdpBindings.Flink;
+        Link != &Datapath->XdpBindings;
+        Link = Link->Flink) {
+        QUIC_DATAPATH_BINDING* Binding =
+            QUIC_CONTAINING_RECORD(Link, QUIC_DATAPATH_BINDING, XdpLink);
+        if (Binding->LocalAddress.Ipv4.sin_addr.s_addr == LocalAddress->Ipv4.sin_addr.s_addr &&
+            Binding->LocalAddress.Ipv4.sin_port == LocalAddress->Ipv4.sin_port) {
+            return Binding;
+        }
+    }
+    return NULL;
+}
+
+static
+void
+QuicProcContextXdpReceive(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+    QUIC_DATAPATH* Datapath = ProcContext->Datapath;
+    QUIC_XDP_SOCKET* Socket = ProcContext->XdpSocket;
+    struct xdp_desc Descs[QUIC_XDP_RECEIVE_BATCH_COUNT];
+    uint32_t Count;
+
+    while ((Count = QuicXdpSocketReceive(Socket, Descs, ARRAYSIZE(Descs))) != 0) {
+
+        QUIC_DATAPATH_BINDING* ChainBinding = NULL;
+        QUIC_RECV_DATAGRAM* DatagramChain = NULL;
+        QUIC_RECV_DATAGRAM** DatagramChainTail = &DatagramChain;
+        uint32_t LastLearnedAddress = 0;
+        const uint64_t RecvTime = QuicTimeUs64();
+
+        QuicRwLockAcquireShared(&Datapath->XdpBindingsLock);
+
+        for (uint32_t i = 0; i < Count; ++i) {
+            uint8_t* Frame = QuicXdpSocketGetFrame(Socket, Descs[i].addr);
+            const uint64_t FrameAddress = QuicXdpSocketGetFrameAddress(Socket, Frame);
+            QUIC_ADDR LocalAddress, RemoteAddress;
+            uint8_t RemoteMacAddress[6];
+            uint8_t TypeOfService;
+            uint16_t PayloadLength;
+
+            if (!QuicXdpParseHeaders(
+                    Frame,
+                    Descs[i].len,
+                    &LocalAddress,
+                    &RemoteAddress,
+                    RemoteMacAddress,
+                    &TypeOfService,
+                    &PayloadLength) ||
+                PayloadLength == 0) {
+                QuicXdpSocketFreeFrame(Socket, FrameAddress);
+                continue;
+            }
+
+            QUIC_DATAPATH_BINDING* Binding =
+                ChainBinding != NULL &&
+                ChainBinding->LocalAddress.Ipv4.sin_addr.s_addr == LocalAddress.Ipv4.sin_addr.s_addr &&
+                ChainBinding->LocalAddress.Ipv4.sin_port == LocalAddress.Ipv4.sin_port ?
+                    ChainBinding :
+                    QuicDataPathXdpLookupBinding(Datapath, &LocalAddress);
+            if (Binding == NULL) {
+                //
+                // The binding was deleted after the program redirected this.
+                //
+                QuicXdpSocketFreeFrame(Socket, FrameAddress);
+                continue;
+            }
+
+            QUIC_DATAPATH_RECV_BLOCK* RecvBlock =
+                QuicPoolAlloc(&ProcContext->XdpRecvBlockPool);
+            if (RecvBlock == NULL) {
+                QuicTraceEvent(
+                    AllocFailure,
+                    "Allocation of '%s' failed. (%llu bytes)",
+                    "QUIC_DATAPATH_RECV_BLOCK",
+                    0);
+                QuicXdpSocketFreeFrame(Socket, FrameAddress);
+                continue;
+            }
+
+            if (RemoteAddress.Ipv4.sin_addr.s_addr != LastLearnedAddress) {
+                QuicDataPathXdpLearnNeighbor(Datapath, &RemoteAddress, RemoteMacAddress);
+                LastLearnedAddress = RemoteAddress.Ipv4.sin_addr.s_addr;
+            }
+
+            QuicZeroMemory(RecvBlock, sizeof(*RecvBlock));
+            RecvBlock->OwningPool = &ProcContext->XdpRecvBlockPool;
+            RecvBlock->ReferenceCount = 1;
+            RecvBlock->XdpSocket = Socket;
+            RecvBlock->XdpFrame = FrameAddress;
+            RecvBlock->Tuple.LocalAddress = LocalAddress;
+            RecvBlock->Tuple.LocalAddress.Ipv6.sin6_scope_id = Datapath->XdpProgram.IfIndex;
+            RecvBlock->Tuple.RemoteAddress = RemoteAddress;
+
+            QuicTraceEvent(
+                DatapathRecv,
+                "[ udp][%p] Recv %u bytes (segment=%hu) Src=%!SOCKADDR! Dst=%!SOCKADDR!",
+                Binding,
+                (uint32_t)PayloadLength,
+                PayloadLength,
+                LOG_ADDR_LEN(LocalAddress),
+                LOG_ADDR_LEN(RemoteAddress),
+                (uint8_t*)&LocalAddress,
+                (uint8_t*)&RemoteAddress);
+
+            QUIC_RECV_DATAGRAM* Datagram =
+                QuicDataPathRecvBlockGetDatagram(Datapath, RecvBlock, 0);
+            QuicDataPathDatagramToInternalDatagramContext(Datagram)->RecvBlock = RecvBlock;
+            Datagram->Next = NULL;
+            Datagram->Buffer = Frame + QUIC_XDP_HEADERS_LENGTH;
+            Datagram->BufferLength = PayloadLength;
+            Datagram->Tuple = &RecvBlock->Tuple;
+            Datagram->PartitionIndex = (uint8_t)ProcContext->Index;
+            Datagram->RecvTime = RecvTime;
+            Datagram->TypeOfService = TypeOfService;
+            Datagram->Allocated = TRUE;
+            Datagram->QueuedOnConnection = FALSE;
+            Datagram->CryptoOffloaded = FALSE;
+
+            if (Binding != ChainBinding && DatagramChain != NULL) {
+                Datapath->RecvHandler(
+                    ChainBinding,
+                    ChainBinding->ClientContext,
+                    DatagramChain);
+                DatagramChain = NULL;
+                DatagramChainTail = &DatagramChain;
+            }
+
+            ChainBinding = Binding;
+            *DatagramChainTail = Datagram;
+            DatagramChainTail = &Datagram->Next;
+        }
+
+        if (DatagramChain != NULL) {
+            Datapath->RecvHandler(
+                ChainBinding,
+                ChainBinding->ClientContext,
+                DatagramChain);
+        }
+
+        QuicRwLockReleaseShared(&Datapath->XdpBindingsLock);
+
+        QuicXdpSocketRefill(Socket);
+    }
+}
+
+//
+// Sends the datagrams over AF_XDP. Returns FALSE, leaving the send context
+// untouched, if they must go through the socket instead.
+//
+static
+BOOLEAN
+QuicDataPathBindingXdpSend(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_opt_ const QUIC_ADDR* LocalAddress,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
+    )
+{
+    QUIC_DATAPATH* Datapath = Binding->Datapath;
+    QUIC_XDP_SOCKET* Socket = SendContext->XdpSocket;
+    struct xdp_desc Descs[QUIC_MAX_BATCH_SEND];
+    uint8_t RemoteMacAddress[6];
+    QUIC_ADDR SourceAddress;
+
+    if (SendContext->CurrentIndex != 0 ||
+        RemoteAddress->Ip.sa_family != AF_INET ||
+        (LocalAddress != NULL && LocalAddress->Ip.sa_family != AF_INET) ||
+        !QuicDataPathXdpLookupNeighbor(Datapath, RemoteAddress, RemoteMacAddress)) {
+        return FALSE;
+    }
+
+    SourceAddress = LocalAddress != NULL ? *LocalAddress : Binding->LocalAddress;
+    SourceAddress.Ipv4.sin_port = Binding->LocalAddress.Ipv4.sin_port;
 
-            ssize_t Ret =
-                recvmsg(
-                    SocketContext->SocketFd,
-                    &SocketContext->RecvMsgHdr,
-                    0);
-            if (Ret < 0) {
-                if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                    QuicTraceEvent(
-                        DatapathErrorStatus,
-                        "[ udp][%p] ERROR, %u, %s.",
-                        SocketContext->Binding,
-                        errno,
-                        "recvmsg failed");
-                }
-                break;
-            } else {
-                QuicSocketContextRecvComplete(SocketContext, ProcContext, Ret);
-            }
-        }
+    for (size_t i = 0; i < SendContext->BufferCount; ++i) {
+        uint8_t* Frame = SendContext->Buffers[i].Buffer - QUIC_XDP_HEADERS_LENGTH;
+        QuicXdpWriteHeaders(
+            Frame,
+            Datapath->XdpProgram.MacAddress,
+            RemoteMacAddress,
+            &SourceAddress,
+            RemoteAddress,
+            SendContext->ECN,
+            (uint16_t)SendContext->Buffers[i].Length);
+        Descs[i].addr = QuicXdpSocketGetFrameAddress(Socket, Frame);
+        Descs[i].len = QUIC_XDP_HEADERS_LENGTH + SendContext->Buffers[i].Length;
+        Descs[i].options = 0;
+
+        QuicTraceEvent(
+            DatapathSendFromTo,
+            "[ udp][%p] Send %u bytes in %hhu buffers (segment=%hu) Dst=%!SOCKADDR!, Src=%!SOCKADDR!",
+            Binding,
+            SendContext->Buffers[i].Length,
+            1,
+            SendContext->Buffers[i].Length,
+            LOG_ADDR_LEN(*RemoteAddress),
+            LOG_ADDR_LEN(SourceAddress),
+            (uint8_t*)RemoteAddress,
+            (uint8_t*)&SourceAddress);
     }
 
-    if (EPOLLOUT & Events) {
-        QuicSocketContextSendComplete(SocketContext, ProcContext);
+    if (!QuicXdpSocketTransmit(Socket, Descs, (uint32_t)SendContext->BufferCount)) {
+        return FALSE;
     }
+
+    //
+    // The frames belong to the socket again once transmitted.
+    //
+    SendContext->BufferCount = 0;
+    return TRUE;
 }
+#endif // QUIC_LINUX_XDP
 
 //
 // Datapath binding interface.
@@ -1501,7 +3711,11 @@ QuicDataPathBindingCreate(
 #else
     QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
 
-    uint32_t SocketCount = Datapath->ProcCount; // TODO - Only use 1 for client (RemoteAddress != NULL) bindings?
+    //
+    // Connected bindings are used by a single (client) connection, which
+    // sends and receives on its own partition, so one socket is enough.
+    //
+    uint32_t SocketCount = RemoteAddress != NULL ? 1 : Datapath->ProcCount;
     size_t BindingLength =
         sizeof(QUIC_DATAPATH_BINDING) +
         SocketCount * sizeof(QUIC_SOCKET_CONTEXT);
@@ -1527,6 +3741,9 @@ QuicDataPathBindingCreate(
     Binding->Datapath = Datapath;
     Binding->ClientContext = RecvCallbackContext;
     Binding->Mtu = QUIC_MAX_MTU;
+    Binding->SocketCount = SocketCount;
+    Binding->ProcIndex =
+        RemoteAddress != NULL ? QuicProcCurrentNumber() % Datapath->ProcCount : 0;
     QuicRundownInitialize(&Binding->Rundown);
     if (LocalAddress) {
         QuicConvertToMappedV6(LocalAddress, &Binding->LocalAddress);
@@ -1536,19 +3753,28 @@ QuicDataPathBindingCreate(
     for (uint32_t i = 0; i < SocketCount; i++) {
         Binding->SocketContexts[i].Binding = Binding;
         Binding->SocketContexts[i].SocketFd = INVALID_SOCKET_FD;
-        Binding->SocketContexts[i].RecvIov.iov_len =
-            Binding->Mtu - QUIC_MIN_IPV4_HEADER_SIZE - QUIC_UDP_HEADER_SIZE;
+        for (uint32_t j = 0; j < QUIC_MAX_RECEIVE_BATCH_COUNT; ++j) {
+            Binding->SocketContexts[i].RecvIovs[j].iov_len =
+                (Datapath->Features & QUIC_DATAPATH_FEATURE_RECV_COALESCING) ?
+                    MAX_GRO_PAYLOAD_LENGTH :
+                    Binding->Mtu - QUIC_MIN_IPV4_HEADER_SIZE - QUIC_UDP_HEADER_SIZE;
+        }
         QuicListInitializeHead(&Binding->SocketContexts[i].PendingSendContextHead);
         QuicRundownAcquire(&Binding->Rundown);
     }
 
     QuicRundownAcquire(&Datapath->BindingsRundown);
 
+    Status = QuicDataPathStartProcessors(Datapath, Binding->ProcIndex, SocketCount);
+    if (QUIC_FAILED(Status)) {
+        goto Exit;
+    }
+
     for (uint32_t i = 0; i < SocketCount; i++) {
         Status =
             QuicSocketContextInitialize(
                 &Binding->SocketContexts[i],
-                &Datapath->ProcContexts[i],
+                &Datapath->ProcContexts[Binding->ProcIndex + i],
                 LocalAddress,
                 RemoteAddress);
         if (QUIC_FAILED(Status)) {
@@ -1556,6 +3782,17 @@ QuicDataPathBindingCreate(
         }
     }
 
+    if (RemoteAddress == NULL && Datapath->CidSteering.CidLength != 0) {
+        //
+        // Steering is best effort. Without it, the kernel's hash still spreads
+        // datagrams across the group, and the core moves them to the right
+        // partition itself.
+        //
+        (void)QuicSocketContextAttachCidSteering(
+            &Binding->SocketContexts[0],
+            SocketCount);
+    }
+
     QuicConvertFromMappedV6(&Binding->LocalAddress, &Binding->LocalAddress);
     Binding->LocalAddress.Ipv6.sin6_scope_id = 0;
 
@@ -1571,16 +3808,22 @@ QuicDataPathBindingCreate(
     //
     *NewBinding = Binding;
 
-    for (uint32_t i = 0; i < Binding->Datapath->ProcCount; i++) {
+    for (uint32_t i = 0; i < Binding->SocketCount; i++) {
         Status =
             QuicSocketContextStartReceive(
                 &Binding->SocketContexts[i],
-                Datapath->ProcContexts[i].EpollFd);
+                &Datapath->ProcContexts[Binding->ProcIndex + i]);
         if (QUIC_FAILED(Status)) {
             goto Exit;
         }
     }
 
+#ifdef QUIC_LINUX_XDP
+    if (RemoteAddress == NULL) {
+        QuicDataPathBindingXdpRegister(Binding);
+    }
+#endif
+
     Status = QUIC_STATUS_SUCCESS;
 
 Exit:
@@ -1620,11 +3863,17 @@ QuicDataPathBindingDelete(
     // upcalls on different threads will be completed.
     //
 
+#ifdef QUIC_LINUX_XDP
+    if (Binding->Xdp) {
+        QuicDataPathBindingXdpUnregister(Binding);
+    }
+#endif
+
     Binding->Shutdown = TRUE;
-    for (uint32_t i = 0; i < Binding->Datapath->ProcCount; ++i) {
+    for (uint32_t i = 0; i < Binding->SocketCount; ++i) {
         QuicSocketContextUninitialize(
             &Binding->SocketContexts[i],
-            &Binding->Datapath->ProcContexts[i]);
+            &Binding->Datapath->ProcContexts[Binding->ProcIndex + i]);
     }
 
     QuicRundownReleaseAndWait(&Binding->Rundown);
@@ -1719,11 +3968,10 @@ QuicDataPathRecvPacketToRecvDatagram(
 #ifdef QUIC_PLATFORM_DISPATCH_TABLE
     return PlatDispatch->DatapathRecvContextToRecvPacket(RecvContext);
 #else
-    QUIC_DATAPATH_RECV_BLOCK* RecvBlock =
-        (QUIC_DATAPATH_RECV_BLOCK*)
-            ((char *)RecvContext - sizeof(QUIC_DATAPATH_RECV_BLOCK));
-
-    return &RecvBlock->RecvPacket;
+    return (QUIC_RECV_DATAGRAM*)
+        (((uint8_t*)RecvContext) -
+            sizeof(QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT) -
+            sizeof(QUIC_RECV_DATAGRAM));
 #endif
 }
 
@@ -1735,10 +3983,10 @@ QuicDataPathRecvDatagramToRecvPacket(
 #ifdef QUIC_PLATFORM_DISPATCH_TABLE
     return PlatDispatch->DatapathRecvPacketToRecvContext(RecvPacket);
 #else
-    QUIC_DATAPATH_RECV_BLOCK* RecvBlock =
-        QUIC_CONTAINING_RECORD(RecvPacket, QUIC_DATAPATH_RECV_BLOCK, RecvPacket);
-
-    return (QUIC_RECV_PACKET*)(RecvBlock + 1);
+    return (QUIC_RECV_PACKET*)
+        (((uint8_t*)RecvPacket) +
+            sizeof(QUIC_RECV_DATAGRAM) +
+            sizeof(QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT));
 #endif
 }
 
@@ -1756,8 +4004,15 @@ QuicDataPathBindingReturnRecvDatagrams(
     while ((Datagram = DatagramChain) != NULL) {
         DatagramChain = DatagramChain->Next;
         QUIC_DATAPATH_RECV_BLOCK* RecvBlock =
-            QUIC_CONTAINING_RECORD(Datagram, QUIC_DATAPATH_RECV_BLOCK, RecvPacket);
-        QuicPoolFree(RecvBlock->OwningPool, RecvBlock);
+            QuicDataPathDatagramToInternalDatagramContext(Datagram)->RecvBlock;
+        if (InterlockedDecrement(&RecvBlock->ReferenceCount) == 0) {
+#ifdef QUIC_LINUX_XDP
+            if (RecvBlock->XdpSocket != NULL) {
+                QuicXdpSocketFreeFrame(RecvBlock->XdpSocket, RecvBlock->XdpFrame);
+            }
+#endif
+            QuicPoolFree(RecvBlock->OwningPool, RecvBlock);
+        }
     }
 #endif
 }
@@ -1765,6 +4020,7 @@ QuicDataPathBindingReturnRecvDatagrams(
 QUIC_DATAPATH_SEND_CONTEXT*
 QuicDataPathBindingAllocSendContext(
     _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ QUIC_ECN_TYPE ECN,
     _In_ uint16_t MaxPacketSize
     )
 {
@@ -1772,9 +4028,9 @@ QuicDataPathBindingAllocSendContext(
     return
         PlatDispatch->DatapathBindingAllocSendContext(
             Binding,
+            ECN,
             MaxPacketSize);
 #else
-    UNREFERENCED_PARAMETER(MaxPacketSize);
     QUIC_DBG_ASSERT(Binding != NULL);
 
     QUIC_DATAPATH_PROC_CONTEXT* ProcContext =
@@ -1792,6 +4048,20 @@ QuicDataPathBindingAllocSendContext(
 
     QuicZeroMemory(SendContext, sizeof(*SendContext));
     SendContext->Owner = ProcContext;
+    SendContext->ECN = (uint8_t)ECN;
+    SendContext->SegmentSize =
+        (Binding->Datapath->Features & QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION)
+            ? MaxPacketSize : 0;
+
+#ifdef QUIC_LINUX_XDP
+    if (Binding->Xdp && ProcContext->XdpSocket != NULL) {
+        //
+        // Each datagram gets its own UMEM frame, so there is no segmentation.
+        //
+        SendContext->XdpSocket = ProcContext->XdpSocket;
+        SendContext->SegmentSize = 0;
+    }
+#endif
 
 Exit:
 
@@ -1807,11 +4077,25 @@ QuicDataPathBindingFreeSendContext(
 #ifdef QUIC_PLATFORM_DISPATCH_TABLE
     PlatDispatch->DatapathBindingFreeSendContext(SendContext);
 #else
+    QUIC_POOL* BufferPool =
+        SendContext->SegmentSize > 0 ?
+            &SendContext->Owner->LargeSendBufferPool :
+            &SendContext->Owner->SendBufferPool;
+
     size_t i = 0;
     for (i = 0; i < SendContext->BufferCount; ++i) {
-        QuicPoolFree(
-            &SendContext->Owner->SendBufferPool,
-            SendContext->Buffers[i].Buffer);
+#ifdef QUIC_LINUX_XDP
+        if (SendContext->XdpSocket != NULL) {
+            QuicXdpSocketFreeFrame(
+                SendContext->XdpSocket,
+                QuicXdpSocketGetFrameAddress(
+                    SendContext->XdpSocket,
+                    SendContext->Buffers[i].Buffer));
+            SendContext->Buffers[i].Buffer = NULL;
+            continue;
+        }
+#endif
+        QuicPoolFree(BufferPool, SendContext->Buffers[i].Buffer);
         SendContext->Buffers[i].Buffer = NULL;
     }
 
@@ -1819,6 +4103,207 @@ QuicDataPathBindingFreeSendContext(
 #endif
 }
 
+static
+BOOLEAN
+QuicSendContextCanAllocSendSegment(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ uint16_t MaxBufferLength
+    )
+{
+    QUIC_DBG_ASSERT(SendContext->SegmentSize > 0);
+    QUIC_DBG_ASSERT(SendContext->BufferCount > 0);
+    QUIC_DBG_ASSERT(SendContext->BufferCount <= SendContext->Owner->Datapath->MaxSendBatchSize);
+
+    //
+    // A new segment can only be appended to the current backing buffer if the
+    // last segment handed out to the client was a full one, and it leaves at
+    // the same time.
+    //
+    if (SendContext->ClientBuffer.Buffer == NULL ||
+        SendContext->TxTimes[SendContext->BufferCount - 1] != SendContext->TxTime) {
+        return FALSE;
+    }
+
+    size_t BytesUsed =
+        SendContext->Buffers[SendContext->BufferCount - 1].Length +
+        SendContext->ClientBuffer.Length;
+
+    return
+        MaxBufferLength <= QUIC_LARGE_SEND_BUFFER_SIZE - BytesUsed &&
+        BytesUsed / SendContext->SegmentSize < QUIC_MAX_SEND_SEGMENT_COUNT;
+}
+
+static
+BOOLEAN
+QuicSendContextCanAllocSend(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ uint16_t MaxBufferLength
+    )
+{
+    return
+        (SendContext->BufferCount < SendContext->Owner->Datapath->MaxSendBatchSize) ||
+        ((SendContext->SegmentSize > 0) &&
+            QuicSendContextCanAllocSendSegment(SendContext, MaxBufferLength));
+}
+
+static
+void
+QuicSendContextFinalizeSendBuffer(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ BOOLEAN IsSendingImmediately
+    )
+{
+    if (SendContext->ClientBuffer.Length == 0) {
+        //
+        // There is no buffer segment outstanding at the client.
+        //
+        return;
+    }
+
+    QUIC_DBG_ASSERT(SendContext->SegmentSize > 0 && SendContext->BufferCount > 0);
+    QUIC_DBG_ASSERT(SendContext->ClientBuffer.Length > 0 && SendContext->ClientBuffer.Length <= SendContext->SegmentSize);
+
+    //
+    // Append the client's buffer segment to our internal send buffer.
+    //
+    SendContext->Buffers[SendContext->BufferCount - 1].Length +=
+        SendContext->ClientBuffer.Length;
+
+    if (SendContext->ClientBuffer.Length == SendContext->SegmentSize) {
+        SendContext->ClientBuffer.Buffer += SendContext->SegmentSize;
+        SendContext->ClientBuffer.Length = 0;
+    } else {
+        //
+        // The next segment allocation must create a new backing buffer.
+        //
+        QUIC_DBG_ASSERT(IsSendingImmediately);
+        UNREFERENCED_PARAMETER(IsSendingImmediately);
+        SendContext->ClientBuffer.Buffer = NULL;
+        SendContext->ClientBuffer.Length = 0;
+    }
+}
+
+_Success_(return != NULL)
+static
+QUIC_BUFFER*
+QuicSendContextAllocBuffer(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ QUIC_POOL* BufferPool
+    )
+{
+    QUIC_DBG_ASSERT(SendContext->BufferCount < SendContext->Owner->Datapath->MaxSendBatchSize);
+
+    QUIC_BUFFER* Buffer = &SendContext->Buffers[SendContext->BufferCount];
+    QuicZeroMemory(Buffer, sizeof(*Buffer));
+
+    Buffer->Buffer = QuicPoolAlloc(BufferPool);
+    if (Buffer->Buffer == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "Send Buffer",
+            0);
+        return NULL;
+    }
+    SendContext->TxTimes[SendContext->BufferCount] = SendContext->TxTime;
+    ++SendContext->BufferCount;
+
+    return Buffer;
+}
+
+#ifdef QUIC_LINUX_XDP
+//
+// Hands out a UMEM frame, leaving room in front of the payload for the
+// Ethernet, IPv4 and UDP headers written at send time.
+//
+_Success_(return != NULL)
+static
+QUIC_BUFFER*
+QuicSendContextAllocXdpBuffer(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
+    )
+{
+    QUIC_DBG_ASSERT(SendContext->BufferCount < SendContext->Owner->Datapath->MaxSendBatchSize);
+
+    QUIC_BUFFER* Buffer = &SendContext->Buffers[SendContext->BufferCount];
+    QuicZeroMemory(Buffer, sizeof(*Buffer));
+
+    uint64_t Frame;
+    if (!QuicXdpSocketAllocFrame(SendContext->XdpSocket, &Frame)) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "XDP Send Frame",
+            0);
+        return NULL;
+    }
+    Buffer->Buffer =
+        QuicXdpSocketGetFrame(SendContext->XdpSocket, Frame) + QUIC_XDP_HEADERS_LENGTH;
+    ++SendContext->BufferCount;
+
+    return Buffer;
+}
+#endif
+
+_Success_(return != NULL)
+static
+QUIC_BUFFER*
+QuicSendContextAllocPacketBuffer(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ uint16_t MaxBufferLength
+    )
+{
+    QUIC_BUFFER* Buffer =
+#ifdef QUIC_LINUX_XDP
+        SendContext->XdpSocket != NULL ?
+            QuicSendContextAllocXdpBuffer(SendContext) :
+#endif
+        QuicSendContextAllocBuffer(SendContext, &SendContext->Owner->SendBufferPool);
+    if (Buffer != NULL) {
+        Buffer->Length = MaxBufferLength;
+    }
+    return Buffer;
+}
+
+_Success_(return != NULL)
+static
+QUIC_BUFFER*
+QuicSendContextAllocSegmentBuffer(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ uint16_t MaxBufferLength
+    )
+{
+    QUIC_DBG_ASSERT(SendContext->SegmentSize > 0);
+    QUIC_DBG_ASSERT(MaxBufferLength <= SendContext->SegmentSize);
+
+    if (SendContext->BufferCount > 0 &&
+        QuicSendContextCanAllocSendSegment(SendContext, MaxBufferLength)) {
+
+        //
+        // All clear to return the next segment of our contiguous buffer.
+        //
+        SendContext->ClientBuffer.Length = MaxBufferLength;
+        return &SendContext->ClientBuffer;
+    }
+
+    QUIC_BUFFER* Buffer =
+        QuicSendContextAllocBuffer(SendContext, &SendContext->Owner->LargeSendBufferPool);
+    if (Buffer == NULL) {
+        return NULL;
+    }
+
+    //
+    // Provide a virtual QUIC_BUFFER to the client. Once the client has
+    // committed to a final send size, we'll append it to our internal backing
+    // buffer.
+    //
+    Buffer->Length = 0;
+    SendContext->ClientBuffer.Buffer = Buffer->Buffer;
+    SendContext->ClientBuffer.Length = MaxBufferLength;
+
+    return &SendContext->ClientBuffer;
+}
+
 QUIC_BUFFER*
 QuicDataPathBindingAllocSendDatagram(
     _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
@@ -1831,62 +4316,205 @@ QuicDataPathBindingAllocSendDatagram(
             SendContext,
             MaxBufferLength);
 #else
-    QUIC_BUFFER* Buffer = NULL;
-
     QUIC_DBG_ASSERT(SendContext != NULL);
+    QUIC_DBG_ASSERT(MaxBufferLength > 0);
     QUIC_DBG_ASSERT(MaxBufferLength <= QUIC_MAX_MTU - QUIC_MIN_IPV4_HEADER_SIZE - QUIC_UDP_HEADER_SIZE);
 
-    if (SendContext->BufferCount ==
-            SendContext->Owner->Datapath->MaxSendBatchSize) {
+    QuicSendContextFinalizeSendBuffer(SendContext, FALSE);
+
+    if (!QuicSendContextCanAllocSend(SendContext, MaxBufferLength)) {
         QuicTraceEvent(
             LibraryError,
             "[ lib] ERROR, %s.",
             "Max batch size limit hit");
-        goto Exit;
+        return NULL;
     }
 
-    Buffer = &SendContext->Buffers[SendContext->BufferCount];
-    QuicZeroMemory(Buffer, sizeof(*Buffer));
+    if (SendContext->SegmentSize == 0) {
+        return QuicSendContextAllocPacketBuffer(SendContext, MaxBufferLength);
+    } else {
+        return QuicSendContextAllocSegmentBuffer(SendContext, MaxBufferLength);
+    }
+#endif
+}
 
-    Buffer->Buffer = QuicPoolAlloc(&SendContext->Owner->SendBufferPool);
-    if (Buffer->Buffer == NULL) {
-        QuicTraceEvent(
-            AllocFailure,
-            "Allocation of '%s' failed. (%llu bytes)",
-            "Send Buffer",
-            0);
-        goto Exit;
+void
+QuicDataPathBindingFreeSendDatagram(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ QUIC_BUFFER* Datagram
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    PlatDispatch->DatapathBindingFreeSendBuffer(SendContext, Datagram);
+#else
+    //
+    // This must be the final send buffer; intermediate buffers cannot be freed.
+    //
+    QUIC_BUFFER* TailBuffer = &SendContext->Buffers[SendContext->BufferCount - 1];
+
+    if (SendContext->SegmentSize == 0) {
+        QUIC_DBG_ASSERT(Datagram == TailBuffer);
+
+#ifdef QUIC_LINUX_XDP
+        if (SendContext->XdpSocket != NULL) {
+            QuicXdpSocketFreeFrame(
+                SendContext->XdpSocket,
+                QuicXdpSocketGetFrameAddress(SendContext->XdpSocket, Datagram->Buffer));
+            Datagram->Buffer = NULL;
+            --SendContext->BufferCount;
+            return;
+        }
+#endif
+
+        QuicPoolFree(&SendContext->Owner->SendBufferPool, Datagram->Buffer);
+        Datagram->Buffer = NULL;
+        --SendContext->BufferCount;
+    } else {
+        QUIC_DBG_ASSERT(Datagram == &SendContext->ClientBuffer);
+        QUIC_DBG_ASSERT(Datagram->Buffer == TailBuffer->Buffer + TailBuffer->Length);
+
+        if (TailBuffer->Length == 0) {
+            QuicPoolFree(&SendContext->Owner->LargeSendBufferPool, TailBuffer->Buffer);
+            TailBuffer->Buffer = NULL;
+            --SendContext->BufferCount;
+        }
+
+        SendContext->ClientBuffer.Buffer = NULL;
+        SendContext->ClientBuffer.Length = 0;
     }
+#endif
+}
+
+//
+// Fills in the message header, and its control data, to send one of the send
+// context's buffers.
+//
+void
+QuicSendContextPrepareMsgHdr(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ size_t Index,
+    _In_opt_ const QUIC_ADDR* LocalAddress,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_ QUIC_ADDR* MappedRemoteAddress,
+    _Out_writes_bytes_(QUIC_SEND_CONTROL_BUFFER_SIZE) char* ControlBuffer,
+    _Out_ struct mmsghdr* MsgHdr
+    )
+{
+    struct cmsghdr *CMsg = NULL;
+    struct in_pktinfo *PktInfo = NULL;
+    struct in6_pktinfo *PktInfo6 = NULL;
+
+    SendContext->Iovs[Index].iov_base = SendContext->Buffers[Index].Buffer;
+    SendContext->Iovs[Index].iov_len = SendContext->Buffers[Index].Length;
 
-    Buffer->Length = MaxBufferLength;
+    if (LocalAddress == NULL) {
+        QuicTraceEvent(
+            DatapathSendTo,
+            "[ udp][%p] Send %u bytes in %hhu buffers (segment=%hu) Dst=%!SOCKADDR!",
+            Binding,
+            SendContext->Buffers[Index].Length,
+            1,
+            SendContext->SegmentSize > 0 ?
+                SendContext->SegmentSize : SendContext->Buffers[Index].Length,
+            LOG_ADDR_LEN(*RemoteAddress),
+            (uint8_t*)RemoteAddress);
+    } else {
+        QuicTraceEvent(
+            DatapathSendFromTo,
+            "[ udp][%p] Send %u bytes in %hhu buffers (segment=%hu) Dst=%!SOCKADDR!, Src=%!SOCKADDR!",
+            Binding,
+            SendContext->Buffers[Index].Length,
+            1,
+            SendContext->SegmentSize > 0 ?
+                SendContext->SegmentSize : SendContext->Buffers[Index].Length,
+            LOG_ADDR_LEN(*RemoteAddress),
+            LOG_ADDR_LEN(*LocalAddress),
+            (uint8_t*)RemoteAddress,
+            (uint8_t*)LocalAddress);
+    }
 
-    SendContext->Iovs[SendContext->BufferCount].iov_base = Buffer->Buffer;
-    SendContext->Iovs[SendContext->BufferCount].iov_len = Buffer->Length;
+    struct msghdr* Mhdr = &MsgHdr->msg_hdr;
+    MsgHdr->msg_len = 0;
+    Mhdr->msg_name = MappedRemoteAddress;
+    Mhdr->msg_namelen = sizeof(*MappedRemoteAddress);
+    Mhdr->msg_iov = &SendContext->Iovs[Index];
+    Mhdr->msg_iovlen = 1;
+    Mhdr->msg_control = ControlBuffer;
+    Mhdr->msg_controllen = QUIC_SEND_CONTROL_BUFFER_SIZE;
+    Mhdr->msg_flags = 0;
+
+    size_t ControlLength = 0;
+    QuicZeroMemory(ControlBuffer, QUIC_SEND_CONTROL_BUFFER_SIZE);
+    CMsg = CMSG_FIRSTHDR(Mhdr);
+
+    if (LocalAddress != NULL) {
+        if (LocalAddress->Ip.sa_family == AF_INET) {
+            CMsg->cmsg_level = IPPROTO_IP;
+            CMsg->cmsg_type = IP_PKTINFO;
+            CMsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+            ControlLength += CMSG_SPACE(sizeof(struct in_pktinfo));
 
-    ++SendContext->BufferCount;
+            PktInfo = (struct in_pktinfo*) CMSG_DATA(CMsg);
+            // TODO: Use Ipv4 instead of Ipv6.
+            PktInfo->ipi_ifindex = LocalAddress->Ipv6.sin6_scope_id;
+            PktInfo->ipi_addr = LocalAddress->Ipv4.sin_addr;
+        } else {
+            CMsg->cmsg_level = IPPROTO_IPV6;
+            CMsg->cmsg_type = IPV6_PKTINFO;
+            CMsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+            ControlLength += CMSG_SPACE(sizeof(struct in6_pktinfo));
 
-Exit:
+            PktInfo6 = (struct in6_pktinfo*) CMSG_DATA(CMsg);
+            PktInfo6->ipi6_ifindex = LocalAddress->Ipv6.sin6_scope_id;
+            PktInfo6->ipi6_addr = LocalAddress->Ipv6.sin6_addr;
+        }
+        CMsg = CMSG_NXTHDR(Mhdr, CMsg);
+    }
 
-    return Buffer;
+#ifdef UDP_SEGMENT
+    if (SendContext->SegmentSize > 0 &&
+        SendContext->Buffers[Index].Length > SendContext->SegmentSize) {
+        QUIC_DBG_ASSERT(CMsg != NULL);
+        CMsg->cmsg_level = SOL_UDP;
+        CMsg->cmsg_type = UDP_SEGMENT;
+        CMsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        ControlLength += CMSG_SPACE(sizeof(uint16_t));
+        *(uint16_t*)CMSG_DATA(CMsg) = SendContext->SegmentSize;
+        CMsg = CMSG_NXTHDR(Mhdr, CMsg);
+    }
 #endif
-}
-
-void
-QuicDataPathBindingFreeSendDatagram(
-    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
-    _In_ QUIC_BUFFER* Datagram
-    )
-{
-#ifdef QUIC_PLATFORM_DISPATCH_TABLE
-    PlatDispatch->DatapathBindingFreeSendBuffer(SendContext, Datagram);
-#else
-    QuicPoolFree(&SendContext->Owner->SendBufferPool, Datagram->Buffer);
-    Datagram->Buffer == NULL;
 
-    QUIC_DBG_ASSERT(Datagram == &SendContext->Buffers[SendContext->BufferCount - 1]);
+    if (SendContext->ECN != QUIC_ECN_NON_ECT) {
+        QUIC_DBG_ASSERT(CMsg != NULL);
+        if (RemoteAddress->Ip.sa_family == AF_INET) {
+            CMsg->cmsg_level = IPPROTO_IP;
+            CMsg->cmsg_type = IP_TOS;
+        } else {
+            CMsg->cmsg_level = IPPROTO_IPV6;
+            CMsg->cmsg_type = IPV6_TCLASS;
+        }
+        CMsg->cmsg_len = CMSG_LEN(sizeof(int));
+        ControlLength += CMSG_SPACE(sizeof(int));
+        *(int*)CMSG_DATA(CMsg) = SendContext->ECN;
+        CMsg = CMSG_NXTHDR(Mhdr, CMsg);
+    }
 
-    --SendContext->BufferCount;
+#ifdef SO_TXTIME
+    if (SendContext->TxTimes[Index] != 0) {
+        QUIC_DBG_ASSERT(CMsg != NULL);
+        CMsg->cmsg_level = SOL_SOCKET;
+        CMsg->cmsg_type = SCM_TXTIME;
+        CMsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+        ControlLength += CMSG_SPACE(sizeof(uint64_t));
+        *(uint64_t*)CMSG_DATA(CMsg) = US_TO_NS(SendContext->TxTimes[Index]);
+    }
 #endif
+
+    Mhdr->msg_controllen = ControlLength;
+    if (ControlLength == 0) {
+        Mhdr->msg_control = NULL;
+    }
 }
 
 QUIC_STATUS
@@ -1900,159 +4528,69 @@ QuicDataPathBindingSend(
     QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
     QUIC_SOCKET_CONTEXT* SocketContext = NULL;
     QUIC_DATAPATH_PROC_CONTEXT* ProcContext = NULL;
-    ssize_t SentByteCount = 0;
+    int SentMessageCount = 0;
     size_t i = 0;
-    socklen_t RemoteAddrLen = 0;
+    size_t StartIndex = 0;
     QUIC_ADDR MappedRemoteAddress = {0};
-    struct cmsghdr *CMsg = NULL;
-    struct in_pktinfo *PktInfo = NULL;
-    struct in6_pktinfo *PktInfo6 = NULL;
     BOOLEAN SendPending = FALSE;
 
     static_assert(CMSG_SPACE(sizeof(struct in6_pktinfo)) >= CMSG_SPACE(sizeof(struct in_pktinfo)), "sizeof(struct in6_pktinfo) >= sizeof(struct in_pktinfo) failed");
-    char ControlBuffer[CMSG_SPACE(sizeof(struct in6_pktinfo))] = {0};
+    char ControlBuffers[QUIC_MAX_BATCH_SEND][QUIC_SEND_CONTROL_BUFFER_SIZE];
+    struct mmsghdr MsgHdrs[QUIC_MAX_BATCH_SEND];
 
     QUIC_DBG_ASSERT(Binding != NULL && RemoteAddress != NULL && SendContext != NULL);
 
-    SocketContext = &Binding->SocketContexts[QuicProcCurrentNumber()];
-    ProcContext = &Binding->Datapath->ProcContexts[QuicProcCurrentNumber()];
+    SocketContext = QuicDataPathBindingGetSocketContext(Binding, &ProcContext);
+
+    //
+    // Commit any segment still outstanding at the client.
+    //
+    QuicSendContextFinalizeSendBuffer(SendContext, TRUE);
 
-    RemoteAddrLen =
-        (AF_INET == RemoteAddress->Ip.sa_family) ?
-            sizeof(RemoteAddress->Ipv4) : sizeof(RemoteAddress->Ipv6);
+#ifdef QUIC_LINUX_XDP
+    if (SendContext->XdpSocket != NULL &&
+        QuicDataPathBindingXdpSend(Binding, LocalAddress, RemoteAddress, SendContext)) {
+        goto Exit;
+    }
+#endif
 
     if (LocalAddress == NULL) {
         QUIC_DBG_ASSERT(Binding->RemoteAddress.Ipv4.sin_port != 0);
+    }
 
-        for (i = SendContext->CurrentIndex;
-            i < SendContext->BufferCount;
-            ++i, SendContext->CurrentIndex++) {
-
-            QuicTraceEvent(
-                DatapathSendTo,
-                "[ udp][%p] Send %u bytes in %hhu buffers (segment=%hu) Dst=%!SOCKADDR!",
-                Binding,
-                SendContext->Buffers[i].Length,
-                1,
-                SendContext->Buffers[i].Length,
-                LOG_ADDR_LEN(*RemoteAddress),
-                (uint8_t*)RemoteAddress);
-
-            SentByteCount =
-                sendto(
-                    SocketContext->SocketFd,
-                    SendContext->Buffers[i].Buffer,
-                    SendContext->Buffers[i].Length,
-                    0,
-                    (struct sockaddr *)RemoteAddress,
-                    RemoteAddrLen);
-
-            if (SentByteCount < 0) {
-                if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                    Status =
-                        QuicSocketContextPendSend(
-                            SocketContext,
-                            SendContext,
-                            ProcContext,
-                            LocalAddress,
-                            RemoteAddress);
-                    if (QUIC_FAILED(Status)) {
-                        goto Exit;
-                    }
-
-                    SendPending = TRUE;
-                    goto Exit;
-                } else {
-                    //
-                    // Completed with error.
-                    //
-
-                    Status = errno;
-                    QuicTraceEvent(
-                        DatapathErrorStatus,
-                        "[ udp][%p] ERROR, %u, %s.",
-                        SocketContext->Binding,
-                        Status,
-                        "sendto failed");
-                    goto Exit;
-                }
-            } else {
-                //
-                // Completed synchronously.
-                //
-                QuicTraceLogVerbose(
-                    DatapathSendToCompleted,
-                    "[ udp][%p] sendto succeeded, bytes transferred %d",
-                    SocketContext->Binding,
-                    SentByteCount);
-            }
-        }
-    } else {
+    //
+    // Map V4 address to dual-stack socket format.
+    //
+    QuicConvertToMappedV6(RemoteAddress, &MappedRemoteAddress);
 
-        uint32_t TotalSize = 0;
-        for (i = 0; i < SendContext->BufferCount; ++i) {
-            SendContext->Iovs[i].iov_base = SendContext->Buffers[i].Buffer;
-            SendContext->Iovs[i].iov_len = SendContext->Buffers[i].Length;
-            TotalSize += SendContext->Buffers[i].Length;
-        }
+    //
+    // Build one message per remaining buffer so the whole batch can be
+    // submitted to the kernel with a single sendmmsg call.
+    //
+    StartIndex = SendContext->CurrentIndex;
+    for (i = StartIndex; i < SendContext->BufferCount; ++i) {
 
-        QuicTraceEvent(
-            DatapathSendFromTo,
-            "[ udp][%p] Send %u bytes in %hhu buffers (segment=%hu) Dst=%!SOCKADDR!, Src=%!SOCKADDR!",
+        QuicSendContextPrepareMsgHdr(
             Binding,
-            TotalSize,
-            SendContext->BufferCount,
-            SendContext->Buffers[0].Length,
-            LOG_ADDR_LEN(*RemoteAddress),
-            LOG_ADDR_LEN(*LocalAddress),
-            (uint8_t*)RemoteAddress,
-            (uint8_t*)LocalAddress);
-
-        //
-        // Map V4 address to dual-stack socket format.
-        //
-        QuicConvertToMappedV6(RemoteAddress, &MappedRemoteAddress);
-
-        struct msghdr Mhdr = {
-            .msg_name = &MappedRemoteAddress,
-            .msg_namelen = sizeof(MappedRemoteAddress),
-            .msg_iov = SendContext->Iovs,
-            .msg_iovlen = SendContext->BufferCount,
-            .msg_flags = 0
-        };
-
-        // TODO: Avoid allocating both.
-
-        if (LocalAddress->Ip.sa_family == AF_INET) {
-            Mhdr.msg_control = ControlBuffer;
-            Mhdr.msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
-
-            CMsg = CMSG_FIRSTHDR(&Mhdr);
-            CMsg->cmsg_level = IPPROTO_IP;
-            CMsg->cmsg_type = IP_PKTINFO;
-            CMsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
-
-            PktInfo = (struct in_pktinfo*) CMSG_DATA(CMsg);
-            // TODO: Use Ipv4 instead of Ipv6.
-            PktInfo->ipi_ifindex = LocalAddress->Ipv6.sin6_scope_id;
-            PktInfo->ipi_addr = LocalAddress->Ipv4.sin_addr;
-        } else {
-            Mhdr.msg_control = ControlBuffer;
-            Mhdr.msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
-
-            CMsg = CMSG_FIRSTHDR(&Mhdr);
-            CMsg->cmsg_level = IPPROTO_IPV6;
-            CMsg->cmsg_type = IPV6_PKTINFO;
-            CMsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+            SendContext,
+            i,
+            LocalAddress,
+            RemoteAddress,
+            &MappedRemoteAddress,
+            ControlBuffers[i - StartIndex],
+            &MsgHdrs[i - StartIndex]);
+    }
 
-            PktInfo6 = (struct in6_pktinfo*) CMSG_DATA(CMsg);
-            PktInfo6->ipi6_ifindex = LocalAddress->Ipv6.sin6_scope_id;
-            PktInfo6->ipi6_addr = LocalAddress->Ipv6.sin6_addr;
-        }
+    while (SendContext->CurrentIndex < SendContext->BufferCount) {
 
-        SentByteCount = sendmsg(SocketContext->SocketFd, &Mhdr, 0);
+        SentMessageCount =
+            sendmmsg(
+                SocketContext->SocketFd,
+                &MsgHdrs[SendContext->CurrentIndex - StartIndex],
+                (unsigned int)(SendContext->BufferCount - SendContext->CurrentIndex),
+                0);
 
-        if (SentByteCount < 0) {
+        if (SentMessageCount < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 Status =
                     QuicSocketContextPendSend(
@@ -2068,24 +4606,29 @@ QuicDataPathBindingSend(
                 SendPending = TRUE;
                 goto Exit;
             } else {
+                //
+                // Completed with error.
+                //
                 Status = errno;
                 QuicTraceEvent(
                     DatapathErrorStatus,
                     "[ udp][%p] ERROR, %u, %s.",
                     SocketContext->Binding,
                     Status,
-                    "sendmsg failed");
+                    "sendmmsg failed");
                 goto Exit;
             }
         } else {
             //
-            // Completed synchronously.
+            // Completed synchronously. The kernel may have accepted only part
+            // of the batch, in which case the remainder is resubmitted.
             //
             QuicTraceLogVerbose(
-                DatapathSendMsgCompleted,
-                "[ udp][%p] sendmsg succeeded, bytes transferred %d",
+                DatapathSendMmsgCompleted,
+                "[ udp][%p] sendmmsg succeeded, messages sent %d",
                 SocketContext->Binding,
-                SentByteCount);
+                SentMessageCount);
+            SendContext->CurrentIndex += (size_t)SentMessageCount;
         }
     }
 
@@ -2161,6 +4704,205 @@ QuicDataPathBindingSendFromTo(
 #endif
 }
 
+QUIC_STATUS
+QuicDataPathBindingSendBatch(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ uint32_t EntryCount,
+    _In_reads_(EntryCount) const QUIC_DATAPATH_SEND_ENTRY* Entries
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    for (uint32_t i = 0; i < EntryCount; ++i) {
+        QUIC_STATUS EntryStatus =
+            Entries[i].LocalAddress == NULL ?
+                QuicDataPathBindingSendTo(
+                    Binding,
+                    Entries[i].RemoteAddress,
+                    Entries[i].SendContext) :
+                QuicDataPathBindingSendFromTo(
+                    Binding,
+                    Entries[i].LocalAddress,
+                    Entries[i].RemoteAddress,
+                    Entries[i].SendContext);
+        if (QUIC_FAILED(EntryStatus)) {
+            Status = EntryStatus;
+        }
+    }
+    return Status;
+#else
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    QUIC_DATAPATH_PROC_CONTEXT* ProcContext;
+    QUIC_SOCKET_CONTEXT* SocketContext =
+        QuicDataPathBindingGetSocketContext(Binding, &ProcContext);
+
+    QUIC_ADDR MappedRemoteAddresses[QUIC_MAX_MULTI_SEND];
+    char ControlBuffers[QUIC_MAX_MULTI_SEND][QUIC_SEND_CONTROL_BUFFER_SIZE];
+    struct mmsghdr MsgHdrs[QUIC_MAX_MULTI_SEND];
+
+    QUIC_STATIC_ASSERT(
+        QUIC_MAX_BATCH_SEND <= QUIC_MAX_MULTI_SEND,
+        "A whole send context must fit in one multi send");
+    QUIC_DBG_ASSERT(Binding != NULL && (EntryCount == 0 || Entries != NULL));
+
+    //
+    // Set once the socket runs out of buffer space. Everything after that is
+    // queued behind the sends already pended, so nothing goes out of order
+    // if the socket becomes writable again before the batch is done.
+    //
+    BOOLEAN SendBlocked = FALSE;
+
+    uint32_t NextEntry = 0;
+    while (NextEntry < EntryCount) {
+
+#ifdef QUIC_LINUX_XDP
+        if (Entries[NextEntry].SendContext->XdpSocket != NULL) {
+            //
+            // AF_XDP sends are already batched on the socket's TX ring.
+            //
+            QUIC_STATUS EntryStatus =
+                QuicDataPathBindingSend(
+                    Binding,
+                    Entries[NextEntry].LocalAddress,
+                    Entries[NextEntry].RemoteAddress,
+                    Entries[NextEntry].SendContext);
+            if (QUIC_FAILED(EntryStatus)) {
+                Status = EntryStatus;
+            }
+            ++NextEntry;
+            continue;
+        }
+#endif
+
+        if (SendBlocked) {
+            QUIC_STATUS PendStatus =
+                QuicSocketContextPendSend(
+                    SocketContext,
+                    Entries[NextEntry].SendContext,
+                    ProcContext,
+                    Entries[NextEntry].LocalAddress,
+                    Entries[NextEntry].RemoteAddress);
+            if (QUIC_FAILED(PendStatus)) {
+                Status = PendStatus;
+                QuicDataPathBindingFreeSendContext(Entries[NextEntry].SendContext);
+            }
+            ++NextEntry;
+            continue;
+        }
+
+        //
+        // Build one message per remaining buffer for as many (whole) send
+        // contexts as fit, each with its own remote address, so they can all
+        // be submitted to the kernel with a single sendmmsg call.
+        //
+        const uint32_t FirstEntry = NextEntry;
+        uint32_t MessageCount = 0;
+        while (NextEntry < EntryCount &&
+               NextEntry - FirstEntry < QUIC_MAX_MULTI_SEND) {
+
+            const QUIC_DATAPATH_SEND_ENTRY* Entry = &Entries[NextEntry];
+            QUIC_DATAPATH_SEND_CONTEXT* SendContext = Entry->SendContext;
+            QUIC_DBG_ASSERT(Entry->RemoteAddress != NULL && SendContext != NULL);
+#ifdef QUIC_LINUX_XDP
+            if (SendContext->XdpSocket != NULL) {
+                break;
+            }
+#endif
+
+            QuicSendContextFinalizeSendBuffer(SendContext, TRUE);
+            if (MessageCount +
+                    (SendContext->BufferCount - SendContext->CurrentIndex) >
+                QUIC_MAX_MULTI_SEND) {
+                break;
+            }
+
+            QUIC_ADDR* MappedRemoteAddress =
+                &MappedRemoteAddresses[NextEntry - FirstEntry];
+            QuicConvertToMappedV6(Entry->RemoteAddress, MappedRemoteAddress);
+
+            for (size_t i = SendContext->CurrentIndex; i < SendContext->BufferCount; ++i) {
+                QuicSendContextPrepareMsgHdr(
+                    Binding,
+                    SendContext,
+                    i,
+                    Entry->LocalAddress,
+                    Entry->RemoteAddress,
+                    MappedRemoteAddress,
+                    ControlBuffers[MessageCount],
+                    &MsgHdrs[MessageCount]);
+                ++MessageCount;
+            }
+            ++NextEntry;
+        }
+
+        uint32_t SentMessageCount = 0;
+        int SendError = 0;
+        while (SentMessageCount < MessageCount) {
+            int Result =
+                sendmmsg(
+                    SocketContext->SocketFd,
+                    &MsgHdrs[SentMessageCount],
+                    MessageCount - SentMessageCount,
+                    0);
+            if (Result < 0) {
+                SendError = errno;
+                break;
+            }
+            QuicTraceLogVerbose(
+                DatapathSendMmsgCompleted,
+                "[ udp][%p] sendmmsg succeeded, messages sent %d",
+                SocketContext->Binding,
+                Result);
+            SentMessageCount += (uint32_t)Result;
+        }
+
+        if (SendError == EAGAIN || SendError == EWOULDBLOCK) {
+            SendBlocked = TRUE;
+        } else if (SendError != 0) {
+            Status = SendError;
+            QuicTraceEvent(
+                DatapathErrorStatus,
+                "[ udp][%p] ERROR, %u, %s.",
+                SocketContext->Binding,
+                Status,
+                "sendmmsg failed");
+        }
+
+        //
+        // Complete the send contexts the kernel took all of. If the socket
+        // ran out of buffer space, the rest are queued, in order, until it's
+        // writable again. Otherwise, they failed and are dropped.
+        //
+        for (uint32_t i = FirstEntry; i < NextEntry; ++i) {
+            QUIC_DATAPATH_SEND_CONTEXT* SendContext = Entries[i].SendContext;
+            uint32_t Remaining =
+                (uint32_t)(SendContext->BufferCount - SendContext->CurrentIndex);
+            uint32_t Sent =
+                Remaining < SentMessageCount ? Remaining : SentMessageCount;
+            SendContext->CurrentIndex += Sent;
+            SentMessageCount -= Sent;
+
+            if (Sent < Remaining && SendBlocked) {
+                QUIC_STATUS PendStatus =
+                    QuicSocketContextPendSend(
+                        SocketContext,
+                        SendContext,
+                        ProcContext,
+                        Entries[i].LocalAddress,
+                        Entries[i].RemoteAddress);
+                if (QUIC_SUCCEEDED(PendStatus)) {
+                    continue;
+                }
+                Status = PendStatus;
+            }
+            QuicDataPathBindingFreeSendContext(SendContext);
+        }
+    }
+
+    return Status;
+#endif
+}
+
 uint16_t
 QuicDataPathBindingGetLocalMtu(
     _In_ QUIC_DATAPATH_BINDING* Binding
@@ -2185,48 +4927,152 @@ QuicDataPathBindingGetLocalMtu(
     })
 #endif
 
-void*
-QuicDataPathWorkerThread(
-    _In_ void* Context
+//
+// Runs the poll callback, if any, and returns the timeout (in ms) for the next
+// epoll wait.
+//
+static
+int
+QuicProcContextRunPollCallback(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
     )
 {
-    QUIC_DATAPATH_PROC_CONTEXT* ProcContext = (QUIC_DATAPATH_PROC_CONTEXT*)Context;
-    QUIC_DBG_ASSERT(ProcContext != NULL && ProcContext->Datapath != NULL);
+    uint64_t DelayUs = UINT64_MAX;
 
-    QuicTraceLogInfo(
-        DatapathWorkerThreadStart,
-        "[ udp][%p] Worker start",
-        ProcContext);
+    QuicLockAcquire(&ProcContext->PollLock);
+    if (ProcContext->PollCallback != NULL) {
+        if (!ProcContext->PollAffinitized) {
+            //
+            // Keep the thread, and so all the work run to completion on it,
+            // on the processor its sockets' receives are partitioned to.
+            //
+            cpu_set_t CpuSet;
+            CPU_ZERO(&CpuSet);
+            CPU_SET(ProcContext->Index, &CpuSet);
+            (void)pthread_setaffinity_np(pthread_self(), sizeof(CpuSet), &CpuSet);
+            ProcContext->PollAffinitized = TRUE;
+        }
+        DelayUs = ProcContext->PollCallback(ProcContext->PollContext);
+    }
+    QuicLockRelease(&ProcContext->PollLock);
+
+    if (DelayUs == UINT64_MAX) {
+        return -1;
+    }
+    if (DelayUs >= (uint64_t)INT32_MAX * 1000) {
+        return INT32_MAX;
+    }
+    return (int)((DelayUs + 999) / 1000); // Round up to not wake early.
+}
 
+static
+void
+QuicProcContextEpollEventLoop(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
     const size_t EpollEventCtMax = 16; // TODO: Experiment.
     struct epoll_event EpollEvents[EpollEventCtMax];
 
     while (!ProcContext->Datapath->Shutdown) {
-        int ReadyEventCount =
-            TEMP_FAILURE_RETRY(
-                epoll_wait(
-                    ProcContext->EpollFd,
-                    EpollEvents,
-                    EpollEventCtMax,
-                    -1));
+        int Timeout = QuicProcContextRunPollCallback(ProcContext);
+        int ReadyEventCount = 0;
+#ifdef QUIC_LINUX_XDP
+        if (ProcContext->XdpSocket != NULL &&
+            QuicXdpSocketRefill(ProcContext->XdpSocket) < QUIC_XDP_RING_SIZE / 2 &&
+            (Timeout < 0 || Timeout > 1)) {
+            //
+            // Frames returned by the upper layer don't wake this thread, so
+            // keep topping up the fill ring while it is running low.
+            //
+            Timeout = 1;
+        }
+#endif
+        const uint32_t BusyPollUs = ProcContext->Datapath->BusyPollUs;
+        if (BusyPollUs != 0 && Timeout != 0) {
+            //
+            // Poll without blocking for up to the busy poll budget, to avoid
+            // the latency of the thread going to sleep and waking back up.
+            //
+            const uint64_t StartTime = QuicTimeUs64();
+            do {
+                ReadyEventCount =
+                    TEMP_FAILURE_RETRY(
+                        epoll_wait(
+                            ProcContext->EpollFd,
+                            EpollEvents,
+                            EpollEventCtMax,
+                            0));
+            } while (ReadyEventCount == 0 &&
+                     !ProcContext->Datapath->Shutdown &&
+                     QuicTimeDiff64(StartTime, QuicTimeUs64()) < BusyPollUs);
+        }
+
+        if (ReadyEventCount == 0) {
+            ReadyEventCount =
+                TEMP_FAILURE_RETRY(
+                    epoll_wait(
+                        ProcContext->EpollFd,
+                        EpollEvents,
+                        EpollEventCtMax,
+                        Timeout));
+        }
 
         QUIC_FRE_ASSERT(ReadyEventCount >= 0);
         for (int i = 0; i < ReadyEventCount; i++) {
             if (EpollEvents[i].data.ptr == NULL) {
+                if (!ProcContext->Datapath->Shutdown) {
+                    //
+                    // Just a wake for the poll callback.
+                    //
+                    eventfd_t Value;
+                    (void)eventfd_read(ProcContext->EventFd, &Value);
+                    continue;
+                }
                 //
                 // The processor context is shutting down and the worker thread
                 // needs to clean up.
                 //
-                QUIC_DBG_ASSERT(ProcContext->Datapath->Shutdown);
                 break;
             }
 
+#ifdef QUIC_LINUX_XDP
+            if (EpollEvents[i].data.ptr == ProcContext->XdpSocket) {
+                QuicProcContextXdpReceive(ProcContext);
+                continue;
+            }
+#endif
+
             QuicSocketContextProcessEvents(
                 EpollEvents[i].data.ptr,
                 ProcContext,
                 EpollEvents[i].events);
         }
     }
+}
+
+void*
+QuicDataPathWorkerThread(
+    _In_ void* Context
+    )
+{
+    QUIC_DATAPATH_PROC_CONTEXT* ProcContext = (QUIC_DATAPATH_PROC_CONTEXT*)Context;
+    QUIC_DBG_ASSERT(ProcContext != NULL && ProcContext->Datapath != NULL);
+
+    QuicTraceLogInfo(
+        DatapathWorkerThreadStart,
+        "[ udp][%p] Worker start",
+        ProcContext);
+
+#ifdef QUIC_LINUX_IO_URING
+    if (ProcContext->Datapath->UseUring) {
+        QuicProcContextUringEventLoop(ProcContext);
+    } else {
+        QuicProcContextEpollEventLoop(ProcContext);
+    }
+#else
+    QuicProcContextEpollEventLoop(ProcContext);
+#endif
 
     QuicTraceLogInfo(
         DatapathWorkerThreadStop,
@@ -2247,3 +5093,46 @@ QuicDataPathBindingIsSendContextFull(
     return SendContext->BufferCount == SendContext->Owner->Datapath->MaxSendBatchSize;
 #endif
 }
+
+void
+QuicDataPathBindingSetSendTxTime(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ uint64_t TxTime
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    //
+    // The dispatch table has no departure times; the datagrams leave
+    // immediately.
+    //
+    UNREFERENCED_PARAMETER(SendContext);
+    UNREFERENCED_PARAMETER(TxTime);
+#else
+    QUIC_DBG_ASSERT(
+        TxTime == 0 ||
+        (SendContext->Owner->Datapath->Features & QUIC_DATAPATH_FEATURE_SEND_TXTIME));
+    SendContext->TxTime = TxTime;
+#endif
+}
+
+void
+QuicDataPathBindingSetCryptoOffloadPacket(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ QUIC_BUFFER* Datagram,
+    _In_ uint16_t PacketOffset,
+    _In_ uint16_t PacketLength,
+    _In_ uint16_t HeaderLength,
+    _In_ uint64_t PacketNumber
+    )
+{
+    //
+    // Never called, as QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD isn't supported.
+    //
+    QUIC_DBG_ASSERT(FALSE);
+    UNREFERENCED_PARAMETER(SendContext);
+    UNREFERENCED_PARAMETER(Datagram);
+    UNREFERENCED_PARAMETER(PacketOffset);
+    UNREFERENCED_PARAMETER(PacketLength);
+    UNREFERENCED_PARAMETER(HeaderLength);
+    UNREFERENCED_PARAMETER(PacketNumber);
+}
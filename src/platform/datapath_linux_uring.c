@@ -0,0 +1,268 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Minimal io_uring wrapper used by the Linux datapath as an alternative to
+    the epoll based completion loop. This talks to the kernel directly so that
+    no additional library dependency is required.
+
+Environment:
+
+    Linux
+
+--*/
+
+#define _GNU_SOURCE
+#include "platform_internal.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#ifdef QUIC_CLOG
+#include "datapath_linux_uring.c.clog.h"
+#endif
+
+static
+int
+QuicUringSetup(
+    _In_ uint32_t EntryCount,
+    _Inout_ struct io_uring_params* Params
+    )
+{
+    return (int)syscall(__NR_io_uring_setup, EntryCount, Params);
+}
+
+static
+int
+QuicUringEnter(
+    _In_ int Fd,
+    _In_ uint32_t SubmitCount,
+    _In_ uint32_t WaitCount,
+    _In_ uint32_t Flags
+    )
+{
+    return (int)syscall(__NR_io_uring_enter, Fd, SubmitCount, WaitCount, Flags, NULL, 0);
+}
+
+QUIC_STATUS
+QuicUringInitialize(
+    _In_ uint32_t EntryCount,
+    _Out_ QUIC_URING* Ring
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    struct io_uring_params Params;
+
+    QuicZeroMemory(Ring, sizeof(*Ring));
+    QuicZeroMemory(&Params, sizeof(Params));
+    Ring->Fd = INVALID_SOCKET_FD;
+    Ring->SqRing = MAP_FAILED;
+    Ring->CqRing = MAP_FAILED;
+    Ring->Sqes = MAP_FAILED;
+
+    Ring->Fd = QuicUringSetup(EntryCount, &Params);
+    if (Ring->Fd < 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "io_uring_setup failed");
+        Ring->Fd = INVALID_SOCKET_FD;
+        goto Exit;
+    }
+
+    Ring->Features = Params.features;
+    Ring->SqRingSize = Params.sq_off.array + Params.sq_entries * sizeof(uint32_t);
+    Ring->CqRingSize = Params.cq_off.cqes + Params.cq_entries * sizeof(struct io_uring_cqe);
+    Ring->SqesSize = Params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (Params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (Ring->CqRingSize > Ring->SqRingSize) {
+            Ring->SqRingSize = Ring->CqRingSize;
+        }
+        Ring->CqRingSize = Ring->SqRingSize;
+    }
+
+    Ring->SqRing =
+        mmap(
+            NULL,
+            Ring->SqRingSize,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            Ring->Fd,
+            IORING_OFF_SQ_RING);
+    if (Ring->SqRing == MAP_FAILED) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "mmap(IORING_OFF_SQ_RING) failed");
+        goto Exit;
+    }
+
+    if (Params.features & IORING_FEAT_SINGLE_MMAP) {
+        Ring->CqRing = Ring->SqRing;
+    } else {
+        Ring->CqRing =
+            mmap(
+                NULL,
+                Ring->CqRingSize,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE,
+                Ring->Fd,
+                IORING_OFF_CQ_RING);
+        if (Ring->CqRing == MAP_FAILED) {
+            Status = errno;
+            QuicTraceEvent(
+                LibraryErrorStatus,
+                "[ lib] ERROR, %u, %s.",
+                Status,
+                "mmap(IORING_OFF_CQ_RING) failed");
+            goto Exit;
+        }
+    }
+
+    Ring->Sqes =
+        mmap(
+            NULL,
+            Ring->SqesSize,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            Ring->Fd,
+            IORING_OFF_SQES);
+    if (Ring->Sqes == MAP_FAILED) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "mmap(IORING_OFF_SQES) failed");
+        goto Exit;
+    }
+
+    Ring->SqHead = (uint32_t*)((uint8_t*)Ring->SqRing + Params.sq_off.head);
+    Ring->SqTail = (uint32_t*)((uint8_t*)Ring->SqRing + Params.sq_off.tail);
+    Ring->SqRingMask = (uint32_t*)((uint8_t*)Ring->SqRing + Params.sq_off.ring_mask);
+    Ring->SqArray = (uint32_t*)((uint8_t*)Ring->SqRing + Params.sq_off.array);
+
+    Ring->CqHead = (uint32_t*)((uint8_t*)Ring->CqRing + Params.cq_off.head);
+    Ring->CqTail = (uint32_t*)((uint8_t*)Ring->CqRing + Params.cq_off.tail);
+    Ring->CqRingMask = (uint32_t*)((uint8_t*)Ring->CqRing + Params.cq_off.ring_mask);
+    Ring->Cqes = (struct io_uring_cqe*)((uint8_t*)Ring->CqRing + Params.cq_off.cqes);
+    Ring->SqeTail = *Ring->SqTail;
+
+    //
+    // Use an identity mapping between the SQ array and the SQEs so that the
+    // array never has to be touched again.
+    //
+    for (uint32_t i = 0; i < Params.sq_entries; ++i) {
+        Ring->SqArray[i] = i;
+    }
+
+Exit:
+
+    if (QUIC_FAILED(Status)) {
+        QuicUringUninitialize(Ring);
+    }
+
+    return Status;
+}
+
+void
+QuicUringUninitialize(
+    _In_ QUIC_URING* Ring
+    )
+{
+    if (Ring->Sqes != MAP_FAILED) {
+        munmap(Ring->Sqes, Ring->SqesSize);
+        Ring->Sqes = MAP_FAILED;
+    }
+    if (Ring->CqRing != MAP_FAILED && Ring->CqRing != Ring->SqRing) {
+        munmap(Ring->CqRing, Ring->CqRingSize);
+    }
+    Ring->CqRing = MAP_FAILED;
+    if (Ring->SqRing != MAP_FAILED) {
+        munmap(Ring->SqRing, Ring->SqRingSize);
+        Ring->SqRing = MAP_FAILED;
+    }
+    if (Ring->Fd != INVALID_SOCKET_FD) {
+        close(Ring->Fd);
+        Ring->Fd = INVALID_SOCKET_FD;
+    }
+}
+
+struct io_uring_sqe*
+QuicUringGetSqe(
+    _In_ QUIC_URING* Ring
+    )
+{
+    const uint32_t Head = __atomic_load_n(Ring->SqHead, __ATOMIC_ACQUIRE);
+
+    if (Ring->SqeTail - Head > *Ring->SqRingMask) {
+        return NULL;
+    }
+
+    struct io_uring_sqe* Sqe = &Ring->Sqes[Ring->SqeTail & *Ring->SqRingMask];
+    QuicZeroMemory(Sqe, sizeof(*Sqe));
+    Ring->SqeTail++;
+
+    return Sqe;
+}
+
+void
+QuicUringFlush(
+    _In_ QUIC_URING* Ring
+    )
+{
+    __atomic_store_n(Ring->SqTail, Ring->SqeTail, __ATOMIC_RELEASE);
+}
+
+QUIC_STATUS
+QuicUringSubmitAndWait(
+    _In_ QUIC_URING* Ring,
+    _In_ uint32_t WaitCount
+    )
+{
+    //
+    // Pass the full ring size as submit count; the kernel only consumes the
+    // entries that have been flushed, including any flushed by other threads
+    // since our last call. EBUSY means the completion queue overflowed and
+    // must be reaped before more can be submitted; the caller does that next.
+    //
+    int Result =
+        QuicUringEnter(
+            Ring->Fd,
+            *Ring->SqRingMask + 1,
+            WaitCount,
+            WaitCount != 0 ? IORING_ENTER_GETEVENTS : 0);
+    if (Result < 0 && errno != EINTR && errno != EBUSY) {
+        return errno;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+struct io_uring_cqe*
+QuicUringPeekCqe(
+    _In_ QUIC_URING* Ring
+    )
+{
+    const uint32_t Head = *Ring->CqHead;
+    const uint32_t Tail = __atomic_load_n(Ring->CqTail, __ATOMIC_ACQUIRE);
+
+    if (Head == Tail) {
+        return NULL;
+    }
+
+    return &Ring->Cqes[Head & *Ring->CqRingMask];
+}
+
+void
+QuicUringCqeSeen(
+    _In_ QUIC_URING* Ring
+    )
+{
+    __atomic_store_n(Ring->CqHead, *Ring->CqHead + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,911 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Minimal AF_XDP wrapper used by the Linux datapath to receive and send UDP
+    datagrams without going through the kernel's UDP stack. This talks to the
+    kernel directly (including loading the XDP program) so that no additional
+    library dependency is required.
+
+Environment:
+
+    Linux (5.9 or newer)
+
+--*/
+
+#define _GNU_SOURCE
+#include "platform_internal.h"
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <ifaddrs.h>
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+#include <linux/ethtool.h>
+#include <linux/if_ether.h>
+#include <linux/sockios.h>
+#ifdef QUIC_CLOG
+#include "datapath_linux_xdp.c.clog.h"
+#endif
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+//
+// The maximum number of local addresses the XDP program can redirect.
+//
+#define QUIC_XDP_MAX_ADDRESSES 64
+
+//
+// The key of the XDP program's address map. All fields are in network order.
+//
+typedef struct QUIC_XDP_ADDRESS_KEY {
+    uint32_t Address;
+    uint16_t Port;
+    uint16_t Reserved;
+} QUIC_XDP_ADDRESS_KEY;
+
+//
+// Helpers to build the XDP program's eBPF instructions.
+//
+#define QUIC_BPF_INSN(Code, Dst, Src, Off, Imm) \
+    { .code = (Code), .dst_reg = (Dst), .src_reg = (Src), .off = (Off), .imm = (Imm) }
+#define QUIC_BPF_MOV64_REG(Dst, Src) \
+    QUIC_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, Dst, Src, 0, 0)
+#define QUIC_BPF_MOV64_IMM(Dst, Imm) \
+    QUIC_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, Dst, 0, 0, Imm)
+#define QUIC_BPF_ALU64_IMM(Op, Dst, Imm) \
+    QUIC_BPF_INSN(BPF_ALU64 | (Op) | BPF_K, Dst, 0, 0, Imm)
+#define QUIC_BPF_LDX_MEM(Size, Dst, Src, Off) \
+    QUIC_BPF_INSN(BPF_LDX | (Size) | BPF_MEM, Dst, Src, Off, 0)
+#define QUIC_BPF_STX_MEM(Size, Dst, Src, Off) \
+    QUIC_BPF_INSN(BPF_STX | (Size) | BPF_MEM, Dst, Src, Off, 0)
+#define QUIC_BPF_ST_MEM(Size, Dst, Off, Imm) \
+    QUIC_BPF_INSN(BPF_ST | (Size) | BPF_MEM, Dst, 0, Off, Imm)
+#define QUIC_BPF_JMP_REG(Op, Dst, Src, Off) \
+    QUIC_BPF_INSN(BPF_JMP | (Op) | BPF_X, Dst, Src, Off, 0)
+#define QUIC_BPF_JMP_IMM(Op, Dst, Imm, Off) \
+    QUIC_BPF_INSN(BPF_JMP | (Op) | BPF_K, Dst, 0, Off, Imm)
+#define QUIC_BPF_LD_MAP_FD(Dst, Fd) \
+    QUIC_BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, Dst, BPF_PSEUDO_MAP_FD, 0, Fd), \
+    QUIC_BPF_INSN(0, 0, 0, 0, 0)
+#define QUIC_BPF_CALL(Func) \
+    QUIC_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, Func)
+#define QUIC_BPF_EXIT() \
+    QUIC_BPF_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+static
+int
+QuicBpf(
+    _In_ int Command,
+    _Inout_ union bpf_attr* Attr
+    )
+{
+    return (int)syscall(__NR_bpf, Command, Attr, sizeof(*Attr));
+}
+
+static
+int
+QuicBpfCreateMap(
+    _In_ uint32_t Type,
+    _In_ uint32_t KeySize,
+    _In_ uint32_t ValueSize,
+    _In_ uint32_t MaxEntries
+    )
+{
+    union bpf_attr Attr;
+    QuicZeroMemory(&Attr, sizeof(Attr));
+    Attr.map_type = Type;
+    Attr.key_size = KeySize;
+    Attr.value_size = ValueSize;
+    Attr.max_entries = MaxEntries;
+    return QuicBpf(BPF_MAP_CREATE, &Attr);
+}
+
+static
+int
+QuicBpfUpdateMap(
+    _In_ int MapFd,
+    _In_ const void* Key,
+    _In_ const void* Value
+    )
+{
+    union bpf_attr Attr;
+    QuicZeroMemory(&Attr, sizeof(Attr));
+    Attr.map_fd = (uint32_t)MapFd;
+    Attr.key = (uint64_t)(uintptr_t)Key;
+    Attr.value = (uint64_t)(uintptr_t)Value;
+    Attr.flags = BPF_ANY;
+    return QuicBpf(BPF_MAP_UPDATE_ELEM, &Attr);
+}
+
+static
+int
+QuicBpfDeleteMapEntry(
+    _In_ int MapFd,
+    _In_ const void* Key
+    )
+{
+    union bpf_attr Attr;
+    QuicZeroMemory(&Attr, sizeof(Attr));
+    Attr.map_fd = (uint32_t)MapFd;
+    Attr.key = (uint64_t)(uintptr_t)Key;
+    return QuicBpf(BPF_MAP_DELETE_ELEM, &Attr);
+}
+
+static
+int
+QuicXdpLoadProgram(
+    _In_ int AddressMapFd,
+    _In_ int XskMapFd
+    )
+{
+    //
+    // Equivalent to:
+    //
+    //  if (frame is option-less, unfragmented UDP/IPv4 &&
+    //      AddressMap[{ip.daddr, udp.dest}] != NULL) {
+    //      return bpf_redirect_map(XskMap, ctx->rx_queue_index, XDP_PASS);
+    //  }
+    //  return XDP_PASS;
+    //
+    // The jump offsets below are relative to the next instruction, and all
+    // land on the final XDP_PASS (instruction 32).
+    //
+    struct bpf_insn Insns[] = {
+        /*  0 */ QUIC_BPF_MOV64_REG(BPF_REG_6, BPF_REG_1),
+        /*  1 */ QUIC_BPF_LDX_MEM(BPF_W, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, data)),
+        /*  2 */ QUIC_BPF_LDX_MEM(BPF_W, BPF_REG_3, BPF_REG_6, offsetof(struct xdp_md, data_end)),
+        /*  3 */ QUIC_BPF_MOV64_REG(BPF_REG_4, BPF_REG_2),
+        /*  4 */ QUIC_BPF_ALU64_IMM(BPF_ADD, BPF_REG_4, QUIC_XDP_HEADERS_LENGTH),
+        /*  5 */ QUIC_BPF_JMP_REG(BPF_JGT, BPF_REG_4, BPF_REG_3, 26),
+        /*  6 */ QUIC_BPF_LDX_MEM(BPF_H, BPF_REG_4, BPF_REG_2, 12),
+        /*  7 */ QUIC_BPF_JMP_IMM(BPF_JNE, BPF_REG_4, htons(ETH_P_IP), 24),
+        /*  8 */ QUIC_BPF_LDX_MEM(BPF_B, BPF_REG_4, BPF_REG_2, 14),
+        /*  9 */ QUIC_BPF_JMP_IMM(BPF_JNE, BPF_REG_4, 0x45, 22),
+        /* 10 */ QUIC_BPF_LDX_MEM(BPF_B, BPF_REG_4, BPF_REG_2, 23),
+        /* 11 */ QUIC_BPF_JMP_IMM(BPF_JNE, BPF_REG_4, IPPROTO_UDP, 20),
+        /* 12 */ QUIC_BPF_LDX_MEM(BPF_H, BPF_REG_4, BPF_REG_2, 20),
+        /* 13 */ QUIC_BPF_ALU64_IMM(BPF_AND, BPF_REG_4, htons(0x3FFF)),
+        /* 14 */ QUIC_BPF_JMP_IMM(BPF_JNE, BPF_REG_4, 0, 17),
+        /* 15 */ QUIC_BPF_LDX_MEM(BPF_W, BPF_REG_4, BPF_REG_2, 30),
+        /* 16 */ QUIC_BPF_STX_MEM(BPF_W, BPF_REG_10, BPF_REG_4, -8),
+        /* 17 */ QUIC_BPF_LDX_MEM(BPF_H, BPF_REG_4, BPF_REG_2, 36),
+        /* 18 */ QUIC_BPF_STX_MEM(BPF_H, BPF_REG_10, BPF_REG_4, -4),
+        /* 19 */ QUIC_BPF_ST_MEM(BPF_H, BPF_REG_10, -2, 0),
+        /* 20 */ QUIC_BPF_LD_MAP_FD(BPF_REG_1, AddressMapFd),
+        /* 22 */ QUIC_BPF_MOV64_REG(BPF_REG_2, BPF_REG_10),
+        /* 23 */ QUIC_BPF_ALU64_IMM(BPF_ADD, BPF_REG_2, -8),
+        /* 24 */ QUIC_BPF_CALL(BPF_FUNC_map_lookup_elem),
+        /* 25 */ QUIC_BPF_JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 6),
+        /* 26 */ QUIC_BPF_LDX_MEM(BPF_W, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, rx_queue_index)),
+        /* 27 */ QUIC_BPF_LD_MAP_FD(BPF_REG_1, XskMapFd),
+        /* 29 */ QUIC_BPF_MOV64_IMM(BPF_REG_3, XDP_PASS),
+        /* 30 */ QUIC_BPF_CALL(BPF_FUNC_redirect_map),
+        /* 31 */ QUIC_BPF_EXIT(),
+        /* 32 */ QUIC_BPF_MOV64_IMM(BPF_REG_0, XDP_PASS),
+        /* 33 */ QUIC_BPF_EXIT(),
+    };
+
+    union bpf_attr Attr;
+    QuicZeroMemory(&Attr, sizeof(Attr));
+    Attr.prog_type = BPF_PROG_TYPE_XDP;
+    Attr.insns = (uint64_t)(uintptr_t)Insns;
+    Attr.insn_cnt = ARRAYSIZE(Insns);
+    Attr.license = (uint64_t)(uintptr_t)"Dual MIT/GPL";
+    return QuicBpf(BPF_PROG_LOAD, &Attr);
+}
+
+uint32_t
+QuicXdpGetInterfaceIndex(
+    _In_ const QUIC_ADDR* Address
+    )
+{
+    uint32_t IfIndex = 0;
+    struct ifaddrs* IfAddrs = NULL;
+
+    if (Address->Ip.sa_family != AF_INET || getifaddrs(&IfAddrs) != 0) {
+        return 0;
+    }
+
+    for (struct ifaddrs* IfAddr = IfAddrs; IfAddr != NULL; IfAddr = IfAddr->ifa_next) {
+        if (IfAddr->ifa_addr != NULL &&
+            IfAddr->ifa_addr->sa_family == AF_INET &&
+            ((struct sockaddr_in*)IfAddr->ifa_addr)->sin_addr.s_addr ==
+                Address->Ipv4.sin_addr.s_addr) {
+            IfIndex = if_nametoindex(IfAddr->ifa_name);
+            break;
+        }
+    }
+
+    freeifaddrs(IfAddrs);
+    return IfIndex;
+}
+
+static
+QUIC_STATUS
+QuicXdpQueryInterface(
+    _Inout_ QUIC_XDP_PROGRAM* Program
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    struct ifreq IfReq;
+    struct ethtool_channels Channels;
+
+    int Fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (Fd == INVALID_SOCKET_FD) {
+        return errno;
+    }
+
+    QuicZeroMemory(&IfReq, sizeof(IfReq));
+    if (if_indextoname(Program->IfIndex, IfReq.ifr_name) == NULL) {
+        Status = errno;
+        goto Exit;
+    }
+
+    if (ioctl(Fd, SIOCGIFHWADDR, &IfReq) != 0) {
+        Status = errno;
+        goto Exit;
+    }
+    if (IfReq.ifr_hwaddr.sa_family != ARPHRD_ETHER) {
+        Status = QUIC_STATUS_NOT_SUPPORTED;
+        goto Exit;
+    }
+    QuicCopyMemory(Program->MacAddress, IfReq.ifr_hwaddr.sa_data, sizeof(Program->MacAddress));
+
+    //
+    // Assume a single queue if the driver doesn't report its channels.
+    //
+    QuicZeroMemory(&Channels, sizeof(Channels));
+    Channels.cmd = ETHTOOL_GCHANNELS;
+    IfReq.ifr_data = (char*)&Channels;
+    if (ioctl(Fd, SIOCETHTOOL, &IfReq) == 0 &&
+        Channels.combined_count + Channels.rx_count != 0) {
+        Program->QueueCount = Channels.combined_count + Channels.rx_count;
+    } else {
+        Program->QueueCount = 1;
+    }
+
+Exit:
+
+    close(Fd);
+    return Status;
+}
+
+QUIC_STATUS
+QuicXdpProgramInitialize(
+    _In_ uint32_t IfIndex,
+    _Out_ QUIC_XDP_PROGRAM* Program
+    )
+{
+    QUIC_STATUS Status;
+    union bpf_attr Attr;
+
+    QuicZeroMemory(Program, sizeof(*Program));
+    Program->IfIndex = IfIndex;
+    Program->ProgramFd = INVALID_SOCKET_FD;
+    Program->LinkFd = INVALID_SOCKET_FD;
+    Program->XskMapFd = INVALID_SOCKET_FD;
+    Program->AddressMapFd = INVALID_SOCKET_FD;
+
+    Status = QuicXdpQueryInterface(Program);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "Query XDP interface failed");
+        goto Exit;
+    }
+
+    Program->XskMapFd =
+        QuicBpfCreateMap(
+            BPF_MAP_TYPE_XSKMAP,
+            sizeof(uint32_t),
+            sizeof(uint32_t),
+            Program->QueueCount);
+    if (Program->XskMapFd < 0) {
+        Status = errno;
+        Program->XskMapFd = INVALID_SOCKET_FD;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "bpf(BPF_MAP_CREATE, XSKMAP) failed");
+        goto Exit;
+    }
+
+    Program->AddressMapFd =
+        QuicBpfCreateMap(
+            BPF_MAP_TYPE_HASH,
+            sizeof(QUIC_XDP_ADDRESS_KEY),
+            sizeof(uint8_t),
+            QUIC_XDP_MAX_ADDRESSES);
+    if (Program->AddressMapFd < 0) {
+        Status = errno;
+        Program->AddressMapFd = INVALID_SOCKET_FD;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "bpf(BPF_MAP_CREATE, HASH) failed");
+        goto Exit;
+    }
+
+    Program->ProgramFd = QuicXdpLoadProgram(Program->AddressMapFd, Program->XskMapFd);
+    if (Program->ProgramFd < 0) {
+        Status = errno;
+        Program->ProgramFd = INVALID_SOCKET_FD;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "bpf(BPF_PROG_LOAD) failed");
+        goto Exit;
+    }
+
+    //
+    // A link (rather than a netlink attach) detaches the program when the last
+    // reference is closed, so that it never outlives the process.
+    //
+    QuicZeroMemory(&Attr, sizeof(Attr));
+    Attr.link_create.prog_fd = (uint32_t)Program->ProgramFd;
+    Attr.link_create.target_ifindex = IfIndex;
+    Attr.link_create.attach_type = BPF_XDP;
+    Program->LinkFd = QuicBpf(BPF_LINK_CREATE, &Attr);
+    if (Program->LinkFd < 0) {
+        Status = errno;
+        Program->LinkFd = INVALID_SOCKET_FD;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "bpf(BPF_LINK_CREATE) failed");
+        goto Exit;
+    }
+
+Exit:
+
+    if (QUIC_FAILED(Status)) {
+        QuicXdpProgramUninitialize(Program);
+    }
+
+    return Status;
+}
+
+void
+QuicXdpProgramUninitialize(
+    _In_ QUIC_XDP_PROGRAM* Program
+    )
+{
+    if (Program->LinkFd != INVALID_SOCKET_FD) {
+        close(Program->LinkFd);
+        Program->LinkFd = INVALID_SOCKET_FD;
+    }
+    if (Program->ProgramFd != INVALID_SOCKET_FD) {
+        close(Program->ProgramFd);
+        Program->ProgramFd = INVALID_SOCKET_FD;
+    }
+    if (Program->AddressMapFd != INVALID_SOCKET_FD) {
+        close(Program->AddressMapFd);
+        Program->AddressMapFd = INVALID_SOCKET_FD;
+    }
+    if (Program->XskMapFd != INVALID_SOCKET_FD) {
+        close(Program->XskMapFd);
+        Program->XskMapFd = INVALID_SOCKET_FD;
+    }
+}
+
+QUIC_STATUS
+QuicXdpProgramSetAddress(
+    _In_ QUIC_XDP_PROGRAM* Program,
+    _In_ const QUIC_ADDR* Address,
+    _In_ BOOLEAN Add
+    )
+{
+    QUIC_DBG_ASSERT(Address->Ip.sa_family == AF_INET);
+
+    QUIC_XDP_ADDRESS_KEY Key = {
+        Address->Ipv4.sin_addr.s_addr,
+        Address->Ipv4.sin_port,
+        0
+    };
+    const uint8_t Value = 1;
+
+    int Result =
+        Add ?
+            QuicBpfUpdateMap(Program->AddressMapFd, &Key, &Value) :
+            QuicBpfDeleteMapEntry(Program->AddressMapFd, &Key);
+
+    return Result == 0 ? QUIC_STATUS_SUCCESS : (QUIC_STATUS)errno;
+}
+
+static
+QUIC_STATUS
+QuicXdpRingInitialize(
+    _In_ int Fd,
+    _In_ const struct xdp_ring_offset* Offsets,
+    _In_ uint32_t DescSize,
+    _In_ off_t PageOffset,
+    _Out_ QUIC_XDP_RING* Ring
+    )
+{
+    Ring->MapSize = Offsets->desc + QUIC_XDP_RING_SIZE * DescSize;
+    Ring->Map =
+        mmap(
+            NULL,
+            Ring->MapSize,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            Fd,
+            PageOffset);
+    if (Ring->Map == MAP_FAILED) {
+        return errno;
+    }
+
+    Ring->Producer = (uint32_t*)((uint8_t*)Ring->Map + Offsets->producer);
+    Ring->Consumer = (uint32_t*)((uint8_t*)Ring->Map + Offsets->consumer);
+    Ring->Flags = (uint32_t*)((uint8_t*)Ring->Map + Offsets->flags);
+    Ring->Descs = (uint8_t*)Ring->Map + Offsets->desc;
+    Ring->Mask = QUIC_XDP_RING_SIZE - 1;
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+static
+void
+QuicXdpRingUninitialize(
+    _In_ QUIC_XDP_RING* Ring
+    )
+{
+    if (Ring->Map != MAP_FAILED) {
+        munmap(Ring->Map, Ring->MapSize);
+        Ring->Map = MAP_FAILED;
+    }
+}
+
+QUIC_STATUS
+QuicXdpSocketInitialize(
+    _In_ QUIC_XDP_PROGRAM* Program,
+    _In_ uint32_t QueueId,
+    _Out_ QUIC_XDP_SOCKET* Socket
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+
+    QuicZeroMemory(Socket, sizeof(*Socket));
+    Socket->Umem = MAP_FAILED;
+    Socket->FillRing.Map = MAP_FAILED;
+    Socket->CompletionRing.Map = MAP_FAILED;
+    Socket->RxRing.Map = MAP_FAILED;
+    Socket->TxRing.Map = MAP_FAILED;
+    QuicLockInitialize(&Socket->Lock);
+
+    Socket->Fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (Socket->Fd == INVALID_SOCKET_FD) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "socket(AF_XDP) failed");
+        goto Exit;
+    }
+
+    Socket->UmemSize = (size_t)QUIC_XDP_FRAME_SIZE * QUIC_XDP_FRAME_COUNT;
+    Socket->Umem =
+        mmap(
+            NULL,
+            Socket->UmemSize,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE,
+            -1,
+            0);
+    if (Socket->Umem == MAP_FAILED) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "mmap(UMEM) failed");
+        goto Exit;
+    }
+
+    struct xdp_umem_reg UmemReg = {
+        .addr = (uint64_t)(uintptr_t)Socket->Umem,
+        .len = Socket->UmemSize,
+        .chunk_size = QUIC_XDP_FRAME_SIZE,
+        .headroom = 0
+    };
+    if (setsockopt(Socket->Fd, SOL_XDP, XDP_UMEM_REG, &UmemReg, sizeof(UmemReg)) != 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "setsockopt(XDP_UMEM_REG) failed");
+        goto Exit;
+    }
+
+    const int RingSize = QUIC_XDP_RING_SIZE;
+    if (setsockopt(Socket->Fd, SOL_XDP, XDP_UMEM_FILL_RING, &RingSize, sizeof(RingSize)) != 0 ||
+        setsockopt(Socket->Fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &RingSize, sizeof(RingSize)) != 0 ||
+        setsockopt(Socket->Fd, SOL_XDP, XDP_RX_RING, &RingSize, sizeof(RingSize)) != 0 ||
+        setsockopt(Socket->Fd, SOL_XDP, XDP_TX_RING, &RingSize, sizeof(RingSize)) != 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "setsockopt(XDP rings) failed");
+        goto Exit;
+    }
+
+    struct xdp_mmap_offsets Offsets;
+    socklen_t OffsetsLength = sizeof(Offsets);
+    if (getsockopt(Socket->Fd, SOL_XDP, XDP_MMAP_OFFSETS, &Offsets, &OffsetsLength) != 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "getsockopt(XDP_MMAP_OFFSETS) failed");
+        goto Exit;
+    }
+    if (OffsetsLength != sizeof(Offsets)) {
+        //
+        // Older kernels don't report the ring flags, which are needed to know
+        // when the kernel must be woken up.
+        //
+        Status = QUIC_STATUS_NOT_SUPPORTED;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "XDP ring flags unsupported");
+        goto Exit;
+    }
+
+    if (QUIC_FAILED(Status = QuicXdpRingInitialize(Socket->Fd, &Offsets.fr, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING, &Socket->FillRing)) ||
+        QUIC_FAILED(Status = QuicXdpRingInitialize(Socket->Fd, &Offsets.cr, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING, &Socket->CompletionRing)) ||
+        QUIC_FAILED(Status = QuicXdpRingInitialize(Socket->Fd, &Offsets.rx, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING, &Socket->RxRing)) ||
+        QUIC_FAILED(Status = QuicXdpRingInitialize(Socket->Fd, &Offsets.tx, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING, &Socket->TxRing))) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "mmap(XDP ring) failed");
+        goto Exit;
+    }
+
+    struct sockaddr_xdp Address = {
+        .sxdp_family = AF_XDP,
+        .sxdp_flags = XDP_USE_NEED_WAKEUP,
+        .sxdp_ifindex = Program->IfIndex,
+        .sxdp_queue_id = QueueId
+    };
+    if (bind(Socket->Fd, (struct sockaddr*)&Address, sizeof(Address)) != 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "bind(AF_XDP) failed");
+        goto Exit;
+    }
+
+    for (uint32_t i = 0; i < QUIC_XDP_FRAME_COUNT; ++i) {
+        Socket->FreeFrames[i] = (uint64_t)i * QUIC_XDP_FRAME_SIZE;
+    }
+    Socket->FreeFrameCount = QUIC_XDP_FRAME_COUNT;
+    QuicXdpSocketRefill(Socket);
+
+    if (QuicBpfUpdateMap(Program->XskMapFd, &QueueId, &Socket->Fd) != 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "bpf(BPF_MAP_UPDATE_ELEM, XSKMAP) failed");
+        goto Exit;
+    }
+
+Exit:
+
+    if (QUIC_FAILED(Status)) {
+        QuicXdpSocketUninitialize(Socket);
+    }
+
+    return Status;
+}
+
+void
+QuicXdpSocketUninitialize(
+    _In_ QUIC_XDP_SOCKET* Socket
+    )
+{
+    //
+    // Closing the socket also removes it from the program's socket map.
+    //
+    if (Socket->Fd != INVALID_SOCKET_FD) {
+        close(Socket->Fd);
+        Socket->Fd = INVALID_SOCKET_FD;
+    }
+    QuicXdpRingUninitialize(&Socket->TxRing);
+    QuicXdpRingUninitialize(&Socket->RxRing);
+    QuicXdpRingUninitialize(&Socket->CompletionRing);
+    QuicXdpRingUninitialize(&Socket->FillRing);
+    if (Socket->Umem != MAP_FAILED) {
+        munmap(Socket->Umem, Socket->UmemSize);
+        Socket->Umem = MAP_FAILED;
+    }
+    QuicLockUninitialize(&Socket->Lock);
+}
+
+_Success_(return != FALSE)
+BOOLEAN
+QuicXdpSocketAllocFrame(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _Out_ uint64_t* Frame
+    )
+{
+    BOOLEAN Allocated = FALSE;
+    QuicLockAcquire(&Socket->Lock);
+    if (Socket->FreeFrameCount != 0) {
+        *Frame = Socket->FreeFrames[--Socket->FreeFrameCount];
+        Allocated = TRUE;
+    }
+    QuicLockRelease(&Socket->Lock);
+    return Allocated;
+}
+
+void
+QuicXdpSocketFreeFrame(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _In_ uint64_t Frame
+    )
+{
+    QuicLockAcquire(&Socket->Lock);
+    QUIC_DBG_ASSERT(Socket->FreeFrameCount < QUIC_XDP_FRAME_COUNT);
+    Socket->FreeFrames[Socket->FreeFrameCount++] = Frame;
+    QuicLockRelease(&Socket->Lock);
+}
+
+//
+// Returns the frames of completed transmits to the free frames. Must be called
+// with the lock held.
+//
+static
+void
+QuicXdpSocketReapCompletions(
+    _In_ QUIC_XDP_SOCKET* Socket
+    )
+{
+    QUIC_XDP_RING* Ring = &Socket->CompletionRing;
+    const uint64_t* Descs = (const uint64_t*)Ring->Descs;
+    uint32_t Consumer = *Ring->Consumer;
+    const uint32_t Producer = __atomic_load_n(Ring->Producer, __ATOMIC_ACQUIRE);
+
+    if (Consumer == Producer) {
+        return;
+    }
+
+    while (Consumer != Producer) {
+        QUIC_DBG_ASSERT(Socket->FreeFrameCount < QUIC_XDP_FRAME_COUNT);
+        Socket->FreeFrames[Socket->FreeFrameCount++] = Descs[Consumer++ & Ring->Mask];
+    }
+
+    __atomic_store_n(Ring->Consumer, Consumer, __ATOMIC_RELEASE);
+}
+
+uint32_t
+QuicXdpSocketReceive(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _Out_writes_to_(MaxCount, return) struct xdp_desc* Descs,
+    _In_ uint32_t MaxCount
+    )
+{
+    QUIC_XDP_RING* Ring = &Socket->RxRing;
+    const struct xdp_desc* RingDescs = (const struct xdp_desc*)Ring->Descs;
+    const uint32_t Consumer = *Ring->Consumer;
+    const uint32_t Producer = __atomic_load_n(Ring->Producer, __ATOMIC_ACQUIRE);
+
+    uint32_t Count = Producer - Consumer;
+    if (Count > MaxCount) {
+        Count = MaxCount;
+    }
+
+    for (uint32_t i = 0; i < Count; ++i) {
+        Descs[i] = RingDescs[(Consumer + i) & Ring->Mask];
+    }
+
+    if (Count != 0) {
+        __atomic_store_n(Ring->Consumer, Consumer + Count, __ATOMIC_RELEASE);
+    }
+
+    return Count;
+}
+
+uint32_t
+QuicXdpSocketRefill(
+    _In_ QUIC_XDP_SOCKET* Socket
+    )
+{
+    QUIC_XDP_RING* Ring = &Socket->FillRing;
+    uint64_t* Descs = (uint64_t*)Ring->Descs;
+    const uint32_t Producer = *Ring->Producer;
+
+    QuicLockAcquire(&Socket->Lock);
+    QuicXdpSocketReapCompletions(Socket);
+
+    const uint32_t Posted = Producer - __atomic_load_n(Ring->Consumer, __ATOMIC_ACQUIRE);
+    uint32_t Count = QUIC_XDP_RING_SIZE - Posted;
+    if (Count > Socket->FreeFrameCount) {
+        Count = Socket->FreeFrameCount;
+    }
+
+    for (uint32_t i = 0; i < Count; ++i) {
+        Descs[(Producer + i) & Ring->Mask] =
+            Socket->FreeFrames[--Socket->FreeFrameCount];
+    }
+    QuicLockRelease(&Socket->Lock);
+
+    if (Count != 0) {
+        __atomic_store_n(Ring->Producer, Producer + Count, __ATOMIC_RELEASE);
+        if (__atomic_load_n(Ring->Flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP) {
+            (void)recvfrom(Socket->Fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+        }
+    }
+
+    return Posted + Count;
+}
+
+BOOLEAN
+QuicXdpSocketTransmit(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _In_reads_(Count) const struct xdp_desc* Descs,
+    _In_ uint32_t Count
+    )
+{
+    QUIC_XDP_RING* Ring = &Socket->TxRing;
+    struct xdp_desc* RingDescs = (struct xdp_desc*)Ring->Descs;
+
+    QuicLockAcquire(&Socket->Lock);
+    QuicXdpSocketReapCompletions(Socket);
+
+    const uint32_t Producer = *Ring->Producer;
+    const uint32_t Available =
+        QUIC_XDP_RING_SIZE - (Producer - __atomic_load_n(Ring->Consumer, __ATOMIC_ACQUIRE));
+    if (Available < Count) {
+        QuicLockRelease(&Socket->Lock);
+        return FALSE;
+    }
+
+    for (uint32_t i = 0; i < Count; ++i) {
+        RingDescs[(Producer + i) & Ring->Mask] = Descs[i];
+    }
+    __atomic_store_n(Ring->Producer, Producer + Count, __ATOMIC_RELEASE);
+    QuicLockRelease(&Socket->Lock);
+
+    if (__atomic_load_n(Ring->Flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP) {
+        //
+        // EAGAIN/EBUSY/ENOBUFS only mean the kernel is still working through
+        // the ring; the frames stay queued either way.
+        //
+        (void)sendto(Socket->Fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+    }
+
+    return TRUE;
+}
+
+_Success_(return != FALSE)
+BOOLEAN
+QuicXdpParseHeaders(
+    _In_reads_bytes_(Length) const uint8_t* Frame,
+    _In_ uint32_t Length,
+    _Out_ QUIC_ADDR* LocalAddress,
+    _Out_ QUIC_ADDR* RemoteAddress,
+    _Out_writes_bytes_(6) uint8_t* RemoteMacAddress,
+    _Out_ uint8_t* TypeOfService,
+    _Out_ uint16_t* PayloadLength
+    )
+{
+    //
+    // N.B. Checksums aren't validated. The NIC has generally done so already,
+    // and the QUIC packet protection catches any corruption regardless.
+    //
+    if (Length < QUIC_XDP_HEADERS_LENGTH) {
+        return FALSE;
+    }
+
+    const uint8_t* Ip = Frame + 14;
+    const uint8_t* Udp = Ip + 20;
+
+    if (*(const uint16_t*)(Frame + 12) != htons(ETH_P_IP) ||
+        Ip[0] != 0x45 ||
+        Ip[9] != IPPROTO_UDP ||
+        (*(const uint16_t*)(Ip + 6) & htons(0x3FFF)) != 0) {
+        return FALSE;
+    }
+
+    const uint16_t IpLength = ntohs(*(const uint16_t*)(Ip + 2));
+    const uint16_t UdpLength = ntohs(*(const uint16_t*)(Udp + 4));
+    if (IpLength > Length - 14 ||
+        UdpLength < 8 ||
+        UdpLength > IpLength - 20) {
+        return FALSE;
+    }
+
+    QuicZeroMemory(LocalAddress, sizeof(*LocalAddress));
+    LocalAddress->Ipv4.sin_family = AF_INET;
+    QuicCopyMemory(&LocalAddress->Ipv4.sin_addr, Ip + 16, 4);
+    QuicCopyMemory(&LocalAddress->Ipv4.sin_port, Udp + 2, 2);
+
+    QuicZeroMemory(RemoteAddress, sizeof(*RemoteAddress));
+    RemoteAddress->Ipv4.sin_family = AF_INET;
+    QuicCopyMemory(&RemoteAddress->Ipv4.sin_addr, Ip + 12, 4);
+    QuicCopyMemory(&RemoteAddress->Ipv4.sin_port, Udp, 2);
+
+    QuicCopyMemory(RemoteMacAddress, Frame + 6, 6);
+    *TypeOfService = Ip[1];
+    *PayloadLength = UdpLength - 8;
+
+    return TRUE;
+}
+
+void
+QuicXdpWriteHeaders(
+    _Out_writes_bytes_(QUIC_XDP_HEADERS_LENGTH) uint8_t* Frame,
+    _In_reads_bytes_(6) const uint8_t* LocalMacAddress,
+    _In_reads_bytes_(6) const uint8_t* RemoteMacAddress,
+    _In_ const QUIC_ADDR* LocalAddress,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_ uint8_t TypeOfService,
+    _In_ uint16_t PayloadLength
+    )
+{
+    uint8_t* Ip = Frame + 14;
+    uint8_t* Udp = Ip + 20;
+
+    QuicCopyMemory(Frame, RemoteMacAddress, 6);
+    QuicCopyMemory(Frame + 6, LocalMacAddress, 6);
+    *(uint16_t*)(Frame + 12) = htons(ETH_P_IP);
+
+    Ip[0] = 0x45;
+    Ip[1] = TypeOfService;
+    *(uint16_t*)(Ip + 2) = htons((uint16_t)(20 + 8 + PayloadLength));
+    *(uint16_t*)(Ip + 4) = 0;
+    *(uint16_t*)(Ip + 6) = htons(0x4000); // Don't fragment
+    Ip[8] = 64;
+    Ip[9] = IPPROTO_UDP;
+    *(uint16_t*)(Ip + 10) = 0;
+    QuicCopyMemory(Ip + 12, &LocalAddress->Ipv4.sin_addr, 4);
+    QuicCopyMemory(Ip + 16, &RemoteAddress->Ipv4.sin_addr, 4);
+
+    uint32_t Checksum = 0;
+    for (uint32_t i = 0; i < 20; i += 2) {
+        Checksum += *(const uint16_t*)(Ip + i);
+    }
+    Checksum = (Checksum & 0xFFFF) + (Checksum >> 16);
+    Checksum = (Checksum & 0xFFFF) + (Checksum >> 16);
+    *(uint16_t*)(Ip + 10) = (uint16_t)~Checksum;
+
+    //
+    // The UDP checksum is optional over IPv4, and QUIC's packet protection
+    // already covers the payload.
+    //
+    QuicCopyMemory(Udp, &LocalAddress->Ipv4.sin_port, 2);
+    QuicCopyMemory(Udp + 2, &RemoteAddress->Ipv4.sin_port, 2);
+    *(uint16_t*)(Udp + 4) = htons((uint16_t)(8 + PayloadLength));
+    *(uint16_t*)(Udp + 6) = 0;
+}
@@ -0,0 +1,836 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    QUIC in-process loopback datapath. Replaces the UDP socket datapath (see
+    QUIC_DATAPATH_LOOPBACK in the root CMakeLists.txt) for CPU-only protocol
+    benchmarks: datagrams sent on one binding are handed directly to the
+    receive callback of the binding that owns the destination port, on the
+    sending thread. There are no sockets, no system calls and no network
+    stack, so the cost measured is the cost of the QUIC protocol (and TLS)
+    processing alone.
+
+    Bindings are only identified by their port; the destination IP address
+    is ignored. Datagrams sent to a port without a binding are reported with
+    the unreachable callback. Nothing is ever dropped or reordered.
+
+--*/
+
+#include "platform_internal.h"
+#ifdef QUIC_CLOG
+#include "datapath_loopback.c.clog.h"
+#endif
+
+//
+// The maximum number of UDP datagrams that can be sent with one call.
+//
+#define QUIC_MAX_BATCH_SEND 7
+
+//
+// The range of ports assigned to bindings created without an explicit port.
+//
+#define QUIC_LOOPBACK_EPHEMERAL_PORT_MIN 49152
+#define QUIC_LOOPBACK_EPHEMERAL_PORT_MAX UINT16_MAX
+
+//
+// Internal receive context, between the QUIC_RECV_DATAGRAM and the client
+// receive context.
+//
+typedef struct QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT {
+
+    //
+    // The owning datagram pool.
+    //
+    QUIC_POOL* OwningPool;
+
+    //
+    // The addresses the datagram was sent from and to.
+    //
+    QUIC_TUPLE Tuple;
+
+} QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT;
+
+//
+// Loopback datapath binding.
+//
+typedef struct QUIC_DATAPATH_BINDING {
+
+    //
+    // The owning datapath.
+    //
+    QUIC_DATAPATH* Datapath;
+
+    //
+    // Client context pointer.
+    //
+    void *ClientContext;
+
+    //
+    // The local address and port, with the port always set.
+    //
+    QUIC_ADDR LocalAddress;
+
+    //
+    // The remote address, for connected bindings.
+    //
+    QUIC_ADDR RemoteAddress;
+
+    //
+    // Indicates the binding was created with a remote address.
+    //
+    BOOLEAN Connected;
+
+    //
+    // Held by each send while it is delivering datagrams to this binding, so
+    // that delete can wait for outstanding receive upcalls.
+    //
+    QUIC_RUNDOWN_REF Rundown;
+
+} QUIC_DATAPATH_BINDING;
+
+//
+// Send context. The send buffers are the payloads of receive datagrams, so
+// that they are delivered to the destination binding without a copy.
+//
+typedef struct QUIC_DATAPATH_SEND_CONTEXT {
+
+    //
+    // The owning binding.
+    //
+    QUIC_DATAPATH_BINDING* Binding;
+
+    //
+    // The ECN codepoint the datagrams are marked with.
+    //
+    uint8_t ECN;
+
+    //
+    // The number of buffers allocated.
+    //
+    uint32_t BufferCount;
+
+    //
+    // The buffers, each pointing into the payload of a receive datagram.
+    //
+    QUIC_BUFFER Buffers[QUIC_MAX_BATCH_SEND];
+
+} QUIC_DATAPATH_SEND_CONTEXT;
+
+//
+// Loopback datapath.
+//
+typedef struct QUIC_DATAPATH {
+
+    //
+    // Client receive and unreachable callbacks.
+    //
+    QUIC_DATAPATH_RECEIVE_CALLBACK_HANDLER RecvHandler;
+    QUIC_DATAPATH_UNREACHABLE_CALLBACK_HANDLER UnreachableHandler;
+
+    //
+    // The length of the client context of each receive datagram.
+    //
+    uint32_t ClientRecvContextLength;
+
+    //
+    // The offset of the payload in each receive datagram.
+    //
+    uint32_t RecvPayloadOffset;
+
+    //
+    // Pools for send contexts and for the datagrams (which are both the send
+    // buffers and the received datagrams).
+    //
+    QUIC_POOL SendContextPool;
+    QUIC_POOL DatagramPool;
+
+    //
+    // Protects the port table.
+    //
+    QUIC_DISPATCH_LOCK Lock;
+
+    //
+    // The next port to try to assign to a binding created without a port.
+    //
+    uint16_t NextEphemeralPort;
+
+    //
+    // The bindings, indexed by local port.
+    //
+    QUIC_DATAPATH_BINDING* Ports[UINT16_MAX + 1];
+
+} QUIC_DATAPATH;
+
+QUIC_RECV_DATAGRAM*
+QuicDataPathRecvPacketToRecvDatagram(
+    _In_ const QUIC_RECV_PACKET* const RecvContext
+    )
+{
+    return (QUIC_RECV_DATAGRAM*)
+        (((uint8_t*)RecvContext) -
+            sizeof(QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT) -
+            sizeof(QUIC_RECV_DATAGRAM));
+}
+
+QUIC_RECV_PACKET*
+QuicDataPathRecvDatagramToRecvPacket(
+    _In_ const QUIC_RECV_DATAGRAM* const RecvPacket
+    )
+{
+    return (QUIC_RECV_PACKET*)
+        (((uint8_t*)RecvPacket) +
+            sizeof(QUIC_RECV_DATAGRAM) +
+            sizeof(QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT));
+}
+
+QUIC_STATUS
+QuicDataPathInitialize(
+    _In_ uint32_t ClientRecvContextLength,
+    _In_ QUIC_DATAPATH_RECEIVE_CALLBACK_HANDLER RecvCallback,
+    _In_ QUIC_DATAPATH_UNREACHABLE_CALLBACK_HANDLER UnreachableCallback,
+    _Out_ QUIC_DATAPATH* *NewDataPath
+    )
+{
+    if (RecvCallback == NULL ||
+        UnreachableCallback == NULL ||
+        NewDataPath == NULL) {
+        return QUIC_STATUS_INVALID_PARAMETER;
+    }
+
+    QUIC_DATAPATH* Datapath = QUIC_ALLOC_PAGED(sizeof(QUIC_DATAPATH));
+    if (Datapath == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_DATAPATH",
+            sizeof(QUIC_DATAPATH));
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    QuicZeroMemory(Datapath, sizeof(QUIC_DATAPATH));
+    Datapath->RecvHandler = RecvCallback;
+    Datapath->UnreachableHandler = UnreachableCallback;
+    Datapath->ClientRecvContextLength = ClientRecvContextLength;
+    Datapath->RecvPayloadOffset =
+        sizeof(QUIC_RECV_DATAGRAM) +
+        sizeof(QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT) +
+        ClientRecvContextLength;
+    Datapath->NextEphemeralPort = QUIC_LOOPBACK_EPHEMERAL_PORT_MIN;
+    QuicPoolInitialize(
+        FALSE,
+        sizeof(QUIC_DATAPATH_SEND_CONTEXT),
+        &Datapath->SendContextPool);
+    QuicPoolInitialize(
+        FALSE,
+        Datapath->RecvPayloadOffset + MAX_UDP_PAYLOAD_LENGTH,
+        &Datapath->DatagramPool);
+    QuicDispatchLockInitialize(&Datapath->Lock);
+
+    *NewDataPath = Datapath;
+    return QUIC_STATUS_SUCCESS;
+}
+
+void
+QuicDataPathUninitialize(
+    _In_ QUIC_DATAPATH* Datapath
+    )
+{
+    if (Datapath == NULL) {
+        return;
+    }
+    QuicDispatchLockUninitialize(&Datapath->Lock);
+    QuicPoolUninitialize(&Datapath->DatagramPool);
+    QuicPoolUninitialize(&Datapath->SendContextPool);
+    QUIC_FREE(Datapath);
+}
+
+uint32_t
+QuicDataPathGetSupportedFeatures(
+    _In_ QUIC_DATAPATH* Datapath
+    )
+{
+    UNREFERENCED_PARAMETER(Datapath);
+    return 0;
+}
+
+BOOLEAN
+QuicDataPathIsPaddingPreferred(
+    _In_ QUIC_DATAPATH* Datapath
+    )
+{
+    UNREFERENCED_PARAMETER(Datapath);
+    return FALSE;
+}
+
+void
+QuicDataPathSetBusyPoll(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t BusyPollUs
+    )
+{
+    //
+    // There is nothing to poll.
+    //
+    UNREFERENCED_PARAMETER(Datapath);
+    UNREFERENCED_PARAMETER(BusyPollUs);
+}
+
+QUIC_STATUS
+QuicDataPathSetPollCallback(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index,
+    _In_opt_ QUIC_DATAPATH_POLL_CALLBACK_HANDLER PollCallback,
+    _In_opt_ void* PollContext
+    )
+{
+    UNREFERENCED_PARAMETER(Datapath);
+    UNREFERENCED_PARAMETER(Index);
+    UNREFERENCED_PARAMETER(PollCallback);
+    UNREFERENCED_PARAMETER(PollContext);
+    return QUIC_STATUS_NOT_SUPPORTED;
+}
+
+void
+QuicDataPathWakeProcessor(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index
+    )
+{
+    UNREFERENCED_PARAMETER(Datapath);
+    UNREFERENCED_PARAMETER(Index);
+}
+
+QUIC_STATUS
+QuicDataPathSetCidSteering(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_opt_ const QUIC_DATAPATH_CID_STEERING* Steering
+    )
+{
+    UNREFERENCED_PARAMETER(Datapath);
+    UNREFERENCED_PARAMETER(Steering);
+    return QUIC_STATUS_NOT_SUPPORTED;
+}
+
+QUIC_STATUS
+QuicDataPathBindingSetCryptoOffload(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_opt_ const QUIC_DATAPATH_CRYPTO_OFFLOAD* Offload
+    )
+{
+    //
+    // No inline crypto offload (QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD).
+    //
+    UNREFERENCED_PARAMETER(Binding);
+    UNREFERENCED_PARAMETER(RemoteAddress);
+    return Offload == NULL ? QUIC_STATUS_SUCCESS : QUIC_STATUS_NOT_SUPPORTED;
+}
+
+QUIC_STATUS
+QuicDataPathResolveAddress(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_z_ const char* HostName,
+    _Inout_ QUIC_ADDR * Address
+    )
+{
+    UNREFERENCED_PARAMETER(Datapath);
+
+    //
+    // Every name resolves to the loopback address, since only the port is
+    // used to find the destination binding.
+    //
+    uint16_t Port = QuicAddrGetPort(Address);
+    QUIC_ADDRESS_FAMILY Family = QuicAddrGetFamily(Address);
+    if (!QuicAddrFromString(HostName, Port, Address) ||
+        (Family != AF_UNSPEC &&
+         QuicAddrGetFamily(Address) != Family)) {
+        QuicZeroMemory(Address, sizeof(QUIC_ADDR));
+        QuicAddrSetFamily(
+            Address,
+            Family == AF_UNSPEC ? AF_INET : Family);
+        QuicAddrSetToLoopback(Address);
+        QuicAddrSetPort(Address, Port);
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+QUIC_STATUS
+QuicDataPathResolveAddressAsync(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_z_ const char* HostName,
+    _In_ QUIC_DATAPATH_RESOLVE_CALLBACK_HANDLER Callback,
+    _In_opt_ void* Context,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+    //
+    // Nothing to wait on, so always complete inline.
+    //
+    UNREFERENCED_PARAMETER(Callback);
+    UNREFERENCED_PARAMETER(Context);
+    QuicZeroMemory(Resolution, sizeof(QUIC_DATAPATH_RESOLUTION));
+    return
+        QuicDataPathResolveAddress(
+            Datapath, HostName, &Resolution->Addresses[0]);
+}
+
+QUIC_STATUS
+QuicDataPathBindingCreate(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_opt_ const QUIC_ADDR * LocalAddress,
+    _In_opt_ const QUIC_ADDR * RemoteAddress,
+    _In_opt_ void* RecvCallbackContext,
+    _Out_ QUIC_DATAPATH_BINDING** NewBinding
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+
+    QUIC_DATAPATH_BINDING* Binding = QUIC_ALLOC_NONPAGED(sizeof(QUIC_DATAPATH_BINDING));
+    if (Binding == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_DATAPATH_BINDING",
+            sizeof(QUIC_DATAPATH_BINDING));
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    QuicZeroMemory(Binding, sizeof(QUIC_DATAPATH_BINDING));
+    Binding->Datapath = Datapath;
+    Binding->ClientContext = RecvCallbackContext;
+    QuicRundownInitialize(&Binding->Rundown);
+
+    if (LocalAddress != NULL) {
+        Binding->LocalAddress = *LocalAddress;
+    } else {
+        QuicAddrSetFamily(
+            &Binding->LocalAddress,
+            RemoteAddress != NULL ?
+                QuicAddrGetFamily(RemoteAddress) : AF_INET);
+        QuicAddrSetToLoopback(&Binding->LocalAddress);
+    }
+    if (RemoteAddress != NULL) {
+        Binding->RemoteAddress = *RemoteAddress;
+        Binding->Connected = TRUE;
+    }
+
+    uint16_t Port = QuicAddrGetPort(&Binding->LocalAddress);
+
+    QuicDispatchLockAcquire(&Datapath->Lock);
+    if (Port == 0) {
+        for (uint32_t i = 0;
+             i <= QUIC_LOOPBACK_EPHEMERAL_PORT_MAX - QUIC_LOOPBACK_EPHEMERAL_PORT_MIN;
+             ++i) {
+            uint16_t Candidate = Datapath->NextEphemeralPort;
+            Datapath->NextEphemeralPort =
+                Candidate == QUIC_LOOPBACK_EPHEMERAL_PORT_MAX ?
+                    QUIC_LOOPBACK_EPHEMERAL_PORT_MIN : (uint16_t)(Candidate + 1);
+            if (Datapath->Ports[Candidate] == NULL) {
+                Port = Candidate;
+                break;
+            }
+        }
+        if (Port == 0) {
+            Status = QUIC_STATUS_ADDRESS_IN_USE;
+        }
+    } else if (Datapath->Ports[Port] != NULL) {
+        Status = QUIC_STATUS_ADDRESS_IN_USE;
+    }
+    if (QUIC_SUCCEEDED(Status)) {
+        QuicAddrSetPort(&Binding->LocalAddress, Port);
+        Datapath->Ports[Port] = Binding;
+    }
+    QuicDispatchLockRelease(&Datapath->Lock);
+
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            Binding,
+            Status,
+            "port reservation");
+        QuicRundownUninitialize(&Binding->Rundown);
+        QUIC_FREE(Binding);
+        return Status;
+    }
+
+    *NewBinding = Binding;
+    return QUIC_STATUS_SUCCESS;
+}
+
+void
+QuicDataPathBindingDelete(
+    _In_ QUIC_DATAPATH_BINDING* Binding
+    )
+{
+    QUIC_DATAPATH* Datapath = Binding->Datapath;
+
+    QuicDispatchLockAcquire(&Datapath->Lock);
+    Datapath->Ports[QuicAddrGetPort(&Binding->LocalAddress)] = NULL;
+    QuicDispatchLockRelease(&Datapath->Lock);
+
+    //
+    // Wait for any sends that are still delivering to this binding.
+    //
+    QuicRundownReleaseAndWait(&Binding->Rundown);
+    QuicRundownUninitialize(&Binding->Rundown);
+    QUIC_FREE(Binding);
+}
+
+uint16_t
+QuicDataPathBindingGetLocalMtu(
+    _In_ QUIC_DATAPATH_BINDING* Binding
+    )
+{
+    UNREFERENCED_PARAMETER(Binding);
+    return QUIC_MAX_MTU;
+}
+
+void
+QuicDataPathBindingGetLocalAddress(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _Out_ QUIC_ADDR * Address
+    )
+{
+    *Address = Binding->LocalAddress;
+}
+
+void
+QuicDataPathBindingGetRemoteAddress(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _Out_ QUIC_ADDR * Address
+    )
+{
+    *Address = Binding->RemoteAddress;
+}
+
+void
+QuicDataPathBindingReturnRecvDatagrams(
+    _In_opt_ QUIC_RECV_DATAGRAM* DatagramChain
+    )
+{
+    while (DatagramChain != NULL) {
+        QUIC_RECV_DATAGRAM* Datagram = DatagramChain;
+        DatagramChain = DatagramChain->Next;
+        QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT* InternalContext =
+            (QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT*)(Datagram + 1);
+        QuicPoolFree(InternalContext->OwningPool, Datagram);
+    }
+}
+
+QUIC_DATAPATH_SEND_CONTEXT*
+QuicDataPathBindingAllocSendContext(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ QUIC_ECN_TYPE ECN,
+    _In_ uint16_t MaxPacketSize
+    )
+{
+    UNREFERENCED_PARAMETER(MaxPacketSize);
+
+    QUIC_DATAPATH_SEND_CONTEXT* SendContext =
+        QuicPoolAlloc(&Binding->Datapath->SendContextPool);
+    if (SendContext != NULL) {
+        SendContext->Binding = Binding;
+        SendContext->ECN = (uint8_t)ECN;
+        SendContext->BufferCount = 0;
+    }
+    return SendContext;
+}
+
+//
+// Returns the receive datagram a send buffer's payload belongs to.
+//
+static
+QUIC_RECV_DATAGRAM*
+QuicSendBufferToRecvDatagram(
+    _In_ const QUIC_DATAPATH* Datapath,
+    _In_ const QUIC_BUFFER* Buffer
+    )
+{
+    return (QUIC_RECV_DATAGRAM*)(Buffer->Buffer - Datapath->RecvPayloadOffset);
+}
+
+void
+QuicDataPathBindingFreeSendContext(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
+    )
+{
+    QUIC_DATAPATH* Datapath = SendContext->Binding->Datapath;
+    for (uint32_t i = 0; i < SendContext->BufferCount; ++i) {
+        QuicPoolFree(
+            &Datapath->DatagramPool,
+            QuicSendBufferToRecvDatagram(Datapath, &SendContext->Buffers[i]));
+    }
+    QuicPoolFree(&Datapath->SendContextPool, SendContext);
+}
+
+QUIC_BUFFER*
+QuicDataPathBindingAllocSendDatagram(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ uint16_t MaxBufferLength
+    )
+{
+    QUIC_DBG_ASSERT(MaxBufferLength <= MAX_UDP_PAYLOAD_LENGTH);
+
+    if (SendContext->BufferCount == QUIC_MAX_BATCH_SEND) {
+        return NULL;
+    }
+
+    QUIC_DATAPATH* Datapath = SendContext->Binding->Datapath;
+    uint8_t* Datagram = QuicPoolAlloc(&Datapath->DatagramPool);
+    if (Datagram == NULL) {
+        return NULL;
+    }
+
+    QUIC_BUFFER* Buffer = &SendContext->Buffers[SendContext->BufferCount++];
+    Buffer->Buffer = Datagram + Datapath->RecvPayloadOffset;
+    Buffer->Length = MaxBufferLength;
+    return Buffer;
+}
+
+void
+QuicDataPathBindingFreeSendDatagram(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ QUIC_BUFFER* SendDatagram
+    )
+{
+    //
+    // This must be the final send buffer; intermediate buffers cannot be freed.
+    //
+    QUIC_DBG_ASSERT(SendContext->BufferCount != 0);
+    QUIC_DBG_ASSERT(SendDatagram == &SendContext->Buffers[SendContext->BufferCount - 1]);
+
+    QUIC_DATAPATH* Datapath = SendContext->Binding->Datapath;
+    QuicPoolFree(
+        &Datapath->DatagramPool,
+        QuicSendBufferToRecvDatagram(Datapath, SendDatagram));
+    --SendContext->BufferCount;
+}
+
+BOOLEAN
+QuicDataPathBindingIsSendContextFull(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
+    )
+{
+    return SendContext->BufferCount == QUIC_MAX_BATCH_SEND;
+}
+
+void
+QuicDataPathBindingSetSendTxTime(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ uint64_t TxTime
+    )
+{
+    //
+    // Datagrams are delivered as soon as they are sent.
+    //
+    UNREFERENCED_PARAMETER(SendContext);
+    UNREFERENCED_PARAMETER(TxTime);
+}
+
+void
+QuicDataPathBindingSetCryptoOffloadPacket(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ QUIC_BUFFER* Datagram,
+    _In_ uint16_t PacketOffset,
+    _In_ uint16_t PacketLength,
+    _In_ uint16_t HeaderLength,
+    _In_ uint64_t PacketNumber
+    )
+{
+    //
+    // Never called, as QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD isn't supported.
+    //
+    QUIC_DBG_ASSERT(FALSE);
+    UNREFERENCED_PARAMETER(SendContext);
+    UNREFERENCED_PARAMETER(Datagram);
+    UNREFERENCED_PARAMETER(PacketOffset);
+    UNREFERENCED_PARAMETER(PacketLength);
+    UNREFERENCED_PARAMETER(HeaderLength);
+    UNREFERENCED_PARAMETER(PacketNumber);
+}
+
+QUIC_STATUS
+QuicDataPathBindingSendFromTo(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ const QUIC_ADDR * LocalAddress,
+    _In_ const QUIC_ADDR * RemoteAddress,
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
+    )
+{
+    QUIC_DATAPATH* Datapath = Binding->Datapath;
+
+    QUIC_ADDR SourceAddress = *LocalAddress;
+    if (QuicAddrIsWildCard(&SourceAddress)) {
+        QuicAddrSetFamily(&SourceAddress, QuicAddrGetFamily(RemoteAddress));
+        QuicAddrSetToLoopback(&SourceAddress);
+    }
+    QuicAddrSetPort(&SourceAddress, QuicAddrGetPort(&Binding->LocalAddress));
+
+    QuicTraceEvent(
+        DatapathSendFromTo,
+        "[ udp][%p] Send %u bytes in %hhu buffers (segment=%hu) Dst=%!SOCKADDR!, Src=%!SOCKADDR!",
+        Binding,
+        SendContext->BufferCount == 0 ? 0 : SendContext->Buffers[0].Length * SendContext->BufferCount,
+        (uint8_t)SendContext->BufferCount,
+        SendContext->BufferCount == 0 ? 0 : (uint16_t)SendContext->Buffers[0].Length,
+        LOG_ADDR_LEN(*RemoteAddress),
+        LOG_ADDR_LEN(SourceAddress),
+        (uint8_t*)RemoteAddress,
+        (uint8_t*)&SourceAddress);
+
+    //
+    // Look up the destination binding and hold its rundown, so that it can't
+    // be deleted while the datagrams are being indicated to it.
+    //
+    QUIC_DATAPATH_BINDING* Destination;
+    QuicDispatchLockAcquire(&Datapath->Lock);
+    Destination = Datapath->Ports[QuicAddrGetPort(RemoteAddress)];
+    if (Destination != NULL && !QuicRundownAcquire(&Destination->Rundown)) {
+        Destination = NULL;
+    }
+    QuicDispatchLockRelease(&Datapath->Lock);
+
+    if (Destination == NULL) {
+        QuicDataPathBindingFreeSendContext(SendContext);
+        Datapath->UnreachableHandler(Binding, Binding->ClientContext, RemoteAddress);
+        return QUIC_STATUS_SUCCESS;
+    }
+
+    //
+    // Convert each send buffer, in place, into a received datagram and
+    // indicate them all as one chain.
+    //
+    QUIC_RECV_DATAGRAM* DatagramChain = NULL;
+    QUIC_RECV_DATAGRAM** DatagramChainTail = &DatagramChain;
+    uint16_t PartitionIndex = (uint16_t)QuicProcCurrentNumber();
+    const uint64_t RecvTime = QuicTimeUs64();
+    for (uint32_t i = 0; i < SendContext->BufferCount; ++i) {
+        QUIC_RECV_DATAGRAM* Datagram =
+            QuicSendBufferToRecvDatagram(Datapath, &SendContext->Buffers[i]);
+        QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT* InternalContext =
+            (QUIC_DATAPATH_RECV_DATAGRAM_CONTEXT*)(Datagram + 1);
+        InternalContext->OwningPool = &Datapath->DatagramPool;
+        InternalContext->Tuple.RemoteAddress = SourceAddress;
+        InternalContext->Tuple.LocalAddress = *RemoteAddress;
+
+        QuicZeroMemory(Datagram, sizeof(QUIC_RECV_DATAGRAM));
+        Datagram->Tuple = &InternalContext->Tuple;
+        Datagram->Buffer = SendContext->Buffers[i].Buffer;
+        Datagram->BufferLength = SendContext->Buffers[i].Length;
+        Datagram->PartitionIndex = PartitionIndex;
+        Datagram->RecvTime = RecvTime;
+        Datagram->TypeOfService = SendContext->ECN;
+        Datagram->Allocated = TRUE;
+        Datagram->CryptoOffloaded = FALSE;
+        QuicZeroMemory(
+            QuicDataPathRecvDatagramToRecvPacket(Datagram),
+            Datapath->ClientRecvContextLength);
+
+        QuicTraceEvent(
+            DatapathRecv,
+            "[ udp][%p] Recv %u bytes (segment=%hu) Src=%!SOCKADDR! Dst=%!SOCKADDR!",
+            Destination,
+            Datagram->BufferLength,
+            (uint16_t)Datagram->BufferLength,
+            LOG_ADDR_LEN(InternalContext->Tuple.LocalAddress),
+            LOG_ADDR_LEN(InternalContext->Tuple.RemoteAddress),
+            (uint8_t*)&InternalContext->Tuple.LocalAddress,
+            (uint8_t*)&InternalContext->Tuple.RemoteAddress);
+
+        *DatagramChainTail = Datagram;
+        DatagramChainTail = &Datagram->Next;
+    }
+
+    //
+    // The datagrams are now owned by the receiver.
+    //
+    SendContext->BufferCount = 0;
+    QuicPoolFree(&Datapath->SendContextPool, SendContext);
+
+    if (DatagramChain != NULL) {
+        Datapath->RecvHandler(Destination, Destination->ClientContext, DatagramChain);
+    }
+
+    QuicRundownRelease(&Destination->Rundown);
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+QUIC_STATUS
+QuicDataPathBindingSendTo(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ const QUIC_ADDR * RemoteAddress,
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
+    )
+{
+    return
+        QuicDataPathBindingSendFromTo(
+            Binding,
+            &Binding->LocalAddress,
+            RemoteAddress,
+            SendContext);
+}
+
+QUIC_STATUS
+QuicDataPathBindingSendBatch(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ uint32_t EntryCount,
+    _In_reads_(EntryCount) const QUIC_DATAPATH_SEND_ENTRY* Entries
+    )
+{
+    //
+    // Each send context is indicated to its destination binding on its own.
+    //
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    for (uint32_t i = 0; i < EntryCount; ++i) {
+        QUIC_STATUS EntryStatus =
+            Entries[i].LocalAddress == NULL ?
+                QuicDataPathBindingSendTo(
+                    Binding,
+                    Entries[i].RemoteAddress,
+                    Entries[i].SendContext) :
+                QuicDataPathBindingSendFromTo(
+                    Binding,
+                    Entries[i].LocalAddress,
+                    Entries[i].RemoteAddress,
+                    Entries[i].SendContext);
+        if (QUIC_FAILED(EntryStatus)) {
+            Status = EntryStatus;
+        }
+    }
+    return Status;
+}
+
+QUIC_STATUS
+QuicDataPathBindingSetParam(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ uint32_t Param,
+    _In_ uint32_t BufferLength,
+    _In_reads_bytes_(BufferLength) const uint8_t * Buffer
+    )
+{
+    UNREFERENCED_PARAMETER(Binding);
+    UNREFERENCED_PARAMETER(Param);
+    UNREFERENCED_PARAMETER(BufferLength);
+    UNREFERENCED_PARAMETER(Buffer);
+    return QUIC_STATUS_NOT_SUPPORTED;
+}
+
+QUIC_STATUS
+QuicDataPathBindingGetParam(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ uint32_t Param,
+    _Inout_ uint32_t* BufferLength,
+    _Out_writes_bytes_opt_(*BufferLength) uint8_t * Buffer
+    )
+{
+    UNREFERENCED_PARAMETER(Binding);
+    UNREFERENCED_PARAMETER(Param);
+    UNREFERENCED_PARAMETER(BufferLength);
+    UNREFERENCED_PARAMETER(Buffer);
+    return QUIC_STATUS_NOT_SUPPORTED;
+}
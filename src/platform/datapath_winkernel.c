@@ -23,6 +23,22 @@ Abstract:
 #define UDP_COALESCED_INFO          3
 #endif
 
+//
+// Only available in newer WDKs.
+//
+#ifndef IP_ECN
+#define IP_ECN                      50
+#endif
+#ifndef IPV6_ECN
+#define IPV6_ECN                    50
+#endif
+#ifndef IP_RECVECN
+#define IP_RECVECN                  50
+#endif
+#ifndef IPV6_RECVECN
+#define IPV6_RECVECN                50
+#endif
+
 typedef enum {
     ICMP4_ECHO_REPLY        =  0, // Echo Reply.
     ICMP4_DST_UNREACH       =  3, // Destination Unreachable.
@@ -84,6 +100,12 @@ typedef enum {
 //
 #define QUIC_MAX_BATCH_SEND                 6
 
+//
+// The maximum number of UDP datagrams, from any number of send contexts, that
+// QuicDataPathBindingSendBatch chains into one WskSendMessages call.
+//
+#define QUIC_MAX_MULTI_SEND                 32
+
 //
 // The maximum number of UDP datagrams to preallocate for URO.
 //
@@ -216,6 +238,11 @@ typedef struct QUIC_DATAPATH_SEND_CONTEXT {
     //
     UINT8 WskBufferCount;
 
+    //
+    // The ECN codepoint to mark the datagrams with.
+    //
+    UINT8 ECN;
+
     //
     // The send segmentation size; zero if segmentation is not performed.
     //
@@ -226,6 +253,12 @@ typedef struct QUIC_DATAPATH_SEND_CONTEXT {
     //
     QUIC_BUFFER ClientBuffer;
 
+    //
+    // The send contexts whose buffers were chained onto this one's, to be sent
+    // with its IRP. They're freed with this one.
+    //
+    struct QUIC_DATAPATH_SEND_CONTEXT* Chained;
+
 } QUIC_DATAPATH_SEND_CONTEXT;
 
 //
@@ -987,6 +1020,82 @@ QuicDataPathIsPaddingPreferred(
     return !!(Datapath->Features & QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION);
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicDataPathSetBusyPoll(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t BusyPollUs
+    )
+{
+    //
+    // Receives are completion based here, so there is nothing to poll.
+    //
+    UNREFERENCED_PARAMETER(Datapath);
+    UNREFERENCED_PARAMETER(BusyPollUs);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathSetPollCallback(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index,
+    _In_opt_ QUIC_DATAPATH_POLL_CALLBACK_HANDLER PollCallback,
+    _In_opt_ void* PollContext
+    )
+{
+    //
+    // Receives complete on system threads here, so there is no datapath
+    // thread to run the work on.
+    //
+    UNREFERENCED_PARAMETER(Datapath);
+    UNREFERENCED_PARAMETER(Index);
+    UNREFERENCED_PARAMETER(PollCallback);
+    UNREFERENCED_PARAMETER(PollContext);
+    return QUIC_STATUS_NOT_SUPPORTED;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDataPathWakeProcessor(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index
+    )
+{
+    UNREFERENCED_PARAMETER(Datapath);
+    UNREFERENCED_PARAMETER(Index);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathSetCidSteering(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_opt_ const QUIC_DATAPATH_CID_STEERING* Steering
+    )
+{
+    //
+    // Receive side scaling decides the processor here; there is no per-socket
+    // steering hook to program.
+    //
+    UNREFERENCED_PARAMETER(Datapath);
+    return Steering == NULL ? QUIC_STATUS_SUCCESS : QUIC_STATUS_NOT_SUPPORTED;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathBindingSetCryptoOffload(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_opt_ const QUIC_DATAPATH_CRYPTO_OFFLOAD* Offload
+    )
+{
+    //
+    // No inline crypto offload (QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD).
+    //
+    UNREFERENCED_PARAMETER(Binding);
+    UNREFERENCED_PARAMETER(RemoteAddress);
+    return Offload == NULL ? QUIC_STATUS_SUCCESS : QUIC_STATUS_NOT_SUPPORTED;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicDataPathResolveAddressWithHint(
@@ -1170,6 +1279,260 @@ Error:
     return Status;
 }
 
+//
+// An outstanding WskGetAddressInfo request. The IRP can complete at
+// DISPATCH_LEVEL, so the callback is deferred to a work item. The work item
+// and the host name buffer follow the structure in the same allocation.
+//
+typedef struct QUIC_DATAPATH_RESOLVE_REQUEST {
+
+    PIRP Irp;
+    PIO_WORKITEM WorkItem;
+    PADDRINFOEXW Result;
+    QUIC_DATAPATH* Datapath;
+    QUIC_DATAPATH_RESOLVE_CALLBACK_HANDLER Callback;
+    void* Context;
+    ADDRINFOEXW Hints;
+    UNICODE_STRING HostName;
+
+} QUIC_DATAPATH_RESOLVE_REQUEST;
+
+//
+// Keeps the first address of each family from the resolver's results.
+//
+void
+QuicDataPathPopulateResolution(
+    _In_opt_ PADDRINFOEXW Ai,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+    uint32_t Count = 0;
+    RtlZeroMemory(Resolution, sizeof(QUIC_DATAPATH_RESOLUTION));
+
+    for (; Ai != NULL && Count < ARRAYSIZE(Resolution->Addresses); Ai = Ai->ai_next) {
+        if (Ai->ai_addr->sa_family != AF_INET &&
+            Ai->ai_addr->sa_family != AF_INET6) {
+            continue;
+        }
+        if (Count == 0 ||
+            Ai->ai_addr->sa_family != Resolution->Addresses[0].si_family) {
+            memcpy(&Resolution->Addresses[Count++], Ai->ai_addr, Ai->ai_addrlen);
+        }
+    }
+}
+
+void
+QuicDataPathResolveRequestFree(
+    _In_ __drv_freesMem(Mem) QUIC_DATAPATH_RESOLVE_REQUEST* Request
+    )
+{
+    if (Request->Result != NULL) {
+        Request->Datapath->WskProviderNpi.Dispatch->
+            WskFreeAddressInfo(
+                Request->Datapath->WskProviderNpi.Client,
+                Request->Result);
+    }
+    if (Request->Irp != NULL) {
+        IoFreeIrp(Request->Irp);
+    }
+    IoUninitializeWorkItem(Request->WorkItem);
+    QUIC_FREE(Request);
+}
+
+IO_WORKITEM_ROUTINE_EX QuicDataPathResolveComplete;
+
+_Use_decl_annotations_
+void
+QuicDataPathResolveComplete(
+    PVOID IoObject,
+    PVOID Context,
+    PIO_WORKITEM IoWorkItem
+    )
+{
+    UNREFERENCED_PARAMETER(IoObject);
+    UNREFERENCED_PARAMETER(IoWorkItem);
+    QUIC_DATAPATH_RESOLVE_REQUEST* Request =
+        (QUIC_DATAPATH_RESOLVE_REQUEST*)Context;
+    QUIC_DATAPATH_RESOLUTION Resolution;
+    QUIC_STATUS Status = Request->Irp->IoStatus.Status;
+
+    if (NT_SUCCESS(Status) && Request->Result != NULL) {
+        QuicDataPathPopulateResolution(Request->Result, &Resolution);
+        Status = QUIC_STATUS_SUCCESS;
+    } else {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "Resolving hostname to IP");
+        RtlZeroMemory(&Resolution, sizeof(Resolution));
+        Status = STATUS_NOT_FOUND;
+    }
+
+    Request->Callback(Request->Context, Status, &Resolution);
+    QuicDataPathResolveRequestFree(Request);
+}
+
+IO_COMPLETION_ROUTINE QuicDataPathResolveIoCompletion;
+
+_Use_decl_annotations_
+QUIC_STATUS
+QuicDataPathResolveIoCompletion(
+    PDEVICE_OBJECT DeviceObject,
+    PIRP Irp,
+    void* Context
+    )
+{
+    UNREFERENCED_PARAMETER(DeviceObject);
+    UNREFERENCED_PARAMETER(Irp);
+    QUIC_DATAPATH_RESOLVE_REQUEST* Request =
+        (QUIC_DATAPATH_RESOLVE_REQUEST*)Context;
+    NT_ASSERT(Request);
+
+    //
+    // The resolve callback must be called at PASSIVE_LEVEL.
+    //
+    IoQueueWorkItemEx(
+        Request->WorkItem,
+        QuicDataPathResolveComplete,
+        DelayedWorkQueue,
+        Request);
+
+    //
+    // The IRP is freed with the request.
+    //
+    return STATUS_MORE_PROCESSING_REQUIRED;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathResolveAddressAsync(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_z_ const char* HostName,
+    _In_ QUIC_DATAPATH_RESOLVE_CALLBACK_HANDLER Callback,
+    _In_opt_ void* Context,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+    QUIC_STATUS Status;
+    ADDRINFOEXW Hints = { 0 };
+    PADDRINFOEXW Ai = NULL;
+
+    size_t HostNameLength = strnlen(HostName, 1024);
+    if (HostNameLength >= 1024) {
+        return QUIC_STATUS_INVALID_PARAMETER;
+    }
+
+    const ULONG WorkItemSize = IoSizeofWorkItem();
+    const size_t RequestSize =
+        sizeof(QUIC_DATAPATH_RESOLVE_REQUEST) + WorkItemSize +
+        sizeof(WCHAR) * HostNameLength;
+    QUIC_DATAPATH_RESOLVE_REQUEST* Request = QUIC_ALLOC_NONPAGED(RequestSize);
+    if (Request == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_DATAPATH_RESOLVE_REQUEST",
+            RequestSize);
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    RtlZeroMemory(Request, sizeof(QUIC_DATAPATH_RESOLVE_REQUEST));
+    Request->WorkItem = (PIO_WORKITEM)(Request + 1);
+    IoInitializeWorkItem(QuicPlatform.DriverObject, Request->WorkItem);
+    Request->Datapath = Datapath;
+    Request->Callback = Callback;
+    Request->Context = Context;
+    Request->HostName.MaximumLength = (USHORT)(sizeof(WCHAR) * HostNameLength);
+    Request->HostName.Buffer = (PWCH)((uint8_t*)Request->WorkItem + WorkItemSize);
+
+    ULONG UniHostNameLength = 0;
+    Status =
+        RtlUTF8ToUnicodeN(
+            Request->HostName.Buffer,
+            Request->HostName.MaximumLength,
+            &UniHostNameLength,
+            HostName,
+            (ULONG)HostNameLength);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "Convert hostname to unicode");
+        goto Error;
+    }
+    Request->HostName.Length = (USHORT)UniHostNameLength;
+
+    //
+    // Numeric names don't need the resolver, so complete those inline.
+    //
+    Hints.ai_family = AF_UNSPEC;
+    Hints.ai_flags = AI_NUMERICHOST;
+    Status =
+        QuicDataPathResolveAddressWithHint(
+            Datapath,
+            &Request->HostName,
+            &Hints,
+            &Ai);
+    if (NT_SUCCESS(Status)) {
+        QuicDataPathPopulateResolution(Ai, Resolution);
+        Datapath->WskProviderNpi.Dispatch->
+            WskFreeAddressInfo(
+                Datapath->WskProviderNpi.Client,
+                Ai);
+        goto Error;
+    }
+
+    Request->Irp = IoAllocateIrp(1, FALSE);
+    if (Request->Irp == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "resolve IRP",
+            0);
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Error;
+    }
+
+    IoSetCompletionRoutine(
+        Request->Irp,
+        QuicDataPathResolveIoCompletion,
+        Request,
+        TRUE,
+        TRUE,
+        TRUE);
+
+    //
+    // WSK always completes the IRP, even if the call returns a failure
+    // without pending, so the completion routine owns the request from here.
+    // The hints and host name live in the request, since they must stay
+    // valid until then.
+    //
+    Request->Hints.ai_family = AF_UNSPEC;
+    Request->Hints.ai_flags = AI_CANONNAME;
+    (void)Datapath->WskProviderNpi.Dispatch->
+        WskGetAddressInfo(
+            Datapath->WskProviderNpi.Client,
+            &Request->HostName,
+            NULL,                           // No service
+            NS_ALL,                         // namespace
+            NULL,                           // No specific provider
+            &Request->Hints,                // Hints
+            &Request->Result,
+            NULL,                           // Process (none)
+            NULL,                           // Thread (none)
+            Request->Irp);
+
+    return QUIC_STATUS_PENDING;
+
+Error:
+
+    QuicDataPathResolveRequestFree(Request);
+
+    return Status;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 _Must_inspect_result_
 NTSTATUS
@@ -1549,6 +1912,47 @@ QuicDataPathBindingCreate(
         goto Error;
     }
 
+    //
+    // Receive the ECN codepoints too. Older versions of Windows don't support
+    // this, in which case the peer's ECN marks are never seen and its ECN
+    // validation fails.
+    //
+    Option = TRUE;
+    Status =
+        QuicDataPathSetControlSocket(
+            SocketContext,
+            WskSetOption,
+            IPV6_RECVECN,
+            IPPROTO_IPV6,
+            sizeof(Option),
+            &Option);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            Binding,
+            Status,
+            "Set IPV6_RECVECN");
+    }
+
+    Option = TRUE;
+    Status =
+        QuicDataPathSetControlSocket(
+            SocketContext,
+            WskSetOption,
+            IP_RECVECN,
+            IPPROTO_IP,
+            sizeof(Option),
+            &Option);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            Binding,
+            Status,
+            "Set IP_RECVECN");
+    }
+
     Option = TRUE;
     Status =
         QuicDataPathSetControlSocket(
@@ -1931,6 +2335,8 @@ QuicDataPathSocketReceive(
         SOCKADDR_INET LocalAddr = { 0 };
         SOCKADDR_INET RemoteAddr;
         UINT16 MessageLength = 0;
+        UINT8 TypeOfService = 0;
+        UINT64 RecvTime = QuicTimeUs64();
 
         //
         // Parse the ancillary data for all the per datagram information that we
@@ -1954,6 +2360,9 @@ QuicDataPathSocketReceive(
                     LocalAddr.Ipv6.sin6_scope_id = PktInfo6->ipi6_ifindex;
                     FoundLocalAddr = TRUE;
 
+                } else if (CMsg->cmsg_type == IPV6_ECN) {
+                    TypeOfService = (UINT8)*(PINT)WSA_CMSG_DATA(CMsg);
+
                 } else if (CMsg->cmsg_type == IPV6_RECVERR) {
                     IN_RECVERR* RecvErr = (IN_RECVERR*)WSA_CMSG_DATA(CMsg);
                     if (RecvErr->type == ICMP6_DST_UNREACH) {
@@ -1970,6 +2379,9 @@ QuicDataPathSocketReceive(
                     LocalAddr.Ipv6.sin6_scope_id = PktInfo->ipi_ifindex;
                     FoundLocalAddr = TRUE;
 
+                } else if (CMsg->cmsg_type == IP_ECN) {
+                    TypeOfService = (UINT8)*(PINT)WSA_CMSG_DATA(CMsg);
+
                 } else if (CMsg->cmsg_type == IP_RECVERR) {
                     IN_RECVERR* RecvErr = (IN_RECVERR*)WSA_CMSG_DATA(CMsg);
                     if (RecvErr->type == ICMP4_DST_UNREACH) {
@@ -2121,8 +2533,11 @@ QuicDataPathSocketReceive(
             QUIC_DBG_ASSERT(Datagram != NULL);
             Datagram->Next = NULL;
             Datagram->PartitionIndex = (uint8_t)QuicProcCurrentNumber();
+            Datagram->RecvTime = RecvTime;
+            Datagram->TypeOfService = TypeOfService;
             Datagram->Allocated = TRUE;
             Datagram->QueuedOnConnection = FALSE;
+            Datagram->CryptoOffloaded = FALSE;
 
             InternalDatagramContext =
                 QuicDataPathDatagramToInternalDatagramContext(Datagram);
@@ -2283,6 +2698,7 @@ _Success_(return != NULL)
 QUIC_DATAPATH_SEND_CONTEXT*
 QuicDataPathBindingAllocSendContext(
     _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ QUIC_ECN_TYPE ECN,
     _In_ UINT16 MaxPacketSize
     )
 {
@@ -2300,11 +2716,13 @@ QuicDataPathBindingAllocSendContext(
         SendContext->TailBuf = NULL;
         SendContext->TotalSize = 0;
         SendContext->WskBufferCount = 0;
+        SendContext->ECN = (UINT8)ECN;
         SendContext->SegmentSize =
             (Binding->Datapath->Features & QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION)
                 ? MaxPacketSize : 0;
         SendContext->ClientBuffer.Length = 0;
         SendContext->ClientBuffer.Buffer = NULL;
+        SendContext->Chained = NULL;
     }
 
     return SendContext;
@@ -2333,6 +2751,16 @@ QuicDataPathBindingFreeSendContext(
         QuicPoolFree(BufferPool, SendBuffer);
     }
 
+    //
+    // The chained send contexts no longer own any buffers.
+    //
+    while (SendContext->Chained != NULL) {
+        QUIC_DATAPATH_SEND_CONTEXT* Chained = SendContext->Chained;
+        SendContext->Chained = Chained->Chained;
+        QUIC_DBG_ASSERT(Chained->WskBufs == NULL);
+        QuicPoolFree(&Chained->Owner->SendContextPool, Chained);
+    }
+
     QuicPoolFree(&ProcContext->SendContextPool, SendContext);
 }
 
@@ -2636,6 +3064,43 @@ QuicDataPathBindingIsSendContextFull(
     return !QuicSendContextCanAllocSend(SendContext, SendContext->SegmentSize);
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDataPathBindingSetSendTxTime(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ uint64_t TxTime
+    )
+{
+    //
+    // Departure times aren't supported (QUIC_DATAPATH_FEATURE_SEND_TXTIME).
+    //
+    UNREFERENCED_PARAMETER(SendContext);
+    UNREFERENCED_PARAMETER(TxTime);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDataPathBindingSetCryptoOffloadPacket(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ QUIC_BUFFER* Datagram,
+    _In_ uint16_t PacketOffset,
+    _In_ uint16_t PacketLength,
+    _In_ uint16_t HeaderLength,
+    _In_ uint64_t PacketNumber
+    )
+{
+    //
+    // Never called, as QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD isn't supported.
+    //
+    QUIC_DBG_ASSERT(FALSE);
+    UNREFERENCED_PARAMETER(SendContext);
+    UNREFERENCED_PARAMETER(Datagram);
+    UNREFERENCED_PARAMETER(PacketOffset);
+    UNREFERENCED_PARAMETER(PacketLength);
+    UNREFERENCED_PARAMETER(HeaderLength);
+    UNREFERENCED_PARAMETER(PacketNumber);
+}
+
 IO_COMPLETION_ROUTINE QuicDataPathSendComplete;
 
 _Use_decl_annotations_
@@ -2728,7 +3193,7 @@ QuicDataPathBindingSendTo(
         SendContext->SegmentSize,
         LOG_ADDR_LEN(*RemoteAddress), (UINT8*)RemoteAddress);
 
-    BYTE CMsgBuffer[WSA_CMSG_SPACE(sizeof(*SegmentSize))];
+    BYTE CMsgBuffer[WSA_CMSG_SPACE(sizeof(*SegmentSize)) + WSA_CMSG_SPACE(sizeof(INT))];
     PWSACMSGHDR CMsg = NULL;
     ULONG CMsgLen = 0;
 
@@ -2744,6 +3209,18 @@ QuicDataPathBindingSendTo(
         *SegmentSize = SendContext->SegmentSize;
     }
 
+    if (SendContext->ECN != QUIC_ECN_NON_ECT) {
+        CMsg = (PWSACMSGHDR)&CMsgBuffer[CMsgLen];
+        CMsgLen += WSA_CMSG_SPACE(sizeof(INT));
+
+        CMsg->cmsg_level =
+            RemoteAddress->si_family == AF_INET ? IPPROTO_IP : IPPROTO_IPV6;
+        CMsg->cmsg_type =
+            RemoteAddress->si_family == AF_INET ? IP_ECN : IPV6_ECN;
+        CMsg->cmsg_len = WSA_CMSG_LEN(sizeof(INT));
+        *(PINT)WSA_CMSG_DATA(CMsg) = SendContext->ECN;
+    }
+
     InterlockedIncrement(&Binding->SendOutstanding);
 
     PWSK_PROVIDER_DATAGRAM_DISPATCH Dispatch =
@@ -2756,7 +3233,7 @@ QuicDataPathBindingSendTo(
             0,
             NULL,
             CMsgLen,
-            CMsg,
+            CMsgLen == 0 ? NULL : (PWSACMSGHDR)CMsgBuffer,
             &SendContext->Irp);
 
     if (QUIC_FAILED(Status)) {
@@ -2834,7 +3311,10 @@ QuicDataPathBindingSendFromTo(
     //
     // Build up message header to indicate local address to send from.
     //
-    BYTE CMsgBuffer[WSA_CMSG_SPACE(sizeof(IN6_PKTINFO)) + WSA_CMSG_SPACE(sizeof(*SegmentSize))];
+    BYTE CMsgBuffer[
+        WSA_CMSG_SPACE(sizeof(IN6_PKTINFO)) +
+        WSA_CMSG_SPACE(sizeof(*SegmentSize)) +
+        WSA_CMSG_SPACE(sizeof(INT))];
     PWSACMSGHDR CMsg = (PWSACMSGHDR)CMsgBuffer;
     ULONG CMsgLen;
 
@@ -2873,6 +3353,18 @@ QuicDataPathBindingSendFromTo(
         *SegmentSize = SendContext->SegmentSize;
     }
 
+    if (SendContext->ECN != QUIC_ECN_NON_ECT) {
+        CMsg = (PWSACMSGHDR)&CMsgBuffer[CMsgLen];
+        CMsgLen += WSA_CMSG_SPACE(sizeof(INT));
+
+        CMsg->cmsg_level =
+            RemoteAddress->si_family == AF_INET ? IPPROTO_IP : IPPROTO_IPV6;
+        CMsg->cmsg_type =
+            RemoteAddress->si_family == AF_INET ? IP_ECN : IPV6_ECN;
+        CMsg->cmsg_len = WSA_CMSG_LEN(sizeof(INT));
+        *(PINT)WSA_CMSG_DATA(CMsg) = SendContext->ECN;
+    }
+
     InterlockedIncrement(&Binding->SendOutstanding);
 
     PWSK_PROVIDER_DATAGRAM_DISPATCH Dispatch =
@@ -2912,6 +3404,108 @@ Exit:
     return Status;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+static
+BOOLEAN
+QuicSendContextCanChain(
+    _In_ const QUIC_DATAPATH_SEND_ENTRY* Head,
+    _In_ const QUIC_DATAPATH_SEND_ENTRY* Entry
+    )
+{
+    //
+    // Only unsegmented sends can be chained, since each of their buffers is
+    // sent as its own datagram, with the same control data.
+    //
+    const QUIC_DATAPATH_SEND_CONTEXT* HeadContext = Head->SendContext;
+    const QUIC_DATAPATH_SEND_CONTEXT* SendContext = Entry->SendContext;
+    return
+        HeadContext->SegmentSize == 0 &&
+        SendContext->SegmentSize == 0 &&
+        HeadContext->WskBufferCount > 0 &&
+        SendContext->WskBufferCount > 0 &&
+        HeadContext->WskBufferCount + SendContext->WskBufferCount <= QUIC_MAX_MULTI_SEND &&
+        HeadContext->ECN == SendContext->ECN &&
+        QuicAddrCompare(Head->RemoteAddress, Entry->RemoteAddress) &&
+        (Head->LocalAddress == NULL ?
+            Entry->LocalAddress == NULL :
+            Entry->LocalAddress != NULL &&
+                QuicAddrCompare(Head->LocalAddress, Entry->LocalAddress));
+}
+
+//
+// Moves the buffers of SendContext to the end of Head's list, to be sent with
+// Head's IRP, and chains SendContext to Head to be freed with it. Head's
+// TailBuf is left on its own last buffer, which is finalized when Head is
+// sent.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+static
+void
+QuicSendContextChain(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* Head,
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
+    )
+{
+    QuicSendContextFinalizeSendBuffer(SendContext);
+
+    PWSK_BUF_LIST Tail = &Head->TailBuf->Link;
+    while (Tail->Next != NULL) {
+        Tail = Tail->Next;
+    }
+    Tail->Next = SendContext->WskBufs;
+    Head->WskBufferCount += SendContext->WskBufferCount;
+    Head->TotalSize += SendContext->TotalSize;
+
+    SendContext->WskBufs = NULL;
+    SendContext->TailBuf = NULL;
+    SendContext->WskBufferCount = 0;
+    SendContext->Chained = Head->Chained;
+    Head->Chained = SendContext;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicDataPathBindingSendBatch(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ uint32_t EntryCount,
+    _In_reads_(EntryCount) const QUIC_DATAPATH_SEND_ENTRY* Entries
+    )
+{
+    //
+    // WSK can't send to several remote hosts in one call, but runs of entries
+    // with the same addresses (e.g. the ACKs of several connections to the
+    // same peer) are chained into one WskSendMessages call and IRP.
+    //
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    uint32_t i = 0;
+    while (i < EntryCount) {
+        QUIC_DATAPATH_SEND_CONTEXT* SendContext = Entries[i].SendContext;
+        uint32_t j = i + 1;
+        while (j < EntryCount &&
+            QuicSendContextCanChain(&Entries[i], &Entries[j])) {
+            QuicSendContextChain(SendContext, Entries[j].SendContext);
+            ++j;
+        }
+
+        QUIC_STATUS EntryStatus =
+            Entries[i].LocalAddress == NULL ?
+                QuicDataPathBindingSendTo(
+                    Binding,
+                    Entries[i].RemoteAddress,
+                    SendContext) :
+                QuicDataPathBindingSendFromTo(
+                    Binding,
+                    Entries[i].LocalAddress,
+                    Entries[i].RemoteAddress,
+                    SendContext);
+        if (QUIC_FAILED(EntryStatus)) {
+            Status = EntryStatus;
+        }
+        i = j;
+    }
+    return Status;
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicDataPathBindingSetParam(
@@ -55,6 +55,22 @@ QuicFuzzerRecvMsg(
 #define UDP_COALESCED_INFO          3
 #endif
 
+//
+// Only available in newer SDKs.
+//
+#ifndef IP_ECN
+#define IP_ECN                      50
+#endif
+#ifndef IPV6_ECN
+#define IPV6_ECN                    50
+#endif
+#ifndef IP_RECVECN
+#define IP_RECVECN                  50
+#endif
+#ifndef IPV6_RECVECN
+#define IPV6_RECVECN                50
+#endif
+
 //
 // The maximum number of UDP datagrams that can be sent with one call.
 //
@@ -75,6 +91,35 @@ QuicFuzzerRecvMsg(
 //
 #define URO_MAX_DATAGRAMS_PER_INDICATION    64
 
+#ifdef QUIC_WINDOWS_RIO
+//
+// The number of receives kept posted on each registered I/O socket.
+//
+#define QUIC_RIO_RECV_DEPTH                 64
+
+//
+// The maximum number of datagrams being sent on each registered I/O socket.
+//
+#define QUIC_RIO_SEND_DEPTH                 256
+
+//
+// The maximum number of bindings using registered I/O. Each one has a request
+// queue on every processor, and the per-processor completion queues are sized
+// for this many. Any further bindings use regular socket I/O.
+//
+#define QUIC_RIO_MAX_BINDINGS               16
+
+//
+// The number of buffers registered at once when a registered pool grows.
+//
+#define QUIC_RIO_BUFFER_CHUNK_COUNT         256
+
+//
+// The maximum number of completions dequeued at once.
+//
+#define QUIC_RIO_DEQUEUE_COUNT              64
+#endif
+
 static_assert(
     sizeof(QUIC_BUFFER) == sizeof(WSABUF),
     "WSABUF is assumed to be interchangeable for QUIC_BUFFER");
@@ -96,6 +141,74 @@ static_assert(
 typedef struct QUIC_UDP_SOCKET_CONTEXT QUIC_UDP_SOCKET_CONTEXT;
 typedef struct QUIC_DATAPATH_PROC_CONTEXT QUIC_DATAPATH_PROC_CONTEXT;
 
+#ifdef QUIC_WINDOWS_RIO
+typedef struct QUIC_RIO_BUFFER_POOL QUIC_RIO_BUFFER_POOL;
+
+//
+// Header in front of each buffer handed out by a registered buffer pool.
+//
+typedef struct DECLSPEC_ALIGN(MEMORY_ALLOCATION_ALIGNMENT) QUIC_RIO_BUFFER {
+
+    //
+    // Link in the pool's free list.
+    //
+    SLIST_ENTRY Link;
+
+    //
+    // The owning pool.
+    //
+    QUIC_RIO_BUFFER_POOL* Pool;
+
+    //
+    // The registration the buffer belongs to, and the offset of the buffer's
+    // data (following this header) within it.
+    //
+    RIO_BUFFERID BufferId;
+    ULONG Offset;
+
+} QUIC_RIO_BUFFER;
+
+//
+// A contiguous, registered allocation carved up into a pool's buffers.
+//
+typedef struct QUIC_RIO_BUFFER_CHUNK {
+
+    struct QUIC_RIO_BUFFER_CHUNK* Next;
+    RIO_BUFFERID BufferId;
+
+} QUIC_RIO_BUFFER_CHUNK;
+
+//
+// Pool of fixed size buffers registered with registered I/O. Registration is
+// done once per chunk as the pool grows, never per I/O. Buffers are only
+// returned to the system when the pool is uninitialized.
+//
+typedef struct QUIC_RIO_BUFFER_POOL {
+
+    //
+    // Buffers available for allocation.
+    //
+    SLIST_HEADER FreeList;
+
+    //
+    // The size of each buffer, and the distance between buffer headers.
+    //
+    uint32_t Size;
+    uint32_t Stride;
+
+    //
+    // Serializes growing the pool.
+    //
+    QUIC_LOCK Lock;
+
+    //
+    // All the chunks allocated for the pool.
+    //
+    QUIC_RIO_BUFFER_CHUNK* Chunks;
+
+} QUIC_RIO_BUFFER_POOL;
+#endif
+
 //
 // Internal receive context.
 //
@@ -116,6 +229,26 @@ typedef struct QUIC_DATAPATH_INTERNAL_RECV_CONTEXT {
     //
     QUIC_TUPLE Tuple;
 
+#ifdef QUIC_WINDOWS_RIO
+    //
+    // Set if the context came from a registered buffer pool instead of
+    // OwningPool.
+    //
+    BOOLEAN RioRegistered;
+
+    //
+    // The ancillary data for a registered I/O receive. Unlike the socket path,
+    // where it lives in the socket context, each posted receive needs its own.
+    //
+    union {
+        RIO_CMSG_BUFFER Header;
+        char Buffer[
+            RIO_CMSG_BASE_SIZE +
+            WSA_CMSG_SPACE(sizeof(IN6_PKTINFO)) +
+            WSA_CMSG_SPACE(sizeof(INT))];
+    } RioControl;
+#endif
+
 } QUIC_DATAPATH_INTERNAL_RECV_CONTEXT;
 
 //
@@ -160,6 +293,11 @@ typedef struct QUIC_DATAPATH_SEND_CONTEXT {
     //
     UINT8 WsaBufferCount;
 
+    //
+    // The ECN codepoint to mark the datagrams with.
+    //
+    UINT8 ECN;
+
     //
     // Contains all the datagram buffers to pass to the socket.
     //
@@ -170,6 +308,33 @@ typedef struct QUIC_DATAPATH_SEND_CONTEXT {
     //
     WSABUF ClientBuffer;
 
+#ifdef QUIC_WINDOWS_RIO
+    //
+    // Set if the context and its buffers came from the registered buffer
+    // pools, for a binding using registered I/O.
+    //
+    BOOLEAN Rio;
+
+    //
+    // The number of datagrams still being sent, plus one while they are being
+    // posted.
+    //
+    long RioPending;
+
+    //
+    // The destination and ancillary data for a registered I/O send. They must
+    // be in registered memory, so they live in the (registered) context.
+    //
+    SOCKADDR_INET RioRemoteAddress;
+    union {
+        RIO_CMSG_BUFFER Header;
+        char Buffer[
+            RIO_CMSG_BASE_SIZE +
+            WSA_CMSG_SPACE(sizeof(IN6_PKTINFO)) +
+            WSA_CMSG_SPACE(sizeof(INT))];
+    } RioControl;
+#endif
+
 } QUIC_DATAPATH_SEND_CONTEXT;
 
 //
@@ -200,11 +365,33 @@ typedef struct QUIC_UDP_SOCKET_CONTEXT {
     WSABUF RecvWsaBuf;
     char RecvWsaMsgControlBuf[
         WSA_CMSG_SPACE(sizeof(IN6_PKTINFO)) +
-        WSA_CMSG_SPACE(sizeof(DWORD))];
+        WSA_CMSG_SPACE(sizeof(DWORD)) +
+        WSA_CMSG_SPACE(sizeof(INT))];
     WSAMSG RecvWsaMsgHdr;
     QUIC_DATAPATH_INTERNAL_RECV_CONTEXT* CurrentRecvContext;
     OVERLAPPED RecvOverlapped;
 
+#ifdef QUIC_WINDOWS_RIO
+    //
+    // The registered I/O request queue, if the binding uses registered I/O.
+    // Its receives are posted by the processor's completion thread, but sends
+    // come from any thread, so all use of it is serialized by RioLock.
+    //
+    RIO_RQ RioRq;
+    QUIC_LOCK RioLock;
+
+    //
+    // The number of receives and send datagrams posted to the request queue
+    // and not yet completed. Clean up waits for them to drain.
+    //
+    long RioOutstanding;
+
+    //
+    // Set once the socket context has been told to clean up.
+    //
+    BOOLEAN RioShutdown;
+#endif
+
 } QUIC_UDP_SOCKET_CONTEXT;
 
 //
@@ -217,6 +404,13 @@ typedef struct QUIC_DATAPATH_BINDING {
     //
     BOOLEAN Connected : 1;
 
+#ifdef QUIC_WINDOWS_RIO
+    //
+    // Flag indicates the binding's sockets use registered I/O.
+    //
+    BOOLEAN Rio : 1;
+#endif
+
     //
     // The index of the affinitized receive processor for a connected socket.
     //
@@ -312,6 +506,25 @@ typedef struct QUIC_DATAPATH_PROC_CONTEXT {
     //
     QUIC_POOL RecvDatagramPool;
 
+#ifdef QUIC_WINDOWS_RIO
+    //
+    // Registered I/O completion queues for all the request queues on this
+    // core. They notify the IOCP above when they have completions to dequeue.
+    //
+    RIO_CQ RioRecvCq;
+    RIO_CQ RioSendCq;
+    OVERLAPPED RioRecvOverlapped;
+    OVERLAPPED RioSendOverlapped;
+
+    //
+    // Registered pools of receive contexts and buffers, send contexts and
+    // send buffers, for bindings using registered I/O on this core.
+    //
+    QUIC_RIO_BUFFER_POOL RioRecvPool;
+    QUIC_RIO_BUFFER_POOL RioSendContextPool;
+    QUIC_RIO_BUFFER_POOL RioSendBufferPool;
+#endif
+
 } QUIC_DATAPATH_PROC_CONTEXT;
 
 //
@@ -344,6 +557,30 @@ typedef struct QUIC_DATAPATH {
     //
     LPFN_WSARECVMSG WSARecvMsg;
 
+#ifdef QUIC_WINDOWS_RIO
+    //
+    // Set if registered I/O is available. Unconnected bindings then use it.
+    //
+    BOOLEAN UseRio;
+
+    //
+    // The number of bindings currently using registered I/O.
+    //
+    long RioBindingCount;
+
+    //
+    // The registered I/O function table.
+    //
+    RIO_EXTENSION_FUNCTION_TABLE Rio;
+
+    //
+    // The offset of the receive payload buffer from the start of a registered
+    // receive context. Registered I/O doesn't use receive coalescing, so this
+    // only leaves room for a single datagram.
+    //
+    uint32_t RioRecvPayloadOffset;
+#endif
+
     //
     // Rundown for waiting on binding cleanup.
     //
@@ -544,6 +781,212 @@ Error:
     }
 }
 
+#ifdef QUIC_WINDOWS_RIO
+VOID
+QuicDataPathQueryRioSupport(
+    _Inout_ QUIC_DATAPATH* Datapath
+    )
+{
+    int Result;
+    DWORD BytesReturned;
+    GUID RioGuid = WSAID_MULTIPLE_RIO;
+
+    SOCKET UdpSocket =
+        WSASocketW(
+            AF_INET6,
+            SOCK_DGRAM,
+            IPPROTO_UDP,
+            NULL,
+            0,
+            WSA_FLAG_OVERLAPPED | WSA_FLAG_REGISTERED_IO);
+    if (UdpSocket == INVALID_SOCKET) {
+        int WsaError = WSAGetLastError();
+        QuicTraceLogWarning(
+            DatapathOpenRioSocketFailed,
+            "[ udp] Registered I/O helper socket failed to open, 0x%x",
+            WsaError);
+        return;
+    }
+
+    Datapath->Rio.cbSize = sizeof(Datapath->Rio);
+    Result =
+        WSAIoctl(
+            UdpSocket,
+            SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER,
+            &RioGuid,
+            sizeof(RioGuid),
+            &Datapath->Rio,
+            sizeof(Datapath->Rio),
+            &BytesReturned,
+            NULL,
+            NULL);
+    if (Result != NO_ERROR) {
+        int WsaError = WSAGetLastError();
+        QuicTraceLogWarning(
+            DatapathQueryRioFailed,
+            "[ udp] Query for registered I/O functions failed, 0x%x",
+            WsaError);
+    } else {
+        Datapath->UseRio = TRUE;
+    }
+
+    closesocket(UdpSocket);
+}
+
+void
+QuicRioBufferPoolInitialize(
+    _In_ uint32_t Size,
+    _Out_ QUIC_RIO_BUFFER_POOL* Pool
+    )
+{
+    InitializeSListHead(&Pool->FreeList);
+    Pool->Size = Size;
+    Pool->Stride =
+        (uint32_t)(sizeof(QUIC_RIO_BUFFER) + Size + MEMORY_ALLOCATION_ALIGNMENT - 1) &
+            ~(MEMORY_ALLOCATION_ALIGNMENT - 1);
+    QuicLockInitialize(&Pool->Lock);
+    Pool->Chunks = NULL;
+}
+
+void
+QuicRioBufferPoolUninitialize(
+    _In_ QUIC_DATAPATH* Datapath,
+    _Inout_ QUIC_RIO_BUFFER_POOL* Pool
+    )
+{
+    QUIC_RIO_BUFFER_CHUNK* Chunk;
+    while ((Chunk = Pool->Chunks) != NULL) {
+        Pool->Chunks = Chunk->Next;
+        Datapath->Rio.RIODeregisterBuffer(Chunk->BufferId);
+        VirtualFree(Chunk, 0, MEM_RELEASE);
+    }
+    QuicLockUninitialize(&Pool->Lock);
+}
+
+//
+// Allocates and registers another chunk of buffers, returning one of them and
+// adding the rest to the free list.
+//
+_Success_(return != NULL)
+QUIC_RIO_BUFFER*
+QuicRioBufferPoolGrow(
+    _In_ QUIC_DATAPATH* Datapath,
+    _Inout_ QUIC_RIO_BUFFER_POOL* Pool
+    )
+{
+    const uint32_t HeaderSize =
+        (uint32_t)(sizeof(QUIC_RIO_BUFFER_CHUNK) + MEMORY_ALLOCATION_ALIGNMENT - 1) &
+            ~(MEMORY_ALLOCATION_ALIGNMENT - 1);
+    const uint32_t ChunkSize =
+        HeaderSize + QUIC_RIO_BUFFER_CHUNK_COUNT * Pool->Stride;
+
+    QUIC_RIO_BUFFER_CHUNK* Chunk =
+        VirtualAlloc(NULL, ChunkSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (Chunk == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_RIO_BUFFER_CHUNK",
+            ChunkSize);
+        return NULL;
+    }
+
+    Chunk->BufferId = Datapath->Rio.RIORegisterBuffer((PCHAR)Chunk, ChunkSize);
+    if (Chunk->BufferId == RIO_INVALID_BUFFERID) {
+        int WsaError = WSAGetLastError();
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            WsaError,
+            "RIORegisterBuffer");
+        VirtualFree(Chunk, 0, MEM_RELEASE);
+        return NULL;
+    }
+
+    QUIC_RIO_BUFFER* Buffer = NULL;
+    for (uint32_t i = 0; i < QUIC_RIO_BUFFER_CHUNK_COUNT; ++i) {
+        const uint32_t Offset = HeaderSize + i * Pool->Stride;
+        Buffer = (QUIC_RIO_BUFFER*)((PUCHAR)Chunk + Offset);
+        Buffer->Pool = Pool;
+        Buffer->BufferId = Chunk->BufferId;
+        Buffer->Offset = Offset + (ULONG)sizeof(QUIC_RIO_BUFFER);
+        if (i + 1 < QUIC_RIO_BUFFER_CHUNK_COUNT) {
+            InterlockedPushEntrySList(&Pool->FreeList, &Buffer->Link);
+        }
+    }
+
+    QuicLockAcquire(&Pool->Lock);
+    Chunk->Next = Pool->Chunks;
+    Pool->Chunks = Chunk;
+    QuicLockRelease(&Pool->Lock);
+
+    return Buffer;
+}
+
+_Success_(return != NULL)
+void*
+QuicRioBufferAlloc(
+    _In_ QUIC_DATAPATH* Datapath,
+    _Inout_ QUIC_RIO_BUFFER_POOL* Pool
+    )
+{
+    QUIC_RIO_BUFFER* Buffer =
+        (QUIC_RIO_BUFFER*)InterlockedPopEntrySList(&Pool->FreeList);
+    if (Buffer == NULL) {
+        Buffer = QuicRioBufferPoolGrow(Datapath, Pool);
+        if (Buffer == NULL) {
+            return NULL;
+        }
+    }
+    return Buffer + 1;
+}
+
+void
+QuicRioBufferFree(
+    _In_ void* Data
+    )
+{
+    QUIC_RIO_BUFFER* Buffer = (QUIC_RIO_BUFFER*)Data - 1;
+    InterlockedPushEntrySList(&Buffer->Pool->FreeList, &Buffer->Link);
+}
+
+//
+// Describes Length bytes at Address, which must be within the registered
+// buffer Data, for registered I/O.
+//
+void
+QuicRioBufferDescribe(
+    _In_ const void* Data,
+    _In_ const void* Address,
+    _In_ ULONG Length,
+    _Out_ RIO_BUF* RioBuf
+    )
+{
+    const QUIC_RIO_BUFFER* Buffer = (const QUIC_RIO_BUFFER*)Data - 1;
+    RioBuf->BufferId = Buffer->BufferId;
+    RioBuf->Offset =
+        Buffer->Offset + (ULONG)((const UCHAR*)Address - (const UCHAR*)Data);
+    RioBuf->Length = Length;
+}
+
+void
+QuicDataPathProcContextUninitializeRio(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+    QUIC_DATAPATH* Datapath = ProcContext->Datapath;
+    if (ProcContext->RioRecvCq != RIO_INVALID_CQ) {
+        Datapath->Rio.RIOCloseCompletionQueue(ProcContext->RioRecvCq);
+    }
+    if (ProcContext->RioSendCq != RIO_INVALID_CQ) {
+        Datapath->Rio.RIOCloseCompletionQueue(ProcContext->RioSendCq);
+    }
+    QuicRioBufferPoolUninitialize(Datapath, &ProcContext->RioRecvPool);
+    QuicRioBufferPoolUninitialize(Datapath, &ProcContext->RioSendContextPool);
+    QuicRioBufferPoolUninitialize(Datapath, &ProcContext->RioSendBufferPool);
+}
+#endif
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicDataPathInitialize(
@@ -607,6 +1050,9 @@ QuicDataPathInitialize(
 
     QuicDataPathQueryRssScalabilityInfo(Datapath);
     QuicDataPathQuerySockoptSupport(Datapath);
+#ifdef QUIC_WINDOWS_RIO
+    QuicDataPathQueryRioSupport(Datapath);
+#endif
 
     if (Datapath->Features & QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION) {
         //
@@ -634,6 +1080,10 @@ QuicDataPathInitialize(
     Datapath->RecvPayloadOffset =
         sizeof(QUIC_DATAPATH_INTERNAL_RECV_CONTEXT) +
         MessageCount * Datapath->DatagramStride;
+#ifdef QUIC_WINDOWS_RIO
+    Datapath->RioRecvPayloadOffset =
+        sizeof(QUIC_DATAPATH_INTERNAL_RECV_CONTEXT) + Datapath->DatagramStride;
+#endif
 
     uint32_t RecvDatagramLength =
         Datapath->RecvPayloadOffset +
@@ -671,6 +1121,20 @@ QuicDataPathInitialize(
             RecvDatagramLength,
             &Datapath->ProcContexts[i].RecvDatagramPool);
 
+#ifdef QUIC_WINDOWS_RIO
+        if (Datapath->UseRio) {
+            QuicRioBufferPoolInitialize(
+                Datapath->RioRecvPayloadOffset + MAX_UDP_PAYLOAD_LENGTH,
+                &Datapath->ProcContexts[i].RioRecvPool);
+            QuicRioBufferPoolInitialize(
+                sizeof(QUIC_DATAPATH_SEND_CONTEXT),
+                &Datapath->ProcContexts[i].RioSendContextPool);
+            QuicRioBufferPoolInitialize(
+                MAX_UDP_PAYLOAD_LENGTH,
+                &Datapath->ProcContexts[i].RioSendBufferPool);
+        }
+#endif
+
         Datapath->ProcContexts[i].IOCP =
             CreateIoCompletionPort(
                 INVALID_HANDLE_VALUE,
@@ -688,6 +1152,56 @@ QuicDataPathInitialize(
             goto Error;
         }
 
+#ifdef QUIC_WINDOWS_RIO
+        if (Datapath->UseRio) {
+            QUIC_DATAPATH_PROC_CONTEXT* ProcContext = &Datapath->ProcContexts[i];
+
+            //
+            // The completion queues signal this core's IOCP, so their
+            // completions are processed by the same thread as the sockets'.
+            //
+            RIO_NOTIFICATION_COMPLETION Notification = { 0 };
+            Notification.Type = RIO_IOCP_COMPLETION;
+            Notification.Iocp.IocpHandle = ProcContext->IOCP;
+            Notification.Iocp.CompletionKey = NULL;
+
+            Notification.Iocp.Overlapped = &ProcContext->RioRecvOverlapped;
+            ProcContext->RioRecvCq =
+                Datapath->Rio.RIOCreateCompletionQueue(
+                    QUIC_RIO_MAX_BINDINGS * QUIC_RIO_RECV_DEPTH,
+                    &Notification);
+            if (ProcContext->RioRecvCq == RIO_INVALID_CQ) {
+                int WsaError = WSAGetLastError();
+                QuicTraceEvent(
+                    LibraryErrorStatus,
+                    "[ lib] ERROR, %u, %s.",
+                    WsaError,
+                    "RIOCreateCompletionQueue (recv)");
+                Status = HRESULT_FROM_WIN32(WsaError);
+                goto Error;
+            }
+
+            Notification.Iocp.Overlapped = &ProcContext->RioSendOverlapped;
+            ProcContext->RioSendCq =
+                Datapath->Rio.RIOCreateCompletionQueue(
+                    QUIC_RIO_MAX_BINDINGS * QUIC_RIO_SEND_DEPTH,
+                    &Notification);
+            if (ProcContext->RioSendCq == RIO_INVALID_CQ) {
+                int WsaError = WSAGetLastError();
+                QuicTraceEvent(
+                    LibraryErrorStatus,
+                    "[ lib] ERROR, %u, %s.",
+                    WsaError,
+                    "RIOCreateCompletionQueue (send)");
+                Status = HRESULT_FROM_WIN32(WsaError);
+                goto Error;
+            }
+
+            (void)Datapath->Rio.RIONotify(ProcContext->RioRecvCq);
+            (void)Datapath->Rio.RIONotify(ProcContext->RioSendCq);
+        }
+#endif
+
         Datapath->ProcContexts[i].CompletionThread =
             CreateThread(
                 NULL,
@@ -761,6 +1275,11 @@ Error:
                 QuicPoolUninitialize(&Datapath->ProcContexts[i].SendBufferPool);
                 QuicPoolUninitialize(&Datapath->ProcContexts[i].LargeSendBufferPool);
                 QuicPoolUninitialize(&Datapath->ProcContexts[i].RecvDatagramPool);
+#ifdef QUIC_WINDOWS_RIO
+                if (Datapath->UseRio && Datapath->ProcContexts[i].Datapath != NULL) {
+                    QuicDataPathProcContextUninitializeRio(&Datapath->ProcContexts[i]);
+                }
+#endif
             }
             QuicRundownUninitialize(&Datapath->BindingsRundown);
             QUIC_FREE(Datapath);
@@ -812,6 +1331,11 @@ QuicDataPathUninitialize(
         QuicPoolUninitialize(&Datapath->ProcContexts[i].SendBufferPool);
         QuicPoolUninitialize(&Datapath->ProcContexts[i].LargeSendBufferPool);
         QuicPoolUninitialize(&Datapath->ProcContexts[i].RecvDatagramPool);
+#ifdef QUIC_WINDOWS_RIO
+        if (Datapath->UseRio) {
+            QuicDataPathProcContextUninitializeRio(&Datapath->ProcContexts[i]);
+        }
+#endif
     }
 
     QuicRundownUninitialize(&Datapath->BindingsRundown);
@@ -838,21 +1362,97 @@ QuicDataPathIsPaddingPreferred(
     return !!(Datapath->Features & QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION);
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
 void
-QuicDataPathPopulateTargetAddress(
-    _In_ ADDRESS_FAMILY Family,
-    _In_ ADDRINFOW *Ai,
-    _Out_ SOCKADDR_INET* Address
+QuicDataPathSetBusyPoll(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t BusyPollUs
     )
 {
-    if (Ai->ai_addr->sa_family == AF_INET6) {
-        //
-        // Is this a mapped ipv4 one?
-        //
-        PSOCKADDR_IN6 SockAddr6 = (PSOCKADDR_IN6)Ai->ai_addr;
+    //
+    // Receives are completion based here, so there is nothing to poll.
+    //
+    UNREFERENCED_PARAMETER(Datapath);
+    UNREFERENCED_PARAMETER(BusyPollUs);
+}
 
-        if (Family == AF_UNSPEC && IN6ADDR_ISV4MAPPED(SockAddr6))
-        {
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathSetPollCallback(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index,
+    _In_opt_ QUIC_DATAPATH_POLL_CALLBACK_HANDLER PollCallback,
+    _In_opt_ void* PollContext
+    )
+{
+    //
+    // Receives complete on system threads here, so there is no datapath
+    // thread to run the work on.
+    //
+    UNREFERENCED_PARAMETER(Datapath);
+    UNREFERENCED_PARAMETER(Index);
+    UNREFERENCED_PARAMETER(PollCallback);
+    UNREFERENCED_PARAMETER(PollContext);
+    return QUIC_STATUS_NOT_SUPPORTED;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDataPathWakeProcessor(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_ uint32_t Index
+    )
+{
+    UNREFERENCED_PARAMETER(Datapath);
+    UNREFERENCED_PARAMETER(Index);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathSetCidSteering(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_opt_ const QUIC_DATAPATH_CID_STEERING* Steering
+    )
+{
+    //
+    // Receive side scaling decides the processor here; there is no per-socket
+    // steering hook to program.
+    //
+    UNREFERENCED_PARAMETER(Datapath);
+    return Steering == NULL ? QUIC_STATUS_SUCCESS : QUIC_STATUS_NOT_SUPPORTED;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathBindingSetCryptoOffload(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_opt_ const QUIC_DATAPATH_CRYPTO_OFFLOAD* Offload
+    )
+{
+    //
+    // No inline crypto offload (QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD).
+    //
+    UNREFERENCED_PARAMETER(Binding);
+    UNREFERENCED_PARAMETER(RemoteAddress);
+    return Offload == NULL ? QUIC_STATUS_SUCCESS : QUIC_STATUS_NOT_SUPPORTED;
+}
+
+void
+QuicDataPathPopulateTargetAddress(
+    _In_ ADDRESS_FAMILY Family,
+    _In_ ADDRINFOW *Ai,
+    _Out_ SOCKADDR_INET* Address
+    )
+{
+    if (Ai->ai_addr->sa_family == AF_INET6) {
+        //
+        // Is this a mapped ipv4 one?
+        //
+        PSOCKADDR_IN6 SockAddr6 = (PSOCKADDR_IN6)Ai->ai_addr;
+
+        if (Family == AF_UNSPEC && IN6ADDR_ISV4MAPPED(SockAddr6))
+        {
             PSOCKADDR_IN SockAddr4 = &Address->Ipv4;
             //
             // Get the ipv4 address from the mapped address.
@@ -978,12 +1578,227 @@ Exit:
     return Status;
 }
 
+//
+// An outstanding GetAddrInfoExW request.
+//
+typedef struct QUIC_DATAPATH_RESOLVE_REQUEST {
+
+    OVERLAPPED Overlapped;
+    PADDRINFOEXW Result;
+    HANDLE CancelHandle;
+    QUIC_DATAPATH* Datapath;
+    QUIC_DATAPATH_RESOLVE_CALLBACK_HANDLER Callback;
+    void* Context;
+    WCHAR HostName[0];
+
+} QUIC_DATAPATH_RESOLVE_REQUEST;
+
+//
+// Keeps the first address of each family from the resolver's results.
+//
+void
+QuicDataPathPopulateResolution(
+    _In_opt_ PADDRINFOEXW Ai,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+    uint32_t Count = 0;
+    RtlZeroMemory(Resolution, sizeof(QUIC_DATAPATH_RESOLUTION));
+
+    for (; Ai != NULL && Count < ARRAYSIZE(Resolution->Addresses); Ai = Ai->ai_next) {
+        if (Ai->ai_addr->sa_family != AF_INET &&
+            Ai->ai_addr->sa_family != AF_INET6) {
+            continue;
+        }
+        QUIC_ADDR* Address = &Resolution->Addresses[Count];
+        //
+        // ADDRINFOEXW starts with the same fields as ADDRINFOW, up to and
+        // including ai_addr, which is all that's used.
+        //
+        QuicDataPathPopulateTargetAddress(AF_UNSPEC, (ADDRINFOW*)Ai, Address);
+        if (Count == 0 ||
+            Address->si_family != Resolution->Addresses[0].si_family) {
+            Count++;
+        } else {
+            RtlZeroMemory(Address, sizeof(QUIC_ADDR));
+        }
+    }
+}
+
+VOID
+CALLBACK
+QuicDataPathResolveComplete(
+    _In_ DWORD Error,
+    _In_ DWORD Bytes,
+    _In_ LPOVERLAPPED Overlapped
+    )
+{
+    UNREFERENCED_PARAMETER(Bytes);
+    QUIC_DATAPATH_RESOLVE_REQUEST* Request =
+        CONTAINING_RECORD(Overlapped, QUIC_DATAPATH_RESOLVE_REQUEST, Overlapped);
+    QUIC_DATAPATH_RESOLUTION Resolution;
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+
+    if (Error == NO_ERROR && Request->Result != NULL) {
+        QuicDataPathPopulateResolution(Request->Result, &Resolution);
+    } else {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Error,
+            "Resolving hostname to IP");
+        RtlZeroMemory(&Resolution, sizeof(Resolution));
+        Status = HRESULT_FROM_WIN32(WSAHOST_NOT_FOUND);
+    }
+
+    if (Request->Result != NULL) {
+        FreeAddrInfoExW(Request->Result);
+    }
+
+    Request->Callback(Request->Context, Status, &Resolution);
+    QUIC_FREE(Request);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicDataPathResolveAddressAsync(
+    _In_ QUIC_DATAPATH* Datapath,
+    _In_z_ const char* HostName,
+    _In_ QUIC_DATAPATH_RESOLVE_CALLBACK_HANDLER Callback,
+    _In_opt_ void* Context,
+    _Out_ QUIC_DATAPATH_RESOLUTION* Resolution
+    )
+{
+    QUIC_STATUS Status;
+    ADDRINFOEXW Hints = { 0 };
+
+    int Result =
+        MultiByteToWideChar(
+            CP_UTF8,
+            MB_ERR_INVALID_CHARS,
+            HostName,
+            -1,
+            NULL,
+            0);
+    if (Result == 0) {
+        DWORD LastError = GetLastError();
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            LastError,
+            "Calculate hostname wchar length");
+        return HRESULT_FROM_WIN32(LastError);
+    }
+
+    QUIC_DATAPATH_RESOLVE_REQUEST* Request =
+        QUIC_ALLOC_PAGED(sizeof(QUIC_DATAPATH_RESOLVE_REQUEST) + sizeof(WCHAR) * Result);
+    if (Request == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "QUIC_DATAPATH_RESOLVE_REQUEST",
+            sizeof(QUIC_DATAPATH_RESOLVE_REQUEST) + sizeof(WCHAR) * Result);
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    RtlZeroMemory(Request, sizeof(QUIC_DATAPATH_RESOLVE_REQUEST));
+    Request->Datapath = Datapath;
+    Request->Callback = Callback;
+    Request->Context = Context;
+
+    Result =
+        MultiByteToWideChar(
+            CP_UTF8,
+            MB_ERR_INVALID_CHARS,
+            HostName,
+            -1,
+            Request->HostName,
+            Result);
+    if (Result == 0) {
+        DWORD LastError = GetLastError();
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            LastError,
+            "Convert hostname to wchar");
+        Status = HRESULT_FROM_WIN32(LastError);
+        goto Error;
+    }
+
+    //
+    // Numeric names don't need the resolver, so complete those inline.
+    //
+    Hints.ai_family = AF_UNSPEC;
+    Hints.ai_flags = AI_NUMERICHOST;
+    if (GetAddrInfoExW(
+            Request->HostName, NULL, NS_ALL, NULL, &Hints, &Request->Result,
+            NULL, NULL, NULL, NULL) == NO_ERROR) {
+        QuicDataPathPopulateResolution(Request->Result, Resolution);
+        FreeAddrInfoExW(Request->Result);
+        Status = QUIC_STATUS_SUCCESS;
+        goto Error;
+    }
+    Request->Result = NULL;
+
+    Hints.ai_flags = AI_CANONNAME;
+    Result =
+        GetAddrInfoExW(
+            Request->HostName,
+            NULL,
+            NS_ALL,
+            NULL,
+            &Hints,
+            &Request->Result,
+            NULL,
+            &Request->Overlapped,
+            QuicDataPathResolveComplete,
+            &Request->CancelHandle);
+    if (Result == WSA_IO_PENDING) {
+        return QUIC_STATUS_PENDING;
+    }
+
+    if (Result == NO_ERROR) {
+        //
+        // Completed synchronously, so the completion routine won't be called.
+        //
+        QuicDataPathPopulateResolution(Request->Result, Resolution);
+        FreeAddrInfoExW(Request->Result);
+        Status = QUIC_STATUS_SUCCESS;
+        goto Error;
+    }
+
+    QuicTraceEvent(
+        LibraryError,
+        "[ lib] ERROR, %s.",
+        "Resolving hostname to IP");
+    QuicTraceLogError(
+        DatapathResolveHostNameFailed,
+        "[%p] Couldn't resolve hostname '%s' to an IP address",
+        Datapath,
+        HostName);
+    Status = HRESULT_FROM_WIN32(WSAHOST_NOT_FOUND);
+
+Error:
+
+    QUIC_FREE(Request);
+
+    return Status;
+}
+
 QUIC_STATUS
 QuicDataPathBindingStartReceive(
     _In_ QUIC_UDP_SOCKET_CONTEXT* SocketContext,
     _In_ HANDLE CompletionPort
     );
 
+#ifdef QUIC_WINDOWS_RIO
+QUIC_STATUS
+QuicDataPathRioStartReceive(
+    _In_ QUIC_UDP_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    );
+#endif
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicDataPathBindingCreate(
@@ -1028,6 +1843,24 @@ QuicDataPathBindingCreate(
     Binding->Mtu = QUIC_MAX_MTU;
     QuicRundownAcquire(&Datapath->BindingsRundown);
 
+#ifdef QUIC_WINDOWS_RIO
+    //
+    // Only unconnected (server) bindings use registered I/O, as they carry the
+    // bulk of the traffic and there are few of them.
+    //
+    if (Datapath->UseRio && RemoteAddress == NULL) {
+        if (InterlockedIncrement(&Datapath->RioBindingCount) <= QUIC_RIO_MAX_BINDINGS) {
+            Binding->Rio = TRUE;
+        } else {
+            InterlockedDecrement(&Datapath->RioBindingCount);
+            QuicTraceLogWarning(
+                DatapathRioBindingLimit,
+                "[ udp][%p] Registered I/O binding limit reached, using socket I/O",
+                Binding);
+        }
+    }
+#endif
+
     for (uint32_t i = 0; i < SocketCount; i++) {
         Binding->SocketContexts[i].Binding = Binding;
         Binding->SocketContexts[i].Socket = INVALID_SOCKET;
@@ -1036,6 +1869,11 @@ QuicDataPathBindingCreate(
                 MAX_URO_PAYLOAD_LENGTH :
                 Binding->Mtu - QUIC_MIN_IPV4_HEADER_SIZE - QUIC_UDP_HEADER_SIZE;
         QuicRundownInitialize(&Binding->SocketContexts[i].UpcallRundown);
+#ifdef QUIC_WINDOWS_RIO
+        if (Binding->Rio) {
+            QuicLockInitialize(&Binding->SocketContexts[i].RioLock);
+        }
+#endif
     }
 
     for (uint32_t i = 0; i < SocketCount; i++) {
@@ -1050,6 +1888,10 @@ QuicDataPathBindingCreate(
                 IPPROTO_UDP,
                 NULL,
                 0,
+#ifdef QUIC_WINDOWS_RIO
+                Binding->Rio ?
+                    WSA_FLAG_OVERLAPPED | WSA_FLAG_REGISTERED_IO :
+#endif
                 WSA_FLAG_OVERLAPPED);
         if (SocketContext->Socket == INVALID_SOCKET) {
             int WsaError = WSAGetLastError();
@@ -1259,6 +2101,45 @@ QuicDataPathBindingCreate(
             goto Error;
         }
 
+        //
+        // Receive the ECN codepoints too. Older versions of Windows don't
+        // support this, in which case the peer's ECN marks are never seen and
+        // its ECN validation fails.
+        //
+        Option = TRUE;
+        Result =
+            setsockopt(
+                SocketContext->Socket,
+                IPPROTO_IPV6,
+                IPV6_RECVECN,
+                (char*)&Option,
+                sizeof(Option));
+        if (Result == SOCKET_ERROR) {
+            QuicTraceEvent(
+                DatapathErrorStatus,
+                "[ udp][%p] ERROR, %u, %s.",
+                Binding,
+                WSAGetLastError(),
+                "Set IPV6_RECVECN");
+        }
+
+        Option = TRUE;
+        Result =
+            setsockopt(
+                SocketContext->Socket,
+                IPPROTO_IP,
+                IP_RECVECN,
+                (char*)&Option,
+                sizeof(Option));
+        if (Result == SOCKET_ERROR) {
+            QuicTraceEvent(
+                DatapathErrorStatus,
+                "[ udp][%p] ERROR, %u, %s.",
+                Binding,
+                WSAGetLastError(),
+                "Set IP_RECVECN");
+        }
+
         //
         // The socket is shared by multiple endpoints, so increase the receive
         // buffer size.
@@ -1284,7 +2165,11 @@ QuicDataPathBindingCreate(
         }
 
 #ifdef UDP_RECV_MAX_COALESCED_SIZE
-        if (Datapath->Features & QUIC_DATAPATH_FEATURE_RECV_COALESCING) {
+        if ((Datapath->Features & QUIC_DATAPATH_FEATURE_RECV_COALESCING)
+#ifdef QUIC_WINDOWS_RIO
+            && !Binding->Rio // Registered receive buffers only fit one datagram.
+#endif
+            ) {
             Option = MAX_URO_PAYLOAD_LENGTH;
             Result =
                 setsockopt(
@@ -1347,6 +2232,36 @@ QUIC_DISABLED_BY_FUZZER_START;
 
 QUIC_DISABLED_BY_FUZZER_END;
 
+#ifdef QUIC_WINDOWS_RIO
+        if (Binding->Rio) {
+            //
+            // Receive and send completions both go to the completion queues of
+            // the socket's processor.
+            //
+            SocketContext->RioRq =
+                Datapath->Rio.RIOCreateRequestQueue(
+                    SocketContext->Socket,
+                    QUIC_RIO_RECV_DEPTH,
+                    1,
+                    QUIC_RIO_SEND_DEPTH,
+                    1,
+                    Datapath->ProcContexts[i].RioRecvCq,
+                    Datapath->ProcContexts[i].RioSendCq,
+                    SocketContext);
+            if (SocketContext->RioRq == RIO_INVALID_RQ) {
+                int WsaError = WSAGetLastError();
+                QuicTraceEvent(
+                    DatapathErrorStatus,
+                    "[ udp][%p] ERROR, %u, %s.",
+                    Binding,
+                    WsaError,
+                    "RIOCreateRequestQueue");
+                Status = HRESULT_FROM_WIN32(WsaError);
+                goto Error;
+            }
+        }
+#endif
+
         if (RemoteAddress != NULL) {
             SOCKADDR_INET MappedRemoteAddress = { 0 };
             QuicConvertToMappedV6(RemoteAddress, &MappedRemoteAddress);
@@ -1372,12 +2287,18 @@ QUIC_DISABLED_BY_FUZZER_START;
 
 QUIC_DISABLED_BY_FUZZER_END;
 
+            //
+            // Receive the socket's datagrams on the processor RSS delivers them
+            // to, so they aren't handed off to another core on the way up and
+            // the connection's partition (and worker) settles on that core.
             //
             // RSS affinitization has some problems:
             //
             // 1. The RSS indirection table can change at any time. There is no
             //    notification API for RSS rebalancing, so static assignment at
-            //    binding time is the closest approximation.
+            //    binding time is the closest approximation. The connection
+            //    still follows the datagrams to whichever partition they are
+            //    received on afterwards.
             // 2. There may be no RSS capability at all, in which case we must
             //    choose a processor index. We fall back to the current
             //    processor index: the caller of this routine is already a load
@@ -1387,16 +2308,7 @@ QUIC_DISABLED_BY_FUZZER_END;
             AffinitizedProcessor =
                 (UINT8)(QuicProcCurrentNumber() % Datapath->ProcCount);
 
-#if 0
-            //
-            // Several miniport drivers that are capable of hashing UDP 4-tuples
-            // are incorrectly reporting themselves as IP 2-tuple capable only.
-            // This leads to poor load distribution if we have traffic over many
-            // unique UDP port pairs. Until hardware vendors provide updated
-            // drivers, always fall back to non-RSS receive worker affinity.
-            //
-
-            if (Datapath->RssMode != QUIC_RSS_NONE) {
+            if (Datapath->Features & QUIC_DATAPATH_FEATURE_RECV_SIDE_SCALING) {
                 SOCKET_PROCESSOR_AFFINITY RssAffinity = { 0 };
 
                 Result =
@@ -1417,12 +2329,14 @@ QUIC_DISABLED_BY_FUZZER_END;
                         "[ udp][%p] WSAIoctl for SIO_QUERY_RSS_PROCESSOR_INFO failed, 0x%x",
                         Binding,
                         WsaError);
-                } else {
-                    AffinitizedProcessor =
-                        (RssAffinity.Processor.Number % Datapath->ProcCount);
+                } else if (RssAffinity.Processor.Group == 0 &&
+                           RssAffinity.Processor.Number < Datapath->ProcCount) {
+                    //
+                    // Processor contexts only cover the first group.
+                    //
+                    AffinitizedProcessor = (UINT8)RssAffinity.Processor.Number;
                 }
             }
-#endif
 
             Binding->ConnectedProcessorAffinity = AffinitizedProcessor;
         }
@@ -1501,6 +2415,14 @@ QUIC_DISABLED_BY_FUZZER_END;
         uint32_t Processor =
             Binding->Connected ? Binding->ConnectedProcessorAffinity : i;
 
+#ifdef QUIC_WINDOWS_RIO
+        if (Binding->Rio) {
+            Status =
+                QuicDataPathRioStartReceive(
+                    &Binding->SocketContexts[i],
+                    &Datapath->ProcContexts[Processor]);
+        } else
+#endif
         Status =
             QuicDataPathBindingStartReceive(
                 &Binding->SocketContexts[i],
@@ -1551,7 +2473,17 @@ QUIC_DISABLED_BY_FUZZER_START;
 QUIC_DISABLED_BY_FUZZER_END;
 
                     QuicRundownUninitialize(&SocketContext->UpcallRundown);
+#ifdef QUIC_WINDOWS_RIO
+                    if (Binding->Rio) {
+                        QuicLockUninitialize(&SocketContext->RioLock);
+                    }
+#endif
+                }
+#ifdef QUIC_WINDOWS_RIO
+                if (Binding->Rio) {
+                    InterlockedDecrement(&Datapath->RioBindingCount);
                 }
+#endif
                 QuicRundownRelease(&Datapath->BindingsRundown);
                 QUIC_FREE(Binding);
             }
@@ -1639,6 +2571,21 @@ QuicDataPathSocketContextShutdown(
     _In_ QUIC_UDP_SOCKET_CONTEXT* SocketContext
     )
 {
+#ifdef QUIC_WINDOWS_RIO
+    if (SocketContext->Binding->Rio) {
+        //
+        // Closing the socket aborts its outstanding registered I/O, but the
+        // completions still reference the socket context. Clean up is
+        // finished when the last of them is processed.
+        //
+        SocketContext->RioShutdown = TRUE;
+        if (SocketContext->RioOutstanding != 0) {
+            return;
+        }
+        QuicLockUninitialize(&SocketContext->RioLock);
+    }
+#endif
+
     if (SocketContext->CurrentRecvContext != NULL) {
         QuicPoolFree(
             SocketContext->CurrentRecvContext->OwningPool,
@@ -1653,6 +2600,11 @@ QuicDataPathSocketContextShutdown(
         //
         // Last socket context cleaned up, so now the binding can be freed.
         //
+#ifdef QUIC_WINDOWS_RIO
+        if (SocketContext->Binding->Rio) {
+            InterlockedDecrement(&SocketContext->Binding->Datapath->RioBindingCount);
+        }
+#endif
         QuicRundownRelease(&SocketContext->Binding->Datapath->BindingsRundown);
         QuicTraceLogVerbose(
             DatapathShutDownComplete,
@@ -1707,20 +2659,35 @@ QuicDataPathBindingAllocRecvContext(
         RecvContext->OwningPool =
             &Datapath->ProcContexts[ProcIndex].RecvDatagramPool;
         RecvContext->ReferenceCount = 0;
+#ifdef QUIC_WINDOWS_RIO
+        RecvContext->RioRegistered = FALSE;
+#endif
     }
 
     return RecvContext;
 }
 
 void
-QuicDataPathBindingHandleUnreachableError(
+QuicDataPathRecvContextFree(
+    _In_ QUIC_DATAPATH_INTERNAL_RECV_CONTEXT* RecvContext
+    )
+{
+#ifdef QUIC_WINDOWS_RIO
+    if (RecvContext->RioRegistered) {
+        QuicRioBufferFree(RecvContext);
+        return;
+    }
+#endif
+    QuicPoolFree(RecvContext->OwningPool, RecvContext);
+}
+
+void
+QuicDataPathBindingHandleUnreachableError(
     _In_ QUIC_UDP_SOCKET_CONTEXT* SocketContext,
+    _In_ PSOCKADDR_INET RemoteAddr,
     _In_ ULONG ErrorCode
     )
 {
-    PSOCKADDR_INET RemoteAddr =
-        &SocketContext->CurrentRecvContext->Tuple.RemoteAddress;
-
     QuicConvertFromMappedV6(RemoteAddr, RemoteAddr);
 
 #if 0 // TODO - Change to ETW event
@@ -1812,7 +2779,10 @@ Retry_recv:
         int WsaError = WSAGetLastError();
         if (WsaError != WSA_IO_PENDING) {
             if (WsaError == WSAECONNRESET) {
-                QuicDataPathBindingHandleUnreachableError(SocketContext, (ULONG)WsaError);
+                QuicDataPathBindingHandleUnreachableError(
+                    SocketContext,
+                    &SocketContext->CurrentRecvContext->Tuple.RemoteAddress,
+                    (ULONG)WsaError);
                 goto Retry_recv;
             } else {
                 QuicTraceEvent(
@@ -1885,7 +2855,7 @@ QuicDataPathRecvComplete(
 
     } else if (IsUnreachableErrorCode(IoResult)) {
 
-        QuicDataPathBindingHandleUnreachableError(SocketContext, IoResult);
+        QuicDataPathBindingHandleUnreachableError(SocketContext, RemoteAddr, IoResult);
 
     } else if (IoResult == ERROR_MORE_DATA ||
         (IoResult == NO_ERROR && SocketContext->RecvWsaBuf.len < NumberOfBytesTransferred)) {
@@ -1928,6 +2898,8 @@ QuicDataPathRecvComplete(
         UINT16 MessageLength = NumberOfBytesTransferred;
         ULONG MessageCount = 0;
         BOOLEAN IsCoalesced = FALSE;
+        UINT8 TypeOfService = 0;
+        UINT64 RecvTime = QuicTimeUs64();
 
         for (WSACMSGHDR *CMsg = WSA_CMSG_FIRSTHDR(&SocketContext->RecvWsaMsgHdr);
             CMsg != NULL;
@@ -1949,6 +2921,9 @@ QuicDataPathRecvComplete(
                 LocalAddr->Ipv4.sin_port = SocketContext->Binding->LocalAddress.Ipv6.sin6_port;
                 LocalAddr->Ipv6.sin6_scope_id = PktInfo->ipi_ifindex;
                 FoundLocalAddr = TRUE;
+            } else if ((CMsg->cmsg_level == IPPROTO_IPV6 && CMsg->cmsg_type == IPV6_ECN) ||
+                       (CMsg->cmsg_level == IPPROTO_IP && CMsg->cmsg_type == IP_ECN)) {
+                TypeOfService = (UINT8)*(PINT)WSA_CMSG_DATA(CMsg);
 #ifdef UDP_RECV_MAX_COALESCED_SIZE
             } else if (CMsg->cmsg_level == IPPROTO_UDP && CMsg->cmsg_type == UDP_COALESCED_INFO) {
                 QUIC_DBG_ASSERT(*(PDWORD)WSA_CMSG_DATA(CMsg) <= MAX_URO_PAYLOAD_LENGTH);
@@ -2015,8 +2990,11 @@ QuicDataPathRecvComplete(
             Datagram->BufferLength = MessageLength;
             Datagram->Tuple = &RecvContext->Tuple;
             Datagram->PartitionIndex = (uint8_t)ProcContext->Index;
+            Datagram->RecvTime = RecvTime;
+            Datagram->TypeOfService = TypeOfService;
             Datagram->Allocated = TRUE;
             Datagram->QueuedOnConnection = FALSE;
+            Datagram->CryptoOffloaded = FALSE;
 
             RecvPayload += MessageLength;
 
@@ -2078,6 +3056,286 @@ Drop:
     (void)QuicDataPathBindingStartReceive(SocketContext, ProcContext->IOCP);
 }
 
+#ifdef QUIC_WINDOWS_RIO
+//
+// Posts a registered I/O receive, into a new context from the registered
+// pool of the socket's processor.
+//
+QUIC_STATUS
+QuicDataPathRioPostReceive(
+    _In_ QUIC_UDP_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+    QUIC_DATAPATH* Datapath = ProcContext->Datapath;
+    RIO_BUF DataBuf, RemoteAddressBuf, ControlBuf;
+
+    QUIC_DATAPATH_INTERNAL_RECV_CONTEXT* RecvContext =
+        QuicRioBufferAlloc(Datapath, &ProcContext->RioRecvPool);
+    if (RecvContext == NULL) {
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    RecvContext->OwningPool = NULL;
+    RecvContext->RioRegistered = TRUE;
+    RecvContext->ReferenceCount = 0;
+    RtlZeroMemory(&RecvContext->Tuple, sizeof(RecvContext->Tuple));
+
+    QuicRioBufferDescribe(
+        RecvContext,
+        (PUCHAR)RecvContext + Datapath->RioRecvPayloadOffset,
+        MAX_UDP_PAYLOAD_LENGTH,
+        &DataBuf);
+    QuicRioBufferDescribe(
+        RecvContext,
+        &RecvContext->Tuple.RemoteAddress,
+        sizeof(RecvContext->Tuple.RemoteAddress),
+        &RemoteAddressBuf);
+    QuicRioBufferDescribe(
+        RecvContext,
+        RecvContext->RioControl.Buffer,
+        sizeof(RecvContext->RioControl.Buffer),
+        &ControlBuf);
+
+    InterlockedIncrement(&SocketContext->RioOutstanding);
+
+    QuicLockAcquire(&SocketContext->RioLock);
+    BOOL Result =
+        Datapath->Rio.RIOReceiveEx(
+            SocketContext->RioRq,
+            &DataBuf,
+            1,
+            NULL,
+            &RemoteAddressBuf,
+            &ControlBuf,
+            NULL,
+            0,
+            RecvContext);
+    QuicLockRelease(&SocketContext->RioLock);
+
+    if (!Result) {
+        int WsaError = WSAGetLastError();
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            SocketContext->Binding,
+            WsaError,
+            "RIOReceiveEx");
+        InterlockedDecrement(&SocketContext->RioOutstanding);
+        QuicRioBufferFree(RecvContext);
+        return HRESULT_FROM_WIN32(WsaError);
+    }
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+QUIC_STATUS
+QuicDataPathRioStartReceive(
+    _In_ QUIC_UDP_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+    for (uint32_t i = 0; i < QUIC_RIO_RECV_DEPTH; ++i) {
+        QUIC_STATUS Status = QuicDataPathRioPostReceive(SocketContext, ProcContext);
+        if (QUIC_FAILED(Status)) {
+            return Status;
+        }
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+void
+QuicDataPathRioRecvComplete(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext,
+    _In_ QUIC_UDP_SOCKET_CONTEXT* SocketContext,
+    _In_ QUIC_DATAPATH_INTERNAL_RECV_CONTEXT* RecvContext,
+    _In_ ULONG IoResult,
+    _In_ ULONG NumberOfBytesTransferred
+    )
+{
+    QUIC_DATAPATH* Datapath = SocketContext->Binding->Datapath;
+    PSOCKADDR_INET RemoteAddr = &RecvContext->Tuple.RemoteAddress;
+    PSOCKADDR_INET LocalAddr = &RecvContext->Tuple.LocalAddress;
+
+    if (!QuicRundownAcquire(&SocketContext->UpcallRundown)) {
+        //
+        // The socket is being cleaned up; don't repost.
+        //
+        QuicRioBufferFree(RecvContext);
+        return;
+    }
+
+    if (IoResult == WSAENOTSOCK || IoResult == WSA_OPERATION_ABORTED) {
+        QuicRioBufferFree(RecvContext);
+        QuicRundownRelease(&SocketContext->UpcallRundown);
+        return;
+    }
+
+    if (IoResult == WSAECONNRESET || IsUnreachableErrorCode(IoResult)) {
+
+        QuicDataPathBindingHandleUnreachableError(SocketContext, RemoteAddr, IoResult);
+        QuicRioBufferFree(RecvContext);
+
+    } else if (IoResult != NO_ERROR) {
+
+        QuicTraceEvent(
+            DatapathErrorStatus,
+            "[ udp][%p] ERROR, %u, %s.",
+            SocketContext->Binding,
+            IoResult,
+            "RIOReceiveEx completion");
+        QuicRioBufferFree(RecvContext);
+
+    } else {
+
+        BOOLEAN FoundLocalAddr = FALSE;
+        UINT8 TypeOfService = 0;
+        UINT64 RecvTime = QuicTimeUs64();
+        PRIO_CMSG_BUFFER Control = &RecvContext->RioControl.Header;
+
+        for (WSACMSGHDR* CMsg = RIO_CMSG_FIRSTHDR(Control);
+            CMsg != NULL;
+            CMsg = RIO_CMSG_NEXTHDR(Control, CMsg)) {
+
+            if (CMsg->cmsg_level == IPPROTO_IPV6 && CMsg->cmsg_type == IPV6_PKTINFO) {
+                PIN6_PKTINFO PktInfo6 = (PIN6_PKTINFO)WSA_CMSG_DATA(CMsg);
+                LocalAddr->si_family = AF_INET6;
+                LocalAddr->Ipv6.sin6_addr = PktInfo6->ipi6_addr;
+                LocalAddr->Ipv6.sin6_port = SocketContext->Binding->LocalAddress.Ipv6.sin6_port;
+                QuicConvertFromMappedV6(LocalAddr, LocalAddr);
+
+                LocalAddr->Ipv6.sin6_scope_id = PktInfo6->ipi6_ifindex;
+                FoundLocalAddr = TRUE;
+            } else if (CMsg->cmsg_level == IPPROTO_IP && CMsg->cmsg_type == IP_PKTINFO) {
+                PIN_PKTINFO PktInfo = (PIN_PKTINFO)WSA_CMSG_DATA(CMsg);
+                LocalAddr->si_family = AF_INET;
+                LocalAddr->Ipv4.sin_addr = PktInfo->ipi_addr;
+                LocalAddr->Ipv4.sin_port = SocketContext->Binding->LocalAddress.Ipv6.sin6_port;
+                LocalAddr->Ipv6.sin6_scope_id = PktInfo->ipi_ifindex;
+                FoundLocalAddr = TRUE;
+            } else if ((CMsg->cmsg_level == IPPROTO_IPV6 && CMsg->cmsg_type == IPV6_ECN) ||
+                       (CMsg->cmsg_level == IPPROTO_IP && CMsg->cmsg_type == IP_ECN)) {
+                TypeOfService = (UINT8)*(PINT)WSA_CMSG_DATA(CMsg);
+            }
+        }
+
+        if (!FoundLocalAddr) {
+            QuicTraceLogWarning(
+                DatapathRioMissingInfo,
+                "[ udp][%p] RIOReceiveEx completion is missing IP_PKTINFO",
+                SocketContext->Binding);
+            QuicRioBufferFree(RecvContext);
+
+        } else if (NumberOfBytesTransferred == 0 ||
+                   NumberOfBytesTransferred > MAX_UDP_PAYLOAD_LENGTH) {
+            QuicTraceLogWarning(
+                DatapathRecvEmpty,
+                "[ udp][%p] Dropping datagram with empty payload.",
+                SocketContext->Binding);
+            QuicRioBufferFree(RecvContext);
+
+        } else {
+            QuicConvertFromMappedV6(RemoteAddr, RemoteAddr);
+
+            QuicTraceEvent(
+                DatapathRecv,
+                "[ udp][%p] Recv %u bytes (segment=%hu) Src=%!SOCKADDR! Dst=%!SOCKADDR!",
+                SocketContext->Binding,
+                NumberOfBytesTransferred,
+                (UINT16)NumberOfBytesTransferred,
+                LOG_ADDR_LEN(*LocalAddr),
+                LOG_ADDR_LEN(*RemoteAddr),
+                (UINT8*)LocalAddr,
+                (UINT8*)RemoteAddr);
+
+            QUIC_RECV_DATAGRAM* Datagram = (QUIC_RECV_DATAGRAM*)(RecvContext + 1);
+            QuicDataPathDatagramToInternalDatagramContext(Datagram)->RecvContext = RecvContext;
+
+            Datagram->Next = NULL;
+            Datagram->Buffer = (PUCHAR)RecvContext + Datapath->RioRecvPayloadOffset;
+            Datagram->BufferLength = (UINT16)NumberOfBytesTransferred;
+            Datagram->Tuple = &RecvContext->Tuple;
+            Datagram->PartitionIndex = (uint8_t)ProcContext->Index;
+            Datagram->RecvTime = RecvTime;
+            Datagram->TypeOfService = TypeOfService;
+            Datagram->Allocated = TRUE;
+            Datagram->QueuedOnConnection = FALSE;
+            Datagram->CryptoOffloaded = FALSE;
+            RecvContext->ReferenceCount = 1;
+
+            QUIC_DBG_ASSERT(Datapath->RecvHandler);
+            Datapath->RecvHandler(
+                SocketContext->Binding,
+                SocketContext->Binding->ClientContext,
+                Datagram);
+        }
+    }
+
+    //
+    // Replace the completed receive.
+    //
+    (void)QuicDataPathRioPostReceive(SocketContext, ProcContext);
+
+    QuicRundownRelease(&SocketContext->UpcallRundown);
+}
+
+//
+// Drops a socket context's reference for a completed registered I/O request,
+// finishing its clean up if it was waiting on the request.
+//
+void
+QuicDataPathRioRequestComplete(
+    _In_ QUIC_UDP_SOCKET_CONTEXT* SocketContext
+    )
+{
+    if (InterlockedDecrement(&SocketContext->RioOutstanding) == 0 &&
+        SocketContext->RioShutdown) {
+        QuicDataPathSocketContextShutdown(SocketContext);
+    }
+}
+
+void
+QuicDataPathRioProcessRecvCompletions(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+    QUIC_DATAPATH* Datapath = ProcContext->Datapath;
+    RIORESULT Results[QUIC_RIO_DEQUEUE_COUNT];
+    ULONG Count;
+
+    while ((Count =
+            Datapath->Rio.RIODequeueCompletion(
+                ProcContext->RioRecvCq,
+                Results,
+                ARRAYSIZE(Results))) != 0) {
+        if (Count == RIO_CORRUPT_CQ) {
+            QuicTraceEvent(
+                LibraryError,
+                "[ lib] ERROR, %s.",
+                "RIODequeueCompletion (recv) corrupt");
+            break;
+        }
+        for (ULONG i = 0; i < Count; ++i) {
+            QUIC_UDP_SOCKET_CONTEXT* SocketContext =
+                (QUIC_UDP_SOCKET_CONTEXT*)(ULONG_PTR)Results[i].SocketContext;
+            QuicDataPathRioRecvComplete(
+                ProcContext,
+                SocketContext,
+                (QUIC_DATAPATH_INTERNAL_RECV_CONTEXT*)(ULONG_PTR)Results[i].RequestContext,
+                (ULONG)Results[i].Status,
+                Results[i].BytesTransferred);
+            QuicDataPathRioRequestComplete(SocketContext);
+        }
+    }
+
+    //
+    // Rearm the notification. It fires immediately if more completions
+    // arrived since the last dequeue.
+    //
+    (void)Datapath->Rio.RIONotify(ProcContext->RioRecvCq);
+}
+#endif
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 void
 QuicDataPathBindingReturnRecvDatagrams(
@@ -2107,9 +3365,7 @@ QuicDataPathBindingReturnRecvDatagrams(
                 //
                 // Clean up the data indication.
                 //
-                QuicPoolFree(
-                    BatchedInternalContext->OwningPool,
-                    BatchedInternalContext);
+                QuicDataPathRecvContextFree(BatchedInternalContext);
             }
 
             BatchedInternalContext = InternalContext;
@@ -2124,9 +3380,7 @@ QuicDataPathBindingReturnRecvDatagrams(
         //
         // Clean up the data indication.
         //
-        QuicPoolFree(
-            BatchedInternalContext->OwningPool,
-            BatchedInternalContext);
+        QuicDataPathRecvContextFree(BatchedInternalContext);
     }
 }
 
@@ -2135,6 +3389,7 @@ _Success_(return != NULL)
 QUIC_DATAPATH_SEND_CONTEXT*
 QuicDataPathBindingAllocSendContext(
     _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ QUIC_ECN_TYPE ECN,
     _In_ uint16_t MaxPacketSize
     )
 {
@@ -2143,11 +3398,38 @@ QuicDataPathBindingAllocSendContext(
     QUIC_DATAPATH_PROC_CONTEXT* ProcContext =
         &Binding->Datapath->ProcContexts[GetCurrentProcessorNumber()];
 
-    QUIC_DATAPATH_SEND_CONTEXT* SendContext =
-        QuicPoolAlloc(&ProcContext->SendContextPool);
+    QUIC_DATAPATH_SEND_CONTEXT* SendContext;
+
+#ifdef QUIC_WINDOWS_RIO
+    if (Binding->Rio) {
+        //
+        // The context holds the send's addressing, which must be registered
+        // too. Its datagrams aren't segmented, as each one is its own request.
+        //
+        SendContext =
+            QuicRioBufferAlloc(Binding->Datapath, &ProcContext->RioSendContextPool);
+        if (SendContext != NULL) {
+            SendContext->Rio = TRUE;
+            SendContext->Owner = ProcContext;
+            SendContext->ECN = (UINT8)ECN;
+            SendContext->SegmentSize = 0;
+            SendContext->TotalSize = 0;
+            SendContext->WsaBufferCount = 0;
+            SendContext->ClientBuffer.len = 0;
+            SendContext->ClientBuffer.buf = NULL;
+        }
+        return SendContext;
+    }
+#endif
+
+    SendContext = QuicPoolAlloc(&ProcContext->SendContextPool);
 
     if (SendContext != NULL) {
+#ifdef QUIC_WINDOWS_RIO
+        SendContext->Rio = FALSE;
+#endif
         SendContext->Owner = ProcContext;
+        SendContext->ECN = (UINT8)ECN;
         SendContext->SegmentSize =
             (Binding->Datapath->Features & QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION)
                 ? MaxPacketSize : 0;
@@ -2171,6 +3453,16 @@ QuicDataPathBindingFreeSendContext(
         SendContext->SegmentSize > 0 ?
             &ProcContext->LargeSendBufferPool : &ProcContext->SendBufferPool;
 
+#ifdef QUIC_WINDOWS_RIO
+    if (SendContext->Rio) {
+        for (UINT8 i = 0; i < SendContext->WsaBufferCount; ++i) {
+            QuicRioBufferFree(SendContext->WsaBuffers[i].buf);
+        }
+        QuicRioBufferFree(SendContext);
+        return;
+    }
+#endif
+
     for (UINT8 i = 0; i < SendContext->WsaBufferCount; ++i) {
         QuicPoolFree(BufferPool, SendContext->WsaBuffers[i].buf);
     }
@@ -2282,7 +3574,25 @@ QuicSendContextAllocPacketBuffer(
     _In_ UINT16 MaxBufferLength
     )
 {
-    WSABUF* WsaBuffer =
+    WSABUF* WsaBuffer;
+
+#ifdef QUIC_WINDOWS_RIO
+    if (SendContext->Rio) {
+        WsaBuffer = &SendContext->WsaBuffers[SendContext->WsaBufferCount];
+        WsaBuffer->buf =
+            QuicRioBufferAlloc(
+                SendContext->Owner->Datapath,
+                &SendContext->Owner->RioSendBufferPool);
+        if (WsaBuffer->buf == NULL) {
+            return NULL;
+        }
+        ++SendContext->WsaBufferCount;
+        WsaBuffer->len = MaxBufferLength;
+        return (QUIC_BUFFER*)WsaBuffer;
+    }
+#endif
+
+    WsaBuffer =
         QuicSendContextAllocBuffer(SendContext, &SendContext->Owner->SendBufferPool);
     if (WsaBuffer != NULL) {
         WsaBuffer->len = MaxBufferLength;
@@ -2371,7 +3681,15 @@ QuicDataPathBindingFreeSendDatagram(
     if (SendContext->SegmentSize == 0) {
         QUIC_DBG_ASSERT(Datagram->Buffer == (uint8_t*)TailBuffer);
 
+#ifdef QUIC_WINDOWS_RIO
+        if (SendContext->Rio) {
+            QuicRioBufferFree(Datagram->Buffer);
+        } else {
+            QuicPoolFree(&ProcContext->SendBufferPool, Datagram->Buffer);
+        }
+#else
         QuicPoolFree(&ProcContext->SendBufferPool, Datagram->Buffer);
+#endif
         --SendContext->WsaBufferCount;
     } else {
         TailBuffer += SendContext->WsaBuffers[SendContext->WsaBufferCount - 1].len;
@@ -2396,6 +3714,43 @@ QuicDataPathBindingIsSendContextFull(
     return !QuicSendContextCanAllocSend(SendContext, SendContext->SegmentSize);
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDataPathBindingSetSendTxTime(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ uint64_t TxTime
+    )
+{
+    //
+    // Departure times aren't supported (QUIC_DATAPATH_FEATURE_SEND_TXTIME).
+    //
+    UNREFERENCED_PARAMETER(SendContext);
+    UNREFERENCED_PARAMETER(TxTime);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDataPathBindingSetCryptoOffloadPacket(
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext,
+    _In_ QUIC_BUFFER* Datagram,
+    _In_ uint16_t PacketOffset,
+    _In_ uint16_t PacketLength,
+    _In_ uint16_t HeaderLength,
+    _In_ uint64_t PacketNumber
+    )
+{
+    //
+    // Never called, as QUIC_DATAPATH_FEATURE_CRYPTO_OFFLOAD isn't supported.
+    //
+    QUIC_DBG_ASSERT(FALSE);
+    UNREFERENCED_PARAMETER(SendContext);
+    UNREFERENCED_PARAMETER(Datagram);
+    UNREFERENCED_PARAMETER(PacketOffset);
+    UNREFERENCED_PARAMETER(PacketLength);
+    UNREFERENCED_PARAMETER(HeaderLength);
+    UNREFERENCED_PARAMETER(PacketNumber);
+}
+
 void
 QuicSendContextComplete(
     _In_ QUIC_UDP_SOCKET_CONTEXT* SocketContext,
@@ -2464,8 +3819,8 @@ QuicDataPathBindingSendTo(
     WSAMhdr.Control.buf = NULL;
     WSAMhdr.Control.len = 0;
 
-    PWSACMSGHDR CMsg;
-    BYTE CtrlBuf[WSA_CMSG_SPACE(sizeof(*SegmentSize))];
+    PWSACMSGHDR CMsg = NULL;
+    BYTE CtrlBuf[WSA_CMSG_SPACE(sizeof(*SegmentSize)) + WSA_CMSG_SPACE(sizeof(INT))];
 
 #ifdef UDP_SEND_MSG_SIZE
     if (SendContext->SegmentSize > 0) {
@@ -2482,6 +3837,23 @@ QuicDataPathBindingSendTo(
     }
 #endif
 
+    if (SendContext->ECN != QUIC_ECN_NON_ECT) {
+        WSAMhdr.Control.buf = (PCHAR)CtrlBuf;
+        WSAMhdr.Control.len += WSA_CMSG_SPACE(sizeof(INT));
+
+        CMsg =
+            CMsg == NULL ?
+                WSA_CMSG_FIRSTHDR(&WSAMhdr) :
+                WSA_CMSG_NXTHDR(&WSAMhdr, CMsg);
+        QUIC_DBG_ASSERT(CMsg != NULL);
+        CMsg->cmsg_level =
+            RemoteAddress->si_family == AF_INET ? IPPROTO_IP : IPPROTO_IPV6;
+        CMsg->cmsg_type =
+            RemoteAddress->si_family == AF_INET ? IP_ECN : IPV6_ECN;
+        CMsg->cmsg_len = WSA_CMSG_LEN(sizeof(INT));
+        *(PINT)WSA_CMSG_DATA(CMsg) = SendContext->ECN;
+    }
+
     QUIC_DBG_ASSERT(Binding->RemoteAddress.Ipv4.sin_port != 0);
 
     //
@@ -2529,6 +3901,195 @@ Exit:
     return Status;
 }
 
+#ifdef QUIC_WINDOWS_RIO
+//
+// Posts one registered I/O send per datagram, committing them all at once.
+// On failure, nothing was sent and the caller still owns the send context.
+//
+QUIC_STATUS
+QuicDataPathRioSend(
+    _In_ QUIC_UDP_SOCKET_CONTEXT* SocketContext,
+    _In_ const SOCKADDR_INET* LocalAddress,
+    _In_ const SOCKADDR_INET* RemoteAddress,
+    _In_ QUIC_DATAPATH_SEND_CONTEXT* SendContext
+    )
+{
+    QUIC_DATAPATH* Datapath = SocketContext->Binding->Datapath;
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    RIO_BUF RemoteAddressBuf, ControlBuf;
+    UINT8 PostedCount = 0;
+
+    QuicConvertToMappedV6(RemoteAddress, &SendContext->RioRemoteAddress);
+
+    WSACMSGHDR* CMsg =
+        (WSACMSGHDR*)(SendContext->RioControl.Buffer + RIO_CMSG_BASE_SIZE);
+    if (LocalAddress->si_family == AF_INET) {
+        SendContext->RioControl.Header.TotalLength =
+            (ULONG)(RIO_CMSG_BASE_SIZE + WSA_CMSG_SPACE(sizeof(IN_PKTINFO)));
+        CMsg->cmsg_level = IPPROTO_IP;
+        CMsg->cmsg_type = IP_PKTINFO;
+        CMsg->cmsg_len = WSA_CMSG_LEN(sizeof(IN_PKTINFO));
+
+        PIN_PKTINFO PktInfo = (PIN_PKTINFO)WSA_CMSG_DATA(CMsg);
+        PktInfo->ipi_ifindex = LocalAddress->Ipv6.sin6_scope_id;
+        PktInfo->ipi_addr = LocalAddress->Ipv4.sin_addr;
+
+    } else {
+        SendContext->RioControl.Header.TotalLength =
+            (ULONG)(RIO_CMSG_BASE_SIZE + WSA_CMSG_SPACE(sizeof(IN6_PKTINFO)));
+        CMsg->cmsg_level = IPPROTO_IPV6;
+        CMsg->cmsg_type = IPV6_PKTINFO;
+        CMsg->cmsg_len = WSA_CMSG_LEN(sizeof(IN6_PKTINFO));
+
+        PIN6_PKTINFO PktInfo6 = (PIN6_PKTINFO)WSA_CMSG_DATA(CMsg);
+        PktInfo6->ipi6_ifindex = LocalAddress->Ipv6.sin6_scope_id;
+        PktInfo6->ipi6_addr = LocalAddress->Ipv6.sin6_addr;
+    }
+
+    if (SendContext->ECN != QUIC_ECN_NON_ECT) {
+        CMsg =
+            (WSACMSGHDR*)(SendContext->RioControl.Buffer +
+                SendContext->RioControl.Header.TotalLength);
+        SendContext->RioControl.Header.TotalLength += WSA_CMSG_SPACE(sizeof(INT));
+        CMsg->cmsg_level =
+            RemoteAddress->si_family == AF_INET ? IPPROTO_IP : IPPROTO_IPV6;
+        CMsg->cmsg_type =
+            RemoteAddress->si_family == AF_INET ? IP_ECN : IPV6_ECN;
+        CMsg->cmsg_len = WSA_CMSG_LEN(sizeof(INT));
+        *(PINT)WSA_CMSG_DATA(CMsg) = SendContext->ECN;
+    }
+
+    QuicRioBufferDescribe(
+        SendContext,
+        &SendContext->RioRemoteAddress,
+        sizeof(SendContext->RioRemoteAddress),
+        &RemoteAddressBuf);
+    QuicRioBufferDescribe(
+        SendContext,
+        SendContext->RioControl.Buffer,
+        SendContext->RioControl.Header.TotalLength,
+        &ControlBuf);
+
+    //
+    // Completions can run on the socket's processor while later datagrams are
+    // still being posted, so hold an extra reference until done.
+    //
+    SendContext->RioPending = 1;
+
+    QuicLockAcquire(&SocketContext->RioLock);
+    for (UINT8 i = 0; i < SendContext->WsaBufferCount; ++i) {
+        RIO_BUF DataBuf;
+        QuicRioBufferDescribe(
+            SendContext->WsaBuffers[i].buf,
+            SendContext->WsaBuffers[i].buf,
+            SendContext->WsaBuffers[i].len,
+            &DataBuf);
+
+        InterlockedIncrement(&SendContext->RioPending);
+        InterlockedIncrement(&SocketContext->RioOutstanding);
+        if (!Datapath->Rio.RIOSendEx(
+                SocketContext->RioRq,
+                &DataBuf,
+                1,
+                NULL,
+                &RemoteAddressBuf,
+                &ControlBuf,
+                NULL,
+                i + 1 < SendContext->WsaBufferCount ? RIO_MSG_DEFER : 0,
+                SendContext)) {
+            int WsaError = WSAGetLastError();
+            QuicTraceEvent(
+                DatapathErrorStatus,
+                "[ udp][%p] ERROR, %u, %s.",
+                SocketContext->Binding,
+                WsaError,
+                "RIOSendEx");
+            InterlockedDecrement(&SendContext->RioPending);
+            InterlockedDecrement(&SocketContext->RioOutstanding);
+            Status = HRESULT_FROM_WIN32(WsaError);
+            if (PostedCount != 0) {
+                //
+                // Flush the deferred datagrams; the rest are dropped.
+                //
+                (void)Datapath->Rio.RIOSendEx(
+                    SocketContext->RioRq,
+                    NULL,
+                    0,
+                    NULL,
+                    NULL,
+                    NULL,
+                    NULL,
+                    RIO_MSG_COMMIT_ONLY,
+                    NULL);
+            }
+            break;
+        }
+        ++PostedCount;
+    }
+    QuicLockRelease(&SocketContext->RioLock);
+
+    if (PostedCount == 0) {
+        return Status;
+    }
+
+    if (InterlockedDecrement(&SendContext->RioPending) == 0) {
+        //
+        // Everything posted already completed.
+        //
+        QuicDataPathBindingFreeSendContext(SendContext);
+    }
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+void
+QuicDataPathRioProcessSendCompletions(
+    _In_ QUIC_DATAPATH_PROC_CONTEXT* ProcContext
+    )
+{
+    QUIC_DATAPATH* Datapath = ProcContext->Datapath;
+    RIORESULT Results[QUIC_RIO_DEQUEUE_COUNT];
+    ULONG Count;
+
+    while ((Count =
+            Datapath->Rio.RIODequeueCompletion(
+                ProcContext->RioSendCq,
+                Results,
+                ARRAYSIZE(Results))) != 0) {
+        if (Count == RIO_CORRUPT_CQ) {
+            QuicTraceEvent(
+                LibraryError,
+                "[ lib] ERROR, %s.",
+                "RIODequeueCompletion (send) corrupt");
+            break;
+        }
+        for (ULONG i = 0; i < Count; ++i) {
+            QUIC_UDP_SOCKET_CONTEXT* SocketContext =
+                (QUIC_UDP_SOCKET_CONTEXT*)(ULONG_PTR)Results[i].SocketContext;
+            QUIC_DATAPATH_SEND_CONTEXT* SendContext =
+                (QUIC_DATAPATH_SEND_CONTEXT*)(ULONG_PTR)Results[i].RequestContext;
+
+            if (Results[i].Status != NO_ERROR) {
+                QuicTraceEvent(
+                    DatapathErrorStatus,
+                    "[ udp][%p] ERROR, %u, %s.",
+                    SocketContext->Binding,
+                    Results[i].Status,
+                    "RIOSendEx completion");
+            }
+
+            if (InterlockedDecrement(&SendContext->RioPending) == 0) {
+                QuicDataPathBindingFreeSendContext(SendContext);
+            }
+
+            QuicDataPathRioRequestComplete(SocketContext);
+        }
+    }
+
+    (void)Datapath->Rio.RIONotify(ProcContext->RioSendCq);
+}
+#endif
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_STATUS
 QuicDataPathBindingSendFromTo(
@@ -2573,6 +4134,18 @@ QuicDataPathBindingSendFromTo(
         (UINT8*)RemoteAddress,
         (UINT8*)LocalAddress);
 
+#ifdef QUIC_WINDOWS_RIO
+    if (SendContext->Rio) {
+        Status =
+            QuicDataPathRioSend(
+                SocketContext,
+                LocalAddress,
+                RemoteAddress,
+                SendContext);
+        goto Exit;
+    }
+#endif
+
     //
     // Map V4 address to dual-stack socket format.
     //
@@ -2587,7 +4160,10 @@ QuicDataPathBindingSendFromTo(
     WSAMhdr.dwBufferCount = SendContext->WsaBufferCount;
 
     PWSACMSGHDR CMsg;
-    BYTE CtrlBuf[WSA_CMSG_SPACE(sizeof(IN6_PKTINFO)) + WSA_CMSG_SPACE(sizeof(*SegmentSize))];
+    BYTE CtrlBuf[
+        WSA_CMSG_SPACE(sizeof(IN6_PKTINFO)) +
+        WSA_CMSG_SPACE(sizeof(*SegmentSize)) +
+        WSA_CMSG_SPACE(sizeof(INT))];
     WSAMhdr.Control.buf = (PCHAR)CtrlBuf;
 
     if (LocalAddress->si_family == AF_INET) {
@@ -2630,6 +4206,19 @@ QuicDataPathBindingSendFromTo(
     }
 #endif
 
+    if (SendContext->ECN != QUIC_ECN_NON_ECT) {
+        WSAMhdr.Control.len += WSA_CMSG_SPACE(sizeof(INT));
+
+        CMsg = WSA_CMSG_NXTHDR(&WSAMhdr, CMsg);
+        QUIC_DBG_ASSERT(CMsg != NULL);
+        CMsg->cmsg_level =
+            RemoteAddress->si_family == AF_INET ? IPPROTO_IP : IPPROTO_IPV6;
+        CMsg->cmsg_type =
+            RemoteAddress->si_family == AF_INET ? IP_ECN : IPV6_ECN;
+        CMsg->cmsg_len = WSA_CMSG_LEN(sizeof(INT));
+        *(PINT)WSA_CMSG_DATA(CMsg) = SendContext->ECN;
+    }
+
     //
     // Start the async send.
     //
@@ -2676,6 +4265,38 @@ Exit:
     return Status;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicDataPathBindingSendBatch(
+    _In_ QUIC_DATAPATH_BINDING* Binding,
+    _In_ uint32_t EntryCount,
+    _In_reads_(EntryCount) const QUIC_DATAPATH_SEND_ENTRY* Entries
+    )
+{
+    //
+    // Winsock can't send to several remote hosts in one call, so each send
+    // context is submitted on its own.
+    //
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    for (uint32_t i = 0; i < EntryCount; ++i) {
+        QUIC_STATUS EntryStatus =
+            Entries[i].LocalAddress == NULL ?
+                QuicDataPathBindingSendTo(
+                    Binding,
+                    Entries[i].RemoteAddress,
+                    Entries[i].SendContext) :
+                QuicDataPathBindingSendFromTo(
+                    Binding,
+                    Entries[i].LocalAddress,
+                    Entries[i].RemoteAddress,
+                    Entries[i].SendContext);
+        if (QUIC_FAILED(EntryStatus)) {
+            Status = EntryStatus;
+        }
+    }
+    return Status;
+}
+
 DWORD
 WINAPI
 QuicDataPathWorkerThread(
@@ -2713,6 +4334,17 @@ QuicDataPathWorkerThread(
             break;
         }
 
+#ifdef QUIC_WINDOWS_RIO
+        if (Overlapped == &ProcContext->RioRecvOverlapped) {
+            QuicDataPathRioProcessRecvCompletions(ProcContext);
+            continue;
+        }
+        if (Overlapped == &ProcContext->RioSendOverlapped) {
+            QuicDataPathRioProcessSendCompletions(ProcContext);
+            continue;
+        }
+#endif
+
         QUIC_DBG_ASSERT(Overlapped != NULL);
         QUIC_DBG_ASSERT(SocketContext != NULL);
 
@@ -2846,6 +4478,7 @@ QuicFuzzerReceiveInject(
     Datagram->Tuple = &RecvContext->Tuple;
     Datagram->Allocated = TRUE;
     Datagram->QueuedOnConnection = FALSE;
+    Datagram->CryptoOffloaded = FALSE;
     Datagram->Buffer = ((PUCHAR)RecvContext) + Socket->Binding->Datapath->RecvPayloadOffset;
 
     memcpy(Datagram->Buffer, PacketData, Datagram->BufferLength);
@@ -0,0 +1,394 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    In-memory flight recorder for trace events.
+
+    Each processor has a ring of QUIC_FLIGHT_RECORDER_RECORD_COUNT records. A
+    writer claims the next position in its processor's ring with a single
+    interlocked increment, so writers never wait on each other (a thread that
+    migrates or is interrupted mid-write just ends up sharing a ring). Each
+    record carries the position it was written for, which is invalidated
+    before the rest of the record is written and set once it is complete.
+    Readers only use a record if that value is valid, expected for the slot
+    and unchanged after copying it out.
+
+--*/
+
+#include "platform_internal.h"
+#include "quic_flight_recorder.h"
+#ifdef QUIC_CLOG
+#include "flight_recorder.c.clog.h"
+#endif
+
+typedef struct QUIC_CACHEALIGN QUIC_FLIGHT_RECORDER_RING {
+    //
+    // The next position to write, i.e. the total number of records ever
+    // written to this ring.
+    //
+    int64_t volatile Next;
+    QUIC_FLIGHT_RECORD Records[QUIC_FLIGHT_RECORDER_RECORD_COUNT];
+} QUIC_FLIGHT_RECORDER_RING;
+
+QUIC_STATIC_ASSERT(
+    (QUIC_FLIGHT_RECORDER_RECORD_COUNT & (QUIC_FLIGHT_RECORDER_RECORD_COUNT - 1)) == 0,
+    L"Record count must be a power of 2");
+
+typedef struct QUIC_FLIGHT_RECORDER_STATE {
+    QUIC_FLIGHT_RECORDER_RING* Rings;
+    uint32_t RingCount;
+    //
+    // The time (in ms) of the last triggered dump.
+    //
+    int64_t volatile LastTriggerTimeMs;
+} QUIC_FLIGHT_RECORDER_STATE;
+
+QUIC_FLIGHT_RECORDER_STATE QuicFlightRecorder;
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+QUIC_STATUS
+QuicFlightRecorderInitialize(
+    void
+    )
+{
+    QUIC_DBG_ASSERT(QuicFlightRecorder.Rings == NULL);
+    uint32_t RingCount = (uint32_t)QuicProcMaxCount();
+    QUIC_FLIGHT_RECORDER_RING* Rings =
+        QUIC_ALLOC_NONPAGED(RingCount * sizeof(QUIC_FLIGHT_RECORDER_RING));
+    if (Rings == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "flight recorder",
+            RingCount * sizeof(QUIC_FLIGHT_RECORDER_RING));
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    for (uint32_t i = 0; i < RingCount; ++i) {
+        Rings[i].Next = 0;
+        for (uint32_t j = 0; j < QUIC_FLIGHT_RECORDER_RECORD_COUNT; ++j) {
+            Rings[i].Records[j].Sequence = -1;
+        }
+    }
+
+    QuicFlightRecorder.RingCount = RingCount;
+    QuicFlightRecorder.LastTriggerTimeMs = 0;
+    MemoryBarrier();
+    QuicFlightRecorder.Rings = Rings;
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicFlightRecorderUninitialize(
+    void
+    )
+{
+    QUIC_FLIGHT_RECORDER_RING* Rings =
+        (QUIC_FLIGHT_RECORDER_RING*)InterlockedExchangePointer(
+            (void* volatile*)&QuicFlightRecorder.Rings, NULL);
+    if (Rings != NULL) {
+        QUIC_FREE(Rings);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicFlightRecorderWrite(
+    _In_z_ const char* Name,
+    _In_z_ const char* Format,
+    _In_ uint32_t ArgCount,
+    _In_reads_(ArgCount)
+        const uint64_t* Args
+    )
+{
+    QUIC_FLIGHT_RECORDER_RING* Rings = QuicFlightRecorder.Rings;
+    if (Rings == NULL) {
+        return;
+    }
+
+    QUIC_FLIGHT_RECORDER_RING* Ring =
+        &Rings[(uint32_t)QuicProcCurrentNumber() % QuicFlightRecorder.RingCount];
+    int64_t Sequence = InterlockedIncrement64(&Ring->Next) - 1;
+    QUIC_FLIGHT_RECORD* Record =
+        &Ring->Records[Sequence & (QUIC_FLIGHT_RECORDER_RECORD_COUNT - 1)];
+
+    (void)InterlockedExchange64(&Record->Sequence, -1);
+    Record->TimeUs = QuicTimeUs64();
+    Record->Name = Name;
+    Record->Format = Format;
+    if (ArgCount > QUIC_FLIGHT_RECORD_MAX_ARGS) {
+        ArgCount = QUIC_FLIGHT_RECORD_MAX_ARGS;
+    }
+    Record->ArgCount = ArgCount;
+    for (uint32_t i = 0; i < ArgCount; ++i) {
+        Record->Args[i] = Args[i];
+    }
+    (void)InterlockedExchange64(&Record->Sequence, Sequence);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicFlightRecorderEnumerate(
+    _In_ QUIC_FLIGHT_RECORDER_CALLBACK* Callback,
+    _In_opt_ void* Context
+    )
+{
+    QUIC_FLIGHT_RECORDER_RING* Rings = QuicFlightRecorder.Rings;
+    if (Rings == NULL) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < QuicFlightRecorder.RingCount; ++i) {
+        QUIC_FLIGHT_RECORDER_RING* Ring = &Rings[i];
+        int64_t End = InterlockedExchangeAdd64(&Ring->Next, 0);
+        int64_t Start =
+            End > QUIC_FLIGHT_RECORDER_RECORD_COUNT ?
+                End - QUIC_FLIGHT_RECORDER_RECORD_COUNT : 0;
+
+        for (int64_t Sequence = Start; Sequence < End; ++Sequence) {
+            QUIC_FLIGHT_RECORD* Record =
+                &Ring->Records[Sequence & (QUIC_FLIGHT_RECORDER_RECORD_COUNT - 1)];
+            if (InterlockedExchangeAdd64(&Record->Sequence, 0) != Sequence) {
+                continue; // Still being written or already overwritten.
+            }
+            QUIC_FLIGHT_RECORD Copy;
+            QuicCopyMemory(&Copy, Record, sizeof(Copy));
+            if (InterlockedExchangeAdd64(&Record->Sequence, 0) != Sequence) {
+                continue; // Overwritten while being copied.
+            }
+            Callback(Context, i, &Copy);
+        }
+    }
+}
+
+typedef struct QUIC_FLIGHT_RECORD_WRITER {
+    char* Buffer;
+    uint32_t BufferLength;
+    uint32_t Length;
+} QUIC_FLIGHT_RECORD_WRITER;
+
+static
+void
+QuicFlightRecordWriteChar(
+    _Inout_ QUIC_FLIGHT_RECORD_WRITER* Writer,
+    _In_ char Char
+    )
+{
+    if (Writer->Length + 1 < Writer->BufferLength) {
+        Writer->Buffer[Writer->Length++] = Char;
+    }
+}
+
+static
+void
+QuicFlightRecordWriteNumber(
+    _Inout_ QUIC_FLIGHT_RECORD_WRITER* Writer,
+    _In_ uint64_t Value,
+    _In_ uint32_t Base,
+    _In_ BOOLEAN Upper
+    )
+{
+    const char* Digits = Upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char Reversed[20];
+    uint32_t Count = 0;
+    do {
+        Reversed[Count++] = Digits[Value % Base];
+        Value /= Base;
+    } while (Value != 0);
+    while (Count > 0) {
+        QuicFlightRecordWriteChar(Writer, Reversed[--Count]);
+    }
+}
+
+static
+void
+QuicFlightRecordWriteAddress(
+    _Inout_ QUIC_FLIGHT_RECORD_WRITER* Writer,
+    _In_ uint64_t Value
+    )
+{
+    QuicFlightRecordWriteChar(Writer, '0');
+    QuicFlightRecordWriteChar(Writer, 'x');
+    QuicFlightRecordWriteNumber(Writer, Value, 16, FALSE);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+uint32_t
+QuicFlightRecordFormat(
+    _In_ const QUIC_FLIGHT_RECORD* Record,
+    _In_ uint32_t BufferLength,
+    _Out_writes_z_(BufferLength)
+        char* Buffer
+    )
+{
+    QUIC_DBG_ASSERT(BufferLength != 0);
+    QUIC_FLIGHT_RECORD_WRITER Writer = { Buffer, BufferLength, 0 };
+    uint32_t ArgIndex = 0;
+
+    for (const char* Fmt = Record->Format; *Fmt != '\0'; ++Fmt) {
+        if (*Fmt != '%') {
+            QuicFlightRecordWriteChar(&Writer, *Fmt);
+            continue;
+        }
+        ++Fmt;
+        if (*Fmt == '\0') {
+            break;
+        }
+        if (*Fmt == '%') {
+            QuicFlightRecordWriteChar(&Writer, '%');
+            continue;
+        }
+
+        if (*Fmt == '!') {
+            //
+            // Extended types (e.g. %!CID! and %!SOCKADDR!) take a length and
+            // a buffer address.
+            //
+            const char* End = Fmt + 1;
+            while (*End != '\0' && *End != '!') {
+                ++End;
+            }
+            if (*End == '\0') {
+                break;
+            }
+            Fmt = End;
+            if (ArgIndex + 2 > Record->ArgCount) {
+                ArgIndex = Record->ArgCount;
+                QuicFlightRecordWriteChar(&Writer, '?');
+                continue;
+            }
+            QuicFlightRecordWriteAddress(&Writer, Record->Args[ArgIndex + 1]);
+            QuicFlightRecordWriteChar(&Writer, '/');
+            QuicFlightRecordWriteNumber(&Writer, Record->Args[ArgIndex], 10, FALSE);
+            ArgIndex += 2;
+            continue;
+        }
+
+        //
+        // Skip flags, width, precision and length modifiers.
+        //
+        while (*Fmt == '-' || *Fmt == '+' || *Fmt == ' ' || *Fmt == '#' ||
+               *Fmt == '.' || (*Fmt >= '0' && *Fmt <= '9') ||
+               *Fmt == 'h' || *Fmt == 'l' || *Fmt == 'z' || *Fmt == 'I') {
+            ++Fmt;
+        }
+        if (*Fmt == '\0') {
+            break;
+        }
+
+        if (ArgIndex >= Record->ArgCount) {
+            QuicFlightRecordWriteChar(&Writer, '?');
+            continue;
+        }
+        uint64_t Value = Record->Args[ArgIndex++];
+
+        switch (*Fmt) {
+        case 'd':
+        case 'i':
+            if ((int64_t)Value < 0) {
+                QuicFlightRecordWriteChar(&Writer, '-');
+                Value = (uint64_t)(-(int64_t)Value);
+            }
+            QuicFlightRecordWriteNumber(&Writer, Value, 10, FALSE);
+            break;
+        case 'u':
+            QuicFlightRecordWriteNumber(&Writer, Value, 10, FALSE);
+            break;
+        case 'x':
+            QuicFlightRecordWriteNumber(&Writer, Value, 16, FALSE);
+            break;
+        case 'X':
+            QuicFlightRecordWriteNumber(&Writer, Value, 16, TRUE);
+            break;
+        case 'c':
+            QuicFlightRecordWriteChar(
+                &Writer, (Value >= 0x20 && Value < 0x7F) ? (char)Value : '?');
+            break;
+        default:
+            //
+            // Pointers and strings. Strings aren't dereferenced, as they may
+            // not be valid anymore.
+            //
+            QuicFlightRecordWriteAddress(&Writer, Value);
+            break;
+        }
+    }
+
+    Buffer[Writer.Length] = '\0';
+    return Writer.Length;
+}
+
+#define QUIC_FLIGHT_RECORD_MESSAGE_LENGTH 256
+
+static
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Function_class_(QUIC_FLIGHT_RECORDER_CALLBACK)
+void
+QuicFlightRecorderDumpRecord(
+    _In_opt_ void* Context,
+    _In_ uint32_t Processor,
+    _In_ const QUIC_FLIGHT_RECORD* Record
+    )
+{
+    UNREFERENCED_PARAMETER(Context);
+    UNREFERENCED_PARAMETER(Processor);
+    char Message[QUIC_FLIGHT_RECORD_MESSAGE_LENGTH];
+    (void)QuicFlightRecordFormat(Record, sizeof(Message), Message);
+
+    //
+    // Written directly to the trace backend so the dump isn't recorded too.
+    //
+    QuicTraceEventWrite(
+        LibraryFlightRecord,
+        "[ lib] FR[%u][%llu] %s: %s",
+        Processor,
+        Record->TimeUs,
+        Record->Name,
+        Message);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicFlightRecorderDump(
+    _In_z_ const char* Reason
+    )
+{
+    UNREFERENCED_PARAMETER(Reason);
+    if (QuicFlightRecorder.Rings == NULL) {
+        return;
+    }
+    QuicTraceEventWrite(
+        LibraryFlightRecorderDump,
+        "[ lib] Flight recorder dump, %s",
+        Reason);
+    QuicFlightRecorderEnumerate(QuicFlightRecorderDumpRecord, NULL);
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+BOOLEAN
+QuicFlightRecorderTrigger(
+    _In_z_ const char* Reason
+    )
+{
+    if (QuicFlightRecorder.Rings == NULL) {
+        return FALSE;
+    }
+
+    int64_t TimeNow = (int64_t)QuicTimeMs64();
+    int64_t LastTime = QuicFlightRecorder.LastTriggerTimeMs;
+    if (LastTime != 0 &&
+        TimeNow - LastTime < QUIC_FLIGHT_RECORDER_TRIGGER_INTERVAL_MS) {
+        return FALSE;
+    }
+    if (InterlockedCompareExchange64(
+            &QuicFlightRecorder.LastTriggerTimeMs, TimeNow, LastTime) != LastTime) {
+        return FALSE; // Another thread is dumping.
+    }
+    QuicFlightRecorderDump(Reason);
+    return TRUE;
+}
@@ -690,6 +690,9 @@ Synchronization:
 
     Hash lock has to be held by caller in exclusive mode.
 
+    If no Context is passed in, the table may be grown by a single bucket,
+    which only moves entries of the split bucket.
+
 Arguments:
 
     HashTable - Pointer to hash table in which we wish to insert entry
@@ -733,6 +736,17 @@ Arguments:
     }
 
     QuicListInsertHead(ContextPtr->PrevLinkage, &Entry->Linkage);
+
+#ifdef QUIC_HASHTABLE_RESIZE_SUPPORT
+    //
+    // Split (at most) one bucket per insert. Skipped if the caller passed a
+    // context, as splitting may move the entries it points to.
+    //
+    if (Context == NULL &&
+        HashTable->NumEntries > HashTable->TableSize * QUIC_HASH_MAX_LOAD_FACTOR) {
+        (void)QuicHashTableExpand(HashTable);
+    }
+#endif
 }
 
 void
@@ -119,6 +119,19 @@ InterlockedIncrement64(
     _Inout_ _Interlocked_operand_ int64_t volatile *Addend
     );
 
+int64_t
+InterlockedExchange64(
+    _Inout_ _Interlocked_operand_ int64_t volatile *Target,
+    _In_ int64_t Value
+    );
+
+int64_t
+InterlockedCompareExchange64(
+    _Inout_ _Interlocked_operand_ int64_t volatile *Destination,
+    _In_ int64_t ExChange,
+    _In_ int64_t Comperand
+    );
+
 _Must_inspect_result_
 _Success_(return != 0)
 BOOLEAN
@@ -276,3 +289,17 @@ QuicAddrToString(
     _In_ const QUIC_ADDR* Addr,
     _Out_ QUIC_ADDR_STR* AddrStr
     );
+
+#if defined(QUIC_PLATFORM_LINUX) && defined(QUIC_LINUX_XDP)
+uint8_t*
+QuicXdpSocketGetFrame(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _In_ uint64_t Frame
+    );
+
+uint64_t
+QuicXdpSocketGetFrameAddress(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _In_ const uint8_t* Buffer
+    );
+#endif
@@ -69,16 +69,42 @@ typedef struct QUIC_PLATFORM {
     //
     HANDLE Heap;
 
+    //
+    // The file mapping backing the shared memory region, if one exists. Its
+    // name only stays visible to other processes while the handle is open.
+    //
+    HANDLE SharedMemory;
+
 } QUIC_PLATFORM;
 
 #elif QUIC_PLATFORM_LINUX
 
+//
+// The directory settings are read from (overridden by the MSQUIC_STORAGE_PATH
+// environment variable). Each storage key is a subdirectory, and each value a
+// file holding a decimal or hex integer.
+//
+#define QUIC_BASE_STORAGE_PATH "/etc/msquic/"
+
 typedef struct QUIC_PLATFORM {
 
     void* Reserved; // Nothing right now.
 
 } QUIC_PLATFORM;
 
+//
+// Sets up and cleans up the watcher for storage changes.
+//
+void
+QuicStorageInitialize(
+    void
+    );
+
+void
+QuicStorageUninitialize(
+    void
+    );
+
 #else
 
 #error "Unsupported Platform"
@@ -145,6 +171,372 @@ QuicConvertFromMappedV6(
 
 #endif
 
+#if defined(QUIC_PLATFORM_LINUX) && defined(QUIC_LINUX_IO_URING)
+
+#include <linux/io_uring.h>
+
+//
+// A minimal io_uring instance, used by the Linux datapath as an alternative to
+// epoll. Queuing and flushing submissions must be serialized by the caller;
+// completions must only be reaped by a single thread.
+//
+typedef struct QUIC_URING {
+
+    //
+    // The io_uring file descriptor.
+    //
+    int Fd;
+
+    //
+    // Submission queue ring state (shared with the kernel).
+    //
+    uint32_t* SqHead;
+    uint32_t* SqTail;
+    uint32_t* SqRingMask;
+    uint32_t* SqArray;
+    struct io_uring_sqe* Sqes;
+
+    //
+    // The local submission tail; entries up to here have been handed out by
+    // QuicUringGetSqe but may not have been flushed to the kernel yet.
+    //
+    uint32_t SqeTail;
+
+    //
+    // Completion queue ring state (shared with the kernel).
+    //
+    uint32_t* CqHead;
+    uint32_t* CqTail;
+    uint32_t* CqRingMask;
+    struct io_uring_cqe* Cqes;
+
+    //
+    // The IORING_FEAT_* flags reported by the kernel.
+    //
+    uint32_t Features;
+
+    //
+    // The mapped regions backing the rings.
+    //
+    void* SqRing;
+    size_t SqRingSize;
+    void* CqRing;
+    size_t CqRingSize;
+    size_t SqesSize;
+
+} QUIC_URING;
+
+//
+// Creates a ring with (at least) the given number of submission entries.
+//
+QUIC_STATUS
+QuicUringInitialize(
+    _In_ uint32_t EntryCount,
+    _Out_ QUIC_URING* Ring
+    );
+
+void
+QuicUringUninitialize(
+    _In_ QUIC_URING* Ring
+    );
+
+//
+// Returns the next free submission entry, zeroed, or NULL if the submission
+// queue is full. Entries are only made visible to the kernel by QuicUringFlush,
+// so the caller must fill them in first.
+//
+struct io_uring_sqe*
+QuicUringGetSqe(
+    _In_ QUIC_URING* Ring
+    );
+
+//
+// Publishes all entries returned by QuicUringGetSqe to the kernel.
+//
+void
+QuicUringFlush(
+    _In_ QUIC_URING* Ring
+    );
+
+//
+// Submits all flushed entries and, if WaitCount is non-zero, blocks until at
+// least that many completions are available. This may be called without the
+// submission lock held.
+//
+QUIC_STATUS
+QuicUringSubmitAndWait(
+    _In_ QUIC_URING* Ring,
+    _In_ uint32_t WaitCount
+    );
+
+//
+// Returns the oldest unconsumed completion entry, or NULL if there are none.
+//
+struct io_uring_cqe*
+QuicUringPeekCqe(
+    _In_ QUIC_URING* Ring
+    );
+
+//
+// Consumes the completion entry returned by the last QuicUringPeekCqe call.
+//
+void
+QuicUringCqeSeen(
+    _In_ QUIC_URING* Ring
+    );
+
+#endif // QUIC_PLATFORM_LINUX && QUIC_LINUX_IO_URING
+
+#if defined(QUIC_PLATFORM_LINUX) && defined(QUIC_LINUX_XDP)
+
+#include <linux/if_xdp.h>
+
+//
+// The size of each UMEM frame; a frame holds exactly one packet.
+//
+#define QUIC_XDP_FRAME_SIZE 2048
+
+//
+// The number of UMEM frames per AF_XDP socket, shared by receives and sends.
+//
+#define QUIC_XDP_FRAME_COUNT 4096
+
+//
+// The number of entries in each of the AF_XDP rings.
+//
+#define QUIC_XDP_RING_SIZE 2048
+
+//
+// The length of the Ethernet, IPv4 and UDP headers in front of the UDP payload
+// in frames built and parsed by the AF_XDP helpers. Only option-less IPv4
+// headers are supported.
+//
+#define QUIC_XDP_HEADERS_LENGTH (14 + 20 + 8)
+
+//
+// A single producer/single consumer ring shared with the kernel.
+//
+typedef struct QUIC_XDP_RING {
+
+    uint32_t* Producer;
+    uint32_t* Consumer;
+    uint32_t* Flags;
+    void* Descs;
+    uint32_t Mask;
+
+    //
+    // The mapped region backing the ring.
+    //
+    void* Map;
+    size_t MapSize;
+
+} QUIC_XDP_RING;
+
+//
+// The XDP program attached to an interface. It redirects UDP/IPv4 datagrams
+// sent to one of the registered local addresses to the AF_XDP socket of the
+// receive queue they arrived on, and passes everything else (including
+// datagrams on queues without a socket) to the kernel stack.
+//
+typedef struct QUIC_XDP_PROGRAM {
+
+    uint32_t IfIndex;
+
+    //
+    // The number of receive queues of the interface.
+    //
+    uint32_t QueueCount;
+
+    //
+    // The link-layer address of the interface.
+    //
+    uint8_t MacAddress[6];
+
+    int ProgramFd;
+    int LinkFd;
+    int XskMapFd;
+    int AddressMapFd;
+
+} QUIC_XDP_PROGRAM;
+
+//
+// An AF_XDP socket bound to one receive queue of an interface, with its own
+// UMEM. The RX and fill rings must only be used by a single thread. The TX and
+// completion rings and the free frames are protected by Lock.
+//
+typedef struct QUIC_XDP_SOCKET {
+
+    int Fd;
+
+    uint8_t* Umem;
+    size_t UmemSize;
+
+    QUIC_XDP_RING FillRing;
+    QUIC_XDP_RING CompletionRing;
+    QUIC_XDP_RING RxRing;
+    QUIC_XDP_RING TxRing;
+
+    QUIC_LOCK Lock;
+
+    //
+    // Stack of UMEM frame addresses owned by neither the kernel nor the app.
+    //
+    uint64_t FreeFrames[QUIC_XDP_FRAME_COUNT];
+    uint32_t FreeFrameCount;
+
+} QUIC_XDP_SOCKET;
+
+//
+// Returns the index of the interface the IPv4 address is assigned to, or zero
+// if none.
+//
+uint32_t
+QuicXdpGetInterfaceIndex(
+    _In_ const QUIC_ADDR* Address
+    );
+
+//
+// Loads the XDP program and attaches it to the interface. The program is
+// detached when it's uninitialized or the process exits.
+//
+QUIC_STATUS
+QuicXdpProgramInitialize(
+    _In_ uint32_t IfIndex,
+    _Out_ QUIC_XDP_PROGRAM* Program
+    );
+
+void
+QuicXdpProgramUninitialize(
+    _In_ QUIC_XDP_PROGRAM* Program
+    );
+
+//
+// Adds or removes a local IPv4 address (and port) the program redirects.
+//
+QUIC_STATUS
+QuicXdpProgramSetAddress(
+    _In_ QUIC_XDP_PROGRAM* Program,
+    _In_ const QUIC_ADDR* Address,
+    _In_ BOOLEAN Add
+    );
+
+//
+// Creates an AF_XDP socket for the receive queue and adds it to the program.
+// The kernel picks zero-copy mode if the driver supports it, and copy mode
+// otherwise.
+//
+QUIC_STATUS
+QuicXdpSocketInitialize(
+    _In_ QUIC_XDP_PROGRAM* Program,
+    _In_ uint32_t QueueId,
+    _Out_ QUIC_XDP_SOCKET* Socket
+    );
+
+void
+QuicXdpSocketUninitialize(
+    _In_ QUIC_XDP_SOCKET* Socket
+    );
+
+inline
+uint8_t*
+QuicXdpSocketGetFrame(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _In_ uint64_t Frame
+    )
+{
+    return Socket->Umem + Frame;
+}
+
+inline
+uint64_t
+QuicXdpSocketGetFrameAddress(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _In_ const uint8_t* Buffer
+    )
+{
+    //
+    // Any pointer into the frame maps back to the frame's address.
+    //
+    return (uint64_t)(Buffer - Socket->Umem) & ~(uint64_t)(QUIC_XDP_FRAME_SIZE - 1);
+}
+
+_Success_(return != FALSE)
+BOOLEAN
+QuicXdpSocketAllocFrame(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _Out_ uint64_t* Frame
+    );
+
+void
+QuicXdpSocketFreeFrame(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _In_ uint64_t Frame
+    );
+
+//
+// Copies out up to MaxCount received frame descriptors. The frames are owned
+// by the caller until freed.
+//
+uint32_t
+QuicXdpSocketReceive(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _Out_writes_to_(MaxCount, return) struct xdp_desc* Descs,
+    _In_ uint32_t MaxCount
+    );
+
+//
+// Hands free frames back to the kernel for receives. Returns the number of
+// frames the kernel has available for receives afterwards.
+//
+uint32_t
+QuicXdpSocketRefill(
+    _In_ QUIC_XDP_SOCKET* Socket
+    );
+
+//
+// Queues all the frames for transmission, or none of them if the TX ring is
+// full. On success, the frames are owned by the socket again.
+//
+BOOLEAN
+QuicXdpSocketTransmit(
+    _In_ QUIC_XDP_SOCKET* Socket,
+    _In_reads_(Count) const struct xdp_desc* Descs,
+    _In_ uint32_t Count
+    );
+
+//
+// Parses the Ethernet, IPv4 and UDP headers of a received frame. Returns FALSE
+// if the frame isn't a well-formed, unfragmented UDP/IPv4 datagram.
+//
+_Success_(return != FALSE)
+BOOLEAN
+QuicXdpParseHeaders(
+    _In_reads_bytes_(Length) const uint8_t* Frame,
+    _In_ uint32_t Length,
+    _Out_ QUIC_ADDR* LocalAddress,
+    _Out_ QUIC_ADDR* RemoteAddress,
+    _Out_writes_bytes_(6) uint8_t* RemoteMacAddress,
+    _Out_ uint8_t* TypeOfService,
+    _Out_ uint16_t* PayloadLength
+    );
+
+//
+// Writes the Ethernet, IPv4 and UDP headers in front of a payload at offset
+// QUIC_XDP_HEADERS_LENGTH of the frame.
+//
+void
+QuicXdpWriteHeaders(
+    _Out_writes_bytes_(QUIC_XDP_HEADERS_LENGTH) uint8_t* Frame,
+    _In_reads_bytes_(6) const uint8_t* LocalMacAddress,
+    _In_reads_bytes_(6) const uint8_t* RemoteMacAddress,
+    _In_ const QUIC_ADDR* LocalAddress,
+    _In_ const QUIC_ADDR* RemoteAddress,
+    _In_ uint8_t TypeOfService,
+    _In_ uint16_t PayloadLength
+    );
+
+#endif // QUIC_PLATFORM_LINUX && QUIC_LINUX_XDP
+
 //
 // TLS Initialization
 //
@@ -21,6 +21,18 @@ Environment:
 #include <sched.h>
 #include <fcntl.h>
 #include <syslog.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#if defined(__has_include) && defined(__has_builtin)
+#if __has_include(<sys/rseq.h>) && __has_builtin(__builtin_thread_pointer)
+#include <sys/rseq.h>
+#define QUIC_RSEQ 1
+#endif
+#endif
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
 #include "quic_trace.h"
 #include "quic_platform_dispatch.h"
 #ifdef QUIC_CLOG
@@ -37,6 +49,41 @@ int RandomFd; // Used for reading random numbers.
 
 uint64_t QuicTotalMemory;
 
+//
+// The NUMA node of each processor, read from sysfs at initialization. If it
+// can't be, all the processors are assumed to be on node 0.
+//
+uint16_t* QuicProcNumaNodes;
+uint32_t QuicProcNumaNodesCount;
+uint16_t QuicNumaNodes = 1;
+
+#if defined(__x86_64__)
+//
+// QuicTimeUs64 is computed from the (invariant) TSC when the kernel itself
+// uses it as the clock source, which means it is synchronized across cores.
+// The TSC rate is first calibrated against CLOCK_MONOTONIC, and then about
+// every QUIC_TSC_REBASE_US the clock is re-anchored by slewing its rate so it
+// converges back to CLOCK_MONOTONIC (which the datapath shares, e.g. for
+// SO_TXTIME) without ever going backwards. Updates are published with a
+// sequence lock; an odd Sequence means an update is in progress.
+//
+#define QUIC_TSC_CALIBRATION_US 2000
+#define QUIC_TSC_REBASE_US      1000000
+
+typedef struct QUIC_TSC_CLOCK {
+    uint32_t Sequence;
+    uint32_t Enabled;
+    uint64_t BaseTsc;
+    uint64_t BaseUs;
+    uint64_t RebaseTicks;       // Ticks after BaseTsc before re-anchoring.
+    uint64_t UsPerTick;         // Fixed point, 32 fractional bits.
+    uint64_t RefTsc;            // Last CLOCK_MONOTONIC reference point,
+    uint64_t RefUs;             // used to measure the real tick rate.
+} QUIC_TSC_CLOCK;
+
+static QUIC_TSC_CLOCK QuicTscClock;
+#endif
+
 __attribute__((noinline))
 void
 quic_bugcheck(
@@ -65,6 +112,53 @@ QuicPlatformSystemLoad(
 {
 }
 
+//
+// Each /sys/devices/system/cpu/cpuN directory has a nodeM link to its NUMA
+// node (on kernels built with NUMA support).
+//
+static
+void
+QuicProcNumaNodesInitialize(
+    void
+    )
+{
+    uint32_t ProcCount = QuicProcMaxCount();
+    uint16_t* Nodes = QuicAlloc(ProcCount * sizeof(uint16_t));
+    if (Nodes == NULL) {
+        return;
+    }
+
+    uint16_t NodeCount = 1;
+    for (uint32_t i = 0; i < ProcCount; ++i) {
+        Nodes[i] = 0;
+        char Path[64];
+        snprintf(Path, sizeof(Path), "/sys/devices/system/cpu/cpu%u", i);
+        DIR* Dir = opendir(Path);
+        if (Dir == NULL) {
+            continue;
+        }
+        struct dirent* Entry;
+        while ((Entry = readdir(Dir)) != NULL) {
+            if (strncmp(Entry->d_name, "node", 4) == 0 &&
+                Entry->d_name[4] >= '0' && Entry->d_name[4] <= '9') {
+                unsigned long Node = strtoul(Entry->d_name + 4, NULL, 10);
+                if (Node < UINT16_MAX) {
+                    Nodes[i] = (uint16_t)Node;
+                    if (NodeCount <= Nodes[i]) {
+                        NodeCount = Nodes[i] + 1;
+                    }
+                }
+                break;
+            }
+        }
+        closedir(Dir);
+    }
+
+    QuicProcNumaNodes = Nodes;
+    QuicProcNumaNodesCount = ProcCount;
+    QuicNumaNodes = NodeCount;
+}
+
 void
 QuicPlatformSystemUnload(
     void
@@ -72,6 +166,75 @@ QuicPlatformSystemUnload(
 {
 }
 
+static
+uint64_t
+QuicTimeMonotonicUs(
+    void
+    )
+{
+    struct timespec CurrTime = {0};
+    int ErrorCode = clock_gettime(CLOCK_MONOTONIC, &CurrTime);
+    QUIC_DBG_ASSERT(ErrorCode == 0);
+    UNREFERENCED_PARAMETER(ErrorCode);
+    return (CurrTime.tv_sec * QUIC_MICROSEC_PER_SEC) + (CurrTime.tv_nsec / QUIC_NANOSEC_PER_MICROSEC);
+}
+
+static
+void
+QuicTscClockInitialize(
+    void
+    )
+{
+#if defined(__x86_64__)
+    if (QuicTscClock.Enabled) {
+        return; // Keep the clock continuous across reinitialization.
+    }
+
+    uint32_t Eax, Ebx, Ecx, Edx;
+    if (!__get_cpuid(0x80000007, &Eax, &Ebx, &Ecx, &Edx) || !(Edx & (1 << 8))) {
+        return; // No invariant TSC.
+    }
+
+    char ClockSource[16] = {0};
+    FILE* File = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+    if (File == NULL) {
+        return;
+    }
+    BOOLEAN IsTsc =
+        fgets(ClockSource, sizeof(ClockSource), File) != NULL &&
+        strncmp(ClockSource, "tsc", 3) == 0 &&
+        (ClockSource[3] == '\n' || ClockSource[3] == '\0');
+    fclose(File);
+    if (!IsTsc) {
+        return; // The kernel doesn't trust the TSC.
+    }
+
+    const uint64_t StartUs = QuicTimeMonotonicUs();
+    const uint64_t StartTsc = __rdtsc();
+    uint64_t EndUs;
+    do {
+        EndUs = QuicTimeMonotonicUs();
+    } while (EndUs - StartUs < QUIC_TSC_CALIBRATION_US);
+    const uint64_t EndTsc = __rdtsc();
+    if (EndTsc <= StartTsc) {
+        return;
+    }
+
+    QuicTscClock.BaseTsc = EndTsc;
+    QuicTscClock.BaseUs = EndUs;
+    QuicTscClock.RefTsc = EndTsc;
+    QuicTscClock.RefUs = EndUs;
+    QuicTscClock.UsPerTick = ((EndUs - StartUs) << 32) / (EndTsc - StartTsc);
+    QuicTscClock.RebaseTicks =
+        (EndTsc - StartTsc) * QUIC_TSC_REBASE_US / (EndUs - StartUs);
+    if (QuicTscClock.UsPerTick == 0 || QuicTscClock.RebaseTicks == 0) {
+        return;
+    }
+    __atomic_store_n(&QuicTscClock.Enabled, 1, __ATOMIC_RELEASE);
+#endif
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicPlatformInitialize(
     void
@@ -88,6 +251,10 @@ QuicPlatformInitialize(
 
     QuicTotalMemory = 0x40000000; // TODO - Hard coded at 1 GB. Query real value.
 
+    QuicProcNumaNodesInitialize();
+    QuicTscClockInitialize();
+    QuicStorageInitialize();
+
     return QUIC_STATUS_SUCCESS;
 }
 
@@ -96,6 +263,13 @@ QuicPlatformUninitialize(
     void
     )
 {
+    QuicStorageUninitialize();
+    if (QuicProcNumaNodes != NULL) {
+        QuicFree(QuicProcNumaNodes);
+        QuicProcNumaNodes = NULL;
+        QuicProcNumaNodesCount = 0;
+    }
+    QuicNumaNodes = 1;
 #ifndef QUIC_PLATFORM_DISPATCH_TABLE
     close(RandomFd);
 #endif
@@ -125,6 +299,270 @@ QuicFree(
 #endif
 }
 
+#ifndef QUIC_PLATFORM_DISPATCH_TABLE
+
+QUIC_STATIC_ASSERT(
+    sizeof(QUIC_POOL_CPU_CACHE) == 64,
+    "Per-CPU pool caches should fill exactly one cache line");
+
+#define QUIC_LARGE_PAGE_SIZE            0x200000 // 2 MB
+#define QUIC_POOL_ARENA_MAX_CHUNKS      64
+
+//
+// Set while new pool entries (of pools that allow it) are carved out of large
+// pages.
+//
+BOOLEAN QuicLargePageBuffers;
+
+//
+// The large pages a pool's entries are carved from. Entries that are really
+// freed (i.e. not cached by the pool) go back to the arena's free list, and
+// the pages are only released with the pool.
+//
+typedef struct QUIC_POOL_ARENA {
+
+    QUIC_LOCK Lock;
+
+    //
+    // Size of the entries, rounded up to a cache line.
+    //
+    uint32_t EntrySize;
+
+    //
+    // Singly linked list of free entries (through their first bytes).
+    //
+    void* FreeList;
+
+    //
+    // Unused part of the last chunk.
+    //
+    uint8_t* Next;
+    uint8_t* End;
+
+    //
+    // The 2 MB aligned chunks.
+    //
+    uint32_t ChunkCount;
+    uint8_t* Chunks[QUIC_POOL_ARENA_MAX_CHUNKS];
+
+} QUIC_POOL_ARENA;
+
+//
+// Maps a 2 MB aligned chunk, from the reserved huge pages (hugetlbfs) if there
+// are any left, or else from regular pages advised to be transparent huge
+// pages.
+//
+static
+uint8_t*
+QuicLargePageAlloc(
+    void
+    )
+{
+    void* Chunk =
+        mmap(
+            NULL,
+            QUIC_LARGE_PAGE_SIZE,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+            -1,
+            0);
+    if (Chunk != MAP_FAILED) {
+        return (uint8_t*)Chunk;
+    }
+
+    uint8_t* Region =
+        mmap(
+            NULL,
+            2 * QUIC_LARGE_PAGE_SIZE,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0);
+    if (Region == MAP_FAILED) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            errno,
+            "mmap (large page) failed");
+        return NULL;
+    }
+
+    //
+    // Only keep the 2 MB aligned part of the region, so it can be backed by a
+    // single huge page.
+    //
+    uint8_t* Aligned =
+        (uint8_t*)(((uintptr_t)Region + QUIC_LARGE_PAGE_SIZE - 1) &
+            ~(uintptr_t)(QUIC_LARGE_PAGE_SIZE - 1));
+    if (Aligned != Region) {
+        munmap(Region, (size_t)(Aligned - Region));
+    }
+    if (Aligned + QUIC_LARGE_PAGE_SIZE != Region + 2 * QUIC_LARGE_PAGE_SIZE) {
+        munmap(
+            Aligned + QUIC_LARGE_PAGE_SIZE,
+            (size_t)(Region + QUIC_LARGE_PAGE_SIZE - Aligned));
+    }
+    (void)madvise(Aligned, QUIC_LARGE_PAGE_SIZE, MADV_HUGEPAGE); // Best effort.
+    return Aligned;
+}
+
+static
+void*
+QuicPoolArenaAlloc(
+    _Inout_ QUIC_POOL_ARENA* Arena
+    )
+{
+    void* Entry = NULL;
+    QuicLockAcquire(&Arena->Lock);
+    if (Arena->FreeList != NULL) {
+        Entry = Arena->FreeList;
+        Arena->FreeList = *(void**)Entry;
+    } else {
+        if ((size_t)(Arena->End - Arena->Next) < Arena->EntrySize &&
+            Arena->ChunkCount < QUIC_POOL_ARENA_MAX_CHUNKS) {
+            uint8_t* Chunk = QuicLargePageAlloc();
+            if (Chunk != NULL) {
+                Arena->Chunks[Arena->ChunkCount++] = Chunk;
+                Arena->Next = Chunk;
+                Arena->End = Chunk + QUIC_LARGE_PAGE_SIZE;
+            }
+        }
+        if ((size_t)(Arena->End - Arena->Next) >= Arena->EntrySize) {
+            Entry = Arena->Next;
+            Arena->Next += Arena->EntrySize;
+        }
+    }
+    QuicLockRelease(&Arena->Lock);
+    return Entry;
+}
+
+//
+// Frees an entry, which may have been carved from the pool's arena.
+//
+static
+void
+QuicPoolEntryFree(
+    _Inout_ QUIC_POOL* Pool,
+    _In_ void* Entry
+    )
+{
+    QUIC_POOL_ARENA* Arena = Pool->Arena;
+    if (Arena != NULL) {
+        uint8_t* Chunk =
+            (uint8_t*)((uintptr_t)Entry & ~(uintptr_t)(QUIC_LARGE_PAGE_SIZE - 1));
+        QuicLockAcquire(&Arena->Lock);
+        for (uint32_t i = 0; i < Arena->ChunkCount; ++i) {
+            if (Arena->Chunks[i] == Chunk) {
+                *(void**)Entry = Arena->FreeList;
+                Arena->FreeList = Entry;
+                QuicLockRelease(&Arena->Lock);
+                return;
+            }
+        }
+        QuicLockRelease(&Arena->Lock);
+    }
+    QuicFree(Entry);
+}
+
+static
+BOOLEAN
+QuicPoolDepotPush(
+    _Inout_ QUIC_POOL_MAGAZINE** Depot,
+    _In_ QUIC_POOL_MAGAZINE* Magazine
+    )
+{
+    for (uint32_t i = 0; i < QUIC_POOL_DEPOT_SIZE; ++i) {
+        QUIC_POOL_MAGAZINE* Expected = NULL;
+        if (__atomic_compare_exchange_n(
+                &Depot[i], &Expected, Magazine, FALSE,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static
+QUIC_POOL_MAGAZINE*
+QuicPoolDepotPop(
+    _Inout_ QUIC_POOL_MAGAZINE** Depot
+    )
+{
+    for (uint32_t i = 0; i < QUIC_POOL_DEPOT_SIZE; ++i) {
+        if (__atomic_load_n(&Depot[i], __ATOMIC_RELAXED) != NULL) {
+            QUIC_POOL_MAGAZINE* Magazine =
+                __atomic_exchange_n(&Depot[i], NULL, __ATOMIC_ACQUIRE);
+            if (Magazine != NULL) {
+                return Magazine;
+            }
+        }
+    }
+    return NULL;
+}
+
+//
+// Frees all the entries in a magazine and then the magazine itself.
+//
+static
+void
+QuicPoolMagazineFree(
+    _Inout_ QUIC_POOL* Pool,
+    _In_opt_ QUIC_POOL_MAGAZINE* Magazine
+    )
+{
+    if (Magazine != NULL) {
+        for (uint32_t i = 0; i < Magazine->Count; ++i) {
+            QuicPoolEntryFree(Pool, Magazine->Entries[i]);
+        }
+        QuicFree(Magazine);
+    }
+}
+
+//
+// Returns an empty magazine to the depot, or frees it if the depot is full.
+//
+static
+void
+QuicPoolReleaseEmptyMagazine(
+    _Inout_ QUIC_POOL* Pool,
+    _In_ const QUIC_POOL_CPU_CACHE* Cache,
+    _In_opt_ QUIC_POOL_MAGAZINE* Magazine
+    )
+{
+    if (Magazine != NULL &&
+        !QuicPoolDepotPush(Pool->Depots[Cache->Depot].EmptyMagazines, Magazine)) {
+        QuicFree(Magazine);
+    }
+}
+
+static
+QUIC_POOL_CPU_CACHE*
+QuicPoolAcquireCache(
+    _Inout_ QUIC_POOL* Pool
+    )
+{
+    if (Pool->CacheCount == 0) {
+        return NULL;
+    }
+    QUIC_POOL_CPU_CACHE* Cache =
+        &Pool->Caches[QuicProcCurrentNumber() % Pool->CacheCount];
+    if (__atomic_exchange_n(&Cache->Busy, 1, __ATOMIC_ACQUIRE) != 0) {
+        return NULL;
+    }
+    return Cache;
+}
+
+static
+void
+QuicPoolReleaseCache(
+    _Inout_ QUIC_POOL_CPU_CACHE* Cache
+    )
+{
+    __atomic_store_n(&Cache->Busy, 0, __ATOMIC_RELEASE);
+}
+
+#endif // QUIC_PLATFORM_DISPATCH_TABLE
+
 void
 QuicPoolInitialize(
     _In_ BOOLEAN IsPaged,
@@ -136,7 +574,35 @@ QuicPoolInitialize(
     PlatDispatch->PoolInitialize(IsPaged, Size, Pool);
 #else
     UNREFERENCED_PARAMETER(IsPaged);
+    QuicZeroMemory(Pool, sizeof(*Pool));
     Pool->Size = Size;
+
+    //
+    // If the caches can't be allocated, the pool just falls back to
+    // allocating and freeing every entry.
+    //
+    uint32_t CacheCount = QuicProcMaxCount();
+    uint32_t DepotCount = QuicNumaNodeCount();
+    Pool->Caches = QuicAlloc(CacheCount * sizeof(QUIC_POOL_CPU_CACHE));
+    Pool->Depots = QuicAlloc(DepotCount * sizeof(QUIC_POOL_DEPOT));
+    if (Pool->Caches != NULL && Pool->Depots != NULL) {
+        QuicZeroMemory(Pool->Caches, CacheCount * sizeof(QUIC_POOL_CPU_CACHE));
+        QuicZeroMemory(Pool->Depots, DepotCount * sizeof(QUIC_POOL_DEPOT));
+        for (uint32_t i = 0; i < CacheCount; ++i) {
+            Pool->Caches[i].Depot = QuicProcNumaNode(i) % DepotCount;
+        }
+        Pool->CacheCount = CacheCount;
+        Pool->DepotCount = DepotCount;
+    } else {
+        if (Pool->Caches != NULL) {
+            QuicFree(Pool->Caches);
+            Pool->Caches = NULL;
+        }
+        if (Pool->Depots != NULL) {
+            QuicFree(Pool->Depots);
+            Pool->Depots = NULL;
+        }
+    }
 #endif
 }
 
@@ -148,7 +614,40 @@ QuicPoolUninitialize(
 #ifdef QUIC_PLATFORM_DISPATCH_TABLE
     PlatDispatch->PoolUninitialize(Pool);
 #else
-    UNREFERENCED_PARAMETER(Pool);
+    uint64_t Hits, Misses;
+    QuicPoolGetStatistics(Pool, &Hits, &Misses);
+    QuicTraceLogVerbose(
+        PoolStatistics,
+        "[pool][%p] Size=%u Hits=%llu Misses=%llu",
+        Pool,
+        Pool->Size,
+        Hits,
+        Misses);
+
+    for (uint32_t i = 0; i < Pool->CacheCount; ++i) {
+        QuicPoolMagazineFree(Pool, Pool->Caches[i].Loaded);
+        QuicPoolMagazineFree(Pool, Pool->Caches[i].Previous);
+    }
+    for (uint32_t i = 0; i < Pool->DepotCount; ++i) {
+        for (uint32_t j = 0; j < QUIC_POOL_DEPOT_SIZE; ++j) {
+            QuicPoolMagazineFree(Pool, Pool->Depots[i].FullMagazines[j]);
+            QuicPoolMagazineFree(Pool, Pool->Depots[i].EmptyMagazines[j]);
+        }
+    }
+    if (Pool->Caches != NULL) {
+        QuicFree(Pool->Caches);
+    }
+    if (Pool->Depots != NULL) {
+        QuicFree(Pool->Depots);
+    }
+    if (Pool->Arena != NULL) {
+        for (uint32_t i = 0; i < Pool->Arena->ChunkCount; ++i) {
+            munmap(Pool->Arena->Chunks[i], QUIC_LARGE_PAGE_SIZE);
+        }
+        QuicLockUninitialize(&Pool->Arena->Lock);
+        QuicFree(Pool->Arena);
+    }
+    QuicZeroMemory(Pool, sizeof(*Pool));
 #endif
 }
 
@@ -160,7 +659,49 @@ QuicPoolAlloc(
 #ifdef QUIC_PLATFORM_DISPATCH_TABLE
     return PlatDispatch->PoolAlloc(Pool);
 #else
-    void*Entry = QuicAlloc(Pool->Size);
+    void* Entry = NULL;
+
+    QUIC_POOL_CPU_CACHE* Cache = QuicPoolAcquireCache(Pool);
+    if (Cache != NULL) {
+        if (Cache->Loaded == NULL || Cache->Loaded->Count == 0) {
+            if (Cache->Previous != NULL && Cache->Previous->Count != 0) {
+                QUIC_POOL_MAGAZINE* Temp = Cache->Loaded;
+                Cache->Loaded = Cache->Previous;
+                Cache->Previous = Temp;
+            } else {
+                QUIC_POOL_MAGAZINE* Full =
+                    QuicPoolDepotPop(Pool->Depots[Cache->Depot].FullMagazines);
+                if (Full != NULL) {
+                    //
+                    // Both local magazines are empty (or missing), so keep
+                    // one to free to and give the other back to the depot.
+                    //
+                    QuicPoolReleaseEmptyMagazine(Pool, Cache, Cache->Previous);
+                    Cache->Previous = Cache->Loaded;
+                    Cache->Loaded = Full;
+                }
+            }
+        }
+
+        if (Cache->Loaded != NULL && Cache->Loaded->Count != 0) {
+            Entry = Cache->Loaded->Entries[--Cache->Loaded->Count];
+            Cache->Hits++;
+        } else {
+            Cache->Misses++;
+        }
+        QuicPoolReleaseCache(Cache);
+
+    } else if (Pool->CacheCount != 0) {
+        __atomic_add_fetch(&Pool->ContendedMisses, 1, __ATOMIC_RELAXED);
+    }
+
+    if (Entry == NULL && Pool->Arena != NULL && QuicLargePageBuffers) {
+        Entry = QuicPoolArenaAlloc(Pool->Arena);
+    }
+
+    if (Entry == NULL) {
+        Entry = QuicAlloc(Pool->Size);
+    }
 
     if (Entry != NULL) {
         QuicZeroMemory(Entry, Pool->Size);
@@ -179,8 +720,176 @@ QuicPoolFree(
 #ifdef QUIC_PLATFORM_DISPATCH_TABLE
     PlatDispatch->PoolFree(Pool, Entry);
 #else
+    QUIC_POOL_CPU_CACHE* Cache = QuicPoolAcquireCache(Pool);
+    if (Cache == NULL) {
+        QuicPoolEntryFree(Pool, Entry);
+        return;
+    }
+
+    if (Cache->Loaded == NULL ||
+        Cache->Loaded->Count == QUIC_POOL_MAGAZINE_SIZE) {
+        if (Cache->Previous != NULL &&
+            Cache->Previous->Count != QUIC_POOL_MAGAZINE_SIZE) {
+            QUIC_POOL_MAGAZINE* Temp = Cache->Loaded;
+            Cache->Loaded = Cache->Previous;
+            Cache->Previous = Temp;
+        } else {
+            QUIC_POOL_MAGAZINE* Empty =
+                QuicPoolDepotPop(Pool->Depots[Cache->Depot].EmptyMagazines);
+            if (Empty == NULL) {
+                Empty = QuicAlloc(sizeof(QUIC_POOL_MAGAZINE));
+            }
+            if (Empty == NULL) {
+                QuicPoolReleaseCache(Cache);
+                QuicPoolEntryFree(Pool, Entry);
+                return;
+            }
+            Empty->Count = 0;
+
+            //
+            // Both local magazines are full (or missing), so keep one to
+            // allocate from and hand the other to the depot, for any CPU of
+            // the node to use. If the depot is full too, the entries are
+            // really freed.
+            //
+            if (Cache->Previous != NULL &&
+                !QuicPoolDepotPush(
+                    Pool->Depots[Cache->Depot].FullMagazines, Cache->Previous)) {
+                QuicPoolMagazineFree(Pool, Cache->Previous);
+            }
+            Cache->Previous = Cache->Loaded;
+            Cache->Loaded = Empty;
+        }
+    }
+
+    Cache->Loaded->Entries[Cache->Loaded->Count++] = Entry;
+    QuicPoolReleaseCache(Cache);
+#endif
+}
+
+void
+QuicPoolEnableLargePages(
+    _Inout_ QUIC_POOL* Pool
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
     UNREFERENCED_PARAMETER(Pool);
-    QuicFree(Entry);
+#else
+    QUIC_DBG_ASSERT(Pool->Arena == NULL);
+    if (Pool->Size > QUIC_LARGE_PAGE_SIZE) {
+        return;
+    }
+    QUIC_POOL_ARENA* Arena = QuicAlloc(sizeof(QUIC_POOL_ARENA));
+    if (Arena == NULL) {
+        return; // Entries are just allocated individually.
+    }
+    QuicZeroMemory(Arena, sizeof(*Arena));
+    QuicLockInitialize(&Arena->Lock);
+    Arena->EntrySize = (Pool->Size + 63) & ~63u; // Cache line aligned.
+    Pool->Arena = Arena;
+#endif
+}
+
+QUIC_STATUS
+QuicSetLargePageBuffers(
+    _In_ BOOLEAN Enabled
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    return Enabled ? QUIC_STATUS_NOT_SUPPORTED : QUIC_STATUS_SUCCESS;
+#else
+    __atomic_store_n(&QuicLargePageBuffers, Enabled, __ATOMIC_RELAXED);
+    return QUIC_STATUS_SUCCESS;
+#endif
+}
+
+BOOLEAN
+QuicGetLargePageBuffers(
+    void
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    return FALSE;
+#else
+    return __atomic_load_n(&QuicLargePageBuffers, __ATOMIC_RELAXED);
+#endif
+}
+
+void*
+QuicSharedMemoryCreate(
+    _In_z_ const char* Name,
+    _In_ uint32_t Size
+    )
+{
+    //
+    // Readable by other users too, since the monitoring agent reading the
+    // region generally runs as a different user.
+    //
+    int Fd = shm_open(Name, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (Fd < 0) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            errno,
+            "shm_open failed");
+        return NULL;
+    }
+
+    void* Buffer = NULL;
+    if (ftruncate(Fd, Size) != 0) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            errno,
+            "ftruncate (shared memory) failed");
+    } else {
+        Buffer = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+        if (Buffer == MAP_FAILED) {
+            QuicTraceEvent(
+                LibraryErrorStatus,
+                "[ lib] ERROR, %u, %s.",
+                errno,
+                "mmap (shared memory) failed");
+            Buffer = NULL;
+        }
+    }
+
+    close(Fd);
+    if (Buffer == NULL) {
+        shm_unlink(Name);
+    }
+    return Buffer;
+}
+
+void
+QuicSharedMemoryDelete(
+    _In_z_ const char* Name,
+    _In_ void* Buffer,
+    _In_ uint32_t Size
+    )
+{
+    munmap(Buffer, Size);
+    shm_unlink(Name);
+}
+
+void
+QuicPoolGetStatistics(
+    _In_ const QUIC_POOL* Pool,
+    _Out_ uint64_t* Hits,
+    _Out_ uint64_t* Misses
+    )
+{
+#ifdef QUIC_PLATFORM_DISPATCH_TABLE
+    UNREFERENCED_PARAMETER(Pool);
+    *Hits = 0;
+    *Misses = 0;
+#else
+    *Hits = 0;
+    *Misses = __atomic_load_n(&Pool->ContendedMisses, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < Pool->CacheCount; ++i) {
+        *Hits += __atomic_load_n(&Pool->Caches[i].Hits, __ATOMIC_RELAXED);
+        *Misses += __atomic_load_n(&Pool->Caches[i].Misses, __ATOMIC_RELAXED);
+    }
 #endif
 }
 
@@ -478,16 +1187,103 @@ QuicGetTimerResolution(
     return QuicTimespecToUs(&Res);
 }
 
+#if defined(__x86_64__)
+//
+// Re-anchors the TSC clock at (Tsc, NowUs), choosing the rate for the next
+// period so that the clock reaches CLOCK_MONOTONIC by the end of it. The
+// correction is limited to half the period, so the clock keeps moving forward.
+//
+static
+void
+QuicTscClockRebase(
+    _In_ uint32_t Sequence,
+    _In_ uint64_t Tsc,
+    _In_ uint64_t NowUs
+    )
+{
+    if (!__atomic_compare_exchange_n(
+            &QuicTscClock.Sequence, &Sequence, Sequence + 1,
+            FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return; // Another thread is already rebasing.
+    }
+
+    const uint64_t MonotonicUs = QuicTimeMonotonicUs();
+    if (Tsc > QuicTscClock.RefTsc && MonotonicUs > QuicTscClock.RefUs) {
+        //
+        // Measure the tick rate over the whole period since the last
+        // reference point, which is far more precise than the calibration.
+        //
+        const uint64_t Ticks = Tsc - QuicTscClock.RefTsc;
+        const uint64_t Us = MonotonicUs - QuicTscClock.RefUs;
+        const uint64_t RebaseTicks =
+            (uint64_t)(((unsigned __int128)Ticks * QUIC_TSC_REBASE_US) / Us);
+        if (RebaseTicks != 0) {
+            QuicTscClock.RebaseTicks = RebaseTicks;
+        }
+    }
+    QuicTscClock.RefTsc = Tsc;
+    QuicTscClock.RefUs = MonotonicUs;
+
+    int64_t CorrectionUs;
+    if (MonotonicUs > NowUs + QUIC_TSC_REBASE_US) {
+        NowUs = MonotonicUs; // Far behind (e.g. long idle), just jump ahead.
+        CorrectionUs = 0;
+    } else {
+        CorrectionUs = (int64_t)(MonotonicUs - NowUs);
+        if (CorrectionUs > QUIC_TSC_REBASE_US / 2) {
+            CorrectionUs = QUIC_TSC_REBASE_US / 2;
+        } else if (CorrectionUs < -(QUIC_TSC_REBASE_US / 2)) {
+            CorrectionUs = -(QUIC_TSC_REBASE_US / 2);
+        }
+    }
+
+    QuicTscClock.BaseTsc = Tsc;
+    QuicTscClock.BaseUs = NowUs;
+    QuicTscClock.UsPerTick =
+        (uint64_t)((((unsigned __int128)(QUIC_TSC_REBASE_US + CorrectionUs)) << 32) /
+            QuicTscClock.RebaseTicks);
+
+    __atomic_store_n(&QuicTscClock.Sequence, Sequence + 2, __ATOMIC_RELEASE);
+}
+#endif
+
 uint64_t
 QuicTimeUs64(
     void
     )
 {
-    struct timespec CurrTime = {0};
-    int ErrorCode = clock_gettime(CLOCK_MONOTONIC, &CurrTime);
-    QUIC_DBG_ASSERT(ErrorCode == 0);
-    UNREFERENCED_PARAMETER(ErrorCode);
-    return QuicTimespecToUs(&CurrTime);
+#if defined(__x86_64__)
+    if (__atomic_load_n(&QuicTscClock.Enabled, __ATOMIC_ACQUIRE)) {
+        for (;;) {
+            const uint32_t Sequence =
+                __atomic_load_n(&QuicTscClock.Sequence, __ATOMIC_ACQUIRE);
+            if (Sequence & 1) {
+                continue; // Update in progress.
+            }
+            const uint64_t BaseTsc = QuicTscClock.BaseTsc;
+            const uint64_t BaseUs = QuicTscClock.BaseUs;
+            const uint64_t UsPerTick = QuicTscClock.UsPerTick;
+            const uint64_t RebaseTicks = QuicTscClock.RebaseTicks;
+            const uint64_t Tsc = __rdtsc();
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&QuicTscClock.Sequence, __ATOMIC_RELAXED) != Sequence) {
+                continue;
+            }
+            if (Tsc < BaseTsc) {
+                return BaseUs; // Read before a concurrent rebase published.
+            }
+            const uint64_t NowUs =
+                BaseUs +
+                (uint64_t)(((unsigned __int128)(Tsc - BaseTsc) * UsPerTick) >> 32);
+            if (Tsc - BaseTsc >= RebaseTicks) {
+                QuicTscClockRebase(Sequence, Tsc, NowUs);
+            }
+            return NowUs;
+        }
+    }
+#endif
+
+    return QuicTimeMonotonicUs();
 }
 
 void
@@ -547,14 +1343,166 @@ QuicProcActiveCount(
     return (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
 }
 
+//
+// The number of YieldProcessor calls after the last failed attempt to acquire
+// a contended dispatch lock, before blocking. The delay doubles after each
+// failed attempt.
+//
+#define QUIC_DISPATCH_LOCK_MAX_BACKOFF 64
+
+uint64_t QuicDispatchLockContendedCount;
+uint64_t QuicDispatchLockParkedCount;
+
+static
+int
+QuicDispatchLockTryMutex(
+    _Inout_ void* Lock
+    )
+{
+    return pthread_mutex_trylock((pthread_mutex_t*)Lock);
+}
+
+static
+int
+QuicDispatchLockTryShared(
+    _Inout_ void* Lock
+    )
+{
+    return pthread_rwlock_tryrdlock((pthread_rwlock_t*)Lock);
+}
+
+static
+int
+QuicDispatchLockTryExclusive(
+    _Inout_ void* Lock
+    )
+{
+    return pthread_rwlock_trywrlock((pthread_rwlock_t*)Lock);
+}
+
+//
+// Spins on a contended lock. Returns FALSE if it still isn't acquired, in
+// which case the caller must block on it.
+//
+static
+BOOLEAN
+QuicDispatchLockSpin(
+    _In_ int (*TryAcquire)(void*),
+    _Inout_ void* Lock
+    )
+{
+    __atomic_add_fetch(&QuicDispatchLockContendedCount, 1, __ATOMIC_RELAXED);
+    for (uint32_t Backoff = 1; Backoff <= QUIC_DISPATCH_LOCK_MAX_BACKOFF; Backoff <<= 1) {
+        for (uint32_t i = 0; i < Backoff; ++i) {
+            YieldProcessor();
+        }
+        if (TryAcquire(Lock) == 0) {
+            return TRUE;
+        }
+    }
+    __atomic_add_fetch(&QuicDispatchLockParkedCount, 1, __ATOMIC_RELAXED);
+    return FALSE;
+}
+
+void
+QuicDispatchLockAcquireContended(
+    _Inout_ QUIC_DISPATCH_LOCK* Lock
+    )
+{
+    if (!QuicDispatchLockSpin(QuicDispatchLockTryMutex, &Lock->Mutex)) {
+        QUIC_FRE_ASSERT(pthread_mutex_lock(&Lock->Mutex) == 0);
+    }
+}
+
+void
+QuicDispatchRwLockAcquireSharedContended(
+    _Inout_ QUIC_DISPATCH_RW_LOCK* Lock
+    )
+{
+    if (!QuicDispatchLockSpin(QuicDispatchLockTryShared, &Lock->RwLock)) {
+        QUIC_FRE_ASSERT(pthread_rwlock_rdlock(&Lock->RwLock) == 0);
+    }
+}
+
+void
+QuicDispatchRwLockAcquireExclusiveContended(
+    _Inout_ QUIC_DISPATCH_RW_LOCK* Lock
+    )
+{
+    if (!QuicDispatchLockSpin(QuicDispatchLockTryExclusive, &Lock->RwLock)) {
+        QUIC_FRE_ASSERT(pthread_rwlock_wrlock(&Lock->RwLock) == 0);
+    }
+}
+
+void
+QuicDispatchLockGetStatistics(
+    _Out_ uint64_t* Contended,
+    _Out_ uint64_t* Parked
+    )
+{
+    *Contended = __atomic_load_n(&QuicDispatchLockContendedCount, __ATOMIC_RELAXED);
+    *Parked = __atomic_load_n(&QuicDispatchLockParkedCount, __ATOMIC_RELAXED);
+}
+
 uint32_t
 QuicProcCurrentNumber(
     void
     )
 {
+#ifdef QUIC_RSEQ
+    //
+    // glibc registers a restartable sequences area for each thread (unless
+    // disabled), in which the kernel keeps the thread's current CPU up to
+    // date. Reading it is a plain load instead of a call.
+    //
+    if (__rseq_size != 0) {
+        const struct rseq* Rseq =
+            (const struct rseq*)((uint8_t*)__builtin_thread_pointer() + __rseq_offset);
+        const int32_t CpuId = (int32_t)__atomic_load_n(&Rseq->cpu_id, __ATOMIC_RELAXED);
+        if (CpuId >= 0) {
+            return (uint32_t)CpuId;
+        }
+    }
+#endif
     return (uint32_t)sched_getcpu();
 }
 
+uint16_t
+QuicProcNumaNode(
+    _In_ uint32_t Index
+    )
+{
+    return Index < QuicProcNumaNodesCount ? QuicProcNumaNodes[Index] : 0;
+}
+
+uint16_t
+QuicNumaNodeCount(
+    void
+    )
+{
+    return QuicNumaNodes;
+}
+
+//
+// Allows the thread to run on any processor of the ideal processor's NUMA
+// node, so its memory stays local.
+//
+static
+void
+QuicThreadNumaAffinity(
+    _In_ uint8_t IdealProcessor,
+    _Out_ cpu_set_t* CpuSet
+    )
+{
+    uint16_t Node = QuicProcNumaNode(IdealProcessor);
+    CPU_ZERO(CpuSet);
+    for (uint32_t i = 0; i < QuicProcNumaNodesCount && i < CPU_SETSIZE; ++i) {
+        if (QuicProcNumaNodes[i] == Node) {
+            CPU_SET(i, CpuSet);
+        }
+    }
+}
+
 QUIC_STATUS
 QuicRandom(
     _In_ uint32_t BufferLen,
@@ -654,8 +1602,15 @@ QuicThreadCreate(
                     "[ lib] ERROR, %s.",
                     "pthread_attr_setaffinity_np failed");
             }
-        } else {
-            // TODO - Set Linux equivalent of NUMA affinity.
+        } else if (QuicNumaNodes > 1) {
+            cpu_set_t CpuSet;
+            QuicThreadNumaAffinity(Config->IdealProcessor, &CpuSet);
+            if (pthread_attr_setaffinity_np(&Attr, sizeof(CpuSet), &CpuSet)) {
+                QuicTraceEvent(
+                    LibraryError,
+                    "[ lib] ERROR, %s.",
+                    "pthread_attr_setaffinity_np failed");
+            }
         }
     }
 #endif
@@ -695,8 +1650,15 @@ QuicThreadCreate(
                     "[ lib] ERROR, %s.",
                     "pthread_setaffinity_np failed");
             }
-        } else {
-            // TODO - Set Linux equivalent of NUMA affinity.
+        } else if (QuicNumaNodes > 1) {
+            cpu_set_t CpuSet;
+            QuicThreadNumaAffinity(Config->IdealProcessor, &CpuSet);
+            if (pthread_setaffinity_np(*Thread, sizeof(CpuSet), &CpuSet)) {
+                QuicTraceEvent(
+                    LibraryError,
+                    "[ lib] ERROR, %s.",
+                    "pthread_setaffinity_np failed");
+            }
         }
     }
 #endif
@@ -199,6 +199,72 @@ QuicFree(
     (void)HeapFree(QuicPlatform.Heap, 0, Mem);
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void*
+QuicSharedMemoryCreate(
+    _In_z_ const char* Name,
+    _In_ uint32_t Size
+    )
+{
+    QUIC_DBG_ASSERT(QuicPlatform.SharedMemory == NULL);
+
+    HANDLE Mapping =
+        CreateFileMappingA(
+            INVALID_HANDLE_VALUE,
+            NULL,
+            PAGE_READWRITE,
+            0,
+            Size,
+            Name);
+    if (Mapping == NULL) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            GetLastError(),
+            "CreateFileMappingA failed");
+        return NULL;
+    }
+
+    //
+    // A new pagefile backed section is already zeroed, but one that's still
+    // open elsewhere (e.g. by a reader of a previous instance) isn't.
+    //
+    BOOLEAN Existed = GetLastError() == ERROR_ALREADY_EXISTS;
+
+    void* Buffer = MapViewOfFile(Mapping, FILE_MAP_WRITE, 0, 0, Size);
+    if (Buffer == NULL) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            GetLastError(),
+            "MapViewOfFile failed");
+        CloseHandle(Mapping);
+        return NULL;
+    }
+
+    if (Existed) {
+        QuicZeroMemory(Buffer, Size);
+    }
+
+    QuicPlatform.SharedMemory = Mapping;
+    return Buffer;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void
+QuicSharedMemoryDelete(
+    _In_z_ const char* Name,
+    _In_ void* Buffer,
+    _In_ uint32_t Size
+    )
+{
+    UNREFERENCED_PARAMETER(Name);
+    UNREFERENCED_PARAMETER(Size);
+    (void)UnmapViewOfFile(Buffer);
+    (void)CloseHandle(QuicPlatform.SharedMemory);
+    QuicPlatform.SharedMemory = NULL;
+}
+
 __declspec(noreturn)
 void
 KrmlExit(
@@ -0,0 +1,169 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    A buffered CSPRNG built on the ChaCha20 keystream (RFC 8439).
+
+    Each refill generates QUIC_RANDOM_STREAM_BLOCK_COUNT blocks from the
+    current key (with a zero nonce and counters starting at zero). The first
+    QUIC_CHACHA20_KEY_SIZE bytes become the next key and the rest is handed
+    out, zeroed as it is consumed. Since a key is never used for more than one
+    refill, the all zero nonce is fine. Every
+    QUIC_RANDOM_STREAM_RESEED_INTERVAL refills the key is replaced with
+    bytes from the platform RNG.
+
+--*/
+
+#include "platform_internal.h"
+#ifdef QUIC_CLOG
+#include "random_stream.c.clog.h"
+#endif
+
+#define QUIC_CHACHA20_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define QUIC_CHACHA20_QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = QUIC_CHACHA20_ROTL(d, 16); \
+    c += d; b ^= c; b = QUIC_CHACHA20_ROTL(b, 12); \
+    a += b; d ^= a; d = QUIC_CHACHA20_ROTL(d, 8); \
+    c += d; b ^= c; b = QUIC_CHACHA20_ROTL(b, 7)
+
+void
+QuicChaCha20Block(
+    _In_reads_(QUIC_CHACHA20_KEY_SIZE / sizeof(uint32_t))
+        const uint32_t* Key,
+    _In_ uint32_t Counter,
+    _In_reads_(3)
+        const uint32_t* Nonce,
+    _Out_writes_bytes_(QUIC_CHACHA20_BLOCK_SIZE)
+        uint8_t* Output
+    )
+{
+    uint32_t State[16] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574, // "expand 32-byte k"
+        Key[0], Key[1], Key[2], Key[3],
+        Key[4], Key[5], Key[6], Key[7],
+        Counter, Nonce[0], Nonce[1], Nonce[2]
+    };
+    uint32_t x[16];
+    QuicCopyMemory(x, State, sizeof(x));
+
+    for (uint32_t i = 0; i < 10; ++i) {
+        QUIC_CHACHA20_QUARTER_ROUND(x[0], x[4], x[8],  x[12]);
+        QUIC_CHACHA20_QUARTER_ROUND(x[1], x[5], x[9],  x[13]);
+        QUIC_CHACHA20_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        QUIC_CHACHA20_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        QUIC_CHACHA20_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        QUIC_CHACHA20_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        QUIC_CHACHA20_QUARTER_ROUND(x[2], x[7], x[8],  x[13]);
+        QUIC_CHACHA20_QUARTER_ROUND(x[3], x[4], x[9],  x[14]);
+    }
+
+    for (uint32_t i = 0; i < 16; ++i) {
+        uint32_t Word = x[i] + State[i];
+        Output[i * 4]     = (uint8_t)Word;
+        Output[i * 4 + 1] = (uint8_t)(Word >> 8);
+        Output[i * 4 + 2] = (uint8_t)(Word >> 16);
+        Output[i * 4 + 3] = (uint8_t)(Word >> 24);
+    }
+
+    QuicSecureZeroMemory(x, sizeof(x));
+    QuicSecureZeroMemory(State, sizeof(State));
+}
+
+QUIC_STATUS
+QuicRandomStreamInitialize(
+    _Out_ QUIC_RANDOM_STREAM* Stream
+    )
+{
+    QUIC_STATUS Status = QuicRandom(sizeof(Stream->Key), Stream->Key);
+    if (QUIC_FAILED(Status)) {
+        return Status;
+    }
+    Stream->RefillsUntilReseed = QUIC_RANDOM_STREAM_RESEED_INTERVAL;
+    Stream->Offset = sizeof(Stream->Buffer); // Empty
+    QuicZeroMemory(Stream->Buffer, sizeof(Stream->Buffer));
+    return QUIC_STATUS_SUCCESS;
+}
+
+void
+QuicRandomStreamUninitialize(
+    _Inout_ QUIC_RANDOM_STREAM* Stream
+    )
+{
+    QuicSecureZeroMemory(Stream, sizeof(*Stream));
+}
+
+static
+void
+QuicRandomStreamRefill(
+    _Inout_ QUIC_RANDOM_STREAM* Stream
+    )
+{
+    if (--Stream->RefillsUntilReseed == 0) {
+        //
+        // On failure, keep going with the current key (which is still only
+        // derived from the last seed) and try again on the next refill.
+        //
+        uint32_t Seed[QUIC_CHACHA20_KEY_SIZE / sizeof(uint32_t)];
+        if (QUIC_SUCCEEDED(QuicRandom(sizeof(Seed), Seed))) {
+            QuicCopyMemory(Stream->Key, Seed, sizeof(Stream->Key));
+            Stream->RefillsUntilReseed = QUIC_RANDOM_STREAM_RESEED_INTERVAL;
+        } else {
+            Stream->RefillsUntilReseed = 1;
+        }
+        QuicSecureZeroMemory(Seed, sizeof(Seed));
+    }
+
+    const uint32_t Nonce[3] = { 0, 0, 0 };
+    for (uint32_t i = 0; i < QUIC_RANDOM_STREAM_BLOCK_COUNT; ++i) {
+        QuicChaCha20Block(
+            Stream->Key,
+            i,
+            Nonce,
+            Stream->Buffer + i * QUIC_CHACHA20_BLOCK_SIZE);
+    }
+
+    //
+    // Replace the key with the start of the keystream, and erase it from the
+    // buffer.
+    //
+    for (uint32_t i = 0; i < ARRAYSIZE(Stream->Key); ++i) {
+        Stream->Key[i] =
+            (uint32_t)Stream->Buffer[i * 4] |
+            ((uint32_t)Stream->Buffer[i * 4 + 1] << 8) |
+            ((uint32_t)Stream->Buffer[i * 4 + 2] << 16) |
+            ((uint32_t)Stream->Buffer[i * 4 + 3] << 24);
+    }
+    QuicSecureZeroMemory(Stream->Buffer, sizeof(Stream->Key));
+    Stream->Offset = sizeof(Stream->Key);
+}
+
+void
+QuicRandomStreamRead(
+    _Inout_ QUIC_RANDOM_STREAM* Stream,
+    _In_ uint32_t BufferLength,
+    _Out_writes_bytes_(BufferLength)
+        void* Buffer
+    )
+{
+    uint8_t* Output = (uint8_t*)Buffer;
+    while (BufferLength > 0) {
+        if (Stream->Offset == sizeof(Stream->Buffer)) {
+            QuicRandomStreamRefill(Stream);
+        }
+
+        uint32_t CopyLength = sizeof(Stream->Buffer) - Stream->Offset;
+        if (CopyLength > BufferLength) {
+            CopyLength = BufferLength;
+        }
+
+        QuicCopyMemory(Output, Stream->Buffer + Stream->Offset, CopyLength);
+        QuicSecureZeroMemory(Stream->Buffer + Stream->Offset, CopyLength);
+        Stream->Offset += CopyLength;
+        Output += CopyLength;
+        BufferLength -= CopyLength;
+    }
+}
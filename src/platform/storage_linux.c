@@ -7,6 +7,16 @@ Abstract:
 
     QUIC Platform Abstraction Layer storage interface.
 
+    The storage is a directory tree, rooted at QUIC_BASE_STORAGE_PATH (or the
+    MSQUIC_STORAGE_PATH environment variable). Each key is a directory and
+    each value a file, named after the value, holding a decimal or hex (0x
+    prefixed) integer. For example:
+
+        echo 0 > /etc/msquic/SendPacingDefault
+
+    A single thread watches all the opened keys with inotify, and indicates
+    their changes, so settings can be tuned on a running process.
+
 Environment:
 
     Linux
@@ -15,10 +25,242 @@ Environment:
 
 #define _GNU_SOURCE
 #include "platform_internal.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #ifdef QUIC_CLOG
 #include "storage_linux.c.clog.h"
 #endif
 
+//
+// The storage context returned that abstracts a watched directory.
+//
+typedef struct QUIC_STORAGE {
+
+    QUIC_LIST_ENTRY Link;
+
+    //
+    // The inotify watch for the directory, or -1 if it couldn't be watched.
+    //
+    int WatchDescriptor;
+
+    //
+    // Set by the watcher thread while collecting a batch of changes.
+    //
+    BOOLEAN Changed;
+
+    QUIC_STORAGE_CHANGE_CALLBACK_HANDLER Callback;
+    void* CallbackContext;
+
+    //
+    // The directory path, with a trailing '/'.
+    //
+    char Path[0];
+
+} QUIC_STORAGE;
+
+//
+// Watches the opened storage directories. Lazily started by the first open.
+//
+typedef struct QUIC_STORAGE_WATCHER {
+
+    //
+    // Protects all the fields below. Held while indicating changes, so that
+    // no callback runs once a storage is closed.
+    //
+    QUIC_LOCK Lock;
+
+    BOOLEAN Started;
+    BOOLEAN Shutdown;
+
+    int InotifyFd;
+
+    //
+    // Used to wake up the thread on shutdown.
+    //
+    int WakeFd;
+
+    QUIC_THREAD Thread;
+
+    //
+    // List of opened QUIC_STORAGE.
+    //
+    QUIC_LIST_ENTRY Storages;
+
+} QUIC_STORAGE_WATCHER;
+
+static QUIC_STORAGE_WATCHER QuicStorageWatcher;
+
+static const char* QuicStorageBasePath = QUIC_BASE_STORAGE_PATH;
+
+void
+QuicStorageInitialize(
+    void
+    )
+{
+    QuicZeroMemory(&QuicStorageWatcher, sizeof(QuicStorageWatcher));
+    QuicLockInitialize(&QuicStorageWatcher.Lock);
+    QuicListInitializeHead(&QuicStorageWatcher.Storages);
+
+    const char* BasePath = getenv("MSQUIC_STORAGE_PATH");
+    QuicStorageBasePath =
+        (BasePath != NULL && BasePath[0] != '\0') ?
+            BasePath : QUIC_BASE_STORAGE_PATH;
+}
+
+void
+QuicStorageUninitialize(
+    void
+    )
+{
+    if (QuicStorageWatcher.Started) {
+        QuicLockAcquire(&QuicStorageWatcher.Lock);
+        QuicStorageWatcher.Shutdown = TRUE;
+        QuicLockRelease(&QuicStorageWatcher.Lock);
+
+        const uint64_t Value = 1;
+        (void)write(QuicStorageWatcher.WakeFd, &Value, sizeof(Value));
+        QuicThreadWait(&QuicStorageWatcher.Thread);
+        QuicThreadDelete(&QuicStorageWatcher.Thread);
+
+        QUIC_DBG_ASSERT(QuicListIsEmpty(&QuicStorageWatcher.Storages));
+        close(QuicStorageWatcher.WakeFd);
+        close(QuicStorageWatcher.InotifyFd);
+        QuicStorageWatcher.Started = FALSE;
+    }
+    QuicLockUninitialize(&QuicStorageWatcher.Lock);
+}
+
+static
+QUIC_THREAD_CALLBACK(QuicStorageWatcherThread, Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    struct pollfd PollFds[2] = {
+        { QuicStorageWatcher.InotifyFd, POLLIN, 0 },
+        { QuicStorageWatcher.WakeFd, POLLIN, 0 }
+    };
+    uint8_t Buffer[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    while (TRUE) {
+        if (poll(PollFds, ARRAYSIZE(PollFds), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        QuicLockAcquire(&QuicStorageWatcher.Lock);
+        if (QuicStorageWatcher.Shutdown) {
+            QuicLockRelease(&QuicStorageWatcher.Lock);
+            break;
+        }
+
+        //
+        // Drain all the queued events, then indicate each changed directory
+        // once, as editing a value usually generates several events.
+        //
+        ssize_t Length;
+        while ((Length = read(QuicStorageWatcher.InotifyFd, Buffer, sizeof(Buffer))) > 0) {
+            for (uint8_t* Offset = Buffer; Offset < Buffer + Length; ) {
+                const struct inotify_event* Event = (const struct inotify_event*)Offset;
+                for (QUIC_LIST_ENTRY* Entry = QuicStorageWatcher.Storages.Flink;
+                     Entry != &QuicStorageWatcher.Storages;
+                     Entry = Entry->Flink) {
+                    QUIC_STORAGE* Storage = QUIC_CONTAINING_RECORD(Entry, QUIC_STORAGE, Link);
+                    if (Storage->WatchDescriptor == Event->wd) {
+                        Storage->Changed = TRUE;
+                    }
+                }
+                Offset += sizeof(struct inotify_event) + Event->len;
+            }
+        }
+
+        for (QUIC_LIST_ENTRY* Entry = QuicStorageWatcher.Storages.Flink;
+             Entry != &QuicStorageWatcher.Storages;
+             Entry = Entry->Flink) {
+            QUIC_STORAGE* Storage = QUIC_CONTAINING_RECORD(Entry, QUIC_STORAGE, Link);
+            if (Storage->Changed) {
+                Storage->Changed = FALSE;
+                QuicTraceLogVerbose(
+                    StorageChanged,
+                    "[ reg] %s changed",
+                    Storage->Path);
+                Storage->Callback(Storage->CallbackContext);
+            }
+        }
+        QuicLockRelease(&QuicStorageWatcher.Lock);
+    }
+
+    QUIC_THREAD_RETURN(QUIC_STATUS_SUCCESS);
+}
+
+//
+// Starts the watcher thread, if not already started. Called with the lock
+// held.
+//
+static
+QUIC_STATUS
+QuicStorageWatcherStart(
+    void
+    )
+{
+    QUIC_STATUS Status;
+
+    if (QuicStorageWatcher.Started) {
+        return QUIC_STATUS_SUCCESS;
+    }
+
+    QuicStorageWatcher.InotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (QuicStorageWatcher.InotifyFd < 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "inotify_init1 (storage) failed");
+        return Status;
+    }
+
+    QuicStorageWatcher.WakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (QuicStorageWatcher.WakeFd < 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "eventfd (storage) failed");
+        close(QuicStorageWatcher.InotifyFd);
+        return Status;
+    }
+
+    QUIC_THREAD_CONFIG ThreadConfig = {
+        0,
+        0,
+        "quic_storage",
+        QuicStorageWatcherThread,
+        NULL
+    };
+    Status = QuicThreadCreate(&ThreadConfig, &QuicStorageWatcher.Thread);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "QuicThreadCreate (storage)");
+        close(QuicStorageWatcher.WakeFd);
+        close(QuicStorageWatcher.InotifyFd);
+        return Status;
+    }
+
+    QuicStorageWatcher.Started = TRUE;
+
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicStorageOpen(
     _In_opt_z_ const char * Path,
@@ -27,21 +269,121 @@ QuicStorageOpen(
     _Out_ QUIC_STORAGE** NewStorage
     )
 {
-    UNREFERENCED_PARAMETER(Path);
-    UNREFERENCED_PARAMETER(Callback);
-    UNREFERENCED_PARAMETER(CallbackContext);
-    UNREFERENCED_PARAMETER(NewStorage);
-    // TODO
-    return QUIC_STATUS_NOT_SUPPORTED;
+    QUIC_STATUS Status;
+    QUIC_STORAGE* Storage = NULL;
+
+    size_t BasePathLength = strlen(QuicStorageBasePath);
+    size_t PathLength = Path == NULL ? 0 : strlen(Path);
+    if (Path != NULL && (strstr(Path, "..") != NULL || strchr(Path, '/') != NULL)) {
+        Status = QUIC_STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    Storage = QUIC_ALLOC_PAGED(sizeof(QUIC_STORAGE) + BasePathLength + PathLength + 2);
+    if (Storage == NULL) {
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Exit;
+    }
+
+    QuicZeroMemory(Storage, sizeof(QUIC_STORAGE));
+    Storage->Callback = Callback;
+    Storage->CallbackContext = CallbackContext;
+    Storage->WatchDescriptor = -1;
+
+    //
+    // Keys are separated with '\' (as registry paths are), which map to
+    // subdirectories.
+    //
+    char* FullPath = Storage->Path;
+    memcpy(FullPath, QuicStorageBasePath, BasePathLength);
+    FullPath += BasePathLength;
+    if (BasePathLength != 0 && FullPath[-1] != '/') {
+        *FullPath++ = '/';
+    }
+    for (size_t i = 0; i < PathLength; ++i) {
+        *FullPath++ = Path[i] == '\\' ? '/' : Path[i];
+    }
+    if (FullPath[-1] != '/') {
+        *FullPath++ = '/';
+    }
+    *FullPath = '\0';
+
+    QuicTraceLogVerbose(
+        StorageOpenKey,
+        "[ reg] Opening %s",
+        Storage->Path);
+
+    if (access(Storage->Path, R_OK | X_OK) != 0) {
+        Status = errno;
+        goto Exit;
+    }
+
+    QuicLockAcquire(&QuicStorageWatcher.Lock);
+    Status = QuicStorageWatcherStart();
+    if (QUIC_SUCCEEDED(Status)) {
+        Storage->WatchDescriptor =
+            inotify_add_watch(
+                QuicStorageWatcher.InotifyFd,
+                Storage->Path,
+                IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+        if (Storage->WatchDescriptor < 0) {
+            Status = errno;
+            QuicTraceEvent(
+                LibraryErrorStatus,
+                "[ lib] ERROR, %u, %s.",
+                Status,
+                "inotify_add_watch (storage) failed");
+        } else {
+            QuicListInsertTail(&QuicStorageWatcher.Storages, &Storage->Link);
+        }
+    }
+    QuicLockRelease(&QuicStorageWatcher.Lock);
+    if (QUIC_FAILED(Status)) {
+        goto Exit;
+    }
+
+    *NewStorage = Storage;
+    Storage = NULL;
+
+Exit:
+
+    if (Storage != NULL) {
+        QUIC_FREE(Storage);
+    }
+
+    return Status;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
 void
 QuicStorageClose(
     _In_opt_ QUIC_STORAGE* Storage
     )
 {
-    UNREFERENCED_PARAMETER(Storage);
-    // TODO
+    if (Storage != NULL) {
+        QuicLockAcquire(&QuicStorageWatcher.Lock);
+        QuicListEntryRemove(&Storage->Link);
+
+        //
+        // Several storages may watch the same directory (and so share the
+        // watch descriptor); only remove the watch with the last of them.
+        //
+        BOOLEAN Shared = FALSE;
+        for (QUIC_LIST_ENTRY* Entry = QuicStorageWatcher.Storages.Flink;
+             Entry != &QuicStorageWatcher.Storages;
+             Entry = Entry->Flink) {
+            QUIC_STORAGE* Other = QUIC_CONTAINING_RECORD(Entry, QUIC_STORAGE, Link);
+            if (Other->WatchDescriptor == Storage->WatchDescriptor) {
+                Shared = TRUE;
+                break;
+            }
+        }
+        if (!Shared) {
+            (void)inotify_rm_watch(QuicStorageWatcher.InotifyFd, Storage->WatchDescriptor);
+        }
+        QuicLockRelease(&QuicStorageWatcher.Lock);
+        QUIC_FREE(Storage);
+    }
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -54,10 +396,61 @@ QuicStorageReadValue(
     _Inout_ uint32_t * BufferLength
     )
 {
-    UNREFERENCED_PARAMETER(Storage);
-    UNREFERENCED_PARAMETER(Name);
-    UNREFERENCED_PARAMETER(Buffer);
-    UNREFERENCED_PARAMETER(BufferLength);
-    // TODO
-    return QUIC_STATUS_NOT_SUPPORTED;
+    if (Name == NULL || strchr(Name, '/') != NULL) {
+        return QUIC_STATUS_INVALID_PARAMETER;
+    }
+
+    int Fd = openat(AT_FDCWD, Storage->Path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (Fd < 0) {
+        return errno;
+    }
+    int ValueFd = openat(Fd, Name, O_RDONLY | O_CLOEXEC);
+    close(Fd);
+    if (ValueFd < 0) {
+        return errno;
+    }
+
+    char Text[32];
+    ssize_t Length = read(ValueFd, Text, sizeof(Text) - 1);
+    close(ValueFd);
+    if (Length <= 0) {
+        return QUIC_STATUS_INVALID_PARAMETER;
+    }
+    Text[Length] = '\0';
+
+    char* End;
+    errno = 0;
+    unsigned long long Value = strtoull(Text, &End, 0);
+    while (*End == ' ' || *End == '\t' || *End == '\r' || *End == '\n') {
+        ++End;
+    }
+    if (errno != 0 || End == Text || *End != '\0') {
+        return QUIC_STATUS_INVALID_PARAMETER;
+    }
+
+    //
+    // Like registry values, a value is either 32 or 64 bits long. Smaller
+    // buffers are still filled if the value fits.
+    //
+    uint32_t ValueLength = Value > UINT32_MAX ? sizeof(uint64_t) : sizeof(uint32_t);
+    if (*BufferLength < ValueLength &&
+        *BufferLength != 0 &&
+        Value < (1ull << (8 * *BufferLength))) {
+        ValueLength = *BufferLength;
+    }
+
+    if (Buffer == NULL) {
+        *BufferLength = ValueLength;
+        return QUIC_STATUS_SUCCESS;
+    }
+    if (*BufferLength < ValueLength) {
+        *BufferLength = ValueLength;
+        return QUIC_STATUS_BUFFER_TOO_SMALL;
+    }
+
+    uint64_t Value64 = (uint64_t)Value;
+    memcpy(Buffer, &Value64, ValueLength); // Little endian.
+    *BufferLength = ValueLength;
+
+    return QUIC_STATUS_SUCCESS;
 }
@@ -682,14 +682,16 @@ QuicTlsSessionUninitialize(
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
-QuicTlsSessionSetTicketKey(
+QuicTlsSessionSetTicketKeys(
     _In_ QUIC_TLS_SESSION* TlsSession,
-    _In_reads_bytes_(44)
-        const void* Buffer
+    _In_range_(1, QUIC_MAX_TICKET_KEY_COUNT) uint32_t KeyCount,
+    _In_reads_bytes_(KeyCount * QUIC_TICKET_KEY_LENGTH)
+        const uint8_t* Keys
     )
 {
     UNREFERENCED_PARAMETER(TlsSession); // miTLS doesn't actually support sessions.
-    if (!FFI_mitls_set_ticket_key("AES256-GCM", (uint8_t*)Buffer, 44)) {
+    UNREFERENCED_PARAMETER(KeyCount); // Or more than one (global) key; previous keys are ignored.
+    if (!FFI_mitls_set_ticket_key("AES256-GCM", (uint8_t*)Keys, QUIC_TICKET_KEY_LENGTH)) {
         QuicTraceEvent(
             LibraryError,
             "[ lib] ERROR, %s.",
@@ -2843,6 +2845,39 @@ QuicEncrypt(
     return QUIC_STATUS_SUCCESS;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicEncryptWithCopy(
+    _In_ QUIC_KEY* Key,
+    _In_reads_bytes_(QUIC_IV_LENGTH)
+        const uint8_t* const Iv,
+    _In_ uint16_t AuthDataLength,
+    _In_reads_bytes_opt_(AuthDataLength)
+        const uint8_t* const AuthData,
+    _In_ uint32_t SegmentCount,
+    _In_reads_(SegmentCount)
+        const QUIC_BUFFER* const Segments,
+    _In_ uint16_t BufferLength,
+    _Out_writes_bytes_(BufferLength)
+        uint8_t* Buffer
+    )
+{
+    //
+    // EverCrypt can't read the plain text from multiple buffers, so gather it
+    // into place first and encrypt it there.
+    //
+    uint16_t Offset = 0;
+    for (uint32_t i = 0; i < SegmentCount; ++i) {
+        if (Segments[i].Buffer != Buffer + Offset) {
+            QuicCopyMemory(Buffer + Offset, Segments[i].Buffer, Segments[i].Length);
+        }
+        Offset += (uint16_t)Segments[i].Length;
+    }
+    QUIC_DBG_ASSERT(Offset + QUIC_ENCRYPTION_OVERHEAD == BufferLength);
+
+    return QuicEncrypt(Key, Iv, AuthDataLength, AuthData, BufferLength, Buffer);
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_STATUS
 #pragma prefast(suppress: __WARNING_6262, "miTLS won't be shipped in product.")
@@ -2885,6 +2920,30 @@ QuicDecrypt(
     return QUIC_STATUS_SUCCESS;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDecryptBatch(
+    _In_ QUIC_KEY* Key,
+    _In_ uint8_t BatchSize,
+    _Inout_updates_(BatchSize)
+        QUIC_DECRYPT_BATCH_ENTRY* Entries
+    )
+{
+    //
+    // EverCrypt only decrypts a single buffer per call.
+    //
+    for (uint8_t i = 0; i < BatchSize; ++i) {
+        Entries[i].Status =
+            QuicDecrypt(
+                Key,
+                Entries[i].Iv,
+                Entries[i].AuthDataLength,
+                Entries[i].AuthData,
+                Entries[i].BufferLength,
+                Entries[i].Buffer);
+    }
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicHpKeyCreate(
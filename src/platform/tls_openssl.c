@@ -12,23 +12,76 @@ Abstract:
 #include "platform_internal.h"
 #include "openssl/ssl.h"
 #include "openssl/err.h"
+#include "openssl/ec.h"
+#include "openssl/hmac.h"
 #include "openssl/kdf.h"
+#include "openssl/ocsp.h"
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include "openssl/core_names.h"
+#endif
+#include "openssl/rand.h"
 #include "openssl/rsa.h"
+#include "openssl/sha.h"
 #include "openssl/x509.h"
 #include "openssl/pem.h"
+#ifdef QUIC_PLATFORM_LINUX
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+#if defined(_M_X64) || defined(__x86_64__) || defined(__i386__)
+#define QUIC_TLS_AES_DETECT_X86 1
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__aarch64__) && defined(QUIC_PLATFORM_LINUX)
+#define QUIC_TLS_AES_DETECT_ARM64 1
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
 #ifdef QUIC_CLOG
 #include "tls_openssl.c.clog.h"
 #endif
 
 uint16_t QuicTlsTPHeaderSize = 0;
 
+//
+// A resumption ticket encryption key, derived from the key configured by the
+// app.
+//
+
+typedef struct QUIC_TLS_TICKET_KEY {
+
+    //
+    // Identifies the key in the tickets it encrypts.
+    //
+    uint8_t Name[16];
+
+    uint8_t CipherKey[32];
+    uint8_t HmacKey[SHA256_DIGEST_LENGTH];
+
+} QUIC_TLS_TICKET_KEY;
+
 //
 // TLS session object.
 //
 
 typedef struct QUIC_TLS_SESSION {
 
-    uint32_t Reserved;
+    //
+    // Protects the ticket keys, which may be replaced while connections are
+    // using them.
+    //
+    QUIC_RW_LOCK TicketKeyLock;
+
+    //
+    // The ring of ticket keys. The first one encrypts new tickets; the rest
+    // only still decrypt tickets issued before the last key rotation.
+    //
+    uint32_t TicketKeyCount;
+    QUIC_TLS_TICKET_KEY TicketKeys[QUIC_MAX_TICKET_KEY_COUNT];
 
 } QUIC_TLS_SESSION;
 
@@ -57,8 +110,21 @@ typedef struct QUIC_SEC_CONFIG {
 
     SSL_CTX *SSLCtx;
 
+    //
+    // The DER encoded OCSP response stapled to the server certificate, loaded
+    // once with the config and shared by all its handshakes.
+    //
+
+    uint8_t* OcspResponse;
+    uint32_t OcspResponseLength;
+
 } QUIC_SEC_CONFIG;
 
+//
+// The maximum number of file descriptors an async job may wait on.
+//
+#define QUIC_TLS_MAX_ASYNC_FDS          4
+
 //
 // A TLS context associated per connection.
 //
@@ -111,6 +177,32 @@ typedef struct QUIC_TLS {
     QUIC_CONNECTION* Connection;
     QUIC_TLS_RECEIVE_TP_CALLBACK_HANDLER ReceiveTPCallback;
 
+    //
+    // Callback handler for completing a pending call.
+    //
+    QUIC_TLS_PROCESS_COMPLETE_CALLBACK_HANDLER ProcessCompleteCallback;
+
+    //
+    // Indicates the handshake is paused in an async job (i.e. a private key
+    // operation offloaded to an engine), and QuicTlsProcessData returned
+    // pending.
+    //
+    BOOLEAN AsyncPending;
+
+    //
+    // The input length of the pending call, reported as consumed once the
+    // call completes.
+    //
+    uint32_t AsyncBufferLength;
+
+    //
+    // The async job's wait file descriptors, while registered with the async
+    // waiter, and the link in its list of waiting contexts.
+    //
+    uint32_t AsyncFdCount;
+    OSSL_ASYNC_FD AsyncFds[QUIC_TLS_MAX_ASYNC_FDS];
+    QUIC_LIST_ENTRY AsyncLink;
+
 } QUIC_TLS;
 
 //
@@ -131,6 +223,13 @@ typedef struct QUIC_KEY {
     size_t BufferLen;
     uint8_t Buffer[64];
 
+    //
+    // Cipher context, initialized with the cipher and key once the key is
+    // known, so that only the nonce needs to be set for each packet.
+    //
+
+    EVP_CIPHER_CTX *CipherCtx;
+
 } QUIC_KEY;
 
 //
@@ -151,6 +250,14 @@ typedef struct QUIC_HASH {
     uint32_t SaltLength;
     uint8_t Salt[QUIC_VERSION_SALT_LENGTH];
 
+    //
+    // The HMAC key and a context already initialized with it, which is copied
+    // for each computation instead of setting up the key every time.
+    //
+
+    EVP_PKEY* HmacKey;
+    EVP_MD_CTX* HmacContext;
+
 } QUIC_HASH;
 
 //
@@ -177,10 +284,13 @@ typedef struct QUIC_HP_KEY {
 } QUIC_HP_KEY;
 
 //
-// Default list of Cipher used.
+// Default list of Cipher used, depending on whether the processor accelerates
+// AES. Without AES instructions, ChaCha20-Poly1305 is several times faster
+// than AES-GCM.
 //
 
 #define QUIC_TLS_DEFAULT_SSL_CIPHERS    "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384:TLS_CHACHA20_POLY1305_SHA256"
+#define QUIC_TLS_CHACHA_SSL_CIPHERS     "TLS_CHACHA20_POLY1305_SHA256:TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384"
 
 //
 // Default list of curves for ECDHE ciphers.
@@ -200,6 +310,591 @@ typedef struct QUIC_HP_KEY {
 
 char *QuicOpenSslClientTrustedCert = NULL;
 
+#ifdef QUIC_PLATFORM_LINUX
+
+//
+// Waits on the file descriptors of paused async jobs (i.e. private key
+// operations offloaded to a hardware or remote signer) and indicates the
+// completion of the corresponding pending TLS calls. Lazily started by the
+// first server security config with async private key operations enabled.
+//
+typedef struct QUIC_TLS_ASYNC_WAITER {
+
+    //
+    // Protects all the fields below, as well as the async state of the TLS
+    // contexts in the list.
+    //
+    QUIC_LOCK Lock;
+
+    BOOLEAN Started;
+    BOOLEAN Shutdown;
+
+    int EpollFd;
+
+    //
+    // Used to wake up the thread on shutdown.
+    //
+    int WakeFd;
+
+    QUIC_THREAD Thread;
+
+    //
+    // List of QUIC_TLS contexts with registered file descriptors.
+    //
+    QUIC_LIST_ENTRY Contexts;
+
+} QUIC_TLS_ASYNC_WAITER;
+
+static QUIC_TLS_ASYNC_WAITER QuicTlsAsyncWaiter;
+
+//
+// Removes the context's file descriptors from the waiter. Must be called with
+// the waiter lock held.
+//
+static
+void
+QuicTlsAsyncWaiterRemoveLocked(
+    _In_ QUIC_TLS* TlsContext
+    )
+{
+    for (uint32_t i = 0; i < TlsContext->AsyncFdCount; ++i) {
+        (void)epoll_ctl(
+            QuicTlsAsyncWaiter.EpollFd,
+            EPOLL_CTL_DEL,
+            TlsContext->AsyncFds[i],
+            NULL);
+    }
+    TlsContext->AsyncFdCount = 0;
+    QuicListEntryRemove(&TlsContext->AsyncLink);
+}
+
+QUIC_THREAD_CALLBACK(QuicTlsAsyncWaiterThread, Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+    struct epoll_event Events[16];
+
+    while (TRUE) {
+        int Count =
+            epoll_wait(QuicTlsAsyncWaiter.EpollFd, Events, ARRAYSIZE(Events), -1);
+        if (Count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            QuicTraceEvent(
+                LibraryErrorStatus,
+                "[ lib] ERROR, %u, %s.",
+                errno,
+                "epoll_wait (async waiter) failed");
+            break;
+        }
+
+        QuicLockAcquire(&QuicTlsAsyncWaiter.Lock);
+        BOOLEAN Shutdown = QuicTlsAsyncWaiter.Shutdown;
+        for (int i = 0; i < Count; ++i) {
+            QUIC_TLS* TlsContext = (QUIC_TLS*)Events[i].data.ptr;
+            if (TlsContext == NULL) {
+                continue; // Wake up.
+            }
+            //
+            // The context may have been cleaned up after the event was
+            // returned, so only trust it if it's still in the list.
+            //
+            QUIC_LIST_ENTRY* Entry = QuicTlsAsyncWaiter.Contexts.Flink;
+            while (Entry != &QuicTlsAsyncWaiter.Contexts) {
+                if (Entry == &TlsContext->AsyncLink) {
+                    QuicTlsAsyncWaiterRemoveLocked(TlsContext);
+                    TlsContext->ProcessCompleteCallback(TlsContext->Connection);
+                    break;
+                }
+                Entry = Entry->Flink;
+            }
+        }
+        QuicLockRelease(&QuicTlsAsyncWaiter.Lock);
+
+        if (Shutdown) {
+            break;
+        }
+    }
+
+    QUIC_THREAD_RETURN(QUIC_STATUS_SUCCESS);
+}
+
+//
+// Starts the async waiter thread, if not already started.
+//
+static
+QUIC_STATUS
+QuicTlsAsyncWaiterStart(
+    void
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+
+    QuicLockAcquire(&QuicTlsAsyncWaiter.Lock);
+    if (QuicTlsAsyncWaiter.Started) {
+        goto Exit;
+    }
+
+    QuicTlsAsyncWaiter.EpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (QuicTlsAsyncWaiter.EpollFd < 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "epoll_create1 (async waiter) failed");
+        goto Exit;
+    }
+
+    QuicTlsAsyncWaiter.WakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (QuicTlsAsyncWaiter.WakeFd < 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "eventfd (async waiter) failed");
+        close(QuicTlsAsyncWaiter.EpollFd);
+        goto Exit;
+    }
+
+    struct epoll_event WakeEvent = { EPOLLIN, { .ptr = NULL } };
+    if (epoll_ctl(
+            QuicTlsAsyncWaiter.EpollFd,
+            EPOLL_CTL_ADD,
+            QuicTlsAsyncWaiter.WakeFd,
+            &WakeEvent) != 0) {
+        Status = errno;
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "epoll_ctl (async waiter) failed");
+        close(QuicTlsAsyncWaiter.WakeFd);
+        close(QuicTlsAsyncWaiter.EpollFd);
+        goto Exit;
+    }
+
+    QUIC_THREAD_CONFIG ThreadConfig = {
+        0,
+        0,
+        "quic_tls_async",
+        QuicTlsAsyncWaiterThread,
+        NULL
+    };
+    Status = QuicThreadCreate(&ThreadConfig, &QuicTlsAsyncWaiter.Thread);
+    if (QUIC_FAILED(Status)) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            Status,
+            "QuicThreadCreate (async waiter)");
+        close(QuicTlsAsyncWaiter.WakeFd);
+        close(QuicTlsAsyncWaiter.EpollFd);
+        goto Exit;
+    }
+
+    QuicTlsAsyncWaiter.Started = TRUE;
+
+Exit:
+
+    QuicLockRelease(&QuicTlsAsyncWaiter.Lock);
+
+    return Status;
+}
+
+//
+// Stops the async waiter thread, if started.
+//
+static
+void
+QuicTlsAsyncWaiterStop(
+    void
+    )
+{
+    if (!QuicTlsAsyncWaiter.Started) {
+        return;
+    }
+
+    QuicLockAcquire(&QuicTlsAsyncWaiter.Lock);
+    QuicTlsAsyncWaiter.Shutdown = TRUE;
+    QuicLockRelease(&QuicTlsAsyncWaiter.Lock);
+
+    const uint64_t Value = 1;
+    (void)write(QuicTlsAsyncWaiter.WakeFd, &Value, sizeof(Value));
+    QuicThreadWait(&QuicTlsAsyncWaiter.Thread);
+    QuicThreadDelete(&QuicTlsAsyncWaiter.Thread);
+
+    QUIC_DBG_ASSERT(QuicListIsEmpty(&QuicTlsAsyncWaiter.Contexts));
+    close(QuicTlsAsyncWaiter.WakeFd);
+    close(QuicTlsAsyncWaiter.EpollFd);
+    QuicTlsAsyncWaiter.Started = FALSE;
+    QuicTlsAsyncWaiter.Shutdown = FALSE;
+}
+
+#endif // QUIC_PLATFORM_LINUX
+
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+
+//
+// Pool of pre-generated P-256 key pairs for the ECDHE key share, refilled by a
+// helper thread, so that handshakes pop a key instead of generating one
+// inline. It's hooked in by overriding OpenSSL's EC key generation method,
+// which falls back to the original when the pool is empty or another curve is
+// requested. Lazily started by the first server security config.
+//
+// N.B. OpenSSL 3.0 generates key shares through providers, which don't use
+// these methods, so the pool is only available with earlier versions.
+//
+#define QUIC_TLS_KEY_SHARE_POOL_SIZE        64
+#define QUIC_TLS_KEY_SHARE_POOL_LOW_WATER   32
+
+typedef struct QUIC_TLS_KEY_SHARE_POOL {
+
+    //
+    // Protects all the fields below.
+    //
+    QUIC_LOCK Lock;
+
+    BOOLEAN Started;
+    BOOLEAN Shutdown;
+
+    //
+    // Set when the pool drops below the low water mark, and on shutdown.
+    //
+    QUIC_EVENT RefillEvent;
+
+    QUIC_THREAD Thread;
+
+    //
+    // The overriding EC method and the original functions it wraps.
+    //
+    EVP_PKEY_METHOD* Method;
+    int (*OriginalCtrl)(EVP_PKEY_CTX* Ctx, int Type, int P1, void* P2);
+    int (*OriginalKeygen)(EVP_PKEY_CTX* Ctx, EVP_PKEY* Pkey);
+
+    uint32_t Count;
+    EC_KEY* Keys[QUIC_TLS_KEY_SHARE_POOL_SIZE];
+
+} QUIC_TLS_KEY_SHARE_POOL;
+
+static QUIC_TLS_KEY_SHARE_POOL QuicTlsKeySharePool;
+
+static
+EC_KEY*
+QuicTlsKeySharePoolPop(
+    void
+    )
+{
+    EC_KEY* Key = NULL;
+
+    QuicLockAcquire(&QuicTlsKeySharePool.Lock);
+    if (QuicTlsKeySharePool.Count > 0) {
+        Key = QuicTlsKeySharePool.Keys[--QuicTlsKeySharePool.Count];
+    }
+    BOOLEAN Refill =
+        QuicTlsKeySharePool.Count < QUIC_TLS_KEY_SHARE_POOL_LOW_WATER;
+    QuicLockRelease(&QuicTlsKeySharePool.Lock);
+
+    if (Refill) {
+        QuicEventSet(QuicTlsKeySharePool.RefillEvent);
+    }
+
+    return Key;
+}
+
+//
+// Marks key generation contexts for P-256 (the curve is set via this control
+// before generating), so that QuicTlsKeyShareKeygen knows it can use a pooled
+// key.
+//
+static
+int
+QuicTlsKeyShareCtrl(
+    _In_ EVP_PKEY_CTX* Ctx,
+    _In_ int Type,
+    _In_ int P1,
+    _In_opt_ void* P2
+    )
+{
+    if (Type == EVP_PKEY_CTRL_EC_PARAMGEN_CURVE_NID) {
+        EVP_PKEY_CTX_set_app_data(
+            Ctx,
+            P1 == NID_X9_62_prime256v1 ? &QuicTlsKeySharePool : NULL);
+    }
+    return QuicTlsKeySharePool.OriginalCtrl(Ctx, Type, P1, P2);
+}
+
+static
+int
+QuicTlsKeyShareKeygen(
+    _In_ EVP_PKEY_CTX* Ctx,
+    _In_ EVP_PKEY* Pkey
+    )
+{
+    if (EVP_PKEY_CTX_get_app_data(Ctx) == &QuicTlsKeySharePool &&
+        EVP_PKEY_CTX_get0_pkey(Ctx) == NULL) {
+        EC_KEY* Key = QuicTlsKeySharePoolPop();
+        if (Key != NULL) {
+            if (EVP_PKEY_assign_EC_KEY(Pkey, Key)) {
+                return 1;
+            }
+            EC_KEY_free(Key);
+        }
+    }
+    return QuicTlsKeySharePool.OriginalKeygen(Ctx, Pkey);
+}
+
+QUIC_THREAD_CALLBACK(QuicTlsKeySharePoolThread, Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    while (TRUE) {
+        QuicLockAcquire(&QuicTlsKeySharePool.Lock);
+        BOOLEAN Shutdown = QuicTlsKeySharePool.Shutdown;
+        BOOLEAN Full = QuicTlsKeySharePool.Count == QUIC_TLS_KEY_SHARE_POOL_SIZE;
+        QuicLockRelease(&QuicTlsKeySharePool.Lock);
+
+        if (Shutdown) {
+            break;
+        }
+
+        if (Full) {
+            QuicEventWaitForever(QuicTlsKeySharePool.RefillEvent);
+            continue;
+        }
+
+        EC_KEY* Key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+        if (Key == NULL || !EC_KEY_generate_key(Key)) {
+            QuicTraceEvent(
+                LibraryError,
+                "[ lib] ERROR, %s.",
+                "Key share pool generation failed");
+            EC_KEY_free(Key);
+            QuicEventWaitForever(QuicTlsKeySharePool.RefillEvent);
+            continue;
+        }
+
+        QuicLockAcquire(&QuicTlsKeySharePool.Lock);
+        QUIC_DBG_ASSERT(QuicTlsKeySharePool.Count < QUIC_TLS_KEY_SHARE_POOL_SIZE);
+        QuicTlsKeySharePool.Keys[QuicTlsKeySharePool.Count++] = Key;
+        QuicLockRelease(&QuicTlsKeySharePool.Lock);
+    }
+
+    QUIC_THREAD_RETURN(QUIC_STATUS_SUCCESS);
+}
+
+//
+// Starts the key share pool, if not already started. Failures are only
+// traced, since handshakes can always generate their key shares inline.
+//
+static
+void
+QuicTlsKeySharePoolStart(
+    void
+    )
+{
+    QuicLockAcquire(&QuicTlsKeySharePool.Lock);
+    if (QuicTlsKeySharePool.Started) {
+        goto Exit;
+    }
+
+    const EVP_PKEY_METHOD* Original = EVP_PKEY_meth_find(EVP_PKEY_EC);
+    if (Original == NULL) {
+        goto Error;
+    }
+
+    EVP_PKEY_METHOD* Method = EVP_PKEY_meth_new(EVP_PKEY_EC, 0);
+    if (Method == NULL) {
+        goto Error;
+    }
+
+    int (*KeygenInit)(EVP_PKEY_CTX*);
+    int (*CtrlStr)(EVP_PKEY_CTX*, const char*, const char*);
+    EVP_PKEY_meth_copy(Method, Original);
+    EVP_PKEY_meth_get_ctrl(Original, &QuicTlsKeySharePool.OriginalCtrl, &CtrlStr);
+    EVP_PKEY_meth_get_keygen(Original, &KeygenInit, &QuicTlsKeySharePool.OriginalKeygen);
+    EVP_PKEY_meth_set_ctrl(Method, QuicTlsKeyShareCtrl, CtrlStr);
+    EVP_PKEY_meth_set_keygen(Method, KeygenInit, QuicTlsKeyShareKeygen);
+
+    QuicEventInitialize(&QuicTlsKeySharePool.RefillEvent, FALSE, TRUE);
+
+    QUIC_THREAD_CONFIG ThreadConfig = {
+        0,
+        0,
+        "quic_tls_keyshare",
+        QuicTlsKeySharePoolThread,
+        NULL
+    };
+    QUIC_STATUS Status = QuicThreadCreate(&ThreadConfig, &QuicTlsKeySharePool.Thread);
+    if (QUIC_FAILED(Status)) {
+        QuicEventUninitialize(QuicTlsKeySharePool.RefillEvent);
+        EVP_PKEY_meth_free(Method);
+        goto Error;
+    }
+
+    if (!EVP_PKEY_meth_add0(Method)) {
+        //
+        // The thread is left to fill the pool, which is just never used.
+        //
+        EVP_PKEY_meth_free(Method);
+        Method = NULL;
+    }
+
+    QuicTlsKeySharePool.Method = Method;
+    QuicTlsKeySharePool.Started = TRUE;
+    goto Exit;
+
+Error:
+
+    QuicTraceEvent(
+        LibraryError,
+        "[ lib] ERROR, %s.",
+        "Key share pool unavailable");
+
+Exit:
+
+    QuicLockRelease(&QuicTlsKeySharePool.Lock);
+}
+
+//
+// Stops the key share pool, if started.
+//
+static
+void
+QuicTlsKeySharePoolStop(
+    void
+    )
+{
+    if (!QuicTlsKeySharePool.Started) {
+        return;
+    }
+
+    QuicLockAcquire(&QuicTlsKeySharePool.Lock);
+    QuicTlsKeySharePool.Shutdown = TRUE;
+    QuicLockRelease(&QuicTlsKeySharePool.Lock);
+
+    QuicEventSet(QuicTlsKeySharePool.RefillEvent);
+    QuicThreadWait(&QuicTlsKeySharePool.Thread);
+    QuicThreadDelete(&QuicTlsKeySharePool.Thread);
+    QuicEventUninitialize(QuicTlsKeySharePool.RefillEvent);
+
+    if (QuicTlsKeySharePool.Method != NULL) {
+        (void)EVP_PKEY_meth_remove(QuicTlsKeySharePool.Method);
+        EVP_PKEY_meth_free(QuicTlsKeySharePool.Method);
+        QuicTlsKeySharePool.Method = NULL;
+    }
+
+    while (QuicTlsKeySharePool.Count > 0) {
+        EC_KEY_free(QuicTlsKeySharePool.Keys[--QuicTlsKeySharePool.Count]);
+    }
+
+    QuicTlsKeySharePool.Started = FALSE;
+    QuicTlsKeySharePool.Shutdown = FALSE;
+}
+
+#endif // OPENSSL_VERSION_NUMBER < 0x30000000L
+
+//
+// Called when the handshake is paused in an async job. Registers the job's
+// file descriptors with the async waiter, sets AsyncPending and returns TRUE,
+// so the call can complete asynchronously. If they can't be registered, waits for the job
+// inline and returns FALSE, so that the caller resumes the handshake.
+//
+static
+BOOLEAN
+QuicTlsAsyncWait(
+    _In_ QUIC_TLS* TlsContext
+    )
+{
+    OSSL_ASYNC_FD Fds[QUIC_TLS_MAX_ASYNC_FDS];
+    size_t FdCount = 0;
+
+    if (SSL_get_all_async_fds(TlsContext->Ssl, NULL, &FdCount) != 1 ||
+        FdCount == 0 ||
+        FdCount > ARRAYSIZE(Fds) ||
+        SSL_get_all_async_fds(TlsContext->Ssl, Fds, &FdCount) != 1) {
+        //
+        // The job didn't give us anything to wait on, so just retry it.
+        //
+        return FALSE;
+    }
+
+#ifdef QUIC_PLATFORM_LINUX
+    QUIC_DBG_ASSERT(QuicTlsAsyncWaiter.Started);
+    QuicLockAcquire(&QuicTlsAsyncWaiter.Lock);
+    QUIC_DBG_ASSERT(TlsContext->AsyncFdCount == 0);
+    //
+    // Set before any descriptor is registered, as the completion may be
+    // processed before this returns.
+    //
+    TlsContext->AsyncPending = TRUE;
+    QuicListInsertTail(&QuicTlsAsyncWaiter.Contexts, &TlsContext->AsyncLink);
+    BOOLEAN Registered = TRUE;
+    for (size_t i = 0; i < FdCount; ++i) {
+        struct epoll_event Event = { EPOLLIN | EPOLLONESHOT, { .ptr = TlsContext } };
+        if (epoll_ctl(
+                QuicTlsAsyncWaiter.EpollFd,
+                EPOLL_CTL_ADD,
+                Fds[i],
+                &Event) != 0) {
+            //
+            // Most likely the descriptor is shared with another job.
+            //
+            Registered = FALSE;
+            break;
+        }
+        TlsContext->AsyncFds[TlsContext->AsyncFdCount++] = Fds[i];
+    }
+    if (!Registered) {
+        QuicTlsAsyncWaiterRemoveLocked(TlsContext);
+        TlsContext->AsyncPending = FALSE;
+    }
+    QuicLockRelease(&QuicTlsAsyncWaiter.Lock);
+
+    if (Registered) {
+        QuicTraceLogConnVerbose(
+            OpenSslAsyncPending,
+            TlsContext->Connection,
+            "Waiting on %u async fds",
+            (uint32_t)FdCount);
+        return TRUE;
+    }
+
+    struct pollfd PollFds[QUIC_TLS_MAX_ASYNC_FDS];
+    for (size_t i = 0; i < FdCount; ++i) {
+        PollFds[i].fd = Fds[i];
+        PollFds[i].events = POLLIN;
+        PollFds[i].revents = 0;
+    }
+    (void)poll(PollFds, (nfds_t)FdCount, -1);
+#endif
+
+    return FALSE;
+}
+
+//
+// Removes any async wait still registered for the context.
+//
+static
+void
+QuicTlsAsyncCancel(
+    _In_ QUIC_TLS* TlsContext
+    )
+{
+#ifdef QUIC_PLATFORM_LINUX
+    if (TlsContext->AsyncPending) {
+        QuicLockAcquire(&QuicTlsAsyncWaiter.Lock);
+        if (TlsContext->AsyncFdCount != 0) {
+            QuicTlsAsyncWaiterRemoveLocked(TlsContext);
+        }
+        QuicLockRelease(&QuicTlsAsyncWaiter.Lock);
+    }
+#else
+    UNREFERENCED_PARAMETER(TlsContext);
+#endif
+}
+
 static
 int
 QuicTlsAlpnSelectCallback(
@@ -359,15 +1054,12 @@ int
 QuicTlsEncrypt(
     _Out_writes_bytes_(OutputBufferLen) uint8_t *OutputBuffer,
     _In_ size_t OutputBufferLen,
-    _In_reads_bytes_(PlainTextLen) const uint8_t *PlainText,
-    _In_ size_t PlainTextLen,
-    _In_reads_bytes_(KeyLen) const uint8_t *Key,
-    _In_ size_t KeyLen,
-    _In_reads_bytes_(NonceLen) const uint8_t *Nonce,
-    _In_ size_t NonceLen,
+    _In_ uint32_t PlainTextCount,
+    _In_reads_(PlainTextCount) const QUIC_BUFFER *PlainText,
+    _In_reads_bytes_(QUIC_IV_LENGTH) const uint8_t *Nonce,
     _In_reads_bytes_(AuthDataLen) const uint8_t *Authdata,
     _In_ size_t AuthDataLen,
-    _In_ const EVP_CIPHER *Aead
+    _In_ const QUIC_KEY *Key
     );
 
 static
@@ -377,13 +1069,22 @@ QuicTlsDecrypt(
     _In_ size_t OutputBufferLen,
     _In_reads_bytes_(CipherTextLen) const uint8_t *CipherText,
     _In_ size_t CipherTextLen,
-    _In_reads_bytes_(KeyLen) const uint8_t *Key,
-    _In_ size_t KeyLen,
-    _In_reads_bytes_(NonceLen) const uint8_t *Nonce,
-    _In_ size_t NonceLen,
+    _In_reads_bytes_(QUIC_IV_LENGTH) const uint8_t *Nonce,
     _In_reads_bytes_(AuthDataLen) const uint8_t *AuthData,
     _In_ size_t AuthDataLen,
-    _In_ const EVP_CIPHER *Aead
+    _In_ const QUIC_KEY *Key
+    );
+
+static
+QUIC_STATUS
+QuicTlsKeyInitializeCipherCtx(
+    _Inout_ QUIC_KEY *Key
+    );
+
+static
+QUIC_STATUS
+QuicTlsHpKeyInitializeCipherCtx(
+    _Inout_ QUIC_HP_KEY *Key
     );
 
 static
@@ -416,6 +1117,17 @@ QuicTlsLibraryInitialize(
     // LINUX_TODO:Add Check for openssl library QUIC support.
     //
 
+#ifdef QUIC_PLATFORM_LINUX
+    QuicZeroMemory(&QuicTlsAsyncWaiter, sizeof(QuicTlsAsyncWaiter));
+    QuicLockInitialize(&QuicTlsAsyncWaiter.Lock);
+    QuicListInitializeHead(&QuicTlsAsyncWaiter.Contexts);
+#endif
+
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+    QuicZeroMemory(&QuicTlsKeySharePool, sizeof(QuicTlsKeySharePool));
+    QuicLockInitialize(&QuicTlsKeySharePool.Lock);
+#endif
+
     return QUIC_STATUS_SUCCESS;
 }
 
@@ -424,6 +1136,15 @@ QuicTlsLibraryUninitialize(
     void
     )
 {
+#ifdef QUIC_PLATFORM_LINUX
+    QuicTlsAsyncWaiterStop();
+    QuicLockUninitialize(&QuicTlsAsyncWaiter.Lock);
+#endif
+
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+    QuicTlsKeySharePoolStop();
+    QuicLockUninitialize(&QuicTlsKeySharePool.Lock);
+#endif
 }
 
 static
@@ -610,51 +1331,240 @@ QuicTlsSendAlertCallback(
 
     QUIC_TLS* TlsContext = SSL_get_app_data(Ssl);
 
-    QuicTraceLogConnError(
-        OpenSslAlert,
-        TlsContext->Connection,
-        "Send alert = %u (Level = %u)",
-        Alert,
-        Level);
+    QuicTraceLogConnError(
+        OpenSslAlert,
+        TlsContext->Connection,
+        "Send alert = %u (Level = %u)",
+        Alert,
+        Level);
+
+    TlsContext->State->AlertCode = Alert;
+    TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
+
+    return 1;
+}
+
+int
+QuicTlsClientHelloCallback(
+    _In_ SSL *Ssl,
+    _Out_opt_ int *Alert,
+    _In_ void *arg
+    )
+{
+    UNREFERENCED_PARAMETER(arg);
+    QUIC_TLS* TlsContext = SSL_get_app_data(Ssl);
+
+    const uint8_t* TransportParams;
+    size_t TransportParamLen;
+
+    if (!SSL_client_hello_get0_ext(
+            Ssl,
+            TLS_EXTENSION_TYPE_QUIC_TRANSPORT_PARAMETERS,
+            &TransportParams,
+            &TransportParamLen)) {
+        TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
+        *Alert = SSL_AD_INTERNAL_ERROR;
+        return SSL_CLIENT_HELLO_ERROR;
+    }
+
+    if (!TlsContext->ReceiveTPCallback(
+            TlsContext->Connection,
+            (uint16_t)TransportParamLen,
+            TransportParams)) {
+        TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
+        return SSL_CLIENT_HELLO_ERROR;
+    }
+
+    return SSL_CLIENT_HELLO_SUCCESS;
+}
+
+//
+// Staples the sec config's cached OCSP response, if the client asked for it.
+// OpenSSL takes ownership of the response, so each handshake gets a copy.
+//
+int
+QuicTlsOcspStatusCallback(
+    _In_ SSL *Ssl,
+    _In_ void *arg
+    )
+{
+    QUIC_SEC_CONFIG* SecurityConfig = (QUIC_SEC_CONFIG*)arg;
+
+    uint8_t* Response = OPENSSL_malloc(SecurityConfig->OcspResponseLength);
+    if (Response == NULL) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    memcpy(Response, SecurityConfig->OcspResponse, SecurityConfig->OcspResponseLength);
+
+    if (SSL_set_tlsext_status_ocsp_resp(
+            Ssl, Response, (long)SecurityConfig->OcspResponseLength) != 1) {
+        OPENSSL_free(Response);
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    return SSL_TLSEXT_ERR_OK;
+}
+
+//
+// Loads the DER encoded OCSP response for the certificate chain file, from
+// the file of the same name with an ".ocsp" suffix.
+//
+static
+QUIC_STATUS
+QuicTlsLoadOcspResponse(
+    _Inout_ QUIC_SEC_CONFIG* SecurityConfig,
+    _In_z_ const char* CertificateFile
+    )
+{
+    QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
+    BIO* Bio = NULL;
+    OCSP_RESPONSE* Response = NULL;
+    uint8_t* Buffer;
+    int Length;
+
+    size_t PathLength = strlen(CertificateFile) + sizeof(".ocsp");
+    char* Path = QuicAlloc(PathLength);
+    if (Path == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "OCSP response path",
+            PathLength);
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Exit;
+    }
+    strcpy(Path, CertificateFile);
+    strcat(Path, ".ocsp");
+
+    Bio = BIO_new_file(Path, "rb");
+    if (Bio == NULL ||
+        (Response = d2i_OCSP_RESPONSE_bio(Bio, NULL)) == NULL) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            ERR_get_error(),
+            "Failed to read OCSP response");
+        Status = QUIC_STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    Length = i2d_OCSP_RESPONSE(Response, NULL);
+    if (Length <= 0) {
+        Status = QUIC_STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    SecurityConfig->OcspResponse = QuicAlloc((size_t)Length);
+    if (SecurityConfig->OcspResponse == NULL) {
+        QuicTraceEvent(
+            AllocFailure,
+            "Allocation of '%s' failed. (%llu bytes)",
+            "OCSP response",
+            (size_t)Length);
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Exit;
+    }
+
+    Buffer = SecurityConfig->OcspResponse;
+    SecurityConfig->OcspResponseLength = (uint32_t)i2d_OCSP_RESPONSE(Response, &Buffer);
+
+Exit:
+
+    if (Response != NULL) {
+        OCSP_RESPONSE_free(Response);
+    }
+    if (Bio != NULL) {
+        BIO_free(Bio);
+    }
+    if (Path != NULL) {
+        QuicFree(Path);
+    }
+
+    return Status;
+}
 
-    TlsContext->State->AlertCode = Alert;
-    TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
+//
+// OpenSSL 3.0 deprecates the HMAC_CTX flavor of the ticket key callback.
+//
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+typedef EVP_MAC_CTX QUIC_TLS_TICKET_MAC_CTX;
+#define QUIC_TLS_SET_TICKET_KEY_CB SSL_CTX_set_tlsext_ticket_key_evp_cb
+#else
+typedef HMAC_CTX QUIC_TLS_TICKET_MAC_CTX;
+#define QUIC_TLS_SET_TICKET_KEY_CB SSL_CTX_set_tlsext_ticket_key_cb
+#endif
 
-    return 1;
+BOOLEAN
+QuicTlsTicketMacInit(
+    _In_ QUIC_TLS_TICKET_MAC_CTX* MacCtx,
+    _In_ const QUIC_TLS_TICKET_KEY* Key
+    )
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM Params[3];
+    Params[0] =
+        OSSL_PARAM_construct_octet_string(
+            OSSL_MAC_PARAM_KEY, (void*)Key->HmacKey, sizeof(Key->HmacKey));
+    Params[1] =
+        OSSL_PARAM_construct_utf8_string(
+            OSSL_MAC_PARAM_DIGEST, (char*)"SHA256", 0);
+    Params[2] = OSSL_PARAM_construct_end();
+    return EVP_MAC_CTX_set_params(MacCtx, Params) == 1;
+#else
+    return HMAC_Init_ex(MacCtx, Key->HmacKey, sizeof(Key->HmacKey), EVP_sha256(), NULL) == 1;
+#endif
 }
 
 int
-QuicTlsClientHelloCallback(
+QuicTlsTicketKeyCallback(
     _In_ SSL *Ssl,
-    _Out_opt_ int *Alert,
-    _In_ void *arg
+    _Inout_updates_bytes_(16) unsigned char *KeyName,
+    _Inout_updates_bytes_(EVP_MAX_IV_LENGTH) unsigned char *Iv,
+    _In_ EVP_CIPHER_CTX *CipherCtx,
+    _In_ QUIC_TLS_TICKET_MAC_CTX *MacCtx,
+    _In_ int Encrypt
     )
 {
-    UNREFERENCED_PARAMETER(arg);
     QUIC_TLS* TlsContext = SSL_get_app_data(Ssl);
+    QUIC_TLS_SESSION* TlsSession = TlsContext->TlsSession;
+    int Result = 0; // Key not found, so do a full handshake.
 
-    const uint8_t* TransportParams;
-    size_t TransportParamLen;
+    QuicRwLockAcquireShared(&TlsSession->TicketKeyLock);
 
-    if (!SSL_client_hello_get0_ext(
-            Ssl,
-            TLS_EXTENSION_TYPE_QUIC_TRANSPORT_PARAMETERS,
-            &TransportParams,
-            &TransportParamLen)) {
-        TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-        *Alert = SSL_AD_INTERNAL_ERROR;
-        return SSL_CLIENT_HELLO_ERROR;
-    }
+    if (Encrypt) {
+        const QUIC_TLS_TICKET_KEY* Key = &TlsSession->TicketKeys[0];
+        if (RAND_bytes(Iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1 ||
+            EVP_EncryptInit_ex(CipherCtx, EVP_aes_256_cbc(), NULL, Key->CipherKey, Iv) != 1 ||
+            !QuicTlsTicketMacInit(MacCtx, Key)) {
+            Result = -1;
+        } else {
+            memcpy(KeyName, Key->Name, sizeof(Key->Name));
+            Result = 1;
+        }
 
-    if (!TlsContext->ReceiveTPCallback(
-            TlsContext->Connection,
-            (uint16_t)TransportParamLen,
-            TransportParams)) {
-        TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-        return SSL_CLIENT_HELLO_ERROR;
+    } else {
+        for (uint32_t i = 0; i < TlsSession->TicketKeyCount; ++i) {
+            const QUIC_TLS_TICKET_KEY* Key = &TlsSession->TicketKeys[i];
+            if (memcmp(KeyName, Key->Name, sizeof(Key->Name)) != 0) {
+                continue;
+            }
+            if (!QuicTlsTicketMacInit(MacCtx, Key) ||
+                EVP_DecryptInit_ex(CipherCtx, EVP_aes_256_cbc(), NULL, Key->CipherKey, Iv) != 1) {
+                Result = -1;
+            } else {
+                //
+                // Tickets encrypted with a previous key are accepted, but the
+                // client is sent a new one, encrypted with the current key.
+                //
+                Result = i == 0 ? 1 : 2;
+            }
+            break;
+        }
     }
 
-    return SSL_CLIENT_HELLO_SUCCESS;
+    QuicRwLockReleaseShared(&TlsSession->TicketKeyLock);
+
+    return Result;
 }
 
 SSL_QUIC_METHOD OpenSslQuicCallbacks = {
@@ -664,6 +1574,47 @@ SSL_QUIC_METHOD OpenSslQuicCallbacks = {
     QuicTlsSendAlertCallback
 };
 
+//
+// Returns TRUE if the processor has AES instructions (AES-NI or the ARMv8
+// crypto extension), i.e. AES-GCM should be preferred over ChaCha20-Poly1305.
+//
+static
+BOOLEAN
+QuicTlsAesAccelerated(
+    void
+    )
+{
+#if defined(QUIC_TLS_AES_DETECT_X86) && defined(_WIN32)
+    int CpuInfo[4];
+    __cpuid(CpuInfo, 1);
+    return (CpuInfo[2] & (1 << 25)) != 0; // ECX.AES
+#elif defined(QUIC_TLS_AES_DETECT_X86)
+    unsigned int Eax, Ebx, Ecx, Edx;
+    if (!__get_cpuid(1, &Eax, &Ebx, &Ecx, &Edx)) {
+        return FALSE;
+    }
+    return (Ecx & bit_AES) != 0;
+#elif defined(QUIC_TLS_AES_DETECT_ARM64)
+    return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#else
+    return TRUE; // Unknown, so keep the standard preference.
+#endif
+}
+
+//
+// The TLS 1.3 cipher suites, in order of local preference.
+//
+static
+const char*
+QuicTlsPreferredCiphers(
+    void
+    )
+{
+    return
+        QuicTlsAesAccelerated() ?
+            QUIC_TLS_DEFAULT_SSL_CIPHERS : QUIC_TLS_CHACHA_SSL_CIPHERS;
+}
+
 QUIC_STATUS
 QuicTlsServerSecConfigCreate(
     _Inout_ QUIC_RUNDOWN_REF* Rundown,
@@ -682,10 +1633,12 @@ QuicTlsServerSecConfigCreate(
     uint32_t SSLOpts = 0;
 
     //
-    // We only allow PEM formatted cert files.
+    // We only allow PEM formatted cert files, optionally with the private key
+    // operations run as async jobs and with a stapled OCSP response.
     //
 
-    if (Flags != QUIC_SEC_CONFIG_FLAG_CERTIFICATE_FILE) {
+    if ((Flags & ~(QUIC_SEC_CONFIG_FLAG_ENABLE_ASYNC_PRIVATE_KEY | QUIC_SEC_CONFIG_FLAG_ENABLE_OCSP)) !=
+            QUIC_SEC_CONFIG_FLAG_CERTIFICATE_FILE) {
         QuicTraceEvent(
             LibraryErrorStatus,
             "[ lib] ERROR, %u, %s.",
@@ -704,6 +1657,26 @@ QuicTlsServerSecConfigCreate(
         goto Exit;
     }
 
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+    QuicTlsKeySharePoolStart();
+#endif
+
+    if (Flags & QUIC_SEC_CONFIG_FLAG_ENABLE_ASYNC_PRIVATE_KEY) {
+#ifdef QUIC_PLATFORM_LINUX
+        Status = QuicTlsAsyncWaiterStart();
+        if (QUIC_FAILED(Status)) {
+            goto Exit;
+        }
+#else
+        QuicTraceEvent(
+            LibraryError,
+            "[ lib] ERROR, %s.",
+            "Async private key operations unsupported");
+        Status = QUIC_STATUS_NOT_SUPPORTED;
+        goto Exit;
+#endif
+    }
+
     if (!QuicRundownAcquire(Rundown)) {
         QuicTraceEvent(
             LibraryError,
@@ -729,6 +1702,7 @@ QuicTlsServerSecConfigCreate(
         goto Exit;
     }
 
+    QuicZeroMemory(SecurityConfig, sizeof(*SecurityConfig));
     SecurityConfig->CleanupRundown = Rundown;
 
     //
@@ -756,9 +1730,14 @@ QuicTlsServerSecConfigCreate(
     // Configure the SSL context with the defaults.
     //
 
+    //
+    // The server's preference wins, except that a client which lists
+    // ChaCha20-Poly1305 first (i.e. lacks AES acceleration) gets it.
+    //
     SSLOpts = (SSL_OP_ALL & ~SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS) |
                SSL_OP_SINGLE_ECDH_USE |
                SSL_OP_CIPHER_SERVER_PREFERENCE |
+               SSL_OP_PRIORITIZE_CHACHA |
                SSL_OP_NO_ANTI_REPLAY;
 
     SSL_CTX_set_options(SecurityConfig->SSLCtx, SSLOpts);
@@ -767,7 +1746,7 @@ QuicTlsServerSecConfigCreate(
     Ret =
         SSL_CTX_set_ciphersuites(
             SecurityConfig->SSLCtx,
-            QUIC_TLS_DEFAULT_SSL_CIPHERS);
+            QuicTlsPreferredCiphers());
     if (Ret != 1) {
         QuicTraceEvent(
             LibraryErrorStatus,
@@ -794,6 +1773,14 @@ QuicTlsServerSecConfigCreate(
 
     SSL_CTX_set_mode(SecurityConfig->SSLCtx, SSL_MODE_RELEASE_BUFFERS);
 
+    if (Flags & QUIC_SEC_CONFIG_FLAG_ENABLE_ASYNC_PRIVATE_KEY) {
+        //
+        // Run the handshake in an async job, so that an engine (e.g. a crypto
+        // accelerator or a remote key server) can pause it while signing.
+        //
+        SSL_CTX_set_mode(SecurityConfig->SSLCtx, SSL_MODE_ASYNC);
+    }
+
     SSL_CTX_set_min_proto_version(SecurityConfig->SSLCtx, TLS1_3_VERSION);
     SSL_CTX_set_max_proto_version(SecurityConfig->SSLCtx, TLS1_3_VERSION);
 
@@ -845,9 +1832,34 @@ QuicTlsServerSecConfigCreate(
       goto Exit;
     }
 
+#if OPENSSL_VERSION_NUMBER >= 0x30200000L
+    //
+    // Compress the certificate chain (RFC 8879) now, once for all handshakes,
+    // with every algorithm OpenSSL was built with. Clients that negotiate one
+    // of them get the cached compressed chain, which usually lets the first
+    // server flight fit under the anti-amplification limit.
+    //
+    if (!SSL_CTX_compress_certs(SecurityConfig->SSLCtx, 0)) {
+        QuicTraceLogWarning(
+            TlsCertCompressionUnavailable,
+            "[ tls] Certificate compression unavailable, 0x%x",
+            (uint32_t)ERR_get_error());
+    }
+#endif
+
+    if (Flags & QUIC_SEC_CONFIG_FLAG_ENABLE_OCSP) {
+        Status = QuicTlsLoadOcspResponse(SecurityConfig, CertFile->CertificateFile);
+        if (QUIC_FAILED(Status)) {
+            goto Exit;
+        }
+        SSL_CTX_set_tlsext_status_cb(SecurityConfig->SSLCtx, QuicTlsOcspStatusCallback);
+        SSL_CTX_set_tlsext_status_arg(SecurityConfig->SSLCtx, SecurityConfig);
+    }
+
     SSL_CTX_set_max_early_data(SecurityConfig->SSLCtx, UINT32_MAX);
     SSL_CTX_set_quic_method(SecurityConfig->SSLCtx, &OpenSslQuicCallbacks);
     SSL_CTX_set_client_hello_cb(SecurityConfig->SSLCtx, QuicTlsClientHelloCallback, NULL);
+    QUIC_TLS_SET_TICKET_KEY_CB(SecurityConfig->SSLCtx, QuicTlsTicketKeyCallback);
 
     //
     // Invoke completion inline.
@@ -881,6 +1893,10 @@ QuicTlsSecConfigDelete(
         SecurityConfig->SSLCtx = NULL;
     }
 
+    if (SecurityConfig->OcspResponse != NULL) {
+        QuicFree(SecurityConfig->OcspResponse);
+    }
+
     QuicFree(SecurityConfig);
     SecurityConfig = NULL;
 
@@ -972,7 +1988,7 @@ QuicTlsClientSecConfigCreate(
         goto Exit;
     }
 
-    Ret = SSL_CTX_set_ciphersuites(SecurityConfig->SSLCtx, QUIC_TLS_DEFAULT_SSL_CIPHERS);
+    Ret = SSL_CTX_set_ciphersuites(SecurityConfig->SSLCtx, QuicTlsPreferredCiphers());
     if (Ret != 1) {
         QuicTraceEvent(
             LibraryErrorStatus,
@@ -1076,13 +2092,37 @@ QuicTlsSecConfigRelease(
     }
 }
 
+//
+// Derives the ticket key from the app's key. The key name is sent in the clear
+// in each ticket, so it is only taken from the first bytes of the app's key,
+// and the cipher and HMAC keys are derived from all of it.
+//
+void
+QuicTlsTicketKeyDerive(
+    _In_reads_bytes_(QUIC_TICKET_KEY_LENGTH)
+        const uint8_t* Secret,
+    _Out_ QUIC_TLS_TICKET_KEY* Key
+    )
+{
+    uint8_t Input[1 + QUIC_TICKET_KEY_LENGTH];
+    memcpy(Input + 1, Secret, QUIC_TICKET_KEY_LENGTH);
+
+    memcpy(Key->Name, Secret, sizeof(Key->Name));
+    Input[0] = 'c';
+    SHA256(Input, sizeof(Input), Key->CipherKey);
+    Input[0] = 'h';
+    SHA256(Input, sizeof(Input), Key->HmacKey);
+
+    OPENSSL_cleanse(Input, sizeof(Input));
+}
+
 QUIC_STATUS
 QuicTlsSessionInitialize(
     _Out_ QUIC_TLS_SESSION** NewTlsSession
     )
 {
-    *NewTlsSession = QuicAlloc(sizeof(QUIC_TLS_SESSION));
-    if (*NewTlsSession == NULL) {
+    QUIC_TLS_SESSION* TlsSession = QuicAlloc(sizeof(QUIC_TLS_SESSION));
+    if (TlsSession == NULL) {
         QuicTraceEvent(
             AllocFailure,
             "Allocation of '%s' failed. (%llu bytes)",
@@ -1090,6 +2130,23 @@ QuicTlsSessionInitialize(
             sizeof(QUIC_TLS_SESSION));
         return QUIC_STATUS_OUT_OF_MEMORY;
     }
+
+    //
+    // Until the app configures its own, use a random ticket key, which (just
+    // like OpenSSL's default) is only good for resumption on this session.
+    //
+    uint8_t Secret[QUIC_TICKET_KEY_LENGTH];
+    QUIC_STATUS Status = QuicRandom(sizeof(Secret), Secret);
+    if (QUIC_FAILED(Status)) {
+        QUIC_FREE(TlsSession);
+        return Status;
+    }
+    QuicTlsTicketKeyDerive(Secret, &TlsSession->TicketKeys[0]);
+    TlsSession->TicketKeyCount = 1;
+    OPENSSL_cleanse(Secret, sizeof(Secret));
+
+    QuicRwLockInitialize(&TlsSession->TicketKeyLock);
+    *NewTlsSession = TlsSession;
     return QUIC_STATUS_SUCCESS;
 }
 
@@ -1099,23 +2156,42 @@ QuicTlsSessionUninitialize(
     )
 {
     if (TlsSession != NULL) {
+        QuicRwLockUninitialize(&TlsSession->TicketKeyLock);
+        OPENSSL_cleanse(TlsSession->TicketKeys, sizeof(TlsSession->TicketKeys));
         QUIC_FREE(TlsSession);
         TlsSession = NULL;
     }
 }
 
 QUIC_STATUS
-QuicTlsSessionSetTicketKey(
+QuicTlsSessionSetTicketKeys(
     _In_ QUIC_TLS_SESSION* TlsSession,
-    _In_reads_bytes_(44)
-        const void* Buffer
+    _In_range_(1, QUIC_MAX_TICKET_KEY_COUNT) uint32_t KeyCount,
+    _In_reads_bytes_(KeyCount * QUIC_TICKET_KEY_LENGTH)
+        const uint8_t* Keys
     )
 {
-    UNREFERENCED_PARAMETER(TlsSession);
-    UNREFERENCED_PARAMETER(Buffer);
+    QUIC_DBG_ASSERT(KeyCount > 0 && KeyCount <= QUIC_MAX_TICKET_KEY_COUNT);
+
     //
-    // LINUX_TODO.
+    // Derive the new keys outside the lock, so that handshakes aren't
+    // blocked any longer than necessary.
     //
+    QUIC_TLS_TICKET_KEY NewKeys[QUIC_MAX_TICKET_KEY_COUNT];
+    for (uint32_t i = 0; i < KeyCount; ++i) {
+        QuicTlsTicketKeyDerive(Keys + i * QUIC_TICKET_KEY_LENGTH, &NewKeys[i]);
+    }
+
+    QuicRwLockAcquireExclusive(&TlsSession->TicketKeyLock);
+    memcpy(TlsSession->TicketKeys, NewKeys, KeyCount * sizeof(QUIC_TLS_TICKET_KEY));
+    OPENSSL_cleanse(
+        TlsSession->TicketKeys + KeyCount,
+        (QUIC_MAX_TICKET_KEY_COUNT - KeyCount) * sizeof(QUIC_TLS_TICKET_KEY));
+    TlsSession->TicketKeyCount = KeyCount;
+    QuicRwLockReleaseExclusive(&TlsSession->TicketKeyLock);
+
+    OPENSSL_cleanse(NewKeys, sizeof(NewKeys));
+
     return QUIC_STATUS_SUCCESS;
 }
 
@@ -1167,6 +2243,7 @@ QuicTlsInitialize(
     TlsContext->AlpnBufferLength = Config->AlpnBufferLength;
     TlsContext->AlpnBuffer = Config->AlpnBuffer;
     TlsContext->ReceiveTPCallback = Config->ReceiveTPCallback;
+    TlsContext->ProcessCompleteCallback = Config->ProcessCompleteCallback;
 
     QuicTraceLogConnVerbose(
         OpenSslContextCreated,
@@ -1279,6 +2356,8 @@ QuicTlsUninitialize(
             TlsContext->SNI = NULL;
         }
 
+        QuicTlsAsyncCancel(TlsContext);
+
         if (TlsContext->Ssl != NULL) {
             SSL_free(TlsContext->Ssl);
             TlsContext->Ssl = NULL;
@@ -1356,50 +2435,19 @@ QuicTlsGetSecConfig(
     return QuicTlsSecConfigAddRef(TlsContext->SecConfig);
 }
 
-QUIC_TLS_RESULT_FLAGS
-QuicTlsProcessData(
-    _In_ QUIC_TLS* TlsContext,
-    _In_ QUIC_TLS_DATA_TYPE DataType,
-    _In_reads_bytes_(*BufferLength) const uint8_t* Buffer,
-    _Inout_ uint32_t* BufferLength,
-    _Inout_ QUIC_TLS_PROCESS_STATE* State
+//
+// Drives the handshake forward with whatever data has been provided. Returns
+// with AsyncPending set if the handshake is paused in an async job.
+//
+static
+void
+QuicTlsHandshake(
+    _In_ QUIC_TLS* TlsContext
     )
 {
     int Ret = 0;
     int Err = 0;
-
-    QUIC_DBG_ASSERT(Buffer != NULL || *BufferLength == 0);
-
-    if (DataType == QUIC_TLS_TICKET_DATA) {
-        TlsContext->ResultFlags = QUIC_TLS_RESULT_ERROR;
-
-        QuicTraceLogConnVerbose(
-            OpenSslProcessData,
-            TlsContext->Connection,
-            "Ignoring %u ticket bytes",
-            *BufferLength);
-        goto Exit;
-    }
-
-    if (*BufferLength != 0) {
-        QuicTraceLogConnVerbose(
-            OpenSslProcessData,
-            TlsContext->Connection,
-            "Processing %u received bytes",
-            *BufferLength);
-    }
-
-    TlsContext->State = State;
-    TlsContext->ResultFlags = 0;
-
-    if (SSL_provide_quic_data(
-            TlsContext->Ssl,
-            TlsContext->State->ReadKey,
-            Buffer,
-            *BufferLength) != 1) {
-        TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-        goto Exit;
-    }
+    QUIC_TLS_PROCESS_STATE* State = TlsContext->State;
 
     if (!State->HandshakeComplete) {
         Ret = SSL_do_handshake(TlsContext->Ssl);
@@ -1408,7 +2456,14 @@ QuicTlsProcessData(
             switch (Err) {
             case SSL_ERROR_WANT_READ:
             case SSL_ERROR_WANT_WRITE:
-                goto Exit;
+                return;
+
+            case SSL_ERROR_WANT_ASYNC:
+                if (QuicTlsAsyncWait(TlsContext)) {
+                    return;
+                }
+                QuicTlsHandshake(TlsContext);
+                return;
 
             case SSL_ERROR_SSL:
                 QuicTraceLogConnError(
@@ -1417,7 +2472,7 @@ QuicTlsProcessData(
                     "TLS handshake error: %s",
                     ERR_error_string(ERR_get_error(), NULL));
                 TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-                goto Exit;
+                return;
 
             default:
                 QuicTraceLogConnError(
@@ -1426,7 +2481,7 @@ QuicTlsProcessData(
                     "TLS handshake error: %d",
                     Err);
                 TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-                goto Exit;
+                return;
             }
         }
 
@@ -1440,7 +2495,7 @@ QuicTlsProcessData(
                     TlsContext->Connection,
                     "Failed to negotiate ALPN");
                 TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-                goto Exit;
+                return;
             }
             if (NegotiatedAlpnLength > UINT8_MAX) {
                 QuicTraceLogConnError(
@@ -1448,7 +2503,7 @@ QuicTlsProcessData(
                     TlsContext->Connection,
                     "Invalid negotiated ALPN length");
                 TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-                goto Exit;
+                return;
             }
             TlsContext->State->NegotiatedAlpn =
                 QuicTlsAlpnFindInList(
@@ -1462,7 +2517,7 @@ QuicTlsProcessData(
                     TlsContext->Connection,
                     "Failed to find a matching ALPN");
                 TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-                goto Exit;
+                return;
             }
         }
 
@@ -1471,6 +2526,7 @@ QuicTlsProcessData(
             TlsContext->Connection,
             "Handshake complete");
         State->HandshakeComplete = TRUE;
+        State->SessionResumed = SSL_session_reused(TlsContext->Ssl) != 0;
         TlsContext->ResultFlags |= QUIC_TLS_RESULT_COMPLETE;
 
         if (TlsContext->IsServer) {
@@ -1487,14 +2543,14 @@ QuicTlsProcessData(
                     TlsContext->Connection,
                     "No transport parameters received");
                 TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-                goto Exit;
+                return;
             }
             if (!TlsContext->ReceiveTPCallback(
                     TlsContext->Connection,
                     (uint16_t)TransportParamLen,
                     TransportParams)) {
                 TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-                goto Exit;
+                return;
             }
         }
     }
@@ -1505,7 +2561,14 @@ QuicTlsProcessData(
         switch (Err) {
         case SSL_ERROR_WANT_READ:
         case SSL_ERROR_WANT_WRITE:
-            goto Exit;
+            return;
+
+        case SSL_ERROR_WANT_ASYNC:
+            if (QuicTlsAsyncWait(TlsContext)) {
+                return;
+            }
+            QuicTlsHandshake(TlsContext);
+            return;
 
         case SSL_ERROR_SSL:
             QuicTraceLogConnError(
@@ -1514,7 +2577,7 @@ QuicTlsProcessData(
                 "TLS handshake error: %s",
                 ERR_error_string(ERR_get_error(), NULL));
             TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-            goto Exit;
+            return;
 
         default:
             QuicTraceLogConnError(
@@ -1523,34 +2586,105 @@ QuicTlsProcessData(
                 "TLS handshake error: %d",
                 Err);
             TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
-            goto Exit;
+            return;
+        }
+    }
+}
+
+//
+// Updates the offsets of the data written to the state's buffer and returns
+// the accumulated result flags.
+//
+static
+QUIC_TLS_RESULT_FLAGS
+QuicTlsProcessDataFinish(
+    _In_ QUIC_TLS* TlsContext
+    )
+{
+    QUIC_TLS_PROCESS_STATE* State = TlsContext->State;
+
+    if (!(TlsContext->ResultFlags & QUIC_TLS_RESULT_ERROR)) {
+        if (State->WriteKeys[QUIC_PACKET_KEY_HANDSHAKE] != NULL &&
+            State->BufferOffsetHandshake == 0) {
+            State->BufferOffsetHandshake = State->BufferTotalLength;
+            QuicTraceLogConnInfo(
+                OpenSslHandshakeDataStart,
+                TlsContext->Connection,
+                "Writing Handshake data starts at %u",
+                State->BufferOffsetHandshake);
+        }
+        if (State->WriteKeys[QUIC_PACKET_KEY_1_RTT] != NULL &&
+            State->BufferOffset1Rtt == 0) {
+            State->BufferOffset1Rtt = State->BufferTotalLength;
+            QuicTraceLogConnInfo(
+                OpenSsl1RttDataStart,
+                TlsContext->Connection,
+                "Writing 1-RTT data starts at %u",
+                State->BufferOffset1Rtt);
         }
     }
 
-Exit:
+    return TlsContext->ResultFlags;
+}
+
+QUIC_TLS_RESULT_FLAGS
+QuicTlsProcessData(
+    _In_ QUIC_TLS* TlsContext,
+    _In_ QUIC_TLS_DATA_TYPE DataType,
+    _In_reads_bytes_(*BufferLength) const uint8_t* Buffer,
+    _Inout_ uint32_t* BufferLength,
+    _Inout_ QUIC_TLS_PROCESS_STATE* State
+    )
+{
+    QUIC_DBG_ASSERT(Buffer != NULL || *BufferLength == 0);
+    QUIC_DBG_ASSERT(!TlsContext->AsyncPending);
+
+    if (DataType == QUIC_TLS_TICKET_DATA) {
+        TlsContext->ResultFlags = QUIC_TLS_RESULT_ERROR;
+
+        QuicTraceLogConnVerbose(
+            OpenSslProcessData,
+            TlsContext->Connection,
+            "Ignoring %u ticket bytes",
+            *BufferLength);
+        return TlsContext->ResultFlags;
+    }
+
+    if (*BufferLength != 0) {
+        QuicTraceLogConnVerbose(
+            OpenSslProcessData,
+            TlsContext->Connection,
+            "Processing %u received bytes",
+            *BufferLength);
+    }
+
+    TlsContext->State = State;
+    TlsContext->ResultFlags = 0;
+
+    if (SSL_provide_quic_data(
+            TlsContext->Ssl,
+            TlsContext->State->ReadKey,
+            Buffer,
+            *BufferLength) != 1) {
+        TlsContext->ResultFlags |= QUIC_TLS_RESULT_ERROR;
+        return QuicTlsProcessDataFinish(TlsContext);
+    }
+
+    //
+    // The data is handed to OpenSSL at this point, so it's all reported as
+    // consumed if the call completes asynchronously. Set before the handshake,
+    // as the completion may be processed (on another thread) before it
+    // returns.
+    //
+    TlsContext->AsyncBufferLength = *BufferLength;
 
-    if (!(TlsContext->ResultFlags & QUIC_TLS_RESULT_ERROR)) {
-        if (State->WriteKeys[QUIC_PACKET_KEY_HANDSHAKE] != NULL &&
-            State->BufferOffsetHandshake == 0) {
-            State->BufferOffsetHandshake = State->BufferTotalLength;
-            QuicTraceLogConnInfo(
-                OpenSslHandshakeDataStart,
-                TlsContext->Connection,
-                "Writing Handshake data starts at %u",
-                State->BufferOffsetHandshake);
-        }
-        if (State->WriteKeys[QUIC_PACKET_KEY_1_RTT] != NULL &&
-            State->BufferOffset1Rtt == 0) {
-            State->BufferOffset1Rtt = State->BufferTotalLength;
-            QuicTraceLogConnInfo(
-                OpenSsl1RttDataStart,
-                TlsContext->Connection,
-                "Writing 1-RTT data starts at %u",
-                State->BufferOffset1Rtt);
-        }
+    QuicTlsHandshake(TlsContext);
+
+    if (TlsContext->AsyncPending) {
+        return QUIC_TLS_RESULT_PENDING;
     }
 
-    return TlsContext->ResultFlags;
+    return QuicTlsProcessDataFinish(TlsContext);
 }
 
 QUIC_TLS_RESULT_FLAGS
@@ -1559,9 +2693,25 @@ QuicTlsProcessDataComplete(
     _Out_ uint32_t * BufferConsumed
     )
 {
-    UNREFERENCED_PARAMETER(TlsContext);
-    UNREFERENCED_PARAMETER(BufferConsumed);
-    return QUIC_TLS_RESULT_ERROR;
+    *BufferConsumed = 0;
+
+    if (!TlsContext->AsyncPending) {
+        return QUIC_TLS_RESULT_ERROR;
+    }
+
+    //
+    // Resume the paused job. The result flags from before it was paused are
+    // still accumulated in the context.
+    //
+    TlsContext->AsyncPending = FALSE;
+    QuicTlsHandshake(TlsContext);
+
+    if (TlsContext->AsyncPending) {
+        return QUIC_TLS_RESULT_PENDING;
+    }
+
+    *BufferConsumed = TlsContext->AsyncBufferLength;
+    return QuicTlsProcessDataFinish(TlsContext);
 }
 
 QUIC_STATUS
@@ -1636,7 +2786,7 @@ QuicPacketKeyCreateInitial(
         }
 
         TempWriteKey->PacketKey->Aead = EVP_aes_128_gcm();
-        TempWriteKey->HeaderKey->Aead = EVP_aes_128_ctr();
+        TempWriteKey->HeaderKey->Aead = EVP_aes_128_ecb();
 
         if (!QuicTlsHkdfExtract(
                 InitialSecret,
@@ -1738,7 +2888,7 @@ QuicPacketKeyCreateInitial(
         }
 
         TempReadKey->PacketKey->Aead = EVP_aes_128_gcm();
-        TempReadKey->HeaderKey->Aead = EVP_aes_128_ctr();
+        TempReadKey->HeaderKey->Aead = EVP_aes_128_ecb();
 
         if (!QuicTlsHkdfExtract(
                 InitialSecret,
@@ -1969,6 +3119,8 @@ QuicKeyCreate(
         goto Exit;
     }
 
+    QuicZeroMemory(Key, sizeof(QUIC_KEY));
+
     switch (AeadType) {
     case QUIC_AEAD_AES_128_GCM:
         Key->Aead = EVP_aes_128_gcm();
@@ -1988,6 +3140,11 @@ QuicKeyCreate(
 
     memcpy(Key->Buffer, RawKey, Key->BufferLen);
 
+    Status = QuicTlsKeyInitializeCipherCtx(Key);
+    if (QUIC_FAILED(Status)) {
+        goto Exit;
+    }
+
     *NewKey = Key;
     Key = NULL;
 
@@ -2004,6 +3161,9 @@ QuicKeyFree(
     )
 {
     if (Key != NULL) {
+        if (Key->CipherCtx != NULL) {
+            EVP_CIPHER_CTX_free(Key->CipherCtx);
+        }
         QuicFree(Key);
         Key = NULL;
     }
@@ -2022,19 +3182,45 @@ QuicEncrypt(
     )
 {
     QUIC_DBG_ASSERT(QUIC_ENCRYPTION_OVERHEAD <= BufferLength);
+    QUIC_BUFFER PlainText;
+    PlainText.Length = BufferLength - QUIC_ENCRYPTION_OVERHEAD;
+    PlainText.Buffer = Buffer;
     int Ret =
         QuicTlsEncrypt(
             Buffer,
             BufferLength,
+            1,
+            &PlainText,
+            Iv,
+            AuthData,
+            AuthDataLength,
+            Key);
+    return (Ret < 0) ? QUIC_STATUS_TLS_ERROR : QUIC_STATUS_SUCCESS;
+}
+
+QUIC_STATUS
+QuicEncryptWithCopy(
+    _In_ QUIC_KEY* Key,
+    _In_reads_bytes_(QUIC_IV_LENGTH) const uint8_t* const Iv,
+    _In_ uint16_t AuthDataLength,
+    _In_reads_bytes_opt_(AuthDataLength) const uint8_t* const AuthData,
+    _In_ uint32_t SegmentCount,
+    _In_reads_(SegmentCount) const QUIC_BUFFER* const Segments,
+    _In_ uint16_t BufferLength,
+    _Out_writes_bytes_(BufferLength) uint8_t* Buffer
+    )
+{
+    QUIC_DBG_ASSERT(QUIC_ENCRYPTION_OVERHEAD <= BufferLength);
+    int Ret =
+        QuicTlsEncrypt(
             Buffer,
-            BufferLength - QUIC_ENCRYPTION_OVERHEAD,
-            Key->Buffer,
-            Key->BufferLen,
+            BufferLength,
+            SegmentCount,
+            Segments,
             Iv,
-            QUIC_IV_LENGTH,
             AuthData,
             AuthDataLength,
-            Key->Aead);
+            Key);
     return (Ret < 0) ? QUIC_STATUS_TLS_ERROR : QUIC_STATUS_SUCCESS;
 }
 
@@ -2055,16 +3241,38 @@ QuicDecrypt(
             BufferLength,
             Buffer,
             BufferLength,
-            Key->Buffer,
-            Key->BufferLen,
             Iv,
-            QUIC_IV_LENGTH,
             AuthData,
             AuthDataLength,
-            Key->Aead);
+            Key);
     return (Ret < 0) ? QUIC_STATUS_TLS_ERROR : QUIC_STATUS_SUCCESS;
 }
 
+void
+QuicDecryptBatch(
+    _In_ QUIC_KEY* Key,
+    _In_ uint8_t BatchSize,
+    _Inout_updates_(BatchSize)
+        QUIC_DECRYPT_BATCH_ENTRY* Entries
+    )
+{
+    //
+    // EVP has no multi-buffer AES-GCM interface (the AES-NI implementation
+    // already interleaves the blocks within each buffer), so decrypt the
+    // buffers one at a time with the key's preinitialized context.
+    //
+    for (uint8_t i = 0; i < BatchSize; ++i) {
+        Entries[i].Status =
+            QuicDecrypt(
+                Key,
+                Entries[i].Iv,
+                Entries[i].AuthDataLength,
+                Entries[i].AuthData,
+                Entries[i].BufferLength,
+                Entries[i].Buffer);
+    }
+}
+
 QUIC_STATUS
 QuicHpKeyCreate(
     _In_ QUIC_AEAD_TYPE AeadType,
@@ -2100,13 +3308,13 @@ QuicHpKeyCreate(
 
     switch (AeadType) {
     case QUIC_AEAD_AES_128_GCM:
-        Key->Aead = EVP_aes_128_ctr();
+        Key->Aead = EVP_aes_128_ecb();
         break;
     case QUIC_AEAD_AES_256_GCM:
-        Key->Aead = EVP_aes_256_ctr();
+        Key->Aead = EVP_aes_256_ecb();
         break;
     case QUIC_AEAD_CHACHA20_POLY1305:
-        Key->Aead = EVP_chacha20_poly1305();
+        Key->Aead = EVP_chacha20();
         break;
     default:
         Status = QUIC_STATUS_NOT_SUPPORTED;
@@ -2116,6 +3324,11 @@ QuicHpKeyCreate(
     Key->BufferLen = EVP_CIPHER_key_length(Key->Aead);
     QuicCopyMemory(Key->Buffer, RawKey, Key->BufferLen);
 
+    Status = QuicTlsHpKeyInitializeCipherCtx(Key);
+    if (QUIC_FAILED(Status)) {
+        goto Exit;
+    }
+
     *NewKey = Key;
     Key = NULL;
 
@@ -2152,33 +3365,53 @@ QuicHpComputeMask(
     uint32_t Offset = 0;
     static const uint8_t PLAINTEXT[] = "\x00\x00\x00\x00\x00";
 
-    for (uint8_t i = 0; i < BatchSize; ++i) { // TODO - Figure out how to not use a loop here!
-        if (EVP_EncryptInit_ex(Key->CipherCtx, Key->Aead, NULL, Key->Buffer, Cipher + Offset) != 1) {
+    if (Key->Aead != EVP_chacha20()) {
+        //
+        // The AES header protection mask is just the AES-ECB encryption of
+        // each sample, so the whole batch is encrypted with a single call.
+        // This lets OpenSSL pipeline the blocks through its multi-block
+        // AES-NI implementation.
+        //
+        if (EVP_EncryptUpdate(
+                Key->CipherCtx,
+                Mask,
+                &Len,
+                Cipher,
+                QUIC_HP_SAMPLE_LENGTH * BatchSize) != 1) {
             QuicTraceEvent(
                 LibraryError,
                 "[ lib] ERROR, %s.",
-                "EVP_EncryptInit_ex failed");
+                "EVP_EncryptUpdate failed");
             goto Exit;
         }
 
-        if (EVP_EncryptUpdate(Key->CipherCtx, Mask + Offset, &Len, PLAINTEXT, sizeof(PLAINTEXT) - 1) != 1) {
+        QUIC_FRE_ASSERT(Len == QUIC_HP_SAMPLE_LENGTH * BatchSize);
+        Ret = TRUE;
+        goto Exit;
+    }
+
+    //
+    // For ChaCha20 each sample is the counter and nonce, so the key is kept
+    // on the context and only the IV is reset for each sample.
+    //
+    for (uint8_t i = 0; i < BatchSize; ++i) {
+        if (EVP_EncryptInit_ex(Key->CipherCtx, NULL, NULL, NULL, Cipher + Offset) != 1) {
             QuicTraceEvent(
                 LibraryError,
                 "[ lib] ERROR, %s.",
-                "EVP_EncryptUpdate failed");
+                "EVP_EncryptInit_ex failed");
             goto Exit;
         }
 
-        QUIC_FRE_ASSERT(Len == 5);
-        if (EVP_EncryptFinal_ex(Key->CipherCtx, Mask + Offset + Len, &Len) != 1) {
+        if (EVP_EncryptUpdate(Key->CipherCtx, Mask + Offset, &Len, PLAINTEXT, sizeof(PLAINTEXT) - 1) != 1) {
             QuicTraceEvent(
                 LibraryError,
                 "[ lib] ERROR, %s.",
-                "EVP_EncryptFinal_ex failed");
+                "EVP_EncryptUpdate failed");
             goto Exit;
         }
 
-        QUIC_FRE_ASSERT(Len == 0);
+        QUIC_FRE_ASSERT(Len == 5);
         Offset += QUIC_HP_SAMPLE_LENGTH;
     }
 
@@ -2189,6 +3422,31 @@ Exit:
     return Ret ? QUIC_STATUS_SUCCESS : QUIC_STATUS_TLS_ERROR;
 }
 
+static
+QUIC_STATUS
+QuicTlsHpKeyInitializeCipherCtx(
+    _Inout_ QUIC_HP_KEY *Key
+    )
+{
+    if (EVP_EncryptInit_ex(Key->CipherCtx, Key->Aead, NULL, Key->Buffer, NULL) != 1) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            ERR_get_error(),
+            "EVP_EncryptInit_ex failed");
+        return QUIC_STATUS_TLS_ERROR;
+    }
+
+    if (Key->Aead != EVP_chacha20()) {
+        //
+        // Samples are always whole blocks, so there is nothing to pad.
+        //
+        EVP_CIPHER_CTX_set_padding(Key->CipherCtx, 0);
+    }
+
+    return QUIC_STATUS_SUCCESS;
+}
+
 QUIC_STATUS
 QuicHashCreate(
     _In_ QUIC_HASH_TYPE HashType,
@@ -2210,6 +3468,9 @@ QuicHashCreate(
         goto Exit;
     }
 
+    Hash->HmacKey = NULL;
+    Hash->HmacContext = NULL;
+
     switch (HashType) {
     case QUIC_HASH_SHA256:
         Hash->Md = EVP_sha256();
@@ -2229,6 +3490,24 @@ QuicHashCreate(
     Hash->SaltLength = SaltLength;
     memcpy(Hash->Salt, Salt, SaltLength);
 
+    Hash->HmacKey =
+        EVP_PKEY_new_mac_key(EVP_PKEY_HMAC, NULL, Hash->Salt, (int)Hash->SaltLength);
+    if (Hash->HmacKey == NULL) {
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Exit;
+    }
+
+    Hash->HmacContext = EVP_MD_CTX_new();
+    if (Hash->HmacContext == NULL) {
+        Status = QUIC_STATUS_OUT_OF_MEMORY;
+        goto Exit;
+    }
+
+    if (!EVP_DigestSignInit(Hash->HmacContext, NULL, Hash->Md, NULL, Hash->HmacKey)) {
+        Status = QUIC_STATUS_INTERNAL_ERROR;
+        goto Exit;
+    }
+
     *NewHash = Hash;
     Hash = NULL;
 
@@ -2245,6 +3524,12 @@ QuicHashFree(
     )
 {
     if (Hash != NULL) {
+        if (Hash->HmacContext != NULL) {
+            EVP_MD_CTX_free(Hash->HmacContext);
+        }
+        if (Hash->HmacKey != NULL) {
+            EVP_PKEY_free(Hash->HmacKey);
+        }
         QuicFree(Hash);
         Hash = NULL;
     }
@@ -2261,21 +3546,14 @@ QuicHashCompute(
 {
     QUIC_STATUS Status = QUIC_STATUS_SUCCESS;
     EVP_MD_CTX* HashContext = NULL;
-    EVP_PKEY* HmacKey = NULL;
 
-    HashContext = EVP_MD_CTX_create();
+    HashContext = EVP_MD_CTX_new();
     if (HashContext == NULL) {
         Status = QUIC_STATUS_OUT_OF_MEMORY;
         goto Error;
     }
 
-    HmacKey = EVP_PKEY_new_mac_key(EVP_PKEY_HMAC, NULL, Hash->Salt, Hash->SaltLength);
-    if (HmacKey == NULL) {
-        Status = QUIC_STATUS_OUT_OF_MEMORY;
-        goto Error;
-    }
-
-    if (!EVP_DigestSignInit(HashContext, NULL, Hash->Md, NULL, HmacKey)) {
+    if (!EVP_MD_CTX_copy_ex(HashContext, Hash->HmacContext)) {
         Status = QUIC_STATUS_INTERNAL_ERROR;
         goto Error;
     }
@@ -2298,10 +3576,6 @@ Error:
         EVP_MD_CTX_free(HashContext);
     }
 
-    if (HmacKey != NULL) {
-        EVP_PKEY_free(HmacKey);
-    }
-
     return Status;
 }
 
@@ -2316,13 +3590,13 @@ QuicTlsKeySetAead(
     case QUIC_AEAD_AES_128_GCM:
         Key->PacketKey->Aead = EVP_aes_128_gcm();
         if (Key->HeaderKey != NULL) {
-            Key->HeaderKey->Aead = EVP_aes_128_ctr();
+            Key->HeaderKey->Aead = EVP_aes_128_ecb();
         }
         break;
     case QUIC_AEAD_AES_256_GCM:
         Key->PacketKey->Aead = EVP_aes_256_gcm();
         if (Key->HeaderKey != NULL) {
-            Key->HeaderKey->Aead = EVP_aes_256_ctr();
+            Key->HeaderKey->Aead = EVP_aes_256_ecb();
         }
         break;
     case QUIC_AEAD_CHACHA20_POLY1305:
@@ -2674,6 +3948,7 @@ QuicAllocatePacketKey(
         goto Error;
     }
 
+    QuicZeroMemory(TempKey->PacketKey, sizeof(QUIC_KEY));
     *Key = TempKey;
 
     return QUIC_STATUS_SUCCESS;
@@ -2718,7 +3993,7 @@ QuicTlsDerivePacketProtectionKey(
         return QUIC_STATUS_TLS_ERROR;
     }
 
-    return QUIC_STATUS_SUCCESS;
+    return QuicTlsKeyInitializeCipherCtx(QuicKey->PacketKey);
 }
 
 static
@@ -2787,7 +4062,7 @@ QuicTlsDeriveHeaderProtectionKey(
         return QUIC_STATUS_TLS_ERROR;
     }
 
-    return QUIC_STATUS_SUCCESS;
+    return QuicTlsHpKeyInitializeCipherCtx(QuicKey->HeaderKey);
 }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -3039,26 +4314,27 @@ int
 QuicTlsEncrypt(
     _Out_writes_bytes_(OutputBufferLen) uint8_t *OutputBuffer,
     _In_ size_t OutputBufferLen,
-    _In_reads_bytes_(PlainTextLen) const uint8_t *PlainText,
-    _In_ size_t PlainTextLen,
-    _In_reads_bytes_(KeyLen) const uint8_t *Key,
-    _In_ size_t KeyLen,
-    _In_reads_bytes_(NonceLen) const uint8_t *Nonce,
-    _In_ size_t NonceLen,
+    _In_ uint32_t PlainTextCount,
+    _In_reads_(PlainTextCount) const QUIC_BUFFER *PlainText,
+    _In_reads_bytes_(QUIC_IV_LENGTH) const uint8_t *Nonce,
     _In_reads_bytes_(AuthDataLen) const uint8_t *Authdata,
     _In_ size_t AuthDataLen,
-    _In_ const EVP_CIPHER *Aead
+    _In_ const QUIC_KEY *Key
     )
 {
-    UNREFERENCED_PARAMETER(KeyLen);
     int Ret = 0;
-    size_t TagLen = QuicTlsAeadTagLength(Aead);
-    EVP_CIPHER_CTX *CipherCtx = NULL;
+    size_t TagLen = QuicTlsAeadTagLength(Key->Aead);
+    EVP_CIPHER_CTX *CipherCtx = Key->CipherCtx;
+    size_t PlainTextLen = 0;
     size_t OutLen = 0;
     int Len = 0;
 
     QUIC_FRE_ASSERT(TagLen == QUIC_ENCRYPTION_OVERHEAD);
 
+    for (uint32_t i = 0; i < PlainTextCount; ++i) {
+        PlainTextLen += PlainText[i].Length;
+    }
+
     if (OutputBufferLen < PlainTextLen + TagLen) {
         QuicTraceEvent(
             LibraryErrorStatus,
@@ -3069,35 +4345,11 @@ QuicTlsEncrypt(
         goto Exit;
     }
 
-    CipherCtx = EVP_CIPHER_CTX_new();
-    if (CipherCtx == NULL) {
-        QuicTraceEvent(
-            LibraryError,
-            "[ lib] ERROR, %s.",
-            "CipherCtx alloc failed");
-        Ret = -1;
-        goto Exit;
-    }
-
-    if (EVP_EncryptInit_ex(CipherCtx, Aead, NULL, NULL, NULL) != 1) {
-        QuicTraceEvent(
-            LibraryError,
-            "[ lib] ERROR, %s.",
-            "EVP_EncryptInit_ex failed");
-        Ret = -1;
-        goto Exit;
-    }
-
-    if (EVP_CIPHER_CTX_ctrl(CipherCtx, EVP_CTRL_AEAD_SET_IVLEN, NonceLen, NULL) != 1) {
-        QuicTraceEvent(
-            LibraryError,
-            "[ lib] ERROR, %s.",
-            "EVP_CIPHER_CTX_ctrl failed");
-        Ret = -1;
-        goto Exit;
-    }
-
-    if (EVP_EncryptInit_ex(CipherCtx, NULL, NULL, Key, Nonce) != 1) {
+    //
+    // The cipher, IV length and key were all set up when the key was created,
+    // so only the nonce needs to be applied here.
+    //
+    if (EVP_EncryptInit_ex(CipherCtx, NULL, NULL, NULL, Nonce) != 1) {
         QuicTraceEvent(
             LibraryError,
             "[ lib] ERROR, %s.",
@@ -3117,17 +4369,28 @@ QuicTlsEncrypt(
         }
     }
 
-    if (EVP_EncryptUpdate(CipherCtx, OutputBuffer, &Len, PlainText, PlainTextLen) != 1) {
-        QuicTraceEvent(
-            LibraryError,
-            "[ lib] ERROR, %s.",
-            "EVP_EncryptUpdate failed");
-        Ret = -1;
-        goto Exit;
+    //
+    // The AEAD ciphers are all stream based, so each plain text segment can be
+    // encrypted straight to its position in the output, whether or not it's
+    // already there.
+    //
+    for (uint32_t i = 0; i < PlainTextCount; ++i) {
+        if (EVP_EncryptUpdate(
+                CipherCtx,
+                OutputBuffer + OutLen,
+                &Len,
+                PlainText[i].Buffer,
+                (int)PlainText[i].Length) != 1) {
+            QuicTraceEvent(
+                LibraryError,
+                "[ lib] ERROR, %s.",
+                "EVP_EncryptUpdate failed");
+            Ret = -1;
+            goto Exit;
+        }
+        OutLen += Len;
     }
 
-    OutLen = Len;
-
     if (EVP_EncryptFinal_ex(CipherCtx, OutputBuffer + OutLen, &Len) != 1) {
         QuicTraceEvent(
             LibraryError,
@@ -3151,11 +4414,6 @@ QuicTlsEncrypt(
 
 Exit:
 
-    if (CipherCtx != NULL) {
-        EVP_CIPHER_CTX_free(CipherCtx);
-        CipherCtx = NULL;
-    }
-
     return Ret;
 }
 
@@ -3166,19 +4424,15 @@ QuicTlsDecrypt(
     _In_ size_t OutputBufferLen,
     _In_reads_bytes_(CipherTextLen) const uint8_t *CipherText,
     _In_ size_t CipherTextLen,
-    _In_reads_bytes_(KeyLen) const uint8_t *Key,
-    _In_ size_t KeyLen,
-    _In_reads_bytes_(NonceLen) const uint8_t *Nonce,
-    _In_ size_t NonceLen,
+    _In_reads_bytes_(QUIC_IV_LENGTH) const uint8_t *Nonce,
     _In_reads_bytes_(AuthDataLen) const uint8_t *AuthData,
     _In_ size_t AuthDataLen,
-    _In_ const EVP_CIPHER *Aead
+    _In_ const QUIC_KEY *Key
     )
 {
-    UNREFERENCED_PARAMETER(KeyLen);
-    size_t TagLen = QuicTlsAeadTagLength(Aead);
+    size_t TagLen = QuicTlsAeadTagLength(Key->Aead);
     int Ret = -1;
-    EVP_CIPHER_CTX *CipherCtx = NULL;
+    EVP_CIPHER_CTX *CipherCtx = Key->CipherCtx;
 
     QUIC_FRE_ASSERT(TagLen == QUIC_ENCRYPTION_OVERHEAD);
 
@@ -3193,34 +4447,7 @@ QuicTlsDecrypt(
     CipherTextLen -= TagLen;
     uint8_t *Tag = (uint8_t *)CipherText + CipherTextLen;
 
-    CipherCtx = EVP_CIPHER_CTX_new();
-    if (CipherCtx == NULL) {
-        QuicTraceEvent(
-            LibraryError,
-            "[ lib] ERROR, %s.",
-            "EVP_CIPHER_CTX_new failed");
-        goto Exit;
-    }
-
-    if (EVP_DecryptInit_ex(CipherCtx, Aead, NULL, NULL, NULL) != 1) {
-        QuicTraceEvent(
-            LibraryErrorStatus,
-            "[ lib] ERROR, %u, %s.",
-            ERR_get_error(),
-            "EVP_DecryptInit_ex failed");
-        goto Exit;
-    }
-
-    if (EVP_CIPHER_CTX_ctrl(CipherCtx, EVP_CTRL_AEAD_SET_IVLEN, NonceLen, NULL) != 1) {
-        QuicTraceEvent(
-            LibraryErrorStatus,
-            "[ lib] ERROR, %u, %s.",
-            ERR_get_error(),
-            "EVP_CIPHER_CTX_ctrl failed");
-        goto Exit;
-    }
-
-    if (EVP_DecryptInit_ex(CipherCtx, NULL, NULL, Key, Nonce) != 1) {
+    if (EVP_DecryptInit_ex(CipherCtx, NULL, NULL, NULL, Nonce) != 1) {
         QuicTraceEvent(
             LibraryErrorStatus,
             "[ lib] ERROR, %u, %s.",
@@ -3277,10 +4504,57 @@ QuicTlsDecrypt(
 
 Exit:
 
-    if (CipherCtx != NULL) {
-        EVP_CIPHER_CTX_free(CipherCtx);
-        CipherCtx = NULL;
+    return Ret;
+}
+
+static
+QUIC_STATUS
+QuicTlsKeyInitializeCipherCtx(
+    _Inout_ QUIC_KEY *Key
+    )
+{
+    QUIC_DBG_ASSERT(Key->CipherCtx == NULL);
+
+    Key->CipherCtx = EVP_CIPHER_CTX_new();
+    if (Key->CipherCtx == NULL) {
+        QuicTraceEvent(
+            LibraryError,
+            "[ lib] ERROR, %s.",
+            "CipherCtx alloc failed");
+        return QUIC_STATUS_OUT_OF_MEMORY;
+    }
+
+    //
+    // All the supported AEADs use the same key schedule for both directions,
+    // so the context is set up for encryption here and QuicTlsDecrypt just
+    // flips the direction when it applies the per-packet nonce.
+    //
+    if (EVP_EncryptInit_ex(Key->CipherCtx, Key->Aead, NULL, NULL, NULL) != 1) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            ERR_get_error(),
+            "EVP_EncryptInit_ex failed");
+        return QUIC_STATUS_TLS_ERROR;
     }
 
-    return Ret;
+    if (EVP_CIPHER_CTX_ctrl(Key->CipherCtx, EVP_CTRL_AEAD_SET_IVLEN, QUIC_IV_LENGTH, NULL) != 1) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            ERR_get_error(),
+            "EVP_CIPHER_CTX_ctrl failed");
+        return QUIC_STATUS_TLS_ERROR;
+    }
+
+    if (EVP_EncryptInit_ex(Key->CipherCtx, NULL, NULL, Key->Buffer, NULL) != 1) {
+        QuicTraceEvent(
+            LibraryErrorStatus,
+            "[ lib] ERROR, %u, %s.",
+            ERR_get_error(),
+            "EVP_EncryptInit_ex failed");
+        return QUIC_STATUS_TLS_ERROR;
+    }
+
+    return QUIC_STATUS_SUCCESS;
 }
@@ -1357,14 +1357,16 @@ QuicTlsSessionUninitialize(
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
-QuicTlsSessionSetTicketKey(
+QuicTlsSessionSetTicketKeys(
     _In_ QUIC_TLS_SESSION* TlsSession,
-    _In_reads_bytes_(44)
-        const void* Buffer
+    _In_range_(1, QUIC_MAX_TICKET_KEY_COUNT) uint32_t KeyCount,
+    _In_reads_bytes_(KeyCount * QUIC_TICKET_KEY_LENGTH)
+        const uint8_t* Keys
     )
 {
     UNREFERENCED_PARAMETER(TlsSession);
-    UNREFERENCED_PARAMETER(Buffer);
+    UNREFERENCED_PARAMETER(KeyCount);
+    UNREFERENCED_PARAMETER(Keys);
     return QUIC_STATUS_NOT_SUPPORTED;
 }
 
@@ -3012,6 +3014,39 @@ QuicEncrypt(
     return NtStatusToQuicStatus(Status);
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+QUIC_STATUS
+QuicEncryptWithCopy(
+    _In_ QUIC_KEY* Key,
+    _In_reads_bytes_(QUIC_IV_LENGTH)
+        const uint8_t* const Iv,
+    _In_ uint16_t AuthDataLength,
+    _In_reads_bytes_opt_(AuthDataLength)
+        const uint8_t* const AuthData,
+    _In_ uint32_t SegmentCount,
+    _In_reads_(SegmentCount)
+        const QUIC_BUFFER* const Segments,
+    _In_ uint16_t BufferLength,
+    _Out_writes_bytes_(BufferLength)
+        uint8_t* Buffer
+    )
+{
+    //
+    // BCryptEncrypt can't read the plain text from multiple buffers, so gather
+    // it into place first and encrypt it there.
+    //
+    uint16_t Offset = 0;
+    for (uint32_t i = 0; i < SegmentCount; ++i) {
+        if (Segments[i].Buffer != Buffer + Offset) {
+            QuicCopyMemory(Buffer + Offset, Segments[i].Buffer, Segments[i].Length);
+        }
+        Offset += (uint16_t)Segments[i].Length;
+    }
+    QUIC_DBG_ASSERT(Offset + QUIC_ENCRYPTION_OVERHEAD == BufferLength);
+
+    return QuicEncrypt(Key, Iv, AuthDataLength, AuthData, BufferLength, Buffer);
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 QUIC_STATUS
 QuicDecrypt(
@@ -3059,6 +3094,30 @@ QuicDecrypt(
     return NtStatusToQuicStatus(Status);
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+void
+QuicDecryptBatch(
+    _In_ QUIC_KEY* Key,
+    _In_ uint8_t BatchSize,
+    _Inout_updates_(BatchSize)
+        QUIC_DECRYPT_BATCH_ENTRY* Entries
+    )
+{
+    //
+    // BCrypt has no call that decrypts multiple buffers at once.
+    //
+    for (uint8_t i = 0; i < BatchSize; ++i) {
+        Entries[i].Status =
+            QuicDecrypt(
+                Key,
+                Entries[i].Iv,
+                Entries[i].AuthDataLength,
+                Entries[i].AuthData,
+                Entries[i].BufferLength,
+                Entries[i].Buffer);
+    }
+}
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 QUIC_STATUS
 QuicHpKeyCreate(
@@ -44,6 +44,15 @@ Notes:
     is, no byte need be processed partially in the array passed in by the
     caller.
 
+    Where the processor supports carry-less multiplication (PCLMULQDQ on x86,
+    PMULL on ARM64) the hash is instead computed four input bytes at a time.
+    XORing shifted copies of the key for each set input bit is exactly the
+    carry-less product of the key and the (bit reversed) input, so a 32-bit
+    input word X at byte offset p contributes bits 32..63 of
+    clmul(K[p..p+7], rev32(X)). To avoid reversing every input word, the key
+    windows are stored reflected, which moves the reversal to a single one on
+    the final 32-bit result.
+
 --*/
 
 #include "platform_internal.h"
@@ -51,6 +60,50 @@ Notes:
 #include "toeplitz.c.clog.h"
 #endif
 
+#if defined(_M_X64) || defined(__x86_64__) || defined(__i386__)
+#define QUIC_TOEPLITZ_CLMUL_X86 1
+#ifdef _WIN32
+#include <intrin.h>
+#define QUIC_TOEPLITZ_CLMUL_TARGET
+#else
+#include <cpuid.h>
+#define QUIC_TOEPLITZ_CLMUL_TARGET __attribute__((target("pclmul,sse2")))
+#endif
+#include <wmmintrin.h>
+#elif defined(__aarch64__) && defined(QUIC_PLATFORM_LINUX)
+#define QUIC_TOEPLITZ_CLMUL_ARM64 1
+#define QUIC_TOEPLITZ_CLMUL_TARGET __attribute__((target("+crypto")))
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+//
+// Returns TRUE if the processor supports a 64x64 carry-less multiply.
+//
+static
+BOOLEAN
+QuicToeplitzCarrylessMultiplySupported(
+    void
+    )
+{
+#if defined(QUIC_TOEPLITZ_CLMUL_X86) && defined(_WIN32)
+    int CpuInfo[4];
+    __cpuid(CpuInfo, 1);
+    return (CpuInfo[2] & (1 << 1)) != 0; // ECX.PCLMULQDQ
+#elif defined(QUIC_TOEPLITZ_CLMUL_X86)
+    unsigned int Eax, Ebx, Ecx, Edx;
+    if (!__get_cpuid(1, &Eax, &Ebx, &Ecx, &Edx)) {
+        return FALSE;
+    }
+    return (Ecx & bit_PCLMUL) != 0;
+#elif defined(QUIC_TOEPLITZ_CLMUL_ARM64)
+    return (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+#else
+    return FALSE;
+#endif
+}
+
 //
 // Initializes the state required for a Toeplitz hash computation. We
 // maintain per-nibble lookup tables, and we initialize them here.
@@ -133,8 +186,122 @@ QuicToeplitzHashInitialize(
             }
         }
     }
+
+    //
+    // Initialize the Toeplitz->ReflectedKey windows. Key bits past the end of
+    // the key are only ever multiplied by zero padding, so are treated as zero.
+    //
+    for (uint32_t i = 0; i < QUIC_TOEPLITZ_INPUT_SIZE; i++) {
+        uint64_t Reflected = 0;
+        for (uint32_t j = 0; j < sizeof(uint64_t); j++) {
+            if (i + j < QUIC_TOEPLITZ_KEY_SIZE) {
+                uint8_t Byte = Toeplitz->HashKey[i + j];
+                for (uint32_t k = 0; k < 8; k++) {
+                    //
+                    // Key bit (8j + k), counting from the MSB, goes to bit
+                    // (8j + k) of the reflected value.
+                    //
+                    if (Byte & (0x80 >> k)) {
+                        Reflected |= 1ull << (8 * j + k);
+                    }
+                }
+            }
+        }
+        Toeplitz->ReflectedKey[i] = Reflected;
+    }
+
+    Toeplitz->UseCarrylessMultiply = QuicToeplitzCarrylessMultiplySupported();
+}
+
+#if defined(QUIC_TOEPLITZ_CLMUL_X86) || defined(QUIC_TOEPLITZ_CLMUL_ARM64)
+
+static
+uint32_t
+QuicToeplitzReverse32(
+    _In_ uint32_t Value
+    )
+{
+    Value = ((Value >> 1) & 0x55555555) | ((Value & 0x55555555) << 1);
+    Value = ((Value >> 2) & 0x33333333) | ((Value & 0x33333333) << 2);
+    Value = ((Value >> 4) & 0x0F0F0F0F) | ((Value & 0x0F0F0F0F) << 4);
+    Value = ((Value >> 8) & 0x00FF00FF) | ((Value & 0x00FF00FF) << 8);
+    return (Value >> 16) | (Value << 16);
+}
+
+//
+// Reads up to four bytes of the input as a big endian word, zero padded.
+//
+static
+uint32_t
+QuicToeplitzReadWord(
+    _In_reads_(Length)
+        const uint8_t* Input,
+    _In_ uint32_t Length
+    )
+{
+    if (Length >= sizeof(uint32_t)) {
+        return
+            ((uint32_t)Input[0] << 24) | ((uint32_t)Input[1] << 16) |
+            ((uint32_t)Input[2] << 8) | Input[3];
+    }
+    uint32_t Word = 0;
+    for (uint32_t i = 0; i < Length; i++) {
+        Word |= (uint32_t)Input[i] << (24 - 8 * i);
+    }
+    return Word;
 }
 
+//
+// Computes the hash four bytes at a time with carry-less multiplication. See
+// the notes at the top of the file.
+//
+static
+QUIC_TOEPLITZ_CLMUL_TARGET
+uint32_t
+QuicToeplitzHashComputeClmul(
+    _In_ const QUIC_TOEPLITZ_HASH* Toeplitz,
+    _In_reads_(HashInputLength)
+        const uint8_t* HashInput,
+    _In_ uint32_t HashInputLength,
+    _In_ uint32_t HashInputOffset
+    )
+{
+    uint64_t Product;
+
+#ifdef QUIC_TOEPLITZ_CLMUL_X86
+    __m128i Accumulator = _mm_setzero_si128();
+    for (uint32_t i = 0; i < HashInputLength; i += sizeof(uint32_t)) {
+        uint64_t Word = QuicToeplitzReadWord(HashInput + i, HashInputLength - i);
+        __m128i Key =
+            _mm_loadl_epi64((const __m128i*)&Toeplitz->ReflectedKey[HashInputOffset + i]);
+        Accumulator =
+            _mm_xor_si128(
+                Accumulator,
+                _mm_clmulepi64_si128(Key, _mm_loadl_epi64((const __m128i*)&Word), 0x00));
+    }
+    _mm_storel_epi64((__m128i*)&Product, Accumulator);
+#else
+    poly128_t Accumulator = 0;
+    for (uint32_t i = 0; i < HashInputLength; i += sizeof(uint32_t)) {
+        uint64_t Word = QuicToeplitzReadWord(HashInput + i, HashInputLength - i);
+        Accumulator ^=
+            vmull_p64(
+                (poly64_t)Toeplitz->ReflectedKey[HashInputOffset + i],
+                (poly64_t)Word);
+    }
+    Product = (uint64_t)Accumulator;
+#endif
+
+    //
+    // The product of the reflected key and the input is the reflection of the
+    // product of the key and the reflected input, so the result bits are
+    // found, reversed, at bits 31..62.
+    //
+    return QuicToeplitzReverse32((uint32_t)(Product >> 31));
+}
+
+#endif
+
 //
 // Computes the hash by processing the input four-bits at a time. It is assumed
 // that the hash input is a whole number of bytes (no partial byte-processing
@@ -158,6 +325,17 @@ QuicToeplitzHashCompute(
     QUIC_DBG_ASSERT(
         (BaseOffset + HashInputLength * NIBBLES_PER_BYTE) <= QUIC_TOEPLITZ_LOOKUP_TABLE_COUNT);
 
+#if defined(QUIC_TOEPLITZ_CLMUL_X86) || defined(QUIC_TOEPLITZ_CLMUL_ARM64)
+    if (Toeplitz->UseCarrylessMultiply) {
+        return
+            QuicToeplitzHashComputeClmul(
+                Toeplitz,
+                HashInput,
+                HashInputLength,
+                HashInputOffset);
+    }
+#endif
+
     for (uint32_t i = 0; i < HashInputLength; i++) {
         Result ^= Toeplitz->LookupTableArray[BaseOffset].Table[(HashInput[i] >> 4) & 0xf];
         BaseOffset++;
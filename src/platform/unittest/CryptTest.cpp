@@ -308,6 +308,51 @@ TEST_P(CryptTest, Encryption)
     ASSERT_FALSE(Key.Decrypt(Iv, sizeof(AuthData), AuthData, sizeof(Buffer), Buffer));
 }
 
+TEST_P(CryptTest, DecryptBatch)
+{
+    int AEAD = GetParam();
+
+    uint8_t RawKey[32] = {0};
+    uint8_t AuthData[12] = {0};
+    const uint8_t BatchSize = 4;
+    uint8_t Buffers[BatchSize][128];
+    QUIC_DECRYPT_BATCH_ENTRY Entries[BatchSize];
+
+    QuicKey Key((QUIC_AEAD_TYPE)AEAD, RawKey);
+    if (Key.Ptr == NULL) return;
+
+    for (uint8_t i = 0; i < BatchSize; ++i) {
+        QuicZeroMemory(Entries[i].Iv, sizeof(Entries[i].Iv));
+        Entries[i].Iv[0] = i;
+        for (uint8_t j = 0; j < sizeof(Buffers[i]) - QUIC_ENCRYPTION_OVERHEAD; ++j) {
+            Buffers[i][j] = (uint8_t)(i + j);
+        }
+        ASSERT_TRUE(Key.Encrypt(Entries[i].Iv, sizeof(AuthData), AuthData, sizeof(Buffers[i]), Buffers[i]));
+        Entries[i].AuthDataLength = sizeof(AuthData);
+        Entries[i].AuthData = AuthData;
+        Entries[i].BufferLength = sizeof(Buffers[i]);
+        Entries[i].Buffer = Buffers[i];
+    }
+
+    //
+    // A failure only affects its own entry.
+    //
+    Buffers[2][0] ^= 1;
+
+    QuicDecryptBatch(Key.Ptr, BatchSize, Entries);
+
+    for (uint8_t i = 0; i < BatchSize; ++i) {
+        if (i == 2) {
+            ASSERT_TRUE(QUIC_FAILED(Entries[i].Status));
+            continue;
+        }
+        ASSERT_EQ(QUIC_STATUS_SUCCESS, Entries[i].Status);
+        for (uint8_t j = 0; j < sizeof(Buffers[i]) - QUIC_ENCRYPTION_OVERHEAD; ++j) {
+            ASSERT_EQ((uint8_t)(i + j), Buffers[i][j]);
+        }
+    }
+}
+
 TEST_P(CryptTest, HashWellKnown)
 {
     int HASH = GetParam();
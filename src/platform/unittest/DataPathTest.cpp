@@ -17,6 +17,140 @@ Abstract:
 #include "DataPathTest.cpp.clog.h"
 #endif
 
+#if defined(QUIC_PLATFORM_LINUX) && !defined(QUIC_LINUX_IO_URING)
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+
+//
+// The datapath is linked into the test, so sendmmsg and epoll_ctl can be
+// interposed to make a send batch run out of socket buffer space part way
+// through. Once the injected EAGAIN has been returned, the write readiness
+// the datapath arms is held back until the test releases it, so the pended
+// sends stay queued (and the worker doesn't race the test) until then.
+//
+struct SendBlockState {
+    pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+    bool Armed {false};
+    bool Blocked {false};
+    uint32_t Budget {0};            // Messages let through before EAGAIN
+    uint32_t CallsWhileBlocked {0};
+    bool ArmDeferred {false};
+    int DeferredEpollFd {-1};
+    int DeferredFd {-1};
+    struct epoll_event DeferredEvent {};
+};
+
+static SendBlockState SendBlock;
+
+extern "C"
+int
+sendmmsg(
+    int Fd,
+    struct mmsghdr* MsgVec,
+    unsigned int VLen,
+    int Flags
+    )
+{
+    using SendMmsgFn = int (*)(int, struct mmsghdr*, unsigned int, int);
+    static SendMmsgFn RealSendMmsg = (SendMmsgFn)dlsym(RTLD_NEXT, "sendmmsg");
+
+    int Result;
+    pthread_mutex_lock(&SendBlock.Lock);
+    if (!SendBlock.Armed) {
+        Result = RealSendMmsg(Fd, MsgVec, VLen, Flags);
+    } else if (SendBlock.Blocked || SendBlock.Budget == 0) {
+        SendBlock.Blocked = true;
+        SendBlock.CallsWhileBlocked++;
+        errno = EAGAIN;
+        Result = -1;
+    } else {
+        Result =
+            RealSendMmsg(
+                Fd,
+                MsgVec,
+                VLen < SendBlock.Budget ? VLen : SendBlock.Budget,
+                Flags);
+        if (Result > 0) {
+            SendBlock.Budget -= (uint32_t)Result;
+        }
+    }
+    pthread_mutex_unlock(&SendBlock.Lock);
+    return Result;
+}
+
+using EpollCtlFn = int (*)(int, int, int, struct epoll_event*);
+
+extern "C"
+int
+epoll_ctl(
+    int EpollFd,
+    int Op,
+    int Fd,
+    struct epoll_event* Event
+    ) noexcept
+{
+    static EpollCtlFn RealEpollCtl = (EpollCtlFn)dlsym(RTLD_NEXT, "epoll_ctl");
+
+    int Result = 0;
+    pthread_mutex_lock(&SendBlock.Lock);
+    if (SendBlock.Blocked && Op == EPOLL_CTL_MOD && (Event->events & EPOLLOUT)) {
+        SendBlock.ArmDeferred = true;
+        SendBlock.DeferredEpollFd = EpollFd;
+        SendBlock.DeferredFd = Fd;
+        SendBlock.DeferredEvent = *Event;
+    } else {
+        Result = RealEpollCtl(EpollFd, Op, Fd, Event);
+    }
+    pthread_mutex_unlock(&SendBlock.Lock);
+    return Result;
+}
+
+static
+void
+SendBlockArm(
+    _In_ uint32_t Budget
+    )
+{
+    pthread_mutex_lock(&SendBlock.Lock);
+    SendBlock.Armed = true;
+    SendBlock.Blocked = false;
+    SendBlock.Budget = Budget;
+    SendBlock.CallsWhileBlocked = 0;
+    SendBlock.ArmDeferred = false;
+    pthread_mutex_unlock(&SendBlock.Lock);
+}
+
+//
+// Stops injecting errors and re-arms the write readiness held back, if any.
+// Returns the number of sendmmsg calls failed with EAGAIN.
+//
+static
+uint32_t
+SendBlockRelease(
+    _Out_ bool* ArmDeferred
+    )
+{
+    static EpollCtlFn RealEpollCtl = (EpollCtlFn)dlsym(RTLD_NEXT, "epoll_ctl");
+
+    pthread_mutex_lock(&SendBlock.Lock);
+    uint32_t CallsWhileBlocked = SendBlock.CallsWhileBlocked;
+    *ArmDeferred = SendBlock.ArmDeferred;
+    SendBlock.Armed = false;
+    SendBlock.Blocked = false;
+    if (SendBlock.ArmDeferred) {
+        RealEpollCtl(
+            SendBlock.DeferredEpollFd,
+            EPOLL_CTL_MOD,
+            SendBlock.DeferredFd,
+            &SendBlock.DeferredEvent);
+        SendBlock.ArmDeferred = false;
+    }
+    pthread_mutex_unlock(&SendBlock.Lock);
+    return CallsWhileBlocked;
+}
+#endif
+
 const uint32_t ExpectedDataSize = 1 * 1024;
 char* ExpectedData;
 
@@ -184,11 +318,13 @@ protected:
         while (recvBuffer != NULL) {
             ASSERT_EQ(recvBuffer->BufferLength, ExpectedDataSize);
             ASSERT_EQ(0, memcmp(recvBuffer->Buffer, ExpectedData, ExpectedDataSize));
+            ASSERT_NE(0ull, recvBuffer->RecvTime);
+            ASSERT_LE(recvBuffer->RecvTime, QuicTimeUs64());
 
             if (recvBuffer->Tuple->LocalAddress.Ipv4.sin_port == RecvContext->ServerAddress.Ipv4.sin_port) {
 
                 auto ServerSendContext =
-                    QuicDataPathBindingAllocSendContext(binding, 0);
+                    QuicDataPathBindingAllocSendContext(binding, QUIC_ECN_NON_ECT, 0);
                 ASSERT_NE(nullptr, ServerSendContext);
 
                 auto ServerDatagram =
@@ -392,7 +528,7 @@ TEST_P(DataPathTest, Data)
     ASSERT_NE(nullptr, client);
 
     auto ClientSendContext =
-        QuicDataPathBindingAllocSendContext(client, 0);
+        QuicDataPathBindingAllocSendContext(client, QUIC_ECN_NON_ECT, 0);
     ASSERT_NE(nullptr, ClientSendContext);
 
     auto ClientDatagram =
@@ -418,6 +554,90 @@ TEST_P(DataPathTest, Data)
     QuicEventUninitialize(RecvContext.ClientCompletion);
 }
 
+TEST_P(DataPathTest, DataTxTime)
+{
+    QUIC_DATAPATH* datapath = nullptr;
+    QUIC_DATAPATH_BINDING* server = nullptr;
+    QUIC_DATAPATH_BINDING* client = nullptr;
+    auto serverAddress = GetNewLocalAddr();
+
+    DataRecvContext RecvContext = {};
+
+    QuicEventInitialize(&RecvContext.ClientCompletion, FALSE, FALSE);
+
+    VERIFY_QUIC_SUCCESS(
+        QuicDataPathInitialize(
+            0,
+            DataRecvCallback,
+            EmptyUnreachableCallback,
+            &datapath));
+    ASSERT_NE(nullptr, datapath);
+
+    if (!(QuicDataPathGetSupportedFeatures(datapath) & QUIC_DATAPATH_FEATURE_SEND_TXTIME)) {
+        QuicDataPathUninitialize(datapath);
+        QuicEventUninitialize(RecvContext.ClientCompletion);
+        GTEST_SKIP_NO_RETURN_(": Departure times unsupported");
+        return;
+    }
+
+    QUIC_STATUS Status = QUIC_STATUS_ADDRESS_IN_USE;
+    while (Status == QUIC_STATUS_ADDRESS_IN_USE) {
+        serverAddress.SockAddr.Ipv4.sin_port = GetNextPort();
+        Status =
+            QuicDataPathBindingCreate(
+                datapath,
+                &serverAddress.SockAddr,
+                nullptr,
+                &RecvContext,
+                &server);
+    }
+    VERIFY_QUIC_SUCCESS(Status);
+    ASSERT_NE(nullptr, server);
+    QuicDataPathBindingGetLocalAddress(server, &RecvContext.ServerAddress);
+    ASSERT_NE(RecvContext.ServerAddress.Ipv4.sin_port, (uint16_t)0);
+    serverAddress.SetPort(RecvContext.ServerAddress.Ipv4.sin_port);
+
+    VERIFY_QUIC_SUCCESS(
+        QuicDataPathBindingCreate(
+            datapath,
+            nullptr,
+            &serverAddress.SockAddr,
+            &RecvContext,
+            &client));
+    ASSERT_NE(nullptr, client);
+
+    auto ClientSendContext =
+        QuicDataPathBindingAllocSendContext(client, QUIC_ECN_NON_ECT, 0);
+    ASSERT_NE(nullptr, ClientSendContext);
+
+    //
+    // The datagram must still arrive when it's held back a little.
+    //
+    QuicDataPathBindingSetSendTxTime(ClientSendContext, QuicTimeUs64() + 1000);
+
+    auto ClientDatagram =
+        QuicDataPathBindingAllocSendDatagram(ClientSendContext, ExpectedDataSize);
+    ASSERT_NE(nullptr, ClientDatagram);
+
+    memcpy(ClientDatagram->Buffer, ExpectedData, ExpectedDataSize);
+
+    VERIFY_QUIC_SUCCESS(
+        QuicDataPathBindingSendTo(
+            client,
+            &serverAddress.SockAddr,
+            ClientSendContext));
+
+    ASSERT_TRUE(QuicEventWaitWithTimeout(RecvContext.ClientCompletion, 2000));
+
+    QuicDataPathBindingDelete(client);
+    QuicDataPathBindingDelete(server);
+
+    QuicDataPathUninitialize(
+        datapath);
+
+    QuicEventUninitialize(RecvContext.ClientCompletion);
+}
+
 TEST_P(DataPathTest, DataRebind)
 {
     QUIC_DATAPATH* datapath = nullptr;
@@ -471,7 +691,7 @@ TEST_P(DataPathTest, DataRebind)
     ASSERT_NE(nullptr, client);
 
     auto ClientSendContext =
-        QuicDataPathBindingAllocSendContext(client, 0);
+        QuicDataPathBindingAllocSendContext(client, QUIC_ECN_NON_ECT, 0);
     ASSERT_NE(nullptr, ClientSendContext);
 
     auto ClientDatagram =
@@ -502,7 +722,7 @@ TEST_P(DataPathTest, DataRebind)
     ASSERT_NE(nullptr, client);
 
     ClientSendContext =
-        QuicDataPathBindingAllocSendContext(client, 0);
+        QuicDataPathBindingAllocSendContext(client, QUIC_ECN_NON_ECT, 0);
     ASSERT_NE(nullptr, ClientSendContext);
 
     ClientDatagram =
@@ -528,4 +748,258 @@ TEST_P(DataPathTest, DataRebind)
     QuicEventUninitialize(RecvContext.ClientCompletion);
 }
 
+TEST_P(DataPathTest, DataBatch)
+{
+    QUIC_DATAPATH* datapath = nullptr;
+    QUIC_DATAPATH_BINDING* server = nullptr;
+    QUIC_DATAPATH_BINDING* clients[2] = { nullptr, nullptr };
+    auto serverAddress = GetNewLocalAddr();
+
+    DataRecvContext ServerRecvContext = {};
+    DataRecvContext ClientRecvContexts[2] = {};
+
+    QuicEventInitialize(&ServerRecvContext.ClientCompletion, FALSE, FALSE);
+    for (auto& Context : ClientRecvContexts) {
+        QuicEventInitialize(&Context.ClientCompletion, FALSE, FALSE);
+    }
+
+    VERIFY_QUIC_SUCCESS(
+        QuicDataPathInitialize(
+            0,
+            DataRecvCallback,
+            EmptyUnreachableCallback,
+            &datapath));
+    ASSERT_NE(nullptr, datapath);
+
+    QUIC_STATUS Status = QUIC_STATUS_ADDRESS_IN_USE;
+    while (Status == QUIC_STATUS_ADDRESS_IN_USE) {
+        serverAddress.SockAddr.Ipv4.sin_port = GetNextPort();
+        Status =
+            QuicDataPathBindingCreate(
+                datapath,
+                &serverAddress.SockAddr,
+                nullptr,
+                &ServerRecvContext,
+                &server);
+#ifdef _WIN32
+        if (Status == HRESULT_FROM_WIN32(WSAEACCES)) {
+            Status = QUIC_STATUS_ADDRESS_IN_USE;
+            std::cout << "Replacing EACCESS with ADDRINUSE for port: " <<
+                htons(serverAddress.SockAddr.Ipv4.sin_port) << std::endl;
+        }
+#endif //_WIN32
+    }
+    VERIFY_QUIC_SUCCESS(Status);
+    ASSERT_NE(nullptr, server);
+    QuicDataPathBindingGetLocalAddress(server, &ServerRecvContext.ServerAddress);
+    ASSERT_NE(ServerRecvContext.ServerAddress.Ipv4.sin_port, (uint16_t)0);
+    serverAddress.SetPort(ServerRecvContext.ServerAddress.Ipv4.sin_port);
+
+    //
+    // Send to two clients, each on its own port, in one batch from the server.
+    //
+    QuicAddr clientAddresses[2];
+    QUIC_DATAPATH_SEND_ENTRY Entries[2];
+    for (uint32_t i = 0; i < 2; ++i) {
+        ClientRecvContexts[i].ServerAddress = ServerRecvContext.ServerAddress;
+        VERIFY_QUIC_SUCCESS(
+            QuicDataPathBindingCreate(
+                datapath,
+                nullptr,
+                &serverAddress.SockAddr,
+                &ClientRecvContexts[i],
+                &clients[i]));
+        ASSERT_NE(nullptr, clients[i]);
+
+        QUIC_ADDR ClientLocalAddress;
+        QuicDataPathBindingGetLocalAddress(clients[i], &ClientLocalAddress);
+        clientAddresses[i] = serverAddress;
+        clientAddresses[i].SetPort(ClientLocalAddress.Ipv4.sin_port);
+
+        auto ServerSendContext =
+            QuicDataPathBindingAllocSendContext(server, QUIC_ECN_NON_ECT, 0);
+        ASSERT_NE(nullptr, ServerSendContext);
+
+        auto ServerDatagram =
+            QuicDataPathBindingAllocSendDatagram(ServerSendContext, ExpectedDataSize);
+        ASSERT_NE(nullptr, ServerDatagram);
+
+        memcpy(ServerDatagram->Buffer, ExpectedData, ExpectedDataSize);
+
+        Entries[i].LocalAddress = &serverAddress.SockAddr;
+        Entries[i].RemoteAddress = &clientAddresses[i].SockAddr;
+        Entries[i].SendContext = ServerSendContext;
+    }
+
+    VERIFY_QUIC_SUCCESS(
+        QuicDataPathBindingSendBatch(
+            server,
+            ARRAYSIZE(Entries),
+            Entries));
+
+    for (auto& Context : ClientRecvContexts) {
+        ASSERT_TRUE(QuicEventWaitWithTimeout(Context.ClientCompletion, 2000));
+    }
+
+    for (auto& client : clients) {
+        QuicDataPathBindingDelete(client);
+    }
+    QuicDataPathBindingDelete(server);
+
+    QuicDataPathUninitialize(
+        datapath);
+
+    for (auto& Context : ClientRecvContexts) {
+        QuicEventUninitialize(Context.ClientCompletion);
+    }
+    QuicEventUninitialize(ServerRecvContext.ClientCompletion);
+}
+
+#if defined(QUIC_PLATFORM_LINUX) && !defined(QUIC_LINUX_IO_URING)
+struct OrderRecvContext {
+    uint32_t Sequence[64];
+    uint32_t Count;
+    uint32_t Expected;
+    QUIC_EVENT Completion;
+};
+
+static void
+OrderRecvCallback(
+    _In_ QUIC_DATAPATH_BINDING* /* Binding */,
+    _In_ void * RecvContext,
+    _In_ QUIC_RECV_DATAGRAM* RecvBufferChain
+    )
+{
+    OrderRecvContext* Context = (OrderRecvContext*)RecvContext;
+    if (Context != nullptr) {
+        for (QUIC_RECV_DATAGRAM* Datagram = RecvBufferChain;
+             Datagram != NULL;
+             Datagram = Datagram->Next) {
+            uint32_t Sequence = UINT32_MAX;
+            if (Datagram->BufferLength >= sizeof(Sequence)) {
+                memcpy(&Sequence, Datagram->Buffer, sizeof(Sequence));
+            }
+            if (Context->Count < ARRAYSIZE(Context->Sequence)) {
+                Context->Sequence[Context->Count] = Sequence;
+            }
+            Context->Count++;
+        }
+        if (Context->Count >= Context->Expected) {
+            QuicEventSet(Context->Completion);
+        }
+    }
+    QuicDataPathBindingReturnRecvDatagrams(RecvBufferChain);
+}
+
+TEST_P(DataPathTest, DataBatchSendBlocked)
+{
+    const uint32_t EntryCount = 16;
+    const uint32_t DatagramsPerEntry = 4; // More than one sendmmsg worth in total
+    const uint16_t DatagramSize = 64;
+
+    QUIC_DATAPATH* datapath = nullptr;
+    QUIC_DATAPATH_BINDING* server = nullptr;
+    QUIC_DATAPATH_BINDING* client = nullptr;
+    auto serverAddress = GetNewLocalAddr();
+
+    OrderRecvContext ClientRecvContext = {};
+    ClientRecvContext.Expected = EntryCount * DatagramsPerEntry;
+    ASSERT_LE(ClientRecvContext.Expected, ARRAYSIZE(ClientRecvContext.Sequence));
+    QuicEventInitialize(&ClientRecvContext.Completion, FALSE, FALSE);
+
+    VERIFY_QUIC_SUCCESS(
+        QuicDataPathInitialize(
+            0,
+            OrderRecvCallback,
+            EmptyUnreachableCallback,
+            &datapath));
+    ASSERT_NE(nullptr, datapath);
+
+    QUIC_STATUS Status = QUIC_STATUS_ADDRESS_IN_USE;
+    while (Status == QUIC_STATUS_ADDRESS_IN_USE) {
+        serverAddress.SockAddr.Ipv4.sin_port = GetNextPort();
+        Status =
+            QuicDataPathBindingCreate(
+                datapath,
+                &serverAddress.SockAddr,
+                nullptr,
+                nullptr,
+                &server);
+    }
+    VERIFY_QUIC_SUCCESS(Status);
+    ASSERT_NE(nullptr, server);
+    QUIC_ADDR ServerLocalAddress;
+    QuicDataPathBindingGetLocalAddress(server, &ServerLocalAddress);
+    serverAddress.SetPort(ServerLocalAddress.Ipv4.sin_port);
+
+    VERIFY_QUIC_SUCCESS(
+        QuicDataPathBindingCreate(
+            datapath,
+            nullptr,
+            &serverAddress.SockAddr,
+            &ClientRecvContext,
+            &client));
+    ASSERT_NE(nullptr, client);
+
+    QUIC_ADDR ClientLocalAddress;
+    QuicDataPathBindingGetLocalAddress(client, &ClientLocalAddress);
+    QuicAddr clientAddress = serverAddress;
+    clientAddress.SetPort(ClientLocalAddress.Ipv4.sin_port);
+
+    //
+    // Number every datagram, in the order they're batched.
+    //
+    QUIC_DATAPATH_SEND_ENTRY Entries[EntryCount];
+    uint32_t Sequence = 0;
+    for (uint32_t i = 0; i < EntryCount; ++i) {
+        auto ServerSendContext =
+            QuicDataPathBindingAllocSendContext(server, QUIC_ECN_NON_ECT, 0);
+        ASSERT_NE(nullptr, ServerSendContext);
+        for (uint32_t j = 0; j < DatagramsPerEntry; ++j) {
+            auto ServerDatagram =
+                QuicDataPathBindingAllocSendDatagram(ServerSendContext, DatagramSize);
+            ASSERT_NE(nullptr, ServerDatagram);
+            memset(ServerDatagram->Buffer, 0, DatagramSize);
+            memcpy(ServerDatagram->Buffer, &Sequence, sizeof(Sequence));
+            ++Sequence;
+        }
+        Entries[i].LocalAddress = &serverAddress.SockAddr;
+        Entries[i].RemoteAddress = &clientAddress.SockAddr;
+        Entries[i].SendContext = ServerSendContext;
+    }
+
+    //
+    // Run out of buffer space in the middle of the second entry.
+    //
+    SendBlockArm(DatagramsPerEntry + DatagramsPerEntry / 2);
+
+    VERIFY_QUIC_SUCCESS(
+        QuicDataPathBindingSendBatch(
+            server,
+            EntryCount,
+            Entries));
+
+    //
+    // Everything after the EAGAIN must have been pended, not sent.
+    //
+    bool ArmDeferred;
+    ASSERT_EQ(1u, SendBlockRelease(&ArmDeferred));
+    ASSERT_TRUE(ArmDeferred);
+
+    ASSERT_TRUE(QuicEventWaitWithTimeout(ClientRecvContext.Completion, 2000));
+    ASSERT_EQ(ClientRecvContext.Expected, ClientRecvContext.Count);
+    for (uint32_t i = 0; i < ClientRecvContext.Expected; ++i) {
+        ASSERT_EQ(i, ClientRecvContext.Sequence[i]);
+    }
+
+    QuicDataPathBindingDelete(client);
+    QuicDataPathBindingDelete(server);
+
+    QuicDataPathUninitialize(
+        datapath);
+
+    QuicEventUninitialize(ClientRecvContext.Completion);
+}
+#endif
+
 INSTANTIATE_TEST_SUITE_P(DataPathTest, DataPathTest, ::testing::Values(4, 6), testing::PrintToStringParamName());
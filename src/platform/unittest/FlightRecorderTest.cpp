@@ -0,0 +1,93 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Unit test for the in-memory trace flight recorder.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "FlightRecorderTest.cpp.clog.h"
+#endif
+
+static
+void
+QuicFlightRecorderTestCallback(
+    _In_opt_ void* Context,
+    _In_ uint32_t Processor,
+    _In_ const QUIC_FLIGHT_RECORD* Record
+    )
+{
+    UNREFERENCED_PARAMETER(Processor);
+    if (strcmp(Record->Name, "FlightRecorderTestEvent") == 0) {
+        ++*(uint32_t*)Context;
+    }
+}
+
+TEST(FlightRecorderTest, Format)
+{
+    QUIC_FLIGHT_RECORD Record;
+    Record.Sequence = 0;
+    Record.TimeUs = 0;
+    Record.Name = "Test";
+    Record.Format = "[conn][%p] %u (%d) 0x%llx %!CID! %c 100%%";
+    Record.ArgCount = 7;
+    Record.Args[0] = 0x1234;
+    Record.Args[1] = 42;
+    Record.Args[2] = (uint64_t)(int64_t)-7;
+    Record.Args[3] = 0xBEEF;
+    Record.Args[4] = 4;
+    Record.Args[5] = 0xABC;
+    Record.Args[6] = 'Q';
+
+    char Buffer[128];
+    uint32_t Length = QuicFlightRecordFormat(&Record, sizeof(Buffer), Buffer);
+    ASSERT_STREQ("[conn][0x1234] 42 (-7) 0xbeef 0xabc/4 Q 100%", Buffer);
+    ASSERT_EQ(strlen(Buffer), Length);
+
+    //
+    // Missing arguments are replaced, and the output is always terminated.
+    //
+    Record.ArgCount = 1;
+    QuicFlightRecordFormat(&Record, sizeof(Buffer), Buffer);
+    ASSERT_STREQ("[conn][0x1234] ? (?) 0x? ? ? 100%", Buffer);
+    Length = QuicFlightRecordFormat(&Record, 8, Buffer);
+    ASSERT_EQ(7u, Length);
+    ASSERT_STREQ("[conn][", Buffer);
+}
+
+TEST(FlightRecorderTest, WriteAndEnumerate)
+{
+    const uint64_t Args[2] = { 1, 2 };
+    uint32_t Count = 0;
+
+    //
+    // Nothing is recorded before initialization.
+    //
+    QuicFlightRecorderWrite("FlightRecorderTestEvent", "%u %u", 2, Args);
+    QuicFlightRecorderEnumerate(QuicFlightRecorderTestCallback, &Count);
+    ASSERT_EQ(0u, Count);
+
+    ASSERT_TRUE(QUIC_SUCCEEDED(QuicFlightRecorderInitialize()));
+
+    QuicFlightRecorderWrite("FlightRecorderTestEvent", "%u %u", 2, Args);
+    QuicFlightRecorderEnumerate(QuicFlightRecorderTestCallback, &Count);
+    ASSERT_EQ(1u, Count);
+
+    //
+    // Wrap the rings; only the most recent records are kept.
+    //
+    for (uint32_t i = 0; i < 2 * QUIC_FLIGHT_RECORDER_RECORD_COUNT; ++i) {
+        QuicFlightRecorderWrite("FlightRecorderTestEvent", "%u %u", 2, Args);
+    }
+    Count = 0;
+    QuicFlightRecorderEnumerate(QuicFlightRecorderTestCallback, &Count);
+    ASSERT_NE(0u, Count);
+    ASSERT_LE(Count, QUIC_FLIGHT_RECORDER_RECORD_COUNT * QuicProcMaxCount());
+
+    QuicFlightRecorderUninitialize();
+}
@@ -0,0 +1,108 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Unit test for the incremental growth of QUIC_HASHTABLE.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "HashtableTest.cpp.clog.h"
+#endif
+
+#include <vector>
+
+struct HashtableTestEntry {
+    QUIC_HASHTABLE_ENTRY Entry;
+    uint32_t Key;
+};
+
+static
+uint64_t
+HashtableTestHash(
+    uint32_t Key
+    )
+{
+    return QuicHashSimple(sizeof(Key), (const uint8_t*)&Key);
+}
+
+static
+HashtableTestEntry*
+HashtableTestLookup(
+    QUIC_HASHTABLE* Table,
+    uint32_t Key
+    )
+{
+    QUIC_HASHTABLE_LOOKUP_CONTEXT Context;
+    QUIC_HASHTABLE_ENTRY* Entry =
+        QuicHashtableLookup(Table, HashtableTestHash(Key), &Context);
+    while (Entry != NULL) {
+        HashtableTestEntry* TestEntry =
+            QUIC_CONTAINING_RECORD(Entry, HashtableTestEntry, Entry);
+        if (TestEntry->Key == Key) {
+            return TestEntry;
+        }
+        Entry = QuicHashtableLookupNext(Table, &Context);
+    }
+    return NULL;
+}
+
+TEST(HashtableTest, GrowsOnInsert)
+{
+    QUIC_HASHTABLE Table;
+    ASSERT_TRUE(QuicHashtableInitializeEx(&Table, QUIC_HASH_MIN_SIZE));
+
+    const uint32_t Count = 100000;
+    std::vector<HashtableTestEntry> Entries(Count);
+    for (uint32_t i = 0; i < Count; ++i) {
+        Entries[i].Key = i;
+        QuicHashtableInsert(&Table, &Entries[i].Entry, HashtableTestHash(i), NULL);
+        //
+        // Each insert only splits a single bucket, so the table can't fall
+        // more than one bucket behind the load factor.
+        //
+        ASSERT_LE(Table.NumEntries, (Table.TableSize + 1) * QUIC_HASH_MAX_LOAD_FACTOR);
+    }
+    ASSERT_EQ(Count, Table.NumEntries);
+    ASSERT_GT(Table.TableSize, (uint32_t)QUIC_HASH_MIN_SIZE);
+
+    for (uint32_t i = 0; i < Count; ++i) {
+        ASSERT_EQ(&Entries[i], HashtableTestLookup(&Table, i));
+    }
+    ASSERT_EQ(nullptr, HashtableTestLookup(&Table, Count));
+
+    for (uint32_t i = 0; i < Count; ++i) {
+        QuicHashtableRemove(&Table, &Entries[i].Entry, NULL);
+    }
+    ASSERT_EQ(0u, Table.NumEntries);
+    ASSERT_EQ(0u, Table.NonEmptyBuckets);
+
+    QuicHashtableUninitialize(&Table);
+}
+
+TEST(HashtableTest, NoGrowthWhileEnumerating)
+{
+    QUIC_HASHTABLE Table;
+    ASSERT_TRUE(QuicHashtableInitializeEx(&Table, QUIC_HASH_MIN_SIZE));
+
+    const uint32_t Count = QUIC_HASH_MIN_SIZE * QUIC_HASH_MAX_LOAD_FACTOR * 2;
+    std::vector<HashtableTestEntry> Entries(Count);
+
+    QUIC_HASHTABLE_ENUMERATOR Enumerator;
+    QuicHashtableEnumerateBegin(&Table, &Enumerator);
+    for (uint32_t i = 0; i < Count; ++i) {
+        Entries[i].Key = i;
+        QuicHashtableInsert(&Table, &Entries[i].Entry, HashtableTestHash(i), NULL);
+    }
+    ASSERT_EQ((uint32_t)QUIC_HASH_MIN_SIZE, Table.TableSize);
+    QuicHashtableEnumerateEnd(&Table, &Enumerator);
+
+    for (uint32_t i = 0; i < Count; ++i) {
+        QuicHashtableRemove(&Table, &Entries[i].Entry, NULL);
+    }
+    QuicHashtableUninitialize(&Table);
+}
@@ -0,0 +1,67 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Unit test for the QUIC_RANDOM_STREAM ChaCha20 based CSPRNG.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "RandomStreamTest.cpp.clog.h"
+#endif
+
+TEST(RandomStreamTest, ChaCha20BlockVector)
+{
+    //
+    // The block function test vector from RFC 8439, section 2.3.2.
+    //
+    const uint32_t Key[8] = {
+        0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c,
+        0x13121110, 0x17161514, 0x1b1a1918, 0x1f1e1d1c
+    };
+    const uint32_t Nonce[3] = { 0x09000000, 0x4a000000, 0x00000000 };
+    const uint8_t Expected[QUIC_CHACHA20_BLOCK_SIZE] = {
+        0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15,
+        0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+        0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03,
+        0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+        0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09,
+        0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+        0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9,
+        0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e
+    };
+    uint8_t Output[QUIC_CHACHA20_BLOCK_SIZE];
+    QuicChaCha20Block(Key, 1, Nonce, Output);
+    ASSERT_EQ(0, memcmp(Expected, Output, sizeof(Output)));
+}
+
+TEST(RandomStreamTest, ReadAcrossRefills)
+{
+    QUIC_RANDOM_STREAM Stream;
+    ASSERT_TRUE(QUIC_SUCCEEDED(QuicRandomStreamInitialize(&Stream)));
+
+    //
+    // Read in odd sized chunks, so reads straddle refills, and make sure the
+    // output doesn't repeat.
+    //
+    uint8_t Previous[37] = {0};
+    for (uint32_t i = 0; i < QUIC_RANDOM_STREAM_RESEED_INTERVAL; ++i) {
+        uint8_t Output[37];
+        QuicRandomStreamRead(&Stream, sizeof(Output), Output);
+        ASSERT_NE(0, memcmp(Previous, Output, sizeof(Output)));
+        memcpy(Previous, Output, sizeof(Output));
+    }
+
+    //
+    // Consumed output must be erased from the buffer.
+    //
+    for (uint32_t i = 0; i < Stream.Offset; ++i) {
+        ASSERT_EQ(0, Stream.Buffer[i]);
+    }
+
+    QuicRandomStreamUninitialize(&Stream);
+}
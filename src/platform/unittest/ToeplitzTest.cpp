@@ -0,0 +1,103 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Unit test for the Toeplitz hash implementations.
+
+--*/
+
+#include "main.h"
+#ifdef QUIC_CLOG
+#include "ToeplitzTest.cpp.clog.h"
+#endif
+
+//
+// The key and IPv4 test vectors from the Microsoft RSS verification suite.
+//
+static const uint8_t RssKey[40] = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+    0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+    0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa
+};
+
+struct RssVector {
+    uint8_t Input[12]; // Source address, destination address, source port, destination port.
+    uint32_t HashAddresses;
+    uint32_t HashAddressesAndPorts;
+};
+
+static const RssVector RssVectors[] = {
+    { { 66, 9, 149, 187, 161, 142, 100, 80, 0x0a, 0xea, 0x06, 0xe6 }, 0x323e8fc2, 0x51ccc178 },
+    { { 199, 92, 111, 2, 65, 69, 140, 83, 0x37, 0x96, 0x12, 0x83 }, 0xd718262a, 0xc626b0ea },
+    { { 24, 19, 198, 95, 12, 22, 207, 184, 0x32, 0x62, 0x94, 0x88 }, 0xd2d0a5de, 0x5c2b394a },
+    { { 38, 27, 205, 30, 209, 142, 163, 6, 0xbc, 0x64, 0x08, 0xa9 }, 0x82989176, 0xafc7327f },
+    { { 153, 39, 163, 191, 202, 188, 127, 2, 0xac, 0xdb, 0x05, 0x17 }, 0x5d1809c5, 0x10e828a2 },
+};
+
+struct ToeplitzTest : public ::testing::TestWithParam<bool>
+{
+    QUIC_TOEPLITZ_HASH Toeplitz;
+
+    void InitializeKey(const uint8_t* Key, uint32_t KeyLength) {
+        QuicZeroMemory(&Toeplitz, sizeof(Toeplitz));
+        QuicCopyMemory(Toeplitz.HashKey, Key, KeyLength);
+        QuicToeplitzHashInitialize(&Toeplitz);
+    }
+
+    bool UseCarrylessMultiply() {
+        if (GetParam() && !Toeplitz.UseCarrylessMultiply) {
+            return false;
+        }
+        Toeplitz.UseCarrylessMultiply = GetParam();
+        return true;
+    }
+};
+
+TEST_P(ToeplitzTest, RssVectors)
+{
+    InitializeKey(RssKey, sizeof(RssKey));
+    if (!UseCarrylessMultiply()) {
+        GTEST_SKIP_(": Carry-less multiply unsupported");
+    }
+    for (const RssVector& Vector : RssVectors) {
+        ASSERT_EQ(Vector.HashAddresses, QuicToeplitzHashCompute(&Toeplitz, Vector.Input, 8, 0));
+        ASSERT_EQ(Vector.HashAddressesAndPorts, QuicToeplitzHashCompute(&Toeplitz, Vector.Input, 12, 0));
+        //
+        // Hashing the parts separately and XORing the results must match.
+        //
+        ASSERT_EQ(
+            Vector.HashAddressesAndPorts,
+            QuicToeplitzHashCompute(&Toeplitz, Vector.Input, 3, 0) ^
+            QuicToeplitzHashCompute(&Toeplitz, Vector.Input + 3, 9, 3));
+    }
+}
+
+TEST_P(ToeplitzTest, MatchesLookupTable)
+{
+    uint8_t Key[QUIC_TOEPLITZ_KEY_SIZE];
+    uint8_t Input[QUIC_TOEPLITZ_INPUT_SIZE];
+    for (uint32_t Round = 0; Round < 100; ++Round) {
+        QuicRandom(sizeof(Key), Key);
+        QuicRandom(sizeof(Input), Input);
+        InitializeKey(Key, sizeof(Key));
+        if (!UseCarrylessMultiply()) {
+            GTEST_SKIP_(": Carry-less multiply unsupported");
+        }
+        QUIC_TOEPLITZ_HASH Reference = Toeplitz;
+        Reference.UseCarrylessMultiply = FALSE;
+        for (uint32_t Offset = 0; Offset < QUIC_TOEPLITZ_INPUT_SIZE; ++Offset) {
+            for (uint32_t Length = 0; Offset + Length <= QUIC_TOEPLITZ_INPUT_SIZE; ++Length) {
+                ASSERT_EQ(
+                    QuicToeplitzHashCompute(&Reference, Input + Offset, Length, Offset),
+                    QuicToeplitzHashCompute(&Toeplitz, Input + Offset, Length, Offset));
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(ToeplitzTest, ToeplitzTest, ::testing::Bool());
@@ -149,6 +149,16 @@ QuicTestConnectAndPing(
     _In_ bool FifoScheduling
     );
 
+void
+QuicTestConnectAndPingEmulated(
+    _In_ int Family
+    );
+
+void
+QuicTestPingEfficiency(
+    _In_ int Family
+    );
+
 //
 // Other Data Tests
 //
@@ -272,6 +282,11 @@ QuicTestDatagramSend(
     _In_ int Family
     );
 
+void
+QuicTestDatagramSendBatch(
+    _In_ int Family
+    );
+
 //
 // Platform Specific Functions
 //
@@ -583,4 +598,16 @@ typedef struct {
     QUIC_CTL_CODE(44, METHOD_BUFFERED, FILE_WRITE_DATA)
     // int - Family
 
-#define QUIC_MAX_IOCTL_FUNC_CODE 44
+#define IOCTL_QUIC_RUN_CONNECT_AND_PING_EMULATED \
+    QUIC_CTL_CODE(45, METHOD_BUFFERED, FILE_WRITE_DATA)
+    // int - Family
+
+#define IOCTL_QUIC_RUN_PING_EFFICIENCY \
+    QUIC_CTL_CODE(46, METHOD_BUFFERED, FILE_WRITE_DATA)
+    // int - Family
+
+#define IOCTL_QUIC_RUN_DATAGRAM_SEND_BATCH \
+    QUIC_CTL_CODE(47, METHOD_BUFFERED, FILE_WRITE_DATA)
+    // int - Family
+
+#define QUIC_MAX_IOCTL_FUNC_CODE 47
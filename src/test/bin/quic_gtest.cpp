@@ -603,6 +603,24 @@ TEST_P(WithSendArgs2, SendLarge) {
     }
 }
 
+TEST_P(WithFamilyArgs, SendEmulatedNetwork) {
+    TestLoggerT<ParamType> Logger("QuicTestConnectAndPingEmulated", GetParam());
+    if (TestingKernelMode) {
+        ASSERT_TRUE(DriverClient.Run(IOCTL_QUIC_RUN_CONNECT_AND_PING_EMULATED, GetParam().Family));
+    } else {
+        QuicTestConnectAndPingEmulated(GetParam().Family);
+    }
+}
+
+TEST_P(WithFamilyArgs, PerfPingEfficiency) {
+    TestLoggerT<ParamType> Logger("QuicTestPingEfficiency", GetParam());
+    if (TestingKernelMode) {
+        ASSERT_TRUE(DriverClient.Run(IOCTL_QUIC_RUN_PING_EFFICIENCY, GetParam().Family));
+    } else {
+        QuicTestPingEfficiency(GetParam().Family);
+    }
+}
+
 TEST_P(WithSendArgs3, SendIntermittently) {
     TestLoggerT<ParamType> Logger("QuicTestConnectAndPing", GetParam());
     if (TestingKernelMode) {
@@ -903,6 +921,15 @@ TEST_P(WithFamilyArgs, DatagramSend) {
     }
 }
 
+TEST_P(WithFamilyArgs, DatagramSendBatch) {
+    TestLoggerT<ParamType> Logger("QuicTestDatagramSendBatch", GetParam());
+    if (TestingKernelMode) {
+        ASSERT_TRUE(DriverClient.Run(IOCTL_QUIC_RUN_DATAGRAM_SEND_BATCH, GetParam().Family));
+    } else {
+        QuicTestDatagramSendBatch(GetParam().Family);
+    }
+}
+
 INSTANTIATE_TEST_SUITE_P(
     ParameterValidation,
     WithBool,
@@ -545,6 +545,9 @@ size_t QUIC_IOCTL_BUFFER_SIZES[] =
     sizeof(INT32),
     sizeof(INT32),
     sizeof(INT32),
+    sizeof(INT32),
+    sizeof(INT32),
+    sizeof(INT32),
     sizeof(INT32)
 };
 
@@ -951,6 +954,27 @@ QuicTestCtlEvtIoDeviceControl(
                 Params->Family));
         break;
 
+    case IOCTL_QUIC_RUN_CONNECT_AND_PING_EMULATED:
+        QUIC_FRE_ASSERT(Params != nullptr);
+        QuicTestCtlRun(
+            QuicTestConnectAndPingEmulated(
+                Params->Family));
+        break;
+
+    case IOCTL_QUIC_RUN_PING_EFFICIENCY:
+        QUIC_FRE_ASSERT(Params != nullptr);
+        QuicTestCtlRun(
+            QuicTestPingEfficiency(
+                Params->Family));
+        break;
+
+    case IOCTL_QUIC_RUN_DATAGRAM_SEND_BATCH:
+        QUIC_FRE_ASSERT(Params != nullptr);
+        QuicTestCtlRun(
+            QuicTestDatagramSendBatch(
+                Params->Family));
+        break;
+
     default:
         Status = STATUS_NOT_IMPLEMENTED;
         break;
@@ -23,6 +23,325 @@ void QuicTestValidateApi()
         MsQuicOpen(nullptr));
 
     MsQuicClose(nullptr);
+
+    int64_t Counters[QUIC_PERF_COUNTER_MAX];
+    uint32_t CountersLength = 0;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_BUFFER_TOO_SMALL,
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_PERF_COUNTERS,
+            &CountersLength,
+            nullptr));
+    TEST_EQUAL(CountersLength, sizeof(Counters));
+
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_PERF_COUNTERS,
+            &CountersLength,
+            Counters));
+    TEST_EQUAL(CountersLength, sizeof(Counters));
+    TEST_TRUE(Counters[QUIC_PERF_COUNTER_CONN_ACTIVE] >= 0);
+    TEST_TRUE(
+        Counters[QUIC_PERF_COUNTER_CONN_CREATED] >=
+        Counters[QUIC_PERF_COUNTER_CONN_ACTIVE]);
+
+    uint16_t MemoryBudget;
+    uint32_t MemoryBudgetLength = sizeof(MemoryBudget);
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_MEMORY_BUDGET_PERCENT,
+            &MemoryBudgetLength,
+            &MemoryBudget));
+    TEST_EQUAL(MemoryBudgetLength, sizeof(MemoryBudget));
+
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_MEMORY_BUDGET_PERCENT,
+            sizeof(MemoryBudget),
+            &MemoryBudget));
+
+    QUIC_MEMORY_USAGE MemoryUsage;
+    uint32_t MemoryUsageLength = 0;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_BUFFER_TOO_SMALL,
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_MEMORY_USAGE,
+            &MemoryUsageLength,
+            nullptr));
+    TEST_EQUAL(MemoryUsageLength, sizeof(MemoryUsage));
+
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_MEMORY_USAGE,
+            &MemoryUsageLength,
+            &MemoryUsage));
+    TEST_EQUAL(MemoryUsageLength, sizeof(MemoryUsage));
+    TEST_TRUE(MemoryUsage.Budget != 0);
+
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_MEMORY_USAGE,
+            sizeof(MemoryUsage),
+            &MemoryUsage));
+
+    //
+    // Large page buffers are disabled by default, and can always be disabled.
+    //
+    BOOLEAN LargePageBuffers = TRUE;
+    uint32_t LargePageBuffersLength = sizeof(LargePageBuffers);
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_LARGE_PAGE_BUFFERS,
+            &LargePageBuffersLength,
+            &LargePageBuffers));
+    TEST_FALSE(LargePageBuffers);
+
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_LARGE_PAGE_BUFFERS,
+            sizeof(LargePageBuffers) + 1,
+            &LargePageBuffers));
+
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_LARGE_PAGE_BUFFERS,
+            sizeof(LargePageBuffers),
+            &LargePageBuffers));
+
+    //
+    // All connections are traced by default.
+    //
+    QUIC_TRACE_SAMPLING Sampling;
+    uint32_t SamplingLength = sizeof(Sampling);
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_TRACE_SAMPLING,
+            &SamplingLength,
+            &Sampling));
+    TEST_EQUAL(SamplingLength, sizeof(Sampling));
+    TEST_EQUAL(Sampling.SampleRate, QUIC_TRACE_SAMPLE_RATE_MAX);
+
+    QUIC_TRACE_SAMPLING BadSampling = Sampling;
+    BadSampling.SampleRate = QUIC_TRACE_SAMPLE_RATE_MAX + 1;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_TRACE_SAMPLING,
+            sizeof(BadSampling),
+            &BadSampling));
+
+    BadSampling = Sampling;
+    BadSampling.CidPrefixLength = QUIC_TRACE_SAMPLING_MAX_CID_PREFIX_LENGTH + 1;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_TRACE_SAMPLING,
+            sizeof(BadSampling),
+            &BadSampling));
+
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_TRACE_SAMPLING,
+            sizeof(Sampling),
+            &Sampling));
+
+    QUIC_STATELESS_SECRETS Secrets;
+    uint32_t SecretsLength = sizeof(Secrets);
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_STATELESS_SECRETS,
+            &SecretsLength,
+            &Secrets));
+    TEST_EQUAL(SecretsLength, sizeof(Secrets));
+    TEST_TRUE(Secrets.RetrySecretsExpiration[Secrets.CurrentRetrySecret] != 0);
+
+    QUIC_STATELESS_SECRETS BadSecrets = Secrets;
+    BadSecrets.CurrentRetrySecret = 2;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_STATELESS_SECRETS,
+            sizeof(BadSecrets),
+            &BadSecrets));
+
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_STATELESS_SECRETS,
+            sizeof(Secrets),
+            &Secrets));
+
+    //
+    // The stats region name can't be empty or contain a null character.
+    //
+    const char BadStatsRegionName[] = "/msquic\0stats";
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_STATS_REGION,
+            0,
+            BadStatsRegionName));
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_STATS_REGION,
+            sizeof(BadStatsRegionName) - 1,
+            BadStatsRegionName));
+
+    QUIC_LOAD_BALANCING_CONFIG LbConfig;
+    uint32_t LbConfigLength = sizeof(LbConfig);
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_LOAD_BALANCING_CONFIG,
+            &LbConfigLength,
+            &LbConfig));
+    TEST_EQUAL(LbConfigLength, sizeof(LbConfig));
+
+    QUIC_LOAD_BALANCING_CONFIG BadLbConfig = { 0 };
+    BadLbConfig.ServerIdLength = 2;
+    BadLbConfig.NonceLength = QUIC_LOAD_BALANCING_MIN_NONCE_LENGTH;
+    BadLbConfig.ConfigRotation = QUIC_LOAD_BALANCING_MAX_CONFIG_ROTATION + 1;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_LOAD_BALANCING_CONFIG,
+            sizeof(BadLbConfig),
+            &BadLbConfig));
+
+    BadLbConfig.ConfigRotation = 0;
+    BadLbConfig.ServerIdLength = 0;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_LOAD_BALANCING_CONFIG,
+            sizeof(BadLbConfig),
+            &BadLbConfig));
+
+    BadLbConfig.ServerIdLength = 2;
+    BadLbConfig.NonceLength = QUIC_LOAD_BALANCING_MIN_NONCE_LENGTH - 1;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_LOAD_BALANCING_CONFIG,
+            sizeof(BadLbConfig),
+            &BadLbConfig));
+
+    //
+    // The stream cipher nonce and server ID don't fit in the CID.
+    //
+    BadLbConfig.ServerIdLength = QUIC_LOAD_BALANCING_MAX_SERVER_ID_LENGTH;
+    BadLbConfig.NonceLength = QUIC_LOAD_BALANCING_MIN_NONCE_LENGTH;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_LOAD_BALANCING_CONFIG,
+            sizeof(BadLbConfig),
+            &BadLbConfig));
+
+    //
+    // The network isn't emulated by default.
+    //
+    QUIC_NETWORK_EMULATION Emulation;
+    uint32_t EmulationLength = 0;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_BUFFER_TOO_SMALL,
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_NETWORK_EMULATION,
+            &EmulationLength,
+            nullptr));
+    TEST_EQUAL(EmulationLength, sizeof(Emulation));
+
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_NETWORK_EMULATION,
+            &EmulationLength,
+            &Emulation));
+    TEST_EQUAL(EmulationLength, sizeof(Emulation));
+    TEST_EQUAL(Emulation.DelayUs, 0);
+    TEST_EQUAL(Emulation.RateKbps, 0);
+    TEST_EQUAL(Emulation.LossPpm, 0);
+    TEST_EQUAL(Emulation.ReorderPpm, 0);
+
+    QUIC_NETWORK_EMULATION BadEmulation = Emulation;
+    BadEmulation.LossPpm = QUIC_NETWORK_EMULATION_PPM_MAX + 1;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_NETWORK_EMULATION,
+            sizeof(BadEmulation),
+            &BadEmulation));
+
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_NETWORK_EMULATION,
+            sizeof(Emulation) - 1,
+            &Emulation));
+
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->SetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_NETWORK_EMULATION,
+            sizeof(Emulation),
+            &Emulation));
 }
 
 void QuicTestValidateRegistration()
@@ -32,6 +351,173 @@ void QuicTestValidateRegistration()
         MsQuic->RegistrationOpen(nullptr, nullptr));
 
     MsQuic->RegistrationClose(nullptr);
+
+    //
+    // Histograms start empty.
+    //
+    {
+        MsQuicRegistration TestReg;
+        TEST_TRUE(TestReg.IsValid());
+
+        QUIC_STATISTICS_HISTOGRAMS Histograms;
+        uint32_t HistogramsLength = 0;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_BUFFER_TOO_SMALL,
+            MsQuic->GetParam(
+                TestReg,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_STATISTICS_HISTOGRAMS,
+                &HistogramsLength,
+                nullptr));
+        TEST_EQUAL(HistogramsLength, sizeof(Histograms));
+
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                TestReg,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_STATISTICS_HISTOGRAMS,
+                &HistogramsLength,
+                &Histograms));
+        TEST_EQUAL(HistogramsLength, sizeof(Histograms));
+        for (uint32_t i = 0; i < QUIC_HISTOGRAM_BUCKET_COUNT; ++i) {
+            TEST_EQUAL(Histograms.Rtt.Buckets[i], 0);
+        }
+
+        //
+        // Only external registrations have execution contexts.
+        //
+        uint32_t ContextsLength = 0;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_STATE,
+            MsQuic->GetParam(
+                TestReg,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_EXECUTION_CONTEXTS,
+                &ContextsLength,
+                nullptr));
+    }
+
+    //
+    // The app polls the workers of an external registration.
+    //
+    {
+        const QUIC_REGISTRATION_CONFIG RegConfig =
+            { "MsQuicBVT-External", QUIC_EXECUTION_PROFILE_TYPE_EXTERNAL };
+        HQUIC Registration = nullptr;
+        TEST_QUIC_SUCCEEDED(MsQuic->RegistrationOpen(&RegConfig, &Registration));
+
+        uint32_t ContextsLength = 0;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_BUFFER_TOO_SMALL,
+            MsQuic->GetParam(
+                Registration,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_EXECUTION_CONTEXTS,
+                &ContextsLength,
+                nullptr));
+        TEST_NOT_EQUAL(ContextsLength, 0);
+        TEST_EQUAL(ContextsLength % sizeof(QUIC_EXECUTION_CONTEXT_CONFIG), 0);
+
+        uint32_t ContextCount = ContextsLength / sizeof(QUIC_EXECUTION_CONTEXT_CONFIG);
+        QUIC_EXECUTION_CONTEXT_CONFIG* Contexts = new QUIC_EXECUTION_CONTEXT_CONFIG[ContextCount];
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                Registration,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_EXECUTION_CONTEXTS,
+                &ContextsLength,
+                Contexts));
+
+        //
+        // Nothing is queued and no timers are set on a new registration.
+        //
+        for (uint32_t i = 0; i < ContextCount; ++i) {
+            TEST_NOT_EQUAL(Contexts[i].ExecutionContext, nullptr);
+            TEST_EQUAL(MsQuic->ExecutionPoll(Contexts[i].ExecutionContext), UINT64_MAX);
+        }
+
+        QUIC_EXECUTION_CONTEXT_CONFIG BadContext = {};
+        BadContext.ExecutionContext = (QUIC_EXECUTION_CONTEXT*)&BadContext;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->SetParam(
+                Registration,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_EXECUTION_CONTEXTS,
+                sizeof(BadContext),
+                &BadContext));
+
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Registration,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_EXECUTION_CONTEXTS,
+                ContextsLength,
+                Contexts));
+
+        delete [] Contexts;
+        MsQuic->RegistrationClose(Registration);
+    }
+
+    //
+    // A registration's workers can be dedicated to a set of processors, until
+    // it has sessions.
+    //
+    {
+        MsQuicRegistration TestReg;
+        TEST_TRUE(TestReg.IsValid());
+
+        const uint16_t BadProcessors[] = { UINT16_MAX };
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->SetParam(
+                TestReg,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_PROCESSORS,
+                sizeof(BadProcessors),
+                BadProcessors));
+
+        const uint16_t Processors[] = { 0 };
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                TestReg,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_PROCESSORS,
+                sizeof(Processors),
+                Processors));
+
+        uint16_t ActualProcessors[2] = { UINT16_MAX, UINT16_MAX };
+        uint32_t ProcessorsLength = sizeof(ActualProcessors);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                TestReg,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_PROCESSORS,
+                &ProcessorsLength,
+                ActualProcessors));
+        TEST_EQUAL(ProcessorsLength, sizeof(Processors));
+        TEST_EQUAL(ActualProcessors[0], Processors[0]);
+
+        const char RawAlpn[] = "MsQuicTest";
+        const QUIC_BUFFER Alpn = { sizeof(RawAlpn) - 1, (uint8_t*)RawAlpn };
+        HQUIC Session = nullptr;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SessionOpen(
+                TestReg,
+                &Alpn,
+                1,
+                nullptr,
+                &Session));
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_STATE,
+            MsQuic->SetParam(
+                TestReg,
+                QUIC_PARAM_LEVEL_REGISTRATION,
+                QUIC_PARAM_REGISTRATION_PROCESSORS,
+                sizeof(Processors),
+                Processors));
+        MsQuic->SessionClose(Session);
+    }
 }
 
 void QuicTestValidateSession()
@@ -213,6 +699,132 @@ void QuicTestValidateSession()
             TicketKey));
 #endif
 
+    uint8_t TicketKeys[QUIC_TICKET_KEY_LENGTH * (QUIC_MAX_TICKET_KEY_COUNT + 1)] = {0};
+
+    //
+    // Ticket key ring - invalid lengths.
+    //
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_TLS_TICKET_KEYS,
+            0,
+            TicketKeys));
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_TLS_TICKET_KEYS,
+            QUIC_TICKET_KEY_LENGTH * 2 - 1,
+            TicketKeys));
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_TLS_TICKET_KEYS,
+            sizeof(TicketKeys),
+            TicketKeys));
+
+#ifndef QUIC_DISABLE_0RTT_TESTS
+    //
+    // Valid ticket key ring (current and one previous key).
+    //
+    TicketKeys[QUIC_TICKET_KEY_LENGTH] = 1;
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->SetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_TLS_TICKET_KEYS,
+            QUIC_TICKET_KEY_LENGTH * 2,
+            TicketKeys));
+#endif
+
+    //
+    // Session statistics.
+    //
+    {
+        QUIC_SESSION_STATISTICS Stats;
+        uint32_t StatsLength = sizeof(Stats);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                Session,
+                QUIC_PARAM_LEVEL_SESSION,
+                QUIC_PARAM_SESSION_STATS,
+                &StatsLength,
+                &Stats));
+        TEST_EQUAL(StatsLength, sizeof(Stats));
+        TEST_EQUAL(Stats.TotalResumptionsAccepted, 0);
+        TEST_EQUAL(Stats.TotalResumptionsRejected, 0);
+    }
+
+    //
+    // Peer stream count max.
+    //
+    {
+        uint16_t CountMax = 256;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->SetParam(
+                Session,
+                QUIC_PARAM_LEVEL_SESSION,
+                QUIC_PARAM_SESSION_PEER_STREAM_COUNT_MAX,
+                sizeof(uint32_t),
+                &CountMax));
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Session,
+                QUIC_PARAM_LEVEL_SESSION,
+                QUIC_PARAM_SESSION_PEER_STREAM_COUNT_MAX,
+                sizeof(CountMax),
+                &CountMax));
+        CountMax = 0;
+        uint32_t CountMaxLength = sizeof(CountMax);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                Session,
+                QUIC_PARAM_LEVEL_SESSION,
+                QUIC_PARAM_SESSION_PEER_STREAM_COUNT_MAX,
+                &CountMaxLength,
+                &CountMax));
+        TEST_EQUAL(CountMax, 256);
+    }
+
+    //
+    // Path metrics cache.
+    //
+    {
+        BOOLEAN Enabled = TRUE;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->SetParam(
+                Session,
+                QUIC_PARAM_LEVEL_SESSION,
+                QUIC_PARAM_SESSION_PATH_METRICS_CACHE_ENABLED,
+                sizeof(uint32_t),
+                &Enabled));
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Session,
+                QUIC_PARAM_LEVEL_SESSION,
+                QUIC_PARAM_SESSION_PATH_METRICS_CACHE_ENABLED,
+                sizeof(Enabled),
+                &Enabled));
+        Enabled = FALSE;
+        uint32_t EnabledLength = sizeof(Enabled);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                Session,
+                QUIC_PARAM_LEVEL_SESSION,
+                QUIC_PARAM_SESSION_PATH_METRICS_CACHE_ENABLED,
+                &EnabledLength,
+                &Enabled));
+        TEST_EQUAL(Enabled, TRUE);
+    }
+
     //
     // Server resumption level - invalid level
     //
@@ -277,6 +889,73 @@ void QuicTestValidateSession()
             sizeof(Level),
             &Level));
 
+    //
+    // Congestion control algorithm - invalid algorithm
+    //
+    uint16_t CcAlgorithm = QUIC_CONGESTION_CONTROL_ALGORITHM_COUNT;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM,
+            sizeof(CcAlgorithm),
+            &CcAlgorithm));
+
+    //
+    // Congestion control algorithm - Invalid length
+    //
+    CcAlgorithm = QUIC_CONGESTION_CONTROL_ALGORITHM_BBR;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM,
+            sizeof(CcAlgorithm) + 1,
+            &CcAlgorithm));
+
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->SetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM,
+            sizeof(CcAlgorithm),
+            &CcAlgorithm));
+
+    CcAlgorithm = QUIC_CONGESTION_CONTROL_ALGORITHM_CUBIC;
+    uint32_t CcAlgorithmLength = sizeof(CcAlgorithm);
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->GetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM,
+            &CcAlgorithmLength,
+            &CcAlgorithm));
+    TEST_EQUAL(CcAlgorithm, QUIC_CONGESTION_CONTROL_ALGORITHM_BBR);
+
+    //
+    // Congestion control algorithm - LEDBAT
+    //
+    CcAlgorithm = QUIC_CONGESTION_CONTROL_ALGORITHM_LEDBAT;
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->SetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM,
+            sizeof(CcAlgorithm),
+            &CcAlgorithm));
+
+    CcAlgorithm = QUIC_CONGESTION_CONTROL_ALGORITHM_CUBIC;
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->GetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM,
+            &CcAlgorithmLength,
+            &CcAlgorithm));
+    TEST_EQUAL(CcAlgorithm, QUIC_CONGESTION_CONTROL_ALGORITHM_LEDBAT);
+
     MsQuic->SessionClose(
         Session);
     Session = nullptr;
@@ -388,17 +1067,34 @@ void QuicTestValidateListener()
             Listener,
             nullptr));
 
-    TEST_QUIC_STATUS(
-        QUIC_STATUS_INVALID_STATE,
-        MsQuic->ListenerStart(
-            Listener,
-            nullptr));
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_STATE,
+        MsQuic->ListenerStart(
+            Listener,
+            nullptr));
+
+    MsQuic->ListenerClose(Listener);
+    Listener = nullptr;
+
+    //
+    // Stop twice.
+    //
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->ListenerOpen(
+            Session,
+            DummyListenerCallback,
+            nullptr,
+            &Listener));
+
+    MsQuic->ListenerStop(Listener);
+
+    MsQuic->ListenerStop(Listener);
 
     MsQuic->ListenerClose(Listener);
     Listener = nullptr;
 
     //
-    // Stop twice.
+    // Invalid connection configs.
     //
     TEST_QUIC_SUCCEEDED(
         MsQuic->ListenerOpen(
@@ -407,9 +1103,48 @@ void QuicTestValidateListener()
             nullptr,
             &Listener));
 
-    MsQuic->ListenerStop(Listener);
+    QUIC_LISTENER_CONNECTION_CONFIG Config = { nullptr, nullptr, nullptr };
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            Listener,
+            QUIC_PARAM_LEVEL_LISTENER,
+            QUIC_PARAM_LISTENER_CONNECTION_CONFIG,
+            sizeof(Config) - 1,
+            &Config));
 
-    MsQuic->ListenerStop(Listener);
+    Config.SecurityConfig = (QUIC_SEC_CONFIG*)1;
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_PARAMETER,
+        MsQuic->SetParam(
+            Listener,
+            QUIC_PARAM_LEVEL_LISTENER,
+            QUIC_PARAM_LISTENER_CONNECTION_CONFIG,
+            sizeof(Config),
+            &Config));
+
+    Config.SecurityConfig = nullptr;
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->SetParam(
+            Listener,
+            QUIC_PARAM_LEVEL_LISTENER,
+            QUIC_PARAM_LISTENER_CONNECTION_CONFIG,
+            sizeof(Config),
+            &Config));
+
+    TEST_QUIC_SUCCEEDED(
+        MsQuic->ListenerStart(
+            Listener,
+            nullptr));
+
+    TEST_QUIC_STATUS(
+        QUIC_STATUS_INVALID_STATE,
+        MsQuic->SetParam(
+            Listener,
+            QUIC_PARAM_LEVEL_LISTENER,
+            QUIC_PARAM_LISTENER_CONNECTION_CONFIG,
+            sizeof(Config),
+            &Config));
 
     MsQuic->ListenerClose(Listener);
     Listener = nullptr;
@@ -763,6 +1498,44 @@ void QuicTestValidateConnection()
                 0,
                 QUIC_SEND_FLAG_NONE,
                 nullptr));
+
+        QUIC_DATAGRAM_SEND_BATCH_ENTRY Entries[2] = {
+            { &DatagramBuffer, 1, QUIC_SEND_FLAG_NONE, 0, nullptr, QUIC_STATUS_SUCCESS },
+            { nullptr, 1, QUIC_SEND_FLAG_NONE, 0, nullptr, QUIC_STATUS_SUCCESS }
+        };
+
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->DatagramSendBatch(
+                nullptr,
+                Entries,
+                ARRAYSIZE(Entries)));
+
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->DatagramSendBatch(
+                Connection.Handle,
+                nullptr,
+                1));
+
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->DatagramSendBatch(
+                Connection.Handle,
+                Entries,
+                0));
+
+        //
+        // Only the invalid entry fails.
+        //
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->DatagramSendBatch(
+                Connection.Handle,
+                Entries,
+                ARRAYSIZE(Entries)));
+        TEST_QUIC_STATUS(QUIC_STATUS_PENDING, Entries[0].Status);
+        TEST_QUIC_STATUS(QUIC_STATUS_INVALID_PARAMETER, Entries[1].Status);
     }
 
     //
@@ -781,16 +1554,320 @@ void QuicTestValidateConnection()
         QUIC_BUFFER DatagramBuffer = { sizeof(RawBuffer), RawBuffer };
 
         TEST_QUIC_SUCCEEDED(
-            MsQuic->DatagramSend(
+            MsQuic->DatagramSend(
+                Connection.Handle,
+                &DatagramBuffer,
+                1,
+                QUIC_SEND_FLAG_NONE,
+                nullptr));
+    }
+
+    //
+    // Successful set datagram receive parameter.
+    //
+    {
+        ConnectionScope Connection;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->ConnectionOpen(
+                Session,
+                DummyConnectionCallback,
+                nullptr,
+                &Connection.Handle));
+
+        BOOLEAN ReceiveDatagrams = TRUE;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_DATAGRAM_RECEIVE_ENABLED,
+                sizeof(ReceiveDatagrams),
+                &ReceiveDatagrams));
+
+        ReceiveDatagrams = FALSE;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_DATAGRAM_RECEIVE_ENABLED,
+                sizeof(ReceiveDatagrams),
+                &ReceiveDatagrams));
+    }
+
+    //
+    // Datagram receive lending.
+    //
+    {
+        ConnectionScope Connection;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->ConnectionOpen(
+                Session,
+                DummyConnectionCallback,
+                nullptr,
+                &Connection.Handle));
+
+        BOOLEAN LendDatagrams = TRUE;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_DATAGRAM_RECEIVE_LENDING,
+                sizeof(LendDatagrams) + 1,
+                &LendDatagrams));
+
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_DATAGRAM_RECEIVE_LENDING,
+                sizeof(LendDatagrams),
+                &LendDatagrams));
+
+        LendDatagrams = FALSE;
+        uint32_t BufferLength = sizeof(LendDatagrams);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_DATAGRAM_RECEIVE_LENDING,
+                &BufferLength,
+                &LendDatagrams));
+        TEST_TRUE(LendDatagrams);
+
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->DatagramReceiveComplete(
+                Connection.Handle,
+                nullptr));
+
+        uint8_t RawBuffer[] = "datagram";
+        QUIC_BUFFER DatagramBuffer = { sizeof(RawBuffer), RawBuffer };
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->DatagramReceiveComplete(
+                nullptr,
+                &DatagramBuffer));
+    }
+
+    //
+    // Multipath.
+    //
+    {
+        ConnectionScope Connection;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->ConnectionOpen(
+                Session,
+                DummyConnectionCallback,
+                nullptr,
+                &Connection.Handle));
+
+        BOOLEAN Multipath = TRUE;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_MULTIPATH_ENABLED,
+                sizeof(Multipath) + 1,
+                &Multipath));
+
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_MULTIPATH_ENABLED,
+                sizeof(Multipath),
+                &Multipath));
+
+        Multipath = FALSE;
+        uint32_t BufferLength = sizeof(Multipath);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_MULTIPATH_ENABLED,
+                &BufferLength,
+                &Multipath));
+        TEST_TRUE(Multipath);
+
+        //
+        // Paths can only be added once multipath has been negotiated.
+        //
+        QuicAddr RemoteAddr(AF_INET, true);
+        QuicAddrSetPort(&RemoteAddr.SockAddr, 4433);
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_STATE,
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_ADD_PATH,
+                sizeof(RemoteAddr.SockAddr),
+                &RemoteAddr.SockAddr));
+    }
+
+    //
+    // Latency sensitive.
+    //
+    {
+        ConnectionScope Connection;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->ConnectionOpen(
+                Session,
+                DummyConnectionCallback,
+                nullptr,
+                &Connection.Handle));
+
+        BOOLEAN LatencySensitive = TRUE;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_LATENCY_SENSITIVE,
+                sizeof(LatencySensitive) + 1,
+                &LatencySensitive));
+
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_LATENCY_SENSITIVE,
+                sizeof(LatencySensitive),
+                &LatencySensitive));
+
+        LatencySensitive = FALSE;
+        uint32_t BufferLength = sizeof(LatencySensitive);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_LATENCY_SENSITIVE,
+                &BufferLength,
+                &LatencySensitive));
+        TEST_TRUE(LatencySensitive);
+    }
+
+    //
+    // Arena enabled.
+    //
+    {
+        ConnectionScope Connection;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->ConnectionOpen(
+                Session,
+                DummyConnectionCallback,
+                nullptr,
+                &Connection.Handle));
+
+        BOOLEAN ArenaEnabled = TRUE;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_ARENA_ENABLED,
+                sizeof(ArenaEnabled),
+                &ArenaEnabled));
+
+        ArenaEnabled = FALSE;
+        uint32_t BufferLength = sizeof(ArenaEnabled);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_ARENA_ENABLED,
+                &BufferLength,
+                &ArenaEnabled));
+        TEST_TRUE(ArenaEnabled);
+    }
+
+    //
+    // Send cork.
+    //
+    {
+        ConnectionScope Connection;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->ConnectionOpen(
+                Session,
+                DummyConnectionCallback,
+                nullptr,
+                &Connection.Handle));
+
+        uint32_t CorkUs = 500;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_SEND_CORK_US,
+                sizeof(CorkUs),
+                &CorkUs));
+
+        CorkUs = 0;
+        uint32_t BufferLength = sizeof(CorkUs);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_SEND_CORK_US,
+                &BufferLength,
+                &CorkUs));
+        TEST_EQUAL(CorkUs, 500);
+
+        CorkUs = UINT32_MAX;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_SEND_CORK_US,
+                sizeof(CorkUs),
+                &CorkUs));
+    }
+
+    //
+    // Receive batch.
+    //
+    {
+        ConnectionScope Connection;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->ConnectionOpen(
+                Session,
+                DummyConnectionCallback,
+                nullptr,
+                &Connection.Handle));
+
+        BOOLEAN Enabled = TRUE;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_RECEIVE_BATCH_ENABLED,
+                sizeof(Enabled),
+                &Enabled));
+
+        Enabled = FALSE;
+        uint32_t BufferLength = sizeof(Enabled);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
                 Connection.Handle,
-                &DatagramBuffer,
-                1,
-                QUIC_SEND_FLAG_NONE,
-                nullptr));
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_RECEIVE_BATCH_ENABLED,
+                &BufferLength,
+                &Enabled));
+        TEST_EQUAL(Enabled, TRUE);
+
+        uint32_t Invalid = 0;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->SetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_RECEIVE_BATCH_ENABLED,
+                sizeof(Invalid),
+                &Invalid));
     }
 
     //
-    // Successful set datagram receive parameter.
+    // Dedicated socket.
     //
     {
         ConnectionScope Connection;
@@ -801,23 +1878,36 @@ void QuicTestValidateConnection()
                 nullptr,
                 &Connection.Handle));
 
-        BOOLEAN ReceiveDatagrams = TRUE;
-        TEST_QUIC_SUCCEEDED(
+        BOOLEAN Enabled = TRUE;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_STATE,
             MsQuic->SetParam(
                 Connection.Handle,
                 QUIC_PARAM_LEVEL_CONNECTION,
-                QUIC_PARAM_CONN_DATAGRAM_RECEIVE_ENABLED,
-                sizeof(ReceiveDatagrams),
-                &ReceiveDatagrams));
+                QUIC_PARAM_CONN_DEDICATED_SOCKET,
+                sizeof(Enabled),
+                &Enabled));
 
-        ReceiveDatagrams = FALSE;
-        TEST_QUIC_SUCCEEDED(
+        Enabled = FALSE;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
             MsQuic->SetParam(
                 Connection.Handle,
                 QUIC_PARAM_LEVEL_CONNECTION,
-                QUIC_PARAM_CONN_DATAGRAM_RECEIVE_ENABLED,
-                sizeof(ReceiveDatagrams),
-                &ReceiveDatagrams));
+                QUIC_PARAM_CONN_DEDICATED_SOCKET,
+                sizeof(Enabled),
+                &Enabled));
+
+        Enabled = TRUE;
+        uint32_t BufferLength = sizeof(Enabled);
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->GetParam(
+                Connection.Handle,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_DEDICATED_SOCKET,
+                &BufferLength,
+                &Enabled));
+        TEST_EQUAL(Enabled, FALSE);
     }
 
     //
@@ -1162,6 +2252,67 @@ void QuicTestValidateStream(bool Connect)
                 }
             }
 
+            //
+            // Early data, queued (before the connection starts, if not
+            // connected) on a stream allowing all its data in 0-RTT.
+            //
+            {
+                StreamScope Stream;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->StreamOpen(
+                        Client.GetConnection(),
+                        QUIC_STREAM_OPEN_FLAG_0_RTT,
+                        DummyStreamCallback,
+                        nullptr,
+                        &Stream.Handle));
+
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->StreamStart(
+                        Stream.Handle,
+                        QUIC_STREAM_START_FLAG_NONE));
+
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->StreamSend(
+                        Stream.Handle,
+                        Buffers,
+                        ARRAYSIZE(Buffers),
+                        QUIC_SEND_FLAG_NONE,
+                        nullptr));
+            }
+
+            //
+            // Streams allocated from (and freed back to) the connection's
+            // arena.
+            //
+            {
+                BOOLEAN ArenaEnabled = TRUE;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->SetParam(
+                        Client.GetConnection(),
+                        QUIC_PARAM_LEVEL_CONNECTION,
+                        QUIC_PARAM_CONN_ARENA_ENABLED,
+                        sizeof(ArenaEnabled),
+                        &ArenaEnabled));
+                for (uint32_t i = 0; i < 8; ++i) {
+                    StreamScope Stream;
+                    TEST_QUIC_SUCCEEDED(
+                        MsQuic->StreamOpen(
+                            Client.GetConnection(),
+                            QUIC_STREAM_OPEN_FLAG_NONE,
+                            DummyStreamCallback,
+                            nullptr,
+                            &Stream.Handle));
+                }
+                ArenaEnabled = FALSE;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->SetParam(
+                        Client.GetConnection(),
+                        QUIC_PARAM_LEVEL_CONNECTION,
+                        QUIC_PARAM_CONN_ARENA_ENABLED,
+                        sizeof(ArenaEnabled),
+                        &ArenaEnabled));
+            }
+
             //
             // Null stream handle.
             //
@@ -1319,6 +2470,82 @@ void QuicTestValidateStream(bool Connect)
                         nullptr));
             }
 
+            //
+            // Batched sends.
+            //
+            {
+                StreamScope Stream;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->StreamOpen(
+                        Client.GetConnection(),
+                        QUIC_STREAM_OPEN_FLAG_NONE,
+                        DummyStreamCallback,
+                        nullptr,
+                        &Stream.Handle));
+
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->StreamStart(
+                        Stream.Handle,
+                        QUIC_STREAM_START_FLAG_NONE));
+
+                QUIC_STREAM_SEND_BATCH_ENTRY Entries[2] = {};
+                Entries[0].Stream = Stream.Handle;
+                Entries[0].Buffers = Buffers;
+                Entries[0].BufferCount = ARRAYSIZE(Buffers);
+                Entries[0].Flags = QUIC_SEND_FLAG_NONE;
+                Entries[1] = Entries[0];
+
+                TEST_QUIC_STATUS(
+                    QUIC_STATUS_INVALID_PARAMETER,
+                    MsQuic->StreamSendBatch(
+                        Client.GetConnection(),
+                        nullptr,
+                        ARRAYSIZE(Entries)));
+
+                TEST_QUIC_STATUS(
+                    QUIC_STATUS_INVALID_PARAMETER,
+                    MsQuic->StreamSendBatch(
+                        Stream.Handle,
+                        Entries,
+                        ARRAYSIZE(Entries)));
+
+                //
+                // Zero length without FIN.
+                //
+                TEST_QUIC_STATUS(
+                    QUIC_STATUS_INVALID_PARAMETER,
+                    MsQuic->StreamSendBatch(
+                        Client.GetConnection(),
+                        Entries,
+                        ARRAYSIZE(Entries)));
+
+                //
+                // Stream on a different connection.
+                //
+                {
+                    TestConnection OtherClient(Session);
+                    TEST_TRUE(OtherClient.IsValid());
+                    Entries[0].Flags = QUIC_SEND_FLAG_FIN;
+                    TEST_QUIC_STATUS(
+                        QUIC_STATUS_INVALID_PARAMETER,
+                        MsQuic->StreamSendBatch(
+                            OtherClient.GetConnection(),
+                            Entries,
+                            1));
+                }
+
+                //
+                // A FIN only send.
+                //
+                TEST_QUIC_STATUS(
+                    QUIC_STATUS_PENDING,
+                    MsQuic->StreamSendBatch(
+                        Client.GetConnection(),
+                        Entries,
+                        1));
+                TEST_QUIC_STATUS(QUIC_STATUS_PENDING, Entries[0].Status);
+            }
+
             //
             // Double-shutdown stream.
             //
@@ -1350,6 +2577,175 @@ void QuicTestValidateStream(bool Connect)
                         QUIC_TEST_NO_ERROR));
             }
 
+            //
+            // Receive message framing.
+            //
+            {
+                StreamScope Stream;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->StreamOpen(
+                        Client.GetConnection(),
+                        QUIC_STREAM_OPEN_FLAG_NONE,
+                        DummyStreamCallback,
+                        nullptr,
+                        &Stream.Handle));
+
+                BOOLEAN Framing = TRUE;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->SetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_RECEIVE_MESSAGE_FRAMING,
+                        sizeof(Framing),
+                        &Framing));
+
+                Framing = FALSE;
+                uint32_t BufferLength = sizeof(Framing);
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->GetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_RECEIVE_MESSAGE_FRAMING,
+                        &BufferLength,
+                        &Framing));
+                TEST_EQUAL(Framing, TRUE);
+
+                uint32_t Invalid = 0;
+                TEST_QUIC_STATUS(
+                    QUIC_STATUS_INVALID_PARAMETER,
+                    MsQuic->SetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_RECEIVE_MESSAGE_FRAMING,
+                        sizeof(Invalid),
+                        &Invalid));
+            }
+
+            //
+            // Stream statistics.
+            //
+            {
+                StreamScope Stream;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->StreamOpen(
+                        Client.GetConnection(),
+                        QUIC_STREAM_OPEN_FLAG_NONE,
+                        DummyStreamCallback,
+                        nullptr,
+                        &Stream.Handle));
+
+                uint32_t BufferLength = 0;
+                TEST_QUIC_STATUS(
+                    QUIC_STATUS_BUFFER_TOO_SMALL,
+                    MsQuic->GetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_STATISTICS,
+                        &BufferLength,
+                        nullptr));
+                TEST_EQUAL(BufferLength, sizeof(QUIC_STREAM_STATISTICS));
+
+                QUIC_STREAM_STATISTICS Stats;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->GetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_STATISTICS,
+                        &BufferLength,
+                        &Stats));
+                TEST_EQUAL(Stats.Send.TotalBytes, 0);
+                TEST_EQUAL(Stats.Recv.EventCount, 0);
+            }
+
+            //
+            // Stream send deadline.
+            //
+            {
+                StreamScope Stream;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->StreamOpen(
+                        Client.GetConnection(),
+                        QUIC_STREAM_OPEN_FLAG_NONE,
+                        DummyStreamCallback,
+                        nullptr,
+                        &Stream.Handle));
+
+                QUIC_STREAM_SEND_DEADLINE Deadline = { 250, 0x10 };
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->SetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_SEND_DEADLINE,
+                        sizeof(Deadline),
+                        &Deadline));
+
+                QUIC_STREAM_SEND_DEADLINE Actual = { 0, 0 };
+                uint32_t BufferLength = sizeof(Actual);
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->GetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_SEND_DEADLINE,
+                        &BufferLength,
+                        &Actual));
+                TEST_EQUAL(Actual.DeadlineMs, 250);
+                TEST_EQUAL(Actual.ErrorCode, 0x10);
+
+                Deadline.ErrorCode = QUIC_UINT62_MAX + 1;
+                TEST_QUIC_STATUS(
+                    QUIC_STATUS_INVALID_PARAMETER,
+                    MsQuic->SetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_SEND_DEADLINE,
+                        sizeof(Deadline),
+                        &Deadline));
+            }
+
+            //
+            // Stream send complete batching.
+            //
+            {
+                StreamScope Stream;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->StreamOpen(
+                        Client.GetConnection(),
+                        QUIC_STREAM_OPEN_FLAG_NONE,
+                        DummyStreamCallback,
+                        nullptr,
+                        &Stream.Handle));
+
+                BOOLEAN Enabled = TRUE;
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->SetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_SEND_COMPLETE_BATCHING,
+                        sizeof(Enabled),
+                        &Enabled));
+
+                Enabled = FALSE;
+                uint32_t BufferLength = sizeof(Enabled);
+                TEST_QUIC_SUCCEEDED(
+                    MsQuic->GetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_SEND_COMPLETE_BATCHING,
+                        &BufferLength,
+                        &Enabled));
+                TEST_EQUAL(Enabled, TRUE);
+
+                uint32_t Invalid = 0;
+                TEST_QUIC_STATUS(
+                    QUIC_STATUS_INVALID_PARAMETER,
+                    MsQuic->SetParam(
+                        Stream.Handle,
+                        QUIC_PARAM_LEVEL_STREAM,
+                        QUIC_PARAM_STREAM_SEND_COMPLETE_BATCHING,
+                        sizeof(Invalid),
+                        &Invalid));
+            }
+
             //
             // Shutdown null handle.
             //
@@ -1392,6 +2788,106 @@ void QuicTestValidateStream(bool Connect)
             MsQuic->StreamClose(nullptr);
         }
     }
+
+    //
+    // Pooled streams.
+    //
+    {
+        StreamScope Stream;
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->PoolStreamOpen(
+                nullptr,
+                "localhost",
+                4433,
+                QUIC_STREAM_OPEN_FLAG_NONE,
+                DummyStreamCallback,
+                nullptr,
+                &Stream.Handle));
+
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->PoolStreamOpen(
+                Session,
+                nullptr,
+                4433,
+                QUIC_STREAM_OPEN_FLAG_NONE,
+                DummyStreamCallback,
+                nullptr,
+                &Stream.Handle));
+
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->PoolStreamOpen(
+                Session,
+                "",
+                4433,
+                QUIC_STREAM_OPEN_FLAG_NONE,
+                DummyStreamCallback,
+                nullptr,
+                &Stream.Handle));
+
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->PoolStreamOpen(
+                Session,
+                "localhost",
+                0,
+                QUIC_STREAM_OPEN_FLAG_NONE,
+                DummyStreamCallback,
+                nullptr,
+                &Stream.Handle));
+
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->PoolStreamOpen(
+                Session,
+                "localhost",
+                4433,
+                QUIC_STREAM_OPEN_FLAG_NONE,
+                nullptr,
+                nullptr,
+                &Stream.Handle));
+
+        TEST_QUIC_STATUS(
+            QUIC_STATUS_INVALID_PARAMETER,
+            MsQuic->PoolStreamOpen(
+                Session,
+                "localhost",
+                4433,
+                QUIC_STREAM_OPEN_FLAG_NONE,
+                DummyStreamCallback,
+                nullptr,
+                nullptr));
+    }
+
+    {
+        //
+        // The second stream reuses the pooled connection opened for the first.
+        // It's shut down (and closed) by the session.
+        //
+        StreamScope Stream1;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->PoolStreamOpen(
+                Session,
+                "localhost",
+                4433,
+                QUIC_STREAM_OPEN_FLAG_NONE,
+                DummyStreamCallback,
+                nullptr,
+                &Stream1.Handle));
+
+        StreamScope Stream2;
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->PoolStreamOpen(
+                Session,
+                "localhost",
+                4433,
+                QUIC_STREAM_OPEN_FLAG_NONE,
+                DummyStreamCallback,
+                nullptr,
+                &Stream2.Handle));
+    }
 }
 
 class SecConfigTestContext {
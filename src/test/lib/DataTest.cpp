@@ -64,6 +64,15 @@ struct PingStats
 
     QUIC_EVENT CompletionEvent;
 
+    //
+    // Sums of the connections' statistics, collected as they shut down if
+    // CollectStatistics is set.
+    //
+    bool CollectStatistics;
+    volatile int64_t SendTotalPackets;
+    volatile int64_t RecvTotalStreamBytes;
+    volatile int64_t ProcessingTimeUs;
+
     PingStats(
         uint64_t _PayloadLength,
         uint32_t _ConnectionCount,
@@ -86,11 +95,21 @@ struct PingStats
         AllowDataIncomplete(_AllowDataIncomplete),
         ExpectedCloseStatus(_ExpectedCloseStatus),
         ServerKeyUpdate(_ServerKeyUpdate),
-        ConnectionsComplete(0)
+        ConnectionsComplete(0),
+        CollectStatistics(false),
+        SendTotalPackets(0),
+        RecvTotalStreamBytes(0),
+        ProcessingTimeUs(0)
     {
         QuicEventInitialize(&CompletionEvent, FALSE, FALSE);
     }
 
+    void AddStatistics(const QUIC_STATISTICS& Statistics) {
+        InterlockedExchangeAdd64(&SendTotalPackets, (int64_t)Statistics.Send.TotalPackets);
+        InterlockedExchangeAdd64(&RecvTotalStreamBytes, (int64_t)Statistics.Recv.TotalStreamBytes);
+        InterlockedExchangeAdd64(&ProcessingTimeUs, (int64_t)Statistics.Processing.TotalTime);
+    }
+
     ~PingStats() {
         QuicEventUninitialize(CompletionEvent);
         QuicZeroMemory(&CompletionEvent, sizeof(CompletionEvent));
@@ -208,6 +227,9 @@ PingConnectionShutdown(
         TEST_FALSE(Connection->GetTransportClosed());
         TEST_FALSE(Connection->GetPeerClosed());
     }
+    if (ConnState->GetPingStats()->CollectStatistics) {
+        ConnState->GetPingStats()->AddStatistics(Connection->GetStatistics());
+    }
     delete ConnState;
 }
 
@@ -447,6 +469,160 @@ QuicTestConnectAndPing(
     }
 }
 
+//
+// Bounds on the protocol efficiency of a loopback transfer. They are loose
+// enough to hold on any build, but fail on regressions like extra or
+// under-filled packets, lost ACK decimation or pathological CPU use.
+//
+#define PING_EFFICIENCY_MAX_PACKETS_PER_MB      1100    // ~870 full packets per MB at the minimum MTU
+#define PING_EFFICIENCY_MAX_ACK_RATIO_PERCENT   60      // Receiver packets per 100 sender packets
+#define PING_EFFICIENCY_MAX_CPU_US_PER_MB       200000  // Sender connection's processing time
+
+void
+QuicTestPingEfficiencyRun(
+    _In_ QUIC_ADDRESS_FAMILY QuicAddrFamily,
+    _In_ uint64_t Length,
+    _In_ uint32_t StreamCount
+    )
+{
+    const uint32_t TimeoutMs = EstimateTimeoutMs(Length * StreamCount);
+
+    PingStats ServerStats(Length, 1, StreamCount, false, false, false, false);
+    PingStats ClientStats(Length, 1, StreamCount, false, false, false, false);
+    ServerStats.CollectStatistics = true;
+    ClientStats.CollectStatistics = true;
+
+    {
+        MsQuicSession Session;
+        TEST_TRUE(Session.IsValid());
+        Session.SetAutoCleanup();
+        TEST_QUIC_SUCCEEDED(Session.SetPeerBidiStreamCount((uint16_t)StreamCount));
+
+        TestListener Listener(Session.Handle, ListenerAcceptPingConnection, false, false);
+        TEST_TRUE(Listener.IsValid());
+        TEST_QUIC_SUCCEEDED(Listener.Start());
+        Listener.Context = &ServerStats;
+
+        QuicAddr ServerLocalAddr;
+        TEST_QUIC_SUCCEEDED(Listener.GetLocalAddr(ServerLocalAddr));
+
+        TestConnection* Connection = NewPingConnection(Session, &ClientStats, false);
+        if (Connection == nullptr) {
+            return;
+        }
+        if (!SendPingBurst(Connection, StreamCount, Length)) {
+            return;
+        }
+
+        QuicAddr RemoteAddr(QuicAddrFamily, true);
+        TEST_QUIC_SUCCEEDED(Connection->SetRemoteAddr(RemoteAddr));
+        TEST_QUIC_SUCCEEDED(
+            Connection->Start(
+                QuicAddrFamily,
+                nullptr,
+                ServerLocalAddr.GetPort()));
+
+        if (!QuicEventWaitWithTimeout(ClientStats.CompletionEvent, TimeoutMs)) {
+            TEST_FAILURE("Wait for clients to complete timed out after %u ms.", TimeoutMs);
+            return;
+        }
+
+        if (!QuicEventWaitWithTimeout(ServerStats.CompletionEvent, TimeoutMs)) {
+            TEST_FAILURE("Wait for server to complete timed out after %u ms.", TimeoutMs);
+            return;
+        }
+
+        //
+        // Closing the session shuts down the connections, which collects
+        // their statistics.
+        //
+    }
+
+    const uint64_t Megabytes = (Length * StreamCount + 999999) / 1000000;
+    const uint64_t ClientPackets = (uint64_t)ClientStats.SendTotalPackets;
+    const uint64_t ServerPackets = (uint64_t)ServerStats.SendTotalPackets;
+
+    TEST_EQUAL((uint64_t)ServerStats.RecvTotalStreamBytes, Length * StreamCount);
+
+    if (ClientPackets > PING_EFFICIENCY_MAX_PACKETS_PER_MB * Megabytes) {
+        TEST_FAILURE(
+            "%llu packets sent for %llu MB, more than %u per MB.",
+            ClientPackets, Megabytes, PING_EFFICIENCY_MAX_PACKETS_PER_MB);
+    }
+
+    if (ServerPackets * 100 > ClientPackets * PING_EFFICIENCY_MAX_ACK_RATIO_PERCENT) {
+        TEST_FAILURE(
+            "Receiver sent %llu packets for %llu received, more than %u%%.",
+            ServerPackets, ClientPackets, PING_EFFICIENCY_MAX_ACK_RATIO_PERCENT);
+    }
+
+    if ((uint64_t)ClientStats.ProcessingTimeUs > PING_EFFICIENCY_MAX_CPU_US_PER_MB * Megabytes) {
+        TEST_FAILURE(
+            "Sender processing took %llu us for %llu MB, more than %u us per MB.",
+            (uint64_t)ClientStats.ProcessingTimeUs, Megabytes, PING_EFFICIENCY_MAX_CPU_US_PER_MB);
+    }
+}
+
+void
+QuicTestPingEfficiency(
+    _In_ int Family
+    )
+{
+#if QUIC_SEND_FAKE_LOSS
+    //
+    // The bounds don't account for artificial loss.
+    //
+    UNREFERENCED_PARAMETER(Family);
+#else
+    QUIC_ADDRESS_FAMILY QuicAddrFamily = (Family == 4) ? AF_INET : AF_INET6;
+
+    //
+    // One large transfer, and many small ones in parallel on one connection.
+    //
+    QuicTestPingEfficiencyRun(QuicAddrFamily, 10000000, 1);
+    QuicTestPingEfficiencyRun(QuicAddrFamily, 100000, 50);
+#endif
+}
+
+void
+QuicTestConnectAndPingEmulated(
+    _In_ int Family
+    )
+{
+    //
+    // A 10 Mbps bottleneck with a 20 ms round trip and a 64 KB buffer, which
+    // also loses 1% of the datagrams (in short bursts) and reorders 1%.
+    //
+    QUIC_NETWORK_EMULATION Emulation = { 0 };
+    Emulation.DelayUs = 10000;
+    Emulation.JitterUs = 1000;
+    Emulation.RateKbps = 10000;
+    Emulation.QueueLimitBytes = 0x10000;
+    Emulation.LossPpm = 10000;
+    Emulation.BurstLength = 2;
+    Emulation.ReorderPpm = 10000;
+    Emulation.ReorderDelayUs = 5000;
+    Emulation.RandomSeed = 0x5EED;
+
+    NetworkEmulationHelper EmulationHelper(Emulation);
+
+    QuicTestConnectAndPing(
+        Family,
+        1000000,
+        1,      // ConnectionCount
+        1,      // StreamCount
+        1,      // StreamBurstCount
+        0,      // StreamBurstDelayMs
+        false,  // ServerStatelessRetry
+        false,  // ClientRebind
+        false,  // ClientZeroRtt
+        false,  // ServerRejectZeroRtt
+        false,  // UseSendBuffer
+        false,  // UnidirectionalStreams
+        false,  // ServerInitiatedStreams
+        true);  // FifoScheduling
+}
+
 void
 QuicTestServerDisconnect(
     void
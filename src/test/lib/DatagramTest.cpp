@@ -244,3 +244,116 @@ QuicTestDatagramSend(
         }
     }
 }
+
+void
+QuicTestDatagramSendBatch(
+    _In_ int Family
+    )
+{
+    MsQuicSession Session;
+    TEST_TRUE(Session.IsValid());
+    TEST_QUIC_SUCCEEDED(Session.SetDatagramReceiveEnabled(true));
+
+    uint8_t RawBuffer[] = "datagram";
+    QUIC_BUFFER DatagramBuffer = { sizeof(RawBuffer), RawBuffer };
+
+    {
+        TestListener Listener(Session.Handle, ListenerAcceptConnection);
+        TEST_TRUE(Listener.IsValid());
+
+        QUIC_ADDRESS_FAMILY QuicAddrFamily = (Family == 4) ? AF_INET : AF_INET6;
+        QuicAddr ServerLocalAddr(QuicAddrFamily);
+        TEST_QUIC_SUCCEEDED(Listener.Start(&ServerLocalAddr.SockAddr));
+        TEST_QUIC_SUCCEEDED(Listener.GetLocalAddr(ServerLocalAddr));
+
+        {
+            UniquePtr<TestConnection> Server;
+            ServerAcceptContext ServerAcceptCtx((TestConnection**)&Server);
+            Listener.Context = &ServerAcceptCtx;
+
+            {
+                TestConnection Client(Session);
+                TEST_TRUE(Client.IsValid());
+
+                TEST_TRUE(Client.GetDatagramSendEnabled());
+
+                //
+                // Queue datagrams before the handshake: the one with a short
+                // lifetime expires before it can be sent, and is canceled.
+                //
+                QUIC_DATAGRAM_SEND_BATCH_ENTRY EarlyEntries[2] = {
+                    { &DatagramBuffer, 1, QUIC_SEND_FLAG_NONE, 0, nullptr, QUIC_STATUS_SUCCESS },
+                    { &DatagramBuffer, 1, QUIC_SEND_FLAG_NONE, 1, nullptr, QUIC_STATUS_SUCCESS }
+                };
+                TEST_QUIC_STATUS(
+                    QUIC_STATUS_PENDING,
+                    MsQuic->DatagramSendBatch(
+                        Client.GetConnection(),
+                        EarlyEntries,
+                        ARRAYSIZE(EarlyEntries)));
+                TEST_QUIC_STATUS(QUIC_STATUS_PENDING, EarlyEntries[0].Status);
+                TEST_QUIC_STATUS(QUIC_STATUS_PENDING, EarlyEntries[1].Status);
+
+                QuicSleep(50);
+
+                TEST_QUIC_SUCCEEDED(
+                    Client.Start(
+                        QuicAddrFamily,
+                        QUIC_LOCALHOST_FOR_AF(QuicAddrFamily),
+                        ServerLocalAddr.GetPort()));
+
+                if (!Client.WaitForConnectionComplete()) {
+                    return;
+                }
+                TEST_TRUE(Client.GetIsConnected());
+
+                TEST_TRUE(Client.GetDatagramSendEnabled());
+
+                TEST_NOT_EQUAL(nullptr, Server);
+                if (!Server->WaitForConnectionComplete()) {
+                    return;
+                }
+                TEST_TRUE(Server->GetIsConnected());
+
+                QuicSleep(100);
+
+                TEST_EQUAL(1, Client.GetDatagramsSent());
+                TEST_EQUAL(1, Client.GetDatagramsCanceled());
+
+                //
+                // Datagrams with a long enough lifetime are sent like any
+                // other.
+                //
+                QUIC_DATAGRAM_SEND_BATCH_ENTRY Entries[2] = {
+                    { &DatagramBuffer, 1, QUIC_SEND_FLAG_NONE, 0, nullptr, QUIC_STATUS_SUCCESS },
+                    { &DatagramBuffer, 1, QUIC_SEND_FLAG_DGRAM_PRIORITY, 10000, nullptr, QUIC_STATUS_SUCCESS }
+                };
+                TEST_QUIC_STATUS(
+                    QUIC_STATUS_PENDING,
+                    MsQuic->DatagramSendBatch(
+                        Client.GetConnection(),
+                        Entries,
+                        ARRAYSIZE(Entries)));
+                TEST_QUIC_STATUS(QUIC_STATUS_PENDING, Entries[0].Status);
+                TEST_QUIC_STATUS(QUIC_STATUS_PENDING, Entries[1].Status);
+
+                QuicSleep(100);
+
+                TEST_EQUAL(3, Client.GetDatagramsSent());
+
+                QuicSleep(100);
+
+                TEST_EQUAL(3, Client.GetDatagramsAcknowledged());
+                TEST_EQUAL(1, Client.GetDatagramsCanceled());
+
+                Client.Shutdown(QUIC_CONNECTION_SHUTDOWN_FLAG_NONE, QUIC_TEST_NO_ERROR);
+                if (!Client.WaitForShutdownComplete()) {
+                    return;
+                }
+
+                TEST_FALSE(Client.GetPeerClosed());
+                TEST_FALSE(Client.GetTransportClosed());
+            }
+        }
+    }
+}
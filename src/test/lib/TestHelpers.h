@@ -372,6 +372,32 @@ struct StatelessRetryHelper
     }
 };
 
+//
+// Applies the network emulation to the bindings created while in scope.
+//
+struct NetworkEmulationHelper
+{
+    NetworkEmulationHelper(const QUIC_NETWORK_EMULATION& Emulation) {
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                nullptr,
+                QUIC_PARAM_LEVEL_GLOBAL,
+                QUIC_PARAM_GLOBAL_NETWORK_EMULATION,
+                sizeof(Emulation),
+                &Emulation));
+    }
+    ~NetworkEmulationHelper() {
+        QUIC_NETWORK_EMULATION Emulation = { 0 };
+        TEST_QUIC_SUCCEEDED(
+            MsQuic->SetParam(
+                nullptr,
+                QUIC_PARAM_LEVEL_GLOBAL,
+                QUIC_PARAM_GLOBAL_NETWORK_EMULATION,
+                sizeof(Emulation),
+                &Emulation));
+    }
+};
+
 #define PRIVATE_TP_TYPE   77
 #define PRIVATE_TP_LENGTH 2345
 
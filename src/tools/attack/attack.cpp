@@ -11,11 +11,20 @@
 #pragma warning(disable:4214)  // nonstandard extension used: zero-sized array in struct/union
 #pragma warning(disable:28931) // Unused Assignment
 
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+#define QUIC_TEST_APIS 1 // Needed for self signed cert API
 #include <precomp.h> // from 'core' dir
 #include <msquichelper.h>
 
 #include "packet_writer.h"
 
+#if !_WIN32
+#include <time.h>
+#endif
+
 #define US_TO_MS(x) ((x) / 1000)
 
 #define QUIC_MIN_INITIAL_LENGTH 1200
@@ -26,6 +35,14 @@
 
 #define ATTACK_PORT_DEFAULT 443
 
+#define BENCH_PORT_DEFAULT 4433
+
+#define BENCH_BASELINE_DEFAULT_MS (5 * 1000)
+
+#define BENCH_PING_INTERVAL_DEFAULT_MS 10
+
+#define BENCH_POLL_INTERVAL_MS 100
+
 void
 PrintUsage()
 {
@@ -33,7 +50,15 @@ PrintUsage()
 
     printf("Usage:\n");
     printf("  quicattack.exe -list\n\n");
-    printf("  quicattack.exe -type:<number> -ip:<ip_address_and_port> [-alpn:<protocol_name>] [-sni:<host_name>] [-timeout:<ms>] [-threads:<count>]\n\n");
+    printf("  quicattack.exe -type:<number> -ip:<ip_address_and_port> [-alpn:<protocol_name>] [-sni:<host_name>] [-timeout:<ms>] [-threads:<count>] [-rate:<packets_per_sec>]\n\n");
+    printf("  quicattack.exe -bench [-port:<number>] [-alpn:<protocol_name>] [-timeout:<ms>] [-threads:<count>] [-rate:<packets_per_sec>] [-junk:<packets_per_sec>] [-junktype:<1-3>] [-retry:<limit>] [-baseline:<ms>] [-interval:<ms>]\n\n");
+
+    printf("-bench hosts a server on the loopback and measures its handshake cost. After\n");
+    printf("a -baseline period with only a ping workload, -threads threads each send valid\n");
+    printf("Initials (type 4) at -rate (0 for unlimited), and one more thread sends -junk\n");
+    printf("packets per second of -junktype (def 3), for -timeout. The ping workload opens\n");
+    printf("a stream every -interval the whole time. -retry sets the retry memory limit,\n");
+    printf("in units of 1/65535 of total memory.\n\n");
 }
 
 void
@@ -90,13 +115,42 @@ UdpUnreachCallback(
 {
 }
 
+//
+// Returns true if PacketCount packets sent since TimeStart are already at or
+// above Rate, in packets per second. A Rate of 0 is unlimited.
+//
+bool
+AttackIsAhead(
+    uint64_t TimeStart,
+    uint64_t PacketCount,
+    uint32_t Rate
+    )
+{
+    return
+        Rate != 0 &&
+        PacketCount * 1000 >= QuicTimeDiff64(TimeStart, QuicTimeMs64()) * Rate;
+}
+
 void
+AttackPace(
+    uint64_t TimeStart,
+    uint64_t PacketCount,
+    uint32_t Rate
+    )
+{
+    while (AttackIsAhead(TimeStart, PacketCount, Rate)) {
+        QuicSleep(1);
+    }
+}
+
+uint64_t
 RunAttackRandom(
     QUIC_DATAPATH_BINDING* Binding,
     const QUIC_ADDR* ServerAddress,
     uint16_t Length,
     bool ValidQuic,
-    uint64_t TimeoutMs
+    uint64_t TimeoutMs,
+    uint32_t Rate
     )
 {
     uint64_t ConnectionId = 0;
@@ -106,20 +160,23 @@ RunAttackRandom(
     uint64_t TimeStart = QuicTimeMs64();
     while (QuicTimeDiff64(TimeStart, QuicTimeMs64()) < TimeoutMs) {
 
+        AttackPace(TimeStart, PacketCount, Rate);
+
         QUIC_DATAPATH_SEND_CONTEXT* SendContext =
-            QuicDataPathBindingAllocSendContext(Binding, Length);
+            QuicDataPathBindingAllocSendContext(Binding, QUIC_ECN_NON_ECT, Length);
         if (SendContext == nullptr) {
             printf("QuicDataPathBindingAllocSendContext failed\n");
-            return;
+            return PacketCount;
         }
 
-        while (!QuicDataPathBindingIsSendContextFull(SendContext)) {
+        while (!QuicDataPathBindingIsSendContextFull(SendContext) &&
+            !AttackIsAhead(TimeStart, PacketCount, Rate)) {
             QUIC_BUFFER* SendBuffer =
                 QuicDataPathBindingAllocSendDatagram(SendContext, Length);
             if (SendBuffer == nullptr) {
                 printf("QuicDataPathBindingAllocSendDatagram failed\n");
                 QuicDataPathBindingFreeSendContext(SendContext);
-                return;
+                return PacketCount;
             }
 
             QuicRandom(Length, SendBuffer->Buffer);
@@ -152,13 +209,14 @@ RunAttackRandom(
                 SendContext);
         if (QUIC_FAILED(Status)) {
             printf("QuicDataPathBindingSendTo failed, 0x%x\n", Status);
-            return;
+            return PacketCount;
         }
     }
 
     uint64_t TimeEnd = QuicTimeMs64();
     printf("%llu packets were sent (%llu Hz).\n",
         PacketCount, (PacketCount * 1000) / QuicTimeDiff64(TimeStart, TimeEnd));
+    return PacketCount;
 }
 
 #if DEBUG
@@ -174,13 +232,14 @@ void printf_buf(const char* name, void* buf, uint32_t len)
 #define printf_buf(name, buf, len)
 #endif
 
-void
+uint64_t
 RunAttackValidInitial(
     QUIC_DATAPATH_BINDING* Binding,
     const QUIC_ADDR* ServerAddress,
     _In_z_ const char* Alpn,
     _In_opt_z_ const char* ServerName,
-    uint64_t TimeoutMs
+    uint64_t TimeoutMs,
+    uint32_t Rate
     )
 {
     const StrBuffer InitialSalt("7fbcdb0e7c66bbe9193a96cd21519ebd7a02644a");
@@ -210,12 +269,15 @@ RunAttackValidInitial(
     uint64_t TimeStart = QuicTimeMs64();
     while (QuicTimeDiff64(TimeStart, QuicTimeMs64()) < TimeoutMs) {
 
+        AttackPace(TimeStart, PacketCount, Rate);
+
         QUIC_DATAPATH_SEND_CONTEXT* SendContext =
-            QuicDataPathBindingAllocSendContext(Binding, DatagramLength);
+            QuicDataPathBindingAllocSendContext(Binding, QUIC_ECN_NON_ECT, DatagramLength);
         VERIFY(SendContext);
 
         while (QuicTimeDiff64(TimeStart, QuicTimeMs64()) < TimeoutMs &&
-            !QuicDataPathBindingIsSendContextFull(SendContext)) {
+            !QuicDataPathBindingIsSendContextFull(SendContext) &&
+            !AttackIsAhead(TimeStart, PacketCount, Rate)) {
             QUIC_BUFFER* SendBuffer =
                 QuicDataPathBindingAllocSendDatagram(SendContext, DatagramLength);
             VERIFY(SendBuffer);
@@ -286,8 +348,69 @@ RunAttackValidInitial(
     uint64_t TimeEnd = QuicTimeMs64();
     printf("%llu packets were sent (%llu Hz).\n",
         PacketCount, (PacketCount * 1000) / QuicTimeDiff64(TimeStart, TimeEnd));
+    return PacketCount;
 }
 
+//
+// The CPU time, in microseconds, used so far by the process or the calling
+// thread.
+//
+#if _WIN32
+uint64_t
+FileTimeToUs(
+    const FILETIME& Time
+    )
+{
+    return (((uint64_t)Time.dwHighDateTime << 32) | Time.dwLowDateTime) / 10;
+}
+
+uint64_t
+GetProcessCpuTimeUs()
+{
+    FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+    if (!GetProcessTimes(
+            GetCurrentProcess(), &CreationTime, &ExitTime, &KernelTime, &UserTime)) {
+        return 0;
+    }
+    return FileTimeToUs(KernelTime) + FileTimeToUs(UserTime);
+}
+
+uint64_t
+GetThreadCpuTimeUs()
+{
+    FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+    if (!GetThreadTimes(
+            GetCurrentThread(), &CreationTime, &ExitTime, &KernelTime, &UserTime)) {
+        return 0;
+    }
+    return FileTimeToUs(KernelTime) + FileTimeToUs(UserTime);
+}
+#else
+uint64_t
+GetCpuTimeUs(
+    clockid_t Clock
+    )
+{
+    struct timespec Time;
+    if (clock_gettime(Clock, &Time) != 0) {
+        return 0;
+    }
+    return (uint64_t)Time.tv_sec * 1000000 + (uint64_t)Time.tv_nsec / 1000;
+}
+
+uint64_t
+GetProcessCpuTimeUs()
+{
+    return GetCpuTimeUs(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+uint64_t
+GetThreadCpuTimeUs()
+{
+    return GetCpuTimeUs(CLOCK_THREAD_CPUTIME_ID);
+}
+#endif
+
 struct ATTACK_THREAD_CONTEXT {
     QUIC_DATAPATH_BINDING* Binding;
     uint32_t Type;
@@ -295,30 +418,62 @@ struct ATTACK_THREAD_CONTEXT {
     const char* Alpn;
     const char* ServerName;
     uint64_t TimeoutMs;
+    uint32_t Rate;          // Packets per second, 0 for unlimited
+    uint64_t PacketCount;   // Out - packets sent
+    uint64_t CpuTimeUs;     // Out - CPU time used by the thread
+    QUIC_THREAD Thread;
 };
 
 QUIC_THREAD_CALLBACK(RunAttackThread, _Context)
 {
-    const ATTACK_THREAD_CONTEXT* Context = (ATTACK_THREAD_CONTEXT*)_Context;
+    ATTACK_THREAD_CONTEXT* Context = (ATTACK_THREAD_CONTEXT*)_Context;
+    uint64_t CpuStart = GetThreadCpuTimeUs();
     switch (Context->Type) {
     case 1:
-        RunAttackRandom(Context->Binding, Context->ServerAddress, 1, false, Context->TimeoutMs);
+        Context->PacketCount = RunAttackRandom(Context->Binding, Context->ServerAddress, 1, false, Context->TimeoutMs, Context->Rate);
         break;
     case 2:
-        RunAttackRandom(Context->Binding, Context->ServerAddress, QUIC_MIN_INITIAL_LENGTH, false, Context->TimeoutMs);
+        Context->PacketCount = RunAttackRandom(Context->Binding, Context->ServerAddress, QUIC_MIN_INITIAL_LENGTH, false, Context->TimeoutMs, Context->Rate);
         break;
     case 3:
-        RunAttackRandom(Context->Binding, Context->ServerAddress, QUIC_MIN_INITIAL_LENGTH, true, Context->TimeoutMs);
+        Context->PacketCount = RunAttackRandom(Context->Binding, Context->ServerAddress, QUIC_MIN_INITIAL_LENGTH, true, Context->TimeoutMs, Context->Rate);
         break;
     case 4:
-        RunAttackValidInitial(Context->Binding, Context->ServerAddress, Context->Alpn, Context->ServerName, Context->TimeoutMs);
+        Context->PacketCount = RunAttackValidInitial(Context->Binding, Context->ServerAddress, Context->Alpn, Context->ServerName, Context->TimeoutMs, Context->Rate);
         break;
     default:
         break;
     }
+    Context->CpuTimeUs = GetThreadCpuTimeUs() - CpuStart;
     QUIC_THREAD_RETURN(QUIC_STATUS_SUCCESS);
 }
 
+void
+StartAttackThreads(
+    ATTACK_THREAD_CONTEXT* Contexts,
+    uint32_t ThreadCount
+    )
+{
+    for (uint32_t i = 0; i < ThreadCount; ++i) {
+        QUIC_THREAD_CONFIG ThreadConfig = {
+            0, 0, "AttackRunner", RunAttackThread, &Contexts[i]
+        };
+        QuicThreadCreate(&ThreadConfig, &Contexts[i].Thread);
+    }
+}
+
+void
+WaitAttackThreads(
+    ATTACK_THREAD_CONTEXT* Contexts,
+    uint32_t ThreadCount
+    )
+{
+    for (uint32_t i = 0; i < ThreadCount; ++i) {
+        QuicThreadWait(&Contexts[i].Thread);
+        QuicThreadDelete(&Contexts[i].Thread);
+    }
+}
+
 void
 RunAttack(
     uint32_t ThreadCount,
@@ -326,7 +481,8 @@ RunAttack(
     const QUIC_ADDR* ServerAddress,
     _In_z_ const char* Alpn,
     _In_opt_z_ const char* ServerName,
-    uint64_t TimeoutMs
+    uint64_t TimeoutMs,
+    uint32_t Rate
     )
 {
     QUIC_STATUS Status;
@@ -357,21 +513,631 @@ RunAttack(
     }
 
     {
-        ATTACK_THREAD_CONTEXT ThreadContext = {
-            Binding, Type, ServerAddress, Alpn, ServerName, TimeoutMs
-        };
-        QUIC_THREAD* Threads =
-            (QUIC_THREAD*)QUIC_ALLOC_PAGED(ThreadCount * sizeof(QUIC_THREAD));
+        ATTACK_THREAD_CONTEXT* Contexts = new ATTACK_THREAD_CONTEXT[ThreadCount];
         for (uint32_t i = 0; i < ThreadCount; ++i) {
-            QUIC_THREAD_CONFIG ThreadConfig = {
-                0, 0, "AttackRunner", RunAttackThread, &ThreadContext
+            Contexts[i] = {
+                Binding, Type, ServerAddress, Alpn, ServerName, TimeoutMs, Rate
             };
-            QuicThreadCreate(&ThreadConfig, &Threads[i]);
         }
+        StartAttackThreads(Contexts, ThreadCount);
+        WaitAttackThreads(Contexts, ThreadCount);
+        delete [] Contexts;
+    }
+
+Error:
+
+    if (Binding != nullptr) {
+        QuicDataPathBindingDelete(Binding);
+    }
+
+    if (Datapath != nullptr) {
+        QuicDataPathUninitialize(Datapath);
+    }
+}
+
+//
+// State of the -bench mode: an in-process server, and a ping workload run
+// against it (over its own connection) while it is attacked.
+//
+struct BENCH_CONTEXT {
+    const QUIC_API_TABLE* MsQuic;
+    QUIC_SEC_CONFIG* SecConfig;
+    HQUIC ClientConnection;
+    QUIC_EVENT ClientConnected;
+    bool IsClientConnected;
+    uint32_t PingIntervalMs;
+    std::atomic<bool> PingStop;
+    std::atomic<uint32_t> PingPhase;    // Index of the phase pings are recorded in
+    std::vector<uint64_t> Latencies[2]; // Baseline and attack ping latencies (us)
+    uint64_t PingFailures[2];
+};
+
+struct BENCH_PING {
+    uint64_t TimeStart;
+    uint64_t LatencyUs;
+    bool Received;
+    QUIC_EVENT Complete;
+};
+
+#define BENCH_PHASE_BASELINE    0
+#define BENCH_PHASE_ATTACK      1
+
+#define BENCH_PING_TIMEOUT_MS   5000
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Function_class_(QUIC_STREAM_CALLBACK)
+QUIC_STATUS
+QUIC_API
+BenchServerStreamCallback(
+    _In_ HQUIC Stream,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_STREAM_EVENT* Event
+    )
+{
+    BENCH_CONTEXT* Bench = (BENCH_CONTEXT*)Context;
+    switch (Event->Type) {
+    case QUIC_STREAM_EVENT_PEER_SEND_SHUTDOWN:
+        //
+        // Answer the ping with a FIN of our own.
+        //
+        Bench->MsQuic->StreamShutdown(Stream, QUIC_STREAM_SHUTDOWN_FLAG_GRACEFUL, 0);
+        break;
+    case QUIC_STREAM_EVENT_PEER_SEND_ABORTED:
+        Bench->MsQuic->StreamShutdown(Stream, QUIC_STREAM_SHUTDOWN_FLAG_ABORT, 0);
+        break;
+    case QUIC_STREAM_EVENT_SHUTDOWN_COMPLETE:
+        Bench->MsQuic->StreamClose(Stream);
+        break;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Function_class_(QUIC_CONNECTION_CALLBACK)
+QUIC_STATUS
+QUIC_API
+BenchServerConnectionCallback(
+    _In_ HQUIC Connection,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_CONNECTION_EVENT* Event
+    )
+{
+    BENCH_CONTEXT* Bench = (BENCH_CONTEXT*)Context;
+    switch (Event->Type) {
+    case QUIC_CONNECTION_EVENT_PEER_STREAM_STARTED:
+        Bench->MsQuic->SetCallbackHandler(
+            Event->PEER_STREAM_STARTED.Stream,
+            (void*)BenchServerStreamCallback,
+            Bench);
+        break;
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_COMPLETE:
+        Bench->MsQuic->ConnectionClose(Connection);
+        break;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Function_class_(QUIC_LISTENER_CALLBACK)
+QUIC_STATUS
+QUIC_API
+BenchListenerCallback(
+    _In_ HQUIC /* Listener */,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_LISTENER_EVENT* Event
+    )
+{
+    BENCH_CONTEXT* Bench = (BENCH_CONTEXT*)Context;
+    switch (Event->Type) {
+    case QUIC_LISTENER_EVENT_NEW_CONNECTION:
+        Event->NEW_CONNECTION.SecurityConfig = Bench->SecConfig;
+        Bench->MsQuic->SetCallbackHandler(
+            Event->NEW_CONNECTION.Connection,
+            (void*)BenchServerConnectionCallback,
+            Bench);
+        break;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Function_class_(QUIC_CONNECTION_CALLBACK)
+QUIC_STATUS
+QUIC_API
+BenchClientConnectionCallback(
+    _In_ HQUIC /* Connection */,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_CONNECTION_EVENT* Event
+    )
+{
+    BENCH_CONTEXT* Bench = (BENCH_CONTEXT*)Context;
+    switch (Event->Type) {
+    case QUIC_CONNECTION_EVENT_CONNECTED:
+        Bench->IsClientConnected = true;
+        QuicEventSet(Bench->ClientConnected);
+        break;
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_COMPLETE:
+        QuicEventSet(Bench->ClientConnected);
+        break;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Function_class_(QUIC_STREAM_CALLBACK)
+QUIC_STATUS
+QUIC_API
+BenchPingStreamCallback(
+    _In_ HQUIC /* Stream */,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_STREAM_EVENT* Event
+    )
+{
+    BENCH_PING* Ping = (BENCH_PING*)Context;
+    switch (Event->Type) {
+    case QUIC_STREAM_EVENT_PEER_SEND_SHUTDOWN:
+        Ping->LatencyUs = QuicTimeDiff64(Ping->TimeStart, QuicTimeUs64());
+        Ping->Received = true;
+        break;
+    case QUIC_STREAM_EVENT_SHUTDOWN_COMPLETE:
+        QuicEventSet(Ping->Complete);
+        break;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+//
+// Opens a stream every PingIntervalMs, closing it immediately with a FIN, and
+// records the time until the server's FIN is received.
+//
+QUIC_THREAD_CALLBACK(BenchPingThread, _Context)
+{
+    BENCH_CONTEXT* Bench = (BENCH_CONTEXT*)_Context;
+    while (!Bench->PingStop) {
+        uint32_t Phase = Bench->PingPhase;
+
+        BENCH_PING Ping;
+        Ping.LatencyUs = 0;
+        Ping.Received = false;
+        QuicEventInitialize(&Ping.Complete, FALSE, FALSE);
+
+        HQUIC Stream = nullptr;
+        Ping.TimeStart = QuicTimeUs64();
+        if (QUIC_SUCCEEDED(
+            Bench->MsQuic->StreamOpen(
+                Bench->ClientConnection,
+                QUIC_STREAM_OPEN_FLAG_NONE,
+                BenchPingStreamCallback,
+                &Ping,
+                &Stream))) {
+            if (QUIC_SUCCEEDED(
+                Bench->MsQuic->StreamStart(Stream, QUIC_STREAM_START_FLAG_NONE)) &&
+                QUIC_SUCCEEDED(
+                Bench->MsQuic->StreamShutdown(Stream, QUIC_STREAM_SHUTDOWN_FLAG_GRACEFUL, 0))) {
+                QuicEventWaitWithTimeout(Ping.Complete, BENCH_PING_TIMEOUT_MS);
+            }
+            //
+            // Closing waits for any callback still running, so Ping can't be
+            // used after this.
+            //
+            Bench->MsQuic->StreamClose(Stream);
+        }
+        QuicEventUninitialize(Ping.Complete);
+
+        if (Ping.Received) {
+            Bench->Latencies[Phase].push_back(Ping.LatencyUs);
+        } else {
+            Bench->PingFailures[Phase]++;
+        }
+
+        QuicSleep(Bench->PingIntervalMs);
+    }
+    QUIC_THREAD_RETURN(QUIC_STATUS_SUCCESS);
+}
+
+void
+BenchGetPerfCounters(
+    const QUIC_API_TABLE* MsQuic,
+    int64_t* Counters
+    )
+{
+    uint32_t BufferLength = sizeof(int64_t) * QUIC_PERF_COUNTER_MAX;
+    if (QUIC_FAILED(
+        MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_PERF_COUNTERS,
+            &BufferLength,
+            Counters))) {
+        memset(Counters, 0, sizeof(int64_t) * QUIC_PERF_COUNTER_MAX);
+    }
+}
+
+void
+BenchPrintLatency(
+    const char* Name,
+    std::vector<uint64_t>& Latencies,
+    uint64_t Failures
+    )
+{
+    if (Latencies.empty()) {
+        printf("%s ping: none completed, %llu failed\n", Name, Failures);
+        return;
+    }
+    std::sort(Latencies.begin(), Latencies.end());
+    const size_t Last = Latencies.size() - 1;
+    printf("%s ping: %llu completed, %llu failed, latency (us) p50 %llu p90 %llu p99 %llu max %llu\n",
+        Name,
+        (uint64_t)Latencies.size(),
+        Failures,
+        Latencies[Last / 2],
+        Latencies[(Last * 90) / 100],
+        Latencies[(Last * 99) / 100],
+        Latencies[Last]);
+}
+
+//
+// Attacks the server from the given threads for TimeoutMs, while the ping
+// workload runs, and reports the server's cost per handshake, when it started
+// sending Retry packets and the ping latencies.
+//
+void
+RunBenchMeasure(
+    BENCH_CONTEXT* Bench,
+    ATTACK_THREAD_CONTEXT* Contexts,
+    uint32_t ThreadCount,
+    uint64_t TimeoutMs,
+    uint64_t BaselineMs
+    )
+{
+    const QUIC_API_TABLE* MsQuic = Bench->MsQuic;
+
+    uint16_t RetryMemoryLimit = 0;
+    uint32_t BufferLength = sizeof(RetryMemoryLimit);
+    (void)MsQuic->GetParam(
+        nullptr,
+        QUIC_PARAM_LEVEL_GLOBAL,
+        QUIC_PARAM_GLOBAL_RETRY_MEMORY_PERCENT,
+        &BufferLength,
+        &RetryMemoryLimit);
+
+    QUIC_THREAD PingThread;
+    QUIC_THREAD_CONFIG PingThreadConfig = {
+        0, 0, "BenchPing", BenchPingThread, Bench
+    };
+    QuicThreadCreate(&PingThreadConfig, &PingThread);
+
+    //
+    // The baseline measures the CPU used by the ping workload (and the idle
+    // server) alone, to be taken out of the attack's.
+    //
+    uint64_t BaselineCpuStart = GetProcessCpuTimeUs();
+    uint64_t BaselineStart = QuicTimeUs64();
+    QuicSleep((uint32_t)BaselineMs);
+    uint64_t BaselineCpuUs = GetProcessCpuTimeUs() - BaselineCpuStart;
+    uint64_t BaselineUs = QuicTimeDiff64(BaselineStart, QuicTimeUs64());
+
+    int64_t CountersStart[QUIC_PERF_COUNTER_MAX];
+    int64_t Counters[QUIC_PERF_COUNTER_MAX];
+    BenchGetPerfCounters(MsQuic, CountersStart);
+
+    Bench->PingPhase = BENCH_PHASE_ATTACK;
+    uint64_t AttackCpuStart = GetProcessCpuTimeUs();
+    uint64_t AttackStart = QuicTimeUs64();
+    StartAttackThreads(Contexts, ThreadCount);
+
+    //
+    // Watch for the first Retry, i.e. QuicBindingShouldRetryConnection finding
+    // the handshake memory over the limit.
+    //
+    uint64_t RetryTimeMs = UINT64_MAX;
+    int64_t RetryConnections = 0;
+    uint64_t RetryHandshakeMemory = 0;
+    uint64_t MaxHandshakeMemory = 0;
+    uint64_t ElapsedMs;
+    do {
+        QuicSleep(BENCH_POLL_INTERVAL_MS);
+        ElapsedMs = US_TO_MS(QuicTimeDiff64(AttackStart, QuicTimeUs64()));
+
+        QUIC_MEMORY_USAGE Usage = {0};
+        BufferLength = sizeof(Usage);
+        (void)MsQuic->GetParam(
+            nullptr,
+            QUIC_PARAM_LEVEL_GLOBAL,
+            QUIC_PARAM_GLOBAL_MEMORY_USAGE,
+            &BufferLength,
+            &Usage);
+        if (Usage.Handshakes > MaxHandshakeMemory) {
+            MaxHandshakeMemory = Usage.Handshakes;
+        }
+
+        BenchGetPerfCounters(MsQuic, Counters);
+        if (RetryTimeMs == UINT64_MAX &&
+            Counters[QUIC_PERF_COUNTER_RETRY_SENT] >
+                CountersStart[QUIC_PERF_COUNTER_RETRY_SENT]) {
+            RetryTimeMs = ElapsedMs;
+            RetryConnections =
+                Counters[QUIC_PERF_COUNTER_CONN_CREATED] -
+                CountersStart[QUIC_PERF_COUNTER_CONN_CREATED];
+            RetryHandshakeMemory = Usage.Handshakes;
+        }
+    } while (ElapsedMs < TimeoutMs);
+
+    WaitAttackThreads(Contexts, ThreadCount);
+    uint64_t AttackCpuUs = GetProcessCpuTimeUs() - AttackCpuStart;
+    uint64_t AttackUs = QuicTimeDiff64(AttackStart, QuicTimeUs64());
+    BenchGetPerfCounters(MsQuic, Counters);
+
+    Bench->PingStop = true;
+    QuicThreadWait(&PingThread);
+    QuicThreadDelete(&PingThread);
+
+    uint64_t InitialCount = 0, JunkCount = 0, GeneratorCpuUs = 0;
+    for (uint32_t i = 0; i < ThreadCount; ++i) {
+        if (Contexts[i].Type == 4) {
+            InitialCount += Contexts[i].PacketCount;
+        } else {
+            JunkCount += Contexts[i].PacketCount;
+        }
+        GeneratorCpuUs += Contexts[i].CpuTimeUs;
+    }
+
+    //
+    // The server's CPU is what the process used, less the generator threads'
+    // and the baseline's (scaled to the attack's duration). The generator's
+    // receive path, which drops the server's responses, is still included.
+    //
+    uint64_t OtherCpuUs =
+        GeneratorCpuUs + (BaselineUs == 0 ? 0 : (BaselineCpuUs * AttackUs) / BaselineUs);
+    uint64_t ServerCpuUs = AttackCpuUs > OtherCpuUs ? AttackCpuUs - OtherCpuUs : 0;
+    int64_t Handshakes =
+        Counters[QUIC_PERF_COUNTER_CONN_CREATED] -
+        CountersStart[QUIC_PERF_COUNTER_CONN_CREATED];
+
+    printf("\nAttack: %llu ms, %llu valid Initials, %llu junk packets sent.\n",
+        US_TO_MS(AttackUs), InitialCount, JunkCount);
+    printf("Server: %lld connections created, %lld handshake failures, %lld retries sent, %lld binding drops, %lld connection drops, %lld decryption failures.\n",
+        Handshakes,
+        Counters[QUIC_PERF_COUNTER_CONN_HANDSHAKE_FAIL] - CountersStart[QUIC_PERF_COUNTER_CONN_HANDSHAKE_FAIL],
+        Counters[QUIC_PERF_COUNTER_RETRY_SENT] - CountersStart[QUIC_PERF_COUNTER_RETRY_SENT],
+        Counters[QUIC_PERF_COUNTER_PKTS_DROPPED_BINDING] - CountersStart[QUIC_PERF_COUNTER_PKTS_DROPPED_BINDING],
+        Counters[QUIC_PERF_COUNTER_PKTS_DROPPED_CONN] - CountersStart[QUIC_PERF_COUNTER_PKTS_DROPPED_CONN],
+        Counters[QUIC_PERF_COUNTER_PKTS_DECRYPTION_FAIL] - CountersStart[QUIC_PERF_COUNTER_PKTS_DECRYPTION_FAIL]);
+    printf("Server CPU: %llu ms (%llu%% of a core, baseline %llu%%)",
+        US_TO_MS(ServerCpuUs),
+        AttackUs == 0 ? 0 : (ServerCpuUs * 100) / AttackUs,
+        BaselineUs == 0 ? 0 : (BaselineCpuUs * 100) / BaselineUs);
+    if (Handshakes > 0) {
+        printf(", %llu us per handshake.\n", ServerCpuUs / (uint64_t)Handshakes);
+    } else {
+        printf(", no handshakes.\n");
+    }
+
+    printf("Retry memory limit: %u/65535 of %llu bytes (%llu bytes). Peak handshake memory %llu bytes.\n",
+        RetryMemoryLimit,
+        QuicTotalMemory,
+        (RetryMemoryLimit * QuicTotalMemory) / UINT16_MAX,
+        MaxHandshakeMemory);
+    if (RetryTimeMs != UINT64_MAX) {
+        printf("Retries started after %llu ms, %lld connections, at %llu bytes of handshake memory.\n",
+            RetryTimeMs, RetryConnections, RetryHandshakeMemory);
+    } else {
+        printf("Retries were not triggered.\n");
+    }
+
+    BenchPrintLatency("Baseline", Bench->Latencies[BENCH_PHASE_BASELINE], Bench->PingFailures[BENCH_PHASE_BASELINE]);
+    BenchPrintLatency("Attack", Bench->Latencies[BENCH_PHASE_ATTACK], Bench->PingFailures[BENCH_PHASE_ATTACK]);
+}
+
+void
+RunBench(
+    uint16_t Port,
+    _In_z_ const char* Alpn,
+    uint32_t ThreadCount,
+    uint64_t TimeoutMs,
+    uint32_t Rate,
+    uint32_t JunkRate,
+    uint32_t JunkType,
+    bool SetRetryMemoryLimit,
+    uint16_t RetryMemoryLimit,
+    uint64_t BaselineMs,
+    uint32_t PingIntervalMs
+    )
+{
+    QUIC_STATUS Status;
+    BENCH_CONTEXT Bench;
+    HQUIC Registration = nullptr;
+    QUIC_SEC_CONFIG_PARAMS* SelfSignedCertParams = nullptr;
+    HQUIC ServerSession = nullptr;
+    HQUIC Listener = nullptr;
+    HQUIC ClientSession = nullptr;
+    QUIC_DATAPATH* Datapath = nullptr;
+    QUIC_DATAPATH_BINDING* Binding = nullptr;
+    QUIC_ADDR ServerAddress = {0};
+    const QUIC_BUFFER AlpnBuffer = { (uint32_t)strlen(Alpn), (uint8_t*)Alpn };
+    const QUIC_REGISTRATION_CONFIG RegConfig = { "quicattack", QUIC_EXECUTION_PROFILE_LOW_LATENCY };
+    uint16_t PeerStreamCount = 100;
+    uint32_t SecFlags = QUIC_CERTIFICATE_FLAG_DISABLE_CERT_VALIDATION;
+
+    Bench.MsQuic = nullptr;
+    Bench.SecConfig = nullptr;
+    Bench.ClientConnection = nullptr;
+    Bench.IsClientConnected = false;
+    Bench.PingIntervalMs = PingIntervalMs;
+    Bench.PingStop = false;
+    Bench.PingPhase = BENCH_PHASE_BASELINE;
+    Bench.PingFailures[BENCH_PHASE_BASELINE] = 0;
+    Bench.PingFailures[BENCH_PHASE_ATTACK] = 0;
+    QuicEventInitialize(&Bench.ClientConnected, TRUE, FALSE);
+
+    if (QUIC_FAILED(Status = MsQuicOpen(&Bench.MsQuic))) {
+        printf("MsQuicOpen failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    if (SetRetryMemoryLimit &&
+        QUIC_FAILED(
+        Status =
+            Bench.MsQuic->SetParam(
+                nullptr,
+                QUIC_PARAM_LEVEL_GLOBAL,
+                QUIC_PARAM_GLOBAL_RETRY_MEMORY_PERCENT,
+                sizeof(RetryMemoryLimit),
+                &RetryMemoryLimit))) {
+        printf("SetParam(QUIC_PARAM_GLOBAL_RETRY_MEMORY_PERCENT) failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    if (QUIC_FAILED(Status = Bench.MsQuic->RegistrationOpen(&RegConfig, &Registration))) {
+        printf("RegistrationOpen failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    SelfSignedCertParams = QuicPlatGetSelfSignedCert(QUIC_SELF_SIGN_CERT_USER);
+    if (SelfSignedCertParams == nullptr) {
+        printf("QuicPlatGetSelfSignedCert failed\n");
+        goto Error;
+    }
+
+    Bench.SecConfig = GetSecConfigForSelfSigned(Bench.MsQuic, Registration, SelfSignedCertParams);
+    if (Bench.SecConfig == nullptr) {
+        printf("GetSecConfigForSelfSigned failed\n");
+        goto Error;
+    }
+
+    //
+    // The server.
+    //
+    if (QUIC_FAILED(
+        Status = Bench.MsQuic->SessionOpen(Registration, &AlpnBuffer, 1, nullptr, &ServerSession))) {
+        printf("SessionOpen failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    if (QUIC_FAILED(
+        Status =
+            Bench.MsQuic->SetParam(
+                ServerSession,
+                QUIC_PARAM_LEVEL_SESSION,
+                QUIC_PARAM_SESSION_PEER_BIDI_STREAM_COUNT,
+                sizeof(PeerStreamCount),
+                &PeerStreamCount))) {
+        printf("SetParam(QUIC_PARAM_SESSION_PEER_BIDI_STREAM_COUNT) failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    if (QUIC_FAILED(
+        Status = Bench.MsQuic->ListenerOpen(ServerSession, BenchListenerCallback, &Bench, &Listener))) {
+        printf("ListenerOpen failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    QuicAddrSetFamily(&ServerAddress, AF_INET);
+    QuicAddrSetPort(&ServerAddress, Port);
+    if (QUIC_FAILED(Status = Bench.MsQuic->ListenerStart(Listener, &ServerAddress))) {
+        printf("ListenerStart failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    //
+    // The ping workload's connection.
+    //
+    if (QUIC_FAILED(
+        Status = Bench.MsQuic->SessionOpen(Registration, &AlpnBuffer, 1, nullptr, &ClientSession))) {
+        printf("SessionOpen failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    if (QUIC_FAILED(
+        Status =
+            Bench.MsQuic->ConnectionOpen(
+                ClientSession,
+                BenchClientConnectionCallback,
+                &Bench,
+                &Bench.ClientConnection))) {
+        printf("ConnectionOpen failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    if (QUIC_FAILED(
+        Status =
+            Bench.MsQuic->SetParam(
+                Bench.ClientConnection,
+                QUIC_PARAM_LEVEL_CONNECTION,
+                QUIC_PARAM_CONN_CERT_VALIDATION_FLAGS,
+                sizeof(SecFlags),
+                &SecFlags))) {
+        printf("SetParam(QUIC_PARAM_CONN_CERT_VALIDATION_FLAGS) failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    if (QUIC_FAILED(
+        Status = Bench.MsQuic->ConnectionStart(Bench.ClientConnection, AF_INET, "localhost", Port))) {
+        printf("ConnectionStart failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    if (!QuicEventWaitWithTimeout(Bench.ClientConnected, BENCH_PING_TIMEOUT_MS) ||
+        !Bench.IsClientConnected) {
+        printf("The ping connection failed to connect\n");
+        goto Error;
+    }
+
+    //
+    // The attack traffic, sent to the server's loopback address.
+    //
+    if (QUIC_FAILED(
+        Status =
+            QuicDataPathInitialize(
+                0,
+                UdpRecvCallback,
+                UdpUnreachCallback,
+                &Datapath))) {
+        printf("QuicDataPathInitialize failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    if (!ConvertArgToAddress("127.0.0.1", Port, &ServerAddress)) {
+        goto Error;
+    }
+
+    if (QUIC_FAILED(
+        Status =
+            QuicDataPathBindingCreate(
+                Datapath,
+                nullptr,
+                &ServerAddress,
+                nullptr,
+                &Binding))) {
+        printf("QuicDataPathBindingCreate failed, 0x%x\n", Status);
+        goto Error;
+    }
+
+    {
+        uint32_t ContextCount = ThreadCount + (JunkRate != 0 ? 1 : 0);
+        ATTACK_THREAD_CONTEXT* Contexts = new ATTACK_THREAD_CONTEXT[ContextCount];
         for (uint32_t i = 0; i < ThreadCount; ++i) {
-            QuicThreadWait(&Threads[i]);
-            QuicThreadDelete(&Threads[i]);
+            Contexts[i] = {
+                Binding, 4, &ServerAddress, Alpn, "localhost", TimeoutMs, Rate
+            };
+        }
+        if (JunkRate != 0) {
+            Contexts[ThreadCount] = {
+                Binding, JunkType, &ServerAddress, Alpn, nullptr, TimeoutMs, JunkRate
+            };
         }
+        RunBenchMeasure(&Bench, Contexts, ContextCount, TimeoutMs, BaselineMs);
+        delete [] Contexts;
     }
 
 Error:
@@ -379,10 +1145,35 @@ Error:
     if (Binding != nullptr) {
         QuicDataPathBindingDelete(Binding);
     }
-
     if (Datapath != nullptr) {
         QuicDataPathUninitialize(Datapath);
     }
+    if (Bench.ClientConnection != nullptr) {
+        Bench.MsQuic->ConnectionClose(Bench.ClientConnection);
+    }
+    if (ClientSession != nullptr) {
+        Bench.MsQuic->SessionClose(ClientSession);
+    }
+    if (Listener != nullptr) {
+        Bench.MsQuic->ListenerClose(Listener);
+    }
+    if (ServerSession != nullptr) {
+        Bench.MsQuic->SessionShutdown(ServerSession, QUIC_CONNECTION_SHUTDOWN_FLAG_SILENT, 0);
+        Bench.MsQuic->SessionClose(ServerSession);
+    }
+    if (Bench.SecConfig != nullptr) {
+        Bench.MsQuic->SecConfigDelete(Bench.SecConfig);
+    }
+    if (SelfSignedCertParams != nullptr) {
+        QuicPlatFreeSelfSignedCert(SelfSignedCertParams);
+    }
+    if (Registration != nullptr) {
+        Bench.MsQuic->RegistrationClose(Registration);
+    }
+    if (Bench.MsQuic != nullptr) {
+        MsQuicClose(Bench.MsQuic);
+    }
+    QuicEventUninitialize(Bench.ClientConnected);
 }
 
 int
@@ -406,6 +1197,46 @@ main(
         PrintUsageList();
         ErrorCode = 0;
 
+    } else if (strcmp("-bench", argv[1]) == 0) {
+        uint16_t Port = BENCH_PORT_DEFAULT;
+        (void)TryGetValue(argc, argv, "port", &Port);
+
+        const char* Alpn = "h3-25";
+        (void)TryGetValue(argc, argv, "alpn", &Alpn);
+
+        uint64_t TimeoutMs = ATTACK_TIMEOUT_DEFAULT_MS;
+        (void)TryGetValue(argc, argv, "timeout", &TimeoutMs);
+
+        uint32_t ThreadCount = ATTACK_THREADS_DEFAULT;
+        (void)TryGetValue(argc, argv, "threads", &ThreadCount);
+
+        uint32_t Rate = 0;
+        (void)TryGetValue(argc, argv, "rate", &Rate);
+
+        uint32_t JunkRate = 0;
+        (void)TryGetValue(argc, argv, "junk", &JunkRate);
+
+        uint32_t JunkType = 3;
+        (void)TryGetValue(argc, argv, "junktype", &JunkType);
+        if (JunkType < 1 || JunkType > 3) {
+            printf("Invalid -junktype:'%d' specified!\n", JunkType);
+            goto Error;
+        }
+
+        uint16_t RetryMemoryLimit = 0;
+        bool SetRetryMemoryLimit = TryGetValue(argc, argv, "retry", &RetryMemoryLimit);
+
+        uint64_t BaselineMs = BENCH_BASELINE_DEFAULT_MS;
+        (void)TryGetValue(argc, argv, "baseline", &BaselineMs);
+
+        uint32_t PingIntervalMs = BENCH_PING_INTERVAL_DEFAULT_MS;
+        (void)TryGetValue(argc, argv, "interval", &PingIntervalMs);
+
+        RunBench(
+            Port, Alpn, ThreadCount, TimeoutMs, Rate, JunkRate, JunkType,
+            SetRetryMemoryLimit, RetryMemoryLimit, BaselineMs, PingIntervalMs);
+        ErrorCode = 0;
+
     } else {
         uint32_t Type;
         const char* IpAddress;
@@ -432,6 +1263,9 @@ main(
         uint32_t ThreadCount = ATTACK_THREADS_DEFAULT;
         (void)TryGetValue(argc, argv, "threads", &ThreadCount);
 
+        uint32_t Rate = 0;
+        (void)TryGetValue(argc, argv, "rate", &Rate);
+
         QUIC_ADDR TargetAddress = {0};
         if (!ConvertArgToAddress(IpAddress, ATTACK_PORT_DEFAULT, &TargetAddress)) {
             printf("Invalid -ip:'%s' specified! Must be IPv4 or IPv6 address and port.\n", IpAddress);
@@ -443,7 +1277,7 @@ main(
             goto Error;
         }
 
-        RunAttack(ThreadCount, Type, &TargetAddress, Alpn, ServerName, TimeoutMs);
+        RunAttack(ThreadCount, Type, &TargetAddress, Alpn, ServerName, TimeoutMs, Rate);
         ErrorCode = 0;
     }
 
@@ -222,18 +222,18 @@ EXT_COMMAND(
     Dml("\tOutstanding Packets  ");
 
     auto Loss = Conn.GetLossDetection();
-    auto SendPackets = Loss.GetSendPackets();
+    auto SendPackets = SentPacketRing(Loss.GetSendPackets());
 
-    if (SendPackets == 0) {
+    if (SendPackets.LiveCount() == 0) {
         Dml("NONE\n");
     } else {
-        while (SendPackets && !CheckControlC()) {
-            auto Packet = SentPacketMetadata(SendPackets);
+        ULONG64 PacketAddr;
+        while (SendPackets.GetNextPacket(&PacketAddr) && !CheckControlC()) {
+            auto Packet = SentPacketMetadata(PacketAddr);
             Dml("<link cmd=\"!quicpacket 0x%I64X\">%I64u</link>\n"
                 "\t                     ",
                 Packet.Addr,
                 Packet.PacketNumber());
-            SendPackets = Packet.Next();
         }
         Dml("\n");
     }
@@ -48,18 +48,20 @@ EXT_COMMAND(
                 Session.Addr,
                 Session.GetAlpns().Data);
 
-            auto Connections = Session.GetConnections();
-            while (!CheckControlC()) {
-                ULONG64 ConnAddr = Connections.Next();
-                if (ConnAddr == 0) {
-                    break;
-                }
+            for (UCHAR i = 0; i < Session::ConnectionShardCount; ++i) {
+                auto Connections = Session.GetConnections(i);
+                while (!CheckControlC()) {
+                    ULONG64 ConnAddr = Connections.Next();
+                    if (ConnAddr == 0) {
+                        break;
+                    }
 
-                auto Connection = Connection::FromSessionLink(ConnAddr);
-                Dml("    <link cmd=\"!quicconnection 0x%I64X\">Conn 0x%I64X</link>    %s\n",
-                    Connection.Addr,
-                    Connection.Addr,
-                    Connection.TypeStr());
+                    auto Connection = Connection::FromSessionLink(ConnAddr);
+                    Dml("    <link cmd=\"!quicconnection 0x%I64X\">Conn 0x%I64X</link>    %s\n",
+                        Connection.Addr,
+                        Connection.Addr,
+                        Connection.TypeStr());
+                }
             }
         }
     }
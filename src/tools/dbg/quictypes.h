@@ -58,6 +58,8 @@ typedef union QUIC_STREAM_FLAGS {
         BOOLEAN ReceiveFlushQueued      : 1;    // The receive flush operation is queued.
         BOOLEAN ReceiveDataPending      : 1;    // Data (or FIN) is queued and ready for delivery.
         BOOLEAN ReceiveCallPending      : 1;    // There is an uncompleted receive to the app.
+        BOOLEAN ReceiveCallActive       : 1;    // The app is in the receive callback.
+        BOOLEAN ReceiveCompletedInline  : 1;    // The app completed the receive in the callback.
 
         BOOLEAN HandleSendShutdown      : 1;    // Send shutdown complete callback delivered.
         BOOLEAN HandleShutdown          : 1;    // Shutdown callback delivered.
@@ -350,6 +352,44 @@ struct HashTable : Struct {
 
 // End of magic
 
+struct CidTable : Struct {
+
+    ULONG Capacity;
+    ULONG64 Control;
+    ULONG64 Slots;
+    ULONG SlotSize;
+    ULONG EntryOffset;
+    ULONG Index;
+
+    CidTable(ULONG64 addr) : Struct("msquic!QUIC_CID_TABLE", addr) {
+        Capacity = ReadType<ULONG>("Capacity");
+        Control = ReadPointer("Control");
+        Slots = ReadPointer("Slots");
+        SlotSize = GetTypeSize("msquic!QUIC_CID_TABLE_SLOT");
+        GetFieldOffset("msquic!QUIC_CID_TABLE_SLOT", "Entry", &EntryOffset);
+        Index = 0;
+    }
+
+    ULONG NumEntries() {
+        return ReadType<ULONG>("NumEntries");
+    }
+
+    bool GetNextEntry(ULONG64* EntryAddress) {
+        for (; Index < Capacity; Index++) {
+            UCHAR ControlByte;
+            if (!ReadTypeAtAddr(Control + Index, &ControlByte)) {
+                return false;
+            }
+            if ((ControlByte & 0x80) == 0) { // Not empty or deleted.
+                ULONG64 SlotAddr = Slots + Index * SlotSize;
+                Index++;
+                return ReadPointerAtAddr(SlotAddr + EntryOffset, EntryAddress);
+            }
+        }
+        return false;
+    }
+};
+
 inline char QuicHalfByteToStr(UCHAR b)
 {
     return b < 10 ? ('0' + b) : ('A' + b - 10);
@@ -394,10 +434,6 @@ struct CidHashEntry : Struct {
 
     CidHashEntry(ULONG64 Addr) : Struct("msquic!QUIC_CID_HASH_ENTRY", Addr) { }
 
-    static CidHashEntry FromEntry(ULONG64 EntryAddr) {
-        return CidHashEntry(LinkEntryToType(EntryAddr, "msquic!QUIC_CID_HASH_ENTRY", "Entry"));
-    }
-
     static CidHashEntry FromLink(ULONG64 LinkAddr) {
         return CidHashEntry(LinkEntryToType(LinkAddr, "msquic!QUIC_CID_HASH_ENTRY", "Link"));
     }
@@ -870,6 +906,45 @@ struct SentPacketMetadata : Struct {
     }
 };
 
+struct SentPacketRing : Struct {
+
+    ULONG64 Headers;
+    ULONG Capacity;
+    ULONG Head;
+    ULONG Count;
+    ULONG HeaderSize;
+    ULONG MetadataOffset;
+    ULONG Index;
+
+    SentPacketRing(ULONG64 addr) : Struct("msquic!QUIC_SENT_PACKET_RING", addr) {
+        Headers = ReadPointer("Headers");
+        Capacity = ReadType<ULONG>("Capacity");
+        Head = ReadType<ULONG>("Head");
+        Count = ReadType<ULONG>("Count");
+        HeaderSize = GetTypeSize("msquic!QUIC_SENT_PACKET_HEADER");
+        GetFieldOffset("msquic!QUIC_SENT_PACKET_HEADER", "Metadata", &MetadataOffset);
+        Index = 0;
+    }
+
+    ULONG LiveCount() {
+        return ReadType<ULONG>("LiveCount");
+    }
+
+    bool GetNextPacket(ULONG64* MetadataAddress) {
+        while (Index < Count) {
+            ULONG64 HeaderAddr = Headers + ((Head + Index) & (Capacity - 1)) * HeaderSize;
+            Index++;
+            if (!ReadPointerAtAddr(HeaderAddr + MetadataOffset, MetadataAddress)) {
+                return false;
+            }
+            if (*MetadataAddress != 0) { // Not removed.
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
 struct LossDetection : Struct {
 
     LossDetection(ULONG64 Addr) : Struct("msquic!QUIC_LOSS_DETECTION", Addr) { }
@@ -883,7 +958,7 @@ struct LossDetection : Struct {
     }
 
     ULONG64 GetSendPackets() {
-        return ReadPointer("SentPackets");
+        return AddrOf("SentPackets");
     }
 
     ULONG64 GetLostPackets() {
@@ -963,6 +1038,7 @@ typedef enum QUIC_OPERATION_TYPE {
     QUIC_OPER_TYPE_TLS_COMPLETE,        // A TLS process call completed.
     QUIC_OPER_TYPE_TIMER_EXPIRED,       // A timer expired.
     QUIC_OPER_TYPE_TRACE_RUNDOWN,       // A trace rundown was triggered.
+    QUIC_OPER_TYPE_GENERATE_KEYS,       // Generate the next 1-RTT keys.
 
     //
     // All stateless operations follow.
@@ -1004,6 +1080,8 @@ struct Operation : Struct {
             return "TIMER_EXPIRED"; // TODO - Timer details.
         case QUIC_OPER_TYPE_TRACE_RUNDOWN:
             return "TRACE_RUNDOWN";
+        case QUIC_OPER_TYPE_GENERATE_KEYS:
+            return "GENERATE_KEYS";
         case QUIC_OPER_TYPE_VERSION_NEGOTIATION:
             return "VERSION_NEGOTIATION";
         case QUIC_OPER_TYPE_STATELESS_RESET:
@@ -1230,8 +1308,17 @@ struct Session : Struct {
         return ReadPointer("Registration");
     }
 
-    LinkedList GetConnections() {
-        return LinkedList(AddrOf("Connections"));
+    //
+    // Must match QUIC_SESSION_CONNECTION_SHARD_COUNT.
+    //
+    static const UCHAR ConnectionShardCount = 16;
+
+    LinkedList GetConnections(UCHAR Index) {
+        ULONG64 ArrayAddr = AddrOf("Connections");
+        ULONG TypeSize = GetTypeSize("msquic!QUIC_SESSION_CONNECTIONS");
+        ULONG ListOffset = 0;
+        GetFieldOffset("msquic!QUIC_SESSION_CONNECTIONS", "List", &ListOffset);
+        return LinkedList(ArrayAddr + Index * TypeSize + ListOffset);
     }
 
     ULONG64 GetRawAlpnList() {
@@ -1294,7 +1381,7 @@ struct LookupHashTable : Struct {
     LookupHashTable(ULONG64 Addr) : Struct("msquic!QUIC_PARTITIONED_HASHTABLE", Addr) { }
 
     ULONG64 GetTablePtr() {
-        return AddrOf("Table"); // TODO - Need Hash Table Enumeration.
+        return AddrOf("Table");
     }
 };
 
@@ -33,18 +33,20 @@ EXT_COMMAND(
         "\n");
 
     bool HasAtLeastOne = false;
-    auto Connections = Session.GetConnections();
-    while (true) {
-        ULONG64 LinkAddr = Connections.Next();
-        if (LinkAddr == 0) {
-            break;
+    for (UCHAR i = 0; i < Session::ConnectionShardCount; ++i) {
+        auto Connections = Session.GetConnections(i);
+        while (true) {
+            ULONG64 LinkAddr = Connections.Next();
+            if (LinkAddr == 0) {
+                break;
+            }
+
+            auto Connection = Connection::FromSessionLink(LinkAddr);
+            Dml("\t<link cmd=\"!quicconnection 0x%I64X\">0x%I64X</link>\n",
+                Connection.Addr,
+                Connection.Addr);
+            HasAtLeastOne = true;
         }
-
-        auto Connection = Connection::FromSessionLink(LinkAddr);
-        Dml("\t<link cmd=\"!quicconnection 0x%I64X\">0x%I64X</link>\n",
-            Connection.Addr,
-            Connection.Addr);
-        HasAtLeastOne = true;
     }
 
     if (!HasAtLeastOne) {
@@ -0,0 +1,402 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    Streaming, multi-threaded per-connection summaries (--conn_summary).
+
+    Instead of building the full object sets, the trace callback copies the
+    few fields of each connection event that the summaries need into a small
+    record and queues it to one of several partitions, picked by hashing the
+    connection pointer. So all the events of a connection are processed, in
+    order, by the same partition thread. Each partition only keeps the state
+    of the connections that are still alive, and prints (then frees) a
+    connection's summary as soon as it is destroyed. The queues are bounded,
+    so the trace callback waits for a partition that falls behind. Memory is
+    then bounded by the number of connections alive at once, not by the size
+    of the trace.
+
+--*/
+
+#include "quicetw.h"
+
+#define CXN_SUMMARY_MAX_PARTITIONS  64
+#define CXN_SUMMARY_QUEUE_SIZE      4096
+
+//
+// The fields of a connection event used by the summaries.
+//
+typedef struct CXN_SUMMARY_EVENT {
+    ULONG64 CxnPtr;
+    ULONG64 TimeStamp; // 100ns
+    USHORT EventId;
+    union {
+        UINT32 ScheduleState;
+        struct {
+            UINT64 BytesSent;
+            UINT32 SmoothedRtt;
+        } OutFlowStats;
+        UINT64 BytesRecv;
+    };
+} CXN_SUMMARY_EVENT;
+
+typedef struct CXN_SUMMARY {
+    QUIC_HASHTABLE_ENTRY Entry;
+    ULONG64 Ptr;
+
+    ULONG64 InitialTimestamp; // 100ns
+    ULONG64 FinalTimestamp; // 100ns
+
+    ULONG64 BytesSent;
+    ULONG64 BytesReceived;
+
+    ULONG RttCount;
+    ULONG MinRtt; // usec
+    ULONG MaxRtt; // usec
+    ULONG64 TotalRtt; // usec
+
+    ULONG CongestionEvents;
+    ULONG PersistentCongestionEvents;
+
+    QUIC_SCHEDULE_STATE ScheduleState;
+    ULONG64 ScheduleStateTimestamp; // 100ns
+    QUIC_TIME_STATS QueueDelay;
+} CXN_SUMMARY;
+
+typedef struct CXN_SUMMARY_PARTITION {
+    HANDLE Thread;
+
+    SRWLOCK Lock;
+    CONDITION_VARIABLE NotEmpty;
+    CONDITION_VARIABLE NotFull;
+    ULONG Head;
+    ULONG Count;
+    BOOLEAN Stopping;
+    CXN_SUMMARY_EVENT Events[CXN_SUMMARY_QUEUE_SIZE];
+
+    //
+    // Only accessed by the partition's thread.
+    //
+    QUIC_HASHTABLE* Cxns;
+    ULONG64 CxnCount;
+} CXN_SUMMARY_PARTITION;
+
+CXN_SUMMARY_PARTITION* CxnSummaryPartitions;
+ULONG CxnSummaryPartitionCount;
+
+//
+// Serializes the output lines of the partitions.
+//
+SRWLOCK CxnSummaryOutputLock = SRWLOCK_INIT;
+
+void
+CxnSummaryOutput(
+    _In_ const CXN_SUMMARY* Cxn
+    )
+{
+    ULONG64 AgeUs = NS100_TO_US(Cxn->FinalTimestamp - Cxn->InitialTimestamp);
+    ULONG64 TxKbps = AgeUs == 0 ? 0 : (Cxn->BytesSent * 8 * 1000) / AgeUs;
+    ULONG64 RxKbps = AgeUs == 0 ? 0 : (Cxn->BytesReceived * 8 * 1000) / AgeUs;
+    ULONG AvgRtt = Cxn->RttCount == 0 ? 0 : (ULONG)(Cxn->TotalRtt / Cxn->RttCount);
+    ULONG MinRtt = Cxn->RttCount == 0 ? 0 : Cxn->MinRtt;
+
+    AcquireSRWLockExclusive(&CxnSummaryOutputLock);
+    if (Cmd.FormatCSV) {
+        printf("%llX,%llu,%llu,%llu,%llu,%llu,%llu,%u,%u,%u,%u,%u,%u,%u\n",
+            Cxn->Ptr,
+            NS100_TO_US(Cxn->InitialTimestamp - Trace.StartTimestamp),
+            AgeUs,
+            Cxn->BytesSent,
+            Cxn->BytesReceived,
+            TxKbps,
+            RxKbps,
+            MinRtt,
+            AvgRtt,
+            Cxn->MaxRtt,
+            Cxn->CongestionEvents,
+            Cxn->PersistentCongestionEvents,
+            AvgCpuTime(&Cxn->QueueDelay),
+            Cxn->QueueDelay.Count == 0 ? 0 : Cxn->QueueDelay.MaxCpuTime);
+    } else {
+        printf(
+            "[%llX] Age %llu us, TX %llu B (%llu kbps), RX %llu B (%llu kbps), "
+            "RTT %u/%u/%u us, Congestion %u (%u persistent), "
+            "Queue delay avg %u us max %u us\n",
+            Cxn->Ptr,
+            AgeUs,
+            Cxn->BytesSent,
+            TxKbps,
+            Cxn->BytesReceived,
+            RxKbps,
+            MinRtt,
+            AvgRtt,
+            Cxn->MaxRtt,
+            Cxn->CongestionEvents,
+            Cxn->PersistentCongestionEvents,
+            AvgCpuTime(&Cxn->QueueDelay),
+            Cxn->QueueDelay.Count == 0 ? 0 : Cxn->QueueDelay.MaxCpuTime);
+    }
+    ReleaseSRWLockExclusive(&CxnSummaryOutputLock);
+}
+
+CXN_SUMMARY*
+CxnSummaryGet(
+    _In_ CXN_SUMMARY_PARTITION* Partition,
+    _In_ const CXN_SUMMARY_EVENT* Event
+    )
+{
+    QUIC_HASHTABLE_LOOKUP_CONTEXT Ctx;
+    QUIC_HASHTABLE_ENTRY* Entry =
+        QuicHashtableLookup(Partition->Cxns, HashPtr(Event->CxnPtr), &Ctx);
+    while (Entry != NULL) {
+        CXN_SUMMARY* Cxn = CONTAINING_RECORD(Entry, CXN_SUMMARY, Entry);
+        if (Cxn->Ptr == Event->CxnPtr) {
+            return Cxn;
+        }
+        Entry = QuicHashtableLookupNext(Partition->Cxns, &Ctx);
+    }
+
+    CXN_SUMMARY* Cxn = malloc(sizeof(CXN_SUMMARY));
+    if (Cxn == NULL) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    memset(Cxn, 0, sizeof(*Cxn));
+    Cxn->Ptr = Event->CxnPtr;
+    Cxn->InitialTimestamp = Event->TimeStamp;
+    Cxn->MinRtt = ULONG_MAX;
+    InitCpuTime(&Cxn->QueueDelay);
+    QuicHashtableInsert(Partition->Cxns, &Cxn->Entry, HashPtr(Cxn->Ptr), NULL);
+    Partition->CxnCount++;
+    return Cxn;
+}
+
+void
+CxnSummaryComplete(
+    _In_ CXN_SUMMARY_PARTITION* Partition,
+    _In_ CXN_SUMMARY* Cxn
+    )
+{
+    QuicHashtableRemove(Partition->Cxns, &Cxn->Entry, NULL);
+    CxnSummaryOutput(Cxn);
+    free(Cxn);
+}
+
+void
+CxnSummaryProcessEvent(
+    _In_ CXN_SUMMARY_PARTITION* Partition,
+    _In_ const CXN_SUMMARY_EVENT* Event
+    )
+{
+    CXN_SUMMARY* Cxn = CxnSummaryGet(Partition, Event);
+    Cxn->FinalTimestamp = Event->TimeStamp;
+
+    switch (Event->EventId) {
+    case EventId_QuicConnScheduleState:
+        if (Cxn->ScheduleStateTimestamp != 0 &&
+            Cxn->ScheduleState == QUIC_SCHEDULE_QUEUED &&
+            Event->ScheduleState == QUIC_SCHEDULE_PROCESSING) {
+            AddCpuTime(
+                &Cxn->QueueDelay,
+                NS100_TO_US(Event->TimeStamp - Cxn->ScheduleStateTimestamp));
+        }
+        Cxn->ScheduleStateTimestamp = Event->TimeStamp;
+        Cxn->ScheduleState = (QUIC_SCHEDULE_STATE)Event->ScheduleState;
+        break;
+    case EventId_QuicConnOutFlowStats:
+        Cxn->BytesSent = Event->OutFlowStats.BytesSent;
+        if (Event->OutFlowStats.SmoothedRtt != 0) {
+            Cxn->RttCount++;
+            Cxn->TotalRtt += Event->OutFlowStats.SmoothedRtt;
+            if (Event->OutFlowStats.SmoothedRtt < Cxn->MinRtt) {
+                Cxn->MinRtt = Event->OutFlowStats.SmoothedRtt;
+            }
+            if (Event->OutFlowStats.SmoothedRtt > Cxn->MaxRtt) {
+                Cxn->MaxRtt = Event->OutFlowStats.SmoothedRtt;
+            }
+        }
+        break;
+    case EventId_QuicConnInFlowStats:
+        Cxn->BytesReceived = Event->BytesRecv;
+        break;
+    case EventId_QuicConnCongestion:
+        Cxn->CongestionEvents++;
+        break;
+    case EventId_QuicConnPersistentCongestion:
+        Cxn->PersistentCongestionEvents++;
+        break;
+    case EventId_QuicConnDestroyed:
+        CxnSummaryComplete(Partition, Cxn);
+        break;
+    default:
+        break;
+    }
+}
+
+DWORD
+WINAPI
+CxnSummaryPartitionThread(
+    _In_ LPVOID Context
+    )
+{
+    CXN_SUMMARY_PARTITION* Partition = (CXN_SUMMARY_PARTITION*)Context;
+    CXN_SUMMARY_EVENT Events[64];
+
+    for (;;) {
+        //
+        // Take events out in chunks, to process them without holding the lock.
+        //
+        AcquireSRWLockExclusive(&Partition->Lock);
+        while (Partition->Count == 0 && !Partition->Stopping) {
+            SleepConditionVariableSRW(&Partition->NotEmpty, &Partition->Lock, INFINITE, 0);
+        }
+        ULONG Count = 0;
+        while (Partition->Count != 0 && Count < ARRAYSIZE(Events)) {
+            Events[Count++] = Partition->Events[Partition->Head];
+            Partition->Head = (Partition->Head + 1) % CXN_SUMMARY_QUEUE_SIZE;
+            Partition->Count--;
+        }
+        ReleaseSRWLockExclusive(&Partition->Lock);
+
+        if (Count == 0) {
+            break; // Stopping and drained.
+        }
+        WakeConditionVariable(&Partition->NotFull);
+
+        for (ULONG i = 0; i < Count; ++i) {
+            CxnSummaryProcessEvent(Partition, &Events[i]);
+        }
+    }
+
+    //
+    // Output the connections still alive at the end of the trace.
+    //
+    QUIC_HASHTABLE_ENUMERATOR Enumerator;
+    QuicHashtableEnumerateBegin(Partition->Cxns, &Enumerator);
+    for (;;) {
+        QUIC_HASHTABLE_ENTRY* Entry =
+            QuicHashtableEnumerateNext(Partition->Cxns, &Enumerator);
+        if (Entry == NULL) {
+            QuicHashtableEnumerateEnd(Partition->Cxns, &Enumerator);
+            break;
+        }
+        CxnSummaryComplete(
+            Partition, CONTAINING_RECORD(Entry, CXN_SUMMARY, Entry));
+    }
+
+    return 0;
+}
+
+void
+CxnSummaryStart(
+    void
+    )
+{
+    ULONG PartitionCount = Cmd.ThreadCount;
+    if (PartitionCount == 0) {
+        PartitionCount = QuicProcActiveCount();
+    }
+    if (PartitionCount > CXN_SUMMARY_MAX_PARTITIONS) {
+        PartitionCount = CXN_SUMMARY_MAX_PARTITIONS;
+    }
+
+    CxnSummaryPartitions = malloc(PartitionCount * sizeof(CXN_SUMMARY_PARTITION));
+    if (CxnSummaryPartitions == NULL) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    memset(CxnSummaryPartitions, 0, PartitionCount * sizeof(CXN_SUMMARY_PARTITION));
+    CxnSummaryPartitionCount = PartitionCount;
+
+    for (ULONG i = 0; i < PartitionCount; ++i) {
+        CXN_SUMMARY_PARTITION* Partition = &CxnSummaryPartitions[i];
+        InitializeSRWLock(&Partition->Lock);
+        InitializeConditionVariable(&Partition->NotEmpty);
+        InitializeConditionVariable(&Partition->NotFull);
+        if (!QuicHashtableInitialize(&Partition->Cxns, 4096)) {
+            printf("QuicHashtableInitialize failed!\n");
+            exit(1);
+        }
+        Partition->Thread =
+            CreateThread(NULL, 0, CxnSummaryPartitionThread, Partition, 0, NULL);
+        if (Partition->Thread == NULL) {
+            printf("CreateThread failed with %u\n", GetLastError());
+            exit(1);
+        }
+    }
+}
+
+void
+CxnSummaryQueueEvent(
+    _In_ PEVENT_RECORD ev
+    )
+{
+    QUIC_EVENT_DATA_CONNECTION* EvData = (QUIC_EVENT_DATA_CONNECTION*)ev->UserData;
+
+    CXN_SUMMARY_EVENT Event;
+    Event.CxnPtr = EvData->CxnPtr;
+    Event.TimeStamp = ev->EventHeader.TimeStamp.QuadPart;
+    Event.EventId = GetEventId(ev->EventHeader.EventDescriptor.Id);
+
+    switch (Event.EventId) {
+    case EventId_QuicConnScheduleState:
+        Event.ScheduleState = EvData->ScheduleState.State;
+        break;
+    case EventId_QuicConnOutFlowStats:
+        Event.OutFlowStats.BytesSent = EvData->OutFlowStats.BytesSent;
+        Event.OutFlowStats.SmoothedRtt = EvData->OutFlowStats.SmoothedRtt;
+        break;
+    case EventId_QuicConnInFlowStats:
+        Event.BytesRecv = EvData->InFlowStats.BytesRecv;
+        break;
+    default:
+        break;
+    }
+
+    CXN_SUMMARY_PARTITION* Partition =
+        &CxnSummaryPartitions[HashPtr(Event.CxnPtr) % CxnSummaryPartitionCount];
+
+    AcquireSRWLockExclusive(&Partition->Lock);
+    while (Partition->Count == CXN_SUMMARY_QUEUE_SIZE) {
+        SleepConditionVariableSRW(&Partition->NotFull, &Partition->Lock, INFINITE, 0);
+    }
+    Partition->Events[(Partition->Head + Partition->Count) % CXN_SUMMARY_QUEUE_SIZE] = Event;
+    Partition->Count++;
+    ReleaseSRWLockExclusive(&Partition->Lock);
+    WakeConditionVariable(&Partition->NotEmpty);
+}
+
+void
+CxnSummaryStop(
+    void
+    )
+{
+    ULONG64 CxnCount = 0;
+
+    for (ULONG i = 0; i < CxnSummaryPartitionCount; ++i) {
+        CXN_SUMMARY_PARTITION* Partition = &CxnSummaryPartitions[i];
+        AcquireSRWLockExclusive(&Partition->Lock);
+        Partition->Stopping = TRUE;
+        ReleaseSRWLockExclusive(&Partition->Lock);
+        WakeConditionVariable(&Partition->NotEmpty);
+    }
+
+    for (ULONG i = 0; i < CxnSummaryPartitionCount; ++i) {
+        CXN_SUMMARY_PARTITION* Partition = &CxnSummaryPartitions[i];
+        WaitForSingleObject(Partition->Thread, INFINITE);
+        CloseHandle(Partition->Thread);
+        QuicHashtableUninitialize(Partition->Cxns);
+        CxnCount += Partition->CxnCount;
+    }
+
+    if (!Cmd.FormatCSV) {
+        printf("\n%llu connections summarized on %u threads.\n",
+            CxnCount, CxnSummaryPartitionCount);
+    }
+
+    free(CxnSummaryPartitions);
+    CxnSummaryPartitions = NULL;
+    CxnSummaryPartitionCount = 0;
+}
@@ -33,6 +33,7 @@ _IRQL_requires_max_(PASSIVE_LEVEL) void QuicTraceRundown(void) { }
 "  --conn_tput [--sort <type>|--filter <type>|--id <num>|--cid <bytes>] [--reso <ms>] [--top <num>]\n" \
 "  --conn_trace [--sort <type>|--filter <type>|--id <num>|--cid <bytes>] [--top <num>]\n" \
 "  --conn_qlog [--sort <type>|--filter <type>|--id <num>|--cid <bytes>]\n" \
+"  --conn_summary [--threads <num>]\n" \
 "\n" \
 "Stream Commands:\n" \
 "  --stream_trace [--id <num>] [--top <num>]\n" \
@@ -52,6 +53,7 @@ _IRQL_requires_max_(PASSIVE_LEVEL) void QuicTraceRundown(void) { }
 "  --cid <bytes>, Connection ID to search for\n" \
 "  --top <num>, Limits the number of output lines\n" \
 "  --reso <ms>, Event resolution in milliseconds\n" \
+"  --threads <num>, Number of analysis threads (default: one per processor)\n" \
 "  --verbose, Includes more detailed output\n" \
 
 #define QUIC_MAN_PATH L"\\minio\\quic\\manifest\\MsQuicEtw.man"
@@ -146,6 +148,18 @@ void WINAPI EventCallback(_In_ PEVENT_RECORD ev)
         Trace.StartTimestamp = ev->EventHeader.TimeStamp.QuadPart;
     }
 
+    if (Cmd.Command == COMMAND_CONN_SUMMARY) {
+        //
+        // Only the connection events are needed, and they're handed off to the
+        // summary threads instead of building the object sets.
+        //
+        if (EventType == EventType_Connection) {
+            CxnSummaryQueueEvent(ev);
+        }
+        Trace.StopTimestamp = ev->EventHeader.TimeStamp.QuadPart;
+        return;
+    }
+
     ULONG ObjectId = 0;
     BOOLEAN TraceEvent = Cmd.Command == COMMAND_TRACE;
     ULONG64 InitialTimestamp = Trace.StartTimestamp;
@@ -282,12 +296,20 @@ void RunProcessTrace(void)
     QueryPerformanceFrequency(&Frequency);
     QueryPerformanceCounter(&ProcessStart);
 
+    if (Cmd.Command == COMMAND_CONN_SUMMARY) {
+        CxnSummaryStart();
+    }
+
     int Err = ProcessTrace(&Trace.Handle, 1, 0, 0);
     if (Err != NO_ERROR) {
         printf("ProcessTrace failed with %u\n", Err);
         exit(1);
     }
 
+    if (Cmd.Command == COMMAND_CONN_SUMMARY) {
+        CxnSummaryStop();
+    }
+
     LARGE_INTEGER ProcessEnd;
     QueryPerformanceCounter(&ProcessEnd);
     Trace.ProcessedMs = ProcessEnd.QuadPart - ProcessStart.QuadPart;
@@ -295,7 +317,11 @@ void RunProcessTrace(void)
     Trace.ProcessedMs /= Frequency.QuadPart;
     Trace.ProcessedMs /= 1000;
 
-    Trace.Processed = TRUE;
+    //
+    // The summaries don't build the object sets, so other commands still need
+    // to process the trace.
+    //
+    Trace.Processed = Cmd.Command != COMMAND_CONN_SUMMARY;
 }
 
 #define InvalidCommandUsage() printf(USAGE_PART2); return
@@ -311,6 +337,7 @@ void ProcessCommandArgs(int argc, char** argv)
     Cmd.MaxOutputLines = ULONG_MAX;
     Cmd.CidLength = 0;
     Cmd.Verbose = FALSE;
+    Cmd.ThreadCount = 0;
     Trace.OutputLineCount = 0;
 
     QJSON QjWorkSpace = {0};
@@ -378,6 +405,13 @@ void ProcessCommandArgs(int argc, char** argv)
             Cmd.Command = COMMAND_CONN_QLOG;
             ProcessTraceFile = TRUE;
 
+        } else if (!strcmp(*argv, "--conn_summary")) {
+            if (Cmd.Command != COMMAND_NONE) {
+                InvalidCommandUsage();
+            }
+            Cmd.Command = COMMAND_CONN_SUMMARY;
+            ProcessTraceFile = TRUE;
+
         } else if (!strcmp(*argv, "--worker")) {
             if (Cmd.Command != COMMAND_NONE) {
                 InvalidCommandUsage();
@@ -461,6 +495,13 @@ void ProcessCommandArgs(int argc, char** argv)
             argc--; argv++;
             ReadCid(*argv);
 
+        } else if (!strcmp(*argv, "--threads")) {
+            if (argc < 2) {
+                InvalidCommandUsage();
+            }
+            argc--; argv++;
+            Cmd.ThreadCount = atoi(*argv);
+
         } else if (!strcmp(*argv, "--verbose")) {
             Cmd.Verbose = TRUE;
 
@@ -521,6 +562,9 @@ void ProcessCommandArgs(int argc, char** argv)
         case COMMAND_CONN_TPUT:
             printf("ms,TxMbps,RxMbps,RttMs,CongEvents,InFlight,Cwnd,TxBufBytes,FlowAvailStrm,FlowAvailConn,SsThresh,CubicK,CubicWindowMax,StrmSndWnd\n");
             break;
+        case COMMAND_CONN_SUMMARY:
+            printf("Ptr,Start(us),Age(us),TX,RX,TxKbps,RxKbps,MinRtt(us),AvgRtt(us),MaxRtt(us),CongEvents,PersistentCongEvents,AvgQueueDelay(us),MaxQueueDelay(us)\n");
+            break;
         case COMMAND_WORKER_LIST:
             printf("ID,Thread,IdealProc,CxnCount,Age(us),Active(us)\n");
             break;
@@ -84,6 +84,8 @@ typedef enum QUIC_EVENT_ID_GLOBAL {
     EventId_QuicApiExit,
     EventId_QuicApiExitStatus,
     EventId_QuicApiWaitOperation,
+    EventId_QuicLibraryFlightRecorderDump,
+    EventId_QuicLibraryFlightRecord,
 
     EventId_QuicLibraryCount
 } QUIC_EVENT_ID_GLOBAL;
@@ -123,6 +125,15 @@ typedef struct QUIC_EVENT_DATA_GLOBAL {
         struct {
             UINT32 Status;
         } ApiExitStatus;
+        struct {
+            char Reason[1];
+        } FlightRecorderDump;
+        struct {
+            UINT32 Processor;
+            UINT64 TimeUs;
+            char Name[1];
+            // char Message[1];
+        } FlightRecord;
     };
 } QUIC_EVENT_DATA_GLOBAL;
 #pragma pack(pop)
@@ -747,6 +758,7 @@ typedef enum _COMMAND_TYPE {
     COMMAND_CONN_TPUT,
     COMMAND_CONN_TRACE,
     COMMAND_CONN_QLOG,
+    COMMAND_CONN_SUMMARY,
     COMMAND_WORKER,
     COMMAND_WORKER_LIST,
     COMMAND_WORKER_QUEUE,
@@ -1034,6 +1046,7 @@ typedef struct _CMD_ARGS {
     ULONG MaxOutputLines;
     UINT8 Cid[256];
     UINT8 CidLength;
+    ULONG ThreadCount;
 } CMD_ARGS;
 
 typedef struct _TRACE_STATE {
@@ -1085,6 +1098,13 @@ void ExecuteCxnCommand(void);
 
 void RunProcessTrace(void);
 
+//
+// Streaming per-connection summaries (cxn_summary.c).
+//
+void CxnSummaryStart(void);
+void CxnSummaryQueueEvent(_In_ PEVENT_RECORD ev);
+void CxnSummaryStop(void);
+
 ObjEventCallback LibraryEventCallback;
 ObjEventCallback WorkerEventCallback;
 ObjEventCallback SessionEventCallback;
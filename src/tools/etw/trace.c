@@ -22,6 +22,8 @@ const char* OperationTypeStr[] = {
     "TLS_COMPLETE",
     "TIMER_EXPIRED",
     "TRACE_RUNDOWN",
+    "GENERATE_KEYS",
+    "ADDR_RESOLVED",
     "VERSION_NEGOTIATION",
     "STATELESS_RESET",
     "RETRY"
@@ -47,7 +49,10 @@ const char* TimerOperationTypeStr[] = {
     "TIMER.LOSS_DETECTION",
     "TIMER.KEEP_ALIVE",
     "TIMER.IDLE",
-    "TIMER.SHUTDOWN"
+    "TIMER.HIBERNATE",
+    "TIMER.ADDR_FALLBACK",
+    "TIMER.SHUTDOWN",
+    "TIMER.CORK"
 };
 
 const char* PacktTypeStr[] = {
@@ -138,6 +143,9 @@ QuicTraceGlobalEvent(
             if (EvData->LibraryInitialized.DatapathFeatures & QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION) {
                 printf("USO ");
             }
+            if (EvData->LibraryInitialized.DatapathFeatures & QUIC_DATAPATH_FEATURE_SEND_TXTIME) {
+                printf("TXTIME ");
+            }
             printf("]\n");
         }
         break;
@@ -176,6 +184,9 @@ QuicTraceGlobalEvent(
             if (EvData->LibraryInitialized.DatapathFeatures & QUIC_DATAPATH_FEATURE_SEND_SEGMENTATION) {
                 printf("USO ");
             }
+            if (EvData->LibraryInitialized.DatapathFeatures & QUIC_DATAPATH_FEATURE_SEND_TXTIME) {
+                printf("TXTIME ");
+            }
             printf("]\n");
         }
         break;
@@ -210,6 +221,18 @@ QuicTraceGlobalEvent(
         printf("API Waiting on operation\n");
         break;
     }
+    case EventId_QuicLibraryFlightRecorderDump: {
+        printf("Flight recorder dump, %s\n", EvData->FlightRecorderDump.Reason);
+        break;
+    }
+    case EventId_QuicLibraryFlightRecord: {
+        printf("FR[%u][%llu] %s: %s\n",
+            EvData->FlightRecord.Processor,
+            EvData->FlightRecord.TimeUs,
+            EvData->FlightRecord.Name,
+            EvData->FlightRecord.Name + strlen(EvData->FlightRecord.Name) + 1);
+        break;
+    }
     default: {
         printf("Unknown Event ID=%u\n", ev->EventHeader.EventDescriptor.Id);
         break;
@@ -26,6 +26,8 @@ enum QuicEventIdGlobal {
     EventId_QuicApiExit,
     EventId_QuicApiExitStatus,
     EventId_QuicApiWaitOperation,
+    EventId_QuicLibraryFlightRecorderDump,
+    EventId_QuicLibraryFlightRecord,
 
     EventId_QuicLibraryCount
 };
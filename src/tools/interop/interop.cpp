@@ -27,6 +27,9 @@ uint32_t TestCases = QuicTestFeatureAll;
 uint32_t WaitTimeoutMs = 5000;
 uint32_t InitialVersion = 0;
 bool RunSerially = false;
+bool RunPerf = false;
+const char* PerfPath = "/";
+uint32_t PerfStreamCount = 10;
 
 const BOOLEAN UseSendBuffering = FALSE;
 const uint32_t CertificateValidationFlags = QUIC_CERTIFICATE_FLAG_DISABLE_CERT_VALIDATION;
@@ -122,13 +125,15 @@ PrintUsage()
     printf("Usage:\n");
     printf("  quicinterop.exe -help\n");
     printf("  quicinterop.exe -list\n");
-    printf("  quicinterop.exe [-target:<implementation> | -custom:<hostname>] [-port:<####>] [-test:<test case>] [-timeout:<milliseconds>] [-version:<####>]\n\n");
+    printf("  quicinterop.exe [-target:<implementation> | -custom:<hostname>] [-port:<####>] [-test:<test case>] [-timeout:<milliseconds>] [-version:<####>]\n");
+    printf("  quicinterop.exe -perf [-target:<implementation> | -custom:<hostname>] [-port:<####>] [-path:<resource>] [-streams:<count>] [-timeout:<milliseconds>]\n\n");
 
     printf("Examples:\n");
     printf("  quicinterop.exe\n");
     printf("  quicinterop.exe -test:H\n");
     printf("  quicinterop.exe -target:msquic\n");
     printf("  quicinterop.exe -custom:localhost -test:16\n");
+    printf("  quicinterop.exe -perf -custom:localhost -port:4433 -path:/10000000\n");
 }
 
 class GetRequest : public QUIC_BUFFER {
@@ -151,16 +156,28 @@ class InteropConnection {
     QUIC_EVENT RequestComplete;
     QUIC_EVENT ShutdownComplete;
     char* NegotiatedAlpn;
+    uint32_t PendingRequests;
 public:
+    uint64_t StartTime;
+    uint64_t ConnectedTime;
+    uint64_t FirstByteTime;
+    uint64_t RequestsDoneTime;
+    uint64_t BytesReceived;
     bool VersionUnsupported : 1;
     bool Connected : 1;
     bool Resumed : 1;
     bool UsedZeroRtt : 1;
     bool ReceivedResponse : 1;
-    InteropConnection(HQUIC Session, bool VerNeg = false, bool LargeTP = false) :
+    InteropConnection(HQUIC Session, bool VerNeg = false, bool LargeTP = false, const char* RequestPath = "/") :
         Connection(nullptr),
-        SendRequest("/"),
+        SendRequest(RequestPath),
         NegotiatedAlpn(nullptr),
+        PendingRequests(0),
+        StartTime(0),
+        ConnectedTime(0),
+        FirstByteTime(0),
+        RequestsDoneTime(0),
+        BytesReceived(0),
         VersionUnsupported(false),
         Connected(false),
         Resumed(false),
@@ -256,6 +273,7 @@ public:
                     &TimeoutMs));
     }
     bool ConnectToServer(const char* ServerName, uint16_t ServerPort) {
+        StartTime = QuicTimeUs64();
         if (QUIC_SUCCEEDED(
             MsQuic->ConnectionStart(
                 Connection,
@@ -276,10 +294,19 @@ public:
     bool WaitForShutdownComplete() {
         return QuicEventWaitWithTimeout(ShutdownComplete, WaitTimeoutMs);
     }
-    bool SendHttpRequest(bool WaitForResponse = true) {
+    bool SendHttpRequest(bool WaitForResponse = true, uint32_t Count = 1) {
         QuicEventReset(RequestComplete);
         ReceivedResponse = false;
+        PendingRequests = Count;
 
+        for (uint32_t i = 0; i < Count; ++i) {
+            if (!StartHttpRequest()) {
+                return false;
+            }
+        }
+        return !WaitForResponse || WaitForHttpResponse();
+    }
+    bool StartHttpRequest() {
         HQUIC Stream;
         if (QUIC_FAILED(
             MsQuic->StreamOpen(
@@ -310,7 +337,7 @@ public:
                 0);
             return false;
         }
-        return !WaitForResponse || WaitForHttpResponse();
+        return true;
     }
     bool WaitForHttpResponse() {
         return
@@ -422,6 +449,7 @@ private:
         InteropConnection* pThis = (InteropConnection*)Context;
         switch (Event->Type) {
         case QUIC_CONNECTION_EVENT_CONNECTED:
+            pThis->ConnectedTime = QuicTimeUs64();
             pThis->Connected = true;
             pThis->NegotiatedAlpn = new char[Event->CONNECTED.NegotiatedAlpnLength + 1];
             memcpy(pThis->NegotiatedAlpn, Event->CONNECTED.NegotiatedAlpn, Event->CONNECTED.NegotiatedAlpnLength);
@@ -467,6 +495,12 @@ private:
     {
         InteropConnection* pThis = (InteropConnection*)Context;
         switch (Event->Type) {
+        case QUIC_STREAM_EVENT_RECEIVE:
+            if (pThis->FirstByteTime == 0) {
+                pThis->FirstByteTime = QuicTimeUs64();
+            }
+            pThis->BytesReceived += Event->RECEIVE.TotalBufferLength;
+            break;
         case QUIC_STREAM_EVENT_SEND_COMPLETE:
             break;
         case QUIC_STREAM_EVENT_PEER_SEND_ABORTED:
@@ -488,7 +522,13 @@ private:
                 Length > 0) {
                 pThis->UsedZeroRtt = true;
             }
-            QuicEventSet(pThis->RequestComplete);
+            if (pThis->PendingRequests <= 1) {
+                pThis->PendingRequests = 0;
+                pThis->RequestsDoneTime = QuicTimeUs64();
+                QuicEventSet(pThis->RequestComplete);
+            } else {
+                pThis->PendingRequests--;
+            }
             MsQuic->StreamClose(Stream);
             break;
         }
@@ -805,6 +845,160 @@ RunInteropTests()
     printf("\n");
 }
 
+//
+// Prints one measurement as a JSON object per line, so the results can be
+// collected and compared over time.
+//
+void
+PrintPerfResult(
+    _In_ const QuicPublicEndpoint& Endpoint,
+    _In_ uint16_t Port,
+    _In_z_ const char* Case,
+    _In_ bool Success,
+    _In_ double Value,
+    _In_z_ const char* Unit
+    )
+{
+    if (Success) {
+        printf("{\"target\":\"%s\",\"server\":\"%s\",\"port\":%hu,\"case\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"}\n",
+            Endpoint.ImplementationName, Endpoint.ServerName, Port, Case, Value, Unit);
+    } else {
+        printf("{\"target\":\"%s\",\"server\":\"%s\",\"port\":%hu,\"case\":\"%s\",\"error\":\"failed\"}\n",
+            Endpoint.ImplementationName, Endpoint.ServerName, Port, Case);
+    }
+}
+
+double
+GoodputMbps(
+    _In_ uint64_t Bytes,
+    _In_ uint64_t TimeUs
+    )
+{
+    return TimeUs == 0 ? 0.0 : (Bytes * 8.0) / TimeUs;
+}
+
+HQUIC
+OpenPerfSession(
+    void
+    )
+{
+    HQUIC Session = nullptr;
+    VERIFY_QUIC_SUCCESS(
+        MsQuic->SessionOpen(
+            Registration,
+            DatapathAlpns,
+            ARRAYSIZE(DatapathAlpns),
+            nullptr,
+            &Session));
+    uint16_t UniStreams = 3;
+    VERIFY_QUIC_SUCCESS(
+        MsQuic->SetParam(
+            Session,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_PEER_UNIDI_STREAM_COUNT,
+            sizeof(UniStreams),
+            &UniStreams));
+    return Session;
+}
+
+//
+// Downloads PerfPath on StreamCount parallel streams of a new connection and
+// reports the goodput, from sending the requests to the last response.
+//
+void
+RunPerfGoodput(
+    _In_ const QuicPublicEndpoint& Endpoint,
+    _In_ uint16_t Port,
+    _In_z_ const char* Case,
+    _In_ uint32_t StreamCount
+    )
+{
+    HQUIC Session = OpenPerfSession();
+    {
+        InteropConnection Connection(Session, false, false, PerfPath);
+        bool Success = Connection.ConnectToServer(Endpoint.ServerName, Port);
+        uint64_t SendTime = QuicTimeUs64();
+        Success =
+            Success &&
+            Connection.SendHttpRequest(true, StreamCount) &&
+            Connection.BytesReceived != 0;
+        PrintPerfResult(
+            Endpoint, Port, Case, Success,
+            GoodputMbps(
+                Connection.BytesReceived,
+                QuicTimeDiff64(SendTime, Connection.RequestsDoneTime)),
+            "Mbps");
+    }
+    MsQuic->SessionClose(Session);
+}
+
+//
+// Measures handshake latency, 0-RTT and 1-RTT time to first byte, and goodput
+// on one and on many streams against one endpoint. The cases run one after
+// the other, so they don't compete with each other for bandwidth.
+//
+void
+RunPerfTests(
+    _In_ const QuicPublicEndpoint& Endpoint,
+    _In_ uint16_t Port
+    )
+{
+    HQUIC Session = OpenPerfSession();
+    {
+        //
+        // A full handshake. This also gets the resumption ticket for the
+        // 0-RTT case.
+        //
+        InteropConnection Connection(Session);
+        bool Success =
+            Connection.ConnectToServer(Endpoint.ServerName, Port) &&
+            Connection.WaitForTicket();
+        PrintPerfResult(
+            Endpoint, Port, "handshake", Success,
+            QuicTimeDiff64(Connection.StartTime, Connection.ConnectedTime) / 1000.0,
+            "ms");
+    }
+    {
+        //
+        // A resumed connection with the request sent in 0-RTT.
+        //
+        InteropConnection Connection(Session, false, false, PerfPath);
+        bool Success =
+            Connection.SendHttpRequest(false) &&
+            Connection.ConnectToServer(Endpoint.ServerName, Port) &&
+            Connection.WaitForHttpResponse() &&
+            Connection.UsedZeroRtt &&
+            Connection.FirstByteTime != 0;
+        PrintPerfResult(
+            Endpoint, Port, "0rtt_first_byte", Success,
+            QuicTimeDiff64(Connection.StartTime, Connection.FirstByteTime) / 1000.0,
+            "ms");
+    }
+    MsQuic->SessionClose(Session);
+
+    Session = OpenPerfSession();
+    {
+        //
+        // A new connection (no ticket) with the request queued before the
+        // handshake, so it goes out as soon as 1-RTT keys are available.
+        //
+        InteropConnection Connection(Session, false, false, PerfPath);
+        bool Success =
+            Connection.SendHttpRequest(false) &&
+            Connection.ConnectToServer(Endpoint.ServerName, Port) &&
+            Connection.WaitForHttpResponse() &&
+            Connection.FirstByteTime != 0;
+        PrintPerfResult(
+            Endpoint, Port, "first_byte", Success,
+            QuicTimeDiff64(Connection.StartTime, Connection.FirstByteTime) / 1000.0,
+            "ms");
+    }
+    MsQuic->SessionClose(Session);
+
+    RunPerfGoodput(Endpoint, Port, "goodput", 1);
+    RunPerfGoodput(Endpoint, Port, "goodput_multi_stream", PerfStreamCount);
+}
+
 int
 QUIC_MAIN_EXPORT
 main(
@@ -848,6 +1042,7 @@ main(
     }
 
     RunSerially = GetValue(argc, argv, "serial") != nullptr;
+    RunPerf = GetValue(argc, argv, "perf") != nullptr;
 
     QuicPlatformSystemLoad();
 
@@ -875,6 +1070,8 @@ main(
     TryGetValue(argc, argv, "timeout", &WaitTimeoutMs);
     TryGetValue(argc, argv, "version", &InitialVersion);
     TryGetValue(argc, argv, "port", &CustomPort);
+    TryGetValue(argc, argv, "path", &PerfPath);
+    TryGetValue(argc, argv, "streams", &PerfStreamCount);
 
     const char* Target, *Custom;
     if (TryGetValue(argc, argv, "target", &Target)) {
@@ -896,7 +1093,17 @@ main(
         EndpointIndex = (int)PublicEndpointsCount;
     }
 
-    RunInteropTests();
+    if (RunPerf) {
+        if (EndpointIndex == -1) {
+            printf("-perf requires -target or -custom\n");
+            goto Error;
+        }
+        RunPerfTests(
+            PublicEndpoints[EndpointIndex],
+            CustomPort == 0 ? PublicPorts[0] : CustomPort);
+    } else {
+        RunInteropTests();
+    }
 
 Error:
 
@@ -0,0 +1,549 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    QUIC Perf Client Implementation. Generates load from a set of threads,
+    each pinned to its own core, for the configured scenario and then prints
+    the rate achieved along with latency percentiles.
+
+--*/
+
+#include "QuicPerf.h"
+
+#undef min // STL headers conflict with previous definitions of min/max.
+#undef max
+#include <algorithm>
+
+struct PerfClientState {
+    HQUIC Session;
+    bool volatile Running;
+
+    int64_t volatile Completed;
+    int64_t volatile Failed;
+    int64_t volatile BytesSent;
+    int64_t volatile BytesReceived;
+    int64_t volatile ConnectionsHeld;
+    int64_t volatile ActiveConnections;
+
+    //
+    // Latency samples (in microseconds). Samples past the end of the array
+    // are dropped, but still counted by SampleIndex.
+    //
+    uint32_t* Samples;
+    int64_t volatile SampleIndex;
+
+    QUIC_EVENT ShutdownComplete;
+};
+
+static PerfClientState Client;
+
+struct PerfClientConnection {
+    HQUIC Handle;
+    uint64_t StartTime;
+    bool Connected;
+    PerfClientConnection() : Handle(nullptr), StartTime(0), Connected(false) { }
+};
+
+struct PerfClientRequest {
+    PerfClientConnection* Connection;
+    uint64_t StartTime;
+    bool Completed;
+    PerfClientRequest(PerfClientConnection* Connection) :
+        Connection(Connection), StartTime(0), Completed(false) { }
+};
+
+static
+void
+PerfClientRecordLatency(
+    _In_ uint64_t StartTime
+    )
+{
+    uint64_t Latency = QuicTimeDiff64(StartTime, QuicTimeUs64());
+    int64_t Index = InterlockedIncrement64(&Client.SampleIndex) - 1;
+    if (Index < (int64_t)PerfConfig.Client.MaxLatencySamples) {
+        Client.Samples[Index] = Latency > UINT32_MAX ? UINT32_MAX : (uint32_t)Latency;
+    }
+}
+
+static
+bool
+PerfClientStartConnection(
+    void
+    );
+
+static
+QUIC_STATUS
+QUIC_API
+PerfClientStreamCallback(
+    _In_ HQUIC Stream,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_STREAM_EVENT* Event
+    );
+
+static
+bool
+PerfClientStartRequest(
+    _In_ PerfClientConnection* Connection
+    )
+{
+    auto Request = new(std::nothrow) PerfClientRequest(Connection);
+    if (Request == nullptr) {
+        return false;
+    }
+
+    HQUIC Stream;
+    if (QUIC_FAILED(
+        MsQuic->StreamOpen(
+            Connection->Handle,
+            QUIC_STREAM_OPEN_FLAG_NONE,
+            PerfClientStreamCallback,
+            Request,
+            &Stream))) {
+        delete Request;
+        return false;
+    }
+
+    Request->StartTime = QuicTimeUs64();
+    if (QUIC_FAILED(MsQuic->StreamStart(Stream, QUIC_STREAM_START_FLAG_NONE))) {
+        MsQuic->StreamClose(Stream);
+        delete Request;
+        return false;
+    }
+
+    //
+    // The request header must always be sent, even if the configured request
+    // size is smaller.
+    //
+    uint64_t RequestSize =
+        PerfConfig.Client.RequestSize < PERF_REQUEST_HEADER_SIZE ?
+            PERF_REQUEST_HEADER_SIZE : PerfConfig.Client.RequestSize;
+    if (!PerfSendPayload(Stream, RequestSize)) {
+        MsQuic->StreamShutdown(Stream, QUIC_STREAM_SHUTDOWN_FLAG_ABORT, 0);
+        return true; // The request is cleaned up on SHUTDOWN_COMPLETE.
+    }
+    InterlockedExchangeAdd64(&Client.BytesSent, (int64_t)RequestSize);
+
+    return true;
+}
+
+static
+QUIC_STATUS
+QUIC_API
+PerfClientStreamCallback(
+    _In_ HQUIC Stream,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_STREAM_EVENT* Event
+    )
+{
+    auto Request = (PerfClientRequest*)Context;
+    switch (Event->Type) {
+    case QUIC_STREAM_EVENT_RECEIVE:
+        InterlockedExchangeAdd64(
+            &Client.BytesReceived, (int64_t)Event->RECEIVE.TotalBufferLength);
+        break;
+    case QUIC_STREAM_EVENT_SEND_COMPLETE:
+        delete (QUIC_BUFFER*)Event->SEND_COMPLETE.ClientContext;
+        break;
+    case QUIC_STREAM_EVENT_PEER_SEND_SHUTDOWN:
+        if (Client.Running) {
+            PerfClientRecordLatency(Request->StartTime);
+            InterlockedIncrement64(&Client.Completed);
+        }
+        Request->Completed = true;
+        break;
+    case QUIC_STREAM_EVENT_PEER_SEND_ABORTED:
+    case QUIC_STREAM_EVENT_PEER_RECEIVE_ABORTED:
+        MsQuic->StreamShutdown(Stream, QUIC_STREAM_SHUTDOWN_FLAG_ABORT, 0);
+        break;
+    case QUIC_STREAM_EVENT_SHUTDOWN_COMPLETE: {
+        if (!Request->Completed && Client.Running) {
+            InterlockedIncrement64(&Client.Failed);
+        }
+        PerfClientConnection* Connection = Request->Connection;
+        delete Request;
+        MsQuic->StreamClose(Stream);
+        if (Client.Running && Connection->Connected) {
+            if (!PerfClientStartRequest(Connection)) {
+                InterlockedIncrement64(&Client.Failed);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+static
+QUIC_STATUS
+QUIC_API
+PerfClientConnectionCallback(
+    _In_ HQUIC /* Connection */,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_CONNECTION_EVENT* Event
+    )
+{
+    auto Connection = (PerfClientConnection*)Context;
+    switch (Event->Type) {
+    case QUIC_CONNECTION_EVENT_CONNECTED:
+        Connection->Connected = true;
+        switch (PerfConfig.Client.Scenario) {
+        case PERF_SCENARIO_RPS:
+            for (uint32_t i = 0; i < PerfConfig.Client.ParallelCount; ++i) {
+                if (!PerfClientStartRequest(Connection)) {
+                    InterlockedIncrement64(&Client.Failed);
+                }
+            }
+            break;
+        case PERF_SCENARIO_HPS:
+            if (Client.Running) {
+                PerfClientRecordLatency(Connection->StartTime);
+                InterlockedIncrement64(&Client.Completed);
+            }
+            MsQuic->ConnectionShutdown(
+                Connection->Handle, QUIC_CONNECTION_SHUTDOWN_FLAG_NONE, 0);
+            break;
+        case PERF_SCENARIO_CONNECTIONS:
+            if (Client.Running) {
+                PerfClientRecordLatency(Connection->StartTime);
+                InterlockedIncrement64(&Client.Completed);
+            }
+            InterlockedIncrement64(&Client.ConnectionsHeld);
+            break;
+        }
+        break;
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_COMPLETE:
+        if (!Connection->Connected && Client.Running) {
+            InterlockedIncrement64(&Client.Failed);
+        } else if (Connection->Connected &&
+            PerfConfig.Client.Scenario == PERF_SCENARIO_CONNECTIONS) {
+            InterlockedExchangeAdd64(&Client.ConnectionsHeld, -1);
+        }
+        MsQuic->ConnectionClose(Connection->Handle);
+        delete Connection;
+        if (PerfConfig.Client.Scenario == PERF_SCENARIO_HPS && Client.Running) {
+            //
+            // Replace the connection, from the same worker, to keep the
+            // configured number of handshakes in flight.
+            //
+            PerfClientStartConnection();
+        }
+        if (InterlockedExchangeAdd64(&Client.ActiveConnections, -1) == 1 &&
+            !Client.Running) {
+            QuicEventSet(Client.ShutdownComplete);
+        }
+        break;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+static
+bool
+PerfClientStartConnection(
+    void
+    )
+{
+    auto Connection = new(std::nothrow) PerfClientConnection;
+    if (Connection == nullptr) {
+        InterlockedIncrement64(&Client.Failed);
+        return false;
+    }
+
+    //
+    // The connection is assigned to the partition of the current processor,
+    // so opening connections from threads pinned to different cores spreads
+    // them across the workers.
+    //
+    if (QUIC_FAILED(
+        MsQuic->ConnectionOpen(
+            Client.Session,
+            PerfClientConnectionCallback,
+            Connection,
+            &Connection->Handle))) {
+        delete Connection;
+        InterlockedIncrement64(&Client.Failed);
+        return false;
+    }
+
+    uint32_t SecFlags = QUIC_CERTIFICATE_FLAG_DISABLE_CERT_VALIDATION;
+    MsQuic->SetParam(
+        Connection->Handle,
+        QUIC_PARAM_LEVEL_CONNECTION,
+        QUIC_PARAM_CONN_CERT_VALIDATION_FLAGS,
+        sizeof(SecFlags),
+        &SecFlags);
+
+    if (PerfConfig.Client.Scenario == PERF_SCENARIO_CONNECTIONS) {
+        uint32_t KeepAlive = DEFAULT_KEEP_ALIVE;
+        MsQuic->SetParam(
+            Connection->Handle,
+            QUIC_PARAM_LEVEL_CONNECTION,
+            QUIC_PARAM_CONN_KEEP_ALIVE,
+            sizeof(KeepAlive),
+            &KeepAlive);
+    }
+
+    InterlockedIncrement64(&Client.ActiveConnections);
+    Connection->StartTime = QuicTimeUs64();
+    if (QUIC_FAILED(
+        MsQuic->ConnectionStart(
+            Connection->Handle,
+            QuicAddrGetFamily(&PerfConfig.Client.RemoteIpAddr),
+            PerfConfig.Client.Target,
+            QuicAddrGetPort(&PerfConfig.Client.RemoteIpAddr)))) {
+        InterlockedExchangeAdd64(&Client.ActiveConnections, -1);
+        MsQuic->ConnectionClose(Connection->Handle);
+        delete Connection;
+        InterlockedIncrement64(&Client.Failed);
+        return false;
+    }
+
+    return true;
+}
+
+QUIC_THREAD_CALLBACK(PerfClientLoadThread, Context)
+{
+    uint32_t ThreadIndex = (uint32_t)(size_t)Context;
+
+    uint32_t Count;
+    if (PerfConfig.Client.Scenario == PERF_SCENARIO_HPS) {
+        Count = PerfConfig.Client.ParallelCount;
+    } else {
+        Count = PerfConfig.Client.ConnectionCount / PerfConfig.Client.ThreadCount;
+        if (ThreadIndex < PerfConfig.Client.ConnectionCount % PerfConfig.Client.ThreadCount) {
+            Count++;
+        }
+    }
+
+    for (uint32_t i = 0; i < Count && Client.Running; ++i) {
+        PerfClientStartConnection();
+    }
+
+    QUIC_THREAD_RETURN(QUIC_STATUS_SUCCESS);
+}
+
+static
+const char*
+PerfScenarioName(
+    _In_ PERF_SCENARIO Scenario
+    )
+{
+    switch (Scenario) {
+    case PERF_SCENARIO_RPS:         return "rps";
+    case PERF_SCENARIO_HPS:         return "hps";
+    case PERF_SCENARIO_CONNECTIONS: return "conns";
+    default:                        return "unknown";
+    }
+}
+
+static
+const char*
+PerfScenarioResultName(
+    _In_ PERF_SCENARIO Scenario
+    )
+{
+    switch (Scenario) {
+    case PERF_SCENARIO_RPS:         return "RequestsPerSecond";
+    case PERF_SCENARIO_HPS:         return "HandshakesPerSecond";
+    case PERF_SCENARIO_CONNECTIONS: return "ConnectionsHeld";
+    default:                        return "Unknown";
+    }
+}
+
+static
+uint32_t
+PerfPercentile(
+    _In_reads_(Count) const uint32_t* Sorted,
+    _In_ uint64_t Count,
+    _In_ uint32_t PerMille
+    )
+{
+    if (Count == 0) {
+        return 0;
+    }
+    uint64_t Index = (Count * PerMille) / 1000;
+    return Sorted[Index >= Count ? Count - 1 : Index];
+}
+
+static
+void
+PerfClientPrintResults(
+    _In_ uint64_t ElapsedUs,
+    _In_ int64_t Completed,
+    _In_ int64_t Failed,
+    _In_ int64_t BytesSent,
+    _In_ int64_t BytesReceived,
+    _In_ int64_t ConnectionsHeld,
+    _In_ int64_t SampleCount
+    )
+{
+    uint64_t Recorded =
+        SampleCount > (int64_t)PerfConfig.Client.MaxLatencySamples ?
+            PerfConfig.Client.MaxLatencySamples : (uint64_t)SampleCount;
+    std::sort(Client.Samples, Client.Samples + Recorded);
+
+    if (ElapsedUs == 0) {
+        ElapsedUs = 1;
+    }
+
+    double Result;
+    if (PerfConfig.Client.Scenario == PERF_SCENARIO_CONNECTIONS) {
+        Result = (double)ConnectionsHeld;
+    } else {
+        Result = ((double)Completed * 1000 * 1000) / ElapsedUs;
+    }
+    uint64_t SendRate = ((uint64_t)BytesSent * 1000 * 1000 * 8) / (1000 * ElapsedUs);
+    uint64_t RecvRate = ((uint64_t)BytesReceived * 1000 * 1000 * 8) / (1000 * ElapsedUs);
+
+    printf(
+        "Result: %.2f %s after %u ms (%lld completed, %lld failed, TX %llu kbps, RX %llu kbps).\n",
+        Result,
+        PerfScenarioResultName(PerfConfig.Client.Scenario),
+        (uint32_t)(ElapsedUs / 1000),
+        (long long)Completed,
+        (long long)Failed,
+        (unsigned long long)SendRate,
+        (unsigned long long)RecvRate);
+
+    //
+    // The JSON summary is printed on a single line so that it can be matched
+    // by scripts/performance.ps1.
+    //
+    printf(
+        "{\"Scenario\":\"%s\",\"Threads\":%u,\"Connections\":%u,\"Parallel\":%u,"
+        "\"RequestSize\":%llu,\"ResponseSize\":%llu,\"DurationMs\":%u,"
+        "\"Completed\":%lld,\"Failed\":%lld,\"%s\":%.2f,"
+        "\"SendKbps\":%llu,\"RecvKbps\":%llu,"
+        "\"LatencyUs\":{\"Min\":%u,\"P50\":%u,\"P90\":%u,\"P99\":%u,\"P999\":%u,\"Max\":%u},"
+        "\"SamplesDropped\":%llu}\n",
+        PerfScenarioName(PerfConfig.Client.Scenario),
+        PerfConfig.Client.ThreadCount,
+        PerfConfig.Client.ConnectionCount,
+        PerfConfig.Client.ParallelCount,
+        (unsigned long long)PerfConfig.Client.RequestSize,
+        (unsigned long long)PerfConfig.Client.ResponseSize,
+        (uint32_t)(ElapsedUs / 1000),
+        (long long)Completed,
+        (long long)Failed,
+        PerfScenarioResultName(PerfConfig.Client.Scenario),
+        Result,
+        (unsigned long long)SendRate,
+        (unsigned long long)RecvRate,
+        Recorded == 0 ? 0 : Client.Samples[0],
+        PerfPercentile(Client.Samples, Recorded, 500),
+        PerfPercentile(Client.Samples, Recorded, 900),
+        PerfPercentile(Client.Samples, Recorded, 990),
+        PerfPercentile(Client.Samples, Recorded, 999),
+        Recorded == 0 ? 0 : Client.Samples[Recorded - 1],
+        (unsigned long long)((uint64_t)SampleCount - Recorded));
+}
+
+void QuicPerfClientRun()
+{
+    //
+    // Every request carries the same header, so write it once at the start of
+    // the shared send buffer.
+    //
+    for (uint32_t i = 0; i < PERF_REQUEST_HEADER_SIZE; ++i) {
+        PerfSendBuffer[i] =
+            (uint8_t)(PerfConfig.Client.ResponseSize >> (8 * (PERF_REQUEST_HEADER_SIZE - 1 - i)));
+    }
+
+    Client.Samples = new(std::nothrow) uint32_t[PerfConfig.Client.MaxLatencySamples + 1];
+    if (Client.Samples == nullptr) {
+        printf("Failed to allocate latency samples!\n");
+        return;
+    }
+    QuicEventInitialize(&Client.ShutdownComplete, TRUE, FALSE);
+
+    QuicSession Session;
+    if (QUIC_FAILED(
+        MsQuic->SessionOpen(
+            Registration,
+            &PerfConfig.ALPN,
+            1,
+            NULL,
+            &Session.Handle))) {
+        printf("MsQuic->SessionOpen failed!\n");
+        QuicEventUninitialize(Client.ShutdownComplete);
+        delete [] Client.Samples;
+        return;
+    }
+    Client.Session = Session.Handle;
+
+    QUIC_THREAD* Threads = new(std::nothrow) QUIC_THREAD[PerfConfig.Client.ThreadCount];
+    if (Threads == nullptr) {
+        printf("Failed to allocate threads!\n");
+        QuicEventUninitialize(Client.ShutdownComplete);
+        delete [] Client.Samples;
+        return;
+    }
+
+    Client.Running = true;
+    uint64_t StartTime = QuicTimeUs64();
+
+    uint32_t ThreadsStarted = 0;
+    for (uint32_t i = 0; i < PerfConfig.Client.ThreadCount; ++i) {
+        QUIC_THREAD_CONFIG Config = {
+            QUIC_THREAD_FLAG_SET_AFFINITIZE,
+            (uint8_t)(i % QuicProcActiveCount()),
+            "perf_load",
+            PerfClientLoadThread,
+            (void*)(size_t)i
+        };
+        if (QUIC_FAILED(QuicThreadCreate(&Config, &Threads[i]))) {
+            printf("QuicThreadCreate failed!\n");
+            break;
+        }
+        ThreadsStarted++;
+    }
+    for (uint32_t i = 0; i < ThreadsStarted; ++i) {
+        QuicThreadWait(&Threads[i]);
+        QuicThreadDelete(&Threads[i]);
+    }
+    delete [] Threads;
+
+    uint64_t Elapsed = QuicTimeDiff64(StartTime, QuicTimeUs64());
+    if (Elapsed < (uint64_t)PerfConfig.Client.RunTime * 1000) {
+        QuicSleep((uint32_t)(PerfConfig.Client.RunTime - Elapsed / 1000));
+    }
+
+    //
+    // Snapshot the results before tearing down the connections, so that the
+    // shutdown doesn't affect them.
+    //
+    Client.Running = false;
+    Elapsed = QuicTimeDiff64(StartTime, QuicTimeUs64());
+    int64_t Completed = Client.Completed;
+    int64_t Failed = Client.Failed;
+    int64_t BytesSent = Client.BytesSent;
+    int64_t BytesReceived = Client.BytesReceived;
+    int64_t ConnectionsHeld = Client.ConnectionsHeld;
+    int64_t SampleCount = Client.SampleIndex;
+
+    if (InterlockedExchangeAdd64(&Client.ActiveConnections, 0) != 0) {
+        MsQuic->SessionShutdown(Session.Handle, QUIC_CONNECTION_SHUTDOWN_FLAG_NONE, 0);
+        if (!QuicEventWaitWithTimeout(Client.ShutdownComplete, PERF_SHUTDOWN_TIMEOUT)) {
+            printf("Cancelling remaining connections.\n");
+            Session.Cancel();
+        }
+    }
+
+    PerfClientPrintResults(
+        Elapsed,
+        Completed,
+        Failed,
+        BytesSent,
+        BytesReceived,
+        ConnectionsHeld,
+        SampleCount);
+
+    QuicEventUninitialize(Client.ShutdownComplete);
+    delete [] Client.Samples;
+}
@@ -0,0 +1,215 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    QUIC Perf Server Implementation. Accepts any number of connections and
+    answers each request stream with the number of bytes the request header
+    asked for.
+
+--*/
+
+#include "QuicPerf.h"
+
+struct PerfServerStream {
+    uint8_t Header[PERF_REQUEST_HEADER_SIZE];
+    uint32_t HeaderLength;
+    PerfServerStream() : HeaderLength(0) { }
+};
+
+static
+void
+PerfServerProcessReceive(
+    _Inout_ PerfServerStream* Context,
+    _In_ const QUIC_STREAM_EVENT* Event
+    )
+{
+    for (uint32_t i = 0;
+         i < Event->RECEIVE.BufferCount && Context->HeaderLength < PERF_REQUEST_HEADER_SIZE;
+         ++i) {
+        uint32_t Length = PERF_REQUEST_HEADER_SIZE - Context->HeaderLength;
+        if (Length > Event->RECEIVE.Buffers[i].Length) {
+            Length = Event->RECEIVE.Buffers[i].Length;
+        }
+        memcpy(
+            Context->Header + Context->HeaderLength,
+            Event->RECEIVE.Buffers[i].Buffer,
+            Length);
+        Context->HeaderLength += Length;
+    }
+}
+
+static
+QUIC_STATUS
+QUIC_API
+PerfServerStreamCallback(
+    _In_ HQUIC Stream,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_STREAM_EVENT* Event
+    )
+{
+    auto StreamContext = (PerfServerStream*)Context;
+    switch (Event->Type) {
+    case QUIC_STREAM_EVENT_RECEIVE:
+        PerfServerProcessReceive(StreamContext, Event);
+        break;
+    case QUIC_STREAM_EVENT_SEND_COMPLETE:
+        delete (QUIC_BUFFER*)Event->SEND_COMPLETE.ClientContext;
+        break;
+    case QUIC_STREAM_EVENT_PEER_SEND_SHUTDOWN: {
+        if (StreamContext->HeaderLength < PERF_REQUEST_HEADER_SIZE) {
+            MsQuic->StreamShutdown(Stream, QUIC_STREAM_SHUTDOWN_FLAG_ABORT, 0);
+            break;
+        }
+        uint64_t ResponseSize = 0;
+        for (uint32_t i = 0; i < PERF_REQUEST_HEADER_SIZE; ++i) {
+            ResponseSize = (ResponseSize << 8) | StreamContext->Header[i];
+        }
+        if (!PerfSendPayload(Stream, ResponseSize)) {
+            MsQuic->StreamShutdown(Stream, QUIC_STREAM_SHUTDOWN_FLAG_ABORT, 0);
+        }
+        break;
+    }
+    case QUIC_STREAM_EVENT_PEER_SEND_ABORTED:
+    case QUIC_STREAM_EVENT_PEER_RECEIVE_ABORTED:
+        MsQuic->StreamShutdown(Stream, QUIC_STREAM_SHUTDOWN_FLAG_ABORT, 0);
+        break;
+    case QUIC_STREAM_EVENT_SHUTDOWN_COMPLETE:
+        delete StreamContext;
+        MsQuic->StreamClose(Stream);
+        break;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+static
+QUIC_STATUS
+QUIC_API
+PerfServerConnectionCallback(
+    _In_ HQUIC Connection,
+    _In_opt_ void* /* Context */,
+    _Inout_ QUIC_CONNECTION_EVENT* Event
+    )
+{
+    switch (Event->Type) {
+    case QUIC_CONNECTION_EVENT_PEER_STREAM_STARTED: {
+        auto StreamContext = new(std::nothrow) PerfServerStream;
+        if (StreamContext == nullptr) {
+            MsQuic->StreamClose(Event->PEER_STREAM_STARTED.Stream);
+            break;
+        }
+        MsQuic->SetCallbackHandler(
+            Event->PEER_STREAM_STARTED.Stream,
+            (void*)PerfServerStreamCallback,
+            StreamContext);
+        break;
+    }
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_COMPLETE:
+        MsQuic->ConnectionClose(Connection);
+        break;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+static
+QUIC_STATUS
+QUIC_API
+PerfServerListenerCallback(
+    _In_ HQUIC /* Listener */,
+    _In_opt_ void* /* Context */,
+    _Inout_ QUIC_LISTENER_EVENT* Event
+    )
+{
+    switch (Event->Type) {
+    case QUIC_LISTENER_EVENT_NEW_CONNECTION:
+        MsQuic->SetCallbackHandler(
+            Event->NEW_CONNECTION.Connection,
+            (void*)PerfServerConnectionCallback,
+            nullptr);
+        Event->NEW_CONNECTION.SecurityConfig = SecurityConfig;
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+bool
+QuicPerfServerStart(
+    _Inout_ QuicSession& Session,
+    _Out_ HQUIC* Listener
+    )
+{
+    if (QUIC_FAILED(
+        MsQuic->SessionOpen(
+            Registration,
+            &PerfConfig.ALPN,
+            1,
+            NULL,
+            &Session.Handle))) {
+        printf("MsQuic->SessionOpen failed!\n");
+        return false;
+    }
+    uint16_t PeerStreamCount = DEFAULT_SERVER_MAX_STREAMS;
+    if (QUIC_FAILED(
+        MsQuic->SetParam(
+            Session.Handle,
+            QUIC_PARAM_LEVEL_SESSION,
+            QUIC_PARAM_SESSION_PEER_BIDI_STREAM_COUNT,
+            sizeof(PeerStreamCount),
+            &PeerStreamCount))) {
+        printf("MsQuic->SetParam (SESSION_PEER_BIDI_STREAM_COUNT) failed!\n");
+        return false;
+    }
+
+    *Listener = nullptr;
+    if (QUIC_FAILED(
+        MsQuic->ListenerOpen(
+            Session.Handle,
+            PerfServerListenerCallback,
+            nullptr,
+            Listener))) {
+        printf("MsQuic->ListenerOpen failed!\n");
+        return false;
+    }
+    if (QUIC_FAILED(
+        MsQuic->ListenerStart(
+            *Listener,
+            &PerfConfig.LocalIpAddr))) {
+        printf("MsQuic->ListenerStart failed!\n");
+        MsQuic->ListenerClose(*Listener);
+        *Listener = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void QuicPerfServerRun()
+{
+    QuicSession Session;
+    HQUIC Listener;
+    if (!QuicPerfServerStart(Session, &Listener)) {
+        return;
+    }
+
+    printf("Ready For Connections!\n\n");
+    //
+    // An explicit flush is needed in order to be detected in real time by the test runner
+    //
+    fflush(stdout);
+
+    if (PerfConfig.Server.RunTime != 0) {
+        QuicSleep(PerfConfig.Server.RunTime);
+    } else {
+        printf("Press Enter to exit.\n\n");
+        getchar();
+    }
+
+    MsQuic->ListenerClose(Listener);
+    Session.Cancel();
+}
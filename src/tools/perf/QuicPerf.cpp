@@ -0,0 +1,432 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+Abstract:
+
+    QUIC Performance Server/Client tool. Unlike quicping, which measures bulk
+    transfers, quicperf measures request rates, handshake rates and the
+    number of connections that can be held open, and reports the results
+    (including latency percentiles) as JSON.
+
+--*/
+
+#include "QuicPerf.h"
+
+const QUIC_API_TABLE* MsQuic;
+HQUIC Registration;
+QUIC_SEC_CONFIG* SecurityConfig;
+QUIC_PERF_CONFIG PerfConfig;
+uint8_t* PerfSendBuffer;
+
+extern "C" void QuicTraceRundown(void) { }
+
+void
+PrintUsage()
+{
+    printf("quicperf is a tool for measuring the request rate, handshake rate and"
+           " connection capacity of a QUIC server.\n");
+
+    printf("\n  quicperf.exe [options]\n");
+
+    printf("\nServer options:\n");
+    printf(
+        "  -listen:<addr or *>         The local IP address to listen on, or * for all IP addresses.\n"
+        "  -thumbprint:<cert_hash>     The hash or thumbprint of the certificate to use.\n"
+        "  -cert_store:<store name>    The certificate store to search for the thumbprint in.\n"
+        "  -machine_cert:<0/1>         Use the machine, or current user's, certificate store. (def:0)\n"
+        "  -selfsign:<0/1>             Use self signed test certificates.\n"
+        "  -runtime:<####>             How long to run before exiting. (def:until Enter is pressed)\n");
+
+    printf("\nClient options:\n");
+    printf(
+        "  -target:<hostname>          The remote hostname or IP address to connect to.\n"
+        "  -ip:<0/4/6>                 A hint for the resolving the hostname to an IP address. (def:0)\n"
+        "  -scenario:<rps/hps/conns>   The scenario to run. (def:%s)\n"
+        "                                rps   - Requests per second over long lived connections.\n"
+        "                                hps   - Handshakes per second.\n"
+        "                                conns - Number of connections held open.\n"
+        "  -connections:<####>         The number of connections to use (rps/conns). (def:%u)\n"
+        "  -threads:<####>             The number of load generating threads, each on its own core. (def:%u)\n"
+        "  -parallel:<####>            Outstanding requests per connection (rps) or handshakes per thread (hps). (def:%u)\n"
+        "  -request:<####>             The request payload size. (def:%u)\n"
+        "  -response:<####>            The response payload size. (def:%u)\n"
+        "  -runtime:<####>             The length of the run. (def:%u ms)\n"
+        "  -samples:<####>             The max number of latency samples recorded. (def:%u)\n"
+        "  -inproc:<0/1>               Also runs a self signed server in this process, e.g. with the loopback datapath. (def:0)\n",
+        DEFAULT_SCENARIO,
+        DEFAULT_CONNECTION_COUNT,
+        DEFAULT_THREAD_COUNT,
+        DEFAULT_PARALLEL_COUNT,
+        DEFAULT_REQUEST_SIZE,
+        DEFAULT_RESPONSE_SIZE,
+        DEFAULT_RUN_TIME,
+        DEFAULT_MAX_LATENCY_SAMPLES);
+
+    printf("\nCommon options:\n");
+    printf(
+        "  -alpn:<str>                 The ALPN to use. (def:%s)\n"
+        "  -port:<####>                The UDP port of the server. (def:%u)\n"
+        "  -encrypt:<0/1>              Enables/disables encryption. (def:%u)\n"
+        "  -exec:<0/1/2/3/4/5>         The execution profile to use. (def:%u)\n",
+        DEFAULT_ALPN,
+        DEFAULT_PORT,
+        DEFAULT_USE_ENCRYPTION,
+        DEFAULT_EXECUTION_PROFILE);
+
+    printf("\nServer Examples:\n");
+    printf("  quicperf.exe -listen:* -selfsign:1\n");
+
+    printf("\nClient Examples:\n");
+    printf("  quicperf.exe -target:localhost -scenario:rps -connections:16 -threads:4 -parallel:8 -request:512 -response:4096\n");
+    printf("  quicperf.exe -target:localhost -scenario:hps -threads:4 -parallel:16\n");
+    printf("  quicperf.exe -target:localhost -scenario:conns -connections:10000 -threads:8\n");
+    printf("  quicperf.exe -target:localhost -inproc:1 -scenario:hps -threads:4 -parallel:16\n");
+}
+
+bool
+PerfSendPayload(
+    _In_ HQUIC Stream,
+    _In_ uint64_t Length
+    )
+{
+    static const QUIC_BUFFER Empty = { 0, nullptr };
+
+    if (Length == 0) {
+        return
+            QUIC_SUCCEEDED(
+            MsQuic->StreamSend(Stream, &Empty, 1, QUIC_SEND_FLAG_FIN, nullptr));
+    }
+
+    while (Length != 0) {
+        QUIC_BUFFER* Buffer = new(std::nothrow) QUIC_BUFFER;
+        if (Buffer == nullptr) {
+            return false;
+        }
+        Buffer->Buffer = PerfSendBuffer;
+        Buffer->Length =
+            Length > PERF_SEND_BUFFER_SIZE ? PERF_SEND_BUFFER_SIZE : (uint32_t)Length;
+        Length -= Buffer->Length;
+        if (QUIC_FAILED(
+            MsQuic->StreamSend(
+                Stream,
+                Buffer,
+                1,
+                Length == 0 ? QUIC_SEND_FLAG_FIN : QUIC_SEND_FLAG_NONE,
+                Buffer))) {
+            delete Buffer;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+ParseCommonCommands(
+    _In_ int argc,
+    _In_reads_(argc) _Null_terminated_ char* argv[]
+    )
+{
+    const char* alpn = DEFAULT_ALPN;
+    TryGetValue(argc, argv, "alpn", &alpn);
+    PerfConfig.ALPN.Buffer = (uint8_t*)alpn;
+    PerfConfig.ALPN.Length = (uint32_t)strlen(alpn);
+
+    uint16_t port = DEFAULT_PORT;
+    TryGetValue(argc, argv, "port", &port);
+    if (PerfConfig.ServerMode) {
+        QuicAddrSetPort(&PerfConfig.LocalIpAddr, port);
+    } else {
+        QuicAddrSetPort(&PerfConfig.Client.RemoteIpAddr, port);
+    }
+
+    uint16_t useEncryption = DEFAULT_USE_ENCRYPTION;
+    TryGetValue(argc, argv, "encrypt", &useEncryption);
+    PerfConfig.UseEncryption = useEncryption != 0;
+
+    PerfSendBuffer = new(std::nothrow) uint8_t[PERF_SEND_BUFFER_SIZE];
+    if (PerfSendBuffer == nullptr) {
+        printf("Failed to allocate the send buffer!\n");
+        return false;
+    }
+    memset(PerfSendBuffer, 0, PERF_SEND_BUFFER_SIZE);
+
+    if (!PerfConfig.UseEncryption) {
+        uint8_t value = FALSE;
+        if (QUIC_FAILED(
+            MsQuic->SetParam(
+                nullptr,
+                QUIC_PARAM_LEVEL_GLOBAL,
+                QUIC_PARAM_GLOBAL_ENCRYPTION,
+                sizeof(value),
+                &value))) {
+            printf("MsQuic->SetParam (GLOBAL_ENCRYPTION) failed!\n");
+        }
+    }
+
+    return true;
+}
+
+void
+ParseServerCommand(
+    _In_ int argc,
+    _In_reads_(argc) _Null_terminated_ char* argv[]
+    )
+{
+    PerfConfig.ServerMode = true;
+
+    const char* localAddress = nullptr;
+    TryGetValue(argc, argv, "listen", &localAddress);
+    if (!ConvertArgToAddress(localAddress, 0, &PerfConfig.LocalIpAddr)) {
+        printf("Failed to decode IP address: '%s'!\nMust be *, a IPv4 or a IPv6 address.\n", localAddress);
+        return;
+    }
+
+    QUIC_SEC_CONFIG_PARAMS* selfSignedCertParams = nullptr;
+
+    uint16_t useSelfSigned = 0;
+    if (!TryGetValue(argc, argv, "selfsign", &useSelfSigned)) {
+
+#if _WIN32
+        const char* certThumbprint;
+        if (!TryGetValue(argc, argv, "thumbprint", &certThumbprint)) {
+            printf("Must specify -thumbprint: for server mode.\n");
+            return;
+        }
+        const char* certStoreName;
+        if (!TryGetValue(argc, argv, "cert_store", &certStoreName)) {
+            SecurityConfig = GetSecConfigForThumbprint(MsQuic, Registration, certThumbprint);
+            if (SecurityConfig == nullptr) {
+                printf("Failed to create security configuration for thumbprint:'%s'.\n", certThumbprint);
+                return;
+            }
+        } else {
+            uint32_t machineCert = 0;
+            TryGetValue(argc, argv, "machine_cert", &machineCert);
+            QUIC_CERTIFICATE_HASH_STORE_FLAGS flags =
+                machineCert ? QUIC_CERTIFICATE_HASH_STORE_FLAG_MACHINE_STORE : QUIC_CERTIFICATE_HASH_STORE_FLAG_NONE;
+
+            SecurityConfig = GetSecConfigForThumbprintAndStore(MsQuic, Registration, flags, certThumbprint, certStoreName);
+            if (SecurityConfig == nullptr) {
+                printf(
+                    "Failed to create security configuration for thumbprint:'%s' and store: '%s'.\n",
+                    certThumbprint,
+                    certStoreName);
+                return;
+            }
+        }
+#else
+        printf("Loading sec config on Linux unsupported right now.\n");
+        return;
+#endif
+    } else {
+        selfSignedCertParams = QuicPlatGetSelfSignedCert(QUIC_SELF_SIGN_CERT_USER);
+        if (!selfSignedCertParams) {
+            printf("Failed to create platform self signed certificate\n");
+            return;
+        }
+
+        SecurityConfig = GetSecConfigForSelfSigned(MsQuic, Registration, selfSignedCertParams);
+        if (!SecurityConfig) {
+            printf("Failed to create security config for self signed certificate\n");
+            QuicPlatFreeSelfSignedCert(selfSignedCertParams);
+            return;
+        }
+    }
+
+    uint32_t runTime = 0;
+    TryGetValue(argc, argv, "runtime", &runTime);
+    PerfConfig.Server.RunTime = runTime;
+
+    if (ParseCommonCommands(argc, argv)) {
+        QuicPerfServerRun();
+    }
+
+    MsQuic->SecConfigDelete(SecurityConfig);
+    if (selfSignedCertParams) {
+        QuicPlatFreeSelfSignedCert(selfSignedCertParams);
+    }
+}
+
+//
+// Runs a server, with a self signed certificate, for the duration of the
+// client run. The server listens on all addresses, at the client's port.
+//
+void
+QuicPerfInProcRun()
+{
+    QUIC_SEC_CONFIG_PARAMS* selfSignedCertParams =
+        QuicPlatGetSelfSignedCert(QUIC_SELF_SIGN_CERT_USER);
+    if (!selfSignedCertParams) {
+        printf("Failed to create platform self signed certificate\n");
+        return;
+    }
+
+    SecurityConfig = GetSecConfigForSelfSigned(MsQuic, Registration, selfSignedCertParams);
+    if (!SecurityConfig) {
+        printf("Failed to create security config for self signed certificate\n");
+        QuicPlatFreeSelfSignedCert(selfSignedCertParams);
+        return;
+    }
+
+    QuicAddrSetPort(
+        &PerfConfig.LocalIpAddr,
+        QuicAddrGetPort(&PerfConfig.Client.RemoteIpAddr));
+
+    {
+        QuicSession ServerSession;
+        HQUIC Listener;
+        if (QuicPerfServerStart(ServerSession, &Listener)) {
+            QuicPerfClientRun();
+            MsQuic->ListenerClose(Listener);
+            ServerSession.Cancel();
+        }
+    }
+
+    MsQuic->SecConfigDelete(SecurityConfig);
+    QuicPlatFreeSelfSignedCert(selfSignedCertParams);
+}
+
+void
+ParseClientCommand(
+    _In_ int argc,
+    _In_reads_(argc) _Null_terminated_ char* argv[]
+    )
+{
+    PerfConfig.ServerMode = false;
+
+    TryGetValue(argc, argv, "target", &PerfConfig.Client.Target);
+
+    uint16_t ip;
+    if (TryGetValue(argc, argv, "ip", &ip)) {
+        switch (ip) {
+        case 4: QuicAddrSetFamily(&PerfConfig.Client.RemoteIpAddr, AF_INET); break;
+        case 6: QuicAddrSetFamily(&PerfConfig.Client.RemoteIpAddr, AF_INET6); break;
+        }
+    }
+
+    const char* scenario = DEFAULT_SCENARIO;
+    TryGetValue(argc, argv, "scenario", &scenario);
+    if (strcmp(scenario, "rps") == 0) {
+        PerfConfig.Client.Scenario = PERF_SCENARIO_RPS;
+    } else if (strcmp(scenario, "hps") == 0) {
+        PerfConfig.Client.Scenario = PERF_SCENARIO_HPS;
+    } else if (strcmp(scenario, "conns") == 0) {
+        PerfConfig.Client.Scenario = PERF_SCENARIO_CONNECTIONS;
+    } else {
+        printf("Invalid scenario: '%s'!\nMust be rps, hps or conns.\n", scenario);
+        return;
+    }
+
+    uint32_t connections = DEFAULT_CONNECTION_COUNT;
+    TryGetValue(argc, argv, "connections", &connections);
+    PerfConfig.Client.ConnectionCount = connections;
+
+    uint32_t threads = DEFAULT_THREAD_COUNT;
+    TryGetValue(argc, argv, "threads", &threads);
+    PerfConfig.Client.ThreadCount = threads;
+
+    uint32_t parallel = DEFAULT_PARALLEL_COUNT;
+    TryGetValue(argc, argv, "parallel", &parallel);
+    PerfConfig.Client.ParallelCount = parallel;
+
+    uint64_t requestSize = DEFAULT_REQUEST_SIZE;
+    TryGetValue(argc, argv, "request", &requestSize);
+    PerfConfig.Client.RequestSize = requestSize;
+
+    uint64_t responseSize = DEFAULT_RESPONSE_SIZE;
+    TryGetValue(argc, argv, "response", &responseSize);
+    PerfConfig.Client.ResponseSize = responseSize;
+
+    uint32_t runTime = DEFAULT_RUN_TIME;
+    TryGetValue(argc, argv, "runtime", &runTime);
+    PerfConfig.Client.RunTime = runTime;
+
+    uint32_t samples = DEFAULT_MAX_LATENCY_SAMPLES;
+    TryGetValue(argc, argv, "samples", &samples);
+    PerfConfig.Client.MaxLatencySamples = samples;
+
+    uint16_t inProc = 0;
+    TryGetValue(argc, argv, "inproc", &inProc);
+
+    if (PerfConfig.Client.ConnectionCount == 0 ||
+        PerfConfig.Client.ThreadCount == 0 ||
+        PerfConfig.Client.ParallelCount == 0 ||
+        PerfConfig.Client.RunTime == 0) {
+        printf("Connections, threads, parallel and runtime must be non-zero!\n");
+        return;
+    }
+
+    if (PerfConfig.Client.ThreadCount > PerfConfig.Client.ConnectionCount &&
+        PerfConfig.Client.Scenario != PERF_SCENARIO_HPS) {
+        PerfConfig.Client.ThreadCount = PerfConfig.Client.ConnectionCount;
+    }
+
+    if (ParseCommonCommands(argc, argv)) {
+        if (inProc) {
+            QuicPerfInProcRun();
+        } else {
+            QuicPerfClientRun();
+        }
+    }
+}
+
+int
+QUIC_MAIN_EXPORT
+main(
+    _In_ int argc,
+    _In_reads_(argc) _Null_terminated_ char* argv[]
+    )
+{
+    int ErrorCode = -1;
+    uint16_t execProfile = DEFAULT_EXECUTION_PROFILE;
+    QUIC_REGISTRATION_CONFIG RegConfig = { "quicperf", DEFAULT_EXECUTION_PROFILE };
+
+    QuicPlatformSystemLoad();
+    QuicPlatformInitialize();
+
+    if (argc < 2) {
+        PrintUsage();
+        goto Error;
+    }
+
+    if (QUIC_FAILED(MsQuicOpen(&MsQuic))) {
+        printf("MsQuicOpen failed!\n");
+        goto Error;
+    }
+
+    TryGetValue(argc, argv, "exec", &execProfile);
+    RegConfig.ExecutionProfile = (QUIC_EXECUTION_PROFILE)execProfile;
+
+    if (QUIC_FAILED(MsQuic->RegistrationOpen(&RegConfig, &Registration))) {
+        printf("RegistrationOpen failed!\n");
+        MsQuicClose(MsQuic);
+        goto Error;
+    }
+
+    //
+    // Parse input to see if we are a client or server
+    //
+    if (GetValue(argc, argv, "listen")) {
+        ParseServerCommand(argc, argv);
+    } else if (GetValue(argc, argv, "target")) {
+        ParseClientCommand(argc, argv);
+    } else {
+        printf("Invalid usage!\n\n");
+        PrintUsage();
+    }
+
+    ErrorCode = 0;
+    MsQuic->RegistrationClose(Registration);
+    MsQuicClose(MsQuic);
+    delete [] PerfSendBuffer;
+
+Error:
+
+    QuicPlatformUninitialize();
+    QuicPlatformSystemUnload();
+
+    return ErrorCode;
+}
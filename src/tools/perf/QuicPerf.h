@@ -0,0 +1,194 @@
+/*++
+
+    Copyright (c) Microsoft Corporation.
+    Licensed under the MIT License.
+
+--*/
+
+#pragma once
+
+#define _CRT_SECURE_NO_WARNINGS 1
+#define QUIC_TEST_APIS 1 // Needed for self signed cert API
+#include <msquichelper.h>
+#include <new>
+
+//
+// QUIC API Function Table.
+//
+extern const QUIC_API_TABLE* MsQuic;
+
+//
+// Registration context.
+//
+extern HQUIC Registration;
+
+//
+// Security configuration for server.
+//
+extern QUIC_SEC_CONFIG* SecurityConfig;
+
+//
+// The protocol name used for QuicPerf.
+//
+#define DEFAULT_ALPN "perf"
+
+//
+// The default port used for QuicPerf.
+//
+#define DEFAULT_PORT 4433
+
+//
+// QuicPerf defaults to using encryption.
+//
+#define DEFAULT_USE_ENCRYPTION 1
+
+//
+// QuicPerf defaults to the max throughput profile.
+//
+#define DEFAULT_EXECUTION_PROFILE QUIC_EXECUTION_PROFILE_TYPE_MAX_THROUGHPUT
+
+//
+// The default client scenario.
+//
+#define DEFAULT_SCENARIO "rps"
+
+//
+// The default number of client connections.
+//
+#define DEFAULT_CONNECTION_COUNT 1
+
+//
+// The default number of client load generating threads.
+//
+#define DEFAULT_THREAD_COUNT 1
+
+//
+// The default number of outstanding requests per connection (rps) or
+// handshakes per thread (hps).
+//
+#define DEFAULT_PARALLEL_COUNT 1
+
+//
+// The default request and response payload sizes.
+//
+#define DEFAULT_REQUEST_SIZE 0
+#define DEFAULT_RESPONSE_SIZE 0
+
+//
+// The default length of a client run (in milliseconds).
+//
+#define DEFAULT_RUN_TIME (10 * 1000)
+
+//
+// The default maximum number of latency samples recorded per run.
+//
+#define DEFAULT_MAX_LATENCY_SAMPLES 1000000
+
+//
+// The max number of simultaneous streams the server allows a client to open.
+//
+#define DEFAULT_SERVER_MAX_STREAMS 1000
+
+//
+// The keep alive interval (in milliseconds) used to hold connections open.
+//
+#define DEFAULT_KEEP_ALIVE 5000
+
+//
+// Every request starts with the response size the client wants, as a 64-bit
+// value in network byte order.
+//
+#define PERF_REQUEST_HEADER_SIZE sizeof(uint64_t)
+
+//
+// The size of the buffers used for sending request and response payloads.
+// Larger payloads are sent as multiple sends of this size.
+//
+#define PERF_SEND_BUFFER_SIZE 0x10000
+
+//
+// The amount of time (in milliseconds) the client waits for its connections
+// to shut down at the end of a run.
+//
+#define PERF_SHUTDOWN_TIMEOUT (10 * 1000)
+
+typedef enum PERF_SCENARIO {
+    PERF_SCENARIO_RPS,          // Request/response over long lived connections
+    PERF_SCENARIO_HPS,          // Back to back handshakes
+    PERF_SCENARIO_CONNECTIONS   // Hold as many connections open as possible
+} PERF_SCENARIO;
+
+typedef struct QUIC_PERF_CONFIG {
+
+    bool ServerMode    : 1;
+    bool UseEncryption : 1;
+
+    QUIC_BUFFER ALPN;
+    QUIC_ADDR LocalIpAddr;
+
+    struct {
+        uint32_t RunTime;           // Milliseconds, 0 means until Enter is pressed
+    } Server;
+
+    struct {
+        PERF_SCENARIO Scenario;
+        const char* Target;         // SNI
+        QUIC_ADDR RemoteIpAddr;
+        uint32_t ConnectionCount;
+        uint32_t ThreadCount;
+        uint32_t ParallelCount;
+        uint64_t RequestSize;
+        uint64_t ResponseSize;
+        uint32_t RunTime;           // Milliseconds
+        uint32_t MaxLatencySamples;
+    } Client;
+
+} QUIC_PERF_CONFIG;
+
+extern QUIC_PERF_CONFIG PerfConfig;
+
+//
+// A zeroed buffer used for all payload sends. The client writes the request
+// header at its start.
+//
+extern uint8_t* PerfSendBuffer;
+
+struct QuicSession
+{
+    HQUIC Handle;
+    QuicSession() : Handle(nullptr) {}
+    ~QuicSession() { if (Handle != nullptr) { MsQuic->SessionClose(Handle); } }
+    void Cancel() {
+        MsQuic->SessionShutdown(Handle, QUIC_CONNECTION_SHUTDOWN_FLAG_SILENT, 0);
+    }
+};
+
+//
+// Queues sends for Length bytes of PerfSendBuffer, with FIN on the last one.
+//
+bool
+PerfSendPayload(
+    _In_ HQUIC Stream,
+    _In_ uint64_t Length
+    );
+
+//
+// Opens the server session and starts listening at the local address.
+//
+bool
+QuicPerfServerStart(
+    _Inout_ QuicSession& Session,
+    _Out_ HQUIC* Listener
+    );
+
+//
+// Starts the server at the local address and serves requests until a key is
+// pressed or the run time elapses.
+//
+void QuicPerfServerRun();
+
+//
+// Runs the configured scenario against the remote server and prints the
+// results.
+//
+void QuicPerfClientRun();
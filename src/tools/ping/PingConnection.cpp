@@ -422,15 +422,25 @@ PingConnection::ProcessEvent(
             printf("[%p]     Stream Bytes:           %llu\n", QuicConnection, Stats.Send.TotalStreamBytes);
             printf("[%p]     Congestion Events:      %u\n", QuicConnection, Stats.Send.CongestionCount);
             printf("[%p]     Pers Congestion Events: %u\n", QuicConnection, Stats.Send.PersistentCongestionCount);
+            printf("[%p]     Undone Cong Events:     %u\n", QuicConnection, Stats.Send.SpuriousCongestionCount);
             printf("[%p]   Recv:\n", QuicConnection);
             printf("[%p]     Total Packets:          %llu\n", QuicConnection, Stats.Recv.TotalPackets);
             printf("[%p]     Reordered Packets:      %llu\n", QuicConnection, Stats.Recv.ReorderedPackets);
             printf("[%p]     Dropped Packets:        %llu\n", QuicConnection, Stats.Recv.DroppedPackets);
             printf("[%p]     Decryption Failures:    %llu\n", QuicConnection, Stats.Recv.DecryptionFailures);
+            printf("[%p]     Queue Drops:            %llu full, %llu old epoch, %llu worker limit\n", QuicConnection,
+                Stats.Recv.QueueFullDrops, Stats.Recv.QueueOldEpochDrops, Stats.Recv.QueueWorkerLimitDrops);
             printf("[%p]     Total Bytes:            %llu\n", QuicConnection, Stats.Recv.TotalBytes);
             printf("[%p]     Stream Bytes:           %llu\n", QuicConnection, Stats.Recv.TotalStreamBytes);
             printf("[%p]   Misc:\n", QuicConnection);
             printf("[%p]     Key Updates:            %u\n", QuicConnection, Stats.Misc.KeyUpdateCount);
+            printf("[%p]   Blocked (us):\n", QuicConnection);
+            printf("[%p]     Congestion Control:     %llu\n", QuicConnection, Stats.Blocked.CongestionControl);
+            printf("[%p]     Pacing:                 %llu\n", QuicConnection, Stats.Blocked.Pacing);
+            printf("[%p]     Amplification:          %llu\n", QuicConnection, Stats.Blocked.AmplificationProt);
+            printf("[%p]     Conn Flow Control:      %llu\n", QuicConnection, Stats.Blocked.ConnFlowControl);
+            printf("[%p]     Stream Flow Control:    %llu\n", QuicConnection, Stats.Blocked.StreamFlowControl);
+            printf("[%p]     App:                    %llu\n", QuicConnection, Stats.Blocked.App);
         }
 
         delete this;
@@ -58,7 +58,7 @@ PrintUsage()
         "  -sendbuf:<0/1>              Whether to use send buffering. (def:%u)\n"
         "  -pacing:<0/1>               Enables/disables pacing. (def:%u)\n"
         "  -stats:<0/1>                Enables/disables printing statistics. (def:%u)\n"
-        "  -exec:<0/1/2/3>             The execution profile to use. (def:%u)\n"
+        "  -exec:<0/1/2/3/4/5>         The execution profile to use. (def:%u)\n"
         "  -uni:<####>                 The number of unidirectional streams to open locally. (def:0)\n"
         "  -bidi:<####>                The number of bidirectional streams to open locally. (def:0)\n"
         "  -peer_uni:<####>            The number of unidirectional streams for the peer to open. (def:0)\n"
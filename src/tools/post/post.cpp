@@ -11,8 +11,16 @@ Abstract:
 
 #define _CRT_SECURE_NO_WARNINGS 1
 
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
 #include <msquichelper.h>
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
 extern "C" void QuicTraceRundown(void) { }
 
 #define IO_SIZE (128 * 1024)
@@ -43,6 +51,48 @@ FILE* File = nullptr;
 QUIC_EVENT SendReady;
 bool TransferCanceled = false;
 
+//
+// Upload benchmark (-upload) configuration and state.
+//
+uint64_t UploadLength = 0;          // Generated bytes per stream
+uint32_t UploadIoSize = IO_SIZE;
+uint32_t UploadConnCount = 1;
+uint32_t UploadStreamCount = 1;     // Per connection
+uint32_t UploadOutstanding = 4;     // Sends in flight per stream
+uint8_t UploadBuffered = 1;
+uint8_t* UploadPayload = nullptr;
+std::atomic<uint32_t> UploadActiveStreams;
+QUIC_EVENT UploadComplete;
+uint64_t UploadEndTime = 0;
+
+struct UploadSend {
+    QUIC_BUFFER Buffers[2];         // Optional header + payload
+    uint32_t BufferCount;
+    uint32_t Length;                // Payload bytes
+    uint64_t StartTime;
+};
+
+struct UploadConnection;
+
+struct UploadStream {
+    UploadConnection* Connection;
+    HQUIC Handle;
+    char Header[64];
+    uint64_t BytesQueued;
+    uint64_t BytesCompleted;
+    uint32_t SendIndex;
+    uint32_t CompleteIndex;
+    bool Canceled;
+    std::vector<UploadSend> Sends; // Ring of UploadOutstanding entries
+    std::vector<uint64_t> SendCompleteLatencies;
+};
+
+struct UploadConnection {
+    HQUIC Handle;
+    std::atomic<uint32_t> ActiveStreams;
+    std::vector<UploadStream> Streams;
+};
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 _Function_class_(QUIC_CONNECTION_CALLBACK)
 QUIC_STATUS
@@ -104,6 +154,277 @@ StreamHandler(
     return QUIC_STATUS_SUCCESS;
 }
 
+//
+// Returns the CPU time (user and kernel) used by the process so far, in us.
+//
+uint64_t
+GetProcessCpuTimeUs(
+    void
+    )
+{
+#ifdef _WIN32
+    FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &CreationTime, &ExitTime, &KernelTime, &UserTime)) {
+        return 0;
+    }
+    ULARGE_INTEGER Kernel, User;
+    Kernel.LowPart = KernelTime.dwLowDateTime;
+    Kernel.HighPart = KernelTime.dwHighDateTime;
+    User.LowPart = UserTime.dwLowDateTime;
+    User.HighPart = UserTime.dwHighDateTime;
+    return (Kernel.QuadPart + User.QuadPart) / 10;
+#else
+    struct rusage Usage;
+    if (getrusage(RUSAGE_SELF, &Usage) != 0) {
+        return 0;
+    }
+    return
+        (uint64_t)(Usage.ru_utime.tv_sec + Usage.ru_stime.tv_sec) * 1000000 +
+        Usage.ru_utime.tv_usec + Usage.ru_stime.tv_usec;
+#endif
+}
+
+//
+// Keeps up to UploadOutstanding sends queued on the stream, until all of its
+// generated payload has been queued. The first send carries the POST header.
+//
+void
+UploadQueueSends(
+    _In_ UploadStream* Stream
+    )
+{
+    while (!Stream->Canceled &&
+           Stream->BytesQueued < UploadLength &&
+           Stream->SendIndex - Stream->CompleteIndex < UploadOutstanding) {
+        UploadSend* Send = &Stream->Sends[Stream->SendIndex % UploadOutstanding];
+        uint64_t Remaining = UploadLength - Stream->BytesQueued;
+        Send->Length = Remaining < UploadIoSize ? (uint32_t)Remaining : UploadIoSize;
+        Send->BufferCount = 0;
+        if (Stream->BytesQueued == 0) {
+            Send->Buffers[Send->BufferCount].Buffer = (uint8_t*)Stream->Header;
+            Send->Buffers[Send->BufferCount].Length = (uint32_t)strlen(Stream->Header);
+            Send->BufferCount++;
+        }
+        Send->Buffers[Send->BufferCount].Buffer = UploadPayload;
+        Send->Buffers[Send->BufferCount].Length = Send->Length;
+        Send->BufferCount++;
+
+        Stream->BytesQueued += Send->Length;
+        Stream->SendIndex++;
+        Send->StartTime = QuicTimeUs64();
+        if (QUIC_FAILED(
+            MsQuic->StreamSend(
+                Stream->Handle,
+                Send->Buffers,
+                Send->BufferCount,
+                Stream->BytesQueued == UploadLength ? QUIC_SEND_FLAG_FIN : QUIC_SEND_FLAG_NONE,
+                Send))) {
+            printf("StreamSend failed!\n");
+            Stream->Canceled = true;
+            MsQuic->StreamShutdown(Stream->Handle, QUIC_STREAM_SHUTDOWN_FLAG_ABORT, 0);
+        }
+    }
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Function_class_(QUIC_CONNECTION_CALLBACK)
+QUIC_STATUS
+QUIC_API
+UploadConnectionHandler(
+    _In_ HQUIC /* Connection */,
+    _In_opt_ void* /* Context */,
+    _Inout_ QUIC_CONNECTION_EVENT* Event
+    )
+{
+    switch (Event->Type) {
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_TRANSPORT:
+        if (Event->SHUTDOWN_INITIATED_BY_TRANSPORT.Status != QUIC_STATUS_CONNECTION_IDLE) {
+            printf("Transport Shutdown 0x%x\n", Event->SHUTDOWN_INITIATED_BY_TRANSPORT.Status);
+        }
+        break;
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_PEER:
+        printf("Peer Shutdown 0x%llx\n", Event->SHUTDOWN_INITIATED_BY_PEER.ErrorCode);
+        break;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Function_class_(QUIC_STREAM_CALLBACK)
+QUIC_STATUS
+QUIC_API
+UploadStreamHandler(
+    _In_ HQUIC Stream,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_STREAM_EVENT* Event
+    )
+{
+    UploadStream* Upload = (UploadStream*)Context;
+    switch (Event->Type) {
+    case QUIC_STREAM_EVENT_START_COMPLETE:
+        if (QUIC_SUCCEEDED(Event->START_COMPLETE.Status)) {
+            UploadQueueSends(Upload);
+        }
+        break;
+    case QUIC_STREAM_EVENT_SEND_COMPLETE: {
+        UploadSend* Send = (UploadSend*)Event->SEND_COMPLETE.ClientContext;
+        Upload->CompleteIndex++;
+        Upload->SendCompleteLatencies.push_back(QuicTimeDiff64(Send->StartTime, QuicTimeUs64()));
+        if (Event->SEND_COMPLETE.Canceled) {
+            Upload->Canceled = true;
+        } else {
+            Upload->BytesCompleted += Send->Length;
+            UploadQueueSends(Upload);
+        }
+        break;
+    }
+    case QUIC_STREAM_EVENT_PEER_RECEIVE_ABORTED:
+        printf("Peer stream recv abort (0x%llx)\n", Event->PEER_RECEIVE_ABORTED.ErrorCode);
+        break;
+    case QUIC_STREAM_EVENT_SHUTDOWN_COMPLETE:
+        MsQuic->StreamClose(Stream);
+        if (--Upload->Connection->ActiveStreams == 0) {
+            MsQuic->ConnectionShutdown(
+                Upload->Connection->Handle, QUIC_CONNECTION_SHUTDOWN_FLAG_NONE, 0);
+        }
+        if (--UploadActiveStreams == 0) {
+            UploadEndTime = QuicTimeUs64();
+            QuicEventSet(UploadComplete);
+        }
+        break;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+uint64_t
+Percentile(
+    _In_ const std::vector<uint64_t>& Sorted,
+    _In_ uint32_t Percent
+    )
+{
+    size_t Index = (Sorted.size() * Percent + 99) / 100;
+    return Sorted[Index == 0 ? 0 : Index - 1];
+}
+
+//
+// Uploads generated payloads (no disk I/O) on UploadStreamCount streams on
+// each of UploadConnCount connections, and reports the throughput, CPU cost
+// and send completion latency.
+//
+void
+RunUploadBenchmark(
+    void
+    )
+{
+    if (UploadIoSize == 0) {
+        UploadIoSize = IO_SIZE;
+    }
+    if (UploadOutstanding == 0) {
+        UploadOutstanding = 1;
+    }
+
+    UploadPayload = new uint8_t[UploadIoSize];
+    for (uint32_t i = 0; i < UploadIoSize; ++i) {
+        UploadPayload[i] = (uint8_t)i;
+    }
+
+    QuicEventInitialize(&UploadComplete, TRUE, FALSE);
+
+    HQUIC Registration = nullptr;
+    HQUIC Session = nullptr;
+    const BOOLEAN SendBuffering = UploadBuffered ? TRUE : FALSE;
+
+    EXIT_ON_FAILURE(MsQuicOpen(&MsQuic));
+    const QUIC_REGISTRATION_CONFIG RegConfig = { "post", QUIC_EXECUTION_PROFILE_TYPE_MAX_THROUGHPUT };
+    EXIT_ON_FAILURE(MsQuic->RegistrationOpen(&RegConfig, &Registration));
+    EXIT_ON_FAILURE(MsQuic->SessionOpen(Registration, ALPNs, ARRAYSIZE(ALPNs), nullptr, &Session));
+
+    std::vector<UploadConnection> Connections(UploadConnCount);
+    UploadActiveStreams = UploadConnCount * UploadStreamCount;
+
+    printf("Uploading %llu bytes on %u stream(s) on each of %u connection(s) to %s:%hu (%u byte sends, %u outstanding, buffering %s)\n",
+        (unsigned long long)UploadLength, UploadStreamCount, UploadConnCount, ServerName, Port,
+        UploadIoSize, UploadOutstanding, UploadBuffered ? "on" : "off");
+
+    uint64_t TimeStart = QuicTimeUs64();
+    uint64_t CpuStart = GetProcessCpuTimeUs();
+
+    for (uint32_t i = 0; i < UploadConnCount; ++i) {
+        UploadConnection& Conn = Connections[i];
+        Conn.ActiveStreams = UploadStreamCount;
+        Conn.Streams.resize(UploadStreamCount);
+        EXIT_ON_FAILURE(MsQuic->ConnectionOpen(Session, UploadConnectionHandler, &Conn, &Conn.Handle));
+        EXIT_ON_FAILURE(MsQuic->SetParam(Conn.Handle, QUIC_PARAM_LEVEL_CONNECTION, QUIC_PARAM_CONN_CERT_VALIDATION_FLAGS, sizeof(CertificateValidationFlags), &CertificateValidationFlags));
+        EXIT_ON_FAILURE(MsQuic->SetParam(Conn.Handle, QUIC_PARAM_LEVEL_CONNECTION, QUIC_PARAM_CONN_SEND_BUFFERING, sizeof(SendBuffering), &SendBuffering));
+        for (uint32_t j = 0; j < UploadStreamCount; ++j) {
+            UploadStream& Stream = Conn.Streams[j];
+            Stream.Connection = &Conn;
+            Stream.BytesQueued = 0;
+            Stream.BytesCompleted = 0;
+            Stream.SendIndex = 0;
+            Stream.CompleteIndex = 0;
+            Stream.Canceled = false;
+            Stream.Sends.resize(UploadOutstanding);
+            snprintf(Stream.Header, sizeof(Stream.Header), POST_HEADER_FORMAT, "upload.bin");
+            EXIT_ON_FAILURE(MsQuic->StreamOpen(Conn.Handle, QUIC_STREAM_OPEN_FLAG_UNIDIRECTIONAL, UploadStreamHandler, &Stream, &Stream.Handle));
+            EXIT_ON_FAILURE(MsQuic->StreamStart(Stream.Handle, QUIC_STREAM_START_FLAG_ASYNC));
+        }
+        EXIT_ON_FAILURE(MsQuic->ConnectionStart(Conn.Handle, AF_UNSPEC, ServerName, Port));
+    }
+
+    QuicEventWaitForever(UploadComplete);
+
+    uint64_t CpuUs = GetProcessCpuTimeUs() - CpuStart;
+    uint64_t ElapsedUs = QuicTimeDiff64(TimeStart, UploadEndTime);
+
+    MsQuic->SessionClose(Session);
+    MsQuic->RegistrationClose(Registration);
+    MsQuicClose(MsQuic);
+
+    uint64_t TotalBytesSent = 0;
+    uint32_t CanceledStreams = 0;
+    std::vector<uint64_t> Latencies;
+    for (auto& Conn : Connections) {
+        for (auto& Stream : Conn.Streams) {
+            TotalBytesSent += Stream.BytesCompleted;
+            CanceledStreams += Stream.Canceled ? 1 : 0;
+            Latencies.insert(
+                Latencies.end(),
+                Stream.SendCompleteLatencies.begin(),
+                Stream.SendCompleteLatencies.end());
+        }
+    }
+
+    printf("%llu bytes sent in %llu.%03llu ms (%.3f mbps)\n",
+        (unsigned long long)TotalBytesSent,
+        (unsigned long long)(ElapsedUs / 1000),
+        (unsigned long long)(ElapsedUs % 1000),
+        ElapsedUs == 0 ? 0.0 : (TotalBytesSent * 8.0) / ElapsedUs);
+    printf("CPU: %llu.%03llu ms (%.3f ns/byte)\n",
+        (unsigned long long)(CpuUs / 1000),
+        (unsigned long long)(CpuUs % 1000),
+        TotalBytesSent == 0 ? 0.0 : (CpuUs * 1000.0) / TotalBytesSent);
+    if (!Latencies.empty()) {
+        std::sort(Latencies.begin(), Latencies.end());
+        printf("Send complete latency (us): p50 %llu  p90 %llu  p99 %llu  max %llu (%zu sends)\n",
+            (unsigned long long)Percentile(Latencies, 50),
+            (unsigned long long)Percentile(Latencies, 90),
+            (unsigned long long)Percentile(Latencies, 99),
+            (unsigned long long)Latencies.back(),
+            Latencies.size());
+    }
+    if (CanceledStreams != 0) {
+        printf("%u stream(s) canceled!\n", CanceledStreams);
+    }
+
+    QuicEventUninitialize(UploadComplete);
+    delete [] UploadPayload;
+}
+
 int
 QUIC_MAIN_EXPORT
 main(
@@ -111,17 +432,31 @@ main(
     _In_reads_(argc) _Null_terminated_ char* argv[]
     )
 {
-    if (argc < 2 || !TryGetValue(argc, argv, "file", &FilePath)) {
+    TryGetValue(argc, argv, "upload", &UploadLength);
+    if (argc < 2 || (!TryGetValue(argc, argv, "file", &FilePath) && UploadLength == 0)) {
         printf("Usage: quicpost.exe [-server:<name>] [-ip:<ip>] [-port:<number>] -file:<path>\n");
+        printf("       quicpost.exe [-server:<name>] [-port:<number>] -upload:<bytes per stream> [-conns:<count>] [-streams:<count per conn>] [-iosize:<bytes>] [-outstanding:<sends per stream>] [-buffered:<0/1>]\n");
         exit(1);
     }
 
     TryGetValue(argc, argv, "server", &ServerName);
     TryGetValue(argc, argv, "port", &Port);
+    TryGetValue(argc, argv, "conns", &UploadConnCount);
+    TryGetValue(argc, argv, "streams", &UploadStreamCount);
+    TryGetValue(argc, argv, "iosize", &UploadIoSize);
+    TryGetValue(argc, argv, "outstanding", &UploadOutstanding);
+    TryGetValue(argc, argv, "buffered", &UploadBuffered);
 
     QuicPlatformSystemLoad();
     QuicPlatformInitialize();
 
+    if (UploadLength != 0) {
+        RunUploadBenchmark();
+        QuicPlatformUninitialize();
+        QuicPlatformSystemUnload();
+        return 0;
+    }
+
     File = fopen(FilePath, "rb");
     if (File == nullptr) {
         printf("Failed to open file!\n");
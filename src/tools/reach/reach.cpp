@@ -11,6 +11,8 @@
 #include <vector>
 #include <map>
 #include <mutex>
+#include <condition_variable>
+#include <string>
 #include <algorithm>
 
 #include <quic_datapath.h>
@@ -25,9 +27,32 @@ std::vector<const char*> ALPNs(
       "hq-27", "hq-28", "hq-29",
       "smb" });
 
+const char* TargetsFile = nullptr;
+const char* FanoutAlpn = "h3-29";
+uint32_t MaxInFlight = 100;
+uint64_t IdleTimeoutMs = 10 * 1000;
+
 const QUIC_API_TABLE* MsQuic;
 HQUIC Registration;
 
+//
+// The state of one target in the high-fanout mode.
+//
+struct ReachTarget {
+    std::string Name;
+    uint16_t Port;
+    uint64_t StartTime {0};
+    uint64_t LatencyUs {0};
+    bool Connected {false};
+    const char* Failure {nullptr};
+    QUIC_STATUS Status {QUIC_STATUS_SUCCESS};
+    QUIC_UINT62 PeerErrorCode {0};
+};
+
+std::mutex InFlightLock;
+std::condition_variable InFlightChanged;
+uint32_t InFlight = 0;
+
 extern "C" void QuicTraceRundown(void) { }
 
 _IRQL_requires_max_(PASSIVE_LEVEL)
@@ -57,6 +82,51 @@ ConnectionHandler(
     return QUIC_STATUS_SUCCESS;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+_Function_class_(QUIC_CONNECTION_CALLBACK)
+QUIC_STATUS
+QUIC_API
+FanoutConnectionHandler(
+    _In_ HQUIC Connection,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_CONNECTION_EVENT* Event
+    )
+{
+    ReachTarget* Target = (ReachTarget*)Context;
+    switch (Event->Type) {
+    case QUIC_CONNECTION_EVENT_CONNECTED:
+        Target->Connected = true;
+        Target->LatencyUs = QuicTimeDiff64(Target->StartTime, QuicTimeUs64());
+        MsQuic->ConnectionShutdown(Connection, QUIC_CONNECTION_SHUTDOWN_FLAG_NONE, 0);
+        break;
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_TRANSPORT:
+        if (!Target->Connected) {
+            Target->Failure = "transport";
+            Target->Status = Event->SHUTDOWN_INITIATED_BY_TRANSPORT.Status;
+        }
+        break;
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_PEER:
+        if (!Target->Connected) {
+            Target->Failure = "peer";
+            Target->PeerErrorCode = Event->SHUTDOWN_INITIATED_BY_PEER.ErrorCode;
+        }
+        break;
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_COMPLETE:
+        MsQuic->ConnectionClose(Connection);
+        {
+            std::lock_guard<std::mutex> Lock(InFlightLock);
+            InFlight--;
+        }
+        InFlightChanged.notify_all();
+        break;
+    case QUIC_CONNECTION_EVENT_PEER_STREAM_STARTED:
+        return QUIC_STATUS_NOT_SUPPORTED;
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
 QUIC_THREAD_CALLBACK(TestReachability, Context)
 {
     QUIC_BUFFER Alpn;
@@ -87,7 +157,6 @@ QUIC_THREAD_CALLBACK(TestReachability, Context)
         exit(1);
     }
 
-    uint64_t IdleTimeoutMs = 10 * 1000;
     if (QUIC_FAILED(MsQuic->SetParam(Connection, QUIC_PARAM_LEVEL_CONNECTION, QUIC_PARAM_CONN_IDLE_TIMEOUT, sizeof(IdleTimeoutMs), &IdleTimeoutMs))) {
         printf("SetParam QUIC_PARAM_CONN_IDLE_TIMEOUT failed.\n");
         exit(1);
@@ -109,6 +178,189 @@ QUIC_THREAD_CALLBACK(TestReachability, Context)
     QUIC_THREAD_RETURN(0);
 }
 
+//
+// Tests each ALPN against the one server, all in parallel.
+//
+void
+RunAlpns(
+    void
+    )
+{
+    printf("\n%s:%hu:\n\n", ServerName, Port);
+
+    std::vector<QUIC_THREAD> Threads;
+    QUIC_THREAD_CONFIG Config = { 0, 0, "reach_worker", TestReachability, nullptr };
+
+    for (auto ALPN : ALPNs) {
+        Config.Context = (void*)ALPN;
+        QUIC_THREAD Thread;
+        if (QUIC_FAILED(QuicThreadCreate(&Config, &Thread))) {
+            printf("QuicThreadCreate failed.\n");
+            exit(1);
+        }
+        Threads.push_back(Thread);
+    }
+
+    for (auto Thread : Threads) {
+        QuicThreadWait(&Thread);
+        QuicThreadDelete(&Thread);
+    }
+}
+
+//
+// Reads the targets, one '<name>[:<port>]' per line. Empty lines and lines
+// starting with '#' are skipped. Names with more than one ':' are taken as
+// IPv6 literals without a port.
+//
+bool
+ReadTargets(
+    _In_z_ const char* FileName,
+    _Inout_ std::vector<ReachTarget>& Targets
+    )
+{
+    FILE* File = fopen(FileName, "r");
+    if (File == nullptr) {
+        return false;
+    }
+
+    char Line[512];
+    while (fgets(Line, sizeof(Line), File) != nullptr) {
+        std::string Name(Line);
+        while (!Name.empty() && isspace((unsigned char)Name.back())) {
+            Name.pop_back();
+        }
+        size_t Begin = 0;
+        while (Begin < Name.size() && isspace((unsigned char)Name[Begin])) {
+            Begin++;
+        }
+        Name = Name.substr(Begin);
+        if (Name.empty() || Name[0] == '#') {
+            continue;
+        }
+
+        ReachTarget Target;
+        Target.Port = Port;
+        size_t Colon = Name.find(':');
+        if (Colon != std::string::npos && Name.find(':', Colon + 1) == std::string::npos) {
+            Target.Port = (uint16_t)atoi(Name.c_str() + Colon + 1);
+            Name.resize(Colon);
+        }
+        Target.Name = Name;
+        Targets.push_back(Target);
+    }
+
+    fclose(File);
+    return true;
+}
+
+uint64_t
+Percentile(
+    _In_ const std::vector<uint64_t>& Sorted,
+    _In_ uint32_t Percent
+    )
+{
+    size_t Index = (Sorted.size() * Percent + 99) / 100;
+    return Sorted[Index == 0 ? 0 : Index - 1];
+}
+
+//
+// Runs one handshake per target, with up to MaxInFlight outstanding at a
+// time, all on the one registration (and so its worker pool).
+//
+void
+RunFanout(
+    void
+    )
+{
+    std::vector<ReachTarget> Targets;
+    if (!ReadTargets(TargetsFile, Targets)) {
+        printf("Failed to read targets from '%s'.\n", TargetsFile);
+        exit(1);
+    }
+
+    QUIC_BUFFER Alpn;
+    Alpn.Buffer = (uint8_t*)FanoutAlpn;
+    Alpn.Length = (uint32_t)strlen(FanoutAlpn);
+
+    HQUIC Session = nullptr;
+    if (QUIC_FAILED(MsQuic->SessionOpen(Registration, &Alpn, 1, nullptr, &Session))) {
+        printf("SessionOpen failed.\n");
+        exit(1);
+    }
+
+    if (MaxInFlight == 0) {
+        MaxInFlight = 1;
+    }
+
+    printf("\n%zu targets, %s, %u in flight:\n\n", Targets.size(), FanoutAlpn, MaxInFlight);
+
+    for (auto& Target : Targets) {
+        {
+            std::unique_lock<std::mutex> Lock(InFlightLock);
+            InFlightChanged.wait(Lock, []{ return InFlight < MaxInFlight; });
+            InFlight++;
+        }
+
+        HQUIC Connection = nullptr;
+        if (QUIC_FAILED(MsQuic->ConnectionOpen(Session, FanoutConnectionHandler, &Target, &Connection))) {
+            printf("ConnectionOpen failed.\n");
+            exit(1);
+        }
+
+        if (QUIC_FAILED(MsQuic->SetParam(Connection, QUIC_PARAM_LEVEL_CONNECTION, QUIC_PARAM_CONN_IDLE_TIMEOUT, sizeof(IdleTimeoutMs), &IdleTimeoutMs))) {
+            printf("SetParam QUIC_PARAM_CONN_IDLE_TIMEOUT failed.\n");
+            exit(1);
+        }
+
+        Target.StartTime = QuicTimeUs64();
+        QUIC_STATUS Status = MsQuic->ConnectionStart(Connection, AF_UNSPEC, Target.Name.c_str(), Target.Port);
+        if (QUIC_FAILED(Status)) {
+            Target.Failure = "start";
+            Target.Status = Status;
+            MsQuic->ConnectionClose(Connection);
+            std::lock_guard<std::mutex> Lock(InFlightLock);
+            InFlight--;
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> Lock(InFlightLock);
+        InFlightChanged.wait(Lock, []{ return InFlight == 0; });
+    }
+
+    MsQuic->SessionClose(Session);
+
+    std::vector<uint64_t> Latencies;
+    for (auto& Target : Targets) {
+        if (Target.Connected) {
+            Latencies.push_back(Target.LatencyUs);
+            printf("  %s:%hu    reachable  %llu.%03llu ms\n",
+                Target.Name.c_str(), Target.Port,
+                (unsigned long long)(Target.LatencyUs / 1000),
+                (unsigned long long)(Target.LatencyUs % 1000));
+        } else if (Target.Failure != nullptr && !strcmp(Target.Failure, "peer")) {
+            printf("  %s:%hu  unreachable  peer error 0x%llx\n",
+                Target.Name.c_str(), Target.Port,
+                (unsigned long long)Target.PeerErrorCode);
+        } else {
+            printf("  %s:%hu  unreachable  %s %s (0x%x)\n",
+                Target.Name.c_str(), Target.Port,
+                Target.Failure != nullptr ? Target.Failure : "unknown",
+                QuicStatusToString(Target.Status), (uint32_t)Target.Status);
+        }
+    }
+
+    printf("\n%zu of %zu reachable\n", Latencies.size(), Targets.size());
+    if (!Latencies.empty()) {
+        std::sort(Latencies.begin(), Latencies.end());
+        printf("Handshake latency (ms): p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+            Percentile(Latencies, 50) / 1000.0,
+            Percentile(Latencies, 90) / 1000.0,
+            Percentile(Latencies, 99) / 1000.0,
+            Latencies.back() / 1000.0);
+    }
+}
+
 int
 QUIC_MAIN_EXPORT
 main(int argc, char **argv)
@@ -122,17 +374,25 @@ main(int argc, char **argv)
             !strcmp(argv[1], "help")
         )) {
         printf("Usage: quicreach.exe [-server:<name>] [-ip:<ip>] [-port:<number>]\n");
+        printf("       quicreach.exe -targets:<file> [-alpn:<name>] [-parallel:<count>] [-port:<default port>] [-timeout:<ms>]\n");
         exit(1);
     }
 
     TryGetValue(argc, argv, "server", &ServerName);
     TryGetValue(argc, argv, "ip", &ServerIp);
     TryGetValue(argc, argv, "port", &Port);
+    TryGetValue(argc, argv, "targets", &TargetsFile);
+    TryGetValue(argc, argv, "alpn", &FanoutAlpn);
+    TryGetValue(argc, argv, "parallel", &MaxInFlight);
+    TryGetValue(argc, argv, "timeout", &IdleTimeoutMs);
 
     QuicPlatformSystemLoad();
     QuicPlatformInitialize();
 
-    if (ServerIp == nullptr) {
+    //
+    // In the high-fanout mode, each connection resolves its own target.
+    //
+    if (TargetsFile == nullptr && ServerIp == nullptr) {
         QUIC_DATAPATH* Datapath = nullptr;
         if (QUIC_FAILED(
             QuicDataPathInitialize(
@@ -152,7 +412,7 @@ main(int argc, char **argv)
             exit(1);
         }
         QuicDataPathUninitialize(Datapath);
-    } else {
+    } else if (TargetsFile == nullptr) {
         if (!QuicAddrFromString(ServerIp, Port, &ServerAddress)) {
             printf("QuicAddrFromString failed.\n");
             exit(1);
@@ -170,24 +430,10 @@ main(int argc, char **argv)
         exit(1);
     }
 
-    printf("\n%s:%hu:\n\n", ServerName, Port);
-
-    std::vector<QUIC_THREAD> Threads;
-    QUIC_THREAD_CONFIG Config = { 0, 0, "reach_worker", TestReachability, nullptr };
-
-    for (auto ALPN : ALPNs) {
-        Config.Context = (void*)ALPN;
-        QUIC_THREAD Thread;
-        if (QUIC_FAILED(QuicThreadCreate(&Config, &Thread))) {
-            printf("QuicThreadCreate failed.\n");
-            exit(1);
-        }
-        Threads.push_back(Thread);
-    }
-
-    for (auto Thread : Threads) {
-        QuicThreadWait(&Thread);
-        QuicThreadDelete(&Thread);
+    if (TargetsFile != nullptr) {
+        RunFanout();
+    } else {
+        RunAlpns();
     }
 
     MsQuic->RegistrationClose(Registration);
@@ -9,10 +9,21 @@ Abstract:
 
         https://tools.ietf.org/html/draft-pardue-quic-siduck-00
 
+    With -bench, the client instead measures the datagram send and receive
+    paths: it sends timestamped quacks at a fixed rate (or as fast as it can)
+    on a set of connections from a set of threads, and reports the rate
+    achieved, the loss, and the RTT percentiles and jitter of the echoes. The
+    server echoes each timestamped quack back in a quack-ack, and keeps
+    statistics of its own.
+
 --*/
 
 #include <msquichelper.h>
 
+#undef min // STL headers conflict with previous definitions of min/max.
+#undef max
+#include <algorithm>
+
 const QUIC_REGISTRATION_CONFIG RegConfig = { "siduck", QUIC_EXECUTION_PROFILE_LOW_LATENCY };
 const QUIC_BUFFER Alpn = { sizeof("siduck") - 1, (uint8_t*)"siduck" };
 uint16_t UdpPort = 5000;
@@ -30,6 +41,33 @@ const QUIC_BUFFER QuackAckBuffer = { sizeof("quack-ack") - 1, (uint8_t*)"quack-a
 
 #define SIDUCK_ONLY_QUACKS_ECHO 0x101
 
+//
+// A benchmark quack is "quack" followed by a sequence number, the send time
+// (in us, of the client) and padding. The server echoes everything after the
+// "quack" back after a "quack-ack".
+//
+#define BENCH_HEADER_LENGTH     (sizeof(uint64_t) * 2)
+
+uint32_t BenchConnectionCount = 1;
+uint32_t BenchThreadCount = 1;
+uint32_t BenchRate = 0;                 // Datagrams per second per connection, 0 for unlimited
+uint32_t BenchDurationMs = 10000;
+uint32_t BenchDrainMs = 1000;           // Time to wait for the last echoes
+uint16_t BenchLength = 100;             // Quack length
+uint32_t BenchMaxOutstanding = 256;     // Sends in flight per connection
+uint32_t BenchMaxSamples = 1000000;     // RTT samples over all connections
+
+//
+// Server side statistics, over all connections.
+//
+struct ServerStatistics {
+    int64_t volatile Connections;
+    int64_t volatile QuacksReceived;
+    int64_t volatile AcksSent;
+    int64_t volatile AckSendFailures;
+    int64_t volatile AcksLost;
+} ServerStats;
+
 extern "C" void QuicTraceRundown(void) { }
 
 void
@@ -39,7 +77,46 @@ PrintUsage()
 
     printf("Usage:\n");
     printf("  quicsiduck.exe -client -target:<...> [-unsecure]\n");
+    printf("  quicsiduck.exe -client -bench -target:<...> [-unsecure] [-conns:<1>] [-threads:<1>]\n");
+    printf("                 [-rate:<0>] [-duration:<10000>] [-drain:<1000>] [-length:<100>] [-outstanding:<256>]\n");
     printf("  quicsiduck.exe -server -cert_hash:<...> or (-cert_file:<...> and -key_file:<...>)\n");
+    printf("\n");
+    printf("  -rate is in datagrams per second per connection, 0 to send as fast as possible.\n");
+    printf("  -duration, -drain are in milliseconds. -length is the size of each quack.\n");
+}
+
+//
+// Echoes a benchmark quack. The ack (with its QUIC_BUFFER in front) is freed
+// once its send is complete.
+//
+void
+ServerSendBenchAck(
+    _In_ HQUIC Connection,
+    _In_ const QUIC_BUFFER* Quack
+    )
+{
+    const uint32_t Length = QuackAckBuffer.Length + Quack->Length - QuackBuffer.Length;
+    uint8_t* Ack = new(std::nothrow) uint8_t[sizeof(QUIC_BUFFER) + Length];
+    if (Ack == nullptr) {
+        InterlockedIncrement64(&ServerStats.AckSendFailures);
+        return;
+    }
+
+    QUIC_BUFFER* Buffer = (QUIC_BUFFER*)Ack;
+    Buffer->Length = Length;
+    Buffer->Buffer = Ack + sizeof(QUIC_BUFFER);
+    memcpy(Buffer->Buffer, QuackAckBuffer.Buffer, QuackAckBuffer.Length);
+    memcpy(
+        Buffer->Buffer + QuackAckBuffer.Length,
+        Quack->Buffer + QuackBuffer.Length,
+        Quack->Length - QuackBuffer.Length);
+
+    if (QUIC_FAILED(MsQuic->DatagramSend(Connection, Buffer, 1, QUIC_SEND_FLAG_NONE, Ack))) {
+        InterlockedIncrement64(&ServerStats.AckSendFailures);
+        delete [] Ack;
+    } else {
+        InterlockedIncrement64(&ServerStats.AcksSent);
+    }
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -68,15 +145,30 @@ ServerConnectionCallback(
         printf("[conn][%p] Complete\n", Connection);
         MsQuic->ConnectionClose(Connection);
         break;
+    case QUIC_CONNECTION_EVENT_DATAGRAM_SEND_STATE_CHANGED:
+        if (Event->DATAGRAM_SEND_STATE_CHANGED.ClientContext != nullptr &&
+            QUIC_DATAGRAM_SEND_STATE_IS_FINAL(Event->DATAGRAM_SEND_STATE_CHANGED.State)) {
+            if (Event->DATAGRAM_SEND_STATE_CHANGED.State == QUIC_DATAGRAM_SEND_LOST_DISCARDED) {
+                InterlockedIncrement64(&ServerStats.AcksLost);
+            }
+            delete [] (uint8_t*)Event->DATAGRAM_SEND_STATE_CHANGED.ClientContext;
+        }
+        break;
     case QUIC_CONNECTION_EVENT_DATAGRAM_RECEIVED:
         if (Event->DATAGRAM_RECEIVED.Buffer->Length == QuackBuffer.Length &&
             !memcmp(Event->DATAGRAM_RECEIVED.Buffer->Buffer, QuackBuffer.Buffer, QuackBuffer.Length)) {
             printf("[conn][%p] quack received. Sending quack-ack...\n", Connection);
+            InterlockedIncrement64(&ServerStats.QuacksReceived);
 
             QUIC_STATUS Status;
             if (QUIC_FAILED(Status = MsQuic->DatagramSend(Connection, &QuackAckBuffer, 1, QUIC_SEND_FLAG_NONE, nullptr))) {
                 printf("DatagramSend failed, 0x%x!\n", Status);
+                InterlockedIncrement64(&ServerStats.AckSendFailures);
             }
+        } else if (Event->DATAGRAM_RECEIVED.Buffer->Length >= QuackBuffer.Length + BENCH_HEADER_LENGTH &&
+            !memcmp(Event->DATAGRAM_RECEIVED.Buffer->Buffer, QuackBuffer.Buffer, QuackBuffer.Length)) {
+            InterlockedIncrement64(&ServerStats.QuacksReceived);
+            ServerSendBenchAck(Connection, Event->DATAGRAM_RECEIVED.Buffer);
         } else {
             printf("[conn][%p] Invalid datagram response received\n", Connection);
             MsQuic->ConnectionShutdown(Connection, QUIC_CONNECTION_SHUTDOWN_FLAG_NONE, SIDUCK_ONLY_QUACKS_ECHO);
@@ -109,6 +201,7 @@ ServerListenerCallback(
         }
         Event->NEW_CONNECTION.SecurityConfig = SecurityConfig;
         MsQuic->SetCallbackHandler(Event->NEW_CONNECTION.Connection, (void*)ServerConnectionCallback, nullptr);
+        InterlockedIncrement64(&ServerStats.Connections);
         break;
     }
     default:
@@ -164,6 +257,14 @@ RunServer(
     printf("Press Enter to exit.\n\n");
     getchar();
 
+    printf(
+        "Server: %lld connections, %lld quacks received, %lld acks sent (%lld failed, %lld lost).\n",
+        (long long)ServerStats.Connections,
+        (long long)ServerStats.QuacksReceived,
+        (long long)ServerStats.AcksSent,
+        (long long)ServerStats.AckSendFailures,
+        (long long)ServerStats.AcksLost);
+
 Error:
 
     if (Listener != nullptr) {
@@ -289,6 +390,493 @@ Error:
     }
 }
 
+//
+// A benchmark send, preallocated per connection. Its QUIC_BUFFER references
+// the payload that follows it.
+//
+struct BenchSend {
+    BenchSend* Next;
+    struct BenchConnection* Connection;
+    QUIC_BUFFER Buffer;
+};
+
+struct BenchConnection {
+    HQUIC Connection;
+    QUIC_EVENT ShutdownComplete;
+    bool volatile Connected;
+    uint16_t volatile MaxSendLength;
+
+    //
+    // Updated by the sending thread only.
+    //
+    uint64_t SendStartUs;
+    uint64_t Sent;
+    uint64_t SendFailures;
+
+    //
+    // Sends not in flight.
+    //
+    QUIC_LOCK Lock;
+    BenchSend* FreeSends;
+    uint8_t* SendMemory;
+
+    int64_t volatile Lost;
+    int64_t volatile Canceled;
+
+    //
+    // Updated by the connection's callbacks only, which are serialized.
+    //
+    uint64_t Acked;
+    uint64_t InvalidAcks;
+    uint32_t* Samples;      // RTTs, in us
+    uint32_t SampleCapacity;
+    uint32_t SampleCount;
+    uint32_t LastRtt;
+    uint64_t JitterSum;
+    uint64_t JitterCount;
+};
+
+struct BenchThread {
+    QUIC_THREAD Thread;
+    BenchConnection** Connections;
+    uint32_t ConnectionCount;
+};
+
+BenchConnection* BenchConnections;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_Function_class_(QUIC_CONNECTION_CALLBACK)
+QUIC_STATUS
+QUIC_API
+BenchConnectionCallback(
+    _In_ HQUIC Connection,
+    _In_opt_ void* Context,
+    _Inout_ QUIC_CONNECTION_EVENT* Event
+    )
+{
+    BenchConnection* Conn = (BenchConnection*)Context;
+    switch (Event->Type) {
+    case QUIC_CONNECTION_EVENT_CONNECTED:
+        Conn->Connected = true;
+        break;
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_TRANSPORT:
+        if (Event->SHUTDOWN_INITIATED_BY_TRANSPORT.Status != QUIC_STATUS_CONNECTION_IDLE) {
+            printf("[conn][%p] Shutdown by transport, 0x%x\n", Connection, Event->SHUTDOWN_INITIATED_BY_TRANSPORT.Status);
+        }
+        Conn->Connected = false;
+        break;
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_INITIATED_BY_PEER:
+        printf("[conn][%p] Shutdown by peer, 0x%llx\n", Connection, Event->SHUTDOWN_INITIATED_BY_PEER.ErrorCode);
+        Conn->Connected = false;
+        break;
+    case QUIC_CONNECTION_EVENT_SHUTDOWN_COMPLETE:
+        Conn->Connected = false;
+        QuicEventSet(Conn->ShutdownComplete);
+        break;
+    case QUIC_CONNECTION_EVENT_DATAGRAM_STATE_CHANGED:
+        Conn->MaxSendLength =
+            Event->DATAGRAM_STATE_CHANGED.SendEnabled ?
+                Event->DATAGRAM_STATE_CHANGED.MaxSendLength : 0;
+        break;
+    case QUIC_CONNECTION_EVENT_DATAGRAM_SEND_STATE_CHANGED:
+        if (QUIC_DATAGRAM_SEND_STATE_IS_FINAL(Event->DATAGRAM_SEND_STATE_CHANGED.State)) {
+            BenchSend* Send = (BenchSend*)Event->DATAGRAM_SEND_STATE_CHANGED.ClientContext;
+            if (Event->DATAGRAM_SEND_STATE_CHANGED.State == QUIC_DATAGRAM_SEND_LOST_DISCARDED) {
+                InterlockedIncrement64(&Conn->Lost);
+            } else if (Event->DATAGRAM_SEND_STATE_CHANGED.State == QUIC_DATAGRAM_SEND_CANCELED) {
+                InterlockedIncrement64(&Conn->Canceled);
+            }
+            QuicLockAcquire(&Conn->Lock);
+            Send->Next = Conn->FreeSends;
+            Conn->FreeSends = Send;
+            QuicLockRelease(&Conn->Lock);
+        }
+        break;
+    case QUIC_CONNECTION_EVENT_DATAGRAM_RECEIVED: {
+        const QUIC_BUFFER* Ack = Event->DATAGRAM_RECEIVED.Buffer;
+        if (Ack->Length < QuackAckBuffer.Length + BENCH_HEADER_LENGTH ||
+            memcmp(Ack->Buffer, QuackAckBuffer.Buffer, QuackAckBuffer.Length)) {
+            Conn->InvalidAcks++;
+            break;
+        }
+        uint64_t SendTimeUs;
+        memcpy(&SendTimeUs, Ack->Buffer + QuackAckBuffer.Length + sizeof(uint64_t), sizeof(SendTimeUs));
+        uint64_t Rtt = QuicTimeDiff64(SendTimeUs, QuicTimeUs64());
+        if (Rtt > UINT32_MAX) {
+            Rtt = UINT32_MAX;
+        }
+
+        if (Conn->Acked != 0) {
+            Conn->JitterSum += Rtt > Conn->LastRtt ? Rtt - Conn->LastRtt : Conn->LastRtt - Rtt;
+            Conn->JitterCount++;
+        }
+        Conn->LastRtt = (uint32_t)Rtt;
+        Conn->Acked++;
+        if (Conn->SampleCount < Conn->SampleCapacity) {
+            Conn->Samples[Conn->SampleCount++] = (uint32_t)Rtt;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return QUIC_STATUS_SUCCESS;
+}
+
+bool
+BenchSendQuack(
+    _In_ BenchConnection* Conn
+    )
+{
+    QuicLockAcquire(&Conn->Lock);
+    BenchSend* Send = Conn->FreeSends;
+    if (Send != nullptr) {
+        Conn->FreeSends = Send->Next;
+    }
+    QuicLockRelease(&Conn->Lock);
+
+    if (Send == nullptr) {
+        return false; // Too many sends in flight.
+    }
+
+    uint64_t Sequence = Conn->Sent;
+    uint64_t SendTimeUs = QuicTimeUs64();
+    memcpy(Send->Buffer.Buffer + QuackBuffer.Length, &Sequence, sizeof(Sequence));
+    memcpy(Send->Buffer.Buffer + QuackBuffer.Length + sizeof(Sequence), &SendTimeUs, sizeof(SendTimeUs));
+
+    if (QUIC_FAILED(MsQuic->DatagramSend(Conn->Connection, &Send->Buffer, 1, QUIC_SEND_FLAG_NONE, Send))) {
+        Conn->SendFailures++;
+        QuicLockAcquire(&Conn->Lock);
+        Send->Next = Conn->FreeSends;
+        Conn->FreeSends = Send;
+        QuicLockRelease(&Conn->Lock);
+        return false;
+    }
+
+    Conn->Sent++;
+    return true;
+}
+
+QUIC_THREAD_CALLBACK(BenchSendThread, Context)
+{
+    BenchThread* Thread = (BenchThread*)Context;
+    const uint64_t EndUs = QuicTimeUs64() + MS_TO_US((uint64_t)BenchDurationMs);
+
+    uint64_t TimeNow;
+    while ((TimeNow = QuicTimeUs64()) < EndUs) {
+        for (uint32_t i = 0; i < Thread->ConnectionCount; ++i) {
+            BenchConnection* Conn = Thread->Connections[i];
+            if (!Conn->Connected) {
+                continue;
+            }
+            if (Conn->SendStartUs == 0) {
+                Conn->SendStartUs = TimeNow;
+            }
+            uint64_t Due =
+                BenchRate == 0 ?
+                    UINT64_MAX :
+                    (QuicTimeDiff64(Conn->SendStartUs, TimeNow) * BenchRate) / (1000 * 1000);
+            while (Conn->Sent < Due && BenchSendQuack(Conn)) {
+            }
+        }
+        if (BenchRate != 0) {
+            QuicSleep(1);
+        }
+    }
+
+    QUIC_THREAD_RETURN(0);
+}
+
+static
+uint32_t
+BenchPercentile(
+    _In_reads_(Count) const uint32_t* Sorted,
+    _In_ uint64_t Count,
+    _In_ uint32_t PerMille
+    )
+{
+    if (Count == 0) {
+        return 0;
+    }
+    uint64_t Index = (Count * PerMille) / 1000;
+    return Sorted[Index >= Count ? Count - 1 : Index];
+}
+
+void
+BenchPrintResults(
+    _In_ uint64_t ElapsedUs
+    )
+{
+    uint64_t Sent = 0, SendFailures = 0, Acked = 0, InvalidAcks = 0;
+    uint64_t Lost = 0, Canceled = 0, JitterSum = 0, JitterCount = 0, SampleCount = 0;
+    for (uint32_t i = 0; i < BenchConnectionCount; ++i) {
+        BenchConnection* Conn = &BenchConnections[i];
+        Sent += Conn->Sent;
+        SendFailures += Conn->SendFailures;
+        Acked += Conn->Acked;
+        InvalidAcks += Conn->InvalidAcks;
+        Lost += (uint64_t)Conn->Lost;
+        Canceled += (uint64_t)Conn->Canceled;
+        JitterSum += Conn->JitterSum;
+        JitterCount += Conn->JitterCount;
+        SampleCount += Conn->SampleCount;
+    }
+
+    //
+    // The samples of all the connections were allocated together, so compact
+    // them to the front of the first connection's array.
+    //
+    uint32_t* Samples = BenchConnections[0].Samples;
+    uint64_t Recorded = 0;
+    for (uint32_t i = 0; i < BenchConnectionCount; ++i) {
+        memmove(Samples + Recorded, BenchConnections[i].Samples, BenchConnections[i].SampleCount * sizeof(uint32_t));
+        Recorded += BenchConnections[i].SampleCount;
+    }
+    std::sort(Samples, Samples + Recorded);
+
+    if (ElapsedUs == 0) {
+        ElapsedUs = 1;
+    }
+
+    printf(
+        "Result: %llu quacks/s sent, %llu quack-acks/s received after %u ms.\n",
+        (unsigned long long)(Sent * 1000 * 1000 / ElapsedUs),
+        (unsigned long long)(Acked * 1000 * 1000 / ElapsedUs),
+        (uint32_t)(ElapsedUs / 1000));
+    printf(
+        "  %llu sent (%llu send failures), %llu acked (%.2f%% loss), %llu lost, %llu canceled, %llu invalid.\n",
+        (unsigned long long)Sent,
+        (unsigned long long)SendFailures,
+        (unsigned long long)Acked,
+        Sent == 0 ? 0.0 : ((double)(Sent > Acked ? Sent - Acked : 0) * 100) / Sent,
+        (unsigned long long)Lost,
+        (unsigned long long)Canceled,
+        (unsigned long long)InvalidAcks);
+    printf(
+        "  RTT (us): Min %u, P50 %u, P90 %u, P99 %u, P99.9 %u, Max %u. Jitter %llu us.\n",
+        Recorded == 0 ? 0 : Samples[0],
+        BenchPercentile(Samples, Recorded, 500),
+        BenchPercentile(Samples, Recorded, 900),
+        BenchPercentile(Samples, Recorded, 990),
+        BenchPercentile(Samples, Recorded, 999),
+        Recorded == 0 ? 0 : Samples[Recorded - 1],
+        (unsigned long long)(JitterCount == 0 ? 0 : JitterSum / JitterCount));
+
+    //
+    // The JSON summary is printed on a single line so that it can be matched
+    // by scripts.
+    //
+    printf(
+        "{\"Connections\":%u,\"Threads\":%u,\"Rate\":%u,\"Length\":%u,\"DurationMs\":%u,"
+        "\"Sent\":%llu,\"Acked\":%llu,\"SendPerSec\":%llu,\"AckPerSec\":%llu,"
+        "\"RttUs\":{\"Min\":%u,\"P50\":%u,\"P90\":%u,\"P99\":%u,\"P999\":%u,\"Max\":%u},"
+        "\"JitterUs\":%llu,\"SamplesDropped\":%llu}\n",
+        BenchConnectionCount,
+        BenchThreadCount,
+        BenchRate,
+        BenchLength,
+        (uint32_t)(ElapsedUs / 1000),
+        (unsigned long long)Sent,
+        (unsigned long long)Acked,
+        (unsigned long long)(Sent * 1000 * 1000 / ElapsedUs),
+        (unsigned long long)(Acked * 1000 * 1000 / ElapsedUs),
+        Recorded == 0 ? 0 : Samples[0],
+        BenchPercentile(Samples, Recorded, 500),
+        BenchPercentile(Samples, Recorded, 900),
+        BenchPercentile(Samples, Recorded, 990),
+        BenchPercentile(Samples, Recorded, 999),
+        Recorded == 0 ? 0 : Samples[Recorded - 1],
+        (unsigned long long)(JitterCount == 0 ? 0 : JitterSum / JitterCount),
+        (unsigned long long)(Acked - SampleCount));
+}
+
+void
+RunBenchClient(
+    _In_ int argc,
+    _In_reads_(argc) _Null_terminated_ char* argv[]
+    )
+{
+    const char* Target;
+    if (!TryGetValue(argc, argv, "target", &Target)) {
+        printf("Must specify '-target' argument!\n");
+        return;
+    }
+
+    TryGetValue(argc, argv, "conns", &BenchConnectionCount);
+    TryGetValue(argc, argv, "threads", &BenchThreadCount);
+    TryGetValue(argc, argv, "rate", &BenchRate);
+    TryGetValue(argc, argv, "duration", &BenchDurationMs);
+    TryGetValue(argc, argv, "drain", &BenchDrainMs);
+    TryGetValue(argc, argv, "length", &BenchLength);
+    TryGetValue(argc, argv, "outstanding", &BenchMaxOutstanding);
+    if (BenchConnectionCount == 0) {
+        BenchConnectionCount = 1;
+    }
+    if (BenchThreadCount == 0) {
+        BenchThreadCount = 1;
+    } else if (BenchThreadCount > BenchConnectionCount) {
+        BenchThreadCount = BenchConnectionCount;
+    }
+    if (BenchMaxOutstanding == 0) {
+        BenchMaxOutstanding = 1;
+    }
+    if (BenchLength < QuackBuffer.Length + BENCH_HEADER_LENGTH) {
+        BenchLength = (uint16_t)(QuackBuffer.Length + BENCH_HEADER_LENGTH);
+    }
+
+    const uint32_t SendSize = (sizeof(BenchSend) + BenchLength + 7) & ~7u;
+    const uint32_t SampleCapacity = BenchMaxSamples / BenchConnectionCount;
+    uint32_t* Samples = new(std::nothrow) uint32_t[(size_t)SampleCapacity * BenchConnectionCount + 1];
+    BenchConnections = new(std::nothrow) BenchConnection[BenchConnectionCount];
+    BenchThread* Threads = new(std::nothrow) BenchThread[BenchThreadCount];
+    BenchConnection** ThreadConnections = new(std::nothrow) BenchConnection*[BenchConnectionCount];
+    if (Samples == nullptr || BenchConnections == nullptr || Threads == nullptr || ThreadConnections == nullptr) {
+        printf("Failed to allocate benchmark state!\n");
+        delete [] Samples;
+        delete [] BenchConnections;
+        delete [] Threads;
+        delete [] ThreadConnections;
+        return;
+    }
+    memset(BenchConnections, 0, sizeof(BenchConnection) * BenchConnectionCount);
+
+    const BOOLEAN EnableDatagrams = TRUE;
+    const uint32_t CertificateValidationFlags = QUIC_CERTIFICATE_FLAG_DISABLE_CERT_VALIDATION;
+    const bool Unsecure = GetValue(argc, argv, "unsecure");
+    uint32_t Opened = 0;
+    uint64_t StartUs, ElapsedUs;
+
+    for (; Opened < BenchConnectionCount; ++Opened) {
+        BenchConnection* Conn = &BenchConnections[Opened];
+        QuicEventInitialize(&Conn->ShutdownComplete, TRUE, FALSE);
+        QuicLockInitialize(&Conn->Lock);
+        Conn->Samples = Samples + (size_t)SampleCapacity * Opened;
+        Conn->SampleCapacity = SampleCapacity;
+
+        Conn->SendMemory = new(std::nothrow) uint8_t[(size_t)SendSize * BenchMaxOutstanding];
+        if (Conn->SendMemory == nullptr) {
+            printf("Failed to allocate send buffers!\n");
+            goto Error;
+        }
+        for (uint32_t i = 0; i < BenchMaxOutstanding; ++i) {
+            BenchSend* Send = (BenchSend*)(Conn->SendMemory + (size_t)SendSize * i);
+            Send->Connection = Conn;
+            Send->Buffer.Length = BenchLength;
+            Send->Buffer.Buffer = (uint8_t*)(Send + 1);
+            memcpy(Send->Buffer.Buffer, QuackBuffer.Buffer, QuackBuffer.Length);
+            memset(Send->Buffer.Buffer + QuackBuffer.Length, 0, BenchLength - QuackBuffer.Length);
+            Send->Next = Conn->FreeSends;
+            Conn->FreeSends = Send;
+        }
+
+        QUIC_STATUS Status;
+        if (QUIC_FAILED(Status = MsQuic->ConnectionOpen(Session, BenchConnectionCallback, Conn, &Conn->Connection))) {
+            printf("ConnectionOpen failed, 0x%x!\n", Status);
+            goto Error;
+        }
+        if (QUIC_FAILED(Status = MsQuic->SetParam(
+                Conn->Connection, QUIC_PARAM_LEVEL_CONNECTION, QUIC_PARAM_CONN_DATAGRAM_RECEIVE_ENABLED,
+                sizeof(EnableDatagrams), &EnableDatagrams))) {
+            printf("SetParam(QUIC_PARAM_CONN_DATAGRAM_RECEIVE_ENABLED) failed, 0x%x!\n", Status);
+            goto Error;
+        }
+        if (Unsecure &&
+            QUIC_FAILED(Status = MsQuic->SetParam(
+                Conn->Connection, QUIC_PARAM_LEVEL_CONNECTION, QUIC_PARAM_CONN_CERT_VALIDATION_FLAGS,
+                sizeof(CertificateValidationFlags), &CertificateValidationFlags))) {
+            printf("SetParam(QUIC_PARAM_CONN_CERT_VALIDATION_FLAGS) failed, 0x%x!\n", Status);
+            goto Error;
+        }
+        if (QUIC_FAILED(Status = MsQuic->ConnectionStart(Conn->Connection, AF_UNSPEC, Target, UdpPort))) {
+            printf("ConnectionStart failed, 0x%x!\n", Status);
+            goto Error;
+        }
+    }
+
+    //
+    // Wait (a bit) for all the connections to be ready to send datagrams.
+    //
+    for (uint32_t Waited = 0; Waited < 5000; Waited += 10) {
+        uint32_t Ready = 0;
+        for (uint32_t i = 0; i < BenchConnectionCount; ++i) {
+            if (BenchConnections[i].Connected && BenchConnections[i].MaxSendLength != 0) {
+                Ready++;
+            }
+        }
+        if (Ready == BenchConnectionCount) {
+            break;
+        }
+        QuicSleep(10);
+    }
+    for (uint32_t i = 0; i < BenchConnectionCount; ++i) {
+        if (BenchConnections[i].MaxSendLength != 0 &&
+            BenchConnections[i].MaxSendLength < BenchLength) {
+            printf("Quack length %hu is larger than the max datagram length %hu!\n",
+                BenchLength, (uint16_t)BenchConnections[i].MaxSendLength);
+            goto Error;
+        }
+    }
+
+    printf("Sending quacks on %u connections from %u threads for %u ms...\n",
+        BenchConnectionCount, BenchThreadCount, BenchDurationMs);
+
+    //
+    // Split the connections between the threads, the first ones taking one
+    // more if they don't divide evenly.
+    //
+    for (uint32_t i = 0, Next = 0; i < BenchThreadCount; ++i) {
+        uint32_t Count =
+            BenchConnectionCount / BenchThreadCount +
+            (i < BenchConnectionCount % BenchThreadCount ? 1 : 0);
+        Threads[i].Connections = ThreadConnections + Next;
+        Threads[i].ConnectionCount = Count;
+        for (uint32_t j = 0; j < Count; ++j, ++Next) {
+            ThreadConnections[Next] = &BenchConnections[Next];
+        }
+    }
+
+    StartUs = QuicTimeUs64();
+    for (uint32_t i = 0; i < BenchThreadCount; ++i) {
+        QUIC_THREAD_CONFIG ThreadConfig = { 0, 0, "siduck_bench", BenchSendThread, &Threads[i] };
+        if (QUIC_FAILED(QuicThreadCreate(&ThreadConfig, &Threads[i].Thread))) {
+            printf("QuicThreadCreate failed!\n");
+            exit(1);
+        }
+    }
+    for (uint32_t i = 0; i < BenchThreadCount; ++i) {
+        QuicThreadWait(&Threads[i].Thread);
+        QuicThreadDelete(&Threads[i].Thread);
+    }
+    ElapsedUs = QuicTimeDiff64(StartUs, QuicTimeUs64());
+
+    QuicSleep(BenchDrainMs); // Wait for the last quack-acks.
+
+    for (uint32_t i = 0; i < BenchConnectionCount; ++i) {
+        MsQuic->ConnectionShutdown(BenchConnections[i].Connection, QUIC_CONNECTION_SHUTDOWN_FLAG_NONE, 0);
+    }
+    for (uint32_t i = 0; i < BenchConnectionCount; ++i) {
+        QuicEventWaitForever(BenchConnections[i].ShutdownComplete);
+    }
+
+    BenchPrintResults(ElapsedUs);
+
+Error:
+
+    for (uint32_t i = 0; i < Opened + (Opened < BenchConnectionCount ? 1 : 0); ++i) {
+        BenchConnection* Conn = &BenchConnections[i];
+        if (Conn->Connection != nullptr) {
+            MsQuic->ConnectionClose(Conn->Connection); // Waits for the sends to complete.
+        }
+        delete [] Conn->SendMemory;
+        QuicLockUninitialize(&Conn->Lock);
+        QuicEventUninitialize(Conn->ShutdownComplete);
+    }
+    delete [] Samples;
+    delete [] BenchConnections;
+    delete [] Threads;
+    delete [] ThreadConnections;
+}
+
 int
 QUIC_MAIN_EXPORT
 main(
@@ -335,6 +923,8 @@ main(
     if (GetValue(argc, argv, "help") ||
         GetValue(argc, argv, "?")) {
         PrintUsage();
+    } else if (GetValue(argc, argv, "client") && GetValue(argc, argv, "bench")) {
+        RunBenchClient(argc, argv);
     } else if (GetValue(argc, argv, "client")) {
         RunClient(argc, argv);
     } else if (GetValue(argc, argv, "server")) {
@@ -11,6 +11,7 @@
 #include <vector>
 #include <map>
 #include <mutex>
+#include <atomic>
 #include <algorithm>
 
 #define QUIC_TEST_APIS 1 // Needed for self signed cert API
@@ -120,6 +121,86 @@ typedef enum {
     SpinQuicAPICallCount    // Always the last element
 } SpinQuicAPICall;
 
+const char* SpinQuicAPICallNames[SpinQuicAPICallCount] = {
+    "ConnectionOpen",
+    "ConnectionStart",
+    "ConnectionShutdown",
+    "ConnectionClose",
+    "StreamOpen",
+    "StreamStart",
+    "StreamSend",
+    "StreamShutdown",
+    "StreamClose",
+    "SetParam(Session)",
+    "SetParam(Connection)",
+    "DatagramSend"
+};
+
+//
+// Latency statistics, in microseconds, updated concurrently by the spin
+// threads and the callbacks. Percentiles are estimated from power of two
+// buckets.
+//
+class SpinQuicLatency {
+    static const uint32_t BucketCount = 32;
+    std::atomic<uint64_t> Count;
+    std::atomic<uint64_t> TotalUs;
+    std::atomic<uint64_t> MaxUs;
+    std::atomic<uint64_t> Buckets[BucketCount];
+    uint64_t Percentile(uint64_t Total, uint32_t Percent) const {
+        uint64_t Target = (Total * Percent + 99) / 100;
+        uint64_t Sum = 0;
+        for (uint32_t i = 0; i < BucketCount; ++i) {
+            Sum += Buckets[i];
+            if (Sum >= Target) {
+                return (1ull << i) - 1; // Upper bound of the bucket.
+            }
+        }
+        return MaxUs;
+    }
+public:
+    void Reset() {
+        Count = 0;
+        TotalUs = 0;
+        MaxUs = 0;
+        for (uint32_t i = 0; i < BucketCount; ++i) {
+            Buckets[i] = 0;
+        }
+    }
+    void Add(uint64_t LatencyUs) {
+        uint32_t Bucket = 0;
+        while (Bucket < BucketCount - 1 && (1ull << Bucket) <= LatencyUs) {
+            ++Bucket;
+        }
+        ++Buckets[Bucket];
+        ++Count;
+        TotalUs += LatencyUs;
+        uint64_t Max = MaxUs;
+        while (LatencyUs > Max && !MaxUs.compare_exchange_weak(Max, LatencyUs)) { }
+    }
+    void Record(uint64_t StartUs) {
+        Add(QuicTimeDiff64(StartUs, QuicTimeUs64()));
+    }
+    void Print(const char* Name) const {
+        uint64_t Total = Count;
+        if (Total == 0) {
+            return;
+        }
+        printf("  %-24s %10llu %10llu %10llu %10llu %10llu\n",
+            Name,
+            (unsigned long long)Total,
+            (unsigned long long)(TotalUs / Total),
+            (unsigned long long)Percentile(Total, 50),
+            (unsigned long long)Percentile(Total, 99),
+            (unsigned long long)MaxUs);
+    }
+};
+
+static SpinQuicLatency ApiLatency[SpinQuicAPICallCount];
+static SpinQuicLatency ConnectionCallbackLatency;
+static SpinQuicLatency StreamCallbackLatency;
+static SpinQuicLatency StreamStartDelay; // StreamStart to START_COMPLETE
+
 class SpinQuicConnection {
 public:
     std::mutex Lock;
@@ -195,13 +276,26 @@ static struct {
     std::vector<uint16_t> Ports;
     const char* ServerName;
     uint8_t LossPercent;
+    uint32_t ClientThreadCount;
+    uint32_t OpsPerSecond; // Per spin thread; 0 is unlimited.
+    uint8_t PrintStats;
 } Settings;
 
 extern "C" void QuicTraceRundown(void) { }
 
-QUIC_STATUS QUIC_API SpinQuicHandleStreamEvent(HQUIC Stream, void * /* Context */, QUIC_STREAM_EVENT *Event)
+QUIC_STATUS QUIC_API SpinQuicHandleStreamEvent(HQUIC Stream, void * Context, QUIC_STREAM_EVENT *Event)
 {
+    uint64_t StartUs = QuicTimeUs64();
+
     switch (Event->Type) {
+    case QUIC_STREAM_EVENT_START_COMPLETE:
+        //
+        // The context holds the time StreamStart was called.
+        //
+        if (Context != nullptr) {
+            StreamStartDelay.Add(QuicTimeDiff64((uint64_t)(uintptr_t)Context, StartUs));
+        }
+        break;
     case QUIC_STREAM_EVENT_PEER_SEND_SHUTDOWN:
         MsQuic->StreamShutdown(Stream, (QUIC_STREAM_SHUTDOWN_FLAGS)GetRandom(16), 0);
         break;
@@ -209,11 +303,14 @@ QUIC_STATUS QUIC_API SpinQuicHandleStreamEvent(HQUIC Stream, void * /* Context *
         break;
     }
 
+    StreamCallbackLatency.Record(StartUs);
     return QUIC_STATUS_SUCCESS;
 }
 
 QUIC_STATUS QUIC_API SpinQuicHandleConnectionEvent(HQUIC Connection, void * /* Context */, QUIC_CONNECTION_EVENT *Event)
 {
+    uint64_t StartUs = QuicTimeUs64();
+
     switch (Event->Type) {
     case QUIC_CONNECTION_EVENT_CONNECTED: {
         int Selector = GetRandom(3);
@@ -256,6 +353,7 @@ QUIC_STATUS QUIC_API SpinQuicHandleConnectionEvent(HQUIC Connection, void * /* C
         break;
     }
 
+    ConnectionCallbackLatency.Record(StartUs);
     return QUIC_STATUS_SUCCESS;
 }
 
@@ -336,7 +434,9 @@ void SpinQuicSetRandomSesssioParam(HQUIC Session)
     SetParamHelper Helper(QUIC_PARAM_LEVEL_SESSION);
     uint8_t TlsTicket[44];
 
-    switch (GetRandom(8)) {
+    uint8_t TlsTickets[44 * 2];
+
+    switch (GetRandom(11)) {
     case QUIC_PARAM_SESSION_TLS_TICKET_KEY:                         // uint8_t[44]
         QuicRandom(sizeof(TlsTicket), TlsTicket);
         Helper.SetPtr(QUIC_PARAM_SESSION_TLS_TICKET_KEY, TlsTicket, sizeof(TlsTicket));
@@ -362,6 +462,15 @@ void SpinQuicSetRandomSesssioParam(HQUIC Session)
     case QUIC_PARAM_SESSION_DATAGRAM_RECEIVE_ENABLED:               // uint8_t (BOOLEAN)
         Helper.SetUint8(QUIC_PARAM_SESSION_DATAGRAM_RECEIVE_ENABLED, GetRandom(2));
         break;
+    case QUIC_PARAM_SESSION_SERVER_RESUMPTION_LEVEL:                // QUIC_SERVER_RESUMPTION_LEVEL
+        break; // Not fuzzed
+    case QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM:           // uint16_t - QUIC_CONGESTION_CONTROL_ALGORITHM
+        Helper.SetUint16(QUIC_PARAM_SESSION_CONGESTION_CONTROL_ALGORITHM, (uint16_t)GetRandom(QUIC_CONGESTION_CONTROL_ALGORITHM_COUNT));
+        break;
+    case QUIC_PARAM_SESSION_TLS_TICKET_KEYS:                        // uint8_t[44 * N]
+        QuicRandom(sizeof(TlsTickets), TlsTickets);
+        Helper.SetPtr(QUIC_PARAM_SESSION_TLS_TICKET_KEYS, TlsTickets, 44 * (1 + GetRandom(2)));
+        break;
     default:
         break;
     }
@@ -372,8 +481,9 @@ void SpinQuicSetRandomSesssioParam(HQUIC Session)
 void SpinQuicSetRandomConnectionParam(HQUIC Connection)
 {
     SetParamHelper Helper(QUIC_PARAM_LEVEL_CONNECTION);
+    QUIC_ADDR PathAddr = { 0 };
 
-    switch (GetRandom(23)) {
+    switch (GetRandom(32)) {
     case QUIC_PARAM_CONN_QUIC_VERSION:                              // uint32_t
         Helper.SetUint32(QUIC_PARAM_CONN_QUIC_VERSION, GetRandom(UINT32_MAX));
         break;
@@ -431,6 +541,35 @@ void SpinQuicSetRandomConnectionParam(HQUIC Connection)
         break;
     case QUIC_PARAM_CONN_DATAGRAM_SEND_ENABLED:                     // uint8_t (BOOLEAN)
         break; // Get Only
+    case QUIC_PARAM_CONN_CONGESTION_CONTROL_ALGORITHM:              // uint16_t - QUIC_CONGESTION_CONTROL_ALGORITHM
+        Helper.SetUint16(QUIC_PARAM_CONN_CONGESTION_CONTROL_ALGORITHM, (uint16_t)GetRandom(QUIC_CONGESTION_CONTROL_ALGORITHM_COUNT));
+        break;
+    case QUIC_PARAM_CONN_STATISTICS_HISTOGRAMS:                     // QUIC_STATISTICS_HISTOGRAMS
+        break; // Get Only
+    case QUIC_PARAM_CONN_DATAGRAM_RECEIVE_LENDING:                  // uint8_t (BOOLEAN)
+        Helper.SetUint8(QUIC_PARAM_CONN_DATAGRAM_RECEIVE_LENDING, GetRandom(2));
+        break;
+    case QUIC_PARAM_CONN_MULTIPATH_ENABLED:                         // uint8_t (BOOLEAN)
+        Helper.SetUint8(QUIC_PARAM_CONN_MULTIPATH_ENABLED, GetRandom(2));
+        break;
+    case QUIC_PARAM_CONN_ADD_PATH:                                  // QUIC_ADDR
+        QuicAddrSetFamily(&PathAddr, GetRandom(2) ? AF_INET : AF_INET6);
+        QuicAddrSetToLoopback(&PathAddr);
+        QuicAddrSetPort(&PathAddr, GetRandomFromVector(Settings.Ports));
+        Helper.SetPtr(QUIC_PARAM_CONN_ADD_PATH, &PathAddr, sizeof(PathAddr));
+        break;
+    case QUIC_PARAM_CONN_LATENCY_SENSITIVE:                         // uint8_t (BOOLEAN)
+        Helper.SetUint8(QUIC_PARAM_CONN_LATENCY_SENSITIVE, GetRandom(2));
+        break;
+    case QUIC_PARAM_CONN_ARENA_ENABLED:                             // uint8_t (BOOLEAN)
+        Helper.SetUint8(QUIC_PARAM_CONN_ARENA_ENABLED, GetRandom(2));
+        break;
+    case QUIC_PARAM_CONN_SEND_CORK_US:                              // uint32_t - microseconds
+        Helper.SetUint32(QUIC_PARAM_CONN_SEND_CORK_US, GetRandom(2000));
+        break;
+    case QUIC_PARAM_CONN_RECEIVE_BATCH_ENABLED:                     // uint8_t (BOOLEAN)
+        Helper.SetUint8(QUIC_PARAM_CONN_RECEIVE_BATCH_ENABLED, GetRandom(2));
+        break;
     default:
         break;
     }
@@ -444,6 +583,17 @@ void Spin(LockableVector<HQUIC>& Connections, bool IsServer)
     while (++OpCount != Settings.MaxOperationCount &&
         QuicTimeDiff64(StartTimeMs, QuicTimeMs64()) < Settings.RunTimeMs) {
 
+        if (Settings.OpsPerSecond != 0) {
+            //
+            // Don't get ahead of the requested rate.
+            //
+            while (OpCount * 1000 >
+                   QuicTimeDiff64(StartTimeMs, QuicTimeMs64()) * Settings.OpsPerSecond &&
+                   QuicTimeDiff64(StartTimeMs, QuicTimeMs64()) < Settings.RunTimeMs) {
+                QuicSleep(1);
+            }
+        }
+
     #define BAIL_ON_NULL_CONNECTION(Connection) \
         if (Connection == nullptr) { \
             if (IsServer) { \
@@ -452,7 +602,10 @@ void Spin(LockableVector<HQUIC>& Connections, bool IsServer)
             continue; \
         }
 
-        switch (GetRandom(SpinQuicAPICallCount)) {
+        auto ApiCall = (SpinQuicAPICall)GetRandom(SpinQuicAPICallCount);
+        uint64_t StartUs;
+
+        switch (ApiCall) {
         case SpinQuicAPICallCreateConnection:
             if (!IsServer) {
                 auto ctx = new SpinQuicConnection();
@@ -460,13 +613,16 @@ void Spin(LockableVector<HQUIC>& Connections, bool IsServer)
 
                 HQUIC Connection;
                 HQUIC Session = GetRandomFromVector(Sessions);
+                StartUs = QuicTimeUs64();
                 QUIC_STATUS Status = MsQuic->ConnectionOpen(Session, SpinQuicHandleConnectionEvent, ctx, &Connection);
+                ApiLatency[ApiCall].Record(StartUs);
                 if (QUIC_SUCCEEDED(Status)) {
                     ctx->Set(Connection);
                     if (GetRandom(2)) {
                         uint32_t DisableCertValidation = QUIC_CERTIFICATE_FLAG_DISABLE_CERT_VALIDATION;
                         MsQuic->SetParam(Connection, QUIC_PARAM_LEVEL_CONNECTION, QUIC_PARAM_CONN_CERT_VALIDATION_FLAGS, sizeof(uint32_t), &DisableCertValidation);
                     }
+                    std::lock_guard<std::mutex> Lock(Connections);
                     Connections.push_back(Connection);
                 } else {
                     delete ctx;
@@ -476,26 +632,34 @@ void Spin(LockableVector<HQUIC>& Connections, bool IsServer)
         case SpinQuicAPICallStartConnection: {
             auto Connection = Connections.TryGetRandom();
             BAIL_ON_NULL_CONNECTION(Connection);
+            StartUs = QuicTimeUs64();
             MsQuic->ConnectionStart(Connection, AF_INET, Settings.ServerName, GetRandomFromVector(Settings.Ports));
+            ApiLatency[ApiCall].Record(StartUs);
             break;
         }
         case SpinQuicAPICallShutdownConnection: {
             auto Connection = Connections.TryGetRandom();
             BAIL_ON_NULL_CONNECTION(Connection);
+            StartUs = QuicTimeUs64();
             MsQuic->ConnectionShutdown(Connection, (QUIC_CONNECTION_SHUTDOWN_FLAGS)GetRandom(2), 0);
+            ApiLatency[ApiCall].Record(StartUs);
             break;
         }
         case SpinQuicAPICallCloseConnection: {
             auto Connection = Connections.TryGetRandom(true);
             BAIL_ON_NULL_CONNECTION(Connection);
+            StartUs = QuicTimeUs64();
             delete SpinQuicConnection::Get(Connection);
+            ApiLatency[ApiCall].Record(StartUs);
             break;
         }
         case SpinQuicAPICallStreamOpen: {
             auto Connection = Connections.TryGetRandom();
             BAIL_ON_NULL_CONNECTION(Connection);
             HQUIC Stream;
+            StartUs = QuicTimeUs64();
             QUIC_STATUS Status = MsQuic->StreamOpen(Connection, (QUIC_STREAM_OPEN_FLAGS)GetRandom(2), SpinQuicHandleStreamEvent, nullptr, &Stream);
+            ApiLatency[ApiCall].Record(StartUs);
             if (QUIC_SUCCEEDED(Status)) {
                 SpinQuicConnection::Get(Connection)->AddStream(Stream);
             }
@@ -509,7 +673,10 @@ void Spin(LockableVector<HQUIC>& Connections, bool IsServer)
                 std::lock_guard<std::mutex> Lock(ctx->Lock);
                 auto Stream = ctx->TryGetStream();
                 if (Stream == nullptr) continue;
+                StartUs = QuicTimeUs64();
+                MsQuic->SetContext(Stream, (void*)(uintptr_t)StartUs);
                 MsQuic->StreamStart(Stream, (QUIC_STREAM_START_FLAGS)GetRandom(2) | QUIC_STREAM_START_FLAG_ASYNC);
+                ApiLatency[ApiCall].Record(StartUs);
             }
             break;
         }
@@ -522,7 +689,9 @@ void Spin(LockableVector<HQUIC>& Connections, bool IsServer)
                 auto Stream = ctx->TryGetStream();
                 if (Stream == nullptr) continue;
                 auto Buffer = &Buffers[GetRandom(BufferCount)];
+                StartUs = QuicTimeUs64();
                 MsQuic->StreamSend(Stream, Buffer, 1, (QUIC_SEND_FLAGS)GetRandom(8), nullptr);
+                ApiLatency[ApiCall].Record(StartUs);
             }
             break;
         }
@@ -534,7 +703,9 @@ void Spin(LockableVector<HQUIC>& Connections, bool IsServer)
                 std::lock_guard<std::mutex> Lock(ctx->Lock);
                 auto Stream = ctx->TryGetStream();
                 if (Stream == nullptr) continue;
+                StartUs = QuicTimeUs64();
                 MsQuic->StreamShutdown(Stream, (QUIC_STREAM_SHUTDOWN_FLAGS)GetRandom(16), 0);
+                ApiLatency[ApiCall].Record(StartUs);
             }
             break;
         }
@@ -548,25 +719,33 @@ void Spin(LockableVector<HQUIC>& Connections, bool IsServer)
                 Stream = ctx->TryGetStream(true);
             }
             if (Stream == nullptr) continue;
+            StartUs = QuicTimeUs64();
             MsQuic->StreamClose(Stream);
+            ApiLatency[ApiCall].Record(StartUs);
             break;
         }
         case SpinQuicAPICallSetParamSession: {
             auto Session = GetRandomFromVector(Sessions);
+            StartUs = QuicTimeUs64();
             SpinQuicSetRandomSesssioParam(Session);
+            ApiLatency[ApiCall].Record(StartUs);
             break;
         }
         case SpinQuicAPICallSetParamConnection: {
             auto Connection = Connections.TryGetRandom();
             BAIL_ON_NULL_CONNECTION(Connection);
+            StartUs = QuicTimeUs64();
             SpinQuicSetRandomConnectionParam(Connection);
+            ApiLatency[ApiCall].Record(StartUs);
             break;
         }
         case SpinQuicAPICallDatagramSend: {
             auto Connection = Connections.TryGetRandom();
             BAIL_ON_NULL_CONNECTION(Connection);
             auto Buffer = &Buffers[GetRandom(BufferCount)];
+            StartUs = QuicTimeUs64();
             MsQuic->DatagramSend(Connection, Buffer, 1, (QUIC_SEND_FLAGS)GetRandom(8), nullptr);
+            ApiLatency[ApiCall].Record(StartUs);
         }
         default:
             break;
@@ -574,6 +753,28 @@ void Spin(LockableVector<HQUIC>& Connections, bool IsServer)
     }
 }
 
+void ResetStats(void)
+{
+    for (uint32_t i = 0; i < SpinQuicAPICallCount; ++i) {
+        ApiLatency[i].Reset();
+    }
+    ConnectionCallbackLatency.Reset();
+    StreamCallbackLatency.Reset();
+    StreamStartDelay.Reset();
+}
+
+void PrintStats(void)
+{
+    printf("Latency (us):\n");
+    printf("  %-24s %10s %10s %10s %10s %10s\n", "", "Count", "Avg", "P50", "P99", "Max");
+    for (uint32_t i = 0; i < SpinQuicAPICallCount; ++i) {
+        ApiLatency[i].Print(SpinQuicAPICallNames[i]);
+    }
+    ConnectionCallbackLatency.Print("Connection callback");
+    StreamCallbackLatency.Print("Stream callback");
+    StreamStartDelay.Print("Stream start queue delay");
+}
+
 QUIC_THREAD_CALLBACK(ServerSpin, Context)
 {
     UNREFERENCED_PARAMETER(Context);
@@ -705,6 +906,9 @@ void PrintHelpText(void)
           "  -target:<ip>           default: '127.0.0.1'\n" \
           "  -timeout:<count_ms>    default: 60000\n" \
           "  -repeat_count:<count>  default: 1\n" \
+          "  -threads:<count>       default: 1 (client spin threads)\n" \
+          "  -rate:<ops_per_sec>    default: 0 (unlimited, per spin thread)\n" \
+          "  -stats:<0/1>           default: 0 (print latency stats)\n" \
           );
     exit(1);
 }
@@ -744,17 +948,28 @@ main(int argc, char **argv)
     Settings.AlpnPrefix = "spin";
     Settings.MaxOperationCount = UINT64_MAX;
     Settings.LossPercent = 1;
+    Settings.ClientThreadCount = 1;
+    Settings.OpsPerSecond = 0;
+    Settings.PrintStats = 0;
 
     TryGetValue(argc, argv, "timeout", &Settings.RunTimeMs);
     TryGetValue(argc, argv, "max_ops", &Settings.MaxOperationCount);
     TryGetValue(argc, argv, "loss", &Settings.LossPercent);
     TryGetValue(argc, argv, "repeat_count", &RepeatCount);
+    TryGetValue(argc, argv, "threads", &Settings.ClientThreadCount);
+    TryGetValue(argc, argv, "rate", &Settings.OpsPerSecond);
+    TryGetValue(argc, argv, "stats", &Settings.PrintStats);
 
     if (RepeatCount == 0) {
         printf("Must specify a non 0 repeat count\n");
         PrintHelpText();
     }
 
+    if (Settings.ClientThreadCount == 0) {
+        printf("Must specify a non 0 thread count\n");
+        PrintHelpText();
+    }
+
     if (RunClient) {
         uint16_t dstPort = 0;
         if (TryGetValue(argc, argv, "dstport", &dstPort)) {
@@ -839,9 +1054,11 @@ main(int argc, char **argv)
             free(AlpnBuffer.Buffer);
         }
 
-        QUIC_THREAD Threads[2];
+        QUIC_THREAD ServerThread;
+        std::vector<QUIC_THREAD> ClientThreads(Settings.ClientThreadCount);
         QUIC_THREAD_CONFIG Config = { 0 };
 
+        ResetStats();
         StartTimeMs = QuicTimeMs64();
 
         //
@@ -851,13 +1068,19 @@ main(int argc, char **argv)
         if (RunServer) {
             Config.Name = "spin_server";
             Config.Callback = ServerSpin;
-            EXIT_ON_FAILURE(QuicThreadCreate(&Config, &Threads[0]));
+            EXIT_ON_FAILURE(QuicThreadCreate(&Config, &ServerThread));
         }
 
         if (RunClient) {
+            //
+            // Each client thread spins on its own connections, but they all
+            // share the sessions (and the library's locks).
+            //
             Config.Name = "spin_client";
             Config.Callback = ClientSpin;
-            EXIT_ON_FAILURE(QuicThreadCreate(&Config, &Threads[1]));
+            for (auto &Thread : ClientThreads) {
+                EXIT_ON_FAILURE(QuicThreadCreate(&Config, &Thread));
+            }
         }
 
         //
@@ -865,13 +1088,19 @@ main(int argc, char **argv)
         //
 
         if (RunClient) {
-            QuicThreadWait(&Threads[1]);
-            QuicThreadDelete(&Threads[1]);
+            for (auto &Thread : ClientThreads) {
+                QuicThreadWait(&Thread);
+                QuicThreadDelete(&Thread);
+            }
         }
 
         if (RunServer) {
-            QuicThreadWait(&Threads[0]);
-            QuicThreadDelete(&Threads[0]);
+            QuicThreadWait(&ServerThread);
+            QuicThreadDelete(&ServerThread);
+        }
+
+        if (Settings.PrintStats) {
+            PrintStats();
         }
 
         //